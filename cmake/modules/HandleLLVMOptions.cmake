@@ -40,6 +40,10 @@ else()
   endif()
 endif()
 
+if( LLVM_ENABLE_USE_BACK_POINTERS )
+  add_definitions( -DLLVM_ENABLE_USE_BACK_POINTERS=1 )
+endif()
+
 if(WIN32)
   if(CYGWIN)
     set(LLVM_ON_WIN32 0)
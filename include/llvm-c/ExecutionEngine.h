@@ -41,6 +41,7 @@ void LLVMLinkInInterpreter(void);
 typedef struct LLVMOpaqueGenericValue *LLVMGenericValueRef;
 typedef struct LLVMOpaqueExecutionEngine *LLVMExecutionEngineRef;
 typedef struct LLVMOpaqueMCJITMemoryManager *LLVMMCJITMemoryManagerRef;
+typedef struct LLVMOpaqueMCJITObjectCache *LLVMMCJITObjectCacheRef;
 
 struct LLVMMCJITCompilerOptions {
   unsigned OptLevel;
@@ -148,6 +149,12 @@ void LLVMAddModule(LLVMExecutionEngineRef EE, LLVMModuleRef M);
 /** Deprecated: Use LLVMAddModule instead. */
 void LLVMAddModuleProvider(LLVMExecutionEngineRef EE, LLVMModuleProviderRef MP);
 
+/**
+ * Remove a module from the execution engine and return it in OutMod, which
+ * the caller then owns.  MCJIT also unloads the code and data generated for
+ * the module and gives their memory back to the memory manager, so pointers
+ * into them must not be used afterwards.
+ */
 LLVMBool LLVMRemoveModule(LLVMExecutionEngineRef EE, LLVMModuleRef M,
                           LLVMModuleRef *OutMod, char **OutError);
 
@@ -169,6 +176,40 @@ void LLVMAddGlobalMapping(LLVMExecutionEngineRef EE, LLVMValueRef Global,
 
 void *LLVMGetPointerToGlobal(LLVMExecutionEngineRef EE, LLVMValueRef Global);
 
+/**
+ * Return the address of the named function, generating code for the module
+ * that defines it and finalizing the loaded modules if needed.  Waits for
+ * the code if it is being generated in the background.  Returns 0 if the
+ * function is not found or the engine is not MCJIT.
+ */
+uint64_t LLVMGetFunctionAddress(LLVMExecutionEngineRef EE, const char *Name);
+
+/**
+ * Start generating code for the module that defines the named function on a
+ * background thread, and return without waiting for it.  Poll for the code
+ * with LLVMGetFunctionAddressIfReady, or wait for it with
+ * LLVMGetFunctionAddress.  The module's context must not be used by other
+ * threads until the code is ready.
+ */
+void LLVMRequestFunctionAddress(LLVMExecutionEngineRef EE, const char *Name);
+
+/**
+ * Return the address of the named function if its code is ready, and 0
+ * otherwise, in which case background code generation is requested for it.
+ * Never generates code on the calling thread.
+ */
+uint64_t LLVMGetFunctionAddressIfReady(LLVMExecutionEngineRef EE,
+                                       const char *Name);
+
+/**
+ * Generate code for a module and load it, without applying relocations or
+ * making the code executable, so that section addresses can be remapped
+ * first.  LLVMFinalizeObject then makes all loaded modules usable.
+ */
+void LLVMGenerateCodeForModule(LLVMExecutionEngineRef EE, LLVMModuleRef M);
+
+void LLVMFinalizeObject(LLVMExecutionEngineRef EE);
+
 /*===-- Operations on memory managers -------------------------------------===*/
 
 typedef uint8_t *(*LLVMMemoryManagerAllocateCodeSectionCallback)(
@@ -201,6 +242,43 @@ LLVMMCJITMemoryManagerRef LLVMCreateSimpleMCJITMemoryManager(
 
 void LLVMDisposeMCJITMemoryManager(LLVMMCJITMemoryManagerRef MM);
 
+/*===-- Operations on object caches ---------------------------------------===*/
+
+typedef void (*LLVMObjectCacheNotifyObjectCompiledCallback)(
+  void *Opaque, LLVMModuleRef M, const char *ObjData, size_t ObjSize);
+typedef LLVMMemoryBufferRef (*LLVMObjectCacheGetObjectCallback)(
+  void *Opaque, LLVMModuleRef M);
+typedef void (*LLVMObjectCacheDestroyCallback)(void *Opaque);
+
+/**
+ * Create an MCJIT object cache that forwards to the given callbacks.  This
+ * will return NULL if any of the passed functions are NULL.  The callbacks
+ * may be called on the engine's background compilation thread.
+ *
+ * @param Opaque An opaque client object to pass back to the callbacks.
+ * @param NotifyObjectCompiled Called with the object file generated for a
+ *   module.  The data is only valid during the call, so it must be copied.
+ * @param GetObject Return a memory buffer with the object file for a module,
+ *   or NULL to have code generated for it.  The engine takes ownership of the
+ *   buffer.
+ * @param Destroy Called when the cache is disposed of.
+ */
+LLVMMCJITObjectCacheRef LLVMCreateSimpleMCJITObjectCache(
+  void *Opaque,
+  LLVMObjectCacheNotifyObjectCompiledCallback NotifyObjectCompiled,
+  LLVMObjectCacheGetObjectCallback GetObject,
+  LLVMObjectCacheDestroyCallback Destroy);
+
+void LLVMDisposeMCJITObjectCache(LLVMMCJITObjectCacheRef Cache);
+
+/**
+ * Set the object cache of an MCJIT execution engine, or clear it if Cache is
+ * NULL.  The engine does not take ownership of the cache, which must outlive
+ * it or be cleared first.
+ */
+void LLVMSetMCJITObjectCache(LLVMExecutionEngineRef EE,
+                             LLVMMCJITObjectCacheRef Cache);
+
 /**
  * @}
  */
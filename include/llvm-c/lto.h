@@ -40,7 +40,7 @@ typedef bool lto_bool_t;
  * @{
  */
 
-#define LTO_API_VERSION 5
+#define LTO_API_VERSION 7
 
 typedef enum {
     LTO_SYMBOL_ALIGNMENT_MASK              = 0x0000001F, /* log2 of alignment */
@@ -296,6 +296,34 @@ lto_codegen_compile(lto_code_gen_t cg, size_t* length);
 extern lto_bool_t
 lto_codegen_compile_to_file(lto_code_gen_t cg, const char** name);
 
+/**
+ * Sets the number of partitions the merged module is split into by
+ * lto_codegen_compile_to_files(). Each partition is compiled concurrently
+ * on its own thread. The default is 1.
+ */
+extern void
+lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned parallelism);
+
+/**
+ * Sets a directory in which lto_codegen_compile_to_files() caches the object
+ * file of each partition, and from which it reuses them for partitions whose
+ * optimized IR and code generation options didn't change. The directory is
+ * created if needed and can be shared by concurrent links.
+ */
+extern void
+lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *path);
+
+/**
+ * Generates code for all added modules into one native object file per
+ * partition (see lto_codegen_set_parallelism()). The array of file names is
+ * written to names and its length to num_files; it is owned by the
+ * lto_code_gen_t and will be freed when lto_codegen_dispose() is called.
+ * Returns true on error.
+ */
+extern lto_bool_t
+lto_codegen_compile_to_files(lto_code_gen_t cg, const char*** names,
+                             unsigned* num_files);
+
 
 /**
  * Sets options to help debug codegen bugs.
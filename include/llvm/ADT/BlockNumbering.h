@@ -0,0 +1,106 @@
+//===-- llvm/ADT/BlockNumbering.h - Dense block number caches ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the BlockNumberTraits template, which block types
+// specialize to expose the dense numbers their function gives them, and
+// BlockNumberCache, a vector indexed by those numbers that analyses put in
+// front of their block maps.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_BLOCKNUMBERING_H
+#define LLVM_ADT_BLOCKNUMBERING_H
+
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+// BlockNumberTraits - Block types that are numbered densely within their
+// function specialize this.  The default version reports no numbering, which
+// turns a BlockNumberCache into a no-op.
+//
+template<class BlockT>
+struct BlockNumberTraits {
+  static const bool HasNumbering = false;
+
+  // getNumber - Return the number of BB within its function, or -1 if it has
+  // none.
+  static int getNumber(const BlockT *BB) { return -1; }
+
+  // getEpoch - Return a value that changes whenever the function of BB gives
+  // a number that was in use to a different block, or a block a number it
+  // had before.  Numbers that are only ever handed out once need not change
+  // it.
+  static unsigned getEpoch(const BlockT *BB) { return 0; }
+};
+
+/// BlockNumberCache - A cache of non-null values for the blocks of one
+/// function, indexed by block number.  It sits in front of the map that owns
+/// the values: lookups that hit skip hashing, and lookups that miss fall back
+/// to the map, which then records the value with insert.  The owner must call
+/// erase whenever the map drops or replaces the value of a block.
+template<class BlockT, class ValueT>
+class BlockNumberCache {
+  typedef BlockNumberTraits<BlockT> Traits;
+  typedef std::pair<const BlockT*, ValueT> EntryTy;
+
+  mutable std::vector<EntryTy> Entries;
+  mutable unsigned Epoch;
+
+  /// getSlot - Return the slot of BB, or null if BB is null or has no
+  /// number.  Entries recorded under an older epoch are discarded first,
+  /// since their numbers may now belong to other blocks.
+  EntryTy *getSlot(const BlockT *BB, bool Grow) const {
+    if (!Traits::HasNumbering || !BB)
+      return 0;
+    int Number = Traits::getNumber(BB);
+    if (Number < 0)
+      return 0;
+    unsigned CurEpoch = Traits::getEpoch(BB);
+    if (CurEpoch != Epoch) {
+      Entries.clear();
+      Epoch = CurEpoch;
+    }
+    if (unsigned(Number) >= Entries.size()) {
+      if (!Grow)
+        return 0;
+      Entries.resize(Number + 1, EntryTy(0, ValueT()));
+    }
+    return &Entries[Number];
+  }
+
+public:
+  BlockNumberCache() : Epoch(0) {}
+
+  /// lookup - Return the value recorded for BB, or null if there is none.
+  ValueT lookup(const BlockT *BB) const {
+    EntryTy *Slot = getSlot(BB, false);
+    return Slot && Slot->first == BB ? Slot->second : ValueT();
+  }
+
+  /// insert - Record V as the value of BB.
+  void insert(const BlockT *BB, ValueT V) const {
+    if (EntryTy *Slot = getSlot(BB, true))
+      *Slot = EntryTy(BB, V);
+  }
+
+  /// erase - Forget the value of BB, if one is recorded.
+  void erase(const BlockT *BB) {
+    EntryTy *Slot = getSlot(BB, false);
+    if (Slot && Slot->first == BB)
+      *Slot = EntryTy(0, ValueT());
+  }
+
+  void clear() { Entries.clear(); }
+};
+
+} // End llvm namespace
+
+#endif
@@ -527,6 +527,95 @@ public:
   }
 };
 
+//===----------------------------------------------------------------------===//
+/// FoldingSetWithHash - This template class is a FoldingSet that keeps the
+/// hash of each node in the node itself.  The hash is computed once, when
+/// the node is inserted; growing the table then never profiles a node again,
+/// and lookups only profile the nodes whose hash matches the one looked up,
+/// instead of every node in the bucket.  This pays off for nodes with
+/// expensive Profile methods.
+///
+/// T must be a subclass of FoldingSetNode that implements a Profile function
+/// and the getFoldingSetHash and setFoldingSetHash methods of
+/// FoldingSetNodeWithHash, e.g. by deriving from it.
+///
+/// Nodes must only be inserted through this class, so it hides the FoldingSet
+/// it is built on.  A node whose profile changes must be removed from the set
+/// before the change and inserted again after it, as with any FoldingSet.
+template<class T> class FoldingSetWithHash : private FoldingSet<T> {
+  typedef FoldingSet<T> BaseT;
+
+  /// NodeEquals - Compare the stored hash before profiling the node.
+  virtual bool NodeEquals(FoldingSetImpl::Node *N, const FoldingSetNodeID &ID,
+                          unsigned IDHash, FoldingSetNodeID &TempID) const {
+    T *TN = static_cast<T *>(N);
+    return TN->getFoldingSetHash() == IDHash &&
+           FoldingSetTrait<T>::Equals(*TN, ID, IDHash, TempID);
+  }
+  /// ComputeNodeHash - Return the stored hash.
+  virtual unsigned ComputeNodeHash(FoldingSetImpl::Node *N,
+                                   FoldingSetNodeID &) const {
+    return static_cast<T *>(N)->getFoldingSetHash();
+  }
+
+public:
+  explicit FoldingSetWithHash(unsigned Log2InitSize = 6)
+  : BaseT(Log2InitSize)
+  {}
+
+  typedef typename BaseT::iterator iterator;
+  typedef typename BaseT::const_iterator const_iterator;
+  typedef typename BaseT::bucket_iterator bucket_iterator;
+  using BaseT::begin;
+  using BaseT::end;
+  using BaseT::bucket_begin;
+  using BaseT::bucket_end;
+  using BaseT::clear;
+  using BaseT::size;
+  using BaseT::empty;
+  using BaseT::RemoveNode;
+  using BaseT::FindNodeOrInsertPos;
+
+  /// GetOrInsertNode - If there is an existing simple Node exactly
+  /// equal to the specified node, return it.  Otherwise, insert 'N' and
+  /// return it instead.
+  T *GetOrInsertNode(T *N) {
+    FoldingSetNodeID ID;
+    FoldingSetTrait<T>::Profile(*N, ID);
+    void *InsertPos;
+    if (T *Existing = FindNodeOrInsertPos(ID, InsertPos))
+      return Existing;
+    InsertNode(N, InsertPos, ID);
+    return N;
+  }
+
+  /// InsertNode - Insert the specified node into the folding set, knowing that
+  /// it is not already in the folding set.  InsertPos must be obtained from
+  /// FindNodeOrInsertPos.  This profiles N to compute its hash.
+  void InsertNode(T *N, void *InsertPos) {
+    FoldingSetNodeID ID;
+    FoldingSetTrait<T>::Profile(*N, ID);
+    InsertNode(N, InsertPos, ID);
+  }
+
+  /// InsertNode - Insert the specified node into the folding set, knowing that
+  /// it is not already in the folding set.  InsertPos must be obtained from
+  /// FindNodeOrInsertPos, and ID is the profile of N that was passed to it,
+  /// which saves profiling N again.
+  void InsertNode(T *N, void *InsertPos, const FoldingSetNodeID &ID) {
+    N->setFoldingSetHash(ID.ComputeHash());
+    FoldingSetImpl::InsertNode(N, InsertPos);
+  }
+
+  /// InsertNode - Insert the specified node into the folding set, knowing that
+  /// it is not already in the folding set.
+  void InsertNode(T *N) {
+    T *Inserted = GetOrInsertNode(N);
+    (void)Inserted;
+    assert(Inserted == N && "Node already inserted!");
+  }
+};
+
 //===----------------------------------------------------------------------===//
 /// FoldingSetVectorIterator - This implements an iterator for
 /// FoldingSetVector. It is only necessary because FoldingSetIterator provides
@@ -782,6 +871,18 @@ public:
   }
 };
 
+//===----------------------------------------------------------------------===//
+/// FoldingSetNodeWithHash - This is a subclass of FoldingSetNode which holds
+/// the hash that a FoldingSetWithHash computed for it.
+class FoldingSetNodeWithHash : public FoldingSetNode {
+  unsigned FoldingSetHash;
+public:
+  FoldingSetNodeWithHash() : FoldingSetHash(0) {}
+
+  unsigned getFoldingSetHash() const { return FoldingSetHash; }
+  void setFoldingSetHash(unsigned Hash) { FoldingSetHash = Hash; }
+};
+
 //===----------------------------------------------------------------------===//
 // Partial specializations of FoldingSetTrait.
 
@@ -0,0 +1,753 @@
+//===- llvm/ADT/GroupDenseMap.h - Group probed hash table -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the GroupDenseMap class, an open addressing hash table
+// with the interface of DenseMap.
+//
+// Next to its array of buckets, the table keeps one control byte per bucket
+// that says whether the bucket is empty, was erased, or holds a key, in which
+// case the byte holds seven bits of the hash of that key.  A lookup compares
+// the control bytes of sixteen buckets at a time against those seven bits,
+// using SSE2 or NEON where available, and only compares the keys of the
+// buckets that matched, so most failed probes never touch the buckets.
+//
+// Unlike DenseMap, the key info only has to provide getHashValue and
+// isEqual; the empty and tombstone keys are never used, so every value of
+// the key type can be stored.  Like DenseMap, inserting into the map
+// invalidates its iterators and the references to its elements.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_GROUPDENSEMAP_H
+#define LLVM_ADT_GROUPDENSEMAP_H
+
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/type_traits.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LLVM_GROUPDENSEMAP_SSE2 1
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) &&                        \
+    (defined(__ARMEL__) || defined(__AARCH64EL__))
+#define LLVM_GROUPDENSEMAP_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace llvm {
+
+namespace groupdensemap_detail {
+/// Control byte of a bucket that never held a key.
+const int8_t CtrlEmpty = -128;
+/// Control byte of a bucket whose key was erased.
+const int8_t CtrlDeleted = -2;
+/// Number of control bytes looked at together.
+const unsigned GroupWidth = 16;
+
+/// MatchMask - The buckets of a group that matched, as a bit mask with
+/// 1 << Shift bits per bucket of which only the highest one may be set.
+template <unsigned Shift> class MatchMask {
+  uint64_t Bits;
+
+public:
+  explicit MatchMask(uint64_t Bits) : Bits(Bits) {}
+
+  bool any() const { return Bits != 0; }
+  /// Index in the group of the first bucket that matched.
+  unsigned lowest() const {
+    return countTrailingZeros(Bits, ZB_Undefined) >> Shift;
+  }
+  /// Index in the group of the last bucket that matched.
+  unsigned highest() const {
+    return (63 - countLeadingZeros(Bits, ZB_Undefined)) >> Shift;
+  }
+  void clearLowest() { Bits &= Bits - 1; }
+};
+
+/// Group - GroupWidth consecutive control bytes.
+#if defined(LLVM_GROUPDENSEMAP_SSE2)
+class Group {
+  __m128i Ctrl;
+
+  static MatchMask<0> toMask(__m128i V) {
+    return MatchMask<0>(static_cast<unsigned>(_mm_movemask_epi8(V)));
+  }
+
+public:
+  typedef MatchMask<0> MaskT;
+
+  explicit Group(const int8_t *Pos)
+      : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Pos))) {}
+
+  MaskT match(int8_t H2) const {
+    return toMask(_mm_cmpeq_epi8(_mm_set1_epi8(H2), Ctrl));
+  }
+  MaskT matchEmpty() const {
+    return toMask(_mm_cmpeq_epi8(_mm_set1_epi8(CtrlEmpty), Ctrl));
+  }
+  // Only the empty and deleted control bytes have their sign bit set.
+  MaskT matchEmptyOrDeleted() const { return toMask(Ctrl); }
+};
+#elif defined(LLVM_GROUPDENSEMAP_NEON)
+class Group {
+  int8x16_t Ctrl;
+
+  // NEON has no movemask; narrowing each 16-bit lane by four bits packs the
+  // comparison into a nibble per byte, of which the top bit is kept.
+  static MatchMask<2> toMask(uint8x16_t V) {
+    uint8x8_t N = vshrn_n_u16(vreinterpretq_u16_u8(V), 4);
+    uint64_t Bits = vget_lane_u64(vreinterpret_u64_u8(N), 0);
+    return MatchMask<2>(Bits & 0x8888888888888888ULL);
+  }
+
+public:
+  typedef MatchMask<2> MaskT;
+
+  explicit Group(const int8_t *Pos) : Ctrl(vld1q_s8(Pos)) {}
+
+  MaskT match(int8_t H2) const {
+    return toMask(vceqq_s8(vdupq_n_s8(H2), Ctrl));
+  }
+  MaskT matchEmpty() const {
+    return toMask(vceqq_s8(vdupq_n_s8(CtrlEmpty), Ctrl));
+  }
+  MaskT matchEmptyOrDeleted() const {
+    return toMask(vcltq_s8(Ctrl, vdupq_n_s8(0)));
+  }
+};
+#else
+class Group {
+  const int8_t *Ctrl;
+
+  template <class PredT> MatchMask<0> matchIf(PredT Pred) const {
+    uint64_t Bits = 0;
+    for (unsigned i = 0; i != GroupWidth; ++i)
+      if (Pred(Ctrl[i]))
+        Bits |= uint64_t(1) << i;
+    return MatchMask<0>(Bits);
+  }
+
+  struct IsEqual {
+    int8_t C;
+    explicit IsEqual(int8_t C) : C(C) {}
+    bool operator()(int8_t B) const { return B == C; }
+  };
+  struct IsNegative {
+    bool operator()(int8_t B) const { return B < 0; }
+  };
+
+public:
+  typedef MatchMask<0> MaskT;
+
+  explicit Group(const int8_t *Pos) : Ctrl(Pos) {}
+
+  MaskT match(int8_t H2) const { return matchIf(IsEqual(H2)); }
+  MaskT matchEmpty() const { return matchIf(IsEqual(CtrlEmpty)); }
+  MaskT matchEmptyOrDeleted() const { return matchIf(IsNegative()); }
+};
+#endif
+} // end namespace groupdensemap_detail
+
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT = DenseMapInfo<KeyT>,
+         bool IsConst = false>
+class GroupDenseMapIterator;
+
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT = DenseMapInfo<KeyT> >
+class GroupDenseMap {
+  typedef std::pair<KeyT, ValueT> BucketT;
+  typedef groupdensemap_detail::Group Group;
+
+  /// The buckets, followed by NumBuckets control bytes and a copy of the
+  /// first GroupWidth of them, so that the group of any bucket can be loaded
+  /// without wrapping around.
+  BucketT *Buckets;
+  int8_t *Ctrl;
+  unsigned NumEntries;
+  unsigned NumTombstones;
+  unsigned NumBuckets;
+
+public:
+  typedef KeyT key_type;
+  typedef ValueT mapped_type;
+  typedef BucketT value_type;
+
+  typedef GroupDenseMapIterator<KeyT, ValueT, KeyInfoT> iterator;
+  typedef GroupDenseMapIterator<KeyT, ValueT, KeyInfoT, true> const_iterator;
+
+  explicit GroupDenseMap(unsigned NumInitBuckets = 0) {
+    init(NumInitBuckets);
+  }
+
+  GroupDenseMap(const GroupDenseMap &Other) {
+    init(0);
+    copyFrom(Other);
+  }
+
+#if LLVM_HAS_RVALUE_REFERENCES
+  GroupDenseMap(GroupDenseMap &&Other) {
+    init(0);
+    swap(Other);
+  }
+#endif
+
+  template<typename InputIt>
+  GroupDenseMap(const InputIt &I, const InputIt &E) {
+    init(getMinBucketsFor(std::distance(I, E)));
+    insert(I, E);
+  }
+
+  ~GroupDenseMap() {
+    destroyAll();
+    operator delete(Buckets);
+  }
+
+  GroupDenseMap &operator=(const GroupDenseMap &Other) {
+    if (&Other != this)
+      copyFrom(Other);
+    return *this;
+  }
+
+#if LLVM_HAS_RVALUE_REFERENCES
+  GroupDenseMap &operator=(GroupDenseMap &&Other) {
+    destroyAll();
+    operator delete(Buckets);
+    init(0);
+    swap(Other);
+    return *this;
+  }
+#endif
+
+  void swap(GroupDenseMap &RHS) {
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(NumTombstones, RHS.NumTombstones);
+    std::swap(NumBuckets, RHS.NumBuckets);
+  }
+
+  inline iterator begin() {
+    return empty() ? end() : iterator(Buckets, Buckets + NumBuckets, Ctrl);
+  }
+  inline iterator end() {
+    return iterator(Buckets + NumBuckets, Buckets + NumBuckets, 0, true);
+  }
+  inline const_iterator begin() const {
+    return empty() ? end()
+                   : const_iterator(Buckets, Buckets + NumBuckets, Ctrl);
+  }
+  inline const_iterator end() const {
+    return const_iterator(Buckets + NumBuckets, Buckets + NumBuckets, 0, true);
+  }
+
+  bool LLVM_ATTRIBUTE_UNUSED_RESULT empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it has at least Size buckets. Does not shrink.
+  void resize(size_t Size) {
+    if (Size > NumBuckets)
+      grow(Size);
+  }
+
+  void clear() {
+    if (NumEntries == 0 && NumTombstones == 0) return;
+
+    // If the capacity of the array is huge, and the # elements used is small,
+    // shrink the array.
+    if (NumEntries * 4 < NumBuckets && NumBuckets > 64) {
+      shrink_and_clear();
+      return;
+    }
+
+    destroyAll();
+    initEmpty();
+  }
+
+  /// count - Return true if the specified key is in the map.
+  bool count(const KeyT &Val) const {
+    unsigned Index;
+    return LookupBucketFor(Val, Index);
+  }
+
+  iterator find(const KeyT &Val) { return find_as(Val); }
+  const_iterator find(const KeyT &Val) const { return find_as(Val); }
+
+  /// Alternate version of find() which allows a different, and possibly
+  /// less expensive, key type.
+  /// The key info is responsible for supplying methods
+  /// getHashValue(LookupKeyT) and isEqual(LookupKeyT, KeyT) for each key
+  /// type used.
+  template<class LookupKeyT>
+  iterator find_as(const LookupKeyT &Val) {
+    unsigned Index;
+    if (LookupBucketFor(Val, Index))
+      return makeIterator(Index);
+    return end();
+  }
+  template<class LookupKeyT>
+  const_iterator find_as(const LookupKeyT &Val) const {
+    unsigned Index;
+    if (LookupBucketFor(Val, Index))
+      return makeIterator(Index);
+    return end();
+  }
+
+  /// lookup - Return the entry for the specified key, or a default
+  /// constructed value if no such entry exists.
+  ValueT lookup(const KeyT &Val) const {
+    unsigned Index;
+    if (LookupBucketFor(Val, Index))
+      return Buckets[Index].second;
+    return ValueT();
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    unsigned Index;
+    if (LookupBucketFor(KV.first, Index))
+      return std::make_pair(makeIterator(Index), false); // Already in map.
+
+    // Otherwise, insert the new element.
+    Index = InsertIntoBucket(KV.first, KV.second, Index);
+    return std::make_pair(makeIterator(Index), true);
+  }
+
+#if LLVM_HAS_RVALUE_REFERENCES
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    unsigned Index;
+    if (LookupBucketFor(KV.first, Index))
+      return std::make_pair(makeIterator(Index), false); // Already in map.
+
+    // Otherwise, insert the new element.
+    Index = InsertIntoBucket(std::move(KV.first), std::move(KV.second), Index);
+    return std::make_pair(makeIterator(Index), true);
+  }
+#endif
+
+  /// insert - Range insertion of pairs.
+  template<typename InputIt>
+  void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  bool erase(const KeyT &Val) {
+    unsigned Index;
+    if (!LookupBucketFor(Val, Index))
+      return false; // not in map.
+
+    eraseBucket(Index);
+    return true;
+  }
+  void erase(iterator I) {
+    eraseBucket(&*I - Buckets);
+  }
+
+  value_type &FindAndConstruct(const KeyT &Key) {
+    unsigned Index;
+    if (LookupBucketFor(Key, Index))
+      return Buckets[Index];
+
+    // Inserting may reallocate the buckets.
+    Index = InsertIntoBucket(Key, ValueT(), Index);
+    return Buckets[Index];
+  }
+
+  ValueT &operator[](const KeyT &Key) {
+    return FindAndConstruct(Key).second;
+  }
+
+#if LLVM_HAS_RVALUE_REFERENCES
+  value_type &FindAndConstruct(KeyT &&Key) {
+    unsigned Index;
+    if (LookupBucketFor(Key, Index))
+      return Buckets[Index];
+
+    Index = InsertIntoBucket(std::move(Key), ValueT(), Index);
+    return Buckets[Index];
+  }
+
+  ValueT &operator[](KeyT &&Key) {
+    return FindAndConstruct(std::move(Key)).second;
+  }
+#endif
+
+  /// isPointerIntoBucketsArray - Return true if the specified pointer points
+  /// somewhere into the map's array of buckets (i.e. either to a key or
+  /// value in the map).
+  bool isPointerIntoBucketsArray(const void *Ptr) const {
+    return Ptr >= Buckets && Ptr < Buckets + NumBuckets;
+  }
+
+  /// getPointerIntoBucketsArray() - Return an opaque pointer into the buckets
+  /// array.  In conjunction with the previous method, this can be used to
+  /// determine whether an insertion caused the map to reallocate.
+  const void *getPointerIntoBucketsArray() const { return Buckets; }
+
+  /// Return the approximate size (in bytes) of the actual map.
+  /// This is just the raw memory used by the map.
+  /// If entries are pointers to objects, the size of the referenced objects
+  /// are not included.
+  size_t getMemorySize() const {
+    return NumBuckets ? getAllocSize(NumBuckets) : 0;
+  }
+
+  void shrink_and_clear() {
+    unsigned OldNumEntries = NumEntries;
+    destroyAll();
+
+    // Reduce the number of buckets.
+    unsigned NewNumBuckets = 0;
+    if (OldNumEntries)
+      NewNumBuckets = std::max(64, 1 << (Log2_32_Ceil(OldNumEntries) + 1));
+    if (NewNumBuckets == NumBuckets) {
+      initEmpty();
+      return;
+    }
+
+    operator delete(Buckets);
+    init(NewNumBuckets);
+  }
+
+private:
+  static size_t getAllocSize(unsigned Num) {
+    return Num * (sizeof(BucketT) + 1) + groupdensemap_detail::GroupWidth;
+  }
+
+  /// getMinBucketsFor - Return the number of buckets needed to hold Num
+  /// entries without growing.
+  static unsigned getMinBucketsFor(size_t Num) {
+    return Num ? NextPowerOf2(Num * 8 / 7) : 0;
+  }
+
+  /// getHash - Mix the hash of Val so that both the bucket it starts probing
+  /// at and the seven bits kept in the control byte depend on all its bits.
+  template<class LookupKeyT>
+  static uint64_t getHash(const LookupKeyT &Val) {
+    return uint64_t(KeyInfoT::getHashValue(Val)) * 0x9E3779B97F4A7C15ULL;
+  }
+  static unsigned getH1(uint64_t Hash) {
+    return static_cast<unsigned>(Hash ^ (Hash >> 32));
+  }
+  static int8_t getH2(uint64_t Hash) {
+    return static_cast<int8_t>(Hash >> 57);
+  }
+
+  iterator makeIterator(unsigned Index) {
+    return iterator(Buckets + Index, Buckets + NumBuckets, Ctrl + Index, true);
+  }
+  const_iterator makeIterator(unsigned Index) const {
+    return const_iterator(Buckets + Index, Buckets + NumBuckets, Ctrl + Index,
+                          true);
+  }
+
+  void setCtrl(unsigned Index, int8_t C) {
+    Ctrl[Index] = C;
+    if (Index < groupdensemap_detail::GroupWidth)
+      Ctrl[NumBuckets + Index] = C;
+  }
+
+  void init(unsigned InitBuckets) {
+    NumBuckets = 0;
+    Buckets = 0;
+    Ctrl = 0;
+    if (InitBuckets)
+      allocateBuckets(InitBuckets);
+    initEmpty();
+  }
+
+  void allocateBuckets(unsigned Num) {
+    unsigned MinBuckets = groupdensemap_detail::GroupWidth;
+    NumBuckets = Num <= MinBuckets ? MinBuckets : NextPowerOf2(Num - 1);
+    char *Mem = static_cast<char *>(operator new(getAllocSize(NumBuckets)));
+    Buckets = reinterpret_cast<BucketT *>(Mem);
+    Ctrl = reinterpret_cast<int8_t *>(Mem + NumBuckets * sizeof(BucketT));
+  }
+
+  void initEmpty() {
+    NumEntries = 0;
+    NumTombstones = 0;
+    if (NumBuckets)
+      memset(Ctrl, groupdensemap_detail::CtrlEmpty,
+             NumBuckets + groupdensemap_detail::GroupWidth);
+  }
+
+  void destroyAll() {
+    if (isPodLike<BucketT>::value)
+      return;
+    for (unsigned i = 0; i != NumBuckets; ++i)
+      if (Ctrl[i] >= 0)
+        Buckets[i].~BucketT();
+  }
+
+  void copyFrom(const GroupDenseMap &Other) {
+    destroyAll();
+    operator delete(Buckets);
+    if (!Other.NumBuckets) {
+      init(0);
+      return;
+    }
+
+    // The buckets keep their position, so the control bytes are copied as is.
+    allocateBuckets(Other.NumBuckets);
+    NumEntries = Other.NumEntries;
+    NumTombstones = Other.NumTombstones;
+    memcpy(Ctrl, Other.Ctrl, NumBuckets + groupdensemap_detail::GroupWidth);
+    if (isPodLike<BucketT>::value) {
+      memcpy(Buckets, Other.Buckets, NumBuckets * sizeof(BucketT));
+      return;
+    }
+    for (unsigned i = 0; i != NumBuckets; ++i)
+      if (Ctrl[i] >= 0)
+        new (&Buckets[i]) BucketT(Other.Buckets[i]);
+  }
+
+  void grow(unsigned AtLeast) {
+    unsigned OldNumBuckets = NumBuckets;
+    BucketT *OldBuckets = Buckets;
+    int8_t *OldCtrl = Ctrl;
+
+    allocateBuckets(AtLeast);
+    initEmpty();
+    if (!OldBuckets)
+      return;
+
+    for (unsigned i = 0; i != OldNumBuckets; ++i) {
+      if (OldCtrl[i] < 0)
+        continue;
+      BucketT &B = OldBuckets[i];
+      uint64_t Hash = getHash(B.first);
+      unsigned Index = findFreeBucket(Hash);
+      setCtrl(Index, getH2(Hash));
+      new (&Buckets[Index].first) KeyT(llvm_move(B.first));
+      new (&Buckets[Index].second) ValueT(llvm_move(B.second));
+      ++NumEntries;
+      B.~BucketT();
+    }
+
+    // Free the old table.
+    operator delete(OldBuckets);
+  }
+
+  /// findFreeBucket - Return the first empty or deleted bucket on the probe
+  /// sequence of Hash.
+  unsigned findFreeBucket(uint64_t Hash) const {
+    unsigned Mask = NumBuckets - 1;
+    unsigned Pos = getH1(Hash) & Mask;
+    for (unsigned Stride = 0;;) {
+      Group::MaskT Free = Group(Ctrl + Pos).matchEmptyOrDeleted();
+      if (Free.any())
+        return (Pos + Free.lowest()) & Mask;
+      Stride += groupdensemap_detail::GroupWidth;
+      Pos = (Pos + Stride) & Mask;
+    }
+  }
+
+  /// LookupBucketFor - Lookup the appropriate bucket for Val, returning it
+  /// in Index.  If the bucket contains the key and a value, this returns
+  /// true, otherwise it returns the bucket the key should be inserted into,
+  /// which is invalid if the map has no buckets.
+  template<typename LookupKeyT>
+  bool LookupBucketFor(const LookupKeyT &Val, unsigned &Index) const {
+    if (NumBuckets == 0) {
+      Index = 0;
+      return false;
+    }
+
+    uint64_t Hash = getHash(Val);
+    int8_t H2 = getH2(Hash);
+    unsigned Mask = NumBuckets - 1;
+    unsigned Pos = getH1(Hash) & Mask;
+    bool FoundFree = false;
+    // Visit the groups in triangular order; as NumBuckets is a power of two
+    // larger than GroupWidth, this eventually visits every bucket.
+    for (unsigned Stride = 0;;) {
+      Group G(Ctrl + Pos);
+      for (Group::MaskT M = G.match(H2); M.any(); M.clearLowest()) {
+        unsigned I = (Pos + M.lowest()) & Mask;
+        if (KeyInfoT::isEqual(Val, Buckets[I].first)) {
+          Index = I;
+          return true;
+        }
+      }
+
+      if (!FoundFree) {
+        Group::MaskT Free = G.matchEmptyOrDeleted();
+        if (Free.any()) {
+          Index = (Pos + Free.lowest()) & Mask;
+          FoundFree = true;
+        }
+      }
+
+      // The key would have been put in an empty bucket of this group.
+      if (G.matchEmpty().any())
+        return false;
+
+      Stride += groupdensemap_detail::GroupWidth;
+      Pos = (Pos + Stride) & Mask;
+    }
+  }
+
+  unsigned InsertIntoBucket(const KeyT &Key, const ValueT &Value,
+                            unsigned Index) {
+    Index = InsertIntoBucketImpl(Key, Index);
+    new (&Buckets[Index].first) KeyT(Key);
+    new (&Buckets[Index].second) ValueT(Value);
+    return Index;
+  }
+
+#if LLVM_HAS_RVALUE_REFERENCES
+  unsigned InsertIntoBucket(KeyT &&Key, ValueT &&Value, unsigned Index) {
+    Index = InsertIntoBucketImpl(Key, Index);
+    new (&Buckets[Index].first) KeyT(std::move(Key));
+    new (&Buckets[Index].second) ValueT(std::move(Value));
+    return Index;
+  }
+#endif
+
+  /// InsertIntoBucketImpl - Claim a bucket for Key, preferably Index, and
+  /// return it.  The caller constructs the key and value in it.
+  unsigned InsertIntoBucketImpl(const KeyT &Key, unsigned Index) {
+    using namespace groupdensemap_detail;
+    uint64_t Hash = getHash(Key);
+
+    // Keep at least one bucket in eight empty, counting the tombstones, both
+    // so that probes stay short and so that they terminate.  When tombstones
+    // take most of that room, rehash at the same size instead of growing.
+    if (NumBuckets == 0 ||
+        (Ctrl[Index] == CtrlEmpty &&
+         (NumEntries + NumTombstones + 1) * 8ULL > NumBuckets * 7ULL)) {
+      if (NumBuckets == 0)
+        grow(64);
+      else if ((NumEntries + 1) * 16ULL > NumBuckets * 7ULL)
+        grow(NumBuckets * 2);
+      else
+        grow(NumBuckets);
+      Index = findFreeBucket(Hash);
+    }
+
+    if (Ctrl[Index] == CtrlDeleted)
+      --NumTombstones;
+    ++NumEntries;
+    setCtrl(Index, getH2(Hash));
+    return Index;
+  }
+
+  void eraseBucket(unsigned Index) {
+    using namespace groupdensemap_detail;
+    Buckets[Index].~BucketT();
+    --NumEntries;
+
+    // A lookup only skips past a group without empty buckets, so if every
+    // group containing this bucket has one, nobody probed past it and it can
+    // become empty again instead of a tombstone.
+    unsigned Mask = NumBuckets - 1;
+    Group::MaskT After = Group(Ctrl + Index).matchEmpty();
+    Group::MaskT Before = Group(Ctrl + ((Index - GroupWidth) & Mask))
+                              .matchEmpty();
+    if (After.any() && Before.any() &&
+        After.lowest() + (GroupWidth - 1 - Before.highest()) < GroupWidth) {
+      setCtrl(Index, CtrlEmpty);
+      return;
+    }
+    setCtrl(Index, CtrlDeleted);
+    ++NumTombstones;
+  }
+};
+
+template<typename KeyT, typename ValueT,
+         typename KeyInfoT, bool IsConst>
+class GroupDenseMapIterator {
+  typedef std::pair<KeyT, ValueT> Bucket;
+  typedef GroupDenseMapIterator<KeyT, ValueT,
+                                KeyInfoT, true> ConstIterator;
+  friend class GroupDenseMapIterator<KeyT, ValueT, KeyInfoT, true>;
+public:
+  typedef ptrdiff_t difference_type;
+  typedef typename conditional<IsConst, const Bucket, Bucket>::type value_type;
+  typedef value_type *pointer;
+  typedef value_type &reference;
+  typedef std::forward_iterator_tag iterator_category;
+private:
+  pointer Ptr, End;
+  const int8_t *Ctrl;
+public:
+  GroupDenseMapIterator() : Ptr(0), End(0), Ctrl(0) {}
+
+  GroupDenseMapIterator(pointer Pos, pointer E, const int8_t *C,
+                        bool NoAdvance = false)
+    : Ptr(Pos), End(E), Ctrl(C) {
+    if (!NoAdvance) AdvancePastEmptyBuckets();
+  }
+
+  // If IsConst is true this is a converting constructor from iterator to
+  // const_iterator and the default copy constructor is used.
+  // Otherwise this is a copy constructor for iterator.
+  GroupDenseMapIterator(const GroupDenseMapIterator<KeyT, ValueT,
+                                                    KeyInfoT, false> &I)
+    : Ptr(I.Ptr), End(I.End), Ctrl(I.Ctrl) {}
+
+  reference operator*() const {
+    return *Ptr;
+  }
+  pointer operator->() const {
+    return Ptr;
+  }
+
+  bool operator==(const ConstIterator &RHS) const {
+    return Ptr == RHS.operator->();
+  }
+  bool operator!=(const ConstIterator &RHS) const {
+    return Ptr != RHS.operator->();
+  }
+
+  inline GroupDenseMapIterator& operator++() {  // Preincrement
+    ++Ptr;
+    ++Ctrl;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  GroupDenseMapIterator operator++(int) {  // Postincrement
+    GroupDenseMapIterator tmp = *this; ++*this; return tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    while (Ptr != End && *Ctrl < 0) {
+      ++Ptr;
+      ++Ctrl;
+    }
+  }
+};
+
+template<typename KeyT, typename ValueT, typename KeyInfoT>
+static inline size_t
+capacity_in_bytes(const GroupDenseMap<KeyT, ValueT, KeyInfoT> &X) {
+  return X.getMemorySize();
+}
+
+} // end namespace llvm
+
+#endif
@@ -28,84 +28,93 @@
 
 #include "llvm/Support/Atomic.h"
 #include "llvm/Support/Valgrind.h"
+#include <utility>
+#include <vector>
 
 namespace llvm {
 class raw_ostream;
 
+/// Statistic - A counter that is printed with -stats.  Updates are added to a
+/// per-thread shard of the counter, so that threads bumping the same
+/// statistic do not contend for its cache line; reading the value sums the
+/// shards.
 class Statistic {
 public:
   const char *Name;
   const char *Desc;
+  /// The part of the value that is not in the per-thread shards.
   volatile llvm::sys::cas_flag Value;
   bool Initialized;
+  /// The slot of this statistic in the per-thread shards, valid once
+  /// Initialized is set.
+  unsigned Index;
 
-  llvm::sys::cas_flag getValue() const { return Value; }
+  llvm::sys::cas_flag getValue() const;
   const char *getName() const { return Name; }
   const char *getDesc() const { return Desc; }
 
   /// construct - This should only be called for non-global statistics.
   void construct(const char *name, const char *desc) {
     Name = name; Desc = desc;
-    Value = 0; Initialized = 0;
+    Value = 0; Initialized = 0; Index = 0;
   }
 
   // Allow use of this class as the value itself.
-  operator unsigned() const { return Value; }
+  operator unsigned() const { return getValue(); }
 
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
-   const Statistic &operator=(unsigned Val) {
-    Value = Val;
-    return init();
+  const Statistic &operator=(unsigned Val) {
+    init();
+    setValue(Val);
+    return *this;
   }
 
   const Statistic &operator++() {
-    // FIXME: This function and all those that follow carefully use an
-    // atomic operation to update the value safely in the presence of
-    // concurrent accesses, but not to read the return value, so the
-    // return value is not thread safe.
-    sys::AtomicIncrement(&Value);
-    return init();
+    add(1);
+    return *this;
   }
 
   unsigned operator++(int) {
-    init();
-    unsigned OldValue = Value;
-    sys::AtomicIncrement(&Value);
+    unsigned OldValue = getValue();
+    add(1);
     return OldValue;
   }
 
   const Statistic &operator--() {
-    sys::AtomicDecrement(&Value);
-    return init();
+    add(-1);
+    return *this;
   }
 
   unsigned operator--(int) {
-    init();
-    unsigned OldValue = Value;
-    sys::AtomicDecrement(&Value);
+    unsigned OldValue = getValue();
+    add(-1);
     return OldValue;
   }
 
   const Statistic &operator+=(const unsigned &V) {
     if (!V) return *this;
-    sys::AtomicAdd(&Value, V);
-    return init();
+    add(V);
+    return *this;
   }
 
   const Statistic &operator-=(const unsigned &V) {
     if (!V) return *this;
-    sys::AtomicAdd(&Value, -V);
-    return init();
+    add(-V);
+    return *this;
   }
 
+  // Multiplying and dividing are not atomic with respect to concurrent
+  // updates of the same statistic.
   const Statistic &operator*=(const unsigned &V) {
-    sys::AtomicMul(&Value, V);
-    return init();
+    init();
+    setValue(getValue() * V);
+    return *this;
   }
 
   const Statistic &operator/=(const unsigned &V) {
-    sys::AtomicDiv(&Value, V);
-    return init();
+    init();
+    setValue(getValue() / V);
+    return *this;
   }
 
 #else  // Statistics are disabled in release builds.
@@ -157,12 +166,18 @@ protected:
     return *this;
   }
   void RegisterStatistic();
+  /// add - Add Delta to the shard of the current thread.
+  void add(llvm::sys::cas_flag Delta);
+  /// setValue - Set the value, clearing the shards.
+  void setValue(llvm::sys::cas_flag Val);
+
+  friend void ResetStatistics();
 };
 
 // STATISTIC - A macro to make definition of statistics really simple.  This
 // automatically passes the DEBUG_TYPE of the file into the statistic.
 #define STATISTIC(VARNAME, DESC) \
-  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0 }
+  static llvm::Statistic VARNAME = { DEBUG_TYPE, DESC, 0, 0, 0 }
 
 /// \brief Enable the collection and printing of statistics.
 void EnableStatistics();
@@ -176,6 +191,15 @@ void PrintStatistics();
 /// \brief Print statistics to the given output stream.
 void PrintStatistics(raw_ostream &OS);
 
+/// \brief Return every statistic that has been updated so far, whether or
+/// not -stats was given, with its current value, sorted by name.
+std::vector<std::pair<const Statistic *, unsigned> > GetStatistics();
+
+/// \brief Set every statistic back to zero, e.g. before the next compilation
+/// whose statistics are to be collected with GetStatistics.  Must not be
+/// called while other threads update statistics.
+void ResetStatistics();
+
 } // End llvm namespace
 
 #endif
@@ -37,7 +37,9 @@
 #ifndef LLVM_ANALYSIS_ALIASANALYSIS_H
 #define LLVM_ANALYSIS_ALIASANALYSIS_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/CallSite.h"
 
 namespace llvm {
@@ -61,7 +63,19 @@ protected:
 private:
   AliasAnalysis *AA;       // Previous Alias Analysis to chain to.
 
+  /// The number of AliasBatches active for this analysis, and the number of
+  /// batches begun so far.
+  unsigned BatchDepth, BatchNumber;
+
 protected:
+  /// isInBatch - Return true if an AliasBatch is active, so the IR is not
+  /// changing between queries.
+  bool isInBatch() const { return BatchDepth != 0; }
+
+  /// getBatchNumber - Return a number that identifies the outermost active
+  /// AliasBatch, or the last one to end.
+  unsigned getBatchNumber() const { return BatchNumber; }
+
   /// InitializeAliasAnalysis - Subclasses must call this method to initialize
   /// the AliasAnalysis interface before any other methods are called.  This is
   /// typically called by the run* methods of these subclasses.  This may be
@@ -75,7 +89,7 @@ protected:
 
 public:
   static char ID; // Class identification, replacement for typeinfo
-  AliasAnalysis() : TD(0), TLI(0), AA(0) {}
+  AliasAnalysis() : TD(0), TLI(0), AA(0), BatchDepth(0), BatchNumber(0) {}
   virtual ~AliasAnalysis();  // We want to be subclassed
 
   /// UnknownSize - This is a special value which can be used with the
@@ -182,6 +196,31 @@ public:
     return alias(V1, UnknownSize, V2, UnknownSize);
   }
 
+  /// AliasBatch - While an AliasBatch exists for an alias analysis, it and
+  /// the analyses it chains to may remember what they learn about pointers
+  /// from one query to the next.  The IR must not change while a batch is
+  /// active.  Batches may nest.
+  class AliasBatch {
+    AliasBatch(const AliasBatch &) LLVM_DELETED_FUNCTION;
+    void operator=(const AliasBatch &) LLVM_DELETED_FUNCTION;
+    AliasAnalysis &AA;
+  public:
+    explicit AliasBatch(AliasAnalysis &AA);
+    ~AliasBatch();
+  };
+  friend class AliasBatch;
+
+  /// batchAlias - Ask whether LocA aliases each of LocBs, in an AliasBatch,
+  /// and append the answers to Results in the order of LocBs.
+  void batchAlias(const Location &LocA, ArrayRef<Location> LocBs,
+                  SmallVectorImpl<AliasResult> &Results);
+
+  /// batchAlias - Ask whether each of LocAs aliases each of LocBs, in an
+  /// AliasBatch, and append the answers to Results row by row: the answer for
+  /// LocAs[i] and LocBs[j] is at index i * LocBs.size() + j.
+  void batchAlias(ArrayRef<Location> LocAs, ArrayRef<Location> LocBs,
+                  SmallVectorImpl<AliasResult> &Results);
+
   /// isNoAlias - A trivial helper function to check to see if the specified
   /// pointers are no-alias.
   bool isNoAlias(const Location &LocA, const Location &LocB) {
@@ -18,6 +18,7 @@
 #define LLVM_ANALYSIS_ALIASSETTRACKER_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/ADT/ilist_node.h"
 #include "llvm/Support/ValueHandle.h"
@@ -95,15 +96,7 @@ class AliasSet : public ilist_node<AliasSet> {
       AS = as;
     }
 
-    void eraseFromList() {
-      if (NextInList) NextInList->PrevInList = PrevInList;
-      *PrevInList = NextInList;
-      if (AS->PtrListEnd == &NextInList) {
-        AS->PtrListEnd = PrevInList;
-        assert(*AS->PtrListEnd == 0 && "List not terminated right!");
-      }
-      delete this;
-    }
+    void eraseFromList(AliasSetTracker &AST);
   };
 
   PointerRec *PtrList, **PtrListEnd;  // Doubly linked list of nodes.
@@ -112,6 +105,16 @@ class AliasSet : public ilist_node<AliasSet> {
   // All instructions without a specific address in this alias set.
   std::vector<AssertingVH<Instruction> > UnknownInsts;
 
+  // Objects - The distinct allocas and global variables the pointers in this
+  // set are based on, unless UnknownObjects is set.  A pointer based on an
+  // object that isn't in the list can't alias the set, which lets most sets be
+  // skipped without asking alias analysis when a loop accesses memory through
+  // a handful of base pointers.
+  SmallVector<const Value*, 4> Objects;
+
+  // SetSize - The number of pointers in this set.
+  unsigned SetSize;
+
   // RefCount - Number of nodes pointing to this AliasSet plus the number of
   // AliasSets forwarding to it.
   unsigned RefCount : 28;
@@ -138,6 +141,10 @@ class AliasSet : public ilist_node<AliasSet> {
   // Volatile - True if this alias set contains volatile loads or stores.
   bool Volatile : 1;
 
+  // UnknownObjects - True if some pointer in this set may be based on an
+  // object other than those in Objects.
+  bool UnknownObjects : 1;
+
   void addRef() { ++RefCount; }
   void dropRef(AliasSetTracker &AST) {
     assert(RefCount >= 1 && "Invalid reference count detected!");
@@ -220,8 +227,9 @@ private:
   // Can only be created by AliasSetTracker. Also, ilist creates one
   // to serve as a sentinel.
   friend struct ilist_sentinel_traits<AliasSet>;
-  AliasSet() : PtrList(0), PtrListEnd(&PtrList), Forward(0), RefCount(0),
-               AccessTy(NoModRef), AliasTy(MustAlias), Volatile(false) {
+  AliasSet() : PtrList(0), PtrListEnd(&PtrList), Forward(0), SetSize(0),
+               RefCount(0), AccessTy(NoModRef), AliasTy(MustAlias),
+               Volatile(false), UnknownObjects(false) {
   }
 
   AliasSet(const AliasSet &AS) LLVM_DELETED_FUNCTION;
@@ -251,7 +259,9 @@ private:
   void addPointer(AliasSetTracker &AST, PointerRec &Entry, uint64_t Size,
                   const MDNode *TBAAInfo,
                   bool KnownMustAlias = false);
-  void addUnknownInst(Instruction *I, AliasAnalysis &AA);
+  void addUnknownInst(Instruction *I, AliasSetTracker &AST);
+  void addObject(const Value *Obj);
+  void setMayAlias(AliasSetTracker &AST);
   void removeUnknownInst(Instruction *I) {
     for (size_t i = 0, e = UnknownInsts.size(); i != e; ++i)
       if (UnknownInsts[i] == I) {
@@ -269,6 +279,11 @@ public:
   bool aliasesPointer(const Value *Ptr, uint64_t Size, const MDNode *TBAAInfo,
                       AliasAnalysis &AA) const;
   bool aliasesUnknownInst(Instruction *Inst, AliasAnalysis &AA) const;
+
+  /// mayContainObject - Return false if no pointer in this set can point into
+  /// Obj, the distinct object some pointer is based on, without having to ask
+  /// alias analysis.  A null Obj may be anything.
+  bool mayContainObject(const Value *Obj) const;
 };
 
 inline raw_ostream& operator<<(raw_ostream &OS, const AliasSet &AS) {
@@ -302,11 +317,22 @@ class AliasSetTracker {
   // Map from pointers to their node
   PointerMapType PointerMap;
 
+  /// AliasAnyAS - Once the tracker is saturated, the single alias set every
+  /// access is put in.
+  AliasSet *AliasAnyAS;
+
+  /// TotalMayAliasSetSize - The number of pointers in may-alias sets.  Adding
+  /// a pointer has to query alias analysis against each of them, so when the
+  /// count passes -alias-set-saturation-threshold the tracker merges all of
+  /// its sets into one and stops making queries.
+  unsigned TotalMayAliasSetSize;
+
 public:
   /// AliasSetTracker ctor - Create an empty collection of AliasSets, and use
   /// the specified alias analysis object to disambiguate load and store
   /// addresses.
-  explicit AliasSetTracker(AliasAnalysis &aa) : AA(aa) {}
+  explicit AliasSetTracker(AliasAnalysis &aa)
+    : AA(aa), AliasAnyAS(0), TotalMayAliasSetSize(0) {}
   ~AliasSetTracker() { clear(); }
 
   /// add methods - These methods are used to add different types of
@@ -368,6 +394,10 @@ public:
   /// alias sets.
   bool containsPointer(Value *P, uint64_t Size, const MDNode *TBAAInfo) const;
 
+  /// isSaturated - Return true if the tracker has given up on telling
+  /// accesses apart, and keeps every access in a single may-alias set.
+  bool isSaturated() const { return AliasAnyAS != 0; }
+
   /// getAliasAnalysis - Return the underlying alias analysis object used by
   /// this tracker.
   AliasAnalysis &getAliasAnalysis() const { return AA; }
@@ -425,6 +455,9 @@ private:
                                    const MDNode *TBAAInfo);
 
   AliasSet *findAliasSetForUnknownInst(Instruction *Inst);
+
+  void checkSaturation();
+  void mergeAllAliasSets();
 };
 
 inline raw_ostream& operator<<(raw_ostream &OS, const AliasSetTracker &AST) {
@@ -15,6 +15,7 @@
 #ifndef LLVM_ANALYSIS_DOMINATORS_H
 #define LLVM_ANALYSIS_DOMINATORS_H
 
+#include "llvm/ADT/BlockNumbering.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -200,6 +201,8 @@ class DominatorTreeBase : public DominatorBase<NodeT> {
 protected:
   typedef DenseMap<NodeT*, DomTreeNodeBase<NodeT>*> DomTreeNodeMapType;
   DomTreeNodeMapType DomTreeNodes;
+  // NodeCache - DomTreeNodes indexed by block number, filled in by getNode.
+  BlockNumberCache<NodeT, DomTreeNodeBase<NodeT>*> NodeCache;
   DomTreeNodeBase<NodeT> *RootNode;
 
   bool DFSInfoValid;
@@ -227,6 +230,7 @@ protected:
            E = DomTreeNodes.end(); I != E; ++I)
       delete I->second;
     DomTreeNodes.clear();
+    NodeCache.clear();
     IDoms.clear();
     this->Roots.clear();
     Vertex.clear();
@@ -333,7 +337,12 @@ public:
   /// block.  This is the same as using operator[] on this class.
   ///
   inline DomTreeNodeBase<NodeT> *getNode(NodeT *BB) const {
-    return DomTreeNodes.lookup(BB);
+    if (DomTreeNodeBase<NodeT> *Node = NodeCache.lookup(BB))
+      return Node;
+    DomTreeNodeBase<NodeT> *Node = DomTreeNodes.lookup(BB);
+    if (Node)
+      NodeCache.insert(BB, Node);
+    return Node;
   }
 
   /// getRootNode - This returns the entry node for the CFG of the function.  If
@@ -535,6 +544,7 @@ public:
     }
 
     DomTreeNodes.erase(BB);
+    NodeCache.erase(BB);
     delete Node;
   }
 
@@ -544,6 +554,7 @@ public:
   void removeNode(NodeT *BB) {
     assert(getNode(BB) && "Removing node that isn't in dominator tree.");
     DomTreeNodes.erase(BB);
+    NodeCache.erase(BB);
   }
 
   /// splitBlock - BB is split and now it has one successor. Update dominator
@@ -555,6 +566,47 @@ public:
       this->Split<NodeT*, GraphTraits<NodeT*> >(*this, NewBB);
   }
 
+  /// insertEdge - Update the tree after the edge From->To has been added to
+  /// the CFG.  Only the subtree that can have changed is recomputed.
+  void insertEdge(NodeT *From, NodeT *To) {
+    // An edge out of an unreachable block does not change dominance.
+    if (!getNode(From))
+      return;
+    // Blocks that were unreachable may have become reachable through To.
+    if (!getNode(To) || this->isPostDominator()) {
+      recalculate(*From->getParent());
+      return;
+    }
+
+    // New paths to To, and to the blocks it dominates, all come through
+    // From, so only the blocks below the nearest common dominator of the two
+    // can lose dominators.  If To's immediate dominator is already that
+    // block, none of them do.
+    NodeT *NCD = findNearestCommonDominator(From, To);
+    if (NCD == To || getNode(To)->getIDom()->getBlock() == NCD)
+      return;
+    recalculateSubtree(getNode(NCD));
+  }
+
+  /// deleteEdge - Update the tree after the edge From->To has been removed
+  /// from the CFG.  Blocks that become unreachable are removed from the tree.
+  void deleteEdge(NodeT *From, NodeT *To) {
+    if (!getNode(From) || !getNode(To))
+      return;
+    if (this->isPostDominator()) {
+      recalculate(*From->getParent());
+      return;
+    }
+
+    // A back edge to a dominator of From does not change dominance.
+    // Otherwise only the blocks below the nearest common dominator of the two
+    // can gain dominators.
+    NodeT *NCD = findNearestCommonDominator(From, To);
+    if (NCD == To)
+      return;
+    recalculateSubtree(getNode(NCD));
+  }
+
   /// print - Convert to human readable form
   ///
   void print(raw_ostream &o) const {
@@ -588,8 +640,10 @@ protected:
   friend void Calculate(DominatorTreeBase<typename GraphTraits<N>::NodeType>& DT,
                         FuncT& F);
 
+public:
   /// updateDFSNumbers - Assign In and Out numbers to the nodes while walking
-  /// dominator tree in dfs order.
+  /// dominator tree in dfs order.  Until the tree is changed, dominance
+  /// queries then only read it, so several threads can make them at once.
   void updateDFSNumbers() {
     unsigned DFSNum = 0;
 
@@ -632,6 +686,7 @@ protected:
     DFSInfoValid = true;
   }
 
+protected:
   DomTreeNodeBase<NodeT> *getNodeForBlock(NodeT *BB) {
     if (DomTreeNodeBase<NodeT> *Node = getNode(BB))
       return Node;
@@ -657,6 +712,100 @@ protected:
     this->Roots.push_back(BB);
   }
 
+  /// recalculateSubtree - Recompute the immediate dominators of the blocks
+  /// in the subtree of R, which must still dominate all of them.  Blocks of
+  /// the subtree that are no longer reachable are removed from the tree.
+  void recalculateSubtree(DomTreeNodeBase<NodeT> *R) {
+    if (!R->getIDom()) {
+      recalculate(*R->getBlock()->getParent());
+      return;
+    }
+
+    // Collect the subtree in preorder.  Each block's postorder number, found
+    // below, is zero until a CFG walk from R reaches it.
+    SmallVector<DomTreeNodeBase<NodeT> *, 32> Subtree;
+    DenseMap<NodeT *, unsigned> Number;
+    Subtree.push_back(R);
+    for (unsigned i = 0; i != Subtree.size(); ++i) {
+      Number[Subtree[i]->getBlock()] = 0;
+      Subtree.append(Subtree[i]->begin(), Subtree[i]->end());
+    }
+
+    // Number the blocks reachable from R in postorder.  Any path into the
+    // subtree passes through R, so edges leaving it can be ignored.
+    typedef GraphTraits<NodeT *> GT;
+    typedef GraphTraits<Inverse<NodeT *> > InvGT;
+    SmallVector<NodeT *, 32> PostOrder;
+    SmallPtrSet<NodeT *, 32> Visited;
+    SmallVector<std::pair<NodeT *, typename GT::ChildIteratorType>, 32> Stack;
+    Visited.insert(R->getBlock());
+    Stack.push_back(std::make_pair(R->getBlock(),
+                                   GT::child_begin(R->getBlock())));
+    while (!Stack.empty()) {
+      NodeT *BB = Stack.back().first;
+      if (Stack.back().second == GT::child_end(BB)) {
+        PostOrder.push_back(BB);
+        Number[BB] = PostOrder.size();
+        Stack.pop_back();
+        continue;
+      }
+      NodeT *Succ = *Stack.back().second++;
+      if (Number.count(Succ) && Visited.insert(Succ))
+        Stack.push_back(std::make_pair(Succ, GT::child_begin(Succ)));
+    }
+
+    // Iterate the immediate dominators to a fixed point in reverse postorder,
+    // intersecting the dominators of the processed predecessors.
+    DenseMap<NodeT *, NodeT *> NewIDom;
+    NewIDom[R->getBlock()] = R->getBlock();
+    bool Changed = true;
+    while (Changed) {
+      Changed = false;
+      for (unsigned i = PostOrder.size() - 1; i-- != 0;) {
+        NodeT *BB = PostOrder[i];
+        NodeT *IDom = 0;
+        for (typename InvGT::ChildIteratorType PI = InvGT::child_begin(BB),
+                                               PE = InvGT::child_end(BB);
+             PI != PE; ++PI) {
+          NodeT *Pred = *PI;
+          if (!Number.lookup(Pred) || !NewIDom.count(Pred))
+            continue;
+          if (!IDom) {
+            IDom = Pred;
+            continue;
+          }
+          while (IDom != Pred) {
+            while (Number[IDom] < Number[Pred])
+              IDom = NewIDom[IDom];
+            while (Number[Pred] < Number[IDom])
+              Pred = NewIDom[Pred];
+          }
+        }
+        NodeT *&Old = NewIDom[BB];
+        if (Old != IDom) {
+          Old = IDom;
+          Changed = true;
+        }
+      }
+    }
+
+    // R is last in postorder and keeps its immediate dominator.
+    for (unsigned i = 0, e = PostOrder.size() - 1; i != e; ++i) {
+      DomTreeNodeBase<NodeT> *N = getNode(PostOrder[i]);
+      NodeT *IDom = NewIDom[PostOrder[i]];
+      if (N->getIDom()->getBlock() != IDom)
+        changeImmediateDominator(N, getNode(IDom));
+    }
+
+    // Remove the blocks that were not reached, children first.
+    for (unsigned i = Subtree.size(); i-- != 0;) {
+      NodeT *BB = Subtree[i]->getBlock();
+      if (!Number[BB])
+        eraseNode(BB);
+    }
+    DFSInfoValid = false;
+  }
+
 public:
   /// recalculate - compute a dominator tree for the given function
   template<class FT>
@@ -792,6 +941,8 @@ public:
 
   virtual bool runOnFunction(Function &F);
 
+  virtual bool isFunctionLocal() const { return true; }
+
   virtual void verifyAnalysis() const;
 
   virtual void getAnalysisUsage(AnalysisUsage &AU) const {
@@ -876,6 +1027,15 @@ public:
     DT->splitBlock(NewBB);
   }
 
+  /// insertEdge - Update the tree after the edge From->To has been added to
+  /// the CFG.  With -verify-dom-info the result is checked against a tree
+  /// computed from scratch.
+  void insertEdge(BasicBlock *From, BasicBlock *To);
+
+  /// deleteEdge - Update the tree after the edge From->To has been removed
+  /// from the CFG.  Blocks that become unreachable are removed from the tree.
+  void deleteEdge(BasicBlock *From, BasicBlock *To);
+
   bool isReachableFromEntry(const BasicBlock* A) const {
     return DT->isReachableFromEntry(A);
   }
@@ -14,12 +14,14 @@
 #ifndef LLVM_ANALYSIS_INLINECOST_H
 #define LLVM_ANALYSIS_INLINECOST_H
 
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include <cassert>
 #include <climits>
 
 namespace llvm {
 class CallSite;
+class CalleeWalkCache;
 class DataLayout;
 class Function;
 class TargetTransformInfo;
@@ -102,6 +104,12 @@ class InlineCostAnalysis : public CallGraphSCCPass {
   const DataLayout *TD;
   const TargetTransformInfo *TTI;
 
+  /// Walks of callees recorded for call sites that tell nothing about the
+  /// callee's arguments, so that later such call sites needn't walk the
+  /// callee again. Callees in the SCC being visited are never cached, since
+  /// the inliner and the function passes after it change them.
+  OwningPtr<CalleeWalkCache> WalkCache;
+
 public:
   static char ID;
 
@@ -111,6 +119,8 @@ public:
   // Pass interface implementation.
   void getAnalysisUsage(AnalysisUsage &AU) const;
   bool runOnSCC(CallGraphSCC &SCC);
+  using llvm::Pass::doFinalization;
+  bool doFinalization(CallGraph &CG);
 
   /// \brief Get an InlineCost object representing the cost of inlining this
   /// callsite.
@@ -0,0 +1,68 @@
+//===- InstSimplifyCache.h - Cache of failed simplifications ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares InstSimplifyCache, an immutable pass that remembers the
+// instructions SimplifyInstruction could not simplify, so that the passes of
+// a long pipeline do not keep trying again on instructions that have not
+// changed since.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_INSTSIMPLIFYCACHE_H
+#define LLVM_ANALYSIS_INSTSIMPLIFYCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/ValueHandle.h"
+
+namespace llvm {
+
+class DataLayout;
+class DominatorTree;
+class Instruction;
+class TargetLibraryInfo;
+
+/// InstSimplifyCache - Remembers, for each instruction SimplifyInstruction
+/// failed on, a hash of its operands and of the analyses that were passed in.
+/// Asking again about the instruction with the same operands and analyses
+/// fails immediately.
+///
+/// Only failures are remembered, so a stale entry can at worst hide a
+/// simplification that a change deeper in the operand tree has made possible;
+/// it never produces a wrong result.
+class InstSimplifyCache : public ImmutablePass {
+  /// CacheVH - Drops an instruction's entry when it is deleted.
+  class CacheVH : public CallbackVH {
+    InstSimplifyCache *Cache;
+    virtual void deleted();
+  public:
+    CacheVH(Value *V, InstSimplifyCache *Cache = 0)
+      : CallbackVH(V), Cache(Cache) {}
+  };
+
+  typedef DenseMap<CacheVH, size_t, DenseMapInfo<Value *> > FailureMapType;
+  FailureMapType Failures;
+
+public:
+  static char ID;
+  InstSimplifyCache();
+
+  /// simplify - Return what SimplifyInstruction returns for I, without
+  /// calling it if it already failed on I with the same operands.
+  Value *simplify(Instruction *I, const DataLayout *TD = 0,
+                  const TargetLibraryInfo *TLI = 0,
+                  const DominatorTree *DT = 0);
+
+  /// clear - Forget every failure.
+  void clear() { Failures.clear(); }
+};
+
+} // End llvm namespace
+
+#endif
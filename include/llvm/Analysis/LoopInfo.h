@@ -30,6 +30,7 @@
 #ifndef LLVM_ANALYSIS_LOOPINFO_H
 #define LLVM_ANALYSIS_LOOPINFO_H
 
+#include "llvm/ADT/BlockNumbering.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -452,6 +453,8 @@ template<class BlockT, class LoopT>
 class LoopInfoBase {
   // BBMap - Mapping of basic blocks to the inner most loop they occur in
   DenseMap<BlockT *, LoopT *> BBMap;
+  // BBCache - BBMap indexed by block number, filled in by getLoopFor.
+  BlockNumberCache<BlockT, LoopT *> BBCache;
   std::vector<LoopT *> TopLevelLoops;
   friend class LoopBase<BlockT, LoopT>;
   friend class LoopInfo;
@@ -468,6 +471,7 @@ public:
       delete *I;   // Delete all of the loops...
 
     BBMap.clear();                           // Reset internal state of analysis
+    BBCache.clear();
     TopLevelLoops.clear();
   }
 
@@ -487,7 +491,12 @@ public:
   /// block is in no loop (for example the entry node), null is returned.
   ///
   LoopT *getLoopFor(const BlockT *BB) const {
-    return BBMap.lookup(const_cast<BlockT*>(BB));
+    if (LoopT *L = BBCache.lookup(BB))
+      return L;
+    LoopT *L = BBMap.lookup(const_cast<BlockT*>(BB));
+    if (L)
+      BBCache.insert(BB, L);
+    return L;
   }
 
   /// operator[] - same as getLoopFor...
@@ -525,6 +534,7 @@ public:
   /// specified loop.  This should be used by transformations that restructure
   /// the loop hierarchy tree.
   void changeLoopFor(BlockT *BB, LoopT *L) {
+    BBCache.erase(BB);
     if (!L) {
       BBMap.erase(BB);
       return;
@@ -561,6 +571,7 @@ public:
         L->removeBlockFromLoop(BB);
 
       BBMap.erase(I);
+      BBCache.erase(BB);
     }
   }
 
@@ -641,6 +652,8 @@ public:
   ///
   virtual bool runOnFunction(Function &F);
 
+  virtual bool isFunctionLocal() const { return true; }
+
   virtual void verifyAnalysis() const;
 
   virtual void releaseMemory() { LI.releaseMemory(); }
@@ -380,7 +380,9 @@ namespace llvm {
     /// conservative in memdep.  This is an optional call that can be used when
     /// the client detects an equivalence between the pointer and some other
     /// value and replaces the other value with ptr. This can make Ptr available
-    /// in more places that cached info does not necessarily keep.
+    /// in more places that cached info does not necessarily keep.  Only the
+    /// cached results for blocks that access memory through Ptr, or through a
+    /// pointer derived from it, are thrown away.
     void invalidateCachedPointerInfo(Value *Ptr);
 
     /// invalidateCachedPredecessors - Clear the PredIteratorCache info.
@@ -433,6 +435,8 @@ namespace llvm {
                                          unsigned NumSortedEntries);
 
     void RemoveCachedNonLocalPointerDependencies(ValueIsLoadPair P);
+    void RemoveCachedNonLocalPointerDependencies(
+        ValueIsLoadPair P, const SmallPtrSet<BasicBlock*, 16> &Blocks);
 
     /// verifyRemoved - Verify that the specified instruction does not occur
     /// in our internal data structures.
@@ -0,0 +1,250 @@
+//===- llvm/Analysis/MemorySSA.h - SSA form for memory ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the MemorySSA analysis, which puts the memory operations
+// of a function into SSA form.  Every instruction that may write memory is a
+// MemoryDef, which produces a new version of memory, and every instruction
+// that only reads memory is a MemoryUse of some version.  Where versions
+// from different paths meet, a MemoryPhi merges them.  The version on entry
+// to the function is the live-on-entry def.
+//
+// Each access's defining access is the closest preceding version of memory;
+// it may or may not actually alias the access.  getClobberingMemoryAccess
+// walks further up the chains, using alias analysis, to find the nearest
+// access that really may clobber the queried location, and caches what it
+// finds.  Passes that need the reaching store for a load, or whether a store
+// is dead, can ask this directly instead of scanning blocks backwards.
+//
+// Clients that delete instructions with memory accesses must call
+// removeMemoryAccess first.  The analysis is not otherwise updated, so passes
+// that add memory operations must not preserve it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ANALYSIS_MEMORYSSA_H
+#define LLVM_ANALYSIS_MEMORYSSA_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Pass.h"
+#include <vector>
+
+namespace llvm {
+
+class BasicBlock;
+class DominatorTree;
+class Instruction;
+class MemorySSA;
+class raw_ostream;
+
+/// MemoryAccess - The base class of the nodes of the memory SSA form.
+class MemoryAccess {
+public:
+  enum AccessKind { UseKind, DefKind, PhiKind };
+
+private:
+  MemoryAccess(const MemoryAccess &) LLVM_DELETED_FUNCTION;
+  void operator=(const MemoryAccess &) LLVM_DELETED_FUNCTION;
+
+  AccessKind Kind;
+  BasicBlock *Block;
+
+  /// Users - The accesses that take this access as their defining access or
+  /// as an incoming value, once for every such operand.
+  std::vector<MemoryAccess*> Users;
+
+  friend class MemorySSA;
+
+protected:
+  MemoryAccess(AccessKind K, BasicBlock *BB) : Kind(K), Block(BB) {}
+
+public:
+  virtual ~MemoryAccess();
+
+  AccessKind getKind() const { return Kind; }
+  BasicBlock *getBlock() const { return Block; }
+
+  typedef std::vector<MemoryAccess*>::const_iterator user_iterator;
+  user_iterator user_begin() const { return Users.begin(); }
+  user_iterator user_end() const { return Users.end(); }
+  bool user_empty() const { return Users.empty(); }
+
+  /// print - Print this access the way MemorySSA annotates the function.
+  virtual void print(raw_ostream &OS) const = 0;
+  void dump() const;
+};
+
+/// MemoryUseOrDef - An access made by one instruction.
+class MemoryUseOrDef : public MemoryAccess {
+  Instruction *MemoryInst;
+  MemoryAccess *DefiningAccess;
+
+  friend class MemorySSA;
+
+protected:
+  MemoryUseOrDef(AccessKind K, Instruction *I, BasicBlock *BB)
+    : MemoryAccess(K, BB), MemoryInst(I), DefiningAccess(0) {}
+
+public:
+  /// getMemoryInst - Return the instruction making the access, or null for
+  /// the live-on-entry def.
+  Instruction *getMemoryInst() const { return MemoryInst; }
+
+  /// getDefiningAccess - Return the version of memory the access is made to.
+  MemoryAccess *getDefiningAccess() const { return DefiningAccess; }
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() != PhiKind;
+  }
+};
+
+/// MemoryUse - An instruction that reads memory without writing it.
+class MemoryUse : public MemoryUseOrDef {
+public:
+  MemoryUse(Instruction *I, BasicBlock *BB) : MemoryUseOrDef(UseKind, I, BB) {}
+
+  virtual void print(raw_ostream &OS) const;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == UseKind;
+  }
+};
+
+/// MemoryDef - An instruction that may write memory, which creates a new
+/// version of memory.
+class MemoryDef : public MemoryUseOrDef {
+  unsigned ID;
+
+public:
+  MemoryDef(Instruction *I, BasicBlock *BB, unsigned Ver)
+    : MemoryUseOrDef(DefKind, I, BB), ID(Ver) {}
+
+  /// getID - Return the number of the version of memory this def creates.
+  /// The live-on-entry def is 0.
+  unsigned getID() const { return ID; }
+
+  virtual void print(raw_ostream &OS) const;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == DefKind;
+  }
+};
+
+/// MemoryPhi - The merge of the versions of memory flowing into a block.
+class MemoryPhi : public MemoryAccess {
+  unsigned ID;
+  SmallVector<std::pair<BasicBlock*, MemoryAccess*>, 4> Incoming;
+
+  friend class MemorySSA;
+
+public:
+  MemoryPhi(BasicBlock *BB, unsigned Ver)
+    : MemoryAccess(PhiKind, BB), ID(Ver) {}
+
+  unsigned getID() const { return ID; }
+
+  unsigned getNumIncomingValues() const { return Incoming.size(); }
+  BasicBlock *getIncomingBlock(unsigned i) const { return Incoming[i].first; }
+  MemoryAccess *getIncomingValue(unsigned i) const {
+    return Incoming[i].second;
+  }
+
+  virtual void print(raw_ostream &OS) const;
+
+  static bool classof(const MemoryAccess *MA) {
+    return MA->getKind() == PhiKind;
+  }
+};
+
+/// MemorySSA - Builds and owns the memory SSA form of a function.
+class MemorySSA : public FunctionPass {
+public:
+  /// AccessList - The accesses in a block, in program order, starting with
+  /// the block's MemoryPhi if it has one.
+  typedef std::vector<MemoryAccess*> AccessList;
+
+private:
+  AliasAnalysis *AA;
+  DominatorTree *DT;
+  Function *F;
+
+  DenseMap<const Instruction*, MemoryUseOrDef*> InstructionAccesses;
+  DenseMap<const BasicBlock*, AccessList*> BlockAccesses;
+  MemoryDef *LiveOnEntryDef;
+
+  /// ClobberCache - The answers getClobberingMemoryAccess has given for
+  /// instructions.
+  mutable DenseMap<const MemoryAccess*, MemoryAccess*> ClobberCache;
+
+  unsigned NextID;
+
+  AccessList &getOrCreateAccessList(BasicBlock *BB);
+  void setDefiningAccess(MemoryUseOrDef *MA, MemoryAccess *Def);
+  void addIncoming(MemoryPhi *Phi, BasicBlock *BB, MemoryAccess *Def);
+  void removeUser(MemoryAccess *Def, MemoryAccess *User);
+  void placePhis(const SmallVectorImpl<BasicBlock*> &DefBlocks);
+  void renameAccesses();
+  MemoryAccess *walkToClobber(MemoryAccess *Start,
+                              const AliasAnalysis::Location &Loc,
+                              DenseMap<MemoryPhi*, MemoryAccess*> &Visited,
+                              unsigned &Budget) const;
+
+public:
+  static char ID;
+  MemorySSA();
+  ~MemorySSA();
+
+  /// getMemoryAccess - Return the access made by I, or null if I doesn't
+  /// touch memory.
+  MemoryUseOrDef *getMemoryAccess(const Instruction *I) const {
+    return InstructionAccesses.lookup(I);
+  }
+
+  /// getMemoryPhi - Return the MemoryPhi at the start of BB, if there is one.
+  MemoryPhi *getMemoryPhi(const BasicBlock *BB) const;
+
+  /// getBlockAccesses - Return the accesses in BB, or null if there are none.
+  const AccessList *getBlockAccesses(const BasicBlock *BB) const {
+    return BlockAccesses.lookup(BB);
+  }
+
+  /// getLiveOnEntryDef - Return the def standing for the memory state on
+  /// entry to the function.
+  MemoryDef *getLiveOnEntryDef() const { return LiveOnEntryDef; }
+  bool isLiveOnEntryDef(const MemoryAccess *MA) const {
+    return MA == LiveOnEntryDef;
+  }
+
+  /// getClobberingMemoryAccess - Return the nearest access above I that may
+  /// clobber the memory I reads or writes: a MemoryDef, a MemoryPhi joining
+  /// different clobbers, or the live-on-entry def.  Calls and instructions
+  /// without a simple location get their defining access.
+  MemoryAccess *getClobberingMemoryAccess(const Instruction *I) const;
+
+  /// getClobberingMemoryAccess - Return the nearest access at or above Start
+  /// that may clobber Loc.
+  MemoryAccess *
+  getClobberingMemoryAccess(MemoryAccess *Start,
+                            const AliasAnalysis::Location &Loc) const;
+
+  /// removeMemoryAccess - Remove the access made by a MemoryUse or MemoryDef,
+  /// before its instruction is deleted.  Users of a removed def are given its
+  /// defining access instead.
+  void removeMemoryAccess(MemoryUseOrDef *MA);
+
+  virtual bool runOnFunction(Function &F);
+  virtual void releaseMemory();
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const;
+  virtual void print(raw_ostream &OS, const Module *M = 0) const;
+};
+
+} // End llvm namespace
+
+#endif
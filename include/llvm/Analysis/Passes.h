@@ -147,6 +147,13 @@ namespace llvm {
   // analyze.
   FunctionPass *createInstCountPass();
 
+  //===--------------------------------------------------------------------===//
+  //
+  // createInstSimplifyCachePass - This pass remembers the instructions that
+  // could not be simplified, for the passes that simplify instructions.
+  //
+  ImmutablePass *createInstSimplifyCachePass();
+
   //===--------------------------------------------------------------------===//
   //
   // createRegionInfoPass - This pass finds all single entry single exit regions
@@ -163,6 +170,13 @@ namespace llvm {
   // information and prints it with -analyze.
   //
   FunctionPass *createMemDepPrinter();
+
+  //===--------------------------------------------------------------------===//
+  //
+  // createMemorySSAPass - This pass builds the memory SSA form of a function,
+  // and prints it annotated with clobbers with -analyze.
+  //
+  FunctionPass *createMemorySSAPass();
 }
 
 #endif
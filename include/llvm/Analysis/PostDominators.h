@@ -34,6 +34,8 @@ struct PostDominatorTree : public FunctionPass {
 
   virtual bool runOnFunction(Function &F);
 
+  virtual bool isFunctionLocal() const { return true; }
+
   virtual void getAnalysisUsage(AnalysisUsage &AU) const {
     AU.setPreservesAll();
   }
@@ -540,6 +540,10 @@ namespace llvm {
     /// forgetMemoizedResults - Drop memoized information computed for S.
     void forgetMemoizedResults(const SCEV *S);
 
+    /// releaseCaches - Drop every cached result and free the memory the
+    /// caches use.
+    void releaseCaches();
+
     /// Return false iff given SCEV contains a SCEVUnknown with NULL value-
     /// pointer.
     bool checkValidity(const SCEV *S) const;
@@ -784,6 +788,22 @@ namespace llvm {
     /// disconnect it from a def-use chain linking it to a loop.
     void forgetValue(Value *V);
 
+    /// releaseLoop - Drop what is cached about L, its subloops and the values
+    /// defined in them.  Unlike forgetLoop this doesn't mean the loop changed;
+    /// clients call it when they are done with a loop nest, to keep memory
+    /// use down in large functions.  Anything dropped is recomputed if asked
+    /// for again.
+    void releaseLoop(const Loop *L);
+
+    /// applyCacheBudget - Drop all of the cached results if they use more
+    /// memory than -scalar-evolution-cache-budget allows.  The SCEV
+    /// expressions themselves stay alive until releaseMemory.
+    void applyCacheBudget();
+
+    /// getCacheMemorySize - Return the number of bytes the cached results
+    /// take up, not counting the SCEV expressions themselves.
+    size_t getCacheMemorySize() const;
+
     /// GetMinTrailingZeros - Determine the minimum number of zero bits that S
     /// is guaranteed to end in (at every loop iteration).  It is, at the same
     /// time, the minimum number of times S is divisible by 2.  For example,
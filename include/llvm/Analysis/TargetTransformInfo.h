@@ -297,10 +297,24 @@ public:
   /// instruction.
   virtual bool haveFastSqrt(Type *Ty) const;
 
+  /// shouldExpandDivisionByInvariant - Return true if an unsigned division
+  /// of type Ty by a loop-invariant divisor is better done as a multiply by
+  /// a reciprocal computed once outside the loop.
+  virtual bool shouldExpandDivisionByInvariant(Type *Ty) const;
+
   /// getIntImmCost - Return the expected cost of materializing the given
   /// integer immediate of the specified type.
   virtual unsigned getIntImmCost(const APInt &Imm, Type *Ty) const;
 
+  /// getCacheLineSize - Return the size of a data cache line in bytes, or 0
+  /// if it is not known.
+  virtual unsigned getCacheLineSize() const;
+
+  /// getCacheMissLatency - Return the expected number of cycles a load that
+  /// misses the data caches waits for memory, or 0 if software prefetching
+  /// should not be used.
+  virtual unsigned getCacheMissLatency() const;
+
   /// @}
 
   /// \name Vector Target Information
@@ -368,6 +382,27 @@ public:
                                    unsigned Alignment,
                                    unsigned AddressSpace) const;
 
+  /// \return The cost of an interleaved load or store: a wide load of \p VecTy
+  /// that is split into \p Factor vectors, taking every \p Factor'th element
+  /// starting at each of \p Indices, or the store that interleaves \p Factor
+  /// vectors into one of type \p VecTy.  For example, with a factor of 2, a
+  /// load of <8 x i32> yields the even elements for index 0 and the odd ones
+  /// for index 1.
+  virtual unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              ArrayRef<unsigned> Indices,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const;
+
+  /// \return True if the target has a gather instruction that loads a vector
+  /// of type \p DataTy using indices of type \p IndexTy (see llvm.gather).
+  virtual bool isLegalGather(Type *DataTy, Type *IndexTy) const;
+
+  /// \return The cost of an llvm.gather of a \p DataTy vector with \p IndexTy
+  /// indices, whose elements are aligned to \p Alignment.
+  virtual unsigned getGatherOpCost(Type *DataTy, Type *IndexTy,
+                                   unsigned Alignment) const;
+
   /// \brief Calculate the cost of performing a vector reduction.
   ///
   /// This is the cost of reducing the vector value of type \p Ty to a scalar
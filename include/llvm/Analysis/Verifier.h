@@ -41,13 +41,23 @@ enum VerifierFailureAction {
   ReturnStatusAction    ///< verifyModule will just return true
 };
 
+/// @brief An enumeration to specify how thoroughly functions are checked.
+enum VerifierLevel {
+  VerifyAll,          ///< Run every check
+  VerifyStructure     ///< Skip the checks that need a dominator tree
+};
+
 /// @brief Create a verifier pass.
 ///
 /// Check a module or function for validity.  When the pass is used, the
 /// action indicated by the \p action argument will be used if errors are
-/// found.
+/// found.  If \p OnlyModified is set, function bodies that passed a full
+/// verification and have not changed since are skipped, as is the module-wide
+/// walk over debug info.
 FunctionPass *createVerifierPass(
-  VerifierFailureAction action = AbortProcessAction ///< Action to take
+  VerifierFailureAction action = AbortProcessAction, ///< Action to take
+  VerifierLevel Level = VerifyAll,  ///< Checks to run on function bodies
+  bool OnlyModified = false         ///< Skip functions known to be valid
 );
 
 /// @brief Check a module for errors.
@@ -63,6 +73,19 @@ bool verifyModule(
   std::string *ErrorInfo = 0      ///< Information about failures.
 );
 
+/// @brief Check the parts of a module that changed since they were last
+/// verified.
+///
+/// Like verifyModule, but only the bodies of functions that were modified
+/// since they last passed a full verification are checked, at the given
+/// \p Level.  Global values and module-level metadata are always checked.
+bool verifyModifiedFunctions(
+  const Module &M,  ///< The module to be verified
+  VerifierFailureAction action = AbortProcessAction, ///< Action to take
+  VerifierLevel Level = VerifyAll,  ///< Checks to run on function bodies
+  std::string *ErrorInfo = 0      ///< Information about failures.
+);
+
 // verifyFunction - Check a function for errors, useful for use when debugging a
 // pass.
 bool verifyFunction(
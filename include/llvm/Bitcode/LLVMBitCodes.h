@@ -42,7 +42,9 @@ namespace bitc {
 
     TYPE_BLOCK_ID_NEW,
 
-    USELIST_BLOCK_ID
+    USELIST_BLOCK_ID,
+
+    SYMTAB_BLOCK_ID
   };
 
 
@@ -71,7 +73,11 @@ namespace bitc {
     // MODULE_CODE_PURGEVALS: [numvals]
     MODULE_CODE_PURGEVALS   = 10,
 
-    MODULE_CODE_GCNAME      = 11   // GCNAME: [strchr x N]
+    MODULE_CODE_GCNAME      = 11,  // GCNAME: [strchr x N]
+
+    // FNINDEX: [offset x N] as a blob of 64-bit little endian bit offsets of
+    // the function blocks, relative to the end of the record.
+    MODULE_CODE_FNINDEX     = 12
   };
 
   /// PARAMATTR blocks have code for defining a parameter attribute set.
@@ -332,6 +338,32 @@ namespace bitc {
     USELIST_CODE_ENTRY = 1   // USELIST_CODE_ENTRY: TBD.
   };
 
+  /// The symbol table block (SYMTAB_BLOCK_ID) lists the global values of the
+  /// module, so that tools can find out what a module defines and references
+  /// without reading the rest of it.
+  enum SymtabCodes {
+    // ENTRY: [kind, linkage, visibility, flags, name blob]
+    SYMTAB_CODE_ENTRY = 1
+  };
+
+  /// The kinds of global value in a SYMTAB_CODE_ENTRY record.
+  enum SymtabKinds {
+    SYMTAB_KIND_FUNCTION = 0,
+    SYMTAB_KIND_VARIABLE = 1,
+    SYMTAB_KIND_ALIAS    = 2
+  };
+
+  /// The flags of a SYMTAB_CODE_ENTRY record.
+  enum SymtabFlags {
+    SYMTAB_FLAG_DECLARATION       = 1 << 0,
+    SYMTAB_FLAG_THREAD_LOCAL      = 1 << 1,
+    SYMTAB_FLAG_UNNAMED_ADDR      = 1 << 2,
+    SYMTAB_FLAG_CONSTANT          = 1 << 3,
+    // What an alias refers to, if it is a function or a variable.
+    SYMTAB_FLAG_ALIAS_OF_FUNCTION = 1 << 4,
+    SYMTAB_FLAG_ALIAS_OF_VARIABLE = 1 << 5
+  };
+
   enum AttributeKindCodes {
     // = 0 is unused
     ATTR_KIND_ALIGNMENT = 1,
@@ -14,12 +14,15 @@
 #ifndef LLVM_BITCODE_READERWRITER_H
 #define LLVM_BITCODE_READERWRITER_H
 
+#include "llvm/IR/GlobalValue.h"
 #include <string>
+#include <vector>
 
 namespace llvm {
   class BitstreamWriter;
   class MemoryBuffer;
   class DataStreamer;
+  class Function;
   class LLVMContext;
   class Module;
   class ModulePass;
@@ -43,6 +46,17 @@ namespace llvm {
                                    LLVMContext &Context,
                                    std::string *ErrMsg = 0);
 
+  /// materializeNextFunction - Read the next function body of a module from
+  /// getLazyBitcodeModule or getStreamedBitcodeModule, in the order the
+  /// bodies appear in the bitcode, and return its function.  For a streamed
+  /// module this only waits for the bytes up to the end of that body, so each
+  /// function can be optimized or compiled while the rest of the bitcode is
+  /// still arriving.  Returns null once every body has been read, or on error,
+  /// in which case *ErrMsg is filled in if ErrMsg is non-null.  Once it
+  /// returns null, call Module::MaterializeAllPermanently to read whatever
+  /// follows the function bodies.
+  Function *materializeNextFunction(Module *M, std::string *ErrMsg = 0);
+
   /// getBitcodeTargetTriple - Read the header of the specified bitcode
   /// buffer and extract just the triple information. If successful,
   /// this returns a string and *does not* take ownership
@@ -52,6 +66,34 @@ namespace llvm {
                                      LLVMContext &Context,
                                      std::string *ErrMsg = 0);
 
+  /// BitcodeSymbol - A global value of a bitcode module, as listed in the
+  /// symbol table block of the module.
+  struct BitcodeSymbol {
+    enum SymbolKind { Function, Variable, Alias };
+
+    std::string Name;
+    SymbolKind Kind;
+    GlobalValue::LinkageTypes Linkage;
+    GlobalValue::VisibilityTypes Visibility;
+    bool IsDeclaration;
+    bool IsThreadLocal;
+    bool HasUnnamedAddr;
+    bool IsConstant;
+    /// IsAliasOfFunction, IsAliasOfVariable - For an alias, whether it
+    /// refers to a function or to a variable.
+    bool IsAliasOfFunction;
+    bool IsAliasOfVariable;
+  };
+
+  /// getBitcodeSymbols - Read the symbol table block of the specified bitcode
+  /// buffer into Symbols, without parsing the rest of the module.  This
+  /// *does not* take ownership of 'buffer'.  Returns false if the module has
+  /// no symbol table, as with bitcode from older writers, or on error, in
+  /// which case *ErrMsg is filled in if ErrMsg is non-null.
+  bool getBitcodeSymbols(MemoryBuffer *Buffer, LLVMContext &Context,
+                         std::vector<BitcodeSymbol> &Symbols,
+                         std::string *ErrMsg = 0);
+
   /// ParseBitcodeFile - Read the specified bitcode file, returning the module.
   /// If an error occurs, this returns null and fills in *ErrMsg if it is
   /// non-null.  This method *never* takes ownership of Buffer.
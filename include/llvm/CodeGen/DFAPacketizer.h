@@ -28,7 +28,6 @@
 
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
-#include <map>
 
 namespace llvm {
 
@@ -104,7 +103,15 @@ protected:
   DFAPacketizer *ResourceTracker;
 
   // Generate MI -> SU map.
-  std::map<MachineInstr*, SUnit*> MIToSUnit;
+  DenseMap<MachineInstr*, SUnit*> MIToSUnit;
+
+  // Packet statistics for the current function. A packet is ended early by
+  // a dependence stall when an instruction depends on a member of the packet
+  // and by a resource stall when the DFA has no free slot for it.
+  unsigned NumPackets;
+  unsigned NumPacketizedInstrs;
+  unsigned NumDependenceStalls;
+  unsigned NumResourceStalls;
 
 public:
   VLIWPacketizerList(
@@ -121,6 +128,12 @@ public:
   // getResourceTracker - return ResourceTracker
   DFAPacketizer *getResourceTracker() {return ResourceTracker;}
 
+  // Accessors for the packet statistics gathered so far.
+  unsigned getNumPackets() const { return NumPackets; }
+  unsigned getNumPacketizedInstrs() const { return NumPacketizedInstrs; }
+  unsigned getNumDependenceStalls() const { return NumDependenceStalls; }
+  unsigned getNumResourceStalls() const { return NumResourceStalls; }
+
   // addToPacket - Add MI to the current packet.
   virtual MachineBasicBlock::iterator addToPacket(MachineInstr *MI) {
     MachineBasicBlock::iterator MII = MI;
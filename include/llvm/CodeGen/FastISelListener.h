@@ -0,0 +1,120 @@
+//===- FastISelListener.h - Observe FastISel fallbacks ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the FastISelListener interface, through which clients are
+// told every time FastISel gives up on an instruction and SelectionDAG has to
+// select it instead, and how long that took.  Unlike -fast-isel-verbose, this
+// is available in release builds and lets a JIT find out which instructions
+// are worth teaching FastISel about.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CODEGEN_FASTISELLISTENER_H
+#define LLVM_CODEGEN_FASTISELLISTENER_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Timer.h"
+#include <string>
+
+namespace llvm {
+
+class Function;
+class Instruction;
+class raw_ostream;
+
+/// FastISelMissInfo - A description of one fallback to SelectionDAG.
+struct FastISelMissInfo {
+  /// The function being selected.
+  const Function *F;
+  /// The instruction FastISel couldn't select, or null if it couldn't lower
+  /// the arguments of F.
+  const Instruction *Inst;
+  /// The number of instructions SelectionDAG selected because of the miss.
+  /// After a miss on anything but a call, FastISel leaves the rest of the
+  /// block to SelectionDAG.
+  unsigned NumInstructions;
+  /// The time SelectionDAG took to select them.
+  TimeRecord Time;
+};
+
+/// FastISelListener - The interface for clients that want to observe each
+/// FastISel miss.
+///
+/// Listeners are global.  They must be registered before and removed after
+/// any code generator runs, and may be called from several threads at once
+/// when functions are compiled in parallel.  Misses are only timed while a
+/// listener is registered.
+class FastISelListener {
+  virtual void anchor();
+
+public:
+  virtual ~FastISelListener() {}
+
+  /// fastISelMissed - Called after SelectionDAG has selected the instructions
+  /// FastISel couldn't.
+  virtual void fastISelMissed(const FastISelMissInfo &Info) = 0;
+};
+
+/// addFastISelListener - Register L to be told about every FastISel miss.
+/// The caller keeps ownership of L.
+void addFastISelListener(FastISelListener *L);
+
+/// removeFastISelListener - Undo addFastISelListener.
+void removeFastISelListener(FastISelListener *L);
+
+/// FastISelMissCounter - A listener totalling the misses of each kind: the
+/// opcode of the missed instruction, with " (vector)" appended for vector
+/// operations, the name of the intrinsic for intrinsic calls, or "arguments".
+class FastISelMissCounter : public FastISelListener {
+public:
+  struct Entry {
+    Entry() : Count(0), NumInstructions(0) {}
+    unsigned Count;
+    unsigned NumInstructions;
+    TimeRecord Time;
+  };
+
+  /// getMissKind - Return the kind a miss on I is counted as.
+  static std::string getMissKind(const Instruction *I);
+
+  virtual void fastISelMissed(const FastISelMissInfo &Info);
+
+  /// lookup - Return the totals for misses of kind Kind.
+  Entry lookup(StringRef Kind) const;
+
+  /// print - Print the kinds of miss, the ones that cost the most time first.
+  void print(raw_ostream &OS) const;
+
+  void clear();
+
+private:
+  mutable sys::SmartMutex<true> Lock;
+  StringMap<Entry> Entries;
+};
+
+/// FastISelFallbackTimer - Times a fallback to SelectionDAG for the
+/// listeners, if there are any.  Used by SelectionDAGISel.
+class FastISelFallbackTimer {
+  const Function &F;
+  const Instruction *Inst;
+  bool Active;
+  TimeRecord Start;
+
+public:
+  FastISelFallbackTimer(const Function &F, const Instruction *Inst);
+
+  /// fallbackDone - Report that SelectionDAG has selected NumInstructions
+  /// instructions since the timer was created.
+  void fallbackDone(unsigned NumInstructions);
+};
+
+} // End llvm namespace
+
+#endif
@@ -36,6 +36,10 @@ namespace llvm {
   /// Creates a shadow stack garbage collector. This collector requires no code
   /// generator support.
   void linkShadowStackGC();
+
+  /// Creates a relocating garbage collector whose safepoints are recorded in
+  /// stack maps.
+  void linkStatepointGC();
 }
 
 #endif
@@ -30,6 +30,7 @@
 #include "llvm/Target/TargetRegisterInfo.h"
 #include <cmath>
 #include <iterator>
+#include <vector>
 
 namespace llvm {
 
@@ -61,6 +62,11 @@ namespace llvm {
     ///
     VNInfo::Allocator VNInfoAllocator;
 
+    /// ThreadVNInfoAllocators - The allocators of the VNInfos created by each
+    /// thread when virtual register intervals are computed in parallel.  They
+    /// are freed along with VNInfoAllocator.
+    std::vector<VNInfo::Allocator*> ThreadVNInfoAllocators;
+
     /// Live interval pointers for all the virtual registers.
     IndexedMap<LiveInterval*, VirtReg2IndexFunctor> VirtRegIntervals;
 
@@ -388,6 +394,10 @@ namespace llvm {
     /// Compute live intervals for all virtual registers.
     void computeVirtRegs();
 
+    /// Compute live intervals for all virtual registers on NumThreads
+    /// threads, each with its own LiveRangeCalc and VNInfo allocator.
+    void computeVirtRegsInParallel(unsigned NumThreads);
+
     /// Compute RegMaskSlots and RegMaskBits.
     void computeRegMasks();
 
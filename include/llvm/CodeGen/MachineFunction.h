@@ -18,6 +18,7 @@
 #ifndef LLVM_CODEGEN_MACHINEFUNCTION_H
 #define LLVM_CODEGEN_MACHINEFUNCTION_H
 
+#include "llvm/ADT/BlockNumbering.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
 #include "llvm/Support/Allocator.h"
@@ -41,6 +42,29 @@ class TargetMachine;
 class TargetRegisterClass;
 struct MachinePointerInfo;
 
+/// MachineFunctionAllocatorPool - A source of memory slabs for the allocators
+/// of MachineFunctions.  The slabs a MachineFunction releases are kept and
+/// handed to the MachineFunctions created after it instead of going back to
+/// malloc, which saves a lot of allocator traffic when many small functions
+/// are compiled one after another, as a JIT does.  The pool is not
+/// thread-safe, and must outlive the MachineFunctions that use it.
+class MachineFunctionAllocatorPool : public SlabAllocator {
+  MallocSlabAllocator Underlying;
+
+  /// FreeSlabs - Slabs released by earlier MachineFunctions.
+  std::vector<MemSlab*> FreeSlabs;
+
+  /// FreeBytes - The total size of FreeSlabs, which is kept below
+  /// MaxFreeBytes.
+  size_t FreeBytes, MaxFreeBytes;
+
+public:
+  explicit MachineFunctionAllocatorPool(size_t MaxFreeBytes = 1 << 20);
+  virtual ~MachineFunctionAllocatorPool();
+  virtual MemSlab *Allocate(size_t Size) LLVM_OVERRIDE;
+  virtual void Deallocate(MemSlab *Slab) LLVM_OVERRIDE;
+};
+
 template <>
 struct ilist_traits<MachineBasicBlock>
     : public ilist_default_traits<MachineBasicBlock> {
@@ -100,6 +124,12 @@ class MachineFunction {
   // numbered and this vector keeps track of the mapping from ID's to MBB's.
   std::vector<MachineBasicBlock*> MBBNumbering;
 
+  // Bumped by RenumberBlocks when it gives blocks numbers they did not have.
+  unsigned BlockNumberEpoch;
+
+  // Where Allocator gets its slabs when there is no allocator pool.
+  MallocSlabAllocator DefaultSlabAllocator;
+
   // Pool-allocate MachineFunction-lifetime and IR objects.
   BumpPtrAllocator Allocator;
 
@@ -139,7 +169,7 @@ class MachineFunction {
 public:
   MachineFunction(const Function *Fn, const TargetMachine &TM,
                   unsigned FunctionNum, MachineModuleInfo &MMI,
-                  GCModuleInfo* GMI);
+                  GCModuleInfo* GMI, MachineFunctionAllocatorPool *Pool = 0);
   ~MachineFunction();
 
   MachineModuleInfo &getMMI() const { return MMI; }
@@ -263,6 +293,12 @@ public:
   /// getNumBlockIDs - Return the number of MBB ID's allocated.
   ///
   unsigned getNumBlockIDs() const { return (unsigned)MBBNumbering.size(); }
+
+  /// getBlockNumberEpoch - Return a counter that changes whenever
+  /// RenumberBlocks moves a block to a different number.  Blocks added later
+  /// get fresh numbers, so caches indexed by block number only need to be
+  /// flushed when this changes.
+  unsigned getBlockNumberEpoch() const { return BlockNumberEpoch; }
   
   /// RenumberBlocks - This discards all of the MachineBasicBlock numbers and
   /// recomputes them.  This guarantees that the MBB numbers are sequential,
@@ -519,6 +555,16 @@ template <> struct GraphTraits<Inverse<const MachineFunction*> > :
   }
 };
 
+template <> struct BlockNumberTraits<MachineBasicBlock> {
+  static const bool HasNumbering = true;
+  static int getNumber(const MachineBasicBlock *MBB) {
+    return MBB->getNumber();
+  }
+  static unsigned getEpoch(const MachineBasicBlock *MBB) {
+    return MBB->getParent()->getBlockNumberEpoch();
+  }
+};
+
 } // End llvm namespace
 
 #endif
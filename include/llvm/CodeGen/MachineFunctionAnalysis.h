@@ -19,6 +19,7 @@
 namespace llvm {
 
 class MachineFunction;
+class MachineFunctionAllocatorPool;
 class TargetMachine;
 
 /// MachineFunctionAnalysis - This class is a Pass that manages a
@@ -28,9 +29,13 @@ private:
   const TargetMachine &TM;
   MachineFunction *MF;
   unsigned NextFnNum;
+  MachineFunctionAllocatorPool *AllocatorPool;
 public:
   static char ID;
-  explicit MachineFunctionAnalysis(const TargetMachine &tm);
+  /// If \p Pool is not null, the MachineFunctions created take their memory
+  /// from it.
+  explicit MachineFunctionAnalysis(const TargetMachine &tm,
+                                   MachineFunctionAllocatorPool *Pool = 0);
   ~MachineFunctionAnalysis();
 
   MachineFunction &getMF() const { return *MF; }
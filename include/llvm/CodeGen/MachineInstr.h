@@ -1064,6 +1064,46 @@ struct MachineInstrExpressionTrait : DenseMapInfo<MachineInstr*> {
   }
 };
 
+/// HashedMachineInstr - A MachineInstr together with its
+/// MachineInstrExpressionTrait hash, for hash tables that look up the same
+/// instruction several times.  The hash is computed once, so a new key must
+/// be made whenever the instruction is changed.
+struct HashedMachineInstr {
+  MachineInstr *MI;
+  unsigned Hash;
+
+  HashedMachineInstr() : MI(0), Hash(0) {}
+  explicit HashedMachineInstr(MachineInstr *MI)
+    : MI(MI), Hash(MachineInstrExpressionTrait::getHashValue(MI)) {}
+  HashedMachineInstr(MachineInstr *MI, unsigned Hash) : MI(MI), Hash(Hash) {}
+};
+
+/// HashedMachineInstrTrait - DenseMapInfo traits comparing HashedMachineInstrs
+/// like MachineInstrExpressionTrait compares MachineInstrs, using the stored
+/// hashes.
+struct HashedMachineInstrTrait {
+  static inline HashedMachineInstr getEmptyKey() {
+    return HashedMachineInstr(MachineInstrExpressionTrait::getEmptyKey(), 0);
+  }
+
+  static inline HashedMachineInstr getTombstoneKey() {
+    return HashedMachineInstr(MachineInstrExpressionTrait::getTombstoneKey(),
+                              0);
+  }
+
+  static unsigned getHashValue(const HashedMachineInstr &Key) {
+    return Key.Hash;
+  }
+
+  static bool isEqual(const HashedMachineInstr &LHS,
+                      const HashedMachineInstr &RHS) {
+    // Identical instructions have the same hash, and so do the empty and
+    // tombstone keys.
+    return LHS.Hash == RHS.Hash &&
+           MachineInstrExpressionTrait::isEqual(LHS.MI, RHS.MI);
+  }
+};
+
 //===----------------------------------------------------------------------===//
 // Debugging Support
 
@@ -99,6 +99,11 @@ namespace PBQP {
     EdgeVector edges;
     FreeEdgeVector freeEdges;
 
+    // Whether each node/edge id is free, so that the iterators can skip the
+    // free ids without searching the free lists.
+    typedef std::vector<bool> FreeFlagVector;
+    FreeFlagVector nodeIsFree, edgeIsFree;
+
     // ----- INTERNAL METHODS -----
 
     NodeEntry& getNode(NodeId nId) { return nodes[nId]; }
@@ -113,9 +118,11 @@ namespace PBQP {
         nodeId = freeNodes.back();
         freeNodes.pop_back();
         nodes[nodeId] = n;
+        nodeIsFree[nodeId] = false;
       } else {
         nodeId = nodes.size();
         nodes.push_back(n);
+        nodeIsFree.push_back(false);
       }
       return nodeId;
     }
@@ -128,9 +135,11 @@ namespace PBQP {
         edgeId = freeEdges.back();
         freeEdges.pop_back();
         edges[edgeId] = e;
+        edgeIsFree[edgeId] = false;
       } else {
         edgeId = edges.size();
         edges.push_back(e);
+        edgeIsFree.push_back(false);
       }
 
       EdgeEntry &ne = getEdge(edgeId);
@@ -155,7 +164,7 @@ namespace PBQP {
     class NodeItr {
     public:
       NodeItr(NodeId nodeId, const Graph &g)
-        : nodeId(nodeId), endNodeId(g.nodes.size()), freeNodes(g.freeNodes) {
+        : nodeId(nodeId), endNodeId(g.nodes.size()), isFree(g.nodeIsFree) {
         this->nodeId = findNextInUse(nodeId); // Move to the first in-use nodeId
       }
 
@@ -166,22 +175,19 @@ namespace PBQP {
 
     private:
       NodeId findNextInUse(NodeId n) const {
-        while (n < endNodeId &&
-               std::find(freeNodes.begin(), freeNodes.end(), n) !=
-                 freeNodes.end()) {
+        while (n < endNodeId && isFree[n])
           ++n;
-        }
         return n;
       }
 
       NodeId nodeId, endNodeId;
-      const FreeNodeVector& freeNodes;
+      const FreeFlagVector& isFree;
     };
 
     class EdgeItr {
     public:
       EdgeItr(EdgeId edgeId, const Graph &g)
-        : edgeId(edgeId), endEdgeId(g.edges.size()), freeEdges(g.freeEdges) {
+        : edgeId(edgeId), endEdgeId(g.edges.size()), isFree(g.edgeIsFree) {
         this->edgeId = findNextInUse(edgeId); // Move to the first in-use edgeId
       }
 
@@ -192,16 +198,13 @@ namespace PBQP {
 
     private:
       EdgeId findNextInUse(EdgeId n) const {
-        while (n < endEdgeId &&
-               std::find(freeEdges.begin(), freeEdges.end(), n) !=
-                 freeEdges.end()) {
+        while (n < endEdgeId && isFree[n])
           ++n;
-        }
         return n;
       }
 
       EdgeId edgeId, endEdgeId;
-      const FreeEdgeVector& freeEdges;
+      const FreeFlagVector& isFree;
     };
 
     /// \brief Construct an empty PBQP graph.
@@ -350,6 +353,9 @@ namespace PBQP {
     /// @return An id for edge (n1Id, n2Id) if such an edge exists,
     ///         otherwise returns an invalid edge id.
     EdgeId findEdge(NodeId n1Id, NodeId n2Id) {
+      // Scan the shorter adjacency list.
+      if (getNodeDegree(n2Id) < getNodeDegree(n1Id))
+        std::swap(n1Id, n2Id);
       for (AdjEdgeItr aeItr = adjEdgesBegin(n1Id), aeEnd = adjEdgesEnd(n1Id);
          aeItr != aeEnd; ++aeItr) {
         if ((getEdgeNode1(*aeItr) == n2Id) ||
@@ -369,6 +375,7 @@ namespace PBQP {
         removeEdge(eId);
       }
       freeNodes.push_back(nId);
+      nodeIsFree[nId] = true;
     }
 
     /// \brief Remove an edge from the graph.
@@ -380,14 +387,17 @@ namespace PBQP {
       n1.removeEdge(e.getNode1AEItr());
       n2.removeEdge(e.getNode2AEItr());
       freeEdges.push_back(eId);
+      edgeIsFree[eId] = true;
     }
 
     /// \brief Remove all nodes and edges from the graph.
     void clear() {
       nodes.clear();
       freeNodes.clear();
+      nodeIsFree.clear();
       edges.clear();
       freeEdges.clear();
+      edgeIsFree.clear();
     }
 
     /// \brief Dump a graph to an output stream.
@@ -428,6 +428,12 @@ namespace llvm {
   ///
   FunctionPass *createBasicRegisterAllocator();
 
+  /// LinearScanRegisterAllocation Pass - This pass assigns live ranges in
+  /// order, evicting lighter ones, but never splits them.  It is faster than
+  /// the greedy allocator and produces better code than the fast one.
+  ///
+  FunctionPass *createLinearScanRegisterAllocator();
+
   /// Greedy register allocation pass - This pass implements a global register
   /// allocator for optimized builds.
   ///
@@ -195,7 +195,7 @@ class SelectionDAG {
 
   /// CSEMap - This structure is used to memoize nodes, automatically performing
   /// CSE with existing nodes when a duplicate is requested.
-  FoldingSet<SDNode> CSEMap;
+  FoldingSetWithHash<SDNode> CSEMap;
 
   /// OperandAllocator - Pool allocation for machine-opcode SDNode operands.
   BumpPtrAllocator OperandAllocator;
@@ -15,6 +15,7 @@
 #ifndef LLVM_CODEGEN_SELECTIONDAGISEL_H
 #define LLVM_CODEGEN_SELECTIONDAGISEL_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/IR/BasicBlock.h"
@@ -261,6 +262,20 @@ private:
   void SelectBasicBlock(BasicBlock::const_iterator Begin,
                         BasicBlock::const_iterator End,
                         bool &HadTailCall);
+
+  /// \brief Perform instruction selection on the instructions between \p
+  /// Begin and \p End, building a separate SelectionDAG for every
+  /// -max-dag-region-size instructions so that huge blocks don't produce huge
+  /// DAGs.  Values used outside the region that defines them are passed in
+  /// virtual registers.
+  void SelectBasicBlockInRegions(BasicBlock::const_iterator Begin,
+                                 BasicBlock::const_iterator End,
+                                 bool &HadTailCall);
+
+  /// \brief Return true if \p BB has too many instructions to be selected as
+  /// a single SelectionDAG.
+  bool isSplitIntoDAGRegions(const BasicBlock *BB) const;
+
   void FinishBasicBlock();
 
   void CodeGenAndEmitDAG();
@@ -281,6 +296,16 @@ private:
   /// state machines that start with a OPC_SwitchOpcode node.
   std::vector<unsigned> OpcodeOffset;
 
+  /// SwitchCaseOffsets - A cache like OpcodeOffset for the other
+  /// OPC_SwitchOpcode and OPC_SwitchType nodes, keyed by their index in the
+  /// matcher table.  For a switch with many cases it holds the index of the
+  /// case for each opcode or value type, or 0 where there is none.  Small
+  /// switches get an empty entry and are scanned.
+  DenseMap<unsigned, std::vector<unsigned> > SwitchCaseOffsets;
+
+  const std::vector<unsigned> &getSwitchCaseOffsets(
+      const unsigned char *MatcherTable, unsigned SwitchStart);
+
   void UpdateChainsAndGlue(SDNode *NodeToMatch, SDValue InputChain,
                            const SmallVectorImpl<SDNode*> &ChainNodesMatched,
                            SDValue InputGlue, const SmallVectorImpl<SDNode*> &F,
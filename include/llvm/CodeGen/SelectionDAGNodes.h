@@ -327,6 +327,14 @@ private:
   /// NodeId - Unique id per SDNode in the DAG.
   int NodeId;
 
+  /// CombinerWorklistIndex - The position of this node in the DAG combiner's
+  /// worklist, or -1 if it is not on the worklist.
+  int CombinerWorklistIndex;
+
+  /// CSEHash - The hash of the node's profile, kept by the DAG's CSE map so
+  /// that it does not recompute it when it grows.
+  unsigned CSEHash;
+
   /// OperandList - The values that are used by this operation.
   ///
   SDUse *OperandList;
@@ -419,6 +427,21 @@ public:
   /// setNodeId - Set unique node id.
   void setNodeId(int Id) { NodeId = Id; }
 
+  /// getCombinerWorklistIndex - Return the position of this node in the DAG
+  /// combiner's worklist, or -1 if it is not on the worklist.
+  int getCombinerWorklistIndex() const { return CombinerWorklistIndex; }
+
+  /// setCombinerWorklistIndex - Set the position of this node in the DAG
+  /// combiner's worklist.
+  void setCombinerWorklistIndex(int Index) { CombinerWorklistIndex = Index; }
+
+  /// getFoldingSetHash - Return the hash of the node's profile, as recorded
+  /// when it was inserted into the CSE map.
+  unsigned getFoldingSetHash() const { return CSEHash; }
+
+  /// setFoldingSetHash - Record the hash of the node's profile.
+  void setFoldingSetHash(unsigned Hash) { CSEHash = Hash; }
+
   /// getIROrder - Return the node ordering.
   ///
   unsigned getIROrder() const { return IROrder; }
@@ -701,7 +724,7 @@ protected:
   SDNode(unsigned Opc, unsigned Order, const DebugLoc dl, SDVTList VTs,
          const SDValue *Ops, unsigned NumOps)
     : NodeType(Opc), OperandsNeedDelete(true), HasDebugValue(false),
-      SubclassData(0), NodeId(-1),
+      SubclassData(0), NodeId(-1), CombinerWorklistIndex(-1), CSEHash(0),
       OperandList(NumOps ? new SDUse[NumOps] : 0),
       ValueList(VTs.VTs), UseList(NULL),
       NumOperands(NumOps), NumValues(VTs.NumVTs),
@@ -717,8 +740,8 @@ protected:
   /// set later with InitOperands.
   SDNode(unsigned Opc, unsigned Order, const DebugLoc dl, SDVTList VTs)
     : NodeType(Opc), OperandsNeedDelete(false), HasDebugValue(false),
-      SubclassData(0), NodeId(-1), OperandList(0),
-      ValueList(VTs.VTs), UseList(NULL), NumOperands(0), NumValues(VTs.NumVTs),
+      SubclassData(0), NodeId(-1), CombinerWorklistIndex(-1), CSEHash(0),
+      OperandList(0), ValueList(VTs.VTs), UseList(NULL), NumOperands(0), NumValues(VTs.NumVTs),
       debugLoc(dl), IROrder(Order) {}
 
   /// InitOperands - Initialize the operands list of this with 1 operand.
@@ -597,6 +597,9 @@
 /* Define if we have the oprofile JIT-support library */
 #cmakedefine LLVM_USE_OPROFILE 1
 
+/* Define if we have the perf JIT-support library */
+#cmakedefine LLVM_USE_PERF 1
+
 /* Major version of the LLVM API */
 #cmakedefine LLVM_VERSION_MAJOR ${LLVM_VERSION_MAJOR}
 
@@ -23,6 +23,7 @@
 #include "llvm/Object/RelocVisitor.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/DataTypes.h"
+#include <vector>
 
 namespace llvm {
 
@@ -134,8 +135,15 @@ public:
   DIContext(DIContextKind K) : Kind(K) {}
   virtual ~DIContext();
 
-  /// getDWARFContext - get a context for binary DWARF data.
-  static DIContext *getDWARFContext(object::ObjectFile *);
+  /// getDWARFContext - get a context for binary DWARF data.  Queries that
+  /// need every compile unit, such as the first address lookup, spread the
+  /// parsing of DIEs and line tables over up to NumThreads threads.  The
+  /// context's methods must still be called from one thread at a time.
+  /// Address queries parse only the DIEs they need, and keep at most
+  /// DIEMemoryBudget bytes of them around if that is not 0.
+  static DIContext *getDWARFContext(object::ObjectFile *,
+                                    unsigned NumThreads = 1,
+                                    size_t DIEMemoryBudget = 0);
 
   virtual void dump(raw_ostream &OS, DIDumpType DumpType = DIDT_All) = 0;
 
@@ -145,6 +153,22 @@ public:
       uint64_t Size, DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
   virtual DIInliningInfo getInliningInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier()) = 0;
+
+  /// getLineTableRanges - Append to Ranges the [Start, End) address range of
+  /// every row of every line table.  All addresses in a range have the same
+  /// file and line, so a client can look each range up once and cache it.
+  virtual void getLineTableRanges(
+      std::vector<std::pair<uint64_t, uint64_t> > &Ranges) = 0;
+
+  /// findDIEOffsetsByName - Append to Offsets, in increasing order, the
+  /// offset in the debug information of every entry named Name.  Name
+  /// indexes in the object are used when there are any.
+  virtual void findDIEOffsetsByName(StringRef Name,
+                                    SmallVectorImpl<uint32_t> &Offsets) = 0;
+
+  /// dumpDIE - Print the entry at Offset, as returned by
+  /// findDIEOffsetsByName, with all of its children.
+  virtual void dumpDIE(raw_ostream &OS, uint32_t Offset) = 0;
 private:
   const DIContextKind Kind;
 };
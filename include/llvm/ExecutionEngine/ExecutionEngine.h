@@ -16,12 +16,14 @@
 #define LLVM_EXECUTIONENGINE_EXECUTIONENGINE_H
 
 #include "llvm-c/ExecutionEngine.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/ValueMap.h"
 #include "llvm/MC/MCCodeGenInfo.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/RWMutex.h"
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
@@ -36,6 +38,7 @@ class Constant;
 class DataLayout;
 class ExecutionEngine;
 class Function;
+class FunctionType;
 class GlobalVariable;
 class GlobalValue;
 class JITEventListener;
@@ -45,6 +48,7 @@ class Module;
 class MutexGuard;
 class ObjectCache;
 class RTDyldMemoryManager;
+class SymbolAddressCache;
 class Triple;
 class Type;
 
@@ -76,6 +80,13 @@ private:
   /// is called at some point.
   std::map<void *, AssertingVH<const GlobalValue> > GlobalAddressReverseMap;
 
+  /// GlobalAddressLookupMap - A copy of the non-null entries of
+  /// GlobalAddressMap, for lookups that do not take the engine lock.  It is
+  /// only changed with both the engine lock and LookupLock held, the latter
+  /// for writing, so readers only need LookupLock for reading.
+  DenseMap<const GlobalValue *, void *> GlobalAddressLookupMap;
+  sys::RWMutex LookupLock;
+
 public:
   ExecutionEngineState(ExecutionEngine &EE);
 
@@ -92,6 +103,19 @@ public:
   ///
   /// \returns The address that \p ToUnmap was happed to.
   void *RemoveMapping(const MutexGuard &, const GlobalValue *ToUnmap);
+
+  /// \brief Record \p Addr as the address of \p GV for lookupAddress, or
+  /// forget the address of \p GV if \p Addr is null.  Must be called
+  /// whenever the entry of \p GV in the global address map changes.
+  void updateLookupMap(const MutexGuard &, const GlobalValue *GV, void *Addr);
+
+  /// \brief Forget all addresses recorded for lookupAddress.
+  void clearLookupMap(const MutexGuard &);
+
+  /// \brief Return the address mapped to \p GV, or null.  Unlike the other
+  /// accessors this does not need the engine lock, and lookups from
+  /// different threads do not serialize.
+  void *lookupAddress(const GlobalValue *GV);
 };
 
 /// \brief Abstract interface for implementation execution of LLVM modules,
@@ -118,6 +142,10 @@ class ExecutionEngine {
   /// using dlsym).
   bool SymbolSearchingDisabled;
 
+  /// Whether the object files of loaded modules are freed once their code is
+  /// finalized.
+  bool ObjectDataDiscarded;
+
   friend class EngineBuilder;  // To allow access to JITCtor and InterpCtor.
 
 protected:
@@ -222,6 +250,20 @@ public:
   virtual GenericValue runFunction(Function *F,
                                 const std::vector<GenericValue> &ArgValues) = 0;
 
+  /// CallTrampoline - Calls Fn, a function of the type the trampoline was
+  /// made for, with the arguments in Args, and stores the return value, if
+  /// any, to Ret.  Args holds the arguments at the offsets of the elements of
+  /// StructType::get(Params) in the engine's DataLayout, Params being the
+  /// parameter types; Ret must be large enough for the store size of the
+  /// return type.
+  typedef void (*CallTrampoline)(void *Fn, const void *Args, void *Ret);
+
+  /// getCallTrampoline - Return a trampoline for calling functions of type
+  /// FTy, which is compiled the first time it is asked for and then reused.
+  /// Only the fixed parameters of a varargs type are passed.  Engines that
+  /// cannot generate code return null.
+  virtual CallTrampoline getCallTrampoline(FunctionType *FTy) { return 0; }
+
   /// getPointerToNamedFunction - This method returns the address of the
   /// specified function by using the dlsym function call.  As such it is only
   /// useful for resolving library symbols, not code generated symbols.
@@ -378,6 +420,25 @@ public:
     return 0;
   }
 
+  /// requestFunctionAddress - Start generating code for the module that
+  /// defines the specified function on a background thread, if that has not
+  /// been done yet, and return without waiting for it.  The caller can keep
+  /// running the function some other way (for example in an interpreter)
+  /// and poll for the compiled code with getFunctionAddressIfReady, or block
+  /// until it is available with getFunctionAddress.
+  ///
+  /// Engines that cannot compile in the background do nothing here, and
+  /// generate code for the function when its address is asked for.
+  virtual void requestFunctionAddress(const std::string &Name) {}
+
+  /// getFunctionAddressIfReady - Return the address of the specified function
+  /// if its code has already been generated, and 0 otherwise.  Unlike
+  /// getFunctionAddress, this never generates code on the calling thread; it
+  /// requests background compilation (see requestFunctionAddress) instead.
+  virtual uint64_t getFunctionAddressIfReady(const std::string &Name) {
+    return getFunctionAddress(Name);
+  }
+
   // The JIT overrides a version that actually does this.
   virtual void runJITOnFunction(Function *, MachineCodeInfo * = 0) { }
 
@@ -430,6 +491,13 @@ public:
     llvm_unreachable("No support for an object cache");
   }
 
+  /// Sets the cache of external symbol addresses, which may be shared with
+  /// other engines.  The ownership of the cache is not changed.  Supported by
+  /// MCJIT but not JIT.
+  virtual void setSymbolAddressCache(SymbolAddressCache *) {
+    llvm_unreachable("No support for a symbol address cache");
+  }
+
   /// DisableLazyCompilation - When lazy compilation is off (the default), the
   /// JIT will eagerly compile every function reachable from the argument to
   /// getPointerToFunction.  If lazy compilation is turned on, the JIT will only
@@ -443,6 +511,13 @@ public:
   /// stub, and 2) any thread modifying LLVM IR must hold the JIT's lock
   /// (ExecutionEngine::lock) or otherwise ensure that no other thread calls a
   /// lazy stub.  See http://llvm.org/PR5184 for details.
+  ///
+  /// MCJIT, when compiling lazily, moves the body of each function of a
+  /// module into a module of its own as the module is compiled, and leaves a
+  /// stub that compiles the body on the first call.  The stubs refer to the
+  /// engine in the current process, so this is only useful when the code runs
+  /// there, and is not done while an object cache is set.  MCJIT's stubs may
+  /// be called from any number of threads.
   void DisableLazyCompilation(bool Disabled = true) {
     CompilingLazily = !Disabled;
   }
@@ -475,6 +550,20 @@ public:
     return SymbolSearchingDisabled;
   }
 
+  /// DiscardObjectData - If called, MCJIT frees the object file of each
+  /// module once the module's code is finalized, instead of keeping it for as
+  /// long as the code, which roughly halves the memory held per module.
+  /// Objects are kept while a JITEventListener is registered, since listeners
+  /// look at them, and the objects of modules loaded while this is on are not
+  /// registered with the debugger.  Must be set before the modules are
+  /// loaded.  Has no effect on the JIT and the interpreter.
+  void DiscardObjectData(bool Discard = true) {
+    ObjectDataDiscarded = Discard;
+  }
+  bool isDiscardingObjectData() const {
+    return ObjectDataDiscarded;
+  }
+
   /// InstallLazyFunctionCreator - If an unknown function is needed, the
   /// specified function pointer is invoked to create it.  If it returns null,
   /// the JIT will abort.
@@ -0,0 +1,67 @@
+//===-- FileObjectCache.h - Object cache backed by a directory --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares FileObjectCache, an ObjectCache that keeps the objects it
+// is given in a directory, so that they can be reused by later processes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include <string>
+
+namespace llvm {
+
+class TargetMachine;
+
+/// FileObjectCache - An ObjectCache that stores objects as files in a cache
+/// directory.
+///
+/// Objects are keyed on an MD5 hash of the module's bitcode together with the
+/// target triple, CPU, features, TargetOptions, relocation model, code model
+/// and optimization level of the TargetMachine the cache was created for, so
+/// an object is only reused when it would have been compiled identically.
+///
+/// Several processes may share a cache directory.  New objects are written to
+/// a temporary file which is renamed into place, under a LockFileManager lock,
+/// so readers never see a partially written object.  If a size limit is set,
+/// the least recently used objects are deleted whenever a new object pushes
+/// the total size of the cache past it.
+class FileObjectCache : public ObjectCache {
+  SmallString<128> CacheDir;
+  std::string TargetKey;
+  uint64_t MaxCacheSize;
+
+  /// PendingKeys - Keys computed by getObject for modules that were not in
+  /// the cache.  Code generation changes the module, so notifyObjectCompiled
+  /// has to use the key that was computed before it ran.
+  DenseMap<const Module *, std::string> PendingKeys;
+
+  std::string computeKey(const Module *M) const;
+  void getObjectPath(StringRef Key, SmallVectorImpl<char> &Path) const;
+  void prune();
+
+public:
+  /// Create a cache in directory \p Dir, which is created if necessary, for
+  /// objects produced by \p TM.  If \p MaxSize is non-zero, the cache is kept
+  /// below \p MaxSize bytes.
+  FileObjectCache(StringRef Dir, const TargetMachine &TM, uint64_t MaxSize = 0);
+  virtual ~FileObjectCache();
+
+  virtual void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj);
+  virtual MemoryBuffer *getObject(const Module *M);
+};
+
+} // End llvm namespace
+
+#endif
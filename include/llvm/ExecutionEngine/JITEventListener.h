@@ -123,6 +123,14 @@ public:
   }
 #endif // USE_OPROFILE
 
+#if LLVM_USE_PERF
+  // Construct a PerfJITEventListener, which writes the /tmp/perf-<pid>.map
+  // symbol map, and a jitdump file if -perf-jitdump is given.
+  static JITEventListener *createPerfJITEventListener();
+#else
+  static JITEventListener *createPerfJITEventListener() { return 0; }
+#endif // USE_PERF
+
 };
 
 } // end namespace llvm.
@@ -10,7 +10,9 @@
 #ifndef LLVM_EXECUTIONENGINE_OBJECTCACHE_H
 #define LLVM_EXECUTIONENGINE_OBJECTCACHE_H
 
+#include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm-c/ExecutionEngine.h"
 
 namespace llvm {
 
@@ -36,6 +38,9 @@ public:
   virtual MemoryBuffer* getObject(const Module* M) = 0;
 };
 
+// Create wrappers for C Binding types (see CBindingWrapping.h).
+DEFINE_SIMPLE_CONVERSION_FUNCTIONS(ObjectCache, LLVMMCJITObjectCacheRef)
+
 }
 
 #endif
@@ -56,6 +56,17 @@ public:
   // Subclasses can override these methods to provide JIT debugging support
   virtual void registerWithDebugger() = 0;
   virtual void deregisterWithDebugger() = 0;
+
+  /// releaseObjectData - Free the object file and the buffer holding it.
+  /// Once the relocations of a loaded object are resolved, only JIT event
+  /// listeners and the debugger look at the object; afterwards the image just
+  /// identifies the object to RuntimeDyld::unloadObject, and none of the
+  /// methods above may be called.  Returns false, keeping the data, if the
+  /// image is registered with the debugger.
+  virtual bool releaseObjectData() = 0;
+
+  /// hasObjectData - Whether the object data has not been released.
+  bool hasObjectData() const { return Buffer.get() != 0; }
 };
 
 } // end namespace llvm
@@ -0,0 +1,139 @@
+//===- PooledSectionMemoryManager.h - Shared slabs for MCJIT ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares SectionMemoryPool, which packs the sections of many
+// JITed objects into a few large slabs, and PooledSectionMemoryManager, the
+// RuntimeDyld memory manager that allocates from such a pool.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_POOLEDSECTIONMEMORYMANAGER_H
+#define LLVM_EXECUTIONENGINE_POOLEDSECTIONMEMORYMANAGER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ExecutionEngine/RuntimeDyld.h"
+#include "llvm/Support/Memory.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/system_error.h"
+
+namespace llvm {
+
+/// A pool of memory for the sections of JITed objects, shared by any number
+/// of PooledSectionMemoryManagers.
+///
+/// Memory is mapped in slabs of a fixed size and handed out in pieces as
+/// small as the sections need, so the sections of many small objects share
+/// pages instead of each taking whole pages of their own.
+///
+/// Code and read-only data are allocated read-write and only get their final
+/// permissions when the manager that owns them is finalized.  Their pages are
+/// never writable and executable at the same time: a page that holds the
+/// unfinalized sections of one manager is not used by any other, and once a
+/// page has been finalized nothing is allocated on it until everything on it
+/// has been released.  Finalizing protects all the pages of a manager with
+/// one call per run of adjacent pages, so loading several objects before
+/// finalizing them packs them more densely and makes fewer system calls.
+///
+/// All the methods may be called concurrently.
+class SectionMemoryPool {
+  SectionMemoryPool(const SectionMemoryPool&) LLVM_DELETED_FUNCTION;
+  void operator=(const SectionMemoryPool&) LLVM_DELETED_FUNCTION;
+
+public:
+  enum MemoryKind {
+    Code,
+    ReadOnlyData,
+    ReadWriteData,
+    NumMemoryKinds
+  };
+
+  /// Create a pool that maps memory \p SlabSize bytes at a time.  Sections
+  /// larger than that get a slab of their own.
+  explicit SectionMemoryPool(size_t SlabSize = 1024 * 1024);
+  ~SectionMemoryPool();
+
+  /// Allocate \p Size bytes aligned to \p Alignment for the manager \p Owner,
+  /// or return null if no memory can be mapped.
+  uint8_t *allocate(MemoryKind Kind, uintptr_t Size, unsigned Alignment,
+                    const void *Owner);
+
+  /// Give \p Blocks, all allocated for one manager, their final permissions.
+  error_code finalize(MemoryKind Kind, ArrayRef<sys::MemoryBlock> Blocks);
+
+  /// Return \p Blocks to the pool.  \p Finalized tells whether they were
+  /// passed to finalize.
+  error_code release(MemoryKind Kind, ArrayRef<sys::MemoryBlock> Blocks,
+                     bool Finalized);
+
+  /// Return the number of bytes currently mapped by the pool.
+  size_t getMappedSize() const;
+
+private:
+  struct Arena;
+
+  Arena *Arenas[NumMemoryKinds];
+  size_t SlabSize;
+  mutable sys::Mutex Lock;
+};
+
+/// A memory manager for MCJIT and RuntimeDyld that allocates the sections of
+/// the objects it loads from a SectionMemoryPool.  The sections of an object
+/// that is unloaded, and all the sections when the manager is destroyed, are
+/// returned to the pool for reuse.
+///
+/// As with SectionMemoryManager, finalizeMemory must be called before the
+/// JITed code is run.
+class PooledSectionMemoryManager : public RTDyldMemoryManager {
+  PooledSectionMemoryManager(const PooledSectionMemoryManager&)
+    LLVM_DELETED_FUNCTION;
+  void operator=(const PooledSectionMemoryManager&) LLVM_DELETED_FUNCTION;
+
+public:
+  explicit PooledSectionMemoryManager(SectionMemoryPool &Pool) : Pool(Pool) {}
+  virtual ~PooledSectionMemoryManager();
+
+  virtual uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                                       unsigned SectionID,
+                                       StringRef SectionName);
+
+  virtual uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                                       unsigned SectionID,
+                                       StringRef SectionName,
+                                       bool IsReadOnly);
+
+  virtual void deallocateSection(uint8_t *Addr, unsigned SectionID);
+
+  /// \brief Apply the final permissions to all the sections allocated since
+  /// the last call and flush the instruction cache for the code among them.
+  ///
+  /// \returns true if an error occurred, false otherwise.
+  virtual bool finalizeMemory(std::string *ErrMsg = 0);
+
+private:
+  struct MemoryGroup {
+    SmallVector<sys::MemoryBlock, 8> Finalized;
+    SmallVector<sys::MemoryBlock, 8> Pending;
+  };
+
+  uint8_t *allocateSection(SectionMemoryPool::MemoryKind Kind, uintptr_t Size,
+                           unsigned Alignment);
+
+  /// Release the block at \p Addr if it is one of \p Blocks.
+  bool releaseBlock(SectionMemoryPool::MemoryKind Kind,
+                    SmallVectorImpl<sys::MemoryBlock> &Blocks, uint8_t *Addr,
+                    bool Finalized);
+
+  SectionMemoryPool &Pool;
+  MemoryGroup Groups[SectionMemoryPool::NumMemoryKinds];
+};
+
+}
+
+#endif
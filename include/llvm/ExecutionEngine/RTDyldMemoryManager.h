@@ -52,6 +52,13 @@ public:
     uintptr_t Size, unsigned Alignment, unsigned SectionID,
     StringRef SectionName, bool IsReadOnly) = 0;
 
+  /// Release the memory of a section returned by allocateCodeSection or
+  /// allocateDataSection.  This is called when the object that contained the
+  /// section is unloaded, after which nothing will refer to the memory.  The
+  /// default implementation does nothing and leaves the memory allocated
+  /// until the memory manager itself is destroyed.
+  virtual void deallocateSection(uint8_t *Addr, unsigned SectionID) {}
+
   /// Register the EH frames with the runtime so that c++ exceptions work.
   ///
   /// \p Addr parameter provides the local address of the EH frame section
@@ -62,6 +69,20 @@ public:
 
   virtual void deregisterEHFrames(uint8_t *Addr, uint64_t LoadAddr, size_t Size);
 
+  /// Called when an object that contains a stack map section, as emitted for
+  /// llvm.experimental.stackmap and llvm.experimental.patchpoint, has been
+  /// loaded.  \p Addr and \p LoadAddr are as for registerEHFrames.  The
+  /// section stays at \p Addr until deregisterStackMaps is called for it, so
+  /// a StackMapParser may read it in place.  The default implementation does
+  /// nothing.
+  virtual void registerStackMaps(uint8_t *Addr, uint64_t LoadAddr,
+                                 size_t Size) {}
+
+  /// Called before the memory of a stack map section passed to
+  /// registerStackMaps is released, when its object is unloaded.
+  virtual void deregisterStackMaps(uint8_t *Addr, uint64_t LoadAddr,
+                                   size_t Size) {}
+
   /// This method returns the address of the specified function or variable.
   /// It is used to resolve symbols during module linking.
   virtual uint64_t getSymbolAddress(const std::string &Name);
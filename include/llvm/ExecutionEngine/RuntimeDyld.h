@@ -23,6 +23,7 @@ namespace llvm {
 
 class RuntimeDyldImpl;
 class ObjectImage;
+class SymbolAddressCache;
 
 class RuntimeDyld {
   RuntimeDyld(const RuntimeDyld &) LLVM_DELETED_FUNCTION;
@@ -32,6 +33,7 @@ class RuntimeDyld {
   // interface.
   RuntimeDyldImpl *Dyld;
   RTDyldMemoryManager *MM;
+  SymbolAddressCache *SymbolCache;
 protected:
   // Change the address associated with a section when resolving relocations.
   // Any relocations already associated with the symbol will be re-resolved.
@@ -46,6 +48,25 @@ public:
   /// failure, the input buffer will be deleted.
   ObjectImage *loadObject(ObjectBuffer *InputBuffer);
 
+  /// Use \p Cache, which may be shared with other instances, to resolve
+  /// external symbols before asking the memory manager, and record there the
+  /// addresses the memory manager returns.  The ownership of the cache is not
+  /// changed.  Pass null to stop using a cache.
+  void setSymbolCache(SymbolAddressCache *Cache);
+
+  /// Unload an object returned by loadObject before the caller deletes it.
+  /// Its symbols are no longer resolved, its pending relocations and EH
+  /// frames are dropped, and the memory of its sections is returned to the
+  /// memory manager.  Code loaded from other objects must no longer refer to
+  /// it.
+  void unloadObject(const ObjectImage *Obj);
+
+  /// Free the object file of a loaded object, through
+  /// ObjectImage::releaseObjectData, once its relocations are resolved.  The
+  /// code stays where it is and \p Obj can still be passed to unloadObject.
+  /// Returns false if the image kept its data.
+  bool releaseObjectData(ObjectImage *Obj);
+
   /// Get the address of our local copy of the symbol. This may or may not
   /// be the address used for relocation (clients can copy the data around
   /// and resolve relocatons based on where they put it).
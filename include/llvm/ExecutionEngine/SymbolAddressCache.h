@@ -0,0 +1,78 @@
+//===- SymbolAddressCache.h - Shared external symbol addresses --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares SymbolAddressCache, a table of the addresses of external
+// symbols that can be shared by any number of RuntimeDyld instances.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_SYMBOLADDRESSCACHE_H
+#define LLVM_EXECUTIONENGINE_SYMBOLADDRESSCACHE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/Mutex.h"
+
+namespace llvm {
+
+/// The addresses of the external symbols that JITed code refers to, kept
+/// across the loading of many objects.
+///
+/// A RuntimeDyld using a cache looks up the external symbols of an object in
+/// it, all at once, before asking its memory manager about them.  Symbols the
+/// memory manager resolves to something other than code loaded by the same
+/// RuntimeDyld are added to the cache, so every symbol is resolved by the
+/// memory manager only once however many objects refer to it.  Clients can
+/// also seed the cache with the addresses of their runtime up front.
+///
+/// A cached address takes precedence over a definition in a module that has
+/// not been loaded yet, so the symbols of the cache should not be defined by
+/// JITed code, and all the users of a cache should resolve external symbols
+/// the same way.
+///
+/// All the methods may be called concurrently.
+class SymbolAddressCache {
+  SymbolAddressCache(const SymbolAddressCache&) LLVM_DELETED_FUNCTION;
+  void operator=(const SymbolAddressCache&) LLVM_DELETED_FUNCTION;
+
+public:
+  SymbolAddressCache() {}
+
+  /// Record \p Addr as the address of the symbol \p Name, replacing any
+  /// address recorded before.
+  void addSymbol(StringRef Name, uint64_t Addr);
+
+  /// Forget the address of the symbol \p Name.
+  void removeSymbol(StringRef Name);
+
+  /// Forget all the addresses.
+  void clear();
+
+  /// Return the address of the symbol \p Name, or 0 if it is not known.
+  uint64_t lookup(StringRef Name) const;
+
+  /// Look up all of \p Names at once.  \p Addrs gets the address of each,
+  /// or 0 for those that are not known.
+  void lookup(ArrayRef<StringRef> Names,
+              SmallVectorImpl<uint64_t> &Addrs) const;
+
+  /// Return the number of symbols with a known address.
+  size_t size() const;
+
+private:
+  StringMap<uint64_t> Symbols;
+  mutable sys::Mutex Lock;
+};
+
+} // end namespace llvm
+
+#endif
@@ -14,12 +14,15 @@
 #ifndef LLVM_IR_BASICBLOCK_H
 #define LLVM_IR_BASICBLOCK_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BlockNumbering.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/SymbolTableListTraits.h"
 #include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/DataTypes.h"
+#include <vector>
 
 namespace llvm {
 
@@ -50,6 +53,8 @@ template<> struct ilist_traits<Instruction>
   Instruction *provideInitialHead() const { return createSentinel(); }
   Instruction *ensureHead(Instruction*) const { return createSentinel(); }
   static void noteHead(Instruction*, Instruction*) {}
+
+  static void noteListChange(BasicBlock *ItemParent);
 private:
   mutable ilist_half_node<Instruction> Sentinel;
 };
@@ -77,9 +82,16 @@ public:
 private:
   InstListType InstList;
   Function *Parent;
+  int Number;
+
+  /// \brief The predecessors of this block, one per CFG edge, if it keeps
+  /// them; null otherwise.
+  std::vector<BasicBlock*> *MaintainedPreds;
 
   void setParent(Function *parent);
   friend class SymbolTableListTraits<BasicBlock, Function>;
+  friend class Value;
+  friend class Instruction;
 
   BasicBlock(const BasicBlock &) LLVM_DELETED_FUNCTION;
   void operator=(const BasicBlock &) LLVM_DELETED_FUNCTION;
@@ -116,6 +128,15 @@ public:
   const Function *getParent() const { return Parent; }
         Function *getParent()       { return Parent; }
 
+  /// \brief Return the number of this block within its function, or -1 if it
+  /// is not in one.
+  ///
+  /// A function numbers its blocks densely in the order they are inserted and
+  /// never reuses a number, so the number of a block only changes when it
+  /// is removed from its function or inserted into another.  Analyses use it
+  /// to index their block maps; see BlockNumberCache.
+  int getNumber() const { return Number; }
+
   /// \brief Returns the terminator instruction if the block is well formed or
   /// null if the block is not well formed.
   TerminatorInst *getTerminator();
@@ -187,6 +208,24 @@ public:
     return const_cast<BasicBlock*>(this)->getUniquePredecessor();
   }
 
+  /// \brief Start or stop keeping a list of this block's predecessors that is
+  /// updated as the CFG changes.
+  ///
+  /// Like pred_iterator, the list has one entry per CFG edge into the block,
+  /// but its order is unspecified.  Keeping it costs a little on every change
+  /// to the uses of the block, so only blocks whose predecessors are queried
+  /// often, like the dispatch block of an interpreter loop, should keep one.
+  void setMaintainsPredecessors(bool Maintain);
+
+  /// \brief Return true if this block keeps a list of its predecessors.
+  bool maintainsPredecessors() const { return MaintainedPreds != 0; }
+
+  /// \brief Return the list of predecessors that this block keeps.
+  ArrayRef<BasicBlock*> getMaintainedPredecessors() const {
+    assert(MaintainedPreds && "Block does not keep its predecessors!");
+    return *MaintainedPreds;
+  }
+
   //===--------------------------------------------------------------------===//
   /// Instruction iterator methods
   ///
@@ -292,6 +331,15 @@ private:
     assert((int)(signed char)getSubclassDataFromValue() >= 0 &&
            "Refcount wrap-around");
   }
+  /// \brief Update the kept predecessor list for an edge from \p Pred that
+  /// was added or is being removed, or whose terminator moved from \p Pred to
+  /// \p NewPred.
+  void addMaintainedPredecessor(BasicBlock *Pred) {
+    MaintainedPreds->push_back(Pred);
+  }
+  void removeMaintainedPredecessor(BasicBlock *Pred);
+  void replaceMaintainedPredecessor(BasicBlock *Pred, BasicBlock *NewPred);
+
   /// \brief Shadow Value::setValueSubclassData with a private forwarding method
   /// so that any future subclasses cannot accidentally use it.
   void setValueSubclassData(unsigned short D) {
@@ -302,6 +350,13 @@ private:
 // Create wrappers for C Binding types (see CBindingWrapping.h).
 DEFINE_SIMPLE_CONVERSION_FUNCTIONS(BasicBlock, LLVMBasicBlockRef)
 
+// Basic block numbers are never handed out twice, so the epoch stays put.
+template <> struct BlockNumberTraits<BasicBlock> {
+  static const bool HasNumbering = true;
+  static int getNumber(const BasicBlock *BB) { return BB->getNumber(); }
+  static unsigned getEpoch(const BasicBlock *) { return 0; }
+};
+
 } // End llvm namespace
 
 #endif
@@ -46,6 +46,7 @@ template<> struct ilist_traits<BasicBlock>
   static void noteHead(BasicBlock*, BasicBlock*) {}
 
   static ValueSymbolTable *getSymTab(Function *ItemParent);
+  static void noteListChange(Function *ItemParent);
 private:
   mutable ilist_half_node<BasicBlock> Sentinel;
 };
@@ -86,6 +87,9 @@ private:
   mutable ArgumentListType ArgumentList;  ///< The formal arguments
   ValueSymbolTable *SymTab;               ///< Symbol table of args/instructions
   AttributeSet AttributeSets;             ///< Parameter attributes
+  unsigned ModificationCount;             ///< Bumped when the body changes
+  unsigned VerifiedModificationCount;     ///< ModificationCount when verified
+  unsigned NextBlockNumber;               ///< Number of the next block added
 
   // HasLazyArguments is stored in Value::SubclassData.
   /*bool HasLazyArguments;*/
@@ -94,6 +98,7 @@ private:
   /*CallingConv::ID CallingConvention;*/
 
   friend class SymbolTableListTraits<Function, Module>;
+  friend class BasicBlock;
 
   void setParent(Module *parent);
 
@@ -166,6 +171,26 @@ public:
                          (static_cast<unsigned>(CC) << 2));
   }
 
+  /// getModificationCount - Return a counter that changes whenever a basic
+  /// block or instruction is added to, removed from or moved within this
+  /// function, or when an instruction operand is rewritten by
+  /// replaceAllUsesWith.  Code that changes operands in place with setOperand
+  /// should call markModified itself.
+  unsigned getModificationCount() const { return ModificationCount; }
+  void markModified() { ++ModificationCount; }
+
+  /// isModifiedSinceVerified - Return true if the body of this function
+  /// changed since the verifier last accepted it.  markVerified is called by
+  /// the verifier; new functions start out unverified.
+  bool isModifiedSinceVerified() const {
+    return ModificationCount != VerifiedModificationCount;
+  }
+  void markVerified() { VerifiedModificationCount = ModificationCount; }
+
+  /// getMaxBlockNumber - Return one more than the largest number given to a
+  /// basic block of this function.  See BasicBlock::getNumber.
+  unsigned getMaxBlockNumber() const { return NextBlockNumber; }
+
   /// @brief Return the attribute list for this Function.
   AttributeSet getAttributes() const { return AttributeSets; }
 
@@ -212,6 +237,14 @@ public:
     return AttributeSets.getAttribute(AttributeSet::FunctionIndex, Kind);
   }
 
+  /// @brief Record the number of times a profile saw this function entered,
+  /// as the "function-entry-count" attribute.
+  void setEntryCount(uint64_t Count);
+
+  /// @brief Return true and set Count if the function has a profiled entry
+  /// count.
+  bool getEntryCount(uint64_t &Count) const;
+
   /// hasGC/getGC/setGC/clearGC - The name of the garbage collection algorithm
   ///                             to use during code generation.
   bool hasGC() const;
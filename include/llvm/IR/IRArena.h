@@ -0,0 +1,100 @@
+//===- llvm/IR/IRArena.h - Arena for instructions ---------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares IRArena, an arena that instructions and their operands
+// can be allocated from instead of the heap.  A client that builds, compiles
+// and throws away many short-lived modules, such as a JIT compiling one
+// module per query, can make allocating them mostly pointer bumps and
+// destroying them a few slab releases.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_IRARENA_H
+#define LLVM_IR_IRARENA_H
+
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/DataTypes.h"
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace llvm {
+
+/// IRArena - Slabs of memory that instructions are allocated from while an
+/// IRArena::Scope for the arena is active on the thread creating them.  Freed
+/// instructions are recycled, by size, for later instructions.
+///
+/// An arena is used by one thread at a time, and must outlive every
+/// instruction allocated from it.  Instructions are only recycled if they are
+/// deleted in a scope of their arena; otherwise deleting them leaves their
+/// memory to be released with the arena, which is the fastest way to tear
+/// down a module that was built in an arena.
+///
+/// Constants, globals and the other values a context or module owns are never
+/// allocated from an arena, and neither are the operand lists that PHI nodes
+/// and switches grow separately.
+class IRArena {
+public:
+  IRArena();
+  ~IRArena();
+
+  /// Scope - Allocate the instructions created on this thread from an arena
+  /// for as long as the scope exists.  Scopes may nest.
+  class Scope {
+    Scope(const Scope &) LLVM_DELETED_FUNCTION;
+    void operator=(const Scope &) LLVM_DELETED_FUNCTION;
+    IRArena *Prev;
+
+  public:
+    explicit Scope(IRArena &Arena);
+    ~Scope();
+  };
+
+  /// getCurrent - Return the arena of the innermost scope active on this
+  /// thread, or null.
+  static IRArena *getCurrent();
+
+  /// allocate - Return Size bytes of pointer-aligned memory, or null if Size
+  /// is too large to be allocated from an arena.
+  void *allocate(size_t Size);
+
+  /// contains - Return true if Ptr points into memory allocated from this
+  /// arena.
+  bool contains(const void *Ptr) const;
+
+  /// release - Give back memory that allocate returned, if it came from the
+  /// arena of the current scope.  Memory from any other arena stays in use
+  /// until the arena is destroyed.
+  static void release(void *Ptr);
+
+  /// getTotalMemory - Return the number of bytes in the arena's slabs.
+  size_t getTotalMemory() const { return Slabs.size() * SlabSize; }
+
+private:
+  IRArena(const IRArena &) LLVM_DELETED_FUNCTION;
+  void operator=(const IRArena &) LLVM_DELETED_FUNCTION;
+
+  static const size_t SlabSize = 64 * 1024;
+  /// Allocations larger than this go to the heap instead.
+  static const size_t MaxAllocationSize = 1024;
+
+  void deallocate(void *Ptr);
+
+  /// The slabs, by the address where each starts, mapped to its end.
+  std::map<const char *, const char *> Slabs;
+  /// The unused part of the newest slab.
+  char *CurPtr, *End;
+  /// The free lists of recycled memory, indexed by size in words.  Each free
+  /// block holds a pointer to the next.
+  std::vector<void *> FreeLists;
+};
+
+} // End llvm namespace
+
+#endif
@@ -40,6 +40,11 @@ class Instruction : public User, public ilist_node<Instruction> {
     /// indicates whether this instruction has metadata attached to it or not.
     HasMetadataBit = 1 << 15
   };
+protected:
+  /// operator new - Allocate an instruction with Us operands from the
+  /// IRArena of the current scope, if there is one, or else the heap.
+  void *operator new(size_t s, unsigned Us);
+
 public:
   // Out of line virtual method, so the vtable, etc has a home.
   ~Instruction();
@@ -260,7 +260,7 @@ protected:
 public:
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
   StoreInst(Value *Val, Value *Ptr, Instruction *InsertBefore);
   StoreInst(Value *Val, Value *Ptr, BasicBlock *InsertAtEnd);
@@ -387,7 +387,7 @@ protected:
 public:
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
 
   // Ordering may only be Acquire, Release, AcquireRelease, or
@@ -455,7 +455,7 @@ protected:
 public:
   // allocate space for exactly three operands
   void *operator new(size_t s) {
-    return User::operator new(s, 3);
+    return Instruction::operator new(s, 3);
   }
   AtomicCmpXchgInst(Value *Ptr, Value *Cmp, Value *NewVal,
                     AtomicOrdering Ordering, SynchronizationScope SynchScope,
@@ -593,7 +593,7 @@ public:
 
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
   AtomicRMWInst(BinOp Operation, Value *Ptr, Value *Val,
                 AtomicOrdering Ordering, SynchronizationScope SynchScope,
@@ -1664,7 +1664,7 @@ protected:
 public:
   // allocate space for exactly three operands
   void *operator new(size_t s) {
-    return User::operator new(s, 3);
+    return Instruction::operator new(s, 3);
   }
   ShuffleVectorInst(Value *V1, Value *V2, Value *Mask,
                     const Twine &NameStr = "",
@@ -1757,7 +1757,7 @@ class ExtractValueInst : public UnaryInstruction {
 
   // allocate space for exactly one operand
   void *operator new(size_t s) {
-    return User::operator new(s, 1);
+    return Instruction::operator new(s, 1);
   }
 protected:
   virtual ExtractValueInst *clone_impl() const;
@@ -1875,7 +1875,7 @@ protected:
 public:
   // allocate space for exactly two operands
   void *operator new(size_t s) {
-    return User::operator new(s, 2);
+    return Instruction::operator new(s, 2);
   }
 
   static InsertValueInst *Create(Value *Agg, Value *Val,
@@ -1983,7 +1983,7 @@ class PHINode : public Instruction {
   PHINode(const PHINode &PN);
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
   explicit PHINode(Type *Ty, unsigned NumReservedValues,
                    const Twine &NameStr = "", Instruction *InsertBefore = 0)
@@ -2186,7 +2186,7 @@ private:
   void *operator new(size_t, unsigned) LLVM_DELETED_FUNCTION;
   // Allocate space for exactly zero operands.
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
   void growOperands(unsigned Size);
   void init(Value *PersFn, unsigned NumReservedValues, const Twine &NameStr);
@@ -2458,7 +2458,7 @@ class SwitchInst : public TerminatorInst {
   void growOperands();
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
   /// SwitchInst ctor - Create a new switch instruction, specifying a value to
   /// switch on and a default destination.  The number of additional cases can
@@ -2752,7 +2752,7 @@ class IndirectBrInst : public TerminatorInst {
   void growOperands();
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
   /// IndirectBrInst ctor - Create a new indirectbr instruction, specifying an
   /// Address to jump to.  The number of expected destinations can be specified
@@ -3147,7 +3147,7 @@ protected:
 public:
   // allocate space for exactly zero operands
   void *operator new(size_t s) {
-    return User::operator new(s, 0);
+    return Instruction::operator new(s, 0);
   }
   explicit UnreachableInst(LLVMContext &C, Instruction *InsertBefore = 0);
   explicit UnreachableInst(LLVMContext &C, BasicBlock *InsertAtEnd);
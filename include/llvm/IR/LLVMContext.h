@@ -32,8 +32,11 @@ template <typename T> class SmallVectorImpl;
 /// This is an important class for using LLVM in a threaded context.  It
 /// (opaquely) owns and manages the core "global" data of LLVM's core
 /// infrastructure, including the type and constant uniquing tables.
-/// LLVMContext itself provides no locking guarantees, so you should be careful
-/// to have one context per thread.
+/// Types and scalar constants (ConstantInt, ConstantFP) may be created from
+/// several threads at once when LLVM is running multithreaded.  Everything
+/// else, and in particular anything that adds uses to a value, provides no
+/// locking guarantees, so you should be careful to have one context per thread
+/// unless your threads only share types.
 class LLVMContext {
 public:
   LLVMContextImpl *const pImpl;
@@ -82,6 +85,17 @@ public:
   /// setInlineAsmDiagnosticHandler.
   void *getInlineAsmDiagnosticContext() const;
 
+  /// setDiscardValueNames - Set whether the names of values other than global
+  /// values are thrown away.  Local names are only read by IR dumps and
+  /// diagnostics, so a client that creates many named temporaries can save
+  /// their memory and symbol table updates.  Values that already have a name
+  /// when this is turned on keep it.
+  void setDiscardValueNames(bool Discard);
+
+  /// shouldDiscardValueNames - Return true if the names of values other than
+  /// global values are thrown away.
+  bool shouldDiscardValueNames() const;
+
 
   /// emitError - Emit an error message to the currently installed error handler
   /// with optional location information.  This function returns, so code should
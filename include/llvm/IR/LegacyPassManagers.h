@@ -19,6 +19,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Timer.h"
 #include <map>
 #include <vector>
 
@@ -201,10 +202,7 @@ public:
   virtual ~PMTopLevelManager();
 
   /// Add immutable pass and initialize it.
-  inline void addImmutablePass(ImmutablePass *P) {
-    P->initializePass();
-    ImmutablePasses.push_back(P);
-  }
+  void addImmutablePass(ImmutablePass *P);
 
   inline SmallVectorImpl<ImmutablePass *>& getImmutablePasses() {
     return ImmutablePasses;
@@ -250,6 +248,10 @@ private:
   /// Immutable passes are managed by top level manager.
   SmallVector<ImmutablePass *, 8> ImmutablePasses;
 
+  /// Map the IDs of the immutable passes and of the interfaces they implement
+  /// to the most recently added pass for each.
+  DenseMap<AnalysisID, ImmutablePass *> ImmutablePassMap;
+
   DenseMap<Pass *, AnalysisUsage *> AnUsageMap;
 };
 
@@ -461,10 +463,48 @@ public:
   virtual PassManagerType getPassManagerType() const {
     return PMT_FunctionPassManager;
   }
+
+  /// getParallelThreadCount - Return the number of threads the contained
+  /// passes should be run on, or 0 if they have to run serially.
+  unsigned getParallelThreadCount() const;
+
+  /// runInParallel - Run the contained passes over Functions, which must be
+  /// definitions in M, on NumThreads threads, each with its own instance of
+  /// every pass.
+  bool runInParallel(Module &M, const std::vector<Function *> &Functions,
+                     unsigned NumThreads);
+
+private:
+  /// canRunInParallel - Return true if all of the contained passes are
+  /// function-local and can be instantiated once per thread.
+  bool canRunInParallel() const;
 };
 
 Timer *getPassTimer(Pass *);
 
+/// PassInstrumentationRegion - Tell the registered PassInstrumentations, if
+/// there are any, about one run of pass P on function F, or on module M if F
+/// is null.
+class PassInstrumentationRegion {
+  Pass *P;
+  Module &M;
+  Function *F;
+  bool Active;
+  bool Skip;
+  unsigned InstCountBefore;
+  TimeRecord Start;
+
+public:
+  PassInstrumentationRegion(Pass *P, Module &M, Function *F);
+
+  /// shouldRunPass - Return false if an instrumentation asked for P to be
+  /// skipped.
+  bool shouldRunPass() const { return !Skip; }
+
+  /// passExecuted - Report the run of P, unless it was skipped.
+  void passExecuted(bool Changed);
+};
+
 }
 
 #endif
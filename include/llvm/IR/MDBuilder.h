@@ -74,6 +74,24 @@ public:
     return MDNode::get(Context, Vals);
   }
 
+  /// \brief Return metadata recording the most frequent targets of an
+  /// indirect call by name, in decreasing order of their call counts, out of
+  /// \p Total calls.
+  MDNode *createIndirectCallTargets(
+      uint64_t Total, ArrayRef<std::pair<StringRef, uint64_t> > Targets) {
+    SmallVector<Value *, 8> Vals;
+    Vals.push_back(createString("indirect_call_targets"));
+
+    Type *Int64Ty = Type::getInt64Ty(Context);
+    Vals.push_back(ConstantInt::get(Int64Ty, Total));
+    for (unsigned i = 0, e = Targets.size(); i != e; ++i) {
+      Vals.push_back(createString(Targets[i].first));
+      Vals.push_back(ConstantInt::get(Int64Ty, Targets[i].second));
+    }
+
+    return MDNode::get(Context, Vals);
+  }
+
   //===------------------------------------------------------------------===//
   // Range metadata.
   //===------------------------------------------------------------------===//
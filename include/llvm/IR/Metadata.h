@@ -63,15 +63,16 @@ public:
 
 
 class MDNodeOperand;
+struct MDNodeInfo;
 
 //===----------------------------------------------------------------------===//
 /// MDNode - a tuple of other values.
-class MDNode : public Value, public FoldingSetNode {
+class MDNode : public Value {
   MDNode(const MDNode &) LLVM_DELETED_FUNCTION;
   void operator=(const MDNode &) LLVM_DELETED_FUNCTION;
   friend class MDNodeOperand;
   friend class LLVMContextImpl;
-  friend struct FoldingSetTrait<MDNode>;
+  friend struct MDNodeInfo;
 
   /// Hash - If the MDNode is uniqued cache the hash to speed up lookup.
   unsigned Hash;
@@ -152,10 +153,6 @@ public:
   // critical code because it recursively visits all the MDNode's operands.
   const Function *getFunction() const;
 
-  /// Profile - calculate a unique identifier for this MDNode to collapse
-  /// duplicates
-  void Profile(FoldingSetNodeID &ID) const;
-
   /// Methods for support type inquiry through isa, cast, and dyn_cast:
   static bool classof(const Value *V) {
     return V->getValueID() == MDNodeVal;
@@ -441,9 +441,9 @@ public:
   /// yet have a Materializer.  To reset the materializer for a module that
   /// already has one, call MaterializeAllPermanently first.  Destroying this
   /// module will destroy its materializer without materializing any more
-  /// GlobalValues.  Without destroying the Module, there is no way to detach or
-  /// destroy a materializer without materializing all the GVs it controls, to
-  /// avoid leaving orphan unmaterialized GVs.
+  /// GlobalValues.  Without destroying the Module, the only ways to detach or
+  /// destroy a materializer are to materialize all the GVs it controls, or to
+  /// call dropMaterializer, which turns the rest into declarations.
   void setMaterializer(GVMaterializer *GVM);
   /// getMaterializer - Retrieves the GVMaterializer, if any, for this Module.
   GVMaterializer *getMaterializer() const { return Materializer.get(); }
@@ -477,6 +477,12 @@ public:
   /// returns false.
   bool MaterializeAllPermanently(std::string *ErrInfo = 0);
 
+  /// dropMaterializer - Clear the Materializer without reading the
+  /// GlobalValues it has not materialized yet, which are left as declarations
+  /// with their old linkage.  The caller is responsible for giving them a
+  /// linkage that is valid for a declaration.
+  void dropMaterializer();
+
 /// @}
 /// @name Direct access to the globals list, functions list, and symbol table
 /// @{
@@ -0,0 +1,84 @@
+//===- PassInstrumentation.h - Observe the legacy pass managers -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the PassInstrumentation interface, through which clients
+// are told about every pass the legacy pass managers run: how long it took,
+// how much heap memory it allocated and how it changed the size of the IR.
+// Unlike -time-passes, which prints a report at exit, this lets a compiler
+// service export the numbers or stop optimizing a module that is over its
+// compile-time budget.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_PASSINSTRUMENTATION_H
+#define LLVM_IR_PASSINSTRUMENTATION_H
+
+#include "llvm/Support/Timer.h"
+
+namespace llvm {
+
+class Function;
+class Module;
+class Pass;
+
+/// PassRunInfo - A description of one run of a pass.
+struct PassRunInfo {
+  /// The pass that ran.
+  Pass *P;
+  /// The module being compiled.
+  Module *M;
+  /// The function the pass ran on, or contains the loop or region the pass ran
+  /// on.  Null for module passes and for call graph passes over more than one
+  /// function.
+  Function *F;
+  /// Whether the pass reported that it changed the IR.
+  bool Changed;
+  /// Elapsed wall, user and system time, and the change in heap usage, which
+  /// includes the slabs of any BumpPtrAllocator the pass grew.
+  TimeRecord Time;
+  /// The number of instructions in F, or in M if F is null, before and after
+  /// the pass ran.
+  unsigned InstCountBefore, InstCountAfter;
+};
+
+/// PassInstrumentation - The interface for clients that want to observe each
+/// pass executed by the legacy pass managers.  Pass managers themselves are
+/// not reported, only the passes they contain.
+///
+/// Instrumentations are global.  They must be registered before and removed
+/// after any pass manager runs, and may be called from several threads at
+/// once when function passes run in parallel.  Counting instructions costs
+/// time linear in the size of the function or module for every pass, so it
+/// is only done while an instrumentation is registered.
+class PassInstrumentation {
+  virtual void anchor();
+
+public:
+  virtual ~PassInstrumentation() {}
+
+  /// shouldRunPass - Called before P runs on F, or on M if F is null.  Return
+  /// false to skip P, for example to stop optimizing once a compile-time
+  /// budget is exhausted.  Analyses are never skipped.  Skipping a pass that
+  /// later passes depend on, such as instruction selection, is not supported.
+  virtual bool shouldRunPass(Pass *P, Module &M, Function *F) { return true; }
+
+  /// passExecuted - Called after a pass has run.
+  virtual void passExecuted(const PassRunInfo &Info) = 0;
+};
+
+/// addPassInstrumentation - Register PI to be told about every pass that is
+/// run.  The caller keeps ownership of PI.
+void addPassInstrumentation(PassInstrumentation *PI);
+
+/// removePassInstrumentation - Undo addPassInstrumentation.
+void removePassInstrumentation(PassInstrumentation *PI);
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,73 @@
+//===- PassTimingReport.h - Per-function pass timing report -----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines PassTimingReport, a PassInstrumentation that records the
+// time and memory of every pass run on every function and writes them out as
+// YAML.  Where -time-passes adds up each pass over the whole module, this
+// report shows which functions are expensive to compile, and in which passes.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_PASSTIMINGREPORT_H
+#define LLVM_IR_PASSTIMINGREPORT_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/Support/Mutex.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class raw_ostream;
+
+/// PassTimingReport - Records each pass run on each function, and each
+/// module pass, in the order they ran.
+///
+/// The peak memory of a function is the largest heap usage seen at the end
+/// of any of its passes; allocations a pass frees again before it finishes
+/// are not seen.
+class PassTimingReport : public PassInstrumentation {
+public:
+  struct PassEntry {
+    StringRef Name;
+    TimeRecord Time;
+  };
+
+  struct FunctionEntry {
+    FunctionEntry() : PeakMemory(0) {}
+    std::string Name;
+    TimeRecord Time;
+    size_t PeakMemory;
+    std::vector<PassEntry> Passes;
+  };
+
+  virtual void passExecuted(const PassRunInfo &Info);
+
+  /// writeYAML - Write the report to OS as a YAML document, with the
+  /// functions that took the most wall time first.
+  void writeYAML(raw_ostream &OS) const;
+
+  void clear();
+
+private:
+  mutable sys::SmartMutex<true> Lock;
+  /// The names of the passes seen, which the entries refer to.
+  StringSet<> PassNames;
+  std::vector<PassEntry> ModulePasses;
+  std::vector<FunctionEntry> Functions;
+  /// The index in Functions of each function.  Functions are found by name
+  /// rather than address, which another context may reuse.
+  StringMap<unsigned> FunctionIndex;
+};
+
+} // End llvm namespace
+
+#endif
@@ -61,6 +61,11 @@ public:
     return Par ? toPtr(Par->getValueSymbolTable()) : 0;
   }
 
+  /// noteListChange - Called whenever a node is added to, removed from or
+  /// moved within the list owned by Par.  Traits for lists whose changes
+  /// need to be tracked hide this.
+  static void noteListChange(ItemParentClass *Par) {}
+
   void addNodeToList(ValueSubClass *V);
   void removeNodeFromList(ValueSubClass *V);
   void transferNodesFromList(ilist_traits<ValueSubClass> &L2,
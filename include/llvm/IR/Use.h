@@ -20,6 +20,10 @@
 //
 //   http://www.llvm.org/docs/ProgrammersManual.html#UserLayout
 //
+// Finding the User that way takes time logarithmic in the number of operands.
+// When LLVM is built with LLVM_ENABLE_USE_BACK_POINTERS, every Use instead
+// holds a pointer to its User, at the cost of a word per Use.
+//
 //===----------------------------------------------------------------------===//
 
 #ifndef LLVM_IR_USE_H
@@ -32,6 +36,10 @@
 #include <cstddef>
 #include <iterator>
 
+#ifndef LLVM_ENABLE_USE_BACK_POINTERS
+#define LLVM_ENABLE_USE_BACK_POINTERS 0
+#endif
+
 namespace llvm {
 
 class Value;
@@ -71,9 +79,7 @@ private:
   Use(const Use &U) LLVM_DELETED_FUNCTION;
 
   /// Destructor - Only for zap()
-  ~Use() {
-    if (Val) removeFromList();
-  }
+  inline ~Use();
 
   enum PrevPtrTag { zeroDigitTag
                   , oneDigitTag
@@ -95,7 +101,11 @@ public:
   
   /// getUser - This returns the User that contains this Use.  For an
   /// instruction operand, for example, this will return the instruction.
+#if LLVM_ENABLE_USE_BACK_POINTERS
+  User *getUser() const { return Parent; }
+#else
   User *getUser() const;
+#endif
 
   inline void set(Value *Val);
 
@@ -115,8 +125,8 @@ public:
 
   
   /// initTags - initialize the waymarking tags on an array of Uses, so that
-  /// getUser() can find the User from any of those Uses.
-  static Use *initTags(Use *Start, Use *Stop);
+  /// getUser() can find the User U from any of those Uses.
+  static Use *initTags(Use *Start, Use *Stop, User *U);
 
   /// zap - This is used to destroy Use operands when the number of operands of
   /// a User changes.
@@ -128,6 +138,9 @@ private:
   Value *Val;
   Use *Next;
   PointerIntPair<Use**, 2, PrevPtrTag> Prev;
+#if LLVM_ENABLE_USE_BACK_POINTERS
+  User *Parent;
+#endif
 
   void setPrev(Use **NewPrev) {
     Prev.setPointer(NewPrev);
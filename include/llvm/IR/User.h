@@ -48,9 +48,17 @@ protected:
   ///
   unsigned NumOperands;
 
+  /// FromArena - Whether this user and its operands were allocated from an
+  /// IRArena, which only instructions are.
+  bool FromArena;
+
   void *operator new(size_t s, unsigned Us);
+  /// placeUser - Lay out Us operands at the start of Storage, which must have
+  /// room for them followed by the user, and return where the user goes.
+  static void *placeUser(void *Storage, unsigned Us);
   User(Type *ty, unsigned vty, Use *OpList, unsigned NumOps)
-    : Value(ty, vty), OperandList(OpList), NumOperands(NumOps) {}
+    : Value(ty, vty), OperandList(OpList), NumOperands(NumOps),
+      FromArena(false) {}
   Use *allocHungoffUses(unsigned) const;
   void dropHungoffUses() {
     Use::zap(OperandList, OperandList + NumOperands, true);
@@ -182,7 +182,19 @@ public:
 
   /// addUse - This method should only be used by the Use class.
   ///
-  void addUse(Use &U) { U.addToList(&UseList); }
+  void addUse(Use &U) {
+    U.addToList(&UseList);
+    if (SubclassID == BasicBlockVal && SubclassOptionalData)
+      updateMaintainedPredecessors(U, true);
+  }
+
+  /// removeUse - This method should only be used by the Use class.
+  ///
+  void removeUse(Use &U) {
+    if (SubclassID == BasicBlockVal && SubclassOptionalData)
+      updateMaintainedPredecessors(U, false);
+    U.removeFromList();
+  }
 
   /// An enumeration for keeping track of the concrete subclass of Value that
   /// is actually instantiated. Values of this enumeration are kept in the 
@@ -346,6 +358,12 @@ public:
 protected:
   unsigned short getSubclassDataFromValue() const { return SubclassData; }
   void setValueSubclassData(unsigned short D) { SubclassData = D; }
+
+private:
+  /// updateMaintainedPredecessors - Note that the use U of this BasicBlock,
+  /// which keeps a list of its predecessors, was added or is being removed.
+  /// This is implemented in BasicBlock.cpp.
+  void updateMaintainedPredecessors(Use &U, bool Added);
 };
 
 inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
@@ -354,11 +372,15 @@ inline raw_ostream &operator<<(raw_ostream &OS, const Value &V) {
 }
   
 void Use::set(Value *V) {
-  if (Val) removeFromList();
+  if (Val) Val->removeUse(*this);
   Val = V;
   if (V) V->addUse(*this);
 }
 
+Use::~Use() {
+  if (Val) Val->removeUse(*this);
+}
+
 
 // isa - Provide some specializations of isa so that we don't have to include
 // the subtype header files to test to see if the value is a subclass...
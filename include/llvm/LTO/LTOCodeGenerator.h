@@ -67,12 +67,29 @@ struct LTOCodeGenerator {
   // Merge given module, return true on success.
   bool addModule(struct LTOModule*, std::string &errMsg);
 
+  // Import the functions listed in the given import list (see LTOSummary.h)
+  // into the merged module, lazily loading the bitcode files that define
+  // them. Return true on success.
+  bool importFunctions(const struct LTOImportList &imports,
+                       std::string &errMsg);
+
   void setTargetOptions(llvm::TargetOptions options);
   void setDebugInfo(lto_debug_model);
   void setCodePICModel(lto_codegen_model);
 
   void setCpu(const char *mCpu) { MCpu = mCpu; }
 
+  // Set the number of partitions the merged module is split into by
+  // compile_to_files(). Each partition is compiled on its own thread, in its
+  // own LLVMContext. The default of 1 generates a single object file.
+  void setParallelism(unsigned N) { Parallelism = N ? N : 1; }
+
+  // Cache the object files compile_to_files() generates in the given
+  // directory, keyed by a hash of the optimized IR of the partition and of
+  // the code generation options, and reuse them for partitions that didn't
+  // change. Concurrent links can share the directory.
+  void setCacheDir(const char *path) { CacheDir = path ? path : ""; }
+
   void addMustPreserveSymbol(const char *sym) { MustPreserveSymbols[sym] = 1; }
 
   // To pass options to the driver and optimization passes. These options are
@@ -117,9 +134,29 @@ struct LTOCodeGenerator {
                       bool disableGVNLoadPRE,
                       std::string &errMsg);
 
+  // Compile the merged module into one object file per partition (see
+  // setParallelism()). The paths of the object files are returned via "names"
+  // and "numFiles" and stay valid until the next compilation or until the
+  // LTOCodeGenerator is destroyed. Return true on success.
+  //
+  // As with compile_to_file(), it is up to the linker to remove the object
+  // files.
+  //
+  bool compile_to_files(const char ***names,
+                        unsigned *numFiles,
+                        bool disableOpt,
+                        bool disableInline,
+                        bool disableGVNLoadPRE,
+                        std::string &errMsg);
+
 private:
   void initializeLTOPasses();
 
+  bool optimize(bool disableOpt,
+                bool disableInline,
+                bool disableGVNLoadPRE,
+                std::string &errMsg);
+
   bool generateObjectFile(llvm::raw_ostream &out,
                           bool disableOpt,
                           bool disableInline,
@@ -147,6 +184,10 @@ private:
   std::vector<char *> CodegenOptions;
   std::string MCpu;
   std::string NativeObjectPath;
+  std::vector<std::string> NativeObjectPaths;
+  std::vector<const char *> NativeObjectPathPtrs;
+  unsigned Parallelism;
+  std::string CacheDir;
   llvm::TargetOptions Options;
 };
 
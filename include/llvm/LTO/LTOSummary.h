@@ -0,0 +1,99 @@
+//===-LTOSummary.h - LLVM Link Time Optimizer -----------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the function summaries written alongside bitcode files
+// for distributed LTO, and the thin link, which decides from the summaries
+// alone which functions each module imports from the others.  Each module is
+// then optimized and compiled on its own, with just those functions imported
+// (see LTOCodeGenerator::importFunctions()).
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LTO_SUMMARY_H
+#define LTO_SUMMARY_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/GlobalValue.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace llvm {
+  class Module;
+  class raw_ostream;
+}
+
+//===----------------------------------------------------------------------===//
+/// LTOFunctionSummary - What the thin link knows about a function defined in
+/// a module.
+///
+struct LTOFunctionSummary {
+  std::string Name;
+  llvm::GlobalValue::LinkageTypes Linkage;
+
+  /// The number of instructions in the body, not counting debug intrinsics.
+  unsigned InstCount;
+
+  /// Whether the body can be imported into another module, that is whether
+  /// it only refers to globals that module can name.
+  bool Importable;
+
+  /// The functions the body calls directly.
+  std::vector<std::string> Calls;
+
+  LTOFunctionSummary()
+    : Linkage(llvm::GlobalValue::ExternalLinkage), InstCount(0),
+      Importable(false) {}
+};
+
+//===----------------------------------------------------------------------===//
+/// LTOModuleSummary - The summaries of the functions a bitcode file defines.
+///
+struct LTOModuleSummary {
+  /// The path of the bitcode file.
+  std::string ModulePath;
+  std::vector<LTOFunctionSummary> Functions;
+
+  /// Summarize the functions \p M defines.  \p M must be fully materialized.
+  void build(const llvm::Module &M, llvm::StringRef Path);
+
+  void write(llvm::raw_ostream &OS) const;
+
+  /// Read a summary written by write().  Return true on success.
+  bool read(llvm::StringRef Buffer, std::string &errMsg);
+};
+
+//===----------------------------------------------------------------------===//
+/// LTOImportList - The functions a module imports, by the path of the bitcode
+/// file that defines them.
+///
+struct LTOImportList {
+  typedef std::map<std::string, std::vector<std::string> > ImportMapTy;
+
+  /// The path of the bitcode file that imports.
+  std::string ModulePath;
+  ImportMapTy Imports;
+
+  void write(llvm::raw_ostream &OS) const;
+
+  /// Read an import list written by write().  Return true on success.
+  bool read(llvm::StringRef Buffer, std::string &errMsg);
+};
+
+/// computeLTOImports - The thin link.  Each module imports the functions it
+/// calls that another module defines with external linkage, if they are
+/// importable and have at most \p InstLimit instructions, then in turn the
+/// functions those call, so that the inliner can flatten a chain of small
+/// functions.  \p Imports gets one list for each of \p Summaries, in order.
+void computeLTOImports(llvm::ArrayRef<LTOModuleSummary> Summaries,
+                       unsigned InstLimit,
+                       std::vector<LTOImportList> &Imports);
+
+#endif // LTO_SUMMARY_H
@@ -74,7 +74,15 @@ namespace {
       (void) llvm::createDomPrinterPass();
       (void) llvm::createDomOnlyViewerPass();
       (void) llvm::createDomViewerPass();
+      (void) llvm::createEdgeProfileLoaderPass();
+      (void) llvm::createEdgeProfilerPass();
       (void) llvm::createGCOVProfilerPass();
+      (void) llvm::createHotColdSplittingPass();
+      (void) llvm::createFunctionSpecializationPass();
+      (void) llvm::createIndirectCallPromotionPass();
+      (void) llvm::createSummaryFunctionAttrsPass();
+      (void) llvm::createFunctionSectionPrefixPass();
+      (void) llvm::createFunctionOrderingPass();
       (void) llvm::createFunctionInliningPass();
       (void) llvm::createAlwaysInlinerPass();
       (void) llvm::createGlobalDCEPass();
@@ -129,11 +137,16 @@ namespace {
       (void) llvm::createJumpThreadingPass();
       (void) llvm::createUnifyFunctionExitNodesPass();
       (void) llvm::createInstCountPass();
+      (void) llvm::createInstSimplifyCachePass();
       (void) llvm::createCodeGenPreparePass();
       (void) llvm::createEarlyCSEPass();
       (void) llvm::createGVNPass();
       (void) llvm::createMemCpyOptPass();
       (void) llvm::createLoopDeletionPass();
+      (void) llvm::createLoopDataPrefetchPass();
+      (void) llvm::createLoopDistributePass();
+      (void) llvm::createLoopFusionPass();
+      (void) llvm::createLoopInvariantDivisionPass();
       (void) llvm::createPostDomTree();
       (void) llvm::createInstructionNamerPass();
       (void) llvm::createMetaRenamerPass();
@@ -144,11 +157,13 @@ namespace {
       (void) llvm::createPrintBasicBlockPass(0);
       (void) llvm::createModuleDebugInfoPrinterPass();
       (void) llvm::createPartialInliningPass();
+      (void) llvm::createWholeProgramDevirtPass();
       (void) llvm::createLintPass();
       (void) llvm::createSinkingPass();
       (void) llvm::createLowerAtomicPass();
       (void) llvm::createCorrelatedValuePropagationPass();
       (void) llvm::createMemDepPrinter();
+      (void) llvm::createMemorySSAPass();
       (void) llvm::createInstructionSimplifierPass();
       (void) llvm::createLoopVectorizePass();
       (void) llvm::createSLPVectorizerPass();
@@ -10,7 +10,11 @@
 #ifndef LLVM_LINKER_H
 #define LLVM_LINKER_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/TinyPtrVector.h"
 #include <string>
 
 namespace llvm {
@@ -27,7 +31,28 @@ class Linker {
   public:
     enum LinkerMode {
       DestroySource = 0, // Allow source module to be destroyed.
-      PreserveSource = 1 // Preserve the source module.
+      PreserveSource = 1, // Preserve the source module.
+      LinkOnlyNeeded = 2 // Only link in definitions the composite refers to.
+    };
+
+    /// IdentifiedStructTypeSet - The identified struct types of the
+    /// composite.  The ones with a body are also indexed by a hash of their
+    /// structure, so that a type of a module being linked in is only
+    /// compared against the few types it could be isomorphic to.
+    class IdentifiedStructTypeSet {
+    public:
+      /// Add \p Ty, or index it if it got a body since it was added.
+      void insert(StructType *Ty);
+      bool count(StructType *Ty) const;
+
+      /// Return the types with a body whose structure hashes the same as
+      /// that of \p Ty, which must have a body.
+      ArrayRef<StructType*> getCandidates(StructType *Ty) const;
+
+    private:
+      SmallPtrSet<StructType*, 32> OpaqueTypes;
+      SmallPtrSet<StructType*, 32> NonOpaqueTypes;
+      DenseMap<unsigned, TinyPtrVector<StructType*> > NonOpaqueIndex;
     };
 
     Linker(Module *M);
@@ -38,6 +63,9 @@ class Linker {
 
     /// \brief Link \p Src into the composite. The source is destroyed if
     /// \p Mode is DestroySource and preserved if it is PreserveSource.
+    /// If \p Mode also has LinkOnlyNeeded set, a function of \p Src is only
+    /// linked in if the composite, or something else linked in, refers to
+    /// it.  The bodies of the other functions are never materialized.
     /// If \p ErrorMsg is not null, information about any error is written
     /// to it.
     /// Returns true on error.
@@ -46,12 +74,25 @@ class Linker {
       return linkInModule(Src, Linker::DestroySource, ErrorMsg);
     }
 
+    /// \brief Import the definitions of the functions of \p Src named in
+    /// \p FunctionsToImport into the composite, with available_externally
+    /// linkage so they can be inlined but are never emitted.  Nothing else is
+    /// defined: the globals, aliases and other functions the imported bodies
+    /// refer to are only declared, and appending variables, named metadata
+    /// and module inline asm are left alone.  The bodies of the other
+    /// functions of a lazily loaded \p Src are never materialized.  \p Src
+    /// is destroyed.  The imported functions must not refer to anything
+    /// with local linkage in \p Src, as that can't be declared.
+    /// Returns true on error.
+    bool importFunctions(Module *Src, const StringSet<> &FunctionsToImport,
+                         std::string *ErrorMsg);
+
     static bool LinkModules(Module *Dest, Module *Src, unsigned Mode,
                             std::string *ErrorMsg);
 
   private:
     Module *Composite;
-    SmallPtrSet<StructType*, 32> IdentifiedStructTypes;
+    IdentifiedStructTypeSet IdentifiedStructTypes;
 };
 
 } // End llvm namespace
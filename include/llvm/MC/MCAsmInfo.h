@@ -307,6 +307,10 @@ namespace llvm {
     /// instead of symbolic register names in .cfi_* directives.
     bool DwarfRegNumForCFI;  // Defaults to false;
 
+    /// CompressDebugSections - True if the object writer should compress the
+    /// .debug_* sections it emits.
+    bool CompressDebugSections;  // Defaults to false.
+
     //===--- Prologue State ----------------------------------------------===//
 
     std::vector<MCCFIInstruction> InitialFrameState;
@@ -532,6 +536,13 @@ namespace llvm {
       return DwarfRegNumForCFI;
     }
 
+    bool compressDebugSections() const {
+      return CompressDebugSections;
+    }
+    void setCompressDebugSections(bool Compress) {
+      CompressDebugSections = Compress;
+    }
+
     void addInitialFrameState(const MCCFIInstruction &Inst) {
       InitialFrameState.push_back(Inst);
     }
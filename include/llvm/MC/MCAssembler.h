@@ -85,6 +85,12 @@ private:
 protected:
   MCFragment(FragmentType _Kind, MCSectionData *_Parent = 0);
 
+  /// getHeapMemory - The bytes \p V holds outside of its inline storage.
+  template <typename T, unsigned N>
+  static size_t getHeapMemory(const SmallVector<T, N> &V) {
+    return V.capacity() > N ? V.capacity() * sizeof(T) : 0;
+  }
+
 public:
   // Only for sentinel.
   MCFragment();
@@ -123,6 +129,10 @@ public:
   virtual void setBundlePadding(uint8_t N) {
   }
 
+  /// \brief The bytes of memory this fragment holds, including the storage
+  /// its contents and fixups have grown into.
+  virtual size_t getMemorySize() const { return sizeof(*this); }
+
   void dump();
 };
 
@@ -241,6 +251,14 @@ public:
   fixup_iterator fixup_end() {return Fixups.end();}
   const_fixup_iterator fixup_end() const {return Fixups.end();}
 
+  /// \brief Release the storage the contents and fixups have grown into but
+  /// do not use.  Called once the streamer has moved past this fragment.
+  void compact();
+
+  virtual size_t getMemorySize() const {
+    return sizeof(*this) + getHeapMemory(Contents) + getHeapMemory(Fixups);
+  }
+
   static bool classof(const MCFragment *F) {
     return F->getKind() == MCFragment::FT_Data;
   }
@@ -274,6 +292,10 @@ public:
   virtual bool alignToBundleEnd() const { return AlignToBundleEnd; }
   virtual void setAlignToBundleEnd(bool V) { AlignToBundleEnd = V; }
 
+  virtual size_t getMemorySize() const {
+    return sizeof(*this) + getHeapMemory(Contents);
+  }
+
   static bool classof(const MCFragment *F) {
     return F->getKind() == MCFragment::FT_CompactEncodedInst;
   }
@@ -321,6 +343,10 @@ public:
   fixup_iterator fixup_end() {return Fixups.end();}
   const_fixup_iterator fixup_end() const {return Fixups.end();}
 
+  virtual size_t getMemorySize() const {
+    return sizeof(*this) + getHeapMemory(Contents) + getHeapMemory(Fixups);
+  }
+
   static bool classof(const MCFragment *F) {
     return F->getKind() == MCFragment::FT_Relaxable;
   }
@@ -370,6 +396,8 @@ public:
 
   /// @}
 
+  virtual size_t getMemorySize() const { return sizeof(*this); }
+
   static bool classof(const MCFragment *F) {
     return F->getKind() == MCFragment::FT_Align;
   }
@@ -408,6 +436,8 @@ public:
 
   /// @}
 
+  virtual size_t getMemorySize() const { return sizeof(*this); }
+
   static bool classof(const MCFragment *F) {
     return F->getKind() == MCFragment::FT_Fill;
   }
@@ -436,6 +466,8 @@ public:
 
   /// @}
 
+  virtual size_t getMemorySize() const { return sizeof(*this); }
+
   static bool classof(const MCFragment *F) {
     return F->getKind() == MCFragment::FT_Org;
   }
@@ -468,6 +500,10 @@ public:
 
   /// @}
 
+  virtual size_t getMemorySize() const {
+    return sizeof(*this) + getHeapMemory(Contents);
+  }
+
   static bool classof(const MCFragment *F) {
     return F->getKind() == MCFragment::FT_LEB;
   }
@@ -504,6 +540,10 @@ public:
 
   /// @}
 
+  virtual size_t getMemorySize() const {
+    return sizeof(*this) + getHeapMemory(Contents);
+  }
+
   static bool classof(const MCFragment *F) {
     return F->getKind() == MCFragment::FT_Dwarf;
   }
@@ -533,6 +573,10 @@ public:
 
   /// @}
 
+  virtual size_t getMemorySize() const {
+    return sizeof(*this) + getHeapMemory(Contents);
+  }
+
   static bool classof(const MCFragment *F) {
     return F->getKind() == MCFragment::FT_DwarfFrame;
   }
@@ -866,6 +910,28 @@ private:
   /// List of declared file names
   FileNameVectorType FileNames;
 
+  /// RelaxationSpan - For a relaxable fragment that was last found not to
+  /// need relaxing, the range of layout orders in its section from the
+  /// fragment to the targets of its fixups, and how many size changes the
+  /// section had seen at the time.
+  struct RelaxationSpan {
+    unsigned First, Last;
+    unsigned NumChanges;
+  };
+
+  /// The relaxable fragments whose answer can only change if a fragment
+  /// inside their span changes size, or, when the span contains alignment,
+  /// anywhere before it.  Only used during layout.
+  DenseMap<const MCFragment*, RelaxationSpan> SettledFragments;
+
+  /// The layout orders of the fragments that changed size during relaxation,
+  /// by section, in the order they changed.
+  DenseMap<const MCSectionData*, std::vector<unsigned> > SizeChanges;
+
+  /// For each section, the number of fragments whose size depends on their
+  /// offset, such as alignment, before each layout order.
+  DenseMap<const MCSectionData*, std::vector<unsigned> > OffsetDependentCounts;
+
   /// The set of function symbols for which a .thumb_func directive has
   /// been seen.
   //
@@ -927,6 +993,15 @@ private:
 
   bool relaxInstruction(MCAsmLayout &Layout, MCRelaxableFragment &IF);
 
+  /// Record the span that decides whether IF needs relaxation, if it only
+  /// depends on distances within its section.
+  void noteSettledFragment(const MCAsmLayout &Layout,
+                           const MCRelaxableFragment &IF);
+
+  /// Check whether IF was found not to need relaxation and nothing that could
+  /// change that has changed size since.
+  bool isSettledFragment(const MCRelaxableFragment &IF);
+
   bool relaxLEB(MCAsmLayout &Layout, MCLEBFragment &IF);
 
   bool relaxDwarfLineAddr(MCAsmLayout &Layout, MCDwarfLineAddrFragment &DF);
@@ -955,10 +1030,15 @@ public:
   /// defining a separate atom.
   bool isSymbolLinkerVisible(const MCSymbol &SD) const;
 
-  /// Emit the section contents using the given object writer.
+  /// Emit the section contents using the assembler's object writer.
   void writeSectionData(const MCSectionData *Section,
                         const MCAsmLayout &Layout) const;
 
+  /// Emit the section contents using the given object writer, which need not
+  /// be the one the assembler was created with.
+  void writeSectionData(const MCSectionData *Section,
+                        const MCAsmLayout &Layout, MCObjectWriter *OW) const;
+
   /// Check whether a given symbol has been flagged with .thumb_func.
   bool isThumbFunc(const MCSymbol *Func) const {
     return ThumbFuncs.count(Func);
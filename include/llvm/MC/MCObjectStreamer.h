@@ -60,6 +60,11 @@ protected:
   MCFragment *getCurrentFragment() const;
 
   void insert(MCFragment *F) const {
+    // The streamer only comes back to the current fragment through a
+    // subsection, so trim the storage it has grown into.
+    if (MCDataFragment *DF =
+          dyn_cast_or_null<MCDataFragment>(getCurrentFragment()))
+      DF->compact();
     CurSectionData->getFragmentList().insert(CurInsertionPoint, F);
     F->setParent(CurSectionData);
   }
@@ -14,6 +14,7 @@
 #ifndef LLVM_OBJECT_ARCHIVE_H
 #define LLVM_OBJECT_ARCHIVE_H
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -102,6 +103,9 @@ public:
     const Child* operator->() const {
       return &child;
     }
+    const Child &operator*() const {
+      return child;
+    }
 
     bool operator==(const child_iterator &other) const {
       return child == other.child;
@@ -185,7 +189,8 @@ public:
     return v->isArchive();
   }
 
-  // check if a symbol is in the archive
+  // check if a symbol is in the archive.  The first call builds a hash table
+  // of the symbol table, so that later calls take constant time.
   child_iterator findSym(StringRef name) const;
 
   bool hasSymbolTable() const;
@@ -195,6 +200,12 @@ private:
   child_iterator StringTable;
   child_iterator FirstRegular;
   Kind Format;
+
+  /// SymbolMap - The symbol and string index of the first symbol with each
+  /// name, built by the first call to findSym.
+  mutable StringMap<std::pair<uint32_t, uint32_t> > SymbolMap;
+  mutable bool SymbolMapBuilt;
+  void buildSymbolMap() const;
 };
 
 }
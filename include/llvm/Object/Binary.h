@@ -75,6 +75,7 @@ public:
 
   StringRef getData() const;
   StringRef getFileName() const;
+  const MemoryBuffer *getMemoryBuffer() const { return Data; }
 
   // Cast methods.
   unsigned int getType() const { return TypeID; }
@@ -404,6 +404,11 @@ public:
   ErrorOr<StringRef> getSymbolName(const Elf_Shdr *SymTab,
                                    const Elf_Sym *Symb) const;
   ErrorOr<StringRef> getSectionName(const Elf_Shdr *Section) const;
+
+  /// \brief Get the string table of the static symbol table, or of the
+  /// dynamic one if \p Dynamic.  Empty if there is no such table.
+  StringRef getSymbolStringTable(bool Dynamic) const;
+
   uint64_t getSymbolIndex(const Elf_Sym *sym) const;
   ErrorOr<ArrayRef<uint8_t> > getSectionContents(const Elf_Shdr *Sec) const;
   StringRef getLoadName() const;
@@ -894,12 +899,23 @@ ErrorOr<StringRef> ELFFile<ELFT>::getSymbolName(const Elf_Shdr *Section,
       return getSectionName(ContainingSec);
   }
 
-  const Elf_Shdr *StrTab = getSection(Section->sh_link);
+  const Elf_Shdr *StrTab = Section == dot_symtab_sec ?
+                           dot_strtab_sec : getSection(Section->sh_link);
   if (Symb->st_name >= StrTab->sh_size)
     return object_error::parse_failed;
   return StringRef(getString(StrTab, Symb->st_name));
 }
 
+template <class ELFT>
+StringRef ELFFile<ELFT>::getSymbolStringTable(bool Dynamic) const {
+  if (Dynamic)
+    return StringRef((const char *)DynStrRegion.Addr, DynStrRegion.Size);
+  if (!dot_strtab_sec)
+    return StringRef();
+  return StringRef((const char *)base() + dot_strtab_sec->sh_offset,
+                   dot_strtab_sec->sh_size);
+}
+
 template <class ELFT>
 ErrorOr<StringRef>
 ELFFile<ELFT>::getSectionName(const Elf_Shdr *Section) const {
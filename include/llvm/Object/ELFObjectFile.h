@@ -35,6 +35,30 @@
 namespace llvm {
 namespace object {
 
+/// ELFSymbolView - A symbol read in bulk from an ELF symbol table by
+/// ELFObjectFile::getSymbolViews.
+template <class ELFT> struct ELFSymbolView {
+  /// The symbol table entry, in the mapped file.
+  const typename ELFFile<ELFT>::Elf_Sym *Sym;
+  /// The name, or for an unnamed symbol in a section, the section's name.
+  StringRef Name;
+  /// The same symbol, for what the view does not cover.
+  SymbolRef Ref;
+};
+
+/// ELFRelocationView - A relocation read in bulk from a SHT_REL or SHT_RELA
+/// section by ELFObjectFile::getRelocationViews.
+template <class ELFT> struct ELFRelocationView {
+  uint64_t Offset;
+  uint32_t Type;
+  /// The addend, which is 0 for a SHT_REL section.
+  int64_t Addend;
+  /// The symbol table entry the relocation refers to, or null for symbol 0.
+  const typename ELFFile<ELFT>::Elf_Sym *Sym;
+  /// The same symbol; its owning object is null when Sym is.
+  SymbolRef Symbol;
+};
+
 template <class ELFT>
 class ELFObjectFile : public ObjectFile {
 public:
@@ -185,6 +209,21 @@ public:
   error_code getSymbolVersion(SymbolRef Symb, StringRef &Version,
                               bool &IsDefault) const;
 
+  /// \brief Read every symbol of the static symbol table, or of the dynamic
+  /// one if \p Dynamic, into \p Result.  The string table is validated once,
+  /// so each symbol costs a bounds check on its name rather than a virtual
+  /// call and a validation per field.
+  error_code getSymbolViews(bool Dynamic,
+                            SmallVectorImpl<ELFSymbolView<ELFT> > &Result)
+    const;
+
+  /// \brief Read every relocation of the SHT_REL or SHT_RELA section \p Sec
+  /// into \p Result.  Symbol indexes are checked against the size of the
+  /// symbol table the section links to.
+  error_code
+  getRelocationViews(SectionRef Sec,
+                     SmallVectorImpl<ELFRelocationView<ELFT> > &Result) const;
+
   virtual uint8_t getBytesInAddress() const;
   virtual StringRef getFileFormatName() const;
   virtual StringRef getObjectType() const { return "ELF"; }
@@ -819,6 +858,105 @@ ELFObjectFile<ELFT>::ELFObjectFile(MemoryBuffer *Object, error_code &ec)
                  Object),
       EF(Object, ec) {}
 
+template <class ELFT>
+error_code ELFObjectFile<ELFT>::getSymbolViews(
+    bool Dynamic, SmallVectorImpl<ELFSymbolView<ELFT> > &Result) const {
+  Result.clear();
+  Elf_Sym_Iter I = Dynamic ? EF.begin_dynamic_symbols() : EF.begin_symbols();
+  Elf_Sym_Iter E = Dynamic ? EF.end_dynamic_symbols() : EF.end_symbols();
+  if (I == E)
+    return object_error::success;
+
+  // A string table ending in a null makes every offset inside it a valid,
+  // terminated name.
+  StringRef StrTab = EF.getSymbolStringTable(Dynamic);
+  if (StrTab.empty() || StrTab.back() != '\0')
+    return object_error::parse_failed;
+
+  Result.reserve(E - I);
+  for (; I != E; ++I) {
+    ELFSymbolView<ELFT> View;
+    View.Sym = &*I;
+    View.Ref = SymbolRef(toDRI(I), this);
+    if (I->st_name >= StrTab.size())
+      return object_error::parse_failed;
+    View.Name = StringRef(StrTab.data() + I->st_name);
+
+    // Like getSymbolName, name an unnamed static symbol after its section.
+    if (!Dynamic && I->st_name == 0)
+      if (const Elf_Shdr *Sec = EF.getSection(View.Sym)) {
+        ErrorOr<StringRef> SecName = EF.getSectionName(Sec);
+        if (!SecName)
+          return SecName;
+        View.Name = *SecName;
+      }
+    Result.push_back(View);
+  }
+  return object_error::success;
+}
+
+template <class ELFT>
+error_code ELFObjectFile<ELFT>::getRelocationViews(
+    SectionRef Sec, SmallVectorImpl<ELFRelocationView<ELFT> > &Result) const {
+  Result.clear();
+  const Elf_Shdr *RelSec = &*toELFShdrIter(Sec.getRawDataRefImpl());
+  bool IsRela = RelSec->sh_type == ELF::SHT_RELA;
+  if (!IsRela && RelSec->sh_type != ELF::SHT_REL)
+    return object_error::parse_failed;
+  if (!RelSec->sh_entsize)
+    return object_error::parse_failed;
+
+  // Symbol 0 is the null symbol, so an unlinked section can only use it.
+  const Elf_Shdr *SymTab = 0;
+  uint64_t NumSymbols = 1;
+  if (RelSec->sh_link) {
+    SymTab = EF.getSection(RelSec->sh_link);
+    if (!SymTab || !SymTab->sh_entsize ||
+        (SymTab->sh_type != ELF::SHT_SYMTAB &&
+         SymTab->sh_type != ELF::SHT_DYNSYM))
+      return object_error::parse_failed;
+    NumSymbols = SymTab->sh_size / SymTab->sh_entsize;
+  }
+  Elf_Sym_Iter FirstSym;
+  if (SymTab)
+    FirstSym = SymTab->sh_type == ELF::SHT_SYMTAB ? EF.begin_symbols()
+                                                  : EF.begin_dynamic_symbols();
+
+  bool IsMips64EL = EF.isMips64EL();
+  Result.reserve(RelSec->sh_size / RelSec->sh_entsize);
+  for (uint64_t i = 0, e = RelSec->sh_size / RelSec->sh_entsize; i != e;
+       ++i) {
+    ELFRelocationView<ELFT> View;
+    uint32_t SymIdx;
+    if (IsRela) {
+      const Elf_Rela *Rela = EF.template getEntry<Elf_Rela>(RelSec, i);
+      View.Offset = Rela->r_offset;
+      View.Type = Rela->getType(IsMips64EL);
+      View.Addend = Rela->r_addend;
+      SymIdx = Rela->getSymbol(IsMips64EL);
+    } else {
+      const Elf_Rel *Rel = EF.template getEntry<Elf_Rel>(RelSec, i);
+      View.Offset = Rel->r_offset;
+      View.Type = Rel->getType(IsMips64EL);
+      View.Addend = 0;
+      SymIdx = Rel->getSymbol(IsMips64EL);
+    }
+
+    if (SymIdx >= NumSymbols)
+      return object_error::parse_failed;
+    View.Sym = 0;
+    if (SymIdx) {
+      // operator+ advances the iterator it is applied to, so use a copy.
+      Elf_Sym_Iter SymI = FirstSym;
+      SymI = SymI + SymIdx;
+      View.Sym = &*SymI;
+      View.Symbol = SymbolRef(toDRI(SymI), this);
+    }
+    Result.push_back(View);
+  }
+  return object_error::success;
+}
+
 template <class ELFT>
 symbol_iterator ELFObjectFile<ELFT>::begin_symbols() const {
   return symbol_iterator(SymbolRef(toDRI(EF.begin_symbols()), this));
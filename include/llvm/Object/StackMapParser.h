@@ -0,0 +1,215 @@
+//===-- StackMapParser.h - StackMap Parsing Support -------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares StackMapParser, which reads the stack map section that
+// StackMaps::serializeToStackMapSection emits for llvm.experimental.stackmap
+// and llvm.experimental.patchpoint calls.  The parser does not copy the
+// section: its accessors read the fields in place, so the section must
+// outlive the parser and the accessors it hands out.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_OBJECT_STACKMAPPARSER_H
+#define LLVM_OBJECT_STACKMAPPARSER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/Endian.h"
+#include <cassert>
+#include <vector>
+
+namespace llvm {
+
+/// StackMapParser - A read-only view of a stack map section laid out in
+/// target byte order \p Endianness.
+template <support::endianness Endianness>
+class StackMapParser {
+public:
+  /// LocationKind - How a location describes where its value lives.  The
+  /// values match the encoding in the section.
+  enum LocationKind {
+    RegisterLocation = 1,      ///< In the register DwarfRegNum.
+    DirectLocation = 2,        ///< The address DwarfRegNum + Offset.
+    IndirectLocation = 3,      ///< Spilled to the address DwarfRegNum + Offset.
+    ConstantLocation = 4,      ///< The small constant Offset.
+    ConstantIndexLocation = 5  ///< The pool constant at index Offset.
+  };
+
+  /// ConstantAccessor - An entry of the pool of large constants.
+  class ConstantAccessor {
+  public:
+    explicit ConstantAccessor(const uint8_t *P) : P(P) {}
+
+    uint64_t getValue() const { return read<uint64_t>(P); }
+
+  private:
+    const uint8_t *P;
+  };
+
+  /// LocationAccessor - One location of a record.
+  class LocationAccessor {
+  public:
+    explicit LocationAccessor(const uint8_t *P) : P(P) {}
+
+    LocationKind getKind() const { return LocationKind(P[KindOffset]); }
+    unsigned getSizeInBytes() const { return P[SizeOffset]; }
+
+    /// getDwarfRegNum - The register of a Register, Direct or Indirect
+    /// location.
+    uint16_t getDwarfRegNum() const {
+      return read<uint16_t>(P + DwarfRegNumOffset);
+    }
+
+    /// getOffset - The offset from the register of a Direct or Indirect
+    /// location, or the subregister offset of a Register location.
+    int32_t getOffset() const { return read<int32_t>(P + ValueOffset); }
+
+    /// getSmallConstant - The value of a Constant location.
+    int32_t getSmallConstant() const {
+      assert(getKind() == ConstantLocation && "Not a small constant");
+      return read<int32_t>(P + ValueOffset);
+    }
+
+    /// getConstantIndex - The pool index of a ConstantIndex location.
+    unsigned getConstantIndex() const {
+      assert(getKind() == ConstantIndexLocation && "Not a constant index");
+      return read<uint32_t>(P + ValueOffset);
+    }
+
+  private:
+    static const unsigned KindOffset = 0;
+    static const unsigned SizeOffset = KindOffset + sizeof(uint8_t);
+    static const unsigned DwarfRegNumOffset = SizeOffset + sizeof(uint8_t);
+    static const unsigned ValueOffset = DwarfRegNumOffset + sizeof(uint16_t);
+
+    const uint8_t *P;
+  };
+
+  /// RecordAccessor - The record of one stackmap or patchpoint call.
+  class RecordAccessor {
+  public:
+    explicit RecordAccessor(const uint8_t *P) : P(P) {}
+
+    /// getID - The ID the call was given, or ~0U if the backend could not
+    /// describe it; such records have no locations.
+    uint32_t getID() const { return read<uint32_t>(P + IDOffset); }
+
+    /// getInstructionOffset - The offset of the call from the start of the
+    /// function that contains it.
+    uint32_t getInstructionOffset() const {
+      return read<uint32_t>(P + InstructionOffsetOffset);
+    }
+
+    uint16_t getFlags() const { return read<uint16_t>(P + FlagsOffset); }
+
+    unsigned getNumLocations() const {
+      return read<uint16_t>(P + NumLocationsOffset);
+    }
+
+    LocationAccessor getLocation(unsigned LocationIndex) const {
+      assert(LocationIndex < getNumLocations() && "Location out of range");
+      return LocationAccessor(P + LocationListOffset +
+                              LocationIndex * LocationSize);
+    }
+
+    /// getSizeInBytes - The size of the record with its locations.
+    unsigned getSizeInBytes() const {
+      return LocationListOffset + getNumLocations() * LocationSize;
+    }
+
+  private:
+    static const unsigned IDOffset = 0;
+    static const unsigned InstructionOffsetOffset = IDOffset + sizeof(uint32_t);
+    static const unsigned FlagsOffset =
+      InstructionOffsetOffset + sizeof(uint32_t);
+    static const unsigned NumLocationsOffset = FlagsOffset + sizeof(uint16_t);
+    static const unsigned LocationListOffset =
+      NumLocationsOffset + sizeof(uint16_t);
+
+    const uint8_t *P;
+  };
+
+  /// Parse the header of \p StackMapSection and find where its records
+  /// start.  Use isValid to find out whether the section was complete.
+  explicit StackMapParser(ArrayRef<uint8_t> StackMapSection)
+      : StackMapSection(StackMapSection), NumConstants(0), Valid(false) {
+    if (StackMapSection.size() < ConstantsListOffset)
+      return;
+    NumConstants = read<uint32_t>(StackMapSection.data() + NumConstantsOffset);
+
+    uint64_t Offset =
+      ConstantsListOffset + uint64_t(NumConstants) * ConstantSize;
+    if (Offset + sizeof(uint32_t) > StackMapSection.size())
+      return;
+    unsigned NumRecords = read<uint32_t>(StackMapSection.data() + Offset);
+    Offset += sizeof(uint32_t);
+
+    // Records vary in size, so remember where each starts to give random
+    // access to them.
+    RecordOffsets.reserve(NumRecords);
+    for (unsigned I = 0; I != NumRecords; ++I) {
+      if (Offset + RecordHeaderSize > StackMapSection.size())
+        return;
+      RecordAccessor R(StackMapSection.data() + Offset);
+      if (Offset + R.getSizeInBytes() > StackMapSection.size())
+        return;
+      RecordOffsets.push_back(unsigned(Offset));
+      Offset += R.getSizeInBytes();
+    }
+    Valid = true;
+  }
+
+  /// isValid - Return true if the whole section could be read.  Only the
+  /// records before the point where it was cut short are available if not.
+  bool isValid() const { return Valid; }
+
+  unsigned getNumConstants() const { return NumConstants; }
+
+  ConstantAccessor getConstant(unsigned ConstantIndex) const {
+    assert(ConstantIndex < NumConstants && "Constant out of range");
+    return ConstantAccessor(StackMapSection.data() + ConstantsListOffset +
+                            ConstantIndex * ConstantSize);
+  }
+
+  unsigned getNumRecords() const { return RecordOffsets.size(); }
+
+  RecordAccessor getRecord(unsigned RecordIndex) const {
+    assert(RecordIndex < RecordOffsets.size() && "Record out of range");
+    return RecordAccessor(StackMapSection.data() + RecordOffsets[RecordIndex]);
+  }
+
+  /// getConstantValue - Return the value of a Constant or ConstantIndex
+  /// location, looking the latter up in the pool.
+  int64_t getConstantValue(const LocationAccessor &Loc) const {
+    if (Loc.getKind() == ConstantLocation)
+      return Loc.getSmallConstant();
+    return getConstant(Loc.getConstantIndex()).getValue();
+  }
+
+private:
+  template <typename T>
+  static T read(const uint8_t *P) {
+    return support::endian::read<T, Endianness, support::unaligned>(P);
+  }
+
+  static const unsigned NumConstantsOffset = sizeof(uint32_t);
+  static const unsigned ConstantsListOffset =
+    NumConstantsOffset + sizeof(uint32_t);
+  static const unsigned ConstantSize = sizeof(uint64_t);
+  static const unsigned RecordHeaderSize = 3 * sizeof(uint32_t);
+  static const unsigned LocationSize = 2 * sizeof(uint32_t);
+
+  ArrayRef<uint8_t> StackMapSection;
+  unsigned NumConstants;
+  std::vector<unsigned> RecordOffsets;
+  bool Valid;
+};
+
+} // End llvm namespace
+
+#endif
@@ -302,6 +302,15 @@ public:
   ///
   virtual bool runOnFunction(Function &F) = 0;
 
+  /// isFunctionLocal - Return true if runOnFunction only reads and writes
+  /// state owned by the function it is run on and by the pass itself.  Such
+  /// a pass must not create constants, types or metadata, modify globals or
+  /// other functions, or use analyses other than the function passes it
+  /// requires.  The pass manager may run function-local passes on several
+  /// functions concurrently, using a separate instance of the pass (created
+  /// with its default constructor) on each thread.
+  virtual bool isFunctionLocal() const { return false; }
+
   virtual void assignPassManager(PMStack &PMS,
                                  PassManagerType T);
 
@@ -19,6 +19,7 @@
 #ifndef LLVM_PASSANALYSISSUPPORT_H
 #define LLVM_PASSANALYSISSUPPORT_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Pass.h"
@@ -129,24 +130,15 @@ public:
 
   // Find pass that is implementing PI.
   Pass *findImplPass(AnalysisID PI) {
-    Pass *ResultPass = 0;
-    for (unsigned i = 0; i < AnalysisImpls.size() ; ++i) {
-      if (AnalysisImpls[i].first == PI) {
-        ResultPass = AnalysisImpls[i].second;
-        break;
-      }
-    }
-    return ResultPass;
+    return AnalysisImpls.lookup(PI);
   }
 
   // Find pass that is implementing PI. Initialize pass for Function F.
   Pass *findImplPass(Pass *P, AnalysisID PI, Function &F);
 
   void addAnalysisImplsPair(AnalysisID PI, Pass *P) {
-    if (findImplPass(PI) == P)
-      return;
-    std::pair<AnalysisID, Pass*> pir = std::make_pair(PI,P);
-    AnalysisImpls.push_back(pir);
+    // The first pass recorded for PI is the one getAnalysis() returns.
+    AnalysisImpls.insert(std::make_pair(PI, P));
   }
 
   /// clearAnalysisImpls - Clear cache that is used to connect a pass to the
@@ -161,7 +153,7 @@ public:
 private:
   // AnalysisImpls - This keeps track of which passes implements the interfaces
   // that are required by the current pass (to implement getAnalysis()).
-  std::vector<std::pair<AnalysisID, Pass*> > AnalysisImpls;
+  DenseMap<AnalysisID, Pass*> AnalysisImpls;
 
   // PassManager that is used to resolve analysis info
   PMDataManager &PM;
@@ -205,9 +197,7 @@ template<typename AnalysisType>
 AnalysisType &Pass::getAnalysisID(AnalysisID PI) const {
   assert(PI && "getAnalysis for unregistered pass!");
   assert(Resolver&&"Pass has not been inserted into a PassManager object!");
-  // PI *must* appear in AnalysisImpls.  Because the number of passes used
-  // should be a small number, we just do a linear search over a (dense)
-  // vector.
+  // PI *must* appear in AnalysisImpls.
   Pass *ResultPass = Resolver->findImplPass(PI);
   assert (ResultPass && 
           "getAnalysis*() called on an analysis that was not "
@@ -235,9 +225,7 @@ template<typename AnalysisType>
 AnalysisType &Pass::getAnalysisID(AnalysisID PI, Function &F) {
   assert(PI && "getAnalysis for unregistered pass!");
   assert(Resolver && "Pass has not been inserted into a PassManager object!");
-  // PI *must* appear in AnalysisImpls.  Because the number of passes used
-  // should be a small number, we just do a linear search over a (dense)
-  // vector.
+  // PI *must* appear in AnalysisImpls.
   Pass *ResultPass = Resolver->findImplPass(this, PI, F);
   assert(ResultPass && "Unable to find requested analysis info");
   
@@ -35,9 +35,13 @@ struct PassRegistrationListener;
 class PassRegistry {
   mutable void *pImpl;
   void *getImpl() const;
+
+  /// Frozen - Set once freeze() has been called.  Lookups in a frozen
+  /// registry do not take the lock.
+  bool Frozen;
    
 public:
-  PassRegistry() : pImpl(0) { }
+  PassRegistry() : pImpl(0), Frozen(false) { }
   ~PassRegistry();
   
   /// getPassRegistry - Access the global registry object, which is 
@@ -53,6 +57,16 @@ public:
   /// argument string.
   const PassInfo *getPassInfo(StringRef Arg) const;
   
+  /// freeze - Declare that no more passes or analysis groups will be
+  /// registered or unregistered.  getPassInfo() does not take the registry's
+  /// lock from then on, so threads that set up pass managers concurrently do
+  /// not contend on it.  Changing the registry after it is frozen is an
+  /// error.
+  void freeze();
+
+  /// isFrozen - Return true if freeze() has been called.
+  bool isFrozen() const { return Frozen; }
+
   /// registerPass - Register a pass (by means of its PassInfo) with the 
   /// registry.  Required in order to use the pass with a PassManager.
   void registerPass(const PassInfo &PI, bool ShouldFree = false);
@@ -41,6 +41,12 @@ namespace cl {
 //===----------------------------------------------------------------------===//
 // ParseCommandLineOptions - Command line option processing entry point.
 //
+// Parsing writes the values of all options, and must be finished before any
+// other thread reads them.  After that, option values are only read, so any
+// number of threads may read them without locking, until options are parsed
+// or set again.  Settings that differ from one compile to the next belong in
+// TargetOptions or the TargetMachine instead.
+//
 void ParseCommandLineOptions(int argc, const char * const *argv,
                              const char *Overview = 0);
 
@@ -222,16 +228,24 @@ public:
   //-------------------------------------------------------------------------===
   // Accessor functions set by OptionModifiers
   //
-  void setArgStr(const char *S) { ArgStr = S; }
+  // The parser indexes options by name and by the flags that make them
+  // positional, sink or consume-after options, so changing those marks the
+  // option list as changed.
+  //
+  void setArgStr(const char *S) { ArgStr = S; MarkOptionsChanged(); }
   void setDescription(const char *S) { HelpStr = S; }
   void setValueStr(const char *S) { ValueStr = S; }
   void setNumOccurrencesFlag(enum NumOccurrencesFlag Val) {
     Occurrences = Val;
+    MarkOptionsChanged();
   }
   void setValueExpectedFlag(enum ValueExpected Val) { Value = Val; }
   void setHiddenFlag(enum OptionHidden Val) { HiddenFlag = Val; }
-  void setFormattingFlag(enum FormattingFlags V) { Formatting = V; }
-  void setMiscFlag(enum MiscFlags M) { Misc |= M; }
+  void setFormattingFlag(enum FormattingFlags V) {
+    Formatting = V;
+    MarkOptionsChanged();
+  }
+  void setMiscFlag(enum MiscFlags M) { Misc |= M; MarkOptionsChanged(); }
   void setPosition(unsigned pos) { Position = pos; }
   void setCategory(OptionCategory &C) { Category = &C; }
 protected:
@@ -688,6 +688,15 @@ public:
     priv ///< May modify via data, but changes are lost on destruction.
   };
 
+  /// How the mapping is going to be accessed; see advise().
+  enum advice {
+    advise_normal,     ///< No particular pattern.
+    advise_sequential, ///< Mostly in order: read ahead aggressively.
+    advise_random,     ///< In no particular order: do not read ahead.
+    advise_willneed,   ///< Soon: start reading it in now.
+    advise_hugepage    ///< Back it with huge pages where possible.
+  };
+
 private:
   /// Platform specific mapping state.
   mapmode Mode;
@@ -749,6 +758,11 @@ public:
   /// behavior.
   const char *const_data() const;
 
+  /// Tell the OS how the \a length bytes at \a offset in the mapping are
+  /// going to be accessed, or the whole mapping if \a length is 0.  This is
+  /// only a hint, which may be ignored.
+  error_code advise(advice a, uint64_t offset = 0, uint64_t length = 0);
+
   /// \returns The minimum alignment offset must be.
   static int alignment();
 };
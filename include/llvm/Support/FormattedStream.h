@@ -57,6 +57,10 @@ private:
   ///
   const char *Scanned;
 
+  /// TrackPosition - Whether Position is kept up to date as data is written.
+  ///
+  bool TrackPosition;
+
   virtual void write_impl(const char *Ptr, size_t Size) LLVM_OVERRIDE;
 
   /// current_pos - Return the current position within the stream,
@@ -85,11 +89,13 @@ public:
   /// underneath it.
   ///
   formatted_raw_ostream(raw_ostream &Stream, bool Delete = false) 
-    : raw_ostream(), TheStream(0), DeleteStream(false), Position(0, 0) {
+    : raw_ostream(), TheStream(0), DeleteStream(false), Position(0, 0),
+      TrackPosition(true) {
     setStream(Stream, Delete);
   }
   explicit formatted_raw_ostream()
-    : raw_ostream(), TheStream(0), DeleteStream(false), Position(0, 0) {
+    : raw_ostream(), TheStream(0), DeleteStream(false), Position(0, 0),
+      TrackPosition(true) {
     Scanned = 0;
   }
 
@@ -124,6 +130,22 @@ public:
   /// \param NewCol - The column to move to.
   formatted_raw_ostream &PadToColumn(unsigned NewCol);
 
+  /// setPositionTracking - Stop or restart keeping track of the line and
+  /// column, which otherwise costs a scan of every character written.
+  /// Text written while tracking is off isn't counted, so getLine() falls
+  /// behind and getColumn() is only right again after the next newline.
+  void setPositionTracking(bool Track) {
+    if (Track == TrackPosition)
+      return;
+    flush();
+    TrackPosition = Track;
+    Scanned = 0;
+  }
+
+  /// isTrackingPosition - Return true if the line and column are kept up to
+  /// date.
+  bool isTrackingPosition() const { return TrackPosition; }
+
   /// getColumn - Return the column number
   unsigned getColumn() { return Position.first; }
 
@@ -151,6 +173,11 @@ public:
     return TheStream->is_displayed();
   }
 
+  void reserveExtraSpace(uint64_t ExtraSize) {
+    flush();
+    TheStream->reserveExtraSpace(ExtraSize);
+  }
+
 private:
   void releaseStream() {
     // Delete the stream if needed. Otherwise, transfer the buffer
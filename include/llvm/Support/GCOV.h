@@ -245,13 +245,23 @@ private:
 typedef DenseMap<uint32_t, uint64_t> LineCounts;
 class FileInfo {
 public:
+  FileInfo() : RunCount(0), ProgramCount(0) {}
   void addLineCount(StringRef Filename, uint32_t Line, uint64_t Count) {
     LineInfo[Filename][Line-1] += Count;
   }
   void setRunCount(uint32_t Runs) { RunCount = Runs; }
   void setProgramCount(uint32_t Programs) { ProgramCount = Programs; }
+  /// merge - Add the line counts of Other to this one, so that a source file
+  /// shared by several translation units, such as a header, gets one set of
+  /// counts.  The run and program counts become the larger of the two.
+  void merge(const FileInfo &Other);
   void print(raw_fd_ostream &OS, StringRef gcnoFile, StringRef gcdaFile) const;
+  /// printSummary - Print the line counts of every source file in the lcov
+  /// tracefile format, one record per file.
+  void printSummary(raw_ostream &OS) const;
 private:
+  void getSortedFilenames(SmallVectorImpl<StringRef> &Filenames) const;
+
   StringMap<LineCounts> LineInfo;
   uint32_t RunCount;
   uint32_t ProgramCount;
@@ -62,27 +62,67 @@ public:
     return "Unknown buffer";
   }
 
+  /// AccessPattern - How the contents of a buffer are going to be read.
+  enum AccessPattern {
+    AP_Normal,     ///< No particular pattern.
+    AP_Sequential, ///< Mostly from start to end, once.
+    AP_Random,     ///< In no particular order.
+    AP_WillNeed    ///< Soon; start reading the file in now.
+  };
+
+  /// adviseAccess - Tell the OS how Range, a part of the buffer (or all of it
+  /// if empty), is going to be read, so that it can schedule the reads from
+  /// disk.  This only has an effect on buffers that map a file.
+  virtual void adviseAccess(AccessPattern AP,
+                            StringRef Range = StringRef()) const {}
+
+  /// OpenOptions - Hints for getFile and friends about how the file is going
+  /// to be read.  They cost nothing for files that end up being read into
+  /// memory rather than mapped.
+  struct OpenOptions {
+    /// The access pattern to advise for the whole buffer.
+    AccessPattern Access;
+    /// Start reading the whole file in the background right away.
+    bool Prefetch;
+    /// Fault the whole file in before returning, so that reading the buffer
+    /// never blocks on the disk.
+    bool Populate;
+    /// Back the mapping with huge pages where the OS supports that for files.
+    bool HugePages;
+    /// Map files of at least this many bytes instead of reading them into
+    /// memory.  Zero selects the default of four pages.
+    uint64_t MinMapSize;
+
+    OpenOptions()
+        : Access(AP_Normal), Prefetch(false), Populate(false), HugePages(false),
+          MinMapSize(0) {}
+  };
+
   /// getFile - Open the specified file as a MemoryBuffer, returning a new
   /// MemoryBuffer if successful, otherwise returning null.  If FileSize is
   /// specified, this means that the client knows that the file exists and that
   /// it has the specified size.
   static error_code getFile(Twine Filename, OwningPtr<MemoryBuffer> &result,
                             int64_t FileSize = -1,
-                            bool RequiresNullTerminator = true);
+                            bool RequiresNullTerminator = true,
+                            const OpenOptions &Options = OpenOptions());
 
   /// Given an already-open file descriptor, map some slice of it into a
   /// MemoryBuffer. The slice is specified by an \p Offset and \p MapSize.
   /// Since this is in the middle of a file, the buffer is not null terminated.
   static error_code getOpenFileSlice(int FD, const char *Filename,
                                      OwningPtr<MemoryBuffer> &Result,
-                                     uint64_t MapSize, int64_t Offset);
+                                     uint64_t MapSize, int64_t Offset,
+                                     const OpenOptions &Options =
+                                         OpenOptions());
 
   /// Given an already-open file descriptor, read the file and return a
   /// MemoryBuffer.
   static error_code getOpenFile(int FD, const char *Filename,
                                 OwningPtr<MemoryBuffer> &Result,
                                 uint64_t FileSize,
-                                bool RequiresNullTerminator = true);
+                                bool RequiresNullTerminator = true,
+                                const OpenOptions &Options = OpenOptions());
 
   /// getMemBuffer - Open the specified memory range as a MemoryBuffer.  Note
   /// that InputData must be null terminated if RequiresNullTerminator is true.
@@ -119,7 +159,8 @@ public:
   /// ec.
   static error_code getFileOrSTDIN(StringRef Filename,
                                    OwningPtr<MemoryBuffer> &result,
-                                   int64_t FileSize = -1);
+                                   int64_t FileSize = -1,
+                                   const OpenOptions &Options = OpenOptions());
 
   //===--------------------------------------------------------------------===//
   // Provided for performance analysis.
@@ -0,0 +1,245 @@
+//===-- llvm/Support/Parallel.h - Parallel algorithms -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines parallel versions of a few standard algorithms, running
+// on the default ThreadPool.  They split their range into chunks of roughly
+// equal size, a few per worker so that idle workers can steal the remaining
+// ones, and run the plain serial algorithm when the pool has no workers or
+// the range is too small to be worth splitting.
+//
+// The callbacks may run concurrently on several threads and must not depend
+// on the order in which the elements are visited.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_PARALLEL_H
+#define LLVM_SUPPORT_PARALLEL_H
+
+#include "llvm/Support/ThreadPool.h"
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+namespace llvm {
+
+namespace parallel_detail {
+/// Ranges shorter than this run serially.
+const size_t MinParallelSize = 1024;
+
+/// getNumChunks - Return the number of chunks to split N elements into.
+inline size_t getNumChunks(ThreadPool &Pool, size_t N, size_t MinChunkSize) {
+  size_t NumThreads = Pool.getThreadCount();
+  if (NumThreads == 0 || N < MinChunkSize * 2)
+    return 1;
+  return std::min(NumThreads * 4, N / MinChunkSize);
+}
+
+/// getChunkBegin - Return the offset of chunk I when N elements are split
+/// into NumChunks chunks.
+inline size_t getChunkBegin(size_t N, size_t NumChunks, size_t I) {
+  return N / NumChunks * I + std::min(I, N % NumChunks);
+}
+
+template <class IndexT, class FuncT> struct ForChunk {
+  FuncT *Fn;
+  IndexT Begin, End;
+
+  static void run(void *Arg) {
+    ForChunk *C = static_cast<ForChunk *>(Arg);
+    for (IndexT I = C->Begin; I != C->End; ++I)
+      (*C->Fn)(I);
+  }
+};
+
+template <class IterT, class FuncT> struct ForEachChunk {
+  FuncT *Fn;
+  IterT Begin, End;
+
+  static void run(void *Arg) {
+    ForEachChunk *C = static_cast<ForEachChunk *>(Arg);
+    for (IterT I = C->Begin; I != C->End; ++I)
+      (*C->Fn)(*I);
+  }
+};
+
+template <class IterT, class CompareT> struct SortChunk {
+  CompareT *Comp;
+  IterT Begin, Middle, End;
+
+  static void sort(void *Arg) {
+    SortChunk *C = static_cast<SortChunk *>(Arg);
+    std::sort(C->Begin, C->End, *C->Comp);
+  }
+
+  static void merge(void *Arg) {
+    SortChunk *C = static_cast<SortChunk *>(Arg);
+    std::inplace_merge(C->Begin, C->Middle, C->End, *C->Comp);
+  }
+};
+
+template <class IterT, class T, class ReduceFuncT, class TransformFuncT>
+struct ReduceChunk {
+  ReduceFuncT *Reduce;
+  TransformFuncT *Transform;
+  IterT Begin, End;
+  T *Result;
+
+  static void run(void *Arg) {
+    ReduceChunk *C = static_cast<ReduceChunk *>(Arg);
+    IterT I = C->Begin;
+    T Acc = (*C->Transform)(*I);
+    for (++I; I != C->End; ++I)
+      Acc = (*C->Reduce)(Acc, (*C->Transform)(*I));
+    *C->Result = Acc;
+  }
+};
+} // end namespace parallel_detail
+
+/// parallel_for - Call Fn(I) for every I in [Begin, End).
+template <class IndexT, class FuncT>
+void parallel_for(IndexT Begin, IndexT End, FuncT Fn) {
+  using namespace parallel_detail;
+  ThreadPool &Pool = ThreadPool::getDefault();
+  size_t N = End - Begin;
+  size_t NumChunks = getNumChunks(Pool, N, 1);
+  if (NumChunks == 1) {
+    for (IndexT I = Begin; I != End; ++I)
+      Fn(I);
+    return;
+  }
+
+  std::vector<ForChunk<IndexT, FuncT> > Chunks(NumChunks);
+  TaskGroup Group(Pool);
+  for (size_t i = 0; i != NumChunks; ++i) {
+    Chunks[i].Fn = &Fn;
+    Chunks[i].Begin = Begin + getChunkBegin(N, NumChunks, i);
+    Chunks[i].End = Begin + getChunkBegin(N, NumChunks, i + 1);
+    Group.spawn(ForChunk<IndexT, FuncT>::run, &Chunks[i]);
+  }
+  Group.wait();
+}
+
+/// parallel_for_each - Call Fn(*I) for every I in the random access range
+/// [Begin, End).
+template <class IterT, class FuncT>
+void parallel_for_each(IterT Begin, IterT End, FuncT Fn) {
+  using namespace parallel_detail;
+  ThreadPool &Pool = ThreadPool::getDefault();
+  size_t N = std::distance(Begin, End);
+  size_t NumChunks = getNumChunks(Pool, N, 1);
+  if (NumChunks == 1) {
+    std::for_each(Begin, End, Fn);
+    return;
+  }
+
+  std::vector<ForEachChunk<IterT, FuncT> > Chunks(NumChunks);
+  TaskGroup Group(Pool);
+  for (size_t i = 0; i != NumChunks; ++i) {
+    Chunks[i].Fn = &Fn;
+    Chunks[i].Begin = Begin + getChunkBegin(N, NumChunks, i);
+    Chunks[i].End = Begin + getChunkBegin(N, NumChunks, i + 1);
+    Group.spawn(ForEachChunk<IterT, FuncT>::run, &Chunks[i]);
+  }
+  Group.wait();
+}
+
+/// parallel_sort - Sort the random access range [Begin, End) with Comp.  As
+/// with std::sort, the order of equivalent elements is unspecified.
+template <class IterT, class CompareT>
+void parallel_sort(IterT Begin, IterT End, CompareT Comp) {
+  using namespace parallel_detail;
+  typedef SortChunk<IterT, CompareT> ChunkT;
+  ThreadPool &Pool = ThreadPool::getDefault();
+  size_t N = std::distance(Begin, End);
+  size_t NumChunks = getNumChunks(Pool, N, MinParallelSize);
+  if (NumChunks == 1) {
+    std::sort(Begin, End, Comp);
+    return;
+  }
+
+  // Sort the chunks independently...
+  std::vector<IterT> Bounds;
+  for (size_t i = 0; i <= NumChunks; ++i)
+    Bounds.push_back(Begin + getChunkBegin(N, NumChunks, i));
+  std::vector<ChunkT> Chunks(NumChunks);
+  {
+    TaskGroup Group(Pool);
+    for (size_t i = 0; i != NumChunks; ++i) {
+      Chunks[i].Comp = &Comp;
+      Chunks[i].Begin = Bounds[i];
+      Chunks[i].End = Bounds[i + 1];
+      Group.spawn(ChunkT::sort, &Chunks[i]);
+    }
+  }
+
+  // ...then merge neighbouring runs pairwise until one is left.
+  for (size_t Width = 1; Width < NumChunks; Width *= 2) {
+    TaskGroup Group(Pool);
+    Chunks.clear();
+    for (size_t i = 0; i + Width < NumChunks; i += 2 * Width) {
+      ChunkT C;
+      C.Comp = &Comp;
+      C.Begin = Bounds[i];
+      C.Middle = Bounds[i + Width];
+      C.End = Bounds[std::min(i + 2 * Width, NumChunks)];
+      Chunks.push_back(C);
+    }
+    for (size_t i = 0, e = Chunks.size(); i != e; ++i)
+      Group.spawn(ChunkT::merge, &Chunks[i]);
+  }
+}
+
+/// parallel_sort - Sort the random access range [Begin, End) with
+/// operator<.
+template <class IterT> void parallel_sort(IterT Begin, IterT End) {
+  parallel_sort(Begin, End,
+                std::less<typename std::iterator_traits<IterT>::value_type>());
+}
+
+/// parallel_transform_reduce - Return Init combined with Transform(*I) for
+/// every I in the random access range [Begin, End), using Reduce to combine
+/// two values.  Reduce must be associative; the values are combined in
+/// order, so it need not be commutative.
+template <class IterT, class T, class ReduceFuncT, class TransformFuncT>
+T parallel_transform_reduce(IterT Begin, IterT End, T Init, ReduceFuncT Reduce,
+                            TransformFuncT Transform) {
+  using namespace parallel_detail;
+  typedef ReduceChunk<IterT, T, ReduceFuncT, TransformFuncT> ChunkT;
+  ThreadPool &Pool = ThreadPool::getDefault();
+  size_t N = std::distance(Begin, End);
+  size_t NumChunks = getNumChunks(Pool, N, MinParallelSize);
+  if (NumChunks == 1) {
+    for (IterT I = Begin; I != End; ++I)
+      Init = Reduce(Init, Transform(*I));
+    return Init;
+  }
+
+  std::vector<T> Results(NumChunks, Init);
+  std::vector<ChunkT> Chunks(NumChunks);
+  {
+    TaskGroup Group(Pool);
+    for (size_t i = 0; i != NumChunks; ++i) {
+      Chunks[i].Reduce = &Reduce;
+      Chunks[i].Transform = &Transform;
+      Chunks[i].Begin = Begin + getChunkBegin(N, NumChunks, i);
+      Chunks[i].End = Begin + getChunkBegin(N, NumChunks, i + 1);
+      Chunks[i].Result = &Results[i];
+      Group.spawn(ChunkT::run, &Chunks[i]);
+    }
+  }
+
+  for (size_t i = 0; i != NumChunks; ++i)
+    Init = Reduce(Init, Results[i]);
+  return Init;
+}
+
+} // end namespace llvm
+
+#endif
@@ -43,7 +43,13 @@ namespace llvm {
       BasicBlock **&Entry = BlockToPredsMap[BB];
       if (Entry) return Entry;
 
-      SmallVector<BasicBlock*, 32> PredCache(pred_begin(BB), pred_end(BB));
+      SmallVector<BasicBlock*, 32> PredCache;
+      if (BB->maintainsPredecessors()) {
+        ArrayRef<BasicBlock*> Preds = BB->getMaintainedPredecessors();
+        PredCache.append(Preds.begin(), Preds.end());
+      } else {
+        PredCache.append(pred_begin(BB), pred_end(BB));
+      }
       PredCache.push_back(0); // null terminator.
       
       BlockToPredCountMap[BB] = PredCache.size()-1;
@@ -150,6 +150,10 @@ public:
   /// allocated space.
   static size_t GetMallocUsage();
 
+  /// \brief Return the peak resident set size of the process, in bytes, or 0
+  /// if the operating system does not report it.
+  static size_t GetPeakMemoryUsage();
+
   /// This static function will set \p user_time to the amount of CPU time
   /// spent in user (non-kernel) mode and \p sys_time to the amount of CPU
   /// time spent in system (kernel) mode.  If the operating system does not
@@ -161,6 +165,13 @@ public:
   static void GetTimeUsage(TimeValue &elapsed, TimeValue &user_time,
                            TimeValue &sys_time);
 
+  /// This static function returns the time elapsed since an arbitrary point
+  /// in the past, read from a clock that is not affected by changes to the
+  /// system time.  It is much cheaper to call than GetTimeUsage, and is meant
+  /// for measuring short intervals.  If the operating system has no such
+  /// clock, TimeValue::now() is returned instead.
+  static TimeValue GetMonotonicTime();
+
   /// This function makes the necessary calls to the operating system to
   /// prevent core files or any other kind of large memory dumps that can
   /// occur when a program fails.
@@ -52,6 +52,11 @@ private:
     /// IncludeLoc - This is the location of the parent include, or null if at
     /// the top level.
     SMLoc IncludeLoc;
+
+    /// LineOffsets - The offsets of the newlines in the buffer, in increasing
+    /// order.  This is built the first time a line number in the buffer is
+    /// looked up, and is null until then.
+    mutable std::vector<size_t> *LineOffsets;
   };
 
   /// Buffers - This is all of the buffers that we are reading from.
@@ -61,17 +66,13 @@ private:
   // include files in.
   std::vector<std::string> IncludeDirectories;
 
-  /// LineNoCache - This is a cache for line number queries, its implementation
-  /// is really private to SourceMgr.cpp.
-  mutable void *LineNoCache;
-
   DiagHandlerTy DiagHandler;
   void *DiagContext;
 
   SourceMgr(const SourceMgr&) LLVM_DELETED_FUNCTION;
   void operator=(const SourceMgr&) LLVM_DELETED_FUNCTION;
 public:
-  SourceMgr() : LineNoCache(0), DiagHandler(0), DiagContext(0) {}
+  SourceMgr() : DiagHandler(0), DiagContext(0) {}
   ~SourceMgr();
 
   void setIncludeDirs(const std::vector<std::string> &Dirs) {
@@ -113,6 +114,7 @@ public:
     SrcBuffer NB;
     NB.Buffer = F;
     NB.IncludeLoc = IncludeLoc;
+    NB.LineOffsets = 0;
     Buffers.push_back(NB);
     return Buffers.size() - 1;
   }
@@ -129,13 +131,14 @@ public:
   int FindBufferContainingLoc(SMLoc Loc) const;
 
   /// FindLineNumber - Find the line number for the specified location in the
-  /// specified file.  This is not a fast method.
+  /// specified file.
   unsigned FindLineNumber(SMLoc Loc, int BufferID = -1) const {
     return getLineAndColumn(Loc, BufferID).first;
   }
 
   /// getLineAndColumn - Find the line and column number for the specified
-  /// location in the specified file.  This is not a fast method.
+  /// location in the specified file.  The first lookup in a buffer indexes
+  /// its lines; later lookups in it take logarithmic time.
   std::pair<unsigned, unsigned>
     getLineAndColumn(SMLoc Loc, int BufferID = -1) const;
 
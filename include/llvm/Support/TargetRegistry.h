@@ -484,6 +484,10 @@ namespace llvm {
   };
 
   /// TargetRegistry - Generic interface to target specific features.
+  ///
+  /// Once all targets have been initialized the registry doesn't change, and
+  /// lookups and iteration only read it, so any number of threads may use
+  /// them at once without a lock.
   struct TargetRegistry {
     class iterator {
       const Target *Current;
@@ -572,7 +576,9 @@ namespace llvm {
     ///
     /// Clients are responsible for ensuring that registration doesn't occur
     /// while another thread is attempting to access the registry. Typically
-    /// this is done by initializing all targets at program startup.
+    /// this is done by initializing all targets at program startup.  A target
+    /// is only added to the registry after its fields are set, so a lookup
+    /// never sees a partly registered target.
     ///
     /// @param T - The target being registered.
     /// @param Name - The target name. This should be a static string.
@@ -0,0 +1,102 @@
+//===-- llvm/Support/ThreadPool.h - A pool of worker threads ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a pool of worker threads that run tasks submitted to it,
+// and TaskGroup, which waits for a subset of those tasks.
+//
+// Every worker keeps its own queue of tasks.  Tasks spawned from a worker go
+// to the front of that worker's queue and are run by it in LIFO order, which
+// keeps recursive work on the thread whose caches hold its data; idle workers
+// steal the oldest task from the other queues.  Threads that wait for tasks
+// help running them, so waiting from inside a task does not tie up a worker.
+//
+// When LLVM is built without thread support, or no thread could be started,
+// the pool has no workers and every task is run by the thread waiting for it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_THREADPOOL_H
+#define LLVM_SUPPORT_THREADPOOL_H
+
+#include "llvm/Support/Compiler.h"
+
+namespace llvm {
+
+class TaskGroup;
+
+/// ThreadPool - A set of worker threads running the tasks submitted to them.
+class ThreadPool {
+public:
+  typedef void (*TaskFn)(void *);
+
+  /// Start \p NumThreads workers, or one per hardware thread if
+  /// \p NumThreads is zero.
+  explicit ThreadPool(unsigned NumThreads = 0);
+
+  /// Wait for all the tasks of the pool, then stop its workers.
+  ~ThreadPool();
+
+  /// async - Run Fn(Arg) on one of the workers at some later point.
+  void async(TaskFn Fn, void *Arg);
+
+  /// wait - Run or wait for every task submitted to the pool until the pool
+  /// is empty.
+  void wait();
+
+  /// getThreadCount - Return the number of workers actually started, which
+  /// is zero if threads are unavailable.
+  unsigned getThreadCount() const;
+
+  /// getDefault - Return the pool shared by the parallel algorithms, which
+  /// has one worker per hardware thread.
+  static ThreadPool &getDefault();
+
+  /// getHardwareConcurrency - Return the number of threads the host can run
+  /// at the same time, or one if it cannot be determined.
+  static unsigned getHardwareConcurrency();
+
+  class Impl;
+
+private:
+  friend class TaskGroup;
+  void enqueue(TaskFn Fn, void *Arg, TaskGroup *Group);
+
+  Impl *P;
+
+  ThreadPool(const ThreadPool &) LLVM_DELETED_FUNCTION;
+  void operator=(const ThreadPool &) LLVM_DELETED_FUNCTION;
+};
+
+/// TaskGroup - A set of tasks running on a ThreadPool that can be waited for
+/// together.  The destructor waits for the tasks still pending.
+class TaskGroup {
+public:
+  explicit TaskGroup(ThreadPool &Pool) : Pool(Pool), Pending(0) {}
+  ~TaskGroup() { wait(); }
+
+  /// spawn - Run Fn(Arg) on the pool as part of this group.
+  void spawn(ThreadPool::TaskFn Fn, void *Arg) { Pool.enqueue(Fn, Arg, this); }
+
+  /// wait - Run or wait for the tasks of this group until none is pending.
+  /// Tasks spawned by those tasks into the group are waited for too.
+  void wait();
+
+private:
+  friend class ThreadPool::Impl;
+  ThreadPool &Pool;
+  /// Number of tasks spawned and not finished yet, guarded by the pool lock.
+  unsigned Pending;
+
+  TaskGroup(const TaskGroup &) LLVM_DELETED_FUNCTION;
+  void operator=(const TaskGroup &) LLVM_DELETED_FUNCTION;
+};
+
+} // end namespace llvm
+
+#endif
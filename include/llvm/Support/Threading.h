@@ -54,6 +54,47 @@ namespace llvm {
   /// the thread stack.
   void llvm_execute_on_thread(void (*UserFn)(void*), void *UserData,
                               unsigned RequestedStackSize = 0);
+
+  /// llvm_thread - An opaque handle for a thread started by
+  /// llvm_create_thread.
+  struct llvm_thread;
+
+  /// llvm_create_thread - Start executing the given \p UserFn on a new
+  /// thread, passing it the provided \p UserData, and return without waiting
+  /// for it.  Every thread started this way must eventually be waited for with
+  /// llvm_join_thread.
+  ///
+  /// \param UserFn - The callback to execute.
+  /// \param UserData - An argument to pass to the callback function.
+  /// \param RequestedStackSize - If non-zero, a requested size (in bytes) for
+  /// the thread stack.
+  /// \returns A handle for the new thread, or null if no thread could be
+  /// created (for example, because LLVM was built without thread support), in
+  /// which case \p UserFn has not been called.
+  llvm_thread *llvm_create_thread(void (*UserFn)(void*), void *UserData,
+                                  unsigned RequestedStackSize = 0);
+
+  /// llvm_join_thread - Wait for a thread started by llvm_create_thread to
+  /// complete, and release its handle.
+  void llvm_join_thread(llvm_thread *Thread);
+
+  /// llvm_execute_on_threads - Execute the given \p UserFn once for each of
+  /// the \p NumTasks entries in \p UserData, running the calls concurrently
+  /// on separate threads, and wait for all of them to complete.
+  ///
+  /// As with llvm_execute_on_thread, this function does not guarantee that
+  /// the calls actually run concurrently; where threads are unavailable or
+  /// cannot be created, the remaining calls are executed on the calling
+  /// thread.
+  ///
+  /// \param UserFn - The callback to execute.
+  /// \param UserData - The arguments to pass to each invocation of \p UserFn.
+  /// \param NumTasks - The number of entries in \p UserData.
+  /// \param RequestedStackSize - If non-zero, a requested size (in bytes) for
+  /// each thread stack.
+  void llvm_execute_on_threads(void (*UserFn)(void*), void *const *UserData,
+                               unsigned NumTasks,
+                               unsigned RequestedStackSize = 0);
 }
 
 #endif
@@ -37,6 +37,11 @@ public:
   /// memory usage.  This matters if the time to get the memory usage is
   /// significant and shouldn't be counted as part of a duration.
   static TimeRecord getCurrentTime(bool Start = true);
+
+  /// getCurrentWallTime - Get the current time from a monotonic clock,
+  /// leaving the process times and memory usage at zero.  This is much cheaper
+  /// than getCurrentTime.
+  static TimeRecord getCurrentWallTime();
   
   double getProcessTime() const { return UserTime+SystemTime; }
   double getUserTime() const { return UserTime; }
@@ -158,8 +163,14 @@ struct NamedRegionTimer : public TimeRegion {
 /// destroy a TimerGroup object before all of the Timers in it are gone.  A
 /// TimerGroup can be specified for a newly created timer in its constructor.
 ///
+/// The timers of a group created with WallTimeOnly set only measure elapsed
+/// time, from a monotonic clock, and not the user and system time or memory
+/// usage of the process.  This makes starting and stopping them cheap enough
+/// to time very short regions without distorting the result.
+///
 class TimerGroup {
   std::string Name;
+  bool WallTimeOnly;   // Do the timers only measure wall time?
   Timer *FirstTimer;   // First timer in the group.
   std::vector<std::pair<TimeRecord, std::string> > TimersToPrint;
   
@@ -167,11 +178,13 @@ class TimerGroup {
   TimerGroup(const TimerGroup &TG) LLVM_DELETED_FUNCTION;
   void operator=(const TimerGroup &TG) LLVM_DELETED_FUNCTION;
 public:
-  explicit TimerGroup(StringRef name);
+  explicit TimerGroup(StringRef name, bool WallTimeOnly = false);
   ~TimerGroup();
 
   void setName(StringRef name) { Name.assign(name.begin(), name.end()); }
 
+  bool isWallTimeOnly() const { return WallTimeOnly; }
+
   /// print - Print any started timers in this group and zero them.
   void print(raw_ostream &OS);
   
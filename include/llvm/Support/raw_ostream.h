@@ -131,6 +131,11 @@ public:
       flush_nonempty();
   }
 
+  /// reserveExtraSpace - Tell the stream that about ExtraSize more bytes are
+  /// about to be written, so that it can make room for all of them at once.
+  /// This is only a hint: writing more or fewer bytes is still allowed.
+  virtual void reserveExtraSpace(uint64_t ExtraSize) {}
+
   raw_ostream &operator<<(char C) {
     if (OutBufCur >= OutBufEnd)
       return write(C);
@@ -321,6 +326,26 @@ class raw_fd_ostream : public raw_ostream {
 
   uint64_t pos;
 
+  /// Path - The name of the file, if this stream opened it.
+  std::string Path;
+
+  /// Mapping - While the room made by reserveExtraSpace is being written, a
+  /// mapping of that part of the file, which is used as the stream buffer so
+  /// that the bytes go straight into the file.
+  sys::fs::mapped_file_region *Mapping;
+
+  /// MappedStart - The start of the stream buffer within Mapping.
+  char *MappedStart;
+
+  /// UnmappedBufferSize - The size of the buffer to go back to once Mapping
+  /// is released, or 0 if the stream was unbuffered.
+  size_t UnmappedBufferSize;
+
+  /// AsyncWrite - The state of the background thread writing the output, if
+  /// asynchronous writes are enabled.
+  struct AsyncWrite;
+  AsyncWrite *Async;
+
   /// write_impl - See raw_ostream::write_impl.
   virtual void write_impl(const char *Ptr, size_t Size) LLVM_OVERRIDE;
 
@@ -328,6 +353,14 @@ class raw_fd_ostream : public raw_ostream {
   /// counting the bytes currently in the buffer.
   virtual uint64_t current_pos() const LLVM_OVERRIDE { return pos; }
 
+  /// releaseMapping - Unmap the reserved room, cut the file back to what has
+  /// been written and go back to normal buffering.
+  void releaseMapping();
+
+  /// finishAsyncWrite - Wait for the background write, if one is running,
+  /// and note whether it failed.
+  void finishAsyncWrite();
+
   /// preferred_buffer_size - Determine an efficient buffer size.
   virtual size_t preferred_buffer_size() const LLVM_OVERRIDE;
 
@@ -363,6 +396,10 @@ public:
   /// position to the offset specified from the beginning of the file.
   uint64_t seek(uint64_t off);
 
+  /// reserveExtraSpace - If a large write to a regular file is coming, grow
+  /// the file and write into a mapping of it instead of calling write().
+  virtual void reserveExtraSpace(uint64_t ExtraSize) LLVM_OVERRIDE;
+
   /// SetUseAtomicWrite - Set the stream to attempt to use atomic writes for
   /// individual output routines where possible.
   ///
@@ -373,6 +410,18 @@ public:
     UseAtomicWrites = Value;
   }
 
+  /// SetUseAsyncWrites - Set the stream to hand its output to a background
+  /// thread, which writes one large buffer while the next one is being
+  /// filled.  This is meant for tools producing a lot of output, which would
+  /// otherwise often wait for the file to take it.
+  ///
+  /// The output is written in order, and seek, close and the destructor wait
+  /// for it to be written.  An error is noticed once the stream has waited for
+  /// the write that failed, so has_error() is only reliable after a seek or
+  /// close.  Streams to a terminal are left alone, as are streams in programs
+  /// which cannot start threads.
+  void SetUseAsyncWrites(bool Value);
+
   virtual raw_ostream &changeColor(enum Colors colors, bool bold=false,
                                    bool bg=false) LLVM_OVERRIDE;
   virtual raw_ostream &resetColor() LLVM_OVERRIDE;
@@ -469,6 +518,9 @@ public:
   /// if the raw_svector_ostream has previously been flushed.
   void resync();
 
+  /// reserveExtraSpace - Grow the vector once to hold ExtraSize more bytes.
+  virtual void reserveExtraSpace(uint64_t ExtraSize) LLVM_OVERRIDE;
+
   /// str - Flushes the stream contents to the target vector and return a
   /// StringRef for the vector contents.
   StringRef str();
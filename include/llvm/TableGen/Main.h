@@ -24,6 +24,17 @@ typedef bool TableGenMainFn(raw_ostream &OS, RecordKeeper &Records);
 
 int TableGenMain(char *argv0, TableGenMainFn *MainFn);
 
+/// \brief Perform the Index'th of several actions using Records, and write
+/// output to OS.
+/// \returns true on error, false otherwise
+typedef bool TableGenBackendFn(raw_ostream &OS, RecordKeeper &Records,
+                               unsigned Index);
+
+/// \brief Parse the input once and perform NumBackends actions on it, each
+/// writing to the file given by the matching -o option.
+int TableGenMain(char *argv0, TableGenBackendFn *BackendFn,
+                 unsigned NumBackends);
+
 }
 
 #endif
@@ -1518,9 +1518,17 @@ public:
   }
 
   bool isSubClassOf(StringRef Name) const {
-    for (unsigned i = 0, e = SuperClasses.size(); i != e; ++i)
-      if (SuperClasses[i]->getNameInitAsString() == Name)
+    for (unsigned i = 0, e = SuperClasses.size(); i != e; ++i) {
+      // Class names are nearly always plain strings, which can be compared
+      // without building a copy.
+      Init *SCName = SuperClasses[i]->getNameInit();
+      if (StringInit *SI = dyn_cast<StringInit>(SCName)) {
+        if (SI->getValue() == Name)
+          return true;
+      } else if (SuperClasses[i]->getNameInitAsString() == Name) {
         return true;
+      }
+    }
     return false;
   }
 
@@ -1646,6 +1654,10 @@ struct MultiClass {
 
 class RecordKeeper {
   std::map<std::string, Record*> Classes, Defs;
+  /// DerivedDefinitions - The results of getAllDerivedDefinitions, which
+  /// backends ask for over and over again.  Dropped whenever a class or def
+  /// is added or removed.
+  mutable std::map<std::string, std::vector<Record*> > DerivedDefinitions;
 
 public:
   ~RecordKeeper() {
@@ -1672,11 +1684,13 @@ public:
     bool Ins = Classes.insert(std::make_pair(R->getName(), R)).second;
     (void)Ins;
     assert(Ins && "Class already exists");
+    DerivedDefinitions.clear();
   }
   void addDef(Record *R) {
     bool Ins = Defs.insert(std::make_pair(R->getName(), R)).second;
     (void)Ins;
     assert(Ins && "Record already exists");
+    DerivedDefinitions.clear();
   }
 
   /// removeClass - Remove, but do not delete, the specified record.
@@ -1684,12 +1698,14 @@ public:
   void removeClass(const std::string &Name) {
     assert(Classes.count(Name) && "Class does not exist!");
     Classes.erase(Name);
+    DerivedDefinitions.clear();
   }
   /// removeDef - Remove, but do not delete, the specified record.
   ///
   void removeDef(const std::string &Name) {
     assert(Defs.count(Name) && "Def does not exist!");
     Defs.erase(Name);
+    DerivedDefinitions.clear();
   }
 
   //===--------------------------------------------------------------------===//
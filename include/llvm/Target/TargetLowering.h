@@ -30,6 +30,7 @@
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/CallingConv.h"
 #include "llvm/IR/InlineAsm.h"
+#include "llvm/Support/BranchProbability.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Target/TargetCallingConv.h"
 #include "llvm/Target/TargetMachine.h"
@@ -204,6 +205,14 @@ public:
     return PredictableSelectIsExpensive;
   }
 
+  /// Return the probability above which one side of a branch is taken often
+  /// enough for the branch to be predicted right.  Selects on such conditions
+  /// are better emitted as branches, and such branches should not be
+  /// if-converted.
+  BranchProbability getPredictableBranchThreshold() const {
+    return BranchProbability(PredictableBranchThreshold, 100);
+  }
+
   /// isLoadBitCastBeneficial() - Return true if the following transform
   /// is beneficial.
   /// fold (conv (load x)) -> (load (conv*)x)
@@ -415,6 +424,13 @@ public:
     return false;
   }
 
+  /// Return true if the target can lower an llvm.gather of a DataVT vector
+  /// with IndexVT indices to a single gather instruction.  Gathers the target
+  /// cannot lower are split into scalar loads by CodeGenPrepare.
+  virtual bool isLegalGather(EVT /*DataVT*/, EVT /*IndexVT*/) const {
+    return false;
+  }
+
   /// Return how this operation should be treated: either it is legal, needs to
   /// be promoted to a larger size, needs to be expanded to some other code
   /// sequence, or the target has a custom expander for it.
@@ -932,6 +948,13 @@ protected:
     JumpIsExpensive = isExpensive;
   }
 
+  /// Tells the code generator the percentage above which a branch outcome is
+  /// considered predictable.
+  void setPredictableBranchThreshold(unsigned Percent) {
+    assert(Percent > 50 && Percent <= 100 && "Invalid threshold");
+    PredictableBranchThreshold = Percent;
+  }
+
   /// Tells the code generator that integer divide is expensive, and if
   /// possible, should be replaced by an alternate sequence of instructions not
   /// containing an integer divide.
@@ -1681,6 +1704,9 @@ protected:
   /// the branch is usually predicted right.
   bool PredictableSelectIsExpensive;
 
+  /// The percentage above which a branch outcome is considered predictable.
+  unsigned PredictableBranchThreshold;
+
 protected:
   /// Return true if the value types that can be represented by the specified
   /// register class are all legal.
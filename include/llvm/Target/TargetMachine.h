@@ -29,6 +29,7 @@ class GlobalValue;
 class MCAsmInfo;
 class MCCodeGenInfo;
 class MCContext;
+class MachineFunctionAllocatorPool;
 class Target;
 class DataLayout;
 class TargetLibraryInfo;
@@ -88,6 +89,18 @@ protected: // Can only create subclasses.
   unsigned MCUseCFI : 1;
   unsigned MCUseDwarfDirectory : 1;
 
+  /// AsmVerbosityDefault, FunctionSections, DataSections - Per-machine code
+  /// generation settings, so that threads compiling with different target
+  /// machines don't share them.  The sections flags start out as given by
+  /// -ffunction-sections and -fdata-sections.
+  unsigned AsmVerbosityDefault : 1;
+  unsigned FunctionSections : 1;
+  unsigned DataSections : 1;
+
+  /// MFAllocatorPool - Where the MachineFunctions of the code generators this
+  /// target machine builds get their memory, or null to use malloc.
+  MachineFunctionAllocatorPool *MFAllocatorPool;
+
 public:
   virtual ~TargetMachine();
 
@@ -197,6 +210,20 @@ public:
   /// with explicit directories.
   void setMCUseDwarfDirectory(bool Value) { MCUseDwarfDirectory = Value; }
 
+  /// getMachineFunctionAllocatorPool - Return the pool MachineFunctions take
+  /// their memory from, or null if they use malloc.
+  MachineFunctionAllocatorPool *getMachineFunctionAllocatorPool() const {
+    return MFAllocatorPool;
+  }
+
+  /// setMachineFunctionAllocatorPool - Have the MachineFunctions of code
+  /// generators built from now on take their memory from Pool, so that it is
+  /// reused from one function to the next.  The caller keeps ownership of
+  /// Pool, which must outlive those code generators.
+  void setMachineFunctionAllocatorPool(MachineFunctionAllocatorPool *Pool) {
+    MFAllocatorPool = Pool;
+  }
+
   /// getRelocationModel - Returns the code generation relocation model. The
   /// choices are static, PIC, and dynamic-no-pic, and target default.
   Reloc::Model getRelocationModel() const;
@@ -219,26 +246,26 @@ public:
 
   /// getAsmVerbosityDefault - Returns the default value of asm verbosity.
   ///
-  static bool getAsmVerbosityDefault();
+  bool getAsmVerbosityDefault() const { return AsmVerbosityDefault; }
 
   /// setAsmVerbosityDefault - Set the default value of asm verbosity. Default
   /// is false.
-  static void setAsmVerbosityDefault(bool);
+  void setAsmVerbosityDefault(bool V) { AsmVerbosityDefault = V; }
 
   /// getDataSections - Return true if data objects should be emitted into their
   /// own section, corresponds to -fdata-sections.
-  static bool getDataSections();
+  bool getDataSections() const { return DataSections; }
 
   /// getFunctionSections - Return true if functions should be emitted into
   /// their own section, corresponding to -ffunction-sections.
-  static bool getFunctionSections();
+  bool getFunctionSections() const { return FunctionSections; }
 
   /// setDataSections - Set if the data are emit into separate sections.
-  static void setDataSections(bool);
+  void setDataSections(bool V) { DataSections = V; }
 
   /// setFunctionSections - Set if the functions are emit into separate
   /// sections.
-  static void setFunctionSections(bool);
+  void setFunctionSections(bool V) { FunctionSections = V; }
 
   /// \brief Register analysis passes for this target with a pass manager.
   virtual void addAnalysisPasses(PassManagerBase &) {}
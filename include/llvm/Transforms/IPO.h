@@ -177,16 +177,60 @@ ModulePass *createStripDeadPrototypesPass();
 ///
 Pass *createFunctionAttrsPass();
 
+//===----------------------------------------------------------------------===//
+/// createSummaryFunctionAttrsPass - This pass deduces the same attributes as
+/// createFunctionAttrsPass for a whole module at once, from per-function
+/// summaries that are computed in parallel.
+///
+ModulePass *createSummaryFunctionAttrsPass();
+
 //===----------------------------------------------------------------------===//
 /// createMergeFunctionsPass - This pass discovers identical functions and
 /// collapses them.
 ///
 ModulePass *createMergeFunctionsPass();
 
+//===----------------------------------------------------------------------===//
+/// createFunctionSpecializationPass - This pass clones internal functions for
+/// constant arguments passed by some of their call sites.
+///
+ModulePass *createFunctionSpecializationPass();
+
+//===----------------------------------------------------------------------===//
+/// createIndirectCallPromotionPass - This pass calls the most frequent
+/// profiled targets of indirect calls directly, behind a check of the called
+/// pointer.
+///
+ModulePass *createIndirectCallPromotionPass();
+
+//===----------------------------------------------------------------------===//
+/// createHotColdSplittingPass - This pass outlines the cold regions of
+/// functions into cold functions.
+///
+ModulePass *createHotColdSplittingPass();
+
+//===----------------------------------------------------------------------===//
+/// createFunctionSectionPrefixPass - This pass marks functions as hot,
+/// unlikely or startup text from their profiled entry counts.
+///
+ModulePass *createFunctionSectionPrefixPass();
+
+//===----------------------------------------------------------------------===//
+/// createFunctionOrderingPass - This pass reorders the functions of a module
+/// so that profiled callers and callees are laid out together.
+///
+ModulePass *createFunctionOrderingPass();
+
 //===----------------------------------------------------------------------===//
 /// createPartialInliningPass - This pass inlines parts of functions.
 ///
 ModulePass *createPartialInliningPass();
+
+//===----------------------------------------------------------------------===//
+/// createWholeProgramDevirtPass - This pass turns virtual calls with a single
+/// possible target, according to the !llvm.vtables metadata, into direct calls.
+///
+ModulePass *createWholeProgramDevirtPass();
   
 //===----------------------------------------------------------------------===//
 // createMetaRenamerPass - Rename everything with metasyntatic names.
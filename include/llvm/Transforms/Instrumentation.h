@@ -63,6 +63,12 @@ struct GCOVOptions {
 ModulePass *createGCOVProfilerPass(const GCOVOptions &Options =
                                    GCOVOptions::getDefault());
 
+// Insert edge counters that the program writes to a profile as it exits, for
+// -edge-profile-loader to turn into branch weights.  The profile is written to
+// Filename, or the file named by -edge-profile-file if it is empty.
+ModulePass *createEdgeProfilerPass(StringRef Filename = StringRef());
+ModulePass *createEdgeProfileLoaderPass(StringRef Filename = StringRef());
+
 // Insert AddressSanitizer (address sanity checking) instrumentation
 FunctionPass *createAddressSanitizerFunctionPass(
     bool CheckInitOrder = true, bool CheckUseAfterReturn = false,
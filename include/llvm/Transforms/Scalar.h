@@ -309,6 +309,35 @@ FunctionPass *createMemCpyOptPass();
 // can prove are dead.
 //
 Pass *createLoopDeletionPass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopDataPrefetch - This pass inserts software prefetches for loads and
+// stores whose address advances by at least a cache line per iteration.
+//
+Pass *createLoopDataPrefetchPass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopInvariantDivision - This pass rewrites unsigned divisions by a
+// loop-invariant divisor into multiplies by a reciprocal computed once in the
+// loop preheader.
+//
+Pass *createLoopInvariantDivisionPass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopDistribute - This pass splits innermost loops into several loops so that
+// a recurrence no longer prevents the rest of the body from being vectorized.
+//
+Pass *createLoopDistributePass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopFusion - This pass merges adjacent innermost loops that run the same
+// number of iterations.
+//
+Pass *createLoopFusionPass();
   
 //===----------------------------------------------------------------------===//
 //
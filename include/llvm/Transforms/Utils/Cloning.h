@@ -18,6 +18,7 @@
 #ifndef LLVM_TRANSFORMS_UTILS_CLONING_H
 #define LLVM_TRANSFORMS_UTILS_CLONING_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/ADT/ValueMap.h"
@@ -28,6 +29,7 @@ namespace llvm {
 
 class Module;
 class Function;
+class GlobalValue;
 class Instruction;
 class Pass;
 class LPPassManager;
@@ -49,6 +51,17 @@ class AllocaInst;
 Module *CloneModule(const Module *M);
 Module *CloneModule(const Module *M, ValueToValueMapTy &VMap);
 
+/// CloneModulePartition - Return a copy of the specified module that only
+/// defines the global values in Definitions, for example one partition from
+/// partitionModule().  The other global values the copied definitions refer to
+/// are declared when they are first referred to, so nothing outside the
+/// partition is copied.  Locals referred to from outside their partition must
+/// already have been made external.  Module-level inline asm is not copied,
+/// as it has to end up in exactly one partition.
+Module *CloneModulePartition(const Module *M,
+                             ArrayRef<const GlobalValue *> Definitions,
+                             ValueToValueMapTy &VMap);
+
 /// ClonedCodeInfo - This struct can be used to capture information about code
 /// being cloned, while it is being cloned.
 struct ClonedCodeInfo {
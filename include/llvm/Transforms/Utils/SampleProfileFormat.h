@@ -0,0 +1,123 @@
+//===- SampleProfileFormat.h - Sample profile file formats ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the readers and writers of the files the sample profile
+// loader reads.  The text format is convenient for tests and debugging.  The
+// binary format starts with an index of the functions by the hash of their
+// names, so that a compilation can look up the functions it defines and
+// leave the records of every other function in a large profile unread.
+//
+// The binary format is little-endian:
+//
+//   Header:   "LLVMSPRF", uint32 version, uint32 number of functions
+//   Index:    (uint64 name hash, uint64 record offset) per function,
+//             sorted by hash
+//   Records:  uint32 name length, name, uint32 total samples,
+//             uint32 head samples, uint32 number of lines, and
+//             (uint32 line offset, uint32 samples, uint32 number of call
+//             targets, and (uint32 name length, name, uint32 samples) per
+//             call target) per line
+//
+// Version 1 files, which have no call targets, are still read.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SAMPLEPROFILEFORMAT_H
+#define LLVM_TRANSFORMS_UTILS_SAMPLEPROFILEFORMAT_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/DataTypes.h"
+#include <map>
+#include <string>
+
+namespace llvm {
+
+class MemoryBuffer;
+class raw_ostream;
+
+namespace sampleprof {
+
+/// CallTargetMap - The functions called from a line, by name, with the number
+/// of samples of each call.
+typedef std::map<std::string, uint32_t> CallTargetMap;
+
+/// FunctionSamples - The samples collected in one function.
+struct FunctionSamples {
+  FunctionSamples() : TotalSamples(0), TotalHeadSamples(0) {}
+
+  /// Samples are cumulative, they include all the samples collected inside
+  /// this function and all its inlined callees.
+  unsigned TotalSamples;
+
+  /// The number of samples collected at the head of the function.
+  unsigned TotalHeadSamples;
+
+  /// The samples collected at each line, by the offset of the line from
+  /// the start of the function.
+  DenseMap<uint32_t, uint32_t> BodySamples;
+
+  /// The targets of the indirect calls at each sampled line, as the profiler
+  /// derived them from the taken branches it recorded (e.g. with LBR).
+  DenseMap<uint32_t, CallTargetMap> CallTargets;
+};
+
+typedef StringMap<FunctionSamples> ProfileMap;
+
+/// readText - Parse a text profile, adding its samples to Profiles.  On a
+/// parse error, return false and set ErrorMsg to the line number and a
+/// description of the problem.
+bool readText(const MemoryBuffer &Buffer, ProfileMap &Profiles,
+              std::string &ErrorMsg);
+
+/// writeText - Write Profiles in the text format, which readText accepts.
+void writeText(const ProfileMap &Profiles, raw_ostream &OS);
+
+/// writeBinary - Write Profiles in the binary format.
+void writeBinary(const ProfileMap &Profiles, raw_ostream &OS);
+
+/// BinaryReader - Reads the records of single functions out of a binary
+/// profile.  The buffer must outlive the reader.
+class BinaryReader {
+public:
+  /// isBinary - Return true if Buffer starts like a binary profile.
+  static bool isBinary(const MemoryBuffer &Buffer);
+
+  /// create - Check the header and index of a binary profile.  On failure,
+  /// return null and set ErrorMsg.
+  static BinaryReader *create(const MemoryBuffer &Buffer,
+                              std::string &ErrorMsg);
+
+  unsigned getNumFunctions() const { return NumFunctions; }
+
+  /// read - Add the samples of the named function to Samples, if it is in
+  /// the profile.  Return false if its record is malformed.
+  bool read(StringRef Name, FunctionSamples &Samples) const;
+
+  /// readAll - Add the samples of every function to Profiles.  Return false
+  /// if any record is malformed.
+  bool readAll(ProfileMap &Profiles) const;
+
+private:
+  BinaryReader(const MemoryBuffer &Buffer, unsigned FileVersion,
+               unsigned NumFunctions)
+    : Buffer(Buffer), FileVersion(FileVersion), NumFunctions(NumFunctions) {}
+
+  bool readRecord(uint64_t Offset, StringRef &Name,
+                  FunctionSamples *Samples) const;
+
+  const MemoryBuffer &Buffer;
+  unsigned FileVersion;
+  unsigned NumFunctions;
+};
+
+} // End sampleprof namespace
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,62 @@
+//===-- SplitModule.h - Split a module into partitions ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines functions for splitting the definitions of a module into
+// partitions that can be code generated independently of each other, for
+// example on separate threads.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+#define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class Module;
+
+/// Assign each global value of \p M to one of \p N partitions, balancing the
+/// number of instructions per partition.  Values that must be emitted
+/// together (an alias and its aliasee, a function and the users of its block
+/// addresses) are kept in the same partition, and module-level data that
+/// cannot be duplicated (appending globals such as llvm.global_ctors) is
+/// placed in partition 0.
+///
+/// Local symbols that are referenced from a partition other than their own
+/// are renamed and given hidden external linkage so that each partition can
+/// refer to them by name.
+///
+/// On return \p Partition holds the partition of every global value of \p M,
+/// in module order: functions first, then global variables, then aliases.
+void partitionModule(Module &M, unsigned N, std::vector<unsigned> &Partition);
+
+/// Strip \p M, which must be an exact copy (for example, a bitcode round trip)
+/// of a module previously passed to partitionModule, down to the definitions
+/// assigned to partition \p P.  Definitions owned by other partitions become
+/// external declarations.
+void extractPartition(Module &M, ArrayRef<unsigned> Partition, unsigned P);
+
+/// Read only the function bodies of partition \p P into \p M, a module still
+/// being read lazily (for example by getLazyBitcodeModule) from a snapshot of
+/// a module previously passed to partitionModule, and drop its materializer.
+/// The bodies of the other partitions are never read and their functions
+/// become external declarations, so loading a partition costs about as much
+/// as the partition itself rather than the whole module.  Call
+/// extractPartition afterwards to strip the rest.
+///
+/// Returns true on error, in which case \p ErrMsg, if non-null, describes it.
+bool materializePartition(Module &M, ArrayRef<unsigned> Partition, unsigned P,
+                          std::string *ErrMsg = 0);
+
+} // End llvm namespace
+
+#endif // LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
@@ -54,6 +54,35 @@ AliasAnalysis::alias(const Location &LocA, const Location &LocB) {
   return AA->alias(LocA, LocB);
 }
 
+AliasAnalysis::AliasBatch::AliasBatch(AliasAnalysis &AA) : AA(AA) {
+  for (AliasAnalysis *A = &AA; A; A = A->AA)
+    if (A->BatchDepth++ == 0)
+      ++A->BatchNumber;
+}
+
+AliasAnalysis::AliasBatch::~AliasBatch() {
+  for (AliasAnalysis *A = &AA; A; A = A->AA) {
+    assert(A->BatchDepth && "Unbalanced AliasBatch!");
+    --A->BatchDepth;
+  }
+}
+
+void AliasAnalysis::batchAlias(const Location &LocA, ArrayRef<Location> LocBs,
+                               SmallVectorImpl<AliasResult> &Results) {
+  AliasBatch Batch(*this);
+  for (unsigned i = 0, e = LocBs.size(); i != e; ++i)
+    Results.push_back(alias(LocA, LocBs[i]));
+}
+
+void AliasAnalysis::batchAlias(ArrayRef<Location> LocAs,
+                               ArrayRef<Location> LocBs,
+                               SmallVectorImpl<AliasResult> &Results) {
+  AliasBatch Batch(*this);
+  for (unsigned i = 0, e = LocAs.size(); i != e; ++i)
+    for (unsigned j = 0, je = LocBs.size(); j != je; ++j)
+      Results.push_back(alias(LocAs[i], LocBs[j]));
+}
+
 bool AliasAnalysis::pointsToConstantMemory(const Location &Loc,
                                            bool OrLocal) {
   assert(AA && "AA didn't call InitializeAliasAnalysis in its run method!");
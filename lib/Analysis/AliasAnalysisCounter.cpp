@@ -13,8 +13,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/Passes.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Assembly/Writer.h"
+#include "llvm/IR/PassInstrumentation.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
@@ -26,12 +29,32 @@ static cl::opt<bool>
 PrintAll("count-aa-print-all-queries", cl::ReallyHidden, cl::init(true));
 static cl::opt<bool>
 PrintAllFailures("count-aa-print-all-failed-queries", cl::ReallyHidden);
+static cl::opt<bool>
+CountPerPass("count-aa-per-pass", cl::Hidden,
+             cl::desc("Report the number of alias queries made by each pass"));
 
 namespace {
+  class AliasAnalysisCounter;
+
+  /// PassQueryCounter - Attributes the queries counted since the previous
+  /// pass finished to the pass that has just finished.
+  class PassQueryCounter : public PassInstrumentation {
+    const AliasAnalysisCounter &Counter;
+    unsigned LastAA, LastMR;
+  public:
+    /// The alias and mod/ref queries made by each pass, by name.
+    StringMap<std::pair<unsigned, unsigned> > Queries;
+
+    explicit PassQueryCounter(const AliasAnalysisCounter &Counter)
+      : Counter(Counter), LastAA(0), LastMR(0) {}
+    virtual void passExecuted(const PassRunInfo &Info);
+  };
+
   class AliasAnalysisCounter : public ModulePass, public AliasAnalysis {
     unsigned No, May, Partial, Must;
     unsigned NoMR, JustRef, JustMod, MR;
     Module *M;
+    OwningPtr<PassQueryCounter> PerPass;
   public:
     static char ID; // Class identification, replacement for typeinfo
     AliasAnalysisCounter() : ModulePass(ID) {
@@ -40,6 +63,9 @@ namespace {
       NoMR = JustRef = JustMod = MR = 0;
     }
 
+    unsigned getNumAliasQueries() const { return No+May+Partial+Must; }
+    unsigned getNumModRefQueries() const { return NoMR+JustRef+JustMod+MR; }
+
     void printLine(const char *Desc, unsigned Val, unsigned Sum) {
       errs() <<  "  " << Val << " " << Desc << " responses ("
              << Val*100/Sum << "%)\n";
@@ -72,12 +98,28 @@ namespace {
                  << "%/" << JustRef*100/MRSum << "%/" << JustMod*100/MRSum
                  << "%/" << MR*100/MRSum <<"%\n\n";
         }
+
+        if (PerPass) {
+          errs() << "  Queries by pass (alias, mod/ref):\n";
+          for (StringMap<std::pair<unsigned, unsigned> >::const_iterator
+                 I = PerPass->Queries.begin(), E = PerPass->Queries.end();
+               I != E; ++I)
+            errs() << "  " << I->getValue().first << " "
+                   << I->getValue().second << " " << I->getKey() << "\n";
+          errs() << "\n";
+        }
       }
+      if (PerPass)
+        removePassInstrumentation(PerPass.get());
     }
 
     bool runOnModule(Module &M) {
       this->M = &M;
       InitializeAliasAnalysis(this);
+      if (CountPerPass && !PerPass) {
+        PerPass.reset(new PassQueryCounter(*this));
+        addPassInstrumentation(PerPass.get());
+      }
       return false;
     }
 
@@ -123,6 +165,18 @@ ModulePass *llvm::createAliasAnalysisCounterPass() {
   return new AliasAnalysisCounter();
 }
 
+void PassQueryCounter::passExecuted(const PassRunInfo &Info) {
+  unsigned NumAA = Counter.getNumAliasQueries();
+  unsigned NumMR = Counter.getNumModRefQueries();
+  if (NumAA == LastAA && NumMR == LastMR)
+    return;
+  std::pair<unsigned, unsigned> &Q = Queries[Info.P->getPassName()];
+  Q.first += NumAA - LastAA;
+  Q.second += NumMR - LastMR;
+  LastAA = NumAA;
+  LastMR = NumMR;
+}
+
 AliasAnalysis::AliasResult
 AliasAnalysisCounter::alias(const Location &LocA, const Location &LocB) {
   AliasResult R = getAnalysis<AliasAnalysis>().alias(LocA, LocB);
@@ -184,6 +184,10 @@ bool AAEval::runOnFunction(Function &F) {
     errs() << "Function: " << F.getName() << ": " << Pointers.size()
            << " pointers, " << CallSites.size() << " call sites\n";
 
+  // The IR does not change while it is evaluated, so the queries can be made
+  // in one batch.
+  AliasAnalysis::AliasBatch Batch(AA);
+
   // iterate over the worklist, and run the full (n^2)/2 disambiguations
   for (SetVector<Value *>::iterator I1 = Pointers.begin(), E = Pointers.end();
        I1 != E; ++I1) {
@@ -13,6 +13,7 @@
 
 #include "llvm/Analysis/AliasSetTracker.h"
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Assembly/Writer.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Instructions.h"
@@ -20,18 +21,92 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/InstIterator.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
+static cl::opt<unsigned>
+SaturationThreshold("alias-set-saturation-threshold", cl::Hidden,
+                    cl::init(250),
+                    cl::desc("The maximum number of pointers in may-alias "
+                             "sets before an alias set tracker gives up and "
+                             "puts every access in one set"));
+
+/// MaxObjectsPerSet - The number of distinct objects an alias set remembers
+/// before it stops telling them apart.
+static const unsigned MaxObjectsPerSet = 8;
+
+/// getDistinctObject - Return the alloca or global variable Ptr is based on,
+/// or null if it could be based on anything.  Pointers based on different
+/// distinct objects never alias.
+static const Value *getDistinctObject(const Value *Ptr, const DataLayout *TD) {
+  const Value *Obj = GetUnderlyingObject(Ptr, TD);
+  if (isa<AllocaInst>(Obj) || isa<GlobalVariable>(Obj))
+    return Obj;
+  return 0;
+}
+
+void AliasSet::PointerRec::eraseFromList(AliasSetTracker &AST) {
+  // The entry may still point at a set that has since been merged away.
+  AliasSet *Set = AS;
+  while (Set->Forward)
+    Set = Set->Forward;
+
+  --Set->SetSize;
+  if (Set->isMayAlias())
+    --AST.TotalMayAliasSetSize;
+
+  if (NextInList) NextInList->PrevInList = PrevInList;
+  *PrevInList = NextInList;
+  if (Set->PtrListEnd == &NextInList) {
+    Set->PtrListEnd = PrevInList;
+    assert(*Set->PtrListEnd == 0 && "List not terminated right!");
+  }
+  delete this;
+}
+
+/// setMayAlias - Downgrade this set to may-alias, accounting for its
+/// pointers in the tracker's saturation count.
+void AliasSet::setMayAlias(AliasSetTracker &AST) {
+  if (AliasTy == MayAlias)
+    return;
+  AliasTy = MayAlias;
+  AST.TotalMayAliasSetSize += SetSize;
+}
+
+/// addObject - Record that some pointer in this set is based on Obj, or on
+/// an unknown object if Obj is null.
+void AliasSet::addObject(const Value *Obj) {
+  if (UnknownObjects)
+    return;
+  if (!Obj || Objects.size() == MaxObjectsPerSet) {
+    UnknownObjects = true;
+    Objects.clear();
+    return;
+  }
+  if (std::find(Objects.begin(), Objects.end(), Obj) == Objects.end())
+    Objects.push_back(Obj);
+}
+
+bool AliasSet::mayContainObject(const Value *Obj) const {
+  // Unknown instructions may access any object whose address escaped.
+  if (!Obj || UnknownObjects || !UnknownInsts.empty())
+    return true;
+  return std::find(Objects.begin(), Objects.end(), Obj) != Objects.end();
+}
+
 /// mergeSetIn - Merge the specified alias set into this alias set.
 ///
 void AliasSet::mergeSetIn(AliasSet &AS, AliasSetTracker &AST) {
   assert(!AS.Forward && "Alias set is already forwarding!");
   assert(!Forward && "This set is a forwarding set!!");
 
+  bool WasMustAlias = isMustAlias();
+  bool ASWasMustAlias = AS.isMustAlias();
+
   // Update the alias and access types of this set...
   AccessTy |= AS.AccessTy;
   AliasTy  |= AS.AliasTy;
@@ -56,6 +131,24 @@ void AliasSet::mergeSetIn(AliasSet &AS, AliasSetTracker &AST) {
       AliasTy = MayAlias;
   }
 
+  if (isMayAlias()) {
+    if (WasMustAlias)
+      AST.TotalMayAliasSetSize += SetSize;
+    if (ASWasMustAlias)
+      AST.TotalMayAliasSetSize += AS.SetSize;
+  }
+  SetSize += AS.SetSize;
+  AS.SetSize = 0;
+
+  if (AS.UnknownObjects) {
+    UnknownObjects = true;
+    Objects.clear();
+  } else {
+    for (unsigned i = 0, e = AS.Objects.size(); i != e; ++i)
+      addObject(AS.Objects[i]);
+  }
+  AS.Objects.clear();
+
   if (UnknownInsts.empty()) {            // Merge call sites...
     if (!AS.UnknownInsts.empty())
       std::swap(UnknownInsts, AS.UnknownInsts);
@@ -84,6 +177,8 @@ void AliasSetTracker::removeAliasSet(AliasSet *AS) {
     Fwd->dropRef(*this);
     AS->Forward = 0;
   }
+  if (AS == AliasAnyAS)
+    AliasAnyAS = 0;
   AliasSets.erase(AS);
 }
 
@@ -106,7 +201,7 @@ void AliasSet::addPointer(AliasSetTracker &AST, PointerRec &Entry,
                                          P->getTBAAInfo()),
                  AliasAnalysis::Location(Entry.getValue(), Size, TBAAInfo));
       if (Result != AliasAnalysis::MustAlias)
-        AliasTy = MayAlias;
+        setMayAlias(AST);
       else                  // First entry of must alias must have maximum size!
         P->updateSizeAndTBAAInfo(Size, TBAAInfo);
       assert(Result != AliasAnalysis::NoAlias && "Cannot be part of must set!");
@@ -121,19 +216,25 @@ void AliasSet::addPointer(AliasSetTracker &AST, PointerRec &Entry,
   PtrListEnd = Entry.setPrevInList(PtrListEnd);
   assert(*PtrListEnd == 0 && "End of list is not null?");
   addRef();               // Entry points to alias set.
+
+  ++SetSize;
+  if (isMayAlias())
+    ++AST.TotalMayAliasSetSize;
+  addObject(getDistinctObject(Entry.getValue(),
+                              AST.getAliasAnalysis().getDataLayout()));
 }
 
-void AliasSet::addUnknownInst(Instruction *I, AliasAnalysis &AA) {
+void AliasSet::addUnknownInst(Instruction *I, AliasSetTracker &AST) {
   UnknownInsts.push_back(I);
 
   if (!I->mayWriteToMemory()) {
-    AliasTy = MayAlias;
+    setMayAlias(AST);
     AccessTy |= Refs;
     return;
   }
 
   // FIXME: This should use mod/ref information to make this not suck so bad
-  AliasTy = MayAlias;
+  setMayAlias(AST);
   AccessTy = ModRef;
 }
 
@@ -202,12 +303,14 @@ void AliasSetTracker::clear() {
   // Delete all the PointerRec entries.
   for (PointerMapType::iterator I = PointerMap.begin(), E = PointerMap.end();
        I != E; ++I)
-    I->second->eraseFromList();
+    I->second->eraseFromList(*this);
   
   PointerMap.clear();
   
   // The alias sets should all be clear now.
   AliasSets.clear();
+  AliasAnyAS = 0;
+  TotalMayAliasSetSize = 0;
 }
 
 
@@ -218,9 +321,16 @@ void AliasSetTracker::clear() {
 AliasSet *AliasSetTracker::findAliasSetForPointer(const Value *Ptr,
                                                   uint64_t Size,
                                                   const MDNode *TBAAInfo) {
+  // A saturated tracker assumes everything aliases.
+  if (AliasAnyAS)
+    return AliasAnyAS;
+
+  const Value *Obj = getDistinctObject(Ptr, AA.getDataLayout());
   AliasSet *FoundSet = 0;
   for (iterator I = begin(), E = end(); I != E; ++I) {
-    if (I->Forward || !I->aliasesPointer(Ptr, Size, TBAAInfo, AA)) continue;
+    if (I->Forward || !I->mayContainObject(Obj) ||
+        !I->aliasesPointer(Ptr, Size, TBAAInfo, AA))
+      continue;
     
     if (FoundSet == 0) {  // If this is the first alias set ptr can go into.
       FoundSet = I;       // Remember it.
@@ -237,8 +347,10 @@ AliasSet *AliasSetTracker::findAliasSetForPointer(const Value *Ptr,
 /// alias sets.
 bool AliasSetTracker::containsPointer(Value *Ptr, uint64_t Size,
                                       const MDNode *TBAAInfo) const {
+  const Value *Obj = getDistinctObject(Ptr, AA.getDataLayout());
   for (const_iterator I = begin(), E = end(); I != E; ++I)
-    if (!I->Forward && I->aliasesPointer(Ptr, Size, TBAAInfo, AA))
+    if (!I->Forward && I->mayContainObject(Obj) &&
+        I->aliasesPointer(Ptr, Size, TBAAInfo, AA))
       return true;
   return false;
 }
@@ -246,6 +358,9 @@ bool AliasSetTracker::containsPointer(Value *Ptr, uint64_t Size,
 
 
 AliasSet *AliasSetTracker::findAliasSetForUnknownInst(Instruction *Inst) {
+  if (AliasAnyAS)
+    return AliasAnyAS;
+
   AliasSet *FoundSet = 0;
   for (iterator I = begin(), E = end(); I != E; ++I) {
     if (I->Forward || !I->aliasesUnknownInst(Inst, AA))
@@ -259,8 +374,26 @@ AliasSet *AliasSetTracker::findAliasSetForUnknownInst(Instruction *Inst) {
   return FoundSet;
 }
 
+/// checkSaturation - Merge all of the alias sets into one if the may-alias
+/// sets have grown too large to keep querying.
+void AliasSetTracker::checkSaturation() {
+  if (!AliasAnyAS && TotalMayAliasSetSize > SaturationThreshold)
+    mergeAllAliasSets();
+}
 
+/// mergeAllAliasSets - Saturate the tracker: merge every alias set into a
+/// single may-alias set that all further accesses are added to.
+void AliasSetTracker::mergeAllAliasSets() {
+  assert(!AliasAnyAS && "Tracker is already saturated!");
+  AliasSets.push_back(new AliasSet());
+  AliasAnyAS = &AliasSets.back();
+  // Starting out may-alias avoids a must-alias query for every merge.
+  AliasAnyAS->setMayAlias(*this);
 
+  for (iterator I = begin(), E = end(); I != E; ++I)
+    if (&*I != AliasAnyAS && !I->Forward)
+      AliasAnyAS->mergeSetIn(*I, *this);
+}
 
 /// getAliasSetForPointer - Return the alias set that the specified pointer
 /// lives in.
@@ -276,17 +409,20 @@ AliasSet &AliasSetTracker::getAliasSetForPointer(Value *Pointer, uint64_t Size,
     return *Entry.getAliasSet(*this)->getForwardedTarget(*this);
   }
   
-  if (AliasSet *AS = findAliasSetForPointer(Pointer, Size, TBAAInfo)) {
+  AliasSet *AS = findAliasSetForPointer(Pointer, Size, TBAAInfo);
+  if (AS) {
     // Add it to the alias set it aliases.
     AS->addPointer(*this, Entry, Size, TBAAInfo);
-    return *AS;
+  } else {
+    if (New) *New = true;
+    // Otherwise create a new alias set to hold the loaded pointer.
+    AliasSets.push_back(new AliasSet());
+    AS = &AliasSets.back();
+    AS->addPointer(*this, Entry, Size, TBAAInfo);
   }
-  
-  if (New) *New = true;
-  // Otherwise create a new alias set to hold the loaded pointer.
-  AliasSets.push_back(new AliasSet());
-  AliasSets.back().addPointer(*this, Entry, Size, TBAAInfo);
-  return AliasSets.back();
+
+  checkSaturation();
+  return *AS->getForwardedTarget(*this);
 }
 
 bool AliasSetTracker::add(Value *Ptr, uint64_t Size, const MDNode *TBAAInfo) {
@@ -338,12 +474,14 @@ bool AliasSetTracker::addUnknown(Instruction *Inst) {
 
   AliasSet *AS = findAliasSetForUnknownInst(Inst);
   if (AS) {
-    AS->addUnknownInst(Inst, AA);
+    AS->addUnknownInst(Inst, *this);
+    checkSaturation();
     return false;
   }
   AliasSets.push_back(new AliasSet());
   AS = &AliasSets.back();
-  AS->addUnknownInst(Inst, AA);
+  AS->addUnknownInst(Inst, *this);
+  checkSaturation();
   return true;
 }
 
@@ -404,7 +542,7 @@ void AliasSetTracker::remove(AliasSet &AS) {
     Value *ValToRemove = P->getValue();
     
     // Unlink and delete entry from the list of values.
-    P->eraseFromList();
+    P->eraseFromList(*this);
     
     // Remember how many references need to be dropped.
     ++NumRefs;
@@ -507,7 +645,7 @@ void AliasSetTracker::deleteValue(Value *PtrVal) {
   AliasSet *AS = PtrValEnt->getAliasSet(*this);
 
   // Unlink and delete from the list of values.
-  PtrValEnt->eraseFromList();
+  PtrValEnt->eraseFromList(*this);
   
   // Stop using the alias set.
   AS->dropRef(*this);
@@ -539,6 +677,7 @@ void AliasSetTracker::copyValue(Value *From, Value *To) {
   AS->addPointer(*this, Entry, I->second->getSize(),
                  I->second->getTBAAInfo(),
                  true);
+  checkSaturation();
 }
 
 
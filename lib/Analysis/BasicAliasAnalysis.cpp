@@ -13,9 +13,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "basicaa"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/InstructionSimplify.h"
@@ -38,6 +40,8 @@
 #include <algorithm>
 using namespace llvm;
 
+STATISTIC(NumBatchGEPHits, "Number of GEP decompositions reused in a batch");
+
 //===----------------------------------------------------------------------===//
 // Useful predicates
 //===----------------------------------------------------------------------===//
@@ -467,7 +471,7 @@ namespace {
   /// BasicAliasAnalysis - This is the primary alias analysis implementation.
   struct BasicAliasAnalysis : public ImmutablePass, public AliasAnalysis {
     static char ID; // Class identification, replacement for typeinfo
-    BasicAliasAnalysis() : ImmutablePass(ID) {
+    BasicAliasAnalysis() : ImmutablePass(ID), CacheBatchNumber(0) {
       initializeBasicAliasAnalysisPass(*PassRegistry::getPassRegistry());
     }
 
@@ -485,6 +489,11 @@ namespace {
       assert(AliasCache.empty() && "AliasCache must be cleared after use!");
       assert(notDifferentParent(LocA.Ptr, LocB.Ptr) &&
              "BasicAliasAnalysis doesn't support interprocedural queries.");
+      if (isInBatch() && CacheBatchNumber != getBatchNumber()) {
+        DecomposedGEPs.clear();
+        UnderlyingObjects.clear();
+        CacheBatchNumber = getBatchNumber();
+      }
       AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.TBAATag,
                                      LocB.Ptr, LocB.Size, LocB.TBAATag);
       // AliasCache rarely has more than 1 or 2 elements, always use
@@ -535,6 +544,29 @@ namespace {
     // Visited - Track instructions visited by pointsToConstantMemory.
     SmallPtrSet<const Value*, 16> Visited;
 
+    /// DecomposedGEP - What DecomposeGEPExpression found for a pointer.
+    struct DecomposedGEP {
+      const Value *Base;
+      int64_t Offset;
+      SmallVector<VariableGEPIndex, 4> VarIndices;
+    };
+
+    // DecomposedGEPs, UnderlyingObjects - The pointers decomposed and the
+    // underlying objects found during the AliasBatch numbered
+    // CacheBatchNumber.  They are only used while that batch is active.
+    DenseMap<const Value*, DecomposedGEP> DecomposedGEPs;
+    DenseMap<const Value*, const Value*> UnderlyingObjects;
+    unsigned CacheBatchNumber;
+
+    // decomposeGEP - DecomposeGEPExpression, remembering the result for the
+    // rest of the batch if there is one.
+    const Value *decomposeGEP(const Value *V, int64_t &BaseOffs,
+                              SmallVectorImpl<VariableGEPIndex> &VarIndices);
+
+    // getUnderlyingObject - GetUnderlyingObject, remembering the result for
+    // the rest of the batch if there is one.
+    const Value *getUnderlyingObject(const Value *V);
+
     // aliasGEP - Provide a bunch of ad-hoc rules to disambiguate a GEP
     // instruction against another.
     AliasResult aliasGEP(const GEPOperator *V1, uint64_t V1Size,
@@ -871,6 +903,34 @@ static bool areVarIndicesEqual(SmallVectorImpl<VariableGEPIndex> &Indices1,
   return true;
 }
 
+const Value *
+BasicAliasAnalysis::decomposeGEP(const Value *V, int64_t &BaseOffs,
+                              SmallVectorImpl<VariableGEPIndex> &VarIndices) {
+  if (!isInBatch())
+    return DecomposeGEPExpression(V, BaseOffs, VarIndices, TD);
+
+  std::pair<DenseMap<const Value*, DecomposedGEP>::iterator, bool> Pair =
+    DecomposedGEPs.insert(std::make_pair(V, DecomposedGEP()));
+  DecomposedGEP &D = Pair.first->second;
+  if (Pair.second)
+    D.Base = DecomposeGEPExpression(V, D.Offset, D.VarIndices, TD);
+  else
+    ++NumBatchGEPHits;
+  BaseOffs = D.Offset;
+  VarIndices.append(D.VarIndices.begin(), D.VarIndices.end());
+  return D.Base;
+}
+
+const Value *BasicAliasAnalysis::getUnderlyingObject(const Value *V) {
+  if (!isInBatch())
+    return GetUnderlyingObject(V, TD);
+
+  const Value *&Object = UnderlyingObjects[V];
+  if (!Object)
+    Object = GetUnderlyingObject(V, TD);
+  return Object;
+}
+
 /// aliasGEP - Provide a bunch of ad-hoc rules to disambiguate a GEP instruction
 /// against another pointer.  We know that V1 is a GEP, but we don't know
 /// anything about V2.  UnderlyingV1 is GetUnderlyingObject(GEP1, TD),
@@ -907,9 +967,9 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
         int64_t GEP2BaseOffset;
         SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
         const Value *GEP2BasePtr =
-          DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices, TD);
+          decomposeGEP(GEP2, GEP2BaseOffset, GEP2VariableIndices);
         const Value *GEP1BasePtr =
-          DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices, TD);
+          decomposeGEP(GEP1, GEP1BaseOffset, GEP1VariableIndices);
         // DecomposeGEPExpression and GetUnderlyingObject should return the
         // same result except when DecomposeGEPExpression has no DataLayout.
         if (GEP1BasePtr != UnderlyingV1 || GEP2BasePtr != UnderlyingV2) {
@@ -933,12 +993,12 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
     // exactly, see if the computed offset from the common pointer tells us
     // about the relation of the resulting pointer.
     const Value *GEP1BasePtr =
-      DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices, TD);
+      decomposeGEP(GEP1, GEP1BaseOffset, GEP1VariableIndices);
 
     int64_t GEP2BaseOffset;
     SmallVector<VariableGEPIndex, 4> GEP2VariableIndices;
     const Value *GEP2BasePtr =
-      DecomposeGEPExpression(GEP2, GEP2BaseOffset, GEP2VariableIndices, TD);
+      decomposeGEP(GEP2, GEP2BaseOffset, GEP2VariableIndices);
 
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -973,7 +1033,7 @@ BasicAliasAnalysis::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
       return R;
 
     const Value *GEP1BasePtr =
-      DecomposeGEPExpression(GEP1, GEP1BaseOffset, GEP1VariableIndices, TD);
+      decomposeGEP(GEP1, GEP1BaseOffset, GEP1VariableIndices);
 
     // DecomposeGEPExpression and GetUnderlyingObject should return the
     // same result except when DecomposeGEPExpression has no DataLayout.
@@ -1193,8 +1253,8 @@ BasicAliasAnalysis::aliasCheck(const Value *V1, uint64_t V1Size,
     return NoAlias;  // Scalars cannot alias each other
 
   // Figure out what objects these things are pointing to if we can.
-  const Value *O1 = GetUnderlyingObject(V1, TD);
-  const Value *O2 = GetUnderlyingObject(V2, TD);
+  const Value *O1 = getUnderlyingObject(V1);
+  const Value *O2 = getUnderlyingObject(V2);
 
   // Null values in the default address space don't point to any object, so they
   // don't alias any other pointer.
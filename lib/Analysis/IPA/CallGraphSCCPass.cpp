@@ -18,6 +18,7 @@
 #define DEBUG_TYPE "cgscc-passmgr"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/IR/Function.h"
@@ -33,6 +34,8 @@ static cl::opt<unsigned>
 MaxIterations("max-cg-scc-iterations", cl::ReallyHidden, cl::init(4));
 
 STATISTIC(MaxSCCIterations, "Maximum CGSCCPassMgr iterations on one SCC");
+STATISTIC(NumParallelLevels,
+          "Number of SCC levels whose function passes ran in parallel");
 
 //===----------------------------------------------------------------------===//
 // CGPassManager
@@ -93,6 +96,16 @@ public:
 private:
   bool RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
                          bool &DevirtualizedCall);
+  bool RunPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
+                      unsigned FirstPass, unsigned LastPass,
+                      bool &CallGraphUpToDate, bool &DevirtualizedCall);
+  void IterateOnSCC(CallGraphSCC &CurSCC, CallGraph &CG, bool &Changed,
+                    unsigned Iteration, bool DevirtualizedCall);
+
+  unsigned getFirstParallelPass();
+  bool RunOnSCCLevels(CallGraph &CG, unsigned FirstParallelPass);
+  bool RunFunctionPassesOnLevel(FPPassManager *FPP, CallGraph &CG,
+                                const std::vector<CallGraphSCC*> &Level);
   
   bool RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
                     CallGraph &CG, bool &CallGraphUpToDate,
@@ -121,7 +134,12 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
-      Changed = CGSP->runOnSCC(CurSCC);
+      // Report a single-function SCC against its function.
+      Function *F = CurSCC.isSingular() ? (*CurSCC.begin())->getFunction() : 0;
+      PassInstrumentationRegion PIR(CGSP, CG.getModule(), F);
+      if (PIR.shouldRunPass())
+        Changed = CGSP->runOnSCC(CurSCC);
+      PIR.passExecuted(Changed);
     }
     
     // After the CGSCCPass is done, when assertions are enabled, use
@@ -365,8 +383,6 @@ bool CGPassManager::RefreshCallGraph(CallGraphSCC &CurSCC,
 /// any calls and returns it in DevirtualizedCall.
 bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
                                       bool &DevirtualizedCall) {
-  bool Changed = false;
-  
   // CallGraphUpToDate - Keep track of whether the callgraph is known to be
   // up-to-date or not.  The CGSSC pass manager runs two types of passes:
   // CallGraphSCC Passes and other random function passes.  Because other
@@ -377,8 +393,25 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
   bool CallGraphUpToDate = true;
 
   // Run all passes on current SCC.
-  for (unsigned PassNo = 0, e = getNumContainedPasses();
-       PassNo != e; ++PassNo) {
+  bool Changed = RunPassesOnSCC(CurSCC, CG, 0, getNumContainedPasses(),
+                                CallGraphUpToDate, DevirtualizedCall);
+
+  // If the callgraph was left out of date (because the last pass run was a
+  // functionpass), refresh it before we move on to the next SCC.
+  if (!CallGraphUpToDate)
+    DevirtualizedCall |= RefreshCallGraph(CurSCC, CG, false);
+  return Changed;
+}
+
+/// RunPassesOnSCC - Execute the passes numbered [FirstPass, LastPass) on the
+/// specified SCC.  CallGraphUpToDate is cleared if a function pass may have
+/// left the call graph out of date.
+bool CGPassManager::RunPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
+                                   unsigned FirstPass, unsigned LastPass,
+                                   bool &CallGraphUpToDate,
+                                   bool &DevirtualizedCall) {
+  bool Changed = false;
+  for (unsigned PassNo = FirstPass; PassNo != LastPass; ++PassNo) {
     Pass *P = getContainedPass(PassNo);
     
     // If we're in -debug-pass=Executions mode, construct the SCC node list,
@@ -413,11 +446,169 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
     recordAvailableAnalysis(P);
     removeDeadPasses(P, "", ON_CG_MSG);
   }
-  
-  // If the callgraph was left out of date (because the last pass run was a
-  // functionpass), refresh it before we move on to the next SCC.
-  if (!CallGraphUpToDate)
-    DevirtualizedCall |= RefreshCallGraph(CurSCC, CG, false);
+  return Changed;
+}
+
+/// IterateOnSCC - Run all passes on an SCC again for as long as they keep
+/// devirtualizing calls, up to the iteration limit.  Iteration is the number
+/// of times they have already been run on it.
+void CGPassManager::IterateOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
+                                 bool &Changed, unsigned Iteration,
+                                 bool DevirtualizedCall) {
+  // At the top level, we run all the passes in this pass manager on the
+  // functions in this SCC.  However, we support iterative compilation in the
+  // case where a function pass devirtualizes a call to a function.  For
+  // example, it is very common for a function pass (often GVN or instcombine)
+  // to eliminate the addressing that feeds into a call.  With that improved
+  // information, we would like the call to be an inline candidate, infer
+  // mod-ref information etc.
+  //
+  // Because of this, we allow iteration up to a specified iteration count.
+  // This only happens in the case of a devirtualized call, so we only burn
+  // compile time in the case that we're making progress.  We also have a hard
+  // iteration count limit in case there is crazy code.
+  while (Iteration == 0 || (DevirtualizedCall && Iteration <= MaxIterations)) {
+    DEBUG(if (Iteration)
+            dbgs() << "  SCCPASSMGR: Re-visiting SCC, iteration #"
+                   << Iteration << '\n');
+    DevirtualizedCall = false;
+    Changed |= RunAllPassesOnSCC(CurSCC, CG, DevirtualizedCall);
+    ++Iteration;
+  }
+
+  if (DevirtualizedCall)
+    DEBUG(dbgs() << "  CGSCCPASSMGR: Stopped iteration after " << Iteration
+                 << " times, due to -max-cg-scc-iterations\n");
+
+  if (Iteration > MaxSCCIterations)
+    MaxSCCIterations = Iteration;
+}
+
+/// getFirstParallelPass - Return the number of the first pass of a trailing
+/// run of function pass managers that can all run on several threads, or
+/// the number of passes if this pass manager doesn't end with one.
+unsigned CGPassManager::getFirstParallelPass() {
+  unsigned FirstPass = getNumContainedPasses();
+  while (FirstPass != 0) {
+    PMDataManager *PM = getContainedPass(FirstPass - 1)->getAsPMDataManager();
+    if (!PM || !static_cast<FPPassManager*>(PM)->getParallelThreadCount())
+      break;
+    --FirstPass;
+  }
+  return FirstPass;
+}
+
+/// RunOnSCCLevels - Execute the passes on the SCCs of the call graph a level
+/// at a time, where the level of an SCC is one more than the highest level
+/// of the SCCs it calls.  SCCs at the same level don't call each other, so
+/// the passes before FirstParallelPass are run on each of them in turn, and
+/// the function passes from there on are run on all of their functions at
+/// once, on several threads.
+///
+/// This gives the same result as visiting the SCCs one after another in
+/// bottom-up order, because a pass run on one SCC only looks at the functions
+/// in it and the ones it calls, all of which have been finished already.
+bool CGPassManager::RunOnSCCLevels(CallGraph &CG, unsigned FirstParallelPass) {
+  // Find all of the SCCs up front, and their levels.  Calls to functions in
+  // the same SCC and to the external node don't count.
+  std::vector<CallGraphSCC*> SCCs;
+  std::vector<unsigned> Levels;
+  DenseMap<CallGraphNode*, unsigned> SCCNumbers;
+  unsigned NumLevels = 0;
+  for (scc_iterator<CallGraph*> CGI = scc_begin(&CG); !CGI.isAtEnd(); ++CGI) {
+    std::vector<CallGraphNode*> &NodeVec = *CGI;
+    unsigned SCCNo = SCCs.size();
+    for (unsigned i = 0, e = NodeVec.size(); i != e; ++i)
+      SCCNumbers[NodeVec[i]] = SCCNo;
+
+    unsigned Level = 0;
+    for (unsigned i = 0, e = NodeVec.size(); i != e; ++i)
+      for (CallGraphNode::iterator I = NodeVec[i]->begin(),
+                                   E = NodeVec[i]->end();
+           I != E; ++I) {
+        unsigned CalleeSCCNo = SCCNumbers.lookup(I->second);
+        if (CalleeSCCNo != SCCNo && I->second->getFunction())
+          Level = std::max(Level, Levels[CalleeSCCNo] + 1);
+      }
+
+    // The SCCs take their own copy of the nodes, and are not tied to the
+    // iterator, which is finished by the time they are visited.
+    SCCs.push_back(new CallGraphSCC(0));
+    SCCs.back()->initialize(&NodeVec[0], &NodeVec[0] + NodeVec.size());
+    Levels.push_back(Level);
+    NumLevels = std::max(NumLevels, Level + 1);
+  }
+
+  std::vector<std::vector<CallGraphSCC*> > SCCsByLevel(NumLevels);
+  for (unsigned i = 0, e = SCCs.size(); i != e; ++i)
+    SCCsByLevel[Levels[i]].push_back(SCCs[i]);
+
+  bool Changed = false;
+  unsigned NumPasses = getNumContainedPasses();
+  for (unsigned L = 0; L != NumLevels; ++L) {
+    const std::vector<CallGraphSCC*> &Level = SCCsByLevel[L];
+    std::vector<char> UpToDate(Level.size(), true);
+    std::vector<char> Devirtualized(Level.size(), false);
+    for (unsigned i = 0, e = Level.size(); i != e; ++i) {
+      bool CallGraphUpToDate = true, DevirtualizedCall = false;
+      Changed |= RunPassesOnSCC(*Level[i], CG, 0, FirstParallelPass,
+                                CallGraphUpToDate, DevirtualizedCall);
+      UpToDate[i] = CallGraphUpToDate;
+      Devirtualized[i] = DevirtualizedCall;
+    }
+
+    for (unsigned PassNo = FirstParallelPass; PassNo != NumPasses; ++PassNo) {
+      FPPassManager *FPP = (FPPassManager*)getContainedPass(PassNo);
+      if (RunFunctionPassesOnLevel(FPP, CG, Level)) {
+        Changed = true;
+        UpToDate.assign(Level.size(), false);
+      }
+    }
+
+    for (unsigned i = 0, e = Level.size(); i != e; ++i) {
+      bool DevirtualizedCall = Devirtualized[i];
+      if (!UpToDate[i])
+        DevirtualizedCall |= RefreshCallGraph(*Level[i], CG, false);
+      IterateOnSCC(*Level[i], CG, Changed, 1, DevirtualizedCall);
+    }
+  }
+
+  DeleteContainerPointers(SCCs);
+  return Changed;
+}
+
+/// RunFunctionPassesOnLevel - Run the function pass manager FPP on all of the
+/// functions of the SCCs in Level, on several threads if there are enough of
+/// them.
+bool CGPassManager::RunFunctionPassesOnLevel(
+    FPPassManager *FPP, CallGraph &CG,
+    const std::vector<CallGraphSCC*> &Level) {
+  std::vector<Function*> Functions;
+  for (unsigned i = 0, e = Level.size(); i != e; ++i)
+    for (CallGraphSCC::iterator I = Level[i]->begin(), E = Level[i]->end();
+         I != E; ++I)
+      if (Function *F = (*I)->getFunction())
+        if (!F->isDeclaration())
+          Functions.push_back(F);
+  if (Functions.empty())
+    return false;
+
+  bool Changed = false;
+  initializeAnalysisImpl(FPP);
+  if (Functions.size() == 1) {
+    TimeRegion PassTimer(getPassTimer(FPP));
+    Changed = FPP->runOnFunction(*Functions[0]);
+  } else {
+    ++NumParallelLevels;
+    Changed = FPP->runInParallel(CG.getModule(), Functions,
+                                 FPP->getParallelThreadCount());
+  }
+  dumpPreservedSet(FPP);
+
+  verifyPreservedAnalysis(FPP);
+  removeNotPreservedAnalysis(FPP);
+  recordAvailableAnalysis(FPP);
+  removeDeadPasses(FPP, "", ON_CG_MSG);
   return Changed;
 }
 
@@ -426,6 +617,15 @@ bool CGPassManager::RunAllPassesOnSCC(CallGraphSCC &CurSCC, CallGraph &CG,
 bool CGPassManager::runOnModule(Module &M) {
   CallGraph &CG = getAnalysis<CallGraph>();
   bool Changed = doInitialization(CG);
+
+  // If the pass manager ends with function passes that can run on several
+  // threads, run them on all the SCCs of a level at once.
+  unsigned FirstParallelPass = getFirstParallelPass();
+  if (FirstParallelPass != getNumContainedPasses()) {
+    Changed |= RunOnSCCLevels(CG, FirstParallelPass);
+    Changed |= doFinalization(CG);
+    return Changed;
+  }
   
   // Walk the callgraph in bottom-up SCC order.
   scc_iterator<CallGraph*> CGI = scc_begin(&CG);
@@ -437,36 +637,8 @@ bool CGPassManager::runOnModule(Module &M) {
     std::vector<CallGraphNode*> &NodeVec = *CGI;
     CurSCC.initialize(&NodeVec[0], &NodeVec[0]+NodeVec.size());
     ++CGI;
-    
-    // At the top level, we run all the passes in this pass manager on the
-    // functions in this SCC.  However, we support iterative compilation in the
-    // case where a function pass devirtualizes a call to a function.  For
-    // example, it is very common for a function pass (often GVN or instcombine)
-    // to eliminate the addressing that feeds into a call.  With that improved
-    // information, we would like the call to be an inline candidate, infer
-    // mod-ref information etc.
-    //
-    // Because of this, we allow iteration up to a specified iteration count.
-    // This only happens in the case of a devirtualized call, so we only burn
-    // compile time in the case that we're making progress.  We also have a hard
-    // iteration count limit in case there is crazy code.
-    unsigned Iteration = 0;
-    bool DevirtualizedCall = false;
-    do {
-      DEBUG(if (Iteration)
-              dbgs() << "  SCCPASSMGR: Re-visiting SCC, iteration #"
-                     << Iteration << '\n');
-      DevirtualizedCall = false;
-      Changed |= RunAllPassesOnSCC(CurSCC, CG, DevirtualizedCall);
-    } while (Iteration++ < MaxIterations && DevirtualizedCall);
-    
-    if (DevirtualizedCall)
-      DEBUG(dbgs() << "  CGSCCPASSMGR: Stopped iteration after " << Iteration
-                   << " times, due to -max-cg-scc-iterations\n");
-    
-    if (Iteration > MaxSCCIterations)
-      MaxSCCIterations = Iteration;
-    
+
+    IterateOnSCC(CurSCC, CG, Changed, 0, false);
   }
   Changed |= doFinalization(CG);
   return Changed;
@@ -519,9 +691,10 @@ void CallGraphSCC::ReplaceNode(CallGraphNode *Old, CallGraphNode *New) {
   }
   
   // Update the active scc_iterator so that it doesn't contain dangling
-  // pointers to the old CallGraphNode.
-  scc_iterator<CallGraph*> *CGI = (scc_iterator<CallGraph*>*)Context;
-  CGI->ReplaceNode(Old, New);
+  // pointers to the old CallGraphNode.  SCCs visited a level at a time are
+  // found before any of them is visited, and have no iterator.
+  if (scc_iterator<CallGraph*> *CGI = (scc_iterator<CallGraph*>*)Context)
+    CGI->ReplaceNode(Old, New);
 }
 
 
@@ -18,6 +18,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/ValueMap.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
@@ -28,16 +29,90 @@
 #include "llvm/IR/Operator.h"
 #include "llvm/InstVisitor.h"
 #include "llvm/Support/CallSite.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
 #include "llvm/Support/raw_ostream.h"
+#include <climits>
 
 using namespace llvm;
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumCalleeWalksRecorded, "Number of callee walks recorded");
+STATISTIC(NumCalleeWalksReplayed, "Number of call sites analyzed by replaying "
+                                  "a recorded callee walk");
+
+static cl::opt<bool>
+CacheCalleeWalks("inline-cache-callee-walks", cl::Hidden, cl::init(true),
+                 cl::desc("Reuse the walk of a callee for call sites that "
+                          "tell nothing about its arguments"));
 
 namespace {
 
+/// \brief A recorded walk of a callee's body.
+///
+/// Unless a call site passes constants, pointers to allocas, pointers at a
+/// constant offset from their base or several pointers with the same base,
+/// walking the callee gives the same costs whatever the call site.  Only the
+/// cost and threshold the walk starts from, which decide when it bails out,
+/// and whether the caller is recursive differ.  A walk is recorded as the
+/// sequence of steps at which those come into play, so that later call sites
+/// can be analyzed by replaying it.
+struct CalleeWalk {
+  enum StepKind {
+    /// The start of a block; Cost includes its terminator.
+    BlockStep,
+    /// An instruction other than a terminator.
+    InstructionStep,
+    /// The end of the first block with more than one live successor.
+    MultipleSuccessorsStep
+  };
+
+  struct Step {
+    /// The cost of the walk up to and including this step.
+    int Cost;
+    unsigned char Kind;
+    /// For instructions, 2 if more than half the instructions so far were
+    /// vector instructions, 1 if more than a tenth were and 0 otherwise.
+    unsigned char VectorLevel;
+  };
+
+  std::vector<Step> Steps;
+
+  /// The step at which the walk found a construct that prevents inlining,
+  /// one at which it allocated more stack than a recursive caller allows,
+  /// and one at which it saw a noduplicate call; or ~0U if there is none.
+  unsigned AbortStep, BigAllocaStep, NoDuplicateStep;
+
+  /// Whether the walk reached the end of the callee.  If not, it stopped just
+  /// after its cost exceeded CostCap.
+  bool Complete;
+  int CostCap;
+
+  explicit CalleeWalk(int CostCap = 0)
+      : AbortStep(~0U), BigAllocaStep(~0U), NoDuplicateStep(~0U),
+        Complete(true), CostCap(CostCap) {}
+};
+
+} // namespace
+
+/// \brief The recorded walks of InlineCostAnalysis, by callee.
+class llvm::CalleeWalkCache {
+  struct Config : ValueMapConfig<const Function *> {
+    // Replacing the uses of a function doesn't change its body.
+    enum { FollowRAUW = false };
+  };
+
+public:
+  ValueMap<const Function *, CalleeWalk, Config> Walks;
+
+  /// The functions of the SCC being visited.
+  SmallPtrSet<const Function *, 8> CurrentSCC;
+};
+
+namespace {
+
+
 class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   typedef InstVisitor<CallAnalyzer, bool> Base;
   friend class InstVisitor<CallAnalyzer, bool>;
@@ -60,6 +135,12 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   bool HasDynamicAlloca;
   bool ContainsNoDuplicateCall;
 
+  /// Where recorded walks of callees are kept, or null if they aren't used.
+  CalleeWalkCache *WalkCache;
+
+  /// The walk being recorded, if this analyzer is recording one.
+  CalleeWalk *Recording;
+
   /// Number of bytes allocated statically by the callee.
   uint64_t AllocatedSize;
   unsigned NumInstructions, NumVectorInstructions;
@@ -105,6 +186,12 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
 
   // Custom analysis routines.
   bool analyzeBlock(BasicBlock *BB);
+  bool walkBlocks(bool &SingleBB, int SingleBBBonus);
+  bool hasPlainArguments();
+  const CalleeWalk *getRecordedWalk();
+  void recordWalk(CalleeWalk &W);
+  void recordStep(CalleeWalk::StepKind Kind);
+  bool replayWalk(const CalleeWalk &W, bool &SingleBB, int SingleBBBonus);
 
   // Disable several entry points to the visitor so we don't accidentally use
   // them by declaring but not defining them here.
@@ -135,11 +222,13 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
 
 public:
   CallAnalyzer(const DataLayout *TD, const TargetTransformInfo &TTI,
-               Function &Callee, int Threshold)
+               Function &Callee, int Threshold,
+               CalleeWalkCache *WalkCache = 0)
       : TD(TD), TTI(TTI), F(Callee), Threshold(Threshold), Cost(0),
         IsCallerRecursive(false), IsRecursiveCall(false),
         ExposesReturnsTwice(false), HasDynamicAlloca(false),
-        ContainsNoDuplicateCall(false), AllocatedSize(0), NumInstructions(0),
+        ContainsNoDuplicateCall(false), WalkCache(WalkCache), Recording(0),
+        AllocatedSize(0), NumInstructions(0),
         NumVectorInstructions(0), FiftyPercentVectorBonus(0),
         TenPercentVectorBonus(0), VectorBonus(0), NumConstantArgs(0),
         NumConstantOffsetPtrArgs(0), NumAllocaArgs(0), NumConstantPtrCmps(0),
@@ -823,6 +912,7 @@ bool CallAnalyzer::analyzeBlock(BasicBlock *BB) {
       ++NumInstructionsSimplified;
     else
       Cost += InlineConstants::InstrCost;
+    recordStep(CalleeWalk::InstructionStep);
 
     // If the visit this instruction detected an uninlinable pattern, abort.
     if (IsRecursiveCall || ExposesReturnsTwice || HasDynamicAlloca)
@@ -835,6 +925,16 @@ bool CallAnalyzer::analyzeBlock(BasicBlock *BB) {
         AllocatedSize > InlineConstants::TotalAllocaSizeRecursiveCaller)
       return false;
 
+    // A recording goes on until no call site it is replayed for could still
+    // be under its threshold.
+    if (Recording) {
+      if (Cost > Recording->CostCap) {
+        Recording->Complete = false;
+        return false;
+      }
+      continue;
+    }
+
     if (NumVectorInstructions > NumInstructions/2)
       VectorBonus = FiftyPercentVectorBonus;
     else if (NumVectorInstructions > NumInstructions/10)
@@ -889,6 +989,252 @@ ConstantInt *CallAnalyzer::stripAndComputeInBoundsConstantOffsets(Value *&V) {
   return cast<ConstantInt>(ConstantInt::get(IntPtrTy, Offset));
 }
 
+/// \brief Walk the blocks of the callee that stay live after inlining.
+///
+/// Returns false if inlining is not viable, and true once the walk is done or,
+/// if it crossed the threshold, has stopped.
+bool CallAnalyzer::walkBlocks(bool &SingleBB, int SingleBBBonus) {
+  // Track whether we've seen a return instruction. The first return
+  // instruction is free, as at least one will usually disappear in inlining.
+  bool HasReturn = false;
+
+  // The worklist of live basic blocks in the callee *after* inlining. We avoid
+  // adding basic blocks of the callee which can be proven to be dead for this
+  // particular call site in order to get more accurate cost estimates. This
+  // requires a somewhat heavyweight iteration pattern: we need to walk the
+  // basic blocks in a breadth-first order as we insert live successors. To
+  // accomplish this, prioritizing for small iterations because we exit after
+  // crossing our threshold, we use a small-size optimized SetVector.
+  typedef SetVector<BasicBlock *, SmallVector<BasicBlock *, 16>,
+                                  SmallPtrSet<BasicBlock *, 16> > BBSetVector;
+  BBSetVector BBWorklist;
+  BBWorklist.insert(&F.getEntryBlock());
+  // Note that we *must not* cache the size, this loop grows the worklist.
+  for (unsigned Idx = 0; Idx != BBWorklist.size(); ++Idx) {
+    // Bail out the moment we cross the threshold. This means we'll under-count
+    // the cost, but only when undercounting doesn't matter.
+    if (!Recording && Cost > (Threshold + VectorBonus))
+      break;
+
+    BasicBlock *BB = BBWorklist[Idx];
+    if (BB->empty())
+      continue;
+
+    // Handle the terminator cost here where we can track returns and other
+    // function-wide constructs.
+    TerminatorInst *TI = BB->getTerminator();
+
+    // We never want to inline functions that contain an indirectbr.  This is
+    // incorrect because all the blockaddress's (in static global initializers
+    // for example) would be referring to the original function, and this
+    // indirect jump would jump from the inlined copy of the function into the 
+    // original function which is extremely undefined behavior.
+    // FIXME: This logic isn't really right; we can safely inline functions
+    // with indirectbr's as long as no other function or global references the
+    // blockaddress of a block within the current function.  And as a QOI issue,
+    // if someone is using a blockaddress without an indirectbr, and that
+    // reference somehow ends up in another function or global, we probably
+    // don't want to inline this function.
+    if (isa<IndirectBrInst>(TI)) {
+      if (Recording) {
+        Recording->AbortStep = Recording->Steps.size();
+        recordStep(CalleeWalk::BlockStep);
+      }
+      return false;
+    }
+
+    if (!HasReturn && isa<ReturnInst>(TI))
+      HasReturn = true;
+    else
+      Cost += InlineConstants::InstrCost;
+    recordStep(CalleeWalk::BlockStep);
+
+    // Analyze the cost of this block. If we blow through the threshold, this
+    // returns false, and we can bail on out.
+    if (!analyzeBlock(BB)) {
+      if (IsRecursiveCall || ExposesReturnsTwice || HasDynamicAlloca)
+        return false;
+
+      // If the caller is a recursive function then we don't want to inline
+      // functions which allocate a lot of stack space because it would increase
+      // the caller stack usage dramatically.
+      if (IsCallerRecursive &&
+          AllocatedSize > InlineConstants::TotalAllocaSizeRecursiveCaller)
+        return false;
+
+      break;
+    }
+
+    // Add in the live successors by first checking whether we have terminator
+    // that may be simplified based on the values simplified by this call.
+    if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
+      if (BI->isConditional()) {
+        Value *Cond = BI->getCondition();
+        if (ConstantInt *SimpleCond
+              = dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
+          BBWorklist.insert(BI->getSuccessor(SimpleCond->isZero() ? 1 : 0));
+          continue;
+        }
+      }
+    } else if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
+      Value *Cond = SI->getCondition();
+      if (ConstantInt *SimpleCond
+            = dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
+        BBWorklist.insert(SI->findCaseValue(SimpleCond).getCaseSuccessor());
+        continue;
+      }
+    }
+
+    // If we're unable to select a particular successor, just count all of
+    // them.
+    for (unsigned TIdx = 0, TSize = TI->getNumSuccessors(); TIdx != TSize;
+         ++TIdx)
+      BBWorklist.insert(TI->getSuccessor(TIdx));
+
+    // If we had any successors at this point, than post-inlining is likely to
+    // have them as well. Note that we assume any basic blocks which existed
+    // due to branches or switches which folded above will also fold after
+    // inlining.
+    if (SingleBB && TI->getNumSuccessors() > 1) {
+      recordStep(CalleeWalk::MultipleSuccessorsStep);
+      // Take off the bonus we applied to the threshold.
+      Threshold -= SingleBBBonus;
+      SingleBB = false;
+    }
+  }
+
+  return true;
+}
+
+/// \brief Test whether the call site's arguments are the kind a recorded walk
+/// of the callee assumes.
+///
+/// These are arguments that give the walk nothing to simplify: no constants,
+/// no pointers to allocas, no pointers at a constant offset from their base
+/// and no two pointers with the same base.
+bool CallAnalyzer::hasPlainArguments() {
+  if (!SimplifiedValues.empty() || !SROAArgValues.empty())
+    return false;
+  SmallPtrSet<Value *, 8> Bases;
+  for (DenseMap<Value *, std::pair<Value *, APInt> >::iterator
+           I = ConstantOffsetPtrs.begin(), E = ConstantOffsetPtrs.end();
+       I != E; ++I)
+    if (I->second.second != 0 || !Bases.insert(I->second.first))
+      return false;
+  return true;
+}
+
+/// \brief Return a recorded walk of the callee that can be replayed for this
+/// call site, recording one if need be, or null if the callee must be walked.
+const CalleeWalk *CallAnalyzer::getRecordedWalk() {
+  if (!WalkCache || WalkCache->CurrentSCC.count(&F) || !hasPlainArguments())
+    return 0;
+
+  // A partial walk can only be replayed if it goes on until no threshold this
+  // call site could end up with has been met.
+  int64_t Needed = int64_t(Threshold) + FiftyPercentVectorBonus - Cost;
+  int CostCap = int(std::min<int64_t>(std::max<int64_t>(Needed, 0),
+                                       INT_MAX / 4));
+  CalleeWalk &W = WalkCache->Walks[&F];
+  if (!W.Steps.empty()) {
+    if (W.Complete || W.CostCap >= CostCap)
+      return &W;
+    // Record further than before so that this is rarely repeated.
+    CostCap = std::max(CostCap, std::min(W.CostCap, INT_MAX / 8) * 2);
+  }
+
+  W = CalleeWalk(CostCap);
+  CallAnalyzer(TD, TTI, F, 0).recordWalk(W);
+  ++NumCalleeWalksRecorded;
+  return &W;
+}
+
+/// \brief Walk the whole callee, assuming a call site with plain arguments,
+/// and record the steps in W.
+void CallAnalyzer::recordWalk(CalleeWalk &W) {
+  // Each pointer argument is its own base, at offset zero.
+  if (TD)
+    for (Function::arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+         AI != AE; ++AI)
+      if (AI->getType()->isPointerTy())
+        ConstantOffsetPtrs[AI] =
+            std::make_pair(AI, APInt::getNullValue(TD->getPointerSizeInBits()));
+
+  Recording = &W;
+  bool SingleBB = true;
+  walkBlocks(SingleBB, 0);
+  Recording = 0;
+}
+
+/// \brief Add a step to the walk being recorded, if there is one.
+void CallAnalyzer::recordStep(CalleeWalk::StepKind Kind) {
+  if (!Recording)
+    return;
+
+  unsigned Index = Recording->Steps.size();
+  CalleeWalk::Step S;
+  S.Cost = Cost;
+  S.Kind = Kind;
+  S.VectorLevel = 0;
+  if (Kind == CalleeWalk::InstructionStep) {
+    if (NumVectorInstructions > NumInstructions/2)
+      S.VectorLevel = 2;
+    else if (NumVectorInstructions > NumInstructions/10)
+      S.VectorLevel = 1;
+
+    if (IsRecursiveCall || ExposesReturnsTwice || HasDynamicAlloca)
+      Recording->AbortStep = Index;
+    if (Recording->BigAllocaStep == ~0U &&
+        AllocatedSize > InlineConstants::TotalAllocaSizeRecursiveCaller)
+      Recording->BigAllocaStep = Index;
+    if (Recording->NoDuplicateStep == ~0U && ContainsNoDuplicateCall)
+      Recording->NoDuplicateStep = Index;
+  }
+  Recording->Steps.push_back(S);
+}
+
+/// \brief Replay a recorded walk of the callee, making the same checks as
+/// walkBlocks and analyzeBlock would at each step.
+bool CallAnalyzer::replayWalk(const CalleeWalk &W, bool &SingleBB,
+                              int SingleBBBonus) {
+  int StartCost = Cost;
+  for (unsigned i = 0, e = W.Steps.size(); i != e; ++i) {
+    const CalleeWalk::Step &S = W.Steps[i];
+    switch (S.Kind) {
+    case CalleeWalk::BlockStep:
+      if (Cost > (Threshold + VectorBonus))
+        return true;
+      if (i == W.AbortStep)
+        return false;
+      Cost = StartCost + S.Cost;
+      break;
+
+    case CalleeWalk::InstructionStep:
+      Cost = StartCost + S.Cost;
+      if (i == W.NoDuplicateStep)
+        ContainsNoDuplicateCall = true;
+      if (i == W.AbortStep)
+        return false;
+      if (IsCallerRecursive && i >= W.BigAllocaStep)
+        return false;
+      VectorBonus = S.VectorLevel == 2 ? FiftyPercentVectorBonus :
+                    S.VectorLevel == 1 ? TenPercentVectorBonus : 0;
+      if (Cost > (Threshold + VectorBonus))
+        return true;
+      break;
+
+    case CalleeWalk::MultipleSuccessorsStep:
+      if (SingleBB) {
+        Threshold -= SingleBBBonus;
+        SingleBB = false;
+      }
+      break;
+    }
+  }
+  assert(W.Complete && "Replayed past the end of a partial walk!");
+  return true;
+}
+
 /// \brief Analyze a call site for potential inlining.
 ///
 /// Returns true if inlining this call is viable, and false if it is not
@@ -989,10 +1335,6 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
     }
   }
 
-  // Track whether we've seen a return instruction. The first return
-  // instruction is free, as at least one will usually disappear in inlining.
-  bool HasReturn = false;
-
   // Populate our simplified values by mapping from function arguments to call
   // arguments with known important simplifications.
   CallSite::arg_iterator CAI = CS.arg_begin();
@@ -1017,102 +1359,12 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   NumConstantOffsetPtrArgs = ConstantOffsetPtrs.size();
   NumAllocaArgs = SROAArgValues.size();
 
-  // The worklist of live basic blocks in the callee *after* inlining. We avoid
-  // adding basic blocks of the callee which can be proven to be dead for this
-  // particular call site in order to get more accurate cost estimates. This
-  // requires a somewhat heavyweight iteration pattern: we need to walk the
-  // basic blocks in a breadth-first order as we insert live successors. To
-  // accomplish this, prioritizing for small iterations because we exit after
-  // crossing our threshold, we use a small-size optimized SetVector.
-  typedef SetVector<BasicBlock *, SmallVector<BasicBlock *, 16>,
-                                  SmallPtrSet<BasicBlock *, 16> > BBSetVector;
-  BBSetVector BBWorklist;
-  BBWorklist.insert(&F.getEntryBlock());
-  // Note that we *must not* cache the size, this loop grows the worklist.
-  for (unsigned Idx = 0; Idx != BBWorklist.size(); ++Idx) {
-    // Bail out the moment we cross the threshold. This means we'll under-count
-    // the cost, but only when undercounting doesn't matter.
-    if (Cost > (Threshold + VectorBonus))
-      break;
-
-    BasicBlock *BB = BBWorklist[Idx];
-    if (BB->empty())
-      continue;
-
-    // Handle the terminator cost here where we can track returns and other
-    // function-wide constructs.
-    TerminatorInst *TI = BB->getTerminator();
-
-    // We never want to inline functions that contain an indirectbr.  This is
-    // incorrect because all the blockaddress's (in static global initializers
-    // for example) would be referring to the original function, and this
-    // indirect jump would jump from the inlined copy of the function into the 
-    // original function which is extremely undefined behavior.
-    // FIXME: This logic isn't really right; we can safely inline functions
-    // with indirectbr's as long as no other function or global references the
-    // blockaddress of a block within the current function.  And as a QOI issue,
-    // if someone is using a blockaddress without an indirectbr, and that
-    // reference somehow ends up in another function or global, we probably
-    // don't want to inline this function.
-    if (isa<IndirectBrInst>(TI))
+  if (const CalleeWalk *W = getRecordedWalk()) {
+    ++NumCalleeWalksReplayed;
+    if (!replayWalk(*W, SingleBB, SingleBBBonus))
       return false;
-
-    if (!HasReturn && isa<ReturnInst>(TI))
-      HasReturn = true;
-    else
-      Cost += InlineConstants::InstrCost;
-
-    // Analyze the cost of this block. If we blow through the threshold, this
-    // returns false, and we can bail on out.
-    if (!analyzeBlock(BB)) {
-      if (IsRecursiveCall || ExposesReturnsTwice || HasDynamicAlloca)
-        return false;
-
-      // If the caller is a recursive function then we don't want to inline
-      // functions which allocate a lot of stack space because it would increase
-      // the caller stack usage dramatically.
-      if (IsCallerRecursive &&
-          AllocatedSize > InlineConstants::TotalAllocaSizeRecursiveCaller)
-        return false;
-
-      break;
-    }
-
-    // Add in the live successors by first checking whether we have terminator
-    // that may be simplified based on the values simplified by this call.
-    if (BranchInst *BI = dyn_cast<BranchInst>(TI)) {
-      if (BI->isConditional()) {
-        Value *Cond = BI->getCondition();
-        if (ConstantInt *SimpleCond
-              = dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
-          BBWorklist.insert(BI->getSuccessor(SimpleCond->isZero() ? 1 : 0));
-          continue;
-        }
-      }
-    } else if (SwitchInst *SI = dyn_cast<SwitchInst>(TI)) {
-      Value *Cond = SI->getCondition();
-      if (ConstantInt *SimpleCond
-            = dyn_cast_or_null<ConstantInt>(SimplifiedValues.lookup(Cond))) {
-        BBWorklist.insert(SI->findCaseValue(SimpleCond).getCaseSuccessor());
-        continue;
-      }
-    }
-
-    // If we're unable to select a particular successor, just count all of
-    // them.
-    for (unsigned TIdx = 0, TSize = TI->getNumSuccessors(); TIdx != TSize;
-         ++TIdx)
-      BBWorklist.insert(TI->getSuccessor(TIdx));
-
-    // If we had any successors at this point, than post-inlining is likely to
-    // have them as well. Note that we assume any basic blocks which existed
-    // due to branches or switches which folded above will also fold after
-    // inlining.
-    if (SingleBB && TI->getNumSuccessors() > 1) {
-      // Take off the bonus we applied to the threshold.
-      Threshold -= SingleBBBonus;
-      SingleBB = false;
-    }
+  } else if (!walkBlocks(SingleBB, SingleBBBonus)) {
+    return false;
   }
 
   // If this is a noduplicate call, we can still inline as long as 
@@ -1151,7 +1403,8 @@ INITIALIZE_PASS_END(InlineCostAnalysis, "inline-cost", "Inline Cost Analysis",
 
 char InlineCostAnalysis::ID = 0;
 
-InlineCostAnalysis::InlineCostAnalysis() : CallGraphSCCPass(ID), TD(0) {}
+InlineCostAnalysis::InlineCostAnalysis()
+    : CallGraphSCCPass(ID), TD(0), WalkCache(new CalleeWalkCache()) {}
 
 InlineCostAnalysis::~InlineCostAnalysis() {}
 
@@ -1164,6 +1417,23 @@ void InlineCostAnalysis::getAnalysisUsage(AnalysisUsage &AU) const {
 bool InlineCostAnalysis::runOnSCC(CallGraphSCC &SCC) {
   TD = getAnalysisIfAvailable<DataLayout>();
   TTI = &getAnalysis<TargetTransformInfo>();
+
+  // The functions of this SCC are about to be changed, so forget their walks
+  // and don't record new ones until the next SCC is visited.
+  WalkCache->CurrentSCC.clear();
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I)
+    if (Function *F = (*I)->getFunction()) {
+      WalkCache->CurrentSCC.insert(F);
+      WalkCache->Walks.erase(F);
+    }
+  return false;
+}
+
+// The walks are kept from one SCC to the next, so releaseMemory, which the
+// pass manager calls after every SCC, leaves them alone.
+bool InlineCostAnalysis::doFinalization(CallGraph &CG) {
+  WalkCache->Walks.clear();
+  WalkCache->CurrentSCC.clear();
   return false;
 }
 
@@ -1220,7 +1490,8 @@ InlineCost InlineCostAnalysis::getInlineCost(CallSite CS, Function *Callee,
   DEBUG(llvm::dbgs() << "      Analyzing call of " << Callee->getName()
         << "...\n");
 
-  CallAnalyzer CA(TD, *TTI, *Callee, Threshold);
+  CallAnalyzer CA(TD, *TTI, *Callee, Threshold,
+                  CacheCalleeWalks ? WalkCache.get() : 0);
   bool ShouldInline = CA.analyzeCall(CS);
 
   DEBUG(CA.dump());
@@ -0,0 +1,72 @@
+//===- InstSimplifyCache.cpp - Cache of failed simplifications ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements InstSimplifyCache.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "instsimplify-cache"
+#include "llvm/Analysis/InstSimplifyCache.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/InstructionSimplify.h"
+#include "llvm/Analysis/Passes.h"
+#include "llvm/IR/Instruction.h"
+using namespace llvm;
+
+STATISTIC(NumHits, "Number of simplifications skipped as known failures");
+STATISTIC(NumMisses, "Number of simplifications attempted");
+
+char InstSimplifyCache::ID = 0;
+INITIALIZE_PASS(InstSimplifyCache, "instsimplify-cache",
+                "Cache of failed instruction simplifications", false, true)
+
+ImmutablePass *llvm::createInstSimplifyCachePass() {
+  return new InstSimplifyCache();
+}
+
+InstSimplifyCache::InstSimplifyCache() : ImmutablePass(ID) {
+  initializeInstSimplifyCachePass(*PassRegistry::getPassRegistry());
+}
+
+void InstSimplifyCache::CacheVH::deleted() {
+  assert(Cache && "CacheVH called with a null InstSimplifyCache!");
+  Cache->Failures.erase(getValPtr());
+  // this now dangles!
+}
+
+/// hashQuery - Hash what the result of simplifying I depends on directly.
+static size_t hashQuery(const Instruction *I, const DataLayout *TD,
+                        const TargetLibraryInfo *TLI,
+                        const DominatorTree *DT) {
+  hash_code H = hash_combine(TD, TLI, DT);
+  for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end();
+       OI != OE; ++OI)
+    H = hash_combine(H, OI->get());
+  return H;
+}
+
+Value *InstSimplifyCache::simplify(Instruction *I, const DataLayout *TD,
+                                   const TargetLibraryInfo *TLI,
+                                   const DominatorTree *DT) {
+  size_t Hash = hashQuery(I, TD, TLI, DT);
+  FailureMapType::iterator It = Failures.find(I);
+  if (It != Failures.end() && It->second == Hash) {
+    ++NumHits;
+    return 0;
+  }
+
+  ++NumMisses;
+  Value *V = SimplifyInstruction(I, TD, TLI, DT);
+  if (!V)
+    Failures[CacheVH(I, this)] = Hash;
+  else if (It != Failures.end())
+    Failures.erase(It);
+  return V;
+}
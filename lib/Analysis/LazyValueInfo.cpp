@@ -16,6 +16,7 @@
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/Constants.h"
@@ -23,17 +24,31 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ConstantRange.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/PatternMatch.h"
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLibraryInfo.h"
+#include <algorithm>
 #include <map>
 #include <stack>
 using namespace llvm;
 using namespace PatternMatch;
 
+STATISTIC(NumFastOverdefined,
+          "Number of queries answered overdefined without solving");
+STATISTIC(NumEvicted, "Number of values evicted from the cache");
+STATISTIC(MaxCacheEntries, "Largest number of block values cached");
+STATISTIC(MaxStackDepth, "Deepest value solver stack");
+
+static cl::opt<unsigned>
+MaxCacheSize("lvi-max-cache-entries", cl::init(100000), cl::Hidden,
+             cl::desc("Number of block values LazyValueInfo caches before "
+                      "evicting the least recently used values (0 = no "
+                      "limit)"));
+
 char LazyValueInfo::ID = 0;
 INITIALIZE_PASS_BEGIN(LazyValueInfo, "lazy-value-info",
                 "Lazy Value Information Analysis", false, true)
@@ -333,6 +348,14 @@ namespace {
     /// don't spend time removing unused blocks from our caches.
     DenseSet<AssertingVH<BasicBlock> > SeenBlocks;
 
+    /// NumEntries - The number of block values in ValueCache.
+    unsigned NumEntries;
+
+    /// LastUse - The time each value in ValueCache was last looked up, in
+    /// ticks of Tick, to find the least recently used values to evict.
+    DenseMap<Value*, unsigned> LastUse;
+    unsigned Tick;
+
     /// BlockValueStack - This stack holds the state of the value solver
     /// during a query.  It basically emulates the callstack of the naive
     /// recursive value lookup process.
@@ -380,10 +403,28 @@ namespace {
     void solve();
     
     ValueCacheEntryTy &lookup(Value *V) {
+      LastUse[V] = ++Tick;
       return ValueCache[LVIValueHandle(V, this)];
     }
 
+    /// getEntry - Return the cached value of V at the end of BB, adding an
+    /// undefined one if there is none.
+    LVILatticeVal &getEntry(Value *V, BasicBlock *BB) {
+      ValueCacheEntryTy &Cache = lookup(V);
+      size_t OldSize = Cache.size();
+      LVILatticeVal &LV = Cache[BB];
+      if (Cache.size() != OldSize && ++NumEntries > MaxCacheEntries)
+        MaxCacheEntries = NumEntries;
+      return LV;
+    }
+
+    /// evict - Drop the least recently used values from the cache until it
+    /// is well under its size limit.  This must not be done while solving.
+    void evict();
+
   public:
+    LazyValueInfoCache() : NumEntries(0), Tick(0) {}
+
     /// getValueInBlock - This is the query interface to determine the lattice
     /// value for the specified Value* at the end of the specified block.
     LVILatticeVal getValueInBlock(Value *V, BasicBlock *BB);
@@ -406,6 +447,8 @@ namespace {
       SeenBlocks.clear();
       ValueCache.clear();
       OverDefinedCache.clear();
+      LastUse.clear();
+      NumEntries = 0;
     }
   };
 } // end anonymous namespace
@@ -426,9 +469,16 @@ void LVIValueHandle::deleted() {
        E = ToErase.end(); I != E; ++I)
     Parent->OverDefinedCache.erase(*I);
   
+  Parent->LastUse.erase(getValPtr());
+  std::map<LVIValueHandle, LazyValueInfoCache::ValueCacheEntryTy>::iterator
+    I = Parent->ValueCache.find(*this);
+  if (I == Parent->ValueCache.end())
+    return;
+  Parent->NumEntries -= I->second.size();
+
   // This erasure deallocates *this, so it MUST happen after we're done
   // using any and all members of *this.
-  Parent->ValueCache.erase(*this);
+  Parent->ValueCache.erase(I);
 }
 
 void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
@@ -451,11 +501,49 @@ void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
 
   for (std::map<LVIValueHandle, ValueCacheEntryTy>::iterator
        I = ValueCache.begin(), E = ValueCache.end(); I != E; ++I)
-    I->second.erase(BB);
+    NumEntries -= I->second.erase(BB);
+}
+
+void LazyValueInfoCache::evict() {
+  std::vector<std::pair<unsigned, Value*> > ByAge;
+  for (std::map<LVIValueHandle, ValueCacheEntryTy>::iterator
+       I = ValueCache.begin(), E = ValueCache.end(); I != E; ++I) {
+    Value *V = I->first;
+    ByAge.push_back(std::make_pair(LastUse.lookup(V), V));
+  }
+  std::sort(ByAge.begin(), ByAge.end());
+
+  // Go down to three quarters of the limit, so that the cost of sorting is
+  // spread over many queries.
+  unsigned Target = MaxCacheSize / 4 * 3;
+  DenseSet<Value*> Evicted;
+  for (unsigned i = 0, e = ByAge.size(); i != e && NumEntries > Target; ++i) {
+    Value *V = ByAge[i].second;
+    std::map<LVIValueHandle, ValueCacheEntryTy>::iterator I =
+      ValueCache.find(LVIValueHandle(V, this));
+    NumEntries -= I->second.size();
+    ValueCache.erase(I);
+    LastUse.erase(V);
+    Evicted.insert(V);
+    ++NumEvicted;
+  }
+
+  SmallVector<OverDefinedPairTy, 16> ToErase;
+  for (DenseSet<OverDefinedPairTy>::iterator I = OverDefinedCache.begin(),
+       E = OverDefinedCache.end(); I != E; ++I) {
+    if (Evicted.count(I->second))
+      ToErase.push_back(*I);
+  }
+
+  for (SmallVectorImpl<OverDefinedPairTy>::iterator I = ToErase.begin(),
+       E = ToErase.end(); I != E; ++I)
+    OverDefinedCache.erase(*I);
 }
 
 void LazyValueInfoCache::solve() {
   while (!BlockValueStack.empty()) {
+    if (BlockValueStack.size() > MaxStackDepth)
+      MaxStackDepth = BlockValueStack.size();
     std::pair<BasicBlock*, Value*> &e = BlockValueStack.top();
     if (solveBlockValue(e.second, e.first)) {
       assert(BlockValueStack.top() == e);
@@ -482,16 +570,15 @@ LVILatticeVal LazyValueInfoCache::getBlockValue(Value *Val, BasicBlock *BB) {
     return LVILatticeVal::get(VC);
 
   SeenBlocks.insert(BB);
-  return lookup(Val)[BB];
+  return getEntry(Val, BB);
 }
 
 bool LazyValueInfoCache::solveBlockValue(Value *Val, BasicBlock *BB) {
   if (isa<Constant>(Val))
     return true;
 
-  ValueCacheEntryTy &Cache = lookup(Val);
   SeenBlocks.insert(BB);
-  LVILatticeVal &BBLV = Cache[BB];
+  LVILatticeVal &BBLV = getEntry(Val, BB);
   
   // OverDefinedCacheUpdater is a helper object that will update
   // the OverDefinedCache for us when this method exits.  Make sure to
@@ -909,13 +996,45 @@ bool LazyValueInfoCache::getEdgeValue(Value *Val, BasicBlock *BBFrom,
   return true;
 }
 
+/// isTriviallyOverdefined - Return true if V is overdefined everywhere
+/// because nothing the solver looks at can constrain it: it is not a pointer,
+/// it is not computed from operands the solver can reason about, and no
+/// comparison, branch or switch uses it.  Looking for users is much cheaper
+/// than walking every path back to the definition to find that out.
+static bool isTriviallyOverdefined(Value *V) {
+  if (!isa<Argument>(V) && !isa<Instruction>(V))
+    return false;
+  if (V->getType()->isPointerTy() || isa<PHINode>(V) ||
+      isa<BinaryOperator>(V) || isa<CastInst>(V))
+    return false;
+  for (Value::use_iterator UI = V->use_begin(), E = V->use_end(); UI != E;
+       ++UI) {
+    // An add can feed the range check idiom that getEdgeValueLocal matches.
+    User *U = *UI;
+    if (isa<ICmpInst>(U) || isa<BranchInst>(U) || isa<SwitchInst>(U) ||
+        (isa<BinaryOperator>(U) &&
+         cast<BinaryOperator>(U)->getOpcode() == Instruction::Add))
+      return false;
+  }
+  return true;
+}
+
 LVILatticeVal LazyValueInfoCache::getValueInBlock(Value *V, BasicBlock *BB) {
   DEBUG(dbgs() << "LVI Getting block end value " << *V << " at '"
         << BB->getName() << "'\n");
   
+  LVILatticeVal Result;
+  if (isTriviallyOverdefined(V)) {
+    ++NumFastOverdefined;
+    Result.markOverdefined();
+    return Result;
+  }
+  if (MaxCacheSize && NumEntries > MaxCacheSize)
+    evict();
+
   BlockValueStack.push(std::make_pair(BB, V));
   solve();
-  LVILatticeVal Result = getBlockValue(V, BB);
+  Result = getBlockValue(V, BB);
 
   DEBUG(dbgs() << "  Result = " << Result << "\n");
   return Result;
@@ -927,6 +1046,14 @@ getValueOnEdge(Value *V, BasicBlock *FromBB, BasicBlock *ToBB) {
         << FromBB->getName() << "' to '" << ToBB->getName() << "'\n");
   
   LVILatticeVal Result;
+  if (isTriviallyOverdefined(V)) {
+    ++NumFastOverdefined;
+    Result.markOverdefined();
+    return Result;
+  }
+  if (MaxCacheSize && NumEntries > MaxCacheSize)
+    evict();
+
   if (!getEdgeValue(V, FromBB, ToBB, Result)) {
     solve();
     bool WasFastQuery = getEdgeValue(V, FromBB, ToBB, Result);
@@ -985,6 +1112,7 @@ void LazyValueInfoCache::threadEdge(BasicBlock *PredBB, BasicBlock *OldSucc,
 
       assert(CI != Entry.end() && "Couldn't find entry to update?");
       Entry.erase(CI);
+      --NumEntries;
       OverDefinedCache.erase(OI);
 
       // If we removed anything, then we potentially need to update 
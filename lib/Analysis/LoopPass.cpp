@@ -14,6 +14,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Assembly/PrintModulePass.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Timer.h"
@@ -228,8 +229,13 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        PassInstrumentationRegion PIR(P, *F.getParent(), &F);
 
-        Changed |= P->runOnLoop(CurrentLoop, *this);
+        bool LocalChanged = false;
+        if (PIR.shouldRunPass())
+          LocalChanged = P->runOnLoop(CurrentLoop, *this);
+        PIR.passExecuted(LocalChanged);
+        Changed |= LocalChanged;
       }
 
       if (Changed)
@@ -279,6 +285,14 @@ bool LPPassManager::runOnFunction(Function &F) {
 
     if (redoThisLoop)
       LQ.push_back(CurrentLoop);
+    else if (!skipThisLoop)
+      if (ScalarEvolution *SE = getAnalysisIfAvailable<ScalarEvolution>()) {
+        // Loops are visited innermost first, so a finished top-level loop
+        // means its whole nest is done with.
+        if (!CurrentLoop->getParentLoop())
+          SE->releaseLoop(CurrentLoop);
+        SE->applyCacheBudget();
+      }
   }
 
   // Finalization
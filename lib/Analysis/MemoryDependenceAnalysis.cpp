@@ -29,10 +29,15 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/PredIteratorCache.h"
 using namespace llvm;
 
+STATISTIC(NumCacheLocal, "Number of cached local responses");
+STATISTIC(NumUncacheLocal, "Number of uncached local responses");
+STATISTIC(NumScanLimit, "Number of block scans stopped by the scan limit");
+
 STATISTIC(NumCacheNonLocal, "Number of fully cached non-local responses");
 STATISTIC(NumCacheDirtyNonLocal, "Number of dirty cached non-local responses");
 STATISTIC(NumUncacheNonLocal, "Number of uncached non-local responses");
@@ -45,9 +50,20 @@ STATISTIC(NumUncacheNonLocalPtr,
           "Number of uncached non-local ptr responses");
 STATISTIC(NumCacheCompleteNonLocalPtr,
           "Number of block queries that were completely cached");
+STATISTIC(NumInvalidatedNonLocalPtr,
+          "Number of cached non-local ptr responses invalidated");
+STATISTIC(NumFlushedNonLocalPtr,
+          "Number of non-local ptr caches flushed completely");
 
 // Limit for the number of instructions to scan in a block.
-static const int BlockScanLimit = 100;
+static cl::opt<unsigned>
+BlockScanLimit("memdep-block-scan-limit", cl::Hidden, cl::init(100),
+               cl::desc("The number of instructions to scan in a block in "
+                        "memory dependency analysis (default = 100)"));
+
+// Limit for the number of uses to follow when looking for the blocks that
+// invalidateCachedPointerInfo needs to invalidate.
+static const unsigned InvalidateUseLimit = 64;
 
 char MemoryDependenceAnalysis::ID = 0;
 
@@ -198,8 +214,10 @@ getCallSiteDependencyFrom(CallSite CS, bool isReadOnlyCall,
     // Limit the amount of scanning we do so we don't end up with quadratic
     // running time on extreme testcases.
     --Limit;
-    if (!Limit)
+    if (!Limit) {
+      ++NumScanLimit;
       return MemDepResult::getUnknown();
+    }
 
     Instruction *Inst = --ScanIt;
 
@@ -380,8 +398,10 @@ getPointerDependencyFrom(const AliasAnalysis::Location &MemLoc, bool isLoad,
     // Limit the amount of scanning we do so we don't end up with quadratic
     // running time on extreme testcases.
     --Limit;
-    if (!Limit)
+    if (!Limit) {
+      ++NumScanLimit;
       return MemDepResult::getUnknown();
+    }
 
     if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(Inst)) {
       // If we reach a lifetime begin or end marker, then the query ends here
@@ -551,8 +571,11 @@ MemDepResult MemoryDependenceAnalysis::getDependency(Instruction *QueryInst) {
 
   // If the cached entry is non-dirty, just return it.  Note that this depends
   // on MemDepResult's default constructing to 'dirty'.
-  if (!LocalCache.isDirty())
+  if (!LocalCache.isDirty()) {
+    ++NumCacheLocal;
     return LocalCache;
+  }
+  ++NumUncacheLocal;
 
   // Otherwise, if we have a dirty entry, we know we can start the scan at that
   // instruction, which may save us some work.
@@ -1294,13 +1317,83 @@ RemoveCachedNonLocalPointerDependencies(ValueIsLoadPair P) {
 /// the client detects an equivalence between the pointer and some other
 /// value and replaces the other value with ptr. This can make Ptr available
 /// in more places that cached info does not necessarily keep.
+/// RemoveCachedNonLocalPointerDependencies - Remove the entries for the blocks
+/// in Blocks from the cached info for P, if there is any.
+void MemoryDependenceAnalysis::RemoveCachedNonLocalPointerDependencies(
+    ValueIsLoadPair P, const SmallPtrSet<BasicBlock*, 16> &Blocks) {
+  CachedNonLocalPointerInfo::iterator It = NonLocalPointerDeps.find(P);
+  if (It == NonLocalPointerDeps.end()) return;
+
+  // Compact the entries that are kept to the front, which keeps them sorted.
+  NonLocalDepInfo &PInfo = It->second.NonLocalDeps;
+  NonLocalDepInfo::iterator Out = PInfo.begin();
+  for (NonLocalDepInfo::iterator I = PInfo.begin(), E = PInfo.end(); I != E;
+       ++I) {
+    if (!Blocks.count(I->getBB())) {
+      *Out++ = *I;
+      continue;
+    }
+    if (Instruction *Target = I->getResult().getInst())
+      RemoveFromReverseMap(ReverseNonLocalPtrDeps, Target, P);
+    ++NumInvalidatedNonLocalPtr;
+  }
+  if (Out == PInfo.end()) return;
+
+  // The cache no longer holds the complete result of a query.
+  PInfo.erase(Out, PInfo.end());
+  It->second.Pair = BBSkipFirstBlockPair();
+}
+
+/// FindBlocksAccessingPointer - Add to Blocks every block that accesses memory
+/// through Ptr or through a pointer computed from it.  Return false if Ptr
+/// has too many uses to look at them all.
+static bool FindBlocksAccessingPointer(Value *Ptr,
+                                       SmallPtrSet<BasicBlock*, 16> &Blocks) {
+  SmallVector<Value*, 16> Worklist;
+  SmallPtrSet<Value*, 16> Visited;
+  Worklist.push_back(Ptr);
+  Visited.insert(Ptr);
+  unsigned NumUses = 0;
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    for (Value::use_iterator UI = V->use_begin(), UE = V->use_end(); UI != UE;
+         ++UI) {
+      if (++NumUses > InvalidateUseLimit)
+        return false;
+      Instruction *I = dyn_cast<Instruction>(*UI);
+      if (!I) continue;
+      if (I->mayReadOrWriteMemory())
+        Blocks.insert(I->getParent());
+      if (I->getType()->getScalarType()->isPointerTy() && Visited.insert(I))
+        Worklist.push_back(I);
+    }
+  }
+  return true;
+}
+
 void MemoryDependenceAnalysis::invalidateCachedPointerInfo(Value *Ptr) {
   // If Ptr isn't really a pointer, just ignore it.
   if (!Ptr->getType()->isPointerTy()) return;
+  ValueIsLoadPair StoreKey(Ptr, false), LoadKey(Ptr, true);
+  if (!NonLocalPointerDeps.count(StoreKey) &&
+      !NonLocalPointerDeps.count(LoadKey))
+    return;
+
+  // The equivalence only changes what memdep concludes in blocks where Ptr is
+  // now used to access memory; the cached results for every other block are
+  // still exact.
+  SmallPtrSet<BasicBlock*, 16> Blocks;
+  if (FindBlocksAccessingPointer(Ptr, Blocks)) {
+    RemoveCachedNonLocalPointerDependencies(StoreKey, Blocks);
+    RemoveCachedNonLocalPointerDependencies(LoadKey, Blocks);
+    return;
+  }
+
+  ++NumFlushedNonLocalPtr;
   // Flush store info for the pointer.
-  RemoveCachedNonLocalPointerDependencies(ValueIsLoadPair(Ptr, false));
+  RemoveCachedNonLocalPointerDependencies(StoreKey);
   // Flush load info for the pointer.
-  RemoveCachedNonLocalPointerDependencies(ValueIsLoadPair(Ptr, true));
+  RemoveCachedNonLocalPointerDependencies(LoadKey);
 }
 
 /// invalidateCachedPredecessors - Clear the PredIteratorCache info.
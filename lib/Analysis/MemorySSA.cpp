@@ -0,0 +1,463 @@
+//===- MemorySSA.cpp - SSA form for memory --------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the MemorySSA analysis.  Phis are placed at the
+// iterated dominance frontier of the blocks that write memory, and accesses
+// are then linked to their reaching version by walking the dominator tree,
+// as for scalar SSA construction.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "memoryssa"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/Passes.h"
+#include "llvm/Assembly/AssemblyAnnotationWriter.h"
+#include "llvm/Assembly/Writer.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+STATISTIC(NumMemoryPhis, "Number of memory phis placed");
+STATISTIC(NumClobberQueries, "Number of clobber queries");
+STATISTIC(NumCachedClobberQueries, "Number of clobber queries answered "
+                                   "from the cache");
+
+static cl::opt<unsigned>
+WalkLimit("memoryssa-walk-limit", cl::Hidden, cl::init(100),
+          cl::desc("The number of memory defs a clobber query may look at "
+                   "before giving up (default = 100)"));
+
+char MemorySSA::ID = 0;
+INITIALIZE_PASS_BEGIN(MemorySSA, "memoryssa", "Memory SSA", false, true)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_DEPENDENCY(DominatorTree)
+INITIALIZE_PASS_END(MemorySSA, "memoryssa", "Memory SSA", false, true)
+
+FunctionPass *llvm::createMemorySSAPass() { return new MemorySSA(); }
+
+//===----------------------------------------------------------------------===//
+// MemoryAccess implementation
+//===----------------------------------------------------------------------===//
+
+MemoryAccess::~MemoryAccess() {}
+
+void MemoryAccess::dump() const {
+  print(dbgs());
+  dbgs() << '\n';
+}
+
+/// printID - Print how an access is referred to as an operand.
+static void printID(raw_ostream &OS, const MemoryAccess *MA) {
+  if (const MemoryDef *Def = dyn_cast<MemoryDef>(MA)) {
+    if (Def->getID() == 0)
+      OS << "liveOnEntry";
+    else
+      OS << Def->getID();
+  } else if (const MemoryPhi *Phi = dyn_cast<MemoryPhi>(MA)) {
+    OS << Phi->getID();
+  } else {
+    OS << "<use>";
+  }
+}
+
+void MemoryUse::print(raw_ostream &OS) const {
+  OS << "MemoryUse(";
+  printID(OS, getDefiningAccess());
+  OS << ')';
+}
+
+void MemoryDef::print(raw_ostream &OS) const {
+  OS << getID() << " = MemoryDef(";
+  printID(OS, getDefiningAccess());
+  OS << ')';
+}
+
+void MemoryPhi::print(raw_ostream &OS) const {
+  OS << getID() << " = MemoryPhi(";
+  for (unsigned i = 0, e = getNumIncomingValues(); i != e; ++i) {
+    if (i)
+      OS << ',';
+    OS << '{';
+    WriteAsOperand(OS, getIncomingBlock(i), false);
+    OS << ',';
+    printID(OS, getIncomingValue(i));
+    OS << '}';
+  }
+  OS << ')';
+}
+
+//===----------------------------------------------------------------------===//
+// MemorySSA construction
+//===----------------------------------------------------------------------===//
+
+MemorySSA::MemorySSA() : FunctionPass(ID), LiveOnEntryDef(0) {
+  initializeMemorySSAPass(*PassRegistry::getPassRegistry());
+}
+
+MemorySSA::~MemorySSA() {
+  releaseMemory();
+}
+
+void MemorySSA::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesAll();
+  AU.addRequiredTransitive<AliasAnalysis>();
+  AU.addRequiredTransitive<DominatorTree>();
+}
+
+void MemorySSA::releaseMemory() {
+  for (DenseMap<const BasicBlock*, AccessList*>::iterator
+       I = BlockAccesses.begin(), E = BlockAccesses.end(); I != E; ++I) {
+    AccessList *Accesses = I->second;
+    for (unsigned i = 0, e = Accesses->size(); i != e; ++i)
+      delete (*Accesses)[i];
+    delete Accesses;
+  }
+  BlockAccesses.clear();
+  InstructionAccesses.clear();
+  ClobberCache.clear();
+  delete LiveOnEntryDef;
+  LiveOnEntryDef = 0;
+}
+
+MemorySSA::AccessList &MemorySSA::getOrCreateAccessList(BasicBlock *BB) {
+  AccessList *&Accesses = BlockAccesses[BB];
+  if (!Accesses)
+    Accesses = new AccessList();
+  return *Accesses;
+}
+
+MemoryPhi *MemorySSA::getMemoryPhi(const BasicBlock *BB) const {
+  AccessList *Accesses = BlockAccesses.lookup(BB);
+  if (!Accesses || Accesses->empty())
+    return 0;
+  return dyn_cast<MemoryPhi>(Accesses->front());
+}
+
+void MemorySSA::setDefiningAccess(MemoryUseOrDef *MA, MemoryAccess *Def) {
+  if (MA->DefiningAccess)
+    removeUser(MA->DefiningAccess, MA);
+  MA->DefiningAccess = Def;
+  Def->Users.push_back(MA);
+}
+
+void MemorySSA::addIncoming(MemoryPhi *Phi, BasicBlock *BB,
+                            MemoryAccess *Def) {
+  Phi->Incoming.push_back(std::make_pair(BB, Def));
+  Def->Users.push_back(Phi);
+}
+
+/// removeUser - Remove one occurrence of User from the users of Def.
+void MemorySSA::removeUser(MemoryAccess *Def, MemoryAccess *User) {
+  std::vector<MemoryAccess*>::iterator I =
+    std::find(Def->Users.begin(), Def->Users.end(), User);
+  assert(I != Def->Users.end() && "User not found!");
+  Def->Users.erase(I);
+}
+
+/// placePhis - Insert a MemoryPhi at the start of every block in the iterated
+/// dominance frontier of DefBlocks.
+void MemorySSA::placePhis(const SmallVectorImpl<BasicBlock*> &DefBlocks) {
+  // Compute the dominance frontier of every reachable block, by walking up
+  // the dominator tree from each predecessor of a join point until its
+  // immediate dominator is reached.
+  DenseMap<BasicBlock*, SmallVector<BasicBlock*, 4> > Frontiers;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    if (!DT->isReachableFromEntry(BB))
+      continue;
+    pred_iterator PI = pred_begin(BB), PE = pred_end(BB);
+    if (PI == PE || llvm::next(PI) == PE)
+      continue;
+    DomTreeNode *IDom = DT->getNode(BB)->getIDom();
+    for (; PI != PE; ++PI) {
+      if (!DT->isReachableFromEntry(*PI))
+        continue;
+      for (DomTreeNode *Runner = DT->getNode(*PI); Runner && Runner != IDom;
+           Runner = Runner->getIDom()) {
+        SmallVectorImpl<BasicBlock*> &DF = Frontiers[Runner->getBlock()];
+        if (DF.empty() || DF.back() != BB)
+          DF.push_back(BB);
+      }
+    }
+  }
+
+  SmallVector<BasicBlock*, 32> Worklist(DefBlocks.begin(), DefBlocks.end());
+  SmallPtrSet<BasicBlock*, 32> Queued(DefBlocks.begin(), DefBlocks.end());
+  SmallPtrSet<BasicBlock*, 32> HasPhi;
+  while (!Worklist.empty()) {
+    BasicBlock *BB = Worklist.pop_back_val();
+    DenseMap<BasicBlock*, SmallVector<BasicBlock*, 4> >::iterator DFI =
+      Frontiers.find(BB);
+    if (DFI == Frontiers.end())
+      continue;
+    for (unsigned i = 0, e = DFI->second.size(); i != e; ++i) {
+      BasicBlock *Join = DFI->second[i];
+      if (!HasPhi.insert(Join))
+        continue;
+      AccessList &Accesses = getOrCreateAccessList(Join);
+      Accesses.insert(Accesses.begin(), new MemoryPhi(Join, NextID++));
+      ++NumMemoryPhis;
+      // The phi is a new def in Join.
+      if (Queued.insert(Join))
+        Worklist.push_back(Join);
+    }
+  }
+}
+
+/// renameAccesses - Link every access to the version of memory reaching it.
+void MemorySSA::renameAccesses() {
+  // Walk the dominator tree, carrying the version live at the end of each
+  // block's immediate dominator.
+  SmallVector<std::pair<DomTreeNode*, MemoryAccess*>, 32> Worklist;
+  SmallPtrSet<BasicBlock*, 32> Visited;
+  Worklist.push_back(std::make_pair(DT->getRootNode(),
+                                    (MemoryAccess*)LiveOnEntryDef));
+  while (!Worklist.empty()) {
+    DomTreeNode *Node = Worklist.back().first;
+    MemoryAccess *Incoming = Worklist.back().second;
+    Worklist.pop_back();
+
+    BasicBlock *BB = Node->getBlock();
+    Visited.insert(BB);
+    if (AccessList *Accesses = BlockAccesses.lookup(BB)) {
+      for (unsigned i = 0, e = Accesses->size(); i != e; ++i) {
+        MemoryAccess *MA = (*Accesses)[i];
+        if (MemoryUseOrDef *UseOrDef = dyn_cast<MemoryUseOrDef>(MA))
+          setDefiningAccess(UseOrDef, Incoming);
+        if (!isa<MemoryUse>(MA))
+          Incoming = MA;
+      }
+    }
+
+    for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; ++SI)
+      if (MemoryPhi *Phi = getMemoryPhi(*SI))
+        addIncoming(Phi, BB, Incoming);
+
+    for (DomTreeNode::iterator CI = Node->begin(), CE = Node->end(); CI != CE;
+         ++CI)
+      Worklist.push_back(std::make_pair(*CI, Incoming));
+  }
+
+  // Nothing reaches the accesses in unreachable blocks; give them the
+  // live-on-entry def so that every access has a defining access.
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    if (Visited.count(BB))
+      continue;
+    if (AccessList *Accesses = BlockAccesses.lookup(BB))
+      for (unsigned i = 0, e = Accesses->size(); i != e; ++i)
+        if (MemoryUseOrDef *UseOrDef = dyn_cast<MemoryUseOrDef>((*Accesses)[i]))
+          setDefiningAccess(UseOrDef, LiveOnEntryDef);
+    for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE; ++SI)
+      if (MemoryPhi *Phi = getMemoryPhi(*SI))
+        addIncoming(Phi, BB, LiveOnEntryDef);
+  }
+}
+
+bool MemorySSA::runOnFunction(Function &Fn) {
+  F = &Fn;
+  AA = &getAnalysis<AliasAnalysis>();
+  DT = &getAnalysis<DominatorTree>();
+
+  NextID = 0;
+  LiveOnEntryDef = new MemoryDef(0, &F->getEntryBlock(), NextID++);
+
+  SmallVector<BasicBlock*, 32> DefBlocks;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    bool HasDef = false;
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      bool Def = I->mayWriteToMemory();
+      if (!Def && !I->mayReadFromMemory())
+        continue;
+      MemoryUseOrDef *MA;
+      if (Def)
+        MA = new MemoryDef(I, BB, NextID++);
+      else
+        MA = new MemoryUse(I, BB);
+      getOrCreateAccessList(BB).push_back(MA);
+      InstructionAccesses[I] = MA;
+      HasDef |= Def;
+    }
+    if (HasDef && DT->isReachableFromEntry(BB))
+      DefBlocks.push_back(BB);
+  }
+
+  placePhis(DefBlocks);
+  renameAccesses();
+  return false;
+}
+
+//===----------------------------------------------------------------------===//
+// Clobber queries
+//===----------------------------------------------------------------------===//
+
+/// walkToClobber - Walk up from Start to the nearest access that may clobber
+/// Loc.  Visited holds the phis seen by this query and what they resolved
+/// to; a phi that is still being resolved maps to null, and reaching it again
+/// around a loop adds nothing new.  Returns null only in that case.
+MemoryAccess *
+MemorySSA::walkToClobber(MemoryAccess *Start,
+                         const AliasAnalysis::Location &Loc,
+                         DenseMap<MemoryPhi*, MemoryAccess*> &Visited,
+                         unsigned &Budget) const {
+  MemoryAccess *Current = Start;
+  while (MemoryDef *Def = dyn_cast<MemoryDef>(Current)) {
+    if (isLiveOnEntryDef(Def))
+      return Def;
+    // Out of budget: conservatively treat this def as the clobber.
+    if (Budget == 0)
+      return Def;
+    --Budget;
+    if (AA->getModRefInfo(Def->getMemoryInst(), Loc) & AliasAnalysis::Mod)
+      return Def;
+    Current = Def->getDefiningAccess();
+  }
+
+  MemoryPhi *Phi = cast<MemoryPhi>(Current);
+  std::pair<DenseMap<MemoryPhi*, MemoryAccess*>::iterator, bool> Ins =
+    Visited.insert(std::make_pair(Phi, (MemoryAccess*)0));
+  if (!Ins.second)
+    return Ins.first->second;
+
+  // If every path into the phi reaches the same clobber, that is the answer;
+  // otherwise the phi itself is.
+  MemoryAccess *Result = 0;
+  for (unsigned i = 0, e = Phi->getNumIncomingValues(); i != e; ++i) {
+    MemoryAccess *Clobber =
+      walkToClobber(Phi->getIncomingValue(i), Loc, Visited, Budget);
+    if (!Clobber || Clobber == Result)
+      continue;
+    if (Result) {
+      Result = Phi;
+      break;
+    }
+    Result = Clobber;
+  }
+  if (!Result)
+    Result = Phi;
+  Visited[Phi] = Result;
+  return Result;
+}
+
+MemoryAccess *
+MemorySSA::getClobberingMemoryAccess(MemoryAccess *Start,
+                                     const AliasAnalysis::Location &Loc) const {
+  DenseMap<MemoryPhi*, MemoryAccess*> Visited;
+  unsigned Budget = WalkLimit;
+  return walkToClobber(Start, Loc, Visited, Budget);
+}
+
+MemoryAccess *
+MemorySSA::getClobberingMemoryAccess(const Instruction *I) const {
+  MemoryUseOrDef *MA = getMemoryAccess(I);
+  if (!MA)
+    return 0;
+
+  ++NumClobberQueries;
+  DenseMap<const MemoryAccess*, MemoryAccess*>::iterator CI =
+    ClobberCache.find(MA);
+  if (CI != ClobberCache.end()) {
+    ++NumCachedClobberQueries;
+    return CI->second;
+  }
+
+  MemoryAccess *Result = MA->getDefiningAccess();
+  AliasAnalysis::Location Loc;
+  if (const LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    if (LI->isUnordered())
+      Loc = AA->getLocation(LI);
+  } else if (const StoreInst *SI = dyn_cast<StoreInst>(I)) {
+    if (SI->isUnordered())
+      Loc = AA->getLocation(SI);
+  }
+  if (Loc.Ptr)
+    Result = getClobberingMemoryAccess(Result, Loc);
+
+  ClobberCache[MA] = Result;
+  return Result;
+}
+
+void MemorySSA::removeMemoryAccess(MemoryUseOrDef *MA) {
+  assert(!isLiveOnEntryDef(MA) && "Can't remove the live-on-entry def!");
+  MemoryAccess *NewDef = MA->getDefiningAccess();
+
+  // Give the users of the access its defining access instead.
+  std::vector<MemoryAccess*> Users(MA->Users);
+  for (unsigned i = 0, e = Users.size(); i != e; ++i) {
+    if (MemoryUseOrDef *User = dyn_cast<MemoryUseOrDef>(Users[i])) {
+      setDefiningAccess(User, NewDef);
+      continue;
+    }
+    MemoryPhi *Phi = cast<MemoryPhi>(Users[i]);
+    for (unsigned j = 0, je = Phi->getNumIncomingValues(); j != je; ++j)
+      if (Phi->Incoming[j].second == MA) {
+        Phi->Incoming[j].second = NewDef;
+        NewDef->Users.push_back(Phi);
+      }
+  }
+  removeUser(NewDef, MA);
+
+  AccessList &Accesses = *BlockAccesses.lookup(MA->getBlock());
+  Accesses.erase(std::find(Accesses.begin(), Accesses.end(), MA));
+  InstructionAccesses.erase(MA->getMemoryInst());
+  ClobberCache.clear();
+  delete MA;
+}
+
+//===----------------------------------------------------------------------===//
+// Printing
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// MemorySSAAnnotatedWriter - Print each access before the instruction that
+/// makes it, and each phi at the start of its block.
+class MemorySSAAnnotatedWriter : public AssemblyAnnotationWriter {
+  const MemorySSA *MSSA;
+
+public:
+  explicit MemorySSAAnnotatedWriter(const MemorySSA *M) : MSSA(M) {}
+
+  virtual void emitBasicBlockStartAnnot(const BasicBlock *BB,
+                                        formatted_raw_ostream &OS) {
+    if (MemoryPhi *Phi = MSSA->getMemoryPhi(BB)) {
+      OS << "; ";
+      Phi->print(OS);
+      OS << '\n';
+    }
+  }
+
+  virtual void emitInstructionAnnot(const Instruction *I,
+                                    formatted_raw_ostream &OS) {
+    MemoryUseOrDef *MA = MSSA->getMemoryAccess(I);
+    if (!MA)
+      return;
+    OS << "  ; ";
+    MA->print(OS);
+    MemoryAccess *Clobber = MSSA->getClobberingMemoryAccess(I);
+    if (Clobber != MA->getDefiningAccess()) {
+      OS << " clobbered by ";
+      printID(OS, Clobber);
+    }
+    OS << '\n';
+  }
+};
+}
+
+void MemorySSA::print(raw_ostream &OS, const Module *) const {
+  MemorySSAAnnotatedWriter Writer(this);
+  F->print(OS, &Writer);
+}
@@ -93,7 +93,12 @@ bool RGPassManager::runOnFunction(Function &F) {
         PassManagerPrettyStackEntry X(P, *CurrentRegion->getEntry());
 
         TimeRegion PassTimer(getPassTimer(P));
-        Changed |= P->runOnRegion(CurrentRegion, *this);
+        PassInstrumentationRegion PIR(P, *F.getParent(), &F);
+        bool LocalChanged = false;
+        if (PIR.shouldRunPass())
+          LocalChanged = P->runOnRegion(CurrentRegion, *this);
+        PIR.passExecuted(LocalChanged);
+        Changed |= LocalChanged;
       }
 
       if (Changed)
@@ -98,6 +98,13 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumSCEVQueries, "Number of getSCEV queries");
+STATISTIC(NumSCEVQueriesComputed,
+          "Number of getSCEV queries not answered from the cache");
+STATISTIC(NumLoopsReleased,
+          "Number of loop nests whose cached results were released");
+STATISTIC(NumCacheFlushes,
+          "Number of times the caches were dropped for being over budget");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -106,6 +113,12 @@ MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
                                  "derived loop"),
                         cl::init(100));
 
+static cl::opt<unsigned>
+CacheBudget("scalar-evolution-cache-budget", cl::Hidden, cl::init(0),
+            cl::desc("The number of kilobytes ScalarEvolution's caches may "
+                     "use before loop pass managers make it drop them "
+                     "(0 = unlimited)"));
+
 // FIXME: Enable this with XDEBUG when the test suite is clean.
 static cl::opt<bool>
 VerifySCEV("verify-scev",
@@ -2741,6 +2754,7 @@ bool ScalarEvolution::checkValidity(const SCEV *S) const {
 /// expression and create a new one.
 const SCEV *ScalarEvolution::getSCEV(Value *V) {
   assert(isSCEVable(V->getType()) && "Value is not SCEVable!");
+  ++NumSCEVQueries;
 
   ValueExprMapType::iterator I = ValueExprMap.find_as(V);
   if (I != ValueExprMap.end()) {
@@ -2750,6 +2764,7 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
     else
       ValueExprMap.erase(I);
   }
+  ++NumSCEVQueriesComputed;
   const SCEV *S = createSCEV(V);
 
   // The process of creating a SCEV for V may have caused other SCEVs
@@ -4224,6 +4239,92 @@ void ScalarEvolution::forgetValue(Value *V) {
   }
 }
 
+/// releaseLoop - Drop what is cached about L, its subloops and the values
+/// defined in them.
+void ScalarEvolution::releaseLoop(const Loop *L) {
+  assert(PendingLoopPredicates.empty() && "Releasing a loop mid-query!");
+  ++NumLoopsReleased;
+
+  SmallVector<const Loop *, 8> Loops(1, L);
+  while (!Loops.empty()) {
+    const Loop *CurL = Loops.pop_back_val();
+    DenseMap<const Loop*, BackedgeTakenInfo>::iterator BTCPos =
+      BackedgeTakenCounts.find(CurL);
+    if (BTCPos != BackedgeTakenCounts.end()) {
+      BTCPos->second.clear();
+      BackedgeTakenCounts.erase(BTCPos);
+    }
+    Loops.append(CurL->begin(), CurL->end());
+  }
+
+  // The expressions for the values stay valid, so, unlike forgetValue, there
+  // is no need to chase users outside of the loop or trip counts that refer
+  // to the expressions.
+  for (Loop::block_iterator BI = L->block_begin(), BE = L->block_end();
+       BI != BE; ++BI)
+    for (BasicBlock::iterator I = (*BI)->begin(), E = (*BI)->end();
+         I != E; ++I) {
+      ValueExprMapType::iterator It =
+        ValueExprMap.find_as(static_cast<Value *>(I));
+      if (It == ValueExprMap.end())
+        continue;
+      const SCEV *S = It->second;
+      ValuesAtScopes.erase(S);
+      LoopDispositions.erase(S);
+      BlockDispositions.erase(S);
+      UnsignedRanges.erase(S);
+      SignedRanges.erase(S);
+      ValueExprMap.erase(It);
+      if (PHINode *PN = dyn_cast<PHINode>(I))
+        ConstantEvolutionLoopExitValue.erase(PN);
+    }
+}
+
+/// applyCacheBudget - Drop all of the cached results if they are over the
+/// budget.
+void ScalarEvolution::applyCacheBudget() {
+  if (CacheBudget == 0 ||
+      getCacheMemorySize() <= (size_t)CacheBudget * 1024)
+    return;
+  ++NumCacheFlushes;
+  releaseCaches();
+}
+
+size_t ScalarEvolution::getCacheMemorySize() const {
+  return ValueExprMap.getMemorySize() +
+         BackedgeTakenCounts.getMemorySize() +
+         ConstantEvolutionLoopExitValue.getMemorySize() +
+         ValuesAtScopes.getMemorySize() +
+         LoopDispositions.getMemorySize() +
+         BlockDispositions.getMemorySize() +
+         UnsignedRanges.getMemorySize() +
+         SignedRanges.getMemorySize();
+}
+
+/// freeMap - Empty M and free its buckets, which clear() may keep around.
+template<typename MapT>
+static void freeMap(MapT &M) {
+  MapT Empty;
+  M.swap(Empty);
+}
+
+void ScalarEvolution::releaseCaches() {
+  assert(PendingLoopPredicates.empty() && "Releasing caches mid-query!");
+  for (DenseMap<const Loop*, BackedgeTakenInfo>::iterator I =
+         BackedgeTakenCounts.begin(), E = BackedgeTakenCounts.end();
+       I != E; ++I)
+    I->second.clear();
+
+  freeMap(ValueExprMap);
+  freeMap(BackedgeTakenCounts);
+  freeMap(ConstantEvolutionLoopExitValue);
+  freeMap(ValuesAtScopes);
+  freeMap(LoopDispositions);
+  freeMap(BlockDispositions);
+  freeMap(UnsignedRanges);
+  freeMap(SignedRanges);
+}
+
 /// getExact - Get the exact loop backedge taken count considering all loop
 /// exits. A computable result can only be return for loops with a single exit.
 /// Returning the minimum taken count among all exits is incorrect because one
@@ -154,10 +154,22 @@ bool TargetTransformInfo::haveFastSqrt(Type *Ty) const {
   return PrevTTI->haveFastSqrt(Ty);
 }
 
+bool TargetTransformInfo::shouldExpandDivisionByInvariant(Type *Ty) const {
+  return PrevTTI->shouldExpandDivisionByInvariant(Ty);
+}
+
 unsigned TargetTransformInfo::getIntImmCost(const APInt &Imm, Type *Ty) const {
   return PrevTTI->getIntImmCost(Imm, Ty);
 }
 
+unsigned TargetTransformInfo::getCacheLineSize() const {
+  return PrevTTI->getCacheLineSize();
+}
+
+unsigned TargetTransformInfo::getCacheMissLatency() const {
+  return PrevTTI->getCacheMissLatency();
+}
+
 unsigned TargetTransformInfo::getNumberOfRegisters(bool Vector) const {
   return PrevTTI->getNumberOfRegisters(Vector);
 }
@@ -208,6 +220,25 @@ unsigned TargetTransformInfo::getMemoryOpCost(unsigned Opcode, Type *Src,
   ;
 }
 
+unsigned
+TargetTransformInfo::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                                unsigned Factor,
+                                                ArrayRef<unsigned> Indices,
+                                                unsigned Alignment,
+                                                unsigned AddressSpace) const {
+  return PrevTTI->getInterleavedMemoryOpCost(Opcode, VecTy, Factor, Indices,
+                                             Alignment, AddressSpace);
+}
+
+bool TargetTransformInfo::isLegalGather(Type *DataTy, Type *IndexTy) const {
+  return PrevTTI->isLegalGather(DataTy, IndexTy);
+}
+
+unsigned TargetTransformInfo::getGatherOpCost(Type *DataTy, Type *IndexTy,
+                                              unsigned Alignment) const {
+  return PrevTTI->getGatherOpCost(DataTy, IndexTy, Alignment);
+}
+
 unsigned
 TargetTransformInfo::getIntrinsicInstrCost(Intrinsic::ID ID,
                                            Type *RetTy,
@@ -533,10 +564,22 @@ struct NoTTI : ImmutablePass, TargetTransformInfo {
     return false;
   }
 
+  bool shouldExpandDivisionByInvariant(Type *Ty) const {
+    return false;
+  }
+
   unsigned getIntImmCost(const APInt &Imm, Type *Ty) const {
     return 1;
   }
 
+  unsigned getCacheLineSize() const {
+    return 0;
+  }
+
+  unsigned getCacheMissLatency() const {
+    return 0;
+  }
+
   unsigned getNumberOfRegisters(bool Vector) const {
     return 8;
   }
@@ -584,6 +627,23 @@ struct NoTTI : ImmutablePass, TargetTransformInfo {
     return 1;
   }
 
+  unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                      unsigned Factor,
+                                      ArrayRef<unsigned> Indices,
+                                      unsigned Alignment,
+                                      unsigned AddressSpace) const {
+    return 1;
+  }
+
+  bool isLegalGather(Type *DataTy, Type *IndexTy) const {
+    return false;
+  }
+
+  unsigned getGatherOpCost(Type *DataTy, Type *IndexTy,
+                           unsigned Alignment) const {
+    return 1;
+  }
+
   unsigned getIntrinsicInstrCost(Intrinsic::ID ID,
                                  Type *RetTy,
                                  ArrayRef<Type*> Tys) const {
@@ -135,6 +135,23 @@ static void UnEscapeLexed(std::string &Str) {
   Str.resize(BOut-Buffer);
 }
 
+/// setUnescapedStrVal - Set StrVal to the text in [Start, End) with its
+/// escapes replaced.  Text without escapes is used in place; the rest is
+/// unescaped into StrAlloc, so StrVal stays valid as long as the lexer does.
+void LLLexer::setUnescapedStrVal(const char *Start, const char *End) {
+  StringRef Str(Start, End - Start);
+  if (Str.find('\\') == StringRef::npos) {
+    StrVal = Str;
+    return;
+  }
+
+  UnescapeBuffer.assign(Start, End);
+  UnEscapeLexed(UnescapeBuffer);
+  char *Mem = StrAlloc.Allocate<char>(UnescapeBuffer.size());
+  memcpy(Mem, UnescapeBuffer.data(), UnescapeBuffer.size());
+  StrVal = StringRef(Mem, UnescapeBuffer.size());
+}
+
 /// isLabelChar - Return true for [-a-zA-Z$._0-9].
 static bool isLabelChar(char C) {
   return isalnum(static_cast<unsigned char>(C)) || C == '-' || C == '$' ||
@@ -210,7 +227,7 @@ lltok::Kind LLLexer::LexToken() {
   case '.':
     if (const char *Ptr = isLabelTail(CurPtr)) {
       CurPtr = Ptr;
-      StrVal.assign(TokStart, CurPtr-1);
+      StrVal = StringRef(TokStart, CurPtr - 1 - TokStart);
       return lltok::LabelStr;
     }
     if (CurPtr[0] == '.' && CurPtr[1] == '.') {
@@ -221,7 +238,7 @@ lltok::Kind LLLexer::LexToken() {
   case '$':
     if (const char *Ptr = isLabelTail(CurPtr)) {
       CurPtr = Ptr;
-      StrVal.assign(TokStart, CurPtr-1);
+      StrVal = StringRef(TokStart, CurPtr - 1 - TokStart);
       return lltok::LabelStr;
     }
     return lltok::Error;
@@ -273,9 +290,8 @@ lltok::Kind LLLexer::LexAt() {
         return lltok::Error;
       }
       if (CurChar == '"') {
-        StrVal.assign(TokStart+2, CurPtr-1);
-        UnEscapeLexed(StrVal);
-        if (StringRef(StrVal).find_first_of(0) != StringRef::npos) {
+        setUnescapedStrVal(TokStart+2, CurPtr-1);
+        if (StrVal.find_first_of(0) != StringRef::npos) {
           Error("Null bytes are not allowed in names");
           return lltok::Error;
         }
@@ -314,8 +330,7 @@ lltok::Kind LLLexer::ReadString(lltok::Kind kind) {
       return lltok::Error;
     }
     if (CurChar == '"') {
-      StrVal.assign(Start, CurPtr-1);
-      UnEscapeLexed(StrVal);
+      setUnescapedStrVal(Start, CurPtr-1);
       return kind;
     }
   }
@@ -333,7 +348,7 @@ bool LLLexer::ReadVarName() {
            CurPtr[0] == '.' || CurPtr[0] == '_')
       ++CurPtr;
 
-    StrVal.assign(NameStart, CurPtr);
+    StrVal = StringRef(NameStart, CurPtr - NameStart);
     return true;
   }
   return false;
@@ -399,8 +414,7 @@ lltok::Kind LLLexer::LexExclaim() {
            CurPtr[0] == '.' || CurPtr[0] == '_' || CurPtr[0] == '\\')
       ++CurPtr;
 
-    StrVal.assign(TokStart+1, CurPtr);   // Skip !
-    UnEscapeLexed(StrVal);
+    setUnescapedStrVal(TokStart+1, CurPtr);   // Skip !
     return lltok::MetadataVar;
   }
   return lltok::exclaim;
@@ -445,7 +459,8 @@ lltok::Kind LLLexer::LexIdentifier() {
 
   // If we stopped due to a colon, this really is a label.
   if (*CurPtr == ':') {
-    StrVal.assign(StartChar-1, CurPtr++);
+    StrVal = StringRef(StartChar - 1, CurPtr - (StartChar - 1));
+    ++CurPtr;
     return lltok::LabelStr;
   }
 
@@ -797,7 +812,7 @@ lltok::Kind LLLexer::LexDigitOrNegative() {
       !isdigit(static_cast<unsigned char>(CurPtr[0]))) {
     // Okay, this is not a number after the -, it's probably a label.
     if (const char *End = isLabelTail(CurPtr)) {
-      StrVal.assign(TokStart, End-1);
+      StrVal = StringRef(TokStart, End - 1 - TokStart);
       CurPtr = End;
       return lltok::LabelStr;
     }
@@ -814,7 +829,7 @@ lltok::Kind LLLexer::LexDigitOrNegative() {
   // Check to see if this really is a label afterall, e.g. "-1:".
   if (isLabelChar(CurPtr[0]) || CurPtr[0] == ':') {
     if (const char *End = isLabelTail(CurPtr)) {
-      StrVal.assign(TokStart, End-1);
+      StrVal = StringRef(TokStart, End - 1 - TokStart);
       CurPtr = End;
       return lltok::LabelStr;
     }
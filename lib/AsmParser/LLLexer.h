@@ -17,6 +17,8 @@
 #include "LLToken.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APSInt.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/SourceMgr.h"
 #include <string>
 
@@ -36,12 +38,19 @@ namespace llvm {
     // Information about the current token.
     const char *TokStart;
     lltok::Kind CurKind;
-    std::string StrVal;
+    /// StrVal - The text of the current token.  It points into the buffer,
+    /// or into StrAlloc if it had escapes, and stays valid after the lexer
+    /// moves on.
+    StringRef StrVal;
     unsigned UIntVal;
     Type *TyVal;
     APFloat APFloatVal;
     APSInt  APSIntVal;
 
+    /// StrAlloc - Holds the unescaped text of tokens that had escapes.
+    BumpPtrAllocator StrAlloc;
+    std::string UnescapeBuffer;
+
   public:
     explicit LLLexer(MemoryBuffer *StartBuf, SourceMgr &SM, SMDiagnostic &,
                      LLVMContext &C);
@@ -54,7 +63,7 @@ namespace llvm {
     typedef SMLoc LocTy;
     LocTy getLoc() const { return SMLoc::getFromPointer(TokStart); }
     lltok::Kind getKind() const { return CurKind; }
-    const std::string &getStrVal() const { return StrVal; }
+    StringRef getStrVal() const { return StrVal; }
     Type *getTyVal() const { return TyVal; }
     unsigned getUIntVal() const { return UIntVal; }
     const APSInt &getAPSIntVal() const { return APSIntVal; }
@@ -72,6 +81,7 @@ namespace llvm {
     void SkipLineComment();
     lltok::Kind ReadString(lltok::Kind kind);
     bool ReadVarName();
+    void setUnescapedStrVal(const char *Start, const char *End);
 
     lltok::Kind LexIdentifier();
     lltok::Kind LexDigitOrNegative();
@@ -34,13 +34,47 @@ static std::string getTypeString(Type *T) {
   return Tmp.str();
 }
 
+/// getFirstForwardRef - Return the entry of a forward reference table whose
+/// use comes first in the file, which is the one to report as undefined.
+template <typename MapTy>
+static typename MapTy::iterator getFirstForwardRef(MapTy &Map) {
+  typename MapTy::iterator First = Map.begin();
+  for (typename MapTy::iterator I = Map.begin(), E = Map.end(); I != E; ++I)
+    if (I->second.second.getPointer() < First->second.second.getPointer())
+      First = I;
+  return First;
+}
+
 /// Run: module ::= toplevelentity*
 bool LLParser::Run() {
   // Prime the lexer.
   Lex.Lex();
 
-  return ParseTopLevelEntities() ||
-         ValidateEndOfModule();
+  // Local values are found by name while parsing, so keep their names until
+  // the whole module, including any block addresses, has been resolved.
+  bool DiscardValueNames = Context.shouldDiscardValueNames();
+  Context.setDiscardValueNames(false);
+  bool Failed = ParseTopLevelEntities() ||
+                ValidateEndOfModule();
+  Context.setDiscardValueNames(DiscardValueNames);
+  if (!Failed && DiscardValueNames)
+    DiscardLocalNames();
+  return Failed;
+}
+
+/// DiscardLocalNames - Drop the names of the arguments, blocks and
+/// instructions of every function, for a context that discards them.
+void LLParser::DiscardLocalNames() {
+  for (Module::iterator F = M->begin(), FE = M->end(); F != FE; ++F) {
+    for (Function::arg_iterator A = F->arg_begin(), AE = F->arg_end();
+         A != AE; ++A)
+      A->setName("");
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB) {
+      BB->setName("");
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+        I->setName("");
+    }
+  }
 }
 
 /// ValidateEndOfModule - Do final validity and sanity checks at the end of the
@@ -162,20 +196,23 @@ bool LLParser::ValidateEndOfModule() {
       return Error(I->second.second,
                    "use of undefined type named '" + I->getKey() + "'");
 
-  if (!ForwardRefVals.empty())
-    return Error(ForwardRefVals.begin()->second.second,
-                 "use of undefined value '@" + ForwardRefVals.begin()->first +
-                 "'");
+  if (!ForwardRefVals.empty()) {
+    ForwardRefValMap::iterator I = getFirstForwardRef(ForwardRefVals);
+    return Error(I->second.second,
+                 "use of undefined value '@" + I->getKey() + "'");
+  }
 
-  if (!ForwardRefValIDs.empty())
-    return Error(ForwardRefValIDs.begin()->second.second,
-                 "use of undefined value '@" +
-                 Twine(ForwardRefValIDs.begin()->first) + "'");
+  if (!ForwardRefValIDs.empty()) {
+    ForwardRefValIDMap::iterator I = getFirstForwardRef(ForwardRefValIDs);
+    return Error(I->second.second,
+                 "use of undefined value '@" + Twine(I->first) + "'");
+  }
 
-  if (!ForwardRefMDNodes.empty())
-    return Error(ForwardRefMDNodes.begin()->second.second,
-                 "use of undefined metadata '!" +
-                 Twine(ForwardRefMDNodes.begin()->first) + "'");
+  if (!ForwardRefMDNodes.empty()) {
+    ForwardRefMDNodeMap::iterator I = getFirstForwardRef(ForwardRefMDNodes);
+    return Error(I->second.second,
+                 "use of undefined metadata '!" + Twine(I->first) + "'");
+  }
 
 
   // Look for intrinsic functions and CallInst that need to be upgraded
@@ -293,7 +330,7 @@ bool LLParser::ParseModuleAsm() {
   assert(Lex.getKind() == lltok::kw_module);
   Lex.Lex();
 
-  std::string AsmStr;
+  StringRef AsmStr;
   if (ParseToken(lltok::kw_asm, "expected 'module asm'") ||
       ParseStringConstant(AsmStr)) return true;
 
@@ -306,7 +343,7 @@ bool LLParser::ParseModuleAsm() {
 ///   ::= 'target' 'datalayout' '=' STRINGCONSTANT
 bool LLParser::ParseTargetDefinition() {
   assert(Lex.getKind() == lltok::kw_target);
-  std::string Str;
+  StringRef Str;
   switch (Lex.Lex()) {
   default: return TokError("unknown target property");
   case lltok::kw_triple:
@@ -341,7 +378,7 @@ bool LLParser::ParseDepLibs() {
     return false;
 
   do {
-    std::string Str;
+    StringRef Str;
     if (ParseStringConstant(Str)) return true;
   } while (EatIfPresent(lltok::comma));
 
@@ -498,7 +535,7 @@ bool LLParser::ParseNamedGlobal() {
 // MDString:
 //   ::= '!' STRINGCONSTANT
 bool LLParser::ParseMDString(MDString *&Result) {
-  std::string Str;
+  StringRef Str;
   if (ParseStringConstant(Str)) return true;
   Result = MDString::get(Context, Str);
   return false;
@@ -591,7 +628,7 @@ bool LLParser::ParseStandaloneMetadata() {
   MDNode *Init = MDNode::get(Context, Elts);
 
   // See if this was forward referenced, if so, handle it.
-  std::map<unsigned, std::pair<TrackingVH<MDNode>, LocTy> >::iterator
+  ForwardRefMDNodeMap::iterator
     FI = ForwardRefMDNodes.find(MetadataID);
   if (FI != ForwardRefMDNodes.end()) {
     MDNode *Temp = FI->second.first;
@@ -663,7 +700,7 @@ bool LLParser::ParseAlias(const std::string &Name, LocTy NameLoc,
   if (GlobalValue *Val = M->getNamedValue(Name)) {
     // See if this was a redefinition.  If so, there is no entry in
     // ForwardRefVals.
-    std::map<std::string, std::pair<GlobalValue*, LocTy> >::iterator
+    ForwardRefValMap::iterator
       I = ForwardRefVals.find(Name);
     if (I == ForwardRefVals.end())
       return Error(NameLoc, "redefinition of global named '@" + Name + "'");
@@ -743,7 +780,7 @@ bool LLParser::ParseGlobal(const std::string &Name, LocTy NameLoc,
       GV = cast<GlobalVariable>(GVal);
     }
   } else {
-    std::map<unsigned, std::pair<GlobalValue*, LocTy> >::iterator
+    ForwardRefValIDMap::iterator
       I = ForwardRefValIDs.find(NumberedVals.size());
     if (I != ForwardRefValIDs.end()) {
       GV = cast<GlobalVariable>(I->second.first);
@@ -863,9 +900,9 @@ bool LLParser::ParseFnAttributeValuePairs(AttrBuilder &B,
     }
     // Target-dependent attributes:
     case lltok::StringConstant: {
-      std::string Attr = Lex.getStrVal();
+      StringRef Attr = Lex.getStrVal();
       Lex.Lex();
-      std::string Val;
+      StringRef Val;
       if (EatIfPresent(lltok::equal) &&
           ParseStringConstant(Val))
         return true;
@@ -964,8 +1001,7 @@ bool LLParser::ParseFnAttributeValuePairs(AttrBuilder &B,
 /// GetGlobalVal - Get a value with the specified name or ID, creating a
 /// forward reference record if needed.  This can return null if the value
 /// exists but does not have the right type.
-GlobalValue *LLParser::GetGlobalVal(const std::string &Name, Type *Ty,
-                                    LocTy Loc) {
+GlobalValue *LLParser::GetGlobalVal(StringRef Name, Type *Ty, LocTy Loc) {
   PointerType *PTy = dyn_cast<PointerType>(Ty);
   if (PTy == 0) {
     Error(Loc, "global variable reference must have pointer type");
@@ -979,7 +1015,7 @@ GlobalValue *LLParser::GetGlobalVal(const std::string &Name, Type *Ty,
   // If this is a forward reference for the value, see if we already created a
   // forward ref record.
   if (Val == 0) {
-    std::map<std::string, std::pair<GlobalValue*, LocTy> >::iterator
+    ForwardRefValMap::iterator
       I = ForwardRefVals.find(Name);
     if (I != ForwardRefVals.end())
       Val = I->second.first;
@@ -1019,7 +1055,7 @@ GlobalValue *LLParser::GetGlobalVal(unsigned ID, Type *Ty, LocTy Loc) {
   // If this is a forward reference for the value, see if we already created a
   // forward ref record.
   if (Val == 0) {
-    std::map<unsigned, std::pair<GlobalValue*, LocTy> >::iterator
+    ForwardRefValIDMap::iterator
       I = ForwardRefValIDs.find(ID);
     if (I != ForwardRefValIDs.end())
       Val = I->second.first;
@@ -1061,7 +1097,7 @@ bool LLParser::ParseToken(lltok::Kind T, const char *ErrMsg) {
 
 /// ParseStringConstant
 ///   ::= StringConstant
-bool LLParser::ParseStringConstant(std::string &Result) {
+bool LLParser::ParseStringConstant(StringRef &Result) {
   if (Lex.getKind() != lltok::StringConstant)
     return TokError("expected string constant");
   Result = Lex.getStrVal();
@@ -1972,7 +2008,7 @@ LLParser::PerFunctionState::PerFunctionState(LLParser &p, Function &f,
 
 LLParser::PerFunctionState::~PerFunctionState() {
   // If there were any forward referenced non-basicblock values, delete them.
-  for (std::map<std::string, std::pair<Value*, LocTy> >::iterator
+  for (ForwardRefValMap::iterator
        I = ForwardRefVals.begin(), E = ForwardRefVals.end(); I != E; ++I)
     if (!isa<BasicBlock>(I->second.first)) {
       I->second.first->replaceAllUsesWith(
@@ -1981,7 +2017,7 @@ LLParser::PerFunctionState::~PerFunctionState() {
       I->second.first = 0;
     }
 
-  for (std::map<unsigned, std::pair<Value*, LocTy> >::iterator
+  for (ForwardRefValIDMap::iterator
        I = ForwardRefValIDs.begin(), E = ForwardRefValIDs.end(); I != E; ++I)
     if (!isa<BasicBlock>(I->second.first)) {
       I->second.first->replaceAllUsesWith(
@@ -2014,14 +2050,16 @@ bool LLParser::PerFunctionState::FinishFunction() {
     }
   }
 
-  if (!ForwardRefVals.empty())
-    return P.Error(ForwardRefVals.begin()->second.second,
-                   "use of undefined value '%" + ForwardRefVals.begin()->first +
-                   "'");
-  if (!ForwardRefValIDs.empty())
-    return P.Error(ForwardRefValIDs.begin()->second.second,
-                   "use of undefined value '%" +
-                   Twine(ForwardRefValIDs.begin()->first) + "'");
+  if (!ForwardRefVals.empty()) {
+    ForwardRefValMap::iterator I = getFirstForwardRef(ForwardRefVals);
+    return P.Error(I->second.second,
+                   "use of undefined value '%" + I->getKey() + "'");
+  }
+  if (!ForwardRefValIDs.empty()) {
+    ForwardRefValIDMap::iterator I = getFirstForwardRef(ForwardRefValIDs);
+    return P.Error(I->second.second,
+                   "use of undefined value '%" + Twine(I->first) + "'");
+  }
   return false;
 }
 
@@ -2029,15 +2067,15 @@ bool LLParser::PerFunctionState::FinishFunction() {
 /// GetVal - Get a value with the specified name or ID, creating a
 /// forward reference record if needed.  This can return null if the value
 /// exists but does not have the right type.
-Value *LLParser::PerFunctionState::GetVal(const std::string &Name,
-                                          Type *Ty, LocTy Loc) {
+Value *LLParser::PerFunctionState::GetVal(StringRef Name, Type *Ty,
+                                          LocTy Loc) {
   // Look this name up in the normal function symbol table.
   Value *Val = F.getValueSymbolTable().lookup(Name);
 
   // If this is a forward reference for the value, see if we already created a
   // forward ref record.
   if (Val == 0) {
-    std::map<std::string, std::pair<Value*, LocTy> >::iterator
+    ForwardRefValMap::iterator
       I = ForwardRefVals.find(Name);
     if (I != ForwardRefVals.end())
       Val = I->second.first;
@@ -2079,7 +2117,7 @@ Value *LLParser::PerFunctionState::GetVal(unsigned ID, Type *Ty,
   // If this is a forward reference for the value, see if we already created a
   // forward ref record.
   if (Val == 0) {
-    std::map<unsigned, std::pair<Value*, LocTy> >::iterator
+    ForwardRefValIDMap::iterator
       I = ForwardRefValIDs.find(ID);
     if (I != ForwardRefValIDs.end())
       Val = I->second.first;
@@ -2114,8 +2152,7 @@ Value *LLParser::PerFunctionState::GetVal(unsigned ID, Type *Ty,
 
 /// SetInstName - After an instruction is parsed and inserted into its
 /// basic block, this installs its name.
-bool LLParser::PerFunctionState::SetInstName(int NameID,
-                                             const std::string &NameStr,
+bool LLParser::PerFunctionState::SetInstName(int NameID, StringRef NameStr,
                                              LocTy NameLoc, Instruction *Inst) {
   // If this instruction has void type, it cannot have a name or ID specified.
   if (Inst->getType()->isVoidTy()) {
@@ -2135,7 +2172,7 @@ bool LLParser::PerFunctionState::SetInstName(int NameID,
       return P.Error(NameLoc, "instruction expected to be numbered '%" +
                      Twine(NumberedVals.size()) + "'");
 
-    std::map<unsigned, std::pair<Value*, LocTy> >::iterator FI =
+    ForwardRefValIDMap::iterator FI =
       ForwardRefValIDs.find(NameID);
     if (FI != ForwardRefValIDs.end()) {
       if (FI->second.first->getType() != Inst->getType())
@@ -2151,7 +2188,7 @@ bool LLParser::PerFunctionState::SetInstName(int NameID,
   }
 
   // Otherwise, the instruction had a name.  Resolve forward refs and set it.
-  std::map<std::string, std::pair<Value*, LocTy> >::iterator
+  ForwardRefValMap::iterator
     FI = ForwardRefVals.find(NameStr);
   if (FI != ForwardRefVals.end()) {
     if (FI->second.first->getType() != Inst->getType())
@@ -2173,8 +2210,7 @@ bool LLParser::PerFunctionState::SetInstName(int NameID,
 
 /// GetBB - Get a basic block with the specified name or ID, creating a
 /// forward reference record if needed.
-BasicBlock *LLParser::PerFunctionState::GetBB(const std::string &Name,
-                                              LocTy Loc) {
+BasicBlock *LLParser::PerFunctionState::GetBB(StringRef Name, LocTy Loc) {
   return cast_or_null<BasicBlock>(GetVal(Name,
                                         Type::getLabelTy(F.getContext()), Loc));
 }
@@ -2187,7 +2223,7 @@ BasicBlock *LLParser::PerFunctionState::GetBB(unsigned ID, LocTy Loc) {
 /// DefineBB - Define the specified basic block, which is either named or
 /// unnamed.  If there is an error, this returns null otherwise it returns
 /// the block being defined.
-BasicBlock *LLParser::PerFunctionState::DefineBB(const std::string &Name,
+BasicBlock *LLParser::PerFunctionState::DefineBB(StringRef Name,
                                                  LocTy Loc) {
   BasicBlock *BB;
   if (Name.empty())
@@ -2995,9 +3031,9 @@ bool LLParser::ParseFunctionHeader(Function *&Fn, bool isDefine) {
   AttrBuilder FuncAttrs;
   std::vector<unsigned> FwdRefAttrGrps;
   LocTy BuiltinLoc;
-  std::string Section;
+  StringRef Section;
   unsigned Alignment;
-  std::string GC;
+  StringRef GC;
   bool UnnamedAddr;
   LocTy UnnamedAddrLoc;
   Constant *Prefix = 0;
@@ -3061,7 +3097,7 @@ bool LLParser::ParseFunctionHeader(Function *&Fn, bool isDefine) {
   if (!FunctionName.empty()) {
     // If this was a definition of a forward reference, remove the definition
     // from the forward reference table and fill in the forward ref.
-    std::map<std::string, std::pair<GlobalValue*, LocTy> >::iterator FRVI =
+    ForwardRefValMap::iterator FRVI =
       ForwardRefVals.find(FunctionName);
     if (FRVI != ForwardRefVals.end()) {
       Fn = M->getFunction(FunctionName);
@@ -3084,7 +3120,7 @@ bool LLParser::ParseFunctionHeader(Function *&Fn, bool isDefine) {
   } else {
     // If this is a definition of a forward referenced function, make sure the
     // types agree.
-    std::map<unsigned, std::pair<GlobalValue*, LocTy> >::iterator I
+    ForwardRefValIDMap::iterator I
       = ForwardRefValIDs.find(NumberedVals.size());
     if (I != ForwardRefValIDs.end()) {
       Fn = cast<Function>(I->second.first);
@@ -3110,7 +3146,7 @@ bool LLParser::ParseFunctionHeader(Function *&Fn, bool isDefine) {
   Fn->setUnnamedAddr(UnnamedAddr);
   Fn->setAlignment(Alignment);
   Fn->setSection(Section);
-  if (!GC.empty()) Fn->setGC(GC.c_str());
+  if (!GC.empty()) Fn->setGC(GC.str().c_str());
   Fn->setPrefixData(Prefix);
   ForwardRefAttrGroups[Fn] = FwdRefAttrGrps;
 
@@ -3163,7 +3199,7 @@ bool LLParser::ParseFunctionBody(Function &Fn) {
 ///   ::= LabelStr? Instruction*
 bool LLParser::ParseBasicBlock(PerFunctionState &PFS) {
   // If this basic block starts out with a name, remember it.
-  std::string Name;
+  StringRef Name;
   LocTy NameLoc = Lex.getLoc();
   if (Lex.getKind() == lltok::LabelStr) {
     Name = Lex.getStrVal();
@@ -3173,7 +3209,7 @@ bool LLParser::ParseBasicBlock(PerFunctionState &PFS) {
   BasicBlock *BB = PFS.DefineBB(Name, NameLoc);
   if (BB == 0) return true;
 
-  std::string NameStr;
+  StringRef NameStr;
 
   // Parse the instructions in this block until we get a terminator.
   Instruction *Inst;
@@ -3182,7 +3218,7 @@ bool LLParser::ParseBasicBlock(PerFunctionState &PFS) {
     // specified, b) name specified "%foo =", c) number specified: "%4 =".
     LocTy NameLoc = Lex.getLoc();
     int NameID = -1;
-    NameStr = "";
+    NameStr = StringRef();
 
     if (Lex.getKind() == lltok::LocalVarID) {
       NameID = Lex.getUIntVal();
@@ -59,7 +59,7 @@ namespace llvm {
 
     LLLexer::LocTy Loc;
     unsigned UIntVal;
-    std::string StrVal, StrVal2;
+    StringRef StrVal, StrVal2;  // Point into the lexer's buffers.
     APSInt APSIntVal;
     APFloat APFloatVal;
     Constant *ConstantVal;
@@ -115,11 +115,18 @@ namespace llvm {
     std::vector<std::pair<Type*, LocTy> > NumberedTypes;
 
     std::vector<TrackingVH<MDNode> > NumberedMetadata;
-    std::map<unsigned, std::pair<TrackingVH<MDNode>, LocTy> > ForwardRefMDNodes;
-
-    // Global Value reference information.
-    std::map<std::string, std::pair<GlobalValue*, LocTy> > ForwardRefVals;
-    std::map<unsigned, std::pair<GlobalValue*, LocTy> > ForwardRefValIDs;
+    typedef DenseMap<unsigned, std::pair<TrackingVH<MDNode>, LocTy> >
+      ForwardRefMDNodeMap;
+    ForwardRefMDNodeMap ForwardRefMDNodes;
+
+    // Global Value reference information.  The forward reference tables are
+    // hashed: the order of their entries only matters when reporting an
+    // undefined value, and then the first use in the file is reported.
+    typedef StringMap<std::pair<GlobalValue*, LocTy> > ForwardRefValMap;
+    typedef DenseMap<unsigned, std::pair<GlobalValue*, LocTy> >
+      ForwardRefValIDMap;
+    ForwardRefValMap ForwardRefVals;
+    ForwardRefValIDMap ForwardRefValIDs;
     std::vector<GlobalValue*> NumberedVals;
 
     // References to blockaddress.  The key is the function ValID, the value is
@@ -151,7 +158,7 @@ namespace llvm {
     /// GetGlobalVal - Get a value with the specified name or ID, creating a
     /// forward reference record if needed.  This can return null if the value
     /// exists but does not have the right type.
-    GlobalValue *GetGlobalVal(const std::string &N, Type *Ty, LocTy Loc);
+    GlobalValue *GetGlobalVal(StringRef N, Type *Ty, LocTy Loc);
     GlobalValue *GetGlobalVal(unsigned ID, Type *Ty, LocTy Loc);
 
     // Helper Routines.
@@ -187,7 +194,7 @@ namespace llvm {
       }
       return false;
     }
-    bool ParseStringConstant(std::string &Result);
+    bool ParseStringConstant(StringRef &Result);
     bool ParseUInt32(unsigned &Val);
     bool ParseUInt32(unsigned &Val, LocTy &Loc) {
       Loc = Lex.getLoc();
@@ -222,6 +229,7 @@ namespace llvm {
     // Top-Level Entities
     bool ParseTopLevelEntities();
     bool ValidateEndOfModule();
+    void DiscardLocalNames();
     bool ParseTargetDefinition();
     bool ParseModuleAsm();
     bool ParseDepLibs();        // FIXME: Remove in 4.0.
@@ -265,8 +273,10 @@ namespace llvm {
     class PerFunctionState {
       LLParser &P;
       Function &F;
-      std::map<std::string, std::pair<Value*, LocTy> > ForwardRefVals;
-      std::map<unsigned, std::pair<Value*, LocTy> > ForwardRefValIDs;
+      typedef StringMap<std::pair<Value*, LocTy> > ForwardRefValMap;
+      typedef DenseMap<unsigned, std::pair<Value*, LocTy> > ForwardRefValIDMap;
+      ForwardRefValMap ForwardRefVals;
+      ForwardRefValIDMap ForwardRefValIDs;
       std::vector<Value*> NumberedVals;
 
       /// FunctionNumber - If this is an unnamed function, this is the slot
@@ -283,24 +293,24 @@ namespace llvm {
       /// GetVal - Get a value with the specified name or ID, creating a
       /// forward reference record if needed.  This can return null if the value
       /// exists but does not have the right type.
-      Value *GetVal(const std::string &Name, Type *Ty, LocTy Loc);
+      Value *GetVal(StringRef Name, Type *Ty, LocTy Loc);
       Value *GetVal(unsigned ID, Type *Ty, LocTy Loc);
 
       /// SetInstName - After an instruction is parsed and inserted into its
       /// basic block, this installs its name.
-      bool SetInstName(int NameID, const std::string &NameStr, LocTy NameLoc,
+      bool SetInstName(int NameID, StringRef NameStr, LocTy NameLoc,
                        Instruction *Inst);
 
       /// GetBB - Get a basic block with the specified name or ID, creating a
       /// forward reference record if needed.  This can return null if the value
       /// is not a BasicBlock.
-      BasicBlock *GetBB(const std::string &Name, LocTy Loc);
+      BasicBlock *GetBB(StringRef Name, LocTy Loc);
       BasicBlock *GetBB(unsigned ID, LocTy Loc);
 
       /// DefineBB - Define the specified basic block, which is either named or
       /// unnamed.  If there is an error, this returns null otherwise it returns
       /// the block being defined.
-      BasicBlock *DefineBB(const std::string &Name, LocTy Loc);
+      BasicBlock *DefineBB(StringRef Name, LocTy Loc);
     };
 
     bool ConvertValIDToValue(Type *Ty, ValID &ID, Value *&V,
@@ -22,6 +22,7 @@
 #include "llvm/IR/OperandTraits.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/Support/DataStream.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
@@ -50,6 +51,9 @@ void BitcodeReader::FreeState() {
   std::vector<BasicBlock*>().swap(FunctionBBs);
   std::vector<Function*>().swap(FunctionsWithBodies);
   DeferredFunctionInfo.clear();
+  std::vector<uint64_t>().swap(FunctionIndex);
+  std::vector<Function*>().swap(FunctionBodyOrder);
+  NextFunctionBody = 0;
   MDKindMap.clear();
 
   assert(BlockAddrFwdRefs.empty() && "Unresolved blockaddress fwd references");
@@ -988,7 +992,8 @@ error_code BitcodeReader::ParseMetadata() {
     bool IsFunctionLocal = false;
     // Read a record.
     Record.clear();
-    unsigned Code = Stream.readRecord(Entry.ID, Record);
+    StringRef Blob;
+    unsigned Code = Stream.readRecord(Entry.ID, Record, &Blob);
     switch (Code) {
     default:  // Default behavior: ignore.
       break;
@@ -1039,8 +1044,15 @@ error_code BitcodeReader::ParseMetadata() {
       break;
     }
     case bitc::METADATA_STRING: {
-      SmallString<8> String(Record.begin(), Record.end());
-      Value *V = MDString::get(Context, String);
+      // The characters either come as a blob that points into the bitcode
+      // buffer, or, for older writers, as one record element per character.
+      Value *V;
+      if (!Record.empty()) {
+        SmallString<8> String(Record.begin(), Record.end());
+        V = MDString::get(Context, String);
+      } else {
+        V = MDString::get(Context, Blob);
+      }
       MDValueList.AssignValue(V, NextMDValueNo++);
       break;
     }
@@ -1611,6 +1623,40 @@ error_code BitcodeReader::RememberAndSkipFunctionBody() {
   return error_code::success();
 }
 
+/// RememberFunctionBodiesFromIndex - When we see the block for the first
+/// function body and the module has a function index, remember where all of
+/// the function bodies are and skip past the last one, without looking at the
+/// blocks in between.  Done is set to false if the index does not match the
+/// module, in which case the caller should fall back to visiting each block.
+error_code BitcodeReader::RememberFunctionBodiesFromIndex(bool &Done) {
+  Done = false;
+  if (FunctionIndex.empty() ||
+      FunctionIndex.size() != FunctionsWithBodies.size())
+    return error_code::success();
+
+  // The cursor has already read the abbrev ID and the block ID that start the
+  // first function block; that's where RememberAndSkipFunctionBody would have
+  // recorded it, and where the index entries need to be moved to as well.
+  // FUNCTION_BLOCK_ID is small enough to fit in a single VBR chunk.
+  uint64_t HeaderBits = Stream.getAbbrevIDWidth() + bitc::BlockIDWidth;
+  if (FunctionIndex.front() + HeaderBits != Stream.GetCurrentBitNo() ||
+      !Stream.canSkipToPos((FunctionIndex.back() + HeaderBits) / 8))
+    return error_code::success();
+
+  for (unsigned i = 0, e = FunctionIndex.size(); i != e; ++i) {
+    Function *Fn = FunctionsWithBodies.back();
+    FunctionsWithBodies.pop_back();
+    DeferredFunctionInfo[Fn] = FunctionIndex[i] + HeaderBits;
+  }
+
+  // Continue after the last function block.
+  Stream.JumpToBit(FunctionIndex.back() + HeaderBits);
+  if (Stream.SkipBlock())
+    return Error(InvalidRecord);
+  Done = true;
+  return error_code::success();
+}
+
 error_code BitcodeReader::GlobalCleanup() {
   // Patch the initializers for globals and aliases up.
   ResolveGlobalAndAliasInits();
@@ -1698,10 +1744,22 @@ error_code BitcodeReader::ParseModule(bool Resume) {
         // If this is the first function body we've seen, reverse the
         // FunctionsWithBodies list.
         if (!SeenFirstFunctionBody) {
+          FunctionBodyOrder = FunctionsWithBodies;
           std::reverse(FunctionsWithBodies.begin(), FunctionsWithBodies.end());
           if (error_code EC = GlobalCleanup())
             return EC;
           SeenFirstFunctionBody = true;
+
+          // If the module has an index of its function bodies, use it to find
+          // all of them at once.  Streamed bitcode is read front to back, so
+          // it keeps visiting the blocks one by one.
+          if (!LazyStreamer) {
+            bool Done;
+            if (error_code EC = RememberFunctionBodiesFromIndex(Done))
+              return EC;
+            if (Done)
+              break;
+          }
         }
 
         if (error_code EC = RememberAndSkipFunctionBody())
@@ -1731,7 +1789,8 @@ error_code BitcodeReader::ParseModule(bool Resume) {
 
 
     // Read a record.
-    switch (Stream.readRecord(Entry.ID, Record)) {
+    StringRef Blob;
+    switch (Stream.readRecord(Entry.ID, Record, &Blob)) {
     default: break;  // Default behavior, ignore unknown content.
     case bitc::MODULE_CODE_VERSION: {  // VERSION: [version#]
       if (Record.size() < 1)
@@ -1793,6 +1852,18 @@ error_code BitcodeReader::ParseModule(bool Resume) {
       GCTable.push_back(S);
       break;
     }
+    case bitc::MODULE_CODE_FNINDEX: { // FNINDEX: [offset x N]
+      // The offsets are relative to the end of this record.
+      if (Blob.size() % 8 != 0)
+        return Error(InvalidRecord);
+      uint64_t Base = Stream.GetCurrentBitNo();
+      FunctionIndex.clear();
+      for (unsigned i = 0, e = Blob.size(); i != e; i += 8)
+        FunctionIndex.push_back(Base +
+          support::endian::read<uint64_t, support::little, support::unaligned>(
+            Blob.data() + i));
+      break;
+    }
     // GLOBALVAR: [pointer type, isconst, initid,
     //             linkage, alignment, section, visibility, threadlocal,
     //             unnamed_addr]
@@ -2035,6 +2106,138 @@ error_code BitcodeReader::ParseModuleTriple(std::string &Triple) {
   }
 }
 
+error_code
+BitcodeReader::ParseSymbolTable(std::vector<BitcodeSymbol> &Symbols) {
+  if (Stream.EnterSubBlock(bitc::SYMTAB_BLOCK_ID))
+    return Error(InvalidRecord);
+
+  SmallVector<uint64_t, 8> Record;
+
+  // Read all the records for this symbol table.
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Error(MalformedBlock);
+    case BitstreamEntry::EndBlock:
+      return error_code::success();
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    // Read a record.
+    Record.clear();
+    StringRef Blob;
+    switch (Stream.readRecord(Entry.ID, Record, &Blob)) {
+    default:  // Default behavior: unknown type.
+      break;
+    case bitc::SYMTAB_CODE_ENTRY: {
+      // ENTRY: [kind, linkage, visibility, flags, name blob]
+      if (Record.size() < 4 || Record[0] > bitc::SYMTAB_KIND_ALIAS)
+        return Error(InvalidRecord);
+      BitcodeSymbol Sym;
+      Sym.Name = Blob;
+      if (Record[0] == bitc::SYMTAB_KIND_FUNCTION)
+        Sym.Kind = BitcodeSymbol::Function;
+      else if (Record[0] == bitc::SYMTAB_KIND_VARIABLE)
+        Sym.Kind = BitcodeSymbol::Variable;
+      else
+        Sym.Kind = BitcodeSymbol::Alias;
+      Sym.Linkage = GetDecodedLinkage(Record[1]);
+      Sym.Visibility = GetDecodedVisibility(Record[2]);
+      uint64_t Flags = Record[3];
+      Sym.IsDeclaration = (Flags & bitc::SYMTAB_FLAG_DECLARATION) != 0;
+      Sym.IsThreadLocal = (Flags & bitc::SYMTAB_FLAG_THREAD_LOCAL) != 0;
+      Sym.HasUnnamedAddr = (Flags & bitc::SYMTAB_FLAG_UNNAMED_ADDR) != 0;
+      Sym.IsConstant = (Flags & bitc::SYMTAB_FLAG_CONSTANT) != 0;
+      Sym.IsAliasOfFunction =
+          (Flags & bitc::SYMTAB_FLAG_ALIAS_OF_FUNCTION) != 0;
+      Sym.IsAliasOfVariable =
+          (Flags & bitc::SYMTAB_FLAG_ALIAS_OF_VARIABLE) != 0;
+      Symbols.push_back(Sym);
+      break;
+    }
+    }
+  }
+}
+
+error_code
+BitcodeReader::ParseModuleSymbols(std::vector<BitcodeSymbol> &Symbols,
+                                  bool &Found) {
+  if (Stream.EnterSubBlock(bitc::MODULE_BLOCK_ID))
+    return Error(InvalidRecord);
+
+  // The writer puts the symbol table in front of everything else, so this
+  // usually stops after the version record.
+  while (1) {
+    BitstreamEntry Entry = Stream.advance();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return Error(MalformedBlock);
+    case BitstreamEntry::EndBlock:
+      return error_code::success();
+
+    case BitstreamEntry::SubBlock:
+      if (Entry.ID == bitc::SYMTAB_BLOCK_ID) {
+        Found = true;
+        return ParseSymbolTable(Symbols);
+      }
+
+      // Ignore other sub-blocks.
+      if (Stream.SkipBlock())
+        return Error(MalformedBlock);
+      continue;
+
+    case BitstreamEntry::Record:
+      Stream.skipRecord(Entry.ID);
+      continue;
+    }
+  }
+}
+
+error_code BitcodeReader::ParseSymbols(std::vector<BitcodeSymbol> &Symbols,
+                                       bool &Found) {
+  if (error_code EC = InitStream())
+    return EC;
+
+  // Sniff for the signature.
+  if (Stream.Read(8) != 'B' ||
+      Stream.Read(8) != 'C' ||
+      Stream.Read(4) != 0x0 ||
+      Stream.Read(4) != 0xC ||
+      Stream.Read(4) != 0xE ||
+      Stream.Read(4) != 0xD)
+    return Error(InvalidBitcodeSignature);
+
+  while (1) {
+    BitstreamEntry Entry = Stream.advance();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::Error:
+      return Error(MalformedBlock);
+    case BitstreamEntry::EndBlock:
+      return error_code::success();
+
+    case BitstreamEntry::SubBlock:
+      if (Entry.ID == bitc::MODULE_BLOCK_ID)
+        return ParseModuleSymbols(Symbols, Found);
+
+      // Ignore other sub-blocks.
+      if (Stream.SkipBlock())
+        return Error(MalformedBlock);
+      continue;
+
+    case BitstreamEntry::Record:
+      Stream.skipRecord(Entry.ID);
+      continue;
+    }
+  }
+}
+
 error_code BitcodeReader::ParseTriple(std::string &Triple) {
   if (error_code EC = InitStream())
     return EC;
@@ -2164,6 +2367,13 @@ error_code BitcodeReader::ParseFunctionBody(Function *F) {
         NextValueNo = ValueList.size();
         break;
       case bitc::VALUE_SYMTAB_BLOCK_ID:
+        // A function's symbol table only names its locals, don't bother
+        // reading it if the names would be thrown away.
+        if (Context.shouldDiscardValueNames()) {
+          if (Stream.SkipBlock())
+            return Error(InvalidRecord);
+          break;
+        }
         if (error_code EC = ParseValueSymbolTable())
           return EC;
         break;
@@ -3092,6 +3302,21 @@ error_code BitcodeReader::Materialize(GlobalValue *GV) {
   return error_code::success();
 }
 
+error_code BitcodeReader::MaterializeNextFunction(Function *&F) {
+  F = 0;
+  while (NextFunctionBody != FunctionBodyOrder.size()) {
+    Function *Next = FunctionBodyOrder[NextFunctionBody++];
+    // Skip functions that have been materialized on request already.
+    if (!Next->isMaterializable())
+      continue;
+    if (error_code EC = Materialize(Next))
+      return EC;
+    F = Next;
+    break;
+  }
+  return error_code::success();
+}
+
 bool BitcodeReader::isDematerializable(const GlobalValue *GV) const {
   const Function *F = dyn_cast<Function>(GV);
   if (!F || F->isDeclaration())
@@ -3314,6 +3539,9 @@ Module *llvm::getStreamedBitcodeModule(const std::string &name,
 /// If an error occurs, return null and fill in *ErrMsg if non-null.
 Module *llvm::ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext& Context,
                                std::string *ErrMsg){
+  // Unlike lazy loading, reading the entire module goes through the buffer
+  // from start to end.
+  Buffer->adviseAccess(MemoryBuffer::AP_Sequential);
   Module *M = getLazyBitcodeModule(Buffer, Context, ErrMsg);
   if (!M) return 0;
 
@@ -3333,6 +3561,39 @@ Module *llvm::ParseBitcodeFile(MemoryBuffer *Buffer, LLVMContext& Context,
   return M;
 }
 
+bool llvm::getBitcodeSymbols(MemoryBuffer *Buffer, LLVMContext &Context,
+                             std::vector<BitcodeSymbol> &Symbols,
+                             std::string *ErrMsg) {
+  BitcodeReader *R = new BitcodeReader(Buffer, Context);
+  // Don't let the BitcodeReader dtor delete 'Buffer'.
+  R->setBufferOwned(false);
+
+  bool Found = false;
+  if (error_code EC = R->ParseSymbols(Symbols, Found)) {
+    if (ErrMsg)
+      *ErrMsg = EC.message();
+    Symbols.clear();
+    Found = false;
+  }
+
+  delete R;
+  return Found;
+}
+
+Function *llvm::materializeNextFunction(Module *M, std::string *ErrMsg) {
+  BitcodeReader *R = static_cast<BitcodeReader*>(M->getMaterializer());
+  if (!R)
+    return 0;
+
+  Function *F;
+  if (error_code EC = R->MaterializeNextFunction(F)) {
+    if (ErrMsg)
+      *ErrMsg = EC.message();
+    return 0;
+  }
+  return F;
+}
+
 std::string llvm::getBitcodeTargetTriple(MemoryBuffer *Buffer,
                                          LLVMContext& Context,
                                          std::string *ErrMsg) {
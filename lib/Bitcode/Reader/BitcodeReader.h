@@ -26,6 +26,7 @@
 #include <vector>
 
 namespace llvm {
+  struct BitcodeSymbol;
   class MemoryBuffer;
   class LLVMContext;
 
@@ -179,6 +180,17 @@ class BitcodeReader : public GVMaterializer {
   /// stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// FunctionIndex - The bit positions of the function blocks, in module
+  /// order, as recorded by a MODULE_CODE_FNINDEX record.  Empty if the module
+  /// has no such record.
+  std::vector<uint64_t> FunctionIndex;
+
+  /// FunctionBodyOrder - The functions with bodies, in the order their bodies
+  /// appear in the bitcode, and the position in it of the next body that
+  /// MaterializeNextFunction returns.
+  std::vector<Function*> FunctionBodyOrder;
+  unsigned NextFunctionBody;
+
   /// BlockAddrFwdRefs - These are blockaddr references to basic blocks.  These
   /// are resolved lazily when functions are loaded.
   typedef std::pair<unsigned, GlobalVariable*> BlockAddrRefTy;
@@ -227,13 +239,15 @@ public:
     : Context(C), TheModule(0), Buffer(buffer), BufferOwned(false),
       LazyStreamer(0), NextUnreadBit(0), SeenValueSymbolTable(false),
       ValueList(C), MDValueList(C),
-      SeenFirstFunctionBody(false), UseRelativeIDs(false) {
+      SeenFirstFunctionBody(false), NextFunctionBody(0),
+      UseRelativeIDs(false) {
   }
   explicit BitcodeReader(DataStreamer *streamer, LLVMContext &C)
     : Context(C), TheModule(0), Buffer(0), BufferOwned(false),
       LazyStreamer(streamer), NextUnreadBit(0), SeenValueSymbolTable(false),
       ValueList(C), MDValueList(C),
-      SeenFirstFunctionBody(false), UseRelativeIDs(false) {
+      SeenFirstFunctionBody(false), NextFunctionBody(0),
+      UseRelativeIDs(false) {
   }
   ~BitcodeReader() {
     FreeState();
@@ -253,6 +267,11 @@ public:
   virtual error_code MaterializeModule(Module *M);
   virtual void Dematerialize(GlobalValue *GV);
 
+  /// MaterializeNextFunction - Read the body of the next function in bitcode
+  /// order that has not been read yet, and set F to it.  F is set to null
+  /// once every body has been read.
+  error_code MaterializeNextFunction(Function *&F);
+
   /// @brief Main interface to parsing a bitcode buffer.
   /// @returns true if an error occurred.
   error_code ParseBitcodeInto(Module *M);
@@ -261,6 +280,11 @@ public:
   /// @returns true if an error occurred.
   error_code ParseTriple(std::string &Triple);
 
+  /// @brief Cheap mechanism to just read the module symbol table
+  /// @returns an error if one occurred.  Found is set if the module has a
+  /// symbol table.
+  error_code ParseSymbols(std::vector<BitcodeSymbol> &Symbols, bool &Found);
+
   static uint64_t decodeSignRotatedValue(uint64_t V);
 
 private:
@@ -356,12 +380,16 @@ private:
   error_code ParseValueSymbolTable();
   error_code ParseConstants();
   error_code RememberAndSkipFunctionBody();
+  error_code RememberFunctionBodiesFromIndex(bool &Done);
   error_code ParseFunctionBody(Function *F);
   error_code GlobalCleanup();
   error_code ResolveGlobalAndAliasInits();
   error_code ParseMetadata();
   error_code ParseMetadataAttachment();
   error_code ParseModuleTriple(std::string &Triple);
+  error_code ParseModuleSymbols(std::vector<BitcodeSymbol> &Symbols,
+                                bool &Found);
+  error_code ParseSymbolTable(std::vector<BitcodeSymbol> &Symbols);
   error_code ParseUseLists();
   error_code InitStream();
   error_code InitStreamFromBuffer();
@@ -23,10 +23,12 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cctype>
 #include <map>
@@ -38,6 +40,12 @@ EnablePreserveUseListOrdering("enable-bc-uselist-preserve",
                                        "use-list order preservation."),
                               cl::init(false), cl::Hidden);
 
+static cl::opt<unsigned>
+BitcodeWriterThreads("bitcode-writer-threads",
+                     cl::desc("Number of threads to encode function blocks "
+                              "on (0 or 1 encodes them serially)"),
+                     cl::init(0), cl::Hidden);
+
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
 enum {
@@ -735,20 +743,20 @@ static void WriteModuleMetadata(const Module *M,
       if (!StartedMetadataBlock)  {
         Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
 
-        // Abbrev for METADATA_STRING.
+        // Abbrev for METADATA_STRING.  The characters are emitted as a blob
+        // so that the reader can use them in place, straight out of the
+        // (possibly memory mapped) input buffer.  Readers that do not ask for
+        // the blob still see the usual [strchar x N] record.
         BitCodeAbbrev *Abbv = new BitCodeAbbrev();
         Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_STRING));
-        Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
-        Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+        Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
         MDSAbbrev = Stream.EmitAbbrev(Abbv);
         StartedMetadataBlock = true;
       }
 
       // Code: [strchar x N]
-      Record.append(MDS->begin(), MDS->end());
-
-      // Emit the finished record.
-      Stream.EmitRecord(bitc::METADATA_STRING, Record, MDSAbbrev);
+      Record.push_back(bitc::METADATA_STRING);
+      Stream.EmitRecordWithBlob(MDSAbbrev, Record, MDS->getString());
       Record.clear();
     }
   }
@@ -1547,10 +1555,10 @@ static void WriteValueSymbolTable(const ValueSymbolTable &VST,
   Stream.ExitBlock();
 }
 
-/// WriteFunction - Emit a function body to the module stream.
-static void WriteFunction(const Function &F, ValueEnumerator &VE,
-                          BitstreamWriter &Stream) {
-  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+/// WriteFunctionBody - Emit the contents of the function block of F.  The
+/// caller has entered the block and exits it afterwards.
+static void WriteFunctionBody(const Function &F, ValueEnumerator &VE,
+                              BitstreamWriter &Stream) {
   VE.incorporateFunction(F);
 
   SmallVector<unsigned, 64> Vals;
@@ -1616,6 +1624,13 @@ static void WriteFunction(const Function &F, ValueEnumerator &VE,
   if (NeedsMetadataAttachment)
     WriteMetadataAttachment(F, VE, Stream);
   VE.purgeFunction();
+}
+
+/// WriteFunction - Emit a function body to the module stream.
+static void WriteFunction(const Function &F, ValueEnumerator &VE,
+                          BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+  WriteFunctionBody(F, VE, Stream);
   Stream.ExitBlock();
 }
 
@@ -1880,6 +1895,181 @@ static void WriteModuleUseLists(const Module *M, ValueEnumerator &VE,
 }
 
 /// WriteModule - Emit the specified module to the bitstream.
+/// WriteSymbolTableEntry - Emit the SYMTAB_CODE_ENTRY record of GV.
+static void WriteSymbolTableEntry(const GlobalValue &GV, unsigned Abbrev,
+                                  BitstreamWriter &Stream) {
+  unsigned Kind, Flags = 0;
+  if (const GlobalVariable *GVar = dyn_cast<GlobalVariable>(&GV)) {
+    Kind = bitc::SYMTAB_KIND_VARIABLE;
+    if (GVar->isThreadLocal())
+      Flags |= bitc::SYMTAB_FLAG_THREAD_LOCAL;
+    if (GVar->isConstant())
+      Flags |= bitc::SYMTAB_FLAG_CONSTANT;
+  } else if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(&GV)) {
+    Kind = bitc::SYMTAB_KIND_ALIAS;
+    const GlobalValue *Aliasee = GA->getAliasedGlobal();
+    if (Aliasee && isa<Function>(Aliasee))
+      Flags |= bitc::SYMTAB_FLAG_ALIAS_OF_FUNCTION;
+    else if (Aliasee && isa<GlobalVariable>(Aliasee))
+      Flags |= bitc::SYMTAB_FLAG_ALIAS_OF_VARIABLE;
+  } else {
+    Kind = bitc::SYMTAB_KIND_FUNCTION;
+  }
+  if (GV.isDeclaration())
+    Flags |= bitc::SYMTAB_FLAG_DECLARATION;
+  if (GV.hasUnnamedAddr())
+    Flags |= bitc::SYMTAB_FLAG_UNNAMED_ADDR;
+
+  SmallVector<unsigned, 5> Vals;
+  Vals.push_back(bitc::SYMTAB_CODE_ENTRY);
+  Vals.push_back(Kind);
+  Vals.push_back(getEncodedLinkage(&GV));
+  Vals.push_back(getEncodedVisibility(&GV));
+  Vals.push_back(Flags);
+  Stream.EmitRecordWithBlob(Abbrev, Vals, GV.getName());
+}
+
+/// WriteSymbolTable - Emit the symbol table block, which lists the name,
+/// linkage and visibility of every global value in M.  It goes at the
+/// start of the module block so that getBitcodeSymbols finds it right away.
+static void WriteSymbolTable(const Module *M, BitstreamWriter &Stream) {
+  Stream.EnterSubblock(bitc::SYMTAB_BLOCK_ID, 3);
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::SYMTAB_CODE_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 2));  // kind
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 4));    // linkage
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 2));  // visibility
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));    // flags
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));      // name
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    WriteSymbolTableEntry(*F, EntryAbbrev, Stream);
+  for (Module::const_global_iterator GV = M->global_begin(),
+       E = M->global_end(); GV != E; ++GV)
+    WriteSymbolTableEntry(*GV, EntryAbbrev, Stream);
+  for (Module::const_alias_iterator A = M->alias_begin(), E = M->alias_end();
+       A != E; ++A)
+    WriteSymbolTableEntry(*A, EntryAbbrev, Stream);
+
+  Stream.ExitBlock();
+}
+
+/// WriteFunctionIndexPlaceholder - Emit a MODULE_CODE_FNINDEX record with
+/// room for the offsets of NumBodies function blocks, and return the bit
+/// position the offsets are relative to.  The offsets are filled in by
+/// BackpatchFunctionIndex once the function blocks have been written.
+static uint64_t WriteFunctionIndexPlaceholder(unsigned NumBodies,
+                                              BitstreamWriter &Stream) {
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::MODULE_CODE_FNINDEX));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+  unsigned IndexAbbrev = Stream.EmitAbbrev(Abbv);
+
+  SmallVector<unsigned, 1> Vals;
+  Vals.push_back(bitc::MODULE_CODE_FNINDEX);
+  std::string Placeholder(NumBodies * 8, '\0');
+  Stream.EmitRecordWithBlob(IndexAbbrev, Vals, Placeholder);
+
+  // The blob is word aligned and a multiple of the word size long, so the
+  // record ends on a word boundary right after the last offset.
+  return Stream.GetCurrentBitNo();
+}
+
+/// BackpatchFunctionIndex - Fill in the offsets of the function blocks in the
+/// record written by WriteFunctionIndexPlaceholder.
+static void BackpatchFunctionIndex(ArrayRef<uint64_t> Offsets,
+                                   uint64_t IndexEnd,
+                                   BitstreamWriter &Stream) {
+  unsigned ByteNo = IndexEnd / 8 - Offsets.size() * 8;
+  for (unsigned i = 0, e = Offsets.size(); i != e; ++i, ByteNo += 8) {
+    Stream.BackpatchWord(ByteNo, (uint32_t)Offsets[i]);
+    Stream.BackpatchWord(ByteNo + 4, (uint32_t)(Offsets[i] >> 32));
+  }
+}
+
+namespace {
+/// FunctionBlockJob - The function blocks of a module, encoded by several
+/// threads at once.  Each thread claims the next function that no thread has
+/// taken yet, so a few large functions do not hold up the rest.
+struct FunctionBlockJob {
+  const ValueEnumerator *VE;
+  std::vector<const Function *> Functions;
+  /// Blocks[i] - The encoded block of Functions[i], as taken by
+  /// BitstreamWriter::EmitEncodedSubblock.
+  std::vector<SmallVector<char, 0> > Blocks;
+  volatile sys::cas_flag NextFunction;
+};
+}
+
+/// EncodeFunctionBlocks - Thread body of FunctionBlockJob.  The value IDs of
+/// the function-local values only depend on the module-level enumeration, so
+/// a private copy of the module's enumerator numbers them exactly as the
+/// serial writer does.
+static void EncodeFunctionBlocks(void *Arg) {
+  FunctionBlockJob &Job = *static_cast<FunctionBlockJob *>(Arg);
+  ValueEnumerator VE(*Job.VE);
+  SmallVector<char, 0> Scratch;
+  while (true) {
+    unsigned i = sys::AtomicIncrement(&Job.NextFunction) - 1;
+    if (i >= Job.Functions.size())
+      return;
+
+    // The function block uses the abbreviations of the blockinfo block, so
+    // write one in front of it; only the block itself is kept.
+    Scratch.clear();
+    {
+      BitstreamWriter Stream(Scratch);
+      WriteBlockInfo(VE, Stream);
+      Stream.EnterSubblock(bitc::FUNCTION_BLOCK_ID, 4);
+      unsigned SizeWord = Stream.GetCurrentBitNo() / 8 - 4;
+      WriteFunctionBody(*Job.Functions[i], VE, Stream);
+      Stream.ExitBlock();
+      Job.Blocks[i].append(Scratch.begin() + SizeWord, Scratch.end());
+    }
+  }
+}
+
+/// WriteFunctionBlocks - Emit the function blocks of M, recording the offset
+/// of each from IndexEnd in Offsets.  With BitcodeWriterThreads above one, the
+/// blocks are encoded on that many threads and then copied into Stream in
+/// order, which produces the same bytes as writing them one after another.
+static void WriteFunctionBlocks(const Module *M, ValueEnumerator &VE,
+                                uint64_t IndexEnd,
+                                SmallVectorImpl<uint64_t> &Offsets,
+                                BitstreamWriter &Stream) {
+  unsigned NumThreads = BitcodeWriterThreads;
+  FunctionBlockJob Job;
+  for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (!F->isDeclaration())
+      Job.Functions.push_back(F);
+
+  if (NumThreads <= 1 || Job.Functions.size() <= 1) {
+    for (unsigned i = 0, e = Job.Functions.size(); i != e; ++i) {
+      Offsets.push_back(Stream.GetCurrentBitNo() - IndexEnd);
+      WriteFunction(*Job.Functions[i], VE, Stream);
+    }
+    return;
+  }
+
+  if (NumThreads > Job.Functions.size())
+    NumThreads = Job.Functions.size();
+  Job.VE = &VE;
+  Job.Blocks.resize(Job.Functions.size());
+  Job.NextFunction = 0;
+  std::vector<void *> Args(NumThreads, &Job);
+  llvm_execute_on_threads(EncodeFunctionBlocks, &Args[0], NumThreads);
+
+  for (unsigned i = 0, e = Job.Functions.size(); i != e; ++i) {
+    Offsets.push_back(Stream.GetCurrentBitNo() - IndexEnd);
+    Stream.EmitEncodedSubblock(bitc::FUNCTION_BLOCK_ID, 4,
+                               StringRef(Job.Blocks[i].data(),
+                                         Job.Blocks[i].size()));
+    SmallVector<char, 0>().swap(Job.Blocks[i]);
+  }
+}
+
 static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   Stream.EnterSubblock(bitc::MODULE_BLOCK_ID, 3);
 
@@ -1888,6 +2078,9 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   Vals.push_back(CurVersion);
   Stream.EmitRecord(bitc::MODULE_CODE_VERSION, Vals);
 
+  // Emit the symbol table, for tools that only need to know the symbols.
+  WriteSymbolTable(M, Stream);
+
   // Analyze the module, enumerating globals, functions, etc.
   ValueEnumerator VE(M);
 
@@ -1923,10 +2116,20 @@ static void WriteModule(const Module *M, BitstreamWriter &Stream) {
   if (EnablePreserveUseListOrdering)
     WriteModuleUseLists(M, VE, Stream);
 
-  // Emit function bodies.
+  // Emit an index of the function bodies, so that a lazy reader can find any
+  // of them without walking over the ones in front of it, and then the
+  // function bodies themselves.
+  unsigned NumBodies = 0;
   for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
     if (!F->isDeclaration())
-      WriteFunction(*F, VE, Stream);
+      ++NumBodies;
+
+  if (NumBodies) {
+    uint64_t IndexEnd = WriteFunctionIndexPlaceholder(NumBodies, Stream);
+    SmallVector<uint64_t, 64> Offsets;
+    WriteFunctionBlocks(M, VE, IndexEnd, Offsets, Stream);
+    BackpatchFunctionIndex(Offsets, IndexEnd, Stream);
+  }
 
   Stream.ExitBlock();
 }
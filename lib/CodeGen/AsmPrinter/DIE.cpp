@@ -108,8 +108,10 @@ void DIEAbbrev::dump() { print(dbgs()); }
 //===----------------------------------------------------------------------===//
 
 DIE::~DIE() {
+  // The children live in the same allocator as this DIE; only run their
+  // destructors to free what they allocated on the heap.
   for (unsigned i = 0, N = Children.size(); i < N; ++i)
-    delete Children[i];
+    Children[i]->~DIE();
 }
 
 /// Climb up the parent chain to get the unit DIE to which this DIE
@@ -31,19 +31,22 @@ namespace llvm {
   /// DIEAbbrevData - Dwarf abbreviation data, describes one attribute of a
   /// Dwarf abbreviation.
   class DIEAbbrevData {
-    /// Attribute - Dwarf attribute code.
+    /// Attribute - Dwarf attribute code.  Every attribute code, vendor
+    /// extensions included, fits in 16 bits.
     ///
-    dwarf::Attribute Attribute;
+    uint16_t Attribute;
 
     /// Form - Dwarf form code.
     ///
-    dwarf::Form Form;
+    uint16_t Form;
   public:
     DIEAbbrevData(dwarf::Attribute A, dwarf::Form F) : Attribute(A), Form(F) {}
 
     // Accessors.
-    dwarf::Attribute getAttribute() const { return Attribute; }
-    dwarf::Form getForm() const { return Form; }
+    dwarf::Attribute getAttribute() const {
+      return (dwarf::Attribute)Attribute;
+    }
+    dwarf::Form getForm() const { return (dwarf::Form)Form; }
 
     /// Profile - Used to gather unique data for the abbreviation folding set.
     ///
@@ -56,7 +59,7 @@ namespace llvm {
   class DIEAbbrev : public FoldingSetNode {
     /// Tag - Dwarf tag code.
     ///
-    dwarf::Tag Tag;
+    uint16_t Tag;
 
     /// ChildrenFlag - Dwarf children flag.
     ///
@@ -66,15 +69,16 @@ namespace llvm {
     ///
     unsigned Number;
 
-    /// Data - Raw data bytes for abbreviation.
+    /// Data - Raw data bytes for abbreviation.  Most DIEs have only a handful
+    /// of attributes, which are kept inline.
     ///
-    SmallVector<DIEAbbrevData, 12> Data;
+    SmallVector<DIEAbbrevData, 6> Data;
 
   public:
     DIEAbbrev(dwarf::Tag T, uint16_t C) : Tag(T), ChildrenFlag(C), Data() {}
 
     // Accessors.
-    dwarf::Tag getTag() const { return Tag; }
+    dwarf::Tag getTag() const { return (dwarf::Tag)Tag; }
     unsigned getNumber() const { return Number; }
     uint16_t getChildrenFlag() const { return ChildrenFlag; }
     const SmallVectorImpl<DIEAbbrevData> &getData() const { return Data; }
@@ -104,6 +108,10 @@ namespace llvm {
   //===--------------------------------------------------------------------===//
   /// DIE - A structured debug information entry.  Has an abbreviation which
   /// describes its organization.
+  ///
+  /// DIEs are allocated in a BumpPtrAllocator.  A DIE owns its children:
+  /// destroying it runs their destructors, but does not free their memory,
+  /// which goes away with the allocator.
   class DIEValue;
 
   class DIE {
@@ -128,7 +136,7 @@ namespace llvm {
 
     /// Attribute values.
     ///
-    SmallVector<DIEValue*, 12> Values;
+    SmallVector<DIEValue*, 6> Values;
 
   public:
     explicit DIE(unsigned Tag)
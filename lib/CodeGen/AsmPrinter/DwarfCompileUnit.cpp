@@ -41,28 +41,31 @@ static cl::opt<bool> GenerateTypeUnits("generate-type-units", cl::Hidden,
 CompileUnit::CompileUnit(unsigned UID, DIE *D, DICompileUnit Node,
                          AsmPrinter *A, DwarfDebug *DW, DwarfUnits *DWU)
     : UniqueID(UID), Node(Node), Language(Node.getLanguage()), CUDie(D),
-      DebugInfoOffset(0), Asm(A), DD(DW), DU(DWU), IndexTyDie(0) {
-  DIEIntegerOne = new (DIEValueAllocator) DIEInteger(1);
+      DebugInfoOffset(0), Asm(A), DD(DW), DU(DWU), IndexTyDie(0),
+      DIEAllocator(DW->getDIEAllocator()) {
+  DIEIntegerOne = new (DIEAllocator) DIEInteger(1);
   insertDIE(Node, D);
 }
 
 CompileUnit::CompileUnit(unsigned UID, DIE *D, uint16_t Language, AsmPrinter *A,
                          DwarfDebug *DD, DwarfUnits *DU)
     : UniqueID(UID), Node(NULL), Language(Language), CUDie(D),
-      DebugInfoOffset(0), Asm(A), DD(DD), DU(DU), IndexTyDie(0) {
-  DIEIntegerOne = new (DIEValueAllocator) DIEInteger(1);
+      DebugInfoOffset(0), Asm(A), DD(DD), DU(DU), IndexTyDie(0),
+      DIEAllocator(DD->getDIEAllocator()) {
+  DIEIntegerOne = new (DIEAllocator) DIEInteger(1);
 }
 
 /// ~CompileUnit - Destructor for compile unit.
 CompileUnit::~CompileUnit() {
   for (unsigned j = 0, M = DIEBlocks.size(); j < M; ++j)
     DIEBlocks[j]->~DIEBlock();
+  CUDie->~DIE();
 }
 
 /// createDIEEntry - Creates a new DIEEntry to be a proxy for a debug
 /// information entry.
 DIEEntry *CompileUnit::createDIEEntry(DIE *Entry) {
-  DIEEntry *Value = new (DIEValueAllocator) DIEEntry(Entry);
+  DIEEntry *Value = new (DIEAllocator) DIEEntry(Entry);
   return Value;
 }
 
@@ -159,7 +162,7 @@ void CompileUnit::addUInt(DIE *Die, dwarf::Attribute Attribute,
                           Optional<dwarf::Form> Form, uint64_t Integer) {
   if (!Form)
     Form = DIEInteger::BestForm(false, Integer);
-  DIEValue *Value = Integer == 1 ? DIEIntegerOne : new (DIEValueAllocator)
+  DIEValue *Value = Integer == 1 ? DIEIntegerOne : new (DIEAllocator)
                         DIEInteger(Integer);
   Die->addValue(Attribute, *Form, Value);
 }
@@ -174,7 +177,7 @@ void CompileUnit::addSInt(DIE *Die, dwarf::Attribute Attribute,
                           Optional<dwarf::Form> Form, int64_t Integer) {
   if (!Form)
     Form = DIEInteger::BestForm(true, Integer);
-  DIEValue *Value = new (DIEValueAllocator) DIEInteger(Integer);
+  DIEValue *Value = new (DIEAllocator) DIEInteger(Integer);
   Die->addValue(Attribute, *Form, Value);
 }
 
@@ -195,18 +198,18 @@ void CompileUnit::addString(DIE *Die, dwarf::Attribute Attribute,
   if (!DD->useSplitDwarf()) {
     MCSymbol *Symb = DU->getStringPoolEntry(String);
     if (Asm->needsRelocationsForDwarfStringPool())
-      Value = new (DIEValueAllocator) DIELabel(Symb);
+      Value = new (DIEAllocator) DIELabel(Symb);
     else {
       MCSymbol *StringPool = DU->getStringPoolSym();
-      Value = new (DIEValueAllocator) DIEDelta(Symb, StringPool);
+      Value = new (DIEAllocator) DIEDelta(Symb, StringPool);
     }
     Form = dwarf::DW_FORM_strp;
   } else {
     unsigned idx = DU->getStringPoolIndex(String);
-    Value = new (DIEValueAllocator) DIEInteger(idx);
+    Value = new (DIEAllocator) DIEInteger(idx);
     Form = dwarf::DW_FORM_GNU_str_index;
   }
-  DIEValue *Str = new (DIEValueAllocator) DIEString(Value, String);
+  DIEValue *Str = new (DIEAllocator) DIEString(Value, String);
   Die->addValue(Attribute, Form, Str);
 }
 
@@ -217,10 +220,10 @@ void CompileUnit::addLocalString(DIE *Die, dwarf::Attribute Attribute,
   MCSymbol *Symb = DU->getStringPoolEntry(String);
   DIEValue *Value;
   if (Asm->needsRelocationsForDwarfStringPool())
-    Value = new (DIEValueAllocator) DIELabel(Symb);
+    Value = new (DIEAllocator) DIELabel(Symb);
   else {
     MCSymbol *StringPool = DU->getStringPoolSym();
-    Value = new (DIEValueAllocator) DIEDelta(Symb, StringPool);
+    Value = new (DIEAllocator) DIEDelta(Symb, StringPool);
   }
   Die->addValue(Attribute, dwarf::DW_FORM_strp, Value);
 }
@@ -228,7 +231,7 @@ void CompileUnit::addLocalString(DIE *Die, dwarf::Attribute Attribute,
 /// addExpr - Add a Dwarf expression attribute data and value.
 ///
 void CompileUnit::addExpr(DIEBlock *Die, dwarf::Form Form, const MCExpr *Expr) {
-  DIEValue *Value = new (DIEValueAllocator) DIEExpr(Expr);
+  DIEValue *Value = new (DIEAllocator) DIEExpr(Expr);
   Die->addValue((dwarf::Attribute)0, Form, Value);
 }
 
@@ -236,7 +239,7 @@ void CompileUnit::addExpr(DIEBlock *Die, dwarf::Form Form, const MCExpr *Expr) {
 ///
 void CompileUnit::addLabel(DIE *Die, dwarf::Attribute Attribute,
                            dwarf::Form Form, const MCSymbol *Label) {
-  DIEValue *Value = new (DIEValueAllocator) DIELabel(Label);
+  DIEValue *Value = new (DIEAllocator) DIELabel(Label);
   Die->addValue(Attribute, Form, Value);
 }
 
@@ -255,15 +258,15 @@ void CompileUnit::addLabelAddress(DIE *Die, dwarf::Attribute Attribute,
 
   if (!DD->useSplitDwarf()) {
     if (Label != NULL) {
-      DIEValue *Value = new (DIEValueAllocator) DIELabel(Label);
+      DIEValue *Value = new (DIEAllocator) DIELabel(Label);
       Die->addValue(Attribute, dwarf::DW_FORM_addr, Value);
     } else {
-      DIEValue *Value = new (DIEValueAllocator) DIEInteger(0);
+      DIEValue *Value = new (DIEAllocator) DIEInteger(0);
       Die->addValue(Attribute, dwarf::DW_FORM_addr, Value);
     }
   } else {
     unsigned idx = DU->getAddrPoolIndex(Label);
-    DIEValue *Value = new (DIEValueAllocator) DIEInteger(idx);
+    DIEValue *Value = new (DIEAllocator) DIEInteger(idx);
     Die->addValue(Attribute, dwarf::DW_FORM_GNU_addr_index, Value);
   }
 }
@@ -287,7 +290,7 @@ void CompileUnit::addOpAddress(DIEBlock *Die, const MCSymbol *Sym) {
 void CompileUnit::addDelta(DIE *Die, dwarf::Attribute Attribute,
                            dwarf::Form Form, const MCSymbol *Hi,
                            const MCSymbol *Lo) {
-  DIEValue *Value = new (DIEValueAllocator) DIEDelta(Hi, Lo);
+  DIEValue *Value = new (DIEAllocator) DIEDelta(Hi, Lo);
   Die->addValue(Attribute, Form, Value);
 }
 
@@ -315,7 +318,7 @@ void CompileUnit::addDIEEntry(DIE *Die, dwarf::Attribute Attribute,
 /// Create a DIE with the given Tag, add the DIE to its parent, and
 /// call insertDIE if MD is not null.
 DIE *CompileUnit::createAndAddDIE(unsigned Tag, DIE &Parent, DIDescriptor N) {
-  DIE *Die = new DIE(Tag);
+  DIE *Die = new (DIEAllocator) DIE(Tag);
   Parent.addChild(Die);
   if (N)
     insertDIE(N, Die);
@@ -486,7 +489,7 @@ void CompileUnit::addRegisterOffset(DIEBlock *TheDie, unsigned Reg,
 /// provided.
 void CompileUnit::addAddress(DIE *Die, dwarf::Attribute Attribute,
                              const MachineLocation &Location, bool Indirect) {
-  DIEBlock *Block = new (DIEValueAllocator) DIEBlock();
+  DIEBlock *Block = new (DIEAllocator) DIEBlock();
 
   if (Location.isReg() && !Indirect)
     addRegisterOp(Block, Location.getReg());
@@ -509,7 +512,7 @@ void CompileUnit::addAddress(DIE *Die, dwarf::Attribute Attribute,
 void CompileUnit::addComplexAddress(const DbgVariable &DV, DIE *Die,
                                     dwarf::Attribute Attribute,
                                     const MachineLocation &Location) {
-  DIEBlock *Block = new (DIEValueAllocator) DIEBlock();
+  DIEBlock *Block = new (DIEAllocator) DIEBlock();
   unsigned N = DV.getNumAddrElements();
   unsigned i = 0;
   if (Location.isReg()) {
@@ -638,7 +641,7 @@ void CompileUnit::addBlockByrefAddress(const DbgVariable &DV, DIE *Die,
 
   // Decode the original location, and use that as the start of the byref
   // variable's location.
-  DIEBlock *Block = new (DIEValueAllocator) DIEBlock();
+  DIEBlock *Block = new (DIEAllocator) DIEBlock();
 
   if (Location.isReg())
     addRegisterOp(Block, Location.getReg());
@@ -775,7 +778,7 @@ void CompileUnit::addConstantValue(DIE *Die, const MachineOperand &MO,
 /// addConstantFPValue - Add constant value entry in variable DIE.
 void CompileUnit::addConstantFPValue(DIE *Die, const MachineOperand &MO) {
   assert(MO.isFPImm() && "Invalid machine operand!");
-  DIEBlock *Block = new (DIEValueAllocator) DIEBlock();
+  DIEBlock *Block = new (DIEAllocator) DIEBlock();
   APFloat FPImm = MO.getFPImm()->getValueAPF();
 
   // Get the raw data form of the floating point.
@@ -842,7 +845,7 @@ void CompileUnit::addConstantValue(DIE *Die, const APInt &Val, bool Unsigned) {
     return;
   }
 
-  DIEBlock *Block = new (DIEValueAllocator) DIEBlock();
+  DIEBlock *Block = new (DIEAllocator) DIEBlock();
 
   // Get the raw data form of the large APInt.
   const uint64_t *Ptr64 = Val.getRawData();
@@ -1379,7 +1382,7 @@ CompileUnit::constructTemplateValueParameterDIE(DIE &Buffer,
     else if (GlobalValue *GV = dyn_cast<GlobalValue>(Val)) {
       // For declaration non-type template parameters (such as global values and
       // functions)
-      DIEBlock *Block = new (DIEValueAllocator) DIEBlock();
+      DIEBlock *Block = new (DIEAllocator) DIEBlock();
       addOpAddress(Block, Asm->getSymbol(GV));
       // Emit DW_OP_stack_value to use the address as the immediate value of the
       // parameter, rather than a pointer to it.
@@ -1432,7 +1435,7 @@ DIE *CompileUnit::getOrCreateSubprogramDIE(DISubprogram SP) {
   DISubprogram SPDecl = SP.getFunctionDeclaration();
   if (SPDecl.isSubprogram())
     // Add subprogram definitions to the CU die directly.
-    ContextDIE = CUDie.get();
+    ContextDIE = CUDie;
 
   // DW_TAG_inlined_subroutine may refer to this DIE.
   SPDie = createAndAddDIE(dwarf::DW_TAG_subprogram, *ContextDIE, SP);
@@ -1603,7 +1606,7 @@ void CompileUnit::createGlobalVariableDIE(DIGlobalVariable GV) {
   bool isGlobalVariable = GV.getGlobal() != NULL;
   if (isGlobalVariable) {
     addToAccelTable = true;
-    DIEBlock *Block = new (DIEValueAllocator) DIEBlock();
+    DIEBlock *Block = new (DIEAllocator) DIEBlock();
     const MCSymbol *Sym = Asm->getSymbol(GV.getGlobal());
     if (GV.getGlobal()->isThreadLocal()) {
       // FIXME: Make this work with -gsplit-dwarf.
@@ -1662,7 +1665,7 @@ void CompileUnit::createGlobalVariableDIE(DIGlobalVariable GV) {
   } else if (const ConstantExpr *CE = getMergedGlobalExpr(GV->getOperand(11))) {
     addToAccelTable = true;
     // GV is a merged global.
-    DIEBlock *Block = new (DIEValueAllocator) DIEBlock();
+    DIEBlock *Block = new (DIEAllocator) DIEBlock();
     Value *Ptr = CE->getOperand(0);
     addOpAddress(Block, Asm->getSymbol(cast<GlobalValue>(Ptr)));
     addUInt(Block, dwarf::DW_FORM_data1, dwarf::DW_OP_constu);
@@ -1728,7 +1731,7 @@ void CompileUnit::constructArrayTypeDIE(DIE &Buffer, DICompositeType CTy) {
   DIE *IdxTy = getIndexTyDie();
   if (!IdxTy) {
     // Construct an anonymous type for index type.
-    IdxTy = createAndAddDIE(dwarf::DW_TAG_base_type, *CUDie.get());
+    IdxTy = createAndAddDIE(dwarf::DW_TAG_base_type, *CUDie);
     addString(IdxTy, dwarf::DW_AT_name, "int");
     addUInt(IdxTy, dwarf::DW_AT_byte_size, None, sizeof(int32_t));
     addUInt(IdxTy, dwarf::DW_AT_encoding, dwarf::DW_FORM_data1,
@@ -1790,7 +1793,7 @@ DIE *CompileUnit::constructVariableDIE(DbgVariable &DV, bool isScopeAbstract) {
   StringRef Name = DV.getName();
 
   // Define variable debug information entry.
-  DIE *VariableDie = new DIE(DV.getTag());
+  DIE *VariableDie = new (DIEAllocator) DIE(DV.getTag());
   DbgVariable *AbsVar = DV.getAbstractVariable();
   DIE *AbsDIE = AbsVar ? AbsVar->getDIE() : NULL;
   if (AbsDIE)
@@ -1871,7 +1874,7 @@ void CompileUnit::constructMemberDIE(DIE &Buffer, DIDerivedType DT) {
 
   addSourceLine(MemberDie, DT);
 
-  DIEBlock *MemLocationDie = new (DIEValueAllocator) DIEBlock();
+  DIEBlock *MemLocationDie = new (DIEAllocator) DIEBlock();
   addUInt(MemLocationDie, dwarf::DW_FORM_data1, dwarf::DW_OP_plus_uconst);
 
   if (DT.getTag() == dwarf::DW_TAG_inheritance && DT.isVirtual()) {
@@ -1880,7 +1883,7 @@ void CompileUnit::constructMemberDIE(DIE &Buffer, DIDerivedType DT) {
     // expression to extract appropriate offset from vtable.
     // BaseAddr = ObAddr + *((*ObAddr) - Offset)
 
-    DIEBlock *VBaseLocationDie = new (DIEValueAllocator) DIEBlock();
+    DIEBlock *VBaseLocationDie = new (DIEAllocator) DIEBlock();
     addUInt(VBaseLocationDie, dwarf::DW_FORM_data1, dwarf::DW_OP_dup);
     addUInt(VBaseLocationDie, dwarf::DW_FORM_data1, dwarf::DW_OP_deref);
     addUInt(VBaseLocationDie, dwarf::DW_FORM_data1, dwarf::DW_OP_constu);
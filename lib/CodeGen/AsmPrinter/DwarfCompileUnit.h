@@ -44,8 +44,9 @@ class CompileUnit {
   /// Language - Language for the translation unit associated with this CU.
   uint16_t Language;
 
-  /// CUDie - Compile unit debug information entry.
-  const OwningPtr<DIE> CUDie;
+  /// CUDie - Compile unit debug information entry.  Allocated in
+  /// DIEAllocator and destroyed with the unit.
+  DIE *const CUDie;
 
   /// Offset of the CUDie from beginning of debug info section.
   unsigned DebugInfoOffset;
@@ -94,8 +95,9 @@ class CompileUnit {
   /// corresponds to the MDNode mapped with the subprogram DIE.
   DenseMap<DIE *, const MDNode *> ContainingTypeMap;
 
-  // DIEValueAllocator - All DIEValues are allocated through this allocator.
-  BumpPtrAllocator DIEValueAllocator;
+  // DIEAllocator - All DIEs and DIEValues are allocated through this
+  // allocator, which is shared by all the units of a DwarfDebug.
+  BumpPtrAllocator &DIEAllocator;
 
   // DIEIntegerOne - A preallocated DIEValue because 1 is used frequently.
   DIEInteger *DIEIntegerOne;
@@ -111,7 +113,7 @@ public:
   unsigned getUniqueID() const { return UniqueID; }
   uint16_t getLanguage() const { return Language; }
   DICompileUnit getNode() const { return Node; }
-  DIE *getCUDie() const { return CUDie.get(); }
+  DIE *getCUDie() const { return CUDie; }
   const StringMap<const DIE *> &getGlobalNames() const { return GlobalNames; }
   const StringMap<const DIE *> &getGlobalTypes() const { return GlobalTypes; }
 
@@ -169,7 +171,7 @@ public:
   DIE *getDIE(DIDescriptor D) const;
 
   /// getDIEBlock - Returns a fresh newly allocated DIEBlock.
-  DIEBlock *getDIEBlock() { return new (DIEValueAllocator) DIEBlock(); }
+  DIEBlock *getDIEBlock() { return new (DIEAllocator) DIEBlock(); }
 
   /// insertDIE - Insert DIE into the map. We delegate the request to DwarfDebug
   /// when the MDNode can be part of the type system, since DIEs for
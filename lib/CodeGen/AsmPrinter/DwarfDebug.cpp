@@ -33,6 +33,7 @@
 #include "llvm/MC/MCSection.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSymbol.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Dwarf.h"
@@ -41,6 +42,7 @@
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Timer.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/Target/TargetFrameLowering.h"
 #include "llvm/Target/TargetLoweringObjectFile.h"
@@ -49,6 +51,8 @@
 #include "llvm/Target/TargetRegisterInfo.h"
 using namespace llvm;
 
+STATISTIC(DIEBytes, "Number of bytes allocated for DIEs and their values");
+
 static cl::opt<bool>
 DisableDebugInfoPrinting("disable-debug-info-print", cl::Hidden,
                          cl::desc("Disable debug info printing"));
@@ -67,6 +71,11 @@ static cl::opt<bool> GenerateCUHash("generate-cu-hash", cl::Hidden,
                                     cl::desc("Add the CU hash as the dwo_id."),
                                     cl::init(false));
 
+static cl::opt<unsigned> DwarfUnitThreads(
+    "dwarf-unit-threads", cl::Hidden, cl::init(0),
+    cl::desc("Number of threads laying out the DIEs of the units (0 or 1 "
+             "lays them out on the calling thread)"));
+
 static cl::opt<bool>
 GenerateGnuPubSections("generate-gnu-dwarf-pub-sections", cl::Hidden,
                        cl::desc("Generate GNU-style pubnames and pubtypes"),
@@ -460,7 +469,7 @@ DIE *DwarfDebug::constructLexicalScopeDIE(CompileUnit *TheCU,
   if (isLexicalScopeDIENull(Scope))
     return 0;
 
-  DIE *ScopeDIE = new DIE(dwarf::DW_TAG_lexical_block);
+  DIE *ScopeDIE = new (DIEAllocator) DIE(dwarf::DW_TAG_lexical_block);
   if (Scope->isAbstractScope())
     return ScopeDIE;
 
@@ -519,7 +528,7 @@ DIE *DwarfDebug::constructInlinedScopeDIE(CompileUnit *TheCU,
     return NULL;
   }
 
-  DIE *ScopeDIE = new DIE(dwarf::DW_TAG_inlined_subroutine);
+  DIE *ScopeDIE = new (DIEAllocator) DIE(dwarf::DW_TAG_inlined_subroutine);
   TheCU->addDIEEntry(ScopeDIE, dwarf::DW_AT_abstract_origin, OriginDIE);
 
   if (Ranges.size() > 1) {
@@ -728,7 +737,7 @@ CompileUnit *DwarfDebug::constructCompileUnit(DICompileUnit DIUnit) {
   StringRef FN = DIUnit.getFilename();
   CompilationDir = DIUnit.getDirectory();
 
-  DIE *Die = new DIE(dwarf::DW_TAG_compile_unit);
+  DIE *Die = new (DIEAllocator) DIE(dwarf::DW_TAG_compile_unit);
   CompileUnit *NewCU = new CompileUnit(GlobalCUIndexCount++, Die, DIUnit, Asm,
                                        this, &InfoHolder);
 
@@ -872,7 +881,7 @@ void DwarfDebug::constructImportedEntityDIE(CompileUnit *TheCU,
   assert(Module.Verify() &&
          "Use one of the MDNode * overloads to handle invalid metadata");
   assert(Context && "Should always have a context for an imported_module");
-  DIE *IMDie = new DIE(Module.getTag());
+  DIE *IMDie = new (DIEAllocator) DIE(Module.getTag());
   TheCU->insertDIE(Module, IMDie);
   DIE *EntityDie;
   DIDescriptor Entity = Module.getEntity();
@@ -1203,6 +1212,10 @@ void DwarfDebug::endModule() {
        I != E; ++I)
     delete *I;
 
+  // The units destroyed their DIEs; release the memory of them all at once.
+  DIEBytes += DIEAllocator.getTotalMemory();
+  DIEAllocator.Reset();
+
   // Reset these for the next Module if we have one.
   FirstCU = NULL;
 }
@@ -1946,6 +1959,12 @@ unsigned DwarfUnits::computeSizeAndOffset(DIE *Die, unsigned Offset) {
 
 // Compute the size and offset for each DIE.
 void DwarfUnits::computeSizeAndOffsets() {
+  if (DwarfUnitThreads > 1 && CUs.size() > 1) {
+    computeSizeAndOffsetsInParallel(std::min<unsigned>(DwarfUnitThreads,
+                                                       CUs.size()));
+    return;
+  }
+
   // Offset from the first CU in the debug info section is 0 initially.
   unsigned SecOffset = 0;
 
@@ -1966,6 +1985,156 @@ void DwarfUnits::computeSizeAndOffsets() {
   }
 }
 
+namespace {
+/// UnitLayout - The state of one unit in computeSizeAndOffsetsInParallel.
+struct UnitLayout {
+  AsmPrinter *Asm;
+  DIE *UnitDie;
+  unsigned HeaderSize;
+  // The distinct abbreviations of the unit in the order they first appear.
+  // Until the numbers are merged, each DIE's abbreviation is numbered by its
+  // position here.
+  std::vector<DIEAbbrev *> Abbrevs;
+  // The final number of each of Abbrevs.
+  std::vector<unsigned> Numbers;
+  unsigned EndOffset;
+};
+
+/// ParallelLayout - The units being laid out, handed out to the threads one
+/// at a time.
+struct ParallelLayout {
+  std::vector<UnitLayout> Units;
+  volatile sys::cas_flag NextUnit;
+  void (*Step)(UnitLayout &);
+};
+}
+
+// Number the abbreviations of the DIEs under Die by their first appearance,
+// as assignAbbrevNumber does, but within the unit only.
+static void collectAbbrevs(DIE *Die, FoldingSet<DIEAbbrev> &Set,
+                           std::vector<DIEAbbrev *> &Abbrevs) {
+  DIEAbbrev &Abbrev = Die->getAbbrev();
+  DIEAbbrev *InSet = Set.GetOrInsertNode(&Abbrev);
+  if (InSet == &Abbrev) {
+    Abbrevs.push_back(&Abbrev);
+    Abbrev.setNumber(Abbrevs.size());
+  } else {
+    Abbrev.setNumber(InSet->getNumber());
+  }
+
+  const std::vector<DIE *> &Children = Die->getChildren();
+  for (unsigned j = 0, M = Children.size(); j < M; ++j)
+    collectAbbrevs(Children[j], Set, Abbrevs);
+}
+
+static void collectUnitAbbrevs(UnitLayout &U) {
+  // The set is only used to find duplicates.  It is dropped without clearing
+  // the nodes' links, which the holder's set overwrites when it takes over
+  // the ones it keeps.
+  FoldingSet<DIEAbbrev> Set;
+  collectAbbrevs(U.UnitDie, Set, U.Abbrevs);
+}
+
+// Give Die its final abbreviation number and lay it out like
+// DwarfUnits::computeSizeAndOffset.
+static unsigned layoutDIE(UnitLayout &U, DIE *Die, unsigned Offset) {
+  DIEAbbrev &Abbrev = Die->getAbbrev();
+  unsigned AbbrevNumber = U.Numbers[Abbrev.getNumber() - 1];
+  Abbrev.setNumber(AbbrevNumber);
+
+  Die->setOffset(Offset);
+  Offset += MCAsmInfo::getULEB128Size(AbbrevNumber);
+
+  const SmallVectorImpl<DIEValue *> &Values = Die->getValues();
+  const SmallVectorImpl<DIEAbbrevData> &AbbrevData = Abbrev.getData();
+  for (unsigned i = 0, N = Values.size(); i < N; ++i)
+    Offset += Values[i]->SizeOf(U.Asm, AbbrevData[i].getForm());
+
+  const std::vector<DIE *> &Children = Die->getChildren();
+  if (!Children.empty()) {
+    assert(Abbrev.getChildrenFlag() == dwarf::DW_CHILDREN_yes &&
+           "Children flag not set");
+
+    for (unsigned j = 0, M = Children.size(); j < M; ++j)
+      Offset = layoutDIE(U, Children[j], Offset);
+
+    // End of children marker.
+    Offset += sizeof(int8_t);
+  }
+
+  Die->setSize(Offset - Die->getOffset());
+  return Offset;
+}
+
+static void layoutUnit(UnitLayout &U) {
+  U.EndOffset = layoutDIE(U, U.UnitDie, sizeof(int32_t) + U.HeaderSize);
+}
+
+static void runLayoutStep(void *Arg) {
+  ParallelLayout &L = *static_cast<ParallelLayout *>(Arg);
+  for (;;) {
+    unsigned i = sys::AtomicIncrement(&L.NextUnit) - 1;
+    if (i >= L.Units.size())
+      return;
+    L.Step(L.Units[i]);
+  }
+}
+
+static void runLayoutStepOnThreads(ParallelLayout &L,
+                                   void (*Step)(UnitLayout &),
+                                   unsigned NumThreads) {
+  L.Step = Step;
+  L.NextUnit = 0;
+  std::vector<void *> Work(NumThreads, &L);
+  llvm_execute_on_threads(runLayoutStep, &Work[0], Work.size());
+}
+
+// Lay out the units on several threads.  The abbreviation numbers depend on
+// the order in which the abbreviations first appear across all the units, so
+// the threads first find the distinct abbreviations of each unit, and they
+// are then numbered in unit order, exactly as the serial walk numbers them.
+// With the numbers known, which determine the size of the abbreviation
+// codes, every unit is sized independently, and only the unit offsets are
+// added up in order at the end.
+void DwarfUnits::computeSizeAndOffsetsInParallel(unsigned NumThreads) {
+  ParallelLayout L;
+  L.Units.resize(CUs.size());
+  for (unsigned i = 0, e = CUs.size(); i != e; ++i) {
+    L.Units[i].Asm = Asm;
+    L.Units[i].UnitDie = CUs[i]->getCUDie();
+    L.Units[i].HeaderSize = CUs[i]->getHeaderSize();
+  }
+
+  runLayoutStepOnThreads(L, collectUnitAbbrevs, NumThreads);
+
+  // The abbreviations added here keep their unit-local numbers until
+  // layoutUnit renumbers their DIEs, so their final numbers are kept aside.
+  DenseMap<const DIEAbbrev *, unsigned> NewNumbers;
+  for (unsigned i = 0, e = L.Units.size(); i != e; ++i) {
+    UnitLayout &U = L.Units[i];
+    U.Numbers.reserve(U.Abbrevs.size());
+    for (unsigned j = 0, je = U.Abbrevs.size(); j != je; ++j) {
+      DIEAbbrev *InSet = AbbreviationsSet->GetOrInsertNode(U.Abbrevs[j]);
+      if (InSet == U.Abbrevs[j]) {
+        Abbreviations.push_back(InSet);
+        NewNumbers[InSet] = Abbreviations.size();
+        U.Numbers.push_back(Abbreviations.size());
+      } else {
+        unsigned Number = NewNumbers.lookup(InSet);
+        U.Numbers.push_back(Number ? Number : InSet->getNumber());
+      }
+    }
+  }
+
+  runLayoutStepOnThreads(L, layoutUnit, NumThreads);
+
+  unsigned SecOffset = 0;
+  for (unsigned i = 0, e = CUs.size(); i != e; ++i) {
+    CUs[i]->setDebugInfoOffset(SecOffset);
+    SecOffset += L.Units[i].EndOffset;
+  }
+}
+
 // Emit initial Dwarf sections with a label at the start of each one.
 void DwarfDebug::emitSectionLabels() {
   const TargetLoweringObjectFile &TLOF = Asm->getObjFileLowering();
@@ -2947,7 +3116,7 @@ void DwarfDebug::emitDebugMacInfo() {
 // DW_AT_ranges_base, DW_AT_addr_base.
 CompileUnit *DwarfDebug::constructSkeletonCU(const CompileUnit *CU) {
 
-  DIE *Die = new DIE(dwarf::DW_TAG_compile_unit);
+  DIE *Die = new (DIEAllocator) DIE(dwarf::DW_TAG_compile_unit);
   CompileUnit *NewCU = new CompileUnit(CU->getUniqueID(), Die, CU->getNode(),
                                        Asm, this, &SkeletonHolder);
 
@@ -3058,7 +3227,7 @@ void DwarfDebug::addTypeUnitType(DIE *RefDie, DICompositeType CTy) {
       return;
     }
   } else {
-    DIE *UnitDie = new DIE(dwarf::DW_TAG_type_unit);
+    DIE *UnitDie = new (DIEAllocator) DIE(dwarf::DW_TAG_type_unit);
     CompileUnit *NewCU =
         new CompileUnit(GlobalCUIndexCount++, UnitDie,
                         dwarf::DW_LANG_C_plus_plus, Asm, this, &InfoHolder);
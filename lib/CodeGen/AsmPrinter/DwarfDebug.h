@@ -262,6 +262,11 @@ public:
   /// \brief Compute the size and offset of all the DIEs.
   void computeSizeAndOffsets();
 
+  /// \brief Compute the size and offset of all the DIEs, laying out the
+  /// units on \p NumThreads threads.  The result is the same as with
+  /// computeSizeAndOffsets.
+  void computeSizeAndOffsetsInParallel(unsigned NumThreads);
+
   /// \brief Define a unique number for the abbreviation.
   void assignAbbrevNumber(DIEAbbrev &Abbrev);
 
@@ -321,6 +326,10 @@ class DwarfDebug {
   // All DIEValues are allocated through this allocator.
   BumpPtrAllocator DIEValueAllocator;
 
+  // All DIEs, and the DIEValues of the units, are allocated through this
+  // allocator.  Its memory is released once the units are destroyed.
+  BumpPtrAllocator DIEAllocator;
+
   // Handle to the a compile unit used for the inline extension handling.
   CompileUnit *FirstCU;
 
@@ -679,6 +688,9 @@ public:
     return MDTypeNodeToDieMap.lookup(TypeMD);
   }
 
+  /// \brief Return the allocator of the DIEs and their values.
+  BumpPtrAllocator &getDIEAllocator() { return DIEAllocator; }
+
   /// \brief Emit all Dwarf sections that should come prior to the
   /// content.
   void beginModule();
@@ -84,6 +84,7 @@ public:
   virtual unsigned getJumpBufSize() const;
   virtual bool shouldBuildLookupTables() const;
   virtual bool haveFastSqrt(Type *Ty) const;
+  virtual bool shouldExpandDivisionByInvariant(Type *Ty) const;
   virtual void getUnrollingPreferences(Loop *L, UnrollingPreferences &UP) const;
 
   /// @}
@@ -109,6 +110,14 @@ public:
   virtual unsigned getMemoryOpCost(unsigned Opcode, Type *Src,
                                    unsigned Alignment,
                                    unsigned AddressSpace) const;
+  virtual unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              ArrayRef<unsigned> Indices,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const;
+  virtual bool isLegalGather(Type *DataTy, Type *IndexTy) const;
+  virtual unsigned getGatherOpCost(Type *DataTy, Type *IndexTy,
+                                   unsigned Alignment) const;
   virtual unsigned getIntrinsicInstrCost(Intrinsic::ID, Type *RetTy,
                                          ArrayRef<Type*> Tys) const;
   virtual unsigned getNumberOfParts(Type *Tp) const;
@@ -191,6 +200,16 @@ bool BasicTTI::haveFastSqrt(Type *Ty) const {
   return TLI->isTypeLegal(VT) && TLI->isOperationLegalOrCustom(ISD::FSQRT, VT);
 }
 
+bool BasicTTI::shouldExpandDivisionByInvariant(Type *Ty) const {
+  const TargetLoweringBase *TLI = getTLI();
+  if (!Ty->isIntegerTy() || TLI->isIntDivCheap())
+    return false;
+  EVT VT = TLI->getValueType(Ty);
+  return TLI->isTypeLegal(VT) &&
+         (TLI->isOperationLegalOrCustom(ISD::MULHU, VT) ||
+          TLI->isOperationLegalOrCustom(ISD::UMUL_LOHI, VT));
+}
+
 void BasicTTI::getUnrollingPreferences(Loop *, UnrollingPreferences &) const { }
 
 //===----------------------------------------------------------------------===//
@@ -422,6 +441,68 @@ unsigned BasicTTI::getMemoryOpCost(unsigned Opcode, Type *Src,
   return LT.first;
 }
 
+unsigned BasicTTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              ArrayRef<unsigned> Indices,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const {
+  VectorType *VT = cast<VectorType>(VecTy);
+  unsigned NumElts = VT->getNumElements();
+  assert(Factor > 1 && NumElts % Factor == 0 && "Invalid interleave factor");
+  unsigned NumSubElts = NumElts / Factor;
+  VectorType *SubVT = VectorType::get(VT->getElementType(), NumSubElts);
+
+  // One wide access...
+  unsigned Cost = TopTTI->getMemoryOpCost(Opcode, VecTy, Alignment,
+                                          AddressSpace);
+
+  // ...plus, without better knowledge of the target, moving every element
+  // between the wide vector and the vectors of its members one at a time.
+  for (unsigned i = 0, e = Indices.size(); i != e; ++i)
+    for (unsigned j = 0; j != NumSubElts; ++j) {
+      unsigned WideIdx = j * Factor + Indices[i];
+      if (Opcode == Instruction::Load) {
+        Cost += TopTTI->getVectorInstrCost(Instruction::ExtractElement, VT,
+                                           WideIdx);
+        Cost += TopTTI->getVectorInstrCost(Instruction::InsertElement, SubVT,
+                                           j);
+      } else {
+        Cost += TopTTI->getVectorInstrCost(Instruction::ExtractElement, SubVT,
+                                           j);
+        Cost += TopTTI->getVectorInstrCost(Instruction::InsertElement, VT,
+                                           WideIdx);
+      }
+    }
+  return Cost;
+}
+
+bool BasicTTI::isLegalGather(Type *DataTy, Type *IndexTy) const {
+  const TargetLoweringBase *TLI = getTLI();
+  return TLI->isLegalGather(TLI->getValueType(DataTy),
+                            TLI->getValueType(IndexTy));
+}
+
+unsigned BasicTTI::getGatherOpCost(Type *DataTy, Type *IndexTy,
+                                   unsigned Alignment) const {
+  VectorType *VT = cast<VectorType>(DataTy);
+  unsigned NumElts = VT->getNumElements();
+
+  // A gather instruction still loads the elements one at a time.
+  if (TopTTI->isLegalGather(DataTy, IndexTy))
+    return NumElts;
+
+  // Otherwise it is split into a scalar load per element, each of which needs
+  // its index extracted and its result inserted.
+  unsigned Cost = 0;
+  for (unsigned i = 0; i != NumElts; ++i) {
+    Cost += TopTTI->getVectorInstrCost(Instruction::ExtractElement, IndexTy, i);
+    Cost += TopTTI->getMemoryOpCost(Instruction::Load, VT->getElementType(),
+                                    Alignment, 0);
+    Cost += TopTTI->getVectorInstrCost(Instruction::InsertElement, DataTy, i);
+  }
+  return Cost;
+}
+
 unsigned BasicTTI::getIntrinsicInstrCost(Intrinsic::ID IID, Type *RetTy,
                                          ArrayRef<Type *> Tys) const {
   unsigned ISD = 0;
@@ -23,7 +23,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#define DEBUG_TYPE "packets"
 #include "llvm/CodeGen/DFAPacketizer.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/MachineInstr.h"
 #include "llvm/CodeGen/MachineInstrBundle.h"
 #include "llvm/CodeGen/ScheduleDAGInstrs.h"
@@ -31,6 +33,11 @@
 #include "llvm/Target/TargetInstrInfo.h"
 using namespace llvm;
 
+STATISTIC(NumPacketsFormed, "Number of VLIW packets formed");
+STATISTIC(NumInstrsPacketized, "Number of instructions placed in packets");
+STATISTIC(NumDepStalls, "Number of packets ended by a dependence");
+STATISTIC(NumResStalls, "Number of packets ended by a resource conflict");
+
 DFAPacketizer::DFAPacketizer(const InstrItineraryData *I, const int (*SIT)[2],
                              const unsigned *SET):
   InstrItins(I), CurrentState(0), DFAStateInputTable(SIT),
@@ -127,7 +134,8 @@ void DefaultVLIWScheduler::schedule() {
 // VLIWPacketizerList Ctor
 VLIWPacketizerList::VLIWPacketizerList(
   MachineFunction &MF, MachineLoopInfo &MLI, MachineDominatorTree &MDT,
-  bool IsPostRA) : TM(MF.getTarget()), MF(MF)  {
+  bool IsPostRA) : TM(MF.getTarget()), MF(MF), NumPackets(0),
+  NumPacketizedInstrs(0), NumDependenceStalls(0), NumResourceStalls(0) {
   TII = TM.getInstrInfo();
   ResourceTracker = TII->CreateTargetScheduleState(&TM, 0);
   VLIWScheduler = new DefaultVLIWScheduler(MF, MLI, MDT, IsPostRA);
@@ -135,6 +143,11 @@ VLIWPacketizerList::VLIWPacketizerList(
 
 // VLIWPacketizerList Dtor
 VLIWPacketizerList::~VLIWPacketizerList() {
+  NumPacketsFormed += NumPackets;
+  NumInstrsPacketized += NumPacketizedInstrs;
+  NumDepStalls += NumDependenceStalls;
+  NumResStalls += NumResourceStalls;
+
   if (VLIWScheduler)
     delete VLIWScheduler;
 
@@ -150,6 +163,10 @@ void VLIWPacketizerList::endPacket(MachineBasicBlock *MBB,
     MachineInstr *MIFirst = CurrentPacketMIs.front();
     finalizeBundle(*MBB, MIFirst, MI);
   }
+  if (!CurrentPacketMIs.empty()) {
+    ++NumPackets;
+    NumPacketizedInstrs += CurrentPacketMIs.size();
+  }
   CurrentPacketMIs.clear();
   ResourceTracker->clearResources();
 }
@@ -180,6 +197,9 @@ void VLIWPacketizerList::PacketizeMIs(MachineBasicBlock *MBB,
     // End the current packet if needed.
     if (this->isSoloInstruction(MI)) {
       endPacket(MBB, MI);
+      // MI forms a packet of its own.
+      ++NumPackets;
+      ++NumPacketizedInstrs;
       continue;
     }
 
@@ -206,6 +226,7 @@ void VLIWPacketizerList::PacketizeMIs(MachineBasicBlock *MBB,
           if (!this->isLegalToPruneDependencies(SUI, SUJ)) {
             // End the packet if dependency cannot be pruned.
             endPacket(MBB, MI);
+            ++NumDependenceStalls;
             break;
           } // !isLegalToPruneDependencies.
         } // !isLegalToPacketizeTogether.
@@ -213,6 +234,7 @@ void VLIWPacketizerList::PacketizeMIs(MachineBasicBlock *MBB,
     } else {
       // End the packet if resource is not available.
       endPacket(MBB, MI);
+      ++NumResourceStalls;
     }
 
     // Add MI to the current packet.
@@ -35,6 +35,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetLowering.h"
 #include "llvm/Target/TargetRegisterInfo.h"
 #include "llvm/Target/TargetSubtargetInfo.h"
 
@@ -54,6 +55,7 @@ STATISTIC(NumDiamondsSeen,  "Number of diamonds");
 STATISTIC(NumDiamondsConv,  "Number of diamonds converted");
 STATISTIC(NumTrianglesSeen, "Number of triangles");
 STATISTIC(NumTrianglesConv, "Number of triangles converted");
+STATISTIC(NumPredictable,   "Number of predictable branches kept");
 
 //===----------------------------------------------------------------------===//
 //                                 SSAIfConv
@@ -579,8 +581,10 @@ namespace {
 class EarlyIfConverter : public MachineFunctionPass {
   const TargetInstrInfo *TII;
   const TargetRegisterInfo *TRI;
+  const TargetLowering *TLI;
   const MCSchedModel *SchedModel;
   MachineRegisterInfo *MRI;
+  const MachineBranchProbabilityInfo *MBPI;
   MachineDominatorTree *DomTree;
   MachineLoopInfo *Loops;
   MachineTraceMetrics *Traces;
@@ -599,6 +603,7 @@ private:
   void updateDomTree(ArrayRef<MachineBasicBlock*> Removed);
   void updateLoops(ArrayRef<MachineBasicBlock*> Removed);
   void invalidateTraces();
+  bool isPredictableBranch();
   bool shouldConvertIf();
 };
 } // end anonymous namespace
@@ -669,6 +674,15 @@ static unsigned adjCycles(unsigned Cyc, int Delta) {
   return Cyc + Delta;
 }
 
+/// Return true if the branch in IfConv.Head goes the same way often enough to
+/// be predicted right.  Such a branch is nearly free, so speculating the other
+/// side only adds work and latency.
+bool EarlyIfConverter::isPredictableBranch() {
+  BranchProbability Threshold = TLI->getPredictableBranchThreshold();
+  return MBPI->getEdgeProbability(IfConv.Head, IfConv.TBB) > Threshold ||
+         MBPI->getEdgeProbability(IfConv.Head, IfConv.FBB) > Threshold;
+}
+
 /// Apply cost model and heuristics to the if-conversion in IfConv.
 /// Return true if the conversion is a good idea.
 ///
@@ -677,6 +691,12 @@ bool EarlyIfConverter::shouldConvertIf() {
   if (Stress)
     return true;
 
+  if (isPredictableBranch()) {
+    DEBUG(dbgs() << "Branch is predictable.\n");
+    ++NumPredictable;
+    return false;
+  }
+
   if (!MinInstr)
     MinInstr = Traces->getEnsemble(MachineTraceMetrics::TS_MinInstrCount);
 
@@ -777,9 +797,11 @@ bool EarlyIfConverter::runOnMachineFunction(MachineFunction &MF) {
                << "********** Function: " << MF.getName() << '\n');
   TII = MF.getTarget().getInstrInfo();
   TRI = MF.getTarget().getRegisterInfo();
+  TLI = MF.getTarget().getTargetLowering();
   SchedModel =
     MF.getTarget().getSubtarget<TargetSubtargetInfo>().getSchedModel();
   MRI = &MF.getRegInfo();
+  MBPI = &getAnalysis<MachineBranchProbabilityInfo>();
   DomTree = &getAnalysis<MachineDominatorTree>();
   Loops = getAnalysisIfAvailable<MachineLoopInfo>();
   Traces = &getAnalysis<MachineTraceMetrics>();
@@ -167,6 +167,7 @@ private:
   bool isSibling(unsigned Reg);
   MachineInstr *traceSiblingValue(unsigned, VNInfo*, VNInfo*);
   void propagateSiblingValue(SibValueMap::iterator, VNInfo *VNI = 0);
+  BlockFrequency getHoistableDepsFreq(const SibValueInfo &SV);
   void analyzeSiblingValues();
 
   bool hoistSpill(LiveInterval &SpillLI, MachineInstr *CopyMI);
@@ -378,7 +379,11 @@ void InlineSpiller::propagateSiblingValue(SibValueMap::iterator SVIIter,
     // Should this value be propagated as a preferred spill candidate?  We don't
     // propagate values of registers that are about to spill.
     bool PropSpill = !DisableHoisting && !isRegToSpill(SV.SpillReg);
-    unsigned SpillDepth = ~0u;
+    BlockFrequency SpillFreq, DepsFreq;
+    if (PropSpill) {
+      SpillFreq = MBFI.getBlockFreq(SV.SpillMBB);
+      DepsFreq = getHoistableDepsFreq(SV);
+    }
 
     for (TinyPtrVector<VNInfo*>::iterator DepI = Deps->begin(),
          DepE = Deps->end(); DepI != DepE; ++DepI) {
@@ -431,14 +436,16 @@ void InlineSpiller::propagateSiblingValue(SibValueMap::iterator SVIIter,
             DepSV.SpillMBB = SV.SpillMBB;
           }
         } else {
-          // DepSV is in a different block.
-          if (SpillDepth == ~0u)
-            SpillDepth = Loops.getLoopDepth(SV.SpillMBB);
-
-          // Also hoist spills to blocks with smaller loop depth, but make sure
-          // that the new value dominates.  Non-phi dependents are always
-          // dominated, phis need checking.
-          if ((Loops.getLoopDepth(DepSV.SpillMBB) > SpillDepth) &&
+          // DepSV is in a different block.  Also hoist spills to colder
+          // blocks, but make sure that the new value dominates.  Non-phi
+          // dependents are always dominated, phis need checking.
+          //
+          // Spilling SV once may also be cheaper than spilling each of its
+          // dependents where they are, even when each of them is colder on
+          // its own.  That is the case when the value is copied to siblings
+          // on several paths out of SpillMBB.
+          if ((SpillFreq < MBFI.getBlockFreq(DepSV.SpillMBB) ||
+               SpillFreq < DepsFreq) &&
               (!DepSVI->first->isPHIDef() ||
                MDT.dominates(SV.SpillMBB, DepSV.SpillMBB))) {
             Changed = true;
@@ -461,6 +468,29 @@ void InlineSpiller::propagateSiblingValue(SibValueMap::iterator SVIIter,
   } while (!WorkList.empty());
 }
 
+/// getHoistableDepsFreq - Return the summed frequency of the blocks where the
+/// dependents of SV would be spilled, counting only the dependents in other
+/// blocks that a spill of SV could replace.
+BlockFrequency InlineSpiller::getHoistableDepsFreq(const SibValueInfo &SV) {
+  BlockFrequency Freq;
+  SmallPtrSet<MachineBasicBlock*, 8> Blocks;
+  for (TinyPtrVector<VNInfo*>::const_iterator DepI = SV.Deps.begin(),
+       DepE = SV.Deps.end(); DepI != DepE; ++DepI) {
+    SibValueMap::iterator DepSVI = SibValues.find(*DepI);
+    assert(DepSVI != SibValues.end() && "Dependent value not in SibValues");
+    SibValueInfo &DepSV = DepSVI->second;
+    if (!DepSV.SpillMBB)
+      DepSV.SpillMBB = LIS.getMBBFromIndex(DepSV.SpillVNI->def);
+    if (DepSV.SpillMBB == SV.SpillMBB || !Blocks.insert(DepSV.SpillMBB))
+      continue;
+    if (DepSVI->first->isPHIDef() &&
+        !MDT.dominates(SV.SpillMBB, DepSV.SpillMBB))
+      continue;
+    Freq += MBFI.getBlockFreq(DepSV.SpillMBB);
+  }
+  return Freq;
+}
+
 /// traceSiblingValue - Trace a value that is about to be spilled back to the
 /// real defining instructions by looking through sibling copies. Always stay
 /// within the range of OrigVNI so the registers are known to carry the same
@@ -47,7 +47,20 @@ static cl::opt<bool>
 EnableLDV("live-debug-variables", cl::init(true),
           cl::desc("Enable the live debug variables pass"), cl::Hidden);
 
+// Tracking a variable through register allocation costs time proportional to
+// the number of its DBG_VALUEs and to the blocks its locations reach.  Once a
+// function has this many DBG_VALUEs, variables seen for the first time are no
+// longer tracked; their DBG_VALUEs are dropped and they show as optimized out.
+static cl::opt<unsigned>
+LDVBudget("live-debug-variables-budget", cl::init(20000), cl::Hidden,
+          cl::desc("Maximum number of DBG_VALUEs tracked per function"));
+
 STATISTIC(NumInsertedDebugValues, "Number of DBG_VALUEs inserted");
+STATISTIC(NumCollectedDebugValues, "Number of DBG_VALUEs tracked");
+STATISTIC(NumRedundantDebugValues, "Number of redundant DBG_VALUEs coalesced");
+STATISTIC(NumDroppedDebugValues, "Number of DBG_VALUEs dropped over budget");
+STATISTIC(NumExtendedBlocks, "Number of blocks debug locations were extended "
+                             "into");
 char LiveDebugVariables::ID = 0;
 
 INITIALIZE_PASS_BEGIN(LiveDebugVariables, "livedebugvars",
@@ -120,6 +133,11 @@ class UserValue {
   /// Map of slot indices where this value is live.
   LocMap locInts;
 
+  /// The last def added by addDef, its block and its location number.
+  SlotIndex lastDefIdx;
+  const MachineBasicBlock *lastDefMBB;
+  unsigned lastDefLocNo;
+
   /// coalesceLocation - After LocNo was changed, check if it has become
   /// identical to another location, and coalesce them. This may cause LocNo or
   /// a later location to be erased, but no earlier location will be erased.
@@ -139,7 +157,7 @@ public:
   UserValue(const MDNode *var, unsigned o, bool i, DebugLoc L,
             LocMap::Allocator &alloc)
     : variable(var), offset(o), IsIndirect(i), dl(L), leader(this),
-      next(0), locInts(alloc)
+      next(0), locInts(alloc), lastDefMBB(0), lastDefLocNo(~0u)
   {}
 
   /// getLeader - Get the leader of this value's equivalence class.
@@ -203,15 +221,42 @@ public:
   /// mapVirtRegs - Ensure that all virtual register locations are mapped.
   void mapVirtRegs(LDVImpl *LDV);
 
+  /// isRedundantDef - Return true if a def of LocMO at Idx in MBB would not
+  /// change where this value is found: the previous def is earlier in the same
+  /// block and has the same location, holding the same value for a virtual
+  /// register.  Defs must be added in instruction order for this to hold.
+  bool isRedundantDef(const MachineBasicBlock *MBB, SlotIndex Idx,
+                      const MachineOperand &LocMO, LiveIntervals &LIS) const {
+    if (MBB != lastDefMBB || lastDefLocNo == ~0u)
+      return false;
+    const MachineOperand &LastMO = locations[lastDefLocNo];
+    if (!LocMO.isReg())
+      return !LastMO.isReg() && LocMO.isIdenticalTo(LastMO);
+    unsigned Reg = LocMO.getReg();
+    if (!LastMO.isReg() || LastMO.getReg() != Reg ||
+        LastMO.getSubReg() != LocMO.getSubReg() ||
+        !TargetRegisterInfo::isVirtualRegister(Reg) || !LIS.hasInterval(Reg))
+      return false;
+    const LiveInterval &LI = LIS.getInterval(Reg);
+    const VNInfo *VNI = LI.getVNInfoAt(Idx);
+    return VNI && VNI == LI.getVNInfoAt(lastDefIdx);
+  }
+
   /// addDef - Add a definition point to this value.
-  void addDef(SlotIndex Idx, const MachineOperand &LocMO) {
+  void addDef(const MachineBasicBlock *MBB, SlotIndex Idx,
+              const MachineOperand &LocMO) {
+    unsigned LocNo = getLocationNo(LocMO);
+    lastDefIdx = Idx;
+    lastDefMBB = MBB;
+    lastDefLocNo = LocNo;
+
     // Add a singular (Idx,Idx) -> Loc mapping.
     LocMap::iterator I = locInts.find(Idx);
     if (!I.valid() || I.start() != Idx)
-      I.insert(Idx, Idx.getNextSlot(), getLocationNo(LocMO));
+      I.insert(Idx, Idx.getNextSlot(), LocNo);
     else
       // A later DBG_VALUE at the same SlotIndex overrides the old location.
-      I.setValue(getLocationNo(LocMO));
+      I.setValue(LocNo);
   }
 
   /// extendDef - Extend the current definition as far as possible down the
@@ -302,9 +347,14 @@ class LDVImpl {
   typedef DenseMap<const MDNode *, UserValue*> UVMap;
   UVMap userVarMap;
 
-  /// getUserValue - Find or create a UserValue.
+  /// Number of DBG_VALUEs collected in the current function, compared against
+  /// LDVBudget.
+  unsigned NumCollected;
+
+  /// getUserValue - Find or create a UserValue.  Return null instead of
+  /// creating one when Create is false.
   UserValue *getUserValue(const MDNode *Var, unsigned Offset,
-                          bool IsIndirect, DebugLoc DL);
+                          bool IsIndirect, DebugLoc DL, bool Create);
 
   /// lookupVirtReg - Find the EC leader for VirtReg or null.
   UserValue *lookupVirtReg(unsigned VirtReg);
@@ -327,7 +377,7 @@ class LDVImpl {
 
 public:
   LDVImpl(LiveDebugVariables *ps) : pass(*ps), EmitDone(false),
-                                    ModifiedMF(false) {}
+                                    ModifiedMF(false), NumCollected(0) {}
   bool runOnMachineFunction(MachineFunction &mf);
 
   /// clear - Release all memory.
@@ -336,6 +386,7 @@ public:
     userValues.clear();
     virtRegToEqClass.clear();
     userVarMap.clear();
+    NumCollected = 0;
     // Make sure we call emitDebugValues if the machine function was modified.
     assert((!ModifiedMF || EmitDone) &&
            "Dbg values are not emitted in LDV");
@@ -419,7 +470,7 @@ void UserValue::mapVirtRegs(LDVImpl *LDV) {
 }
 
 UserValue *LDVImpl::getUserValue(const MDNode *Var, unsigned Offset,
-                                 bool IsIndirect, DebugLoc DL) {
+                                 bool IsIndirect, DebugLoc DL, bool Create) {
   UserValue *&Leader = userVarMap[Var];
   if (Leader) {
     UserValue *UV = Leader->getLeader();
@@ -429,6 +480,8 @@ UserValue *LDVImpl::getUserValue(const MDNode *Var, unsigned Offset,
         return UV;
   }
 
+  if (!Create)
+    return 0;
   UserValue *UV = new UserValue(Var, Offset, IsIndirect, DL, allocator);
   userValues.push_back(UV);
   Leader = UserValue::merge(Leader, UV);
@@ -460,9 +513,23 @@ bool LDVImpl::handleDebugValue(MachineInstr *MI, SlotIndex Idx) {
   bool IsIndirect = MI->isIndirectDebugValue();
   unsigned Offset = IsIndirect ? MI->getOperand(1).getImm() : 0;
   const MDNode *Var = MI->getOperand(2).getMetadata();
-  //here.
-  UserValue *UV = getUserValue(Var, Offset, IsIndirect, MI->getDebugLoc());
-  UV->addDef(Idx, MI->getOperand(0));
+  // Variables first seen over budget are not tracked at all, so they are
+  // dropped consistently rather than left with stale locations.
+  UserValue *UV = getUserValue(Var, Offset, IsIndirect, MI->getDebugLoc(),
+                               NumCollected < LDVBudget);
+  if (!UV) {
+    ++NumDroppedDebugValues;
+    return true;
+  }
+
+  MachineBasicBlock *MBB = MI->getParent();
+  if (UV->isRedundantDef(MBB, Idx, MI->getOperand(0), *LIS)) {
+    ++NumRedundantDebugValues;
+    return true;
+  }
+  ++NumCollected;
+  ++NumCollectedDebugValues;
+  UV->addDef(MBB, Idx, MI->getOperand(0));
   return true;
 }
 
@@ -503,6 +570,7 @@ void UserValue::extendDef(SlotIndex Idx, unsigned LocNo,
   Todo.push_back(Idx);
   do {
     SlotIndex Start = Todo.pop_back_val();
+    ++NumExtendedBlocks;
     MachineBasicBlock *MBB = LIS.getMBBFromIndex(Start);
     SlotIndex Stop = LIS.getMBBEndIdx(MBB);
     LocMap::iterator I = locInts.find(Start);
@@ -20,6 +20,7 @@
 #include "LiveRangeCalc.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/CodeGen/LiveVariables.h"
 #include "llvm/CodeGen/MachineDominators.h"
@@ -32,6 +33,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
 #include "llvm/Target/TargetMachine.h"
@@ -60,6 +62,19 @@ static cl::opt<bool> EnablePrecomputePhysRegs(
 static bool EnablePrecomputePhysRegs = false;
 #endif // NDEBUG
 
+STATISTIC(NumParallelIntervals,
+          "Number of virtual register intervals computed in parallel");
+
+static cl::opt<unsigned> LiveIntervalThreads(
+  "live-interval-threads", cl::Hidden, cl::init(0),
+  cl::desc("Number of threads computing the live intervals of virtual "
+           "registers (0 or 1 computes them on the calling thread)"));
+
+static cl::opt<unsigned> ParallelIntervalsThreshold(
+  "live-interval-parallel-threshold", cl::Hidden, cl::init(10000),
+  cl::desc("Minimum number of virtual registers for their live intervals "
+           "to be computed on several threads"));
+
 void LiveIntervals::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesCFG();
   AU.addRequired<AliasAnalysis>();
@@ -101,6 +116,7 @@ void LiveIntervals::releaseMemory() {
 
   // Release VNInfo memory regions, VNInfo objects don't need to be dtor'd.
   VNInfoAllocator.Reset();
+  DeleteContainerPointers(ThreadVNInfoAllocators);
 }
 
 /// runOnMachineFunction - calculates LiveIntervals
@@ -187,6 +203,12 @@ void LiveIntervals::computeVirtRegInterval(LiveInterval &LI) {
 }
 
 void LiveIntervals::computeVirtRegs() {
+  if (LiveIntervalThreads > 1 &&
+      MRI->getNumVirtRegs() >= ParallelIntervalsThreshold) {
+    computeVirtRegsInParallel(LiveIntervalThreads);
+    return;
+  }
+
   for (unsigned i = 0, e = MRI->getNumVirtRegs(); i != e; ++i) {
     unsigned Reg = TargetRegisterInfo::index2VirtReg(i);
     if (MRI->reg_nodbg_empty(Reg))
@@ -195,6 +217,66 @@ void LiveIntervals::computeVirtRegs() {
   }
 }
 
+namespace {
+/// IntervalChunk - The intervals computed by one thread.
+struct IntervalChunk {
+  const MachineFunction *MF;
+  SlotIndexes *Indexes;
+  MachineDominatorTree *DomTree;
+  VNInfo::Allocator *Alloc;
+  LiveRangeCalc LRCalc;
+  std::vector<LiveInterval*> Intervals;
+};
+}
+
+static void computeIntervalChunk(void *Arg) {
+  IntervalChunk &C = *static_cast<IntervalChunk*>(Arg);
+  for (unsigned i = 0, e = C.Intervals.size(); i != e; ++i) {
+    C.LRCalc.reset(C.MF, C.Indexes, C.DomTree, C.Alloc);
+    C.LRCalc.createDeadDefs(*C.Intervals[i]);
+    C.LRCalc.extendToUses(*C.Intervals[i]);
+  }
+}
+
+void LiveIntervals::computeVirtRegsInParallel(unsigned NumThreads) {
+  // Each interval only depends on the operands of its own register, so they
+  // can be computed independently once they have all been created.  Only the
+  // kill flags of those operands are written.
+  std::vector<LiveInterval*> Intervals;
+  for (unsigned i = 0, e = MRI->getNumVirtRegs(); i != e; ++i) {
+    unsigned Reg = TargetRegisterInfo::index2VirtReg(i);
+    if (MRI->reg_nodbg_empty(Reg))
+      continue;
+    Intervals.push_back(&createEmptyInterval(Reg));
+  }
+  NumThreads = std::min<unsigned>(NumThreads, Intervals.size());
+  if (NumThreads == 0)
+    return;
+
+  // LiveRangeCalc asks the dominator tree about dominance, which would
+  // otherwise renumber the tree the first time it found its numbers stale.
+  DomTree->getBase().updateDFSNumbers();
+
+  std::vector<IntervalChunk*> Chunks;
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    IntervalChunk *C = new IntervalChunk();
+    C->MF = MF;
+    C->Indexes = Indexes;
+    C->DomTree = DomTree;
+    C->Alloc = new VNInfo::Allocator();
+    ThreadVNInfoAllocators.push_back(C->Alloc);
+    // Give each thread a contiguous run of registers.
+    C->Intervals.assign(Intervals.begin() + i * Intervals.size() / NumThreads,
+                        Intervals.begin() +
+                            (i + 1) * Intervals.size() / NumThreads);
+    Chunks.push_back(C);
+  }
+  std::vector<void *> Work(Chunks.begin(), Chunks.end());
+  llvm_execute_on_threads(computeIntervalChunk, &Work[0], Work.size());
+  NumParallelIntervals += Intervals.size();
+  DeleteContainerPointers(Chunks);
+}
+
 void LiveIntervals::computeRegMasks() {
   RegMaskBlocks.resize(MF->getNumBlockIDs());
 
@@ -65,6 +65,13 @@ ExitBlockBias("block-placement-exit-block-bias",
                        "over the original exit to be considered the new exit."),
               cl::init(0), cl::Hidden);
 
+static cl::opt<bool>
+UseExtTSPLayout("block-placement-ext-tsp",
+                cl::desc("Order the blocks of a function to maximize the "
+                         "Ext-TSP score of its weighted edges instead of "
+                         "building chains greedily."),
+                cl::init(false), cl::Hidden);
+
 namespace {
 class BlockChain;
 /// \brief Type for our function-wide basic block -> block chain mapping.
@@ -166,6 +173,419 @@ public:
 };
 }
 
+namespace {
+/// \brief Block layout maximizing the Ext-TSP score of a function.
+///
+/// The extended TSP score of a layout sums, over the edges of the CFG, the
+/// execution count of each edge weighted by how cheap its branch is in that
+/// layout: a fallthrough counts fully, a short jump counts for a fraction
+/// which shrinks with its length, and a long jump does not count. Maximizing
+/// it favors fallthroughs first and then keeps the remaining hot jumps short,
+/// which is what the instruction cache and the branch predictor reward.
+///
+/// Finding the best layout is NP-hard, so this uses the greedy chain merging
+/// of "Improved Basic Block Reordering" by Newell and Pupyrev. It starts with
+/// one chain per unit -- a block, or a sequence of blocks whose fallthroughs
+/// cannot be analyzed and must be kept -- and repeatedly performs the merge
+/// of two chains connected by an edge that raises the score the most. A merge
+/// either concatenates the two chains or, for short chains, splits one of
+/// them between two units and places the other in the gap. Once no merge
+/// raises the score, the chains are ordered by decreasing execution density,
+/// with the chain of the entry block first.
+class ExtTSPLayout {
+  /// \brief A sequence of units which will be laid out contiguously.
+  struct Chain {
+    /// \brief The units of the chain, in layout order.
+    SmallVector<BlockChain *, 4> Units;
+
+    /// \brief The estimated size of the chain in bytes.
+    uint64_t Size;
+
+    /// \brief The sum of the execution counts of the blocks of the chain.
+    uint64_t Count;
+
+    /// \brief The score of the edges within the chain.
+    double Score;
+
+    /// \brief The position of the earliest unit of the chain in the function,
+    /// which breaks ties in the final order.
+    unsigned Index;
+
+    /// \brief Whether the chain starts with the entry block.
+    bool HasEntry;
+  };
+
+  /// \brief Orders chains by decreasing execution density, keeping the chain
+  /// of the entry block first and otherwise the function order.
+  struct DensityOrder {
+    bool operator()(const Chain *A, const Chain *B) const {
+      if (A->HasEntry != B->HasEntry)
+        return A->HasEntry;
+      double DensityA = double(A->Count) / A->Size;
+      double DensityB = double(B->Count) / B->Size;
+      if (DensityA != DensityB)
+        return DensityA > DensityB;
+      return A->Index < B->Index;
+    }
+  };
+
+  /// \brief The best way found to merge two chains: Y is placed before the
+  /// unit Offset of X, raising the score by Gain.
+  struct MergeCandidate {
+    Chain *X;
+    Chain *Y;
+    unsigned Offset;
+    double Gain;
+  };
+
+  /// \brief An edge to or from a block, with its execution count.
+  typedef std::pair<MachineBasicBlock *, uint64_t> Edge;
+  typedef SmallVector<Edge, 4> EdgeList;
+
+  const MachineBranchProbabilityInfo &MBPI;
+  const MachineBlockFrequencyInfo &MBFI;
+
+  DenseMap<MachineBasicBlock *, EdgeList> OutEdges;
+  DenseMap<MachineBasicBlock *, EdgeList> InEdges;
+  DenseMap<MachineBasicBlock *, uint64_t> BlockSize;
+
+  /// \brief The chain each block is in, and its offset within that chain.
+  DenseMap<MachineBasicBlock *, Chain *> ChainOf;
+  DenseMap<MachineBasicBlock *, uint64_t> BlockOffset;
+
+  /// \brief The chains, which never move. A chain merged into another one is
+  /// left empty.
+  std::vector<Chain> Chains;
+
+  /// \brief The merges which raise the score, keyed by the pair of chains
+  /// with the lower address first.
+  typedef DenseMap<std::pair<Chain *, Chain *>, MergeCandidate> CandidateMap;
+  CandidateMap Candidates;
+
+  /// \brief Scratch space for the block offsets of a tentative layout.
+  DenseMap<MachineBasicBlock *, uint64_t> TentativeOffset;
+
+  void addEdges(MachineBasicBlock *BB);
+  double scoreLayout(ArrayRef<BlockChain *> A, ArrayRef<BlockChain *> B,
+                     ArrayRef<BlockChain *> C);
+  double scoreConcatenation(Chain &First, Chain &Second);
+  void considerMerges(Chain &X, Chain &Y, MergeCandidate &Best);
+  void updateCandidate(Chain &A, Chain &B);
+  void updateOffsets(Chain &C);
+  void merge(const MergeCandidate &M);
+
+public:
+  ExtTSPLayout(const MachineBranchProbabilityInfo &MBPI,
+               const MachineBlockFrequencyInfo &MBFI)
+    : MBPI(MBPI), MBFI(MBFI) {}
+
+  /// \brief Order \p Units, given in function order with the unit of the
+  /// entry block first, into \p Order.
+  void run(ArrayRef<BlockChain *> Units,
+           SmallVectorImpl<BlockChain *> &Order);
+};
+}
+
+// The weights and the reach of the jumps in the Ext-TSP score.
+static const double FallthroughWeight = 1.0;
+static const double ForwardJumpWeight = 0.1;
+static const double BackwardJumpWeight = 0.1;
+static const uint64_t ForwardJumpDistance = 1024;
+static const uint64_t BackwardJumpDistance = 640;
+
+/// \brief Chains of at most this many units in total are merged by splitting
+/// one of them, in addition to concatenating them.
+static const unsigned MaxSplitMergeUnits = 128;
+
+/// \brief Estimate the size of a block in bytes.
+///
+/// Not all targets can tell the size of an instruction before it is emitted,
+/// so the distances of the Ext-TSP score are counted in instructions, at an
+/// average of four bytes each.
+static uint64_t estimateBlockSize(const MachineBasicBlock *BB) {
+  uint64_t NumInstrs = 0;
+  for (MachineBasicBlock::const_iterator I = BB->begin(), E = BB->end();
+       I != E; ++I)
+    if (!I->isDebugValue())
+      ++NumInstrs;
+  return std::max<uint64_t>(NumInstrs, 1) * 4;
+}
+
+/// \brief Score an edge executed \p Count times from a block which ends at
+/// \p SrcEnd to a block which starts at \p DstStart.
+static double scoreEdge(uint64_t SrcEnd, uint64_t DstStart, uint64_t Count) {
+  if (DstStart == SrcEnd)
+    return FallthroughWeight * Count;
+  if (DstStart > SrcEnd) {
+    uint64_t Distance = DstStart - SrcEnd;
+    if (Distance <= ForwardJumpDistance)
+      return ForwardJumpWeight * Count *
+             (1.0 - double(Distance) / ForwardJumpDistance);
+    return 0;
+  }
+  uint64_t Distance = SrcEnd - DstStart;
+  if (Distance <= BackwardJumpDistance)
+    return BackwardJumpWeight * Count *
+           (1.0 - double(Distance) / BackwardJumpDistance);
+  return 0;
+}
+
+/// \brief Record the edges out of \p BB with their execution counts.
+void ExtTSPLayout::addEdges(MachineBasicBlock *BB) {
+  // Query the weights through the successor iterators: asking for the
+  // probability of each successor would be quadratic in their number, which
+  // is large for switch dispatch blocks.
+  uint32_t Scale = 1;
+  uint32_t Sum = MBPI.getSumForBlock(BB, Scale);
+  BlockFrequency Freq = MBFI.getBlockFreq(BB);
+  for (MachineBasicBlock::const_succ_iterator SI = BB->succ_begin(),
+                                              SE = BB->succ_end();
+       SI != SE; ++SI) {
+    BranchProbability Prob(MBPI.getEdgeWeight(BB, SI) / Scale, Sum);
+    uint64_t Count = (Freq * Prob).getFrequency();
+    if (!Count)
+      continue;
+    OutEdges[BB].push_back(Edge(*SI, Count));
+    InEdges[*SI].push_back(Edge(BB, Count));
+  }
+}
+
+/// \brief Score the edges within the layout made of the units \p A, then
+/// \p B, then \p C.
+double ExtTSPLayout::scoreLayout(ArrayRef<BlockChain *> A,
+                                 ArrayRef<BlockChain *> B,
+                                 ArrayRef<BlockChain *> C) {
+  ArrayRef<BlockChain *> Parts[] = { A, B, C };
+  SmallVector<MachineBasicBlock *, 32> Blocks;
+  uint64_t Offset = 0;
+  for (unsigned p = 0; p != 3; ++p)
+    for (unsigned u = 0, ue = Parts[p].size(); u != ue; ++u)
+      for (BlockChain::iterator BI = Parts[p][u]->begin(),
+                                BE = Parts[p][u]->end();
+           BI != BE; ++BI) {
+        Blocks.push_back(*BI);
+        TentativeOffset[*BI] = Offset;
+        Offset += BlockSize[*BI];
+      }
+
+  double Score = 0;
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i) {
+    MachineBasicBlock *BB = Blocks[i];
+    uint64_t End = TentativeOffset[BB] + BlockSize[BB];
+    EdgeList &Out = OutEdges[BB];
+    for (unsigned j = 0, je = Out.size(); j != je; ++j) {
+      DenseMap<MachineBasicBlock *, uint64_t>::iterator DI =
+        TentativeOffset.find(Out[j].first);
+      if (DI != TentativeOffset.end())
+        Score += scoreEdge(End, DI->second, Out[j].second);
+    }
+  }
+  TentativeOffset.clear();
+  return Score;
+}
+
+/// \brief Score the edges between \p First and \p Second when \p Second is
+/// placed right after \p First.
+///
+/// Concatenating two chains does not move the blocks of either relative to
+/// each other, so this is all the score it gains. Each edge between the
+/// chains has an end in the shorter one, so walking it is enough.
+double ExtTSPLayout::scoreConcatenation(Chain &First, Chain &Second) {
+  bool WalkFirst = First.Units.size() <= Second.Units.size();
+  Chain &Walked = WalkFirst ? First : Second;
+  Chain &Other = WalkFirst ? Second : First;
+  uint64_t WalkedStart = WalkFirst ? 0 : First.Size;
+  uint64_t OtherStart = WalkFirst ? First.Size : 0;
+
+  double Score = 0;
+  for (unsigned u = 0, ue = Walked.Units.size(); u != ue; ++u)
+    for (BlockChain::iterator BI = Walked.Units[u]->begin(),
+                              BE = Walked.Units[u]->end();
+         BI != BE; ++BI) {
+      uint64_t Start = WalkedStart + BlockOffset[*BI];
+      EdgeList &Out = OutEdges[*BI];
+      for (unsigned j = 0, je = Out.size(); j != je; ++j)
+        if (ChainOf[Out[j].first] == &Other)
+          Score += scoreEdge(Start + BlockSize[*BI],
+                             OtherStart + BlockOffset[Out[j].first],
+                             Out[j].second);
+      EdgeList &In = InEdges[*BI];
+      for (unsigned j = 0, je = In.size(); j != je; ++j)
+        if (ChainOf[In[j].first] == &Other)
+          Score += scoreEdge(OtherStart + BlockOffset[In[j].first] +
+                             BlockSize[In[j].first],
+                             Start, In[j].second);
+    }
+  return Score;
+}
+
+/// \brief Update \p Best with the merges which place \p Y into \p X.
+void ExtTSPLayout::considerMerges(Chain &X, Chain &Y, MergeCandidate &Best) {
+  // The entry block has to stay first.
+  unsigned NumUnits = X.Units.size();
+  unsigned FirstOffset = X.HasEntry ? 1 : 0;
+  unsigned LastOffset = Y.HasEntry ? 0 : NumUnits;
+
+  for (unsigned Offset = FirstOffset; Offset <= LastOffset; ++Offset) {
+    double Gain;
+    if (Offset == 0) {
+      Gain = scoreConcatenation(Y, X);
+    } else if (Offset == NumUnits) {
+      Gain = scoreConcatenation(X, Y);
+    } else {
+      if (NumUnits + Y.Units.size() > MaxSplitMergeUnits)
+        continue;
+      ArrayRef<BlockChain *> Units(X.Units);
+      Gain = scoreLayout(Units.slice(0, Offset), Y.Units,
+                         Units.slice(Offset)) - X.Score - Y.Score;
+    }
+    if (Gain > Best.Gain) {
+      Best.X = &X;
+      Best.Y = &Y;
+      Best.Offset = Offset;
+      Best.Gain = Gain;
+    }
+  }
+}
+
+/// \brief Record the best merge of \p A and \p B if it raises the score.
+void ExtTSPLayout::updateCandidate(Chain &A, Chain &B) {
+  MergeCandidate Best;
+  Best.X = Best.Y = 0;
+  Best.Offset = 0;
+  Best.Gain = 0;
+  considerMerges(A, B, Best);
+  considerMerges(B, A, Best);
+  if (!Best.X)
+    return;
+  Chain *First = &A < &B ? &A : &B;
+  Chain *Second = &A < &B ? &B : &A;
+  Candidates[std::make_pair(First, Second)] = Best;
+}
+
+/// \brief Recompute the offsets of the blocks of \p C within it.
+void ExtTSPLayout::updateOffsets(Chain &C) {
+  uint64_t Offset = 0;
+  for (unsigned u = 0, ue = C.Units.size(); u != ue; ++u)
+    for (BlockChain::iterator BI = C.Units[u]->begin(),
+                              BE = C.Units[u]->end();
+         BI != BE; ++BI) {
+      ChainOf[*BI] = &C;
+      BlockOffset[*BI] = Offset;
+      Offset += BlockSize[*BI];
+    }
+}
+
+/// \brief Perform the merge \p M, leaving its Y chain empty.
+void ExtTSPLayout::merge(const MergeCandidate &M) {
+  Chain &X = *M.X;
+  Chain &Y = *M.Y;
+  X.Units.insert(X.Units.begin() + M.Offset, Y.Units.begin(), Y.Units.end());
+  X.Size += Y.Size;
+  X.Count += Y.Count;
+  X.Score += Y.Score + M.Gain;
+  X.Index = std::min(X.Index, Y.Index);
+  X.HasEntry |= Y.HasEntry;
+  Y.Units.clear();
+  updateOffsets(X);
+
+  // Drop the merges of either chain; those of X are computed anew.
+  SmallVector<std::pair<Chain *, Chain *>, 16> Stale;
+  for (CandidateMap::iterator I = Candidates.begin(), E = Candidates.end();
+       I != E; ++I)
+    if (I->first.first == &X || I->first.second == &X ||
+        I->first.first == &Y || I->first.second == &Y)
+      Stale.push_back(I->first);
+  for (unsigned i = 0, e = Stale.size(); i != e; ++i)
+    Candidates.erase(Stale[i]);
+
+  SmallPtrSet<Chain *, 16> Neighbors;
+  for (unsigned u = 0, ue = X.Units.size(); u != ue; ++u)
+    for (BlockChain::iterator BI = X.Units[u]->begin(),
+                              BE = X.Units[u]->end();
+         BI != BE; ++BI) {
+      EdgeList &Out = OutEdges[*BI];
+      for (unsigned j = 0, je = Out.size(); j != je; ++j)
+        Neighbors.insert(ChainOf[Out[j].first]);
+      EdgeList &In = InEdges[*BI];
+      for (unsigned j = 0, je = In.size(); j != je; ++j)
+        Neighbors.insert(ChainOf[In[j].first]);
+    }
+  Neighbors.erase(&X);
+  for (SmallPtrSet<Chain *, 16>::iterator I = Neighbors.begin(),
+                                          E = Neighbors.end();
+       I != E; ++I)
+    updateCandidate(X, **I);
+}
+
+void ExtTSPLayout::run(ArrayRef<BlockChain *> Units,
+                       SmallVectorImpl<BlockChain *> &Order) {
+  // The chains must not move once they are referenced.
+  Chains.resize(Units.size());
+  for (unsigned i = 0, e = Units.size(); i != e; ++i) {
+    Chain &C = Chains[i];
+    C.Units.push_back(Units[i]);
+    C.Size = 0;
+    C.Count = 0;
+    C.Index = i;
+    C.HasEntry = i == 0;
+    for (BlockChain::iterator BI = Units[i]->begin(), BE = Units[i]->end();
+         BI != BE; ++BI) {
+      BlockSize[*BI] = estimateBlockSize(*BI);
+      C.Size += BlockSize[*BI];
+      C.Count += MBFI.getBlockFreq(*BI).getFrequency();
+      addEdges(*BI);
+    }
+    updateOffsets(C);
+  }
+  for (unsigned i = 0, e = Chains.size(); i != e; ++i)
+    Chains[i].Score = scoreLayout(Chains[i].Units, None, None);
+
+  for (unsigned i = 0, e = Chains.size(); i != e; ++i) {
+    Chain &C = Chains[i];
+    for (BlockChain::iterator BI = C.Units[0]->begin(),
+                              BE = C.Units[0]->end();
+         BI != BE; ++BI) {
+      EdgeList &Out = OutEdges[*BI];
+      for (unsigned j = 0, je = Out.size(); j != je; ++j) {
+        Chain *Succ = ChainOf[Out[j].first];
+        if (Succ != &C &&
+            !Candidates.count(std::make_pair(std::min(&C, Succ),
+                                             std::max(&C, Succ))))
+          updateCandidate(C, *Succ);
+      }
+    }
+  }
+
+  // Merge greedily. Ties are broken on the addresses of the chains, which
+  // follow the function order, so the result is deterministic.
+  while (!Candidates.empty()) {
+    CandidateMap::iterator Best = Candidates.begin();
+    for (CandidateMap::iterator I = llvm::next(Candidates.begin()),
+                                E = Candidates.end();
+         I != E; ++I)
+      if (I->second.Gain > Best->second.Gain ||
+          (I->second.Gain == Best->second.Gain && I->first < Best->first))
+        Best = I;
+    MergeCandidate M = Best->second;
+    merge(M);
+  }
+
+  SmallVector<Chain *, 16> Live;
+  for (unsigned i = 0, e = Chains.size(); i != e; ++i)
+    if (!Chains[i].Units.empty())
+      Live.push_back(&Chains[i]);
+  std::sort(Live.begin(), Live.end(), DensityOrder());
+
+  double Score = 0;
+  for (unsigned i = 0, e = Live.size(); i != e; ++i) {
+    Score += Live[i]->Score;
+    Order.append(Live[i]->Units.begin(), Live[i]->Units.end());
+  }
+  DEBUG(dbgs() << "Ext-TSP layout: " << Units.size() << " units in "
+               << Live.size() << " chains, score " << Score << "\n");
+}
+
 namespace {
 class MachineBlockPlacement : public MachineFunctionPass {
   /// \brief A typedef for a block filter set.
@@ -229,6 +649,7 @@ class MachineBlockPlacement : public MachineFunctionPass {
   void buildLoopChains(MachineFunction &F, MachineLoop &L);
   void rotateLoop(BlockChain &LoopChain, MachineBasicBlock *ExitingBB,
                   const BlockFilterSet &LoopBlockSet);
+  void buildExtTSPChain(MachineFunction &F, BlockChain &FunctionChain);
   void buildCFGChains(MachineFunction &F);
 
 public:
@@ -884,6 +1305,30 @@ void MachineBlockPlacement::buildLoopChains(MachineFunction &F,
   });
 }
 
+/// \brief Lay out the whole function for the best Ext-TSP score.
+///
+/// This replaces the loop-aware greedy chain building with the global layout
+/// of ExtTSPLayout. It keeps the chains formed for unanalyzable fallthroughs
+/// intact and merges everything into \p FunctionChain, the chain of the entry
+/// block.
+void MachineBlockPlacement::buildExtTSPChain(MachineFunction &F,
+                                             BlockChain &FunctionChain) {
+  SmallVector<BlockChain *, 16> Units;
+  for (MachineFunction::iterator FI = F.begin(), FE = F.end(); FI != FE; ++FI) {
+    BlockChain *Unit = BlockToChain[FI];
+    if (*Unit->begin() == FI)
+      Units.push_back(Unit);
+  }
+  assert(Units.front() == &FunctionChain && "Entry block not first");
+
+  SmallVector<BlockChain *, 16> Order;
+  ExtTSPLayout(*MBPI, *MBFI).run(Units, Order);
+  assert(Order.size() == Units.size() && Order.front() == &FunctionChain &&
+         "Ext-TSP layout lost a unit or moved the entry block");
+  for (unsigned i = 1, e = Order.size(); i != e; ++i)
+    FunctionChain.merge(*Order[i]->begin(), Order[i]);
+}
+
 void MachineBlockPlacement::buildCFGChains(MachineFunction &F) {
   // Ensure that every BB in the function has an associated chain to simplify
   // the assumptions of the remaining algorithm.
@@ -914,40 +1359,45 @@ void MachineBlockPlacement::buildCFGChains(MachineFunction &F) {
     }
   }
 
-  // Build any loop-based chains.
-  for (MachineLoopInfo::iterator LI = MLI->begin(), LE = MLI->end(); LI != LE;
-       ++LI)
-    buildLoopChains(F, **LI);
-
-  SmallVector<MachineBasicBlock *, 16> BlockWorkList;
-
-  SmallPtrSet<BlockChain *, 4> UpdatedPreds;
-  for (MachineFunction::iterator FI = F.begin(), FE = F.end(); FI != FE; ++FI) {
-    MachineBasicBlock *BB = &*FI;
-    BlockChain &Chain = *BlockToChain[BB];
-    if (!UpdatedPreds.insert(&Chain))
-      continue;
+  BlockChain &FunctionChain = *BlockToChain[&F.front()];
+  if (UseExtTSPLayout) {
+    buildExtTSPChain(F, FunctionChain);
+  } else {
+    // Build any loop-based chains.
+    for (MachineLoopInfo::iterator LI = MLI->begin(), LE = MLI->end(); LI != LE;
+         ++LI)
+      buildLoopChains(F, **LI);
+
+    SmallVector<MachineBasicBlock *, 16> BlockWorkList;
+
+    SmallPtrSet<BlockChain *, 4> UpdatedPreds;
+    for (MachineFunction::iterator FI = F.begin(), FE = F.end(); FI != FE;
+         ++FI) {
+      MachineBasicBlock *BB = &*FI;
+      BlockChain &Chain = *BlockToChain[BB];
+      if (!UpdatedPreds.insert(&Chain))
+        continue;
 
-    assert(Chain.LoopPredecessors == 0);
-    for (BlockChain::iterator BCI = Chain.begin(), BCE = Chain.end();
-         BCI != BCE; ++BCI) {
-      assert(BlockToChain[*BCI] == &Chain);
-      for (MachineBasicBlock::pred_iterator PI = (*BCI)->pred_begin(),
-                                            PE = (*BCI)->pred_end();
-           PI != PE; ++PI) {
-        if (BlockToChain[*PI] == &Chain)
-          continue;
-        ++Chain.LoopPredecessors;
+      assert(Chain.LoopPredecessors == 0);
+      for (BlockChain::iterator BCI = Chain.begin(), BCE = Chain.end();
+           BCI != BCE; ++BCI) {
+        assert(BlockToChain[*BCI] == &Chain);
+        for (MachineBasicBlock::pred_iterator PI = (*BCI)->pred_begin(),
+                                              PE = (*BCI)->pred_end();
+             PI != PE; ++PI) {
+          if (BlockToChain[*PI] == &Chain)
+            continue;
+          ++Chain.LoopPredecessors;
+        }
       }
+
+      if (Chain.LoopPredecessors == 0)
+        BlockWorkList.push_back(*Chain.begin());
     }
 
-    if (Chain.LoopPredecessors == 0)
-      BlockWorkList.push_back(*Chain.begin());
+    buildChain(&F.front(), FunctionChain, BlockWorkList);
   }
 
-  BlockChain &FunctionChain = *BlockToChain[&F.front()];
-  buildChain(&F.front(), FunctionChain, BlockWorkList);
-
   typedef SmallPtrSet<MachineBasicBlock *, 16> FunctionBlockSetType;
   DEBUG({
     // Crash at the end so we get all of the debugging output first.
@@ -67,10 +67,12 @@ namespace {
 
   private:
     const unsigned LookAheadLimit;
+    // The table is keyed by instructions with their hashes, so that looking
+    // up an instruction and then inserting it only hashes it once.
     typedef RecyclingAllocator<BumpPtrAllocator,
-        ScopedHashTableVal<MachineInstr*, unsigned> > AllocatorTy;
-    typedef ScopedHashTable<MachineInstr*, unsigned,
-        MachineInstrExpressionTrait, AllocatorTy> ScopedHTType;
+        ScopedHashTableVal<HashedMachineInstr, unsigned> > AllocatorTy;
+    typedef ScopedHashTable<HashedMachineInstr, unsigned,
+        HashedMachineInstrTrait, AllocatorTy> ScopedHTType;
     typedef ScopedHTType::ScopeTy ScopeType;
     DenseMap<MachineBasicBlock*, ScopeType*> ScopeMap;
     ScopedHTType VNT;
@@ -443,7 +445,8 @@ bool MachineCSE::ProcessBlock(MachineBasicBlock *MBB) {
     if (!isCSECandidate(MI))
       continue;
 
-    bool FoundCSE = VNT.count(MI);
+    HashedMachineInstr Key(MI);
+    bool FoundCSE = VNT.count(Key);
     if (!FoundCSE) {
       // Look for trivial copy coalescing opportunities.
       if (PerformTrivialCoalescing(MI, MBB)) {
@@ -452,24 +455,30 @@ bool MachineCSE::ProcessBlock(MachineBasicBlock *MBB) {
         // After coalescing MI itself may become a copy.
         if (MI->isCopyLike())
           continue;
-        FoundCSE = VNT.count(MI);
+        Key = HashedMachineInstr(MI);
+        FoundCSE = VNT.count(Key);
       }
     }
 
     // Commute commutable instructions.
     bool Commuted = false;
     if (!FoundCSE && MI->isCommutable()) {
+      HashedMachineInstr OrigKey = Key;
       MachineInstr *NewMI = TII->commuteInstruction(MI);
       if (NewMI) {
         Commuted = true;
-        FoundCSE = VNT.count(NewMI);
+        Key = HashedMachineInstr(NewMI);
+        FoundCSE = VNT.count(Key);
         if (NewMI != MI) {
           // New instruction. It doesn't need to be kept.
           NewMI->eraseFromParent();
           Changed = true;
-        } else if (!FoundCSE)
+          Key = OrigKey;
+        } else if (!FoundCSE) {
           // MI was changed but it didn't help, commute it back!
           (void)TII->commuteInstruction(MI);
+          Key = OrigKey;
+        }
       }
     }
 
@@ -490,7 +499,7 @@ bool MachineCSE::ProcessBlock(MachineBasicBlock *MBB) {
       // This can never be the case if the instruction both uses and
       // defines the same physical register, which was detected above.
       if (!PhysUseDef) {
-        unsigned CSVN = VNT.lookup(MI);
+        unsigned CSVN = VNT.lookup(Key);
         MachineInstr *CSMI = Exps[CSVN];
         if (PhysRegDefsReach(CSMI, MI, PhysRefs, PhysDefs, CrossMBBPhysDef))
           FoundCSE = true;
@@ -498,13 +507,13 @@ bool MachineCSE::ProcessBlock(MachineBasicBlock *MBB) {
     }
 
     if (!FoundCSE) {
-      VNT.insert(MI, CurrVN++);
+      VNT.insert(Key, CurrVN++);
       Exps.push_back(MI);
       continue;
     }
 
     // Found a common subexpression, eliminate it.
-    unsigned CSVN = VNT.lookup(MI);
+    unsigned CSVN = VNT.lookup(Key);
     MachineInstr *CSMI = Exps[CSVN];
     DEBUG(dbgs() << "Examining: " << *MI);
     DEBUG(dbgs() << "*** Found a common subexpression: " << *CSMI);
@@ -584,7 +593,7 @@ bool MachineCSE::ProcessBlock(MachineBasicBlock *MBB) {
         ++NumCommutes;
       Changed = true;
     } else {
-      VNT.insert(MI, CurrVN++);
+      VNT.insert(Key, CurrVN++);
       Exps.push_back(MI);
     }
     CSEPairs.clear();
@@ -39,6 +39,42 @@
 #include "llvm/Target/TargetMachine.h"
 using namespace llvm;
 
+//===----------------------------------------------------------------------===//
+// MachineFunctionAllocatorPool implementation
+//===----------------------------------------------------------------------===//
+
+MachineFunctionAllocatorPool::MachineFunctionAllocatorPool(size_t MaxFree)
+  : FreeBytes(0), MaxFreeBytes(MaxFree) {}
+
+MachineFunctionAllocatorPool::~MachineFunctionAllocatorPool() {
+  for (unsigned i = 0, e = FreeSlabs.size(); i != e; ++i)
+    Underlying.Deallocate(FreeSlabs[i]);
+}
+
+MemSlab *MachineFunctionAllocatorPool::Allocate(size_t Size) {
+  // Reuse the most recently released slab that is big enough, as long as it
+  // isn't so big that most of it would be wasted.
+  for (unsigned i = FreeSlabs.size(); i != 0; --i) {
+    MemSlab *Slab = FreeSlabs[i - 1];
+    if (Slab->Size < Size || Slab->Size / 2 > Size)
+      continue;
+    FreeSlabs.erase(FreeSlabs.begin() + (i - 1));
+    FreeBytes -= Slab->Size;
+    Slab->NextPtr = 0;
+    return Slab;
+  }
+  return Underlying.Allocate(Size);
+}
+
+void MachineFunctionAllocatorPool::Deallocate(MemSlab *Slab) {
+  if (FreeBytes + Slab->Size > MaxFreeBytes) {
+    Underlying.Deallocate(Slab);
+    return;
+  }
+  FreeSlabs.push_back(Slab);
+  FreeBytes += Slab->Size;
+}
+
 //===----------------------------------------------------------------------===//
 // MachineFunction implementation
 //===----------------------------------------------------------------------===//
@@ -52,8 +88,11 @@ void ilist_traits<MachineBasicBlock>::deleteNode(MachineBasicBlock *MBB) {
 
 MachineFunction::MachineFunction(const Function *F, const TargetMachine &TM,
                                  unsigned FunctionNum, MachineModuleInfo &mmi,
-                                 GCModuleInfo* gmi)
-  : Fn(F), Target(TM), Ctx(mmi.getContext()), MMI(mmi), GMI(gmi) {
+                                 GCModuleInfo* gmi,
+                                 MachineFunctionAllocatorPool *Pool)
+  : Fn(F), Target(TM), Ctx(mmi.getContext()), MMI(mmi), GMI(gmi),
+    Allocator(4096, 4096,
+              Pool ? static_cast<SlabAllocator&>(*Pool) : DefaultSlabAllocator) {
   if (TM.getRegisterInfo())
     RegInfo = new (Allocator) MachineRegisterInfo(TM);
   else
@@ -79,6 +118,7 @@ MachineFunction::MachineFunction(const Function *F, const TargetMachine &TM,
 
   FunctionNumber = FunctionNum;
   JumpTableInfo = 0;
+  BlockNumberEpoch = 0;
 }
 
 MachineFunction::~MachineFunction() {
@@ -130,7 +170,11 @@ getOrCreateJumpTableInfo(unsigned EntryKind) {
 /// specific MachineBasicBlock is specified, only that block and those after
 /// it are renumbered.
 void MachineFunction::RenumberBlocks(MachineBasicBlock *MBB) {
-  if (empty()) { MBBNumbering.clear(); return; }
+  if (empty()) {
+    MBBNumbering.clear();
+    ++BlockNumberEpoch;
+    return;
+  }
   MachineFunction::iterator MBBI, E = end();
   if (MBB == 0)
     MBBI = begin();
@@ -144,6 +188,9 @@ void MachineFunction::RenumberBlocks(MachineBasicBlock *MBB) {
 
   for (; MBBI != E; ++MBBI, ++BlockNo) {
     if (MBBI->getNumber() != (int)BlockNo) {
+      // Anything indexed by the old numbers is now stale.
+      ++BlockNumberEpoch;
+
       // Remove use of the old number.
       if (MBBI->getNumber() != -1) {
         assert(MBBNumbering[MBBI->getNumber()] == &*MBBI &&
@@ -69,6 +69,11 @@ static cl::opt<bool> EnableMacroFusion("misched-fusion", cl::Hidden,
 static cl::opt<bool> VerifyScheduling("verify-misched", cl::Hidden,
   cl::desc("Verify machine instrs before and after machine scheduling"));
 
+static cl::opt<unsigned> MaxRegionInstrs("misched-max-region-instrs",
+  cl::Hidden, cl::init(0),
+  cl::desc("Split scheduling regions longer than N instructions, leaving the "
+           "instruction above each piece in place (0 = no limit)"));
+
 // DAG subtrees must have at least this many nodes.
 static const unsigned MinSubtreeSize = 8;
 
@@ -296,11 +301,14 @@ bool MachineScheduler::runOnMachineFunction(MachineFunction &mf) {
       }
 
       // The next region starts above the previous region. Look backward in the
-      // instruction stream until we find the nearest boundary.
+      // instruction stream until we find the nearest boundary.  Once a region
+      // reaches MaxRegionInstrs, the instruction above it is treated as a
+      // boundary, so that no DAG grows without bound.
       unsigned NumRegionInstrs = 0;
       MachineBasicBlock::iterator I = RegionEnd;
       for(;I != MBB->begin(); --I, --RemainingInstrs, ++NumRegionInstrs) {
-        if (TII->isSchedulingBoundary(llvm::prior(I), MBB, *MF))
+        if (TII->isSchedulingBoundary(llvm::prior(I), MBB, *MF) ||
+            (MaxRegionInstrs && NumRegionInstrs == MaxRegionInstrs))
           break;
       }
       // Notify the scheduler of the region, even if we may skip scheduling
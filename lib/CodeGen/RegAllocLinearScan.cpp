@@ -0,0 +1,315 @@
+//===-- RegAllocLinearScan.cpp - Linear Scan Register Allocator -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the RALinearScan function pass, a register allocator that
+// sits between the fast and the greedy allocators in compile time and code
+// quality.
+//
+// Live ranges are assigned in order of their start points, as in classic
+// linear scan, but interference is checked against the LiveRegMatrix, so the
+// holes in live ranges are used.  When every register is taken, lighter live
+// ranges are evicted and queued again, like RAGreedy does.  Live ranges are
+// never split; a live range that cannot get a register is spilled everywhere
+// by the inline spiller.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "regalloc"
+#include "llvm/CodeGen/Passes.h"
+#include "AllocationOrder.h"
+#include "LiveDebugVariables.h"
+#include "RegAllocBase.h"
+#include "Spiller.h"
+#include "llvm/ADT/IndexedMap.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/CodeGen/CalcSpillWeights.h"
+#include "llvm/CodeGen/LiveIntervalAnalysis.h"
+#include "llvm/CodeGen/LiveRangeEdit.h"
+#include "llvm/CodeGen/LiveRegMatrix.h"
+#include "llvm/CodeGen/LiveStackAnalysis.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/RegAllocRegistry.h"
+#include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/PassAnalysisSupport.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+using namespace llvm;
+
+STATISTIC(NumEvicted, "Number of interferences evicted");
+
+static RegisterRegAlloc linearScanRegAlloc("linearscan",
+                                           "linear scan register allocator",
+                                           createLinearScanRegisterAllocator);
+
+namespace {
+  /// CompStart - Order live ranges by their start points, earliest first.
+  /// Ties are broken by register number to keep the order deterministic.
+  struct CompStart {
+    bool operator()(LiveInterval *A, LiveInterval *B) const {
+      if (A->beginIndex() != B->beginIndex())
+        return B->beginIndex() < A->beginIndex();
+      return A->reg > B->reg;
+    }
+  };
+}
+
+namespace {
+class RALinearScan : public MachineFunctionPass, public RegAllocBase {
+  // context
+  MachineFunction *MF;
+
+  // state
+  OwningPtr<Spiller> SpillerInstance;
+  std::priority_queue<LiveInterval*, std::vector<LiveInterval*>,
+                      CompStart> Queue;
+
+  // Cascade numbers prevent eviction loops: a live range may only evict
+  // live ranges with an older cascade number.  See canEvictInterference().
+  IndexedMap<unsigned, VirtReg2IndexFunctor> Cascade;
+  unsigned NextCascade;
+
+public:
+  RALinearScan();
+
+  /// Return the pass name.
+  virtual const char* getPassName() const {
+    return "Linear Scan Register Allocator";
+  }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const;
+
+  virtual void releaseMemory();
+
+  virtual Spiller &spiller() { return *SpillerInstance; }
+
+  virtual void enqueue(LiveInterval *LI) {
+    Cascade.grow(LI->reg);
+    Queue.push(LI);
+  }
+
+  virtual LiveInterval *dequeue() {
+    if (Queue.empty())
+      return 0;
+    LiveInterval *LI = Queue.top();
+    Queue.pop();
+    return LI;
+  }
+
+  virtual unsigned selectOrSplit(LiveInterval &VirtReg,
+                                 SmallVectorImpl<unsigned> &NewVRegs);
+
+  /// Perform register allocation.
+  virtual bool runOnMachineFunction(MachineFunction &mf);
+
+  static char ID;
+
+private:
+  bool canEvictInterference(LiveInterval &VirtReg, unsigned PhysReg,
+                            float &MaxWeight);
+  void evictInterference(LiveInterval &VirtReg, unsigned PhysReg,
+                         SmallVectorImpl<unsigned> &NewVRegs);
+};
+
+char RALinearScan::ID = 0;
+
+} // end anonymous namespace
+
+RALinearScan::RALinearScan(): MachineFunctionPass(ID) {
+  initializeLiveDebugVariablesPass(*PassRegistry::getPassRegistry());
+  initializeLiveIntervalsPass(*PassRegistry::getPassRegistry());
+  initializeSlotIndexesPass(*PassRegistry::getPassRegistry());
+  initializeRegisterCoalescerPass(*PassRegistry::getPassRegistry());
+  initializeMachineSchedulerPass(*PassRegistry::getPassRegistry());
+  initializeLiveStacksPass(*PassRegistry::getPassRegistry());
+  initializeMachineDominatorTreePass(*PassRegistry::getPassRegistry());
+  initializeMachineLoopInfoPass(*PassRegistry::getPassRegistry());
+  initializeVirtRegMapPass(*PassRegistry::getPassRegistry());
+  initializeLiveRegMatrixPass(*PassRegistry::getPassRegistry());
+}
+
+void RALinearScan::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesCFG();
+  AU.addRequired<AliasAnalysis>();
+  AU.addPreserved<AliasAnalysis>();
+  AU.addRequired<LiveIntervals>();
+  AU.addPreserved<LiveIntervals>();
+  AU.addPreserved<SlotIndexes>();
+  AU.addRequired<LiveDebugVariables>();
+  AU.addPreserved<LiveDebugVariables>();
+  AU.addRequired<LiveStacks>();
+  AU.addPreserved<LiveStacks>();
+  AU.addRequired<MachineBlockFrequencyInfo>();
+  AU.addPreserved<MachineBlockFrequencyInfo>();
+  AU.addRequiredID(MachineDominatorsID);
+  AU.addPreservedID(MachineDominatorsID);
+  AU.addRequired<MachineLoopInfo>();
+  AU.addPreserved<MachineLoopInfo>();
+  AU.addRequired<VirtRegMap>();
+  AU.addPreserved<VirtRegMap>();
+  AU.addRequired<LiveRegMatrix>();
+  AU.addPreserved<LiveRegMatrix>();
+  MachineFunctionPass::getAnalysisUsage(AU);
+}
+
+void RALinearScan::releaseMemory() {
+  SpillerInstance.reset(0);
+  Cascade.clear();
+}
+
+/// canEvictInterference - Return true if all live ranges assigned to PhysReg
+/// that interfere with VirtReg can be evicted, and the heaviest of them is
+/// lighter than MaxWeight.  On success, MaxWeight is updated.
+bool RALinearScan::canEvictInterference(LiveInterval &VirtReg,
+                                        unsigned PhysReg, float &MaxWeight) {
+  // A live range without a cascade number may evict anything.
+  unsigned VirtCascade = Cascade[VirtReg.reg];
+  if (!VirtCascade)
+    VirtCascade = NextCascade;
+
+  float Weight = 0;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    // If there is 10 or more interferences, chances are one is heavier.
+    if (Q.collectInterferingVRegs(10) >= 10)
+      return false;
+
+    for (unsigned i = Q.interferingVRegs().size(); i; --i) {
+      LiveInterval *Intf = Q.interferingVRegs()[i - 1];
+      // Spill products cannot be spilled again.
+      if (!Intf->isSpillable())
+        return false;
+      // An unspillable live range must get a register, so it may evict any
+      // spillable one.  Otherwise only evict lighter, older live ranges.
+      if (VirtReg.isSpillable() &&
+          (VirtCascade <= Cascade[Intf->reg] || Intf->weight >= VirtReg.weight))
+        return false;
+      Weight = std::max(Weight, Intf->weight);
+      if (Weight >= MaxWeight)
+        return false;
+    }
+  }
+  MaxWeight = Weight;
+  return true;
+}
+
+/// evictInterference - Unassign the live ranges that prevent VirtReg from
+/// being assigned to PhysReg and queue them again.
+void RALinearScan::evictInterference(LiveInterval &VirtReg, unsigned PhysReg,
+                                     SmallVectorImpl<unsigned> &NewVRegs) {
+  unsigned VirtCascade = Cascade[VirtReg.reg];
+  if (!VirtCascade)
+    VirtCascade = Cascade[VirtReg.reg] = NextCascade++;
+
+  DEBUG(dbgs() << "evicting " << PrintReg(PhysReg, TRI)
+               << " interference: Cascade " << VirtCascade << '\n');
+
+  // Collect all interfering virtregs first.
+  SmallVector<LiveInterval*, 8> Intfs;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    assert(Q.seenAllInterferences() && "Didn't check all interfererences.");
+    ArrayRef<LiveInterval*> IVR = Q.interferingVRegs();
+    Intfs.append(IVR.begin(), IVR.end());
+  }
+
+  // Evict them second. This will invalidate the queries.
+  for (unsigned i = 0, e = Intfs.size(); i != e; ++i) {
+    LiveInterval *Intf = Intfs[i];
+    // The same VirtReg may be present in multiple RegUnits. Skip duplicates.
+    if (!VRM->hasPhys(Intf->reg))
+      continue;
+    Matrix->unassign(*Intf);
+    Cascade[Intf->reg] = VirtCascade;
+    ++NumEvicted;
+    NewVRegs.push_back(Intf->reg);
+  }
+}
+
+// Assign VirtReg to the first free register in allocation order, which puts
+// the hints first.  Failing that, evict the cheapest set of lighter live
+// ranges, or spill VirtReg.
+unsigned RALinearScan::selectOrSplit(LiveInterval &VirtReg,
+                                     SmallVectorImpl<unsigned> &NewVRegs) {
+  SmallVector<unsigned, 8> EvictCands;
+  AllocationOrder Order(VirtReg.reg, *VRM, RegClassInfo);
+  while (unsigned PhysReg = Order.next()) {
+    switch (Matrix->checkInterference(VirtReg, PhysReg)) {
+    case LiveRegMatrix::IK_Free:
+      return PhysReg;
+    case LiveRegMatrix::IK_VirtReg:
+      EvictCands.push_back(PhysReg);
+      continue;
+    default:
+      // RegMask or RegUnit interference.
+      continue;
+    }
+  }
+
+  float BestWeight = VirtReg.isSpillable() ? VirtReg.weight : HUGE_VALF;
+  unsigned BestPhys = 0;
+  for (unsigned i = 0, e = EvictCands.size(); i != e; ++i)
+    if (canEvictInterference(VirtReg, EvictCands[i], BestWeight))
+      BestPhys = EvictCands[i];
+
+  if (BestPhys) {
+    evictInterference(VirtReg, BestPhys, NewVRegs);
+    return BestPhys;
+  }
+
+  DEBUG(dbgs() << "spilling: " << VirtReg << '\n');
+  if (!VirtReg.isSpillable())
+    return ~0u;
+  LiveRangeEdit LRE(&VirtReg, NewVRegs, *MF, *LIS, VRM);
+  spiller().spill(LRE);
+
+  // The live virtual register requesting allocation was spilled, so tell
+  // the caller not to allocate anything during this round.
+  return 0;
+}
+
+bool RALinearScan::runOnMachineFunction(MachineFunction &mf) {
+  DEBUG(dbgs() << "********** LINEAR SCAN REGISTER ALLOCATION **********\n"
+               << "********** Function: "
+               << mf.getName() << '\n');
+
+  MF = &mf;
+  RegAllocBase::init(getAnalysis<VirtRegMap>(),
+                     getAnalysis<LiveIntervals>(),
+                     getAnalysis<LiveRegMatrix>());
+
+  calculateSpillWeightsAndHints(*LIS, *MF,
+                                getAnalysis<MachineLoopInfo>(),
+                                getAnalysis<MachineBlockFrequencyInfo>());
+
+  SpillerInstance.reset(createInlineSpiller(*this, *MF, *VRM));
+  Cascade.clear();
+  Cascade.resize(MRI->getNumVirtRegs());
+  NextCascade = 1;
+
+  allocatePhysRegs();
+
+  // Diagnostic output before rewriting
+  DEBUG(dbgs() << "Post alloc VirtRegMap:\n" << *VRM << "\n");
+
+  releaseMemory();
+  return true;
+}
+
+FunctionPass* llvm::createLinearScanRegisterAllocator() {
+  return new RALinearScan();
+}
@@ -35,6 +35,7 @@
 #include "RegisterCoalescer.h"
 #include "Spiller.h"
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/CodeGen/CalcSpillWeights.h"
 #include "llvm/CodeGen/LiveIntervalAnalysis.h"
@@ -55,7 +56,9 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
 #include "llvm/Target/TargetMachine.h"
+#include <algorithm>
 #include <limits>
+#include <map>
 #include <memory>
 #include <set>
 #include <sstream>
@@ -63,6 +66,10 @@
 
 using namespace llvm;
 
+STATISTIC(NumInterferenceEdges, "Number of PBQP interference edges");
+STATISTIC(NumInterferenceMatrices,
+          "Number of distinct PBQP interference matrices built");
+
 static RegisterRegAlloc
 registerPBQPRepAlloc("pbqp", "PBQP register allocator",
                        createDefaultPBQPRegisterAllocator);
@@ -258,27 +265,75 @@ PBQPRAProblem *PBQPBuilder::build(MachineFunction *mf, const LiveIntervals *lis,
     addSpillCosts(g.getNodeCosts(node), spillCost);
   }
 
-  for (RegSet::const_iterator vr1Itr = vregs.begin(), vrEnd = vregs.end();
-         vr1Itr != vrEnd; ++vr1Itr) {
-    unsigned vr1 = *vr1Itr;
-    const LiveInterval &l1 = lis->getInterval(vr1);
-    const PBQPRAProblem::AllowedSet &vr1Allowed = p->getAllowedSet(vr1);
-
-    for (RegSet::const_iterator vr2Itr = llvm::next(vr1Itr);
-         vr2Itr != vrEnd; ++vr2Itr) {
-      unsigned vr2 = *vr2Itr;
-      const LiveInterval &l2 = lis->getInterval(vr2);
-      const PBQPRAProblem::AllowedSet &vr2Allowed = p->getAllowedSet(vr2);
+  // Find the interfering pairs by sweeping over the intervals in order of
+  // their start, testing each against those that are still live there
+  // rather than against every other interval.
+  typedef std::pair<SlotIndex, unsigned> IntervalStart;
+  std::vector<IntervalStart> starts;
+  for (RegSet::const_iterator vrItr = vregs.begin(), vrEnd = vregs.end();
+       vrItr != vrEnd; ++vrItr) {
+    const LiveInterval &li = lis->getInterval(*vrItr);
+    assert(!li.empty() && "Empty interval in vreg set?");
+    starts.push_back(IntervalStart(li.beginIndex(), *vrItr));
+  }
+  std::sort(starts.begin(), starts.end());
+
+  typedef std::pair<unsigned, unsigned> VRegPair;
+  std::vector<VRegPair> interferences;
+  std::vector<unsigned> active;
+  for (unsigned i = 0, e = starts.size(); i != e; ++i) {
+    unsigned vr = starts[i].second;
+    const LiveInterval &li = lis->getInterval(vr);
+    unsigned numActive = 0;
+    for (unsigned j = 0, je = active.size(); j != je; ++j) {
+      unsigned activeVR = active[j];
+      const LiveInterval &activeLI = lis->getInterval(activeVR);
+      if (activeLI.endIndex() <= starts[i].first)
+        continue; // Ended before vr starts, and so before any later one.
+      active[numActive++] = activeVR;
+      if (activeLI.overlaps(li))
+        interferences.push_back(VRegPair(std::min(vr, activeVR),
+                                         std::max(vr, activeVR)));
+    }
+    active.resize(numActive);
+    active.push_back(vr);
+  }
 
-      assert(!l2.empty() && "Empty interval in vreg set?");
-      if (l1.overlaps(l2)) {
-        PBQP::Graph::EdgeId edge =
-          g.addEdge(p->getNodeForVReg(vr1), p->getNodeForVReg(vr2),
-                    PBQP::Matrix(vr1Allowed.size()+1, vr2Allowed.size()+1, 0));
+  // Add the edges in the order of the vregs, as a walk over all pairs would,
+  // so that the solver sees the same graph.
+  std::sort(interferences.begin(), interferences.end());
+
+  // An interference matrix only depends on the allowed sets of the two
+  // vregs, and most vregs of a class share theirs, so build each distinct
+  // matrix once.
+  std::map<PBQPRAProblem::AllowedSet, unsigned> allowedSetIds;
+  DenseMap<unsigned, unsigned> vregAllowedSetIds;
+  for (RegSet::const_iterator vrItr = vregs.begin(), vrEnd = vregs.end();
+       vrItr != vrEnd; ++vrItr) {
+    unsigned id = allowedSetIds.insert(
+      std::make_pair(p->getAllowedSet(*vrItr), allowedSetIds.size()))
+        .first->second;
+    vregAllowedSetIds[*vrItr] = id;
+  }
 
-        addInterferenceCosts(g.getEdgeCosts(edge), vr1Allowed, vr2Allowed, tri);
-      }
+  typedef std::map<std::pair<unsigned, unsigned>, PBQP::Matrix> MatrixCache;
+  MatrixCache interferenceMatrices;
+  for (unsigned i = 0, e = interferences.size(); i != e; ++i) {
+    unsigned vr1 = interferences[i].first, vr2 = interferences[i].second;
+    std::pair<unsigned, unsigned> key(vregAllowedSetIds[vr1],
+                                      vregAllowedSetIds[vr2]);
+    MatrixCache::iterator mItr = interferenceMatrices.find(key);
+    if (mItr == interferenceMatrices.end()) {
+      const PBQPRAProblem::AllowedSet &vr1Allowed = p->getAllowedSet(vr1);
+      const PBQPRAProblem::AllowedSet &vr2Allowed = p->getAllowedSet(vr2);
+      PBQP::Matrix costs(vr1Allowed.size() + 1, vr2Allowed.size() + 1, 0);
+      addInterferenceCosts(costs, vr1Allowed, vr2Allowed, tri);
+      mItr = interferenceMatrices.insert(std::make_pair(key, costs)).first;
+      ++NumInterferenceMatrices;
     }
+
+    g.addEdge(p->getNodeForVReg(vr1), p->getNodeForVReg(vr2), mItr->second);
+    ++NumInterferenceEdges;
   }
 
   return p.take();
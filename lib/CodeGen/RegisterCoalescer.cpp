@@ -15,6 +15,7 @@
 
 #define DEBUG_TYPE "regalloc"
 #include "RegisterCoalescer.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallSet.h"
@@ -51,6 +52,9 @@ STATISTIC(NumReMats   , "Number of instructions re-materialized");
 STATISTIC(NumInflated , "Number of register classes inflated");
 STATISTIC(NumLaneConflicts, "Number of dead lane conflicts tested");
 STATISTIC(NumLaneResolves,  "Number of dead lane conflicts resolved");
+STATISTIC(NumRetries, "Number of copies retried after failing to join");
+STATISTIC(NumRetriesSkipped,
+          "Number of retries skipped because neither register had changed");
 
 static cl::opt<bool>
 EnableJoining("join-liveintervals",
@@ -68,6 +72,14 @@ EnableGlobalCopies("join-globalcopies",
   cl::desc("Coalesce copies that span blocks (default=subtarget)"),
   cl::init(cl::BOU_UNSET), cl::Hidden);
 
+// Retrying a copy that failed to join can only succeed once the live range
+// of one of its registers has changed.
+static cl::opt<bool>
+RetryChangedOnly("join-retry-changed-only",
+  cl::desc("Only retry joining copies whose registers have changed since "
+           "the last attempt"),
+  cl::init(false), cl::Hidden);
+
 static cl::opt<bool>
 VerifyCoalescing("verify-coalescing",
          cl::desc("Verify machine instrs before and after register coalescing"),
@@ -105,6 +117,27 @@ namespace {
     /// Dead instructions that are about to be deleted.
     SmallVector<MachineInstr*, 8> DeadDefs;
 
+    /// ChangeCount - The number of times live ranges have been changed by
+    /// joining or erasing instructions.
+    unsigned ChangeCount;
+
+    /// RegChangedAt - The value of ChangeCount when the live range of each
+    /// register last changed.  PhysChangedAt is the last change of any
+    /// physical register, whose intervals share register units.
+    DenseMap<unsigned, unsigned> RegChangedAt;
+    unsigned PhysChangedAt;
+
+    /// FailedAt - The value of ChangeCount when each copy of the work lists
+    /// last failed to join.
+    DenseMap<MachineInstr*, unsigned> FailedAt;
+
+    /// Record that the live range of Reg has changed.
+    void markChanged(unsigned Reg);
+
+    /// Return true if the live range of a register of CP has changed since
+    /// ChangeCount was Count.
+    bool changedSince(const CoalescerPair &CP, unsigned Count) const;
+
     /// Virtual registers to be considered for register class inflation.
     SmallVector<unsigned, 8> InflateRegs;
 
@@ -406,6 +439,27 @@ void RegisterCoalescer::eliminateDeadDefs() {
 void RegisterCoalescer::LRE_WillEraseInstruction(MachineInstr *MI) {
   // MI may be in WorkList. Make sure we don't visit it.
   ErasedInstrs.insert(MI);
+  FailedAt.erase(MI);
+
+  // Erasing MI shrinks the live ranges of the registers it uses.
+  ++ChangeCount;
+  for (MIOperands MO(MI); MO.isValid(); ++MO)
+    if (MO->isReg() && MO->getReg())
+      markChanged(MO->getReg());
+}
+
+void RegisterCoalescer::markChanged(unsigned Reg) {
+  RegChangedAt[Reg] = ChangeCount;
+  if (TargetRegisterInfo::isPhysicalRegister(Reg))
+    PhysChangedAt = ChangeCount;
+}
+
+bool RegisterCoalescer::changedSince(const CoalescerPair &CP,
+                                     unsigned Count) const {
+  if (CP.isPhys() && PhysChangedAt > Count)
+    return true;
+  return RegChangedAt.lookup(CP.getSrcReg()) > Count ||
+         RegChangedAt.lookup(CP.getDstReg()) > Count;
 }
 
 /// adjustCopiesBackFrom - We found a non-trivially-coalescable copy with IntA
@@ -2095,9 +2149,29 @@ copyCoalesceWorkList(MutableArrayRef<MachineInstr*> CurrList) {
       CurrList[i] = 0;
       continue;
     }
+    MachineInstr *MI = CurrList[i];
+    CoalescerPair CP(*TRI);
+    bool HasRegs = CP.setRegisters(MI);
+    DenseMap<MachineInstr*, unsigned>::iterator FI = FailedAt.find(MI);
+    if (FI != FailedAt.end()) {
+      if (RetryChangedOnly && HasRegs && !changedSince(CP, FI->second)) {
+        ++NumRetriesSkipped;
+        continue;
+      }
+      ++NumRetries;
+      FailedAt.erase(FI);
+    }
+
     bool Again = false;
-    bool Success = joinCopy(CurrList[i], Again);
+    bool Success = joinCopy(MI, Again);
     Progress |= Success;
+    if (Success && HasRegs) {
+      ++ChangeCount;
+      markChanged(CP.getSrcReg());
+      markChanged(CP.getDstReg());
+    } else if (!Success && Again) {
+      FailedAt[MI] = ChangeCount;
+    }
     if (Success || !Again)
       CurrList[i] = 0;
   }
@@ -2154,6 +2228,7 @@ void RegisterCoalescer::coalesceLocals() {
 void RegisterCoalescer::joinAllIntervals() {
   DEBUG(dbgs() << "********** JOINING INTERVALS ***********\n");
   assert(WorkList.empty() && LocalWorkList.empty() && "Old data still around.");
+  ChangeCount = PhysChangedAt = 0;
 
   std::vector<MBBPriorityInfo> MBBs;
   MBBs.reserve(MF->size());
@@ -2184,6 +2259,8 @@ void RegisterCoalescer::joinAllIntervals() {
 
 void RegisterCoalescer::releaseMemory() {
   ErasedInstrs.clear();
+  RegChangedAt.clear();
+  FailedAt.clear();
   WorkList.clear();
   DeadDefs.clear();
   InflateRegs.clear();
@@ -17,6 +17,7 @@
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/LiveIntervalAnalysis.h"
@@ -44,6 +45,16 @@ static cl::opt<bool> EnableAASchedMI("enable-aa-sched-mi", cl::Hidden,
     cl::ZeroOrMore, cl::init(false),
     cl::desc("Enable use of AA during MI GAD construction"));
 
+static cl::opt<unsigned> SimpleMemChainThreshold(
+    "sched-simple-mem-chain-threshold", cl::Hidden, cl::init(4096),
+    cl::desc("Order all stores in scheduling regions with more memory "
+             "operations than this (0 = no limit)"));
+
+STATISTIC(NumDAGEdges, "Number of edges in scheduling DAGs");
+STATISTIC(MaxDAGEdges, "Largest number of edges in one scheduling DAG");
+STATISTIC(NumSimpleMemChainRegions,
+          "Number of scheduling regions given simple memory chains");
+
 ScheduleDAGInstrs::ScheduleDAGInstrs(MachineFunction &mf,
                                      const MachineLoopInfo &mli,
                                      const MachineDominatorTree &mdt,
@@ -707,6 +718,25 @@ void ScheduleDAGInstrs::buildSchedGraph(AliasAnalysis *AA,
   // Create an SUnit for each real instruction.
   initSUnits();
 
+  // Finding precise memory dependencies compares each memory operation with
+  // many of the ones below it.  In huge regions, just order each store, call
+  // and other barrier with all the memory operations around it, which only
+  // needs a few edges per operation.
+  bool SimpleMemChains = false;
+  if (SimpleMemChainThreshold) {
+    unsigned NumMemOps = 0;
+    for (unsigned i = 0, e = SUnits.size(); i != e; ++i) {
+      const MachineInstr *MI = SUnits[i].getInstr();
+      if (MI->mayLoad() || MI->mayStore() || MI->isCall() ||
+          MI->hasUnmodeledSideEffects())
+        ++NumMemOps;
+    }
+    if (NumMemOps > SimpleMemChainThreshold) {
+      SimpleMemChains = true;
+      ++NumSimpleMemChainRegions;
+    }
+  }
+
   if (PDiffs)
     PDiffs->init(SUnits.size());
 
@@ -812,7 +842,27 @@ void ScheduleDAGInstrs::buildSchedGraph(AliasAnalysis *AA,
     // TODO: Use an AliasAnalysis and do real alias-analysis queries, and
     // produce more precise dependence information.
     unsigned TrueMemOrderLatency = MI->mayStore() ? 1 : 0;
-    if (isGlobalMemoryObject(AA, MI)) {
+    if (SimpleMemChains) {
+      // AliasChain is the nearest store or barrier below SU, and PendingLoads
+      // are the loads between it and SU.
+      if (isGlobalMemoryObject(AA, MI) || MI->mayStore()) {
+        for (unsigned k = 0, m = PendingLoads.size(); k != m; ++k) {
+          SDep Dep(SU, SDep::Barrier);
+          Dep.setLatency(TrueMemOrderLatency);
+          PendingLoads[k]->addPred(Dep);
+        }
+        PendingLoads.clear();
+        if (AliasChain)
+          AliasChain->addPred(SDep(SU, SDep::Barrier));
+        AliasChain = SU;
+        if (!isGlobalMemoryObject(AA, MI) && !ExitSU.isPred(SU))
+          ExitSU.addPred(SDep(SU, SDep::Artificial));
+      } else if (MI->mayLoad() && !MI->isInvariantLoad(AA)) {
+        if (AliasChain)
+          AliasChain->addPred(SDep(SU, SDep::Barrier));
+        PendingLoads.push_back(SU);
+      }
+    } else if (isGlobalMemoryObject(AA, MI)) {
       // Be conservative with these and add dependencies on all memory
       // references, even those that are known to not alias.
       for (MapVector<const Value *, SUnit *>::iterator I =
@@ -997,6 +1047,15 @@ void ScheduleDAGInstrs::buildSchedGraph(AliasAnalysis *AA,
   Uses.clear();
   VRegDefs.clear();
   PendingLoads.clear();
+
+  unsigned NumEdges = ExitSU.Preds.size();
+  for (unsigned i = 0, e = SUnits.size(); i != e; ++i)
+    NumEdges += SUnits[i].Preds.size();
+  DEBUG(dbgs() << "Scheduling DAG: " << SUnits.size() << " nodes, "
+               << NumEdges << " edges\n");
+  NumDAGEdges += NumEdges;
+  if (NumEdges > MaxDAGEdges)
+    MaxDAGEdges = NumEdges;
 }
 
 void ScheduleDAGInstrs::dumpNode(const SUnit *SU) const {
@@ -18,6 +18,7 @@
 
 #define DEBUG_TYPE "dagcombine"
 #include "llvm/CodeGen/SelectionDAG.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
@@ -46,12 +47,20 @@ STATISTIC(PostIndexedNodes, "Number of post-indexed nodes created");
 STATISTIC(OpsNarrowed     , "Number of load/op/store narrowed");
 STATISTIC(LdStFP2Int      , "Number of fp load/store pairs transformed to int");
 STATISTIC(SlicedLoads, "Number of load sliced");
+STATISTIC(NodesVisited    , "Number of dag nodes visited");
+STATISTIC(NodesOverLimit  , "Number of dag nodes that hit the visit limit");
 
 namespace {
   static cl::opt<bool>
     CombinerAA("combiner-alias-analysis", cl::Hidden,
                cl::desc("Turn on alias analysis during testing"));
 
+  static cl::opt<unsigned>
+    CombinerNodeVisitLimit("combiner-node-visit-limit", cl::Hidden,
+               cl::init(0),
+               cl::desc("Stop combining a node after this many visits "
+                        "(0 = no limit)"));
+
   static cl::opt<bool>
     CombinerGlobalAA("combiner-global-alias-analysis", cl::Hidden,
                cl::desc("Include global information in alias analysis"));
@@ -82,18 +91,17 @@ namespace {
     // also only appear once. The naive approach to this takes
     // linear time.
     //
-    // To reduce the insert/remove time to logarithmic, we use
-    // a set and a vector to maintain our worklist.
-    //
-    // The set contains the items on the worklist, but does not
-    // maintain the order they should be visited.
-    //
-    // The vector maintains the order nodes should be visited, but may
-    // contain duplicate or removed nodes. When choosing a node to
-    // visit, we pop off the order stack until we find an item that is
-    // also in the contents set. All operations are O(log N).
-    SmallPtrSet<SDNode*, 64> WorkListContents;
-    SmallVector<SDNode*, 64> WorkListOrder;
+    // The worklist of nodes to visit, processed from the back.  Each node on
+    // the worklist records its position in the vector, so adding, removing
+    // and testing for membership are all O(1).  Removing a node leaves a null
+    // entry behind, which is skipped when it reaches the back.
+    SmallVector<SDNode*, 64> WorkList;
+    unsigned WorkListSize;
+
+    // VisitCounts - The number of times each node has been combined, tracked
+    // only when visits are being limited or traced.
+    DenseMap<SDNode*, unsigned> VisitCounts;
+    bool TrackVisits;
 
     // AA - Used for DAG load/store alias analysis.
     AliasAnalysis &AA;
@@ -116,14 +124,41 @@ namespace {
     /// AddToWorkList - Add to the work list making sure its instance is at the
     /// back (next to be processed.)
     void AddToWorkList(SDNode *N) {
-      WorkListContents.insert(N);
-      WorkListOrder.push_back(N);
+      int Index = N->getCombinerWorklistIndex();
+      if (Index >= 0)
+        WorkList[Index] = 0;
+      else
+        ++WorkListSize;
+      N->setCombinerWorklistIndex(WorkList.size());
+      WorkList.push_back(N);
     }
 
-    /// removeFromWorkList - remove all instances of N from the worklist.
+    /// removeFromWorkList - remove N from the worklist, if it is there.
     ///
     void removeFromWorkList(SDNode *N) {
-      WorkListContents.erase(N);
+      if (TrackVisits)
+        VisitCounts.erase(N);
+      int Index = N->getCombinerWorklistIndex();
+      if (Index < 0)
+        return;
+      WorkList[Index] = 0;
+      N->setCombinerWorklistIndex(-1);
+      --WorkListSize;
+    }
+
+    /// getNextWorkListEntry - Pop the next node to visit off the worklist, or
+    /// return null if the worklist is empty.
+    SDNode *getNextWorkListEntry() {
+      while (!WorkList.empty()) {
+        SDNode *N = WorkList.pop_back_val();
+        if (!N)
+          continue;
+        N->setCombinerWorklistIndex(-1);
+        --WorkListSize;
+        return N;
+      }
+      assert(WorkListSize == 0 && "Worklist size out of sync");
+      return 0;
     }
 
     SDValue CombineTo(SDNode *N, const SDValue *To, unsigned NumTo,
@@ -329,7 +364,9 @@ namespace {
   public:
     DAGCombiner(SelectionDAG &D, AliasAnalysis &A, CodeGenOpt::Level OL)
         : DAG(D), TLI(D.getTargetLoweringInfo()), Level(BeforeLegalizeTypes),
-          OptLevel(OL), LegalOperations(false), LegalTypes(false), AA(A) {
+          OptLevel(OL), LegalOperations(false), LegalTypes(false),
+          WorkListSize(0), TrackVisits(CombinerNodeVisitLimit != 0), AA(A) {
+      DEBUG(TrackVisits = true);
       AttributeSet FnAttrs =
           DAG.getMachineFunction().getFunction()->getAttributes();
       ForCodeSize =
@@ -1030,19 +1067,11 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
   // done.  Set it to null to avoid confusion.
   DAG.setRoot(SDValue());
 
+  unsigned NumVisits = 0, MaxNodeVisits = 0;
+
   // while the worklist isn't empty, find a node and
   // try and combine it.
-  while (!WorkListContents.empty()) {
-    SDNode *N;
-    // The WorkListOrder holds the SDNodes in order, but it may contain
-    // duplicates.
-    // In order to avoid a linear scan, we use a set (O(log N)) to hold what the
-    // worklist *should* contain, and check the node we want to visit is should
-    // actually be visited.
-    do {
-      N = WorkListOrder.pop_back_val();
-    } while (!WorkListContents.erase(N));
-
+  while (SDNode *N = getNextWorkListEntry()) {
     // If N has no uses, it is dead.  Make sure to revisit all N's operands once
     // N is deleted from the DAG, since they too may now be dead or may have a
     // reduced number of uses, allowing other xforms.
@@ -1050,10 +1079,26 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
       for (unsigned i = 0, e = N->getNumOperands(); i != e; ++i)
         AddToWorkList(N->getOperand(i).getNode());
 
+      removeFromWorkList(N);
       DAG.DeleteNode(N);
       continue;
     }
 
+    ++NodesVisited;
+    ++NumVisits;
+    if (TrackVisits) {
+      unsigned &Visits = VisitCounts[N];
+      if (CombinerNodeVisitLimit && Visits >= CombinerNodeVisitLimit) {
+        if (Visits++ == CombinerNodeVisitLimit) {
+          ++NodesOverLimit;
+          DEBUG(dbgs() << "\nVisit limit reached for ";
+                N->dump(&DAG));
+        }
+        continue;
+      }
+      MaxNodeVisits = std::max(MaxNodeVisits, ++Visits);
+    }
+
     SDValue RV = combine(N);
 
     if (RV.getNode() == 0)
@@ -1113,6 +1158,10 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
     }
   }
 
+  DEBUG(dbgs() << "\nDAG combine made " << NumVisits << " visits, at most "
+               << MaxNodeVisits << " to any one node\n");
+  VisitCounts.clear();
+
   // If the root changed (e.g. it was a dead load, update the root).
   DAG.setRoot(Dummy.getValue());
   DAG.RemoveDeadNodes();
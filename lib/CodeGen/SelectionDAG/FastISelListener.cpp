@@ -0,0 +1,133 @@
+//===-- FastISelListener.cpp - Observe FastISel fallbacks -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the registry of FastISelListeners and the
+// FastISelMissCounter.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/FastISelListener.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+using namespace llvm;
+
+void FastISelListener::anchor() {}
+
+static ManagedStatic<sys::SmartMutex<true> > ListenersMutex;
+static ManagedStatic<std::vector<FastISelListener *> > Listeners;
+
+void llvm::addFastISelListener(FastISelListener *L) {
+  sys::SmartScopedLock<true> Lock(*ListenersMutex);
+  Listeners->push_back(L);
+}
+
+void llvm::removeFastISelListener(FastISelListener *L) {
+  sys::SmartScopedLock<true> Lock(*ListenersMutex);
+  Listeners->erase(std::remove(Listeners->begin(), Listeners->end(), L),
+                   Listeners->end());
+}
+
+FastISelFallbackTimer::FastISelFallbackTimer(const Function &F,
+                                             const Instruction *Inst)
+  : F(F), Inst(Inst), Active(false) {
+  if (!Listeners.isConstructed() || Listeners->empty())
+    return;
+  Active = true;
+  Start = TimeRecord::getCurrentTime(true);
+}
+
+void FastISelFallbackTimer::fallbackDone(unsigned NumInstructions) {
+  if (!Active)
+    return;
+
+  FastISelMissInfo Info;
+  Info.Time = TimeRecord::getCurrentTime(false);
+  Info.Time -= Start;
+  Info.F = &F;
+  Info.Inst = Inst;
+  Info.NumInstructions = NumInstructions;
+
+  std::vector<FastISelListener *> &Ls = *Listeners;
+  for (unsigned i = 0, e = Ls.size(); i != e; ++i)
+    Ls[i]->fastISelMissed(Info);
+}
+
+//===----------------------------------------------------------------------===//
+// FastISelMissCounter implementation
+
+std::string FastISelMissCounter::getMissKind(const Instruction *I) {
+  if (!I)
+    return "arguments";
+  if (const IntrinsicInst *II = dyn_cast<IntrinsicInst>(I))
+    return Intrinsic::getName(II->getIntrinsicID());
+
+  std::string Kind = I->getOpcodeName();
+  if (I->getType()->isVectorTy() ||
+      (I->getNumOperands() > 0 && I->getOperand(0)->getType()->isVectorTy()))
+    Kind += " (vector)";
+  return Kind;
+}
+
+void FastISelMissCounter::fastISelMissed(const FastISelMissInfo &Info) {
+  std::string Kind = getMissKind(Info.Inst);
+  sys::SmartScopedLock<true> Guard(Lock);
+  Entry &E = Entries[Kind];
+  ++E.Count;
+  E.NumInstructions += Info.NumInstructions;
+  E.Time += Info.Time;
+}
+
+FastISelMissCounter::Entry FastISelMissCounter::lookup(StringRef Kind) const {
+  sys::SmartScopedLock<true> Guard(Lock);
+  return Entries.lookup(Kind);
+}
+
+namespace {
+typedef std::pair<std::string, FastISelMissCounter::Entry> KindEntry;
+
+struct CostsMore {
+  bool operator()(const KindEntry &LHS, const KindEntry &RHS) const {
+    if (LHS.second.Time.getWallTime() != RHS.second.Time.getWallTime())
+      return RHS.second.Time < LHS.second.Time;
+    return LHS.first < RHS.first;
+  }
+};
+}
+
+void FastISelMissCounter::print(raw_ostream &OS) const {
+  std::vector<KindEntry> Sorted;
+  {
+    sys::SmartScopedLock<true> Guard(Lock);
+    for (StringMap<Entry>::const_iterator I = Entries.begin(),
+                                          E = Entries.end();
+         I != E; ++I)
+      Sorted.push_back(KindEntry(I->getKey(), I->getValue()));
+  }
+  std::sort(Sorted.begin(), Sorted.end(), CostsMore());
+
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                         FastISel misses by kind\n"
+     << "===" << std::string(73, '-') << "===\n"
+     << "   --Wall Time--   Misses  Fallback Insts  Kind\n";
+  for (unsigned i = 0, e = Sorted.size(); i != e; ++i) {
+    const Entry &E = Sorted[i].second;
+    OS << format("  %14.4f  %7u  %14u  ", E.Time.getWallTime(), E.Count,
+                 E.NumInstructions)
+       << Sorted[i].first << '\n';
+  }
+}
+
+void FastISelMissCounter::clear() {
+  sys::SmartScopedLock<true> Guard(Lock);
+  Entries.clear();
+}
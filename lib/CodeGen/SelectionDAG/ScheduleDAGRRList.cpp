@@ -1532,6 +1532,12 @@ class RegReductionPQBase;
 
 struct queue_sort : public std::binary_function<SUnit*, SUnit*, bool> {
   bool isReady(SUnit* SU, unsigned CurCycle) const { return true; }
+
+  /// getStableKey - Sorts that set HasStableKey return a key here that
+  /// orders nodes the way the first comparisons of the sort do: a node with a
+  /// larger key is always preferred.  The key only depends on the node, so
+  /// the queue can keep its nodes in a heap ordered by it.
+  uint64_t getStableKey(const SUnit *SU) const { return 0; }
 };
 
 #ifndef NDEBUG
@@ -1554,7 +1560,8 @@ struct reverse_sort : public queue_sort {
 struct bu_ls_rr_sort : public queue_sort {
   enum {
     IsBottomUp = true,
-    HasReadyFilter = false
+    HasReadyFilter = false,
+    HasStableKey = false
   };
 
   RegReductionPQBase *SPQ;
@@ -1568,7 +1575,8 @@ struct bu_ls_rr_sort : public queue_sort {
 struct src_ls_rr_sort : public queue_sort {
   enum {
     IsBottomUp = true,
-    HasReadyFilter = false
+    HasReadyFilter = false,
+    HasStableKey = true
   };
 
   RegReductionPQBase *SPQ;
@@ -1577,6 +1585,8 @@ struct src_ls_rr_sort : public queue_sort {
   src_ls_rr_sort(const src_ls_rr_sort &RHS)
     : SPQ(RHS.SPQ) {}
 
+  uint64_t getStableKey(const SUnit *SU) const;
+
   bool operator()(SUnit* left, SUnit* right) const;
 };
 
@@ -1584,7 +1594,8 @@ struct src_ls_rr_sort : public queue_sort {
 struct hybrid_ls_rr_sort : public queue_sort {
   enum {
     IsBottomUp = true,
-    HasReadyFilter = false
+    HasReadyFilter = false,
+    HasStableKey = false
   };
 
   RegReductionPQBase *SPQ;
@@ -1603,7 +1614,8 @@ struct hybrid_ls_rr_sort : public queue_sort {
 struct ilp_ls_rr_sort : public queue_sort {
   enum {
     IsBottomUp = true,
-    HasReadyFilter = false
+    HasReadyFilter = false,
+    HasStableKey = false
   };
 
   RegReductionPQBase *SPQ;
@@ -1761,6 +1773,55 @@ SUnit *popFromQueue(std::vector<SUnit*> &Q, SF &Picker, ScheduleDAG *DAG) {
   return popFromQueueImpl(Q, Picker);
 }
 
+template<class SF>
+struct StableKeyLess {
+  const SF *Picker;
+  StableKeyLess(const SF &Picker) : Picker(&Picker) {}
+
+  bool operator()(const SUnit *left, const SUnit *right) const {
+    return Picker->getStableKey(left) < Picker->getStableKey(right);
+  }
+};
+
+/// popFromKeyedQueue - Pop the best node from Q, which is a heap ordered by
+/// the stable key of Picker.  Only the nodes with the largest key compete, so
+/// wide DAGs with many ready nodes do not have to compare all of them.
+template<class SF>
+SUnit *popFromKeyedQueue(std::vector<SUnit*> &Q, SF &Picker,
+                         ScheduleDAG *DAG) {
+  StableKeyLess<SF> Less(Picker);
+#ifndef NDEBUG
+  if (DAG->StressSched) {
+    SUnit *V = popFromQueue(Q, Picker, DAG);
+    std::make_heap(Q.begin(), Q.end(), Less);
+    return V;
+  }
+#endif
+
+  // Move the nodes with the largest key out of the heap, to the end of Q.
+  uint64_t TopKey = Picker.getStableKey(Q.front());
+  std::vector<SUnit *>::iterator HeapEnd = Q.end();
+  do {
+    std::pop_heap(Q.begin(), HeapEnd, Less);
+    --HeapEnd;
+  } while (HeapEnd != Q.begin() && Picker.getStableKey(Q.front()) == TopKey);
+
+  std::vector<SUnit *>::iterator Best = HeapEnd;
+  for (std::vector<SUnit *>::iterator I = llvm::next(HeapEnd), E = Q.end();
+       I != E; ++I)
+    if (Picker(*Best, *I))
+      Best = I;
+  SUnit *V = *Best;
+  if (Best != prior(Q.end()))
+    std::swap(*Best, Q.back());
+  Q.pop_back();
+
+  // Put the other candidates back.
+  for (std::vector<SUnit *>::iterator I = HeapEnd; I != Q.end(); )
+    std::push_heap(Q.begin(), ++I, Less);
+  return V;
+}
+
 template<class SF>
 class RegReductionPriorityQueue : public RegReductionPQBase {
   SF Picker;
@@ -1782,10 +1843,24 @@ public:
     return Picker.HasReadyFilter && Picker.isReady(U, getCurCycle());
   }
 
+  void push(SUnit *U) {
+    RegReductionPQBase::push(U);
+    if (SF::HasStableKey)
+      std::push_heap(Queue.begin(), Queue.end(), StableKeyLess<SF>(Picker));
+  }
+
+  void remove(SUnit *SU) {
+    RegReductionPQBase::remove(SU);
+    if (SF::HasStableKey)
+      std::make_heap(Queue.begin(), Queue.end(), StableKeyLess<SF>(Picker));
+  }
+
   SUnit *pop() {
     if (Queue.empty()) return NULL;
 
-    SUnit *V = popFromQueue(Queue, Picker, scheduleDAG);
+    SUnit *V = SF::HasStableKey ?
+      popFromKeyedQueue(Queue, Picker, scheduleDAG) :
+      popFromQueue(Queue, Picker, scheduleDAG);
     V->NodeQueueId = 0;
     return V;
   }
@@ -2502,6 +2577,14 @@ bool bu_ls_rr_sort::operator()(SUnit *left, SUnit *right) const {
   return BURRSort(left, right, SPQ);
 }
 
+// The source order comparison of operator(): nodes that are scheduled low
+// first, then nodes without an order, then the later nodes in source order.
+uint64_t src_ls_rr_sort::getStableKey(const SUnit *SU) const {
+  uint64_t Order = SPQ->getNodeOrdering(SU);
+  return (uint64_t)SU->isScheduleLow << 33 | (uint64_t)(Order == 0) << 32 |
+         Order;
+}
+
 // Source order, otherwise bottom up.
 bool src_ls_rr_sort::operator()(SUnit *left, SUnit *right) const {
   if (int res = checkSpecialNodes(left, right))
@@ -1049,7 +1049,7 @@ SDValue SelectionDAG::getConstant(const ConstantInt &Val, EVT VT, bool isT) {
 
   if (!N) {
     N = new (NodeAllocator) ConstantSDNode(isT, Elt, EltVT);
-    CSEMap.InsertNode(N, IP);
+    CSEMap.InsertNode(N, IP, ID);
     AllNodes.push_back(N);
   }
 
@@ -1091,7 +1091,7 @@ SDValue SelectionDAG::getConstantFP(const ConstantFP& V, EVT VT, bool isTarget){
 
   if (!N) {
     N = new (NodeAllocator) ConstantFPSDNode(isTarget, &V, EltVT);
-    CSEMap.InsertNode(N, IP);
+    CSEMap.InsertNode(N, IP, ID);
     AllNodes.push_back(N);
   }
 
@@ -1161,7 +1161,7 @@ SDValue SelectionDAG::getGlobalAddress(const GlobalValue *GV, SDLoc DL,
   SDNode *N = new (NodeAllocator) GlobalAddressSDNode(Opc, DL.getIROrder(),
                                                       DL.getDebugLoc(), GV, VT,
                                                       Offset, TargetFlags);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1176,7 +1176,7 @@ SDValue SelectionDAG::getFrameIndex(int FI, EVT VT, bool isTarget) {
     return SDValue(E, 0);
 
   SDNode *N = new (NodeAllocator) FrameIndexSDNode(FI, VT, isTarget);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1196,7 +1196,7 @@ SDValue SelectionDAG::getJumpTable(int JTI, EVT VT, bool isTarget,
 
   SDNode *N = new (NodeAllocator) JumpTableSDNode(JTI, VT, isTarget,
                                                   TargetFlags);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1223,7 +1223,7 @@ SDValue SelectionDAG::getConstantPool(const Constant *C, EVT VT,
 
   SDNode *N = new (NodeAllocator) ConstantPoolSDNode(isTarget, C, VT, Offset,
                                                      Alignment, TargetFlags);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1251,7 +1251,7 @@ SDValue SelectionDAG::getConstantPool(MachineConstantPoolValue *C, EVT VT,
 
   SDNode *N = new (NodeAllocator) ConstantPoolSDNode(isTarget, C, VT, Offset,
                                                      Alignment, TargetFlags);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1269,7 +1269,7 @@ SDValue SelectionDAG::getTargetIndex(int Index, EVT VT, int64_t Offset,
 
   SDNode *N = new (NodeAllocator) TargetIndexSDNode(Index, VT, Offset,
                                                     TargetFlags);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1283,7 +1283,7 @@ SDValue SelectionDAG::getBasicBlock(MachineBasicBlock *MBB) {
     return SDValue(E, 0);
 
   SDNode *N = new (NodeAllocator) BasicBlockSDNode(MBB);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1428,7 +1428,7 @@ SDValue SelectionDAG::getVectorShuffle(EVT VT, SDLoc dl, SDValue N1,
     new (NodeAllocator) ShuffleVectorSDNode(VT, dl.getIROrder(),
                                             dl.getDebugLoc(), N1, N2,
                                             MaskAlloc);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1453,7 +1453,7 @@ SDValue SelectionDAG::getConvertRndSat(EVT VT, SDLoc dl,
   CvtRndSatSDNode *N = new (NodeAllocator) CvtRndSatSDNode(VT, dl.getIROrder(),
                                                            dl.getDebugLoc(),
                                                            Ops, 5, Code);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1467,7 +1467,7 @@ SDValue SelectionDAG::getRegister(unsigned RegNo, EVT VT) {
     return SDValue(E, 0);
 
   SDNode *N = new (NodeAllocator) RegisterSDNode(RegNo, VT);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1481,7 +1481,7 @@ SDValue SelectionDAG::getRegisterMask(const uint32_t *RegMask) {
     return SDValue(E, 0);
 
   SDNode *N = new (NodeAllocator) RegisterMaskSDNode(RegMask);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1497,7 +1497,7 @@ SDValue SelectionDAG::getEHLabel(SDLoc dl, SDValue Root, MCSymbol *Label) {
 
   SDNode *N = new (NodeAllocator) EHLabelSDNode(dl.getIROrder(),
                                                 dl.getDebugLoc(), Root, Label);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1520,7 +1520,7 @@ SDValue SelectionDAG::getBlockAddress(const BlockAddress *BA, EVT VT,
 
   SDNode *N = new (NodeAllocator) BlockAddressSDNode(Opc, VT, BA, Offset,
                                                      TargetFlags);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1538,7 +1538,7 @@ SDValue SelectionDAG::getSrcValue(const Value *V) {
     return SDValue(E, 0);
 
   SDNode *N = new (NodeAllocator) SrcValueSDNode(V);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1554,7 +1554,7 @@ SDValue SelectionDAG::getMDNode(const MDNode *MD) {
     return SDValue(E, 0);
 
   SDNode *N = new (NodeAllocator) MDNodeSDNode(MD);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -1575,7 +1575,7 @@ SDValue SelectionDAG::getAddrSpaceCast(SDLoc dl, EVT VT, SDValue Ptr,
   SDNode *N = new (NodeAllocator) AddrSpaceCastSDNode(dl.getIROrder(),
                                                       dl.getDebugLoc(),
                                                       VT, Ptr, SrcAS, DestAS);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -2491,7 +2491,7 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, EVT VT) {
 
   SDNode *N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(),
                                          DL.getDebugLoc(), getVTList(VT));
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
 
   AllNodes.push_back(N);
 #ifndef NDEBUG
@@ -2753,7 +2753,7 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL,
 
     N = new (NodeAllocator) UnarySDNode(Opcode, DL.getIROrder(),
                                         DL.getDebugLoc(), VTs, Operand);
-    CSEMap.InsertNode(N, IP);
+    CSEMap.InsertNode(N, IP, ID);
   } else {
     N = new (NodeAllocator) UnarySDNode(Opcode, DL.getIROrder(),
                                         DL.getDebugLoc(), VTs, Operand);
@@ -3328,7 +3328,7 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, EVT VT, SDValue N1,
 
     N = new (NodeAllocator) BinarySDNode(Opcode, DL.getIROrder(),
                                          DL.getDebugLoc(), VTs, N1, N2);
-    CSEMap.InsertNode(N, IP);
+    CSEMap.InsertNode(N, IP, ID);
   } else {
     N = new (NodeAllocator) BinarySDNode(Opcode, DL.getIROrder(),
                                          DL.getDebugLoc(), VTs, N1, N2);
@@ -3435,7 +3435,7 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, EVT VT,
 
     N = new (NodeAllocator) TernarySDNode(Opcode, DL.getIROrder(),
                                           DL.getDebugLoc(), VTs, N1, N2, N3);
-    CSEMap.InsertNode(N, IP);
+    CSEMap.InsertNode(N, IP, ID);
   } else {
     N = new (NodeAllocator) TernarySDNode(Opcode, DL.getIROrder(),
                                           DL.getDebugLoc(), VTs, N1, N2, N3);
@@ -4207,7 +4207,7 @@ SDValue SelectionDAG::getAtomic(unsigned Opcode, SDLoc dl, EVT MemVT,
                                                dl.getDebugLoc(), VTList, MemVT,
                                                Ops, DynOps, NumOps, MMO,
                                                Ordering, SynchScope);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -4436,7 +4436,7 @@ SelectionDAG::getMemIntrinsicNode(unsigned Opcode, SDLoc dl, SDVTList VTList,
     N = new (NodeAllocator) MemIntrinsicSDNode(Opcode, dl.getIROrder(),
                                                dl.getDebugLoc(), VTList, Ops,
                                                NumOps, MemVT, MMO);
-    CSEMap.InsertNode(N, IP);
+    CSEMap.InsertNode(N, IP, ID);
   } else {
     N = new (NodeAllocator) MemIntrinsicSDNode(Opcode, dl.getIROrder(),
                                                dl.getDebugLoc(), VTList, Ops,
@@ -4557,7 +4557,7 @@ SelectionDAG::getLoad(ISD::MemIndexedMode AM, ISD::LoadExtType ExtType,
   SDNode *N = new (NodeAllocator) LoadSDNode(Ops, dl.getIROrder(),
                                              dl.getDebugLoc(), VTs, AM, ExtType,
                                              MemVT, MMO);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -4664,7 +4664,7 @@ SDValue SelectionDAG::getStore(SDValue Chain, SDLoc dl, SDValue Val,
   SDNode *N = new (NodeAllocator) StoreSDNode(Ops, dl.getIROrder(),
                                               dl.getDebugLoc(), VTs,
                                               ISD::UNINDEXED, false, VT, MMO);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -4733,7 +4733,7 @@ SDValue SelectionDAG::getTruncStore(SDValue Chain, SDLoc dl, SDValue Val,
   SDNode *N = new (NodeAllocator) StoreSDNode(Ops, dl.getIROrder(),
                                               dl.getDebugLoc(), VTs,
                                               ISD::UNINDEXED, true, SVT, MMO);
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -4760,7 +4760,7 @@ SelectionDAG::getIndexedStore(SDValue OrigStore, SDLoc dl, SDValue Base,
                                               ST->isTruncatingStore(),
                                               ST->getMemoryVT(),
                                               ST->getMemOperand());
-  CSEMap.InsertNode(N, IP);
+  CSEMap.InsertNode(N, IP, ID);
   AllNodes.push_back(N);
   return SDValue(N, 0);
 }
@@ -4833,7 +4833,7 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, EVT VT,
 
     N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(),
                                    VTs, Ops, NumOps);
-    CSEMap.InsertNode(N, IP);
+    CSEMap.InsertNode(N, IP, ID);
   } else {
     N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(),
                                    VTs, Ops, NumOps);
@@ -4913,7 +4913,7 @@ SDValue SelectionDAG::getNode(unsigned Opcode, SDLoc DL, SDVTList VTList,
       N = new (NodeAllocator) SDNode(Opcode, DL.getIROrder(), DL.getDebugLoc(),
                                      VTList, Ops, NumOps);
     }
-    CSEMap.InsertNode(N, IP);
+    CSEMap.InsertNode(N, IP, ID);
   } else {
     if (NumOps == 1) {
       N = new (NodeAllocator) UnarySDNode(Opcode, DL.getIROrder(),
@@ -5533,8 +5533,8 @@ SelectionDAG::getMachineNode(unsigned Opcode, SDLoc DL, SDVTList VTs,
   const SDValue *Ops = OpsArray.data();
   unsigned NumOps = OpsArray.size();
 
+  FoldingSetNodeID ID;
   if (DoCSE) {
-    FoldingSetNodeID ID;
     AddNodeIDNode(ID, ~Opcode, VTs, Ops, NumOps);
     IP = 0;
     if (SDNode *E = CSEMap.FindNodeOrInsertPos(ID, IP)) {
@@ -5558,7 +5558,7 @@ SelectionDAG::getMachineNode(unsigned Opcode, SDLoc DL, SDVTList VTs,
   N->OperandsNeedDelete = false;
 
   if (DoCSE)
-    CSEMap.InsertNode(N, IP);
+    CSEMap.InsertNode(N, IP, ID);
 
   AllNodes.push_back(N);
 #ifndef NDEBUG
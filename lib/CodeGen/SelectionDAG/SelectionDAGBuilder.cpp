@@ -73,6 +73,12 @@ LimitFPPrecision("limit-float-precision",
                  cl::location(LimitFloatPrecision),
                  cl::init(0));
 
+static cl::opt<unsigned>
+SwitchPeelThreshold("switch-peel-threshold", cl::Hidden, cl::init(66),
+                    cl::desc("Test a switch case ahead of the rest of the "
+                             "switch if it takes at least this percentage "
+                             "of the executions (0 = never)"));
+
 // Limit the width of DAG chains. This is important in general to prevent
 // prevent DAG-based analysis from blowing up. For example, alias analysis and
 // load clustering may not complete in reasonable time. It is difficult to
@@ -2368,16 +2374,36 @@ bool SelectionDAGBuilder::handleBTSplitSwitchCase(CaseRec& CR,
     RSize -= J->size();
   }
 
+  // Without jump tables to make room for, split the cases into halves of
+  // equal weight, or of equal number if there are no weights, so that the
+  // likely cases take fewer compares.
+  uint64_t TotalWeight = 0;
+  for (CaseItr I = CR.Range.first, E = CR.Range.second; I != E; ++I)
+    TotalWeight += I->ExtraWeight;
+
   const TargetLowering *TLI = TM.getTargetLowering();
   if (areJTsAllowed(*TLI)) {
     // If our case is dense we *really* should handle it earlier!
     assert((FMetric > 0) && "Should handle dense range earlier!");
+  } else if (TotalWeight) {
+    uint64_t LWeight = CR.Range.first->ExtraWeight;
+    Pivot = CR.Range.first + 1;
+    while (Pivot + 1 != CR.Range.second &&
+           (LWeight + Pivot->ExtraWeight) * 2 <= TotalWeight)
+      LWeight += (Pivot++)->ExtraWeight;
   } else {
     Pivot = CR.Range.first + Size/2;
   }
 
   CaseRange LHSR(CR.Range.first, Pivot);
   CaseRange RHSR(Pivot, CR.Range.second);
+
+  // Weigh each side of the compare by its cases, scaled to fit in 32 bits.
+  uint64_t LHSWeight = 0;
+  for (CaseItr I = LHSR.first, E = LHSR.second; I != E; ++I)
+    LHSWeight += I->ExtraWeight;
+  uint64_t RHSWeight = TotalWeight - LHSWeight;
+  uint64_t WeightScale = std::max(LHSWeight, RHSWeight) / UINT32_MAX + 1;
   const Constant *C = Pivot->Low;
   MachineBasicBlock *FalseBB = 0, *TrueBB = 0;
 
@@ -2421,7 +2447,8 @@ bool SelectionDAGBuilder::handleBTSplitSwitchCase(CaseRec& CR,
   // Create a CaseBlock record representing a conditional branch to
   // the LHS node if the value being switched on SV is less than C.
   // Otherwise, branch to LHS.
-  CaseBlock CB(ISD::SETLT, SV, C, NULL, TrueBB, FalseBB, CR.CaseBB);
+  CaseBlock CB(ISD::SETLT, SV, C, NULL, TrueBB, FalseBB, CR.CaseBB,
+               LHSWeight / WeightScale, RHSWeight / WeightScale);
 
   if (CR.CaseBB == SwitchBB)
     visitSwitchCase(CB, SwitchBB);
@@ -2617,6 +2644,74 @@ size_t SelectionDAGBuilder::Clusterify(CaseVector& Cases,
   return numCmps;
 }
 
+/// peelHotSwitchCases - Test the cases of SI that take most of its executions
+/// one at a time, hottest first, ahead of the rest of the switch.  A compare
+/// and branch which nearly always goes the same way is predicted well, while
+/// the jump table or the search tree that the case would otherwise be part of
+/// costs an indirect jump or several branches.  The peeled cases are removed
+/// from Cases.  Returns the block in which to lower the remaining cases.
+MachineBasicBlock *
+SelectionDAGBuilder::peelHotSwitchCases(CaseVector &Cases, const SwitchInst &SI,
+                                        MachineBasicBlock *Default) {
+  MachineBasicBlock *SwitchMBB = FuncInfo.MBB;
+  BranchProbabilityInfo *BPI = FuncInfo.BPI;
+  if (!BPI || !SwitchPeelThreshold)
+    return SwitchMBB;
+
+  // The default destination is the first successor in IR.
+  uint64_t TotalWeight = BPI->getEdgeWeight(SI.getParent(), (unsigned)0);
+  for (CaseItr I = Cases.begin(), E = Cases.end(); I != E; ++I)
+    TotalWeight += I->ExtraWeight;
+
+  const Value *SV = SI.getCondition();
+  MachineFunction::iterator BBI = SwitchMBB;
+  ++BBI;
+  MachineBasicBlock *CurMBB = SwitchMBB;
+  // A few cases are tested in order of weight anyway.
+  while (Cases.size() > 3 && TotalWeight) {
+    CaseItr Hottest = Cases.begin();
+    for (CaseItr I = llvm::next(Cases.begin()), E = Cases.end(); I != E; ++I)
+      if (I->ExtraWeight > Hottest->ExtraWeight)
+        Hottest = I;
+    uint64_t HotWeight = Hottest->ExtraWeight;
+    if (HotWeight * 100 < TotalWeight * SwitchPeelThreshold)
+      break;
+
+    DEBUG(dbgs() << "Peeling switch case " << *Hottest->Low << " with weight "
+                 << HotWeight << " of " << TotalWeight << '\n');
+
+    MachineBasicBlock *RestMBB =
+      FuncInfo.MF->CreateMachineBasicBlock(SwitchMBB->getBasicBlock());
+    FuncInfo.MF->insert(BBI, RestMBB);
+
+    // Put SV in a virtual register to make it available from the new blocks.
+    ExportFromCurrentBlock(SV);
+
+    const Value *RHS, *LHS, *MHS;
+    ISD::CondCode CC;
+    if (Hottest->Low == Hottest->High) {
+      CC = ISD::SETEQ;
+      LHS = SV; RHS = Hottest->High; MHS = NULL;
+    } else {
+      CC = ISD::SETLE;
+      LHS = Hottest->Low; MHS = SV; RHS = Hottest->High;
+    }
+
+    TotalWeight -= HotWeight;
+    uint64_t Scale = std::max(HotWeight, TotalWeight) / UINT32_MAX + 1;
+    CaseBlock CB(CC, LHS, RHS, MHS, Hottest->BB, RestMBB, CurMBB,
+                 HotWeight / Scale, TotalWeight / Scale);
+    if (CurMBB == SwitchMBB)
+      visitSwitchCase(CB, SwitchMBB);
+    else
+      SwitchCases.push_back(CB);
+
+    Cases.erase(Hottest);
+    CurMBB = RestMBB;
+  }
+  return CurMBB;
+}
+
 void SelectionDAGBuilder::UpdateSplitBlock(MachineBasicBlock *First,
                                            MachineBasicBlock *Last) {
   // Update JTCases.
@@ -2666,9 +2761,12 @@ void SelectionDAGBuilder::visitSwitch(const SwitchInst &SI) {
   // search tree.
   const Value *SV = SI.getCondition();
 
+  // Branch to the hottest cases first if the profile is skewed enough.
+  MachineBasicBlock *CaseMBB = peelHotSwitchCases(Cases, SI, Default);
+
   // Push the initial CaseRec onto the worklist
   CaseRecVector WorkList;
-  WorkList.push_back(CaseRec(SwitchMBB,0,0,
+  WorkList.push_back(CaseRec(CaseMBB,0,0,
                              CaseRange(Cases.begin(),Cases.end())));
 
   while (!WorkList.empty()) {
@@ -3769,6 +3867,49 @@ void SelectionDAGBuilder::visitTargetIntrinsic(const CallInst &I,
   }
 }
 
+/// visitGather - Lower a call to llvm.gather.  Targets with a gather
+/// instruction for the types get it as an INTRINSIC_W_CHAIN node, everything
+/// else is split into one load per element.
+void SelectionDAGBuilder::visitGather(const CallInst &I) {
+  const TargetLowering *TLI = TM.getTargetLowering();
+  EVT VT = TLI->getValueType(I.getType());
+  EVT IdxVT = TLI->getValueType(I.getArgOperand(1)->getType());
+  if (TLI->isLegalGather(VT, IdxVT)) {
+    visitTargetIntrinsic(I, Intrinsic::gather);
+    return;
+  }
+
+  SDLoc sdl = getCurSDLoc();
+  SDValue Base = getValue(I.getArgOperand(0));
+  SDValue Indices = getValue(I.getArgOperand(1));
+  EVT PtrVT = Base.getValueType();
+  Type *EltTy = I.getType()->getVectorElementType();
+  EVT EltVT = VT.getVectorElementType();
+  SDValue EltSize = DAG.getConstant(EltVT.getStoreSize(), PtrVT);
+  unsigned Align = TLI->getDataLayout()->getABITypeAlignment(EltTy);
+
+  // The loads only need to be ordered against stores, like any other load.
+  SDValue Root = DAG.getRoot();
+  SmallVector<SDValue, 16> Elts;
+  SmallVector<SDValue, 16> Chains;
+  for (unsigned i = 0, e = VT.getVectorNumElements(); i != e; ++i) {
+    SDValue Idx = DAG.getNode(ISD::EXTRACT_VECTOR_ELT, sdl,
+                              IdxVT.getVectorElementType(), Indices,
+                              DAG.getConstant(i, TLI->getVectorIdxTy()));
+    Idx = DAG.getSExtOrTrunc(Idx, sdl, PtrVT);
+    SDValue Ptr = DAG.getNode(ISD::ADD, sdl, PtrVT, Base,
+                              DAG.getNode(ISD::MUL, sdl, PtrVT, Idx, EltSize));
+    SDValue Elt = DAG.getLoad(EltVT, sdl, Root, Ptr, MachinePointerInfo(),
+                              false, false, false, Align);
+    Elts.push_back(Elt);
+    Chains.push_back(Elt.getValue(1));
+  }
+
+  PendingLoads.push_back(DAG.getNode(ISD::TokenFactor, sdl, MVT::Other,
+                                     &Chains[0], Chains.size()));
+  setValue(&I, DAG.getNode(ISD::BUILD_VECTOR, sdl, VT, &Elts[0], Elts.size()));
+}
+
 /// GetSignificand - Get the significand and build it into a floating-point
 /// number with exponent of 1:
 ///
@@ -5157,6 +5298,9 @@ SelectionDAGBuilder::visitIntrinsicCall(const CallInst &I, unsigned Intrinsic) {
     setValue(&I, Res);
     return 0;
   }
+  case Intrinsic::gather:
+    visitGather(I);
+    return 0;
   case Intrinsic::annotation:
   case Intrinsic::ptr_annotation:
     // Drop the intrinsic, but forward the value
@@ -6781,6 +6925,32 @@ SelectionDAGBuilder::LowerCallOperands(const CallInst &CI, unsigned ArgIdx,
   return TLI->LowerCallTo(CLI);
 }
 
+/// \brief Add the live variables of a stackmap or patchpoint, starting at
+/// operand \p StartIdx of \p CI, to \p Ops.  Constants are recorded as such
+/// and static allocas as the address of their frame object, instead of being
+/// materialized in registers.
+void SelectionDAGBuilder::addStackMapLiveVars(const CallInst &CI,
+                                              unsigned StartIdx,
+                                              SmallVectorImpl<SDValue> &Ops) {
+  for (unsigned i = StartIdx, e = CI.getNumArgOperands(); i != e; ++i) {
+    SDValue OpVal = getValue(CI.getArgOperand(i));
+    if (ConstantSDNode *C = dyn_cast<ConstantSDNode>(OpVal)) {
+      Ops.push_back(
+        DAG.getTargetConstant(StackMaps::ConstantOp, MVT::i64));
+      Ops.push_back(
+        DAG.getTargetConstant(C->getSExtValue(), MVT::i64));
+    } else if (FrameIndexSDNode *FI = dyn_cast<FrameIndexSDNode>(OpVal)) {
+      const TargetLowering *TLI = TM.getTargetLowering();
+      Ops.push_back(
+        DAG.getTargetConstant(StackMaps::DirectMemRefOp, MVT::i64));
+      Ops.push_back(
+        DAG.getTargetFrameIndex(FI->getIndex(), TLI->getPointerTy()));
+      Ops.push_back(DAG.getTargetConstant(0, MVT::i64));
+    } else
+      Ops.push_back(OpVal);
+  }
+}
+
 /// \brief Lower llvm.experimental.stackmap directly to its target opcode.
 void SelectionDAGBuilder::visitStackmap(const CallInst &CI) {
   // void @llvm.experimental.stackmap(i32 <id>, i32 <numShadowBytes>,
@@ -6814,8 +6984,7 @@ void SelectionDAGBuilder::visitStackmap(const CallInst &CI) {
         cast<ConstantSDNode>(tmp)->getZExtValue(), MVT::i32));
   }
   // Push live variables for the stack map.
-  for (unsigned i = 2, e = CI.getNumArgOperands(); i != e; ++i)
-    Ops.push_back(getValue(CI.getArgOperand(i)));
+  addStackMapLiveVars(CI, 2, Ops);
 
   // Push the chain (this is originally the first operand of the call, but
   // becomes now the last or second to last operand).
@@ -6918,16 +7087,7 @@ void SelectionDAGBuilder::visitPatchpoint(const CallInst &CI) {
     Ops.push_back(*i);
 
   // Push live variables for the stack map.
-  for (unsigned i = NumArgs + 4, e = CI.getNumArgOperands(); i != e; ++i) {
-    SDValue OpVal = getValue(CI.getArgOperand(i));
-    if (ConstantSDNode *C = dyn_cast<ConstantSDNode>(OpVal)) {
-      Ops.push_back(
-        DAG.getTargetConstant(StackMaps::ConstantOp, MVT::i64));
-      Ops.push_back(
-        DAG.getTargetConstant(C->getSExtValue(), MVT::i64));
-    } else
-      Ops.push_back(OpVal);
-  }
+  addStackMapLiveVars(CI, NumArgs + 4, Ops);
 
   // Push the register mask info.
   if (hasGlue)
@@ -7195,10 +7355,11 @@ SelectionDAGBuilder::CopyValueToVirtualRegister(const Value *V, unsigned Reg) {
 /// isOnlyUsedInEntryBlock - If the specified argument is only used in the
 /// entry block, return true.  This includes arguments used by switches, since
 /// the switch may expand into multiple basic blocks.
-static bool isOnlyUsedInEntryBlock(const Argument *A, bool FastISel) {
-  // With FastISel active, we may be splitting blocks, so force creation
-  // of virtual registers for all non-dead arguments.
-  if (FastISel)
+static bool isOnlyUsedInEntryBlock(const Argument *A, bool SplitEntry) {
+  // With FastISel active, or if the entry block is too big for one DAG, we
+  // may be splitting blocks, so force creation of virtual registers for all
+  // non-dead arguments.
+  if (SplitEntry)
     return A->use_empty();
 
   const BasicBlock *Entry = A->getParent()->begin();
@@ -7413,7 +7574,8 @@ void SelectionDAGISel::LowerArguments(const Function &F) {
         continue;
       }
     }
-    if (!isOnlyUsedInEntryBlock(I, TM.Options.EnableFastISel)) {
+    if (!isOnlyUsedInEntryBlock(I, TM.Options.EnableFastISel ||
+                                       isSplitIntoDAGRegions(&F.front()))) {
       FuncInfo->InitializeRegForValue(I);
       SDB->CopyToExportRegsIfNeeded(I);
     }
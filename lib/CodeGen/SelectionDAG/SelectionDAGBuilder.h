@@ -625,6 +625,8 @@ public:
                                                 unsigned NumArgs,
                                                 SDValue Callee,
                                                 bool useVoidTy = false);
+  void addStackMapLiveVars(const CallInst &CI, unsigned StartIdx,
+                           SmallVectorImpl<SDValue> &Ops);
 
   /// UpdateSplitBlock - When an MBB was split during scheduling, update the
   /// references that ned to refer to the last resulting block.
@@ -659,6 +661,9 @@ private:
                                 const Value* SV,
                                 MachineBasicBlock* Default,
                                 MachineBasicBlock *SwitchBB);
+  MachineBasicBlock *peelHotSwitchCases(CaseVector &Cases,
+                                        const SwitchInst &SI,
+                                        MachineBasicBlock *Default);
 
   uint32_t getEdgeWeight(const MachineBasicBlock *Src,
                          const MachineBasicBlock *Dst) const;
@@ -755,6 +760,7 @@ private:
   void visitInlineAsm(ImmutableCallSite CS);
   const char *visitIntrinsicCall(const CallInst &I, unsigned Intrinsic);
   void visitTargetIntrinsic(const CallInst &I, unsigned Intrinsic);
+  void visitGather(const CallInst &I);
 
   void visitVAStart(const CallInst &I);
   void visitVAArg(const VAArgInst &I);
@@ -22,6 +22,7 @@
 #include "llvm/Analysis/CFG.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/CodeGen/FastISel.h"
+#include "llvm/CodeGen/FastISelListener.h"
 #include "llvm/CodeGen/FunctionLoweringInfo.h"
 #include "llvm/CodeGen/GCMetadata.h"
 #include "llvm/CodeGen/GCStrategy.h"
@@ -63,6 +64,7 @@ STATISTIC(NumFastIselFailures, "Number of instructions fast isel failed on");
 STATISTIC(NumFastIselSuccess, "Number of instructions fast isel selected");
 STATISTIC(NumFastIselBlocks, "Number of blocks selected entirely by fast isel");
 STATISTIC(NumDAGBlocks, "Number of blocks selected using DAG");
+STATISTIC(NumDAGRegions, "Number of extra DAGs built for oversized blocks");
 STATISTIC(NumDAGIselRetries,"Number of times dag isel has to try another path");
 STATISTIC(NumEntryBlocks, "Number of entry blocks encountered");
 STATISTIC(NumFastIselFailLowerArguments,
@@ -156,6 +158,11 @@ EnableFastISelAbortArgs("fast-isel-abort-args", cl::Hidden,
           cl::desc("Enable abort calls when \"fast\" instruction selection "
                    "fails to lower a formal argument"));
 
+static cl::opt<unsigned>
+MaxDAGRegionSize("max-dag-region-size", cl::Hidden, cl::init(0),
+          cl::desc("Build a separate SelectionDAG for every N instructions of "
+                   "a basic block (0 = one DAG per block)"));
+
 static cl::opt<bool>
 UseMBPI("use-mbpi",
         cl::desc("use Machine Branch Probability Info"),
@@ -541,6 +548,57 @@ void SelectionDAGISel::SelectBasicBlock(BasicBlock::const_iterator Begin,
   CodeGenAndEmitDAG();
 }
 
+bool SelectionDAGISel::isSplitIntoDAGRegions(const BasicBlock *BB) const {
+  return MaxDAGRegionSize && BB->size() > MaxDAGRegionSize;
+}
+
+void
+SelectionDAGISel::SelectBasicBlockInRegions(BasicBlock::const_iterator Begin,
+                                            BasicBlock::const_iterator End,
+                                            bool &HadTailCall) {
+  SmallPtrSet<const Instruction*, 64> InRegion;
+  HadTailCall = false;
+  BasicBlock::const_iterator RegionBegin = Begin;
+  while (RegionBegin != End && !HadTailCall) {
+    BasicBlock::const_iterator RegionEnd = RegionBegin;
+    InRegion.clear();
+    for (unsigned i = 0; RegionEnd != End && i != MaxDAGRegionSize; ++i)
+      InRegion.insert(RegionEnd++);
+
+    // Don't separate a tail call from the return that follows it, and don't
+    // leave a region that would only hold the terminator.
+    while (RegionEnd != End &&
+           ((isa<CallInst>(llvm::prior(RegionEnd)) &&
+             cast<CallInst>(llvm::prior(RegionEnd))->isTailCall()) ||
+            llvm::next(RegionEnd) == End))
+      InRegion.insert(RegionEnd++);
+
+    // Values used outside this region must be copied into virtual registers,
+    // since the SelectionDAG that computes them is gone by the time the next
+    // region is selected.  Values used in other blocks already have them,
+    // and static allocas are referenced through their frame index.
+    for (BasicBlock::const_iterator I = RegionBegin; I != RegionEnd; ++I) {
+      if (I->getType()->isVoidTy() || I->getType()->isEmptyTy() ||
+          FuncInfo->ValueMap.count(I))
+        continue;
+      if (const AllocaInst *AI = dyn_cast<AllocaInst>(I))
+        if (FuncInfo->StaticAllocaMap.count(AI))
+          continue;
+      for (Value::const_use_iterator UI = I->use_begin(), UE = I->use_end();
+           UI != UE; ++UI)
+        if (!InRegion.count(cast<Instruction>(*UI))) {
+          FuncInfo->InitializeRegForValue(I);
+          break;
+        }
+    }
+
+    if (RegionBegin != Begin)
+      ++NumDAGRegions;
+    SelectBasicBlock(RegionBegin, RegionEnd, HadTailCall);
+    RegionBegin = RegionEnd;
+  }
+}
+
 void SelectionDAGISel::ComputeLiveOutVRegInfo() {
   SmallPtrSet<SDNode*, 128> VisitedNodes;
   SmallVector<SDNode*, 128> Worklist;
@@ -983,6 +1041,9 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
     BasicBlock::const_iterator const Begin = LLVMBB->getFirstNonPHI();
     BasicBlock::const_iterator const End = LLVMBB->end();
     BasicBlock::const_iterator BI = End;
+    // The instruction FastISel gave up on, leaving the instructions before it
+    // to SelectionDAG.
+    const Instruction *MissedInst = 0;
 
     FuncInfo->MBB = FuncInfo->MBBMap[LLVMBB];
     FuncInfo->InsertPt = FuncInfo->MBB->getFirstNonPHI();
@@ -1010,10 +1071,12 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
             llvm_unreachable("FastISel didn't lower all arguments");
 
           // Use SelectionDAG argument lowering
+          FastISelFallbackTimer Fallback(Fn, 0);
           LowerArguments(Fn);
           CurDAG->setRoot(SDB->getControlRoot());
           SDB->clear();
           CodeGenAndEmitDAG();
+          Fallback.fallbackDone(0);
         }
 
         // If we inserted any instructions at the beginning, make a note of
@@ -1085,13 +1148,16 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
 
           bool HadTailCall = false;
           MachineBasicBlock::iterator SavedInsertPt = FuncInfo->InsertPt;
+          FastISelFallbackTimer Fallback(Fn, Inst);
           SelectBasicBlock(Inst, BI, HadTailCall);
+          Fallback.fallbackDone(1);
 
           // If the call was emitted as a tail call, we're done with the block.
           // We also need to delete any previously emitted instructions.
           if (HadTailCall) {
             FastIS->removeDeadCode(SavedInsertPt, FuncInfo->MBB->end());
             --BI;
+            MissedInst = Inst;
             break;
           }
 
@@ -1121,6 +1187,7 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
             // For the purpose of debugging, just abort.
             llvm_unreachable("FastISel didn't select the entire block");
         }
+        MissedInst = Inst;
         break;
       }
 
@@ -1142,8 +1209,15 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
       // Run SelectionDAG instruction selection on the remainder of the block
       // not handled by FastISel. If FastISel is not run, this is the entire
       // block.
+      FastISelFallbackTimer Fallback(Fn, MissedInst);
       bool HadTailCall;
-      SelectBasicBlock(Begin, BI, HadTailCall);
+      if (MaxDAGRegionSize &&
+          (unsigned)std::distance(Begin, BI) > MaxDAGRegionSize)
+        SelectBasicBlockInRegions(Begin, BI, HadTailCall);
+      else
+        SelectBasicBlock(Begin, BI, HadTailCall);
+      if (MissedInst)
+        Fallback.fallbackDone(std::distance(Begin, BI));
     }
 
     FinishBasicBlock();
@@ -1785,6 +1859,65 @@ GetVBR(uint64_t Val, const unsigned char *MatcherTable, unsigned &Idx) {
   return Val;
 }
 
+/// MinSwitchTableCases - The number of cases from which an OPC_SwitchOpcode
+/// or OPC_SwitchType gets a table instead of being scanned.
+static const unsigned MinSwitchTableCases = 4;
+
+/// getSwitchCaseOffsets - Return the cached case indices of the switch at
+/// SwitchStart, decoding it the first time it is executed.
+const std::vector<unsigned> &
+SelectionDAGISel::getSwitchCaseOffsets(const unsigned char *MatcherTable,
+                                       unsigned SwitchStart) {
+  DenseMap<unsigned, std::vector<unsigned> >::iterator I =
+    SwitchCaseOffsets.find(SwitchStart);
+  if (I != SwitchCaseOffsets.end())
+    return I->second;
+
+  std::vector<unsigned> &Offsets = SwitchCaseOffsets[SwitchStart];
+  bool IsTypeSwitch = MatcherTable[SwitchStart] == OPC_SwitchType;
+  unsigned KeySize = IsTypeSwitch ? 1 : 2;
+
+  // Count the cases first, so that small switches are left alone.
+  unsigned NumCases = 0, Idx = SwitchStart + 1;
+  while (1) {
+    unsigned CaseSize = MatcherTable[Idx++];
+    if (CaseSize & 128)
+      CaseSize = GetVBR(CaseSize, MatcherTable, Idx);
+    if (CaseSize == 0) break;
+    Idx += KeySize + CaseSize;
+    ++NumCases;
+  }
+  if (NumCases < MinSwitchTableCases)
+    return Offsets;
+
+  Idx = SwitchStart + 1;
+  while (1) {
+    unsigned CaseSize = MatcherTable[Idx++];
+    if (CaseSize & 128)
+      CaseSize = GetVBR(CaseSize, MatcherTable, Idx);
+    if (CaseSize == 0) break;
+
+    unsigned Key;
+    if (IsTypeSwitch) {
+      MVT CaseVT = (MVT::SimpleValueType)MatcherTable[Idx++];
+      if (CaseVT == MVT::iPTR)
+        CaseVT = getTargetLowering()->getPointerTy();
+      Key = CaseVT.SimpleTy;
+    } else {
+      Key = MatcherTable[Idx++];
+      Key |= (unsigned)MatcherTable[Idx++] << 8;
+    }
+
+    // As when scanning, the first case for a key wins.
+    if (Key >= Offsets.size())
+      Offsets.resize(Key + 1);
+    if (Offsets[Key] == 0)
+      Offsets[Key] = Idx;
+    Idx += CaseSize;
+  }
+  return Offsets;
+}
+
 
 /// UpdateChainsAndGlue - When a match is complete, this method updates uses of
 /// interior glue and chain results to use the new glue and chain results.
@@ -2573,6 +2706,19 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
     case OPC_SwitchOpcode: {
       unsigned CurNodeOpcode = N.getOpcode();
       unsigned SwitchStart = MatcherIndex-1; (void)SwitchStart;
+      const std::vector<unsigned> &Offsets =
+        getSwitchCaseOffsets(MatcherTable, SwitchStart);
+      if (!Offsets.empty()) {
+        unsigned CaseIndex =
+          CurNodeOpcode < Offsets.size() ? Offsets[CurNodeOpcode] : 0;
+        // If no cases matched, bail out.
+        if (CaseIndex == 0) break;
+        MatcherIndex = CaseIndex;
+        DEBUG(dbgs() << "  OpcodeSwitch from " << SwitchStart
+                     << " to " << MatcherIndex << "\n");
+        continue;
+      }
+
       unsigned CaseSize;
       while (1) {
         // Get the size of this case.
@@ -2604,6 +2750,20 @@ SelectCodeCommon(SDNode *NodeToMatch, const unsigned char *MatcherTable,
     case OPC_SwitchType: {
       MVT CurNodeVT = N.getSimpleValueType();
       unsigned SwitchStart = MatcherIndex-1; (void)SwitchStart;
+      const std::vector<unsigned> &Offsets =
+        getSwitchCaseOffsets(MatcherTable, SwitchStart);
+      if (!Offsets.empty()) {
+        unsigned VT = CurNodeVT.SimpleTy;
+        unsigned CaseIndex = VT < Offsets.size() ? Offsets[VT] : 0;
+        // If no cases matched, bail out.
+        if (CaseIndex == 0) break;
+        MatcherIndex = CaseIndex;
+        DEBUG(dbgs() << "  TypeSwitch[" << EVT(CurNodeVT).getEVTString()
+                     << "] from " << SwitchStart << " to " << MatcherIndex
+                     << '\n');
+        continue;
+      }
+
       unsigned CaseSize;
       while (1) {
         // Get the size of this case.
@@ -24,6 +24,7 @@ INITIALIZE_PASS(SlotIndexes, "slotindexes",
 
 STATISTIC(NumLocalRenum,  "Number of local renumberings");
 STATISTIC(NumGlobalRenum, "Number of global renumberings");
+STATISTIC(NumRenumberedIndexes, "Number of indexes locally renumbered");
 
 void SlotIndexes::getAnalysisUsage(AnalysisUsage &au) const {
   au.setPreservesAll();
@@ -124,22 +125,59 @@ void SlotIndexes::renumberIndexes() {
 
 // Renumber indexes locally after curItr was inserted, but failed to get a new
 // index.
+//
+// Renumbering only up to the first index that is already bigger leaves the
+// renumbered entries densely packed, so that repeated insertions in the same
+// area renumber longer and longer runs.  Instead, grow a window of entries
+// around curItr, doubling its size each time, until the indexes on either
+// side of it leave room to space its entries at least Space apart, and then
+// spread them evenly.  This keeps the cost of each renumbering proportional
+// to the number of insertions that caused it.
 void SlotIndexes::renumberIndexes(IndexList::iterator curItr) {
-  // Number indexes with half the default spacing so we can catch up quickly.
+  // The entries of the window are spaced at least this far apart.
   const unsigned Space = SlotIndex::InstrDist/2;
   assert((Space & 3) == 0 && "InstrDist must be a multiple of 2*NUM");
 
-  IndexList::iterator startItr = prior(curItr);
-  unsigned index = startItr->getIndex();
-  do {
-    curItr->setIndex(index += Space);
-    ++curItr;
-    // If the next index is bigger, we have caught up.
-  } while (curItr != indexList.end() && curItr->getIndex() <= index);
+  // The window is [Begin, End).  The entry before it is never renumbered.
+  IndexList::iterator Begin = curItr, End = llvm::next(curItr);
+  unsigned Count = 1;
+  unsigned Low = prior(Begin)->getIndex(), Dist = SlotIndex::InstrDist;
+  for (unsigned Target = 2; End != indexList.end(); Target *= 2) {
+    while (Count < Target) {
+      bool Grew = false;
+      if (prior(Begin) != indexList.begin()) {
+        --Begin;
+        ++Count;
+        Grew = true;
+      }
+      if (Count < Target && End != indexList.end()) {
+        ++End;
+        ++Count;
+        Grew = true;
+      }
+      if (!Grew)
+        break;
+    }
+    Low = prior(Begin)->getIndex();
+    if (End == indexList.end())
+      break;
+    // Leave room between the last entry of the window and End too.
+    Dist = ((End->getIndex() - Low) / (Count + 1)) & ~3u;
+    if (Dist >= Space)
+      break;
+  }
+  // Past the last entry there's as much room as needed.
+  if (End == indexList.end())
+    Dist = SlotIndex::InstrDist;
+
+  unsigned index = Low;
+  for (IndexList::iterator I = Begin; I != End; ++I)
+    I->setIndex(index += Dist);
 
-  DEBUG(dbgs() << "\n*** Renumbered SlotIndexes " << startItr->getIndex() << '-'
+  DEBUG(dbgs() << "\n*** Renumbered SlotIndexes " << Low << '-'
                << index << " ***\n");
   ++NumLocalRenum;
+  NumRenumberedIndexes += Count;
 }
 
 // Repair indexes after adding and removing instructions.
@@ -23,16 +23,17 @@
 
 #define DEBUG_TYPE "stackcoloring"
 #include "llvm/CodeGen/Passes.h"
-#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SparseBitVector.h"
 #include "llvm/ADT/SparseSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/LiveInterval.h"
+#include "llvm/CodeGen/LiveIntervalUnion.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
 #include "llvm/CodeGen/MachineBranchProbabilityInfo.h"
 #include "llvm/CodeGen/MachineDominators.h"
@@ -89,17 +90,19 @@ class StackColoring : public MachineFunctionPass {
   MachineFunction *MF;
 
   /// A class representing liveness information for a single basic block.
-  /// Each bit in the BitVector represents the liveness property
-  /// for a different stack slot.
+  /// Each bit in the SparseBitVector represents the liveness property
+  /// for a different stack slot.  A block only has bits for the few slots
+  /// whose lifetime touches it, so the vectors stay small in functions with
+  /// thousands of allocas.
   struct BlockLifetimeInfo {
     /// Which slots BEGINs in each basic block.
-    BitVector Begin;
+    SparseBitVector<> Begin;
     /// Which slots ENDs in each basic block.
-    BitVector End;
+    SparseBitVector<> End;
     /// Which slots are marked as LIVE_IN, coming into each basic block.
-    BitVector LiveIn;
+    SparseBitVector<> LiveIn;
     /// Which slots are marked as LIVE_OUT, coming out of each basic block.
-    BitVector LiveOut;
+    SparseBitVector<> LiveOut;
   };
 
   /// Maps active slots (per bit) for each basic block.
@@ -155,7 +158,7 @@ private:
   /// Scan the machine function and find all of the lifetime markers.
   /// Record the findings in the BEGIN and END vectors.
   /// \returns the number of markers found.
-  unsigned collectMarkers(unsigned NumSlot);
+  unsigned collectMarkers();
 
   /// Perform the dataflow calculation and calculate the lifetime for each of
   /// the slots, based on the BEGIN/END vectors. Set the LifetimeLIVE_IN and
@@ -211,30 +214,14 @@ void StackColoring::dump() const {
     assert(BI != BlockLiveness.end() && "Block not found");
     const BlockLifetimeInfo &BlockInfo = BI->second;
 
-    DEBUG(dbgs()<<"BEGIN  : {");
-    for (unsigned i=0; i < BlockInfo.Begin.size(); ++i)
-      DEBUG(dbgs()<<BlockInfo.Begin.test(i)<<" ");
-    DEBUG(dbgs()<<"}\n");
-
-    DEBUG(dbgs()<<"END    : {");
-    for (unsigned i=0; i < BlockInfo.End.size(); ++i)
-      DEBUG(dbgs()<<BlockInfo.End.test(i)<<" ");
-
-    DEBUG(dbgs()<<"}\n");
-
-    DEBUG(dbgs()<<"LIVE_IN: {");
-    for (unsigned i=0; i < BlockInfo.LiveIn.size(); ++i)
-      DEBUG(dbgs()<<BlockInfo.LiveIn.test(i)<<" ");
-
-    DEBUG(dbgs()<<"}\n");
-    DEBUG(dbgs()<<"LIVEOUT: {");
-    for (unsigned i=0; i < BlockInfo.LiveOut.size(); ++i)
-      DEBUG(dbgs()<<BlockInfo.LiveOut.test(i)<<" ");
-    DEBUG(dbgs()<<"}\n");
+    DEBUG(dbgs()<<"BEGIN  : "; llvm::dump(BlockInfo.Begin, dbgs()));
+    DEBUG(dbgs()<<"END    : "; llvm::dump(BlockInfo.End, dbgs()));
+    DEBUG(dbgs()<<"LIVE_IN: "; llvm::dump(BlockInfo.LiveIn, dbgs()));
+    DEBUG(dbgs()<<"LIVEOUT: "; llvm::dump(BlockInfo.LiveOut, dbgs()));
   }
 }
 
-unsigned StackColoring::collectMarkers(unsigned NumSlot) {
+unsigned StackColoring::collectMarkers() {
   unsigned MarkersFound = 0;
   // Scan the function to find all lifetime markers.
   // NOTE: We use the a reverse-post-order iteration to ensure that we obtain a
@@ -250,9 +237,6 @@ unsigned StackColoring::collectMarkers(unsigned NumSlot) {
     // Keep a reference to avoid repeated lookups.
     BlockLifetimeInfo &BlockInfo = BlockLiveness[*FI];
 
-    BlockInfo.Begin.resize(NumSlot);
-    BlockInfo.End.resize(NumSlot);
-
     for (MachineBasicBlock::iterator BI = (*FI)->begin(), BE = (*FI)->end();
          BI != BE; ++BI) {
 
@@ -322,8 +306,8 @@ void StackColoring::calculateLocalLiveness() {
       assert(BI != BlockLiveness.end() && "Block not found");
       BlockLifetimeInfo &BlockInfo = BI->second;
 
-      BitVector LocalLiveIn;
-      BitVector LocalLiveOut;
+      SparseBitVector<> LocalLiveIn;
+      SparseBitVector<> LocalLiveOut;
 
       // Forward propagation from begins to ends.
       for (MachineBasicBlock::const_pred_iterator PI = BB->pred_begin(),
@@ -333,7 +317,7 @@ void StackColoring::calculateLocalLiveness() {
         LocalLiveIn |= I->second.LiveOut;
       }
       LocalLiveIn |= BlockInfo.End;
-      LocalLiveIn.reset(BlockInfo.Begin);
+      LocalLiveIn.intersectWithComplement(BlockInfo.Begin);
 
       // Reverse propagation from ends to begins.
       for (MachineBasicBlock::const_succ_iterator SI = BB->succ_begin(),
@@ -343,15 +327,15 @@ void StackColoring::calculateLocalLiveness() {
         LocalLiveOut |= I->second.LiveIn;
       }
       LocalLiveOut |= BlockInfo.Begin;
-      LocalLiveOut.reset(BlockInfo.End);
+      LocalLiveOut.intersectWithComplement(BlockInfo.End);
 
       LocalLiveIn |= LocalLiveOut;
       LocalLiveOut |= LocalLiveIn;
 
       // After adopting the live bits, we need to turn-off the bits which
       // are de-activated in this block.
-      LocalLiveOut.reset(BlockInfo.End);
-      LocalLiveIn.reset(BlockInfo.Begin);
+      LocalLiveOut.intersectWithComplement(BlockInfo.End);
+      LocalLiveIn.intersectWithComplement(BlockInfo.Begin);
 
       // If we have both BEGIN and END markers in the same basic block then
       // we know that the BEGIN marker comes after the END, because we already
@@ -360,23 +344,21 @@ void StackColoring::calculateLocalLiveness() {
       // Want to enable the LIVE_IN and LIVE_OUT of slots that have both
       // BEGIN and END because it means that the value lives before and after
       // this basic block.
-      BitVector LocalEndBegin = BlockInfo.End;
+      SparseBitVector<> LocalEndBegin = BlockInfo.End;
       LocalEndBegin &= BlockInfo.Begin;
       LocalLiveIn |= LocalEndBegin;
       LocalLiveOut |= LocalEndBegin;
 
-      if (LocalLiveIn.test(BlockInfo.LiveIn)) {
+      if (BlockInfo.LiveIn |= LocalLiveIn) {
         changed = true;
-        BlockInfo.LiveIn |= LocalLiveIn;
 
         for (MachineBasicBlock::const_pred_iterator PI = BB->pred_begin(),
              PE = BB->pred_end(); PI != PE; ++PI)
           NextBBSet.insert(*PI);
       }
 
-      if (LocalLiveOut.test(BlockInfo.LiveOut)) {
+      if (BlockInfo.LiveOut |= LocalLiveOut) {
         changed = true;
-        BlockInfo.LiveOut |= LocalLiveOut;
 
         for (MachineBasicBlock::const_succ_iterator SI = BB->succ_begin(),
              SE = BB->succ_end(); SI != SE; ++SI)
@@ -391,73 +373,85 @@ void StackColoring::calculateLocalLiveness() {
 void StackColoring::calculateLiveIntervals(unsigned NumSlots) {
   SmallVector<SlotIndex, 16> Starts;
   SmallVector<SlotIndex, 16> Finishes;
+  Starts.resize(NumSlots);
+  Finishes.resize(NumSlots);
+
+  // The slots that have a start or finish in the current block.  Only these
+  // need an interval update, and only their entries are reset for the next
+  // block.
+  SmallVector<int, 16> ActiveSlots;
 
   // For each block, find which slots are active within this block
   // and update the live intervals.
   for (MachineFunction::iterator MBB = MF->begin(), MBBe = MF->end();
        MBB != MBBe; ++MBB) {
-    Starts.clear();
-    Starts.resize(NumSlots);
-    Finishes.clear();
-    Finishes.resize(NumSlots);
+    for (unsigned i = 0, e = ActiveSlots.size(); i != e; ++i) {
+      Starts[ActiveSlots[i]] = SlotIndex();
+      Finishes[ActiveSlots[i]] = SlotIndex();
+    }
+    ActiveSlots.clear();
 
     // Create the interval for the basic blocks with lifetime markers in them.
-    for (SmallVectorImpl<MachineInstr*>::const_iterator it = Markers.begin(),
-         e = Markers.end(); it != e; ++it) {
-      const MachineInstr *MI = *it;
-      if (MI->getParent() != MBB)
-        continue;
-
-      assert((MI->getOpcode() == TargetOpcode::LIFETIME_START ||
-              MI->getOpcode() == TargetOpcode::LIFETIME_END) &&
-             "Invalid Lifetime marker");
+    // Markers were only collected from the blocks that were numbered.
+    if (BasicBlocks.count(MBB)) {
+      for (MachineBasicBlock::iterator MI = MBB->begin(), ME = MBB->end();
+           MI != ME; ++MI) {
+        if (MI->getOpcode() != TargetOpcode::LIFETIME_START &&
+            MI->getOpcode() != TargetOpcode::LIFETIME_END)
+          continue;
 
-      bool IsStart = MI->getOpcode() == TargetOpcode::LIFETIME_START;
-      const MachineOperand &Mo = MI->getOperand(0);
-      int Slot = Mo.getIndex();
-      assert(Slot >= 0 && "Invalid slot");
+        bool IsStart = MI->getOpcode() == TargetOpcode::LIFETIME_START;
+        const MachineOperand &Mo = MI->getOperand(0);
+        int Slot = Mo.getIndex();
+        assert(Slot >= 0 && "Invalid slot");
 
-      SlotIndex ThisIndex = Indexes->getInstructionIndex(MI);
+        SlotIndex ThisIndex = Indexes->getInstructionIndex(MI);
 
-      if (IsStart) {
-        if (!Starts[Slot].isValid() || Starts[Slot] > ThisIndex)
-          Starts[Slot] = ThisIndex;
-      } else {
-        if (!Finishes[Slot].isValid() || Finishes[Slot] < ThisIndex)
-          Finishes[Slot] = ThisIndex;
+        if (!Starts[Slot].isValid() && !Finishes[Slot].isValid())
+          ActiveSlots.push_back(Slot);
+        if (IsStart) {
+          if (!Starts[Slot].isValid() || Starts[Slot] > ThisIndex)
+            Starts[Slot] = ThisIndex;
+        } else {
+          if (!Finishes[Slot].isValid() || Finishes[Slot] < ThisIndex)
+            Finishes[Slot] = ThisIndex;
+        }
       }
     }
 
     // Create the interval of the blocks that we previously found to be 'alive'.
     BlockLifetimeInfo &MBBLiveness = BlockLiveness[MBB];
-    for (int pos = MBBLiveness.LiveIn.find_first(); pos != -1;
-         pos = MBBLiveness.LiveIn.find_next(pos)) {
-      Starts[pos] = Indexes->getMBBStartIdx(MBB);
+    for (SparseBitVector<>::iterator I = MBBLiveness.LiveIn.begin(),
+         E = MBBLiveness.LiveIn.end(); I != E; ++I) {
+      if (!Starts[*I].isValid() && !Finishes[*I].isValid())
+        ActiveSlots.push_back(*I);
+      Starts[*I] = Indexes->getMBBStartIdx(MBB);
     }
-    for (int pos = MBBLiveness.LiveOut.find_first(); pos != -1;
-         pos = MBBLiveness.LiveOut.find_next(pos)) {
-      Finishes[pos] = Indexes->getMBBEndIdx(MBB);
+    for (SparseBitVector<>::iterator I = MBBLiveness.LiveOut.begin(),
+         E = MBBLiveness.LiveOut.end(); I != E; ++I) {
+      if (!Starts[*I].isValid() && !Finishes[*I].isValid())
+        ActiveSlots.push_back(*I);
+      Finishes[*I] = Indexes->getMBBEndIdx(MBB);
     }
 
-    for (unsigned i = 0; i < NumSlots; ++i) {
-      assert(Starts[i].isValid() == Finishes[i].isValid() && "Unmatched range");
-      if (!Starts[i].isValid())
-        continue;
-
-      assert(Starts[i] && Finishes[i] && "Invalid interval");
-      VNInfo *ValNum = Intervals[i]->getValNumInfo(0);
-      SlotIndex S = Starts[i];
-      SlotIndex F = Finishes[i];
+    for (unsigned i = 0, e = ActiveSlots.size(); i != e; ++i) {
+      int Slot = ActiveSlots[i];
+      assert(Starts[Slot].isValid() == Finishes[Slot].isValid() &&
+             "Unmatched range");
+      assert(Starts[Slot] && Finishes[Slot] && "Invalid interval");
+      VNInfo *ValNum = Intervals[Slot]->getValNumInfo(0);
+      SlotIndex S = Starts[Slot];
+      SlotIndex F = Finishes[Slot];
       if (S < F) {
         // We have a single consecutive region.
-        Intervals[i]->addSegment(LiveInterval::Segment(S, F, ValNum));
+        Intervals[Slot]->addSegment(LiveInterval::Segment(S, F, ValNum));
       } else {
         // We have two non consecutive regions. This happens when
         // LIFETIME_START appears after the LIFETIME_END marker.
         SlotIndex NewStart = Indexes->getMBBStartIdx(MBB);
         SlotIndex NewFin = Indexes->getMBBEndIdx(MBB);
-        Intervals[i]->addSegment(LiveInterval::Segment(NewStart, F, ValNum));
-        Intervals[i]->addSegment(LiveInterval::Segment(S, NewFin, ValNum));
+        Intervals[Slot]->addSegment(LiveInterval::Segment(NewStart, F, ValNum));
+        Intervals[Slot]->addSegment(LiveInterval::Segment(S, NewFin, ValNum));
       }
     }
   }
@@ -683,7 +677,7 @@ bool StackColoring::runOnMachineFunction(MachineFunction &Func) {
   SortedSlots.reserve(NumSlots);
   Intervals.reserve(NumSlots);
 
-  unsigned NumMarkers = collectMarkers(NumSlots);
+  unsigned NumMarkers = collectMarkers();
 
   unsigned TotalSize = 0;
   DEBUG(dbgs()<<"Found "<<NumMarkers<<" markers and "<<NumSlots<<" slots\n");
@@ -733,56 +727,60 @@ bool StackColoring::runOnMachineFunction(MachineFunction &Func) {
   }
 
   // This is a simple greedy algorithm for merging allocas. First, sort the
-  // slots, placing the largest slots first. Next, perform an n^2 scan and look
-  // for disjoint slots. When you find disjoint slots, merge the samller one
-  // into the bigger one and update the live interval. Remove the small alloca
-  // and continue.
+  // slots, placing the largest slots first. Next, give each slot in turn to
+  // the first of the slots kept so far whose live range, together with the
+  // ranges already merged into it, is disjoint from its own.  If there is
+  // none, keep the slot.  The ranges merged into each kept slot live in a
+  // LiveIntervalUnion, so that an overlap test is a lookup per segment of the
+  // slot being placed instead of a walk over both ranges.
 
   // Sort the slots according to their size. Place unused slots at the end.
   // Use stable sort to guarantee deterministic code generation.
   std::stable_sort(SortedSlots.begin(), SortedSlots.end(),
                    SlotSizeSorter(MFI));
 
-  bool Changed = true;
-  while (Changed) {
-    Changed = false;
-    for (unsigned I = 0; I < NumSlots; ++I) {
-      if (SortedSlots[I] == -1)
-        continue;
-
-      for (unsigned J=I+1; J < NumSlots; ++J) {
-        if (SortedSlots[J] == -1)
-          continue;
+  LiveIntervalUnion::Allocator UnionAllocator;
+  LiveIntervalUnion::Array Unions;
+  Unions.init(UnionAllocator, NumSlots);
+  SmallVector<int, 16> KeptSlots;
 
-        int FirstSlot = SortedSlots[I];
-        int SecondSlot = SortedSlots[J];
-        LiveInterval *First = Intervals[FirstSlot];
-        LiveInterval *Second = Intervals[SecondSlot];
-        assert (!First->empty() && !Second->empty() && "Found an empty range");
-
-        // Merge disjoint slots.
-        if (!First->overlaps(*Second)) {
-          Changed = true;
-          First->MergeSegmentsInAsValue(*Second, First->getValNumInfo(0));
-          SlotRemap[SecondSlot] = FirstSlot;
-          SortedSlots[J] = -1;
-          DEBUG(dbgs()<<"Merging #"<<FirstSlot<<" and slots #"<<
-                SecondSlot<<" together.\n");
-          unsigned MaxAlignment = std::max(MFI->getObjectAlignment(FirstSlot),
-                                           MFI->getObjectAlignment(SecondSlot));
-
-          assert(MFI->getObjectSize(FirstSlot) >=
-                 MFI->getObjectSize(SecondSlot) &&
-                 "Merging a small object into a larger one");
-
-          RemovedSlots+=1;
-          ReducedSize += MFI->getObjectSize(SecondSlot);
-          MFI->setObjectAlignment(FirstSlot, MaxAlignment);
-          MFI->RemoveStackObject(SecondSlot);
-        }
-      }
+  for (unsigned I = 0; I < NumSlots; ++I) {
+    int SecondSlot = SortedSlots[I];
+    if (SecondSlot == -1)
+      continue;
+
+    LiveInterval *Second = Intervals[SecondSlot];
+    assert(!Second->empty() && "Found an empty range");
+    unsigned Color = 0, NumColors = KeptSlots.size();
+    for (; Color != NumColors; ++Color) {
+      LiveIntervalUnion::Query Q(Second, &Unions[Color]);
+      if (!Q.checkInterference())
+        break;
     }
-  }// While changed.
+    Unions[Color].unify(*Second);
+    if (Color == NumColors) {
+      KeptSlots.push_back(SecondSlot);
+      continue;
+    }
+
+    // Merge disjoint slots.
+    int FirstSlot = KeptSlots[Color];
+    SlotRemap[SecondSlot] = FirstSlot;
+    DEBUG(dbgs()<<"Merging #"<<FirstSlot<<" and slots #"<<
+          SecondSlot<<" together.\n");
+    unsigned MaxAlignment = std::max(MFI->getObjectAlignment(FirstSlot),
+                                     MFI->getObjectAlignment(SecondSlot));
+
+    assert(MFI->getObjectSize(FirstSlot) >=
+           MFI->getObjectSize(SecondSlot) &&
+           "Merging a small object into a larger one");
+
+    RemovedSlots+=1;
+    ReducedSize += MFI->getObjectSize(SecondSlot);
+    MFI->setObjectAlignment(FirstSlot, MaxAlignment);
+    MFI->RemoveStackObject(SecondSlot);
+  }
+  Unions.clear();
 
   // Record statistics.
   StackSpaceSaved += ReducedSize;
@@ -0,0 +1,396 @@
+//===-- StatepointGC.cpp - GC support through safepoint stack maps --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the "statepoint" GC strategy for relocating
+// collectors.  Unlike the shadow stack and the llvm.gcroot based strategies,
+// it does not pin the roots of a function to stack slots: GC pointers are
+// plain SSA values in address space 1, which the optimizers and the register
+// allocator handle like any other value.
+//
+// Only the calls are safepoints.  Just before a call, the GC pointers that are
+// live across it are stored to spill slots, and just after it they are
+// reloaded from them.  An llvm.experimental.stackmap call between the two
+// records the slots in the stack map section, where the collector finds the
+// pointers to update when it moves objects.  The ID of each stack map is
+// unique within the module.
+//
+// Each live pointer is recorded as a pair of slots: the base pointer of the
+// object, followed by the pointer itself.  They are the same slot unless the
+// pointer was derived from the base with getelementptr, in which case the
+// collector relocates the base and moves the derived pointer by the same
+// amount.  Derived pointers must not flow through PHIs or selects, whose
+// results are taken to be base pointers.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "statepointgc"
+#include "llvm/CodeGen/GCs.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/GCStrategy.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/InstIterator.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/SSAUpdater.h"
+#include <algorithm>
+
+using namespace llvm;
+
+STATISTIC(NumSafepoints, "Number of safepoints recorded");
+STATISTIC(NumRelocations, "Number of GC pointers relocated at safepoints");
+
+namespace {
+
+  typedef DenseSet<Value*> ValueSet;
+
+  class StatepointGC : public GCStrategy {
+    /// NextID - The stack map ID of the next safepoint of the module.
+    unsigned NextID;
+
+  public:
+    StatepointGC();
+
+    bool performCustomLowering(Function &F);
+  };
+
+  /// SafepointInfo - A call and the GC pointers live across it, in the order
+  /// in which they are recorded.
+  struct SafepointInfo {
+    Instruction *Call;
+    SmallVector<Value*, 8> Live;
+  };
+
+  /// ValueOrder - Sorts values by the number a function gave them, so that
+  /// the output does not depend on the addresses of the values.
+  class ValueOrder {
+    const DenseMap<Value*, unsigned> &Numbering;
+
+  public:
+    explicit ValueOrder(const DenseMap<Value*, unsigned> &Numbering)
+      : Numbering(Numbering) {}
+
+    bool operator()(Value *A, Value *B) const {
+      return Numbering.lookup(A) < Numbering.lookup(B);
+    }
+  };
+
+}
+
+static GCRegistry::Add<StatepointGC>
+X("statepoint", "Relocating GC with safepoints recorded in stack maps");
+
+void llvm::linkStatepointGC() { }
+
+StatepointGC::StatepointGC() : NextID(0) {
+  CustomRoots = true;
+  InitRoots = false;
+}
+
+/// isGCPointer - Return true if V is a pointer into the garbage collected
+/// heap, which is address space 1, that the function computes.
+static bool isGCPointer(const Value *V) {
+  PointerType *PT = dyn_cast<PointerType>(V->getType());
+  return PT && PT->getAddressSpace() == 1 &&
+         (isa<Instruction>(V) || isa<Argument>(V));
+}
+
+/// getBasePointer - Return the pointer to the start of the object that the GC
+/// pointer V points into.
+static Value *getBasePointer(Value *V) {
+  Value *Base = V;
+  for (;;) {
+    if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(Base))
+      Base = GEP->getPointerOperand();
+    else if (BitCastInst *BC = dyn_cast<BitCastInst>(Base))
+      Base = BC->getOperand(0);
+    else
+      break;
+  }
+  // Pointers derived from constants are not moved.
+  return isGCPointer(Base) ? Base : V;
+}
+
+/// isSafepoint - Return true if the collector may run during I.
+static bool isSafepoint(const Instruction *I) {
+  if (isa<InvokeInst>(I))
+    return true;
+  const CallInst *CI = dyn_cast<CallInst>(I);
+  return CI && !isa<IntrinsicInst>(CI) && !CI->isInlineAsm();
+}
+
+/// stepBackward - Update Live, the GC pointers live after I, to those live
+/// before it.  I must not be a PHI.
+static void stepBackward(Instruction *I, ValueSet &Live) {
+  Live.erase(I);
+  for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE; ++OI)
+    if (isGCPointer(*OI))
+      Live.insert(*OI);
+}
+
+/// computeLiveOut - Compute the GC pointers live out of each block of F.
+static void computeLiveOut(Function &F,
+                           DenseMap<BasicBlock*, ValueSet> &LiveOut) {
+  DenseMap<BasicBlock*, ValueSet> LiveIn;
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (Function::iterator BI = F.end(), BE = F.begin(); BI != BE;) {
+      BasicBlock *BB = --BI;
+
+      ValueSet Live;
+      for (succ_iterator SI = succ_begin(BB), SE = succ_end(BB); SI != SE;
+           ++SI) {
+        ValueSet &SuccLive = LiveIn[*SI];
+        for (ValueSet::iterator I = SuccLive.begin(), E = SuccLive.end();
+             I != E; ++I)
+          Live.insert(*I);
+        for (BasicBlock::iterator I = SI->begin(); isa<PHINode>(I); ++I) {
+          Value *V = cast<PHINode>(I)->getIncomingValueForBlock(BB);
+          if (isGCPointer(V))
+            Live.insert(V);
+        }
+      }
+      LiveOut[BB] = Live;
+
+      for (BasicBlock::iterator I = BB->end(); I != BB->begin();) {
+        --I;
+        if (isa<PHINode>(I))
+          Live.erase(I);
+        else
+          stepBackward(I, Live);
+      }
+
+      // The sets only grow, so comparing sizes finds the changes.
+      ValueSet &OldLive = LiveIn[BB];
+      if (OldLive.size() != Live.size()) {
+        OldLive = Live;
+        Changed = true;
+      }
+    }
+  }
+}
+
+/// findDefBefore - Return the last of Defs before I in its block, or null.
+static Value *findDefBefore(Instruction *I,
+                            const SmallPtrSet<Value*, 8> &Defs) {
+  BasicBlock *BB = I->getParent();
+  for (BasicBlock::iterator II = I; II != BB->begin();) {
+    --II;
+    if (Defs.count(II))
+      return II;
+  }
+  return 0;
+}
+
+/// rewriteUses - Make each use of V use whichever of V and its Reloads
+/// reaches it last.
+static void rewriteUses(Value *V, ArrayRef<LoadInst*> Reloads) {
+  SmallPtrSet<Value*, 8> Defs;
+  Defs.insert(V);
+  SmallPtrSet<BasicBlock*, 8> DefBlocks;
+  BasicBlock *VBlock;
+  if (Instruction *I = dyn_cast<Instruction>(V))
+    VBlock = I->getParent();
+  else
+    VBlock = &cast<Argument>(V)->getParent()->getEntryBlock();
+  DefBlocks.insert(VBlock);
+  for (unsigned i = 0, e = Reloads.size(); i != e; ++i) {
+    Defs.insert(Reloads[i]);
+    DefBlocks.insert(Reloads[i]->getParent());
+  }
+
+  SSAUpdater SSA;
+  SSA.Initialize(V->getType(), V->getName());
+  for (SmallPtrSet<BasicBlock*, 8>::iterator I = DefBlocks.begin(),
+       E = DefBlocks.end(); I != E; ++I) {
+    // Only the entry block of an argument has no definition in it.
+    Value *Last = findDefBefore((*I)->getTerminator(), Defs);
+    SSA.AddAvailableValue(*I, Last ? Last : V);
+  }
+
+  SmallVector<Use*, 16> Uses;
+  for (Value::use_iterator UI = V->use_begin(), UE = V->use_end(); UI != UE;
+       ++UI)
+    Uses.push_back(&UI.getUse());
+
+  for (unsigned i = 0, e = Uses.size(); i != e; ++i) {
+    Use &U = *Uses[i];
+    Instruction *User = cast<Instruction>(U.getUser());
+    Value *NewV;
+    if (PHINode *PN = dyn_cast<PHINode>(User)) {
+      NewV = SSA.GetValueAtEndOfBlock(PN->getIncomingBlock(U));
+    } else {
+      NewV = findDefBefore(User, Defs);
+      if (!NewV)
+        NewV = SSA.GetValueInMiddleOfBlock(User->getParent());
+    }
+    if (NewV != V)
+      U.set(NewV);
+  }
+}
+
+bool StatepointGC::performCustomLowering(Function &F) {
+  // The safepoints find the roots themselves.
+  bool MadeChange = false;
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E;) {
+    IntrinsicInst *II = dyn_cast<IntrinsicInst>(&*I++);
+    if (II && II->getIntrinsicID() == Intrinsic::gcroot) {
+      II->eraseFromParent();
+      MadeChange = true;
+    }
+  }
+
+  DenseMap<Value*, unsigned> Numbering;
+  unsigned Number = 0;
+  for (Function::arg_iterator AI = F.arg_begin(), AE = F.arg_end(); AI != AE;
+       ++AI)
+    Numbering[AI] = Number++;
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
+    Numbering[&*I] = Number++;
+
+  DenseMap<BasicBlock*, ValueSet> LiveOut;
+  computeLiveOut(F, LiveOut);
+
+  // Find the pointers live across each safepoint before changing anything.
+  // The landing pads reload the pointers live into them for all the invokes
+  // that unwind to them.
+  std::vector<SafepointInfo> Safepoints;
+  DenseMap<BasicBlock*, SmallVector<Value*, 8> > LandingPadLive;
+  for (Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    ValueSet Live = LiveOut[BB];
+    unsigned FirstInBlock = Safepoints.size();
+    for (BasicBlock::iterator I = BB->end(); I != BB->begin();) {
+      --I;
+      if (isa<PHINode>(I))
+        break;
+      if (isSafepoint(I)) {
+        Safepoints.push_back(SafepointInfo());
+        SafepointInfo &SP = Safepoints.back();
+        SP.Call = I;
+        Live.erase(I);
+        ValueSet Bases;
+        for (ValueSet::iterator VI = Live.begin(), VE = Live.end(); VI != VE;
+             ++VI) {
+          SP.Live.push_back(*VI);
+          Value *Base = getBasePointer(*VI);
+          if (Base != *VI && !Live.count(Base) && Bases.insert(Base).second)
+            SP.Live.push_back(Base);
+        }
+        std::sort(SP.Live.begin(), SP.Live.end(), ValueOrder(Numbering));
+      }
+      stepBackward(I, Live);
+    }
+    // Lower the safepoints of the block in order.
+    std::reverse(Safepoints.begin() + FirstInBlock, Safepoints.end());
+
+    if (!BB->isLandingPad())
+      continue;
+    SmallVector<Value*, 8> &LPLive = LandingPadLive[BB];
+    Live = LiveOut[BB];
+    for (BasicBlock::iterator I = BB->end(); I != BB->begin();) {
+      --I;
+      if (isa<PHINode>(I))
+        Live.erase(I);
+      else
+        stepBackward(I, Live);
+    }
+    for (ValueSet::iterator VI = Live.begin(), VE = Live.end(); VI != VE;
+         ++VI)
+      LPLive.push_back(*VI);
+    std::sort(LPLive.begin(), LPLive.end(), ValueOrder(Numbering));
+  }
+
+  if (Safepoints.empty())
+    return MadeChange;
+
+  Module *M = F.getParent();
+  Function *StackMap =
+    Intrinsic::getDeclaration(M, Intrinsic::experimental_stackmap);
+  Type *Int32Ty = Type::getInt32Ty(F.getContext());
+  Instruction *AllocaPt = F.getEntryBlock().begin();
+
+  DenseMap<Value*, AllocaInst*> Slots;
+  DenseMap<Value*, SmallVector<LoadInst*, 4> > Reloads;
+  for (unsigned i = 0, e = Safepoints.size(); i != e; ++i) {
+    SafepointInfo &SP = Safepoints[i];
+    Instruction *Call = SP.Call;
+
+    // Spill the live pointers.  Their uses, these stores included, are
+    // rewritten below to use the latest reload.
+    SmallVector<Value*, 16> Args;
+    Args.push_back(ConstantInt::get(Int32Ty, NextID++));
+    Args.push_back(ConstantInt::get(Int32Ty, 0));
+    for (unsigned j = 0, je = SP.Live.size(); j != je; ++j) {
+      Value *V = SP.Live[j];
+      AllocaInst *&Slot = Slots[V];
+      if (!Slot)
+        Slot = new AllocaInst(V->getType(), 0, V->getName() + ".gcslot",
+                              AllocaPt);
+      new StoreInst(V, Slot, Call);
+    }
+    for (unsigned j = 0, je = SP.Live.size(); j != je; ++j) {
+      Value *V = SP.Live[j];
+      Args.push_back(Slots[getBasePointer(V)]);
+      Args.push_back(Slots[V]);
+    }
+
+    // Record them right after the call, and reload them for its successors.
+    Instruction *InsertPt;
+    if (InvokeInst *II = dyn_cast<InvokeInst>(Call)) {
+      BasicBlock *Normal = II->getNormalDest();
+      if (BasicBlock *NewBB = SplitCriticalEdge(II, 0))
+        Normal = NewBB;
+      InsertPt = Normal->getFirstInsertionPt();
+    } else {
+      InsertPt = llvm::next(BasicBlock::iterator(Call));
+    }
+    CallInst::Create(StackMap, Args, "", InsertPt);
+    for (unsigned j = 0, je = SP.Live.size(); j != je; ++j) {
+      Value *V = SP.Live[j];
+      Reloads[V].push_back(new LoadInst(Slots[V], V->getName() + ".relocated",
+                                        InsertPt));
+    }
+
+    DEBUG(dbgs() << "Safepoint " << NextID - 1 << " with " << SP.Live.size()
+                 << " live GC pointers: " << *Call << "\n");
+    ++NumSafepoints;
+    NumRelocations += SP.Live.size();
+  }
+
+  for (DenseMap<BasicBlock*, SmallVector<Value*, 8> >::iterator
+       I = LandingPadLive.begin(), E = LandingPadLive.end(); I != E; ++I) {
+    Instruction *InsertPt = I->first->getFirstInsertionPt();
+    for (unsigned j = 0, je = I->second.size(); j != je; ++j) {
+      Value *V = I->second[j];
+      assert(Slots.count(V) && "Pointer live into a landing pad not spilled");
+      Reloads[V].push_back(new LoadInst(Slots[V], V->getName() + ".relocated",
+                                        InsertPt));
+    }
+  }
+
+  // Visit the pointers in a fixed order, since SSA construction may create
+  // PHIs.
+  SmallVector<Value*, 16> Relocated;
+  for (DenseMap<Value*, SmallVector<LoadInst*, 4> >::iterator
+       I = Reloads.begin(), E = Reloads.end(); I != E; ++I)
+    Relocated.push_back(I->first);
+  std::sort(Relocated.begin(), Relocated.end(), ValueOrder(Numbering));
+  for (unsigned i = 0, e = Relocated.size(); i != e; ++i)
+    rewriteUses(Relocated[i], Reloads[Relocated[i]]);
+
+  return true;
+}
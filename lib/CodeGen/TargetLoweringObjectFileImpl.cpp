@@ -232,6 +232,16 @@ static const char *getSectionPrefixForGlobal(SectionKind Kind) {
   return ".data.rel.ro.";
 }
 
+/// getTextSectionPrefix - Return the name of the text section that profile
+/// data placed GV in, such as ".text.hot", or an empty string.
+static std::string getTextSectionPrefix(const GlobalValue *GV) {
+  const Function *F = dyn_cast<Function>(GV);
+  if (!F || !F->hasFnAttribute("section-prefix"))
+    return std::string();
+  return ".text." +
+         F->getFnAttribute("section-prefix").getValueAsString().str();
+}
+
 
 const MCSection *TargetLoweringObjectFileELF::
 SelectSectionForGlobal(const GlobalValue *GV, SectionKind Kind,
@@ -246,12 +256,17 @@ SelectSectionForGlobal(const GlobalValue *GV, SectionKind Kind,
 
   // If this global is linkonce/weak and the target handles this by emitting it
   // into a 'uniqued' section name, create and return the section now.
+  std::string TextPrefix;
+  if (Kind.isText())
+    TextPrefix = getTextSectionPrefix(GV);
+
   if ((GV->isWeakForLinker() || EmitUniquedSection) &&
       !Kind.isCommon()) {
-    const char *Prefix;
-    Prefix = getSectionPrefixForGlobal(Kind);
-
-    SmallString<128> Name(Prefix, Prefix+strlen(Prefix));
+    SmallString<128> Name;
+    if (!TextPrefix.empty())
+      Name = TextPrefix + ".";
+    else
+      Name = getSectionPrefixForGlobal(Kind);
     MCSymbol *Sym = getSymbol(*Mang, GV);
     Name.append(Sym->getName().begin(), Sym->getName().end());
     StringRef Group = "";
@@ -266,6 +281,12 @@ SelectSectionForGlobal(const GlobalValue *GV, SectionKind Kind,
                                       Flags, Kind, 0, Group);
   }
 
+  // Functions that profile data placed get a section of their own kind, such
+  // as .text.hot or .text.unlikely, which linkers group together.
+  if (!TextPrefix.empty())
+    return getContext().getELFSection(TextPrefix, ELF::SHT_PROGBITS,
+                                      getELFSectionFlags(Kind), Kind);
+
   if (Kind.isText()) return TextSection;
 
   if (Kind.isMergeable1ByteCString() ||
@@ -13,6 +13,11 @@ using namespace llvm;
 
 DIContext::~DIContext() {}
 
-DIContext *DIContext::getDWARFContext(object::ObjectFile *Obj) {
-  return new DWARFContextInMemory(Obj);
+DIContext *DIContext::getDWARFContext(object::ObjectFile *Obj,
+                                      unsigned NumThreads,
+                                      size_t DIEMemoryBudget) {
+  DWARFContextInMemory *Ctx = new DWARFContextInMemory(Obj);
+  Ctx->setNumThreads(NumThreads);
+  Ctx->setDIEMemoryBudget(DIEMemoryBudget);
+  return Ctx;
 }
@@ -0,0 +1,126 @@
+//===-- DWARFAcceleratorTable.cpp -----------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "DWARFAcceleratorTable.h"
+#include "llvm/Support/Dwarf.h"
+using namespace llvm;
+using namespace dwarf;
+
+static const uint32_t MagicHash = 0x48415348; // 'HASH'
+
+bool DWARFAcceleratorTable::extract() {
+  uint32_t Offset = 0;
+  if (!AccelSection.isValidOffsetForDataOfSize(Offset, 28))
+    return false;
+  if (AccelSection.getU32(&Offset) != MagicHash)
+    return false;
+  uint16_t Version = AccelSection.getU16(&Offset);
+  uint16_t HashFunction = AccelSection.getU16(&Offset);
+  if (Version != 1 || HashFunction != DW_hash_function_djb)
+    return false;
+  BucketCount = AccelSection.getU32(&Offset);
+  HashCount = AccelSection.getU32(&Offset);
+  uint32_t HeaderDataLength = AccelSection.getU32(&Offset);
+
+  // The header data starts with the atoms that describe each DIE entry.
+  BucketsOffset = Offset + HeaderDataLength;
+  DIEOffsetBase = AccelSection.getU32(&Offset);
+  uint32_t NumAtoms = AccelSection.getU32(&Offset);
+  if (NumAtoms > UINT32_MAX / 4 ||
+      !AccelSection.isValidOffsetForDataOfSize(Offset, NumAtoms * 4))
+    return false;
+  bool HasDIEOffset = false;
+  Atoms.clear();
+  for (uint32_t i = 0; i != NumAtoms; ++i) {
+    Atom A;
+    A.Type = AccelSection.getU16(&Offset);
+    A.Form = AccelSection.getU16(&Offset);
+    HasDIEOffset |= A.Type == DW_ATOM_die_offset;
+    Atoms.push_back(A);
+  }
+
+  uint64_t TableSize = (uint64_t(BucketCount) + 2 * uint64_t(HashCount)) * 4;
+  return HasDIEOffset && BucketCount && TableSize <= UINT32_MAX &&
+         AccelSection.isValidOffsetForDataOfSize(BucketsOffset, TableSize);
+}
+
+bool DWARFAcceleratorTable::extractAtom(uint16_t Form, uint32_t *Offset,
+                                        uint64_t &Value) const {
+  switch (Form) {
+  case DW_FORM_data1:
+  case DW_FORM_ref1:
+  case DW_FORM_flag:
+    Value = AccelSection.getU8(Offset);
+    return true;
+  case DW_FORM_data2:
+  case DW_FORM_ref2:
+    Value = AccelSection.getU16(Offset);
+    return true;
+  case DW_FORM_data4:
+  case DW_FORM_ref4:
+    Value = AccelSection.getU32(Offset);
+    return true;
+  case DW_FORM_data8:
+  case DW_FORM_ref8:
+    Value = AccelSection.getU64(Offset);
+    return true;
+  case DW_FORM_udata:
+  case DW_FORM_ref_udata:
+    Value = AccelSection.getULEB128(Offset);
+    return true;
+  case DW_FORM_sdata:
+    Value = AccelSection.getSLEB128(Offset);
+    return true;
+  default:
+    return false;
+  }
+}
+
+void DWARFAcceleratorTable::findDIEOffsets(
+    StringRef Name, SmallVectorImpl<uint32_t> &Offsets) const {
+  if (!BucketCount)
+    return;
+  uint32_t Hash = hash(Name);
+  uint32_t Bucket = Hash % BucketCount;
+  uint32_t Offset = BucketsOffset + Bucket * 4;
+  uint32_t Index = AccelSection.getU32(&Offset);
+  if (Index == UINT32_MAX)
+    return;
+
+  // The hashes of a bucket are contiguous; each has the offset of its data
+  // at the same index in the offsets array.
+  const uint32_t HashesOffset = BucketsOffset + BucketCount * 4;
+  const uint32_t OffsetsOffset = HashesOffset + HashCount * 4;
+  for (; Index < HashCount; ++Index) {
+    Offset = HashesOffset + Index * 4;
+    uint32_t EntryHash = AccelSection.getU32(&Offset);
+    if (EntryHash % BucketCount != Bucket)
+      break;
+    if (EntryHash != Hash)
+      continue;
+
+    Offset = OffsetsOffset + Index * 4;
+    uint32_t DataOffset = AccelSection.getU32(&Offset);
+    uint32_t StringOffset = AccelSection.getU32(&DataOffset);
+    const char *Str = StringSection.getCStr(&StringOffset);
+    if (!Str || Name != Str)
+      continue;
+
+    uint32_t NumDIEs = AccelSection.getU32(&DataOffset);
+    for (uint32_t i = 0; i != NumDIEs; ++i) {
+      for (unsigned j = 0, e = Atoms.size(); j != e; ++j) {
+        uint64_t Value;
+        if (!extractAtom(Atoms[j].Form, &DataOffset, Value))
+          return;
+        if (Atoms[j].Type == DW_ATOM_die_offset)
+          Offsets.push_back(DIEOffsetBase + Value);
+      }
+    }
+  }
+}
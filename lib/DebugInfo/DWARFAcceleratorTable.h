@@ -0,0 +1,69 @@
+//===-- DWARFAcceleratorTable.h ---------------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_DEBUGINFO_DWARFACCELERATORTABLE_H
+#define LLVM_DEBUGINFO_DWARFACCELERATORTABLE_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataExtractor.h"
+
+namespace llvm {
+
+/// DWARFAcceleratorTable - Reader for the Apple-style hash tables that
+/// DwarfAccelTable emits into the .apple_names, .apple_types and
+/// .apple_namespaces sections.  Lookups go straight to the hash bucket of a
+/// name without reading the rest of the table.
+class DWARFAcceleratorTable {
+  struct Atom {
+    uint16_t Type;
+    uint16_t Form;
+  };
+
+  DataExtractor AccelSection;
+  DataExtractor StringSection;
+
+  uint32_t BucketCount;
+  uint32_t HashCount;
+  uint32_t DIEOffsetBase;
+  SmallVector<Atom, 3> Atoms;
+  /// Offset of the buckets, followed by the hashes and the offsets.
+  uint32_t BucketsOffset;
+
+  /// extractAtom - Read a value of the given form into Value.  Returns false
+  /// for forms the tables do not use.
+  bool extractAtom(uint16_t Form, uint32_t *Offset, uint64_t &Value) const;
+
+public:
+  DWARFAcceleratorTable(StringRef AccelSection, StringRef StringSection,
+                        bool LittleEndian)
+      : AccelSection(AccelSection, LittleEndian, 0),
+        StringSection(StringSection, LittleEndian, 0), BucketCount(0),
+        HashCount(0), DIEOffsetBase(0), BucketsOffset(0) {}
+
+  /// extract - Read the table header.  Returns false if the section does
+  /// not hold a table this reader understands.
+  bool extract();
+
+  /// findDIEOffsets - Append to Offsets the .debug_info offset of every DIE
+  /// the table lists under Name.
+  void findDIEOffsets(StringRef Name, SmallVectorImpl<uint32_t> &Offsets) const;
+
+  /// hash - The hash function of the tables, DW_hash_function_djb.
+  static uint32_t hash(StringRef Str) {
+    uint32_t h = 5381;
+    for (unsigned i = 0, e = Str.size(); i != e; ++i)
+      h = ((h << 5) + h) + Str[i];
+    return h;
+  }
+};
+
+}
+
+#endif
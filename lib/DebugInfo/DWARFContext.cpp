@@ -8,13 +8,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "DWARFContext.h"
+#include "DWARFAcceleratorTable.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 using namespace llvm;
@@ -29,6 +32,37 @@ DWARFContext::~DWARFContext() {
   DeleteContainerPointers(DWOCUs);
 }
 
+namespace {
+  /// ParallelJob - Work items shared out between the threads of a
+  /// runInParallel call.
+  struct ParallelJob {
+    void (*Fn)(void *Ctx, unsigned Item);
+    void *Ctx;
+    unsigned NumItems;
+    volatile sys::cas_flag NextItem;
+  };
+}
+
+static void runParallelJob(void *Arg) {
+  ParallelJob *Job = static_cast<ParallelJob *>(Arg);
+  for (;;) {
+    unsigned Item = sys::AtomicIncrement(&Job->NextItem) - 1;
+    if (Item >= Job->NumItems)
+      return;
+    Job->Fn(Job->Ctx, Item);
+  }
+}
+
+/// runInParallel - Call Fn(Ctx, Item) for every Item below NumItems, on up to
+/// NumThreads threads, and wait for all of the calls to finish.
+static void runInParallel(unsigned NumThreads, unsigned NumItems,
+                          void (*Fn)(void *, unsigned), void *Ctx) {
+  ParallelJob Job = { Fn, Ctx, NumItems, 0 };
+  std::vector<void *> Work(std::min(NumThreads, NumItems), &Job);
+  if (!Work.empty())
+    llvm_execute_on_threads(runParallelJob, &Work[0], Work.size());
+}
+
 static void dumpPubSection(raw_ostream &OS, StringRef Name, StringRef Data,
                            bool LittleEndian, bool GnuStyle) {
   OS << "\n." << Name << " contents:\n";
@@ -66,6 +100,11 @@ void DWARFContext::dump(raw_ostream &OS, DIDumpType DumpType) {
 
   if (DumpType == DIDT_All || DumpType == DIDT_Info) {
     OS << "\n.debug_info contents:\n";
+    // Dumping keeps the DIEs of every unit, so they might as well be parsed
+    // up front.
+    std::vector<char> Extracted;
+    getNumCompileUnits();
+    extractDIEsInParallel(CUs, /*CUDieOnly=*/false, Extracted);
     for (unsigned i = 0, e = getNumCompileUnits(); i != e; ++i)
       getCompileUnitAtIndex(i)->dump(OS);
   }
@@ -256,10 +295,89 @@ const DWARFDebugFrame *DWARFContext::getDebugFrame() {
   return DebugFrame.get();
 }
 
+namespace {
+  struct ExtractDIEsJob {
+    ArrayRef<DWARFCompileUnit *> Units;
+    bool CUDieOnly;
+    std::vector<char> *Extracted;
+  };
+
+  struct LineTableJob {
+    StringRef Data;
+    bool LittleEndian;
+    const RelocAddrMap *Relocs;
+    std::vector<uint32_t> Offsets;
+    std::vector<uint8_t> AddrSizes;
+    std::vector<DWARFDebugLine::State> Tables;
+    std::vector<char> Parsed;
+  };
+}
+
+static void extractUnitDIEs(void *Ctx, unsigned Item) {
+  ExtractDIEsJob *Job = static_cast<ExtractDIEsJob *>(Ctx);
+  if (Job->Units[Item]->extractDIEsIfNeeded(Job->CUDieOnly))
+    (*Job->Extracted)[Item] = true;
+}
+
+void DWARFContext::extractDIEsInParallel(ArrayRef<DWARFCompileUnit *> Units,
+                                         bool CUDieOnly,
+                                         std::vector<char> &Extracted) {
+  Extracted.assign(Units.size(), false);
+  if (NumThreads <= 1)
+    return;
+  ExtractDIEsJob Job = { Units, CUDieOnly, &Extracted };
+  runInParallel(NumThreads, Units.size(), extractUnitDIEs, &Job);
+}
+
+static void parseLineTable(void *Ctx, unsigned Item) {
+  LineTableJob *Job = static_cast<LineTableJob *>(Ctx);
+  DataExtractor LineData(Job->Data, Job->LittleEndian, Job->AddrSizes[Item]);
+  uint32_t Offset = Job->Offsets[Item];
+  Job->Parsed[Item] = DWARFDebugLine::parseStatementTable(
+      LineData, Job->Relocs, &Offset, Job->Tables[Item]);
+}
+
+void DWARFContext::parseAllLineTables() {
+  std::vector<char> Extracted;
+  getNumCompileUnits();
+  extractDIEsInParallel(CUs, /*CUDieOnly=*/true, Extracted);
+
+  LineTableJob Job;
+  Job.Data = getLineSection().Data;
+  Job.LittleEndian = isLittleEndian();
+  Job.Relocs = Line->getRelocMap();
+  for (unsigned i = 0, e = CUs.size(); i != e; ++i) {
+    DWARFCompileUnit *CU = CUs[i];
+    const DWARFDebugInfoEntryMinimal *CUDie = CU->getCompileUnitDIE();
+    if (!CUDie)
+      continue;
+    unsigned StmtOffset =
+        CUDie->getAttributeValueAsSectionOffset(CU, DW_AT_stmt_list, -1U);
+    if (StmtOffset == -1U || Line->getLineTable(StmtOffset) ||
+        std::find(Job.Offsets.begin(), Job.Offsets.end(), StmtOffset) !=
+            Job.Offsets.end())
+      continue;
+    Job.Offsets.push_back(StmtOffset);
+    Job.AddrSizes.push_back(CU->getAddressByteSize());
+  }
+  Job.Tables.resize(Job.Offsets.size());
+  Job.Parsed.resize(Job.Offsets.size());
+  runInParallel(NumThreads, Job.Offsets.size(), parseLineTable, &Job);
+
+  // Tables that failed to parse are left for getOrParseLineTable to retry
+  // and report.
+  for (unsigned i = 0, e = Job.Offsets.size(); i != e; ++i)
+    if (Job.Parsed[i])
+      Line->addLineTable(Job.Offsets[i], Job.Tables[i]);
+}
+
 const DWARFLineTable *
 DWARFContext::getLineTableForCompileUnit(DWARFCompileUnit *cu) {
-  if (!Line)
+  if (!Line) {
     Line.reset(new DWARFDebugLine(&getLineSection().Relocs));
+    if (NumThreads > 1)
+      parseAllLineTables();
+  }
 
   unsigned stmtOffset =
       cu->getCompileUnitDIE()->getAttributeValueAsSectionOffset(
@@ -365,7 +483,32 @@ DWARFCompileUnit *DWARFContext::getCompileUnitForAddress(uint64_t Address) {
   // First, get the offset of the compile unit.
   uint32_t CUOffset = getDebugAranges()->findAddress(Address);
   // Retrieve the compile unit.
-  return getCompileUnitForOffset(CUOffset);
+  DWARFCompileUnit *CU = getCompileUnitForOffset(CUOffset);
+  if (CU && DIEMemoryBudget)
+    noteUnitQueried(CU);
+  return CU;
+}
+
+void DWARFContext::noteUnitQueried(DWARFCompileUnit *CU) {
+  // The DIEs a unit parsed during its last query are only counted now.
+  DenseMap<DWARFCompileUnit *, RecentUnitList::iterator>::iterator I =
+      RecentUnitMap.find(CU);
+  if (I != RecentUnitMap.end()) {
+    RecentDIEMemory -= I->second->second;
+    RecentUnits.erase(I->second);
+  }
+  size_t Bytes = CU->getDIEMemoryUsage();
+  RecentDIEMemory += Bytes;
+  RecentUnits.push_back(std::make_pair(CU, Bytes));
+  RecentUnitMap[CU] = --RecentUnits.end();
+
+  while (RecentDIEMemory > DIEMemoryBudget && RecentUnits.size() > 1) {
+    DWARFCompileUnit *Cold = RecentUnits.front().first;
+    RecentDIEMemory -= RecentUnits.front().second;
+    RecentUnits.pop_front();
+    RecentUnitMap.erase(Cold);
+    Cold->clearDIEs(/*KeepCUDie=*/true);
+  }
 }
 
 static bool getFileNameForCompileUnit(DWARFCompileUnit *CU,
@@ -556,6 +699,155 @@ DIInliningInfo DWARFContext::getInliningInfoForAddress(uint64_t Address,
   return InliningInfo;
 }
 
+void DWARFContext::getLineTableRanges(
+    std::vector<std::pair<uint64_t, uint64_t> > &Ranges) {
+  for (unsigned i = 0, e = getNumCompileUnits(); i != e; ++i) {
+    const DWARFLineTable *LineTable =
+        getLineTableForCompileUnit(getCompileUnitAtIndex(i));
+    if (!LineTable)
+      continue;
+    for (DWARFLineTable::SequenceIter SI = LineTable->Sequences.begin(),
+                                      SE = LineTable->Sequences.end();
+         SI != SE; ++SI) {
+      if (!SI->isValid())
+        continue;
+      // The last row of a sequence is its end_sequence row, which only marks
+      // where the previous row's range ends.
+      for (unsigned Row = SI->FirstRowIndex; Row + 1 < SI->LastRowIndex;
+           ++Row) {
+        uint64_t Start = LineTable->Rows[Row].Address;
+        uint64_t End = LineTable->Rows[Row + 1].Address;
+        if (Start < End)
+          Ranges.push_back(std::make_pair(Start, End));
+      }
+    }
+  }
+}
+
+/// findInPubSection - Append to Offsets the debug_info offset of every entry
+/// named Name in a debug_pubnames or debug_pubtypes style section.
+static void findInPubSection(StringRef Data, bool LittleEndian, bool GnuStyle,
+                             StringRef Name,
+                             SmallVectorImpl<uint32_t> &Offsets) {
+  DataExtractor PubNames(Data, LittleEndian, 0);
+  uint32_t SetOffset = 0;
+  // Each set has a 14 byte header: length, version, unit offset and size.
+  while (PubNames.isValidOffsetForDataOfSize(SetOffset, 14)) {
+    uint32_t Offset = SetOffset;
+    uint32_t Length = PubNames.getU32(&Offset);
+    uint32_t NextSetOffset = Offset + Length;
+    Offset += 2; // Version.
+    uint32_t UnitOffset = PubNames.getU32(&Offset);
+    Offset += 4; // Unit size.
+    while (Offset < NextSetOffset) {
+      uint32_t DIEOffset = PubNames.getU32(&Offset);
+      if (DIEOffset == 0)
+        break;
+      if (GnuStyle)
+        PubNames.getU8(&Offset); // Index entry descriptor.
+      const char *Str = PubNames.getCStr(&Offset);
+      if (!Str)
+        return;
+      if (Name == Str)
+        Offsets.push_back(UnitOffset + DIEOffset);
+    }
+    if (NextSetOffset <= SetOffset)
+      return;
+    SetOffset = NextSetOffset;
+  }
+}
+
+namespace {
+  struct FindNameJob {
+    ArrayRef<DWARFCompileUnit *> Units;
+    StringRef Name;
+    std::vector<SmallVector<uint32_t, 1> > Found;
+  };
+}
+
+static void findNameInUnit(void *Ctx, unsigned Item) {
+  FindNameJob *Job = static_cast<FindNameJob *>(Ctx);
+  Job->Units[Item]->findDIEOffsetsByName(Job->Name, Job->Found[Item]);
+}
+
+void DWARFContext::findDIEOffsetsByName(StringRef Name,
+                                        SmallVectorImpl<uint32_t> &Offsets) {
+  size_t OldSize = Offsets.size();
+
+  // The type indexes are only consulted along with a name index: producers
+  // that emit pubtypes without pubnames are common and leave out functions
+  // and variables.
+  DWARFAcceleratorTable AppleNames(getAppleNamesSection(), getStringSection(),
+                                   isLittleEndian());
+  bool HaveIndex = AppleNames.extract();
+  if (HaveIndex) {
+    AppleNames.findDIEOffsets(Name, Offsets);
+    StringRef AccelSections[] = { getAppleTypesSection(),
+                                  getAppleNamespacesSection() };
+    for (unsigned i = 0; i != array_lengthof(AccelSections); ++i) {
+      DWARFAcceleratorTable Table(AccelSections[i], getStringSection(),
+                                  isLittleEndian());
+      if (Table.extract())
+        Table.findDIEOffsets(Name, Offsets);
+    }
+  } else if (!getPubNamesSection().empty() ||
+             !getGnuPubNamesSection().empty()) {
+    HaveIndex = true;
+    StringRef PubSections[] = { getPubNamesSection(), getPubTypesSection(),
+                                getGnuPubNamesSection(),
+                                getGnuPubTypesSection() };
+    for (unsigned i = 0; i != array_lengthof(PubSections); ++i)
+      if (!PubSections[i].empty())
+        findInPubSection(PubSections[i], isLittleEndian(),
+                         /*GnuStyle=*/i >= 2, Name, Offsets);
+  }
+
+  if (!HaveIndex) {
+    // Nothing indexes the names; look at every DIE.
+    getNumCompileUnits();
+    if (NumThreads > 1) {
+      FindNameJob Job;
+      Job.Units = CUs;
+      Job.Name = Name;
+      Job.Found.resize(CUs.size());
+      runInParallel(NumThreads, CUs.size(), findNameInUnit, &Job);
+      for (unsigned i = 0, e = CUs.size(); i != e; ++i)
+        Offsets.append(Job.Found[i].begin(), Job.Found[i].end());
+    } else {
+      for (unsigned i = 0, e = CUs.size(); i != e; ++i)
+        CUs[i]->findDIEOffsetsByName(Name, Offsets);
+    }
+  }
+
+  std::sort(Offsets.begin() + OldSize, Offsets.end());
+  Offsets.erase(std::unique(Offsets.begin() + OldSize, Offsets.end()),
+                Offsets.end());
+}
+
+const DWARFDebugInfoEntryMinimal *
+DWARFContext::getDIEForOffset(uint32_t Offset, DWARFCompileUnit *&CU) {
+  if (CUs.empty())
+    parseCompileUnits();
+
+  // The unit holding Offset is the last one starting at or before it.
+  DWARFCompileUnit **I =
+      std::upper_bound(CUs.begin(), CUs.end(), Offset, OffsetComparator());
+  if (I == CUs.begin())
+    return 0;
+  CU = *(I - 1);
+  if (Offset >= CU->getNextUnitOffset())
+    return 0;
+  return CU->getDIEForOffset(Offset);
+}
+
+void DWARFContext::dumpDIE(raw_ostream &OS, uint32_t Offset) {
+  DWARFCompileUnit *CU = 0;
+  if (const DWARFDebugInfoEntryMinimal *DIE = getDIEForOffset(Offset, CU))
+    DIE->dump(OS, CU, -1U);
+  else
+    OS << format("\n0x%8.8x: <no DIE at this offset>\n", Offset);
+}
+
 static bool consumeCompressedDebugSectionHeader(StringRef &data,
                                                 uint64_t &OriginalSize) {
   // Consume "ZLIB" prefix.
@@ -616,6 +908,9 @@ DWARFContextInMemory::DWARFContextInMemory(object::ObjectFile *Obj) :
             .Case("debug_pubtypes", &PubTypesSection)
             .Case("debug_gnu_pubnames", &GnuPubNamesSection)
             .Case("debug_gnu_pubtypes", &GnuPubTypesSection)
+            .Case("apple_names", &AppleNamesSection)
+            .Case("apple_types", &AppleTypesSection)
+            .Case("apple_namespaces", &AppleNamespacesSection)
             .Case("debug_info.dwo", &InfoDWOSection.Data)
             .Case("debug_abbrev.dwo", &AbbrevDWOSection)
             .Case("debug_str.dwo", &StringDWOSection)
@@ -623,6 +918,9 @@ DWARFContextInMemory::DWARFContextInMemory(object::ObjectFile *Obj) :
             .Case("debug_addr", &AddrSection)
             // Any more debug info sections go here.
             .Default(0);
+    // The sections are parsed as a whole; start reading them from disk now.
+    if (Section || name == "debug_types")
+      Obj->getMemoryBuffer()->adviseAccess(MemoryBuffer::AP_WillNeed, data);
     if (Section) {
       *Section = data;
       if (name == "debug_ranges") {
@@ -643,6 +941,9 @@ DWARFContextInMemory::DWARFContextInMemory(object::ObjectFile *Obj) :
     RelocatedSection->getName(RelSecName);
     RelSecName = RelSecName.substr(
         RelSecName.find_first_not_of("._")); // Skip . and _ prefixes.
+    // Relocations against a compressed section apply to its contents.
+    if (RelSecName.startswith("zdebug_"))
+      RelSecName = RelSecName.substr(1);
 
     // TODO: Add support for relocations in other sections as needed.
     // Record relocations for the debug_info and debug_line sections.
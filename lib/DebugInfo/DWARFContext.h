@@ -17,9 +17,12 @@
 #include "DWARFDebugLoc.h"
 #include "DWARFDebugRangeList.h"
 #include "DWARFTypeUnit.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/DebugInfo/DIContext.h"
+#include <list>
 
 namespace llvm {
 
@@ -39,6 +42,20 @@ class DWARFContext : public DIContext {
   SmallVector<DWARFCompileUnit *, 1> DWOCUs;
   OwningPtr<DWARFDebugAbbrev> AbbrevDWO;
 
+  /// NumThreads - How many threads to parse with when a query needs every
+  /// compile unit.
+  unsigned NumThreads;
+
+  /// DIEMemoryBudget - How many bytes of parsed DIEs address queries may
+  /// leave behind, or 0 for no limit.
+  size_t DIEMemoryBudget;
+  /// RecentUnits - The compile units address queries looked at, least
+  /// recently used first, with the bytes of DIEs each had then.
+  typedef std::list<std::pair<DWARFCompileUnit *, size_t> > RecentUnitList;
+  RecentUnitList RecentUnits;
+  DenseMap<DWARFCompileUnit *, RecentUnitList::iterator> RecentUnitMap;
+  size_t RecentDIEMemory;
+
   DWARFContext(DWARFContext &) LLVM_DELETED_FUNCTION;
   DWARFContext &operator=(DWARFContext &) LLVM_DELETED_FUNCTION;
 
@@ -52,13 +69,23 @@ class DWARFContext : public DIContext {
   /// DWOCUs.
   void parseDWOCompileUnits();
 
+  /// parseAllLineTables - Parse the line tables of all compile units that
+  /// have not been parsed yet, spread over NumThreads threads.
+  void parseAllLineTables();
+
+  /// noteUnitQueried - Make CU the most recently queried unit, and clear the
+  /// DIEs of the least recently queried ones while over DIEMemoryBudget.
+  void noteUnitQueried(DWARFCompileUnit *CU);
+
 public:
   struct Section {
     StringRef Data;
     RelocAddrMap Relocs;
   };
 
-  DWARFContext() : DIContext(CK_DWARF) {}
+  DWARFContext()
+      : DIContext(CK_DWARF), NumThreads(1), DIEMemoryBudget(0),
+        RecentDIEMemory(0) {}
   virtual ~DWARFContext();
 
   static bool classof(const DIContext *DICtx) {
@@ -67,6 +94,23 @@ public:
 
   virtual void dump(raw_ostream &OS, DIDumpType DumpType = DIDT_All);
 
+  /// setNumThreads - Let queries that need every compile unit, such as
+  /// building the address ranges, parse up to N units at once.  With more
+  /// than one thread the first line table lookup parses every line table.
+  void setNumThreads(unsigned N) { NumThreads = N ? N : 1; }
+  unsigned getNumThreads() const { return NumThreads; }
+
+  /// setDIEMemoryBudget - Let address queries keep at most Bytes of parsed
+  /// DIEs, clearing those of the units queried least recently.  The unit of
+  /// the latest query is always kept.  0 means no limit.
+  void setDIEMemoryBudget(size_t Bytes) { DIEMemoryBudget = Bytes; }
+
+  /// extractDIEsInParallel - Extract the DIEs of Units, or just their unit
+  /// DIEs, on up to getNumThreads() threads.  Sets Extracted[i] if it
+  /// extracted anything for Units[i].  Does nothing with a single thread.
+  void extractDIEsInParallel(ArrayRef<DWARFCompileUnit *> Units,
+                             bool CUDieOnly, std::vector<char> &Extracted);
+
   /// Get the number of compile units in this context.
   unsigned getNumCompileUnits() {
     if (CUs.empty())
@@ -134,6 +178,20 @@ public:
       uint64_t Size, DILineInfoSpecifier Specifier = DILineInfoSpecifier());
   virtual DIInliningInfo getInliningInfoForAddress(uint64_t Address,
       DILineInfoSpecifier Specifier = DILineInfoSpecifier());
+  virtual void getLineTableRanges(
+      std::vector<std::pair<uint64_t, uint64_t> > &Ranges);
+
+  /// findDIEOffsetsByName - Looks Name up in the Apple accelerator tables if
+  /// there are any, or else in the pubnames and pubtypes sections.  Without
+  /// either, scans the DIEs of every compile unit.
+  virtual void findDIEOffsetsByName(StringRef Name,
+                                    SmallVectorImpl<uint32_t> &Offsets);
+  virtual void dumpDIE(raw_ostream &OS, uint32_t Offset);
+
+  /// getDIEForOffset - Get the DIE at Offset in the debug_info section and
+  /// its compile unit, or null if no DIE starts there.
+  const DWARFDebugInfoEntryMinimal *getDIEForOffset(uint32_t Offset,
+                                                    DWARFCompileUnit *&CU);
 
   virtual bool isLittleEndian() const = 0;
   virtual uint8_t getAddressSize() const = 0;
@@ -150,6 +208,9 @@ public:
   virtual StringRef getPubTypesSection() = 0;
   virtual StringRef getGnuPubNamesSection() = 0;
   virtual StringRef getGnuPubTypesSection() = 0;
+  virtual StringRef getAppleNamesSection() = 0;
+  virtual StringRef getAppleTypesSection() = 0;
+  virtual StringRef getAppleNamespacesSection() = 0;
 
   // Sections for DWARF5 split dwarf proposal.
   virtual const Section &getInfoDWOSection() = 0;
@@ -167,7 +228,7 @@ private:
   DWARFCompileUnit *getCompileUnitForOffset(uint32_t Offset);
 
   /// Return the compile unit which contains instruction with provided
-  /// address.
+  /// address, and note it as the most recently queried unit.
   DWARFCompileUnit *getCompileUnitForAddress(uint64_t Address);
 };
 
@@ -191,6 +252,9 @@ class DWARFContextInMemory : public DWARFContext {
   StringRef PubTypesSection;
   StringRef GnuPubNamesSection;
   StringRef GnuPubTypesSection;
+  StringRef AppleNamesSection;
+  StringRef AppleTypesSection;
+  StringRef AppleNamespacesSection;
 
   // Sections for DWARF5 split dwarf proposal.
   Section InfoDWOSection;
@@ -222,6 +286,11 @@ public:
   virtual StringRef getPubTypesSection() { return PubTypesSection; }
   virtual StringRef getGnuPubNamesSection() { return GnuPubNamesSection; }
   virtual StringRef getGnuPubTypesSection() { return GnuPubTypesSection; }
+  virtual StringRef getAppleNamesSection() { return AppleNamesSection; }
+  virtual StringRef getAppleTypesSection() { return AppleTypesSection; }
+  virtual StringRef getAppleNamespacesSection() {
+    return AppleNamespacesSection;
+  }
 
   // Sections for DWARF5 split dwarf proposal.
   virtual const Section &getInfoDWOSection() { return InfoDWOSection; }
@@ -59,14 +59,28 @@ void DWARFDebugAranges::generate(DWARFContext *CTX) {
   // Generate aranges from DIEs: even if .debug_aranges section is present,
   // it may describe only a small subset of compilation units, so we need to
   // manually build aranges for the rest of them.
+  SmallVector<DWARFCompileUnit *, 16> Pending;
   for (uint32_t i = 0, n = CTX->getNumCompileUnits(); i < n; ++i) {
     if (DWARFCompileUnit *CU = CTX->getCompileUnitAtIndex(i)) {
       uint32_t CUOffset = CU->getOffset();
       if (ParsedCUOffsets.insert(CUOffset).second)
-        CU->buildAddressRangeTable(this, true, CUOffset);
+        Pending.push_back(CU);
     }
   }
 
+  // Parsing the DIEs is the expensive part, and can be done for all of the
+  // units at once.  Only adding the ranges has to be done in order.
+  std::vector<char> Extracted;
+  CTX->extractDIEsInParallel(Pending, /*CUDieOnly=*/false, Extracted);
+  for (unsigned i = 0, e = Pending.size(); i != e; ++i) {
+    DWARFCompileUnit *CU = Pending[i];
+    CU->buildAddressRangeTable(this, true, CU->getOffset());
+    // Keep memory down, as buildAddressRangeTable does for the DIEs it
+    // parses itself.
+    if (Extracted[i])
+      CU->clearDIEs(true);
+  }
+
   sortAndMinimize();
 }
 
@@ -239,6 +239,12 @@ public:
   const LineTable *getLineTable(uint32_t offset) const;
   const LineTable *getOrParseLineTable(DataExtractor debug_line_data,
                                        uint32_t offset);
+  /// addLineTable - Cache a line table that was parsed separately, unless a
+  /// table at the same offset is already cached.
+  void addLineTable(uint32_t offset, const LineTable &table) {
+    LineTableMap.insert(LineTableMapTy::value_type(offset, table));
+  }
+  const RelocAddrMap *getRelocMap() const { return RelocMap; }
 
 private:
   typedef std::map<uint32_t, LineTable> LineTableMapTy;
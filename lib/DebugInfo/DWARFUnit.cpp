@@ -12,6 +12,7 @@
 #include "llvm/DebugInfo/DWARFFormValue.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/Path.h"
+#include <algorithm>
 #include <cstdio>
 
 using namespace llvm;
@@ -123,11 +124,12 @@ uint64_t DWARFUnit::getDWOId() {
       .getAttributeValueAsUnsignedConstant(this, DW_AT_GNU_dwo_id, FailValue);
 }
 
-void DWARFUnit::setDIERelations() {
-  if (DieArray.empty())
+void DWARFUnit::setDIERelations(
+    std::vector<DWARFDebugInfoEntryMinimal> &Dies) {
+  if (Dies.empty())
     return;
-  DWARFDebugInfoEntryMinimal *die_array_begin = &DieArray.front();
-  DWARFDebugInfoEntryMinimal *die_array_end = &DieArray.back();
+  DWARFDebugInfoEntryMinimal *die_array_begin = &Dies.front();
+  DWARFDebugInfoEntryMinimal *die_array_end = &Dies.back();
   DWARFDebugInfoEntryMinimal *curr_die;
   // We purposely are skipping the last element in the array in the loop below
   // so that we can always have a valid next item
@@ -210,6 +212,49 @@ void DWARFUnit::extractDIEsToVector(
                     "bounds cu 0x%8.8x at 0x%8.8x'\n", getOffset(), Offset);
 }
 
+void DWARFUnit::extractSubtreeToVector(
+    uint32_t Offset, std::vector<DWARFDebugInfoEntryMinimal> &Dies) const {
+  uint32_t NextCUOffset = getNextUnitOffset();
+  DWARFDebugInfoEntryMinimal DIE;
+  uint32_t Depth = 0;
+  while (Offset < NextCUOffset && DIE.extractFast(this, &Offset)) {
+    Dies.push_back(DIE);
+    const DWARFAbbreviationDeclaration *AbbrDecl =
+      DIE.getAbbreviationDeclarationPtr();
+    if (AbbrDecl) {
+      if (AbbrDecl->hasChildren())
+        ++Depth;
+    } else if (Depth > 0) {
+      --Depth;
+    }
+    if (Depth == 0)
+      break;
+  }
+}
+
+void DWARFUnit::indexSubprograms() {
+  SubprogramsIndexed = true;
+  uint32_t Offset = getFirstDIEOffset();
+  uint32_t NextCUOffset = getNextUnitOffset();
+  DWARFDebugInfoEntryMinimal DIE;
+  uint32_t Depth = 0;
+  while (Offset < NextCUOffset && DIE.extractFast(this, &Offset)) {
+    const DWARFAbbreviationDeclaration *AbbrDecl =
+      DIE.getAbbreviationDeclarationPtr();
+    if (AbbrDecl) {
+      if (DIE.isSubprogramDIE())
+        SubprogramOffsets.push_back(DIE.getOffset());
+      if (AbbrDecl->hasChildren())
+        ++Depth;
+    } else {
+      if (Depth > 0)
+        --Depth;
+      if (Depth == 0)
+        break;
+    }
+  }
+}
+
 size_t DWARFUnit::extractDIEsIfNeeded(bool CUDieOnly) {
   if ((CUDieOnly && DieArray.size() > 0) ||
       DieArray.size() > 1)
@@ -234,7 +279,7 @@ size_t DWARFUnit::extractDIEsIfNeeded(bool CUDieOnly) {
         this, DW_AT_GNU_ranges_base, 0);
   }
 
-  setDIERelations();
+  setDIERelations(DieArray);
   return DieArray.size();
 }
 
@@ -296,6 +341,9 @@ void DWARFUnit::clearDIEs(bool KeepCUDie) {
     if (KeepCUDie)
       DieArray.push_back(TmpArray.front());
   }
+  SubprogramsIndexed = false;
+  std::vector<uint32_t>().swap(SubprogramOffsets);
+  std::vector<DWARFDebugInfoEntryMinimal>().swap(SubprogramDieArray);
 }
 
 void
@@ -328,14 +376,77 @@ DWARFUnit::buildAddressRangeTable(DWARFDebugAranges *debug_aranges,
     clearDIEs(true);
 }
 
+namespace {
+  struct DIEOffsetComparator {
+    bool operator()(const DWARFDebugInfoEntryMinimal &LHS,
+                    uint32_t RHS) const {
+      return LHS.getOffset() < RHS;
+    }
+  };
+}
+
 const DWARFDebugInfoEntryMinimal *
-DWARFUnit::getSubprogramForAddress(uint64_t Address) {
+DWARFUnit::getDIEForOffset(uint32_t Offset) {
   extractDIEsIfNeeded(false);
-  for (size_t i = 0, n = DieArray.size(); i != n; i++)
-    if (DieArray[i].isSubprogramDIE() &&
-        DieArray[i].addressRangeContainsAddress(this, Address)) {
-      return &DieArray[i];
-    }
+  std::vector<DWARFDebugInfoEntryMinimal>::const_iterator I =
+      std::lower_bound(DieArray.begin(), DieArray.end(), Offset,
+                       DIEOffsetComparator());
+  if (I == DieArray.end() || I->getOffset() != Offset)
+    return 0;
+  return &*I;
+}
+
+void DWARFUnit::findDIEOffsetsByName(StringRef Name,
+                                     SmallVectorImpl<uint32_t> &Offsets) {
+  const bool clear_dies = extractDIEsIfNeeded(false) > 1;
+  for (size_t i = 0, n = DieArray.size(); i != n; i++) {
+    const DWARFDebugInfoEntryMinimal &DIE = DieArray[i];
+    if (DIE.isNULL())
+      continue;
+    const char *DIEName = DIE.getAttributeValueAsString(this, DW_AT_name, 0);
+    if (!DIEName || Name != DIEName)
+      DIEName = DIE.getAttributeValueAsString(this, DW_AT_MIPS_linkage_name,
+                                              0);
+    if (!DIEName || Name != DIEName)
+      DIEName = DIE.getAttributeValueAsString(this, DW_AT_linkage_name, 0);
+    if (DIEName && Name == DIEName)
+      Offsets.push_back(DIE.getOffset());
+  }
+  if (clear_dies)
+    clearDIEs(true);
+}
+
+const DWARFDebugInfoEntryMinimal *
+DWARFUnit::getSubprogramForAddress(uint64_t Address) {
+  // Search all the DIEs if they are parsed already.
+  if (DieArray.size() > 1) {
+    for (size_t i = 0, n = DieArray.size(); i != n; i++)
+      if (DieArray[i].isSubprogramDIE() &&
+          DieArray[i].addressRangeContainsAddress(this, Address)) {
+        return &DieArray[i];
+      }
+    return 0;
+  }
+
+  // Otherwise only parse the subprogram that contains Address.  The unit DIE
+  // gives the base address and range list base the ranges are relative to.
+  extractDIEsIfNeeded(true);
+  if (!SubprogramDieArray.empty() &&
+      SubprogramDieArray[0].addressRangeContainsAddress(this, Address))
+    return &SubprogramDieArray[0];
+  if (!SubprogramsIndexed)
+    indexSubprograms();
+  DWARFDebugInfoEntryMinimal DIE;
+  for (size_t i = 0, n = SubprogramOffsets.size(); i != n; i++) {
+    uint32_t Offset = SubprogramOffsets[i];
+    if (!DIE.extractFast(this, &Offset) ||
+        !DIE.addressRangeContainsAddress(this, Address))
+      continue;
+    SubprogramDieArray.clear();
+    extractSubtreeToVector(SubprogramOffsets[i], SubprogramDieArray);
+    setDIERelations(SubprogramDieArray);
+    return &SubprogramDieArray[0];
+  }
   return 0;
 }
 
@@ -48,6 +48,12 @@ class DWARFUnit {
   uint64_t BaseAddr;
   // The compile unit debug information entry items.
   std::vector<DWARFDebugInfoEntryMinimal> DieArray;
+  // Address lookups in a unit whose DIEs have not all been extracted only
+  // keep the offsets of its subprogram DIEs, and the DIEs of the subprogram
+  // found last.
+  bool SubprogramsIndexed;
+  std::vector<uint32_t> SubprogramOffsets;
+  std::vector<DWARFDebugInfoEntryMinimal> SubprogramDieArray;
 
   class DWOHolder {
     OwningPtr<object::ObjectFile> DWOFile;
@@ -139,19 +145,47 @@ public:
   /// chain is valid as long as parsed compile unit DIEs are not cleared.
   DWARFDebugInfoEntryInlinedChain getInlinedChainForAddress(uint64_t Address);
 
-private:
   /// extractDIEsIfNeeded - Parses a compile unit and indexes its DIEs if it
   /// hasn't already been done. Returns the number of DIEs parsed at this call.
+  /// Units share no mutable state, so different units may be extracted on
+  /// different threads at the same time.
   size_t extractDIEsIfNeeded(bool CUDieOnly);
+  /// clearDIEs - Clear parsed DIEs to keep memory usage low.
+  void clearDIEs(bool KeepCUDie);
+  /// getDIEMemoryUsage - Returns the number of bytes the DIEs parsed so far
+  /// take up.
+  size_t getDIEMemoryUsage() const {
+    return (DieArray.capacity() + SubprogramDieArray.capacity()) *
+               sizeof(DWARFDebugInfoEntryMinimal) +
+           SubprogramOffsets.capacity() * sizeof(uint32_t);
+  }
+
+  /// getDIEForOffset - Returns the DIE that starts at Offset in the section,
+  /// or null if no DIE of this unit does.  Parses all the DIEs of the unit.
+  const DWARFDebugInfoEntryMinimal *getDIEForOffset(uint32_t Offset);
+
+  /// findDIEOffsetsByName - Appends to Offsets the offset of every DIE whose
+  /// name or linkage name is Name.  DIEs parsed only for the search are
+  /// cleared again afterwards.
+  void findDIEOffsetsByName(StringRef Name,
+                            SmallVectorImpl<uint32_t> &Offsets);
+
+private:
   /// extractDIEsToVector - Appends all parsed DIEs to a vector.
   void extractDIEsToVector(bool AppendCUDie, bool AppendNonCUDIEs,
                            std::vector<DWARFDebugInfoEntryMinimal> &DIEs) const;
+  /// extractSubtreeToVector - Appends the DIE at Offset and all of its
+  /// descendants to a vector.
+  void extractSubtreeToVector(uint32_t Offset,
+                              std::vector<DWARFDebugInfoEntryMinimal> &Dies)
+      const;
+  /// indexSubprograms - Walks the DIEs of the unit, without keeping them, to
+  /// record the offsets of its subprogram DIEs.
+  void indexSubprograms();
   /// setDIERelations - We read in all of the DIE entries into our flat list
   /// of DIE entries and now we need to go back through all of them and set the
   /// parent, sibling and child pointers for quick DIE navigation.
-  void setDIERelations();
-  /// clearDIEs - Clear parsed DIEs to keep memory usage low.
-  void clearDIEs(bool KeepCUDie);
+  static void setDIERelations(std::vector<DWARFDebugInfoEntryMinimal> &Dies);
 
   /// parseDWO - Parses .dwo file for current compile unit. Returns true if
   /// it was actually constructed.
@@ -159,7 +193,8 @@ private:
 
   /// getSubprogramForAddress - Returns subprogram DIE with address range
   /// encompassing the provided address. The pointer is alive as long as parsed
-  /// compile unit DIEs are not cleared.
+  /// compile unit DIEs are not cleared and, unless all of them were parsed
+  /// already, until the next call.  Only the subprogram found is parsed.
   const DWARFDebugInfoEntryMinimal *getSubprogramForAddress(uint64_t Address);
 };
 
@@ -66,6 +66,7 @@ ExecutionEngine::ExecutionEngine(Module *M)
   CompilingLazily         = false;
   GVCompilationDisabled   = false;
   SymbolSearchingDisabled = false;
+  ObjectDataDiscarded     = false;
   Modules.push_back(M);
   assert(M && "Module is null?");
 }
@@ -133,7 +134,7 @@ Function *ExecutionEngine::FindFunctionNamed(const char *FnName) {
 }
 
 
-void *ExecutionEngineState::RemoveMapping(const MutexGuard &,
+void *ExecutionEngineState::RemoveMapping(const MutexGuard &Guard,
                                           const GlobalValue *ToUnmap) {
   GlobalAddressMapTy::iterator I = GlobalAddressMap.find(ToUnmap);
   void *OldVal;
@@ -148,9 +149,29 @@ void *ExecutionEngineState::RemoveMapping(const MutexGuard &,
   }
 
   GlobalAddressReverseMap.erase(OldVal);
+  updateLookupMap(Guard, ToUnmap, 0);
   return OldVal;
 }
 
+void ExecutionEngineState::updateLookupMap(const MutexGuard &,
+                                           const GlobalValue *GV, void *Addr) {
+  sys::ScopedWriter Writer(LookupLock);
+  if (Addr)
+    GlobalAddressLookupMap[GV] = Addr;
+  else
+    GlobalAddressLookupMap.erase(GV);
+}
+
+void ExecutionEngineState::clearLookupMap(const MutexGuard &) {
+  sys::ScopedWriter Writer(LookupLock);
+  GlobalAddressLookupMap.clear();
+}
+
+void *ExecutionEngineState::lookupAddress(const GlobalValue *GV) {
+  sys::ScopedReader Reader(LookupLock);
+  return GlobalAddressLookupMap.lookup(GV);
+}
+
 void ExecutionEngine::addGlobalMapping(const GlobalValue *GV, void *Addr) {
   MutexGuard locked(lock);
 
@@ -159,6 +180,7 @@ void ExecutionEngine::addGlobalMapping(const GlobalValue *GV, void *Addr) {
   void *&CurVal = EEState.getGlobalAddressMap(locked)[GV];
   assert((CurVal == 0 || Addr == 0) && "GlobalMapping already established!");
   CurVal = Addr;
+  EEState.updateLookupMap(locked, GV, Addr);
 
   // If we are using the reverse mapping, add it too.
   if (!EEState.getGlobalAddressReverseMap(locked).empty()) {
@@ -174,6 +196,7 @@ void ExecutionEngine::clearAllGlobalMappings() {
 
   EEState.getGlobalAddressMap(locked).clear();
   EEState.getGlobalAddressReverseMap(locked).clear();
+  EEState.clearLookupMap(locked);
 }
 
 void ExecutionEngine::clearGlobalMappingsFromModule(Module *M) {
@@ -202,6 +225,7 @@ void *ExecutionEngine::updateGlobalMapping(const GlobalValue *GV, void *Addr) {
   if (CurVal && !EEState.getGlobalAddressReverseMap(locked).empty())
     EEState.getGlobalAddressReverseMap(locked).erase(CurVal);
   CurVal = Addr;
+  EEState.updateLookupMap(locked, GV, Addr);
 
   // If we are using the reverse mapping, add it too.
   if (!EEState.getGlobalAddressReverseMap(locked).empty()) {
@@ -214,11 +238,9 @@ void *ExecutionEngine::updateGlobalMapping(const GlobalValue *GV, void *Addr) {
 }
 
 void *ExecutionEngine::getPointerToGlobalIfAvailable(const GlobalValue *GV) {
-  MutexGuard locked(lock);
-
-  ExecutionEngineState::GlobalAddressMapTy::iterator I =
-    EEState.getGlobalAddressMap(locked).find(GV);
-  return I != EEState.getGlobalAddressMap(locked).end() ? I->second : 0;
+  // This is called a lot, from any thread, so it doesn't take the engine
+  // lock.
+  return EEState.lookupAddress(GV);
 }
 
 const GlobalValue *ExecutionEngine::getGlobalValueAtAddress(void *Addr) {
@@ -1325,6 +1347,9 @@ void ExecutionEngineState::AddressMapConfig::onDelete(ExecutionEngineState *EES,
                                                       const GlobalValue *Old) {
   void *OldVal = EES->GlobalAddressMap.lookup(Old);
   EES->GlobalAddressReverseMap.erase(OldVal);
+  // The engine lock is held by the ValueMap.
+  sys::ScopedWriter Writer(EES->LookupLock);
+  EES->GlobalAddressLookupMap.erase(Old);
 }
 
 void ExecutionEngineState::AddressMapConfig::onRAUW(ExecutionEngineState *,
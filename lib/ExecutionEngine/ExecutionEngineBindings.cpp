@@ -15,6 +15,7 @@
 #include "llvm-c/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Module.h"
@@ -334,6 +335,27 @@ void *LLVMGetPointerToGlobal(LLVMExecutionEngineRef EE, LLVMValueRef Global) {
   return unwrap(EE)->getPointerToGlobal(unwrap<GlobalValue>(Global));
 }
 
+uint64_t LLVMGetFunctionAddress(LLVMExecutionEngineRef EE, const char *Name) {
+  return unwrap(EE)->getFunctionAddress(Name);
+}
+
+void LLVMRequestFunctionAddress(LLVMExecutionEngineRef EE, const char *Name) {
+  unwrap(EE)->requestFunctionAddress(Name);
+}
+
+uint64_t LLVMGetFunctionAddressIfReady(LLVMExecutionEngineRef EE,
+                                       const char *Name) {
+  return unwrap(EE)->getFunctionAddressIfReady(Name);
+}
+
+void LLVMGenerateCodeForModule(LLVMExecutionEngineRef EE, LLVMModuleRef M) {
+  unwrap(EE)->generateCodeForModule(unwrap(M));
+}
+
+void LLVMFinalizeObject(LLVMExecutionEngineRef EE) {
+  unwrap(EE)->finalizeObject();
+}
+
 /*===-- Operations on memory managers -------------------------------------===*/
 
 namespace {
@@ -437,3 +459,63 @@ void LLVMDisposeMCJITMemoryManager(LLVMMCJITMemoryManagerRef MM) {
   delete unwrap(MM);
 }
 
+
+/*===-- Operations on object caches ---------------------------------------===*/
+
+namespace {
+
+struct SimpleBindingOCFunctions {
+  LLVMObjectCacheNotifyObjectCompiledCallback NotifyObjectCompiled;
+  LLVMObjectCacheGetObjectCallback GetObject;
+  LLVMObjectCacheDestroyCallback Destroy;
+};
+
+class SimpleBindingObjectCache : public ObjectCache {
+public:
+  SimpleBindingObjectCache(const SimpleBindingOCFunctions &Functions,
+                           void *Opaque)
+    : Functions(Functions), Opaque(Opaque) {}
+  virtual ~SimpleBindingObjectCache() {
+    Functions.Destroy(Opaque);
+  }
+
+  virtual void notifyObjectCompiled(const Module *M, const MemoryBuffer *Obj) {
+    Functions.NotifyObjectCompiled(Opaque, wrap(M), Obj->getBufferStart(),
+                                   Obj->getBufferSize());
+  }
+
+  virtual MemoryBuffer *getObject(const Module *M) {
+    return unwrap(Functions.GetObject(Opaque, wrap(M)));
+  }
+
+private:
+  SimpleBindingOCFunctions Functions;
+  void *Opaque;
+};
+
+} // anonymous namespace
+
+LLVMMCJITObjectCacheRef LLVMCreateSimpleMCJITObjectCache(
+  void *Opaque,
+  LLVMObjectCacheNotifyObjectCompiledCallback NotifyObjectCompiled,
+  LLVMObjectCacheGetObjectCallback GetObject,
+  LLVMObjectCacheDestroyCallback Destroy) {
+
+  if (!NotifyObjectCompiled || !GetObject || !Destroy)
+    return NULL;
+
+  SimpleBindingOCFunctions functions;
+  functions.NotifyObjectCompiled = NotifyObjectCompiled;
+  functions.GetObject = GetObject;
+  functions.Destroy = Destroy;
+  return wrap(new SimpleBindingObjectCache(functions, Opaque));
+}
+
+void LLVMDisposeMCJITObjectCache(LLVMMCJITObjectCacheRef Cache) {
+  delete unwrap(Cache);
+}
+
+void LLVMSetMCJITObjectCache(LLVMExecutionEngineRef EE,
+                             LLVMMCJITObjectCacheRef Cache) {
+  unwrap(EE)->setObjectCache(unwrap(Cache));
+}
@@ -0,0 +1,195 @@
+//===-- FileObjectCache.cpp - Object cache backed by a directory ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the FileObjectCache class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+
+using namespace llvm;
+
+static const char CachePrefix[] = "llvmcache-";
+
+FileObjectCache::FileObjectCache(StringRef Dir, const TargetMachine &TM,
+                                 uint64_t MaxSize)
+  : CacheDir(Dir), MaxCacheSize(MaxSize) {
+  sys::fs::create_directories(CacheDir.str());
+
+  // Everything about the target machine that can change the generated code
+  // goes into the key.
+  const TargetOptions &O = TM.Options;
+  raw_string_ostream OS(TargetKey);
+  OS << TM.getTargetTriple() << '\0' << TM.getTargetCPU() << '\0'
+     << TM.getTargetFeatureString() << '\0' << TM.getRelocationModel() << ' '
+     << TM.getCodeModel() << ' ' << TM.getOptLevel() << ' '
+     << O.NoFramePointerElim << O.LessPreciseFPMADOption << O.UnsafeFPMath
+     << O.NoInfsFPMath << O.NoNaNsFPMath
+     << O.HonorSignDependentRoundingFPMathOption << O.UseSoftFloat
+     << O.NoZerosInBSS << O.JITEmitDebugInfo << O.GuaranteedTailCallOpt
+     << O.DisableTailCalls << O.EnableFastISel
+     << O.PositionIndependentExecutable << O.EnableSegmentedStacks
+     << O.UseInitArray << O.CompressDebugSections << ' ' << O.StackAlignmentOverride << ' '
+     << O.FloatABIType << ' ' << O.AllowFPOpFusion << ' ' << O.TrapFuncName;
+  OS.flush();
+}
+
+FileObjectCache::~FileObjectCache() {}
+
+std::string FileObjectCache::computeKey(const Module *M) const {
+  SmallString<0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(M, OS);
+  }
+
+  MD5 Hash;
+  Hash.update(TargetKey);
+  Hash.update(StringRef("\0", 1));
+  Hash.update(M->getTargetTriple().empty() ? sys::getProcessTriple()
+                                           : M->getTargetTriple());
+  Hash.update(Bitcode.str());
+
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+void FileObjectCache::getObjectPath(StringRef Key,
+                                    SmallVectorImpl<char> &Path) const {
+  Path.clear();
+  Path.append(CacheDir.begin(), CacheDir.end());
+  sys::path::append(Path, CachePrefix + Key + ".o");
+}
+
+MemoryBuffer *FileObjectCache::getObject(const Module *M) {
+  std::string Key = computeKey(M);
+  SmallString<128> Path;
+  getObjectPath(Key, Path);
+
+  OwningPtr<MemoryBuffer> Obj;
+  if (MemoryBuffer::getFile(Path.str(), Obj, -1, false)) {
+    PendingKeys[M] = Key;
+    return 0;
+  }
+
+  // Mark the object as recently used for pruning.
+  int FD;
+  if (!sys::fs::openFileForWrite(Path.str(), FD, sys::fs::F_Append)) {
+    sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+    raw_fd_ostream Closer(FD, /*shouldClose=*/true);
+  }
+  return Obj.take();
+}
+
+void FileObjectCache::notifyObjectCompiled(const Module *M,
+                                           const MemoryBuffer *Obj) {
+  std::string Key;
+  DenseMap<const Module *, std::string>::iterator I = PendingKeys.find(M);
+  if (I != PendingKeys.end()) {
+    Key = I->second;
+    PendingKeys.erase(I);
+  } else {
+    Key = computeKey(M);
+  }
+
+  SmallString<128> Path;
+  getObjectPath(Key, Path);
+
+  // If another process is writing the same object, let it.
+  LockFileManager Lock(Path.str());
+  if (Lock != LockFileManager::LFS_Owned)
+    return;
+
+  // Write the object to a temporary file and move it into place, so that the
+  // object file appears atomically.
+  SmallString<128> TempPath;
+  int FD;
+  if (sys::fs::createUniqueFile(Path.str() + ".%%%%%%.tmp", FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Obj->getBuffer();
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath.str());
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath.str(), Path.str())) {
+    sys::fs::remove(TempPath.str());
+    return;
+  }
+
+  if (MaxCacheSize)
+    prune();
+}
+
+namespace {
+struct CacheEntry {
+  sys::TimeValue LastUsed;
+  uint64_t Size;
+  std::string Path;
+
+  bool operator<(const CacheEntry &RHS) const {
+    return LastUsed < RHS.LastUsed;
+  }
+};
+}
+
+/// prune - Delete the least recently used objects until the cache fits in
+/// MaxCacheSize.  Only one process prunes a directory at a time.
+void FileObjectCache::prune() {
+  SmallString<128> LockPath(CacheDir);
+  sys::path::append(LockPath, "llvmcache.prune");
+  LockFileManager Lock(LockPath.str());
+  if (Lock != LockFileManager::LFS_Owned)
+    return;
+
+  std::vector<CacheEntry> Entries;
+  uint64_t TotalSize = 0;
+  error_code EC;
+  for (sys::fs::directory_iterator DI(CacheDir.str(), EC), DE; !EC && DI != DE;
+       DI.increment(EC)) {
+    StringRef Name = sys::path::filename(DI->path());
+    if (!Name.startswith(CachePrefix) || !Name.endswith(".o"))
+      continue;
+    sys::fs::file_status Status;
+    if (DI->status(Status) || !sys::fs::is_regular_file(Status))
+      continue;
+    CacheEntry Entry;
+    Entry.LastUsed = Status.getLastModificationTime();
+    Entry.Size = Status.getSize();
+    Entry.Path = DI->path();
+    TotalSize += Entry.Size;
+    Entries.push_back(Entry);
+  }
+
+  std::sort(Entries.begin(), Entries.end());
+  for (unsigned i = 0, e = Entries.size(); i != e && TotalSize > MaxCacheSize;
+       ++i) {
+    if (!sys::fs::remove(Entries[i].Path))
+      TotalSize -= Entries[i].Size;
+  }
+}
@@ -0,0 +1,721 @@
+//===-- Dispatch.cpp - Pre-decoded instruction dispatch -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements the interpreter's dispatch loop.  The first time a
+//  function is called it is decoded: every argument and instruction result
+//  gets a slot in the stack frame, constant operands are evaluated once into
+//  a pool, and the instructions that dominate typical code (integer and
+//  pointer arithmetic up to 64 bits, comparisons, casts, scalar floating
+//  point, loads, stores, GEPs and branches) are specialized to operate on
+//  slots directly.  PHI nodes become copies on the CFG edges.  Anything else,
+//  and any specialized instruction that hits an edge case such as a division
+//  by zero, is run by the InstVisitor on the IR, so both paths share one
+//  frame layout.  With GCC-compatible compilers the loop dispatches with
+//  computed gotos.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "interpreter"
+#include "Interpreter.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/GetElementPtrTypeIterator.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MathExtras.h"
+#include <cstring>
+using namespace llvm;
+
+STATISTIC(NumDynamicInsts, "Number of dynamic instructions executed");
+STATISTIC(NumDecoded, "Number of functions decoded for dispatch");
+
+#if defined(__GNUC__)
+#define INTERPRETER_THREADED_DISPATCH 1
+#else
+#define INTERPRETER_THREADED_DISPATCH 0
+#endif
+
+namespace {
+  // DecodedOp - What the dispatch loop does for a DecodedInst.  Keep this in
+  // sync with the dispatch table in runFrame.
+  enum DecodedOp {
+    OpVisit,      // Run the InstVisitor, then continue with the next one
+    OpLeave,      // Run the InstVisitor, which may call or return
+    OpAdd, OpSub, OpMul, OpUDiv, OpSDiv, OpURem, OpSRem,
+    OpAnd, OpOr, OpXor, OpShl, OpLShr, OpAShr,
+    OpICmp,       // Aux is the predicate
+    OpFAdd, OpFSub, OpFMul, OpFDiv, // Aux is nonzero for double
+    OpZExt, OpSExt, OpTrunc, // Aux is the source width
+    OpPtrToInt, OpIntToPtr, OpPtrCopy,
+    OpSelect,
+    OpGEPConst,   // Src[0] + Imm
+    OpGEPIndex,   // Src[0] + Imm + Src[1] * Aux, Src[1] being Width bits
+    OpLoad, OpStore, // Width is the size in bytes, Aux a MemKind
+    OpBr,         // Take edge Src[1]
+    OpCondBr      // Take edge Src[1] if Src[0] is true, else edge Src[2]
+  };
+
+  // MemKind - How a decoded load or store accesses memory.
+  enum MemKind { MemInt, MemPtr, MemFloat, MemDouble };
+}
+
+/// isFastInt - Return true if Ty is a scalar integer that fits in 64 bits.
+static bool isFastInt(Type *Ty) {
+  IntegerType *ITy = dyn_cast<IntegerType>(Ty);
+  return ITy && ITy->getBitWidth() <= 64;
+}
+
+static unsigned getWidth(Type *Ty) {
+  return cast<IntegerType>(Ty)->getBitWidth();
+}
+
+static inline uint64_t getInt(const GenericValue &V) {
+  return V.IntVal.getZExtValue();
+}
+
+static inline void setInt(GenericValue &V, unsigned Width, uint64_t X) {
+  V.IntVal = APInt(Width, X);
+}
+
+static inline bool compareInts(unsigned Pred, uint64_t A, uint64_t B,
+                               unsigned Width) {
+  switch (Pred) {
+  default: llvm_unreachable("Invalid integer predicate!");
+  case ICmpInst::ICMP_EQ:  return A == B;
+  case ICmpInst::ICMP_NE:  return A != B;
+  case ICmpInst::ICMP_ULT: return A < B;
+  case ICmpInst::ICMP_ULE: return A <= B;
+  case ICmpInst::ICMP_UGT: return A > B;
+  case ICmpInst::ICMP_UGE: return A >= B;
+  case ICmpInst::ICMP_SLT: return SignExtend64(A, Width) <
+                                  SignExtend64(B, Width);
+  case ICmpInst::ICMP_SLE: return SignExtend64(A, Width) <=
+                                  SignExtend64(B, Width);
+  case ICmpInst::ICMP_SGT: return SignExtend64(A, Width) >
+                                  SignExtend64(B, Width);
+  case ICmpInst::ICMP_SGE: return SignExtend64(A, Width) >=
+                                  SignExtend64(B, Width);
+  }
+}
+
+DecodedFunction *Interpreter::getDecodedFunction(Function *F,
+                                                 ExecutionContext &SF) {
+  DecodedFunction *&DF = DecodedFunctions[F];
+  if (!DF) {
+    DF = new DecodedFunction();
+    decodeFunction(F, *DF, SF);
+  } else if (DF->ModificationCount != F->getModificationCount()) {
+    decodeFunction(F, *DF, SF);
+  }
+  return DF;
+}
+
+void Interpreter::destroyDecodedFunctions() {
+  for (DenseMap<Function*, DecodedFunction*>::iterator
+         I = DecodedFunctions.begin(), E = DecodedFunctions.end(); I != E; ++I)
+    delete I->second;
+  DecodedFunctions.clear();
+}
+
+/// decodeFunction - (Re)build DF from the body of F.  Values keep the slots
+/// they were given by earlier decodings, so frames of F that are already on
+/// the stack stay valid; they only need to grow to the new NumSlots.
+void Interpreter::decodeFunction(Function *F, DecodedFunction &DF,
+                                 ExecutionContext &SF) {
+  ++NumDecoded;
+  DF.ModificationCount = F->getModificationCount();
+
+  // Constants are cheap to evaluate again, and may have been destroyed.
+  for (DenseMap<const Value*, unsigned>::iterator I = DF.Slots.begin(),
+         E = DF.Slots.end(); I != E; ++I)
+    if (I->second & DecodedFunction::ConstantBit)
+      DF.Slots.erase(I);
+  DF.Constants.clear();
+
+  SmallVector<Value*, 32> Values;
+  for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end();
+       AI != E; ++AI)
+    Values.push_back(AI);
+  DenseMap<BasicBlock*, unsigned> BlockStarts;
+  unsigned NumInsts = 0;
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    BlockStarts[BB] = NumInsts;
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      if (!I->getType()->isVoidTy())
+        Values.push_back(I);
+      if (!isa<PHINode>(I))
+        ++NumInsts;
+    }
+  }
+  for (unsigned i = 0, e = Values.size(); i != e; ++i) {
+    std::pair<DenseMap<const Value*, unsigned>::iterator, bool> R =
+      DF.Slots.insert(std::make_pair(Values[i], DF.NumSlots));
+    if (R.second)
+      ++DF.NumSlots;
+  }
+
+  DF.Insts.clear();
+  DF.Insts.reserve(NumInsts);
+  DF.Index.clear();
+  DF.Edges.clear();
+  DF.Moves.clear();
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    for (BasicBlock::iterator I = BB->getFirstNonPHI(), IE = BB->end();
+         I != IE; ++I) {
+      DF.Index[I] = DF.Insts.size();
+      decodeInstruction(*I, DF, BlockStarts, SF);
+    }
+}
+
+/// getOperandCode - Return the frame slot of V, or its index in the constant
+/// pool with ConstantBit set.
+unsigned Interpreter::getOperandCode(Value *V, DecodedFunction &DF,
+                                     ExecutionContext &SF) {
+  if (!isa<Constant>(V))
+    return DF.getSlot(V);
+
+  unsigned Code = DF.Constants.size() | DecodedFunction::ConstantBit;
+  std::pair<DenseMap<const Value*, unsigned>::iterator, bool> R =
+    DF.Slots.insert(std::make_pair(V, Code));
+  if (!R.second) {
+    if (R.first->second & DecodedFunction::ConstantBit)
+      return R.first->second;
+    // The slot of a deleted value whose memory now holds this constant.
+    R.first->second = Code;
+  }
+  DF.Constants.push_back(getOperandValue(V, SF));
+  return Code;
+}
+
+/// getEdge - Return the number of a new edge from From to To, along with the
+/// copies that set the PHI nodes of To.
+unsigned
+Interpreter::getEdge(BasicBlock *From, BasicBlock *To, DecodedFunction &DF,
+                     const DenseMap<BasicBlock*, unsigned> &BlockStarts,
+                     ExecutionContext &SF) {
+  DecodedEdge Edge;
+  Edge.Target = To;
+  Edge.TargetIndex = BlockStarts.lookup(To);
+  Edge.MovesBegin = DF.Moves.size();
+  for (BasicBlock::iterator I = To->begin(); PHINode *PN = dyn_cast<PHINode>(I);
+       ++I) {
+    unsigned Src = getOperandCode(PN->getIncomingValueForBlock(From), DF, SF);
+    DF.Moves.push_back(std::make_pair(DF.getSlot(PN), Src));
+  }
+  Edge.MovesEnd = DF.Moves.size();
+  DF.Edges.push_back(Edge);
+  return DF.Edges.size() - 1;
+}
+
+void Interpreter::decodeInstruction(Instruction &I, DecodedFunction &DF,
+                            const DenseMap<BasicBlock*, unsigned> &BlockStarts,
+                                    ExecutionContext &SF) {
+  DecodedInst D;
+  D.Op = OpVisit;
+  D.Width = D.Aux = 0;
+  D.Dest = I.getType()->isVoidTy() ? 0 : DF.getSlot(&I);
+  D.Src[0] = D.Src[1] = D.Src[2] = 0;
+  D.Imm = 0;
+  D.Inst = &I;
+
+  Type *Ty = I.getType();
+  bool HostLayout = TD.isLittleEndian() == sys::IsLittleEndianHost &&
+                    TD.getPointerSizeInBits() == sizeof(void*) * 8;
+
+  switch (I.getOpcode()) {
+  default:
+    break;
+  case Instruction::Call:
+  case Instruction::Invoke:
+  case Instruction::Ret:
+    D.Op = OpLeave;
+    break;
+
+  case Instruction::Add:  case Instruction::Sub:  case Instruction::Mul:
+  case Instruction::UDiv: case Instruction::SDiv: case Instruction::URem:
+  case Instruction::SRem: case Instruction::And:  case Instruction::Or:
+  case Instruction::Xor:  case Instruction::Shl:  case Instruction::LShr:
+  case Instruction::AShr: {
+    if (!isFastInt(Ty))
+      break;
+    static const unsigned char Ops[] = {
+      OpAdd, OpSub, OpMul, OpUDiv, OpSDiv, OpURem, OpSRem,
+      OpAnd, OpOr, OpXor, OpShl, OpLShr, OpAShr
+    };
+    unsigned Opcodes[] = {
+      Instruction::Add, Instruction::Sub, Instruction::Mul,
+      Instruction::UDiv, Instruction::SDiv, Instruction::URem,
+      Instruction::SRem, Instruction::And, Instruction::Or,
+      Instruction::Xor, Instruction::Shl, Instruction::LShr,
+      Instruction::AShr
+    };
+    for (unsigned i = 0; i != array_lengthof(Opcodes); ++i)
+      if (Opcodes[i] == I.getOpcode())
+        D.Op = Ops[i];
+    D.Width = getWidth(Ty);
+    D.Src[0] = getOperandCode(I.getOperand(0), DF, SF);
+    D.Src[1] = getOperandCode(I.getOperand(1), DF, SF);
+    break;
+  }
+
+  case Instruction::FAdd: case Instruction::FSub:
+  case Instruction::FMul: case Instruction::FDiv:
+    if (!Ty->isFloatTy() && !Ty->isDoubleTy())
+      break;
+    D.Op = I.getOpcode() == Instruction::FAdd ? OpFAdd :
+           I.getOpcode() == Instruction::FSub ? OpFSub :
+           I.getOpcode() == Instruction::FMul ? OpFMul : OpFDiv;
+    D.Aux = Ty->isDoubleTy();
+    D.Src[0] = getOperandCode(I.getOperand(0), DF, SF);
+    D.Src[1] = getOperandCode(I.getOperand(1), DF, SF);
+    break;
+
+  case Instruction::ICmp: {
+    ICmpInst &CI = cast<ICmpInst>(I);
+    Type *OpTy = CI.getOperand(0)->getType();
+    if (isFastInt(OpTy)) {
+      D.Width = getWidth(OpTy);
+      D.Aux = CI.getPredicate();
+    } else if (OpTy->isPointerTy()) {
+      // Pointers are compared as unsigned host addresses.
+      D.Width = 64;
+      D.Aux = CI.getUnsignedPredicate();
+    } else {
+      break;
+    }
+    D.Op = OpICmp;
+    D.Src[0] = getOperandCode(CI.getOperand(0), DF, SF);
+    D.Src[1] = getOperandCode(CI.getOperand(1), DF, SF);
+    if (OpTy->isPointerTy())
+      D.Src[2] = 1;
+    break;
+  }
+
+  case Instruction::ZExt: case Instruction::SExt: case Instruction::Trunc: {
+    Type *SrcTy = I.getOperand(0)->getType();
+    if (!isFastInt(Ty) || !isFastInt(SrcTy))
+      break;
+    D.Op = I.getOpcode() == Instruction::ZExt ? OpZExt :
+           I.getOpcode() == Instruction::SExt ? OpSExt : OpTrunc;
+    D.Width = getWidth(Ty);
+    D.Aux = getWidth(SrcTy);
+    D.Src[0] = getOperandCode(I.getOperand(0), DF, SF);
+    break;
+  }
+
+  case Instruction::PtrToInt:
+    if (!isFastInt(Ty) || Ty->isVectorTy() ||
+        I.getOperand(0)->getType()->isVectorTy())
+      break;
+    D.Op = OpPtrToInt;
+    D.Width = getWidth(Ty);
+    D.Src[0] = getOperandCode(I.getOperand(0), DF, SF);
+    break;
+
+  case Instruction::IntToPtr: {
+    Type *SrcTy = I.getOperand(0)->getType();
+    if (!isFastInt(SrcTy) || getWidth(SrcTy) != TD.getPointerSizeInBits() ||
+        !HostLayout)
+      break;
+    D.Op = OpIntToPtr;
+    D.Src[0] = getOperandCode(I.getOperand(0), DF, SF);
+    break;
+  }
+
+  case Instruction::BitCast:
+    if (!Ty->isPointerTy() || !I.getOperand(0)->getType()->isPointerTy())
+      break;
+    D.Op = OpPtrCopy;
+    D.Src[0] = getOperandCode(I.getOperand(0), DF, SF);
+    break;
+
+  case Instruction::Select:
+    if (I.getOperand(0)->getType()->isVectorTy())
+      break;
+    D.Op = OpSelect;
+    for (unsigned i = 0; i != 3; ++i)
+      D.Src[i] = getOperandCode(I.getOperand(i), DF, SF);
+    break;
+
+  case Instruction::GetElementPtr: {
+    GetElementPtrInst &GEP = cast<GetElementPtrInst>(I);
+    if (Ty->isVectorTy())
+      break;
+    // Fold the constant indices into Imm, allowing one variable index.
+    bool HasIndex = false;
+    uint64_t Offset = 0;
+    gep_type_iterator GTI = gep_type_begin(GEP), GTE = gep_type_end(GEP);
+    for (; GTI != GTE; ++GTI) {
+      if (StructType *STy = dyn_cast<StructType>(*GTI)) {
+        unsigned Field = cast<ConstantInt>(GTI.getOperand())->getZExtValue();
+        Offset += TD.getStructLayout(STy)->getElementOffset(Field);
+        continue;
+      }
+      uint64_t Size = TD.getTypeAllocSize(
+        cast<SequentialType>(*GTI)->getElementType());
+      if (ConstantInt *CI = dyn_cast<ConstantInt>(GTI.getOperand())) {
+        Offset += Size * CI->getSExtValue();
+        continue;
+      }
+      if (HasIndex || Size > ~0U)
+        break;
+      HasIndex = true;
+      D.Src[1] = getOperandCode(GTI.getOperand(), DF, SF);
+      D.Width = getWidth(GTI.getOperand()->getType());
+      D.Aux = Size;
+    }
+    if (GTI != GTE)
+      break;
+    D.Op = HasIndex ? OpGEPIndex : OpGEPConst;
+    D.Imm = Offset;
+    D.Src[0] = getOperandCode(GEP.getPointerOperand(), DF, SF);
+    break;
+  }
+
+  case Instruction::Load:
+  case Instruction::Store: {
+    bool IsLoad = isa<LoadInst>(I);
+    if (IsLoad ? cast<LoadInst>(I).isVolatile() :
+                 cast<StoreInst>(I).isVolatile())
+      break;
+    Type *ValTy = IsLoad ? Ty : I.getOperand(0)->getType();
+    if (isFastInt(ValTy) && getWidth(ValTy) % 8 == 0 &&
+        isPowerOf2_32(getWidth(ValTy)) && HostLayout)
+      D.Aux = MemInt;
+    else if (ValTy->isPointerTy() && HostLayout)
+      D.Aux = MemPtr;
+    else if (ValTy->isFloatTy())
+      D.Aux = MemFloat;
+    else if (ValTy->isDoubleTy())
+      D.Aux = MemDouble;
+    else
+      break;
+    D.Width = TD.getTypeStoreSize(ValTy);
+    if (IsLoad) {
+      D.Op = OpLoad;
+      D.Src[0] = getOperandCode(I.getOperand(0), DF, SF);
+    } else {
+      D.Op = OpStore;
+      D.Src[0] = getOperandCode(I.getOperand(1), DF, SF);
+      D.Src[1] = getOperandCode(I.getOperand(0), DF, SF);
+    }
+    break;
+  }
+
+  case Instruction::Br: {
+    BranchInst &BI = cast<BranchInst>(I);
+    BasicBlock *BB = BI.getParent();
+    if (BI.isUnconditional()) {
+      D.Op = OpBr;
+      D.Src[1] = getEdge(BB, BI.getSuccessor(0), DF, BlockStarts, SF);
+    } else {
+      D.Op = OpCondBr;
+      D.Src[0] = getOperandCode(BI.getCondition(), DF, SF);
+      D.Src[1] = getEdge(BB, BI.getSuccessor(0), DF, BlockStarts, SF);
+      D.Src[2] = getEdge(BB, BI.getSuccessor(1), DF, BlockStarts, SF);
+    }
+    break;
+  }
+  }
+
+  DF.Insts.push_back(D);
+}
+
+/// runFrame - Run the instructions of the top stack frame SF until it calls
+/// another function or returns.
+void Interpreter::runFrame(ExecutionContext &SF) {
+  DecodedFunction &DF = *SF.Decoded;
+  // The body may have changed since the frame was last running, for example
+  // because a call to an intrinsic was lowered.
+  if (DF.ModificationCount != SF.CurFunction->getModificationCount())
+    decodeFunction(SF.CurFunction, DF, SF);
+  if (SF.Values.size() < DF.NumSlots)
+    SF.Values.resize(DF.NumSlots);
+
+  const DecodedInst *Insts = &DF.Insts[0];
+  GenericValue *Frame = SF.Values.empty() ? 0 : &SF.Values[0];
+  const GenericValue *Constants =
+    DF.Constants.empty() ? 0 : &DF.Constants[0];
+  const DecodedEdge *Edge;
+  const DecodedInst *D;
+  assert(DF.Index.count(SF.CurInst) && "Frame is not at an instruction!");
+  unsigned PC = DF.Index.lookup(SF.CurInst);
+
+#define OPERAND(N)                                                   \
+  (D->Src[N] & DecodedFunction::ConstantBit ?                        \
+   Constants[D->Src[N] & ~DecodedFunction::ConstantBit] : Frame[D->Src[N]])
+#define INT_OPERAND(N) getInt(OPERAND(N))
+#define SINT_OPERAND(N) SignExtend64(INT_OPERAND(N), D->Width)
+#define NEXT() do { ++PC; DISPATCH(); } while (0)
+
+#if INTERPRETER_THREADED_DISPATCH
+  // Indexed by DecodedOp.
+  __extension__ static const void *const DispatchTable[] = {
+    &&Do_OpVisit, &&Do_OpLeave,
+    &&Do_OpAdd, &&Do_OpSub, &&Do_OpMul, &&Do_OpUDiv, &&Do_OpSDiv,
+    &&Do_OpURem, &&Do_OpSRem,
+    &&Do_OpAnd, &&Do_OpOr, &&Do_OpXor, &&Do_OpShl, &&Do_OpLShr, &&Do_OpAShr,
+    &&Do_OpICmp,
+    &&Do_OpFAdd, &&Do_OpFSub, &&Do_OpFMul, &&Do_OpFDiv,
+    &&Do_OpZExt, &&Do_OpSExt, &&Do_OpTrunc,
+    &&Do_OpPtrToInt, &&Do_OpIntToPtr, &&Do_OpPtrCopy,
+    &&Do_OpSelect,
+    &&Do_OpGEPConst, &&Do_OpGEPIndex,
+    &&Do_OpLoad, &&Do_OpStore,
+    &&Do_OpBr, &&Do_OpCondBr
+  };
+#define DISPATCH()                                                   \
+  do {                                                               \
+    D = &Insts[PC];                                                  \
+    ++NumDynamicInsts;                                               \
+    __extension__ ({ goto *DispatchTable[D->Op]; });                 \
+  } while (0)
+#define HANDLER(Op) Do_##Op
+#else
+#define DISPATCH() goto Dispatch
+#define HANDLER(Op) case Op
+#endif
+
+  DISPATCH();
+#if !INTERPRETER_THREADED_DISPATCH
+Dispatch:
+  D = &Insts[PC];
+  ++NumDynamicInsts;
+  switch (D->Op) {
+  default: llvm_unreachable("Invalid decoded instruction!");
+#endif
+
+  HANDLER(OpAdd):
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0) + INT_OPERAND(1));
+    NEXT();
+  HANDLER(OpSub):
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0) - INT_OPERAND(1));
+    NEXT();
+  HANDLER(OpMul):
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0) * INT_OPERAND(1));
+    NEXT();
+  HANDLER(OpUDiv):
+    if (INT_OPERAND(1) == 0)
+      goto Visit;
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0) / INT_OPERAND(1));
+    NEXT();
+  HANDLER(OpURem):
+    if (INT_OPERAND(1) == 0)
+      goto Visit;
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0) % INT_OPERAND(1));
+    NEXT();
+  HANDLER(OpSDiv):
+    // The host traps on INT64_MIN / -1.
+    if (INT_OPERAND(1) == 0 || (D->Width == 64 && SINT_OPERAND(1) == -1))
+      goto Visit;
+    setInt(Frame[D->Dest], D->Width, SINT_OPERAND(0) / SINT_OPERAND(1));
+    NEXT();
+  HANDLER(OpSRem):
+    if (INT_OPERAND(1) == 0 || (D->Width == 64 && SINT_OPERAND(1) == -1))
+      goto Visit;
+    setInt(Frame[D->Dest], D->Width, SINT_OPERAND(0) % SINT_OPERAND(1));
+    NEXT();
+  HANDLER(OpAnd):
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0) & INT_OPERAND(1));
+    NEXT();
+  HANDLER(OpOr):
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0) | INT_OPERAND(1));
+    NEXT();
+  HANDLER(OpXor):
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0) ^ INT_OPERAND(1));
+    NEXT();
+  HANDLER(OpShl):
+    // Oversized shifts are left to the visitor, which defines them.
+    if (INT_OPERAND(1) >= D->Width)
+      goto Visit;
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0) << INT_OPERAND(1));
+    NEXT();
+  HANDLER(OpLShr):
+    if (INT_OPERAND(1) >= D->Width)
+      goto Visit;
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0) >> INT_OPERAND(1));
+    NEXT();
+  HANDLER(OpAShr):
+    if (INT_OPERAND(1) >= D->Width)
+      goto Visit;
+    setInt(Frame[D->Dest], D->Width, SINT_OPERAND(0) >> INT_OPERAND(1));
+    NEXT();
+
+  HANDLER(OpICmp): {
+    uint64_t A, B;
+    if (D->Src[2]) {
+      A = (uintptr_t)OPERAND(0).PointerVal;
+      B = (uintptr_t)OPERAND(1).PointerVal;
+    } else {
+      A = INT_OPERAND(0);
+      B = INT_OPERAND(1);
+    }
+    setInt(Frame[D->Dest], 1, compareInts(D->Aux, A, B, D->Width));
+    NEXT();
+  }
+
+  HANDLER(OpFAdd):
+    if (D->Aux)
+      Frame[D->Dest].DoubleVal = OPERAND(0).DoubleVal + OPERAND(1).DoubleVal;
+    else
+      Frame[D->Dest].FloatVal = OPERAND(0).FloatVal + OPERAND(1).FloatVal;
+    NEXT();
+  HANDLER(OpFSub):
+    if (D->Aux)
+      Frame[D->Dest].DoubleVal = OPERAND(0).DoubleVal - OPERAND(1).DoubleVal;
+    else
+      Frame[D->Dest].FloatVal = OPERAND(0).FloatVal - OPERAND(1).FloatVal;
+    NEXT();
+  HANDLER(OpFMul):
+    if (D->Aux)
+      Frame[D->Dest].DoubleVal = OPERAND(0).DoubleVal * OPERAND(1).DoubleVal;
+    else
+      Frame[D->Dest].FloatVal = OPERAND(0).FloatVal * OPERAND(1).FloatVal;
+    NEXT();
+  HANDLER(OpFDiv):
+    if (D->Aux)
+      Frame[D->Dest].DoubleVal = OPERAND(0).DoubleVal / OPERAND(1).DoubleVal;
+    else
+      Frame[D->Dest].FloatVal = OPERAND(0).FloatVal / OPERAND(1).FloatVal;
+    NEXT();
+
+  HANDLER(OpZExt):
+  HANDLER(OpTrunc):
+    setInt(Frame[D->Dest], D->Width, INT_OPERAND(0));
+    NEXT();
+  HANDLER(OpSExt):
+    setInt(Frame[D->Dest], D->Width, SignExtend64(INT_OPERAND(0), D->Aux));
+    NEXT();
+  HANDLER(OpPtrToInt):
+    setInt(Frame[D->Dest], D->Width, (intptr_t)OPERAND(0).PointerVal);
+    NEXT();
+  HANDLER(OpIntToPtr):
+    Frame[D->Dest].PointerVal = (PointerTy)(intptr_t)INT_OPERAND(0);
+    NEXT();
+  HANDLER(OpPtrCopy):
+    Frame[D->Dest].PointerVal = OPERAND(0).PointerVal;
+    NEXT();
+  HANDLER(OpSelect):
+    Frame[D->Dest] = INT_OPERAND(0) ? OPERAND(1) : OPERAND(2);
+    NEXT();
+
+  HANDLER(OpGEPConst):
+    Frame[D->Dest].PointerVal = (char*)OPERAND(0).PointerVal + D->Imm;
+    NEXT();
+  HANDLER(OpGEPIndex):
+    Frame[D->Dest].PointerVal = (char*)OPERAND(0).PointerVal + D->Imm +
+      SignExtend64(getInt(OPERAND(1)), D->Width) * (int64_t)D->Aux;
+    NEXT();
+
+  HANDLER(OpLoad): {
+    const void *Ptr = OPERAND(0).PointerVal;
+    GenericValue &Result = Frame[D->Dest];
+    switch (D->Aux) {
+    case MemInt: {
+      uint64_t X = 0;
+      memcpy(&X, Ptr, D->Width);
+      setInt(Result, D->Width * 8, X);
+      break;
+    }
+    case MemPtr:    memcpy(&Result.PointerVal, Ptr, sizeof(PointerTy)); break;
+    case MemFloat:  memcpy(&Result.FloatVal, Ptr, sizeof(float)); break;
+    case MemDouble: memcpy(&Result.DoubleVal, Ptr, sizeof(double)); break;
+    }
+    NEXT();
+  }
+  HANDLER(OpStore): {
+    void *Ptr = OPERAND(0).PointerVal;
+    const GenericValue &Val = OPERAND(1);
+    switch (D->Aux) {
+    case MemInt: {
+      uint64_t X = getInt(Val);
+      memcpy(Ptr, &X, D->Width);
+      break;
+    }
+    case MemPtr:    memcpy(Ptr, &Val.PointerVal, sizeof(PointerTy)); break;
+    case MemFloat:  memcpy(Ptr, &Val.FloatVal, sizeof(float)); break;
+    case MemDouble: memcpy(Ptr, &Val.DoubleVal, sizeof(double)); break;
+    }
+    NEXT();
+  }
+
+  HANDLER(OpBr):
+    Edge = &DF.Edges[D->Src[1]];
+    goto TakeEdge;
+  HANDLER(OpCondBr):
+    Edge = &DF.Edges[D->Src[INT_OPERAND(0) ? 1 : 2]];
+    goto TakeEdge;
+
+  HANDLER(OpVisit):
+  HANDLER(OpLeave):
+    goto Visit;
+
+#if !INTERPRETER_THREADED_DISPATCH
+  }
+#endif
+
+TakeEdge: {
+    // PHI nodes read all of their inputs before any of them is written.
+    unsigned NumMoves = Edge->MovesEnd - Edge->MovesBegin;
+    const std::pair<unsigned, unsigned> *Moves =
+      NumMoves ? &DF.Moves[Edge->MovesBegin] : 0;
+    if (NumMoves == 1) {
+      unsigned Src = Moves[0].second;
+      Frame[Moves[0].first] = Src & DecodedFunction::ConstantBit ?
+        Constants[Src & ~DecodedFunction::ConstantBit] : Frame[Src];
+    } else if (NumMoves) {
+      PHIScratch.resize(NumMoves);
+      for (unsigned i = 0; i != NumMoves; ++i) {
+        unsigned Src = Moves[i].second;
+        PHIScratch[i] = Src & DecodedFunction::ConstantBit ?
+          Constants[Src & ~DecodedFunction::ConstantBit] : Frame[Src];
+      }
+      for (unsigned i = 0; i != NumMoves; ++i)
+        Frame[Moves[i].first] = PHIScratch[i];
+    }
+
+    // Loop iterations make a function hot just like calls do.
+    if (SF.TierUp && SF.TierUp->LoopHeaders.count(Edge->Target))
+      ++SF.TierUp->Count;
+    PC = Edge->TargetIndex;
+    DISPATCH();
+  }
+
+Visit: {
+    // Hand the instruction to the visitor, positioned as it expects.
+    Instruction &I = *D->Inst;
+    bool Leave = D->Op == OpLeave;
+    BasicBlock::iterator Next = &I;
+    ++Next;
+    SF.CurBB = I.getParent();
+    SF.CurInst = Next;
+    DEBUG(dbgs() << "About to interpret: " << I);
+    visit(I);
+
+    // Calls and returns change the stack, which may also move SF or decode
+    // this function again.  Let run() pick the frame to continue with.
+    if (Leave)
+      return;
+    if (SF.CurInst == Next)
+      ++PC;
+    else
+      PC = DF.Index.lookup(SF.CurInst);
+    DISPATCH();
+  }
+
+#undef OPERAND
+#undef INT_OPERAND
+#undef SINT_OPERAND
+#undef NEXT
+#undef DISPATCH
+#undef HANDLER
+}
@@ -14,7 +14,6 @@
 #define DEBUG_TYPE "interpreter"
 #include "Interpreter.h"
 #include "llvm/ADT/APInt.h"
-#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/IntrinsicLowering.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -28,8 +27,6 @@
 #include <cmath>
 using namespace llvm;
 
-STATISTIC(NumDynamicInsts, "Number of dynamic instructions executed");
-
 static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
           cl::desc("make the interpreter print every volatile load and store"));
 
@@ -38,7 +35,7 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //===----------------------------------------------------------------------===//
 
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  SF.Values[SF.Decoded->getSlot(V)] = Val;
 }
 
 //===----------------------------------------------------------------------===//
@@ -930,6 +927,10 @@ void Interpreter::SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF){
   SF.CurBB   = Dest;                  // Update CurBB to branch destination
   SF.CurInst = SF.CurBB->begin();     // Update new instruction ptr...
 
+  // Loop iterations make a function hot just like calls do.
+  if (SF.TierUp && SF.TierUp->LoopHeaders.count(Dest))
+    ++SF.TierUp->Count;
+
   if (!isa<PHINode>(SF.CurInst)) return;  // Nothing fancy to do
 
   // Loop over all of the PHI nodes in the current block, reading their inputs.
@@ -2060,7 +2061,7 @@ GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
   } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
     return PTOGV(getPointerToGlobal(GV));
   } else {
-    return SF.Values[V];
+    return SF.Values[SF.Decoded->getSlot(V)];
   }
 }
 
@@ -2089,9 +2090,22 @@ void Interpreter::callFunction(Function *F,
     return;
   }
 
+  // Hot functions run as native code once MCJIT has compiled them.
+  if (TierUpThreshold) {
+    TierUpInfo *Info = getTierUpInfo(F);
+    if (getTierUpEntry(F, *Info)) {
+      GenericValue Result = callTierUpEntry(F, *Info, ArgVals);
+      popStackAndReturnValueToCaller(F->getReturnType(), Result);
+      return;
+    }
+    StackFrame.TierUp = Info;
+  }
+
   // Get pointers to first LLVM BB & Instruction in function.
   StackFrame.CurBB     = F->begin();
   StackFrame.CurInst   = StackFrame.CurBB->begin();
+  StackFrame.Decoded   = getDecodedFunction(F, StackFrame);
+  StackFrame.Values.resize(StackFrame.Decoded->NumSlots);
 
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
@@ -2110,37 +2124,8 @@ void Interpreter::callFunction(Function *F,
 
 
 void Interpreter::run() {
-  while (!ECStack.empty()) {
-    // Interpret a single instruction & increment the "PC".
-    ExecutionContext &SF = ECStack.back();  // Current stack frame
-    Instruction &I = *SF.CurInst++;         // Increment before execute
-
-    // Track the number of dynamic instructions executed.
-    ++NumDynamicInsts;
-
-    DEBUG(dbgs() << "About to interpret: " << I);
-    visit(I);   // Dispatch to one of the visit* methods...
-#if 0
-    // This is not safe, as visiting the instruction could lower it and free I.
-DEBUG(
-    if (!isa<CallInst>(I) && !isa<InvokeInst>(I) && 
-        I.getType() != Type::VoidTy) {
-      dbgs() << "  --> ";
-      const GenericValue &Val = SF.Values[&I];
-      switch (I.getType()->getTypeID()) {
-      default: llvm_unreachable("Invalid GenericValue Type");
-      case Type::VoidTyID:    dbgs() << "void"; break;
-      case Type::FloatTyID:   dbgs() << "float " << Val.FloatVal; break;
-      case Type::DoubleTyID:  dbgs() << "double " << Val.DoubleVal; break;
-      case Type::PointerTyID: dbgs() << "void* " << intptr_t(Val.PointerVal);
-        break;
-      case Type::IntegerTyID: 
-        dbgs() << "i" << Val.IntVal.getBitWidth() << " "
-               << Val.IntVal.toStringUnsigned(10)
-               << " (0x" << Val.IntVal.toStringUnsigned(16) << ")\n";
-        break;
-      }
-    });
-#endif
-  }
+  // Each frame runs in the dispatch loop until it calls another function or
+  // returns, see Dispatch.cpp.
+  while (!ECStack.empty())
+    runFrame(ECStack.back());
 }
@@ -45,7 +45,7 @@ ExecutionEngine *Interpreter::create(Module *M, std::string* ErrStr) {
 // Interpreter ctor - Initialize stuff
 //
 Interpreter::Interpreter(Module *M)
-  : ExecutionEngine(M), TD(M) {
+  : ExecutionEngine(M), TD(M), TierUpJIT(0) {
       
   memset(&ExitValue.Untyped, 0, sizeof(ExitValue.Untyped));
   setDataLayout(&TD);
@@ -55,9 +55,12 @@ Interpreter::Interpreter(Module *M)
   emitGlobals();
 
   IL = new IntrinsicLowering(TD);
+  initializeTierUp();
 }
 
 Interpreter::~Interpreter() {
+  destroyTierUp();
+  destroyDecodedFunctions();
   delete IL;
 }
 
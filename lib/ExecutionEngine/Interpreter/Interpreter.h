@@ -14,6 +14,8 @@
 #ifndef LLI_INTERPRETER_H
 #define LLI_INTERPRETER_H
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/DataLayout.h"
@@ -26,6 +28,7 @@
 namespace llvm {
 
 class IntrinsicLowering;
+class StructType;
 struct FunctionInfo;
 template<typename T> class generic_gep_type_iterator;
 class ConstantExpr;
@@ -64,6 +67,78 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// TierUpInfo - Execution counts and native code state of one function when
+// hot functions are being compiled with MCJIT.  See TierUp.cpp.
+//
+struct TierUpInfo {
+  enum StateTy {
+    Counting,    // Interpreted; calls and loop iterations are being counted.
+    Compiling,   // Handed to MCJIT; interpreted until the code is ready.
+    Compiled,    // Calls go to native code through StubAddr.
+    Rejected     // Cannot be run natively; always interpreted.
+  };
+  StateTy State;
+  unsigned Count;
+  SmallPtrSet<const BasicBlock *, 8> LoopHeaders;
+  std::string StubName;
+  uint64_t StubAddr;
+  StructType *ArgsTy;
+
+  TierUpInfo() : State(Counting), Count(0), StubAddr(0), ArgsTy(0) {}
+};
+
+// DecodedInst - One instruction of a DecodedFunction.  Operands are frame
+// slots, or indices into the constant pool if DecodedFunction::ConstantBit is
+// set.  The meaning of Width and Aux depends on Op; see Dispatch.cpp.
+//
+struct DecodedInst {
+  unsigned Op;           // What the dispatch loop does for this instruction
+  unsigned Width;        // Bit width or access size of the operation
+  unsigned Aux;          // Predicate, source width or GEP index scale
+  unsigned Dest;         // Frame slot of the result
+  unsigned Src[3];       // Operands, or edge numbers for branches
+  int64_t Imm;           // Constant byte offset of a GEP
+  Instruction *Inst;     // The instruction this was decoded from
+};
+
+// DecodedEdge - A CFG edge taken by a decoded branch.  The PHI nodes of the
+// target are assigned from Moves[MovesBegin, MovesEnd), all at once.
+//
+struct DecodedEdge {
+  BasicBlock *Target;
+  unsigned TargetIndex;  // Index of the first non-PHI instruction of Target
+  unsigned MovesBegin, MovesEnd;
+};
+
+// DecodedFunction - A function translated for the dispatch loop in
+// Dispatch.cpp.  Each argument and instruction gets a slot in the frames of
+// the function, constants are evaluated once, and common integer, pointer
+// and floating point instructions are specialized.  Everything else is run by
+// the InstVisitor on the IR.  Slots are never reassigned, so a function can
+// be decoded again after its body changed while it has frames on the stack.
+//
+struct DecodedFunction {
+  static const unsigned ConstantBit = 1U << 31;
+
+  DenseMap<const Value*, unsigned> Slots;       // Values and constants
+  DenseMap<const Instruction*, unsigned> Index; // Position in Insts
+  std::vector<DecodedInst> Insts;
+  std::vector<DecodedEdge> Edges;
+  std::vector<std::pair<unsigned, unsigned> > Moves; // PHI slot, operand
+  std::vector<GenericValue> Constants;
+  unsigned NumSlots;
+  unsigned ModificationCount;   // Of the function when it was decoded
+
+  DecodedFunction() : NumSlots(0), ModificationCount(0) {}
+
+  unsigned getSlot(const Value *V) const {
+    DenseMap<const Value*, unsigned>::const_iterator I = Slots.find(V);
+    assert(I != Slots.end() && !(I->second & ConstantBit) &&
+           "Value has no frame slot!");
+    return I->second;
+  }
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
@@ -71,11 +146,15 @@ struct ExecutionContext {
   Function             *CurFunction;// The currently executing function
   BasicBlock           *CurBB;      // The currently executing BB
   BasicBlock::iterator  CurInst;    // The next instruction to execute
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  DecodedFunction      *Decoded;    // CurFunction, ready for dispatch
+  std::vector<GenericValue> Values; // Values of this invocation, by slot
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
   AllocaHolderHandle    Allocas;    // Track memory allocated by alloca
+  TierUpInfo           *TierUp;     // Hotness counters, if tiering up
+
+  ExecutionContext() : CurFunction(0), CurBB(0), Decoded(0), TierUp(0) {}
 };
 
 // Interpreter - This class represents the entirety of the interpreter.
@@ -93,6 +172,18 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // Tiered execution: functions that become hot are compiled by TierUpJIT,
+  // an MCJIT whose modules each live in a context of their own.  Disabled if
+  // TierUpThreshold is zero.
+  unsigned TierUpThreshold;
+  std::map<Function*, TierUpInfo> TierUpFunctions;
+  ExecutionEngine *TierUpJIT;
+  std::vector<LLVMContext*> TierUpContexts;
+
+  // Functions translated for the dispatch loop, see Dispatch.cpp.
+  DenseMap<Function*, DecodedFunction*> DecodedFunctions;
+  std::vector<GenericValue> PHIScratch;
+
 public:
   explicit Interpreter(Module *M);
   ~Interpreter();
@@ -136,6 +227,7 @@ public:
   // Place a call on the stack
   void callFunction(Function *F, const std::vector<GenericValue> &ArgVals);
   void run();                // Execute instructions until nothing left to do
+  void runFrame(ExecutionContext &SF); // Run SF until it calls or returns
 
   // Opcode Implementations
   void visitReturnInst(ReturnInst &I);
@@ -217,6 +309,29 @@ private:  // Helper functions
 
   void initializeExecutionEngine() { }
   void initializeExternalFunctions();
+
+  // Decoding for the dispatch loop, implemented in Dispatch.cpp.
+  DecodedFunction *getDecodedFunction(Function *F, ExecutionContext &SF);
+  void decodeFunction(Function *F, DecodedFunction &DF, ExecutionContext &SF);
+  void decodeInstruction(Instruction &I, DecodedFunction &DF,
+                         const DenseMap<BasicBlock*, unsigned> &BlockStarts,
+                         ExecutionContext &SF);
+  unsigned getOperandCode(Value *V, DecodedFunction &DF, ExecutionContext &SF);
+  unsigned getEdge(BasicBlock *From, BasicBlock *To, DecodedFunction &DF,
+                   const DenseMap<BasicBlock*, unsigned> &BlockStarts,
+                   ExecutionContext &SF);
+  void destroyDecodedFunctions();
+
+  // Tiered execution, implemented in TierUp.cpp.
+  void initializeTierUp();
+  void destroyTierUp();
+  TierUpInfo *getTierUpInfo(Function *F);
+  uint64_t getTierUpEntry(Function *F, TierUpInfo &Info);
+  bool promoteFunction(Function *F, TierUpInfo &Info);
+  bool createTierUpJIT();
+  GenericValue callTierUpEntry(Function *F, TierUpInfo &Info,
+                               const std::vector<GenericValue> &ArgVals);
+
   GenericValue getConstantExprValue(ConstantExpr *CE, ExecutionContext &SF);
   GenericValue getOperandValue(Value *V, ExecutionContext &SF);
   GenericValue executeTruncInst(Value *SrcVal, Type *DstTy,
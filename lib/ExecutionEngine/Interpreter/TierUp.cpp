@@ -0,0 +1,377 @@
+//===-- TierUp.cpp - Move hot interpreted functions to native code --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+//  This file implements tiered execution for the interpreter.  Every call of a
+//  function and every iteration of one of its loops is counted, and once the
+//  count reaches -interpreter-tier-up-threshold the function, together with
+//  the functions it calls, is handed to MCJIT.  Compilation happens on MCJIT's
+//  background thread while the interpreter keeps going; once the code is
+//  ready, calls to the function run natively.
+//
+//  Native code shares memory with the interpreter: references to global
+//  variables are replaced by their addresses in the interpreter.  Functions,
+//  however, are represented by their Function objects in the interpreter, so
+//  a function is only compiled if no function pointer can flow into or out of
+//  native code.  Each compiled module is round-tripped through bitcode into an
+//  LLVMContext of its own so that code generation never touches the context
+//  the interpreter is working in.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "interpreter"
+#include "Interpreter.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/CFG.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+using namespace llvm;
+
+STATISTIC(NumTieredUp, "Number of functions compiled to native code");
+STATISTIC(NumTierUpRejected, "Number of hot functions that stay interpreted");
+
+static cl::opt<unsigned>
+TierUpThresholdOpt("interpreter-tier-up-threshold", cl::init(0),
+                   cl::desc("Compile a function with MCJIT after this many "
+                            "calls and loop iterations (0 = never)"));
+
+static cl::opt<bool>
+TierUpWait("interpreter-tier-up-wait", cl::Hidden,
+           cl::desc("Wait for hot functions to be compiled instead of "
+                    "interpreting them in the meantime"));
+
+void Interpreter::initializeTierUp() {
+  TierUpThreshold = TierUpThresholdOpt;
+}
+
+void Interpreter::destroyTierUp() {
+  // The JIT owns modules that live in the contexts.
+  delete TierUpJIT;
+  TierUpJIT = 0;
+  for (unsigned i = 0, e = TierUpContexts.size(); i != e; ++i)
+    delete TierUpContexts[i];
+  TierUpContexts.clear();
+}
+
+TierUpInfo *Interpreter::getTierUpInfo(Function *F) {
+  std::pair<std::map<Function*, TierUpInfo>::iterator, bool> Res =
+    TierUpFunctions.insert(std::make_pair(F, TierUpInfo()));
+  TierUpInfo &Info = Res.first->second;
+  if (Res.second) {
+    SmallVector<std::pair<const BasicBlock*, const BasicBlock*>, 8> Edges;
+    FindFunctionBackedges(*F, Edges);
+    for (unsigned i = 0, e = Edges.size(); i != e; ++i)
+      Info.LoopHeaders.insert(Edges[i].second);
+  }
+  return &Info;
+}
+
+/// getTierUpEntry - Count a call of F and return the address of the native
+/// entry stub for F, or zero if F is to be interpreted this time.
+uint64_t Interpreter::getTierUpEntry(Function *F, TierUpInfo &Info) {
+  switch (Info.State) {
+  case TierUpInfo::Rejected:
+    return 0;
+  case TierUpInfo::Compiled:
+    return Info.StubAddr;
+  case TierUpInfo::Counting:
+    if (++Info.Count < TierUpThreshold)
+      return 0;
+    if (!promoteFunction(F, Info)) {
+      Info.State = TierUpInfo::Rejected;
+      ++NumTierUpRejected;
+      return 0;
+    }
+    Info.State = TierUpInfo::Compiling;
+    // Without threads MCJIT cannot compile in the background, so wait.
+    if (TierUpWait || !llvm_is_multithreaded()) {
+      Info.StubAddr = TierUpJIT->getFunctionAddress(Info.StubName);
+      break;
+    }
+    // FALLTHROUGH
+  case TierUpInfo::Compiling:
+    Info.StubAddr = TierUpJIT->getFunctionAddressIfReady(Info.StubName);
+    break;
+  }
+
+  if (Info.StubAddr) {
+    DEBUG(dbgs() << "Tier-up: running " << F->getName() << " natively\n");
+    Info.State = TierUpInfo::Compiled;
+    ++NumTieredUp;
+  }
+  return Info.StubAddr;
+}
+
+/// isNativeArgType - Return true if values of type Ty can be passed between
+/// the interpreter and native code through memory.
+static bool isNativeArgType(Type *Ty) {
+  if (PointerType *PTy = dyn_cast<PointerType>(Ty))
+    return !PTy->getElementType()->isFunctionTy();
+  return Ty->isIntegerTy() || Ty->isFloatTy() || Ty->isDoubleTy() ||
+         Ty->isVectorTy();
+}
+
+/// canRunNatively - Return true if the constant C, used by a function that
+/// is being compiled, means the same thing in native code as it does in the
+/// interpreter.
+static bool canRunNatively(const Constant *C,
+                           SmallPtrSet<const Constant*, 16> &Visited) {
+  if (isa<Function>(C) || isa<GlobalAlias>(C) || isa<BlockAddress>(C))
+    return false;
+  if (isa<GlobalValue>(C) || !Visited.insert(C))
+    return true;
+  for (unsigned i = 0, e = C->getNumOperands(); i != e; ++i)
+    if (!canRunNatively(cast<Constant>(C->getOperand(i)), Visited))
+      return false;
+  return true;
+}
+
+/// collectNativeFunctions - Add F and every function it may call to Funcs,
+/// and return false if one of them cannot be run natively.
+static bool collectNativeFunctions(Function *F,
+                                   SmallVectorImpl<Function*> &Funcs) {
+  SmallPtrSet<Function*, 8> Seen;
+  SmallPtrSet<const Constant*, 16> Visited;
+  Seen.insert(F);
+  Funcs.push_back(F);
+  for (unsigned Idx = 0; Idx != Funcs.size(); ++Idx) {
+    Function *G = Funcs[Idx];
+    for (Function::iterator BB = G->begin(), BE = G->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+        // Exceptions cannot unwind between native and interpreted frames.
+        if (isa<InvokeInst>(I))
+          return false;
+        // A function pointer loaded from memory was stored by the
+        // interpreter and does not point to code.
+        if (PointerType *PTy = dyn_cast<PointerType>(I->getType()))
+          if (PTy->getElementType()->isFunctionTy())
+            return false;
+
+        CallInst *CI = dyn_cast<CallInst>(I);
+        for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i) {
+          Value *Op = I->getOperand(i);
+          Function *Callee = dyn_cast<Function>(Op);
+          if (Callee && CI && Op == CI->getCalledValue()) {
+            if (!Callee->isDeclaration() && Seen.insert(Callee))
+              Funcs.push_back(Callee);
+            continue;
+          }
+          if (Constant *C = dyn_cast<Constant>(Op))
+            if (!canRunNatively(C, Visited))
+              return false;
+        }
+      }
+  }
+  return true;
+}
+
+namespace {
+/// GlobalAddressMaterializer - Map the global values referred to by cloned
+/// functions into the module being compiled: global variables become their
+/// addresses in the interpreter, functions become declarations.
+class GlobalAddressMaterializer : public ValueMaterializer {
+  ExecutionEngine &EE;
+  const DataLayout &TD;
+  Module &M;
+
+public:
+  GlobalAddressMaterializer(ExecutionEngine &EE, const DataLayout &TD,
+                            Module &M)
+    : EE(EE), TD(TD), M(M) {}
+
+  virtual Value *materializeValueFor(Value *V) {
+    if (GlobalVariable *GV = dyn_cast<GlobalVariable>(V)) {
+      uintptr_t Addr = (uintptr_t)EE.getPointerToGlobal(GV);
+      Constant *Int = ConstantInt::get(TD.getIntPtrType(GV->getContext()), Addr);
+      return ConstantExpr::getIntToPtr(Int, GV->getType());
+    }
+    if (Function *F = dyn_cast<Function>(V)) {
+      Function *Decl = Function::Create(F->getFunctionType(),
+                                        GlobalValue::ExternalLinkage,
+                                        F->getName(), &M);
+      Decl->copyAttributesFrom(F);
+      Decl->setVisibility(GlobalValue::DefaultVisibility);
+      return Decl;
+    }
+    return 0;
+  }
+};
+} // end anonymous namespace
+
+bool Interpreter::createTierUpJIT() {
+  LLVMContext *Context = new LLVMContext();
+  TierUpContexts.push_back(Context);
+  Module *M = new Module("tierup", *Context);
+  M->setTargetTriple(Modules[0]->getTargetTriple());
+
+  std::string ErrorStr;
+  EngineBuilder Builder(M);
+  Builder.setEngineKind(EngineKind::JIT)
+         .setUseMCJIT(true)
+         .setErrorStr(&ErrorStr);
+  TierUpJIT = Builder.create();
+  if (!TierUpJIT) {
+    DEBUG(dbgs() << "Tier-up: cannot create MCJIT: " << ErrorStr << '\n');
+    delete M;
+    return false;
+  }
+
+  // Interpreter memory is laid out according to TD, native code has to agree.
+  if (TierUpJIT->getDataLayout()->getStringRepresentation() !=
+      TD.getStringRepresentation()) {
+    DEBUG(dbgs() << "Tier-up: data layout differs from the target's\n");
+    delete TierUpJIT;
+    TierUpJIT = 0;
+    return false;
+  }
+  return true;
+}
+
+/// promoteFunction - Hand F, and everything it calls, to MCJIT.  The code is
+/// reached through an entry stub "void stub(i8 *Args, i8 *Ret)", which reads
+/// the arguments of F from a struct at Args and writes the result to Ret.
+bool Interpreter::promoteFunction(Function *F, TierUpInfo &Info) {
+  FunctionType *FTy = F->getFunctionType();
+  Type *RetTy = FTy->getReturnType();
+  if (FTy->isVarArg() || (!RetTy->isVoidTy() && !isNativeArgType(RetTy)))
+    return false;
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+    if (!isNativeArgType(FTy->getParamType(i)))
+      return false;
+
+  SmallVector<Function*, 8> Funcs;
+  if (!collectNativeFunctions(F, Funcs))
+    return false;
+
+  if (!TierUpJIT && !createTierUpJIT()) {
+    // Stop counting; nothing will ever be compiled.
+    TierUpThreshold = 0;
+    return false;
+  }
+
+  // Clone the functions into a module of their own.  They get internal
+  // linkage, so a function can be compiled again as part of another module.
+  LLVMContext &Context = F->getContext();
+  Module M("tierup", Context);
+  M.setTargetTriple(F->getParent()->getTargetTriple());
+  M.setDataLayout(TD.getStringRepresentation());
+
+  ValueToValueMapTy VMap;
+  for (unsigned i = 0, e = Funcs.size(); i != e; ++i) {
+    Function *G = Funcs[i];
+    Function *NG = Function::Create(G->getFunctionType(),
+                                    GlobalValue::InternalLinkage,
+                                    G->getName(), &M);
+    NG->copyAttributesFrom(G);
+    NG->setVisibility(GlobalValue::DefaultVisibility);
+    VMap[G] = NG;
+    Function::arg_iterator NAI = NG->arg_begin();
+    for (Function::arg_iterator AI = G->arg_begin(), AE = G->arg_end();
+         AI != AE; ++AI, ++NAI)
+      VMap[AI] = NAI;
+  }
+
+  GlobalAddressMaterializer Materializer(*this, TD, M);
+  for (unsigned i = 0, e = Funcs.size(); i != e; ++i) {
+    SmallVector<ReturnInst*, 8> Returns;
+    CloneFunctionInto(cast<Function>(VMap[Funcs[i]]), Funcs[i], VMap,
+                      /*ModuleLevelChanges=*/true, Returns, "", 0, 0,
+                      &Materializer);
+  }
+
+  // Build the entry stub.
+  SmallVector<Type*, 8> Params(FTy->param_begin(), FTy->param_end());
+  Info.ArgsTy = StructType::get(Context, Params);
+  Type *I8PtrTy = Type::getInt8PtrTy(Context);
+  Type *StubParams[] = { I8PtrTy, I8PtrTy };
+  Function *Stub =
+    Function::Create(FunctionType::get(Type::getVoidTy(Context), StubParams,
+                                       false),
+                     GlobalValue::ExternalLinkage,
+                     "__tierup_stub" + Twine(TierUpContexts.size()), &M);
+  Info.StubName = Stub->getName();
+
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", Stub));
+  Function::arg_iterator StubArg = Stub->arg_begin();
+  Value *ArgsPtr = Builder.CreateBitCast(StubArg++,
+                                         Info.ArgsTy->getPointerTo());
+  Value *RetPtr = StubArg;
+  SmallVector<Value*, 8> Args;
+  for (unsigned i = 0, e = Params.size(); i != e; ++i)
+    Args.push_back(Builder.CreateAlignedLoad(
+        Builder.CreateStructGEP(ArgsPtr, i), 1));
+  Function *NF = cast<Function>(VMap[F]);
+  CallInst *Call = Builder.CreateCall(NF, Args);
+  Call->setCallingConv(NF->getCallingConv());
+  Call->setAttributes(NF->getAttributes());
+  if (!RetTy->isVoidTy())
+    Builder.CreateAlignedStore(
+        Call, Builder.CreateBitCast(RetPtr, RetTy->getPointerTo()), 1);
+  Builder.CreateRetVoid();
+
+  // Move the module into a context of its own and start compiling it.
+  SmallString<0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+  OwningPtr<MemoryBuffer> Buffer(
+      MemoryBuffer::getMemBuffer(Bitcode.str(), "", false));
+  LLVMContext *JITContext = new LLVMContext();
+  TierUpContexts.push_back(JITContext);
+  std::string ErrorStr;
+  Module *JITModule = ParseBitcodeFile(Buffer.get(), *JITContext, &ErrorStr);
+  if (!JITModule) {
+    DEBUG(dbgs() << "Tier-up: " << ErrorStr << '\n');
+    return false;
+  }
+
+  DEBUG(dbgs() << "Tier-up: compiling " << F->getName() << " and "
+               << (Funcs.size() - 1) << " callees\n");
+  TierUpJIT->addModule(JITModule);
+  TierUpJIT->requestFunctionAddress(Info.StubName);
+  return true;
+}
+
+GenericValue
+Interpreter::callTierUpEntry(Function *F, TierUpInfo &Info,
+                             const std::vector<GenericValue> &ArgVals) {
+  FunctionType *FTy = F->getFunctionType();
+  const StructLayout *SL = TD.getStructLayout(Info.ArgsTy);
+  SmallVector<uint64_t, 8> Args(SL->getSizeInBytes() / 8 + 1);
+  char *ArgsPtr = (char*)Args.data();
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+    StoreValueToMemory(ArgVals[i],
+                       (GenericValue*)(ArgsPtr + SL->getElementOffset(i)),
+                       FTy->getParamType(i));
+
+  Type *RetTy = FTy->getReturnType();
+  SmallVector<uint64_t, 4> Ret;
+  if (!RetTy->isVoidTy())
+    Ret.resize(TD.getTypeStoreSize(RetTy) / 8 + 1);
+
+  typedef void (*StubTy)(void *, void *);
+  ((StubTy)(intptr_t)Info.StubAddr)(ArgsPtr, Ret.data());
+
+  GenericValue Result;
+  if (!RetTy->isVoidTy())
+    LoadValueFromMemory(Result, (GenericValue*)Ret.data(), RetTy);
+  return Result;
+}
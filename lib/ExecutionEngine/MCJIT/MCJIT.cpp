@@ -8,6 +8,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "MCJIT.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/CodeGen/MachineFunction.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/JITMemoryManager.h"
@@ -19,12 +21,16 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -34,6 +40,10 @@ static struct RegisterJIT {
   RegisterJIT() { MCJIT::Register(); }
 } JITRegistrator;
 
+// The function the stubs of lazily compiled functions call to have the body
+// compiled.
+const char LazyCompileCallbackName[] = "__llvm_mcjit_lazy_compile";
+
 }
 
 extern "C" void LLVMLinkInMCJIT() {
@@ -56,13 +66,30 @@ ExecutionEngine *MCJIT::createJIT(Module *M,
 MCJIT::MCJIT(Module *m, TargetMachine *tm, RTDyldMemoryManager *MM,
              bool AllocateGVsWithCode)
   : ExecutionEngine(m), TM(tm), Ctx(0), MemMgr(this, MM), Dyld(&MemMgr),
-    ObjCache(0) {
+    ObjCache(0), BackgroundThread(0), BackgroundThreadDone(true),
+    StopBackgroundThread(false), NextLazyModuleID(0) {
 
   OwnedModules.addModule(m);
   setDataLayout(TM->getDataLayout());
+
+  MFAllocatorPool.reset(new MachineFunctionAllocatorPool());
+  TM->setMachineFunctionAllocatorPool(MFAllocatorPool.get());
 }
 
 MCJIT::~MCJIT() {
+  // Stop the background compiler before tearing anything down.  It finishes
+  // the module it is working on, if any.
+  {
+    MutexGuard locked(lock);
+    StopBackgroundThread = true;
+  }
+  if (BackgroundThread)
+    llvm_join_thread(BackgroundThread);
+  for (BackgroundObjectMap::iterator I = BackgroundObjects.begin(),
+                                     E = BackgroundObjects.end();
+       I != E; ++I)
+    delete I->second;
+
   MutexGuard locked(lock);
   // FIXME: We are managing our modules, so we do not want the base class
   // ExecutionEngine to manage them as well. To avoid double destruction
@@ -81,11 +108,19 @@ MCJIT::~MCJIT() {
   for (it = LoadedObjects.begin(); it != end; ++it) {
     ObjectImage *Obj = it->second;
     if (Obj) {
-      NotifyFreeingObject(*Obj);
+      if (Obj->hasObjectData())
+        NotifyFreeingObject(*Obj);
       delete Obj;
     }
   }
   LoadedObjects.clear();
+
+  // The bodies that have been compiled belong to OwnedModules by now.
+  for (unsigned i = 0, e = LazyFunctions.size(); i != e; ++i) {
+    if (!LazyFunctions[i]->Compiled)
+      delete LazyFunctions[i]->Body;
+    delete LazyFunctions[i];
+  }
   delete TM;
 }
 
@@ -96,6 +131,39 @@ void MCJIT::addModule(Module *M) {
 
 bool MCJIT::removeModule(Module *M) {
   MutexGuard locked(lock);
+
+  // Make sure the background compiler is done with M.
+  BackgroundQueue.erase(std::remove(BackgroundQueue.begin(),
+                                    BackgroundQueue.end(), M),
+                        BackgroundQueue.end());
+  {
+    MutexGuard codegen(CodeGenLock);
+    BackgroundObjectMap::iterator I = BackgroundObjects.find(M);
+    if (I != BackgroundObjects.end()) {
+      delete I->second;
+      BackgroundObjects.erase(I);
+    }
+  }
+
+  // Unload the module's object, if it got that far, and give its memory back.
+  LoadedObjectMap::iterator I = LoadedObjects.find(M);
+  if (I != LoadedObjects.end()) {
+    ObjectImage *Obj = I->second;
+    if (Obj) {
+      Dyld.unloadObject(Obj);
+      if (Obj->hasObjectData())
+        NotifyFreeingObject(*Obj);
+      ObjectsToRelease.erase(std::remove(ObjectsToRelease.begin(),
+                                         ObjectsToRelease.end(), Obj),
+                             ObjectsToRelease.end());
+      // Deleting the image also deregisters it from the debugger.
+      delete Obj;
+    }
+    LoadedObjects.erase(I);
+  }
+  clearGlobalMappingsFromModule(M);
+  freeLazyFunctions(M);
+
   return OwnedModules.removeModule(M);
 }
 
@@ -103,15 +171,19 @@ bool MCJIT::removeModule(Module *M) {
 
 void MCJIT::setObjectCache(ObjectCache* NewCache) {
   MutexGuard locked(lock);
+  MutexGuard codegen(CodeGenLock);
   ObjCache = NewCache;
 }
 
-ObjectBufferStream* MCJIT::emitObject(Module *M) {
+void MCJIT::setSymbolAddressCache(SymbolAddressCache *Cache) {
   MutexGuard locked(lock);
+  Dyld.setSymbolCache(Cache);
+}
 
+ObjectBufferStream* MCJIT::emitObject(Module *M) {
   // This must be a module which has already been added but not loaded to this
-  // MCJIT instance, since these conditions are tested by our caller,
-  // generateCodeForModule.
+  // MCJIT instance, since these conditions are tested by our callers,
+  // generateCodeForModule and the background compiler.
 
   PassManager PM;
 
@@ -155,29 +227,56 @@ void MCJIT::generateCodeForModule(Module *M) {
   if (OwnedModules.hasModuleBeenLoaded(M))
     return;
 
-  OwningPtr<ObjectBuffer> ObjectToLoad;
+  splitLazyFunctions(M);
+
+  ObjectBuffer *ObjectToLoad;
+  {
+    // If the background compiler is working on this module, this waits for it
+    // and then picks up its result.
+    MutexGuard codegen(CodeGenLock);
+    BackgroundObjectMap::iterator I = BackgroundObjects.find(M);
+    if (I != BackgroundObjects.end()) {
+      ObjectToLoad = I->second;
+      BackgroundObjects.erase(I);
+    } else {
+      ObjectToLoad = compileModule(M);
+    }
+  }
+
+  loadObject(M, ObjectToLoad);
+}
+
+ObjectBuffer *MCJIT::compileModule(Module *M) {
   // Try to load the pre-compiled object from cache if possible
   if (0 != ObjCache) {
     OwningPtr<MemoryBuffer> PreCompiledObject(ObjCache->getObject(M));
     if (0 != PreCompiledObject.get())
-      ObjectToLoad.reset(new ObjectBuffer(PreCompiledObject.take()));
+      return new ObjectBuffer(PreCompiledObject.take());
   }
 
   // If the cache did not contain a suitable object, compile the object
-  if (!ObjectToLoad) {
-    ObjectToLoad.reset(emitObject(M));
-    assert(ObjectToLoad.get() && "Compilation did not produce an object.");
-  }
+  ObjectBuffer *Obj = emitObject(M);
+  assert(Obj && "Compilation did not produce an object.");
+  return Obj;
+}
+
+void MCJIT::loadObject(Module *M, ObjectBuffer *ObjectToLoad) {
+  MutexGuard locked(lock);
 
   // Load the object into the dynamic linker.
   // MCJIT now owns the ObjectImage pointer (via its LoadedObjects map).
-  ObjectImage *LoadedObject = Dyld.loadObject(ObjectToLoad.take());
+  ObjectImage *LoadedObject = Dyld.loadObject(ObjectToLoad);
   LoadedObjects[M] = LoadedObject;
   if (!LoadedObject)
     report_fatal_error(Dyld.getErrorString());
 
+  // The debugger reads the object data, so objects whose data is to be freed
+  // are not registered with it.
   // FIXME: Make this optional, maybe even move it to a JIT event listener
-  LoadedObject->registerWithDebugger();
+  if (isDiscardingObjectData())
+    ObjectsToRelease.push_back(LoadedObject);
+  else
+    LoadedObject->registerWithDebugger();
 
   NotifyObjectEmitted(*LoadedObject);
 
@@ -197,6 +296,13 @@ void MCJIT::finalizeLoadedModules() {
 
   // Set page permissions.
   MemMgr.finalizeMemory();
+
+  // With the relocations resolved, only listeners look at the objects.
+  if (!ObjectsToRelease.empty() && EventListeners.empty()) {
+    for (unsigned i = 0, e = ObjectsToRelease.size(); i != e; ++i)
+      Dyld.releaseObjectData(ObjectsToRelease[i]);
+    ObjectsToRelease.clear();
+  }
 }
 
 // FIXME: Rename this.
@@ -266,6 +372,10 @@ uint64_t MCJIT::getSymbolAddress(const std::string &Name,
 {
   MutexGuard locked(lock);
 
+  // The stubs of lazily compiled functions call back into the engine.
+  if (Name == LazyCompileCallbackName)
+    return (uint64_t)(uintptr_t)&LazyCompileCallback;
+
   // First, check to see if we already have this symbol.
   uint64_t Addr = getExistingSymbolAddress(Name);
   if (Addr)
@@ -298,6 +408,317 @@ uint64_t MCJIT::getFunctionAddress(const std::string &Name) {
   return Result;
 }
 
+void MCJIT::requestFunctionAddress(const std::string &Name) {
+  MutexGuard locked(lock);
+  if (getExistingSymbolAddress(Name))
+    return;
+  Module *M = findModuleForSymbol(Name, true);
+  if (!M)
+    return;
+  if (std::find(BackgroundQueue.begin(), BackgroundQueue.end(), M) ==
+      BackgroundQueue.end())
+    BackgroundQueue.push_back(M);
+  startBackgroundCompiler();
+}
+
+uint64_t MCJIT::getFunctionAddressIfReady(const std::string &Name) {
+  MutexGuard locked(lock);
+  uint64_t Result = getExistingSymbolAddress(Name);
+  if (Result == 0) {
+    requestFunctionAddress(Name);
+    return 0;
+  }
+  finalizeLoadedModules();
+  return Result;
+}
+
+void MCJIT::startBackgroundCompiler() {
+  // The engine lock is held by our caller.
+  if (BackgroundThread && !BackgroundThreadDone)
+    return;
+
+  // A previous background compiler has run out of work and is about to exit.
+  if (BackgroundThread) {
+    llvm_join_thread(BackgroundThread);
+    BackgroundThread = 0;
+  }
+
+  // Code generation touches global state such as the pass registry, which is
+  // only protected once LLVM is in multithreaded mode.
+  if (!llvm_is_multithreaded())
+    llvm_start_multithreaded();
+
+  BackgroundThreadDone = false;
+  BackgroundThread = llvm_create_thread(BackgroundCompilerEntry, this);
+  // Without threads, code is generated when the address is asked for.
+  if (!BackgroundThread)
+    BackgroundThreadDone = true;
+}
+
+void MCJIT::BackgroundCompilerEntry(void *Engine) {
+  static_cast<MCJIT *>(Engine)->runBackgroundCompiler();
+}
+
+void MCJIT::runBackgroundCompiler() {
+  while (true) {
+    lock.acquire();
+    Module *M = 0;
+    while (!M && !StopBackgroundThread && !BackgroundQueue.empty()) {
+      Module *Next = BackgroundQueue.front();
+      BackgroundQueue.erase(BackgroundQueue.begin());
+      if (OwnedModules.hasModuleBeenAddedButNotLoaded(Next))
+        M = Next;
+    }
+    if (!M) {
+      BackgroundThreadDone = true;
+      lock.release();
+      return;
+    }
+
+    splitLazyFunctions(M);
+
+    // Trade the engine lock for CodeGenLock, so that the engine stays usable
+    // while M is compiled, but anyone who needs M's code waits for it.
+    CodeGenLock.acquire();
+    lock.release();
+    BackgroundObjects[M] = compileModule(M);
+    CodeGenLock.release();
+
+    // Load and finalize the object, unless generateCodeForModule or
+    // removeModule got to it first.
+    MutexGuard locked(lock);
+    ObjectBuffer *Obj = 0;
+    {
+      MutexGuard codegen(CodeGenLock);
+      BackgroundObjectMap::iterator I = BackgroundObjects.find(M);
+      if (I != BackgroundObjects.end()) {
+        Obj = I->second;
+        BackgroundObjects.erase(I);
+      }
+    }
+    if (Obj) {
+      loadObject(M, Obj);
+      finalizeLoadedModules();
+    }
+  }
+}
+
+namespace {
+
+// Declares, in the module holding a function body that has been split off,
+// the globals of the original module the body refers to.
+class LazyBodyMaterializer : public ValueMaterializer {
+  Module *Body;
+
+public:
+  explicit LazyBodyMaterializer(Module *Body) : Body(Body) {}
+
+  virtual Value *materializeValueFor(Value *V) {
+    GlobalValue *GV = dyn_cast<GlobalValue>(V);
+    if (!GV)
+      return 0;
+    Type *Ty = GV->getType()->getElementType();
+    if (FunctionType *FTy = dyn_cast<FunctionType>(Ty)) {
+      Function *Decl = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                        GV->getName(), Body);
+      if (Function *F = dyn_cast<Function>(GV))
+        Decl->copyAttributesFrom(F);
+      return Decl;
+    }
+    GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV);
+    return new GlobalVariable(*Body, Ty, GVar && GVar->isConstant(),
+                              GlobalValue::ExternalLinkage, 0, GV->getName(),
+                              0, GVar ? GVar->getThreadLocalMode()
+                                      : GlobalVariable::NotThreadLocal,
+                              GV->getType()->getAddressSpace());
+  }
+};
+
+} // end anonymous namespace
+
+static bool isLazyCandidate(const Function &F) {
+  if (F.isDeclaration() || F.isVarArg() || F.hasAvailableExternallyLinkage())
+    return false;
+  if (F.getAttributes().hasAttribute(AttributeSet::FunctionIndex,
+                                     Attribute::Naked))
+    return false;
+  // A block address would end up referring to a block in another module.
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    if (BB->hasAddressTaken())
+      return false;
+  return true;
+}
+
+// Emit a call from From to Callee that passes on all of From's arguments and
+// returns the result.
+static void emitForwardingCall(IRBuilder<> &Builder, Function *From,
+                               Value *Callee) {
+  SmallVector<Value *, 8> Args;
+  for (Function::arg_iterator A = From->arg_begin(), E = From->arg_end();
+       A != E; ++A)
+    Args.push_back(A);
+  CallInst *Call = Builder.CreateCall(Callee, Args);
+  Call->setCallingConv(From->getCallingConv());
+  AttributeSet Attrs = From->getAttributes();
+  Call->setAttributes(Attrs.removeAttributes(From->getContext(),
+                                             AttributeSet::FunctionIndex,
+                                             Attrs.getFnAttributes()));
+  Call->setTailCall();
+  if (From->getReturnType()->isVoidTy())
+    Builder.CreateRetVoid();
+  else
+    Builder.CreateRet(Call);
+}
+
+void MCJIT::splitLazyFunctions(Module *M) {
+  // The stubs refer to the engine's own records, so they cannot be cached.
+  if (!isCompilingLazily() || ObjCache || !LazySplitModules.insert(M))
+    return;
+
+  SmallVector<Function *, 16> Candidates;
+  for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+    if (isLazyCandidate(*F))
+      Candidates.push_back(F);
+  if (Candidates.empty())
+    return;
+
+  // The bodies may refer to anything in M, so nothing in it can stay local.
+  // Renaming keeps the symbols of different modules apart.
+  std::string Suffix = ".lazy" + utostr(NextLazyModuleID++);
+  SmallVector<GlobalValue *, 16> Locals;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    Locals.push_back(I);
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    Locals.push_back(I);
+  for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+       I != E; ++I)
+    Locals.push_back(I);
+  for (unsigned i = 0, e = Locals.size(); i != e; ++i) {
+    GlobalValue *GV = Locals[i];
+    if (!GV->hasLocalLinkage())
+      continue;
+    GV->setName((GV->hasName() ? GV->getName() : "anon") + Suffix);
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+
+  LLVMContext &Context = M->getContext();
+  Type *Int8PtrTy = Type::getInt8PtrTy(Context);
+  Type *IntPtrTy = getDataLayout()->getIntPtrType(Context);
+  Constant *Callback = M->getOrInsertFunction(LazyCompileCallbackName,
+                                              Int8PtrTy, Int8PtrTy, NULL);
+
+  for (unsigned i = 0, e = Candidates.size(); i != e; ++i) {
+    Function *F = Candidates[i];
+    LazyFunction *LF = new LazyFunction();
+    LF->Engine = this;
+    LF->Parent = M;
+    LF->BodyName = (F->getName() + ".lazy_body").str();
+    LF->Compiled = false;
+    LF->Body = new Module(M->getModuleIdentifier() + ":" + F->getName().str(),
+                          Context);
+    LF->Body->setTargetTriple(M->getTargetTriple());
+    LF->Body->setDataLayout(M->getDataLayout());
+    LazyFunctions.push_back(LF);
+    LazySplitModules.insert(LF->Body);
+
+    // Move the body over, pointing its references to the rest of M at
+    // declarations in the new module.
+    Function *NewF = Function::Create(F->getFunctionType(),
+                                      GlobalValue::ExternalLinkage,
+                                      LF->BodyName, LF->Body);
+    NewF->copyAttributesFrom(F);
+    NewF->setVisibility(GlobalValue::DefaultVisibility);
+    NewF->getBasicBlockList().splice(NewF->end(), F->getBasicBlockList());
+    for (Function::arg_iterator A = F->arg_begin(), NewA = NewF->arg_begin(),
+         E = F->arg_end(); A != E; ++A, ++NewA) {
+      NewA->takeName(A);
+      A->replaceAllUsesWith(NewA);
+    }
+    ValueToValueMapTy VMap;
+    VMap[F] = NewF;
+    LazyBodyMaterializer Materializer(LF->Body);
+    for (Function::iterator BB = NewF->begin(), BE = NewF->end(); BB != BE;
+         ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+        RemapInstruction(I, VMap,
+                         RemapFlags(RF_NoModuleLevelChanges |
+                                    RF_IgnoreMissingEntries),
+                         0, &Materializer);
+
+    // F calls through a pointer that first leads to a resolver, which has
+    // the body compiled and updates the pointer to refer to it.
+    Function *Resolver = Function::Create(F->getFunctionType(),
+                                          GlobalValue::InternalLinkage,
+                                          F->getName() + ".lazy_resolve", M);
+    Resolver->copyAttributesFrom(F);
+    Resolver->setVisibility(GlobalValue::DefaultVisibility);
+    GlobalVariable *Target =
+        new GlobalVariable(*M, F->getType(), false,
+                           GlobalValue::InternalLinkage, Resolver,
+                           F->getName() + ".lazy_target");
+
+    IRBuilder<> Builder(BasicBlock::Create(Context, "entry", Resolver));
+    Constant *Handle = ConstantExpr::getIntToPtr(
+        ConstantInt::get(IntPtrTy, (uint64_t)(uintptr_t)LF), Int8PtrTy);
+    Value *Addr = Builder.CreatePointerCast(Builder.CreateCall(Callback, Handle),
+                                            F->getType());
+    Builder.CreateStore(Addr, Target);
+    emitForwardingCall(Builder, Resolver, Addr);
+
+    Builder.SetInsertPoint(BasicBlock::Create(Context, "entry", F));
+    emitForwardingCall(Builder, F, Builder.CreateLoad(Target));
+
+    // The stub and the resolver touch memory even if the body does not.
+    F->removeFnAttr(Attribute::ReadNone);
+    F->removeFnAttr(Attribute::ReadOnly);
+    Resolver->removeFnAttr(Attribute::ReadNone);
+    Resolver->removeFnAttr(Attribute::ReadOnly);
+  }
+}
+
+uint64_t MCJIT::compileLazyFunction(LazyFunction *LF) {
+  MutexGuard locked(lock);
+
+  if (!LF->Compiled) {
+    LF->Compiled = true;
+    OwnedModules.addModule(LF->Body);
+    generateCodeForModule(LF->Body);
+    finalizeLoadedModules();
+  }
+
+  uint64_t Addr = getExistingSymbolAddress(LF->BodyName);
+  if (!Addr)
+    report_fatal_error("Unable to compile the body of '" + LF->BodyName +
+                       "' on its first call!");
+  return Addr;
+}
+
+void MCJIT::freeLazyFunctions(Module *M) {
+  MutexGuard locked(lock);
+
+  LazySplitModules.erase(M);
+  for (unsigned i = 0; i != LazyFunctions.size();) {
+    LazyFunction *LF = LazyFunctions[i];
+    if (LF->Parent != M) {
+      ++i;
+      continue;
+    }
+    if (LF->Compiled)
+      removeModule(LF->Body);
+    LazySplitModules.erase(LF->Body);
+    delete LF->Body;
+    delete LF;
+    LazyFunctions.erase(LazyFunctions.begin() + i);
+  }
+}
+
+void *MCJIT::LazyCompileCallback(void *Handle) {
+  LazyFunction *LF = static_cast<LazyFunction *>(Handle);
+  return (void *)(uintptr_t)LF->Engine->compileLazyFunction(LF);
+}
+
 // Deprecated.  Use getFunctionAddress instead.
 void *MCJIT::getPointerToFunction(Function *F) {
   MutexGuard locked(lock);
@@ -475,7 +896,81 @@ GenericValue MCJIT::runFunction(Function *F,
     }
   }
 
-  llvm_unreachable("Full-featured argument passing not supported yet!");
+  // Everything else goes through the trampoline for the type of F.
+  CallTrampoline Trampoline = getCallTrampoline(FTy);
+  SmallVector<Type*, 8> Params(FTy->param_begin(), FTy->param_end());
+  const DataLayout *TD = getDataLayout();
+  const StructLayout *SL =
+    TD->getStructLayout(StructType::get(F->getContext(), Params));
+  SmallVector<uint64_t, 8> Args(SL->getSizeInBytes() / 8 + 1);
+  char *ArgsPtr = (char*)Args.data();
+  for (unsigned i = 0, e = Params.size(); i != e; ++i)
+    StoreValueToMemory(ArgValues[i],
+                       (GenericValue*)(ArgsPtr + SL->getElementOffset(i)),
+                       Params[i]);
+
+  SmallVector<uint64_t, 4> Ret;
+  if (!RetTy->isVoidTy())
+    Ret.resize(TD->getTypeStoreSize(RetTy) / 8 + 1);
+  Trampoline(FPtr, ArgsPtr, Ret.data());
+
+  GenericValue Result;
+  if (!RetTy->isVoidTy())
+    LoadValueFromMemory(Result, (GenericValue*)Ret.data(), RetTy);
+  return Result;
+}
+
+ExecutionEngine::CallTrampoline MCJIT::getCallTrampoline(FunctionType *FTy) {
+  MutexGuard locked(lock);
+  CallTrampoline &Trampoline = CallTrampolines[FTy];
+  if (Trampoline)
+    return Trampoline;
+
+  // Build
+  //   void @name(i8* %fn, i8* %args, i8* %ret)
+  // which loads the arguments from %args, calls %fn and stores the result to
+  // %ret, in a module of its own.
+  LLVMContext &Context = FTy->getContext();
+  std::string Name =
+    "__llvm_mcjit_trampoline" + utostr(CallTrampolines.size());
+  Module *M = new Module(Name, Context);
+  M->setTargetTriple(TM->getTargetTriple());
+  M->setDataLayout(getDataLayout()->getStringRepresentation());
+
+  Type *I8PtrTy = Type::getInt8PtrTy(Context);
+  Type *TrampolineParams[] = { I8PtrTy, I8PtrTy, I8PtrTy };
+  Function *F =
+    Function::Create(FunctionType::get(Type::getVoidTy(Context),
+                                       TrampolineParams, false),
+                     GlobalValue::ExternalLinkage, Name, M);
+  Function::arg_iterator AI = F->arg_begin();
+  Value *FnPtr = AI++;
+  Value *ArgsPtr = AI++;
+  Value *RetPtr = AI;
+
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+  SmallVector<Type*, 8> Params(FTy->param_begin(), FTy->param_end());
+  StructType *ArgsTy = StructType::get(Context, Params);
+  ArgsPtr = Builder.CreateBitCast(ArgsPtr, ArgsTy->getPointerTo());
+  SmallVector<Value*, 8> Args;
+  for (unsigned i = 0, e = Params.size(); i != e; ++i)
+    Args.push_back(Builder.CreateAlignedLoad(
+        Builder.CreateStructGEP(ArgsPtr, i), 1));
+  Value *Call =
+    Builder.CreateCall(Builder.CreateBitCast(FnPtr, FTy->getPointerTo()),
+                       Args);
+  if (!FTy->getReturnType()->isVoidTy())
+    Builder.CreateAlignedStore(
+        Call,
+        Builder.CreateBitCast(RetPtr, FTy->getReturnType()->getPointerTo()),
+        1);
+  Builder.CreateRetVoid();
+
+  addModule(M);
+  Trampoline = (CallTrampoline)(intptr_t)getFunctionAddress(Name);
+  if (!Trampoline)
+    report_fatal_error("Unable to compile the call trampoline " + Name);
+  return Trampoline;
 }
 
 void *MCJIT::getPointerToNamedFunction(const std::string &Name,
@@ -11,6 +11,7 @@
 #define LLVM_LIB_EXECUTIONENGINE_MCJIT_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
@@ -20,7 +21,9 @@
 #include "llvm/IR/Module.h"
 
 namespace llvm {
+class MachineFunctionAllocatorPool;
 class MCJIT;
+struct llvm_thread;
 
 // This is a helper class that the MCJIT execution engine uses for linking
 // functions across modules that it owns.  It aggregates the memory manager
@@ -46,6 +49,10 @@ public:
                                          SectionID, SectionName, IsReadOnly);
   }
 
+  virtual void deallocateSection(uint8_t *Addr, unsigned SectionID) {
+    ClientMM->deallocateSection(Addr, SectionID);
+  }
+
   virtual void notifyObjectLoaded(ExecutionEngine *EE,
                                   const ObjectImage *Obj) {
     ClientMM->notifyObjectLoaded(EE, Obj);
@@ -200,6 +207,11 @@ class MCJIT : public ExecutionEngine {
 
   TargetMachine *TM;
   MCContext *Ctx;
+
+  // Memory for the MachineFunctions of every module compiled, so that it is
+  // reused instead of going back to malloc after each one.
+  OwningPtr<MachineFunctionAllocatorPool> MFAllocatorPool;
+
   LinkingMemoryManager MemMgr;
   RuntimeDyld Dyld;
   SmallVector<JITEventListener*, 2> EventListeners;
@@ -209,10 +221,84 @@ class MCJIT : public ExecutionEngine {
   typedef DenseMap<Module *, ObjectImage *> LoadedObjectMap;
   LoadedObjectMap  LoadedObjects;
 
+  // The loaded objects whose data is to be freed once their relocations are
+  // resolved, if DiscardObjectData is on.
+  std::vector<ObjectImage *> ObjectsToRelease;
+
   // An optional ObjectCache to be notified of compiled objects and used to
   // perform lookup of pre-compiled code to avoid re-compilation.
   ObjectCache *ObjCache;
 
+  // CodeGenLock serializes code generation, which uses TM and ObjCache,
+  // between client threads and the background compiler.  It may be acquired
+  // while holding the engine lock, but the engine lock must never be acquired
+  // while holding it.
+  sys::Mutex CodeGenLock;
+
+  // Modules the background compiler has been asked to compile but has not
+  // picked up yet.  Guarded by the engine lock.
+  SmallVector<Module *, 4> BackgroundQueue;
+
+  // Objects compiled by the background compiler that have not been loaded
+  // yet.  Guarded by CodeGenLock.
+  typedef DenseMap<Module *, ObjectBuffer *> BackgroundObjectMap;
+  BackgroundObjectMap BackgroundObjects;
+
+  // The background compiler thread, if one has been started.  It sets
+  // BackgroundThreadDone, under the engine lock, when it runs out of work and
+  // only needs to be joined.  Guarded by the engine lock.
+  llvm_thread *BackgroundThread;
+  bool BackgroundThreadDone;
+  bool StopBackgroundThread;
+
+  // A function whose body has been split off into a module of its own when
+  // compiling lazily.  Its module keeps a stub under the original name that
+  // calls back into the engine to compile the body on the first call.
+  struct LazyFunction {
+    MCJIT *Engine;
+    Module *Parent;
+    // The module holding the body, owned by this record until it is compiled
+    // and by OwnedModules after that.
+    Module *Body;
+    std::string BodyName;
+    bool Compiled;
+  };
+  std::vector<LazyFunction *> LazyFunctions;
+
+  // Modules whose functions have already been split off, or which hold the
+  // body of a single function.  Guarded by the engine lock.
+  SmallPtrSet<Module *, 4> LazySplitModules;
+  unsigned NextLazyModuleID;
+
+  // The call trampolines made so far, by the function type they call.
+  // Guarded by the engine lock.
+  DenseMap<FunctionType *, CallTrampoline> CallTrampolines;
+
+  /// splitLazyFunctions - When compiling lazily, move the body of each
+  /// function in M into a module of its own and leave a stub in its place.
+  /// The caller must hold the engine lock.
+  void splitLazyFunctions(Module *M);
+
+  /// compileLazyFunction - Compile the body of LF, if not done yet, and
+  /// return its address.
+  uint64_t compileLazyFunction(LazyFunction *LF);
+
+  /// freeLazyFunctions - Free the split off bodies of the functions of M.
+  void freeLazyFunctions(Module *M);
+
+  static void *LazyCompileCallback(void *Handle);
+
+  /// compileModule - Produce an object for M, from the object cache if
+  /// possible.  The caller must hold CodeGenLock.
+  ObjectBuffer *compileModule(Module *M);
+
+  /// loadObject - Hand the compiled object for M to the dynamic linker.
+  void loadObject(Module *M, ObjectBuffer *Obj);
+
+  void startBackgroundCompiler();
+  void runBackgroundCompiler();
+  static void BackgroundCompilerEntry(void *Engine);
+
   Function *FindFunctionNamedInModulePtrSet(const char *FnName,
                                             ModulePtrSet::iterator I,
                                             ModulePtrSet::iterator E);
@@ -237,6 +323,8 @@ public:
   /// Sets the object manager that MCJIT should use to avoid compilation.
   virtual void setObjectCache(ObjectCache *manager);
 
+  virtual void setSymbolAddressCache(SymbolAddressCache *Cache);
+
   virtual void generateCodeForModule(Module *M);
 
   /// finalizeObject - ensure the module is fully processed and is usable.
@@ -269,6 +357,8 @@ public:
   virtual GenericValue runFunction(Function *F,
                                    const std::vector<GenericValue> &ArgValues);
 
+  virtual CallTrampoline getCallTrampoline(FunctionType *FTy);
+
   /// getPointerToNamedFunction - This method returns the address of the
   /// specified function by using the dlsym function call.  As such it is only
   /// useful for resolving library symbols, not code generated symbols.
@@ -297,6 +387,12 @@ public:
   virtual uint64_t getGlobalValueAddress(const std::string &Name);
   virtual uint64_t getFunctionAddress(const std::string &Name);
 
+  /// Code for requested functions is generated, one module at a time, on a
+  /// background thread owned by the engine.  The modules' LLVMContexts must
+  /// not be used by other threads while this happens.
+  virtual void requestFunctionAddress(const std::string &Name);
+  virtual uint64_t getFunctionAddressIfReady(const std::string &Name);
+
   /// @}
   /// @name (Private) Registration Interfaces
   /// @{
@@ -323,7 +419,7 @@ protected:
   /// Currently, MCJIT only supports a single module and the module passed to
   /// this function call is expected to be the contained module.  The module
   /// is passed as a parameter here to prepare for multiple module support in 
-  /// the future.
+  /// the future.  The caller must hold CodeGenLock.
   ObjectBufferStream* emitObject(Module *M);
 
   void NotifyObjectEmitted(const ObjectImage& Obj);
@@ -0,0 +1,415 @@
+//===- PooledSectionMemoryManager.cpp - Shared slabs for MCJIT ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements SectionMemoryPool and PooledSectionMemoryManager.
+//
+// Each kind of memory has an arena: the slabs mapped for it, the ranges of
+// them that are free, and for the kinds whose permissions change, the state
+// of every page.  A page records how many sections are on it, whether it has
+// been given its final permissions, and which manager has unfinalized
+// sections on it, if any.  The free ranges never include finalized pages.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/PooledSectionMemoryManager.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+struct PageState {
+  PageState() : Owner(0), NumSections(0), Finalized(false) {}
+
+  /// The manager with unfinalized sections on this page.
+  const void *Owner;
+  unsigned NumSections;
+  bool Finalized;
+};
+
+struct Slab {
+  sys::MemoryBlock Block;
+  std::vector<PageState> Pages;
+};
+
+typedef std::pair<uintptr_t, uintptr_t> AddrRange;
+}
+
+struct SectionMemoryPool::Arena {
+  explicit Arena(unsigned FinalPermissions)
+    : FinalPermissions(FinalPermissions) {}
+
+  /// The permissions the memory gets when it is finalized, or zero if it
+  /// stays read-write.
+  unsigned FinalPermissions;
+  /// The slabs, by start address.
+  std::map<uintptr_t, Slab> Slabs;
+  /// The free ranges, as a map from their start to their end.
+  std::map<uintptr_t, uintptr_t> Free;
+  sys::MemoryBlock Near;
+
+  PageState &getPage(uintptr_t Addr);
+  void addFree(uintptr_t Begin, uintptr_t End);
+  void removeFree(uintptr_t Begin, uintptr_t End);
+  uintptr_t findForeignPage(uintptr_t Begin, uintptr_t End,
+                            const void *Owner);
+  bool findFree(uintptr_t Size, unsigned Alignment, const void *Owner,
+                uintptr_t &Addr);
+};
+
+static size_t getPageSize() {
+  static const size_t PageSize = sys::process::get_self()->page_size();
+  return PageSize;
+}
+
+static uintptr_t alignDown(uintptr_t Addr, uintptr_t Alignment) {
+  return Addr & ~(Alignment - 1);
+}
+
+static uintptr_t alignUp(uintptr_t Addr, uintptr_t Alignment) {
+  return alignDown(Addr + Alignment - 1, Alignment);
+}
+
+/// Return the address range of B.  Empty sections still take a byte so that
+/// every section has an address of its own.
+static AddrRange getRange(const sys::MemoryBlock &B) {
+  uintptr_t Begin = (uintptr_t)B.base();
+  return AddrRange(Begin, Begin + std::max<size_t>(B.size(), 1));
+}
+
+/// Return the page-aligned ranges covering Blocks, with adjacent and
+/// overlapping ones merged.
+static std::vector<AddrRange> getPageRuns(ArrayRef<sys::MemoryBlock> Blocks) {
+  size_t PageSize = getPageSize();
+  std::vector<AddrRange> Runs;
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i) {
+    AddrRange R = getRange(Blocks[i]);
+    Runs.push_back(AddrRange(alignDown(R.first, PageSize),
+                             alignUp(R.second, PageSize)));
+  }
+  std::sort(Runs.begin(), Runs.end());
+
+  std::vector<AddrRange> Merged;
+  for (unsigned i = 0, e = Runs.size(); i != e; ++i) {
+    if (!Merged.empty() && Runs[i].first <= Merged.back().second)
+      Merged.back().second = std::max(Merged.back().second, Runs[i].second);
+    else
+      Merged.push_back(Runs[i]);
+  }
+  return Merged;
+}
+
+PageState &SectionMemoryPool::Arena::getPage(uintptr_t Addr) {
+  std::map<uintptr_t, Slab>::iterator I = Slabs.upper_bound(Addr);
+  assert(I != Slabs.begin() && "Address not in any slab!");
+  --I;
+  Slab &S = I->second;
+  assert(Addr - I->first < S.Block.size() && "Address not in any slab!");
+  return S.Pages[(Addr - I->first) / getPageSize()];
+}
+
+void SectionMemoryPool::Arena::addFree(uintptr_t Begin, uintptr_t End) {
+  // Merge with the ranges right before and right after.
+  std::map<uintptr_t, uintptr_t>::iterator Next = Free.lower_bound(Begin);
+  if (Next != Free.begin()) {
+    std::map<uintptr_t, uintptr_t>::iterator Prev = Next;
+    --Prev;
+    assert(Prev->second <= Begin && "Range already free!");
+    if (Prev->second == Begin) {
+      Begin = Prev->first;
+      Free.erase(Prev);
+    }
+  }
+  if (Next != Free.end()) {
+    assert(End <= Next->first && "Range already free!");
+    if (Next->first == End) {
+      End = Next->second;
+      Free.erase(Next);
+    }
+  }
+  Free[Begin] = End;
+}
+
+void SectionMemoryPool::Arena::removeFree(uintptr_t Begin, uintptr_t End) {
+  std::map<uintptr_t, uintptr_t>::iterator I = Free.upper_bound(Begin);
+  if (I != Free.begin())
+    --I;
+  while (I != Free.end() && I->first < End) {
+    uintptr_t RangeBegin = I->first, RangeEnd = I->second;
+    if (RangeEnd <= Begin) {
+      ++I;
+      continue;
+    }
+    Free.erase(I++);
+    if (RangeBegin < Begin)
+      Free[RangeBegin] = Begin;
+    if (End < RangeEnd)
+      Free[End] = RangeEnd;
+  }
+}
+
+/// Return the first page in [Begin, End) with unfinalized sections of a
+/// manager other than Owner, or zero if there is none.
+uintptr_t SectionMemoryPool::Arena::findForeignPage(uintptr_t Begin,
+                                                    uintptr_t End,
+                                                    const void *Owner) {
+  if (!FinalPermissions)
+    return 0;
+  size_t PageSize = getPageSize();
+  for (uintptr_t Page = alignDown(Begin, PageSize); Page < End;
+       Page += PageSize) {
+    const void *PageOwner = getPage(Page).Owner;
+    if (PageOwner && PageOwner != Owner)
+      return Page;
+  }
+  return 0;
+}
+
+/// Find the first free place for Size bytes aligned to Alignment that shares
+/// no page with the unfinalized sections of other managers.
+bool SectionMemoryPool::Arena::findFree(uintptr_t Size, unsigned Alignment,
+                                        const void *Owner, uintptr_t &Addr) {
+  for (std::map<uintptr_t, uintptr_t>::iterator I = Free.begin(),
+         E = Free.end(); I != E; ++I) {
+    uintptr_t Begin = alignUp(I->first, Alignment);
+    while (Begin >= I->first && Begin + Size <= I->second) {
+      uintptr_t Foreign = findForeignPage(Begin, Begin + Size, Owner);
+      if (!Foreign) {
+        Addr = Begin;
+        return true;
+      }
+      Begin = alignUp(Foreign + getPageSize(), Alignment);
+    }
+  }
+  return false;
+}
+
+SectionMemoryPool::SectionMemoryPool(size_t SlabSize) : SlabSize(SlabSize) {
+  Arenas[Code] = new Arena(sys::Memory::MF_READ | sys::Memory::MF_EXEC);
+  Arenas[ReadOnlyData] = new Arena(sys::Memory::MF_READ);
+  Arenas[ReadWriteData] = new Arena(0);
+}
+
+SectionMemoryPool::~SectionMemoryPool() {
+  for (unsigned K = 0; K != NumMemoryKinds; ++K) {
+    std::map<uintptr_t, Slab> &Slabs = Arenas[K]->Slabs;
+    for (std::map<uintptr_t, Slab>::iterator I = Slabs.begin(),
+           E = Slabs.end(); I != E; ++I)
+      sys::Memory::releaseMappedMemory(I->second.Block);
+    delete Arenas[K];
+  }
+}
+
+uint8_t *SectionMemoryPool::allocate(MemoryKind Kind, uintptr_t Size,
+                                     unsigned Alignment, const void *Owner) {
+  if (!Alignment)
+    Alignment = 16;
+  assert(!(Alignment & (Alignment - 1)) && "Alignment must be a power of two.");
+  Size = std::max<uintptr_t>(Size, 1);
+
+  MutexGuard Guard(Lock);
+  Arena &A = *Arenas[Kind];
+  uintptr_t Addr;
+  if (!A.findFree(Size, Alignment, Owner, Addr)) {
+    error_code ec;
+    sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(
+        std::max<size_t>(SlabSize, Size + Alignment),
+        A.Near.base() ? &A.Near : 0,
+        sys::Memory::MF_READ | sys::Memory::MF_WRITE, ec);
+    if (ec)
+      return 0;
+    A.Near = MB;
+
+    uintptr_t Begin = (uintptr_t)MB.base();
+    Slab &S = A.Slabs[Begin];
+    S.Block = MB;
+    S.Pages.resize(alignUp(MB.size(), getPageSize()) / getPageSize());
+    A.addFree(Begin, Begin + MB.size());
+
+    bool Found = A.findFree(Size, Alignment, Owner, Addr);
+    (void)Found;
+    assert(Found && "A new slab should have room for the section!");
+  }
+
+  A.removeFree(Addr, Addr + Size);
+  size_t PageSize = getPageSize();
+  for (uintptr_t Page = alignDown(Addr, PageSize); Page < Addr + Size;
+       Page += PageSize) {
+    PageState &P = A.getPage(Page);
+    ++P.NumSections;
+    if (A.FinalPermissions)
+      P.Owner = Owner;
+  }
+  return (uint8_t*)Addr;
+}
+
+error_code SectionMemoryPool::finalize(MemoryKind Kind,
+                                       ArrayRef<sys::MemoryBlock> Blocks) {
+  MutexGuard Guard(Lock);
+  Arena &A = *Arenas[Kind];
+  if (!A.FinalPermissions)
+    return error_code::success();
+
+  // Nothing else is allocated on these pages once they are protected, so
+  // what is left of them is no longer free.
+  size_t PageSize = getPageSize();
+  std::vector<AddrRange> Runs = getPageRuns(Blocks);
+  for (unsigned i = 0, e = Runs.size(); i != e; ++i) {
+    uintptr_t Begin = Runs[i].first, End = Runs[i].second;
+    sys::MemoryBlock MB((void*)Begin, End - Begin);
+    if (error_code ec = sys::Memory::protectMappedMemory(MB,
+                                                         A.FinalPermissions))
+      return ec;
+    for (uintptr_t Page = Begin; Page != End; Page += PageSize) {
+      PageState &P = A.getPage(Page);
+      P.Finalized = true;
+      P.Owner = 0;
+    }
+    A.removeFree(Begin, End);
+  }
+
+  if (Kind == Code)
+    for (unsigned i = 0, e = Blocks.size(); i != e; ++i)
+      sys::Memory::InvalidateInstructionCache(Blocks[i].base(),
+                                              Blocks[i].size());
+  return error_code::success();
+}
+
+error_code SectionMemoryPool::release(MemoryKind Kind,
+                                      ArrayRef<sys::MemoryBlock> Blocks,
+                                      bool Finalized) {
+  MutexGuard Guard(Lock);
+  Arena &A = *Arenas[Kind];
+  size_t PageSize = getPageSize();
+
+  // Finalized pages become writable and free again once the last section on
+  // them is gone.
+  std::vector<sys::MemoryBlock> EmptyPages;
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i) {
+    AddrRange R = getRange(Blocks[i]);
+    bool Protected = Finalized && A.FinalPermissions;
+    if (!Protected)
+      A.addFree(R.first, R.second);
+    for (uintptr_t Page = alignDown(R.first, PageSize); Page < R.second;
+         Page += PageSize) {
+      PageState &P = A.getPage(Page);
+      assert(P.NumSections && "Releasing a section twice!");
+      if (--P.NumSections)
+        continue;
+      P.Owner = 0;
+      if (Protected)
+        EmptyPages.push_back(sys::MemoryBlock((void*)Page, PageSize));
+    }
+  }
+
+  std::vector<AddrRange> Runs = getPageRuns(EmptyPages);
+  for (unsigned i = 0, e = Runs.size(); i != e; ++i) {
+    uintptr_t Begin = Runs[i].first, End = Runs[i].second;
+    sys::MemoryBlock MB((void*)Begin, End - Begin);
+    if (error_code ec = sys::Memory::protectMappedMemory(
+            MB, sys::Memory::MF_READ | sys::Memory::MF_WRITE))
+      return ec;
+    for (uintptr_t Page = Begin; Page != End; Page += PageSize)
+      A.getPage(Page).Finalized = false;
+    A.addFree(Begin, End);
+  }
+  return error_code::success();
+}
+
+size_t SectionMemoryPool::getMappedSize() const {
+  MutexGuard Guard(Lock);
+  size_t Size = 0;
+  for (unsigned K = 0; K != NumMemoryKinds; ++K) {
+    const std::map<uintptr_t, Slab> &Slabs = Arenas[K]->Slabs;
+    for (std::map<uintptr_t, Slab>::const_iterator I = Slabs.begin(),
+           E = Slabs.end(); I != E; ++I)
+      Size += I->second.Block.size();
+  }
+  return Size;
+}
+
+PooledSectionMemoryManager::~PooledSectionMemoryManager() {
+  for (unsigned K = 0; K != SectionMemoryPool::NumMemoryKinds; ++K) {
+    SectionMemoryPool::MemoryKind Kind = SectionMemoryPool::MemoryKind(K);
+    Pool.release(Kind, Groups[K].Pending, false);
+    Pool.release(Kind, Groups[K].Finalized, true);
+  }
+}
+
+uint8_t *PooledSectionMemoryManager::allocateCodeSection(uintptr_t Size,
+                                                         unsigned Alignment,
+                                                         unsigned SectionID,
+                                                         StringRef SectionName) {
+  return allocateSection(SectionMemoryPool::Code, Size, Alignment);
+}
+
+uint8_t *PooledSectionMemoryManager::allocateDataSection(uintptr_t Size,
+                                                         unsigned Alignment,
+                                                         unsigned SectionID,
+                                                         StringRef SectionName,
+                                                         bool IsReadOnly) {
+  return allocateSection(IsReadOnly ? SectionMemoryPool::ReadOnlyData
+                                    : SectionMemoryPool::ReadWriteData,
+                         Size, Alignment);
+}
+
+uint8_t *
+PooledSectionMemoryManager::allocateSection(SectionMemoryPool::MemoryKind Kind,
+                                            uintptr_t Size,
+                                            unsigned Alignment) {
+  uint8_t *Addr = Pool.allocate(Kind, Size, Alignment, this);
+  if (Addr)
+    Groups[Kind].Pending.push_back(sys::MemoryBlock(Addr, Size));
+  return Addr;
+}
+
+void PooledSectionMemoryManager::deallocateSection(uint8_t *Addr,
+                                                   unsigned SectionID) {
+  for (unsigned K = 0; K != SectionMemoryPool::NumMemoryKinds; ++K) {
+    SectionMemoryPool::MemoryKind Kind = SectionMemoryPool::MemoryKind(K);
+    if (releaseBlock(Kind, Groups[K].Pending, Addr, false) ||
+        releaseBlock(Kind, Groups[K].Finalized, Addr, true))
+      return;
+  }
+  llvm_unreachable("Deallocating a section this manager did not allocate!");
+}
+
+bool PooledSectionMemoryManager::releaseBlock(
+    SectionMemoryPool::MemoryKind Kind,
+    SmallVectorImpl<sys::MemoryBlock> &Blocks, uint8_t *Addr, bool Finalized) {
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i) {
+    if (Blocks[i].base() != Addr)
+      continue;
+    Pool.release(Kind, Blocks[i], Finalized);
+    Blocks.erase(Blocks.begin() + i);
+    return true;
+  }
+  return false;
+}
+
+bool PooledSectionMemoryManager::finalizeMemory(std::string *ErrMsg) {
+  for (unsigned K = 0; K != SectionMemoryPool::NumMemoryKinds; ++K) {
+    MemoryGroup &Group = Groups[K];
+    error_code ec = Pool.finalize(SectionMemoryPool::MemoryKind(K),
+                                  Group.Pending);
+    if (ec) {
+      if (ErrMsg)
+        *ErrMsg = ec.message();
+      return true;
+    }
+    Group.Finalized.append(Group.Pending.begin(), Group.Pending.end());
+    Group.Pending.clear();
+  }
+  return false;
+}
@@ -0,0 +1,361 @@
+//===-- PerfJITEventListener.cpp - Tell Linux perf about JITted code ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a JITEventListener object that tells Linux perf about
+// JITted functions.  Every function is added to the /tmp/perf-<pid>.map symbol
+// map that perf report reads for code it cannot find in a mapped file.  When
+// requested, the functions are also recorded in a jitdump file together with
+// their code and line tables, for use with perf inject --jit.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Config/config.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+
+#define DEBUG_TYPE "perf-jit-event-listener"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/DebugInfo/DIContext.h"
+#include "llvm/ExecutionEngine/ObjectImage.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+static cl::opt<bool>
+PerfJITDump("perf-jitdump",
+            cl::desc("Also record JITted code in a jitdump file for perf"),
+            cl::init(false));
+
+static cl::opt<std::string>
+PerfJITDumpDir("perf-jitdump-dir",
+               cl::desc("Directory for the jit-<pid>.dump file "
+                        "(default: current directory)"),
+               cl::init(""));
+
+namespace {
+
+// The jitdump file format, as described in
+// tools/perf/Documentation/jitdump-specification.txt of the Linux sources.
+// All the fields are in the byte order of the host.
+enum {
+  JITDumpMagic = 0x4A695444, // "JiTD"
+  JITDumpVersion = 1
+};
+
+enum JITDumpRecordType {
+  JIT_CODE_LOAD = 0,
+  JIT_CODE_MOVE = 1,
+  JIT_CODE_DEBUG_INFO = 2,
+  JIT_CODE_CLOSE = 3
+};
+
+struct JITDumpFileHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t TotalSize;
+  uint32_t ElfMach;
+  uint32_t Pad1;
+  uint32_t Pid;
+  uint64_t Timestamp;
+  uint64_t Flags;
+};
+
+struct JITDumpRecordHeader {
+  uint32_t Id;
+  uint32_t TotalSize;
+  uint64_t Timestamp;
+};
+
+struct JITDumpCodeLoad {
+  uint32_t Pid;
+  uint32_t Tid;
+  uint64_t Vma;
+  uint64_t CodeAddr;
+  uint64_t CodeSize;
+  uint64_t CodeIndex;
+};
+
+struct JITDumpDebugInfo {
+  uint64_t CodeAddr;
+  uint64_t NrEntry;
+};
+
+struct JITDumpDebugEntry {
+  uint64_t Addr;
+  int32_t Lineno;
+  int32_t Discrim;
+};
+
+class PerfJITEventListener : public JITEventListener {
+public:
+  PerfJITEventListener();
+  ~PerfJITEventListener();
+
+  virtual void NotifyObjectEmitted(const ObjectImage &Obj);
+
+private:
+  void openPerfMap();
+  void openJITDump();
+  void closeJITDump();
+
+  void writePerfMapEntry(StringRef Name, uint64_t Addr, uint64_t Size);
+  void writeDebugInfo(uint64_t Addr, DILineInfoTable &Lines);
+  void writeCodeLoad(StringRef Name, uint64_t Addr, uint64_t Size);
+
+  sys::Mutex Lock;
+  uint32_t Pid;
+  OwningPtr<raw_fd_ostream> PerfMap;
+  OwningPtr<raw_fd_ostream> JITDump;
+  // perf finds the jitdump file through the mmap event of this mapping.
+  void *JITDumpMarker;
+  size_t JITDumpMarkerSize;
+  uint64_t CodeIndex;
+};
+
+uint64_t getTimestamp() {
+  // perf record must be run with -k mono for the samples to line up.
+  struct timespec TS;
+  if (clock_gettime(CLOCK_MONOTONIC, &TS))
+    return 0;
+  return (uint64_t)TS.tv_sec * 1000000000 + TS.tv_nsec;
+}
+
+uint32_t getELFMachine() {
+  switch (Triple(sys::getProcessTriple()).getArch()) {
+  case Triple::x86:     return ELF::EM_386;
+  case Triple::x86_64:  return ELF::EM_X86_64;
+  case Triple::arm:
+  case Triple::thumb:   return ELF::EM_ARM;
+  case Triple::aarch64: return ELF::EM_AARCH64;
+  case Triple::mips:
+  case Triple::mipsel:
+  case Triple::mips64:
+  case Triple::mips64el: return ELF::EM_MIPS;
+  case Triple::ppc:     return ELF::EM_PPC;
+  case Triple::ppc64:
+  case Triple::ppc64le: return ELF::EM_PPC64;
+  case Triple::systemz: return ELF::EM_S390;
+  default:              return ELF::EM_NONE;
+  }
+}
+
+} // end anonymous namespace
+
+PerfJITEventListener::PerfJITEventListener()
+  : Pid(::getpid()), JITDumpMarker(0), JITDumpMarkerSize(0), CodeIndex(0) {
+  openPerfMap();
+  if (PerfJITDump)
+    openJITDump();
+}
+
+PerfJITEventListener::~PerfJITEventListener() {
+  closeJITDump();
+}
+
+void PerfJITEventListener::openPerfMap() {
+  std::string Path;
+  raw_string_ostream(Path) << "/tmp/perf-" << Pid << ".map";
+  int FD = ::open(Path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0666);
+  if (FD < 0) {
+    DEBUG(dbgs() << "Failed to open " << Path << ": "
+                 << sys::StrError() << "\n");
+    return;
+  }
+  PerfMap.reset(new raw_fd_ostream(FD, /*shouldClose=*/true));
+}
+
+void PerfJITEventListener::openJITDump() {
+  std::string Path;
+  raw_string_ostream OS(Path);
+  if (!PerfJITDumpDir.empty())
+    OS << PerfJITDumpDir << "/";
+  OS << "jit-" << Pid << ".dump";
+  OS.flush();
+
+  int FD = ::open(Path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (FD < 0) {
+    DEBUG(dbgs() << "Failed to open " << Path << ": "
+                 << sys::StrError() << "\n");
+    return;
+  }
+
+  // Map the first page of the file executable.  The mapping itself is never
+  // used; the PERF_RECORD_MMAP it generates is how perf inject locates the
+  // file.
+  JITDumpMarkerSize = sys::process::get_self()->page_size();
+  JITDumpMarker = ::mmap(0, JITDumpMarkerSize, PROT_READ | PROT_EXEC,
+                         MAP_PRIVATE, FD, 0);
+  if (JITDumpMarker == MAP_FAILED) {
+    DEBUG(dbgs() << "Failed to map " << Path << ": "
+                 << sys::StrError() << "\n");
+    JITDumpMarker = 0;
+    ::close(FD);
+    return;
+  }
+
+  JITDump.reset(new raw_fd_ostream(FD, /*shouldClose=*/true));
+
+  JITDumpFileHeader Header;
+  memset(&Header, 0, sizeof(Header));
+  Header.Magic = JITDumpMagic;
+  Header.Version = JITDumpVersion;
+  Header.TotalSize = sizeof(Header);
+  Header.ElfMach = getELFMachine();
+  Header.Pid = Pid;
+  Header.Timestamp = getTimestamp();
+  JITDump->write((const char *)&Header, sizeof(Header));
+  JITDump->flush();
+}
+
+void PerfJITEventListener::closeJITDump() {
+  if (JITDump) {
+    JITDumpRecordHeader Close;
+    Close.Id = JIT_CODE_CLOSE;
+    Close.TotalSize = sizeof(Close);
+    Close.Timestamp = getTimestamp();
+    JITDump->write((const char *)&Close, sizeof(Close));
+    JITDump.reset();
+  }
+  if (JITDumpMarker) {
+    ::munmap(JITDumpMarker, JITDumpMarkerSize);
+    JITDumpMarker = 0;
+  }
+}
+
+void PerfJITEventListener::writePerfMapEntry(StringRef Name, uint64_t Addr,
+                                             uint64_t Size) {
+  // START SIZE symbolname, with START and SIZE in hex and no 0x prefix.
+  PerfMap->write_hex(Addr) << ' ';
+  PerfMap->write_hex(Size) << ' ' << Name << '\n';
+}
+
+void PerfJITEventListener::writeDebugInfo(uint64_t Addr,
+                                          DILineInfoTable &Lines) {
+  uint32_t TotalSize = sizeof(JITDumpRecordHeader) + sizeof(JITDumpDebugInfo);
+  for (DILineInfoTable::iterator I = Lines.begin(), E = Lines.end();
+       I != E; ++I)
+    TotalSize += sizeof(JITDumpDebugEntry) +
+                 strlen(I->second.getFileName()) + 1;
+
+  JITDumpRecordHeader Header;
+  Header.Id = JIT_CODE_DEBUG_INFO;
+  Header.TotalSize = TotalSize;
+  Header.Timestamp = getTimestamp();
+  JITDump->write((const char *)&Header, sizeof(Header));
+
+  JITDumpDebugInfo Info;
+  Info.CodeAddr = Addr;
+  Info.NrEntry = Lines.size();
+  JITDump->write((const char *)&Info, sizeof(Info));
+
+  for (DILineInfoTable::iterator I = Lines.begin(), E = Lines.end();
+       I != E; ++I) {
+    JITDumpDebugEntry Entry;
+    Entry.Addr = I->first;
+    Entry.Lineno = I->second.getLine();
+    Entry.Discrim = 0;
+    JITDump->write((const char *)&Entry, sizeof(Entry));
+    const char *FileName = I->second.getFileName();
+    JITDump->write(FileName, strlen(FileName) + 1);
+  }
+}
+
+void PerfJITEventListener::writeCodeLoad(StringRef Name, uint64_t Addr,
+                                         uint64_t Size) {
+  JITDumpRecordHeader Header;
+  Header.Id = JIT_CODE_LOAD;
+  Header.TotalSize = sizeof(Header) + sizeof(JITDumpCodeLoad) +
+                     Name.size() + 1 + Size;
+  Header.Timestamp = getTimestamp();
+  JITDump->write((const char *)&Header, sizeof(Header));
+
+  JITDumpCodeLoad Load;
+  Load.Pid = Pid;
+  Load.Tid = ::syscall(SYS_gettid);
+  Load.Vma = Addr;
+  Load.CodeAddr = Addr;
+  Load.CodeSize = Size;
+  Load.CodeIndex = CodeIndex++;
+  JITDump->write((const char *)&Load, sizeof(Load));
+
+  JITDump->write(Name.data(), Name.size());
+  *JITDump << '\0';
+  JITDump->write((const char *)(uintptr_t)Addr, Size);
+}
+
+void PerfJITEventListener::NotifyObjectEmitted(const ObjectImage &Obj) {
+  MutexGuard locked(Lock);
+  if (!PerfMap && !JITDump)
+    return;
+
+  OwningPtr<DIContext> Context;
+  if (JITDump)
+    Context.reset(DIContext::getDWARFContext(Obj.getObjectFile()));
+
+  // Use symbol info to iterate functions in the object.
+  error_code ec;
+  for (object::symbol_iterator I = Obj.begin_symbols(),
+                               E = Obj.end_symbols();
+                        I != E && !ec;
+                        I.increment(ec)) {
+    object::SymbolRef::Type SymType;
+    if (I->getType(SymType)) continue;
+    if (SymType != object::SymbolRef::ST_Function) continue;
+
+    StringRef  Name;
+    uint64_t   Addr;
+    uint64_t   Size;
+    if (I->getName(Name)) continue;
+    if (I->getAddress(Addr)) continue;
+    if (I->getSize(Size)) continue;
+    if (Size == 0) continue;
+
+    if (PerfMap)
+      writePerfMapEntry(Name, Addr, Size);
+
+    if (JITDump) {
+      // A function's debug info must come before its code load record.
+      if (Context) {
+        DILineInfoTable Lines = Context->getLineInfoForAddressRange(Addr, Size);
+        if (!Lines.empty())
+          writeDebugInfo(Addr, Lines);
+      }
+      writeCodeLoad(Name, Addr, Size);
+    }
+  }
+
+  // Make the new entries visible to perf straight away; the process may not
+  // exit cleanly.
+  if (PerfMap)
+    PerfMap->flush();
+  if (JITDump)
+    JITDump->flush();
+}
+
+namespace llvm {
+JITEventListener *JITEventListener::createPerfJITEventListener() {
+  return new PerfJITEventListener();
+}
+} // namespace llvm
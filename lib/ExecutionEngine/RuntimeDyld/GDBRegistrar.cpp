@@ -9,6 +9,7 @@
 
 #include "JITRegistrar.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Mutex.h"
@@ -16,6 +17,31 @@
 
 using namespace llvm;
 
+namespace {
+  enum RegistrationMode {
+    RegisterImmediately,
+    RegisterOnAttach,
+    RegisterNothing
+  };
+}
+
+// Every notification makes an attached debugger load the symbols of the new
+// object, which gets slow with many objects.  Without notifications the
+// objects are only linked into the descriptor's list, which a debugger reads
+// in one go when it attaches.
+static cl::opt<RegistrationMode>
+JITDebugRegistration("jit-debug-registration", cl::init(RegisterImmediately),
+  cl::desc("How JIT compiled objects are registered with debuggers"),
+  cl::values(
+    clEnumValN(RegisterImmediately, "immediate",
+               "Notify the debugger of each object as it is loaded"),
+    clEnumValN(RegisterOnAttach, "on-attach",
+               "List objects for debuggers that attach later, without "
+               "notifying an attached one"),
+    clEnumValN(RegisterNothing, "none",
+               "Do not register objects, so their data can be freed"),
+    clEnumValEnd));
+
 // This must be kept in sync with gdb/gdb/jit.h .
 extern "C" {
 
@@ -53,9 +79,14 @@ extern "C" {
 
 namespace {
 
-// Buffer for an in-memory object file in executable memory
-typedef llvm::DenseMap< const char*,
-                        std::pair<std::size_t, jit_code_entry*> >
+// Buffer for an in-memory object file in executable memory, and whether the
+// debugger was notified when it was registered.
+struct RegisteredObject {
+  std::size_t Size;
+  jit_code_entry *Entry;
+  bool Notified;
+};
+typedef llvm::DenseMap<const char*, RegisteredObject>
   RegisteredObjectBufferMap;
 
 /// Global access point for the JIT debugging interface designed for use with a
@@ -78,7 +109,7 @@ public:
   /// Creates an entry in the JIT registry for the buffer @p Object,
   /// which must contain an object file in executable memory with any
   /// debug information for the debugger.
-  void registerObject(const ObjectBuffer &Object);
+  bool registerObject(const ObjectBuffer &Object);
 
   /// Removes the internal registration of @p Object, and
   /// frees associated resources.
@@ -96,10 +127,10 @@ private:
 /// modify global variables.
 llvm::sys::Mutex JITDebugLock;
 
-/// Acquire the lock and do the registration.
-void NotifyDebugger(jit_code_entry* JITCodeEntry) {
+/// Acquire the lock and do the registration, telling the debugger about it
+/// if Notify is set.
+void NotifyDebugger(jit_code_entry* JITCodeEntry, bool Notify) {
   llvm::MutexGuard locked(JITDebugLock);
-  __jit_debug_descriptor.action_flag = JIT_REGISTER_FN;
 
   // Insert this entry at the head of the list.
   JITCodeEntry->prev_entry = NULL;
@@ -109,8 +140,11 @@ void NotifyDebugger(jit_code_entry* JITCodeEntry) {
     NextEntry->prev_entry = JITCodeEntry;
   }
   __jit_debug_descriptor.first_entry = JITCodeEntry;
-  __jit_debug_descriptor.relevant_entry = JITCodeEntry;
-  __jit_debug_register_code();
+  if (Notify) {
+    __jit_debug_descriptor.action_flag = JIT_REGISTER_FN;
+    __jit_debug_descriptor.relevant_entry = JITCodeEntry;
+    __jit_debug_register_code();
+  }
 }
 
 GDBJITRegistrar::~GDBJITRegistrar() {
@@ -124,7 +158,9 @@ GDBJITRegistrar::~GDBJITRegistrar() {
   ObjectBufferMap.clear();
 }
 
-void GDBJITRegistrar::registerObject(const ObjectBuffer &Object) {
+bool GDBJITRegistrar::registerObject(const ObjectBuffer &Object) {
+  if (JITDebugRegistration == RegisterNothing)
+    return false;
 
   const char *Buffer = Object.getBufferStart();
   size_t      Size = Object.getBufferSize();
@@ -142,9 +178,13 @@ void GDBJITRegistrar::registerObject(const ObjectBuffer &Object) {
     JITCodeEntry->symfile_addr = Buffer;
     JITCodeEntry->symfile_size = Size;
 
-    ObjectBufferMap[Buffer] = std::make_pair(Size, JITCodeEntry);
-    NotifyDebugger(JITCodeEntry);
+    RegisteredObject &Registered = ObjectBufferMap[Buffer];
+    Registered.Size = Size;
+    Registered.Entry = JITCodeEntry;
+    Registered.Notified = JITDebugRegistration == RegisterImmediately;
+    NotifyDebugger(JITCodeEntry, Registered.Notified);
   }
+  return true;
 }
 
 bool GDBJITRegistrar::deregisterObject(const ObjectBuffer& Object) {
@@ -162,12 +202,11 @@ bool GDBJITRegistrar::deregisterObject(const ObjectBuffer& Object) {
 void GDBJITRegistrar::deregisterObjectInternal(
     RegisteredObjectBufferMap::iterator I) {
 
-  jit_code_entry*& JITCodeEntry = I->second.second;
+  jit_code_entry*& JITCodeEntry = I->second.Entry;
 
   // Acquire the lock and do the unregistration.
   {
     llvm::MutexGuard locked(JITDebugLock);
-    __jit_debug_descriptor.action_flag = JIT_UNREGISTER_FN;
 
     // Remove the jit_code_entry from the linked list.
     jit_code_entry* PrevEntry = JITCodeEntry->prev_entry;
@@ -185,8 +224,12 @@ void GDBJITRegistrar::deregisterObjectInternal(
     }
 
     // Tell the debugger which entry we removed, and unregister the code.
-    __jit_debug_descriptor.relevant_entry = JITCodeEntry;
-    __jit_debug_register_code();
+    // A debugger that was not told about the entry may not know it.
+    if (I->second.Notified) {
+      __jit_debug_descriptor.action_flag = JIT_UNREGISTER_FN;
+      __jit_debug_descriptor.relevant_entry = JITCodeEntry;
+      __jit_debug_register_code();
+    }
   }
 
   delete JITCodeEntry;
@@ -28,7 +28,9 @@ public:
   /// Creates an entry in the JIT registry for the buffer @p Object,
   /// which must contain an object file in executable memory with any
   /// debug information for the debugger.
-  virtual void registerObject(const ObjectBuffer &Object) = 0;
+  /// Returns false if registration is turned off, in which case the debugger
+  /// does not need the buffer.
+  virtual bool registerObject(const ObjectBuffer &Object) = 0;
 
   /// Removes the internal registration of @p Object, and
   /// frees associated resources.
@@ -71,6 +71,13 @@ public:
   // Subclasses can override these methods to provide JIT debugging support
   virtual void registerWithDebugger() {}
   virtual void deregisterWithDebugger() {}
+
+  virtual bool releaseObjectData() {
+    delete ObjFile;
+    ObjFile = 0;
+    Buffer.reset();
+    return true;
+  }
 };
 
 } // end namespace llvm
@@ -76,6 +76,98 @@ void RuntimeDyldImpl::mapSectionAddress(const void *LocalAddress,
   llvm_unreachable("Attempting to remap address of unknown section!");
 }
 
+static void removeRelocationsTo(SmallVectorImpl<RelocationEntry> &Relocs,
+                                unsigned Begin, unsigned End) {
+  for (unsigned i = 0; i != Relocs.size();) {
+    if (Relocs[i].SectionID >= Begin && Relocs[i].SectionID < End)
+      Relocs.erase(Relocs.begin() + i);
+    else
+      ++i;
+  }
+}
+
+void RuntimeDyldImpl::unloadObject(const ObjectImage *Obj) {
+  MutexGuard locked(lock);
+
+  ObjectSectionMap::iterator I = LoadedObjectSections.find(Obj);
+  if (I == LoadedObjectSections.end())
+    return;
+  SID Begin = I->second.first, End = I->second.second;
+  LoadedObjectSections.erase(I);
+
+  unloadSections(Begin, End);
+
+  for (unsigned i = 0; i != StackMapSections.size();) {
+    SID SectionID = StackMapSections[i];
+    if (SectionID < Begin || SectionID >= End) {
+      ++i;
+      continue;
+    }
+    MemMgr->deregisterStackMaps(Sections[SectionID].Address,
+                                Sections[SectionID].LoadAddress,
+                                Sections[SectionID].Size);
+    StackMapSections.erase(StackMapSections.begin() + i);
+  }
+
+  // Forget the symbols the object defined so that nothing loaded later
+  // resolves to its memory.
+  for (SymbolTableMap::iterator SI = GlobalSymbolTable.begin(),
+       SE = GlobalSymbolTable.end(); SI != SE;) {
+    SymbolTableMap::iterator Cur = SI;
+    ++SI;
+    if (Cur->second.first >= Begin && Cur->second.first < End)
+      GlobalSymbolTable.erase(Cur);
+  }
+
+  // Drop the pending relocations based on the object's sections, and those
+  // that would have been applied to them.
+  for (SID i = Begin; i != End; ++i)
+    Relocations.erase(i);
+  for (DenseMap<unsigned, RelocationList>::iterator RI = Relocations.begin(),
+       RE = Relocations.end(); RI != RE; ++RI)
+    removeRelocationsTo(RI->second, Begin, End);
+  for (StringMap<RelocationList>::iterator RI =
+         ExternalSymbolRelocations.begin(),
+       RE = ExternalSymbolRelocations.end(); RI != RE;) {
+    StringMap<RelocationList>::iterator Cur = RI;
+    ++RI;
+    removeRelocationsTo(Cur->second, Begin, End);
+    if (Cur->second.empty())
+      ExternalSymbolRelocations.erase(Cur);
+  }
+
+  // Give the memory back.  The entries stay in the list, empty, so that the
+  // SectionIDs of other objects keep their meaning.
+  for (SID i = Begin; i != End; ++i) {
+    if (Sections[i].Address)
+      MemMgr->deallocateSection(Sections[i].Address, i);
+    Sections[i] = SectionEntry(StringRef(), 0, 0, 0);
+  }
+}
+
+bool RuntimeDyldImpl::releaseObjectData(ObjectImage *Obj) {
+  MutexGuard locked(lock);
+
+  ObjectSectionMap::iterator I = LoadedObjectSections.find(Obj);
+#ifndef NDEBUG
+  // Relocations read their addends from the object's copy of the section.
+  if (I != LoadedObjectSections.end())
+    for (DenseMap<unsigned, RelocationList>::iterator RI = Relocations.begin(),
+         RE = Relocations.end(); RI != RE; ++RI)
+      for (unsigned j = 0, e = RI->second.size(); j != e; ++j)
+        assert((RI->second[j].SectionID < I->second.first ||
+                RI->second[j].SectionID >= I->second.second) &&
+               "Releasing an object with unresolved relocations");
+#endif
+
+  if (!Obj->releaseObjectData())
+    return false;
+  if (I != LoadedObjectSections.end())
+    for (SID i = I->second.first; i != I->second.second; ++i)
+      Sections[i].ObjAddress = 0;
+  return true;
+}
+
 // Subclasses can implement this method to create specialized image instances.
 // The caller owns the pointer that is returned.
 ObjectImage *RuntimeDyldImpl::createObjectImage(ObjectBuffer *InputBuffer) {
@@ -89,6 +181,9 @@ ObjectImage *RuntimeDyldImpl::loadObject(ObjectBuffer *InputBuffer) {
   if (!obj)
     report_fatal_error("Unable to create object image from memory buffer!");
 
+  // All the sections of this object are emitted from here on.
+  SID FirstSectionID = Sections.size();
+
   // Save information about our target
   Arch = (Triple::ArchType)obj->getArch();
   IsTargetLittleEndian = obj->getObjectFile()->isLittleEndian();
@@ -189,6 +284,25 @@ ObjectImage *RuntimeDyldImpl::loadObject(ObjectBuffer *InputBuffer) {
   // Give the subclasses a chance to tie-up any loose ends.
   finalizeLoad(LocalSections);
 
+  // Hand the stack maps to the memory manager.  Nothing refers to them, so
+  // they have to be emitted explicitly.
+  for (section_iterator si = obj->begin_sections(),
+       se = obj->end_sections(); si != se; si.increment(err)) {
+    Check(err);
+    StringRef Name;
+    Check(si->getName(Name));
+    if (Name != ".llvm_stackmaps" && Name != "__llvm_stackmaps")
+      continue;
+    SID SectionID = findOrEmitSection(*obj, *si, false, LocalSections);
+    StackMapSections.push_back(SectionID);
+    MemMgr->registerStackMaps(Sections[SectionID].Address,
+                              Sections[SectionID].LoadAddress,
+                              Sections[SectionID].Size);
+  }
+
+  LoadedObjectSections[obj.get()] =
+      std::make_pair(FirstSectionID, (SID)Sections.size());
+
   return obj.take();
 }
 
@@ -495,7 +609,42 @@ void RuntimeDyldImpl::resolveRelocationList(const RelocationList &Relocs,
   }
 }
 
+void RuntimeDyldImpl::resolveCachedExternalSymbols() {
+  SmallVector<StringRef, 16> Names;
+  for (StringMap<RelocationList>::iterator i =
+         ExternalSymbolRelocations.begin(),
+       e = ExternalSymbolRelocations.end(); i != e; ++i) {
+    StringRef Name = i->first();
+    if (!Name.empty() && !GlobalSymbolTable.count(Name))
+      Names.push_back(Name);
+  }
+  if (Names.empty())
+    return;
+
+  SmallVector<uint64_t, 16> Addrs;
+  SymbolCache->lookup(Names, Addrs);
+  for (unsigned i = 0, e = Names.size(); i != e; ++i) {
+    uint64_t Addr = Addrs[i];
+    if (!Addr)
+      continue;
+    // Erasing the entry frees the name, so resolve everything before.
+    StringMap<RelocationList>::iterator I =
+        ExternalSymbolRelocations.find(Names[i]);
+    updateGOTEntries(Names[i], Addr);
+    DEBUG(dbgs() << "Resolving relocations Name: " << Names[i]
+            << "\t" << format("0x%lx", Addr)
+            << " (cached)\n");
+    resolveRelocationList(I->second, Addr);
+    ExternalSymbolRelocations.erase(I);
+  }
+}
+
 void RuntimeDyldImpl::resolveExternalSymbols() {
+  // Resolve the symbols we already know about in one go, leaving only those
+  // the memory manager has to look up.
+  if (SymbolCache)
+    resolveCachedExternalSymbols();
+
   while(!ExternalSymbolRelocations.empty()) {
     StringMap<RelocationList>::iterator i = ExternalSymbolRelocations.begin();
 
@@ -519,6 +668,10 @@ void RuntimeDyldImpl::resolveExternalSymbols() {
           // associated with this symbol is deferred until below this point.
           // New entries may have been added to the relocation list.
           i = ExternalSymbolRelocations.find(Name);
+          // Share the address with later loads unless it turned out to be
+          // in code we loaded ourselves.
+          if (Addr && SymbolCache && !GlobalSymbolTable.count(Name))
+            SymbolCache->addSymbol(Name, Addr);
       } else {
         // We found the symbol in our global table.  It was probably in a
         // Module that we loaded previously.
@@ -557,6 +710,7 @@ RuntimeDyld::RuntimeDyld(RTDyldMemoryManager *mm) {
   // permissions are applied.
   Dyld = 0;
   MM = mm;
+  SymbolCache = 0;
 }
 
 RuntimeDyld::~RuntimeDyld() {
@@ -596,6 +750,7 @@ ObjectImage *RuntimeDyld::loadObject(ObjectBuffer *InputBuffer) {
     case sys::fs::file_magic::windows_resource:
       report_fatal_error("Incompatible object format!");
     }
+    Dyld->setSymbolCache(SymbolCache);
   } else {
     if (!Dyld->isCompatibleFormat(InputBuffer))
       report_fatal_error("Incompatible object format!");
@@ -634,6 +789,23 @@ StringRef RuntimeDyld::getErrorString() {
   return Dyld->getErrorString();
 }
 
+void RuntimeDyld::setSymbolCache(SymbolAddressCache *Cache) {
+  SymbolCache = Cache;
+  if (Dyld)
+    Dyld->setSymbolCache(Cache);
+}
+
+void RuntimeDyld::unloadObject(const ObjectImage *Obj) {
+  if (Dyld)
+    Dyld->unloadObject(Obj);
+}
+
+bool RuntimeDyld::releaseObjectData(ObjectImage *Obj) {
+  if (Dyld)
+    return Dyld->releaseObjectData(Obj);
+  return Obj->releaseObjectData();
+}
+
 void RuntimeDyld::registerEHFrames() {
   if (Dyld)
     Dyld->registerEHFrames();
@@ -105,13 +105,21 @@ class ELFObjectImage : public ObjectImageCommon {
 
     virtual void registerWithDebugger()
     {
-      JITRegistrar::getGDBRegistrar().registerObject(*Buffer);
-      Registered = true;
+      Registered = JITRegistrar::getGDBRegistrar().registerObject(*Buffer);
     }
     virtual void deregisterWithDebugger()
     {
       JITRegistrar::getGDBRegistrar().deregisterObject(*Buffer);
     }
+
+    virtual bool releaseObjectData()
+    {
+      // The debugger reads the object from our buffer.
+      if (Registered)
+        return false;
+      DyldObj = 0;
+      return ObjectImageCommon::releaseObjectData();
+    }
 };
 
 // The MemoryBuffer passed into this constructor is just a wrapper around the
@@ -178,6 +186,35 @@ void RuntimeDyldELF::deregisterEHFrames() {
   RegisteredEHFrameSections.clear();
 }
 
+void RuntimeDyldELF::unloadSections(SID Begin, SID End) {
+  for (unsigned i = 0; i != RegisteredEHFrameSections.size();) {
+    SID EHFrameSID = RegisteredEHFrameSections[i];
+    if (EHFrameSID < Begin || EHFrameSID >= End) {
+      ++i;
+      continue;
+    }
+    if (MemMgr)
+      MemMgr->deregisterEHFrames(Sections[EHFrameSID].Address,
+                                 Sections[EHFrameSID].LoadAddress,
+                                 Sections[EHFrameSID].Size);
+    RegisteredEHFrameSections.erase(RegisteredEHFrameSections.begin() + i);
+  }
+  for (unsigned i = 0; i != UnregisteredEHFrameSections.size();) {
+    SID EHFrameSID = UnregisteredEHFrameSections[i];
+    if (EHFrameSID >= Begin && EHFrameSID < End)
+      UnregisteredEHFrameSections.erase(
+          UnregisteredEHFrameSections.begin() + i);
+    else
+      ++i;
+  }
+  for (unsigned i = 0; i != GOTs.size();) {
+    if (GOTs[i].first >= Begin && GOTs[i].first < End)
+      GOTs.erase(GOTs.begin() + i);
+    else
+      ++i;
+  }
+}
+
 ObjectImage *RuntimeDyldELF::createObjectImage(ObjectBuffer *Buffer) {
   if (Buffer->getBufferSize() < ELF::EI_NIDENT)
     llvm_unreachable("Unexpected ELF object size");
@@ -576,17 +613,16 @@ uint64_t RuntimeDyldELF::findPPC64TOC() const {
   return it->LoadAddress + 0x8000;
 }
 
-// Returns the sections and offset associated with the ODP entry referenced
-// by Symbol.
-void RuntimeDyldELF::findOPDEntrySection(ObjectImage &Obj,
-                                         ObjSectionToIDMap &LocalSections,
-                                         RelocationValueRef &Rel) {
-  // Get the ELF symbol value (st_value) to compare with Relocation offset in
-  // .opd entries
-
+/// findOPDEntry - Find the .opd entry whose first field is at EntryOffset,
+/// reading the relocations of .opd in bulk.  Return false if there is none.
+template <class ELFT>
+static bool findOPDEntry(const ELFObjectFile<ELFT> &Obj, int64_t EntryOffset,
+                         SymbolRef &TargetSymbol, int64_t &Addend) {
+  SmallVector<ELFRelocationView<ELFT>, 64> Relocs;
   error_code err;
   for (section_iterator si = Obj.begin_sections(),
      se = Obj.end_sections(); si != se; si.increment(err)) {
+    check(err);
     section_iterator RelSecI = si->getRelocatedSection();
     if (RelSecI == Obj.end_sections())
       continue;
@@ -596,50 +632,50 @@ void RuntimeDyldELF::findOPDEntrySection(ObjectImage &Obj,
     if (RelSectionName != ".opd")
       continue;
 
-    for (relocation_iterator i = si->begin_relocations(),
-         e = si->end_relocations(); i != e;) {
-      check(err);
-
-      // The R_PPC64_ADDR64 relocation indicates the first field
-      // of a .opd entry
-      uint64_t TypeFunc;
-      check(i->getType(TypeFunc));
-      if (TypeFunc != ELF::R_PPC64_ADDR64) {
-        i.increment(err);
-        continue;
-      }
-
-      uint64_t TargetSymbolOffset;
-      symbol_iterator TargetSymbol = i->getSymbol();
-      check(i->getOffset(TargetSymbolOffset));
-      int64_t Addend;
-      check(getELFRelocationAddend(*i, Addend));
-
-      i = i.increment(err);
-      if (i == e)
-        break;
-      check(err);
-
-      // Just check if following relocation is a R_PPC64_TOC
-      uint64_t TypeTOC;
-      check(i->getType(TypeTOC));
-      if (TypeTOC != ELF::R_PPC64_TOC)
+    check(Obj.getRelocationViews(*si, Relocs));
+    for (unsigned i = 0, e = Relocs.size(); i + 1 < e; ++i) {
+      // An R_PPC64_ADDR64 relocation followed by an R_PPC64_TOC one marks the
+      // first field of a .opd entry.
+      if (Relocs[i].Type != ELF::R_PPC64_ADDR64 ||
+          Relocs[i + 1].Type != ELF::R_PPC64_TOC)
         continue;
 
-      // Finally compares the Symbol value and the target symbol offset
-      // to check if this .opd entry refers to the symbol the relocation
-      // points to.
-      if (Rel.Addend != (int64_t)TargetSymbolOffset)
+      // Compare the symbol value and the target symbol offset to check if
+      // this .opd entry refers to the symbol the relocation points to.
+      if ((int64_t)Relocs[i].Offset != EntryOffset)
         continue;
 
-      section_iterator tsi(Obj.end_sections());
-      check(TargetSymbol->getSection(tsi));
-      Rel.SectionID = findOrEmitSection(Obj, (*tsi), true, LocalSections);
-      Rel.Addend = (intptr_t)Addend;
-      return;
+      TargetSymbol = Relocs[i].Symbol;
+      Addend = Relocs[i].Addend;
+      return true;
     }
   }
-  llvm_unreachable("Attempting to get address of ODP entry!");
+  return false;
+}
+
+// Returns the sections and offset associated with the ODP entry referenced
+// by Symbol.
+void RuntimeDyldELF::findOPDEntrySection(ObjectImage &Obj,
+                                         ObjSectionToIDMap &LocalSections,
+                                         RelocationValueRef &Rel) {
+  // Get the ELF symbol value (st_value) to compare with Relocation offset in
+  // .opd entries
+  ObjectFile *ObjFile = Obj.getObjectFile();
+  SymbolRef TargetSymbol;
+  int64_t Addend;
+  bool Found;
+  if (const ELF64LEObjectFile *ELFObj = dyn_cast<ELF64LEObjectFile>(ObjFile))
+    Found = findOPDEntry(*ELFObj, Rel.Addend, TargetSymbol, Addend);
+  else
+    Found = findOPDEntry(*cast<ELF64BEObjectFile>(ObjFile), Rel.Addend,
+                         TargetSymbol, Addend);
+  if (!Found)
+    llvm_unreachable("Attempting to get address of ODP entry!");
+
+  section_iterator tsi(Obj.end_sections());
+  check(TargetSymbol.getSection(tsi));
+  Rel.SectionID = findOrEmitSection(Obj, (*tsi), true, LocalSections);
+  Rel.Addend = (intptr_t)Addend;
 }
 
 // Relocation masks following the #lo(value), #hi(value), #higher(value),
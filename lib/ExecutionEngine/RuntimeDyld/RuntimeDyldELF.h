@@ -144,6 +144,7 @@ public:
   virtual void registerEHFrames();
   virtual void deregisterEHFrames();
   virtual void finalizeLoad(ObjSectionToIDMap &SectionMap);
+  virtual void unloadSections(SID Begin, SID End);
   virtual ~RuntimeDyldELF();
 };
 
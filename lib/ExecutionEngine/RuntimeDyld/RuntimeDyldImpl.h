@@ -20,6 +20,7 @@
 #include "llvm/ADT/Triple.h"
 #include "llvm/ExecutionEngine/ObjectImage.h"
 #include "llvm/ExecutionEngine/RuntimeDyld.h"
+#include "llvm/ExecutionEngine/SymbolAddressCache.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -143,6 +144,9 @@ protected:
   // The MemoryManager to load objects into.
   RTDyldMemoryManager *MemMgr;
 
+  // The addresses of external symbols shared with other linkers, if any.
+  SymbolAddressCache *SymbolCache;
+
   // A list of all sections emitted by the dynamic linker.  These sections are
   // referenced in the code by means of their index in this list - SectionID.
   typedef SmallVector<SectionEntry, 64> SectionList;
@@ -182,6 +186,15 @@ protected:
   // modules.  This map is indexed by symbol name.
   StringMap<RelocationList> ExternalSymbolRelocations;
 
+  // The sections emitted for each loaded object, which are always the
+  // contiguous range [first, second) of SectionIDs.  Used to unload it.
+  typedef DenseMap<const ObjectImage*, std::pair<SID, SID> > ObjectSectionMap;
+  ObjectSectionMap LoadedObjectSections;
+
+  // The stack map sections handed to the memory manager, to take back when
+  // their objects are unloaded.
+  SmallVector<SID, 2> StackMapSections;
+
   typedef std::map<RelocationValueRef, uintptr_t> StubMap;
 
   Triple::ArchType Arch;
@@ -306,13 +319,18 @@ protected:
   /// \brief Resolve relocations to external symbols.
   void resolveExternalSymbols();
 
+  /// \brief Resolve the relocations to the external symbols whose address is
+  /// in the symbol cache.
+  void resolveCachedExternalSymbols();
+
   /// \brief Update GOT entries for external symbols.
   // The base class does nothing.  ELF overrides this.
   virtual void updateGOTEntries(StringRef Name, uint64_t Addr) {}
 
   virtual ObjectImage *createObjectImage(ObjectBuffer *InputBuffer);
 public:
-  RuntimeDyldImpl(RTDyldMemoryManager *mm) : MemMgr(mm), HasError(false) {}
+  RuntimeDyldImpl(RTDyldMemoryManager *mm)
+    : MemMgr(mm), SymbolCache(0), HasError(false) {}
 
   virtual ~RuntimeDyldImpl();
 
@@ -360,6 +378,17 @@ public:
   virtual void deregisterEHFrames();
 
   virtual void finalizeLoad(ObjSectionToIDMap &SectionMap) {}
+
+  void unloadObject(const ObjectImage *Obj);
+
+  bool releaseObjectData(ObjectImage *Obj);
+
+  void setSymbolCache(SymbolAddressCache *Cache) { SymbolCache = Cache; }
+
+  /// \brief Forget the format-specific state, such as EH frames, that refers
+  /// to the sections [Begin, End) of an object being unloaded.
+  // The base class does nothing.
+  virtual void unloadSections(SID Begin, SID End) {}
 };
 
 } // end namespace llvm
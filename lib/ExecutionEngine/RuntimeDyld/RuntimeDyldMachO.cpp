@@ -84,10 +84,34 @@ void RuntimeDyldMachO::registerEHFrames() {
     MemMgr->registerEHFrames(EHFrame->Address,
                              EHFrame->LoadAddress,
                              EHFrame->Size);
+    RegisteredEHFrameSections.push_back(SectionInfo.EHFrameSID);
   }
   UnregisteredEHFrameSections.clear();
 }
 
+void RuntimeDyldMachO::unloadSections(SID Begin, SID End) {
+  for (unsigned i = 0; i != RegisteredEHFrameSections.size();) {
+    SID EHFrameSID = RegisteredEHFrameSections[i];
+    if (EHFrameSID < Begin || EHFrameSID >= End) {
+      ++i;
+      continue;
+    }
+    if (MemMgr)
+      MemMgr->deregisterEHFrames(Sections[EHFrameSID].Address,
+                                 Sections[EHFrameSID].LoadAddress,
+                                 Sections[EHFrameSID].Size);
+    RegisteredEHFrameSections.erase(RegisteredEHFrameSections.begin() + i);
+  }
+  for (unsigned i = 0; i != UnregisteredEHFrameSections.size();) {
+    SID EHFrameSID = UnregisteredEHFrameSections[i].EHFrameSID;
+    if (EHFrameSID >= Begin && EHFrameSID < End)
+      UnregisteredEHFrameSections.erase(
+          UnregisteredEHFrameSections.begin() + i);
+    else
+      ++i;
+  }
+}
+
 void RuntimeDyldMachO::finalizeLoad(ObjSectionToIDMap &SectionMap) {
   unsigned EHFrameSID = RTDYLD_INVALID_SECTION_ID;
   unsigned TextSID = RTDYLD_INVALID_SECTION_ID;
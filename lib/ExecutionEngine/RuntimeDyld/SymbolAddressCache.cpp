@@ -0,0 +1,51 @@
+//===-- SymbolAddressCache.cpp - Shared external symbol addresses ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the SymbolAddressCache class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/SymbolAddressCache.h"
+#include "llvm/Support/MutexGuard.h"
+
+using namespace llvm;
+
+void SymbolAddressCache::addSymbol(StringRef Name, uint64_t Addr) {
+  MutexGuard locked(Lock);
+  Symbols[Name] = Addr;
+}
+
+void SymbolAddressCache::removeSymbol(StringRef Name) {
+  MutexGuard locked(Lock);
+  Symbols.erase(Name);
+}
+
+void SymbolAddressCache::clear() {
+  MutexGuard locked(Lock);
+  Symbols.clear();
+}
+
+uint64_t SymbolAddressCache::lookup(StringRef Name) const {
+  MutexGuard locked(Lock);
+  return Symbols.lookup(Name);
+}
+
+void SymbolAddressCache::lookup(ArrayRef<StringRef> Names,
+                                SmallVectorImpl<uint64_t> &Addrs) const {
+  Addrs.clear();
+  Addrs.reserve(Names.size());
+  MutexGuard locked(Lock);
+  for (unsigned i = 0, e = Names.size(); i != e; ++i)
+    Addrs.push_back(Symbols.lookup(Names[i]));
+}
+
+size_t SymbolAddressCache::size() const {
+  MutexGuard locked(Lock);
+  return Symbols.size();
+}
@@ -142,11 +142,18 @@ public:
 /// element: function, return type, or parameter.
 class AttributeSetNode : public FoldingSetNode {
   unsigned NumAttrs; ///< Number of attributes in this node.
+  /// \brief Bitmask of the enum attribute kinds in this node.
+  uint64_t AvailableAttrs;
 
-  AttributeSetNode(ArrayRef<Attribute> Attrs) : NumAttrs(Attrs.size()) {
+  AttributeSetNode(ArrayRef<Attribute> Attrs)
+      : NumAttrs(Attrs.size()), AvailableAttrs(0) {
+    assert(Attribute::EndAttrKinds <= 64 && "Too many attributes for mask!");
     // There's memory after the node where we can store the entries in.
     std::copy(Attrs.begin(), Attrs.end(),
               reinterpret_cast<Attribute *>(this + 1));
+    for (iterator I = begin(), E = end(); I != E; ++I)
+      if (!I->isStringAttribute())
+        AvailableAttrs |= getKindMask(I->getKindAsEnum());
   }
 
   // AttributesSetNode is uniqued, these should not be publicly available.
@@ -155,10 +162,20 @@ class AttributeSetNode : public FoldingSetNode {
 public:
   static AttributeSetNode *get(LLVMContext &C, ArrayRef<Attribute> Attrs);
 
-  bool hasAttribute(Attribute::AttrKind Kind) const;
+  /// \brief Return the bit for the given kind in the enum attribute masks.
+  static uint64_t getKindMask(Attribute::AttrKind Kind) {
+    return uint64_t(1) << Kind;
+  }
+
+  bool hasAttribute(Attribute::AttrKind Kind) const {
+    return AvailableAttrs & getKindMask(Kind);
+  }
   bool hasAttribute(StringRef Kind) const;
   bool hasAttributes() const { return NumAttrs != 0; }
 
+  /// \brief Return the mask of the enum attribute kinds in this node.
+  uint64_t getAvailableAttrs() const { return AvailableAttrs; }
+
   Attribute getAttribute(Attribute::AttrKind Kind) const;
   Attribute getAttribute(StringRef Kind) const;
 
@@ -190,19 +207,29 @@ class AttributeSetImpl : public FoldingSetNode {
 
   typedef std::pair<unsigned, AttributeSetNode*> IndexAttrPair;
   unsigned NumAttrs; ///< Number of entries in this set.
+  unsigned NumIndices; ///< Number of entries in the index-to-node table.
+  AttributeSetNode *FunctionNode; ///< The function attributes, if any.
+  uint64_t AvailableSomewhere; ///< Enum attribute kinds at any index.
 
   /// \brief Return a pointer to the IndexAttrPair for the specified slot.
   const IndexAttrPair *getNode(unsigned Slot) const {
     return reinterpret_cast<const IndexAttrPair *>(this + 1) + Slot;
   }
 
+  /// \brief Return the table that maps the return and parameter indices to
+  /// their nodes.  It follows the IndexAttrPairs.
+  AttributeSetNode *const *getIndexTable() const {
+    return reinterpret_cast<AttributeSetNode *const *>(getNode(NumAttrs));
+  }
+
   // AttributesSet is uniqued, these should not be publicly available.
   void operator=(const AttributeSetImpl &) LLVM_DELETED_FUNCTION;
   AttributeSetImpl(const AttributeSetImpl &) LLVM_DELETED_FUNCTION;
 public:
   AttributeSetImpl(LLVMContext &C,
                    ArrayRef<std::pair<unsigned, AttributeSetNode *> > Attrs)
-      : Context(C), NumAttrs(Attrs.size()) {
+      : Context(C), NumAttrs(Attrs.size()), NumIndices(getNumIndices(Attrs)),
+        FunctionNode(0), AvailableSomewhere(0) {
 #ifndef NDEBUG
     if (Attrs.size() >= 2) {
       for (const std::pair<unsigned, AttributeSetNode *> *i = Attrs.begin() + 1,
@@ -215,6 +242,30 @@ public:
     // There's memory after the node where we can store the entries in.
     std::copy(Attrs.begin(), Attrs.end(),
               reinterpret_cast<IndexAttrPair *>(this + 1));
+
+    // Followed by the index-to-node table.  The first node for an index is
+    // the one that is used.
+    AttributeSetNode **Table = const_cast<AttributeSetNode **>(getIndexTable());
+    std::fill(Table, Table + NumIndices, (AttributeSetNode *)0);
+    for (unsigned I = NumAttrs; I != 0; --I) {
+      unsigned Index = Attrs[I - 1].first;
+      AttributeSetNode *Node = Attrs[I - 1].second;
+      if (Index == AttributeSet::FunctionIndex)
+        FunctionNode = Node;
+      else
+        Table[Index] = Node;
+      AvailableSomewhere |= Node->getAvailableAttrs();
+    }
+  }
+
+  /// \brief Return the number of entries that the index-to-node table of a
+  /// set with the given slots needs: one more than the largest index other
+  /// than the function index.
+  static unsigned getNumIndices(ArrayRef<IndexAttrPair> Attrs) {
+    for (unsigned I = Attrs.size(); I != 0; --I)
+      if (Attrs[I - 1].first != AttributeSet::FunctionIndex)
+        return Attrs[I - 1].first + 1;
+    return 0;
   }
 
   /// \brief Get the context that created this AttributeSetImpl.
@@ -244,6 +295,19 @@ public:
     return getNode(Slot)->second;
   }
 
+  /// \brief Return the attribute set node for the given return, parameter or
+  /// function index, or null if there are no attributes at it.
+  AttributeSetNode *getIndexNode(unsigned Index) const {
+    if (Index == AttributeSet::FunctionIndex)
+      return FunctionNode;
+    return Index < NumIndices ? getIndexTable()[Index] : 0;
+  }
+
+  /// \brief Return true if the given attribute is at any index.
+  bool hasAttrSomewhere(Attribute::AttrKind Kind) const {
+    return AvailableSomewhere & AttributeSetNode::getKindMask(Kind);
+  }
+
   typedef AttributeSetNode::iterator iterator;
   iterator begin(unsigned Slot) const { return getSlotNode(Slot)->begin(); }
   iterator end(unsigned Slot) const { return getSlotNode(Slot)->end(); }
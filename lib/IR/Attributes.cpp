@@ -430,13 +430,6 @@ AttributeSetNode *AttributeSetNode::get(LLVMContext &C,
   return PA;
 }
 
-bool AttributeSetNode::hasAttribute(Attribute::AttrKind Kind) const {
-  for (iterator I = begin(), E = end(); I != E; ++I)
-    if (I->hasAttribute(Kind))
-      return true;
-  return false;
-}
-
 bool AttributeSetNode::hasAttribute(StringRef Kind) const {
   for (iterator I = begin(), E = end(); I != E; ++I)
     if (I->hasAttribute(Kind))
@@ -445,6 +438,8 @@ bool AttributeSetNode::hasAttribute(StringRef Kind) const {
 }
 
 Attribute AttributeSetNode::getAttribute(Attribute::AttrKind Kind) const {
+  if (!hasAttribute(Kind))
+    return Attribute();
   for (iterator I = begin(), E = end(); I != E; ++I)
     if (I->hasAttribute(Kind))
       return *I;
@@ -459,6 +454,8 @@ Attribute AttributeSetNode::getAttribute(StringRef Kind) const {
 }
 
 unsigned AttributeSetNode::getAlignment() const {
+  if (!hasAttribute(Attribute::Alignment))
+    return 0;
   for (iterator I = begin(), E = end(); I != E; ++I)
     if (I->hasAttribute(Attribute::Alignment))
       return I->getAlignment();
@@ -466,6 +463,8 @@ unsigned AttributeSetNode::getAlignment() const {
 }
 
 unsigned AttributeSetNode::getStackAlignment() const {
+  if (!hasAttribute(Attribute::StackAlignment))
+    return 0;
   for (iterator I = begin(), E = end(); I != E; ++I)
     if (I->hasAttribute(Attribute::StackAlignment))
       return I->getStackAlignment();
@@ -536,10 +535,13 @@ AttributeSet::getImpl(LLVMContext &C,
   // If we didn't find any existing attributes of the same shape then
   // create a new one and insert it.
   if (!PA) {
-    // Coallocate entries after the AttributeSetImpl itself.
+    // Coallocate entries, and then the index-to-node table, after the
+    // AttributeSetImpl itself.
     void *Mem = ::operator new(sizeof(AttributeSetImpl) +
                                sizeof(std::pair<unsigned, AttributeSetNode *>) *
-                                   Attrs.size());
+                                   Attrs.size() +
+                               sizeof(AttributeSetNode *) *
+                                   AttributeSetImpl::getNumIndices(Attrs));
     PA = new (Mem) AttributeSetImpl(C, Attrs);
     pImpl->AttrsLists.InsertNode(PA, InsertPoint);
   }
@@ -833,15 +835,7 @@ bool AttributeSet::hasAttributes(unsigned Index) const {
 /// \brief Return true if the specified attribute is set for at least one
 /// parameter or for the return value.
 bool AttributeSet::hasAttrSomewhere(Attribute::AttrKind Attr) const {
-  if (pImpl == 0) return false;
-
-  for (unsigned I = 0, E = pImpl->getNumAttributes(); I != E; ++I)
-    for (AttributeSetImpl::iterator II = pImpl->begin(I),
-           IE = pImpl->end(I); II != IE; ++II)
-      if (II->hasAttribute(Attr))
-        return true;
-
-  return false;
+  return pImpl && pImpl->hasAttrSomewhere(Attr);
 }
 
 Attribute AttributeSet::getAttribute(unsigned Index,
@@ -874,14 +868,7 @@ std::string AttributeSet::getAsString(unsigned Index,
 
 /// \brief The attributes for the specified index are returned.
 AttributeSetNode *AttributeSet::getAttributes(unsigned Index) const {
-  if (!pImpl) return 0;
-
-  // Loop through to find the attribute node we want.
-  for (unsigned I = 0, E = pImpl->getNumAttributes(); I != E; ++I)
-    if (pImpl->getSlotIndex(I) == Index)
-      return pImpl->getSlotNode(I);
-
-  return 0;
+  return pImpl ? pImpl->getIndexNode(Index) : 0;
 }
 
 AttributeSet::iterator AttributeSet::begin(unsigned Slot) const {
@@ -38,10 +38,17 @@ LLVMContext &BasicBlock::getContext() const {
 // are not in the public header file...
 template class llvm::SymbolTableListTraits<Instruction, BasicBlock>;
 
+void ilist_traits<Instruction>::noteListChange(BasicBlock *BB) {
+  if (BB)
+    if (Function *F = BB->getParent())
+      F->markModified();
+}
+
 
 BasicBlock::BasicBlock(LLVMContext &C, const Twine &Name, Function *NewParent,
                        BasicBlock *InsertBefore)
-  : Value(Type::getLabelTy(C), Value::BasicBlockVal), Parent(0) {
+  : Value(Type::getLabelTy(C), Value::BasicBlockVal), Parent(0),
+    Number(-1), MaintainedPreds(0) {
 
   // Make sure that we get added to a function
   LeakDetector::addGarbageObject(this);
@@ -80,6 +87,7 @@ BasicBlock::~BasicBlock() {
   assert(getParent() == 0 && "BasicBlock still linked into the program!");
   dropAllReferences();
   InstList.clear();
+  delete MaintainedPreds;
 }
 
 void BasicBlock::setParent(Function *parent) {
@@ -88,6 +96,7 @@ void BasicBlock::setParent(Function *parent) {
 
   // Set Parent=parent, updating instruction symtab entries as appropriate.
   InstList.setSymTabObject(&Parent, parent);
+  Number = parent ? parent->NextBlockNumber++ : -1;
 
   if (getParent())
     LeakDetector::removeGarbageObject(this);
@@ -181,6 +190,9 @@ void BasicBlock::dropAllReferences() {
 /// getSinglePredecessor - If this basic block has a single predecessor block,
 /// return the block, otherwise return a null pointer.
 BasicBlock *BasicBlock::getSinglePredecessor() {
+  if (MaintainedPreds)
+    return MaintainedPreds->size() == 1 ? MaintainedPreds->front() : 0;
+
   pred_iterator PI = pred_begin(this), E = pred_end(this);
   if (PI == E) return 0;         // No preds.
   BasicBlock *ThePred = *PI;
@@ -194,6 +206,16 @@ BasicBlock *BasicBlock::getSinglePredecessor() {
 /// multiple edges from the unique predecessor to this block (for example
 /// a switch statement with multiple cases having the same destination).
 BasicBlock *BasicBlock::getUniquePredecessor() {
+  if (MaintainedPreds) {
+    if (MaintainedPreds->empty())
+      return 0;
+    BasicBlock *PredBB = MaintainedPreds->front();
+    for (unsigned i = 1, e = MaintainedPreds->size(); i != e; ++i)
+      if ((*MaintainedPreds)[i] != PredBB)
+        return 0;
+    return PredBB;
+  }
+
   pred_iterator PI = pred_begin(this), E = pred_end(this);
   if (PI == E) return 0; // No preds.
   BasicBlock *PredBB = *PI;
@@ -207,6 +229,56 @@ BasicBlock *BasicBlock::getUniquePredecessor() {
   return PredBB;
 }
 
+void BasicBlock::setMaintainsPredecessors(bool Maintain) {
+  if (Maintain == maintainsPredecessors())
+    return;
+
+  if (!Maintain) {
+    delete MaintainedPreds;
+    MaintainedPreds = 0;
+    SubclassOptionalData = 0;
+    return;
+  }
+
+  // Terminators that are not in a block yet add their edges when they are
+  // inserted into one.
+  MaintainedPreds = new std::vector<BasicBlock*>();
+  for (pred_iterator PI = pred_begin(this), E = pred_end(this); PI != E; ++PI)
+    if (*PI)
+      MaintainedPreds->push_back(*PI);
+  SubclassOptionalData = 1;
+}
+
+void BasicBlock::removeMaintainedPredecessor(BasicBlock *Pred) {
+  std::vector<BasicBlock*>::iterator I =
+    std::find(MaintainedPreds->begin(), MaintainedPreds->end(), Pred);
+  assert(I != MaintainedPreds->end() && "Edge missing from predecessors!");
+  *I = MaintainedPreds->back();
+  MaintainedPreds->pop_back();
+}
+
+void BasicBlock::replaceMaintainedPredecessor(BasicBlock *Pred,
+                                              BasicBlock *NewPred) {
+  std::vector<BasicBlock*>::iterator I =
+    std::find(MaintainedPreds->begin(), MaintainedPreds->end(), Pred);
+  assert(I != MaintainedPreds->end() && "Edge missing from predecessors!");
+  *I = NewPred;
+}
+
+/// updateMaintainedPredecessors - Keep the predecessor list of a block up to
+/// date as the operands of the terminators in the function change.  Edges
+/// from terminators that are not in a block are not in the list.
+void Value::updateMaintainedPredecessors(Use &U, bool Added) {
+  TerminatorInst *TI = dyn_cast<TerminatorInst>(U.getUser());
+  if (!TI || !TI->getParent())
+    return;
+  BasicBlock *BB = cast<BasicBlock>(this);
+  if (Added)
+    BB->addMaintainedPredecessor(TI->getParent());
+  else
+    BB->removeMaintainedPredecessor(TI->getParent());
+}
+
 /// removePredecessor - This method is used to notify a BasicBlock that the
 /// specified Predecessor of the block is no longer able to reach it.  This is
 /// actually not used to update the Predecessor list, but is actually used to
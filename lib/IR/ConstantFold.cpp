@@ -869,6 +869,63 @@ Constant *llvm::ConstantFoldInsertValueInstruction(Constant *Agg,
   return ConstantVector::get(Result);
 }
 
+// Host float and double arithmetic is only used for folding when the compiler
+// rounds every operation to the precision of its type, which rules out x87
+// code.  The host is assumed to run in its default round-to-nearest mode.
+#if (defined(__FLT_EVAL_METHOD__) && __FLT_EVAL_METHOD__ == 0) || \
+    defined(_M_X64)
+#define LLVM_HOST_FP_FOLDING 1
+#else
+#define LLVM_HOST_FP_FOLDING 0
+#endif
+
+/// isHostFoldable - Return true if X is a zero, an infinity or a normal
+/// number.  Hosts may flush subnormals to zero, and do not propagate NaN
+/// payloads the way APFloat does.
+template<typename T>
+static bool isHostFoldable(T X) {
+  if (X != X)
+    return false;
+  if (X == 0 || X > std::numeric_limits<T>::max() ||
+      X < -std::numeric_limits<T>::max())
+    return true;
+  return X >= std::numeric_limits<T>::min() ||
+         X <= -std::numeric_limits<T>::min();
+}
+
+/// HostFoldFP - Fold the FAdd, FSub, FMul or FDiv of V1 and V2 with host
+/// arithmetic into Result.  Return false if the host may round differently
+/// from APFloat in round-to-nearest-even, in which case the caller must fold
+/// with APFloat instead.
+template<typename T>
+static bool HostFoldFP(unsigned Opcode, T V1, T V2, T &Result) {
+  if (!LLVM_HOST_FP_FOLDING || !isHostFoldable(V1) || !isHostFoldable(V2))
+    return false;
+
+  switch (Opcode) {
+  default: return false;
+  case Instruction::FAdd: Result = V1 + V2; break;
+  case Instruction::FSub: Result = V1 - V2; break;
+  case Instruction::FMul: Result = V1 * V2; break;
+  case Instruction::FDiv: Result = V1 / V2; break;
+  }
+
+  if (Result != 0)
+    return isHostFoldable(Result);
+
+  // A zero may be an underflow that the host flushed, so it is only trusted
+  // when the exact result is zero.
+  switch (Opcode) {
+  default:                return false;
+  case Instruction::FAdd: return V1 == -V2;
+  case Instruction::FSub: return V1 == V2;
+  case Instruction::FMul: return V1 == 0 || V2 == 0;
+  case Instruction::FDiv:
+    return V1 == 0 || V2 > std::numeric_limits<T>::max() ||
+           V2 < -std::numeric_limits<T>::max();
+  }
+}
+
 
 Constant *llvm::ConstantFoldBinaryInstruction(unsigned Opcode,
                                               Constant *C1, Constant *C2) {
@@ -1114,6 +1171,21 @@ Constant *llvm::ConstantFoldBinaryInstruction(unsigned Opcode,
     if (ConstantFP *CFP2 = dyn_cast<ConstantFP>(C2)) {
       APFloat C1V = CFP1->getValueAPF();
       APFloat C2V = CFP2->getValueAPF();
+
+      // Most float and double arithmetic can be done by the host, which is
+      // much faster than APFloat.
+      const fltSemantics &Sem = C1V.getSemantics();
+      if (&Sem == &APFloat::IEEEdouble) {
+        double R;
+        if (HostFoldFP(Opcode, C1V.convertToDouble(), C2V.convertToDouble(),
+                       R))
+          return ConstantFP::get(C1->getContext(), APFloat(R));
+      } else if (&Sem == &APFloat::IEEEsingle) {
+        float R;
+        if (HostFoldFP(Opcode, C1V.convertToFloat(), C2V.convertToFloat(), R))
+          return ConstantFP::get(C1->getContext(), APFloat(R));
+      }
+
       APFloat C3V = C1V;  // copy for modification
       switch (Opcode) {
       default:                   
@@ -484,7 +484,11 @@ ConstantInt *ConstantInt::get(LLVMContext &Context, const APInt &V) {
   IntegerType *ITy = IntegerType::get(Context, V.getBitWidth());
   // get an existing value or the insertion position
   LLVMContextImpl *pImpl = Context.pImpl;
-  ConstantInt *&Slot = pImpl->IntConstants[DenseMapAPIntKeyInfo::KeyTy(V, ITy)];
+  DenseMapAPIntKeyInfo::KeyTy Key(V, ITy);
+  unsigned Shard = DenseMapAPIntKeyInfo::getHashValue(Key) %
+                   LLVMContextImpl::NumConstantShards;
+  sys::SmartScopedLock<true> Lock(pImpl->IntConstantsLock[Shard]);
+  ConstantInt *&Slot = pImpl->IntConstants[Shard][Key];
   if (!Slot) Slot = new ConstantInt(ITy, V);
   return Slot;
 }
@@ -610,7 +614,11 @@ Constant *ConstantFP::getZeroValueForNegation(Type *Ty) {
 ConstantFP* ConstantFP::get(LLVMContext &Context, const APFloat& V) {
   LLVMContextImpl* pImpl = Context.pImpl;
 
-  ConstantFP *&Slot = pImpl->FPConstants[DenseMapAPFloatKeyInfo::KeyTy(V)];
+  DenseMapAPFloatKeyInfo::KeyTy Key(V);
+  unsigned Shard = DenseMapAPFloatKeyInfo::getHashValue(Key) %
+                   LLVMContextImpl::NumConstantShards;
+  sys::SmartScopedLock<true> Lock(pImpl->FPConstantsLock[Shard]);
+  ConstantFP *&Slot = pImpl->FPConstants[Shard][Key];
 
   if (!Slot) {
     Type *Ty;
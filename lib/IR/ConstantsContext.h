@@ -23,7 +23,6 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
-#include <map>
 
 namespace llvm {
 template<class ValType>
@@ -333,20 +332,25 @@ struct ExprMapKeyType {
            this->operands == that.operands &&
            this->indices == that.indices;
   }
-  bool operator<(const ExprMapKeyType & that) const {
-    if (this->opcode != that.opcode) return this->opcode < that.opcode;
-    if (this->operands != that.operands) return this->operands < that.operands;
-    if (this->subclassdata != that.subclassdata)
-      return this->subclassdata < that.subclassdata;
-    if (this->subclassoptionaldata != that.subclassoptionaldata)
-      return this->subclassoptionaldata < that.subclassoptionaldata;
-    if (this->indices != that.indices) return this->indices < that.indices;
-    return false;
-  }
 
   bool operator!=(const ExprMapKeyType& that) const {
     return !(*this == that);
   }
+
+  /// getHash - Hash the parts of a constant expression.  Both the keys and
+  /// the ConstantExprs in the uniquing map are hashed with this.
+  static unsigned getHash(unsigned Opcode, unsigned OptionalFlags,
+                          unsigned Flags, ArrayRef<Constant*> Ops,
+                          ArrayRef<unsigned> Inds) {
+    return hash_combine(Opcode, OptionalFlags, Flags,
+                        hash_combine_range(Ops.begin(), Ops.end()),
+                        hash_combine_range(Inds.begin(), Inds.end()));
+  }
+
+  unsigned getHash() const {
+    return getHash(opcode, subclassoptionaldata, subclassdata, operands,
+                   indices);
+  }
 };
 
 struct InlineAsmKeyType {
@@ -368,23 +372,24 @@ struct InlineAsmKeyType {
            this->is_align_stack == that.is_align_stack &&
            this->asm_dialect == that.asm_dialect;
   }
-  bool operator<(const InlineAsmKeyType& that) const {
-    if (this->asm_string != that.asm_string)
-      return this->asm_string < that.asm_string;
-    if (this->constraints != that.constraints)
-      return this->constraints < that.constraints;
-    if (this->has_side_effects != that.has_side_effects)
-      return this->has_side_effects < that.has_side_effects;
-    if (this->is_align_stack != that.is_align_stack)
-      return this->is_align_stack < that.is_align_stack;
-    if (this->asm_dialect != that.asm_dialect)
-      return this->asm_dialect < that.asm_dialect;
-    return false;
-  }
 
   bool operator!=(const InlineAsmKeyType& that) const {
     return !(*this == that);
   }
+
+  /// getHash - Hash the parts of an inline asm.  Both the keys and the
+  /// InlineAsms in the uniquing map are hashed with this.
+  static unsigned getHash(StringRef AsmString, StringRef Constraints,
+                          bool HasSideEffects, bool IsAlignStack,
+                          unsigned AsmDialect) {
+    return hash_combine(AsmString, Constraints, HasSideEffects, IsAlignStack,
+                        AsmDialect);
+  }
+
+  unsigned getHash() const {
+    return getHash(asm_string, constraints, has_side_effects, is_align_stack,
+                   asm_dialect);
+  }
 };
 
 // The number of operands for each ConstantCreator::create method is
@@ -422,6 +427,9 @@ struct ConstantArrayCreator {
   }
 };
 
+// ConstantKeyData - Describes the constants of a ConstantUniqueMap: how to
+// get back their key, hash them and compare them to a key, which has to
+// agree with hashing and comparing the key itself.
 template<class ConstantClass>
 struct ConstantKeyData {
   typedef void ValType;
@@ -489,6 +497,33 @@ struct ConstantKeyData<ConstantExpr> {
         CE->hasIndices() ?
           CE->getIndices() : ArrayRef<unsigned>());
   }
+
+  static unsigned getHash(ConstantExpr *CE) {
+    SmallVector<Constant*, 8> Operands;
+    for (unsigned i = 0, e = CE->getNumOperands(); i != e; ++i)
+      Operands.push_back(CE->getOperand(i));
+    return ExprMapKeyType::getHash(CE->getOpcode(),
+                                   CE->getRawSubclassOptionalData(),
+                                   CE->isCompare() ? CE->getPredicate() : 0,
+                                   Operands,
+                                   CE->hasIndices() ?
+                                     CE->getIndices() : ArrayRef<unsigned>());
+  }
+
+  static bool isEqual(const ValType &Key, ConstantExpr *CE) {
+    if (Key.opcode != CE->getOpcode() ||
+        Key.subclassoptionaldata != CE->getRawSubclassOptionalData() ||
+        Key.subclassdata != (CE->isCompare() ? CE->getPredicate() : 0) ||
+        Key.operands.size() != CE->getNumOperands())
+      return false;
+    for (unsigned i = 0, e = CE->getNumOperands(); i != e; ++i)
+      if (Key.operands[i] != CE->getOperand(i))
+        return false;
+    ArrayRef<unsigned> Indices =
+      CE->hasIndices() ? CE->getIndices() : ArrayRef<unsigned>();
+    return Key.indices.size() == Indices.size() &&
+           std::equal(Indices.begin(), Indices.end(), Key.indices.begin());
+  }
 };
 
 template<>
@@ -508,26 +543,81 @@ struct ConstantKeyData<InlineAsm> {
                             Asm->hasSideEffects(), Asm->isAlignStack(),
                             Asm->getDialect());
   }
+
+  static unsigned getHash(InlineAsm *Asm) {
+    return InlineAsmKeyType::getHash(Asm->getAsmString(),
+                                     Asm->getConstraintString(),
+                                     Asm->hasSideEffects(),
+                                     Asm->isAlignStack(), Asm->getDialect());
+  }
+
+  static bool isEqual(const ValType &Key, InlineAsm *Asm) {
+    return Key.asm_string == Asm->getAsmString() &&
+           Key.constraints == Asm->getConstraintString() &&
+           Key.has_side_effects == Asm->hasSideEffects() &&
+           Key.is_align_stack == Asm->isAlignStack() &&
+           Key.asm_dialect == Asm->getDialect();
+  }
 };
 
-template<class ValType, class ValRefType, class TypeClass, class ConstantClass,
-         bool HasLargeKey = false /*true for arrays and structs*/ >
+// Unique map for constant expressions and inline asms.  The constants are
+// kept in a hash table along with their hashes, which are computed once from
+// the key that creates them.  A lookup compares the hashes first and the
+// constants' parts next, without building a key for the constants in the
+// table.
+template<class ValType, class ValRefType, class TypeClass, class ConstantClass>
 class ConstantUniqueMap {
 public:
-  typedef std::pair<TypeClass*, ValType> MapKey;
-  typedef std::map<MapKey, ConstantClass *> MapTy;
-  typedef std::map<ConstantClass *, typename MapTy::iterator> InverseMapTy;
+  struct LookupKey {
+    TypeClass *Ty;
+    ValRefType Val;
+    unsigned Hash;
+
+    LookupKey(TypeClass *Ty, ValRefType Val)
+      : Ty(Ty), Val(Val), Hash(hash_combine(Ty, Val.getHash())) {}
+  };
+
+  struct Entry {
+    ConstantClass *C;
+    unsigned Hash;
+  };
+
+private:
+  struct MapInfo {
+    typedef DenseMapInfo<ConstantClass*> ConstantClassInfo;
+    static inline Entry getEmptyKey() {
+      Entry E = { ConstantClassInfo::getEmptyKey(), 0 };
+      return E;
+    }
+    static inline Entry getTombstoneKey() {
+      Entry E = { ConstantClassInfo::getTombstoneKey(), 0 };
+      return E;
+    }
+    static unsigned getHashValue(const Entry &E) {
+      return E.Hash;
+    }
+    static bool isEqual(const Entry &LHS, const Entry &RHS) {
+      return LHS.C == RHS.C;
+    }
+    static unsigned getHashValue(const LookupKey &Val) {
+      return Val.Hash;
+    }
+    static bool isEqual(const LookupKey &LHS, const Entry &RHS) {
+      if (RHS.C == ConstantClassInfo::getEmptyKey() ||
+          RHS.C == ConstantClassInfo::getTombstoneKey())
+        return false;
+      return LHS.Hash == RHS.Hash && LHS.Ty == RHS.C->getType() &&
+             ConstantKeyData<ConstantClass>::isEqual(LHS.Val, RHS.C);
+    }
+  };
+public:
+  typedef DenseMap<Entry, char, MapInfo> MapTy;
+
 private:
   /// Map - This is the main map from the element descriptor to the Constants.
   /// This is the primary way we avoid creating two of the same shape
   /// constant.
   MapTy Map;
-    
-  /// InverseMap - If "HasLargeKey" is true, this contains an inverse mapping
-  /// from the constants to their element in Map.  This is important for
-  /// removal of constants from the array, which would otherwise have to scan
-  /// through the map with very large keys.
-  InverseMapTy InverseMap;
 
 public:
   typename MapTy::iterator map_begin() { return Map.begin(); }
@@ -537,110 +627,40 @@ public:
     for (typename MapTy::iterator I=Map.begin(), E=Map.end();
          I != E; ++I) {
       // Asserts that use_empty().
-      delete I->second;
+      delete I->first.C;
     }
   }
-    
-  /// InsertOrGetItem - Return an iterator for the specified element.
-  /// If the element exists in the map, the returned iterator points to the
-  /// entry and Exists=true.  If not, the iterator points to the newly
-  /// inserted entry and returns Exists=false.  Newly inserted entries have
-  /// I->second == 0, and should be filled in.
-  typename MapTy::iterator InsertOrGetItem(std::pair<MapKey, ConstantClass *>
-                                 &InsertVal,
-                                 bool &Exists) {
-    std::pair<typename MapTy::iterator, bool> IP = Map.insert(InsertVal);
-    Exists = !IP.second;
-    return IP.first;
-  }
-    
-private:
-  typename MapTy::iterator FindExistingElement(ConstantClass *CP) {
-    if (HasLargeKey) {
-      typename InverseMapTy::iterator IMI = InverseMap.find(CP);
-      assert(IMI != InverseMap.end() && IMI->second != Map.end() &&
-             IMI->second->second == CP &&
-             "InverseMap corrupt!");
-      return IMI->second;
-    }
-      
-    typename MapTy::iterator I =
-      Map.find(MapKey(static_cast<TypeClass*>(CP->getType()),
-                      ConstantKeyData<ConstantClass>::getValType(CP)));
-    if (I == Map.end() || I->second != CP) {
-      // FIXME: This should not use a linear scan.  If this gets to be a
-      // performance problem, someone should look at this.
-      for (I = Map.begin(); I != Map.end() && I->second != CP; ++I)
-        /* empty */;
-    }
-    return I;
-  }
 
-  ConstantClass *Create(TypeClass *Ty, ValRefType V,
-                        typename MapTy::iterator I) {
-    ConstantClass* Result =
-      ConstantCreator<ConstantClass,TypeClass,ValType>::create(Ty, V);
-
-    assert(Result->getType() == Ty && "Type specified is not correct!");
-    I = Map.insert(I, std::make_pair(MapKey(Ty, V), Result));
-
-    if (HasLargeKey)  // Remember the reverse mapping if needed.
-      InverseMap.insert(std::make_pair(Result, I));
-
-    return Result;
-  }
-public:
-    
   /// getOrCreate - Return the specified constant from the map, creating it if
   /// necessary.
   ConstantClass *getOrCreate(TypeClass *Ty, ValRefType V) {
-    MapKey Lookup(Ty, V);
-    ConstantClass* Result = 0;
-    
-    typename MapTy::iterator I = Map.find(Lookup);
-    // Is it in the map?  
+    LookupKey Lookup(Ty, V);
+    typename MapTy::iterator I = Map.find_as(Lookup);
+    // Is it in the map?
     if (I != Map.end())
-      Result = I->second;
-        
-    if (!Result) {
-      // If no preexisting value, create one now...
-      Result = Create(Ty, V, I);
-    }
-        
+      return I->first.C;
+
+    // If no preexisting value, create one now...
+    ConstantClass *Result =
+      ConstantCreator<ConstantClass,TypeClass,ValType>::create(Ty, V);
+    assert(Result->getType() == Ty && "Type specified is not correct!");
+    Entry E = { Result, Lookup.Hash };
+    Map[E] = '\0';
     return Result;
   }
 
+  /// Remove this constant from the map.  Its hash is recomputed from its
+  /// parts, which have not changed since it was created.
   void remove(ConstantClass *CP) {
-    typename MapTy::iterator I = FindExistingElement(CP);
+    Entry E = {
+      CP, hash_combine(static_cast<TypeClass*>(CP->getType()),
+                       ConstantKeyData<ConstantClass>::getHash(CP))
+    };
+    typename MapTy::iterator I = Map.find(E);
     assert(I != Map.end() && "Constant not found in constant table!");
-    assert(I->second == CP && "Didn't find correct element?");
-
-    if (HasLargeKey)  // Remember the reverse mapping if needed.
-      InverseMap.erase(CP);
-
     Map.erase(I);
   }
 
-  /// MoveConstantToNewSlot - If we are about to change C to be the element
-  /// specified by I, update our internal data structures to reflect this
-  /// fact.
-  void MoveConstantToNewSlot(ConstantClass *C, typename MapTy::iterator I) {
-    // First, remove the old location of the specified constant in the map.
-    typename MapTy::iterator OldI = FindExistingElement(C);
-    assert(OldI != Map.end() && "Constant not found in constant table!");
-    assert(OldI->second == C && "Didn't find correct element?");
-      
-     // Remove the old entry from the map.
-    Map.erase(OldI);
-    
-    // Update the inverse map so that we know that this constant is now
-    // located at descriptor I.
-    if (HasLargeKey) {
-      assert(I->second == C && "Bad inversemap entry!");
-      InverseMap[C] = I;
-    }
-  }
-
   void dump() const {
     DEBUG(dbgs() << "Constant.cpp: ConstantUniqueMap\n");
   }
@@ -89,6 +89,16 @@ void DominatorTree::verifyAnalysis() const {
   }
 }
 
+void DominatorTree::insertEdge(BasicBlock *From, BasicBlock *To) {
+  DT->insertEdge(From, To);
+  verifyAnalysis();
+}
+
+void DominatorTree::deleteEdge(BasicBlock *From, BasicBlock *To) {
+  DT->deleteEdge(From, To);
+  verifyAnalysis();
+}
+
 void DominatorTree::print(raw_ostream &OS, const Module *) const {
   DT->print(OS);
 }
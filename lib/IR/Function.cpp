@@ -195,7 +195,8 @@ void Function::eraseFromParent() {
 Function::Function(FunctionType *Ty, LinkageTypes Linkage,
                    const Twine &name, Module *ParentModule)
   : GlobalValue(PointerType::getUnqual(Ty),
-                Value::FunctionVal, 0, 0, Linkage, name) {
+                Value::FunctionVal, 0, 0, Linkage, name),
+    ModificationCount(1), VerifiedModificationCount(0), NextBlockNumber(0) {
   assert(FunctionType::isValidReturnType(getReturnType()) &&
          "invalid return type");
   SymTab = new ValueSymbolTable();
@@ -299,6 +300,17 @@ void Function::removeAttributes(unsigned i, AttributeSet attrs) {
   setAttributes(PAL);
 }
 
+void Function::setEntryCount(uint64_t Count) {
+  addFnAttr("function-entry-count", utostr(Count));
+}
+
+bool Function::getEntryCount(uint64_t &Count) const {
+  Attribute A = getFnAttribute("function-entry-count");
+  if (!A.isStringAttribute())
+    return false;
+  return !A.getValueAsString().getAsInteger(10, Count);
+}
+
 // Maintain the GC name for each function in an on-the-side table. This saves
 // allocating an additional word in Function for programs which do not use GC
 // (i.e., most programs) at the cost of increased overhead for clients which do
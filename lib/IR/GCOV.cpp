@@ -19,6 +19,7 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryObject.h"
 #include "llvm/Support/system_error.h"
+#include <algorithm>
 using namespace llvm;
 
 //===----------------------------------------------------------------------===//
@@ -281,16 +282,39 @@ void GCOVBlock::dump() const {
 //===----------------------------------------------------------------------===//
 // FileInfo implementation.
 
+/// merge - Add the line counts of Other to this one.
+void FileInfo::merge(const FileInfo &Other) {
+  for (StringMap<LineCounts>::const_iterator I = Other.LineInfo.begin(),
+         E = Other.LineInfo.end(); I != E; ++I) {
+    LineCounts &L = LineInfo[I->first()];
+    for (LineCounts::const_iterator LI = I->second.begin(),
+           LE = I->second.end(); LI != LE; ++LI)
+      L[LI->first] += LI->second;
+  }
+  RunCount = std::max(RunCount, Other.RunCount);
+  ProgramCount = std::max(ProgramCount, Other.ProgramCount);
+}
+
+/// getSortedFilenames - Get the names of the source files in sorted order,
+/// so that reports do not depend on the order the counts were collected in.
+void FileInfo::getSortedFilenames(SmallVectorImpl<StringRef> &Filenames) const {
+  for (StringMap<LineCounts>::const_iterator I = LineInfo.begin(),
+         E = LineInfo.end(); I != E; ++I)
+    Filenames.push_back(I->first());
+  std::sort(Filenames.begin(), Filenames.end());
+}
+
 /// print -  Print source files with collected line count information.
 void FileInfo::print(raw_fd_ostream &OS, StringRef gcnoFile,
                      StringRef gcdaFile) const {
-  for (StringMap<LineCounts>::const_iterator I = LineInfo.begin(),
-         E = LineInfo.end(); I != E; ++I) {
-    StringRef Filename = I->first();
+  SmallVector<StringRef, 16> Filenames;
+  getSortedFilenames(Filenames);
+  for (unsigned FI = 0, FE = Filenames.size(); FI != FE; ++FI) {
+    StringRef Filename = Filenames[FI];
     OwningPtr<MemoryBuffer> Buff;
     if (error_code ec = MemoryBuffer::getFileOrSTDIN(Filename, Buff)) {
       errs() << Filename << ": " << ec.message() << "\n";
-      return;
+      continue;
     }
     StringRef AllLines = Buff->getBuffer();
 
@@ -300,7 +324,7 @@ void FileInfo::print(raw_fd_ostream &OS, StringRef gcnoFile,
     OS << "        -:    0:Runs:" << RunCount << "\n";
     OS << "        -:    0:Programs:" << ProgramCount << "\n";
 
-    const LineCounts &L = I->second;
+    const LineCounts &L = LineInfo.find(Filename)->second;
     uint32_t i = 0;
     while (!AllLines.empty()) {
       LineCounts::const_iterator CountIt = L.find(i);
@@ -321,3 +345,29 @@ void FileInfo::print(raw_fd_ostream &OS, StringRef gcnoFile,
     }
   }
 }
+
+/// printSummary - Print the line counts of every source file in the lcov
+/// tracefile format.
+void FileInfo::printSummary(raw_ostream &OS) const {
+  SmallVector<StringRef, 16> Filenames;
+  getSortedFilenames(Filenames);
+  for (unsigned FI = 0, FE = Filenames.size(); FI != FE; ++FI) {
+    const LineCounts &L = LineInfo.find(Filenames[FI])->second;
+    SmallVector<uint32_t, 64> Lines;
+    for (LineCounts::const_iterator I = L.begin(), E = L.end(); I != E; ++I)
+      Lines.push_back(I->first);
+    std::sort(Lines.begin(), Lines.end());
+
+    unsigned LinesHit = 0;
+    OS << "SF:" << Filenames[FI] << "\n";
+    for (unsigned i = 0, e = Lines.size(); i != e; ++i) {
+      uint64_t Count = L.find(Lines[i])->second;
+      if (Count)
+        ++LinesHit;
+      OS << "DA:" << Lines[i] + 1 << "," << Count << "\n";
+    }
+    OS << "LF:" << Lines.size() << "\n";
+    OS << "LH:" << LinesHit << "\n";
+    OS << "end_of_record\n";
+  }
+}
@@ -0,0 +1,99 @@
+//===-- IRArena.cpp - Arena for instructions ------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements IRArena.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/IRArena.h"
+#include "llvm/Support/Atomic.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/ThreadLocal.h"
+using namespace llvm;
+
+static ManagedStatic<sys::ThreadLocal<const IRArena> > CurrentArena;
+
+/// The number of scopes active on any thread.  While there are none, which
+/// is the common case, instructions are allocated without looking up the
+/// current arena.
+static volatile sys::cas_flag NumScopes = 0;
+
+IRArena::IRArena()
+  : CurPtr(0), End(0), FreeLists(MaxAllocationSize / sizeof(void *) + 2) {}
+
+IRArena::~IRArena() {
+  for (std::map<const char *, const char *>::iterator I = Slabs.begin(),
+                                                      E = Slabs.end();
+       I != E; ++I)
+    ::operator delete(const_cast<char *>(I->first));
+}
+
+IRArena::Scope::Scope(IRArena &Arena)
+  : Prev(const_cast<IRArena *>(CurrentArena->get())) {
+  sys::AtomicIncrement(&NumScopes);
+  CurrentArena->set(&Arena);
+}
+
+IRArena::Scope::~Scope() {
+  CurrentArena->set(Prev);
+  sys::AtomicDecrement(&NumScopes);
+}
+
+IRArena *IRArena::getCurrent() {
+  if (NumScopes == 0)
+    return 0;
+  return const_cast<IRArena *>(CurrentArena->get());
+}
+
+void *IRArena::allocate(size_t Size) {
+  if (Size > MaxAllocationSize)
+    return 0;
+
+  // Each block starts with a word holding its size in words, so that it can
+  // be put back on the right free list.
+  size_t Words = (Size + sizeof(void *) - 1) / sizeof(void *) + 1;
+  void **Block = static_cast<void **>(FreeLists[Words]);
+  if (Block) {
+    FreeLists[Words] = Block[1];
+  } else {
+    size_t Bytes = Words * sizeof(void *);
+    if (size_t(End - CurPtr) < Bytes) {
+      CurPtr = static_cast<char *>(::operator new(SlabSize));
+      End = CurPtr + SlabSize;
+      Slabs[CurPtr] = End;
+    }
+    Block = reinterpret_cast<void **>(CurPtr);
+    CurPtr += Bytes;
+  }
+  *reinterpret_cast<size_t *>(Block) = Words;
+  return Block + 1;
+}
+
+void IRArena::deallocate(void *Ptr) {
+  void **Block = static_cast<void **>(Ptr) - 1;
+  size_t Words = *reinterpret_cast<size_t *>(Block);
+  Block[1] = FreeLists[Words];
+  FreeLists[Words] = Block;
+}
+
+bool IRArena::contains(const void *Ptr) const {
+  const char *P = static_cast<const char *>(Ptr);
+  std::map<const char *, const char *>::const_iterator I =
+    Slabs.upper_bound(P);
+  if (I == Slabs.begin())
+    return false;
+  --I;
+  return P < I->second;
+}
+
+void IRArena::release(void *Ptr) {
+  IRArena *Arena = getCurrent();
+  if (Arena && Arena->contains(Ptr))
+    Arena->deallocate(Ptr);
+}
@@ -13,6 +13,7 @@
 
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
@@ -24,6 +25,9 @@ using namespace llvm;
 Instruction::Instruction(Type *ty, unsigned it, Use *Ops, unsigned NumOps,
                          Instruction *InsertBefore)
   : User(ty, Value::InstructionVal + it, Ops, NumOps), Parent(0) {
+  if (IRArena *Arena = IRArena::getCurrent())
+    FromArena = Arena->contains(this);
+
   // Make sure that we get added to a basicblock
   LeakDetector::addGarbageObject(this);
 
@@ -38,6 +42,9 @@ Instruction::Instruction(Type *ty, unsigned it, Use *Ops, unsigned NumOps,
 Instruction::Instruction(Type *ty, unsigned it, Use *Ops, unsigned NumOps,
                          BasicBlock *InsertAtEnd)
   : User(ty, Value::InstructionVal + it, Ops, NumOps), Parent(0) {
+  if (IRArena *Arena = IRArena::getCurrent())
+    FromArena = Arena->contains(this);
+
   // Make sure that we get added to a basicblock
   LeakDetector::addGarbageObject(this);
 
@@ -47,6 +54,13 @@ Instruction::Instruction(Type *ty, unsigned it, Use *Ops, unsigned NumOps,
 }
 
 
+void *Instruction::operator new(size_t s, unsigned Us) {
+  if (IRArena *Arena = IRArena::getCurrent())
+    if (void *Storage = Arena->allocate(s + sizeof(Use) * Us))
+      return placeUser(Storage, Us);
+  return User::operator new(s, Us);
+}
+
 // Out of line virtual method, so the vtable, etc has a home.
 Instruction::~Instruction() {
   assert(Parent == 0 && "Instruction still linked in the program!");
@@ -62,6 +76,21 @@ void Instruction::setParent(BasicBlock *P) {
     if (P) LeakDetector::removeGarbageObject(this);
   }
 
+  // The edges of a terminator move with it.  Update the successors that keep
+  // their predecessor lists.
+  if (isa<TerminatorInst>(this) && P != Parent)
+    for (op_iterator OI = op_begin(), OE = op_end(); OI != OE; ++OI) {
+      BasicBlock *Succ = dyn_cast_or_null<BasicBlock>(OI->get());
+      if (!Succ || !Succ->maintainsPredecessors())
+        continue;
+      if (!Parent)
+        Succ->addMaintainedPredecessor(P);
+      else if (!P)
+        Succ->removeMaintainedPredecessor(Parent);
+      else
+        Succ->replaceMaintainedPredecessor(Parent, P);
+    }
+
   Parent = P;
 }
 
@@ -37,16 +37,17 @@ LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
     Int64Ty(C, 64) {
   InlineAsmDiagHandler = 0;
   InlineAsmDiagContext = 0;
+  DiscardValueNames = false;
   NamedStructTypesUniqueID = 0;
 }
 
 namespace {
 struct DropReferences {
-  // Takes the value_type of a ConstantUniqueMap's internal map, whose 'second'
-  // is a Constant*.
+  // Takes the value_type of a ConstantUniqueMap's internal map, whose 'first'
+  // is an entry holding a Constant*.
   template<typename PairT>
   void operator()(const PairT &P) {
-    P.second->dropAllReferences();
+    P.first.C->dropAllReferences();
   }
 };
 
@@ -87,8 +88,10 @@ LLVMContextImpl::~LLVMContextImpl() {
   DeleteContainerSeconds(CPNConstants);
   DeleteContainerSeconds(UVConstants);
   InlineAsms.freeConstants();
-  DeleteContainerSeconds(IntConstants);
-  DeleteContainerSeconds(FPConstants);
+  for (unsigned i = 0; i != NumConstantShards; ++i) {
+    DeleteContainerSeconds(IntConstants[i]);
+    DeleteContainerSeconds(FPConstants[i]);
+  }
   
   for (StringMap<ConstantDataSequential*>::iterator I = CDSConstants.begin(),
        E = CDSConstants.end(); I != E; ++I)
@@ -120,9 +123,9 @@ LLVMContextImpl::~LLVMContextImpl() {
   // and the NonUniquedMDNodes sets, so copy the values out first.
   SmallVector<MDNode*, 8> MDNodes;
   MDNodes.reserve(MDNodeSet.size() + NonUniquedMDNodes.size());
-  for (FoldingSetIterator<MDNode> I = MDNodeSet.begin(), E = MDNodeSet.end();
+  for (MDNodeSetTy::iterator I = MDNodeSet.begin(), E = MDNodeSet.end();
        I != E; ++I)
-    MDNodes.push_back(&*I);
+    MDNodes.push_back(I->first);
   MDNodes.append(NonUniquedMDNodes.begin(), NonUniquedMDNodes.end());
   for (SmallVectorImpl<MDNode *>::iterator I = MDNodes.begin(),
          E = MDNodes.end(); I != E; ++I)
@@ -30,6 +30,7 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/ValueHandle.h"
 #include <vector>
 
@@ -187,23 +188,42 @@ struct FunctionTypeKeyInfo {
   }
 };
 
-// Provide a FoldingSetTrait::Equals specialization for MDNode that can use a
-// shortcut to avoid comparing all operands.
-template<> struct FoldingSetTrait<MDNode> : DefaultFoldingSetTrait<MDNode> {
-  static bool Equals(const MDNode &X, const FoldingSetNodeID &ID,
-                     unsigned IDHash, FoldingSetNodeID &TempID) {
-    assert(!X.isNotUniqued() && "Non-uniqued MDNode in FoldingSet?");
-    // First, check if the cached hashes match.  If they don't we can skip the
-    // expensive operand walk.
-    if (X.Hash != IDHash)
+/// MDNodeInfo - DenseMapInfo for the uniqued MDNodes.  A node caches the hash
+/// of its operands, so it can be removed from the map while its operands are
+/// being changed, and lookups only compare the operands of nodes whose hash
+/// matches.
+struct MDNodeInfo {
+  struct KeyTy {
+    ArrayRef<Value*> Ops;
+    unsigned Hash;
+    KeyTy(ArrayRef<Value*> Ops)
+      : Ops(Ops), Hash(hash_combine_range(Ops.begin(), Ops.end())) {}
+  };
+  static inline MDNode* getEmptyKey() {
+    return DenseMapInfo<MDNode*>::getEmptyKey();
+  }
+  static inline MDNode* getTombstoneKey() {
+    return DenseMapInfo<MDNode*>::getTombstoneKey();
+  }
+  static unsigned getHashValue(const KeyTy &Key) {
+    return Key.Hash;
+  }
+  static unsigned getHashValue(const MDNode *N) {
+    return N->Hash;
+  }
+  static bool isEqual(const KeyTy &LHS, const MDNode *RHS) {
+    if (RHS == getEmptyKey() || RHS == getTombstoneKey())
       return false;
-
-    // If they match we have to compare the operands.
-    X.Profile(TempID);
-    return TempID == ID;
+    assert(!RHS->isNotUniqued() && "Non-uniqued MDNode in MDNodeSet?");
+    if (LHS.Hash != RHS->Hash || LHS.Ops.size() != RHS->getNumOperands())
+      return false;
+    for (unsigned i = 0, e = LHS.Ops.size(); i != e; ++i)
+      if (LHS.Ops[i] != RHS->getOperand(i))
+        return false;
+    return true;
   }
-  static unsigned ComputeHash(const MDNode &X, FoldingSetNodeID &) {
-    return X.Hash; // Return cached hash.
+  static bool isEqual(const MDNode *LHS, const MDNode *RHS) {
+    return LHS == RHS;
   }
 };
 
@@ -238,14 +258,25 @@ public:
   
   LLVMContext::InlineAsmDiagHandlerTy InlineAsmDiagHandler;
   void *InlineAsmDiagContext;
+
+  /// DiscardValueNames - Whether only global values may be named.
+  bool DiscardValueNames;
   
+  /// The ConstantInt and ConstantFP uniquing tables are split into
+  /// NumConstantShards shards, selected by the hash of the key, each with its
+  /// own lock.  Threads creating scalar constants in the same context only
+  /// contend when they hit the same shard.
+  enum { NumConstantShards = 16 };
+
   typedef DenseMap<DenseMapAPIntKeyInfo::KeyTy, ConstantInt*, 
                          DenseMapAPIntKeyInfo> IntMapTy;
-  IntMapTy IntConstants;
+  IntMapTy IntConstants[NumConstantShards];
+  sys::SmartMutex<true> IntConstantsLock[NumConstantShards];
   
   typedef DenseMap<DenseMapAPFloatKeyInfo::KeyTy, ConstantFP*, 
                          DenseMapAPFloatKeyInfo> FPMapTy;
-  FPMapTy FPConstants;
+  FPMapTy FPConstants[NumConstantShards];
+  sys::SmartMutex<true> FPConstantsLock[NumConstantShards];
 
   FoldingSet<AttributeImpl> AttrsSet;
   FoldingSet<AttributeSetImpl> AttrsLists;
@@ -253,7 +284,8 @@ public:
 
   StringMap<Value*> MDStringCache;
 
-  FoldingSet<MDNode> MDNodeSet;
+  typedef DenseMap<MDNode*, char, MDNodeInfo> MDNodeSetTy;
+  MDNodeSetTy MDNodeSet;
 
   // MDNodes may be uniqued or not uniqued.  When they're not uniqued, they
   // aren't in the MDNodeSet, but they're still shared between objects, so no
@@ -300,6 +332,11 @@ public:
   /// TypeAllocator - All dynamically allocated types are allocated from this.
   /// They live forever until the context is torn down.
   BumpPtrAllocator TypeAllocator;
+
+  /// TypeLock - Guards TypeAllocator and the derived type tables below when
+  /// LLVM is running multithreaded.  Types have no use lists, so once created
+  /// they can be read from any thread without locking.
+  sys::SmartMutex<true> TypeLock;
   
   DenseMap<unsigned, IntegerType*> IntegerTypes;
   
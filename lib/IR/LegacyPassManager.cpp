@@ -17,12 +17,15 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/LegacyPassManagers.h"
+#include "llvm/IR/PassInstrumentation.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/Mutex.h"
 #include "llvm/Support/PassNameParser.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -82,6 +85,11 @@ PrintAfterAll("print-after-all",
               llvm::cl::desc("Print IR after each pass"),
               cl::init(false));
 
+static cl::opt<unsigned>
+FunctionPassThreads("function-pass-threads", cl::Hidden, cl::init(0),
+  cl::desc("Run function pass pipelines made up of function-local passes "
+           "on this many threads"));
+
 /// This is a helper to determine whether to print IR before or
 /// after a pass.
 
@@ -457,12 +465,18 @@ namespace {
 
 static ManagedStatic<sys::SmartMutex<true> > TimingInfoMutex;
 
+static cl::opt<bool>
+TimePassesWallClock("time-passes-wall-clock", cl::Hidden,
+                    cl::desc("Only measure wall clock time with -time-passes, "
+                             "which is much cheaper"));
+
 class TimingInfo {
   DenseMap<Pass*, Timer*> TimingData;
   TimerGroup TG;
 public:
   // Use 'create' member to get this.
-  TimingInfo() : TG("... Pass execution timing report ...") {}
+  TimingInfo()
+    : TG("... Pass execution timing report ...", TimePassesWallClock) {}
 
   // TimingDtor - Print out information about timing information
   ~TimingInfo() {
@@ -710,28 +724,26 @@ Pass *PMTopLevelManager::findAnalysisPass(AnalysisID AID) {
     if (Pass *P = (*I)->findAnalysisPass(AID, false))
       return P;
 
-  // Check the immutable passes. Iterate in reverse order so that we find
-  // the most recently registered passes first.
-  for (SmallVectorImpl<ImmutablePass *>::reverse_iterator I =
-       ImmutablePasses.rbegin(), E = ImmutablePasses.rend(); I != E; ++I) {
-    AnalysisID PI = (*I)->getPassID();
-    if (PI == AID)
-      return *I;
-
-    // If Pass not found then check the interfaces implemented by Immutable Pass
-    const PassInfo *PassInf =
-      PassRegistry::getPassRegistry()->getPassInfo(PI);
-    assert(PassInf && "Expected all immutable passes to be initialized");
-    const std::vector<const PassInfo*> &ImmPI =
-      PassInf->getInterfacesImplemented();
-    for (std::vector<const PassInfo*>::const_iterator II = ImmPI.begin(),
-         EE = ImmPI.end(); II != EE; ++II) {
-      if ((*II)->getTypeInfo() == AID)
-        return *I;
-    }
-  }
+  // Check the immutable passes.
+  return ImmutablePassMap.lookup(AID);
+}
 
-  return 0;
+void PMTopLevelManager::addImmutablePass(ImmutablePass *P) {
+  P->initializePass();
+  ImmutablePasses.push_back(P);
+
+  // Later passes take precedence over earlier ones, for their own ID and for
+  // the interfaces they implement.
+  AnalysisID AID = P->getPassID();
+  ImmutablePassMap[AID] = P;
+
+  const PassInfo *PassInf = PassRegistry::getPassRegistry()->getPassInfo(AID);
+  assert(PassInf && "Expected all immutable passes to be initialized");
+  const std::vector<const PassInfo*> &ImmPI =
+    PassInf->getInterfacesImplemented();
+  for (std::vector<const PassInfo*>::const_iterator II = ImmPI.begin(),
+       EE = ImmPI.end(); II != EE; ++II)
+    ImmutablePassMap[(*II)->getTypeInfo()] = P;
 }
 
 // Print passes managed by this top level manager.
@@ -1307,8 +1319,11 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        PassInstrumentationRegion PIR(BP, *F.getParent(), &F);
 
-        LocalChanged |= BP->runOnBasicBlock(*I);
+        if (PIR.shouldRunPass())
+          LocalChanged |= BP->runOnBasicBlock(*I);
+        PIR.passExecuted(LocalChanged);
       }
 
       Changed |= LocalChanged;
@@ -1534,8 +1549,11 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassInstrumentationRegion PIR(FP, *F.getParent(), &F);
 
-      LocalChanged |= FP->runOnFunction(F);
+      if (PIR.shouldRunPass())
+        LocalChanged |= FP->runOnFunction(F);
+      PIR.passExecuted(LocalChanged);
     }
 
     Changed |= LocalChanged;
@@ -1552,6 +1570,14 @@ bool FPPassManager::runOnFunction(Function &F) {
 }
 
 bool FPPassManager::runOnModule(Module &M) {
+  if (unsigned NumThreads = getParallelThreadCount()) {
+    std::vector<Function *> Functions;
+    for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+      if (!I->isDeclaration())
+        Functions.push_back(I);
+    return runInParallel(M, Functions, NumThreads);
+  }
+
   bool Changed = false;
 
   for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
@@ -1560,6 +1586,138 @@ bool FPPassManager::runOnModule(Module &M) {
   return Changed;
 }
 
+unsigned FPPassManager::getParallelThreadCount() const {
+  if (FunctionPassThreads > 1 && canRunInParallel())
+    return FunctionPassThreads;
+  return 0;
+}
+
+bool FPPassManager::canRunInParallel() const {
+  // Timing, verification and debug output all go through state shared by
+  // the whole pass manager.
+  if (PassDebugging != Disabled || TimePassesIsEnabled)
+    return false;
+
+  for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
+    FunctionPass *FP = static_cast<FunctionPass *>(PassVector[Index]);
+    if (!FP->isFunctionLocal())
+      return false;
+    const PassInfo *PI =
+      PassRegistry::getPassRegistry()->getPassInfo(FP->getPassID());
+    if (!PI || !PI->getNormalCtor())
+      return false;
+  }
+  return true;
+}
+
+namespace {
+/// FunctionPassWorker - One thread's copy of an FPPassManager pipeline and
+/// the shared queue of functions it takes work from.
+struct FunctionPassWorker {
+  std::vector<FunctionPass *> Passes;
+  const std::vector<Function *> *Functions;
+  volatile sys::cas_flag *NextFunction;
+  bool Changed;
+};
+}
+
+static void runFunctionPassWorker(void *Arg) {
+  FunctionPassWorker &W = *static_cast<FunctionPassWorker *>(Arg);
+  const std::vector<Function *> &Functions = *W.Functions;
+  for (;;) {
+    unsigned Index = sys::AtomicIncrement(W.NextFunction) - 1;
+    if (Index >= Functions.size())
+      break;
+    Function &F = *Functions[Index];
+    for (unsigned i = 0, e = W.Passes.size(); i != e; ++i) {
+      PassManagerPrettyStackEntry X(W.Passes[i], F);
+      PassInstrumentationRegion PIR(W.Passes[i], *F.getParent(), &F);
+      bool LocalChanged = false;
+      if (PIR.shouldRunPass())
+        LocalChanged = W.Passes[i]->runOnFunction(F);
+      PIR.passExecuted(LocalChanged);
+      W.Changed |= LocalChanged;
+    }
+    for (unsigned i = 0, e = W.Passes.size(); i != e; ++i)
+      W.Passes[i]->releaseMemory();
+  }
+}
+
+bool FPPassManager::runInParallel(Module &M,
+                                  const std::vector<Function *> &Functions,
+                                  unsigned NumThreads) {
+  if (Functions.empty())
+    return false;
+  if (Functions.size() < NumThreads)
+    NumThreads = Functions.size();
+
+  // Pass instances, analysis resolvers and the PassRegistry are shared
+  // between threads below.
+  if (NumThreads > 1 && !llvm_is_multithreaded())
+    llvm_start_multithreaded();
+
+  populateInheritedAnalysis(TPM->activeStack);
+
+  // Give every worker its own instance of each pass.  The pass manager has
+  // already scheduled a fresh instance of an analysis after every pass that
+  // invalidates it, so the most recent earlier provider in the pipeline is the
+  // one a pass would have been handed when run serially.  Anything else comes
+  // from an enclosing pass manager and is shared.
+  PassRegistry &PR = *PassRegistry::getPassRegistry();
+  unsigned NumPasses = getNumContainedPasses();
+  std::vector<FunctionPassWorker> Workers(NumThreads);
+  std::vector<void *> Work;
+  volatile sys::cas_flag NextFunction = 0;
+  bool Changed = false;
+  for (unsigned T = 0; T != NumThreads; ++T) {
+    FunctionPassWorker &W = Workers[T];
+    W.Functions = &Functions;
+    W.NextFunction = &NextFunction;
+    W.Changed = false;
+
+    DenseMap<AnalysisID, FunctionPass *> Provider;
+    for (unsigned Index = 0; Index < NumPasses; ++Index) {
+      FunctionPass *FP = getContainedPass(Index);
+      const PassInfo *PI = PR.getPassInfo(FP->getPassID());
+      FunctionPass *Clone = static_cast<FunctionPass *>(PI->createPass());
+      AnalysisResolver *AR = new AnalysisResolver(*this);
+      Clone->setResolver(AR);
+
+      AnalysisUsage *AnUsage = TPM->findAnalysisUsage(FP);
+      const AnalysisUsage::VectorType &Required = AnUsage->getRequiredSet();
+      for (unsigned i = 0, e = Required.size(); i != e; ++i) {
+        DenseMap<AnalysisID, FunctionPass *>::iterator I =
+          Provider.find(Required[i]);
+        if (I != Provider.end())
+          AR->addAnalysisImplsPair(Required[i], I->second);
+        else if (Pass *Impl = findAnalysisPass(Required[i], true))
+          AR->addAnalysisImplsPair(Required[i], Impl);
+      }
+
+      Provider[PI->getTypeInfo()] = Clone;
+      const std::vector<const PassInfo *> &II = PI->getInterfacesImplemented();
+      for (unsigned i = 0, e = II.size(); i != e; ++i)
+        Provider[II[i]->getTypeInfo()] = Clone;
+
+      Changed |= Clone->doInitialization(M);
+      W.Passes.push_back(Clone);
+    }
+    Work.push_back(&W);
+  }
+
+  llvm_execute_on_threads(runFunctionPassWorker, &Work[0], Work.size());
+
+  for (unsigned T = 0; T != NumThreads; ++T) {
+    FunctionPassWorker &W = Workers[T];
+    Changed |= W.Changed;
+    for (int Index = W.Passes.size() - 1; Index >= 0; --Index) {
+      Changed |= W.Passes[Index]->doFinalization(M);
+      delete W.Passes[Index];
+    }
+  }
+  return Changed;
+}
+
 bool FPPassManager::doInitialization(Module &M) {
   bool Changed = false;
 
@@ -1612,8 +1770,11 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassInstrumentationRegion PIR(MP, M, 0);
 
-      LocalChanged |= MP->runOnModule(M);
+      if (PIR.shouldRunPass())
+        LocalChanged |= MP->runOnModule(M);
+      PIR.passExecuted(LocalChanged);
     }
 
     Changed |= LocalChanged;
@@ -1774,6 +1935,83 @@ Timer *llvm::getPassTimer(Pass *P) {
   return 0;
 }
 
+//===----------------------------------------------------------------------===//
+// PassInstrumentation implementation
+
+void PassInstrumentation::anchor() {}
+
+static ManagedStatic<sys::SmartMutex<true> > InstrumentationsMutex;
+static ManagedStatic<std::vector<PassInstrumentation *> > Instrumentations;
+
+void llvm::addPassInstrumentation(PassInstrumentation *PI) {
+  sys::SmartScopedLock<true> Lock(*InstrumentationsMutex);
+  Instrumentations->push_back(PI);
+}
+
+void llvm::removePassInstrumentation(PassInstrumentation *PI) {
+  sys::SmartScopedLock<true> Lock(*InstrumentationsMutex);
+  Instrumentations->erase(std::remove(Instrumentations->begin(),
+                                      Instrumentations->end(), PI),
+                          Instrumentations->end());
+}
+
+static unsigned countInstructions(const Function &F) {
+  unsigned Count = 0;
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Count += BB->size();
+  return Count;
+}
+
+static unsigned countInstructions(const Module &M, const Function *F) {
+  if (F)
+    return countInstructions(*F);
+  unsigned Count = 0;
+  for (Module::const_iterator I = M.begin(), E = M.end(); I != E; ++I)
+    Count += countInstructions(*I);
+  return Count;
+}
+
+PassInstrumentationRegion::PassInstrumentationRegion(Pass *P, Module &M,
+                                                     Function *F)
+  : P(P), M(M), F(F), Active(false), Skip(false), InstCountBefore(0) {
+  if (!Instrumentations.isConstructed() || Instrumentations->empty() ||
+      P->getAsPMDataManager())
+    return;
+  Active = true;
+
+  const PassInfo *PI =
+    PassRegistry::getPassRegistry()->getPassInfo(P->getPassID());
+  if (!PI || !PI->isAnalysis()) {
+    std::vector<PassInstrumentation *> &PIs = *Instrumentations;
+    for (unsigned i = 0, e = PIs.size(); i != e && !Skip; ++i)
+      Skip = !PIs[i]->shouldRunPass(P, M, F);
+  }
+  if (Skip)
+    return;
+
+  InstCountBefore = countInstructions(M, F);
+  Start = TimeRecord::getCurrentTime(true);
+}
+
+void PassInstrumentationRegion::passExecuted(bool Changed) {
+  if (!Active || Skip)
+    return;
+
+  PassRunInfo Info;
+  Info.Time = TimeRecord::getCurrentTime(false);
+  Info.Time -= Start;
+  Info.P = P;
+  Info.M = &M;
+  Info.F = F;
+  Info.Changed = Changed;
+  Info.InstCountBefore = InstCountBefore;
+  Info.InstCountAfter = countInstructions(M, F);
+
+  std::vector<PassInstrumentation *> &PIs = *Instrumentations;
+  for (unsigned i = 0, e = PIs.size(); i != e; ++i)
+    PIs[i]->passExecuted(Info);
+}
+
 //===----------------------------------------------------------------------===//
 // PMStack implementation
 //
@@ -137,7 +137,7 @@ MDNode::~MDNode() {
   if (isNotUniqued()) {
     pImpl->NonUniquedMDNodes.erase(this);
   } else {
-    pImpl->MDNodeSet.RemoveNode(this);
+    pImpl->MDNodeSet.erase(this);
   }
 
   // Destroy the operands.
@@ -218,19 +218,16 @@ MDNode *MDNode::getMDNode(LLVMContext &Context, ArrayRef<Value*> Vals,
                           FunctionLocalness FL, bool Insert) {
   LLVMContextImpl *pImpl = Context.pImpl;
 
-  // Add all the operand pointers. Note that we don't have to add the
-  // isFunctionLocal bit because that's implied by the operands.
+  // Look the node up by its operand pointers. Note that we don't have to
+  // include the isFunctionLocal bit because that's implied by the operands.
   // Note that if the operands are later nulled out, the node will be
   // removed from the uniquing map.
-  FoldingSetNodeID ID;
-  for (unsigned i = 0; i != Vals.size(); ++i)
-    ID.AddPointer(Vals[i]);
-
-  void *InsertPoint;
-  MDNode *N = pImpl->MDNodeSet.FindNodeOrInsertPos(ID, InsertPoint);
-
-  if (N || !Insert)
-    return N;
+  MDNodeInfo::KeyTy Key(Vals);
+  LLVMContextImpl::MDNodeSetTy::iterator I = pImpl->MDNodeSet.find_as(Key);
+  if (I != pImpl->MDNodeSet.end())
+    return I->first;
+  if (!Insert)
+    return 0;
 
   bool isFunctionLocal = false;
   switch (FL) {
@@ -254,13 +251,11 @@ MDNode *MDNode::getMDNode(LLVMContext &Context, ArrayRef<Value*> Vals,
 
   // Coallocate space for the node and Operands together, then placement new.
   void *Ptr = malloc(sizeof(MDNode) + Vals.size() * sizeof(MDNodeOperand));
-  N = new (Ptr) MDNode(Context, Vals, isFunctionLocal);
+  MDNode *N = new (Ptr) MDNode(Context, Vals, isFunctionLocal);
 
   // Cache the operand hash.
-  N->Hash = ID.ComputeHash();
-
-  // InsertPoint will have been set by the FindNodeOrInsertPos call.
-  pImpl->MDNodeSet.InsertNode(N, InsertPoint);
+  N->Hash = Key.Hash;
+  pImpl->MDNodeSet.insert(std::make_pair(N, char()));
 
   return N;
 }
@@ -291,7 +286,7 @@ MDNode *MDNode::getTemporary(LLVMContext &Context, ArrayRef<Value*> Vals) {
 
 void MDNode::deleteTemporary(MDNode *N) {
   assert(N->use_empty() && "Temporary MDNode has uses!");
-  assert(!N->getContext().pImpl->MDNodeSet.RemoveNode(N) &&
+  assert(!N->getContext().pImpl->MDNodeSet.erase(N) &&
          "Deleting a non-temporary uniqued node!");
   assert(!N->getContext().pImpl->NonUniquedMDNodes.erase(N) &&
          "Deleting a non-temporary non-uniqued node!");
@@ -309,15 +304,6 @@ Value *MDNode::getOperand(unsigned i) const {
   return *getOperandPtr(const_cast<MDNode*>(this), i);
 }
 
-void MDNode::Profile(FoldingSetNodeID &ID) const {
-  // Add all the operand pointers. Note that we don't have to add the
-  // isFunctionLocal bit because that's implied by the operands.
-  // Note that if the operands are later nulled out, the node will be
-  // removed from the uniquing map.
-  for (unsigned i = 0, e = getNumOperands(); i != e; ++i)
-    ID.AddPointer(getOperand(i));
-}
-
 void MDNode::setIsNotUniqued() {
   setValueSubclassData(getSubclassDataFromValue() | NotUniquedBit);
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
@@ -358,35 +344,37 @@ void MDNode::replaceOperand(MDNodeOperand *Op, Value *To) {
 
   LLVMContextImpl *pImpl = getType()->getContext().pImpl;
 
-  // Remove "this" from the context map.  FoldingSet doesn't have to reprofile
-  // this node to remove it, so we don't care what state the operands are in.
-  pImpl->MDNodeSet.RemoveNode(this);
+  // Remove "this" from the context map.  The map uses the cached hash to find
+  // this node, so we don't care what state the operands are in.
+  pImpl->MDNodeSet.erase(this);
 
   // If we are dropping an argument to null, we choose to not unique the MDNode
   // anymore.  This commonly occurs during destruction, and uniquing these
   // brings little reuse.  Also, this means we don't need to include
-  // isFunctionLocal bits in FoldingSetNodeIDs for MDNodes.
+  // isFunctionLocal bits in the uniquing keys for MDNodes.
   if (To == 0) {
     setIsNotUniqued();
     return;
   }
 
-  // Now that the node is out of the folding set, get ready to reinsert it.
-  // First, check to see if another node with the same operands already exists
-  // in the set.  If so, then this node is redundant.
-  FoldingSetNodeID ID;
-  Profile(ID);
-  void *InsertPoint;
-  if (MDNode *N = pImpl->MDNodeSet.FindNodeOrInsertPos(ID, InsertPoint)) {
+  // Now that the node is out of the map, get ready to reinsert it.  First,
+  // check to see if another node with the same operands already exists in the
+  // map.  If so, then this node is redundant.
+  SmallVector<Value*, 8> Vals;
+  for (unsigned i = 0, e = getNumOperands(); i != e; ++i)
+    Vals.push_back(getOperand(i));
+  MDNodeInfo::KeyTy Key(Vals);
+  LLVMContextImpl::MDNodeSetTy::iterator I = pImpl->MDNodeSet.find_as(Key);
+  if (I != pImpl->MDNodeSet.end()) {
+    MDNode *N = I->first;
     replaceAllUsesWith(N);
     destroy();
     return;
   }
 
   // Cache the operand hash.
-  Hash = ID.ComputeHash();
-  // InsertPoint will have been set by the FindNodeOrInsertPos call.
-  pImpl->MDNodeSet.InsertNode(this, InsertPoint);
+  Hash = Key.Hash;
+  pImpl->MDNodeSet.insert(std::make_pair(this, char()));
 
   // If this MDValue was previously function-local but no longer is, clear
   // its function-local flag.
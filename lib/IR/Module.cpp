@@ -435,6 +435,10 @@ bool Module::MaterializeAllPermanently(std::string *ErrInfo) {
   return false;
 }
 
+void Module::dropMaterializer() {
+  Materializer.reset();
+}
+
 //===----------------------------------------------------------------------===//
 // Other module related stuff.
 //
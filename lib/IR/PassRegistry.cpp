@@ -18,6 +18,7 @@
 #include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Function.h"
 #include "llvm/PassSupport.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
@@ -84,27 +85,52 @@ PassRegistry::~PassRegistry() {
   pImpl = 0;
 }
 
-const PassInfo *PassRegistry::getPassInfo(const void *TI) const {
-  sys::SmartScopedReader<true> Guard(*Lock);
-  PassRegistryImpl *Impl = static_cast<PassRegistryImpl*>(getImpl());
+void PassRegistry::freeze() {
+  sys::SmartScopedWriter<true> Guard(*Lock);
+  // Create the maps now, so that frozen lookups never have to.
+  getImpl();
+
+  // Make the registrations visible to the threads that see Frozen set.
+  sys::MemoryFence();
+  Frozen = true;
+}
+
+static const PassInfo *lookupPassInfo(PassRegistryImpl *Impl, const void *TI) {
   PassRegistryImpl::MapType::const_iterator I = Impl->PassInfoMap.find(TI);
   return I != Impl->PassInfoMap.end() ? I->second : 0;
 }
 
-const PassInfo *PassRegistry::getPassInfo(StringRef Arg) const {
-  sys::SmartScopedReader<true> Guard(*Lock);
-  PassRegistryImpl *Impl = static_cast<PassRegistryImpl*>(getImpl());
+static const PassInfo *lookupPassInfo(PassRegistryImpl *Impl, StringRef Arg) {
   PassRegistryImpl::StringMapType::const_iterator
     I = Impl->PassInfoStringMap.find(Arg);
   return I != Impl->PassInfoStringMap.end() ? I->second : 0;
 }
 
+const PassInfo *PassRegistry::getPassInfo(const void *TI) const {
+  if (Frozen) {
+    sys::MemoryFence();
+    return lookupPassInfo(static_cast<PassRegistryImpl*>(pImpl), TI);
+  }
+  sys::SmartScopedReader<true> Guard(*Lock);
+  return lookupPassInfo(static_cast<PassRegistryImpl*>(getImpl()), TI);
+}
+
+const PassInfo *PassRegistry::getPassInfo(StringRef Arg) const {
+  if (Frozen) {
+    sys::MemoryFence();
+    return lookupPassInfo(static_cast<PassRegistryImpl*>(pImpl), Arg);
+  }
+  sys::SmartScopedReader<true> Guard(*Lock);
+  return lookupPassInfo(static_cast<PassRegistryImpl*>(getImpl()), Arg);
+}
+
 //===----------------------------------------------------------------------===//
 // Pass Registration mechanism
 //
 
 void PassRegistry::registerPass(const PassInfo &PI, bool ShouldFree) {
   sys::SmartScopedWriter<true> Guard(*Lock);
+  assert(!Frozen && "Pass registered after the registry was frozen!");
   PassRegistryImpl *Impl = static_cast<PassRegistryImpl*>(getImpl());
   bool Inserted =
     Impl->PassInfoMap.insert(std::make_pair(PI.getTypeInfo(),&PI)).second;
@@ -122,6 +148,7 @@ void PassRegistry::registerPass(const PassInfo &PI, bool ShouldFree) {
 
 void PassRegistry::unregisterPass(const PassInfo &PI) {
   sys::SmartScopedWriter<true> Guard(*Lock);
+  assert(!Frozen && "Pass unregistered after the registry was frozen!");
   PassRegistryImpl *Impl = static_cast<PassRegistryImpl*>(getImpl());
   PassRegistryImpl::MapType::iterator I = 
     Impl->PassInfoMap.find(PI.getTypeInfo());
@@ -147,6 +174,7 @@ void PassRegistry::registerAnalysisGroup(const void *InterfaceID,
                                          PassInfo& Registeree,
                                          bool isDefault,
                                          bool ShouldFree) {
+  assert(!Frozen && "Analysis group registered after the registry was frozen!");
   PassInfo *InterfaceInfo =  const_cast<PassInfo*>(getPassInfo(InterfaceID));
   if (InterfaceInfo == 0) {
     // First reference to Interface, register it now.
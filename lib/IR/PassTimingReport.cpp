@@ -0,0 +1,156 @@
+//===-- PassTimingReport.cpp - Per-function pass timing report ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements PassTimingReport.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/PassTimingReport.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/YAMLTraits.h"
+#include <algorithm>
+using namespace llvm;
+
+void PassTimingReport::passExecuted(const PassRunInfo &Info) {
+  size_t MemUsage = sys::Process::GetMallocUsage();
+  sys::SmartScopedLock<true> Guard(Lock);
+
+  PassEntry Entry;
+  Entry.Name = PassNames.GetOrCreateValue(Info.P->getPassName()).getKey();
+  Entry.Time = Info.Time;
+  if (!Info.F) {
+    ModulePasses.push_back(Entry);
+    return;
+  }
+
+  StringMapEntry<unsigned> &Index =
+    FunctionIndex.GetOrCreateValue(Info.F->getName(), Functions.size());
+  if (Index.getValue() == Functions.size()) {
+    Functions.push_back(FunctionEntry());
+    Functions.back().Name = Info.F->getName();
+  }
+  FunctionEntry &FE = Functions[Index.getValue()];
+  FE.Time += Info.Time;
+  FE.PeakMemory = std::max(FE.PeakMemory, MemUsage);
+  FE.Passes.push_back(Entry);
+}
+
+void PassTimingReport::clear() {
+  sys::SmartScopedLock<true> Guard(Lock);
+  ModulePasses.clear();
+  Functions.clear();
+  FunctionIndex.clear();
+  PassNames.clear();
+}
+
+//===----------------------------------------------------------------------===//
+// YAML output
+
+namespace {
+/// YAMLPass - A run of a pass as written to the report.
+struct YAMLPass {
+  StringRef Name;
+  double WallTime, UserTime, SystemTime;
+  int64_t MemoryDelta;
+
+  YAMLPass() {}
+  explicit YAMLPass(const PassTimingReport::PassEntry &E)
+    : Name(E.Name), WallTime(E.Time.getWallTime()),
+      UserTime(E.Time.getUserTime()), SystemTime(E.Time.getSystemTime()),
+      MemoryDelta(E.Time.getMemUsed()) {}
+};
+
+/// YAMLFunction - A function as written to the report.
+struct YAMLFunction {
+  StringRef Name;
+  double WallTime, UserTime, SystemTime;
+  uint64_t PeakMemory;
+  std::vector<YAMLPass> Passes;
+};
+
+/// YAMLReport - The whole report.
+struct YAMLReport {
+  std::vector<YAMLPass> ModulePasses;
+  std::vector<YAMLFunction> Functions;
+};
+
+struct TakesLonger {
+  bool operator()(const PassTimingReport::FunctionEntry *LHS,
+                  const PassTimingReport::FunctionEntry *RHS) const {
+    return LHS->Time.getWallTime() > RHS->Time.getWallTime();
+  }
+};
+}
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(YAMLPass)
+LLVM_YAML_IS_SEQUENCE_VECTOR(YAMLFunction)
+
+namespace llvm {
+namespace yaml {
+template <> struct MappingTraits<YAMLPass> {
+  static void mapping(IO &IO, YAMLPass &P) {
+    IO.mapRequired("Name", P.Name);
+    IO.mapRequired("WallTime", P.WallTime);
+    IO.mapRequired("UserTime", P.UserTime);
+    IO.mapRequired("SystemTime", P.SystemTime);
+    IO.mapRequired("MemoryDelta", P.MemoryDelta);
+  }
+};
+
+template <> struct MappingTraits<YAMLFunction> {
+  static void mapping(IO &IO, YAMLFunction &F) {
+    IO.mapRequired("Name", F.Name);
+    IO.mapRequired("WallTime", F.WallTime);
+    IO.mapRequired("UserTime", F.UserTime);
+    IO.mapRequired("SystemTime", F.SystemTime);
+    IO.mapRequired("PeakMemory", F.PeakMemory);
+    IO.mapRequired("Passes", F.Passes);
+  }
+};
+
+template <> struct MappingTraits<YAMLReport> {
+  static void mapping(IO &IO, YAMLReport &R) {
+    IO.mapRequired("ModulePasses", R.ModulePasses);
+    IO.mapRequired("Functions", R.Functions);
+  }
+};
+}
+}
+
+void PassTimingReport::writeYAML(raw_ostream &OS) const {
+  sys::SmartScopedLock<true> Guard(Lock);
+
+  YAMLReport Report;
+  for (unsigned i = 0, e = ModulePasses.size(); i != e; ++i)
+    Report.ModulePasses.push_back(YAMLPass(ModulePasses[i]));
+
+  std::vector<const FunctionEntry *> Sorted;
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+    Sorted.push_back(&Functions[i]);
+  std::stable_sort(Sorted.begin(), Sorted.end(), TakesLonger());
+
+  Report.Functions.resize(Sorted.size());
+  for (unsigned i = 0, e = Sorted.size(); i != e; ++i) {
+    const FunctionEntry &FE = *Sorted[i];
+    YAMLFunction &F = Report.Functions[i];
+    F.Name = FE.Name;
+    F.WallTime = FE.Time.getWallTime();
+    F.UserTime = FE.Time.getUserTime();
+    F.SystemTime = FE.Time.getSystemTime();
+    F.PeakMemory = FE.PeakMemory;
+    for (unsigned j = 0, je = FE.Passes.size(); j != je; ++j)
+      F.Passes.push_back(YAMLPass(FE.Passes[j]));
+  }
+
+  yaml::Output YOut(OS);
+  YOut << Report;
+}
@@ -68,6 +68,7 @@ void SymbolTableListTraits<ValueSubClass,ItemParentClass>
   assert(V->getParent() == 0 && "Value already in a container!!");
   ItemParentClass *Owner = getListOwner();
   V->setParent(Owner);
+  TraitsClass::noteListChange(Owner);
   if (V->hasName())
     if (ValueSymbolTable *ST = TraitsClass::getSymTab(Owner))
       ST->reinsertValue(V);
@@ -77,8 +78,10 @@ template<typename ValueSubClass, typename ItemParentClass>
 void SymbolTableListTraits<ValueSubClass,ItemParentClass>
 ::removeNodeFromList(ValueSubClass *V) {
   V->setParent(0);
+  ItemParentClass *Owner = getListOwner();
+  TraitsClass::noteListChange(Owner);
   if (V->hasName())
-    if (ValueSymbolTable *ST = TraitsClass::getSymTab(getListOwner()))
+    if (ValueSymbolTable *ST = TraitsClass::getSymTab(Owner))
       ST->removeValueName(V->getValueName());
 }
 
@@ -89,7 +92,9 @@ void SymbolTableListTraits<ValueSubClass,ItemParentClass>
                         ilist_iterator<ValueSubClass> last) {
   // We only have to do work here if transferring instructions between BBs
   ItemParentClass *NewIP = getListOwner(), *OldIP = L2.getListOwner();
+  TraitsClass::noteListChange(NewIP);
   if (NewIP == OldIP) return;  // No work to do at all...
+  TraitsClass::noteListChange(OldIP);
 
   // We only have to update symbol table entries if we are transferring the
   // instructions to a different symtab object...
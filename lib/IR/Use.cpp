@@ -25,11 +25,11 @@ void Use::swap(Use &RHS) {
   Value *V2(RHS.Val);
   if (V1 != V2) {
     if (V1) {
-      removeFromList();
+      V1->removeUse(*this);
     }
 
     if (V2) {
-      RHS.removeFromList();
+      V2->removeUse(RHS);
       Val = V2;
       V2->addUse(*this);
     } else {
@@ -86,7 +86,14 @@ const Use *Use::getImpliedUser() const {
 //                         Use initTags Implementation
 //===----------------------------------------------------------------------===//
 
-Use *Use::initTags(Use * const Start, Use *Stop) {
+Use *Use::initTags(Use * const Start, Use *Stop, User *U) {
+#if LLVM_ENABLE_USE_BACK_POINTERS
+  for (Use *I = Start; I != Stop; ++I) {
+    new(I) Use(fullStopTag);
+    I->Parent = U;
+  }
+#else
+  (void)U;
   ptrdiff_t Done = 0;
   while (Done < 20) {
     if (Start == Stop--)
@@ -115,6 +122,7 @@ Use *Use::initTags(Use * const Start, Use *Stop) {
       ++Done;
     }
   }
+#endif
 
   return Start;
 }
@@ -134,6 +142,7 @@ void Use::zap(Use *Start, const Use *Stop, bool del) {
 //                         Use getUser Implementation
 //===----------------------------------------------------------------------===//
 
+#if !LLVM_ENABLE_USE_BACK_POINTERS
 User *Use::getUser() const {
   const Use *End = getImpliedUser();
   const UserRef *ref = reinterpret_cast<const UserRef*>(End);
@@ -141,5 +150,6 @@ User *Use::getUser() const {
     ? ref->getPointer()
     : reinterpret_cast<User*>(const_cast<Use*>(End));
 }
+#endif
 
 } // End llvm namespace
@@ -10,6 +10,7 @@
 #include "llvm/IR/User.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/Operator.h"
 
 namespace llvm {
@@ -49,7 +50,7 @@ Use *User::allocHungoffUses(unsigned N) const {
   Use *Begin = static_cast<Use*>(::operator new(size));
   Use *End = Begin + N;
   (void) new(End) Use::UserRef(const_cast<User*>(this), 1);
-  return Use::initTags(Begin, End);
+  return Use::initTags(Begin, End, const_cast<User*>(this));
 }
 
 //===----------------------------------------------------------------------===//
@@ -57,13 +58,16 @@ Use *User::allocHungoffUses(unsigned N) const {
 //===----------------------------------------------------------------------===//
 
 void *User::operator new(size_t s, unsigned Us) {
-  void *Storage = ::operator new(s + sizeof(Use) * Us);
+  return placeUser(::operator new(s + sizeof(Use) * Us), Us);
+}
+
+void *User::placeUser(void *Storage, unsigned Us) {
   Use *Start = static_cast<Use*>(Storage);
   Use *End = Start + Us;
   User *Obj = reinterpret_cast<User*>(End);
   Obj->OperandList = Start;
   Obj->NumOperands = Us;
-  Use::initTags(Start, End);
+  Use::initTags(Start, End, Obj);
   return Obj;
 }
 
@@ -76,7 +80,10 @@ void User::operator delete(void *Usr) {
   Use *Storage = static_cast<Use*>(Usr) - Start->NumOperands;
   // If there were hung-off uses, they will have been freed already and
   // NumOperands reset to 0, so here we just free the User itself.
-  ::operator delete(Storage);
+  if (Start->FromArena)
+    IRArena::release(Storage);
+  else
+    ::operator delete(Storage);
 }
 
 //===----------------------------------------------------------------------===//
@@ -180,11 +180,22 @@ void Value::setName(const Twine &NewName) {
   if (NewName.isTriviallyEmpty() && !hasName())
     return;
 
+  // Only global values are named in a context that discards names; don't
+  // even render the name.
+  bool DiscardName =
+    !isa<GlobalValue>(this) && getContext().shouldDiscardValueNames();
+  if (DiscardName && !hasName())
+    return;
+
   SmallString<256> NameData;
   StringRef NameRef = NewName.toStringRef(NameData);
   assert(NameRef.find_first_of(0) == StringRef::npos &&
          "Null bytes are not allowed in names");
 
+  // Renaming a value named before names were discarded drops its name.
+  if (DiscardName)
+    NameRef = StringRef();
+
   // Name isn't changing?
   if (getName() == NameRef)
     return;
@@ -264,6 +275,12 @@ void Value::takeName(Value *V) {
   // If V has no name either, we're done.
   if (!V->hasName()) return;
 
+  // In a context that discards names, only global values take them.
+  if (!isa<GlobalValue>(this) && getContext().shouldDiscardValueNames()) {
+    V->setName("");
+    return;
+  }
+
   // Get this's symtab if we didn't before.
   if (!ST) {
     if (getSymTab(this, ST)) {
@@ -323,6 +340,12 @@ void Value::replaceAllUsesWith(Value *New) {
       }
     }
 
+    // Let the verifier know that the using function changed.
+    if (Instruction *I = dyn_cast<Instruction>(U.getUser()))
+      if (BasicBlock *BB = I->getParent())
+        if (Function *F = BB->getParent())
+          F->markModified();
+
     U.set(New);
   }
 
@@ -126,6 +126,8 @@ namespace {
     bool Broken;          // Is this module found to be broken?
     VerifierFailureAction action;
                           // What to do if verification fails.
+    VerifierLevel Level;  // Which checks to run on function bodies.
+    bool OnlyModified;    // Skip functions that are already known valid.
     Module *Mod;          // Module we are verifying right now
     LLVMContext *Context; // Context within which we are verifying
     DominatorTree *DT;    // Dominator Tree, caution can be null!
@@ -154,13 +156,17 @@ namespace {
 
     Verifier()
       : FunctionPass(ID), Broken(false),
-        action(AbortProcessAction), Mod(0), Context(0), DT(0), DL(0),
+        action(AbortProcessAction), Level(VerifyAll), OnlyModified(false),
+        Mod(0), Context(0), DT(0), DL(0),
         MessagesStr(Messages), PersonalityFn(0) {
       initializeVerifierPass(*PassRegistry::getPassRegistry());
     }
-    explicit Verifier(VerifierFailureAction ctn)
-      : FunctionPass(ID), Broken(false), action(ctn), Mod(0),
-        Context(0), DT(0), DL(0), MessagesStr(Messages), PersonalityFn(0) {
+    explicit Verifier(VerifierFailureAction ctn,
+                      VerifierLevel Level = VerifyAll,
+                      bool OnlyModified = false)
+      : FunctionPass(ID), Broken(false), action(ctn), Level(Level),
+        OnlyModified(OnlyModified), Mod(0), Context(0), DT(0), DL(0),
+        MessagesStr(Messages), PersonalityFn(0) {
       initializeVerifierPass(*PassRegistry::getPassRegistry());
     }
 
@@ -176,12 +182,17 @@ namespace {
     }
 
     bool runOnFunction(Function &F) {
-      // Get dominator information if we are being run by PassManager
-      DT = &getAnalysis<DominatorTree>();
+      if (OnlyModified && !F.isModifiedSinceVerified())
+        return false;
+
+      // Get dominator information if we are being run by PassManager.  The
+      // structural level does without it.
+      DT = Level == VerifyAll ? &getAnalysis<DominatorTree>() : 0;
 
       Mod = F.getParent();
       if (!Context) Context = &F.getContext();
 
+      bool WasBroken = Broken;
       Finder.reset();
       visit(F);
       InstsInThisBlock.clear();
@@ -191,6 +202,10 @@ namespace {
         // Verify Debug Info.
         verifyDebugInfo();
 
+      // Only a full check lets later incremental runs skip this function.
+      if (Level == VerifyAll && !WasBroken && !Broken)
+        F.markVerified();
+
       // We must abort before returning back to the pass manager, or else the
       // pass manager may try to run other passes on the broken module.
       return abortIfBroken();
@@ -220,7 +235,9 @@ namespace {
       visitModuleFlags(M);
       visitModuleIdents(M);
 
-      if (!DisableDebugInfoVerifier) {
+      // Collecting the module's debug info walks every instruction, which is
+      // what an incremental run is trying to avoid.
+      if (!DisableDebugInfoVerifier && !OnlyModified) {
         Finder.reset();
         Finder.processModule(M);
         // Verify Debug Info.
@@ -234,7 +251,8 @@ namespace {
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.setPreservesAll();
       AU.addRequiredID(PreVerifyID);
-      AU.addRequired<DominatorTree>();
+      if (Level == VerifyAll)
+        AU.addRequired<DominatorTree>();
     }
 
     /// abortIfBroken - If the module is broken and we are supposed to abort on
@@ -1154,6 +1172,20 @@ void Verifier::visitBasicBlock(BasicBlock &BB) {
       }
     }
   }
+
+  // Check that the predecessor list the block keeps matches the CFG.
+  if (BB.maintainsPredecessors()) {
+    SmallVector<BasicBlock*, 8> Preds;
+    for (pred_iterator PI = pred_begin(&BB), E = pred_end(&BB); PI != E; ++PI)
+      if (*PI)
+        Preds.push_back(*PI);
+    ArrayRef<BasicBlock*> Kept = BB.getMaintainedPredecessors();
+    SmallVector<BasicBlock*, 8> KeptPreds(Kept.begin(), Kept.end());
+    std::sort(Preds.begin(), Preds.end());
+    std::sort(KeptPreds.begin(), KeptPreds.end());
+    Assert1(Preds == KeptPreds,
+            "Kept predecessor list does not match the CFG!", &BB);
+  }
 }
 
 void Verifier::visitTerminatorInst(TerminatorInst &I) {
@@ -1997,6 +2029,10 @@ void Verifier::visitLandingPadInst(LandingPadInst &LPI) {
 }
 
 void Verifier::verifyDominatesUse(Instruction &I, unsigned i) {
+  // The structural level does not check dominance.
+  if (!DT)
+    return;
+
   Instruction *Op = cast<Instruction>(I.getOperand(i));
   // If the we have an invalid invoke, don't try to compute the dominance.
   // We already reject it in the invoke specific checks and the dominance
@@ -2017,7 +2053,9 @@ void Verifier::visitInstruction(Instruction &I) {
   BasicBlock *BB = I.getParent();
   Assert1(BB, "Instruction not embedded in basic block!", &I);
 
-  if (!isa<PHINode>(I)) {   // Check that non-phi nodes are not self referential
+  // Check that non-phi nodes are not self referential.  Unreachable code may
+  // do this, so it takes a dominator tree to tell.
+  if (!isa<PHINode>(I) && DT) {
     for (Value::use_iterator UI = I.use_begin(), UE = I.use_end();
          UI != UE; ++UI)
       Assert1(*UI != (User*)&I || !DT->isReachableFromEntry(BB),
@@ -2377,6 +2415,15 @@ void Verifier::visitIntrinsicFunctionCall(Intrinsic::ID ID, CallInst &CI) {
     Assert1(isa<ConstantInt>(CI.getArgOperand(1)),
             "llvm.invariant.end parameter #2 must be a constant integer", &CI);
     break;
+  case Intrinsic::gather: {
+    VectorType *IdxTy = cast<VectorType>(CI.getArgOperand(1)->getType());
+    Assert1(IdxTy->getElementType()->isIntegerTy(),
+            "llvm.gather indices must be integers", &CI);
+    Assert1(IdxTy->getNumElements() ==
+                cast<VectorType>(CI.getType())->getNumElements(),
+            "llvm.gather needs one index per element", &CI);
+    break;
+  }
   }
 }
 
@@ -2406,8 +2453,10 @@ void Verifier::verifyDebugInfo() {
 //  Implement the public interfaces to this file...
 //===----------------------------------------------------------------------===//
 
-FunctionPass *llvm::createVerifierPass(VerifierFailureAction action) {
-  return new Verifier(action);
+FunctionPass *llvm::createVerifierPass(VerifierFailureAction action,
+                                       VerifierLevel Level,
+                                       bool OnlyModified) {
+  return new Verifier(action, Level, OnlyModified);
 }
 
 
@@ -2440,3 +2489,21 @@ bool llvm::verifyModule(const Module &M, VerifierFailureAction action,
     *ErrorInfo = V->MessagesStr.str();
   return V->Broken;
 }
+
+/// verifyModifiedFunctions - Check the global values of a module and the
+/// bodies of the functions that changed since they were last verified.
+/// Return true if the module is corrupt.
+///
+bool llvm::verifyModifiedFunctions(const Module &M,
+                                   VerifierFailureAction action,
+                                   VerifierLevel Level,
+                                   std::string *ErrorInfo) {
+  PassManager PM;
+  Verifier *V = new Verifier(action, Level, /*OnlyModified=*/true);
+  PM.add(V);
+  PM.run(const_cast<Module&>(M));
+
+  if (ErrorInfo && V->Broken)
+    *ErrorInfo = V->MessagesStr.str();
+  return V->Broken;
+}
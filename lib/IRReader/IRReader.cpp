@@ -83,8 +83,13 @@ Module *llvm::ParseIR(MemoryBuffer *Buffer, SMDiagnostic &Err,
 
 Module *llvm::ParseIRFile(const std::string &Filename, SMDiagnostic &Err,
                           LLVMContext &Context) {
+  // The whole file is parsed from start to end.
+  MemoryBuffer::OpenOptions Options;
+  Options.Access = MemoryBuffer::AP_Sequential;
+  Options.Prefetch = true;
   OwningPtr<MemoryBuffer> File;
-  if (error_code ec = MemoryBuffer::getFileOrSTDIN(Filename, File)) {
+  if (error_code ec = MemoryBuffer::getFileOrSTDIN(Filename, File, -1,
+                                                   Options)) {
     Err = SMDiagnostic(Filename, SourceMgr::DK_Error,
                        "Could not open input file: " + ec.message());
     return 0;
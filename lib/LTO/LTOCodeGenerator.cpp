@@ -14,7 +14,9 @@
 
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/LTO/LTOModule.h"
+#include "llvm/LTO/LTOSummary.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -35,10 +37,14 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/system_error.h"
 #include "llvm/Target/TargetLibraryInfo.h"
@@ -49,6 +55,7 @@
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/ObjCARC.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 using namespace llvm;
 
 const char* LTOCodeGenerator::getVersionString() {
@@ -62,7 +69,8 @@ const char* LTOCodeGenerator::getVersionString() {
 LTOCodeGenerator::LTOCodeGenerator()
     : Context(getGlobalContext()), Linker(new Module("ld-temp.o", Context)),
       TargetMach(NULL), EmitDwarfDebugInfo(false), ScopeRestrictionsDone(false),
-      CodeModel(LTO_CODEGEN_PIC_MODEL_DYNAMIC), NativeObjectFile(NULL) {
+      CodeModel(LTO_CODEGEN_PIC_MODEL_DYNAMIC), NativeObjectFile(NULL),
+      Parallelism(1) {
   initializeLTOPasses();
 }
 
@@ -120,6 +128,32 @@ bool LTOCodeGenerator::addModule(LTOModule* mod, std::string& errMsg) {
   return !ret;
 }
 
+bool LTOCodeGenerator::importFunctions(const LTOImportList &imports,
+                                       std::string &errMsg) {
+  for (LTOImportList::ImportMapTy::const_iterator I = imports.Imports.begin(),
+       E = imports.Imports.end(); I != E; ++I) {
+    OwningPtr<MemoryBuffer> Buffer;
+    if (error_code EC = MemoryBuffer::getFile(I->first, Buffer)) {
+      errMsg = "could not read " + I->first + ": " + EC.message();
+      return false;
+    }
+
+    // Only the bodies of the imported functions are ever read.
+    OwningPtr<Module> Src(getLazyBitcodeModule(Buffer.get(), Context,
+                                               &errMsg));
+    if (!Src)
+      return false;
+    Buffer.take();
+
+    llvm::StringSet<> Functions;
+    for (unsigned i = 0, e = I->second.size(); i != e; ++i)
+      Functions.insert(I->second[i]);
+    if (Linker.importFunctions(Src.get(), Functions, &errMsg))
+      return false;
+  }
+  return true;
+}
+
 void LTOCodeGenerator::setTargetOptions(TargetOptions options) {
   Options.LessPreciseFPMADOption = options.LessPreciseFPMADOption;
   Options.NoFramePointerElim = options.NoFramePointerElim;
@@ -439,11 +473,10 @@ void LTOCodeGenerator::applyScopeRestrictions() {
 }
 
 /// Optimize merged modules using various IPO passes
-bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
-                                          bool DisableOpt,
-                                          bool DisableInline,
-                                          bool DisableGVNLoadPRE,
-                                          std::string &errMsg) {
+bool LTOCodeGenerator::optimize(bool DisableOpt,
+                                bool DisableInline,
+                                bool DisableGVNLoadPRE,
+                                std::string &errMsg) {
   if (!this->determineTarget(errMsg))
     return false;
 
@@ -474,10 +507,18 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // Make sure everything is still good.
   passes.add(createVerifierPass());
 
+  // Run our queue of passes all at once now, efficiently.
+  passes.run(*mergedModule);
+  return true;
+}
+
+/// Run the code generator on an optimized module and write the object file.
+static bool emitObjectFile(Module &M, TargetMachine &TM, raw_ostream &out,
+                           std::string &errMsg) {
   PassManager codeGenPasses;
 
-  codeGenPasses.add(new DataLayout(*TargetMach->getDataLayout()));
-  TargetMach->addAnalysisPasses(codeGenPasses);
+  codeGenPasses.add(new DataLayout(*TM.getDataLayout()));
+  TM.addAnalysisPasses(codeGenPasses);
 
   formatted_raw_ostream Out(out);
 
@@ -485,18 +526,331 @@ bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
   // the ObjCARCContractPass must be run, so do it unconditionally here.
   codeGenPasses.add(createObjCARCContractPass());
 
-  if (TargetMach->addPassesToEmitFile(codeGenPasses, Out,
-                                      TargetMachine::CGFT_ObjectFile)) {
+  if (TM.addPassesToEmitFile(codeGenPasses, Out,
+                             TargetMachine::CGFT_ObjectFile)) {
     errMsg = "target file type not supported";
     return false;
   }
 
-  // Run our queue of passes all at once now, efficiently.
-  passes.run(*mergedModule);
-
   // Run the code generator, and write assembly file
-  codeGenPasses.run(*mergedModule);
+  codeGenPasses.run(M);
+
+  return true;
+}
+
+bool LTOCodeGenerator::generateObjectFile(raw_ostream &out,
+                                          bool DisableOpt,
+                                          bool DisableInline,
+                                          bool DisableGVNLoadPRE,
+                                          std::string &errMsg) {
+  if (!optimize(DisableOpt, DisableInline, DisableGVNLoadPRE, errMsg))
+    return false;
+
+  return emitObjectFile(*Linker.getModule(), *TargetMach, out, errMsg);
+}
+
+namespace {
+/// CodeGenPartition - The work handed to the thread that generates code for
+/// one partition of the merged module.
+struct CodeGenPartition {
+  StringRef Bitcode;
+  ArrayRef<unsigned> Assignment;
+  unsigned Number;
+  const TargetMachine *Parent;
+  TargetOptions Options;
+  StringRef CacheDir;   // Empty if object files aren't cached.
+  StringRef ConfigKey;  // See hashCodeGenConfig().
+  raw_fd_ostream *Out;
+  bool Success;
+  std::string ErrMsg;
+};
+}
+
+static void hashString(MD5 &Hash, StringRef S) {
+  const uint8_t Separator = 0;
+  Hash.update(S);
+  Hash.update(ArrayRef<uint8_t>(Separator));
+}
+
+/// Hash everything besides the IR of a partition that decides the object file
+/// generated for it, into \p Key.
+static void hashCodeGenConfig(const TargetMachine &TM,
+                              const TargetOptions &Options,
+                              ArrayRef<char *> CodegenOptions,
+                              SmallString<32> &Key) {
+  MD5 Hash;
+  hashString(Hash, LTOCodeGenerator::getVersionString());
+  hashString(Hash, TM.getTargetTriple());
+  hashString(Hash, TM.getTargetCPU());
+  hashString(Hash, TM.getTargetFeatureString());
+  hashString(Hash, Options.TrapFuncName);
+  for (unsigned i = 0, e = CodegenOptions.size(); i != e; ++i)
+    hashString(Hash, CodegenOptions[i]);
+
+  uint32_t Values[] = {
+    TM.getRelocationModel(), TM.getCodeModel(), TM.getOptLevel(),
+    Options.LessPreciseFPMADOption, Options.NoFramePointerElim,
+    Options.AllowFPOpFusion, Options.UnsafeFPMath, Options.NoInfsFPMath,
+    Options.NoNaNsFPMath, Options.HonorSignDependentRoundingFPMathOption,
+    Options.UseSoftFloat, Options.FloatABIType, Options.NoZerosInBSS,
+    Options.GuaranteedTailCallOpt, Options.DisableTailCalls,
+    Options.StackAlignmentOverride, Options.PositionIndependentExecutable,
+    Options.EnableSegmentedStacks, Options.UseInitArray
+  };
+  Hash.update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(Values),
+                                sizeof(Values)));
+
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  MD5::stringifyResult(Result, Key);
+}
+
+/// Delete the declarations of a partition that nothing refers to, which are
+/// most of the program, so that the partition's hash only changes with what
+/// it actually uses.
+static void stripUnusedDeclarations(Module &M) {
+  for (Module::iterator I = M.begin(), E = M.end(); I != E;) {
+    Function *F = I++;
+    if (F->isDeclaration() && F->use_empty())
+      F->eraseFromParent();
+  }
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E;) {
+    GlobalVariable *GV = I++;
+    if (GV->isDeclaration() && GV->use_empty())
+      GV->eraseFromParent();
+  }
+}
+
+/// Find the path the object file of partition \p M is cached at.
+static void getCachePath(const Module &M, const CodeGenPartition &P,
+                         SmallVectorImpl<char> &Path) {
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+
+  MD5 Hash;
+  hashString(Hash, P.ConfigKey);
+  Hash.update(ArrayRef<uint8_t>(
+    reinterpret_cast<const uint8_t *>(Bitcode.data()), Bitcode.size()));
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+
+  Path.clear();
+  Path.append(P.CacheDir.begin(), P.CacheDir.end());
+  sys::path::append(Path, "llvmcache-" + Key + ".o");
+}
+
+/// Copy the cached object file at \p CachePath to \p Out, if there is one.
+static bool readCachedObject(StringRef CachePath, raw_ostream &Out) {
+  OwningPtr<MemoryBuffer> Buffer;
+  if (MemoryBuffer::getFile(CachePath, Buffer))
+    return false;
+  Out << Buffer->getBuffer();
+  return true;
+}
+
+/// Add \p Object to the cache.  It is written to a temporary file that is
+/// then renamed, so that no one ever reads it half written.  Failing to
+/// cache it is not an error.
+static void addCachedObject(StringRef CachePath, StringRef Object) {
+  SmallString<128> TempPath;
+  int FD;
+  if (sys::fs::createUniqueFile(CachePath + "-%%%%%%.tmp", FD, TempPath))
+    return;
+
+  raw_fd_ostream OS(FD, /*shouldClose=*/true);
+  OS << Object;
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    sys::fs::remove(TempPath.str());
+    return;
+  }
+  if (sys::fs::rename(TempPath.str(), CachePath))
+    sys::fs::remove(TempPath.str());
+}
+
+static void closePartitionOutput(CodeGenPartition &P) {
+  P.Out->close();
+  if (P.Out->has_error()) {
+    P.Out->clear_error();
+    P.ErrMsg = "could not write object file";
+    return;
+  }
+  P.Success = true;
+}
+
+/// Load a private copy of one partition of the merged module into a fresh
+/// context and generate code for it, or find the object file in the cache if
+/// there is one.  Only the function bodies of the partition are read.
+static void generatePartition(void *Arg) {
+  CodeGenPartition &P = *static_cast<CodeGenPartition *>(Arg);
+  raw_fd_ostream &Out = *P.Out;
+
+  LLVMContext Context;
+  MemoryBuffer *Buffer =
+    MemoryBuffer::getMemBuffer(P.Bitcode, "ld-temp.o", false);
+  OwningPtr<Module> M(getLazyBitcodeModule(Buffer, Context, &P.ErrMsg));
+  if (!M) {
+    delete Buffer;
+    return;
+  }
+  if (materializePartition(*M, P.Assignment, P.Number, &P.ErrMsg))
+    return;
+  extractPartition(*M, P.Assignment, P.Number);
+
+  SmallString<128> CachePath;
+  if (!P.CacheDir.empty()) {
+    stripUnusedDeclarations(*M);
+    getCachePath(*M, P, CachePath);
+    if (readCachedObject(CachePath, Out)) {
+      closePartitionOutput(P);
+      return;
+    }
+  }
+
+  const TargetMachine &Parent = *P.Parent;
+  OwningPtr<TargetMachine> TM(
+    Parent.getTarget().createTargetMachine(Parent.getTargetTriple(),
+                                           Parent.getTargetCPU(),
+                                           Parent.getTargetFeatureString(),
+                                           P.Options,
+                                           Parent.getRelocationModel(),
+                                           Parent.getCodeModel(),
+                                           Parent.getOptLevel()));
+  if (CachePath.empty()) {
+    if (emitObjectFile(*M, *TM, Out, P.ErrMsg))
+      closePartitionOutput(P);
+    return;
+  }
+
+  // Whoever holds the lock on a cache entry is generating it.  Wait for them
+  // rather than generate the same object file again.
+  LockFileManager Lock(CachePath);
+  if (Lock == LockFileManager::LFS_Shared) {
+    Lock.waitForUnlock();
+    if (readCachedObject(CachePath, Out)) {
+      closePartitionOutput(P);
+      return;
+    }
+  }
+
+  SmallVector<char, 0> Object;
+  {
+    raw_svector_ostream OS(Object);
+    if (!emitObjectFile(*M, *TM, OS, P.ErrMsg))
+      return;
+  }
+  StringRef ObjectRef(Object.data(), Object.size());
+  Out << ObjectRef;
+  if (Lock == LockFileManager::LFS_Owned)
+    addCachedObject(CachePath, ObjectRef);
+  closePartitionOutput(P);
+}
+
+bool LTOCodeGenerator::compile_to_files(const char ***names,
+                                        unsigned *numFiles,
+                                        bool disableOpt,
+                                        bool disableInline,
+                                        bool disableGVNLoadPRE,
+                                        std::string &errMsg) {
+  NativeObjectPaths.clear();
+  NativeObjectPathPtrs.clear();
+
+  if (Parallelism <= 1 && CacheDir.empty()) {
+    const char *name;
+    if (!compile_to_file(&name, disableOpt, disableInline, disableGVNLoadPRE,
+                         errMsg))
+      return false;
+    NativeObjectPaths.push_back(name);
+  } else {
+    if (!optimize(disableOpt, disableInline, disableGVNLoadPRE, errMsg))
+      return false;
+
+    // Number the partitions in the merged module itself, so that local
+    // symbols referenced across partitions are renamed consistently, and
+    // hand a bitcode snapshot to each thread.
+    Module *mergedModule = Linker.getModule();
+    std::vector<unsigned> Assignment;
+    partitionModule(*mergedModule, Parallelism, Assignment);
+
+    SmallVector<char, 0> Bitcode;
+    {
+      raw_svector_ostream OS(Bitcode);
+      WriteBitcodeToFile(mergedModule, OS);
+    }
+
+    SmallString<32> ConfigKey;
+    if (!CacheDir.empty()) {
+      if (error_code EC = sys::fs::create_directories(CacheDir)) {
+        errMsg = "could not create cache directory " + CacheDir + ": " +
+                 EC.message();
+        return false;
+      }
+      hashCodeGenConfig(*TargetMach, Options, CodegenOptions, ConfigKey);
+    }
+
+    std::vector<CodeGenPartition> Partitions(Parallelism);
+    std::vector<void *> Work;
+    bool Success = true;
+    for (unsigned i = 0; i != Parallelism; ++i) {
+      SmallString<128> Filename;
+      int FD;
+      error_code EC = sys::fs::createTemporaryFile("lto-llvm", "o", FD,
+                                                   Filename);
+      if (EC) {
+        errMsg = EC.message();
+        Success = false;
+        break;
+      }
+      NativeObjectPaths.push_back(Filename.str());
+
+      CodeGenPartition &P = Partitions[i];
+      P.Out = new raw_fd_ostream(FD, /*shouldClose=*/true);
+      P.Bitcode = StringRef(Bitcode.data(), Bitcode.size());
+      P.Assignment = Assignment;
+      P.Number = i;
+      P.Parent = TargetMach;
+      P.Options = Options;
+      P.CacheDir = CacheDir;
+      P.ConfigKey = ConfigKey;
+      P.Success = false;
+      Work.push_back(&P);
+    }
+
+    if (Success) {
+      // The threads share global state such as the pass registry, which is
+      // only guarded once LLVM is in multithreaded mode.
+      if (!llvm_is_multithreaded())
+        llvm_start_multithreaded();
+      llvm_execute_on_threads(generatePartition, &Work[0], Work.size());
+    }
+
+    for (unsigned i = 0, e = Work.size(); i != e; ++i) {
+      if (Success && !Partitions[i].Success) {
+        errMsg = Partitions[i].ErrMsg;
+        Success = false;
+      }
+      delete Partitions[i].Out;
+    }
+
+    if (!Success) {
+      for (unsigned i = 0, e = NativeObjectPaths.size(); i != e; ++i)
+        sys::fs::remove(NativeObjectPaths[i]);
+      NativeObjectPaths.clear();
+      return false;
+    }
+  }
 
+  for (unsigned i = 0, e = NativeObjectPaths.size(); i != e; ++i)
+    NativeObjectPathPtrs.push_back(NativeObjectPaths[i].c_str());
+  *names = &NativeObjectPathPtrs[0];
+  *numFiles = NativeObjectPathPtrs.size();
   return true;
 }
 
@@ -0,0 +1,268 @@
+//===-- LTOSummary.cpp - LLVM Link Time Optimizer -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the function summaries of distributed LTO and the thin
+// link over them.  Summaries and import lists are written as YAML.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LTO/LTOSummary.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/InstIterator.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+
+/// refersToLocal - Return true if the operand \p V refers to something another
+/// module can't name: a global with local linkage, or a block address.
+static bool refersToLocal(const Value *V,
+                          SmallPtrSet<const Constant*, 16> &Visited) {
+  const Constant *C = dyn_cast<Constant>(V);
+  if (!C || !Visited.insert(C))
+    return false;
+  if (isa<BlockAddress>(C))
+    return true;
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(C))
+    return GV->hasLocalLinkage();
+  for (User::const_op_iterator I = C->op_begin(), E = C->op_end(); I != E; ++I)
+    if (refersToLocal(*I, Visited))
+      return true;
+  return false;
+}
+
+void LTOModuleSummary::build(const Module &M, StringRef Path) {
+  ModulePath = Path;
+  Functions.clear();
+
+  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+
+    Functions.push_back(LTOFunctionSummary());
+    LTOFunctionSummary &S = Functions.back();
+    S.Name = F->getName();
+    S.Linkage = F->getLinkage();
+    S.Importable = true;
+
+    SmallPtrSet<const Function*, 16> Callees;
+    SmallPtrSet<const Constant*, 16> Visited;
+    for (const_inst_iterator I = inst_begin(F), IE = inst_end(F); I != IE;
+         ++I) {
+      if (isa<DbgInfoIntrinsic>(&*I))
+        continue;
+      ++S.InstCount;
+
+      for (User::const_op_iterator OI = I->op_begin(), OE = I->op_end();
+           S.Importable && OI != OE; ++OI)
+        if (refersToLocal(*OI, Visited))
+          S.Importable = false;
+
+      ImmutableCallSite CS(&*I);
+      if (!CS)
+        continue;
+      const Function *Callee =
+        dyn_cast<Function>(CS.getCalledValue()->stripPointerCasts());
+      if (Callee && !Callee->isIntrinsic() && Callees.insert(Callee))
+        S.Calls.push_back(Callee->getName());
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// YAML I/O
+
+namespace {
+/// YAMLImport - The functions imported from one module, as written.
+struct YAMLImport {
+  std::string Module;
+  std::vector<std::string> Functions;
+};
+
+/// YAMLImportList - An import list as written.
+struct YAMLImportList {
+  std::string Module;
+  std::vector<YAMLImport> Imports;
+};
+}
+
+LLVM_YAML_IS_FLOW_SEQUENCE_VECTOR(std::string)
+LLVM_YAML_IS_SEQUENCE_VECTOR(LTOFunctionSummary)
+LLVM_YAML_IS_SEQUENCE_VECTOR(YAMLImport)
+
+namespace llvm {
+namespace yaml {
+template <> struct ScalarEnumerationTraits<GlobalValue::LinkageTypes> {
+  static void enumeration(IO &IO, GlobalValue::LinkageTypes &L) {
+    IO.enumCase(L, "external", GlobalValue::ExternalLinkage);
+    IO.enumCase(L, "available_externally",
+                GlobalValue::AvailableExternallyLinkage);
+    IO.enumCase(L, "linkonce", GlobalValue::LinkOnceAnyLinkage);
+    IO.enumCase(L, "linkonce_odr", GlobalValue::LinkOnceODRLinkage);
+    IO.enumCase(L, "weak", GlobalValue::WeakAnyLinkage);
+    IO.enumCase(L, "weak_odr", GlobalValue::WeakODRLinkage);
+    IO.enumCase(L, "appending", GlobalValue::AppendingLinkage);
+    IO.enumCase(L, "internal", GlobalValue::InternalLinkage);
+    IO.enumCase(L, "private", GlobalValue::PrivateLinkage);
+    IO.enumCase(L, "linker_private", GlobalValue::LinkerPrivateLinkage);
+    IO.enumCase(L, "linker_private_weak",
+                GlobalValue::LinkerPrivateWeakLinkage);
+    IO.enumCase(L, "dllimport", GlobalValue::DLLImportLinkage);
+    IO.enumCase(L, "dllexport", GlobalValue::DLLExportLinkage);
+    IO.enumCase(L, "extern_weak", GlobalValue::ExternalWeakLinkage);
+    IO.enumCase(L, "common", GlobalValue::CommonLinkage);
+  }
+};
+
+template <> struct MappingTraits<LTOFunctionSummary> {
+  static void mapping(IO &IO, LTOFunctionSummary &S) {
+    IO.mapRequired("Name", S.Name);
+    IO.mapRequired("Linkage", S.Linkage);
+    IO.mapRequired("InstCount", S.InstCount);
+    IO.mapRequired("Importable", S.Importable);
+    IO.mapOptional("Calls", S.Calls);
+  }
+};
+
+template <> struct MappingTraits<LTOModuleSummary> {
+  static void mapping(IO &IO, LTOModuleSummary &S) {
+    IO.mapRequired("Module", S.ModulePath);
+    IO.mapOptional("Functions", S.Functions);
+  }
+};
+
+template <> struct MappingTraits<YAMLImport> {
+  static void mapping(IO &IO, YAMLImport &I) {
+    IO.mapRequired("Module", I.Module);
+    IO.mapRequired("Functions", I.Functions);
+  }
+};
+
+template <> struct MappingTraits<YAMLImportList> {
+  static void mapping(IO &IO, YAMLImportList &L) {
+    IO.mapRequired("Module", L.Module);
+    IO.mapOptional("Imports", L.Imports);
+  }
+};
+}
+}
+
+void LTOModuleSummary::write(raw_ostream &OS) const {
+  yaml::Output YOut(OS);
+  YOut << const_cast<LTOModuleSummary &>(*this);
+}
+
+bool LTOModuleSummary::read(StringRef Buffer, std::string &errMsg) {
+  *this = LTOModuleSummary();
+  yaml::Input YIn(Buffer);
+  YIn >> *this;
+  if (YIn.error()) {
+    errMsg = "malformed summary";
+    return false;
+  }
+  return true;
+}
+
+void LTOImportList::write(raw_ostream &OS) const {
+  YAMLImportList List;
+  List.Module = ModulePath;
+  for (ImportMapTy::const_iterator I = Imports.begin(), E = Imports.end();
+       I != E; ++I) {
+    List.Imports.push_back(YAMLImport());
+    List.Imports.back().Module = I->first;
+    List.Imports.back().Functions = I->second;
+  }
+
+  yaml::Output YOut(OS);
+  YOut << List;
+}
+
+bool LTOImportList::read(StringRef Buffer, std::string &errMsg) {
+  YAMLImportList List;
+  yaml::Input YIn(Buffer);
+  YIn >> List;
+  if (YIn.error()) {
+    errMsg = "malformed import list";
+    return false;
+  }
+
+  ModulePath = List.Module;
+  Imports.clear();
+  for (unsigned i = 0, e = List.Imports.size(); i != e; ++i) {
+    std::vector<std::string> &Functions = Imports[List.Imports[i].Module];
+    Functions.insert(Functions.end(), List.Imports[i].Functions.begin(),
+                     List.Imports[i].Functions.end());
+  }
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Thin link
+
+void computeLTOImports(ArrayRef<LTOModuleSummary> Summaries,
+                       unsigned InstLimit,
+                       std::vector<LTOImportList> &Imports) {
+  // Where each function with external linkage is defined: the index of the
+  // module and the summary of the function.
+  typedef std::pair<unsigned, const LTOFunctionSummary *> DefinitionTy;
+  StringMap<DefinitionTy> Definitions;
+  for (unsigned i = 0, e = Summaries.size(); i != e; ++i) {
+    const std::vector<LTOFunctionSummary> &Functions = Summaries[i].Functions;
+    for (unsigned j = 0, je = Functions.size(); j != je; ++j)
+      if (Functions[j].Linkage == GlobalValue::ExternalLinkage)
+        Definitions.GetOrCreateValue(Functions[j].Name,
+                                     DefinitionTy(i, &Functions[j]));
+  }
+
+  Imports.assign(Summaries.size(), LTOImportList());
+  for (unsigned i = 0, e = Summaries.size(); i != e; ++i) {
+    LTOImportList &List = Imports[i];
+    List.ModulePath = Summaries[i].ModulePath;
+
+    // Calls to what the module defines itself, or to what has already been
+    // looked at, are skipped.
+    StringSet<> Seen;
+    std::vector<const LTOFunctionSummary *> Worklist;
+    const std::vector<LTOFunctionSummary> &Functions = Summaries[i].Functions;
+    for (unsigned j = 0, je = Functions.size(); j != je; ++j) {
+      Seen.insert(Functions[j].Name);
+      Worklist.push_back(&Functions[j]);
+    }
+
+    while (!Worklist.empty()) {
+      const LTOFunctionSummary *F = Worklist.back();
+      Worklist.pop_back();
+
+      for (unsigned j = 0, je = F->Calls.size(); j != je; ++j) {
+        if (!Seen.insert(F->Calls[j]))
+          continue;
+        StringMap<DefinitionTy>::const_iterator D =
+          Definitions.find(F->Calls[j]);
+        if (D == Definitions.end())
+          continue;
+        const LTOFunctionSummary *Callee = D->second.second;
+        if (!Callee->Importable || Callee->InstCount > InstLimit)
+          continue;
+        List.Imports[Summaries[D->second.first].ModulePath].push_back(
+          Callee->Name);
+        Worklist.push_back(Callee);
+      }
+    }
+
+    for (LTOImportList::ImportMapTy::iterator I = List.Imports.begin(),
+         IE = List.Imports.end(); I != IE; ++I)
+      std::sort(I->second.begin(), I->second.end());
+  }
+}
@@ -13,6 +13,7 @@
 
 #include "llvm/Linker.h"
 #include "llvm-c/Linker.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallString.h"
@@ -29,8 +30,76 @@ using namespace llvm;
 // TypeMap implementation.
 //===----------------------------------------------------------------------===//
 
+//===----------------------------------------------------------------------===//
+// IdentifiedStructTypeSet implementation.
+//===----------------------------------------------------------------------===//
+
+/// hashTypeShape - Hash the structure of \p Ty.  Identified structs inside it
+/// only count as structs, since an opaque one is isomorphic to any other:
+/// isomorphic types hash the same whatever their names.
+static hash_code hashTypeShape(Type *Ty) {
+  StructType *STy = dyn_cast<StructType>(Ty);
+  if (STy && !STy->isLiteral())
+    return hash_value(unsigned(Type::StructTyID));
+
+  unsigned Extra = 0;
+  if (IntegerType *ITy = dyn_cast<IntegerType>(Ty))
+    Extra = ITy->getBitWidth();
+  else if (PointerType *PTy = dyn_cast<PointerType>(Ty))
+    Extra = PTy->getAddressSpace();
+  else if (FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+    Extra = FTy->isVarArg();
+  else if (STy)
+    Extra = STy->isPacked();
+  else if (SequentialType *SeqTy = dyn_cast<SequentialType>(Ty))
+    Extra = isa<ArrayType>(SeqTy) ? cast<ArrayType>(SeqTy)->getNumElements()
+                                  : cast<VectorType>(SeqTy)->getNumElements();
+
+  hash_code Hash = hash_combine(unsigned(Ty->getTypeID()), Extra);
+  for (unsigned i = 0, e = Ty->getNumContainedTypes(); i != e; ++i)
+    Hash = hash_combine(Hash, hashTypeShape(Ty->getContainedType(i)));
+  return Hash;
+}
+
+/// getIndexKey - The key of a struct type with a body in the index.
+static unsigned getIndexKey(StructType *Ty) {
+  assert(!Ty->isOpaque() && "Only types with a body are indexed");
+  hash_code Hash = hash_value(Ty->isPacked());
+  for (unsigned i = 0, e = Ty->getNumElements(); i != e; ++i)
+    Hash = hash_combine(Hash, hashTypeShape(Ty->getElementType(i)));
+  // Keep clear of the empty and tombstone keys of DenseMap.
+  return unsigned(size_t(Hash)) >> 1;
+}
+
+void Linker::IdentifiedStructTypeSet::insert(StructType *Ty) {
+  if (Ty->isOpaque()) {
+    OpaqueTypes.insert(Ty);
+    return;
+  }
+  OpaqueTypes.erase(Ty);
+  if (NonOpaqueTypes.insert(Ty))
+    NonOpaqueIndex[getIndexKey(Ty)].push_back(Ty);
+}
+
+bool Linker::IdentifiedStructTypeSet::count(StructType *Ty) const {
+  return OpaqueTypes.count(Ty) || NonOpaqueTypes.count(Ty);
+}
+
+ArrayRef<StructType*>
+Linker::IdentifiedStructTypeSet::getCandidates(StructType *Ty) const {
+  DenseMap<unsigned, TinyPtrVector<StructType*> >::const_iterator I =
+    NonOpaqueIndex.find(getIndexKey(Ty));
+  if (I == NonOpaqueIndex.end())
+    return ArrayRef<StructType*>();
+  return I->second;
+}
+
+//===----------------------------------------------------------------------===//
+// TypeMapTy implementation.
+//===----------------------------------------------------------------------===//
+
 namespace {
-  typedef SmallPtrSet<StructType*, 32> TypeSet;
+  typedef Linker::IdentifiedStructTypeSet TypeSet;
 
 class TypeMapTy : public ValueMapTypeRemapper {
   /// MappedTypes - This is a mapping from a source type to a destination type
@@ -60,6 +129,12 @@ public:
   /// module.
   void addTypeMapping(Type *DstTy, Type *SrcTy);
 
+  /// findIsomorphicType - Map the identified struct \p SrcTy, which has a
+  /// body, onto a destination type it is isomorphic to, if there is one, and
+  /// return that type.  Only the destination types whose structure hashes the
+  /// same are tried.
+  StructType *findIsomorphicType(StructType *SrcTy);
+
   /// linkDefinedTypeBodies - Produce a body for an opaque type in the dest
   /// module from a type definition in the source module.
   void linkDefinedTypeBodies();
@@ -113,6 +188,30 @@ void TypeMapTy::addTypeMapping(Type *DstTy, Type *SrcTy) {
   SpeculativeTypes.clear();
 }
 
+StructType *TypeMapTy::findIsomorphicType(StructType *SrcTy) {
+  ArrayRef<StructType*> Candidates = DstStructTypesSet.getCandidates(SrcTy);
+  for (unsigned i = 0, e = Candidates.size(); i != e; ++i) {
+    StructType *DstTy = Candidates[i];
+    unsigned NumToResolve = SrcDefinitionsToResolve.size();
+    if (areTypesIsomorphic(DstTy, SrcTy)) {
+      SpeculativeTypes.clear();
+      return DstTy;
+    }
+
+    // Roll back everything the failed match established, including the
+    // opaque destination types it would have given a body to.
+    for (unsigned j = 0, je = SpeculativeTypes.size(); j != je; ++j)
+      MappedTypes.erase(SpeculativeTypes[j]);
+    SpeculativeTypes.clear();
+    while (SrcDefinitionsToResolve.size() != NumToResolve) {
+      StructType *STy = SrcDefinitionsToResolve.pop_back_val();
+      DstResolvedOpaqueTypes.erase(cast<StructType>(MappedTypes[STy]));
+      MappedTypes.erase(STy);
+    }
+  }
+  return 0;
+}
+
 /// areTypesIsomorphic - Recursively walk this pair of types, returning true
 /// if they are isomorphic, false if they are not.
 bool TypeMapTy::areTypesIsomorphic(Type *DstTy, Type *SrcTy) {
@@ -222,6 +321,7 @@ void TypeMapTy::linkDefinedTypeBodies() {
       Elements[i] = getImpl(SrcSTy->getElementType(i));
     
     DstSTy->setBody(Elements, SrcSTy->isPacked());
+    DstStructTypesSet.insert(DstSTy);
     
     // If DstSTy has no name or has a longer name than STy, then viciously steal
     // STy's name.
@@ -338,6 +438,11 @@ Type *TypeMapTy::getImpl(Type *Ty) {
     return *Entry = STy;
   }
   
+  // Reuse a destination type with the same structure if there is one, rather
+  // than create a duplicate that only differs by name.
+  if (findIsomorphicType(STy))
+    return MappedTypes[STy];
+
   // Otherwise we create a new type and resolve its body later.  This will be
   // resolved by the top level of get().
   SrcDefinitionsToResolve.push_back(STy);
@@ -346,7 +451,7 @@ Type *TypeMapTy::getImpl(Type *Ty) {
   // identified structs in the destination module.
   DstStructTypesSet.insert(DTy);
   DstResolvedOpaqueTypes.insert(DTy);
-  return *Entry = DTy;
+  return MappedTypes[STy] = DTy;
 }
 
 //===----------------------------------------------------------------------===//
@@ -358,19 +463,25 @@ namespace {
 
   /// ValueMaterializerTy - Creates prototypes for functions that are lazily
   /// linked on the fly. This speeds up linking for modules with many
-  /// lazily linked functions of which few get used.
+  /// lazily linked functions of which few get used.  When importing, it
+  /// declares the globals the imported functions refer to instead.
   class ValueMaterializerTy : public ValueMaterializer {
     TypeMapTy &TypeMap;
     Module *DstM;
     std::vector<Function*> &LazilyLinkFunctions;
+    bool Importing;
   public:
     ValueMaterializerTy(TypeMapTy &TypeMap, Module *DstM,
-                        std::vector<Function*> &LazilyLinkFunctions) :
+                        std::vector<Function*> &LazilyLinkFunctions,
+                        bool Importing) :
       ValueMaterializer(), TypeMap(TypeMap), DstM(DstM),
-      LazilyLinkFunctions(LazilyLinkFunctions) {
+      LazilyLinkFunctions(LazilyLinkFunctions), Importing(Importing) {
     }
 
     virtual Value *materializeValueFor(Value *V);
+
+  private:
+    GlobalValue *declareGlobal(GlobalValue *SGV);
   };
 
   /// ModuleLinker - This is an implementation class for the LinkModules
@@ -402,14 +513,20 @@ namespace {
     
     // Vector of functions to lazily link in.
     std::vector<Function*> LazilyLinkFunctions;
+
+    // Names of the functions to import, or null when linking the whole
+    // source module.
+    const StringSet<> *FunctionsToImport;
     
   public:
     std::string ErrorMsg;
     
-    ModuleLinker(Module *dstM, TypeSet &Set, Module *srcM, unsigned mode)
+    ModuleLinker(Module *dstM, TypeSet &Set, Module *srcM, unsigned mode,
+                 const StringSet<> *functionsToImport = 0)
       : DstM(dstM), SrcM(srcM), TypeMap(Set),
-        ValMaterializer(TypeMap, DstM, LazilyLinkFunctions),
-        Mode(mode) { }
+        ValMaterializer(TypeMap, DstM, LazilyLinkFunctions,
+                        functionsToImport != 0),
+        Mode(mode), FunctionsToImport(functionsToImport) { }
     
     bool run();
     
@@ -454,6 +571,7 @@ namespace {
     bool linkAppendingVarProto(GlobalVariable *DstGV, GlobalVariable *SrcGV);
     bool linkGlobalProto(GlobalVariable *SrcGV);
     bool linkFunctionProto(Function *SrcF);
+    bool importFunctionProto(Function *SrcF, GlobalValue *DGV);
     bool linkAliasProto(GlobalAlias *SrcA);
     bool linkModuleFlagsMetadata();
     
@@ -510,7 +628,41 @@ static bool isLessConstraining(GlobalValue::VisibilityTypes a,
   return false;
 }
 
+/// declareGlobal - Declare a global value of the source module that an
+/// imported function refers to.  Aliases are declared as what they alias.
+GlobalValue *ValueMaterializerTy::declareGlobal(GlobalValue *SGV) {
+  PointerType *Ty = cast<PointerType>(TypeMap.get(SGV->getType()));
+  GlobalValue *DGV;
+  if (FunctionType *FTy = dyn_cast<FunctionType>(Ty->getElementType())) {
+    Function *DF = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                    SGV->getName(), DstM);
+    if (Function *SF = dyn_cast<Function>(SGV)) {
+      DF->setCallingConv(SF->getCallingConv());
+      DF->setAttributes(SF->getAttributes());
+    }
+    DGV = DF;
+  } else {
+    GlobalVariable *SGVar = dyn_cast<GlobalVariable>(SGV);
+    DGV = new GlobalVariable(*DstM, Ty->getElementType(),
+                             SGVar && SGVar->isConstant(),
+                             GlobalValue::ExternalLinkage, /*init*/0,
+                             SGV->getName(), /*insertbefore*/0,
+                             SGVar ? SGVar->getThreadLocalMode()
+                                   : GlobalVariable::NotThreadLocal,
+                             Ty->getAddressSpace());
+  }
+  DGV->setAlignment(SGV->getAlignment());
+  DGV->setVisibility(SGV->getVisibility());
+  forceRenaming(DGV, SGV->getName());
+  return DGV;
+}
+
 Value *ValueMaterializerTy::materializeValueFor(Value *V) {
+  if (Importing) {
+    GlobalValue *SGV = dyn_cast<GlobalValue>(V);
+    return SGV ? declareGlobal(SGV) : NULL;
+  }
+
   Function *SF = dyn_cast<Function>(V);
   if (!SF)
     return NULL;
@@ -753,6 +905,15 @@ bool ModuleLinker::linkGlobalProto(GlobalVariable *SGV) {
   llvm::Optional<GlobalValue::VisibilityTypes> NewVisibility;
   bool HasUnnamedAddr = SGV->hasUnnamedAddr();
 
+  // When importing, the variables of the source are only declared, on demand,
+  // unless the destination already has them.
+  if (FunctionsToImport) {
+    if (DGV)
+      ValueMap[SGV] = ConstantExpr::getBitCast(DGV,TypeMap.get(SGV->getType()));
+    DoNotLinkFromSource.insert(SGV);
+    return false;
+  }
+
   if (DGV) {
     // Concatenation of appending linkage variables is magic and handled later.
     if (DGV->hasAppendingLinkage() || SGV->hasAppendingLinkage())
@@ -824,6 +985,9 @@ bool ModuleLinker::linkFunctionProto(Function *SF) {
   llvm::Optional<GlobalValue::VisibilityTypes> NewVisibility;
   bool HasUnnamedAddr = SF->hasUnnamedAddr();
 
+  if (FunctionsToImport)
+    return importFunctionProto(SF, DGV);
+
   if (DGV) {
     GlobalValue::LinkageTypes NewLinkage = GlobalValue::InternalLinkage;
     bool LinkFromSrc = false;
@@ -851,8 +1015,11 @@ bool ModuleLinker::linkFunctionProto(Function *SF) {
   }
   
   // If the function is to be lazily linked, don't create it just yet.
-  // The ValueMaterializerTy will deal with creating it if it's used.
-  if (!DGV && (SF->hasLocalLinkage() || SF->hasLinkOnceLinkage() ||
+  // The ValueMaterializerTy will deal with creating it if it's used.  When
+  // only needed functions are linked, that goes for any function the
+  // destination doesn't know about.
+  if (!DGV && ((Mode & Linker::LinkOnlyNeeded) || SF->hasLocalLinkage() ||
+               SF->hasLinkOnceLinkage() ||
                SF->hasAvailableExternallyLinkage())) {
     DoNotLinkFromSource.insert(SF);
     return false;
@@ -877,12 +1044,49 @@ bool ModuleLinker::linkFunctionProto(Function *SF) {
   return false;
 }
 
+/// importFunctionProto - Set up the prototype of an imported function, or
+/// the mapping to what the destination has for a function that isn't.  An
+/// imported function is available_externally: the module it comes from still
+/// emits it.
+bool ModuleLinker::importFunctionProto(Function *SF, GlobalValue *DGV) {
+  if (!FunctionsToImport->count(SF->getName()) || SF->hasLocalLinkage() ||
+      (SF->isDeclaration() && !SF->isMaterializable()) ||
+      (DGV && !DGV->isDeclaration())) {
+    if (DGV)
+      ValueMap[SF] = ConstantExpr::getBitCast(DGV, TypeMap.get(SF->getType()));
+    DoNotLinkFromSource.insert(SF);
+    return false;
+  }
+
+  Function *NewDF = Function::Create(TypeMap.get(SF->getFunctionType()),
+                                     GlobalValue::AvailableExternallyLinkage,
+                                     SF->getName(), DstM);
+  copyGVAttributes(NewDF, SF);
+
+  if (DGV) {
+    // Any uses of the declaration need to change to NewDF, with cast.
+    DGV->replaceAllUsesWith(ConstantExpr::getBitCast(NewDF, DGV->getType()));
+    DGV->eraseFromParent();
+  }
+
+  ValueMap[SF] = NewDF;
+  return false;
+}
+
 /// LinkAliasProto - Set up prototypes for any aliases that come over from the
 /// source module.
 bool ModuleLinker::linkAliasProto(GlobalAlias *SGA) {
   GlobalValue *DGV = getLinkedToGlobal(SGA);
   llvm::Optional<GlobalValue::VisibilityTypes> NewVisibility;
 
+  // When importing, aliases are declared on demand like variables.
+  if (FunctionsToImport) {
+    if (DGV)
+      ValueMap[SGA] = ConstantExpr::getBitCast(DGV,TypeMap.get(SGA->getType()));
+    DoNotLinkFromSource.insert(SGA);
+    return false;
+  }
+
   if (DGV) {
     GlobalValue::LinkageTypes NewLinkage = GlobalValue::InternalLinkage;
     GlobalValue::VisibilityTypes NV;
@@ -978,7 +1182,7 @@ void ModuleLinker::linkFunctionBody(Function *Dst, Function *Src) {
     ValueMap[I] = DI;
   }
 
-  if (Mode == Linker::DestroySource) {
+  if (!(Mode & Linker::PreserveSource)) {
     // Splice the body of the source function into the dest function.
     Dst->getBasicBlockList().splice(Dst->end(), Src->getBasicBlockList());
     
@@ -1214,8 +1418,9 @@ bool ModuleLinker::run() {
            << DstM->getTargetTriple() << "'\n";
   }
 
-  // Append the module inline asm string.
-  if (!SrcM->getModuleInlineAsm().empty()) {
+  // Append the module inline asm string.  It defines whatever it defines,
+  // so none of it is imported.
+  if (!SrcM->getModuleInlineAsm().empty() && !FunctionsToImport) {
     if (DstM->getModuleInlineAsm().empty())
       DstM->setModuleInlineAsm(SrcM->getModuleInlineAsm());
     else
@@ -1285,57 +1490,44 @@ bool ModuleLinker::run() {
 
   // Remap all of the named MDNodes in Src into the DstM module. We do this
   // after linking GlobalValues so that MDNodes that reference GlobalValues
-  // are properly remapped.
-  linkNamedMDNodes();
+  // are properly remapped.  When importing, the destination keeps its own.
+  if (!FunctionsToImport) {
+    linkNamedMDNodes();
 
-  // Merge the module flags into the DstM module.
-  if (linkModuleFlagsMetadata())
-    return true;
+    // Merge the module flags into the DstM module.
+    if (linkModuleFlagsMetadata())
+      return true;
+  }
 
-  // Process vector of lazily linked in functions.
-  bool LinkedInAnyFunctions;
-  do {
-    LinkedInAnyFunctions = false;
-    
-    for(std::vector<Function*>::iterator I = LazilyLinkFunctions.begin(),
-        E = LazilyLinkFunctions.end(); I != E; ++I) {      
-      Function *SF = *I;
-      if (!SF)
-        continue;
+  // Process vector of lazily linked in functions.  Linking a body can add
+  // more functions to the end of the vector, so walk it by index; a function
+  // that can't be linked now never will be, so each is looked at once.
+  for (unsigned i = 0; i != LazilyLinkFunctions.size(); ++i) {
+    Function *SF = LazilyLinkFunctions[i];
 
-      Function *DF = cast<Function>(ValueMap[SF]);
-      if (SF->hasPrefixData()) {
-        // Link in the prefix data.
-        DF->setPrefixData(MapValue(SF->getPrefixData(),
-                                   ValueMap,
-                                   RF_None,
-                                   &TypeMap,
-                                   &ValMaterializer));
-      }
+    Function *DF = cast<Function>(ValueMap[SF]);
+    if (SF->hasPrefixData()) {
+      // Link in the prefix data.
+      DF->setPrefixData(MapValue(SF->getPrefixData(),
+                                 ValueMap,
+                                 RF_None,
+                                 &TypeMap,
+                                 &ValMaterializer));
+    }
 
-      // Materialize if necessary.
-      if (SF->isDeclaration()) {
-        if (!SF->isMaterializable())
-          continue;
-        if (SF->Materialize(&ErrorMsg))
-          return true;
-      }
-      
-      // Erase from vector *before* the function body is linked - linkFunctionBody could
-      // invalidate I.
-      LazilyLinkFunctions.erase(I);
+    // Materialize if necessary.
+    if (SF->isDeclaration()) {
+      if (!SF->isMaterializable())
+        continue;
+      if (SF->Materialize(&ErrorMsg))
+        return true;
+    }
 
-      // Link in function body.
-      linkFunctionBody(DF, SF);
-      SF->Dematerialize();
+    // Link in function body.
+    linkFunctionBody(DF, SF);
+    SF->Dematerialize();
+  }
 
-      // Set flag to indicate we may have more functions to lazily link in
-      // since we linked in a function.
-      LinkedInAnyFunctions = true;
-      break;
-    }
-  } while (LinkedInAnyFunctions);
-  
   // Now that all of the types from the source are used, resolve any structs
   // copied over to the dest that didn't exist there.
   TypeMap.linkDefinedTypeBodies();
@@ -1346,7 +1538,8 @@ bool ModuleLinker::run() {
 Linker::Linker(Module *M) : Composite(M) {
   TypeFinder StructTypes;
   StructTypes.run(*M, true);
-  IdentifiedStructTypes.insert(StructTypes.begin(), StructTypes.end());
+  for (unsigned i = 0, e = StructTypes.size(); i != e; ++i)
+    IdentifiedStructTypes.insert(StructTypes[i]);
 }
 
 Linker::~Linker() {
@@ -1367,6 +1560,18 @@ bool Linker::linkInModule(Module *Src, unsigned Mode, std::string *ErrorMsg) {
   return false;
 }
 
+bool Linker::importFunctions(Module *Src, const StringSet<> &FunctionsToImport,
+                             std::string *ErrorMsg) {
+  ModuleLinker TheLinker(Composite, IdentifiedStructTypes, Src,
+                         Linker::DestroySource, &FunctionsToImport);
+  if (TheLinker.run()) {
+    if (ErrorMsg)
+      *ErrorMsg = TheLinker.ErrorMsg;
+    return true;
+  }
+  return false;
+}
+
 //===----------------------------------------------------------------------===//
 // LinkModules entrypoint.
 //===----------------------------------------------------------------------===//
@@ -18,6 +18,7 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/MC/MCAsmBackend.h"
+#include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCAsmLayout.h"
 #include "llvm/MC/MCAssembler.h"
 #include "llvm/MC/MCContext.h"
@@ -28,9 +29,13 @@
 #include "llvm/MC/MCObjectWriter.h"
 #include "llvm/MC/MCSectionELF.h"
 #include "llvm/MC/MCValue.h"
+#include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
+#include <map>
 #include <vector>
 using namespace llvm;
 
@@ -38,6 +43,56 @@ using namespace llvm;
 #define DEBUG_TYPE "reloc-info"
 
 namespace {
+/// SectionContentsWriter - An object writer that only collects the bytes of
+/// a section, used to get at its contents before they are compressed.
+class SectionContentsWriter : public MCObjectWriter {
+public:
+  SectionContentsWriter(raw_ostream &OS, bool IsLittleEndian)
+    : MCObjectWriter(OS, IsLittleEndian) {}
+
+  void ExecutePostLayoutBinding(MCAssembler &Asm,
+                                const MCAsmLayout &Layout) LLVM_OVERRIDE {}
+  void RecordRelocation(const MCAssembler &Asm, const MCAsmLayout &Layout,
+                        const MCFragment *Fragment, const MCFixup &Fixup,
+                        MCValue Target, uint64_t &FixedValue) LLVM_OVERRIDE {
+    llvm_unreachable("Relocations are recorded by the real object writer");
+  }
+  void WriteObject(MCAssembler &Asm,
+                   const MCAsmLayout &Layout) LLVM_OVERRIDE {
+    llvm_unreachable("Only section contents can be written");
+  }
+};
+
+/// DebugSectionContents - The contents of a debug section that is a
+/// candidate for compression.
+struct DebugSectionContents {
+  const MCSectionData *SD;
+  std::string Data;
+  bool Compressed;
+};
+
+/// CompressDebugSection - Replace the contents of a debug section with the
+/// zlib-compressed form gold and GNU as use for .zdebug_* sections: the
+/// "ZLIB" magic and the uncompressed size as a 64-bit big-endian integer,
+/// followed by the compressed stream.  Sections that would not get smaller
+/// are left alone.
+struct CompressDebugSection {
+  void operator()(DebugSectionContents &C) const {
+    OwningPtr<MemoryBuffer> CompressedData;
+    if (zlib::compress(C.Data, CompressedData) != zlib::StatusOK ||
+        CompressedData->getBufferSize() + 12 >= C.Data.size())
+      return;
+
+    std::string Result("ZLIB");
+    uint64_t Size = C.Data.size();
+    for (int Shift = 56; Shift >= 0; Shift -= 8)
+      Result += char(Size >> Shift);
+    Result += CompressedData->getBuffer();
+    C.Data.swap(Result);
+    C.Compressed = true;
+  }
+};
+
 class ELFObjectWriter : public MCObjectWriter {
   protected:
 
@@ -50,10 +105,10 @@ class ELFObjectWriter : public MCObjectWriter {
                         bool isUsedInReloc);
     static bool IsELFMetaDataSection(const MCSectionData &SD);
     static uint64_t DataSectionSize(const MCSectionData &SD);
-    static uint64_t GetSectionFileSize(const MCAsmLayout &Layout,
-                                       const MCSectionData &SD);
-    static uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
-                                          const MCSectionData &SD);
+    uint64_t GetSectionFileSize(const MCAsmLayout &Layout,
+                                const MCSectionData &SD) const;
+    uint64_t GetSectionAddressSize(const MCAsmLayout &Layout,
+                                   const MCSectionData &SD) const;
 
     void WriteDataSectionData(MCAssembler &Asm,
                               const MCAsmLayout &Layout,
@@ -89,6 +144,12 @@ class ELFObjectWriter : public MCObjectWriter {
                    std::vector<ELFRelocationEntry> > Relocations;
     DenseMap<const MCSection*, uint64_t> SectionStringTableIndex;
 
+    /// The contents of the debug sections that are written compressed.
+    std::map<const MCSectionData*, std::string> CompressedSections;
+    /// The names of the sections that are written under a name other than
+    /// their own, i.e. the compressed debug sections and their relocations.
+    std::map<const MCSection*, std::string> RenamedSections;
+
     /// @}
     /// @name Symbol Table Data
     /// @{
@@ -278,6 +339,16 @@ class ELFObjectWriter : public MCObjectWriter {
                             RevGroupMapTy RevGroupMap,
                             unsigned NumRegularSections);
 
+    StringRef getOutputSectionName(const MCSectionELF &Section) const {
+      std::map<const MCSection*, std::string>::const_iterator I =
+        RenamedSections.find(&Section);
+      if (I == RenamedSections.end())
+        return Section.getSectionName();
+      return I->second;
+    }
+
+    void CompressDebugSections(MCAssembler &Asm, const MCAsmLayout &Layout);
+
     void ComputeIndexMap(MCAssembler &Asm,
                          SectionIndexMapTy &SectionIndexMap,
                          const RelMapTy &RelMap);
@@ -997,6 +1068,49 @@ void ELFObjectWriter::ComputeSymbolTable(MCAssembler &Asm,
     NeedsSymtabShndx = true;
 }
 
+void ELFObjectWriter::CompressDebugSections(MCAssembler &Asm,
+                                            const MCAsmLayout &Layout) {
+  if (!Asm.getContext().getAsmInfo()->compressDebugSections() ||
+      !zlib::isAvailable())
+    return;
+
+  std::vector<const MCSectionData*> DebugSections;
+  for (MCAssembler::const_iterator it = Asm.begin(),
+         ie = Asm.end(); it != ie; ++it) {
+    const MCSectionELF &Section =
+      static_cast<const MCSectionELF&>(it->getSection());
+    if (Section.getSectionName().startswith(".debug_") &&
+        !Section.isVirtualSection() && !(Section.getFlags() & ELF::SHF_ALLOC))
+      DebugSections.push_back(&*it);
+  }
+  if (DebugSections.empty())
+    return;
+
+  std::vector<DebugSectionContents> Contents(DebugSections.size());
+  for (unsigned i = 0, e = DebugSections.size(); i != e; ++i) {
+    Contents[i].SD = DebugSections[i];
+    Contents[i].Compressed = false;
+    raw_string_ostream OS(Contents[i].Data);
+    SectionContentsWriter Writer(OS, isLittleEndian());
+    Asm.writeSectionData(DebugSections[i], Layout, &Writer);
+  }
+
+  // The sections compress independently of each other, and compressing is
+  // by far the most expensive part.
+  parallel_for_each(Contents.begin(), Contents.end(), CompressDebugSection());
+
+  // Relocations keep applying to the uncompressed contents, which is what
+  // consumers of .zdebug_* sections expect.
+  for (unsigned i = 0, e = Contents.size(); i != e; ++i) {
+    if (!Contents[i].Compressed)
+      continue;
+    const MCSection &Section = Contents[i].SD->getSection();
+    StringRef Name = static_cast<const MCSectionELF&>(Section).getSectionName();
+    RenamedSections[&Section] = (".z" + Name.substr(1)).str();
+    CompressedSections[Contents[i].SD].swap(Contents[i].Data);
+  }
+}
+
 void ELFObjectWriter::CreateRelocationSections(MCAssembler &Asm,
                                                MCAsmLayout &Layout,
                                                RelMapTy &RelMap) {
@@ -1011,7 +1125,8 @@ void ELFObjectWriter::CreateRelocationSections(MCAssembler &Asm,
       static_cast<const MCSectionELF&>(SD.getSection());
 
     const StringRef SectionName = Section.getSectionName();
-    std::string RelaSectionName = hasRelocationAddend() ? ".rela" : ".rel";
+    const StringRef RelaPrefix = hasRelocationAddend() ? ".rela" : ".rel";
+    std::string RelaSectionName = RelaPrefix;
     RelaSectionName += SectionName;
 
     unsigned EntrySize;
@@ -1032,6 +1147,9 @@ void ELFObjectWriter::CreateRelocationSections(MCAssembler &Asm,
                         ELF::SHT_RELA : ELF::SHT_REL, Flags,
                         SectionKind::getReadOnly(),
                         EntrySize, Group);
+    StringRef OutputName = getOutputSectionName(Section);
+    if (OutputName != SectionName)
+      RenamedSections[RelaSection] = (RelaPrefix + OutputName).str();
     RelMap[&Section] = RelaSection;
     Asm.getOrCreateSectionData(*RelaSection);
   }
@@ -1122,10 +1240,17 @@ void ELFObjectWriter::WriteRelocationsFragment(const MCAssembler &Asm,
   }
 }
 
-static int compareBySuffix(const MCSectionELF *const *a,
-                           const MCSectionELF *const *b) {
-  const StringRef &NameA = (*a)->getSectionName();
-  const StringRef &NameB = (*b)->getSectionName();
+namespace {
+/// NamedSection - A section together with the name it is written under.
+struct NamedSection {
+  StringRef Name;
+  const MCSectionELF *Section;
+};
+}
+
+static int compareBySuffix(const NamedSection *a, const NamedSection *b) {
+  const StringRef &NameA = a->Name;
+  const StringRef &NameB = b->Name;
   const unsigned sizeA = NameA.size();
   const unsigned sizeB = NameB.size();
   const unsigned len = std::min(sizeA, sizeB);
@@ -1197,12 +1322,13 @@ void ELFObjectWriter::CreateMetadataSections(MCAssembler &Asm,
 
   F = new MCDataFragment(&ShstrtabSD);
 
-  std::vector<const MCSectionELF*> Sections;
+  std::vector<NamedSection> Sections;
   for (MCAssembler::const_iterator it = Asm.begin(),
          ie = Asm.end(); it != ie; ++it) {
     const MCSectionELF &Section =
       static_cast<const MCSectionELF&>(it->getSection());
-    Sections.push_back(&Section);
+    NamedSection NS = { getOutputSectionName(Section), &Section };
+    Sections.push_back(NS);
   }
   array_pod_sort(Sections.begin(), Sections.end(), compareBySuffix);
 
@@ -1214,11 +1340,11 @@ void ELFObjectWriter::CreateMetadataSections(MCAssembler &Asm,
   F->getContents().push_back('\x00');
 
   for (unsigned int I = 0, E = Sections.size(); I != E; ++I) {
-    const MCSectionELF &Section = *Sections[I];
+    const MCSectionELF &Section = *Sections[I].Section;
 
-    StringRef Name = Section.getSectionName();
+    StringRef Name = Sections[I].Name;
     if (I != 0) {
-      StringRef PreviousName = Sections[I - 1]->getSectionName();
+      StringRef PreviousName = Sections[I - 1].Name;
       if (PreviousName.endswith(Name)) {
         SectionStringTableIndex[&Section] = Index - Name.size() - 1;
         continue;
@@ -1402,16 +1528,24 @@ uint64_t ELFObjectWriter::DataSectionSize(const MCSectionData &SD) {
 }
 
 uint64_t ELFObjectWriter::GetSectionFileSize(const MCAsmLayout &Layout,
-                                             const MCSectionData &SD) {
+                                             const MCSectionData &SD) const {
   if (IsELFMetaDataSection(SD))
     return DataSectionSize(SD);
+  std::map<const MCSectionData*, std::string>::const_iterator I =
+    CompressedSections.find(&SD);
+  if (I != CompressedSections.end())
+    return I->second.size();
   return Layout.getSectionFileSize(&SD);
 }
 
 uint64_t ELFObjectWriter::GetSectionAddressSize(const MCAsmLayout &Layout,
-                                                const MCSectionData &SD) {
+                                                const MCSectionData &SD) const {
   if (IsELFMetaDataSection(SD))
     return DataSectionSize(SD);
+  std::map<const MCSectionData*, std::string>::const_iterator I =
+    CompressedSections.find(&SD);
+  if (I != CompressedSections.end())
+    return I->second.size();
   return Layout.getSectionAddressSize(&SD);
 }
 
@@ -1430,9 +1564,15 @@ void ELFObjectWriter::WriteDataSectionData(MCAssembler &Asm,
       assert(F.getKind() == MCFragment::FT_Data);
       WriteBytes(cast<MCDataFragment>(F).getContents());
     }
-  } else {
-    Asm.writeSectionData(&SD, Layout);
+    return;
   }
+
+  std::map<const MCSectionData*, std::string>::const_iterator I =
+    CompressedSections.find(&SD);
+  if (I != CompressedSections.end())
+    WriteBytes(I->second);
+  else
+    Asm.writeSectionData(&SD, Layout);
 }
 
 void ELFObjectWriter::WriteSectionHeader(MCAssembler &Asm,
@@ -1514,6 +1654,8 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
 
   unsigned NumUserSections = Asm.size();
 
+  CompressDebugSections(Asm, Layout);
+
   DenseMap<const MCSectionELF*, const MCSectionELF*> RelMap;
   CreateRelocationSections(Asm, const_cast<MCAsmLayout&>(Layout), RelMap);
 
@@ -1579,6 +1721,10 @@ void ELFObjectWriter::WriteObject(MCAssembler &Asm,
     FileOff += GetSectionFileSize(Layout, SD);
   }
 
+  // The size of the whole file is known now, so let the stream make room for
+  // it before the many small writes below.
+  OS.reserveExtraSpace(FileOff);
+
   // Write out the ELF header ...
   WriteHeader(Asm, SectionHeaderOffset, NumSections + 1);
 
@@ -49,6 +49,7 @@ private:
   raw_svector_ostream CommentStream;
 
   unsigned IsVerboseAsm : 1;
+  unsigned RestoreTracking : 1;
   unsigned ShowInst : 1;
   unsigned UseLoc : 1;
   unsigned UseCFI : 1;
@@ -73,13 +74,17 @@ public:
       : MCStreamer(Context, TargetStreamer), OS(os), MAI(Context.getAsmInfo()),
         InstPrinter(printer), Emitter(emitter), AsmBackend(asmbackend),
         CommentStream(CommentToEmit), IsVerboseAsm(isVerboseAsm),
-        ShowInst(showInst), UseLoc(useLoc), UseCFI(useCFI),
-        UseDwarfDirectory(useDwarfDirectory) {
+        RestoreTracking(false), ShowInst(showInst), UseLoc(useLoc),
+        UseCFI(useCFI), UseDwarfDirectory(useDwarfDirectory) {
     if (InstPrinter && IsVerboseAsm)
       InstPrinter->setCommentStream(CommentStream);
+    if (!IsVerboseAsm)
+      setUpFastOutput();
   }
   ~MCAsmStreamer() {}
 
+  void setUpFastOutput();
+
   inline void EmitEOL() {
     // If we don't have any comments, just emit a \n.
     if (!IsVerboseAsm) {
@@ -262,6 +267,22 @@ public:
 
 } // end anonymous namespace.
 
+/// The output buffer size used when assembly is written without comments.
+static const size_t FastOutputBufferSize = 64 * 1024;
+
+/// setUpFastOutput - Without comments nothing is ever aligned to a column, so
+/// stop the stream from scanning every character for line breaks and give it a
+/// large buffer, so that most of the output is passed on in big blocks.
+void MCAsmStreamer::setUpFastOutput() {
+  if (OS.isTrackingPosition()) {
+    OS.setPositionTracking(false);
+    RestoreTracking = true;
+  }
+  size_t BufferSize = OS.GetBufferSize();
+  if (BufferSize != 0 && BufferSize < FastOutputBufferSize)
+    OS.SetBufferSize(FastOutputBufferSize);
+}
+
 /// AddComment - Add a comment that can be emitted to the generated .s
 /// file if applicable as a QoI issue to make the output of the compiler
 /// more readable.  This only affects the MCAsmStreamer, and only when
@@ -1366,6 +1387,10 @@ void MCAsmStreamer::FinishImpl() {
 
   if (!UseCFI)
     EmitFrames(AsmBackend.get(), false);
+
+  // The stream may outlive us, so leave it as we found it.
+  if (RestoreTracking)
+    OS.setPositionTracking(true);
 }
 
 MCStreamer *llvm::createAsmStreamer(MCContext &Context,
@@ -51,6 +51,12 @@ STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(RelaxationChecks, "Number of relaxable fragments checked");
+STATISTIC(RelaxationChecksAvoided,
+          "Number of relaxation checks avoided because no fragment they "
+          "depend on changed");
+STATISTIC(FragmentMemory, "Number of bytes held by fragments before layout");
+STATISTIC(CompactedBytes, "Number of bytes released by compacting fragments");
 }
 }
 
@@ -230,6 +236,28 @@ MCEncodedFragmentWithFixups::~MCEncodedFragmentWithFixups() {
 
 /* *** */
 
+/// compactVector - Reallocate V to fit its elements if that releases a
+/// meaningful part of its storage.  Returns the number of bytes released.
+template <typename T, unsigned N>
+static size_t compactVector(SmallVector<T, N> &V) {
+  // A reallocation is never smaller than twice the inline storage, and below
+  // an eighth of slack the copy is not worth it.
+  size_t Size = V.size(), Capacity = V.capacity();
+  if (Size <= 2 * N || Capacity - Size <= Size / 8)
+    return 0;
+  SmallVector<T, N> Compacted(V.begin(), V.end());
+  if (Compacted.capacity() >= Capacity)
+    return 0;
+  V.swap(Compacted);
+  return (Capacity - V.capacity()) * sizeof(T);
+}
+
+void MCDataFragment::compact() {
+  stats::CompactedBytes += compactVector(Contents) + compactVector(Fixups);
+}
+
+/* *** */
+
 MCSectionData::MCSectionData() : Section(0) {}
 
 MCSectionData::MCSectionData(const MCSection &_Section, MCAssembler *A)
@@ -532,11 +560,9 @@ static void writeFragmentContents(const MCFragment &F, MCObjectWriter *OW) {
   OW->WriteBytes(EF.getContents());
 }
 
-/// \brief Write the fragment \p F to the output file.
+/// \brief Write the fragment \p F with the object writer \p OW.
 static void writeFragment(const MCAssembler &Asm, const MCAsmLayout &Layout,
-                          const MCFragment &F) {
-  MCObjectWriter *OW = &Asm.getWriter();
-
+                          const MCFragment &F, MCObjectWriter *OW) {
   // FIXME: Embed in fragments instead?
   uint64_t FragmentSize = Asm.computeFragmentSize(Layout, F);
 
@@ -684,6 +710,12 @@ static void writeFragment(const MCAssembler &Asm, const MCAsmLayout &Layout,
 
 void MCAssembler::writeSectionData(const MCSectionData *SD,
                                    const MCAsmLayout &Layout) const {
+  writeSectionData(SD, Layout, &getWriter());
+}
+
+void MCAssembler::writeSectionData(const MCSectionData *SD,
+                                   const MCAsmLayout &Layout,
+                                   MCObjectWriter *OW) const {
   // Ignore virtual sections.
   if (SD->getSection().isVirtualSection()) {
     assert(Layout.getSectionFileSize(SD) == 0 && "Invalid size for section!");
@@ -723,14 +755,14 @@ void MCAssembler::writeSectionData(const MCSectionData *SD,
     return;
   }
 
-  uint64_t Start = getWriter().getStream().tell();
+  uint64_t Start = OW->getStream().tell();
   (void)Start;
 
   for (MCSectionData::const_iterator it = SD->begin(), ie = SD->end();
        it != ie; ++it)
-    writeFragment(*this, Layout, *it);
+    writeFragment(*this, Layout, *it, OW);
 
-  assert(getWriter().getStream().tell() - Start ==
+  assert(OW->getStream().tell() - Start ==
          Layout.getSectionAddressSize(SD));
 }
 
@@ -770,19 +802,32 @@ void MCAssembler::Finish() {
   }
 
   // Assign layout order indices to sections and fragments.
+  uint64_t FragmentBytes = 0;
   for (unsigned i = 0, e = Layout.getSectionOrder().size(); i != e; ++i) {
     MCSectionData *SD = Layout.getSectionOrder()[i];
     SD->setLayoutOrder(i);
 
     unsigned FragmentIndex = 0;
+    std::vector<unsigned> &Counts = OffsetDependentCounts[SD];
+    Counts.push_back(0);
     for (MCSectionData::iterator iFrag = SD->begin(), iFragEnd = SD->end();
-         iFrag != iFragEnd; ++iFrag)
+         iFrag != iFragEnd; ++iFrag) {
       iFrag->setLayoutOrder(FragmentIndex++);
+      FragmentBytes += iFrag->getMemorySize();
+      bool DependsOnOffset = iFrag->getKind() == MCFragment::FT_Align ||
+                             iFrag->getKind() == MCFragment::FT_Org;
+      Counts.push_back(Counts.back() + DependsOnOffset);
+    }
   }
+  stats::FragmentMemory += FragmentBytes;
+  DEBUG(dbgs() << "assembler fragments hold " << FragmentBytes << " bytes\n");
 
   // Layout until everything fits.
   while (layoutOnce(Layout))
     continue;
+  SettledFragments.clear();
+  SizeChanges.clear();
+  OffsetDependentCounts.clear();
 
   DEBUG_WITH_TYPE("mc-dump", {
       llvm::errs() << "assembler backend - post-relaxation\n--\n";
@@ -886,6 +931,65 @@ bool MCAssembler::relaxInstruction(MCAsmLayout &Layout,
   return true;
 }
 
+void MCAssembler::noteSettledFragment(const MCAsmLayout &Layout,
+                                      const MCRelaxableFragment &F) {
+  // Bundle padding depends on the offset of every fragment.
+  if (isBundlingEnabled() || !getBackend().mayNeedRelaxation(F.getInst()))
+    return;
+
+  const MCSectionData *SD = F.getParent();
+  RelaxationSpan Span;
+  Span.First = Span.Last = F.getLayoutOrder();
+  for (MCRelaxableFragment::const_fixup_iterator it = F.fixup_begin(),
+       ie = F.fixup_end(); it != ie; ++it) {
+    // Only a PC-relative reference to a label in the same section is known
+    // not to move relative to the fragment.
+    unsigned Flags = Backend.getFixupKindInfo(it->getKind()).Flags;
+    if (!(Flags & MCFixupKindInfo::FKF_IsPCRel) ||
+        (Flags & MCFixupKindInfo::FKF_IsAlignedDownTo32Bits))
+      return;
+    MCValue Target;
+    if (!it->getValue()->EvaluateAsRelocatable(Target, Layout) ||
+        !Target.getSymA() || Target.getSymB())
+      return;
+    const MCSymbol &Sym = Target.getSymA()->getSymbol().AliasedSymbol();
+    if (Sym.isVariable() || !Sym.isDefined())
+      return;
+    const MCFragment *Frag = getSymbolData(Sym).getFragment();
+    if (!Frag || Frag->getParent() != SD)
+      return;
+    Span.First = std::min(Span.First, Frag->getLayoutOrder());
+    Span.Last = std::max(Span.Last, Frag->getLayoutOrder());
+  }
+  Span.NumChanges = SizeChanges[SD].size();
+  SettledFragments[&F] = Span;
+}
+
+bool MCAssembler::isSettledFragment(const MCRelaxableFragment &F) {
+  DenseMap<const MCFragment*, RelaxationSpan>::iterator It =
+    SettledFragments.find(&F);
+  if (It == SettledFragments.end())
+    return false;
+
+  RelaxationSpan &Span = It->second;
+  const MCSectionData *SD = F.getParent();
+  const std::vector<unsigned> &Changes = SizeChanges[SD];
+  const std::vector<unsigned> &Counts = OffsetDependentCounts[SD];
+  // A change before the span moves all of it, which only matters if some
+  // fragment in the span changes size as a result.
+  bool SpanDependsOnOffset = Counts[Span.Last + 1] != Counts[Span.First];
+  for (unsigned i = Span.NumChanges, e = Changes.size(); i != e; ++i) {
+    if (Changes[i] > Span.Last)
+      continue;
+    if (Changes[i] >= Span.First || SpanDependsOnOffset) {
+      SettledFragments.erase(It);
+      return false;
+    }
+  }
+  Span.NumChanges = Changes.size();
+  return true;
+}
+
 bool MCAssembler::relaxLEB(MCAsmLayout &Layout, MCLEBFragment &LF) {
   int64_t Value = 0;
   uint64_t OldSize = LF.getContents().size();
@@ -944,6 +1048,10 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
   // invalidated because their offset is going to change.
   MCFragment *FirstRelaxedFragment = NULL;
 
+  // The offsets used for the rest of this pass don't account for the
+  // fragments relaxed in it, so they only count as changes in the next pass.
+  SmallVector<unsigned, 8> Changed;
+
   // Attempt to relax all the fragments in the section.
   for (MCSectionData::iterator I = SD.begin(), IE = SD.end(); I != IE; ++I) {
     // Check if this is a fragment that needs relaxation.
@@ -951,11 +1059,20 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
     switch(I->getKind()) {
     default:
       break;
-    case MCFragment::FT_Relaxable:
+    case MCFragment::FT_Relaxable: {
       assert(!getRelaxAll() &&
              "Did not expect a MCRelaxableFragment in RelaxAll mode");
-      RelaxedFrag = relaxInstruction(Layout, *cast<MCRelaxableFragment>(I));
+      MCRelaxableFragment &RF = *cast<MCRelaxableFragment>(I);
+      if (isSettledFragment(RF)) {
+        ++stats::RelaxationChecksAvoided;
+        break;
+      }
+      ++stats::RelaxationChecks;
+      RelaxedFrag = relaxInstruction(Layout, RF);
+      if (!RelaxedFrag)
+        noteSettledFragment(Layout, RF);
       break;
+    }
     case MCFragment::FT_Dwarf:
       RelaxedFrag = relaxDwarfLineAddr(Layout,
                                        *cast<MCDwarfLineAddrFragment>(I));
@@ -969,10 +1086,15 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSectionData &SD) {
       RelaxedFrag = relaxLEB(Layout, *cast<MCLEBFragment>(I));
       break;
     }
-    if (RelaxedFrag && !FirstRelaxedFragment)
+    if (!RelaxedFrag)
+      continue;
+    Changed.push_back(I->getLayoutOrder());
+    if (!FirstRelaxedFragment)
       FirstRelaxedFragment = I;
   }
   if (FirstRelaxedFragment) {
+    std::vector<unsigned> &Changes = SizeChanges[&SD];
+    Changes.insert(Changes.end(), Changed.begin(), Changed.end());
     Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
     return true;
   }
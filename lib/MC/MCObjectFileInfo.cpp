@@ -511,6 +511,11 @@ void MCObjectFileInfo::InitELFMCObjectFileInfo(Triple T) {
   DwarfAddrSection =
     Ctx->getELFSection(".debug_addr", ELF::SHT_PROGBITS, 0,
                        SectionKind::getMetadata());
+
+  // The stack maps are read at run time, so they are allocated.
+  StackMapSection =
+    Ctx->getELFSection(".llvm_stackmaps", ELF::SHT_PROGBITS, ELF::SHF_ALLOC,
+                       SectionKind::getMetadata());
 }
 
 
@@ -694,6 +699,7 @@ void MCObjectFileInfo::InitMCObjectFileInfo(StringRef TT, Reloc::Model relocm,
   DwarfAccelObjCSection = 0;      // Used only by selected targets.
   DwarfAccelNamespaceSection = 0; // Used only by selected targets.
   DwarfAccelTypesSection = 0;     // Used only by selected targets.
+  StackMapSection = 0;            // Used only by selected targets.
 
   Triple T(TT);
   Triple::ArchType Arch = T.getArch();
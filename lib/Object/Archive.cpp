@@ -194,9 +194,12 @@ error_code Archive::Child::getAsBinary(OwningPtr<Binary> &Result) const {
 }
 
 Archive::Archive(MemoryBuffer *source, error_code &ec)
-  : Binary(Binary::ID_Archive, source), SymbolTable(end_children()) {
+  : Binary(Binary::ID_Archive, source), SymbolTable(end_children()),
+    SymbolMapBuilt(false) {
   // Check for sufficient magic.
   assert(source);
+  // Members and symbols are looked up in no particular order.
+  source->adviseAccess(MemoryBuffer::AP_Random);
   if (source->getBufferSize() < 8 ||
       StringRef(source->getBufferStart(), 8) != Magic) {
     ec = object_error::invalid_file_type;
@@ -427,22 +430,34 @@ Archive::symbol_iterator Archive::end_symbols() const {
     Symbol(this, symbol_count, 0));
 }
 
-Archive::child_iterator Archive::findSym(StringRef name) const {
+void Archive::buildSymbolMap() const {
+  SymbolMapBuilt = true;
   Archive::symbol_iterator bs = begin_symbols();
   Archive::symbol_iterator es = end_symbols();
-  Archive::child_iterator result;
-  
   StringRef symname;
-  for (; bs != es; ++bs) {
+  for (uint32_t i = 0; bs != es; ++bs, ++i) {
     if (bs->getName(symname))
-        return end_children();
-    if (symname == name) {
-      if (bs->getMember(result))
-        return end_children();
-      return result;
-    }
+      return;
+    // Like a search of the symbol table, find the first symbol of each name.
+    uint32_t StringIndex =
+        symname.data() - SymbolTable->getBuffer().begin();
+    SymbolMap.GetOrCreateValue(symname, std::make_pair(i, StringIndex));
   }
-  return end_children();
+}
+
+Archive::child_iterator Archive::findSym(StringRef name) const {
+  if (!SymbolMapBuilt)
+    buildSymbolMap();
+  StringMap<std::pair<uint32_t, uint32_t> >::const_iterator I =
+      SymbolMap.find(name);
+  if (I == SymbolMap.end())
+    return end_children();
+
+  Symbol sym(this, I->second.first, I->second.second);
+  Archive::child_iterator result;
+  if (sym.getMember(result))
+    return end_children();
+  return result;
 }
 
 bool Archive::hasSymbolTable() const {
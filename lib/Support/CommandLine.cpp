@@ -103,11 +103,15 @@ void cl::MarkOptionsChanged() {
 /// have statically constructed themselves.
 static Option *RegisteredOptionList = 0;
 
+/// NumRegisteredOptions - The length of RegisteredOptionList.
+static unsigned NumRegisteredOptions = 0;
+
 void Option::addArgument() {
   assert(NextRegistered == 0 && "argument multiply registered!");
 
   NextRegistered = RegisteredOptionList;
   RegisteredOptionList = this;
+  ++NumRegisteredOptions;
   MarkOptionsChanged();
 }
 
@@ -171,6 +175,41 @@ static void GetOptionInfo(SmallVectorImpl<Option*> &PositionalOpts,
   std::reverse(PositionalOpts.begin(), PositionalOpts.end());
 }
 
+namespace {
+/// OptionTable - The registered options, in the form GetOptionInfo returns
+/// them.
+struct OptionTable {
+  SmallVector<Option*, 4> PositionalOpts;
+  SmallVector<Option*, 4> SinkOpts;
+  StringMap<Option*> OptionsMap;
+
+  /// Size the map for the options registered so far, which is all of them
+  /// unless a plugin is loaded later, so that building it does not rehash.
+  OptionTable()
+    : OptionsMap(NumRegisteredOptions ?
+                 NextPowerOf2(NumRegisteredOptions * 4 / 3) : 0) {}
+};
+}
+
+static ManagedStatic<OptionTable> RegisteredOptionTable;
+
+/// getOptionTable - Return the table of the registered options.  It is built
+/// the first time it is needed, and only rebuilt when options are registered
+/// or change their names afterwards, so that the parser and the help printers
+/// share it instead of each scanning every option linked into the program.
+static OptionTable &getOptionTable() {
+  bool Stale = OptionListChanged || !RegisteredOptionTable.isConstructed();
+  OptionTable &T = *RegisteredOptionTable;
+  if (Stale) {
+    T.PositionalOpts.clear();
+    T.SinkOpts.clear();
+    T.OptionsMap.clear();
+    GetOptionInfo(T.PositionalOpts, T.SinkOpts, T.OptionsMap);
+    OptionListChanged = false;
+  }
+  return T;
+}
+
 
 /// LookupOption - Lookup the option specified by the specified option on the
 /// command line.  If there is a value specified (after an equal sign) return
@@ -715,10 +754,10 @@ void cl::ParseEnvironmentOptions(const char *progName, const char *envVar,
 void cl::ParseCommandLineOptions(int argc, const char * const *argv,
                                  const char *Overview) {
   // Process all registered options.
-  SmallVector<Option*, 4> PositionalOpts;
-  SmallVector<Option*, 4> SinkOpts;
-  StringMap<Option*> Opts;
-  GetOptionInfo(PositionalOpts, SinkOpts, Opts);
+  OptionTable &Table = getOptionTable();
+  SmallVectorImpl<Option*> &PositionalOpts = Table.PositionalOpts;
+  SmallVectorImpl<Option*> &SinkOpts = Table.SinkOpts;
+  const StringMap<Option*> &Opts = Table.OptionsMap;
 
   assert((!Opts.empty() || !PositionalOpts.empty()) &&
          "No options specified!");
@@ -807,13 +846,8 @@ void cl::ParseCommandLineOptions(int argc, const char * const *argv,
     // If the option list changed, this means that some command line
     // option has just been registered or deregistered.  This can occur in
     // response to things like -load, etc.  If this happens, rescan the options.
-    if (OptionListChanged) {
-      PositionalOpts.clear();
-      SinkOpts.clear();
-      Opts.clear();
-      GetOptionInfo(PositionalOpts, SinkOpts, Opts);
-      OptionListChanged = false;
-    }
+    if (OptionListChanged)
+      getOptionTable();
 
     // Check to see if this is a positional argument.  This argument is
     // considered to be positional if it doesn't start with '-', if it is "-"
@@ -992,7 +1026,7 @@ void cl::ParseCommandLineOptions(int argc, const char * const *argv,
   }
 
   // Loop over args and make sure all required args are specified!
-  for (StringMap<Option*>::iterator I = Opts.begin(),
+  for (StringMap<Option*>::const_iterator I = Opts.begin(),
          E = Opts.end(); I != E; ++I) {
     switch (I->second->getNumOccurrencesFlag()) {
     case Required:
@@ -1016,10 +1050,9 @@ void cl::ParseCommandLineOptions(int argc, const char * const *argv,
         dbgs() << '\n';
        );
 
-  // Free all of the memory allocated to the map.  Command line options may only
-  // be processed once!
-  Opts.clear();
-  PositionalOpts.clear();
+  // The option table is kept for the help and option value printers, which
+  // may still run after this.  Command line options may only be processed
+  // once!
   MoreHelp->clear();
 
   // If we had an error processing our arguments, don't let the program execute
@@ -1428,13 +1461,11 @@ public:
     if (Value == false) return;
 
     // Get all the options.
-    SmallVector<Option*, 4> PositionalOpts;
-    SmallVector<Option*, 4> SinkOpts;
-    StringMap<Option*> OptMap;
-    GetOptionInfo(PositionalOpts, SinkOpts, OptMap);
+    OptionTable &Table = getOptionTable();
+    SmallVectorImpl<Option*> &PositionalOpts = Table.PositionalOpts;
 
     StrOptionPairVector Opts;
-    sortOpts(OptMap, Opts, ShowHidden);
+    sortOpts(Table.OptionsMap, Opts, ShowHidden);
 
     if (ProgramOverview)
       outs() << "OVERVIEW: " << ProgramOverview << "\n";
@@ -1657,13 +1688,8 @@ void cl::PrintOptionValues() {
   if (!PrintOptions && !PrintAllOptions) return;
 
   // Get all the options.
-  SmallVector<Option*, 4> PositionalOpts;
-  SmallVector<Option*, 4> SinkOpts;
-  StringMap<Option*> OptMap;
-  GetOptionInfo(PositionalOpts, SinkOpts, OptMap);
-
   SmallVector<std::pair<const char *, Option*>, 128> Opts;
-  sortOpts(OptMap, Opts, /*ShowHidden*/true);
+  sortOpts(getOptionTable().OptionsMap, Opts, /*ShowHidden*/true);
 
   // Compute the maximum argument length...
   size_t MaxArgLen = 0;
@@ -1775,10 +1801,9 @@ void cl::AddExtraVersionPrinter(void (*func)()) {
 
 void cl::getRegisteredOptions(StringMap<Option*> &Map)
 {
-  // Get all the options.
-  SmallVector<Option*, 4> PositionalOpts; //NOT USED
-  SmallVector<Option*, 4> SinkOpts;  //NOT USED
   assert(Map.size() == 0 && "StringMap must be empty");
-  GetOptionInfo(PositionalOpts, SinkOpts, Map);
-  return;
+  const StringMap<Option*> &OptionsMap = getOptionTable().OptionsMap;
+  for (StringMap<Option*>::const_iterator I = OptionsMap.begin(),
+         E = OptionsMap.end(); I != E; ++I)
+    Map[I->getKey()] = I->second;
 }
@@ -74,7 +74,8 @@ formatted_raw_ostream &formatted_raw_ostream::PadToColumn(unsigned NewCol) {
 
 void formatted_raw_ostream::write_impl(const char *Ptr, size_t Size) {
   // Figure out what's in the buffer and add it to the column count.
-  ComputePosition(Ptr, Size);
+  if (TrackPosition)
+    ComputePosition(Ptr, Size);
 
   // Write the data to the underlying stream (which is unbuffered, so
   // the data will be immediately written out).
@@ -16,6 +16,7 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Config/config.h"
 #include "llvm/Support/Errno.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Path.h"
@@ -30,6 +31,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <fcntl.h>
 #include <unistd.h>
 #else
 #include <io.h>
@@ -166,10 +168,11 @@ MemoryBuffer *MemoryBuffer::getNewMemBuffer(size_t Size, StringRef BufferName) {
 /// returns an empty buffer.
 error_code MemoryBuffer::getFileOrSTDIN(StringRef Filename,
                                         OwningPtr<MemoryBuffer> &result,
-                                        int64_t FileSize) {
+                                        int64_t FileSize,
+                                        const OpenOptions &Options) {
   if (Filename == "-")
     return getSTDIN(result);
-  return getFile(Filename, result, FileSize);
+  return getFile(Filename, result, FileSize, true, Options);
 }
 
 //===----------------------------------------------------------------------===//
@@ -195,17 +198,58 @@ class MemoryBufferMMapFile : public MemoryBuffer {
     return MFR.const_data() + (Offset - getLegalMapOffset(Offset));
   }
 
+  static sys::fs::mapped_file_region::advice getAdvice(AccessPattern AP) {
+    switch (AP) {
+    case AP_Normal:     return sys::fs::mapped_file_region::advise_normal;
+    case AP_Sequential: return sys::fs::mapped_file_region::advise_sequential;
+    case AP_Random:     return sys::fs::mapped_file_region::advise_random;
+    case AP_WillNeed:   return sys::fs::mapped_file_region::advise_willneed;
+    }
+    llvm_unreachable("Unknown access pattern");
+  }
+
+  void advise(sys::fs::mapped_file_region::advice A, StringRef Range) {
+    // Failing to advise is harmless.
+    (void)MFR.advise(A, Range.data() - MFR.const_data(), Range.size());
+  }
+
 public:
   MemoryBufferMMapFile(bool RequiresNullTerminator, int FD, uint64_t Len,
-                       uint64_t Offset, error_code EC)
+                       uint64_t Offset, const OpenOptions &Options,
+                       error_code &EC)
       : MFR(FD, false, sys::fs::mapped_file_region::readonly,
             getLegalMapSize(Len, Offset), getLegalMapOffset(Offset), EC) {
-    if (!EC) {
-      const char *Start = getStart(Len, Offset);
-      init(Start, Start + Len, RequiresNullTerminator);
+    if (EC)
+      return;
+    const char *Start = getStart(Len, Offset);
+    init(Start, Start + Len, RequiresNullTerminator);
+
+    StringRef Buffer = getBuffer();
+    if (Options.HugePages)
+      advise(sys::fs::mapped_file_region::advise_hugepage, Buffer);
+    if (Options.Access != AP_Normal)
+      advise(getAdvice(Options.Access), Buffer);
+    if (Options.Prefetch || Options.Populate)
+      advise(sys::fs::mapped_file_region::advise_willneed, Buffer);
+    if (Options.Populate) {
+      // Touch every page while the read-ahead started above is in flight.
+      static const int PageSize = sys::process::get_self()->page_size();
+      volatile char Sink = 0;
+      for (uint64_t I = 0; I < Len; I += PageSize)
+        Sink ^= Start[I];
+      (void)Sink;
     }
   }
 
+  virtual void adviseAccess(AccessPattern AP,
+                            StringRef Range) const LLVM_OVERRIDE {
+    if (Range.empty())
+      Range = getBuffer();
+    if (Range.data() < getBufferStart() || Range.end() > getBufferEnd())
+      return;
+    const_cast<MemoryBufferMMapFile *>(this)->advise(getAdvice(AP), Range);
+  }
+
   virtual const char *getBufferIdentifier() const LLVM_OVERRIDE {
     // The name is stored after the class itself.
     return reinterpret_cast<const char *>(this + 1);
@@ -240,34 +284,38 @@ static error_code getMemoryBufferForStream(int FD,
 
 static error_code getFileAux(const char *Filename,
                              OwningPtr<MemoryBuffer> &result, int64_t FileSize,
-                             bool RequiresNullTerminator);
+                             bool RequiresNullTerminator,
+                             const MemoryBuffer::OpenOptions &Options);
 
 error_code MemoryBuffer::getFile(Twine Filename,
                                  OwningPtr<MemoryBuffer> &result,
                                  int64_t FileSize,
-                                 bool RequiresNullTerminator) {
+                                 bool RequiresNullTerminator,
+                                 const OpenOptions &Options) {
   // Ensure the path is null terminated.
   SmallString<256> PathBuf;
   StringRef NullTerminatedName = Filename.toNullTerminatedStringRef(PathBuf);
   return getFileAux(NullTerminatedName.data(), result, FileSize,
-                    RequiresNullTerminator);
+                    RequiresNullTerminator, Options);
 }
 
 static error_code getOpenFileImpl(int FD, const char *Filename,
                                   OwningPtr<MemoryBuffer> &Result,
                                   uint64_t FileSize, uint64_t MapSize,
-                                  int64_t Offset, bool RequiresNullTerminator);
+                                  int64_t Offset, bool RequiresNullTerminator,
+                                  const MemoryBuffer::OpenOptions &Options);
 
 static error_code getFileAux(const char *Filename,
                              OwningPtr<MemoryBuffer> &result, int64_t FileSize,
-                             bool RequiresNullTerminator) {
+                             bool RequiresNullTerminator,
+                             const MemoryBuffer::OpenOptions &Options) {
   int FD;
   error_code EC = sys::fs::openFileForRead(Filename, FD);
   if (EC)
     return EC;
 
   error_code ret = getOpenFileImpl(FD, Filename, result, FileSize, FileSize, 0,
-                                   RequiresNullTerminator);
+                                   RequiresNullTerminator, Options);
   close(FD);
   return ret;
 }
@@ -277,10 +325,13 @@ static bool shouldUseMmap(int FD,
                           size_t MapSize,
                           off_t Offset,
                           bool RequiresNullTerminator,
-                          int PageSize) {
+                          int PageSize,
+                          uint64_t MinMapSize) {
   // We don't use mmap for small files because this can severely fragment our
   // address space.
-  if (MapSize < 4 * 4096 || MapSize < (unsigned)PageSize)
+  if (MinMapSize == 0)
+    MinMapSize = 4 * 4096;
+  if (MapSize < MinMapSize || MapSize < (unsigned)PageSize)
     return false;
 
   if (!RequiresNullTerminator)
@@ -326,7 +377,8 @@ static bool shouldUseMmap(int FD,
 static error_code getOpenFileImpl(int FD, const char *Filename,
                                   OwningPtr<MemoryBuffer> &result,
                                   uint64_t FileSize, uint64_t MapSize,
-                                  int64_t Offset, bool RequiresNullTerminator) {
+                                  int64_t Offset, bool RequiresNullTerminator,
+                                  const MemoryBuffer::OpenOptions &Options) {
   static int PageSize = sys::process::get_self()->page_size();
 
   // Default is to map the full file.
@@ -353,10 +405,10 @@ static error_code getOpenFileImpl(int FD, const char *Filename,
   }
 
   if (shouldUseMmap(FD, FileSize, MapSize, Offset, RequiresNullTerminator,
-                    PageSize)) {
+                    PageSize, Options.MinMapSize)) {
     error_code EC;
     result.reset(new (NamedBufferAlloc(Filename)) MemoryBufferMMapFile(
-        RequiresNullTerminator, FD, MapSize, Offset, EC));
+        RequiresNullTerminator, FD, MapSize, Offset, Options, EC));
     if (!EC)
       return error_code::success();
   }
@@ -372,6 +424,11 @@ static error_code getOpenFileImpl(int FD, const char *Filename,
   char *BufPtr = const_cast<char*>(SB->getBufferStart());
 
   size_t BytesLeft = MapSize;
+#ifdef POSIX_FADV_SEQUENTIAL
+  // We read the whole range in order, so let the kernel read ahead further.
+  if (Options.Access == MemoryBuffer::AP_Sequential || Options.Prefetch)
+    (void)::posix_fadvise(FD, Offset, MapSize, POSIX_FADV_SEQUENTIAL);
+#endif
 #ifndef HAVE_PREAD
   if (lseek(FD, Offset, SEEK_SET) == -1)
     return error_code(errno, posix_category());
@@ -406,15 +463,18 @@ static error_code getOpenFileImpl(int FD, const char *Filename,
 error_code MemoryBuffer::getOpenFile(int FD, const char *Filename,
                                      OwningPtr<MemoryBuffer> &Result,
                                      uint64_t FileSize,
-                                     bool RequiresNullTerminator) {
+                                     bool RequiresNullTerminator,
+                                     const OpenOptions &Options) {
   return getOpenFileImpl(FD, Filename, Result, FileSize, FileSize, 0,
-                         RequiresNullTerminator);
+                         RequiresNullTerminator, Options);
 }
 
 error_code MemoryBuffer::getOpenFileSlice(int FD, const char *Filename,
                                           OwningPtr<MemoryBuffer> &Result,
-                                          uint64_t MapSize, int64_t Offset) {
-  return getOpenFileImpl(FD, Filename, Result, -1, MapSize, Offset, false);
+                                          uint64_t MapSize, int64_t Offset,
+                                          const OpenOptions &Options) {
+  return getOpenFileImpl(FD, Filename, Result, -1, MapSize, Offset, false,
+                         Options);
 }
 
 //===----------------------------------------------------------------------===//
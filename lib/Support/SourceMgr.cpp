@@ -21,30 +21,16 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
+#include <algorithm>
+#include <cstring>
 using namespace llvm;
 
 static const size_t TabStop = 8;
 
-namespace {
-  struct LineNoCacheTy {
-    int LastQueryBufferID;
-    const char *LastQuery;
-    unsigned LineNoOfQuery;
-  };
-}
-
-static LineNoCacheTy *getCache(void *Ptr) {
-  return (LineNoCacheTy*)Ptr;
-}
-
-
 SourceMgr::~SourceMgr() {
-  // Delete the line # cache if allocated.
-  if (LineNoCacheTy *Cache = getCache(LineNoCache))
-    delete Cache;
-
   while (!Buffers.empty()) {
     delete Buffers.back().Buffer;
+    delete Buffers.back().LineOffsets;
     Buffers.pop_back();
   }
 }
@@ -83,50 +69,54 @@ int SourceMgr::FindBufferContainingLoc(SMLoc Loc) const {
   return -1;
 }
 
+/// getLineOffsets - Return the offsets of the newlines in the buffer, finding
+/// them the first time they are asked for.
+static const std::vector<size_t> &
+getLineOffsets(const MemoryBuffer *Buff, std::vector<size_t> *&LineOffsets) {
+  if (LineOffsets)
+    return *LineOffsets;
+
+  LineOffsets = new std::vector<size_t>();
+  const char *BufStart = Buff->getBufferStart();
+  const char *BufEnd = Buff->getBufferEnd();
+  for (const char *Ptr = BufStart;
+       (Ptr = (const char*)memchr(Ptr, '\n', BufEnd - Ptr)); ++Ptr)
+    LineOffsets->push_back(Ptr - BufStart);
+  return *LineOffsets;
+}
+
 /// getLineAndColumn - Find the line and column number for the specified
-/// location in the specified file.  This is not a fast method.
+/// location in the specified file.
 std::pair<unsigned, unsigned>
 SourceMgr::getLineAndColumn(SMLoc Loc, int BufferID) const {
   if (BufferID == -1) BufferID = FindBufferContainingLoc(Loc);
   assert(BufferID != -1 && "Invalid Location!");
 
-  MemoryBuffer *Buff = getBufferInfo(BufferID).Buffer;
+  const SrcBuffer &SB = getBufferInfo(BufferID);
+  const char *BufStart = SB.Buffer->getBufferStart();
+  const char *Ptr = Loc.getPointer();
+  size_t Offset = Ptr - BufStart;
 
-  // Count the number of \n's between the start of the file and the specified
+  // The line number is one more than the number of newlines before the
   // location.
-  unsigned LineNo = 1;
-
-  const char *BufStart = Buff->getBufferStart();
-  const char *Ptr = BufStart;
-
-  // If we have a line number cache, and if the query is to a later point in the
-  // same file, start searching from the last query location.  This optimizes
-  // for the case when multiple diagnostics come out of one file in order.
-  if (LineNoCacheTy *Cache = getCache(LineNoCache))
-    if (Cache->LastQueryBufferID == BufferID &&
-        Cache->LastQuery <= Loc.getPointer()) {
-      Ptr = Cache->LastQuery;
-      LineNo = Cache->LineNoOfQuery;
-    }
-
-  // Scan for the location being queried, keeping track of the number of lines
-  // we see.
-  for (; SMLoc::getFromPointer(Ptr) != Loc; ++Ptr)
-    if (*Ptr == '\n') ++LineNo;
-
-  // Allocate the line number cache if it doesn't exist.
-  if (LineNoCache == 0)
-    LineNoCache = new LineNoCacheTy();
-
-  // Update the line # cache.
-  LineNoCacheTy &Cache = *getCache(LineNoCache);
-  Cache.LastQueryBufferID = BufferID;
-  Cache.LastQuery = Ptr;
-  Cache.LineNoOfQuery = LineNo;
-  
-  size_t NewlineOffs = StringRef(BufStart, Ptr-BufStart).find_last_of("\n\r");
-  if (NewlineOffs == StringRef::npos) NewlineOffs = ~(size_t)0;
-  return std::make_pair(LineNo, Ptr-BufStart-NewlineOffs);
+  const std::vector<size_t> &Offsets = getLineOffsets(SB.Buffer,
+                                                      SB.LineOffsets);
+  std::vector<size_t>::const_iterator I =
+    std::lower_bound(Offsets.begin(), Offsets.end(), Offset);
+  unsigned LineNo = 1 + (I - Offsets.begin());
+
+  // The column counts from the last newline or carriage return before the
+  // location; a carriage return can only be on the location's own line.
+  size_t LineStart = I == Offsets.begin() ? 0 : *(I - 1) + 1;
+  size_t NewlineOffs =
+    StringRef(BufStart + LineStart, Offset - LineStart).find_last_of('\r');
+  if (NewlineOffs != StringRef::npos)
+    NewlineOffs += LineStart;
+  else if (LineStart != 0)
+    NewlineOffs = LineStart - 1;
+  else
+    NewlineOffs = ~(size_t)0;
+  return std::make_pair(LineNo, Offset-NewlineOffs);
 }
 
 void SourceMgr::PrintIncludeStack(SMLoc IncludeLoc, raw_ostream &OS) const {
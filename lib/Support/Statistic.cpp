@@ -28,6 +28,7 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstring>
@@ -46,34 +47,89 @@ Enabled(
 
 
 namespace {
+/// StatisticShard - The amounts one thread added to the statistics, indexed
+/// by Statistic::Index.  Only that thread writes to the shard, so its updates
+/// need no atomic operations; other threads just sum the shards up.  The
+/// counters live in pages that are never reallocated, so a reader never sees
+/// a stale copy.
+class StatisticShard {
+  static const unsigned PageSize = 256;
+  static const unsigned MaxPages = 64;
+  volatile sys::cas_flag *volatile Pages[MaxPages];
+
+public:
+  static const unsigned MaxStatistics = PageSize * MaxPages;
+
+  StatisticShard() {
+    for (unsigned i = 0; i != MaxPages; ++i)
+      Pages[i] = 0;
+  }
+
+  ~StatisticShard() {
+    for (unsigned i = 0; i != MaxPages; ++i)
+      delete[] const_cast<sys::cas_flag *>(Pages[i]);
+  }
+
+  void add(unsigned Index, sys::cas_flag Delta) {
+    volatile sys::cas_flag *Page = Pages[Index / PageSize];
+    if (!Page) {
+      Page = new sys::cas_flag[PageSize]();
+      // Publish the zeroed page before the pointer to it.
+      sys::MemoryFence();
+      Pages[Index / PageSize] = Page;
+    }
+    Page[Index % PageSize] += Delta;
+  }
+
+  sys::cas_flag get(unsigned Index) const {
+    volatile sys::cas_flag *Page = Pages[Index / PageSize];
+    return Page ? Page[Index % PageSize] : 0;
+  }
+
+  void clear(unsigned Index) {
+    if (volatile sys::cas_flag *Page = Pages[Index / PageSize])
+      Page[Index % PageSize] = 0;
+  }
+};
+
 /// StatisticInfo - This class is used in a ManagedStatic so that it is created
 /// on demand (when the first statistic is bumped) and destroyed only when
 /// llvm_shutdown is called.  We print statistics from the destructor.
 class StatisticInfo {
-  std::vector<const Statistic*> Stats;
+  std::vector<Statistic*> Stats;
+  std::vector<StatisticShard*> Shards;
+  friend class llvm::Statistic;
   friend void llvm::PrintStatistics();
   friend void llvm::PrintStatistics(raw_ostream &OS);
+  friend std::vector<std::pair<const Statistic *, unsigned> >
+  llvm::GetStatistics();
+  friend void llvm::ResetStatistics();
 public:
   ~StatisticInfo();
 
-  void addStatistic(const Statistic *S) {
+  void addStatistic(Statistic *S) {
     Stats.push_back(S);
   }
 };
 }
 
 static ManagedStatic<StatisticInfo> StatInfo;
-static ManagedStatic<sys::SmartMutex<true> > StatLock;
+// Statistics are often bumped from worker threads without
+// llvm_start_multithreaded having been called, so always lock.
+static ManagedStatic<sys::Mutex> StatLock;
+/// The shard of the current thread, created by its first update.
+static ManagedStatic<sys::ThreadLocal<const StatisticShard> > CurrentShard;
 
 /// RegisterStatistic - The first time a statistic is bumped, this method is
 /// called.
 void Statistic::RegisterStatistic() {
-  // If stats are enabled, inform StatInfo that this statistic should be
-  // printed.
-  sys::SmartScopedLock<true> Writer(*StatLock);
+  // Give the statistic its slot in the shards and remember it for
+  // PrintStatistics and GetStatistics.
+  sys::ScopedLock Writer(*StatLock);
   if (!Initialized) {
-    if (Enabled)
-      StatInfo->addStatistic(this);
+    Index = StatInfo->Stats.size();
+    StatInfo->addStatistic(this);
+    (void)*CurrentShard;
 
     TsanHappensBefore(this);
     sys::MemoryFence();
@@ -84,6 +140,43 @@ void Statistic::RegisterStatistic() {
   }
 }
 
+void Statistic::add(sys::cas_flag Delta) {
+  init();
+  if (Index >= StatisticShard::MaxStatistics) {
+    sys::AtomicAdd(&Value, Delta);
+    return;
+  }
+
+  StatisticShard *Shard = const_cast<StatisticShard *>(CurrentShard->get());
+  if (!Shard) {
+    Shard = new StatisticShard();
+    sys::ScopedLock Writer(*StatLock);
+    StatInfo->Shards.push_back(Shard);
+    CurrentShard->set(Shard);
+  }
+  Shard->add(Index, Delta);
+}
+
+sys::cas_flag Statistic::getValue() const {
+  if (!Initialized)
+    return Value;
+
+  sys::ScopedLock Reader(*StatLock);
+  sys::cas_flag Sum = Value;
+  if (Index < StatisticShard::MaxStatistics)
+    for (size_t i = 0, e = StatInfo->Shards.size(); i != e; ++i)
+      Sum += StatInfo->Shards[i]->get(Index);
+  return Sum;
+}
+
+void Statistic::setValue(sys::cas_flag Val) {
+  sys::ScopedLock Writer(*StatLock);
+  if (Index < StatisticShard::MaxStatistics)
+    for (size_t i = 0, e = StatInfo->Shards.size(); i != e; ++i)
+      StatInfo->Shards[i]->clear(Index);
+  Value = Val;
+}
+
 namespace {
 
 struct NameCompare {
@@ -101,6 +194,8 @@ struct NameCompare {
 // Print information when destroyed, iff command line option is specified.
 StatisticInfo::~StatisticInfo() {
   llvm::PrintStatistics();
+  for (size_t i = 0, e = Shards.size(); i != e; ++i)
+    delete Shards[i];
 }
 
 void llvm::EnableStatistics() {
@@ -112,6 +207,7 @@ bool llvm::AreStatisticsEnabled() {
 }
 
 void llvm::PrintStatistics(raw_ostream &OS) {
+  sys::ScopedLock Reader(*StatLock);
   StatisticInfo &Stats = *StatInfo;
 
   // Figure out how long the biggest Value and Name fields are.
@@ -148,7 +244,7 @@ void llvm::PrintStatistics() {
   StatisticInfo &Stats = *StatInfo;
 
   // Statistics not enabled?
-  if (Stats.Stats.empty()) return;
+  if (!Enabled || Stats.Stats.empty()) return;
 
   // Get the stream to write to.
   raw_ostream &OutStream = *CreateInfoOutputFile();
@@ -168,3 +264,21 @@ void llvm::PrintStatistics() {
   }
 #endif
 }
+
+std::vector<std::pair<const Statistic *, unsigned> > llvm::GetStatistics() {
+  sys::ScopedLock Reader(*StatLock);
+  std::vector<Statistic*> Stats = StatInfo->Stats;
+  std::stable_sort(Stats.begin(), Stats.end(), NameCompare());
+
+  std::vector<std::pair<const Statistic *, unsigned> > Result;
+  for (size_t i = 0, e = Stats.size(); i != e; ++i)
+    Result.push_back(std::make_pair(Stats[i], Stats[i]->getValue()));
+  return Result;
+}
+
+void llvm::ResetStatistics() {
+  sys::ScopedLock Writer(*StatLock);
+  StatisticInfo &Stats = *StatInfo;
+  for (size_t i = 0, e = Stats.Stats.size(); i != e; ++i)
+    Stats.Stats[i]->setValue(0);
+}
@@ -10,6 +10,7 @@
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cassert>
@@ -114,14 +115,15 @@ void TargetRegistry::RegisterTarget(Target &T,
   if (T.Name)
     return;
          
-  // Add to the list of targets.
-  T.Next = FirstTarget;
-  FirstTarget = &T;
-
   T.Name = Name;
   T.ShortDesc = ShortDesc;
   T.TripleMatchQualityFn = TQualityFn;
   T.HasJIT = HasJIT;
+
+  // Add to the list of targets, once the target is complete.
+  T.Next = FirstTarget;
+  sys::MemoryFence();
+  FirstTarget = &T;
 }
 
 const Target *TargetRegistry::getClosestTargetForJIT(std::string &Error) {
@@ -0,0 +1,321 @@
+//===-- ThreadPool.cpp - A pool of worker threads -------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements ThreadPool and TaskGroup.
+//
+// All the queues of a pool are guarded by a single lock.  The tasks run
+// without it, so the lock is only contended when tasks are very short, and
+// the callers of the parallel algorithms make their tasks coarse enough for
+// that not to matter.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/ThreadLocal.h"
+#include "llvm/Support/Threading.h"
+#include <cassert>
+#include <deque>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#if defined(HAVE_UNISTD_H)
+#include <unistd.h>
+#endif
+#elif LLVM_ENABLE_THREADS != 0 && defined(LLVM_ON_WIN32)
+#include "Windows/Windows.h"
+#endif
+
+using namespace llvm;
+
+namespace {
+/// PoolLock - The lock of a pool, together with the condition its threads
+/// wait on for new tasks or for tasks to finish.
+class PoolLock {
+public:
+  PoolLock();
+  ~PoolLock();
+  void lock();
+  void unlock();
+  /// Release the lock until notifyAll is called, then reacquire it.  May
+  /// return spuriously.
+  void wait();
+  /// Wake up every waiting thread.  Must be called with the lock held.
+  void notifyAll();
+
+private:
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+  pthread_mutex_t Mutex;
+  pthread_cond_t Cond;
+#elif LLVM_ENABLE_THREADS != 0 && defined(LLVM_ON_WIN32)
+  // Condition variables only exist since Windows Vista, so waiters block on
+  // a semaphore that notifyAll releases once per waiter.
+  CRITICAL_SECTION Section;
+  HANDLE Semaphore;
+  unsigned NumWaiters;
+#endif
+};
+}
+
+#if LLVM_ENABLE_THREADS != 0 && defined(HAVE_PTHREAD_H)
+PoolLock::PoolLock() {
+  ::pthread_mutex_init(&Mutex, 0);
+  ::pthread_cond_init(&Cond, 0);
+}
+
+PoolLock::~PoolLock() {
+  ::pthread_cond_destroy(&Cond);
+  ::pthread_mutex_destroy(&Mutex);
+}
+
+void PoolLock::lock() { ::pthread_mutex_lock(&Mutex); }
+void PoolLock::unlock() { ::pthread_mutex_unlock(&Mutex); }
+void PoolLock::wait() { ::pthread_cond_wait(&Cond, &Mutex); }
+void PoolLock::notifyAll() { ::pthread_cond_broadcast(&Cond); }
+
+unsigned ThreadPool::getHardwareConcurrency() {
+#if defined(HAVE_UNISTD_H) && defined(_SC_NPROCESSORS_ONLN)
+  long N = ::sysconf(_SC_NPROCESSORS_ONLN);
+  if (N > 0)
+    return N;
+#endif
+  return 1;
+}
+#elif LLVM_ENABLE_THREADS != 0 && defined(LLVM_ON_WIN32)
+PoolLock::PoolLock() : NumWaiters(0) {
+  ::InitializeCriticalSection(&Section);
+  Semaphore = ::CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+}
+
+PoolLock::~PoolLock() {
+  ::CloseHandle(Semaphore);
+  ::DeleteCriticalSection(&Section);
+}
+
+void PoolLock::lock() { ::EnterCriticalSection(&Section); }
+void PoolLock::unlock() { ::LeaveCriticalSection(&Section); }
+
+void PoolLock::wait() {
+  ++NumWaiters;
+  ::LeaveCriticalSection(&Section);
+  // A thread that starts waiting right after a notification can consume the
+  // release meant for an earlier waiter; the timeout bounds how long the
+  // latter sleeps before it looks at the queues again.
+  (void)::WaitForSingleObject(Semaphore, 10);
+  ::EnterCriticalSection(&Section);
+}
+
+void PoolLock::notifyAll() {
+  if (NumWaiters)
+    ::ReleaseSemaphore(Semaphore, NumWaiters, NULL);
+  NumWaiters = 0;
+}
+
+unsigned ThreadPool::getHardwareConcurrency() {
+  SYSTEM_INFO Info;
+  ::GetSystemInfo(&Info);
+  return Info.dwNumberOfProcessors ? Info.dwNumberOfProcessors : 1;
+}
+#else
+// Without threads, every task runs on the thread waiting for it, so nothing
+// can ever finish while a thread waits.
+PoolLock::PoolLock() {}
+PoolLock::~PoolLock() {}
+void PoolLock::lock() {}
+void PoolLock::unlock() {}
+void PoolLock::wait() { assert(0 && "Waiting for a task that never runs"); }
+void PoolLock::notifyAll() {}
+
+unsigned ThreadPool::getHardwareConcurrency() { return 1; }
+#endif
+
+namespace {
+struct Task {
+  ThreadPool::TaskFn Fn;
+  void *Arg;
+  TaskGroup *Group;
+};
+
+struct WorkerInfo {
+  ThreadPool::Impl *Pool;
+  unsigned Index;
+};
+}
+
+/// The worker the current thread is, if any.
+static ManagedStatic<sys::ThreadLocal<const WorkerInfo> > CurrentWorker;
+
+class ThreadPool::Impl {
+public:
+  explicit Impl(unsigned NumThreads);
+  ~Impl();
+
+  void enqueue(const Task &T);
+  /// Run tasks until *Counter drops to zero.
+  void waitFor(const unsigned *Counter);
+  void waitForAll() { waitFor(&Outstanding); }
+
+  unsigned getThreadCount() const { return Threads.size(); }
+
+private:
+  static void runWorker(void *Info);
+  /// Return the index of the queue the current thread pushes to.
+  unsigned getQueueIndex() const;
+  /// Pick the next task for the thread owning queue Index.  Must be called
+  /// with the lock held.
+  bool popTask(unsigned Index, Task &T);
+  /// Run T, which was popped with the lock held, and account for it.
+  void runTask(const Task &T);
+
+  PoolLock Lock;
+  /// One queue per worker, plus a last one for the other threads.
+  std::vector<std::deque<Task> > Queues;
+  std::vector<WorkerInfo> Workers;
+  std::vector<llvm_thread *> Threads;
+  /// Number of tasks queued or running.
+  unsigned Outstanding;
+  bool ShuttingDown;
+};
+
+ThreadPool::Impl::Impl(unsigned NumThreads)
+    : Queues(NumThreads + 1), Workers(NumThreads), Outstanding(0),
+      ShuttingDown(false) {
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Workers[i].Pool = this;
+    Workers[i].Index = i;
+  }
+
+  // Create the thread local before the workers race for it.
+  (void)*CurrentWorker;
+
+  // Workers that fail to start leave their queue empty, since nothing but
+  // the worker itself pushes to it.
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    llvm_thread *Thread = llvm_create_thread(runWorker, &Workers[i]);
+    if (!Thread)
+      break;
+    Threads.push_back(Thread);
+  }
+}
+
+ThreadPool::Impl::~Impl() {
+  waitForAll();
+  Lock.lock();
+  ShuttingDown = true;
+  Lock.notifyAll();
+  Lock.unlock();
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    llvm_join_thread(Threads[i]);
+}
+
+unsigned ThreadPool::Impl::getQueueIndex() const {
+  const WorkerInfo *W = CurrentWorker->get();
+  if (W && W->Pool == this)
+    return W->Index;
+  return Queues.size() - 1;
+}
+
+bool ThreadPool::Impl::popTask(unsigned Index, Task &T) {
+  // Newest task of our own queue first...
+  std::deque<Task> &Own = Queues[Index];
+  if (!Own.empty()) {
+    T = Own.back();
+    Own.pop_back();
+    return true;
+  }
+  // ...then the oldest task of somebody else's.
+  for (unsigned i = 1, e = Queues.size(); i != e; ++i) {
+    std::deque<Task> &Victim = Queues[(Index + i) % e];
+    if (!Victim.empty()) {
+      T = Victim.front();
+      Victim.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Impl::runTask(const Task &T) {
+  Lock.unlock();
+  T.Fn(T.Arg);
+  Lock.lock();
+
+  --Outstanding;
+  bool Notify = Outstanding == 0;
+  if (T.Group && --T.Group->Pending == 0)
+    Notify = true;
+  if (Notify)
+    Lock.notifyAll();
+}
+
+void ThreadPool::Impl::runWorker(void *Arg) {
+  WorkerInfo *W = static_cast<WorkerInfo *>(Arg);
+  Impl *Pool = W->Pool;
+  CurrentWorker->set(W);
+
+  Pool->Lock.lock();
+  for (;;) {
+    Task T;
+    if (Pool->popTask(W->Index, T))
+      Pool->runTask(T);
+    else if (Pool->ShuttingDown)
+      break;
+    else
+      Pool->Lock.wait();
+  }
+  Pool->Lock.unlock();
+  CurrentWorker->erase();
+}
+
+void ThreadPool::Impl::enqueue(const Task &T) {
+  Lock.lock();
+  ++Outstanding;
+  if (T.Group)
+    ++T.Group->Pending;
+  Queues[getQueueIndex()].push_back(T);
+  Lock.notifyAll();
+  Lock.unlock();
+}
+
+void ThreadPool::Impl::waitFor(const unsigned *Counter) {
+  unsigned Index = getQueueIndex();
+  Lock.lock();
+  while (*Counter != 0) {
+    Task T;
+    if (popTask(Index, T))
+      runTask(T);
+    else
+      Lock.wait();
+  }
+  Lock.unlock();
+}
+
+ThreadPool::ThreadPool(unsigned NumThreads)
+    : P(new Impl(NumThreads ? NumThreads : getHardwareConcurrency())) {}
+
+ThreadPool::~ThreadPool() { delete P; }
+
+void ThreadPool::async(TaskFn Fn, void *Arg) { enqueue(Fn, Arg, 0); }
+
+void ThreadPool::enqueue(TaskFn Fn, void *Arg, TaskGroup *Group) {
+  Task T = { Fn, Arg, Group };
+  P->enqueue(T);
+}
+
+void ThreadPool::wait() { P->waitForAll(); }
+
+unsigned ThreadPool::getThreadCount() const { return P->getThreadCount(); }
+
+static ManagedStatic<ThreadPool> DefaultPool;
+
+ThreadPool &ThreadPool::getDefault() { return *DefaultPool; }
+
+void TaskGroup::wait() { Pool.P->waitFor(&Pending); }
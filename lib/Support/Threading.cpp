@@ -14,8 +14,10 @@
 #include "llvm/Support/Threading.h"
 #include "llvm/Config/config.h"
 #include "llvm/Support/Atomic.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Mutex.h"
 #include <cassert>
+#include <vector>
 
 using namespace llvm;
 
@@ -102,6 +104,36 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
  error:
   ::pthread_attr_destroy(&Attr);
 }
+
+struct llvm::llvm_thread {
+  ThreadInfo Info;
+  pthread_t Thread;
+};
+
+llvm_thread *llvm::llvm_create_thread(void (*Fn)(void*), void *UserData,
+                                      unsigned RequestedStackSize) {
+  pthread_attr_t Attr;
+  if (::pthread_attr_init(&Attr) != 0)
+    return 0;
+
+  llvm_thread *T = new llvm_thread;
+  T->Info.UserFn = Fn;
+  T->Info.UserData = UserData;
+  if ((RequestedStackSize != 0 &&
+       ::pthread_attr_setstacksize(&Attr, RequestedStackSize) != 0) ||
+      ::pthread_create(&T->Thread, &Attr, ExecuteOnThread_Dispatch,
+                       &T->Info) != 0) {
+    delete T;
+    T = 0;
+  }
+  ::pthread_attr_destroy(&Attr);
+  return T;
+}
+
+void llvm::llvm_join_thread(llvm_thread *T) {
+  ::pthread_join(T->Thread, 0);
+  delete T;
+}
 #elif LLVM_ENABLE_THREADS!=0 && defined(LLVM_ON_WIN32)
 #include "Windows/Windows.h"
 #include <process.h>
@@ -136,6 +168,31 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
     ::CloseHandle(hThread);
   }
 }
+
+struct llvm::llvm_thread {
+  ThreadInfo Info;
+  HANDLE Thread;
+};
+
+llvm_thread *llvm::llvm_create_thread(void (*Fn)(void*), void *UserData,
+                                      unsigned RequestedStackSize) {
+  llvm_thread *T = new llvm_thread;
+  T->Info.func = Fn;
+  T->Info.param = UserData;
+  T->Thread = (HANDLE)::_beginthreadex(NULL, RequestedStackSize,
+                                       ThreadCallback, &T->Info, 0, NULL);
+  if (!T->Thread) {
+    delete T;
+    return 0;
+  }
+  return T;
+}
+
+void llvm::llvm_join_thread(llvm_thread *T) {
+  (void)::WaitForSingleObject(T->Thread, INFINITE);
+  ::CloseHandle(T->Thread);
+  delete T;
+}
 #else
 // Support for non-Win32, non-pthread implementation.
 void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
@@ -144,4 +201,42 @@ void llvm::llvm_execute_on_thread(void (*Fn)(void*), void *UserData,
   Fn(UserData);
 }
 
+llvm_thread *llvm::llvm_create_thread(void (*Fn)(void*), void *UserData,
+                                      unsigned RequestedStackSize) {
+  (void) Fn;
+  (void) UserData;
+  (void) RequestedStackSize;
+  return 0;
+}
+
+void llvm::llvm_join_thread(llvm_thread *T) {
+  (void) T;
+  llvm_unreachable("No threads can have been created");
+}
+
 #endif
+
+void llvm::llvm_execute_on_threads(void (*Fn)(void*), void *const *UserData,
+                                   unsigned NumTasks,
+                                   unsigned RequestedStackSize) {
+  std::vector<llvm_thread *> Threads;
+  Threads.reserve(NumTasks);
+  unsigned NextTask = 0;
+
+  // Leave the last task for the calling thread, which would otherwise just
+  // sit waiting for the others.
+  for (; NextTask + 1 < NumTasks; ++NextTask) {
+    llvm_thread *T = llvm_create_thread(Fn, UserData[NextTask],
+                                        RequestedStackSize);
+    if (!T)
+      break;
+    Threads.push_back(T);
+  }
+
+  // Run whatever could not be handed to a thread here.
+  for (; NextTask < NumTasks; ++NextTask)
+    Fn(UserData[NextTask]);
+
+  for (unsigned i = 0, e = Threads.size(); i != e; ++i)
+    llvm_join_thread(Threads[i]);
+}
@@ -144,16 +144,29 @@ TimeRecord TimeRecord::getCurrentTime(bool Start) {
   return Result;
 }
 
+TimeRecord TimeRecord::getCurrentWallTime() {
+  TimeRecord Result;
+  sys::TimeValue now = sys::Process::GetMonotonicTime();
+  Result.WallTime = now.seconds() + now.nanoseconds() / 1000000000.0;
+  return Result;
+}
+
 static ManagedStatic<std::vector<Timer*> > ActiveTimers;
 
 void Timer::startTimer() {
   Started = true;
   ActiveTimers->push_back(this);
-  Time -= TimeRecord::getCurrentTime(true);
+  if (TG->WallTimeOnly)
+    Time -= TimeRecord::getCurrentWallTime();
+  else
+    Time -= TimeRecord::getCurrentTime(true);
 }
 
 void Timer::stopTimer() {
-  Time += TimeRecord::getCurrentTime(false);
+  if (TG->WallTimeOnly)
+    Time += TimeRecord::getCurrentWallTime();
+  else
+    Time += TimeRecord::getCurrentTime(false);
 
   if (ActiveTimers->back() == this) {
     ActiveTimers->pop_back();
@@ -250,8 +263,8 @@ NamedRegionTimer::NamedRegionTimer(StringRef Name, StringRef GroupName,
 /// TimerGroup ctor/dtor and is protected by the TimerLock lock.
 static TimerGroup *TimerGroupList = 0;
 
-TimerGroup::TimerGroup(StringRef name)
-  : Name(name.begin(), name.end()), FirstTimer(0) {
+TimerGroup::TimerGroup(StringRef name, bool WallTimeOnly)
+  : Name(name.begin(), name.end()), WallTimeOnly(WallTimeOnly), FirstTimer(0) {
     
   // Add the group to TimerGroupList.
   sys::SmartScopedLock<true> L(*TimerLock);
@@ -330,9 +343,14 @@ void TimerGroup::PrintQueuedTimers(raw_ostream &OS) {
   // If this is not an collection of ungrouped times, print the total time.
   // Ungrouped timers don't really make sense to add up.  We still print the
   // TOTAL line to make the percentages make sense.
-  if (this != DefaultTimerGroup)
-    OS << format("  Total Execution Time: %5.4f seconds (%5.4f wall clock)\n",
-                 Total.getProcessTime(), Total.getWallTime());
+  if (this != DefaultTimerGroup) {
+    if (WallTimeOnly)
+      OS << format("  Total Execution Time: %5.4f seconds (wall clock)\n",
+                   Total.getWallTime());
+    else
+      OS << format("  Total Execution Time: %5.4f seconds (%5.4f wall clock)\n",
+                   Total.getProcessTime(), Total.getWallTime());
+  }
   OS << '\n';
   
   if (Total.getUserTime())
@@ -22,9 +22,11 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Program.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/system_error.h"
 #include <cctype>
 #include <cerrno>
+#include <limits>
 #include <sys/stat.h>
 
 // <fcntl.h> may provide O_BINARY.
@@ -279,7 +281,9 @@ raw_ostream &raw_ostream::write(unsigned char C) {
       return write(C);
     }
 
+    // Flushing may have changed the buffer, or left the stream unbuffered.
     flush_nonempty();
+    return write(C);
   }
 
   *OutBufCur++ = C;
@@ -426,7 +430,8 @@ void format_object_base::home() {
 /// if no error occurred.
 raw_fd_ostream::raw_fd_ostream(const char *Filename, std::string &ErrorInfo,
                                sys::fs::OpenFlags Flags)
-    : Error(false), UseAtomicWrites(false), pos(0) {
+    : Error(false), UseAtomicWrites(false), pos(0), Mapping(0), MappedStart(0),
+      UnmappedBufferSize(0), Async(0) {
   assert(Filename != 0 && "Filename is null");
   ErrorInfo.clear();
 
@@ -455,13 +460,15 @@ raw_fd_ostream::raw_fd_ostream(const char *Filename, std::string &ErrorInfo,
 
   // Ok, we successfully opened the file, so it'll need to be closed.
   ShouldClose = true;
+  Path = Filename;
 }
 
 /// raw_fd_ostream ctor - FD is the file descriptor that this writes to.  If
 /// ShouldClose is true, this closes the file when the stream is destroyed.
 raw_fd_ostream::raw_fd_ostream(int fd, bool shouldClose, bool unbuffered)
   : raw_ostream(unbuffered), FD(fd),
-    ShouldClose(shouldClose), Error(false), UseAtomicWrites(false) {
+    ShouldClose(shouldClose), Error(false), UseAtomicWrites(false),
+    Mapping(0), MappedStart(0), UnmappedBufferSize(0), Async(0) {
 #ifdef O_BINARY
   // Setting STDOUT and STDERR to binary mode is necessary in Win32
   // to avoid undesirable linefeed conversion.
@@ -480,6 +487,9 @@ raw_fd_ostream::raw_fd_ostream(int fd, bool shouldClose, bool unbuffered)
 raw_fd_ostream::~raw_fd_ostream() {
   if (FD >= 0) {
     flush();
+    finishAsyncWrite();
+    if (Mapping)
+      releaseMapping();
     if (ShouldClose)
       while (::close(FD) != 0)
         if (errno != EINTR) {
@@ -487,6 +497,7 @@ raw_fd_ostream::~raw_fd_ostream() {
           break;
         }
   }
+  delete Async;
 
 #ifdef __MINGW32__
   // On mingw, global dtors should not call exit().
@@ -505,10 +516,10 @@ raw_fd_ostream::~raw_fd_ostream() {
 }
 
 
-void raw_fd_ostream::write_impl(const char *Ptr, size_t Size) {
-  assert(FD >= 0 && "File already closed.");
-  pos += Size;
-
+/// writeAll - Write all Size bytes at Ptr to FD.  Return false if an error
+/// occurred.
+static bool writeAll(int FD, const char *Ptr, size_t Size,
+                     bool UseAtomicWrites) {
   do {
     ssize_t ret;
 
@@ -542,9 +553,8 @@ void raw_fd_ostream::write_impl(const char *Ptr, size_t Size) {
           )
         continue;
 
-      // Otherwise it's a non-recoverable error. Note it and quit.
-      error_detected();
-      break;
+      // Otherwise it's a non-recoverable error.
+      return false;
     }
 
     // The write may have written some or all of the data. Update the
@@ -553,12 +563,111 @@ void raw_fd_ostream::write_impl(const char *Ptr, size_t Size) {
     Ptr += ret;
     Size -= ret;
   } while (Size > 0);
+  return true;
+}
+
+/// AsyncBufferSize - The buffer size of streams with asynchronous writes.
+static const size_t AsyncBufferSize = 1024 * 1024;
+
+struct raw_fd_ostream::AsyncWrite {
+  int FD;
+  bool UseAtomicWrites;
+  /// The bytes being written.  The memory is reused for the next write.
+  SmallVector<char, 0> Bytes;
+  /// Set by the writing thread if the write failed.
+  bool Failed;
+  /// The thread writing Bytes, or null if none is running.
+  llvm_thread *Thread;
+
+  explicit AsyncWrite(int FD)
+      : FD(FD), UseAtomicWrites(false), Failed(false), Thread(0) {}
+
+  static void run(void *Arg) {
+    AsyncWrite *W = static_cast<AsyncWrite *>(Arg);
+    W->Failed = !writeAll(W->FD, W->Bytes.data(), W->Bytes.size(),
+                          W->UseAtomicWrites);
+  }
+};
+
+void raw_fd_ostream::SetUseAsyncWrites(bool Value) {
+  assert(FD >= 0 && "File already closed.");
+  if (Value == (Async != 0))
+    return;
+
+  flush();
+  finishAsyncWrite();
+  if (Mapping)
+    releaseMapping();
+
+  if (!Value) {
+    delete Async;
+    Async = 0;
+    return;
+  }
+
+  if (is_displayed())
+    return;
+  Async = new AsyncWrite(FD);
+  SetBufferSize(AsyncBufferSize);
+}
+
+void raw_fd_ostream::finishAsyncWrite() {
+  if (!Async)
+    return;
+  if (Async->Thread) {
+    llvm_join_thread(Async->Thread);
+    Async->Thread = 0;
+  }
+  if (Async->Failed) {
+    Async->Failed = false;
+    error_detected();
+  }
+}
+
+void raw_fd_ostream::write_impl(const char *Ptr, size_t Size) {
+  assert(FD >= 0 && "File already closed.");
+  if (Mapping) {
+    // Bytes flushed from the mapped buffer are already in the file.
+    if (Ptr == MappedStart) {
+      pos += Size;
+      releaseMapping();
+      return;
+    }
+    // Otherwise the room went unused; write the bytes as usual.
+    releaseMapping();
+  }
+  pos += Size;
+
+  if (!Async) {
+    if (!writeAll(FD, Ptr, Size, UseAtomicWrites))
+      error_detected();
+    return;
+  }
+
+  // Copy the bytes for the background thread once it is done with the
+  // previous ones, as the caller reuses its buffer as soon as we return.
+  finishAsyncWrite();
+  Async->Bytes.clear();
+  Async->Bytes.append(Ptr, Ptr + Size);
+  Async->UseAtomicWrites = UseAtomicWrites;
+  Async->Thread = llvm_create_thread(AsyncWrite::run, Async);
+  if (Async->Thread)
+    return;
+
+  // Without threads, go back to writing synchronously.
+  AsyncWrite::run(Async);
+  finishAsyncWrite();
+  delete Async;
+  Async = 0;
 }
 
 void raw_fd_ostream::close() {
   assert(ShouldClose);
   ShouldClose = false;
   flush();
+  finishAsyncWrite();
+  if (Mapping)
+    releaseMapping();
   while (::close(FD) != 0)
     if (errno != EINTR) {
       error_detected();
@@ -569,12 +678,93 @@ void raw_fd_ostream::close() {
 
 uint64_t raw_fd_ostream::seek(uint64_t off) {
   flush();
+  finishAsyncWrite();
+  if (Mapping)
+    releaseMapping();
   pos = ::lseek(FD, off, SEEK_SET);
   if (pos != off)
     error_detected();
   return pos;
 }
 
+/// MinMappedWriteSize - Below this many bytes, setting up a mapping costs more
+/// than the write() calls it saves.
+static const uint64_t MinMappedWriteSize = 64 * 1024;
+
+void raw_fd_ostream::reserveExtraSpace(uint64_t ExtraSize) {
+#ifdef LLVM_ON_UNIX
+  if (FD < 0 || Mapping || UseAtomicWrites || ExtraSize < MinMappedWriteSize ||
+      ExtraSize > std::numeric_limits<size_t>::max())
+    return;
+
+  // Only map regular files with nothing after the current position, so that
+  // growing and later truncating the file can't lose any data.  Writes to a
+  // file opened for append don't go to pos, so leave those alone too.
+  struct stat FileInfo;
+  if (::fstat(FD, &FileInfo) != 0 || !S_ISREG(FileInfo.st_mode) ||
+      uint64_t(FileInfo.st_size) > pos)
+    return;
+#if defined(HAVE_FCNTL_H) && defined(O_APPEND)
+  int FileFlags = ::fcntl(FD, F_GETFL);
+  if (FileFlags == -1 || (FileFlags & O_APPEND))
+    return;
+#endif
+
+  flush();
+  finishAsyncWrite();
+  if (::ftruncate(FD, pos + ExtraSize) != 0)
+    return;
+
+  // A file descriptor opened only for writing can't be mapped, so map the
+  // file by name when it is still the file being written.
+  uint64_t Offset = pos & ~uint64_t(sys::fs::mapped_file_region::alignment() -
+                                    1);
+  uint64_t Length = pos - Offset + ExtraSize;
+  struct stat PathInfo;
+  bool UsePath = !Path.empty() && ::stat(Path.c_str(), &PathInfo) == 0 &&
+                 PathInfo.st_dev == FileInfo.st_dev &&
+                 PathInfo.st_ino == FileInfo.st_ino;
+  error_code EC;
+  sys::fs::mapped_file_region *Region;
+  if (UsePath)
+    Region = new sys::fs::mapped_file_region(
+        Path, sys::fs::mapped_file_region::readwrite, Length, Offset, EC);
+  else
+    Region = new sys::fs::mapped_file_region(
+        FD, false, sys::fs::mapped_file_region::readwrite, Length, Offset, EC);
+  if (EC) {
+    delete Region;
+    if (::ftruncate(FD, pos) != 0)
+      error_detected();
+    return;
+  }
+
+  Mapping = Region;
+  MappedStart = Region->data() + (pos - Offset);
+  UnmappedBufferSize = GetBufferSize();
+  SetBuffer(MappedStart, ExtraSize);
+#endif
+}
+
+void raw_fd_ostream::releaseMapping() {
+  assert(Mapping && GetNumBytesInBuffer() == 0 && "Mapping still in use!");
+  delete Mapping;
+  Mapping = 0;
+  MappedStart = 0;
+
+#ifdef LLVM_ON_UNIX
+  // Drop the room that wasn't used, and carry on writing after the bytes
+  // that were.
+  if (::ftruncate(FD, pos) != 0 || ::lseek(FD, pos, SEEK_SET) != off_t(pos))
+    error_detected();
+#endif
+
+  if (UnmappedBufferSize)
+    SetBufferSize(UnmappedBufferSize);
+  else
+    SetUnbuffered();
+}
+
 size_t raw_fd_ostream::preferred_buffer_size() const {
 #if !defined(_MSC_VER) && !defined(__MINGW32__) && !defined(__minix)
   // Windows and Minix have no st_blksize.
@@ -743,6 +933,15 @@ void raw_svector_ostream::write_impl(const char *Ptr, size_t Size) {
   SetBuffer(OS.end(), OS.capacity() - OS.size());
 }
 
+void raw_svector_ostream::reserveExtraSpace(uint64_t ExtraSize) {
+  flush();
+  if (ExtraSize <= OS.capacity() - OS.size() ||
+      ExtraSize > std::numeric_limits<unsigned>::max() - OS.size())
+    return;
+  OS.reserve(OS.size() + ExtraSize);
+  SetBuffer(OS.end(), OS.capacity() - OS.size());
+}
+
 uint64_t raw_svector_ostream::current_pos() const {
    return OS.size();
 }
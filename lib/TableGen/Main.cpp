@@ -17,6 +17,7 @@
 
 #include "TGParser.h"
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/ToolOutputFile.h"
@@ -29,9 +30,9 @@
 using namespace llvm;
 
 namespace {
-  cl::opt<std::string>
-  OutputFilename("o", cl::desc("Output filename"), cl::value_desc("filename"),
-                 cl::init("-"));
+  cl::list<std::string>
+  OutputFilenames("o", cl::desc("Output filename, once for each action"),
+                  cl::value_desc("filename"));
 
   cl::opt<std::string>
   DependFilename("d",
@@ -52,7 +53,9 @@ namespace {
 /// This functionality is really only for the benefit of the build system.
 /// It is similar to GCC's `-M*` family of options.
 static int createDependencyFile(const TGParser &Parser, const char *argv0) {
-  if (OutputFilename == "-") {
+  if (OutputFilenames.empty() ||
+      std::find(OutputFilenames.begin(), OutputFilenames.end(), "-") !=
+        OutputFilenames.end()) {
     errs() << argv0 << ": the option -d must be used together with -o\n";
     return 1;
   }
@@ -63,7 +66,9 @@ static int createDependencyFile(const TGParser &Parser, const char *argv0) {
       << ":" << Error << "\n";
     return 1;
   }
-  DepOut.os() << OutputFilename << ":";
+  for (unsigned i = 0, e = OutputFilenames.size(); i != e; ++i)
+    DepOut.os() << (i ? " " : "") << OutputFilenames[i];
+  DepOut.os() << ":";
   const TGLexer::DependenciesMapTy &Dependencies = Parser.getDependencies();
   for (TGLexer::DependenciesMapTy::const_iterator I = Dependencies.begin(),
                                                   E = Dependencies.end();
@@ -75,9 +80,30 @@ static int createDependencyFile(const TGParser &Parser, const char *argv0) {
   return 0;
 }
 
+static TableGenMainFn *SingleMainFn;
+
+static bool runSingleMainFn(raw_ostream &OS, RecordKeeper &Records,
+                            unsigned Index) {
+  return SingleMainFn(OS, Records);
+}
+
 namespace llvm {
 
 int TableGenMain(char *argv0, TableGenMainFn *MainFn) {
+  SingleMainFn = MainFn;
+  return TableGenMain(argv0, &runSingleMainFn, 1);
+}
+
+int TableGenMain(char *argv0, TableGenBackendFn *BackendFn,
+                 unsigned NumBackends) {
+  if (OutputFilenames.empty() && NumBackends == 1)
+    OutputFilenames.push_back("-");
+  if (OutputFilenames.size() != NumBackends) {
+    errs() << argv0 << ": " << NumBackends << " actions need as many -o "
+           << "options, " << OutputFilenames.size() << " given\n";
+    return 1;
+  }
+
   RecordKeeper Records;
 
   // Parse the input file.
@@ -102,29 +128,40 @@ int TableGenMain(char *argv0, TableGenMainFn *MainFn) {
   if (Parser.ParseFile())
     return 1;
 
-  std::string Error;
-  tool_output_file Out(OutputFilename.c_str(), Error);
-  if (!Error.empty()) {
-    errs() << argv0 << ": error opening " << OutputFilename
-      << ":" << Error << "\n";
-    return 1;
-  }
-  if (!DependFilename.empty()) {
-    if (int Ret = createDependencyFile(Parser, argv0))
-      return Ret;
+  // Open every output first, so that a bad filename is reported before any
+  // backend runs.
+  std::vector<tool_output_file *> Outs;
+  int Ret = 0;
+  for (unsigned i = 0; i != NumBackends; ++i) {
+    std::string Error;
+    Outs.push_back(new tool_output_file(OutputFilenames[i].c_str(), Error));
+    if (!Error.empty()) {
+      errs() << argv0 << ": error opening " << OutputFilenames[i]
+        << ":" << Error << "\n";
+      Ret = 1;
+      break;
+    }
   }
+  if (!Ret && !DependFilename.empty())
+    Ret = createDependencyFile(Parser, argv0);
 
-  if (MainFn(Out.os(), Records))
-    return 1;
+  // The backends share the parsed records, and anything the records cache,
+  // so the input is only parsed and resolved once for all of them.
+  for (unsigned i = 0; !Ret && i != NumBackends; ++i)
+    if (BackendFn(Outs[i]->os(), Records, i))
+      Ret = 1;
 
-  if (ErrorsPrinted > 0) {
+  if (!Ret && ErrorsPrinted > 0) {
     errs() << argv0 << ": " << ErrorsPrinted << " errors.\n";
-    return 1;
+    Ret = 1;
   }
 
   // Declare success.
-  Out.keep();
-  return 0;
+  if (!Ret)
+    for (unsigned i = 0; i != NumBackends; ++i)
+      Outs[i]->keep();
+  DeleteContainerPointers(Outs);
+  return Ret;
 }
 
 }
@@ -2015,11 +2015,16 @@ raw_ostream &llvm::operator<<(raw_ostream &OS, const RecordKeeper &RK) {
 /// name does not exist, an error is printed and true is returned.
 std::vector<Record*>
 RecordKeeper::getAllDerivedDefinitions(const std::string &ClassName) const {
+  std::map<std::string, std::vector<Record*> >::const_iterator Cached =
+    DerivedDefinitions.find(ClassName);
+  if (Cached != DerivedDefinitions.end())
+    return Cached->second;
+
   Record *Class = getClass(ClassName);
   if (!Class)
     PrintFatalError("ERROR: Couldn't find the `" + ClassName + "' class!\n");
 
-  std::vector<Record*> Defs;
+  std::vector<Record*> &Defs = DerivedDefinitions[ClassName];
   for (std::map<std::string, Record*>::const_iterator I = getDefs().begin(),
          E = getDefs().end(); I != E; ++I)
     if (I->second->isSubClassOf(Class))
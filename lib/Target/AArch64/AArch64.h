@@ -22,6 +22,7 @@ namespace llvm {
 
 class AArch64AsmPrinter;
 class FunctionPass;
+class ImmutablePass;
 class AArch64TargetMachine;
 class MachineInstr;
 class MCInst;
@@ -33,6 +34,10 @@ FunctionPass *createAArch64CleanupLocalDynamicTLSPass();
 
 FunctionPass *createAArch64BranchFixupPass();
 
+/// \brief Creates an AArch64-specific Target Transformation Info pass.
+ImmutablePass *
+createAArch64TargetTransformInfoPass(const AArch64TargetMachine *TM);
+
 void LowerAArch64MachineInstrToMCInst(const MachineInstr *MI, MCInst &OutMI,
                                       AArch64AsmPrinter &AP);
 
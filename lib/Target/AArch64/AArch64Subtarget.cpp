@@ -29,8 +29,9 @@ using namespace llvm;
 void AArch64Subtarget::anchor() {}
 
 AArch64Subtarget::AArch64Subtarget(StringRef TT, StringRef CPU, StringRef FS)
-    : AArch64GenSubtargetInfo(TT, CPU, FS), HasFPARMv8(false), HasNEON(false),
-      HasCrypto(false), TargetTriple(TT), CPUString(CPU) {
+    : AArch64GenSubtargetInfo(TT, CPU, FS), ARMProcFamily(Others),
+      HasFPARMv8(false), HasNEON(false), HasCrypto(false), TargetTriple(TT),
+      CPUString(CPU) {
 
   initializeSubtargetFeatures(CPU, FS);
 }
@@ -59,3 +60,12 @@ bool AArch64Subtarget::GVIsIndirectSymbol(const GlobalValue *GV,
 
   return !GV->hasLocalLinkage() && !GV->hasHiddenVisibility();
 }
+
+bool AArch64Subtarget::enablePostRAScheduler(
+           CodeGenOpt::Level OptLevel,
+           TargetSubtargetInfo::AntiDepBreakMode& Mode,
+           RegClassVector& CriticalPathRCs) const {
+  Mode = TargetSubtargetInfo::ANTIDEP_NONE;
+  CriticalPathRCs.clear();
+  return isCortexA53() && OptLevel >= CodeGenOpt::Default;
+}
@@ -29,6 +29,11 @@ class GlobalValue;
 class AArch64Subtarget : public AArch64GenSubtargetInfo {
   virtual void anchor();
 protected:
+  enum ARMProcFamilyEnum {Others, CortexA53};
+
+  /// ARMProcFamily - ARM processor family: Cortex-A53 and others.
+  ARMProcFamilyEnum ARMProcFamily;
+
   bool HasFPARMv8;
   bool HasNEON;
   bool HasCrypto;
@@ -52,6 +57,12 @@ public:
     return true;
   }
 
+  /// enablePostRAScheduler - Run the post-RA scheduler on in-order cores,
+  /// where it can still hide load-use and multiply latencies.
+  bool enablePostRAScheduler(CodeGenOpt::Level OptLevel,
+                             TargetSubtargetInfo::AntiDepBreakMode& Mode,
+                             RegClassVector& CriticalPathRCs) const;
+
   /// ParseSubtargetFeatures - Parses features string setting specified
   /// subtarget options.  Definition of function is auto generated by tblgen.
   void ParseSubtargetFeatures(StringRef CPU, StringRef FS);
@@ -65,6 +76,8 @@ public:
   bool hasNEON() const { return HasNEON; }
   bool hasCrypto() const { return HasCrypto; }
 
+  bool isCortexA53() const { return ARMProcFamily == CortexA53; }
+
   const std::string & getCPUString() const { return CPUString; }
 };
 } // End llvm namespace
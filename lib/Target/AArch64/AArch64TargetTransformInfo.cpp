@@ -0,0 +1,368 @@
+//===-- AArch64TargetTransformInfo.cpp - AArch64 specific TTI pass --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements a TargetTransformInfo analysis pass specific to the
+/// AArch64 target machine. It uses the target's detailed information to
+/// provide more precise answers to certain TTI queries, while letting the
+/// target independent and default TTI implementations handle the rest.
+///
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "aarch64tti"
+#include "AArch64.h"
+#include "AArch64TargetMachine.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Target/CostTable.h"
+#include "llvm/Target/TargetLowering.h"
+using namespace llvm;
+
+// Declare the pass initialization routine locally as target-specific passes
+// don't have a target-wide initialization entry point, and so we rely on the
+// pass constructor initialization.
+namespace llvm {
+void initializeAArch64TTIPass(PassRegistry &);
+}
+
+namespace {
+
+class AArch64TTI : public ImmutablePass, public TargetTransformInfo {
+  const AArch64Subtarget *ST;
+  const AArch64TargetLowering *TLI;
+
+public:
+  AArch64TTI() : ImmutablePass(ID), ST(0), TLI(0) {
+    llvm_unreachable("This pass cannot be directly constructed");
+  }
+
+  AArch64TTI(const AArch64TargetMachine *TM)
+      : ImmutablePass(ID), ST(TM->getSubtargetImpl()),
+        TLI(TM->getTargetLowering()) {
+    initializeAArch64TTIPass(*PassRegistry::getPassRegistry());
+  }
+
+  virtual void initializePass() {
+    pushTTIStack(this);
+  }
+
+  virtual void finalizePass() {
+    popTTIStack();
+  }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    TargetTransformInfo::getAnalysisUsage(AU);
+  }
+
+  /// Pass identification.
+  static char ID;
+
+  /// Provide necessary pointer adjustments for the two base classes.
+  virtual void *getAdjustedAnalysisPointer(const void *ID) {
+    if (ID == &TargetTransformInfo::ID)
+      return (TargetTransformInfo*)this;
+    return this;
+  }
+
+  /// \name Scalar TTI Implementations
+  /// @{
+
+  virtual unsigned getIntImmCost(const APInt &Imm, Type *Ty) const;
+
+  /// @}
+
+  /// \name Vector TTI Implementations
+  /// @{
+
+  unsigned getNumberOfRegisters(bool Vector) const {
+    if (Vector) {
+      if (ST->hasNEON())
+        return 32;
+      return 0;
+    }
+    return 31;
+  }
+
+  unsigned getRegisterBitWidth(bool Vector) const {
+    if (Vector) {
+      if (ST->hasNEON())
+        return 128;
+      return 0;
+    }
+    return 64;
+  }
+
+  unsigned getMaximumUnrollFactor() const {
+    // The cores we tune for are out of order with two NEON pipes, so two
+    // independent copies of a loop body keep both busy.
+    if (ST->hasNEON())
+      return 2;
+    return 1;
+  }
+
+  unsigned getArithmeticInstrCost(unsigned Opcode, Type *Ty,
+                                  OperandValueKind Op1Info = OK_AnyValue,
+                                  OperandValueKind Op2Info = OK_AnyValue) const;
+
+  unsigned getShuffleCost(ShuffleKind Kind, Type *Tp,
+                          int Index, Type *SubTp) const;
+
+  unsigned getCastInstrCost(unsigned Opcode, Type *Dst, Type *Src) const;
+
+  unsigned getVectorInstrCost(unsigned Opcode, Type *Val, unsigned Index) const;
+
+  unsigned getAddressComputationCost(Type *Val, bool IsComplex) const;
+
+  unsigned getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
+                           unsigned AddressSpace) const;
+
+  unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                      unsigned Factor,
+                                      ArrayRef<unsigned> Indices,
+                                      unsigned Alignment,
+                                      unsigned AddressSpace) const;
+  /// @}
+};
+
+} // end anonymous namespace
+
+INITIALIZE_AG_PASS(AArch64TTI, TargetTransformInfo, "aarch64tti",
+                   "AArch64 Target Transform Info", true, true, false)
+char AArch64TTI::ID = 0;
+
+ImmutablePass *
+llvm::createAArch64TargetTransformInfoPass(const AArch64TargetMachine *TM) {
+  return new AArch64TTI(TM);
+}
+
+unsigned AArch64TTI::getIntImmCost(const APInt &Imm, Type *Ty) const {
+  assert(Ty->isIntegerTy());
+
+  unsigned Bits = Ty->getPrimitiveSizeInBits();
+  if (Bits == 0 || Bits > 64)
+    return 4;
+
+  // A constant is materialized with one movz or movn and a movk for each
+  // further 16-bit chunk that is not all zeros (or all ones).
+  uint64_t Val = Imm.getZExtValue();
+  if (Imm.isNegative())
+    Val = ~Imm.getSExtValue();
+  unsigned Cost = 0;
+  for (unsigned Shift = 0; Shift < Bits; Shift += 16)
+    if ((Val >> Shift) & 0xffff)
+      ++Cost;
+  return std::max(1U, Cost);
+}
+
+unsigned AArch64TTI::getArithmeticInstrCost(unsigned Opcode, Type *Ty,
+                                            OperandValueKind Op1Info,
+                                            OperandValueKind Op2Info) const {
+  int ISD = TLI->InstructionOpcodeToISD(Opcode);
+  std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(Ty);
+
+  static const CostTblEntry<MVT::SimpleValueType> NEONCostTbl[] = {
+    // fdiv is not pipelined; a 128-bit division occupies the divider for
+    // about twice as long as a scalar one.
+    { ISD::FDIV, MVT::v2f32, 2 },
+    { ISD::FDIV, MVT::v4f32, 4 },
+    { ISD::FDIV, MVT::v2f64, 4 }
+  };
+
+  if (ST->hasNEON() && Ty->isVectorTy()) {
+    int Idx = CostTableLookup(NEONCostTbl, ISD, LT.second);
+    if (Idx != -1)
+      return LT.first * NEONCostTbl[Idx].Cost;
+  }
+
+  return TargetTransformInfo::getArithmeticInstrCost(Opcode, Ty, Op1Info,
+                                                     Op2Info);
+}
+
+unsigned AArch64TTI::getShuffleCost(ShuffleKind Kind, Type *Tp, int Index,
+                                    Type *SubTp) const {
+  // We only handle costs of reverse shuffles for now.
+  if (Kind != SK_Reverse || !ST->hasNEON())
+    return TargetTransformInfo::getShuffleCost(Kind, Tp, Index, SubTp);
+
+  static const CostTblEntry<MVT::SimpleValueType> NEONShuffleTbl[] = {
+    // Reversing the lanes of a double word is a single rev64; a quad word
+    // also needs an ext to swap the halves.
+    { ISD::VECTOR_SHUFFLE, MVT::v2i32, 1 },
+    { ISD::VECTOR_SHUFFLE, MVT::v2f32, 1 },
+    { ISD::VECTOR_SHUFFLE, MVT::v4i16, 1 },
+    { ISD::VECTOR_SHUFFLE, MVT::v8i8,  1 },
+    { ISD::VECTOR_SHUFFLE, MVT::v2i64, 1 },
+    { ISD::VECTOR_SHUFFLE, MVT::v2f64, 1 },
+
+    { ISD::VECTOR_SHUFFLE, MVT::v4i32, 2 },
+    { ISD::VECTOR_SHUFFLE, MVT::v4f32, 2 },
+    { ISD::VECTOR_SHUFFLE, MVT::v8i16, 2 },
+    { ISD::VECTOR_SHUFFLE, MVT::v16i8, 2 }
+  };
+
+  std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(Tp);
+
+  int Idx = CostTableLookup(NEONShuffleTbl, ISD::VECTOR_SHUFFLE, LT.second);
+  if (Idx == -1)
+    return TargetTransformInfo::getShuffleCost(Kind, Tp, Index, SubTp);
+
+  return LT.first * NEONShuffleTbl[Idx].Cost;
+}
+
+unsigned AArch64TTI::getCastInstrCost(unsigned Opcode, Type *Dst,
+                                      Type *Src) const {
+  int ISD = TLI->InstructionOpcodeToISD(Opcode);
+  assert(ISD && "Invalid opcode");
+
+  EVT SrcTy = TLI->getValueType(Src);
+  EVT DstTy = TLI->getValueType(Dst);
+
+  if (!SrcTy.isSimple() || !DstTy.isSimple() || !SrcTy.isVector() ||
+      !ST->hasNEON())
+    return TargetTransformInfo::getCastInstrCost(Opcode, Dst, Src);
+
+  static const TypeConversionCostTblEntry<MVT::SimpleValueType>
+  NEONConversionTbl[] = {
+    // Widening by one step is a single sshll/ushll (or sshll2/ushll2 for the
+    // high half), narrowing one step is an xtn.
+    { ISD::SIGN_EXTEND, MVT::v8i16, MVT::v8i8,  1 },
+    { ISD::ZERO_EXTEND, MVT::v8i16, MVT::v8i8,  1 },
+    { ISD::SIGN_EXTEND, MVT::v4i32, MVT::v4i16, 1 },
+    { ISD::ZERO_EXTEND, MVT::v4i32, MVT::v4i16, 1 },
+    { ISD::SIGN_EXTEND, MVT::v2i64, MVT::v2i32, 1 },
+    { ISD::ZERO_EXTEND, MVT::v2i64, MVT::v2i32, 1 },
+    { ISD::TRUNCATE,    MVT::v8i8,  MVT::v8i16, 1 },
+    { ISD::TRUNCATE,    MVT::v4i16, MVT::v4i32, 1 },
+    { ISD::TRUNCATE,    MVT::v2i32, MVT::v2i64, 1 },
+
+    // Results that need two registers take one instruction per half.
+    { ISD::SIGN_EXTEND, MVT::v16i16, MVT::v16i8, 2 },
+    { ISD::ZERO_EXTEND, MVT::v16i16, MVT::v16i8, 2 },
+    { ISD::SIGN_EXTEND, MVT::v8i32,  MVT::v8i16, 2 },
+    { ISD::ZERO_EXTEND, MVT::v8i32,  MVT::v8i16, 2 },
+    { ISD::SIGN_EXTEND, MVT::v4i64,  MVT::v4i32, 2 },
+    { ISD::ZERO_EXTEND, MVT::v4i64,  MVT::v4i32, 2 },
+    { ISD::SIGN_EXTEND, MVT::v4i32,  MVT::v4i8,  2 },
+    { ISD::ZERO_EXTEND, MVT::v4i32,  MVT::v4i8,  2 },
+    { ISD::SIGN_EXTEND, MVT::v8i32,  MVT::v8i8,  3 },
+    { ISD::ZERO_EXTEND, MVT::v8i32,  MVT::v8i8,  3 },
+    { ISD::SIGN_EXTEND, MVT::v16i32, MVT::v16i8, 6 },
+    { ISD::ZERO_EXTEND, MVT::v16i32, MVT::v16i8, 6 },
+    { ISD::TRUNCATE,    MVT::v16i8,  MVT::v16i16, 2 },
+    { ISD::TRUNCATE,    MVT::v8i16,  MVT::v8i32,  2 },
+    { ISD::TRUNCATE,    MVT::v4i32,  MVT::v4i64,  2 },
+    { ISD::TRUNCATE,    MVT::v8i8,   MVT::v8i32,  3 },
+    { ISD::TRUNCATE,    MVT::v16i8,  MVT::v16i32, 6 },
+
+    // Conversions between integers and floats of the same width are a
+    // single scvtf/ucvtf/fcvtzs/fcvtzu.
+    { ISD::SINT_TO_FP,  MVT::v2f32, MVT::v2i32, 1 },
+    { ISD::UINT_TO_FP,  MVT::v2f32, MVT::v2i32, 1 },
+    { ISD::SINT_TO_FP,  MVT::v4f32, MVT::v4i32, 1 },
+    { ISD::UINT_TO_FP,  MVT::v4f32, MVT::v4i32, 1 },
+    { ISD::SINT_TO_FP,  MVT::v2f64, MVT::v2i64, 1 },
+    { ISD::UINT_TO_FP,  MVT::v2f64, MVT::v2i64, 1 },
+    { ISD::FP_TO_SINT,  MVT::v2i32, MVT::v2f32, 1 },
+    { ISD::FP_TO_UINT,  MVT::v2i32, MVT::v2f32, 1 },
+    { ISD::FP_TO_SINT,  MVT::v4i32, MVT::v4f32, 1 },
+    { ISD::FP_TO_UINT,  MVT::v4i32, MVT::v4f32, 1 },
+    { ISD::FP_TO_SINT,  MVT::v2i64, MVT::v2f64, 1 },
+    { ISD::FP_TO_UINT,  MVT::v2i64, MVT::v2f64, 1 },
+
+    // Changing the width as well adds a widening or narrowing step.
+    { ISD::SINT_TO_FP,  MVT::v2f64, MVT::v2i32, 2 },
+    { ISD::UINT_TO_FP,  MVT::v2f64, MVT::v2i32, 2 },
+    { ISD::SINT_TO_FP,  MVT::v4f32, MVT::v4i16, 2 },
+    { ISD::UINT_TO_FP,  MVT::v4f32, MVT::v4i16, 2 },
+    { ISD::FP_TO_SINT,  MVT::v2i32, MVT::v2f64, 2 },
+    { ISD::FP_TO_UINT,  MVT::v2i32, MVT::v2f64, 2 },
+
+    // Single to/from double precision is fcvtl/fcvtn.
+    { ISD::FP_EXTEND,   MVT::v2f64, MVT::v2f32, 1 },
+    { ISD::FP_ROUND,    MVT::v2f32, MVT::v2f64, 1 },
+    { ISD::FP_EXTEND,   MVT::v4f64, MVT::v4f32, 2 },
+    { ISD::FP_ROUND,    MVT::v4f32, MVT::v4f64, 2 }
+  };
+
+  int Idx = ConvertCostTableLookup(NEONConversionTbl, ISD,
+                                   DstTy.getSimpleVT(), SrcTy.getSimpleVT());
+  if (Idx != -1)
+    return NEONConversionTbl[Idx].Cost;
+
+  return TargetTransformInfo::getCastInstrCost(Opcode, Dst, Src);
+}
+
+unsigned AArch64TTI::getVectorInstrCost(unsigned Opcode, Type *Val,
+                                        unsigned Index) const {
+  assert(Val->isVectorTy() && "This must be a vector type");
+
+  if (Index != -1U) {
+    // Legalize the type.
+    std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(Val);
+
+    // This type is legalized to a scalar type.
+    if (!LT.second.isVector())
+      return 0;
+
+    // The type may be split. Normalize the index to the new type.
+    unsigned Width = LT.second.getVectorNumElements();
+    Index = Index % Width;
+
+    // Lane zero of a floating point vector is the scalar register itself.
+    if (Index == 0 && Val->getScalarType()->isFloatingPointTy())
+      return 0;
+  }
+
+  // Everything else is an ins, dup or umov that crosses between the
+  // general purpose and the NEON register files.
+  return 2;
+}
+
+unsigned AArch64TTI::getAddressComputationCost(Type *Ty, bool IsComplex) const {
+  // Address computations in vectorized code with non-consecutive addresses
+  // turn into extracts and scalar adds that the scalar loop would have folded
+  // into its addressing modes.
+  unsigned NumVectorInstToHideOverhead = 10;
+
+  if (Ty->isVectorTy() && IsComplex)
+    return NumVectorInstToHideOverhead;
+
+  // Register offsets and post-increments usually fold the rest.
+  return 1;
+}
+
+unsigned AArch64TTI::getMemoryOpCost(unsigned Opcode, Type *Src,
+                                     unsigned Alignment,
+                                     unsigned AddressSpace) const {
+  // Unaligned NEON loads and stores run at full speed unless they cross a
+  // cache line, so only the number of registers matters.
+  std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(Src);
+  return LT.first;
+}
+
+unsigned AArch64TTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                                unsigned Factor,
+                                                ArrayRef<unsigned> Indices,
+                                                unsigned Alignment,
+                                                unsigned AddressSpace) const {
+  // As on ARM, the shuffles of a factor of two are matched to uzp1/uzp2 and
+  // zip1/zip2, one per register of each member.  ld3/ld4 and st3/st4 are not
+  // formed from shuffles, so larger factors get the generic estimate.
+  VectorType *VT = cast<VectorType>(VecTy);
+  if (Factor == 2 && ST->hasNEON()) {
+    Type *SubTy = VectorType::get(VT->getElementType(),
+                                  VT->getNumElements() / Factor);
+    std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(SubTy);
+    return getMemoryOpCost(Opcode, VecTy, Alignment, AddressSpace) +
+           Indices.size() * LT.first;
+  }
+
+  return TargetTransformInfo::getInterleavedMemoryOpCost(Opcode, VecTy, Factor,
+                                                         Indices, Alignment,
+                                                         AddressSpace);
+}
@@ -24,6 +24,8 @@
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/CodeGen/MachineBasicBlock.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineInstr.h"
@@ -53,6 +55,9 @@ STATISTIC(NumLDRD2LDM,  "Number of ldrd instructions turned back into ldm");
 STATISTIC(NumSTRD2STM,  "Number of strd instructions turned back into stm");
 STATISTIC(NumLDRD2LDR,  "Number of ldrd instructions turned back into ldr's");
 STATISTIC(NumSTRD2STR,  "Number of strd instructions turned back into str's");
+STATISTIC(NumBaseUpdates, "Number of base register updates folded");
+STATISTIC(NumBlocksJoined,"Number of fall-through blocks joined before "
+                          "allocation");
 
 /// ARMAllocLoadStoreOpt - Post- register allocation pass the combine
 /// load / store instructions to form ldm / stm instructions.
@@ -867,6 +872,7 @@ bool ARMLoadStoreOpt::MergeBaseUpdateLSMultiple(MachineBasicBlock &MBB,
   MIB->setMemRefs(MI->memoperands_begin(), MI->memoperands_end());
 
   MBB.erase(MBBI);
+  ++NumBaseUpdates;
   return true;
 }
 
@@ -1054,6 +1060,7 @@ bool ARMLoadStoreOpt::MergeBaseUpdateLoadStore(MachineBasicBlock &MBB,
     }
   }
   MBB.erase(MBBI);
+  ++NumBaseUpdates;
 
   return true;
 }
@@ -1568,6 +1575,7 @@ namespace {
                        unsigned Base, bool isLd,
                        DenseMap<MachineInstr*, unsigned> &MI2LocMap);
     bool RescheduleLoadStoreInstrs(MachineBasicBlock *MBB);
+    bool JoinFallThroughBlock(MachineBasicBlock *MBB);
   };
   char ARMPreAllocLoadStoreOpt::ID = 0;
 }
@@ -1582,38 +1590,113 @@ bool ARMPreAllocLoadStoreOpt::runOnMachineFunction(MachineFunction &Fn) {
 
   bool Modified = false;
   for (MachineFunction::iterator MFI = Fn.begin(), E = Fn.end(); MFI != E;
-       ++MFI)
+       ++MFI) {
+    while (JoinFallThroughBlock(MFI))
+      Modified = true;
     Modified |= RescheduleLoadStoreInstrs(MFI);
+  }
 
   return Modified;
 }
 
+/// hasMemoryOp - Return true if MBB contains a load / store this pass may
+/// combine.
+static bool hasMemoryOp(const MachineBasicBlock *MBB) {
+  for (MachineBasicBlock::const_iterator I = MBB->begin(), E = MBB->end();
+       I != E; ++I)
+    if (isMemoryOp(I))
+      return true;
+  return false;
+}
+
+/// JoinFallThroughBlock - If MBB falls through into a block that has no other
+/// predecessors, the two are a single straight-line sequence; splice the
+/// successor onto the end of MBB so that accesses on both sides of the
+/// boundary can be paired up. Returns true if the blocks were joined.
+bool ARMPreAllocLoadStoreOpt::JoinFallThroughBlock(MachineBasicBlock *MBB) {
+  if (MBB->succ_size() != 1)
+    return false;
+  MachineBasicBlock *Succ = *MBB->succ_begin();
+  if (Succ == MBB || !MBB->isLayoutSuccessor(Succ) ||
+      Succ->pred_size() != 1 || Succ->isLandingPad() ||
+      Succ->hasAddressTaken())
+    return false;
+  if (!Succ->empty() && Succ->front().isPHI())
+    return false;
+
+  // Only bother when there is something to pair on both sides.
+  if (!hasMemoryOp(MBB) || !hasMemoryOp(Succ))
+    return false;
+
+  MachineBasicBlock *TBB = 0, *FBB = 0;
+  SmallVector<MachineOperand, 4> Cond;
+  if (TII->AnalyzeBranch(*MBB, TBB, FBB, Cond) || !Cond.empty())
+    return false;
+
+  DEBUG(dbgs() << "Joining BB#" << Succ->getNumber() << " into BB#"
+               << MBB->getNumber() << "\n");
+  TII->RemoveBranch(*MBB);
+  MBB->splice(MBB->end(), Succ, Succ->begin(), Succ->end());
+  MBB->removeSuccessor(Succ);
+  MBB->transferSuccessorsAndUpdatePHIs(Succ);
+  Succ->eraseFromParent();
+  ++NumBlocksJoined;
+  return true;
+}
+
+/// isDisjointMemOp - Return true if the memory operands of MIa and MIb show
+/// that the two cannot access the same memory.
+static bool isDisjointMemOp(const MachineInstr *MIa, const MachineInstr *MIb,
+                            const DataLayout *TD) {
+  if (!MIa->hasOneMemOperand() || !MIb->hasOneMemOperand())
+    return false;
+  const MachineMemOperand *MMOa = *MIa->memoperands_begin();
+  const MachineMemOperand *MMOb = *MIb->memoperands_begin();
+  if (MMOa->isVolatile() || MMOb->isVolatile())
+    return false;
+  const Value *Va = MMOa->getValue();
+  const Value *Vb = MMOb->getValue();
+  if (!Va || !Vb)
+    return false;
+
+  // Different fields of the same object.
+  if (Va == Vb) {
+    int64_t OffA = MMOa->getOffset(), OffB = MMOb->getOffset();
+    return OffA + (int64_t)MMOa->getSize() <= OffB ||
+           OffB + (int64_t)MMOb->getSize() <= OffA;
+  }
+
+  // Two distinct objects, e.g. a pair of allocas.
+  const Value *Oa = GetUnderlyingObject(Va, TD);
+  const Value *Ob = GetUnderlyingObject(Vb, TD);
+  return Oa != Ob && isIdentifiedObject(Oa) && isIdentifiedObject(Ob);
+}
+
 static bool IsSafeAndProfitableToMove(bool isLd, unsigned Base,
                                       MachineBasicBlock::iterator I,
                                       MachineBasicBlock::iterator E,
                                       SmallPtrSet<MachineInstr*, 4> &MemOps,
                                       SmallSet<unsigned, 4> &MemRegs,
-                                      const TargetRegisterInfo *TRI) {
+                                      const TargetRegisterInfo *TRI,
+                                      const DataLayout *TD) {
   // Are there stores / loads / calls between them?
-  // FIXME: This is overly conservative. We should make use of alias information
-  // some day.
   SmallSet<unsigned, 4> AddedRegPressure;
   while (++I != E) {
     if (I->isDebugValue() || MemOps.count(&*I))
       continue;
     if (I->isCall() || I->isTerminator() || I->hasUnmodeledSideEffects())
       return false;
-    if (isLd && I->mayStore())
-      return false;
-    if (!isLd) {
-      if (I->mayLoad())
-        return false;
-      // It's not safe to move the first 'str' down.
-      // str r1, [r0]
-      // strh r5, [r0]
-      // str r4, [r0, #+4]
-      if (I->mayStore())
-        return false;
+    // Loads may move past stores, and stores past any memory access, only if
+    // the memory operands show they are independent. E.g. it's not safe to
+    // move the first 'str' down here:
+    // str r1, [r0]
+    // strh r5, [r0]
+    // str r4, [r0, #+4]
+    if (isLd ? I->mayStore() : (I->mayLoad() || I->mayStore())) {
+      for (SmallPtrSet<MachineInstr*, 4>::iterator MI = MemOps.begin(),
+             ME = MemOps.end(); MI != ME; ++MI)
+        if (!isDisjointMemOp(I, *MI, TD))
+          return false;
     }
     for (unsigned j = 0, NumOps = I->getNumOperands(); j != NumOps; ++j) {
       MachineOperand &MO = I->getOperand(j);
@@ -1802,7 +1885,7 @@ bool ARMPreAllocLoadStoreOpt::RescheduleOps(MachineBasicBlock *MBB,
       bool DoMove = (LastLoc - FirstLoc) <= NumMove*4; // FIXME: Tune this.
       if (DoMove)
         DoMove = IsSafeAndProfitableToMove(isLd, Base, FirstOp, LastOp,
-                                           MemOps, MemRegs, TRI);
+                                           MemOps, MemRegs, TRI, TD);
       if (!DoMove) {
         for (unsigned i = 0; i != NumMove; ++i)
           Ops.pop_back();
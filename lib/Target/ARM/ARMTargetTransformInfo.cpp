@@ -132,6 +132,12 @@ public:
 
   unsigned getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
                            unsigned AddressSpace) const;
+
+  unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                      unsigned Factor,
+                                      ArrayRef<unsigned> Indices,
+                                      unsigned Alignment,
+                                      unsigned AddressSpace) const;
   /// @}
 };
 
@@ -555,3 +561,26 @@ unsigned ARMTTI::getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
   }
   return LT.first;
 }
+
+unsigned ARMTTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                            unsigned Factor,
+                                            ArrayRef<unsigned> Indices,
+                                            unsigned Alignment,
+                                            unsigned AddressSpace) const {
+  // The shuffles that split a factor of two into its even and odd elements,
+  // and merge them back, are matched to vuzp and vzip, one per register of
+  // each member.  vld3/vld4 and vst3/vst4 are not formed from shuffles, so
+  // larger factors get the generic estimate.
+  VectorType *VT = cast<VectorType>(VecTy);
+  if (Factor == 2 && ST->hasNEON() && VT->getScalarSizeInBits() <= 32) {
+    Type *SubTy = VectorType::get(VT->getElementType(),
+                                  VT->getNumElements() / Factor);
+    std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(SubTy);
+    return getMemoryOpCost(Opcode, VecTy, Alignment, AddressSpace) +
+           Indices.size() * LT.first;
+  }
+
+  return TargetTransformInfo::getInterleavedMemoryOpCost(Opcode, VecTy, Factor,
+                                                         Indices, Alignment,
+                                                         AddressSpace);
+}
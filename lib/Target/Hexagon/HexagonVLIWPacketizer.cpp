@@ -41,13 +41,13 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Format.h"
 #include "Hexagon.h"
 #include "HexagonTargetMachine.h"
 #include "HexagonRegisterInfo.h"
 #include "HexagonSubtarget.h"
 #include "HexagonMachineFunctionInfo.h"
 
-#include <map>
 #include <vector>
 
 using namespace llvm;
@@ -56,6 +56,10 @@ static cl::opt<bool> PacketizeVolatiles("hexagon-packetize-volatiles",
       cl::ZeroOrMore, cl::Hidden, cl::init(true),
       cl::desc("Allow non-solo packetization of volatile memory references"));
 
+static cl::opt<bool> PrintPacketStats("hexagon-packet-stats",
+      cl::Hidden, cl::init(false),
+      cl::desc("Print packet density and stall counts for each function"));
+
 namespace llvm {
   void initializeHexagonPacketizerPass(PassRegistry&);
 }
@@ -147,21 +151,16 @@ namespace {
                          const TargetRegisterClass* RC);
     bool CanPromoteToDotNew(MachineInstr* MI, SUnit* PacketSU,
                             unsigned DepReg,
-                            std::map <MachineInstr*, SUnit*> MIToSUnit,
                             MachineBasicBlock::iterator &MII,
                             const TargetRegisterClass* RC);
     bool CanPromoteToNewValue(MachineInstr* MI, SUnit* PacketSU,
                               unsigned DepReg,
-                              std::map <MachineInstr*, SUnit*> MIToSUnit,
                               MachineBasicBlock::iterator &MII);
     bool CanPromoteToNewValueStore(MachineInstr* MI, MachineInstr* PacketMI,
-                                   unsigned DepReg,
-                                   std::map <MachineInstr*, SUnit*> MIToSUnit);
+                                   unsigned DepReg);
     bool DemoteToDotOld(MachineInstr* MI);
-    bool ArePredicatesComplements(MachineInstr* MI1, MachineInstr* MI2,
-                    std::map <MachineInstr*, SUnit*> MIToSUnit);
-    bool RestrictingDepExistInPacket(MachineInstr*,
-                    unsigned, std::map <MachineInstr*, SUnit*>);
+    bool ArePredicatesComplements(MachineInstr* MI1, MachineInstr* MI2);
+    bool RestrictingDepExistInPacket(MachineInstr*, unsigned);
     bool isNewifiable(MachineInstr* MI);
     bool isCondInst(MachineInstr* MI);
     bool tryAllocateResourcesForConstExt(MachineInstr* MI);
@@ -260,6 +259,18 @@ bool HexagonPacketizer::runOnMachineFunction(MachineFunction &Fn) {
     }
   }
 
+  if (PrintPacketStats) {
+    unsigned NumPackets = Packetizer.getNumPackets();
+    unsigned NumInstrs = Packetizer.getNumPacketizedInstrs();
+    dbgs() << "Packet stats for " << Fn.getName() << ": " << NumInstrs
+           << " instructions in " << NumPackets << " packets";
+    if (NumPackets)
+      dbgs() << format(" (%.2f per packet)", double(NumInstrs) / NumPackets);
+    dbgs() << ", " << Packetizer.getNumDependenceStalls()
+           << " dependence stalls, " << Packetizer.getNumResourceStalls()
+           << " resource stalls\n";
+  }
+
   return true;
 }
 
@@ -272,49 +283,27 @@ static bool IsIndirectCall(MachineInstr* MI) {
 // Reserve resources for constant extender. Trigure an assertion if
 // reservation fail.
 void HexagonPacketizerList::reserveResourcesForConstExt(MachineInstr* MI) {
-  const HexagonInstrInfo *QII = (const HexagonInstrInfo *) TII;
-  MachineFunction *MF = MI->getParent()->getParent();
-  MachineInstr *PseudoMI = MF->CreateMachineInstr(QII->get(Hexagon::IMMEXT_i),
-                                                  MI->getDebugLoc());
-
-  if (ResourceTracker->canReserveResources(PseudoMI)) {
-    ResourceTracker->reserveResources(PseudoMI);
-    MI->getParent()->getParent()->DeleteMachineInstr(PseudoMI);
-  } else {
-    MI->getParent()->getParent()->DeleteMachineInstr(PseudoMI);
+  const MCInstrDesc &ExtDesc = TII->get(Hexagon::IMMEXT_i);
+  if (!ResourceTracker->canReserveResources(&ExtDesc))
     llvm_unreachable("can not reserve resources for constant extender.");
-  }
-  return;
+  ResourceTracker->reserveResources(&ExtDesc);
 }
 
 bool HexagonPacketizerList::canReserveResourcesForConstExt(MachineInstr *MI) {
   const HexagonInstrInfo *QII = (const HexagonInstrInfo *) TII;
   assert((QII->isExtended(MI) || QII->isConstExtended(MI)) &&
          "Should only be called for constant extended instructions");
-  MachineFunction *MF = MI->getParent()->getParent();
-  MachineInstr *PseudoMI = MF->CreateMachineInstr(QII->get(Hexagon::IMMEXT_i),
-                                                  MI->getDebugLoc());
-  bool CanReserve = ResourceTracker->canReserveResources(PseudoMI);
-  MF->DeleteMachineInstr(PseudoMI);
-  return CanReserve;
+  return ResourceTracker->canReserveResources(&QII->get(Hexagon::IMMEXT_i));
 }
 
 // Allocate resources (i.e. 4 bytes) for constant extender. If succeed, return
 // true, otherwise, return false.
 bool HexagonPacketizerList::tryAllocateResourcesForConstExt(MachineInstr* MI) {
-  const HexagonInstrInfo *QII = (const HexagonInstrInfo *) TII;
-  MachineFunction *MF = MI->getParent()->getParent();
-  MachineInstr *PseudoMI = MF->CreateMachineInstr(QII->get(Hexagon::IMMEXT_i),
-                                                  MI->getDebugLoc());
-
-  if (ResourceTracker->canReserveResources(PseudoMI)) {
-    ResourceTracker->reserveResources(PseudoMI);
-    MI->getParent()->getParent()->DeleteMachineInstr(PseudoMI);
-    return true;
-  } else {
-    MI->getParent()->getParent()->DeleteMachineInstr(PseudoMI);
+  const MCInstrDesc &ExtDesc = TII->get(Hexagon::IMMEXT_i);
+  if (!ResourceTracker->canReserveResources(&ExtDesc))
     return false;
-  }
+  ResourceTracker->reserveResources(&ExtDesc);
+  return true;
 }
 
 
@@ -536,8 +525,7 @@ static MachineOperand& GetStoreValueOperand(MachineInstr *MI) {
 //    already a store in a packet, there can not be a new value store.
 //    Arch Spec: 3.4.4.2
 bool HexagonPacketizerList::CanPromoteToNewValueStore( MachineInstr *MI,
-                MachineInstr *PacketMI, unsigned DepReg,
-                std::map <MachineInstr*, SUnit*> MIToSUnit) {
+                MachineInstr *PacketMI, unsigned DepReg) {
   const HexagonInstrInfo *QII = (const HexagonInstrInfo *) TII;
   // Make sure we are looking at the store, that can be promoted.
   if (!QII->mayBeNewStore(MI))
@@ -718,7 +706,6 @@ bool HexagonPacketizerList::CanPromoteToNewValueStore( MachineInstr *MI,
 // new value store or new value jump
 bool HexagonPacketizerList::CanPromoteToNewValue( MachineInstr *MI,
                 SUnit *PacketSU, unsigned DepReg,
-                std::map <MachineInstr*, SUnit*> MIToSUnit,
                 MachineBasicBlock::iterator &MII)
 {
 
@@ -732,7 +719,7 @@ bool HexagonPacketizerList::CanPromoteToNewValue( MachineInstr *MI,
   MachineInstr *PacketMI = PacketSU->getInstr();
 
   // Check to see the store can be new value'ed.
-  if (CanPromoteToNewValueStore(MI, PacketMI, DepReg, MIToSUnit))
+  if (CanPromoteToNewValueStore(MI, PacketMI, DepReg))
     return true;
 
   // Check to see the compare/jump can be new value'ed.
@@ -747,7 +734,6 @@ bool HexagonPacketizerList::CanPromoteToNewValue( MachineInstr *MI,
 // 3. dot new on jump NV/J - V4 -- This is generated in a pass.
 bool HexagonPacketizerList::CanPromoteToDotNew( MachineInstr *MI,
                               SUnit *PacketSU, unsigned DepReg,
-                              std::map <MachineInstr*, SUnit*> MIToSUnit,
                               MachineBasicBlock::iterator &MII,
                               const TargetRegisterClass* RC )
 {
@@ -766,22 +752,16 @@ bool HexagonPacketizerList::CanPromoteToDotNew( MachineInstr *MI,
       !QII->mayBeNewStore(MI)) // MI is not a new-value store
     return false;
   else {
-    // Create a dot new machine instruction to see if resources can be
-    // allocated. If not, bail out now.
+    // Check whether resources can be allocated for the dot new form of
+    // the instruction. If not, bail out now.
     int NewOpcode = QII->GetDotNewOp(MI);
     const MCInstrDesc &desc = QII->get(NewOpcode);
-    DebugLoc dl;
-    MachineInstr *NewMI =
-                    MI->getParent()->getParent()->CreateMachineInstr(desc, dl);
-    bool ResourcesAvailable = ResourceTracker->canReserveResources(NewMI);
-    MI->getParent()->getParent()->DeleteMachineInstr(NewMI);
-
-    if (!ResourcesAvailable)
+    if (!ResourceTracker->canReserveResources(&desc))
       return false;
 
     // new value store only
     // new new value jump generated as a passes
-    if (!CanPromoteToNewValue(MI, PacketSU, DepReg, MIToSUnit, MII)) {
+    if (!CanPromoteToNewValue(MI, PacketSU, DepReg, MII)) {
       return false;
     }
   }
@@ -803,8 +783,7 @@ bool HexagonPacketizerList::CanPromoteToDotNew( MachineInstr *MI,
 // a)'s P3 is converted to .new form
 // Anti Dep between c) and b) is irrelevant for this case
 bool HexagonPacketizerList::RestrictingDepExistInPacket (MachineInstr* MI,
-      unsigned DepReg,
-      std::map <MachineInstr*, SUnit*> MIToSUnit) {
+      unsigned DepReg) {
 
   const HexagonInstrInfo *QII = (const HexagonInstrInfo *) TII;
   SUnit* PacketSUDep = MIToSUnit[MI];
@@ -861,7 +840,7 @@ static unsigned getPredicatedRegister(MachineInstr *MI,
 // Given two predicated instructions, this function detects whether
 // the predicates are complements
 bool HexagonPacketizerList::ArePredicatesComplements (MachineInstr* MI1,
-     MachineInstr* MI2, std::map <MachineInstr*, SUnit*> MIToSUnit) {
+     MachineInstr* MI2) {
 
   const HexagonInstrInfo *QII = (const HexagonInstrInfo *) TII;
 
@@ -917,8 +896,7 @@ bool HexagonPacketizerList::ArePredicatesComplements (MachineInstr* MI1,
             // Now I need to see if there is an anti dependency
             // from c) to any other instruction in the
             // same packet on the pred reg of interest
-            RestrictingDepExistInPacket(*VIN,PacketSU->Succs[i].getReg(),
-                                        MIToSUnit)) {
+            RestrictingDepExistInPacket(*VIN,PacketSU->Succs[i].getReg())) {
            return false;
         }
       }
@@ -1186,7 +1164,7 @@ bool HexagonPacketizerList::isLegalToPacketizeTogether(SUnit *SUI, SUnit *SUJ) {
 
       // For instructions that can be promoted to dot-new, try to promote.
       else if ((DepType == SDep::Data) &&
-               CanPromoteToDotNew(I, SUJ, DepReg, MIToSUnit, II, RC) &&
+               CanPromoteToDotNew(I, SUJ, DepReg, II, RC) &&
                PromoteToDotNew(I, DepType, II, RC)) {
         PromotedToDotNew = true;
         /* do nothing */
@@ -1201,7 +1179,7 @@ bool HexagonPacketizerList::isLegalToPacketizeTogether(SUnit *SUI, SUnit *SUJ) {
       // then there can be no dependence.
       else if (QII->isPredicated(I) &&
                QII->isPredicated(J) &&
-          ArePredicatesComplements(I, J, MIToSUnit)) {
+          ArePredicatesComplements(I, J)) {
         /* do nothing */
 
       }
@@ -1364,6 +1342,7 @@ HexagonPacketizerList::addToPacket(MachineInstr *MI) {
       if ((QII->isExtended(MI) || QII->isConstExtended(MI)) &&
           !tryAllocateResourcesForConstExt(MI)) {
         endPacket(MBB, MI);
+        ++NumResourceStalls;
         ResourceTracker->reserveResources(MI);
         assert(canReserveResourcesForConstExt(MI) &&
                "Ensure that there is a slot");
@@ -1385,6 +1364,7 @@ HexagonPacketizerList::addToPacket(MachineInstr *MI) {
               !ResourceTracker->canReserveResources(nvjMI)))
       {
         endPacket(MBB, MI);
+        ++NumResourceStalls;
         // A new and empty packet starts.
         // We are sure that the resources requirements can be satisfied.
         // Therefore, do not need to call "canReserveResources" anymore.
@@ -1402,6 +1382,7 @@ HexagonPacketizerList::addToPacket(MachineInstr *MI) {
               || !ResourceTracker->canReserveResources(MI)))
       {
         endPacket(MBB, MI);
+        ++NumResourceStalls;
         // Check if the instruction was promoted to a dot-new. If so, demote it
         // back into a dot-old
         if (PromotedToDotNew) {
@@ -62,6 +62,8 @@ inline static const char *NVPTXCondCodeToString(NVPTXCC::CondCodes CC) {
 FunctionPass *
 createNVPTXISelDag(NVPTXTargetMachine &TM, llvm::CodeGenOpt::Level OptLevel);
 ModulePass *createGenericToNVVMPass();
+FunctionPass *createNVPTXInferAddressSpacesPass();
+FunctionPass *createNVPTXLoadStoreVectorizerPass();
 ModulePass *createNVVMReflectPass();
 ModulePass *createNVVMReflectPass(const StringMap<int>& Mapping);
 MachineFunctionPass *createNVPTXPrologEpilogPass();
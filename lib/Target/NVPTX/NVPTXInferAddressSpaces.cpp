@@ -0,0 +1,332 @@
+//===-- NVPTXInferAddressSpaces.cpp - Infer address spaces of pointers ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Loads and stores through generic pointers are translated to generic ld/st,
+// which are slower than accesses to a specific address space. Frontends and
+// GenericToNVVM produce generic pointers by converting specific ones, e.g.
+//
+//   %p = call i32* @llvm.nvvm.ptr.global.to.gen.p0i32.p1i32(i32 addrspace(1)* %g)
+//   %q = getelementptr i32* %p, i32 %i
+//   %v = load i32* %q
+//
+// This pass computes, for each generic pointer feeding a load or store, the
+// address space it must point into. The dataflow walks through GEPs,
+// bitcasts, PHIs and selects. When all the conversions that reach a pointer
+// come from the same space, the pointer expression is rebuilt in that space
+// and the access uses it directly:
+//
+//   %q.global = getelementptr i32 addrspace(1)* %g, i32 %i
+//   %v = load i32 addrspace(1)* %q.global
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "nvptx-infer-addrspace"
+
+#include "NVPTX.h"
+#include "MCTargetDesc/NVPTXBaseInfo.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ValueHandle.h"
+#include "llvm/Transforms/Utils/Local.h"
+
+using namespace llvm;
+
+STATISTIC(NumAccessesInferred, "Number of generic loads/stores made specific");
+
+namespace llvm {
+void initializeNVPTXInferAddressSpacesPass(PassRegistry &);
+}
+
+namespace {
+// Lattice value of a pointer that no conversion reaches yet.
+const unsigned UninitializedAddressSpace = ~0U;
+
+class NVPTXInferAddressSpaces : public FunctionPass {
+public:
+  static char ID;
+
+  NVPTXInferAddressSpaces() : FunctionPass(ID) {}
+
+  virtual bool runOnFunction(Function &F);
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.setPreservesCFG();
+  }
+
+  virtual const char *getPassName() const {
+    return "NVPTX infer address spaces";
+  }
+
+private:
+  void collectPointerExpressions(Value *V);
+  unsigned computeAddressSpace(Value *V) const;
+  Value *cloneInAddressSpace(Value *V);
+
+  // Generic pointer expressions in post order: operands come before users,
+  // except around PHI cycles.
+  SmallVector<Value *, 32> Postorder;
+  SmallPtrSet<Value *, 32> Visited;
+  DenseMap<Value *, unsigned> InferredAS;
+  DenseMap<Value *, Value *> Clones;
+};
+}
+
+char NVPTXInferAddressSpaces::ID = 0;
+
+INITIALIZE_PASS(NVPTXInferAddressSpaces, "nvptx-infer-addrspace",
+                "Infer the address spaces of generic pointers", false, false)
+
+FunctionPass *llvm::createNVPTXInferAddressSpacesPass() {
+  return new NVPTXInferAddressSpaces();
+}
+
+static bool isGenericPointer(const Value *V) {
+  PointerType *PTy = dyn_cast<PointerType>(V->getType());
+  return PTy && PTy->getAddressSpace() == ADDRESS_SPACE_GENERIC;
+}
+
+/// getConversionSource - If V converts a pointer in a specific address space
+/// to a generic one, return that pointer, otherwise null.
+static Value *getConversionSource(Value *V) {
+  if (Operator::getOpcode(V) == Instruction::AddrSpaceCast)
+    return cast<Operator>(V)->getOperand(0);
+
+  if (const IntrinsicInst *II = dyn_cast<IntrinsicInst>(V)) {
+    switch (II->getIntrinsicID()) {
+    default:
+      break;
+    case Intrinsic::nvvm_ptr_global_to_gen:
+    case Intrinsic::nvvm_ptr_shared_to_gen:
+    case Intrinsic::nvvm_ptr_local_to_gen:
+    case Intrinsic::nvvm_ptr_constant_to_gen:
+      return II->getArgOperand(0);
+    }
+  }
+  return 0;
+}
+
+/// getPointerOperands - Return the pointer operands through which V may get
+/// its address space. Values outside the dataflow have none.
+static SmallVector<Value *, 2> getPointerOperands(Value *V) {
+  SmallVector<Value *, 2> Ops;
+  switch (Operator::getOpcode(V)) {
+  case Instruction::GetElementPtr:
+  case Instruction::BitCast:
+    Ops.push_back(cast<Operator>(V)->getOperand(0));
+    break;
+  case Instruction::PHI: {
+    PHINode *PN = cast<PHINode>(V);
+    for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i)
+      Ops.push_back(PN->getIncomingValue(i));
+    break;
+  }
+  case Instruction::Select:
+    Ops.push_back(cast<SelectInst>(V)->getTrueValue());
+    Ops.push_back(cast<SelectInst>(V)->getFalseValue());
+    break;
+  default:
+    break;
+  }
+  return Ops;
+}
+
+/// collectPointerExpressions - Add the generic pointer V and, transitively,
+/// the generic pointers it is computed from to Postorder.
+void NVPTXInferAddressSpaces::collectPointerExpressions(Value *V) {
+  if (!isGenericPointer(V) || !Visited.insert(V))
+    return;
+  if (!getConversionSource(V)) {
+    SmallVector<Value *, 2> Ops = getPointerOperands(V);
+    for (unsigned i = 0, e = Ops.size(); i != e; ++i)
+      collectPointerExpressions(Ops[i]);
+  }
+  Postorder.push_back(V);
+}
+
+/// joinAddressSpaces - Meet of two lattice values: uninitialized, a specific
+/// address space, or generic.
+static unsigned joinAddressSpaces(unsigned AS1, unsigned AS2) {
+  if (AS1 == UninitializedAddressSpace)
+    return AS2;
+  if (AS2 == UninitializedAddressSpace)
+    return AS1;
+  return AS1 == AS2 ? AS1 : (unsigned)ADDRESS_SPACE_GENERIC;
+}
+
+unsigned NVPTXInferAddressSpaces::computeAddressSpace(Value *V) const {
+  if (Value *Src = getConversionSource(V))
+    return Src->getType()->getPointerAddressSpace();
+  if (isa<UndefValue>(V))
+    return UninitializedAddressSpace;
+
+  SmallVector<Value *, 2> Ops = getPointerOperands(V);
+  // Arguments, loaded pointers, calls, null, ...
+  if (Ops.empty())
+    return ADDRESS_SPACE_GENERIC;
+
+  unsigned AS = UninitializedAddressSpace;
+  for (unsigned i = 0, e = Ops.size(); i != e; ++i) {
+    DenseMap<Value *, unsigned>::const_iterator I = InferredAS.find(Ops[i]);
+    if (I == InferredAS.end())
+      return ADDRESS_SPACE_GENERIC;
+    AS = joinAddressSpaces(AS, I->second);
+  }
+  return AS;
+}
+
+/// cloneInAddressSpace - Return a pointer equal to V but typed in the address
+/// space inferred for it, creating the instructions or constants needed.
+Value *NVPTXInferAddressSpaces::cloneInAddressSpace(Value *V) {
+  DenseMap<Value *, Value *>::iterator CI = Clones.find(V);
+  if (CI != Clones.end())
+    return CI->second;
+
+  unsigned AS = InferredAS.lookup(V);
+  PointerType *NewTy =
+      PointerType::get(V->getType()->getPointerElementType(), AS);
+  Value *NewV = 0;
+
+  if (Value *Src = getConversionSource(V)) {
+    NewV = Src;
+    if (Src->getType() != NewTy) {
+      if (Constant *C = dyn_cast<Constant>(Src))
+        NewV = ConstantExpr::getBitCast(C, NewTy);
+      else
+        NewV = new BitCastInst(Src, NewTy, Src->getName() + ".cast",
+                               cast<Instruction>(V));
+    }
+  } else if (isa<UndefValue>(V)) {
+    NewV = UndefValue::get(NewTy);
+  } else if (PHINode *PN = dyn_cast<PHINode>(V)) {
+    // Register the clone before its operands to break cycles.
+    PHINode *NewPN = PHINode::Create(NewTy, PN->getNumIncomingValues(),
+                                     PN->getName() + ".as", PN);
+    Clones[V] = NewPN;
+    for (unsigned i = 0, e = PN->getNumIncomingValues(); i != e; ++i)
+      NewPN->addIncoming(cloneInAddressSpace(PN->getIncomingValue(i)),
+                         PN->getIncomingBlock(i));
+    return NewPN;
+  } else if (SelectInst *SI = dyn_cast<SelectInst>(V)) {
+    NewV = SelectInst::Create(SI->getCondition(),
+                              cloneInAddressSpace(SI->getTrueValue()),
+                              cloneInAddressSpace(SI->getFalseValue()),
+                              SI->getName() + ".as", SI);
+  } else if (GEPOperator *GEP = dyn_cast<GEPOperator>(V)) {
+    Value *NewPtr = cloneInAddressSpace(GEP->getPointerOperand());
+    SmallVector<Value *, 4> Indices(GEP->idx_begin(), GEP->idx_end());
+    if (GetElementPtrInst *GEPI = dyn_cast<GetElementPtrInst>(V)) {
+      GetElementPtrInst *NewGEP =
+          GetElementPtrInst::Create(NewPtr, Indices, GEPI->getName() + ".as",
+                                    GEPI);
+      NewGEP->setIsInBounds(GEPI->isInBounds());
+      NewV = NewGEP;
+    } else {
+      SmallVector<Constant *, 4> CIndices;
+      for (unsigned i = 0, e = Indices.size(); i != e; ++i)
+        CIndices.push_back(cast<Constant>(Indices[i]));
+      NewV = ConstantExpr::getGetElementPtr(cast<Constant>(NewPtr), CIndices,
+                                            GEP->isInBounds());
+    }
+  } else {
+    assert(Operator::getOpcode(V) == Instruction::BitCast &&
+           "Unexpected pointer expression");
+    Value *NewPtr = cloneInAddressSpace(cast<Operator>(V)->getOperand(0));
+    if (BitCastInst *BC = dyn_cast<BitCastInst>(V))
+      NewV = new BitCastInst(NewPtr, NewTy, BC->getName() + ".as", BC);
+    else
+      NewV = ConstantExpr::getBitCast(cast<Constant>(NewPtr), NewTy);
+  }
+
+  Clones[V] = NewV;
+  return NewV;
+}
+
+bool NVPTXInferAddressSpaces::runOnFunction(Function &F) {
+  Postorder.clear();
+  Visited.clear();
+  InferredAS.clear();
+  Clones.clear();
+
+  // Find the generic pointers that loads and stores go through.
+  SmallVector<Instruction *, 32> Accesses;
+  for (Function::iterator BB = F.begin(), BE = F.end(); BB != BE; ++BB) {
+    for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+      Value *Ptr = 0;
+      if (LoadInst *LI = dyn_cast<LoadInst>(I))
+        Ptr = LI->getPointerOperand();
+      else if (StoreInst *SI = dyn_cast<StoreInst>(I))
+        Ptr = SI->getPointerOperand();
+      if (!Ptr || !isGenericPointer(Ptr))
+        continue;
+      Accesses.push_back(I);
+      collectPointerExpressions(Ptr);
+    }
+  }
+  if (Accesses.empty())
+    return false;
+
+  // Iterate to a fixed point. Each value can only move down the lattice twice,
+  // so this terminates quickly.
+  for (unsigned i = 0, e = Postorder.size(); i != e; ++i)
+    InferredAS[Postorder[i]] = UninitializedAddressSpace;
+  bool Changed;
+  do {
+    Changed = false;
+    for (unsigned i = 0, e = Postorder.size(); i != e; ++i) {
+      Value *V = Postorder[i];
+      unsigned OldAS = InferredAS[V];
+      unsigned NewAS = joinAddressSpaces(OldAS, computeAddressSpace(V));
+      if (NewAS != OldAS) {
+        InferredAS[V] = NewAS;
+        Changed = true;
+      }
+    }
+  } while (Changed);
+
+  // Point each access at a specific-space version of its address.
+  SmallVector<WeakVH, 32> DeadCandidates;
+  for (unsigned i = 0, e = Accesses.size(); i != e; ++i) {
+    Instruction *I = Accesses[i];
+    unsigned OpNo = isa<LoadInst>(I) ? LoadInst::getPointerOperandIndex()
+                                     : StoreInst::getPointerOperandIndex();
+    Value *Ptr = I->getOperand(OpNo);
+    unsigned AS = InferredAS.lookup(Ptr);
+    if (AS == ADDRESS_SPACE_GENERIC || AS == UninitializedAddressSpace)
+      continue;
+
+    DEBUG(dbgs() << "Accessing " << *Ptr << " in address space " << AS
+                 << "\n");
+    I->setOperand(OpNo, cloneInAddressSpace(Ptr));
+    DeadCandidates.push_back(Ptr);
+    ++NumAccessesInferred;
+  }
+  if (DeadCandidates.empty())
+    return false;
+
+  // The generic expressions may now be unused.
+  for (unsigned i = 0, e = DeadCandidates.size(); i != e; ++i) {
+    Value *V = DeadCandidates[i];
+    if (!V)
+      continue;
+    if (PHINode *PN = dyn_cast<PHINode>(V))
+      RecursivelyDeleteDeadPHINode(PN);
+    else
+      RecursivelyDeleteTriviallyDeadInstructions(V);
+  }
+  return true;
+}
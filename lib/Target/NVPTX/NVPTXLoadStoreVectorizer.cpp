@@ -0,0 +1,343 @@
+//===-- NVPTXLoadStoreVectorizer.cpp - Merge adjacent loads and stores ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// PTX has v2 and v4 forms of ld and st, but instruction selection only uses
+// them for accesses that already have a vector type. This pass merges scalar
+// loads (or stores) of the same type from consecutive addresses in a basic
+// block into one vector access, e.g.
+//
+//   %x = load float addrspace(1)* %p, align 8
+//   %y = load float addrspace(1)* %p.1, align 4
+//
+// becomes
+//
+//   %v = load <2 x float> addrspace(1)* %p.vec, align 8
+//   %x = extractelement <2 x float> %v, i32 0
+//   %y = extractelement <2 x float> %v, i32 1
+//
+// The first access must be aligned to the size of the vector, and alias
+// analysis must show that moving the accesses together is safe.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "nvptx-vectorize-ldst"
+
+#include "NVPTX.h"
+#include "MCTargetDesc/NVPTXBaseInfo.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+
+using namespace llvm;
+
+STATISTIC(NumVectorLoads, "Number of vector loads formed");
+STATISTIC(NumVectorStores, "Number of vector stores formed");
+STATISTIC(NumScalarsMerged, "Number of scalar loads/stores merged");
+
+namespace llvm {
+void initializeNVPTXLoadStoreVectorizerPass(PassRegistry &);
+}
+
+namespace {
+/// MemAccess - A simple load or store at a constant offset from a base.
+struct MemAccess {
+  Instruction *I;
+  int64_t Offset;
+  unsigned Position;
+  MemAccess(Instruction *I, int64_t Offset, unsigned Position)
+      : I(I), Offset(Offset), Position(Position) {}
+};
+
+struct OffsetCompare {
+  bool operator()(const MemAccess &LHS, const MemAccess &RHS) const {
+    if (LHS.Offset != RHS.Offset)
+      return LHS.Offset < RHS.Offset;
+    return LHS.Position < RHS.Position;
+  }
+};
+
+class NVPTXLoadStoreVectorizer : public FunctionPass {
+public:
+  static char ID;
+
+  NVPTXLoadStoreVectorizer() : FunctionPass(ID), TD(0), AA(0) {}
+
+  virtual bool runOnFunction(Function &F);
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<AliasAnalysis>();
+    AU.setPreservesCFG();
+  }
+
+  virtual const char *getPassName() const {
+    return "NVPTX load/store vectorizer";
+  }
+
+private:
+  typedef SmallVector<MemAccess, 8> AccessList;
+  typedef MapVector<std::pair<Value *, Type *>, AccessList> AccessMap;
+
+  bool vectorizeBlock(BasicBlock &BB);
+  bool vectorizeChains(AccessMap &Map, bool IsStore);
+  bool isSafeToMerge(ArrayRef<MemAccess> Chain, bool IsStore);
+  void mergeLoads(ArrayRef<MemAccess> Chain);
+  void mergeStores(ArrayRef<MemAccess> Chain);
+  unsigned getAlignment(Instruction *I) const;
+
+  const DataLayout *TD;
+  AliasAnalysis *AA;
+  // Position of every instruction of the block being vectorized.
+  DenseMap<Instruction *, unsigned> Positions;
+  SmallVector<Instruction *, 64> Insts;
+};
+}
+
+char NVPTXLoadStoreVectorizer::ID = 0;
+
+INITIALIZE_PASS_BEGIN(NVPTXLoadStoreVectorizer, "nvptx-vectorize-ldst",
+                      "Merge adjacent loads and stores into vector accesses",
+                      false, false)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_END(NVPTXLoadStoreVectorizer, "nvptx-vectorize-ldst",
+                    "Merge adjacent loads and stores into vector accesses",
+                    false, false)
+
+FunctionPass *llvm::createNVPTXLoadStoreVectorizerPass() {
+  return new NVPTXLoadStoreVectorizer();
+}
+
+/// isVectorizableType - PTX has vector loads and stores of two elements of up
+/// to 64 bits, and of four elements of up to 32 bits.
+static bool isVectorizableType(Type *Ty) {
+  return Ty->isIntegerTy(8) || Ty->isIntegerTy(16) || Ty->isIntegerTy(32) ||
+         Ty->isIntegerTy(64) || Ty->isFloatTy() || Ty->isDoubleTy();
+}
+
+unsigned NVPTXLoadStoreVectorizer::getAlignment(Instruction *I) const {
+  unsigned Align;
+  Type *Ty;
+  if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    Align = LI->getAlignment();
+    Ty = LI->getType();
+  } else {
+    StoreInst *SI = cast<StoreInst>(I);
+    Align = SI->getAlignment();
+    Ty = SI->getValueOperand()->getType();
+  }
+  return Align ? Align : TD->getABITypeAlignment(Ty);
+}
+
+bool NVPTXLoadStoreVectorizer::runOnFunction(Function &F) {
+  TD = getAnalysisIfAvailable<DataLayout>();
+  if (!TD)
+    return false;
+  AA = &getAnalysis<AliasAnalysis>();
+
+  bool Changed = false;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    while (vectorizeBlock(*BB))
+      Changed = true;
+  return Changed;
+}
+
+/// vectorizeBlock - Form at most one vector access in BB. Returns true if it
+/// did, in which case the block has to be rescanned.
+bool NVPTXLoadStoreVectorizer::vectorizeBlock(BasicBlock &BB) {
+  Positions.clear();
+  Insts.clear();
+  AccessMap Loads, Stores;
+
+  for (BasicBlock::iterator I = BB.begin(), E = BB.end(); I != E; ++I) {
+    Positions[I] = Insts.size();
+    Insts.push_back(I);
+
+    Value *Ptr;
+    Type *Ty;
+    bool IsStore;
+    if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+      if (!LI->isSimple())
+        continue;
+      Ptr = LI->getPointerOperand();
+      Ty = LI->getType();
+      IsStore = false;
+    } else if (StoreInst *SI = dyn_cast<StoreInst>(I)) {
+      if (!SI->isSimple())
+        continue;
+      Ptr = SI->getPointerOperand();
+      Ty = SI->getValueOperand()->getType();
+      IsStore = true;
+    } else
+      continue;
+
+    if (!isVectorizableType(Ty) ||
+        Ptr->getType()->getPointerAddressSpace() == ADDRESS_SPACE_PARAM)
+      continue;
+
+    int64_t Offset = 0;
+    Value *Base = GetPointerBaseWithConstantOffset(Ptr, Offset, TD);
+    AccessMap &Map = IsStore ? Stores : Loads;
+    Map[std::make_pair(Base, Ty)].push_back(
+        MemAccess(I, Offset, Positions[I]));
+  }
+
+  return vectorizeChains(Loads, false) || vectorizeChains(Stores, true);
+}
+
+bool NVPTXLoadStoreVectorizer::vectorizeChains(AccessMap &Map, bool IsStore) {
+  for (AccessMap::iterator MI = Map.begin(), ME = Map.end(); MI != ME; ++MI) {
+    AccessList &Accesses = MI->second;
+    if (Accesses.size() < 2)
+      continue;
+    std::sort(Accesses.begin(), Accesses.end(), OffsetCompare());
+
+    Type *Ty = MI->first.second;
+    int64_t EltBytes = TD->getTypeStoreSize(Ty);
+    unsigned MaxElts = EltBytes == 8 ? 2 : 4;
+
+    for (unsigned i = 0, e = Accesses.size(); i != e; ++i) {
+      unsigned Align = getAlignment(Accesses[i].I);
+      // Try the widest access first.
+      for (unsigned NumElts = MaxElts; NumElts >= 2; NumElts /= 2) {
+        if (i + NumElts > e || Align < NumElts * EltBytes)
+          continue;
+        bool Consecutive = true;
+        for (unsigned k = 1; k != NumElts && Consecutive; ++k)
+          Consecutive = Accesses[i + k].Offset ==
+                        Accesses[i].Offset + (int64_t)k * EltBytes;
+        if (!Consecutive)
+          continue;
+
+        ArrayRef<MemAccess> Chain(&Accesses[i], NumElts);
+        if (!isSafeToMerge(Chain, IsStore))
+          continue;
+
+        if (IsStore)
+          mergeStores(Chain);
+        else
+          mergeLoads(Chain);
+        NumScalarsMerged += NumElts;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/// isSafeToMerge - Loads are merged at the position of the first one and
+/// stores at the position of the last one, so no memory access in between may
+/// conflict with an access that moves across it.
+bool NVPTXLoadStoreVectorizer::isSafeToMerge(ArrayRef<MemAccess> Chain,
+                                             bool IsStore) {
+  unsigned First = Chain[0].Position, Last = Chain[0].Position;
+  for (unsigned i = 1, e = Chain.size(); i != e; ++i) {
+    First = std::min(First, Chain[i].Position);
+    Last = std::max(Last, Chain[i].Position);
+  }
+
+  // The address of the lowest element is the address of the vector. For
+  // loads it has to be available where the vector load goes.
+  if (!IsStore) {
+    Instruction *Ptr = dyn_cast<Instruction>(
+        cast<LoadInst>(Chain[0].I)->getPointerOperand());
+    if (Ptr && Ptr->getParent() == Chain[0].I->getParent() &&
+        Positions.lookup(Ptr) >= First)
+      return false;
+  }
+
+  for (unsigned Pos = First + 1; Pos < Last; ++Pos) {
+    Instruction *I = Insts[Pos];
+    if (IsStore ? !I->mayReadOrWriteMemory() : !I->mayWriteToMemory())
+      continue;
+    for (unsigned i = 0, e = Chain.size(); i != e; ++i) {
+      const MemAccess &A = Chain[i];
+      if (A.I == I)
+        continue;
+      // Only accesses that move across I matter: later loads move up, earlier
+      // stores move down.
+      if (IsStore ? A.Position > Pos : A.Position < Pos)
+        continue;
+      AliasAnalysis::Location Loc =
+          IsStore ? AA->getLocation(cast<StoreInst>(A.I))
+                  : AA->getLocation(cast<LoadInst>(A.I));
+      AliasAnalysis::ModRefResult MR = AA->getModRefInfo(I, Loc);
+      if (IsStore ? MR != AliasAnalysis::NoModRef : (MR & AliasAnalysis::Mod))
+        return false;
+    }
+  }
+  return true;
+}
+
+void NVPTXLoadStoreVectorizer::mergeLoads(ArrayRef<MemAccess> Chain) {
+  Instruction *First = Chain[0].I;
+  for (unsigned i = 1, e = Chain.size(); i != e; ++i)
+    if (Chain[i].Position < Positions[First])
+      First = Chain[i].I;
+
+  LoadInst *LI0 = cast<LoadInst>(Chain[0].I);
+  Value *Ptr = LI0->getPointerOperand();
+  VectorType *VecTy = VectorType::get(LI0->getType(), Chain.size());
+  unsigned AS = Ptr->getType()->getPointerAddressSpace();
+
+  IRBuilder<> Builder(First);
+  Value *VecPtr = Builder.CreateBitCast(Ptr, VecTy->getPointerTo(AS));
+  LoadInst *VecLoad = Builder.CreateAlignedLoad(VecPtr, getAlignment(LI0),
+                                                LI0->getName() + ".vec");
+  DEBUG(dbgs() << "Formed " << *VecLoad << "\n");
+
+  // The builder inserts before one of the scalar loads, so erase them only
+  // once all the extracts exist.
+  SmallVector<Value *, 4> Elts;
+  for (unsigned i = 0, e = Chain.size(); i != e; ++i)
+    Elts.push_back(Builder.CreateExtractElement(VecLoad, Builder.getInt32(i),
+                                                Chain[i].I->getName()));
+  for (unsigned i = 0, e = Chain.size(); i != e; ++i) {
+    Chain[i].I->replaceAllUsesWith(Elts[i]);
+    Chain[i].I->eraseFromParent();
+  }
+  ++NumVectorLoads;
+}
+
+void NVPTXLoadStoreVectorizer::mergeStores(ArrayRef<MemAccess> Chain) {
+  Instruction *Last = Chain[0].I;
+  for (unsigned i = 1, e = Chain.size(); i != e; ++i)
+    if (Chain[i].Position > Positions[Last])
+      Last = Chain[i].I;
+
+  StoreInst *SI0 = cast<StoreInst>(Chain[0].I);
+  Value *Ptr = SI0->getPointerOperand();
+  VectorType *VecTy =
+      VectorType::get(SI0->getValueOperand()->getType(), Chain.size());
+  unsigned AS = Ptr->getType()->getPointerAddressSpace();
+
+  IRBuilder<> Builder(Last);
+  Value *Vec = UndefValue::get(VecTy);
+  for (unsigned i = 0, e = Chain.size(); i != e; ++i)
+    Vec = Builder.CreateInsertElement(
+        Vec, cast<StoreInst>(Chain[i].I)->getValueOperand(),
+        Builder.getInt32(i));
+  Value *VecPtr = Builder.CreateBitCast(Ptr, VecTy->getPointerTo(AS));
+  StoreInst *VecStore =
+      Builder.CreateAlignedStore(Vec, VecPtr, getAlignment(SI0));
+  DEBUG(dbgs() << "Formed " << *VecStore << "\n");
+  (void)VecStore;
+
+  for (unsigned i = 0, e = Chain.size(); i != e; ++i)
+    Chain[i].I->eraseFromParent();
+  ++NumVectorStores;
+}
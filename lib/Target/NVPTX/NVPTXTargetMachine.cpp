@@ -50,6 +50,8 @@ using namespace llvm;
 namespace llvm {
 void initializeNVVMReflectPass(PassRegistry&);
 void initializeGenericToNVVMPass(PassRegistry&);
+void initializeNVPTXInferAddressSpacesPass(PassRegistry&);
+void initializeNVPTXLoadStoreVectorizerPass(PassRegistry&);
 }
 
 extern "C" void LLVMInitializeNVPTXTarget() {
@@ -61,6 +63,8 @@ extern "C" void LLVMInitializeNVPTXTarget() {
   // but it's very NVPTX-specific.
   initializeNVVMReflectPass(*PassRegistry::getPassRegistry());
   initializeGenericToNVVMPass(*PassRegistry::getPassRegistry());
+  initializeNVPTXInferAddressSpacesPass(*PassRegistry::getPassRegistry());
+  initializeNVPTXLoadStoreVectorizerPass(*PassRegistry::getPassRegistry());
 }
 
 NVPTXTargetMachine::NVPTXTargetMachine(
@@ -130,6 +134,13 @@ void NVPTXPassConfig::addIRPasses() {
 
   TargetPassConfig::addIRPasses();
   addPass(createGenericToNVVMPass());
+
+  // Move accesses out of the generic address space before merging them, so
+  // that the vector accesses are formed on the final addresses.
+  if (getOptLevel() != CodeGenOpt::None) {
+    addPass(createNVPTXInferAddressSpacesPass());
+    addPass(createNVPTXLoadStoreVectorizerPass());
+  }
 }
 
 bool NVPTXPassConfig::addInstSelector() {
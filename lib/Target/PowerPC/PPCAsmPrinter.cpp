@@ -849,6 +849,7 @@ void PPCDarwinAsmPrinter::EmitStartOfAsmFile(Module &M) {
     "power6",
     "power6x",
     "power7",
+    "power8",
     "ppc64",
     "ppc64le"
   };
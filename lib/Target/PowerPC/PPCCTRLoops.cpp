@@ -19,7 +19,8 @@
 //  - Countable loops (w/ ind. var for a trip count)
 //  - Try inner-most loops first
 //  - No nested CTR loops.
-//  - No function calls in loops.
+//  - No function calls in loops (except calls that never return, and
+//    memory intrinsics that are small enough to be expanded inline).
 //
 //===----------------------------------------------------------------------===//
 
@@ -186,6 +187,29 @@ bool PPCCTRLoops::runOnFunction(Function &F) {
   return MadeChange;
 }
 
+/// isExpandedInline - Return true if the selection DAG always turns this
+/// memory intrinsic into loads and stores rather than a library call.
+static bool isExpandedInline(const MemIntrinsic *MI,
+                             const TargetLowering *TLI) {
+  const ConstantInt *Len = dyn_cast<ConstantInt>(MI->getLength());
+  if (!Len)
+    return false;
+
+  bool OptSize = MI->getParent()->getParent()->getAttributes().
+    hasAttribute(AttributeSet::FunctionIndex, Attribute::OptimizeForSize);
+  unsigned Limit;
+  if (isa<MemSetInst>(MI))
+    Limit = TLI->getMaxStoresPerMemset(OptSize);
+  else if (isa<MemMoveInst>(MI))
+    Limit = TLI->getMaxStoresPerMemmove(OptSize);
+  else
+    Limit = TLI->getMaxStoresPerMemcpy(OptSize);
+
+  // Every store writes at least one byte, so a length within the store limit
+  // is expanded whatever the alignment.
+  return Len->getValue().ule(Limit);
+}
+
 bool PPCCTRLoops::mightUseCTR(const Triple &TT, BasicBlock *BB) {
   for (BasicBlock::iterator J = BB->begin(), JE = BB->end();
        J != JE; ++J) {
@@ -204,6 +228,11 @@ bool PPCCTRLoops::mightUseCTR(const Triple &TT, BasicBlock *BB) {
         continue;
       }
 
+      // A call that does not return cannot clobber the counter register of a
+      // loop it never comes back to.
+      if (CI->doesNotReturn() && isa<UnreachableInst>(llvm::next(J)))
+        continue;
+
       if (!TM)
         return true;
       const TargetLowering *TLI = TM->getTargetLowering();
@@ -243,6 +272,9 @@ bool PPCCTRLoops::mightUseCTR(const Triple &TT, BasicBlock *BB) {
           case Intrinsic::memcpy:
           case Intrinsic::memmove:
           case Intrinsic::memset:
+            if (isExpandedInline(cast<MemIntrinsic>(CI), TLI))
+              continue;
+            return true;
           case Intrinsic::powi:
           case Intrinsic::log:
           case Intrinsic::log2:
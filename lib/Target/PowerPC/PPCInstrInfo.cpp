@@ -74,9 +74,11 @@ ScheduleHazardRecognizer *PPCInstrInfo::CreateTargetPostRAHazardRecognizer(
   const ScheduleDAG *DAG) const {
   unsigned Directive = TM.getSubtarget<PPCSubtarget>().getDarwinDirective();
 
-  // Most subtargets use a PPC970 recognizer.
+  // Most subtargets use a PPC970 recognizer. The POWER8 does not form
+  // 970-style dispatch groups, so it uses its itineraries instead.
   if (Directive != PPC::DIR_440 && Directive != PPC::DIR_A2 &&
-      Directive != PPC::DIR_E500mc && Directive != PPC::DIR_E5500) {
+      Directive != PPC::DIR_E500mc && Directive != PPC::DIR_E5500 &&
+      Directive != PPC::DIR_PWR8) {
     assert(TM.getInstrInfo() && "No InstrInfo?");
 
     return new PPCHazardRecognizer970(TM);
@@ -78,6 +78,8 @@ public:
   /// @{
   virtual PopcntSupportKind getPopcntSupport(unsigned TyWidth) const;
   virtual void getUnrollingPreferences(Loop *L, UnrollingPreferences &UP) const;
+  virtual unsigned getCacheLineSize() const;
+  virtual unsigned getCacheMissLatency() const;
 
   /// @}
 
@@ -138,6 +140,39 @@ void PPCTTI::getUnrollingPreferences(Loop *L, UnrollingPreferences &UP) const {
   }
 }
 
+unsigned PPCTTI::getCacheLineSize() const {
+  switch (ST->getDarwinDirective()) {
+  case PPC::DIR_970:
+  case PPC::DIR_PWR3:
+  case PPC::DIR_PWR4:
+  case PPC::DIR_PWR5:
+  case PPC::DIR_PWR5X:
+  case PPC::DIR_PWR6:
+  case PPC::DIR_PWR6X:
+  case PPC::DIR_PWR7:
+  case PPC::DIR_PWR8:
+  case PPC::DIR_64:
+    // The server cores all use 128-byte cache lines.
+    return 128;
+  case PPC::DIR_A2:
+  case PPC::DIR_E500mc:
+  case PPC::DIR_E5500:
+    return 64;
+  default:
+    return 32;
+  }
+}
+
+unsigned PPCTTI::getCacheMissLatency() const {
+  // Software prefetching is only enabled for the recent server cores. A miss
+  // to memory costs them a few hundred cycles; the other cores are left to
+  // their hardware prefetchers.
+  unsigned Directive = ST->getDarwinDirective();
+  if (Directive == PPC::DIR_PWR7 || Directive == PPC::DIR_PWR8)
+    return 400;
+  return 0;
+}
+
 unsigned PPCTTI::getNumberOfRegisters(bool Vector) const {
   if (Vector && !ST->hasAltivec())
     return 0;
@@ -255,6 +255,17 @@ void AMDGPUAsmPrinter::EmitProgramInfoSI(MachineFunction &MF) {
   if (VCCUsed) {
     MaxSGPR += 2;
   }
+
+  if (isVerbose() && OutStreamer.hasRawTextSupport()) {
+    unsigned NumVGPRs = MaxVGPR + 1;
+    unsigned NumSGPRs = MaxSGPR + 1;
+    unsigned Waves = std::min(SIRegisterInfo::getNumWavesForVGPRs(NumVGPRs),
+                              SIRegisterInfo::getNumWavesForSGPRs(NumSGPRs));
+    OutStreamer.EmitRawText("; NumVgprs: " + Twine(NumVGPRs));
+    OutStreamer.EmitRawText("; NumSgprs: " + Twine(NumSGPRs));
+    OutStreamer.EmitRawText("; Occupancy: " + Twine(Waves) +
+                            " waves per SIMD");
+  }
   SIMachineFunctionInfo * MFI = MF.getInfo<SIMachineFunctionInfo>();
   unsigned RsrcReg;
   switch (MFI->ShaderType) {
@@ -16,9 +16,24 @@
 #include "SIRegisterInfo.h"
 #include "AMDGPUTargetMachine.h"
 #include "SIInstrInfo.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MathExtras.h"
 
 using namespace llvm;
 
+static cl::opt<unsigned> TargetWaves("si-target-waves", cl::Hidden,
+  cl::desc("Number of waves per SIMD that SI scheduling tries to keep "
+           "register usage low enough for"),
+  cl::init(4));
+
+// Each SIMD has 256 VGPRs per lane and 512 SGPRs, and can hold at most 10
+// waves.  VGPRs are allocated in blocks of 4 and SGPRs in blocks of 8, and a
+// single wave can address at most 104 SGPRs.
+static const unsigned MaxWavesPerSIMD = 10;
+static const unsigned NumVGPRsPerSIMD = 256;
+static const unsigned NumSGPRsPerSIMD = 512;
+static const unsigned MaxSGPRsPerWave = 104;
+
 SIRegisterInfo::SIRegisterInfo(AMDGPUTargetMachine &tm)
 : AMDGPURegisterInfo(tm),
   TM(tm)
@@ -33,9 +48,63 @@ BitVector SIRegisterInfo::getReservedRegs(const MachineFunction &MF) const {
   return Reserved;
 }
 
+unsigned SIRegisterInfo::getNumWavesForVGPRs(unsigned NumVGPRs) {
+  if (NumVGPRs == 0)
+    return MaxWavesPerSIMD;
+  return std::min(MaxWavesPerSIMD,
+                  NumVGPRsPerSIMD / (unsigned)RoundUpToAlignment(NumVGPRs, 4));
+}
+
+unsigned SIRegisterInfo::getNumWavesForSGPRs(unsigned NumSGPRs) {
+  if (NumSGPRs == 0)
+    return MaxWavesPerSIMD;
+  return std::min(MaxWavesPerSIMD,
+                  NumSGPRsPerSIMD / (unsigned)RoundUpToAlignment(NumSGPRs, 8));
+}
+
+unsigned SIRegisterInfo::getMaxVGPRsForWaves(unsigned NumWaves) {
+  NumWaves = std::max(1U, std::min(NumWaves, MaxWavesPerSIMD));
+  return (NumVGPRsPerSIMD / NumWaves) & ~3U;
+}
+
+unsigned SIRegisterInfo::getMaxSGPRsForWaves(unsigned NumWaves) {
+  NumWaves = std::max(1U, std::min(NumWaves, MaxWavesPerSIMD));
+  return std::min(MaxSGPRsPerWave, (NumSGPRsPerSIMD / NumWaves) & ~7U);
+}
+
+unsigned SIRegisterInfo::getTargetWaves() {
+  return TargetWaves;
+}
+
 unsigned SIRegisterInfo::getRegPressureLimit(const TargetRegisterClass *RC,
                                              MachineFunction &MF) const {
-  return RC->getNumRegs();
+  unsigned Budget;
+  if (isSGPRClass(RC)) {
+    Budget = getMaxSGPRsForWaves(TargetWaves);
+  } else if (RC->hasSubClassEq(&AMDGPU::SReg_32RegClass) ||
+             RC->hasSubClassEq(&AMDGPU::SReg_64RegClass)) {
+    // VSrc classes hold either kind of register.
+    Budget = getMaxVGPRsForWaves(TargetWaves) +
+             getMaxSGPRsForWaves(TargetWaves);
+  } else {
+    Budget = getMaxVGPRsForWaves(TargetWaves);
+  }
+
+  // The limit is counted in registers of RC, so wide classes get a
+  // proportionally smaller share of the budget.
+  unsigned Width = std::max(1U, RC->getSize() / 4);
+  return std::min(RC->getNumRegs(), std::max(1U, Budget / Width));
+}
+
+unsigned SIRegisterInfo::getRegPressureSetLimit(unsigned Idx) const {
+  // The first pressure set of a register class is the smallest one that
+  // contains it, which for the 32-bit classes tracks exactly one kind of
+  // register.
+  if (Idx == (unsigned)*getRegClassPressureSets(&AMDGPU::VReg_32RegClass))
+    return getMaxVGPRsForWaves(TargetWaves);
+  if (Idx == (unsigned)*getRegClassPressureSets(&AMDGPU::SGPR_32RegClass))
+    return getMaxSGPRsForWaves(TargetWaves);
+  return AMDGPURegisterInfo::getRegPressureSetLimit(Idx);
 }
 
 const TargetRegisterClass *
@@ -29,9 +29,33 @@ struct SIRegisterInfo : public AMDGPURegisterInfo {
 
   virtual BitVector getReservedRegs(const MachineFunction &MF) const;
 
+  /// \brief Limit register pressure so that the scheduler keeps enough
+  /// registers free for the targeted number of waves per SIMD.
   virtual unsigned getRegPressureLimit(const TargetRegisterClass *RC,
                                        MachineFunction &MF) const;
 
+  virtual unsigned getRegPressureSetLimit(unsigned Idx) const;
+
+  /// \returns the number of waves per SIMD the hardware can launch when each
+  /// wave uses \p NumVGPRs vector registers.
+  static unsigned getNumWavesForVGPRs(unsigned NumVGPRs);
+
+  /// \returns the number of waves per SIMD the hardware can launch when each
+  /// wave uses \p NumSGPRs scalar registers.
+  static unsigned getNumWavesForSGPRs(unsigned NumSGPRs);
+
+  /// \returns the largest number of vector registers a wave can use while
+  /// still allowing \p NumWaves waves per SIMD.
+  static unsigned getMaxVGPRsForWaves(unsigned NumWaves);
+
+  /// \returns the largest number of scalar registers a wave can use while
+  /// still allowing \p NumWaves waves per SIMD.
+  static unsigned getMaxSGPRsForWaves(unsigned NumWaves);
+
+  /// \returns the number of waves per SIMD the scheduler tries to keep
+  /// register usage low enough for.
+  static unsigned getTargetWaves();
+
   /// \param RC is an AMDIL reg class.
   ///
   /// \returns the SI register class that is equivalent to \p RC.
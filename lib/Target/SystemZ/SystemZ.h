@@ -21,6 +21,7 @@
 namespace llvm {
   class SystemZTargetMachine;
   class FunctionPass;
+  class ImmutablePass;
 
   namespace SystemZ {
     // Condition-code mask values.
@@ -111,5 +112,9 @@ namespace llvm {
   FunctionPass *createSystemZElimComparePass(SystemZTargetMachine &TM);
   FunctionPass *createSystemZShortenInstPass(SystemZTargetMachine &TM);
   FunctionPass *createSystemZLongBranchPass(SystemZTargetMachine &TM);
+
+  /// \brief Creates a SystemZ-specific Target Transformation Info pass.
+  ImmutablePass *
+  createSystemZTargetTransformInfoPass(const SystemZTargetMachine *TM);
 } // end namespace llvm;
 #endif
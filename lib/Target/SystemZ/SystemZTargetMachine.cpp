@@ -9,6 +9,7 @@
 
 #include "SystemZTargetMachine.h"
 #include "llvm/CodeGen/Passes.h"
+#include "llvm/PassManager.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Transforms/Scalar.h"
 
@@ -37,6 +38,14 @@ SystemZTargetMachine::SystemZTargetMachine(const Target &T, StringRef TT,
   initAsmInfo();
 }
 
+void SystemZTargetMachine::addAnalysisPasses(PassManagerBase &PM) {
+  // Add first the target-independent BasicTTI pass, then our SystemZ pass.
+  // This allows the SystemZ pass to delegate to the target independent layer
+  // when appropriate.
+  PM.add(createBasicTargetTransformInfoPass(this));
+  PM.add(createSystemZTargetTransformInfoPass(this));
+}
+
 namespace {
 /// SystemZ Code Generator Pass Configuration Options.
 class SystemZPassConfig : public TargetPassConfig {
@@ -67,6 +67,7 @@ public:
 
   // Override LLVMTargetMachine
   virtual TargetPassConfig *createPassConfig(PassManagerBase &PM) LLVM_OVERRIDE;
+  virtual void addAnalysisPasses(PassManagerBase &PM) LLVM_OVERRIDE;
 };
 
 } // end namespace llvm
@@ -0,0 +1,237 @@
+//===-- SystemZTargetTransformInfo.cpp - SystemZ specific TTI pass --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements a TargetTransformInfo analysis pass specific to the
+/// SystemZ target machine. It uses the target's detailed information to
+/// provide more precise answers to certain TTI queries, while letting the
+/// target independent and default TTI implementations handle the rest.
+///
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "systemztti"
+#include "SystemZ.h"
+#include "SystemZTargetMachine.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/Debug.h"
+using namespace llvm;
+
+// Declare the pass initialization routine locally as target-specific passes
+// don't have a target-wide initialization entry point, and so we rely on the
+// pass constructor initialization.
+namespace llvm {
+void initializeSystemZTTIPass(PassRegistry &);
+}
+
+namespace {
+
+class SystemZTTI : public ImmutablePass, public TargetTransformInfo {
+  const SystemZSubtarget *ST;
+
+public:
+  SystemZTTI() : ImmutablePass(ID), ST(0) {
+    llvm_unreachable("This pass cannot be directly constructed");
+  }
+
+  SystemZTTI(const SystemZTargetMachine *TM)
+      : ImmutablePass(ID), ST(TM->getSubtargetImpl()) {
+    initializeSystemZTTIPass(*PassRegistry::getPassRegistry());
+  }
+
+  virtual void initializePass() {
+    pushTTIStack(this);
+  }
+
+  virtual void finalizePass() {
+    popTTIStack();
+  }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    TargetTransformInfo::getAnalysisUsage(AU);
+  }
+
+  /// Pass identification.
+  static char ID;
+
+  /// Provide necessary pointer adjustments for the two base classes.
+  virtual void *getAdjustedAnalysisPointer(const void *ID) {
+    if (ID == &TargetTransformInfo::ID)
+      return (TargetTransformInfo*)this;
+    return this;
+  }
+
+  /// \name Scalar TTI Implementations
+  /// @{
+
+  virtual unsigned getUserCost(const User *U) const;
+
+  virtual bool isLoweredToCall(const Function *F) const;
+
+  virtual PopcntSupportKind getPopcntSupport(unsigned TyWidth) const {
+    // CTPOP is expanded; the backend does not use the z196 POPCNT
+    // instruction, which only counts the bits within each byte.
+    return PSK_Software;
+  }
+
+  virtual unsigned getIntImmCost(const APInt &Imm, Type *Ty) const;
+
+  /// @}
+
+  /// \name Vector TTI Implementations
+  /// @{
+
+  virtual unsigned getNumberOfRegisters(bool Vector) const {
+    if (Vector)
+      return 0;
+    return 16;
+  }
+
+  virtual unsigned getRegisterBitWidth(bool Vector) const {
+    if (Vector)
+      return 0;
+    return 64;
+  }
+
+  virtual unsigned getMaximumUnrollFactor() const {
+    // The distinct-operands facility came with the out-of-order z196, which
+    // can overlap two independent copies of a loop body.
+    if (ST->hasDistinctOps())
+      return 2;
+    return 1;
+  }
+
+  virtual unsigned getCmpSelInstrCost(unsigned Opcode, Type *ValTy,
+                                      Type *CondTy) const;
+
+  virtual unsigned getMemoryOpCost(unsigned Opcode, Type *Src,
+                                   unsigned Alignment,
+                                   unsigned AddressSpace) const;
+
+  /// @}
+};
+
+} // end anonymous namespace
+
+INITIALIZE_AG_PASS(SystemZTTI, TargetTransformInfo, "systemztti",
+                   "SystemZ Target Transform Info", true, true, false)
+char SystemZTTI::ID = 0;
+
+ImmutablePass *
+llvm::createSystemZTargetTransformInfoPass(const SystemZTargetMachine *TM) {
+  return new SystemZTTI(TM);
+}
+
+//===----------------------------------------------------------------------===//
+//
+// SystemZ cost model.
+//
+//===----------------------------------------------------------------------===//
+
+// Return true if ICmp is a 32- or 64-bit integer comparison whose only use
+// is a conditional branch in the same block, and whose second operand is a
+// register or an 8-bit immediate.  Such comparisons are fused with the
+// branch into a single CRJ, CGIJ, CLRJ, etc.
+static bool isFusedCompareAndBranch(const ICmpInst *ICmp) {
+  if (!ICmp->hasOneUse())
+    return false;
+  const BranchInst *Br = dyn_cast<BranchInst>(*ICmp->use_begin());
+  if (!Br || !Br->isConditional() || Br->getParent() != ICmp->getParent())
+    return false;
+
+  Type *Ty = ICmp->getOperand(0)->getType();
+  if (!Ty->isIntegerTy(32) && !Ty->isIntegerTy(64))
+    return false;
+
+  const ConstantInt *CI = dyn_cast<ConstantInt>(ICmp->getOperand(1));
+  if (!CI)
+    return true;
+  if (ICmp->isUnsigned())
+    return CI->getValue().isIntN(8);
+  return CI->getValue().isSignedIntN(8);
+}
+
+unsigned SystemZTTI::getUserCost(const User *U) const {
+  if (const ICmpInst *ICmp = dyn_cast<ICmpInst>(U))
+    if (isFusedCompareAndBranch(ICmp))
+      return TCC_Free;
+
+  // Constant-length memcpys and memsets are expanded inline into MVCs
+  // (or XCs for zeroing), each handling up to 256 bytes.  Longer blocks
+  // use a loop of the same instructions.
+  if (const MemIntrinsic *MI = dyn_cast<MemIntrinsic>(U))
+    if (!isa<MemMoveInst>(MI) && !MI->isVolatile())
+      if (const ConstantInt *Len = dyn_cast<ConstantInt>(MI->getLength())) {
+        uint64_t Bytes = Len->getZExtValue();
+        if (Bytes == 0)
+          return TCC_Free;
+        if (Bytes <= 6 * 256)
+          return ((Bytes + 255) / 256) * TCC_Basic;
+        return 4 * TCC_Basic;
+      }
+
+  return TargetTransformInfo::getUserCost(U);
+}
+
+bool SystemZTTI::isLoweredToCall(const Function *F) const {
+  // SystemZSelectionDAGInfo expands these into the string instructions
+  // (SRST, CLST, MVST) rather than calling the library.
+  if (F->hasName() && !F->hasLocalLinkage()) {
+    StringRef Name = F->getName();
+    if (Name == "memchr" || Name == "strcpy" || Name == "stpcpy" ||
+        Name == "strcmp" || Name == "strlen" || Name == "strnlen")
+      return false;
+  }
+  return TargetTransformInfo::isLoweredToCall(F);
+}
+
+unsigned SystemZTTI::getIntImmCost(const APInt &Imm, Type *Ty) const {
+  assert(Ty->isIntegerTy());
+
+  unsigned BitSize = Ty->getPrimitiveSizeInBits();
+  if (BitSize == 0 || BitSize > 64)
+    return TargetTransformInfo::getIntImmCost(Imm, Ty);
+
+  // LGFI, LLILF and LLIHF load any signed 32-bit value, unsigned 32-bit
+  // value or value with only the high 32 bits set in a single instruction.
+  // Everything else needs a pair, such as LLIHF followed by OILF.
+  int64_t Val = Imm.getSExtValue();
+  if (isInt<32>(Val) || isUInt<32>(Val) || (Val & 0xffffffff) == 0)
+    return TCC_Basic;
+  return 2 * TCC_Basic;
+}
+
+unsigned SystemZTTI::getCmpSelInstrCost(unsigned Opcode, Type *ValTy,
+                                        Type *CondTy) const {
+  // Without load/store-on-condition an integer select needs a branch
+  // around a register move.
+  if (Opcode == Instruction::Select && ValTy->isIntegerTy() &&
+      ValTy->getPrimitiveSizeInBits() <= 64) {
+    if (ST->hasLoadStoreOnCond())
+      return 1;
+    return 2;
+  }
+
+  return TargetTransformInfo::getCmpSelInstrCost(Opcode, ValTy, CondTy);
+}
+
+unsigned SystemZTTI::getMemoryOpCost(unsigned Opcode, Type *Src,
+                                     unsigned Alignment,
+                                     unsigned AddressSpace) const {
+  // The hardware has no alignment restrictions.  f128 values live in
+  // register pairs and are loaded and stored as two halves.
+  if (Src->isFP128Ty())
+    return 2;
+  if ((Src->isIntegerTy() && Src->getPrimitiveSizeInBits() <= 64) ||
+      Src->isFloatTy() || Src->isDoubleTy())
+    return 1;
+
+  return TargetTransformInfo::getMemoryOpCost(Opcode, Src, Alignment,
+                                              AddressSpace);
+}
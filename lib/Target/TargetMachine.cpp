@@ -28,15 +28,14 @@ using namespace llvm;
 
 namespace llvm {
   bool HasDivModLibcall;
-  bool AsmVerbosityDefault(false);
 }
 
 static cl::opt<bool>
-DataSections("fdata-sections",
+EnableDataSections("fdata-sections",
   cl::desc("Emit data into separate sections"),
   cl::init(false));
 static cl::opt<bool>
-FunctionSections("ffunction-sections",
+EnableFunctionSections("ffunction-sections",
   cl::desc("Emit functions into separate sections"),
   cl::init(false));
 
@@ -55,6 +54,10 @@ TargetMachine::TargetMachine(const Target &T,
     MCUseLoc(true),
     MCUseCFI(true),
     MCUseDwarfDirectory(false),
+    AsmVerbosityDefault(false),
+    FunctionSections(EnableFunctionSections),
+    DataSections(EnableDataSections),
+    MFAllocatorPool(0),
     Options(Options) {
 }
 
@@ -164,26 +167,3 @@ CodeGenOpt::Level TargetMachine::getOptLevel() const {
   return CodeGenInfo->getOptLevel();
 }
 
-bool TargetMachine::getAsmVerbosityDefault() {
-  return AsmVerbosityDefault;
-}
-
-void TargetMachine::setAsmVerbosityDefault(bool V) {
-  AsmVerbosityDefault = V;
-}
-
-bool TargetMachine::getFunctionSections() {
-  return FunctionSections;
-}
-
-bool TargetMachine::getDataSections() {
-  return DataSections;
-}
-
-void TargetMachine::setFunctionSections(bool V) {
-  FunctionSections = V;
-}
-
-void TargetMachine::setDataSections(bool V) {
-  DataSections = V;
-}
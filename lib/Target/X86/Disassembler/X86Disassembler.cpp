@@ -22,6 +22,7 @@
 #include "llvm/MC/MCInst.h"
 #include "llvm/MC/MCInstrInfo.h"
 #include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/MemoryObject.h"
 #include "llvm/Support/TargetRegistry.h"
@@ -68,6 +69,11 @@ extern Target TheX86_32Target, TheX86_64Target;
 
 }
 
+static cl::opt<bool>
+DisableDecodeCache("x86-disable-decode-cache", cl::Hidden,
+                   cl::desc("Look up the ID of every decoded X86 instruction "
+                            "in the decoder tables"));
+
 static bool translateInstruction(MCInst &target,
                                 InternalInstruction &source,
                                 const MCDisassembler *Dis);
@@ -75,9 +81,13 @@ static bool translateInstruction(MCInst &target,
 X86GenericDisassembler::X86GenericDisassembler(const MCSubtargetInfo &STI,
                                                DisassemblerMode mode,
                                                const MCInstrInfo *MII)
-  : MCDisassembler(STI), MII(MII), fMode(mode) {}
+  : MCDisassembler(STI), MII(MII), Cache(0), fMode(mode) {
+  if (!DisableDecodeCache)
+    Cache = new DecodeCache();
+}
 
 X86GenericDisassembler::~X86GenericDisassembler() {
+  delete Cache;
   delete MII;
 }
 
@@ -132,6 +142,7 @@ X86GenericDisassembler::getInstruction(MCInst &instr,
                               loggerFn,
                               (void*)&vStream,
                               (const void*)MII,
+                              Cache,
                               address,
                               fMode);
 
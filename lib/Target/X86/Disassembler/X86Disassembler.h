@@ -87,6 +87,8 @@
 
 #include "llvm/MC/MCDisassembler.h"
 
+struct DecodeCache;
+
 namespace llvm {
 
 class MCInst;
@@ -102,6 +104,10 @@ namespace X86Disassembler {
 ///   provide a different disassemblerMode value.
 class X86GenericDisassembler : public MCDisassembler {
   const MCInstrInfo *MII;
+  /// Cache - The instruction IDs found for recently decoded opcodes, or null
+  /// if the cache is disabled.  Like CommentStream, this makes decoding with
+  /// one disassembler on several threads at once unsafe.
+  mutable DecodeCache *Cache;
 public:
   /// Constructor     - Initializes the disassembler.
   ///
@@ -817,94 +817,19 @@ static BOOL is16BitEquivalent(const char* orig, const char* equiv) {
 }
 
 /*
- * getID - Determines the ID of an instruction, consuming the ModR/M byte as
- *   appropriate for extended and escape opcodes.  Determines the attributes and
- *   context for the instruction before doing so.
+ * lookupID - Determines the ID of an instruction with the given attributes,
+ *   consuming the ModR/M byte as appropriate for extended and escape opcodes.
  *
- * @param insn  - The instruction whose ID is to be determined.
- * @return      - 0 if the ModR/M could be read when needed or was not needed;
- *                nonzero otherwise.
+ * @param insn      - The instruction whose ID is to be determined.
+ * @param attrMask  - The attributes of the decoding context, from getID().
+ * @return          - 0 if the ModR/M could be read when needed or was not
+ *                    needed; nonzero otherwise.
  */
-static int getID(struct InternalInstruction* insn, const void *miiArg) {
-  uint8_t attrMask;
+static int lookupID(struct InternalInstruction* insn,
+                    uint8_t attrMask,
+                    const void *miiArg) {
   uint16_t instructionID;
 
-  dbgprintf(insn, "getID()");
-
-  attrMask = ATTR_NONE;
-
-  if (insn->mode == MODE_64BIT)
-    attrMask |= ATTR_64BIT;
-
-  if (insn->vexXopType != TYPE_NO_VEX_XOP) {
-    attrMask |= ATTR_VEX;
-
-    if (insn->vexXopType == TYPE_VEX_3B) {
-      switch (ppFromVEX3of3(insn->vexXopPrefix[2])) {
-      case VEX_PREFIX_66:
-        attrMask |= ATTR_OPSIZE;
-        break;
-      case VEX_PREFIX_F3:
-        attrMask |= ATTR_XS;
-        break;
-      case VEX_PREFIX_F2:
-        attrMask |= ATTR_XD;
-        break;
-      }
-
-      if (lFromVEX3of3(insn->vexXopPrefix[2]))
-        attrMask |= ATTR_VEXL;
-    }
-    else if (insn->vexXopType == TYPE_VEX_2B) {
-      switch (ppFromVEX2of2(insn->vexXopPrefix[1])) {
-      case VEX_PREFIX_66:
-        attrMask |= ATTR_OPSIZE;
-        break;
-      case VEX_PREFIX_F3:
-        attrMask |= ATTR_XS;
-        break;
-      case VEX_PREFIX_F2:
-        attrMask |= ATTR_XD;
-        break;
-      }
-
-      if (lFromVEX2of2(insn->vexXopPrefix[1]))
-        attrMask |= ATTR_VEXL;
-    }
-    else if (insn->vexXopType == TYPE_XOP) {
-      switch (ppFromXOP3of3(insn->vexXopPrefix[2])) {
-      case VEX_PREFIX_66:
-        attrMask |= ATTR_OPSIZE;
-        break;
-      case VEX_PREFIX_F3:
-        attrMask |= ATTR_XS;
-        break;
-      case VEX_PREFIX_F2:
-        attrMask |= ATTR_XD;
-        break;
-      }
-
-      if (lFromXOP3of3(insn->vexXopPrefix[2]))
-        attrMask |= ATTR_VEXL;
-    }
-    else {
-      return -1;
-    }
-  }
-  else {
-    if (isPrefixAtLocation(insn, 0x66, insn->necessaryPrefixLocation))
-      attrMask |= ATTR_OPSIZE;
-    else if (isPrefixAtLocation(insn, 0x67, insn->necessaryPrefixLocation))
-      attrMask |= ATTR_ADSIZE;
-    else if (isPrefixAtLocation(insn, 0xf3, insn->necessaryPrefixLocation))
-      attrMask |= ATTR_XS;
-    else if (isPrefixAtLocation(insn, 0xf2, insn->necessaryPrefixLocation))
-      attrMask |= ATTR_XD;
-  }
-
-  if (insn->rexPrefix & 0x08)
-    attrMask |= ATTR_REXW;
-
   if (getIDWithAttrMask(&instructionID, insn, attrMask))
     return -1;
 
@@ -995,6 +920,174 @@ static int getID(struct InternalInstruction* insn, const void *miiArg) {
   return 0;
 }
 
+/*
+ * lookupIDInCache - Like lookupID, but looks the ID up in a DecodeCache first,
+ *   and adds it there if it was not found.
+ *
+ * @param insn      - The instruction whose ID is to be determined.
+ * @param attrMask  - The attributes of the decoding context, from getID().
+ * @param cache     - The cache to use.
+ * @return          - 0 if the ModR/M could be read when needed or was not
+ *                    needed; nonzero otherwise.
+ */
+static int lookupIDInCache(struct InternalInstruction* insn,
+                           uint8_t attrMask,
+                           const void *miiArg,
+                           struct DecodeCache* cache) {
+  InstructionContext context;
+  BOOL opsizeFixup, nopFixup, needsModRM, fixupNeedsModRM;
+  uint32_t key;
+  struct DecodeCacheEntry *entry;
+
+  /*
+   * Everything lookupID() depends on goes into the key: the opcode, the
+   * attributes, whether one of its fixups applies and the ModR/M byte if
+   * any of its table lookups read one.
+   */
+  context = contextForAttrs(attrMask);
+  opsizeFixup = insn->prefixPresent[0x66] && !(attrMask & ATTR_OPSIZE);
+  nopFixup = !opsizeFixup && insn->opcodeType == ONEBYTE &&
+             insn->opcode == 0x90 && (insn->rexPrefix & 0x01);
+  needsModRM = modRMRequired(insn->opcodeType, context, insn->opcode);
+  fixupNeedsModRM = FALSE;
+  if (opsizeFixup)
+    fixupNeedsModRM = modRMRequired(insn->opcodeType,
+                                    contextForAttrs(attrMask | ATTR_OPSIZE),
+                                    insn->opcode);
+  else if (nopFixup)
+    fixupNeedsModRM = modRMRequired(insn->opcodeType, context, 0x91);
+
+  if (needsModRM || fixupNeedsModRM) {
+    if (readModRM(insn)) {
+      /* This is what lookupID() does when it cannot read the ModR/M byte. */
+      if (needsModRM)
+        return -1;
+      insn->instructionID = decode(insn->opcodeType, context, insn->opcode, 0);
+      insn->spec = specifierForUID(insn->instructionID);
+      return 0;
+    }
+  }
+
+  key = 0x80000000u |
+        (uint32_t)insn->opcode |
+        ((uint32_t)insn->opcodeType << 8) |
+        ((uint32_t)attrMask << 12) |
+        ((uint32_t)opsizeFixup << 20) |
+        ((uint32_t)nopFixup << 21);
+  if (needsModRM || fixupNeedsModRM)
+    key |= 0x400000u | ((uint32_t)insn->modRM << 23);
+
+  entry = &cache->entries[(key * 2654435761u) >> 20 & (DECODE_CACHE_SIZE - 1)];
+  if (entry->key == key) {
+    insn->instructionID = entry->instructionID;
+    insn->spec = specifierForUID(insn->instructionID);
+    return 0;
+  }
+
+  if (lookupID(insn, attrMask, miiArg))
+    return -1;
+
+  entry->key = key;
+  entry->instructionID = insn->instructionID;
+  return 0;
+}
+
+/*
+ * getID - Determines the ID of an instruction, consuming the ModR/M byte as
+ *   appropriate for extended and escape opcodes.  Determines the attributes and
+ *   context for the instruction before doing so.
+ *
+ * @param insn  - The instruction whose ID is to be determined.
+ * @param cache - If not NULL, the cache to look the ID up in.
+ * @return      - 0 if the ModR/M could be read when needed or was not needed;
+ *                nonzero otherwise.
+ */
+static int getID(struct InternalInstruction* insn,
+                 const void *miiArg,
+                 struct DecodeCache* cache) {
+  uint8_t attrMask;
+
+  dbgprintf(insn, "getID()");
+
+  attrMask = ATTR_NONE;
+
+  if (insn->mode == MODE_64BIT)
+    attrMask |= ATTR_64BIT;
+
+  if (insn->vexXopType != TYPE_NO_VEX_XOP) {
+    attrMask |= ATTR_VEX;
+
+    if (insn->vexXopType == TYPE_VEX_3B) {
+      switch (ppFromVEX3of3(insn->vexXopPrefix[2])) {
+      case VEX_PREFIX_66:
+        attrMask |= ATTR_OPSIZE;
+        break;
+      case VEX_PREFIX_F3:
+        attrMask |= ATTR_XS;
+        break;
+      case VEX_PREFIX_F2:
+        attrMask |= ATTR_XD;
+        break;
+      }
+
+      if (lFromVEX3of3(insn->vexXopPrefix[2]))
+        attrMask |= ATTR_VEXL;
+    }
+    else if (insn->vexXopType == TYPE_VEX_2B) {
+      switch (ppFromVEX2of2(insn->vexXopPrefix[1])) {
+      case VEX_PREFIX_66:
+        attrMask |= ATTR_OPSIZE;
+        break;
+      case VEX_PREFIX_F3:
+        attrMask |= ATTR_XS;
+        break;
+      case VEX_PREFIX_F2:
+        attrMask |= ATTR_XD;
+        break;
+      }
+
+      if (lFromVEX2of2(insn->vexXopPrefix[1]))
+        attrMask |= ATTR_VEXL;
+    }
+    else if (insn->vexXopType == TYPE_XOP) {
+      switch (ppFromXOP3of3(insn->vexXopPrefix[2])) {
+      case VEX_PREFIX_66:
+        attrMask |= ATTR_OPSIZE;
+        break;
+      case VEX_PREFIX_F3:
+        attrMask |= ATTR_XS;
+        break;
+      case VEX_PREFIX_F2:
+        attrMask |= ATTR_XD;
+        break;
+      }
+
+      if (lFromXOP3of3(insn->vexXopPrefix[2]))
+        attrMask |= ATTR_VEXL;
+    }
+    else {
+      return -1;
+    }
+  }
+  else {
+    if (isPrefixAtLocation(insn, 0x66, insn->necessaryPrefixLocation))
+      attrMask |= ATTR_OPSIZE;
+    else if (isPrefixAtLocation(insn, 0x67, insn->necessaryPrefixLocation))
+      attrMask |= ATTR_ADSIZE;
+    else if (isPrefixAtLocation(insn, 0xf3, insn->necessaryPrefixLocation))
+      attrMask |= ATTR_XS;
+    else if (isPrefixAtLocation(insn, 0xf2, insn->necessaryPrefixLocation))
+      attrMask |= ATTR_XD;
+  }
+
+  if (insn->rexPrefix & 0x08)
+    attrMask |= ATTR_REXW;
+
+  if (cache)
+    return lookupIDInCache(insn, attrMask, miiArg, cache);
+  return lookupID(insn, attrMask, miiArg);
+}
+
 /*
  * readSIB - Consumes the SIB byte to determine addressing information for an
  *   instruction.
@@ -1702,6 +1795,8 @@ static int readOperands(struct InternalInstruction* insn) {
  *                    and warnings.
  * @param loggerArg - A generic argument to be passed to the logger to store
  *                    any internal state.
+ * @param miiArg    - The MCInstrInfo, for looking up instruction names.
+ * @param cache     - If not NULL, a cache of instruction IDs to use.
  * @param startLoc  - The address (in the reader's address space) of the first
  *                    byte in the instruction.
  * @param mode      - The mode (real mode, IA-32e, or IA-32e in 64-bit mode) to
@@ -1715,6 +1810,7 @@ int decodeInstruction(struct InternalInstruction* insn,
                       dlog_t logger,
                       void* loggerArg,
                       const void* miiArg,
+                      struct DecodeCache* cache,
                       uint64_t startLoc,
                       DisassemblerMode mode) {
   memset(insn, 0, sizeof(struct InternalInstruction));
@@ -1730,7 +1826,7 @@ int decodeInstruction(struct InternalInstruction* insn,
 
   if (readPrefixes(insn)       ||
       readOpcode(insn)         ||
-      getID(insn, miiArg)      ||
+      getID(insn, miiArg, cache) ||
       insn->instructionID == 0 ||
       readOperands(insn))
     return -1;
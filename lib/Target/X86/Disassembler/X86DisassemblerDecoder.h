@@ -631,6 +631,25 @@ struct InternalInstruction {
   const struct OperandSpecifier *operands;
 };
 
+/*
+ * DecodeCache - A direct-mapped cache of instruction IDs, keyed by the opcode,
+ *   the attributes of the decoding context and the ModR/M byte if one was
+ *   needed.  Finding the ID walks several tables, and for instructions with an
+ *   OpSize prefix that the tables do not expect it also compares instruction
+ *   names, so code that decodes the same instructions over and over can skip
+ *   most of that.  A zeroed cache is empty.
+ */
+#define DECODE_CACHE_SIZE 4096
+
+struct DecodeCacheEntry {
+  uint32_t key;           /* 0 if the entry is unused */
+  uint16_t instructionID;
+};
+
+struct DecodeCache {
+  struct DecodeCacheEntry entries[DECODE_CACHE_SIZE];
+};
+
 /* decodeInstruction - Decode one instruction and store the decoding results in
  *   a buffer provided by the consumer.
  * @param insn      - The buffer to store the instruction in.  Allocated by the
@@ -642,6 +661,9 @@ struct InternalInstruction {
  *                    disassembler.  May be NULL.
  * @param loggerArg - An argument to pass to the logger for storing context
  *                    specific to the logger.  May be NULL.
+ * @param miiArg    - The MCInstrInfo, for looking up instruction names.
+ * @param cache     - A DecodeCache to look instruction IDs up in and add them
+ *                    to.  May be NULL.
  * @param startLoc  - The address (in the reader's address space) of the first
  *                    byte in the instruction.
  * @param mode      - The mode (16-bit, 32-bit, 64-bit) to decode in.
@@ -653,6 +675,7 @@ int decodeInstruction(struct InternalInstruction* insn,
                       dlog_t logger,
                       void* loggerArg,
                       const void* miiArg,
+                      struct DecodeCache* cache,
                       uint64_t startLoc,
                       DisassemblerMode mode);
 
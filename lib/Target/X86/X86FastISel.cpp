@@ -103,6 +103,8 @@ private:
 
   bool X86SelectBranch(const Instruction *I);
 
+  bool X86SelectSwitch(const Instruction *I);
+
   bool X86SelectShift(const Instruction *I);
 
   bool X86SelectDivRem(const Instruction *I);
@@ -1245,6 +1247,52 @@ bool X86FastISel::X86SelectBranch(const Instruction *I) {
   return true;
 }
 
+/// MaxFastISelSwitchCases - Switches with more cases than this are left to
+/// SelectionDAG, which can use jump tables and bit tests for them.
+static const unsigned MaxFastISelSwitchCases = 3;
+
+bool X86FastISel::X86SelectSwitch(const Instruction *I) {
+  // Handle a small switch as a chain of compares and branches.
+  const SwitchInst *SI = cast<SwitchInst>(I);
+  if (SI->getNumCases() > MaxFastISelSwitchCases)
+    return false;
+
+  MVT VT;
+  if (!isTypeLegal(SI->getCondition()->getType(), VT) || !VT.isInteger())
+    return false;
+
+  // Make sure none of the compares can fail once the first branch is out.
+  if (getRegForValue(SI->getCondition()) == 0)
+    return false;
+  for (SwitchInst::ConstCaseIt i = SI->case_begin(), e = SI->case_end();
+       i != e; ++i)
+    if (!X86ChooseCmpImmediateOpcode(VT, i.getCaseValue()) &&
+        getRegForValue(i.getCaseValue()) == 0)
+      return false;
+
+  for (SwitchInst::ConstCaseIt i = SI->case_begin(), e = SI->case_end();
+       i != e; ++i) {
+    if (!X86FastEmitCompare(SI->getCondition(), i.getCaseValue(), VT))
+      return false;
+    MachineBasicBlock *CaseMBB = FuncInfo.MBBMap[i.getCaseSuccessor()];
+    BuildMI(*FuncInfo.MBB, FuncInfo.InsertPt, DL, TII.get(X86::JE_4))
+      .addMBB(CaseMBB);
+    if (!FuncInfo.MBB->isSuccessor(CaseMBB))
+      FuncInfo.MBB->addSuccessor(CaseMBB);
+  }
+
+  // Several cases, and the default, may share a destination, which must only
+  // be added as a successor once.
+  MachineBasicBlock *DefaultMBB = FuncInfo.MBBMap[SI->getDefaultDest()];
+  if (!FuncInfo.MBB->isSuccessor(DefaultMBB)) {
+    FastEmitBranch(DefaultMBB, DL);
+  } else if (!FuncInfo.MBB->isLayoutSuccessor(DefaultMBB)) {
+    TII.InsertBranch(*FuncInfo.MBB, DefaultMBB, NULL,
+                     SmallVector<MachineOperand, 0>(), DL);
+  }
+  return true;
+}
+
 bool X86FastISel::X86SelectShift(const Instruction *I) {
   unsigned CReg = 0, OpReg = 0;
   const TargetRegisterClass *RC = NULL;
@@ -2323,6 +2371,8 @@ X86FastISel::TargetSelectInstruction(const Instruction *I)  {
     return X86SelectZExt(I);
   case Instruction::Br:
     return X86SelectBranch(I);
+  case Instruction::Switch:
+    return X86SelectSwitch(I);
   case Instruction::Call:
     return X86SelectCall(I);
   case Instruction::LShr:
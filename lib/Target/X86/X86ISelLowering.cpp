@@ -1322,6 +1322,7 @@ void X86TargetLowering::resetOperationActions() {
     setOperationAction(ISD::FDIV,               MVT::v16f32, Legal);
     setOperationAction(ISD::FSQRT,              MVT::v16f32, Legal);
     setOperationAction(ISD::FNEG,               MVT::v16f32, Custom);
+    setOperationAction(ISD::FABS,               MVT::v16f32, Custom);
 
     setOperationAction(ISD::FADD,               MVT::v8f64, Legal);
     setOperationAction(ISD::FSUB,               MVT::v8f64, Legal);
@@ -1329,6 +1330,7 @@ void X86TargetLowering::resetOperationActions() {
     setOperationAction(ISD::FDIV,               MVT::v8f64, Legal);
     setOperationAction(ISD::FSQRT,              MVT::v8f64, Legal);
     setOperationAction(ISD::FNEG,               MVT::v8f64, Custom);
+    setOperationAction(ISD::FABS,               MVT::v8f64, Custom);
     setOperationAction(ISD::FMA,                MVT::v8f64, Legal);
     setOperationAction(ISD::FMA,                MVT::v16f32, Legal);
     setOperationAction(ISD::SDIV,               MVT::v16i32, Custom);
@@ -9202,7 +9204,7 @@ SDValue X86TargetLowering::LowerFABS(SDValue Op, SelectionDAG &DAG) const {
                              MachinePointerInfo::getConstantPool(),
                              false, false, false, Alignment);
   if (VT.isVector()) {
-    MVT ANDVT = VT.is128BitVector() ? MVT::v2i64 : MVT::v4i64;
+    MVT ANDVT = MVT::getVectorVT(MVT::i64, VT.getSizeInBits()/64);
     return DAG.getNode(ISD::BITCAST, dl, VT,
                        DAG.getNode(ISD::AND, dl, ANDVT,
                                    DAG.getNode(ISD::BITCAST, dl, ANDVT,
@@ -11727,6 +11729,72 @@ static SDValue LowerINTRINSIC_WO_CHAIN(SDValue Op, SelectionDAG &DAG) {
   }
 }
 
+/// getAVX2GatherIntrinsic - Return the AVX2 gather intrinsic that loads a
+/// DataVT vector using IndexVT indices, or not_intrinsic if there is none.
+static Intrinsic::ID getAVX2GatherIntrinsic(MVT DataVT, MVT IndexVT) {
+  switch (DataVT.SimpleTy) {
+  default: break;
+  case MVT::v4f32:
+    if (IndexVT == MVT::v4i32) return Intrinsic::x86_avx2_gather_d_ps;
+    if (IndexVT == MVT::v4i64) return Intrinsic::x86_avx2_gather_q_ps_256;
+    break;
+  case MVT::v8f32:
+    if (IndexVT == MVT::v8i32) return Intrinsic::x86_avx2_gather_d_ps_256;
+    break;
+  case MVT::v2f64:
+    if (IndexVT == MVT::v2i64) return Intrinsic::x86_avx2_gather_q_pd;
+    break;
+  case MVT::v4f64:
+    if (IndexVT == MVT::v4i32) return Intrinsic::x86_avx2_gather_d_pd_256;
+    if (IndexVT == MVT::v4i64) return Intrinsic::x86_avx2_gather_q_pd_256;
+    break;
+  case MVT::v4i32:
+    if (IndexVT == MVT::v4i32) return Intrinsic::x86_avx2_gather_d_d;
+    if (IndexVT == MVT::v4i64) return Intrinsic::x86_avx2_gather_q_d_256;
+    break;
+  case MVT::v8i32:
+    if (IndexVT == MVT::v8i32) return Intrinsic::x86_avx2_gather_d_d_256;
+    break;
+  case MVT::v2i64:
+    if (IndexVT == MVT::v2i64) return Intrinsic::x86_avx2_gather_q_q;
+    break;
+  case MVT::v4i64:
+    if (IndexVT == MVT::v4i32) return Intrinsic::x86_avx2_gather_d_q_256;
+    if (IndexVT == MVT::v4i64) return Intrinsic::x86_avx2_gather_q_q_256;
+    break;
+  }
+  return Intrinsic::not_intrinsic;
+}
+
+/// getAVX512GatherOpcode - Return the AVX-512 gather instruction that loads a
+/// DataVT vector using IndexVT indices, or 0 if there is none.
+static unsigned getAVX512GatherOpcode(MVT DataVT, MVT IndexVT) {
+  switch (DataVT.SimpleTy) {
+  default: break;
+  case MVT::v16f32:
+    if (IndexVT == MVT::v16i32) return X86::VGATHERDPSZrm;
+    break;
+  case MVT::v8f32:
+    if (IndexVT == MVT::v8i64) return X86::VGATHERQPSZrm;
+    break;
+  case MVT::v8f64:
+    if (IndexVT == MVT::v8i32) return X86::VGATHERDPDZrm;
+    if (IndexVT == MVT::v8i64) return X86::VGATHERQPDZrm;
+    break;
+  case MVT::v16i32:
+    if (IndexVT == MVT::v16i32) return X86::VPGATHERDDZrm;
+    break;
+  case MVT::v8i32:
+    if (IndexVT == MVT::v8i64) return X86::VPGATHERQDZrm;
+    break;
+  case MVT::v8i64:
+    if (IndexVT == MVT::v8i32) return X86::VPGATHERDQZrm;
+    if (IndexVT == MVT::v8i64) return X86::VPGATHERQQZrm;
+    break;
+  }
+  return 0;
+}
+
 static SDValue getGatherNode(unsigned Opc, SDValue Op, SelectionDAG &DAG,
                              SDValue Base, SDValue Index,
                              SDValue ScaleOp, SDValue Chain,
@@ -11842,6 +11910,30 @@ static SDValue LowerINTRINSIC_W_CHAIN(SDValue Op, const X86Subtarget *Subtarget,
     return DAG.getNode(ISD::MERGE_VALUES, dl, Op->getVTList(), Result, isValid,
                        SDValue(Result.getNode(), 2));
   }
+  // llvm.gather(base, index), which isLegalGather accepted.
+  case Intrinsic::gather: {
+    MVT VT = Op.getSimpleValueType();
+    MVT IndexVT = Op.getOperand(3).getSimpleValueType();
+    SDValue Chain = Op.getOperand(0);
+    SDValue Base  = Op.getOperand(2);
+    SDValue Index = Op.getOperand(3);
+    SDValue Scale = DAG.getConstant(VT.getScalarType().getStoreSize(),
+                                    MVT::i8);
+    if (unsigned Opc = getAVX512GatherOpcode(VT, IndexVT))
+      if (Subtarget->hasAVX512())
+        return getGatherNode(Opc, Op, DAG, Base, Index, Scale, Chain,
+                             Subtarget);
+
+    // Use the AVX2 intrinsic with every element enabled in the mask.
+    Intrinsic::ID ID = getAVX2GatherIntrinsic(VT, IndexVT);
+    assert(ID != Intrinsic::not_intrinsic && "Unexpected gather!");
+    EVT PtrVT = Op.getOperand(1).getValueType();
+    SDValue Ops[] = { Chain, DAG.getTargetConstant(ID, PtrVT),
+                      getZeroVector(VT, Subtarget, DAG, dl), Base, Index,
+                      getOnesVector(VT, true, DAG, dl), Scale };
+    return DAG.getNode(ISD::INTRINSIC_W_CHAIN, dl, Op->getVTList(), Ops,
+                       array_lengthof(Ops));
+  }
   //int_gather(index, base, scale);
   case Intrinsic::x86_avx512_gather_qpd_512:
   case Intrinsic::x86_avx512_gather_qps_512:
@@ -14066,6 +14158,17 @@ X86TargetLowering::isVectorClearMaskLegal(const SmallVectorImpl<int> &Mask,
   return false;
 }
 
+bool X86TargetLowering::isLegalGather(EVT DataVT, EVT IndexVT) const {
+  if (!DataVT.isSimple() || !IndexVT.isSimple())
+    return false;
+
+  MVT DVT = DataVT.getSimpleVT(), IVT = IndexVT.getSimpleVT();
+  if (Subtarget->hasAVX512() && getAVX512GatherOpcode(DVT, IVT))
+    return true;
+  return Subtarget->hasInt256() &&
+         getAVX2GatherIntrinsic(DVT, IVT) != Intrinsic::not_intrinsic;
+}
+
 //===----------------------------------------------------------------------===//
 //                           X86 Scheduler Hooks
 //===----------------------------------------------------------------------===//
@@ -728,6 +728,10 @@ namespace llvm {
     virtual bool isVectorClearMaskLegal(const SmallVectorImpl<int> &Mask,
                                         EVT VT) const;
 
+    /// isLegalGather - Return true if AVX2 or AVX-512 has a gather
+    /// instruction that loads a DataVT vector using IndexVT indices.
+    virtual bool isLegalGather(EVT DataVT, EVT IndexVT) const;
+
     /// ShouldShrinkFPConstant - If true, then instruction selection should
     /// seek to shrink the FP constant of the specified type to a smaller type
     /// in order to save space and / or reduce runtime.
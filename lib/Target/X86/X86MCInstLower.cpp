@@ -722,11 +722,17 @@ X86AsmPrinter::stackmapOperandParser(MachineInstr::const_mop_iterator MOI,
     switch (MOP.getImm()) {
     default: llvm_unreachable("Unrecognized operand type.");
     case StackMaps::DirectMemRefOp: {
+      // A frame object: its base register and offset.
       unsigned Size = TM.getDataLayout()->getPointerSizeInBits();
       assert((Size % 8) == 0 && "Need pointer size in bytes.");
       Size /= 8;
-      return parseMemoryOperand(StackMaps::Location::Direct, Size,
-                                llvm::next(MOI), MOE);
+      const MachineOperand &Base = *(++MOI);
+      const MachineOperand &Offset = *(++MOI);
+      assert(Base.isReg() && Offset.isImm() &&
+             "Unsupported direct frame object operands.");
+      return std::make_pair(
+        Location(Location::Direct, Size, Base.getReg(), Offset.getImm()),
+        ++MOI);
     }
     case StackMaps::IndirectMemRefOp: {
       ++MOI;
@@ -15,6 +15,7 @@
 #include "X86TargetMachine.h"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/MathExtras.h"
 using namespace llvm;
 
 X86SelectionDAGInfo::X86SelectionDAGInfo(const X86TargetMachine &TM) :
@@ -26,6 +27,69 @@ X86SelectionDAGInfo::X86SelectionDAGInfo(const X86TargetMachine &TM) :
 X86SelectionDAGInfo::~X86SelectionDAGInfo() {
 }
 
+/// EmitVectorMemOps - Expand a memcpy of SizeVal bytes from Src, or a memset
+/// of them to the value Src, into vector loads and stores.  If SizeVal is
+/// not a multiple of the vector size the last store overlaps the one before
+/// it.  Returns a null SDValue if the subtarget prefers other code for this
+/// size.
+static SDValue EmitVectorMemOps(SelectionDAG &DAG, SDLoc dl,
+                                const X86Subtarget *Subtarget, SDValue Chain,
+                                SDValue Dst, SDValue Src, bool IsMemset,
+                                uint64_t SizeVal, unsigned Align,
+                                bool isVolatile,
+                                MachinePointerInfo DstPtrInfo,
+                                MachinePointerInfo SrcPtrInfo) {
+  if (isVolatile || !Subtarget->hasSSE2() ||
+      SizeVal > Subtarget->getMaxInlineVectorSizeThreshold())
+    return SDValue();
+  const Function *F = DAG.getMachineFunction().getFunction();
+  if (F->getAttributes().hasAttribute(AttributeSet::FunctionIndex,
+                                      Attribute::NoImplicitFloat))
+    return SDValue();
+
+  // Use the same types as getOptimalMemOpType.  A memset stores an integer
+  // splat, which needs no vector arithmetic.
+  EVT VT = MVT::v4i32;
+  if (SizeVal >= 32 && Subtarget->hasFp256())
+    VT = Subtarget->hasInt256() || IsMemset ? MVT::v8i32 : MVT::v8f32;
+  unsigned VTSize = VT.getSizeInBits() / 8;
+  if (SizeVal < VTSize)
+    return SDValue();
+
+  SDValue Value;
+  if (IsMemset) {
+    ConstantSDNode *ValC = dyn_cast<ConstantSDNode>(Src);
+    if (!ValC)
+      return SDValue();
+    Value = DAG.getConstant(APInt::getSplat(32, APInt(8, ValC->getZExtValue())),
+                            VT);
+  }
+
+  EVT DstVT = Dst.getValueType();
+  SmallVector<SDValue, 16> Stores;
+  for (uint64_t Offset = 0; Offset < SizeVal; Offset += VTSize) {
+    uint64_t Off = std::min(Offset, SizeVal - VTSize);
+    unsigned OffAlign = MinAlign(Align, Off);
+    SDValue Val = Value, StoreChain = Chain;
+    if (!IsMemset) {
+      EVT SrcVT = Src.getValueType();
+      Val = DAG.getLoad(VT, dl, Chain,
+                        DAG.getNode(ISD::ADD, dl, SrcVT, Src,
+                                    DAG.getConstant(Off, SrcVT)),
+                        SrcPtrInfo.getWithOffset(Off), false, false, false,
+                        OffAlign);
+      StoreChain = Val.getValue(1);
+    }
+    Stores.push_back(DAG.getStore(StoreChain, dl, Val,
+                                  DAG.getNode(ISD::ADD, dl, DstVT, Dst,
+                                              DAG.getConstant(Off, DstVT)),
+                                  DstPtrInfo.getWithOffset(Off), false, false,
+                                  OffAlign));
+  }
+  return DAG.getNode(ISD::TokenFactor, dl, MVT::Other,
+                     &Stores[0], Stores.size());
+}
+
 SDValue
 X86SelectionDAGInfo::EmitTargetCodeForMemset(SelectionDAG &DAG, SDLoc dl,
                                              SDValue Chain,
@@ -39,6 +103,15 @@ X86SelectionDAGInfo::EmitTargetCodeForMemset(SelectionDAG &DAG, SDLoc dl,
   if (DstPtrInfo.getAddrSpace() >= 256)
     return SDValue();
 
+  if (ConstantSize) {
+    SDValue Vector = EmitVectorMemOps(DAG, dl, Subtarget, Chain, Dst, Src,
+                                      true, ConstantSize->getZExtValue(),
+                                      Align, isVolatile, DstPtrInfo,
+                                      MachinePointerInfo());
+    if (Vector.getNode())
+      return Vector;
+  }
+
   // If not DWORD aligned or size is more than the threshold, call the library.
   // The libc version is likely to be faster for these cases. It can use the
   // address value and run time information about the CPU.
@@ -185,6 +258,16 @@ X86SelectionDAGInfo::EmitTargetCodeForMemcpy(SelectionDAG &DAG, SDLoc dl,
   if (!ConstantSize)
     return SDValue();
   uint64_t SizeVal = ConstantSize->getZExtValue();
+
+  // Medium sized copies are faster as vector moves than as rep/movs.
+  if (DstPtrInfo.getAddrSpace() < 256 && SrcPtrInfo.getAddrSpace() < 256) {
+    SDValue Vector = EmitVectorMemOps(DAG, dl, Subtarget, Chain, Dst, Src,
+                                      false, SizeVal, Align, isVolatile,
+                                      DstPtrInfo, SrcPtrInfo);
+    if (Vector.getNode())
+      return Vector;
+  }
+
   if (!AlwaysInline && SizeVal > Subtarget->getMaxInlineSizeThreshold())
     return SDValue();
 
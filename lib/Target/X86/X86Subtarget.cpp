@@ -17,6 +17,7 @@
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalValue.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Host.h"
@@ -34,6 +35,11 @@ using namespace llvm;
 #include <intrin.h>
 #endif
 
+static cl::opt<int>
+VectorMemOpThreshold("x86-vector-memop-threshold", cl::init(-1), cl::Hidden,
+  cl::desc("Override the largest memcpy / memset that is expanded into "
+           "vector loads and stores"));
+
 /// ClassifyBlockAddressReference - Classify a blockaddress reference for the
 /// current subtarget according to how we should reference it in a non-pcrel
 /// context.
@@ -482,6 +488,14 @@ void X86Subtarget::resetSubtargetFeatures(StringRef CPU, StringRef FS) {
   else if (isTargetDarwin() || isTargetLinux() || isTargetSolaris() ||
            In64BitMode)
     stackAlignment = 16;
+
+  // rep/movs and rep/stos take a while to start up, so medium sized copies
+  // and sets are faster as straight-line vector code where unaligned
+  // accesses are cheap.
+  if (VectorMemOpThreshold >= 0)
+    MaxInlineVectorSizeThreshold = VectorMemOpThreshold;
+  else if (IsUAMemFast && hasSSE2())
+    MaxInlineVectorSizeThreshold = hasFp256() ? 512 : 256;
 }
 
 void X86Subtarget::initializeEnvironment() {
@@ -526,6 +540,7 @@ void X86Subtarget::initializeEnvironment() {
   stackAlignment = 4;
   // FIXME: this is a known good value for Yonah. How about others?
   MaxInlineSizeThreshold = 128;
+  MaxInlineVectorSizeThreshold = 0;
 }
 
 X86Subtarget::X86Subtarget(const std::string &TT, const std::string &CPU,
@@ -192,6 +192,10 @@ protected:
   ///
   unsigned MaxInlineSizeThreshold;
 
+  /// Max. memset / memcpy size that is turned into a sequence of possibly
+  /// unaligned vector loads and stores, or 0 if they are not used.
+  unsigned MaxInlineVectorSizeThreshold;
+
   /// TargetTriple - What processor and OS we're targeting.
   Triple TargetTriple;
 
@@ -222,6 +226,13 @@ public:
   /// that still makes it profitable to inline the call.
   unsigned getMaxInlineSizeThreshold() const { return MaxInlineSizeThreshold; }
 
+  /// getMaxInlineVectorSizeThreshold - Returns the maximum memset / memcpy
+  /// size of a known size that is expanded into vector loads and stores
+  /// rather than rep/movs, rep/stos or a call.
+  unsigned getMaxInlineVectorSizeThreshold() const {
+    return MaxInlineVectorSizeThreshold;
+  }
+
   /// ParseSubtargetFeatures - Parses features string setting specified
   /// subtarget options.  Definition of function is auto generated by tblgen.
   void ParseSubtargetFeatures(StringRef CPU, StringRef FS);
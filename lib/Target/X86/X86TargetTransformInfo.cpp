@@ -76,6 +76,8 @@ public:
   /// \name Scalar TTI Implementations
   /// @{
   virtual PopcntSupportKind getPopcntSupport(unsigned TyWidth) const;
+  virtual unsigned getCacheLineSize() const;
+  virtual unsigned getCacheMissLatency() const;
 
   /// @}
 
@@ -99,6 +101,11 @@ public:
   virtual unsigned getMemoryOpCost(unsigned Opcode, Type *Src,
                                    unsigned Alignment,
                                    unsigned AddressSpace) const;
+  virtual unsigned getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                              unsigned Factor,
+                                              ArrayRef<unsigned> Indices,
+                                              unsigned Alignment,
+                                              unsigned AddressSpace) const;
 
   virtual unsigned getAddressComputationCost(Type *PtrTy, bool IsComplex) const;
   
@@ -134,17 +141,32 @@ X86TTI::PopcntSupportKind X86TTI::getPopcntSupport(unsigned TyWidth) const {
   return ST->hasPOPCNT() ? PSK_FastHardware : PSK_Software;
 }
 
+unsigned X86TTI::getCacheLineSize() const {
+  // Every x86 processor we model uses 64-byte cache lines.
+  return 64;
+}
+
+unsigned X86TTI::getCacheMissLatency() const {
+  // A rough figure for a trip to DRAM on recent server parts. It only needs
+  // to be in the right range to tell how far ahead to prefetch.
+  return 200;
+}
+
 unsigned X86TTI::getNumberOfRegisters(bool Vector) const {
   if (Vector && !ST->hasSSE1())
     return 0;
 
-  if (ST->is64Bit())
+  if (ST->is64Bit()) {
+    if (Vector && ST->hasAVX512())
+      return 32;
     return 16;
+  }
   return 8;
 }
 
 unsigned X86TTI::getRegisterBitWidth(bool Vector) const {
   if (Vector) {
+    if (ST->hasAVX512()) return 512;
     if (ST->hasAVX()) return 256;
     if (ST->hasSSE1()) return 128;
     return 0;
@@ -177,6 +199,29 @@ unsigned X86TTI::getArithmeticInstrCost(unsigned Opcode, Type *Ty,
   int ISD = TLI->InstructionOpcodeToISD(Opcode);
   assert(ISD && "Invalid opcode");
 
+  static const CostTblEntry<MVT::SimpleValueType> AVX512CostTable[] = {
+    // Shifts on v16i32/v8i64 are legal in AVX-512, but are declared custom
+    // to detect the cases where the shift amount is a scalar.
+    { ISD::SHL,     MVT::v16i32,    1 },
+    { ISD::SRL,     MVT::v16i32,    1 },
+    { ISD::SRA,     MVT::v16i32,    1 },
+    { ISD::SHL,     MVT::v8i64,     1 },
+    { ISD::SRL,     MVT::v8i64,     1 },
+    { ISD::SRA,     MVT::v8i64,     1 },
+
+    // Vectorizing division is a bad idea. See the SSE2 table for more comments.
+    { ISD::SDIV,  MVT::v16i32,  16*20 },
+    { ISD::SDIV,  MVT::v8i64,   8*20 },
+    { ISD::UDIV,  MVT::v16i32,  16*20 },
+    { ISD::UDIV,  MVT::v8i64,   8*20 },
+  };
+
+  if (ST->hasAVX512()) {
+    int Idx = CostTableLookup(AVX512CostTable, ISD, LT.second);
+    if (Idx != -1)
+      return LT.first * AVX512CostTable[Idx].Cost;
+  }
+
   static const CostTblEntry<MVT::SimpleValueType> AVX2CostTable[] = {
     // Shifts on v4i64/v8i32 on AVX2 is legal even though we declare to
     // customize them to detect the cases where shift amount is a scalar one.
@@ -319,10 +364,11 @@ unsigned X86TTI::getArithmeticInstrCost(unsigned Opcode, Type *Ty,
 
   // Custom lowering of vectors.
   static const CostTblEntry<MVT::SimpleValueType> CustomLowered[] = {
-    // A v2i64/v4i64 and multiply is custom lowered as a series of long
+    // A v2i64/v4i64/v8i64 multiply is custom lowered as a series of long
     // multiplies(3), shifts(4) and adds(2).
     { ISD::MUL,     MVT::v2i64,    9 },
     { ISD::MUL,     MVT::v4i64,    9 },
+    { ISD::MUL,     MVT::v8i64,    9 },
   };
   int Idx = CostTableLookup(CustomLowered, ISD, LT.second);
   if (Idx != -1)
@@ -493,6 +539,20 @@ unsigned X86TTI::getCmpSelInstrCost(unsigned Opcode, Type *ValTy,
     { ISD::SETCC,   MVT::v32i8,   1 },
   };
 
+  // AVX-512 compares write a mask register, which selects use directly.
+  static const CostTblEntry<MVT::SimpleValueType> AVX512CostTbl[] = {
+    { ISD::SETCC,   MVT::v8i64,   1 },
+    { ISD::SETCC,   MVT::v16i32,  1 },
+    { ISD::SETCC,   MVT::v8f64,   1 },
+    { ISD::SETCC,   MVT::v16f32,  1 },
+  };
+
+  if (ST->hasAVX512()) {
+    int Idx = CostTableLookup(AVX512CostTbl, ISD, MTy);
+    if (Idx != -1)
+      return LT.first * AVX512CostTbl[Idx].Cost;
+  }
+
   if (ST->hasAVX2()) {
     int Idx = CostTableLookup(AVX2CostTbl, ISD, MTy);
     if (Idx != -1)
@@ -599,6 +659,33 @@ unsigned X86TTI::getMemoryOpCost(unsigned Opcode, Type *Src, unsigned Alignment,
   return Cost;
 }
 
+unsigned X86TTI::getInterleavedMemoryOpCost(unsigned Opcode, Type *VecTy,
+                                            unsigned Factor,
+                                            ArrayRef<unsigned> Indices,
+                                            unsigned Alignment,
+                                            unsigned AddressSpace) const {
+  // Pairs of 32 and 64 bit elements are split and merged with one shufps or
+  // unpck[lh]p[sd] per register of each member.
+  VectorType *VT = cast<VectorType>(VecTy);
+  unsigned EltSize = VT->getScalarSizeInBits();
+  if (Factor == 2 && ST->hasSSE2() && (EltSize == 32 || EltSize == 64)) {
+    Type *SubTy = VectorType::get(VT->getElementType(),
+                                  VT->getNumElements() / Factor);
+    std::pair<unsigned, MVT> LT = TLI->getTypeLegalizationCost(SubTy);
+    unsigned ShuffleCost = LT.first;
+    // These shuffles do not cross the 128 bit lanes of AVX registers, so
+    // each one needs a vperm2f128 as well.
+    if (LT.second.getSizeInBits() > 128)
+      ShuffleCost *= 2;
+    return getMemoryOpCost(Opcode, VecTy, Alignment, AddressSpace) +
+           Indices.size() * ShuffleCost;
+  }
+
+  return TargetTransformInfo::getInterleavedMemoryOpCost(Opcode, VecTy, Factor,
+                                                         Indices, Alignment,
+                                                         AddressSpace);
+}
+
 unsigned X86TTI::getAddressComputationCost(Type *Ty, bool IsComplex) const {
   // Address computations in vectorized code with non-consecutive addresses will
   // likely result in more instructions compared to scalar code where the
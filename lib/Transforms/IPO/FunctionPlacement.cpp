@@ -0,0 +1,387 @@
+//===- FunctionPlacement.cpp - Place functions by their profile -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements two passes that use the entry counts of functions,
+// which the edge and sample profile loaders record, to lay out the text of a
+// program so that the code that runs together is close together.
+//
+// -function-section-prefix gives each function a "section-prefix" attribute
+// naming the kind of text it is, which ELF targets turn into a section such as
+// .text.hot.  The hot functions are those with the highest entry counts that
+// together make up -hot-function-coverage percent of all the entries.
+// Functions that the profile never saw entered, or that are marked cold, are
+// "unlikely", and the static constructors and the internal functions only
+// they call are "startup".  Linkers group these sections, which keeps the hot
+// code on few pages and the startup code out of their way.
+//
+// -order-functions reorders the functions of a module, which is the order
+// they are emitted in, by clustering the call graph as Pettis and Hansen
+// describe: it merges the clusters of callers and callees along the call
+// edges, heaviest first, up to -function-cluster-size instructions, and puts
+// the densest clusters first.  It is most useful in LTO, where it sees the
+// whole program.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "function-placement"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+using namespace llvm;
+
+STATISTIC(NumHot, "Number of functions placed in hot text");
+STATISTIC(NumUnlikely, "Number of functions placed in unlikely text");
+STATISTIC(NumStartup, "Number of functions placed in startup text");
+STATISTIC(NumClustered, "Number of functions ordered by call graph clusters");
+
+static cl::opt<unsigned>
+HotCoverage("hot-function-coverage", cl::init(90), cl::Hidden,
+            cl::desc("The percentage of all profiled function entries that "
+                     "the hot functions account for"));
+
+static cl::opt<unsigned>
+MaxClusterSize("function-cluster-size", cl::init(1024), cl::Hidden,
+               cl::desc("The most instructions -order-functions puts in a "
+                        "cluster of callers and callees"));
+
+/// getFunctionSize - Return the number of instructions in F.
+static uint64_t getFunctionSize(const Function &F) {
+  uint64_t Size = 0;
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Size += BB->size();
+  return Size;
+}
+
+//===----------------------------------------------------------------------===//
+// Section prefixes
+//===----------------------------------------------------------------------===//
+
+namespace {
+  struct FunctionSectionPrefix : public ModulePass {
+    static char ID; // Pass identification, replacement for typeid
+    FunctionSectionPrefix() : ModulePass(ID) {
+      initializeFunctionSectionPrefixPass(*PassRegistry::getPassRegistry());
+    }
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.setPreservesCFG();
+    }
+
+    virtual bool runOnModule(Module &M);
+  };
+}
+
+char FunctionSectionPrefix::ID = 0;
+INITIALIZE_PASS(FunctionSectionPrefix, "function-section-prefix",
+                "Place functions in text sections by profile", false, false)
+
+ModulePass *llvm::createFunctionSectionPrefixPass() {
+  return new FunctionSectionPrefix();
+}
+
+/// getHotThreshold - Return the smallest entry count of the hottest functions
+/// that make up HotCoverage percent of the entries of all of them, or 0 if no
+/// function has a non-zero entry count.
+static uint64_t getHotThreshold(Module &M) {
+  std::vector<uint64_t> Counts;
+  uint64_t Total = 0;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    uint64_t Count;
+    if (F->isDeclaration() || !F->getEntryCount(Count) || Count == 0)
+      continue;
+    Counts.push_back(Count);
+    Total += Count;
+  }
+  if (Counts.empty())
+    return 0;
+
+  std::sort(Counts.begin(), Counts.end(), std::greater<uint64_t>());
+  uint64_t Covered = 0;
+  for (unsigned i = 0, e = Counts.size(); i != e; ++i) {
+    Covered += Counts[i];
+    if (Covered >= Total * (HotCoverage / 100.0))
+      return Counts[i];
+  }
+  return Counts.back();
+}
+
+/// findStartupFunctions - Add to Startup the static constructors of M and the
+/// internal functions that are only called from them.
+static void findStartupFunctions(Module &M,
+                                 SmallPtrSet<const Function *, 16> &Startup) {
+  SmallVector<Function *, 16> Worklist;
+  GlobalVariable *GV = M.getGlobalVariable("llvm.global_ctors");
+  if (GV && GV->hasInitializer())
+    if (ConstantArray *CA = dyn_cast<ConstantArray>(GV->getInitializer()))
+      for (unsigned i = 0, e = CA->getNumOperands(); i != e; ++i) {
+        ConstantStruct *CS = dyn_cast<ConstantStruct>(CA->getOperand(i));
+        if (!CS || CS->getNumOperands() < 2)
+          continue;
+        Function *F = dyn_cast<Function>(CS->getOperand(1));
+        if (F && !F->isDeclaration() && Startup.insert(F))
+          Worklist.push_back(F);
+      }
+
+  while (!Worklist.empty()) {
+    Function *Caller = Worklist.pop_back_val();
+    for (Function::iterator BB = Caller->begin(), E = Caller->end(); BB != E;
+         ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE;
+           ++I) {
+        CallSite CS(I);
+        Function *Callee = CS ? CS.getCalledFunction() : 0;
+        if (!Callee || Callee->isDeclaration() || !Callee->hasLocalLinkage() ||
+            Startup.count(Callee))
+          continue;
+
+        // Each use of the callee must be a call from a startup function.
+        bool OnlyStartup = true;
+        for (Value::use_iterator UI = Callee->use_begin(),
+               UE = Callee->use_end(); UI != UE && OnlyStartup; ++UI) {
+          CallSite UseCS(*UI);
+          OnlyStartup = UseCS && UseCS.isCallee(UI) &&
+                        Startup.count(UseCS.getInstruction()->getParent()
+                                           ->getParent());
+        }
+        if (OnlyStartup) {
+          Startup.insert(Callee);
+          Worklist.push_back(Callee);
+        }
+      }
+  }
+}
+
+bool FunctionSectionPrefix::runOnModule(Module &M) {
+  uint64_t HotThreshold = getHotThreshold(M);
+  SmallPtrSet<const Function *, 16> Startup;
+  findStartupFunctions(M, Startup);
+
+  bool Changed = false;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration() || F->hasSection())
+      continue;
+
+    uint64_t Count;
+    bool HasCount = F->getEntryCount(Count);
+    StringRef Prefix;
+    if (HasCount && HotThreshold && Count >= HotThreshold) {
+      Prefix = "hot";
+      ++NumHot;
+    } else if ((HasCount && Count == 0) ||
+               F->hasFnAttribute(Attribute::Cold)) {
+      Prefix = "unlikely";
+      ++NumUnlikely;
+    } else if (Startup.count(F)) {
+      Prefix = "startup";
+      ++NumStartup;
+    } else {
+      continue;
+    }
+
+    DEBUG(dbgs() << "Placing " << F->getName() << " in " << Prefix
+                 << " text\n");
+    F->addFnAttr("section-prefix", Prefix);
+    Changed = true;
+  }
+  return Changed;
+}
+
+//===----------------------------------------------------------------------===//
+// Call graph ordering
+//===----------------------------------------------------------------------===//
+
+namespace {
+  struct FunctionOrdering : public ModulePass {
+    static char ID; // Pass identification, replacement for typeid
+    FunctionOrdering() : ModulePass(ID) {
+      initializeFunctionOrderingPass(*PassRegistry::getPassRegistry());
+    }
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.addRequired<BlockFrequencyInfo>();
+      AU.setPreservesAll();
+    }
+
+    virtual bool runOnModule(Module &M);
+
+  private:
+    /// Cluster - Functions that are to be laid out together, in order.
+    struct Cluster {
+      Cluster() : Size(0), Count(0) {}
+      std::vector<Function *> Functions;
+      /// The number of instructions in the functions.
+      uint64_t Size;
+      /// The sum of the entry counts of the functions.
+      uint64_t Count;
+    };
+
+    /// CallEdge - The number of calls from one function, by its index, to
+    /// another.
+    struct CallEdge {
+      CallEdge(uint64_t Weight, unsigned Caller, unsigned Callee)
+        : Weight(Weight), Caller(Caller), Callee(Callee) {}
+      uint64_t Weight;
+      unsigned Caller, Callee;
+
+      /// Order the heaviest edges first, and the rest by the order of their
+      /// functions, so that the clusters do not depend on pointer values.
+      bool operator<(const CallEdge &RHS) const {
+        if (Weight != RHS.Weight)
+          return Weight > RHS.Weight;
+        if (Caller != RHS.Caller)
+          return Caller < RHS.Caller;
+        return Callee < RHS.Callee;
+      }
+    };
+
+    void findCallEdges(Function &F, unsigned Index, uint64_t EntryCount,
+                       const DenseMap<const Function *, unsigned> &Indices,
+                       std::vector<CallEdge> &Edges);
+  };
+}
+
+char FunctionOrdering::ID = 0;
+INITIALIZE_PASS_BEGIN(FunctionOrdering, "order-functions",
+                      "Order functions by call graph clusters", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
+INITIALIZE_PASS_END(FunctionOrdering, "order-functions",
+                    "Order functions by call graph clusters", false, false)
+
+ModulePass *llvm::createFunctionOrderingPass() {
+  return new FunctionOrdering();
+}
+
+/// findCallEdges - Add to Edges the direct calls of F, which is entered
+/// EntryCount times, to the functions that Indices numbers, weighted by the
+/// number of times each call site runs.
+void FunctionOrdering::findCallEdges(
+    Function &F, unsigned Index, uint64_t EntryCount,
+    const DenseMap<const Function *, unsigned> &Indices,
+    std::vector<CallEdge> &Edges) {
+  BlockFrequencyInfo &BFI = getAnalysis<BlockFrequencyInfo>(F);
+  double EntryFreq = BFI.getBlockFreq(&F.getEntryBlock()).getFrequency();
+  if (EntryFreq == 0)
+    return;
+
+  DenseMap<unsigned, uint64_t> Weights;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    uint64_t Count = EntryCount *
+                     (BFI.getBlockFreq(BB).getFrequency() / EntryFreq);
+    if (Count == 0)
+      continue;
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      CallSite CS(I);
+      Function *Callee = CS ? CS.getCalledFunction() : 0;
+      if (!Callee || Callee == &F)
+        continue;
+      DenseMap<const Function *, unsigned>::const_iterator It =
+        Indices.find(Callee);
+      if (It != Indices.end())
+        Weights[It->second] += Count;
+    }
+  }
+
+  for (DenseMap<unsigned, uint64_t>::iterator I = Weights.begin(),
+         E = Weights.end(); I != E; ++I)
+    Edges.push_back(CallEdge(I->second, Index, I->first));
+}
+
+bool FunctionOrdering::runOnModule(Module &M) {
+  std::vector<Function *> Functions;
+  DenseMap<const Function *, unsigned> Indices;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (!F->isDeclaration()) {
+      Indices[F] = Functions.size();
+      Functions.push_back(F);
+    }
+
+  // Start with a cluster per function.
+  std::vector<Cluster> Clusters(Functions.size());
+  std::vector<unsigned> ClusterOf(Functions.size());
+  std::vector<CallEdge> Edges;
+  bool HasProfile = false;
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    Function *F = Functions[i];
+    Clusters[i].Functions.push_back(F);
+    Clusters[i].Size = getFunctionSize(*F);
+    ClusterOf[i] = i;
+
+    uint64_t Count;
+    if (!F->getEntryCount(Count) || Count == 0)
+      continue;
+    Clusters[i].Count = Count;
+    HasProfile = true;
+    findCallEdges(*F, i, Count, Indices, Edges);
+  }
+  if (!HasProfile)
+    return false;
+
+  // Merge the clusters at the ends of each edge, heaviest first, appending
+  // the callee's cluster to the caller's.
+  std::sort(Edges.begin(), Edges.end());
+  for (unsigned i = 0, e = Edges.size(); i != e; ++i) {
+    unsigned To = ClusterOf[Edges[i].Caller];
+    unsigned From = ClusterOf[Edges[i].Callee];
+    if (To == From ||
+        Clusters[To].Size + Clusters[From].Size > MaxClusterSize)
+      continue;
+
+    Cluster &Dst = Clusters[To], &Src = Clusters[From];
+    for (unsigned j = 0, je = Src.Functions.size(); j != je; ++j)
+      ClusterOf[Indices[Src.Functions[j]]] = To;
+    Dst.Functions.insert(Dst.Functions.end(), Src.Functions.begin(),
+                         Src.Functions.end());
+    Dst.Size += Src.Size;
+    Dst.Count += Src.Count;
+    Src = Cluster();
+  }
+
+  // Lay out the clusters that ran, densest first, and then the rest in their
+  // original order.
+  std::vector<std::pair<double, unsigned> > Ranked;
+  for (unsigned i = 0, e = Clusters.size(); i != e; ++i)
+    if (Clusters[i].Count)
+      Ranked.push_back(std::make_pair(
+          -double(Clusters[i].Count) / std::max<uint64_t>(Clusters[i].Size, 1),
+          i));
+  std::stable_sort(Ranked.begin(), Ranked.end());
+
+  std::vector<Function *> Order;
+  std::vector<bool> Placed(Functions.size(), false);
+  for (unsigned i = 0, e = Ranked.size(); i != e; ++i) {
+    const Cluster &C = Clusters[Ranked[i].second];
+    DEBUG(dbgs() << "Cluster of " << C.Functions.size() << " functions, "
+                 << C.Count << " entries, " << C.Size << " instructions\n");
+    for (unsigned j = 0, je = C.Functions.size(); j != je; ++j) {
+      Order.push_back(C.Functions[j]);
+      Placed[Indices[C.Functions[j]]] = true;
+      ++NumClustered;
+    }
+  }
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+    if (!Placed[i])
+      Order.push_back(Functions[i]);
+
+  // Move the definitions to the end of the function list in their new order.
+  Module::FunctionListType &FL = M.getFunctionList();
+  for (unsigned i = 0, e = Order.size(); i != e; ++i)
+    FL.splice(FL.end(), FL, Order[i]);
+  return !Ranked.empty();
+}
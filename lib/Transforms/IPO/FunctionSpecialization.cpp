@@ -0,0 +1,276 @@
+//===- FunctionSpecialization.cpp - Clone functions for constant args -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass clones internal functions for constant arguments that some, but
+// not all, of their call sites pass, and redirects those call sites to the
+// clones.  IPSCCP already handles arguments on which all call sites agree.
+//
+// The main targets are generic helpers that take a callback, such as sort
+// routines taking a comparator or visitors taking an action: in the clone the
+// indirect calls through the argument become direct calls, which the inliner
+// can then inline.  Integer arguments that feed comparisons and switches are
+// specialized too, as their branches fold in the clone.
+//
+// Each clone grows the module by the size of the cloned function, unless the
+// original becomes dead.  The total growth is bounded by a percentage of the
+// size of the module.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "function-specialization"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+using namespace llvm;
+
+STATISTIC(NumSpecialized, "Number of function specializations created");
+STATISTIC(NumCallSitesRedirected, "Number of call sites redirected");
+
+static cl::opt<unsigned>
+MaxGrowth("funcspec-max-growth", cl::init(10), cl::Hidden,
+          cl::desc("The most the module may grow by specialization, as a "
+                   "percentage of its instruction count"));
+
+static cl::opt<unsigned>
+MaxFunctionSize("funcspec-max-size", cl::init(500), cl::Hidden,
+                cl::desc("The largest function, in instructions, that is "
+                         "specialized"));
+
+static cl::opt<unsigned>
+MaxClonesPerFunction("funcspec-max-clones", cl::init(3), cl::Hidden,
+                     cl::desc("The most specializations of one function"));
+
+static cl::opt<unsigned>
+CallBonus("funcspec-call-bonus", cl::init(20), cl::Hidden,
+          cl::desc("The estimated benefit of turning an indirect call into "
+                   "a direct call"));
+
+static cl::opt<unsigned>
+BranchBonus("funcspec-branch-bonus", cl::init(4), cl::Hidden,
+            cl::desc("The estimated benefit of a comparison or switch on a "
+                     "constant"));
+
+namespace {
+  /// A constant argument on which to specialize a function.
+  struct Candidate {
+    Function *F;
+    unsigned ArgNo;
+    Constant *C;
+    /// The estimated benefit per call site times the number of call sites.
+    unsigned Score;
+  };
+
+  struct FunctionSpecialization : public ModulePass {
+    static char ID; // Pass identification, replacement for typeid
+    FunctionSpecialization() : ModulePass(ID) {
+      initializeFunctionSpecializationPass(*PassRegistry::getPassRegistry());
+    }
+
+    virtual bool runOnModule(Module &M);
+
+  private:
+    void findCandidates(Function &F, std::vector<Candidate> &Candidates);
+    Function *specialize(const Candidate &C);
+  };
+}
+
+char FunctionSpecialization::ID = 0;
+INITIALIZE_PASS(FunctionSpecialization, "function-specialization",
+                "Function Specialization", false, false)
+
+ModulePass *llvm::createFunctionSpecializationPass() {
+  return new FunctionSpecialization();
+}
+
+static unsigned getInstructionCount(const Function &F) {
+  unsigned Size = 0;
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Size += BB->size();
+  return Size;
+}
+
+/// Return true if F may be cloned and all of its uses are direct calls.
+static bool isSpecializable(const Function &F) {
+  if (F.isDeclaration() || !F.hasLocalLinkage() || F.isVarArg() ||
+      F.hasAddressTaken() || F.hasFnAttribute(Attribute::OptimizeNone) ||
+      F.hasFnAttribute(Attribute::NoDuplicate))
+    return false;
+  for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end();
+         I != IE; ++I) {
+      const CallInst *CI = dyn_cast<CallInst>(I);
+      if (CI && CI->cannotDuplicate())
+        return false;
+    }
+  return true;
+}
+
+/// Estimate what is saved in the body of F when argument A is known to be C.
+static unsigned getSpecializationBonus(Argument *A, Constant *C) {
+  bool IsFunction = isa<Function>(C->stripPointerCasts());
+  unsigned Bonus = 0;
+  for (Value::use_iterator UI = A->use_begin(), E = A->use_end();
+       UI != E; ++UI) {
+    User *U = *UI;
+    if (IsFunction) {
+      CallSite CS(U);
+      if (CS && CS.isCallee(UI))
+        Bonus += CallBonus;
+    } else if (isa<ICmpInst>(U) || isa<SwitchInst>(U)) {
+      Bonus += BranchBonus;
+    }
+  }
+  return Bonus;
+}
+
+void
+FunctionSpecialization::findCandidates(Function &F,
+                                       std::vector<Candidate> &Candidates) {
+  // Count the call sites passing each interesting constant, in the order in
+  // which they are found so that the result does not depend on pointer
+  // values.
+  typedef std::pair<unsigned, Constant *> ArgConst;
+  DenseMap<ArgConst, unsigned> Index;
+  SmallVector<ArgConst, 8> Keys;
+  SmallVector<unsigned, 8> NumCallSites;
+  for (Value::use_iterator UI = F.use_begin(), E = F.use_end(); UI != E; ++UI) {
+    CallSite CS(*UI);
+    assert(CS && CS.isCallee(UI) && "Function with its address taken");
+    for (unsigned i = 0, e = CS.arg_size(); i != e; ++i) {
+      Constant *C = dyn_cast<Constant>(CS.getArgument(i));
+      if (!C ||
+          (!isa<ConstantInt>(C) && !isa<Function>(C->stripPointerCasts())))
+        continue;
+      ArgConst Key(i, C);
+      DenseMap<ArgConst, unsigned>::iterator It = Index.find(Key);
+      if (It == Index.end()) {
+        Index[Key] = Keys.size();
+        Keys.push_back(Key);
+        NumCallSites.push_back(1);
+      } else {
+        ++NumCallSites[It->second];
+      }
+    }
+  }
+
+  SmallVector<Argument *, 8> Args;
+  for (Function::arg_iterator AI = F.arg_begin(), AE = F.arg_end();
+       AI != AE; ++AI)
+    Args.push_back(AI);
+  for (unsigned i = 0, e = Keys.size(); i != e; ++i) {
+    // If every call site passes the constant, IPSCCP propagates it.
+    if (NumCallSites[i] == F.getNumUses())
+      continue;
+    unsigned Bonus = getSpecializationBonus(Args[Keys[i].first],
+                                            Keys[i].second);
+    if (!Bonus)
+      continue;
+    Candidate Cand;
+    Cand.F = &F;
+    Cand.ArgNo = Keys[i].first;
+    Cand.C = Keys[i].second;
+    Cand.Score = Bonus * NumCallSites[i];
+    Candidates.push_back(Cand);
+  }
+}
+
+/// Clone the function of C with its argument replaced by the constant, and
+/// redirect the call sites passing the constant to the clone.  Return null
+/// if no call site is left to redirect.
+Function *FunctionSpecialization::specialize(const Candidate &C) {
+  Function *F = C.F;
+  SmallVector<CallSite, 8> CallSites;
+  for (Value::use_iterator UI = F->use_begin(), E = F->use_end(); UI != E;
+       ++UI) {
+    CallSite CS(*UI);
+    if (CS.getArgument(C.ArgNo) == C.C)
+      CallSites.push_back(CS);
+  }
+  if (CallSites.empty())
+    return 0;
+
+  // Keep the signature, so that call sites only change their callee; the
+  // argument is dead in the clone and left for DeadArgElimination.
+  ValueToValueMapTy VMap;
+  Function *Clone = CloneFunction(F, VMap, /*ModuleLevelChanges=*/false);
+  Clone->setName(F->getName() + ".spec");
+  F->getParent()->getFunctionList().push_back(Clone);
+  Function::arg_iterator AI = Clone->arg_begin();
+  std::advance(AI, C.ArgNo);
+  AI->replaceAllUsesWith(C.C);
+
+  for (unsigned i = 0, e = CallSites.size(); i != e; ++i)
+    CallSites[i].setCalledFunction(Clone);
+  NumCallSitesRedirected += CallSites.size();
+
+  // Recursive calls in the clone that pass the constant along now call the
+  // clone.
+  for (Function::iterator BB = Clone->begin(), E = Clone->end(); BB != E; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      CallSite CS(I);
+      if (CS && CS.getCalledFunction() == F &&
+          CS.getArgument(C.ArgNo) == C.C) {
+        CS.setCalledFunction(Clone);
+        ++NumCallSitesRedirected;
+      }
+    }
+  return Clone;
+}
+
+static bool compareScores(const Candidate &LHS, const Candidate &RHS) {
+  return LHS.Score > RHS.Score;
+}
+
+bool FunctionSpecialization::runOnModule(Module &M) {
+  unsigned ModuleSize = 0;
+  std::vector<Candidate> Candidates;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    ModuleSize += getInstructionCount(*F);
+    if (isSpecializable(*F) && getInstructionCount(*F) <= MaxFunctionSize)
+      findCandidates(*F, Candidates);
+  }
+  if (Candidates.empty())
+    return false;
+
+  // Take the most profitable candidates first, as long as the budget allows.
+  std::stable_sort(Candidates.begin(), Candidates.end(), compareScores);
+  uint64_t Budget = (uint64_t)ModuleSize * MaxGrowth / 100;
+  uint64_t Growth = 0;
+  DenseMap<Function *, unsigned> NumClones;
+  bool Changed = false;
+  for (unsigned i = 0, e = Candidates.size(); i != e; ++i) {
+    const Candidate &C = Candidates[i];
+    unsigned Size = getInstructionCount(*C.F);
+    if (Growth + Size > Budget || NumClones[C.F] >= MaxClonesPerFunction)
+      continue;
+    Function *Clone = specialize(C);
+    if (!Clone)
+      continue;
+    DEBUG(dbgs() << "Specialized " << C.F->getName() << " for argument "
+                 << C.ArgNo << " = " << *C.C << " as " << Clone->getName()
+                 << "\n");
+    ++NumSpecialized;
+    ++NumClones[C.F];
+    Changed = true;
+    // The original is left for GlobalDCE if it has no callers left.
+    if (!C.F->use_empty())
+      Growth += Size;
+  }
+  return Changed;
+}
@@ -20,6 +20,7 @@
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/ValueMap.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/IR/CallingConv.h"
@@ -32,6 +33,7 @@
 #include "llvm/IR/Operator.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/CallSite.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
@@ -59,8 +61,20 @@ STATISTIC(NumNestRemoved   , "Number of nest attributes removed");
 STATISTIC(NumAliasesResolved, "Number of global aliases resolved");
 STATISTIC(NumAliasesRemoved, "Number of global aliases eliminated");
 STATISTIC(NumCXXDtorsRemoved, "Number of global C++ destructors removed");
+STATISTIC(NumSettledSkipped, "Number of unchanged globals not reanalyzed");
+
+static cl::opt<unsigned>
+CtorEvalBudget("globalopt-ctor-eval-budget", cl::init(100000), cl::Hidden,
+               cl::desc("The most instructions evaluated for one static "
+                        "constructor"));
 
 namespace {
+  /// Settled globals are forgotten when they are deleted, and not moved to
+  /// their replacement on RAUW.
+  struct SettledMapConfig : public ValueMapConfig<GlobalVariable*> {
+    enum { FollowRAUW = false };
+  };
+
   struct GlobalOpt : public ModulePass {
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.addRequired<TargetLibraryInfo>();
@@ -85,6 +99,15 @@ namespace {
 
     DataLayout *TD;
     TargetLibraryInfo *TLI;
+
+    /// Settled - The globals that had nothing to optimize when they were last
+    /// processed, with their number of uses at the time.  They are not
+    /// processed again until their uses change.
+    ValueMap<GlobalVariable*, unsigned, SettledMapConfig> Settled;
+
+    /// CtorsOverBudget - The static constructors that could not be evaluated
+    /// within the budget, which are not tried again.
+    SmallPtrSet<Function*, 8> CtorsOverBudget;
   };
 }
 
@@ -1934,6 +1957,22 @@ bool GlobalOpt::OptimizeGlobalVars(Module &M) {
     // Global variables without names cannot be referenced outside this module.
     if (!GV->hasName() && !GV->isDeclaration())
       GV->setLinkage(GlobalValue::InternalLinkage);
+
+    // Skip the globals that had nothing to optimize last time if their uses
+    // have not changed since.  The number of uses is only a cheap
+    // fingerprint, but skipping a global can only miss an optimization.
+    GV->removeDeadConstantUsers();
+    unsigned NumUses = GV->getNumUses();
+    ValueMap<GlobalVariable*, unsigned, SettledMapConfig>::iterator S =
+      Settled.find(GV);
+    if (S != Settled.end()) {
+      if (S->second == NumUses) {
+        ++NumSettledSkipped;
+        continue;
+      }
+      Settled.erase(S);
+    }
+
     // Simplify the initializer.
     if (GV->hasInitializer())
       if (ConstantExpr *CE = dyn_cast<ConstantExpr>(GV->getInitializer())) {
@@ -1942,7 +1981,10 @@ bool GlobalOpt::OptimizeGlobalVars(Module &M) {
           GV->setInitializer(New);
       }
 
-    Changed |= ProcessGlobal(GV, GVI);
+    if (ProcessGlobal(GV, GVI))
+      Changed = true;
+    else
+      Settled[GV] = NumUses;
   }
   return Changed;
 }
@@ -2259,8 +2301,9 @@ namespace {
 /// Once an evaluation call fails, the evaluation object should not be reused.
 class Evaluator {
 public:
-  Evaluator(const DataLayout *TD, const TargetLibraryInfo *TLI)
-    : TD(TD), TLI(TLI) {
+  Evaluator(const DataLayout *TD, const TargetLibraryInfo *TLI,
+            unsigned MaxSteps)
+    : StepsLeft(MaxSteps), TD(TD), TLI(TLI) {
     ValueStack.push_back(new DenseMap<Value*, Constant*>);
   }
 
@@ -2309,6 +2352,10 @@ public:
     return Invariants;
   }
 
+  /// ranOutOfSteps - Return true if the evaluation failed because it took
+  /// more instructions than it was allowed to.
+  bool ranOutOfSteps() const { return StepsLeft == 0; }
+
 private:
   Constant *ComputeLoadResult(Constant *P);
 
@@ -2340,6 +2387,9 @@ private:
   /// simple enough to live in a static initializer of a global.
   SmallPtrSet<Constant*, 8> SimpleConstants;
 
+  /// StepsLeft - The number of instructions that may still be evaluated.
+  unsigned StepsLeft;
+
   const DataLayout *TD;
   const TargetLibraryInfo *TLI;
 };
@@ -2383,6 +2433,12 @@ bool Evaluator::EvaluateBlock(BasicBlock::iterator CurInst,
   while (1) {
     Constant *InstResult = 0;
 
+    if (StepsLeft == 0) {
+      DEBUG(dbgs() << "Out of evaluation steps! Can not evaluate.\n");
+      return false;
+    }
+    --StepsLeft;
+
     DEBUG(dbgs() << "Evaluating Instruction: " << *CurInst << "\n");
 
     if (StoreInst *SI = dyn_cast<StoreInst>(CurInst)) {
@@ -2769,11 +2825,13 @@ bool Evaluator::EvaluateFunction(Function *F, Constant *&RetVal,
 }
 
 /// EvaluateStaticConstructor - Evaluate static constructors in the function, if
-/// we can.  Return true if we can, false otherwise.
+/// we can.  Return true if we can, false otherwise.  OutOfSteps is set if the
+/// evaluation gave up because it took more than CtorEvalBudget instructions.
 static bool EvaluateStaticConstructor(Function *F, const DataLayout *TD,
-                                      const TargetLibraryInfo *TLI) {
+                                      const TargetLibraryInfo *TLI,
+                                      bool &OutOfSteps) {
   // Call the function.
-  Evaluator Eval(TD, TLI);
+  Evaluator Eval(TD, TLI, CtorEvalBudget);
   Constant *RetValDummy;
   bool EvalSuccess = Eval.EvaluateFunction(F, RetValDummy,
                                            SmallVector<Constant*, 0>());
@@ -2793,6 +2851,7 @@ static bool EvaluateStaticConstructor(Function *F, const DataLayout *TD,
       (*I)->setConstant(true);
   }
 
+  OutOfSteps = !EvalSuccess && Eval.ranOutOfSteps();
   return EvalSuccess;
 }
 
@@ -2820,18 +2879,27 @@ bool GlobalOpt::OptimizeGlobalCtorsList(GlobalVariable *&GCL) {
     // We cannot simplify external ctor functions.
     if (F->empty()) continue;
 
+    // Evaluating a constructor that was too big once is not worth retrying.
+    if (CtorsOverBudget.count(F)) continue;
+
     // If we can evaluate the ctor at compile time, do.
-    if (EvaluateStaticConstructor(F, TD, TLI)) {
+    bool OutOfSteps = false;
+    if (EvaluateStaticConstructor(F, TD, TLI, OutOfSteps)) {
       Ctors.erase(Ctors.begin()+i);
       MadeChange = true;
       --i;
       ++NumCtorsEvaluated;
       continue;
     }
+    if (OutOfSteps)
+      CtorsOverBudget.insert(F);
   }
 
   if (!MadeChange) return false;
 
+  // The evaluated constructors changed the initializers of globals, which may
+  // now be optimized.
+  Settled.clear();
   GCL = InstallGlobalCtors(GCL, Ctors);
   return true;
 }
@@ -3181,5 +3249,7 @@ bool GlobalOpt::runOnModule(Module &M) {
   // TODO: Move all global ctors functions to the end of the module for code
   // layout.
 
+  Settled.clear();
+  CtorsOverBudget.clear();
   return Changed;
 }
@@ -0,0 +1,219 @@
+//===- HotColdSplitting.cpp - Outline cold regions of functions -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass moves the regions of a function that BlockFrequencyInfo says
+// rarely run, such as error handling, into functions of their own, so that
+// the code that does run is packed densely into the instruction cache and the
+// TLB.  The outlined functions are marked cold and, on ELF targets, placed in
+// the .text.unlikely section, which linkers group away from the hot code.
+//
+// A region is a cold block whose immediate dominator is not cold, together
+// with the cold blocks it dominates that are only entered through the region.
+// Branch weights from a profile make the estimates, and so the regions,
+// reflect how the program really runs.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "hotcoldsplit"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+using namespace llvm;
+
+STATISTIC(NumOutlined, "Number of cold regions outlined");
+STATISTIC(NumOutlinedInsts, "Number of instructions moved to cold functions");
+
+static cl::opt<unsigned>
+ColdRatio("hotcold-cold-ratio", cl::init(16), cl::Hidden,
+          cl::desc("A block is cold if its estimated frequency is at most "
+                   "that of the function entry divided by this"));
+
+static cl::opt<unsigned>
+MinRegionSize("hotcold-min-size", cl::init(4), cl::Hidden,
+              cl::desc("The fewest instructions in a cold region worth the "
+                       "call that replaces it"));
+
+static cl::opt<std::string>
+ColdSection("hotcold-section", cl::init(".text.unlikely"), cl::Hidden,
+            cl::desc("The section of outlined cold functions on ELF "
+                     "targets"));
+
+namespace {
+  struct HotColdSplitting : public ModulePass {
+    static char ID; // Pass identification, replacement for typeid
+    HotColdSplitting() : ModulePass(ID) {
+      initializeHotColdSplittingPass(*PassRegistry::getPassRegistry());
+    }
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.addRequired<BlockFrequencyInfo>();
+    }
+
+    virtual bool runOnModule(Module &M);
+
+  private:
+    bool splitFunction(Function &F, bool IsELF);
+  };
+}
+
+char HotColdSplitting::ID = 0;
+INITIALIZE_PASS_BEGIN(HotColdSplitting, "hotcoldsplit",
+                      "Hot Cold Splitting", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
+INITIALIZE_PASS_END(HotColdSplitting, "hotcoldsplit",
+                    "Hot Cold Splitting", false, false)
+
+ModulePass *llvm::createHotColdSplittingPass() {
+  return new HotColdSplitting();
+}
+
+bool HotColdSplitting::runOnModule(Module &M) {
+  bool IsELF = Triple(M.getTargetTriple()).isOSBinFormatELF();
+
+  // Collect the functions first, so that the outlined ones are not visited.
+  SmallVector<Function *, 32> Worklist;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (!F->isDeclaration() &&
+        !F->getAttributes().hasAttribute(AttributeSet::FunctionIndex,
+                                         Attribute::Cold))
+      Worklist.push_back(F);
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Worklist.size(); i != e; ++i)
+    Changed |= splitFunction(*Worklist[i], IsELF);
+  return Changed;
+}
+
+/// getColdRegion - Return the blocks of the region headed by Header: the cold
+/// blocks it dominates, less those that could be entered from outside.
+static std::vector<BasicBlock *>
+getColdRegion(BasicBlock *Header, const SmallPtrSet<BasicBlock *, 16> &Cold,
+              DominatorTree &DT) {
+  std::vector<BasicBlock *> Region(1, Header);
+  SmallPtrSet<BasicBlock *, 16> InRegion;
+  InRegion.insert(Header);
+  for (unsigned i = 0; i != Region.size(); ++i)
+    for (succ_iterator SI = succ_begin(Region[i]), SE = succ_end(Region[i]);
+         SI != SE; ++SI)
+      if (Cold.count(*SI) && DT.dominates(Header, *SI) && InRegion.insert(*SI))
+        Region.push_back(*SI);
+
+  // Removing a block with a predecessor outside the region can leave its
+  // successors with one, so repeat until the region has a single entry.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (unsigned i = 1; i < Region.size();) {
+      bool Outside = false;
+      for (pred_iterator PI = pred_begin(Region[i]), PE = pred_end(Region[i]);
+           PI != PE && !Outside; ++PI)
+        Outside = !InRegion.count(*PI);
+      if (!Outside) {
+        ++i;
+        continue;
+      }
+      InRegion.erase(Region[i]);
+      Region.erase(Region.begin() + i);
+      Changed = true;
+    }
+  }
+  return Region;
+}
+
+/// isWorthOutlining - Return true if Region is big enough to outline, and it
+/// can be.  CodeExtractor merges the incoming values of a PHI for blocks in
+/// the region, so they must agree.
+static bool isWorthOutlining(ArrayRef<BasicBlock *> Region) {
+  SmallPtrSet<BasicBlock *, 16> InRegion(Region.begin(), Region.end());
+  unsigned Size = 0;
+  for (unsigned i = 0, e = Region.size(); i != e; ++i) {
+    Size += Region[i]->size();
+    for (succ_iterator SI = succ_begin(Region[i]), SE = succ_end(Region[i]);
+         SI != SE; ++SI) {
+      if (InRegion.count(*SI))
+        continue;
+      for (BasicBlock::iterator I = SI->begin(); isa<PHINode>(I); ++I) {
+        PHINode *PN = cast<PHINode>(I);
+        Value *V = 0;
+        for (unsigned j = 0, je = PN->getNumIncomingValues(); j != je; ++j) {
+          if (!InRegion.count(PN->getIncomingBlock(j)))
+            continue;
+          if (V && V != PN->getIncomingValue(j))
+            return false;
+          V = PN->getIncomingValue(j);
+        }
+      }
+    }
+  }
+  return Size >= MinRegionSize;
+}
+
+bool HotColdSplitting::splitFunction(Function &F, bool IsELF) {
+  BlockFrequencyInfo &BFI = getAnalysis<BlockFrequencyInfo>(F);
+  BasicBlock *Entry = &F.getEntryBlock();
+  uint64_t Threshold = BFI.getBlockFreq(Entry).getFrequency() / ColdRatio;
+  SmallPtrSet<BasicBlock *, 16> Cold;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    if (&*BB != Entry && BFI.getBlockFreq(BB).getFrequency() <= Threshold)
+      Cold.insert(BB);
+  if (Cold.empty())
+    return false;
+
+  // Find all the regions before outlining any, since each outlining changes
+  // the frequencies of the blocks around it.
+  DominatorTree DT;
+  DT.runOnFunction(F);
+  std::vector<std::vector<BasicBlock *> > Regions;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    DomTreeNode *Node = DT.getNode(BB);
+    if (!Cold.count(BB) || !Node || Cold.count(Node->getIDom()->getBlock()))
+      continue;
+    std::vector<BasicBlock *> Region = getColdRegion(BB, Cold, DT);
+    if (isWorthOutlining(Region))
+      Regions.push_back(Region);
+  }
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Regions.size(); i != e; ++i) {
+    // Outlining one region leaves the others alone, but not the dominator
+    // tree, which CodeExtractor checks and updates.
+    if (i != 0)
+      DT.runOnFunction(F);
+    unsigned Size = 0;
+    for (unsigned j = 0, je = Regions[i].size(); j != je; ++j)
+      Size += Regions[i][j]->size();
+
+    CodeExtractor CE(Regions[i], &DT);
+    Function *Outlined = CE.extractCodeRegion();
+    if (!Outlined)
+      continue;
+    DEBUG(dbgs() << "Outlined cold region of " << F.getName() << " into "
+                 << Outlined->getName() << "\n");
+    Outlined->addFnAttr(Attribute::Cold);
+    Outlined->addFnAttr(Attribute::NoInline);
+    Outlined->addFnAttr(Attribute::OptimizeForSize);
+    if (IsELF && !ColdSection.empty())
+      Outlined->setSection(ColdSection);
+    ++NumOutlined;
+    NumOutlinedInsts += Size;
+    Changed = true;
+  }
+  return Changed;
+}
@@ -27,9 +27,14 @@ void llvm::initializeIPO(PassRegistry &Registry) {
   initializeDAEPass(Registry);
   initializeDAHPass(Registry);
   initializeFunctionAttrsPass(Registry);
+  initializeFunctionSpecializationPass(Registry);
+  initializeFunctionOrderingPass(Registry);
+  initializeFunctionSectionPrefixPass(Registry);
   initializeGlobalDCEPass(Registry);
   initializeGlobalOptPass(Registry);
+  initializeHotColdSplittingPass(Registry);
   initializeIPCPPass(Registry);
+  initializeIndirectCallPromotionPass(Registry);
   initializeAlwaysInlinerPass(Registry);
   initializeSimpleInlinerPass(Registry);
   initializeInternalizePassPass(Registry);
@@ -43,7 +48,9 @@ void llvm::initializeIPO(PassRegistry &Registry) {
   initializeStripSymbolsPass(Registry);
   initializeStripDebugDeclarePass(Registry);
   initializeStripDeadDebugInfoPass(Registry);
+  initializeSummaryFunctionAttrsPass(Registry);
   initializeStripNonDebugSymbolsPass(Registry);
+  initializeWholeProgramDevirtPass(Registry);
 }
 
 void LLVMInitializeIPO(LLVMPassRegistryRef R) {
@@ -0,0 +1,230 @@
+//===- IndirectCallPromotion.cpp - Call profiled targets directly ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass promotes indirect calls to direct calls to the targets that their
+// profile says they call most of the time, behind a check of the called
+// pointer, so that the inliner can inline the targets:
+//
+//   %r = call i32 %fp(i32 %x), !prof !0
+//
+// becomes
+//
+//   %cmp = icmp eq i32 (i32)* %fp, @f
+//   br i1 %cmp, label %icp.direct, label %icp.indirect
+// icp.direct:
+//   %r.direct = call i32 @f(i32 %x)
+//   br label %icp.merge
+// icp.indirect:
+//   %r.indirect = call i32 %fp(i32 %x)
+//   br label %icp.merge
+// icp.merge:
+//   %r = phi i32 [ %r.direct, %icp.direct ], [ %r.indirect, %icp.indirect ]
+//
+// The profile is the indirect call target metadata that the edge and sample
+// profile loaders attach to the calls.  Only targets that the module declares
+// can be promoted.  Invokes are left alone.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "indirect-call-promotion"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+using namespace llvm;
+
+STATISTIC(NumPromoted, "Number of indirect call targets promoted");
+
+static cl::opt<unsigned>
+MaxTargets("icp-max-targets", cl::init(2), cl::Hidden,
+           cl::desc("The most targets of an indirect call that are "
+                    "promoted"));
+
+static cl::opt<unsigned>
+MinPercent("icp-min-percent", cl::init(30), cl::Hidden,
+           cl::desc("The smallest share of the calls left, in percent, that "
+                    "a target is promoted for"));
+
+static cl::opt<unsigned>
+MinCount("icp-min-count", cl::init(100), cl::Hidden,
+         cl::desc("The fewest calls that a target is promoted for"));
+
+namespace {
+  struct IndirectCallPromotion : public ModulePass {
+    static char ID; // Pass identification, replacement for typeid
+    IndirectCallPromotion() : ModulePass(ID) {
+      initializeIndirectCallPromotionPass(*PassRegistry::getPassRegistry());
+    }
+
+    virtual bool runOnModule(Module &M);
+
+  private:
+    bool promoteTargets(CallInst *CI, MDNode *Targets);
+  };
+}
+
+char IndirectCallPromotion::ID = 0;
+INITIALIZE_PASS(IndirectCallPromotion, "indirect-call-promotion",
+                "Promote profiled indirect calls", false, false)
+
+ModulePass *llvm::createIndirectCallPromotionPass() {
+  return new IndirectCallPromotion();
+}
+
+/// Return the indirect call target metadata of CI, or null if it has none or
+/// it is malformed.
+static MDNode *getTargetsMetadata(CallInst *CI) {
+  MDNode *MD = CI->getMetadata(LLVMContext::MD_prof);
+  if (!MD || MD->getNumOperands() < 2 || MD->getNumOperands() % 2 != 0)
+    return 0;
+  MDString *Kind = dyn_cast<MDString>(MD->getOperand(0));
+  if (!Kind || Kind->getString() != "indirect_call_targets" ||
+      !isa<ConstantInt>(MD->getOperand(1)))
+    return 0;
+  for (unsigned i = 2, e = MD->getNumOperands(); i != e; i += 2)
+    if (!isa<MDString>(MD->getOperand(i)) ||
+        !isa<ConstantInt>(MD->getOperand(i + 1)))
+      return 0;
+  return MD;
+}
+
+/// Return true if CI may call F directly, with F cast to the type of the
+/// called pointer.
+static bool isLegalToPromote(Function *F, CallInst *CI) {
+  if (F->getCallingConv() != CI->getCallingConv())
+    return false;
+  PointerType *CalleeTy = cast<PointerType>(CI->getCalledValue()->getType());
+  FunctionType *CallTy = cast<FunctionType>(CalleeTy->getElementType());
+  FunctionType *FTy = F->getFunctionType();
+  if (FTy == CallTy)
+    return true;
+  if (FTy->isVarArg() != CallTy->isVarArg() ||
+      FTy->getNumParams() != CallTy->getNumParams())
+    return false;
+  if (FTy->getReturnType() != CallTy->getReturnType() &&
+      !CastInst::isBitCastable(FTy->getReturnType(),
+                               CallTy->getReturnType()))
+    return false;
+  for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
+    if (!CastInst::isBitCastable(CallTy->getParamType(i),
+                                 FTy->getParamType(i)))
+      return false;
+  return true;
+}
+
+/// Call Target directly from CI when the called pointer is Target.  CI stays
+/// as the call for the other targets.
+static void promote(CallInst *CI, Function *Target, uint64_t Count,
+                    uint64_t Total) {
+  LLVMContext &Ctx = CI->getContext();
+  BasicBlock *Head = CI->getParent();
+  Function *F = Head->getParent();
+  BasicBlock *Merge = Head->splitBasicBlock(CI->getNextNode(), "icp.merge");
+  BasicBlock *Direct = BasicBlock::Create(Ctx, "icp.direct", F, Merge);
+  BasicBlock *Indirect = BasicBlock::Create(Ctx, "icp.indirect", F, Merge);
+  BranchInst::Create(Merge, Direct);
+  CI->moveBefore(BranchInst::Create(Merge, Indirect));
+
+  Value *Callee = CI->getCalledValue();
+  Constant *DirectCallee = ConstantExpr::getBitCast(Target, Callee->getType());
+  CallInst *DirectCall = cast<CallInst>(CI->clone());
+  DirectCall->setCalledFunction(DirectCallee);
+  DirectCall->setMetadata(LLVMContext::MD_prof, 0);
+  DirectCall->insertBefore(Direct->getTerminator());
+
+  // Branch weights are 32 bits wide.
+  uint64_t Scale = Total / UINT32_MAX + 1;
+  IRBuilder<> Builder(Head->getTerminator());
+  Builder.SetCurrentDebugLocation(CI->getDebugLoc());
+  Builder.CreateCondBr(Builder.CreateICmpEQ(Callee, DirectCallee), Direct,
+                       Indirect,
+                       MDBuilder(Ctx).createBranchWeights(
+                           Count / Scale, (Total - Count) / Scale));
+  Head->getTerminator()->eraseFromParent();
+
+  if (!CI->getType()->isVoidTy() && !CI->use_empty()) {
+    PHINode *PN = PHINode::Create(CI->getType(), 2, "", Merge->begin());
+    PN->takeName(CI);
+    CI->replaceAllUsesWith(PN);
+    DirectCall->setName(PN->getName() + ".direct");
+    CI->setName(PN->getName() + ".indirect");
+    PN->addIncoming(DirectCall, Direct);
+    PN->addIncoming(CI, Indirect);
+  }
+}
+
+/// Promote the most frequent of the profiled targets of CI.  Return true if
+/// any was.
+bool IndirectCallPromotion::promoteTargets(CallInst *CI, MDNode *Targets) {
+  Module *M = CI->getParent()->getParent()->getParent();
+  uint64_t Total = cast<ConstantInt>(Targets->getOperand(1))->getZExtValue();
+
+  // The targets come most frequent first, so the first one that is called too
+  // rarely ends the promotion.
+  unsigned NumPromotedHere = 0;
+  bool Done = false;
+  SmallVector<std::pair<StringRef, uint64_t>, 4> Remaining;
+  for (unsigned i = 2, e = Targets->getNumOperands(); i != e; i += 2) {
+    MDString *Name = cast<MDString>(Targets->getOperand(i));
+    uint64_t Count = std::min(
+        cast<ConstantInt>(Targets->getOperand(i + 1))->getZExtValue(), Total);
+    Done |= NumPromotedHere == MaxTargets || Count < MinCount ||
+            Count * 100 < MinPercent * Total;
+    Function *Target = Done ? 0 : M->getFunction(Name->getString());
+    if (!Target || !isLegalToPromote(Target, CI)) {
+      Remaining.push_back(std::make_pair(Name->getString(), Count));
+      continue;
+    }
+
+    DEBUG(dbgs() << "Promoting call to " << Target->getName() << " in "
+                 << CI->getParent()->getParent()->getName() << ": " << Count
+                 << " of " << Total << " calls\n");
+    promote(CI, Target, Count, Total);
+    Total -= Count;
+    ++NumPromotedHere;
+    ++NumPromoted;
+  }
+  if (!NumPromotedHere)
+    return false;
+
+  // What is left of the profile describes the calls that still go through
+  // the pointer.
+  CI->setMetadata(LLVMContext::MD_prof,
+                  MDBuilder(CI->getContext())
+                      .createIndirectCallTargets(Total, Remaining));
+  return true;
+}
+
+bool IndirectCallPromotion::runOnModule(Module &M) {
+  SmallVector<std::pair<CallInst *, MDNode *>, 16> Calls;
+  for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F)
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE;
+           ++I) {
+        CallInst *CI = dyn_cast<CallInst>(I);
+        if (!CI || CI->getCalledFunction() || CI->isInlineAsm())
+          continue;
+        if (MDNode *Targets = getTargetsMetadata(CI))
+          Calls.push_back(std::make_pair(CI, Targets));
+      }
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Calls.size(); i != e; ++i)
+    Changed |= promoteTargets(Calls[i].first, Calls[i].second);
+  return Changed;
+}
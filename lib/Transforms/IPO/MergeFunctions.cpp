@@ -9,13 +9,14 @@
 //
 // This pass looks for equivalent functions that are mergable and folds them.
 //
-// A hash is computed from the function, based on its type and number of
-// basic blocks.
+// A hash is computed from the function, based on its type and on the
+// structure of its body: the opcode and type of each instruction, and which
+// argument, instruction or block each operand refers to.
 //
 // Once all hashes are computed, we perform an expensive equality comparison
-// on each function pair. This takes n^2/2 comparisons per bucket, so it's
-// important that the hash function be high quality. The equality comparison
-// iterates through each instruction in each basic block.
+// on each function pair with the same hash. This takes n^2/2 comparisons per
+// bucket, so it's important that the hash function be high quality. The
+// equality comparison iterates through each instruction in each basic block.
 //
 // When a match is found the functions are folded. If both functions are
 // overridable, we move the functionality into a new internal function and
@@ -48,6 +49,7 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/Constants.h"
@@ -71,6 +73,7 @@ STATISTIC(NumFunctionsMerged, "Number of functions merged");
 STATISTIC(NumThunksWritten, "Number of thunks generated");
 STATISTIC(NumAliasesWritten, "Number of aliases generated");
 STATISTIC(NumDoubleWeak, "Number of new functions created");
+STATISTIC(NumComparisons, "Number of function pairs compared in full");
 
 /// Returns the type id for a type to be hashed. We turn pointer types into
 /// integers here because the actual compare logic below considers pointers and
@@ -82,8 +85,9 @@ static Type::TypeID getTypeIDForHash(Type *Ty) {
 }
 
 /// Creates a hash-code for the function which is the same for any two
-/// functions that will compare equal, without looking at the instructions
-/// inside the function.
+/// functions that will compare equal.  Only what FunctionComparator requires
+/// to match exactly goes into the hash, so GEPs contribute little more than
+/// their opcode and constants only their kind.
 static unsigned profileFunction(const Function *F) {
   FunctionType *FTy = F->getFunctionType();
 
@@ -95,6 +99,63 @@ static unsigned profileFunction(const Function *F) {
   ID.AddInteger(getTypeIDForHash(FTy->getReturnType()));
   for (unsigned i = 0, e = FTy->getNumParams(); i != e; ++i)
     ID.AddInteger(getTypeIDForHash(FTy->getParamType(i)));
+  if (F->isDeclaration())
+    return ID.ComputeHash();
+
+  // Visit the blocks in the same order as FunctionComparator::compare, so
+  // that equivalent values of equal functions get the same number.
+  DenseMap<const Value *, unsigned> Numbers;
+  unsigned NextNumber = 1;
+  for (Function::const_arg_iterator AI = F->arg_begin(), AE = F->arg_end();
+       AI != AE; ++AI)
+    Numbers[AI] = NextNumber++;
+
+  SmallVector<const BasicBlock *, 16> Blocks;
+  SmallVector<const BasicBlock *, 8> Worklist;
+  SmallPtrSet<const BasicBlock *, 16> VisitedBBs;
+  Worklist.push_back(&F->getEntryBlock());
+  VisitedBBs.insert(&F->getEntryBlock());
+  while (!Worklist.empty()) {
+    const BasicBlock *BB = Worklist.pop_back_val();
+    Blocks.push_back(BB);
+    Numbers[BB] = NextNumber++;
+    for (BasicBlock::const_iterator I = BB->begin(), E = BB->end(); I != E;
+         ++I)
+      Numbers[I] = NextNumber++;
+
+    const TerminatorInst *TI = BB->getTerminator();
+    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i)
+      if (VisitedBBs.insert(TI->getSuccessor(i)))
+        Worklist.push_back(TI->getSuccessor(i));
+  }
+
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i) {
+    const BasicBlock *BB = Blocks[i];
+    ID.AddInteger(BB->size());
+    for (BasicBlock::const_iterator I = BB->begin(), E = BB->end(); I != E;
+         ++I) {
+      ID.AddInteger(I->getOpcode());
+      if (const GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(I)) {
+        // With DataLayout, GEPs compare equal when they add the same offset,
+        // however they are indexed.
+        ID.AddInteger(GEP->getPointerAddressSpace());
+        ID.AddInteger(Numbers.lookup(GEP->getPointerOperand()));
+        continue;
+      }
+
+      ID.AddInteger(getTypeIDForHash(I->getType()));
+      ID.AddInteger(I->getRawSubclassOptionalData());
+      if (const CmpInst *CI = dyn_cast<CmpInst>(I))
+        ID.AddInteger(CI->getPredicate());
+      ID.AddInteger(I->getNumOperands());
+      for (unsigned j = 0, je = I->getNumOperands(); j != je; ++j) {
+        const Value *Op = I->getOperand(j);
+        ID.AddInteger(Op->getValueID());
+        ID.AddInteger(getTypeIDForHash(Op->getType()));
+        ID.AddInteger(Numbers.lookup(Op));
+      }
+    }
+  }
   return ID.ComputeHash();
 }
 
@@ -111,6 +172,11 @@ public:
   ComparableFunction(Function *Func, DataLayout *TD)
     : Func(Func), Hash(profileFunction(Func)), TD(TD) {}
 
+  /// ComparableFunction - A key that finds Func, inserted earlier with the
+  /// given hash, by pointer comparison alone.
+  ComparableFunction(Function *Func, unsigned Hash)
+    : Func(Func), Hash(Hash), TD(LookupOnly) {}
+
   Function *getFunc() const { return Func; }
   unsigned getHash() const { return Hash; }
   DataLayout *getTD() const { return TD; }
@@ -605,6 +671,11 @@ private:
   /// to modify it.
   FnSetType FnSet;
 
+  /// The hash each function in FnSet was inserted with. A function's hash
+  /// depends on its body, which may have changed since, so remove() uses this
+  /// to find it.
+  DenseMap<Function *, unsigned> FnHashes;
+
   /// DataLayout for more accurate GEP comparisons. May be NULL.
   DataLayout *TD;
 
@@ -669,14 +740,16 @@ bool MergeFunctions::runOnModule(Module &M) {
   } while (!Deferred.empty());
 
   FnSet.clear();
+  FnHashes.clear();
 
   return Changed;
 }
 
 bool DenseMapInfo<ComparableFunction>::isEqual(const ComparableFunction &LHS,
                                                const ComparableFunction &RHS) {
-  if (LHS.getFunc() == RHS.getFunc() &&
-      LHS.getHash() == RHS.getHash())
+  if (LHS.getHash() != RHS.getHash())
+    return false;
+  if (LHS.getFunc() == RHS.getFunc())
     return true;
   if (!LHS.getFunc() || !RHS.getFunc())
     return false;
@@ -689,6 +762,7 @@ bool DenseMapInfo<ComparableFunction>::isEqual(const ComparableFunction &LHS,
   assert(LHS.getTD() == RHS.getTD() &&
          "Comparing functions for different targets");
 
+  ++NumComparisons;
   return FunctionComparator(LHS.getTD(), LHS.getFunc(),
                             RHS.getFunc()).compare();
 }
@@ -839,6 +913,7 @@ bool MergeFunctions::insert(ComparableFunction &NewF) {
   std::pair<FnSetType::iterator, bool> Result = FnSet.insert(NewF);
   if (Result.second) {
     DEBUG(dbgs() << "Inserting as unique: " << NewF.getFunc()->getName() << '\n');
+    FnHashes[NewF.getFunc()] = NewF.getHash();
     return false;
   }
 
@@ -878,7 +953,11 @@ void MergeFunctions::remove(Function *F) {
   // The special "lookup only" ComparableFunction bypasses the expensive
   // function comparison in favour of a pointer comparison on the underlying
   // Function*'s.
-  ComparableFunction CF = ComparableFunction(F, ComparableFunction::LookupOnly);
+  DenseMap<Function *, unsigned>::iterator I = FnHashes.find(F);
+  if (I == FnHashes.end())
+    return;
+  ComparableFunction CF = ComparableFunction(F, I->second);
+  FnHashes.erase(I);
   if (FnSet.erase(CF)) {
     DEBUG(dbgs() << "Removed " << F->getName() << " from set and deferred it.\n");
     Deferred.push_back(F);
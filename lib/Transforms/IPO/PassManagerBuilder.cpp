@@ -58,6 +58,56 @@ static cl::opt<bool>
 RunLoopRerolling("reroll-loops", cl::Hidden,
                  cl::desc("Run the loop rerolling pass"));
 
+static cl::opt<bool>
+RunLoopFusion("fuse-loops", cl::init(false), cl::Hidden,
+  cl::desc("Fuse adjacent loops with the same trip count before "
+           "vectorization"));
+
+static cl::opt<bool>
+RunLoopDistribution("distribute-loops", cl::init(false), cl::Hidden,
+  cl::desc("Split loops so that recurrences do not block the vectorization "
+           "of the rest of the loop body"));
+
+static cl::opt<bool>
+RunLoopDataPrefetch("prefetch-loop-data", cl::init(false), cl::Hidden,
+  cl::desc("Insert software prefetches for large-stride loop accesses"));
+
+static cl::opt<bool>
+RunLoopInvariantDivision("expand-loop-invariant-div", cl::init(false),
+  cl::Hidden, cl::desc("Multiply by a hoisted reciprocal instead of dividing "
+                       "by loop invariants"));
+
+static cl::opt<bool>
+RunFunctionSpecialization("specialize-functions", cl::init(false), cl::Hidden,
+  cl::desc("Clone functions for constant arguments such as callbacks"));
+
+static cl::opt<bool>
+RunIndirectCallPromotion("promote-indirect-calls", cl::init(false), cl::Hidden,
+  cl::desc("Call the profiled targets of indirect calls directly"));
+
+static cl::opt<bool>
+UseSummaryFunctionAttrs("lto-summary-functionattrs", cl::init(false),
+  cl::Hidden, cl::desc("Deduce function attributes in LTO from summaries "
+                       "computed in parallel"));
+
+static cl::opt<bool>
+RunHotColdSplitting("split-cold-code", cl::init(false), cl::Hidden,
+  cl::desc("Outline the cold regions of functions into cold functions"));
+
+static cl::opt<bool>
+RunFunctionSectionPrefix("profile-section-prefix", cl::init(false), cl::Hidden,
+  cl::desc("Place functions in hot, unlikely and startup text sections by "
+           "their profiled entry counts"));
+
+static cl::opt<bool>
+RunFunctionOrdering("lto-order-functions", cl::init(false), cl::Hidden,
+  cl::desc("Order functions by clustering the profiled call graph in LTO"));
+
+static cl::opt<bool>
+UseInstSimplifyCache("use-instsimplify-cache", cl::init(false), cl::Hidden,
+  cl::desc("Remember the instructions that could not be simplified, so that "
+           "later passes do not try them again"));
+
 PassManagerBuilder::PassManagerBuilder() {
     OptLevel = 2;
     SizeLevel = 0;
@@ -153,12 +203,20 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
 
   addInitialAliasAnalysisPasses(MPM);
 
+  if (UseInstSimplifyCache)
+    MPM.add(createInstSimplifyCachePass());
+
   if (!DisableUnitAtATime) {
     addExtensionsToPM(EP_ModuleOptimizerEarly, MPM);
 
     MPM.add(createGlobalOptimizerPass());     // Optimize out global vars
 
     MPM.add(createIPSCCPPass());              // IP SCCP
+    // Specialize before the inliner, so that it sees the direct calls.
+    if (RunFunctionSpecialization && OptLevel > 1)
+      MPM.add(createFunctionSpecializationPass());
+    if (RunIndirectCallPromotion && OptLevel > 1)
+      MPM.add(createIndirectCallPromotionPass());
     MPM.add(createDeadArgEliminationPass());  // Dead argument elimination
 
     MPM.add(createInstructionCombiningPass());// Clean up after IPCP & DAE
@@ -194,14 +252,22 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
   MPM.add(createReassociatePass());           // Reassociate expressions
   MPM.add(createLoopRotatePass());            // Rotate Loop
   MPM.add(createLICMPass());                  // Hoist loop invariants
+  // After LICM, so that the divisors have been hoisted where possible.
+  if (RunLoopInvariantDivision && OptLevel > 1)
+    MPM.add(createLoopInvariantDivisionPass());
   MPM.add(createLoopUnswitchPass(SizeLevel || OptLevel < 3));
   MPM.add(createInstructionCombiningPass());
   MPM.add(createIndVarSimplifyPass());        // Canonicalize indvars
   MPM.add(createLoopIdiomPass());             // Recognize idioms like memset.
   MPM.add(createLoopDeletionPass());          // Delete dead loops
 
-  if (!LateVectorize && LoopVectorize)
-      MPM.add(createLoopVectorizePass(DisableUnrollLoops));
+  if (!LateVectorize && LoopVectorize) {
+    if (RunLoopFusion)
+      MPM.add(createLoopFusionPass());
+    if (RunLoopDistribution)
+      MPM.add(createLoopDistributePass());
+    MPM.add(createLoopVectorizePass(DisableUnrollLoops));
+  }
 
   if (!DisableUnrollLoops)
     MPM.add(createLoopUnrollPass());          // Unroll small loops
@@ -254,11 +320,25 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
 
     // Add the various vectorization passes and relevant cleanup passes for
     // them since we are no longer in the middle of the main scalar pipeline.
+    if (RunLoopFusion)
+      MPM.add(createLoopFusionPass());
+    if (RunLoopDistribution)
+      MPM.add(createLoopDistributePass());
     MPM.add(createLoopVectorizePass(DisableUnrollLoops));
     MPM.add(createInstructionCombiningPass());
     MPM.add(createCFGSimplificationPass());
   }
 
+  // Prefetch once vectorization and unrolling have fixed the loop bodies,
+  // since their size decides how far ahead to prefetch.
+  if (RunLoopDataPrefetch && OptLevel > 1)
+    MPM.add(createLoopDataPrefetchPass());
+
+  // Outline cold code after inlining, so that the inliner sees whole
+  // functions and cold code inlined into hot callers is outlined too.
+  if (RunHotColdSplitting && OptLevel > 1)
+    MPM.add(createHotColdSplittingPass());
+
   if (!DisableUnitAtATime) {
     // FIXME: We shouldn't bother with this anymore.
     MPM.add(createStripDeadPrototypesPass()); // Get rid of dead prototypes
@@ -270,6 +350,10 @@ void PassManagerBuilder::populateModulePassManager(PassManagerBase &MPM) {
       MPM.add(createConstantMergePass());     // Merge dup global constants
     }
   }
+
+  // Place functions once inlining and outlining have settled what they are.
+  if (RunFunctionSectionPrefix)
+    MPM.add(createFunctionSectionPrefixPass());
   addExtensionsToPM(EP_OptimizerLast, MPM);
 }
 
@@ -301,6 +385,10 @@ void PassManagerBuilder::populateLTOPassManager(PassManagerBase &PM,
   // Remove unused arguments from functions.
   PM.add(createDeadArgEliminationPass());
 
+  // Turn virtual calls with a single possible target into direct calls, so
+  // that the inliner sees them.
+  PM.add(createWholeProgramDevirtPass());
+
   // Reduce the code after globalopt and ipsccp.  Both can open up significant
   // simplification opportunities, and both can propagate functions through
   // function pointers.  When this happens, we often have to resolve varargs
@@ -333,7 +421,10 @@ void PassManagerBuilder::populateLTOPassManager(PassManagerBase &PM,
     PM.add(createScalarReplAggregatesPass());
 
   // Run a few AA driven optimizations here and now, to cleanup the code.
-  PM.add(createFunctionAttrsPass()); // Add nocapture.
+  if (UseSummaryFunctionAttrs)
+    PM.add(createSummaryFunctionAttrsPass()); // Add nocapture.
+  else
+    PM.add(createFunctionAttrsPass()); // Add nocapture.
   PM.add(createGlobalsModRefPass()); // IP alias analysis.
 
   PM.add(createLICMPass());                 // Hoist loop invariants.
@@ -353,6 +444,12 @@ void PassManagerBuilder::populateLTOPassManager(PassManagerBase &PM,
 
   // Now that we have optimized the program, discard unreachable functions.
   PM.add(createGlobalDCEPass());
+
+  // Lay out the text of the whole program from its profile.
+  if (RunFunctionSectionPrefix)
+    PM.add(createFunctionSectionPrefixPass());
+  if (RunFunctionOrdering)
+    PM.add(createFunctionOrderingPass());
 }
 
 inline PassManagerBuilder *unwrap(LLVMPassManagerBuilderRef P) {
@@ -0,0 +1,378 @@
+//===- SummaryFunctionAttrs.cpp - Summary-based function attributes -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass deduces the same readnone/readonly function attributes and
+// nocapture argument attributes as -functionattrs, but is laid out for LTO of
+// large programs.  Instead of walking the call graph an SCC at a time and
+// asking alias analysis about every instruction, it first computes a summary
+// of each function from its body alone:
+//
+//  - whether the function itself reads or writes non-local memory, not
+//    counting its direct calls to other functions of the module,
+//  - the functions of the module that it calls directly, and
+//  - for each pointer argument, whether the function captures it, or else
+//    the arguments of other functions of the module that it is passed to.
+//
+// The summaries do not depend on each other, so they are computed on the
+// default ThreadPool.  The memory effects are then propagated bottom-up over
+// the SCCs of the call graph, and captures are propagated backwards along
+// the argument flow edges, starting from the arguments that are certainly
+// captured.
+//
+// The summaries only look through pointers to allocas and constant globals,
+// where -functionattrs asks alias analysis, so this pass may deduce less.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "summary-functionattrs"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/CaptureTracking.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/InstIterator.h"
+#include "llvm/Support/Parallel.h"
+#include <algorithm>
+#include <vector>
+using namespace llvm;
+
+STATISTIC(NumReadNone, "Number of functions marked readnone");
+STATISTIC(NumReadOnly, "Number of functions marked readonly");
+STATISTIC(NumNoCapture, "Number of arguments marked nocapture");
+
+namespace {
+  /// The memory that a function may access, ordered so that the effect of
+  /// several instructions is the largest of their effects.
+  enum MemoryEffect {
+    NoAccess = 0,
+    MayRead = 1,
+    MayWrite = 2
+  };
+
+  /// What a function does with one of its pointer arguments.
+  struct ArgumentSummary {
+    Argument *Arg;
+    bool Captured;
+    /// The arguments of functions of the module that Arg is passed to,
+    /// which capture Arg if they capture their own argument.
+    SmallVector<Argument *, 2> FlowsInto;
+  };
+
+  /// The facts about a function that can be computed without looking at any
+  /// other function.
+  struct FunctionSummary {
+    Function *F;
+    MemoryEffect LocalEffect;
+    MemoryEffect Effect;
+    SmallVector<Function *, 4> Callees;
+    SmallVector<ArgumentSummary, 2> Args;
+  };
+
+  typedef DenseMap<Function *, FunctionSummary *> SummaryMapTy;
+
+  /// Collects the uses through which an argument escapes into other
+  /// summarized functions, like ArgumentUsesTracker in -functionattrs.
+  struct ArgumentFlowTracker : public CaptureTracker {
+    ArgumentFlowTracker(const SummaryMapTy &Summaries)
+      : Captured(false), Summaries(Summaries) {}
+
+    void tooManyUses() { Captured = true; }
+
+    bool captured(Use *U) {
+      CallSite CS(U->getUser());
+      Function *F = CS ? CS.getCalledFunction() : 0;
+      if (!F || !Summaries.count(F) || U < CS.arg_begin() ||
+          U >= CS.arg_end()) {
+        Captured = true;
+        return true;
+      }
+      unsigned ArgNo = U - CS.arg_begin();
+      if (ArgNo >= F->arg_size()) {
+        // Passed through the varargs.
+        Captured = true;
+        return true;
+      }
+      Function::arg_iterator AI = F->arg_begin();
+      std::advance(AI, ArgNo);
+      FlowsInto.push_back(AI);
+      return false;
+    }
+
+    bool Captured;
+    SmallVector<Argument *, 2> FlowsInto;
+
+    const SummaryMapTy &Summaries;
+  };
+
+  /// Fills in the summary of one function.  Runs on several threads at once,
+  /// so it only reads the IR.
+  struct SummarizeFunction {
+    const SummaryMapTy *Summaries;
+
+    SummarizeFunction(const SummaryMapTy &Summaries) : Summaries(&Summaries) {}
+
+    void operator()(FunctionSummary &S) const;
+  };
+
+  struct SummaryFunctionAttrs : public ModulePass {
+    static char ID; // Pass identification, replacement for typeid
+    SummaryFunctionAttrs() : ModulePass(ID) {
+      initializeSummaryFunctionAttrsPass(*PassRegistry::getPassRegistry());
+    }
+
+    virtual bool runOnModule(Module &M);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.setPreservesCFG();
+      AU.addRequired<CallGraph>();
+      AU.addPreserved<CallGraph>();
+    }
+
+  private:
+    void propagateEffects(CallGraph &CG, SummaryMapTy &Summaries);
+    void propagateCaptures(std::vector<FunctionSummary> &Summaries);
+    bool addReadAttrs(std::vector<FunctionSummary> &Summaries);
+    bool addNoCaptureAttrs(std::vector<FunctionSummary> &Summaries);
+  };
+}
+
+char SummaryFunctionAttrs::ID = 0;
+INITIALIZE_PASS_BEGIN(SummaryFunctionAttrs, "summary-functionattrs",
+                "Deduce function attributes from summaries", false, false)
+INITIALIZE_PASS_DEPENDENCY(CallGraph)
+INITIALIZE_PASS_END(SummaryFunctionAttrs, "summary-functionattrs",
+                "Deduce function attributes from summaries", false, false)
+
+ModulePass *llvm::createSummaryFunctionAttrsPass() {
+  return new SummaryFunctionAttrs();
+}
+
+/// Return true if Ptr only points to memory that the function owns or that
+/// never changes, so that accessing it is not a side effect.
+static bool isLocalOrConstantMemory(Value *Ptr) {
+  Value *Obj = GetUnderlyingObject(Ptr);
+  if (isa<AllocaInst>(Obj))
+    return true;
+  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(Obj))
+    return GV->isConstant();
+  return false;
+}
+
+/// Return the effect of a call that is not to a summarized function.
+static MemoryEffect getCallEffect(CallSite CS) {
+  if (CS.doesNotAccessMemory())
+    return NoAccess;
+  if (CS.onlyReadsMemory())
+    return MayRead;
+  return MayWrite;
+}
+
+void SummarizeFunction::operator()(FunctionSummary &S) const {
+  S.LocalEffect = NoAccess;
+  for (inst_iterator II = inst_begin(S.F), E = inst_end(S.F); II != E; ++II) {
+    Instruction *I = &*II;
+    MemoryEffect Effect = NoAccess;
+    CallSite CS(I);
+    if (CS) {
+      Function *Callee = CS.getCalledFunction();
+      if (Callee && Summaries->count(Callee)) {
+        // Accounted for when the effects are propagated.
+        if (std::find(S.Callees.begin(), S.Callees.end(), Callee) ==
+            S.Callees.end())
+          S.Callees.push_back(Callee);
+        continue;
+      }
+      Effect = getCallEffect(CS);
+    } else if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+      if (LI->isVolatile() || !isLocalOrConstantMemory(LI->getPointerOperand()))
+        Effect = MayRead;
+    } else if (StoreInst *SI = dyn_cast<StoreInst>(I)) {
+      // A store to a constant global is undefined, so only allocas count.
+      if (SI->isVolatile() ||
+          !isa<AllocaInst>(GetUnderlyingObject(SI->getPointerOperand())))
+        Effect = MayWrite;
+    } else if (I->mayWriteToMemory()) {
+      Effect = MayWrite;
+    } else if (I->mayReadFromMemory()) {
+      Effect = MayRead;
+    }
+    S.LocalEffect = std::max(S.LocalEffect, Effect);
+  }
+  S.Effect = S.LocalEffect;
+
+  for (Function::arg_iterator A = S.F->arg_begin(), E = S.F->arg_end();
+       A != E; ++A) {
+    if (!A->getType()->isPointerTy() || A->hasNoCaptureAttr())
+      continue;
+    ArgumentFlowTracker Tracker(*Summaries);
+    PointerMayBeCaptured(A, &Tracker);
+    S.Args.push_back(ArgumentSummary());
+    ArgumentSummary &AS = S.Args.back();
+    AS.Arg = A;
+    AS.Captured = Tracker.Captured;
+    if (!AS.Captured)
+      AS.FlowsInto.swap(Tracker.FlowsInto);
+  }
+}
+
+/// Compute the effect of every summarized function, including that of the
+/// functions it calls, visiting callees before their callers.
+void SummaryFunctionAttrs::propagateEffects(CallGraph &CG,
+                                            SummaryMapTy &Summaries) {
+  SmallPtrSet<Function *, 8> SCCNodes;
+  SmallVector<FunctionSummary *, 8> SCCSummaries;
+  for (scc_iterator<CallGraph *> I = scc_begin(&CG), E = scc_end(&CG); I != E;
+       ++I) {
+    std::vector<CallGraphNode *> &SCC = *I;
+    SCCNodes.clear();
+    SCCSummaries.clear();
+    for (unsigned i = 0, e = SCC.size(); i != e; ++i)
+      if (FunctionSummary *S = Summaries.lookup(SCC[i]->getFunction())) {
+        SCCNodes.insert(S->F);
+        SCCSummaries.push_back(S);
+      }
+
+    // The functions of an SCC may call each other, so they all get the
+    // largest effect of any of them.
+    MemoryEffect Effect = NoAccess;
+    for (unsigned i = 0, e = SCCSummaries.size(); i != e; ++i) {
+      FunctionSummary *S = SCCSummaries[i];
+      Effect = std::max(Effect, S->LocalEffect);
+      for (unsigned j = 0, je = S->Callees.size(); j != je; ++j)
+        if (!SCCNodes.count(S->Callees[j]))
+          Effect = std::max(Effect, Summaries[S->Callees[j]]->Effect);
+    }
+    for (unsigned i = 0, e = SCCSummaries.size(); i != e; ++i)
+      SCCSummaries[i]->Effect = Effect;
+  }
+}
+
+/// Mark every argument captured that is passed to a captured argument.
+/// Arguments that are only passed around a cycle stay uncaptured.
+void SummaryFunctionAttrs::propagateCaptures(
+    std::vector<FunctionSummary> &Summaries) {
+  DenseMap<Argument *, ArgumentSummary *> ArgSummaries;
+  for (unsigned i = 0, e = Summaries.size(); i != e; ++i)
+    for (unsigned j = 0, je = Summaries[i].Args.size(); j != je; ++j)
+      ArgSummaries[Summaries[i].Args[j].Arg] = &Summaries[i].Args[j];
+
+  // Reverse the flow edges, and treat flowing into an argument that is
+  // already nocapture or was never summarized as appropriate.
+  DenseMap<Argument *, SmallVector<ArgumentSummary *, 2> > PassedFrom;
+  SmallVector<ArgumentSummary *, 16> Worklist;
+  for (unsigned i = 0, e = Summaries.size(); i != e; ++i)
+    for (unsigned j = 0, je = Summaries[i].Args.size(); j != je; ++j) {
+      ArgumentSummary &AS = Summaries[i].Args[j];
+      for (unsigned k = 0, ke = AS.FlowsInto.size(); k != ke; ++k) {
+        Argument *To = AS.FlowsInto[k];
+        if (ArgSummaries.count(To))
+          PassedFrom[To].push_back(&AS);
+        else if (!To->hasNoCaptureAttr())
+          AS.Captured = true;
+      }
+      if (AS.Captured)
+        Worklist.push_back(&AS);
+    }
+
+  while (!Worklist.empty()) {
+    ArgumentSummary *AS = Worklist.pop_back_val();
+    SmallVectorImpl<ArgumentSummary *> &From = PassedFrom[AS->Arg];
+    for (unsigned i = 0, e = From.size(); i != e; ++i)
+      if (!From[i]->Captured) {
+        From[i]->Captured = true;
+        Worklist.push_back(From[i]);
+      }
+  }
+}
+
+/// Add readnone/readonly to the functions that do not write memory.
+bool
+SummaryFunctionAttrs::addReadAttrs(std::vector<FunctionSummary> &Summaries) {
+  bool MadeChange = false;
+  for (unsigned i = 0, e = Summaries.size(); i != e; ++i) {
+    Function *F = Summaries[i].F;
+    MemoryEffect Effect = Summaries[i].Effect;
+    if (Effect == MayWrite || F->doesNotAccessMemory() ||
+        (Effect == MayRead && F->onlyReadsMemory()))
+      continue;
+
+    AttrBuilder B;
+    B.addAttribute(Attribute::ReadOnly)
+      .addAttribute(Attribute::ReadNone);
+    F->removeAttributes(AttributeSet::FunctionIndex,
+                        AttributeSet::get(F->getContext(),
+                                          AttributeSet::FunctionIndex, B));
+    F->addAttribute(AttributeSet::FunctionIndex,
+                    Effect == MayRead ? Attribute::ReadOnly
+                                      : Attribute::ReadNone);
+    if (Effect == MayRead)
+      ++NumReadOnly;
+    else
+      ++NumReadNone;
+    MadeChange = true;
+  }
+  return MadeChange;
+}
+
+/// Add nocapture to the pointer arguments that are not captured.
+bool SummaryFunctionAttrs::addNoCaptureAttrs(
+    std::vector<FunctionSummary> &Summaries) {
+  bool MadeChange = false;
+  for (unsigned i = 0, e = Summaries.size(); i != e; ++i)
+    for (unsigned j = 0, je = Summaries[i].Args.size(); j != je; ++j) {
+      ArgumentSummary &AS = Summaries[i].Args[j];
+      if (AS.Captured)
+        continue;
+      AttrBuilder B;
+      B.addAttribute(Attribute::NoCapture);
+      AS.Arg->addAttr(AttributeSet::get(AS.Arg->getContext(),
+                                        AS.Arg->getArgNo() + 1, B));
+      ++NumNoCapture;
+      MadeChange = true;
+    }
+  return MadeChange;
+}
+
+bool SummaryFunctionAttrs::runOnModule(Module &M) {
+  // Definitions that may be replaced at link time are treated like
+  // declarations: their callers only go by their attributes.
+  std::vector<FunctionSummary> Summaries;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+    if (!F->isDeclaration() && !F->mayBeOverridden()) {
+      Summaries.push_back(FunctionSummary());
+      Summaries.back().F = F;
+    }
+  if (Summaries.empty())
+    return false;
+
+  SummaryMapTy SummaryMap;
+  for (unsigned i = 0, e = Summaries.size(); i != e; ++i)
+    SummaryMap[Summaries[i].F] = &Summaries[i];
+
+  parallel_for_each(Summaries.begin(), Summaries.end(),
+                    SummarizeFunction(SummaryMap));
+
+  propagateEffects(getAnalysis<CallGraph>(), SummaryMap);
+  propagateCaptures(Summaries);
+
+  bool Changed = addReadAttrs(Summaries);
+  Changed |= addNoCaptureAttrs(Summaries);
+  DEBUG(dbgs() << "Summarized " << Summaries.size() << " functions\n");
+  return Changed;
+}
@@ -0,0 +1,208 @@
+//===- WholeProgramDevirt.cpp - Devirtualize calls with a single target ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass turns virtual calls that can only reach one function into direct
+// calls, which the inliner can then inline.  It relies on metadata from the
+// frontend, and on seeing the whole program, so it is meant for LTO.
+//
+// The named metadata !llvm.vtables lists, for each class, every vtable that
+// an object of that class (or of a class derived from it) may point to, along
+// with the byte offset of the address point within the vtable:
+//
+//   !llvm.vtables = !{!0, !1, !2}
+//   !0 = metadata !{metadata !"_ZTS1A", [3 x i8*]* @_ZTV1A, i64 16}
+//   !1 = metadata !{metadata !"_ZTS1A", [3 x i8*]* @_ZTV1B, i64 16}
+//   !2 = metadata !{metadata !"_ZTS1B", [3 x i8*]* @_ZTV1B, i64 16}
+//
+// A virtual call names the static class of the object with !vcall:
+//
+//   %vtable = load void (%struct.A*)*** %0
+//   %vfn = getelementptr inbounds void (%struct.A*)** %vtable, i64 1
+//   %fp = load void (%struct.A*)** %vfn
+//   call void %fp(%struct.A* %a), !vcall !3
+//   !3 = metadata !{metadata !"_ZTS1A"}
+//
+// If the slot at the call's offset from the address point holds the same
+// function in every vtable of the class, the call becomes a direct call to
+// that function.  Slots holding __cxa_pure_virtual are ignored, since an
+// object of an abstract class is never called through.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "wholeprogramdevirt"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/Debug.h"
+using namespace llvm;
+
+STATISTIC(NumDevirtualized, "Number of virtual calls made direct");
+
+namespace {
+  /// A vtable that objects of some class may point to.
+  struct VTableInfo {
+    GlobalVariable *VTable;
+    uint64_t AddressPoint;
+  };
+
+  struct WholeProgramDevirt : public ModulePass {
+    static char ID; // Pass identification, replacement for typeid
+    WholeProgramDevirt() : ModulePass(ID), TD(0) {
+      initializeWholeProgramDevirtPass(*PassRegistry::getPassRegistry());
+    }
+
+    virtual bool runOnModule(Module &M);
+
+  private:
+    Function *getSingleTarget(const SmallVectorImpl<VTableInfo> &VTables,
+                              uint64_t SlotOffset);
+
+    DataLayout *TD;
+  };
+}
+
+char WholeProgramDevirt::ID = 0;
+INITIALIZE_PASS(WholeProgramDevirt, "wholeprogramdevirt",
+                "Whole program devirtualization", false, false)
+
+ModulePass *llvm::createWholeProgramDevirtPass() {
+  return new WholeProgramDevirt();
+}
+
+/// Return the function whose address is stored at byte Offset of the constant
+/// C, or null if there is none.
+static Function *getFunctionAtOffset(Constant *C, uint64_t Offset,
+                                     const DataLayout &TD) {
+  if (Offset == 0)
+    if (Function *F = dyn_cast<Function>(C->stripPointerCasts()))
+      return F;
+
+  Type *Ty = C->getType();
+  if (StructType *STy = dyn_cast<StructType>(Ty)) {
+    const StructLayout *SL = TD.getStructLayout(STy);
+    if (Offset >= SL->getSizeInBytes())
+      return 0;
+    unsigned Elt = SL->getElementContainingOffset(Offset);
+    Constant *Op = C->getAggregateElement(Elt);
+    if (!Op)
+      return 0;
+    return getFunctionAtOffset(Op, Offset - SL->getElementOffset(Elt), TD);
+  }
+  if (ArrayType *ATy = dyn_cast<ArrayType>(Ty)) {
+    uint64_t EltSize = TD.getTypeAllocSize(ATy->getElementType());
+    if (EltSize == 0 || Offset / EltSize >= ATy->getNumElements())
+      return 0;
+    Constant *Op = C->getAggregateElement(Offset / EltSize);
+    if (!Op)
+      return 0;
+    return getFunctionAtOffset(Op, Offset % EltSize, TD);
+  }
+  return 0;
+}
+
+/// Return the function that every vtable of VTables holds at SlotOffset from
+/// its address point, or null if they do not agree or a vtable is not known.
+Function *
+WholeProgramDevirt::getSingleTarget(const SmallVectorImpl<VTableInfo> &VTables,
+                                    uint64_t SlotOffset) {
+  Function *Target = 0;
+  for (unsigned i = 0, e = VTables.size(); i != e; ++i) {
+    GlobalVariable *GV = VTables[i].VTable;
+    if (!GV->isConstant() || !GV->hasDefinitiveInitializer())
+      return 0;
+    Function *F = getFunctionAtOffset(GV->getInitializer(),
+                                      VTables[i].AddressPoint + SlotOffset,
+                                      *TD);
+    if (!F)
+      return 0;
+    if (F->getName() == "__cxa_pure_virtual")
+      continue;
+    if (Target && Target != F)
+      return 0;
+    Target = F;
+  }
+  return Target;
+}
+
+bool WholeProgramDevirt::runOnModule(Module &M) {
+  NamedMDNode *VTablesMD = M.getNamedMetadata("llvm.vtables");
+  if (!VTablesMD)
+    return false;
+  TD = getAnalysisIfAvailable<DataLayout>();
+  if (!TD)
+    return false;
+
+  // Collect the vtables of each class.
+  DenseMap<MDString *, SmallVector<VTableInfo, 4> > ClassVTables;
+  for (unsigned i = 0, e = VTablesMD->getNumOperands(); i != e; ++i) {
+    MDNode *Entry = VTablesMD->getOperand(i);
+    if (Entry->getNumOperands() != 3)
+      continue;
+    MDString *Class = dyn_cast_or_null<MDString>(Entry->getOperand(0));
+    GlobalVariable *GV = dyn_cast_or_null<GlobalVariable>(
+        Entry->getOperand(1) ? Entry->getOperand(1)->stripPointerCasts() : 0);
+    ConstantInt *AddressPoint =
+        dyn_cast_or_null<ConstantInt>(Entry->getOperand(2));
+    if (!Class || !GV || !AddressPoint)
+      continue;
+    VTableInfo Info;
+    Info.VTable = GV;
+    Info.AddressPoint = AddressPoint->getZExtValue();
+    ClassVTables[Class].push_back(Info);
+  }
+
+  unsigned VCallKind = M.getContext().getMDKindID("vcall");
+  bool Changed = false;
+  for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F)
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE;
+           ++I) {
+        CallSite CS(I);
+        if (!CS || CS.getCalledFunction())
+          continue;
+        MDNode *VCall = I->getMetadata(VCallKind);
+        if (!VCall || VCall->getNumOperands() != 1)
+          continue;
+        MDString *Class = dyn_cast_or_null<MDString>(VCall->getOperand(0));
+        if (!Class || !ClassVTables.count(Class))
+          continue;
+
+        // The callee is loaded from a constant offset into the vtable.
+        Value *Callee = CS.getCalledValue();
+        LoadInst *FnLoad = dyn_cast<LoadInst>(Callee->stripPointerCasts());
+        if (!FnLoad)
+          continue;
+        int64_t SlotOffset = 0;
+        Value *VTablePtr = GetPointerBaseWithConstantOffset(
+            FnLoad->getPointerOperand(), SlotOffset, TD);
+        if (!isa<LoadInst>(VTablePtr) || SlotOffset < 0)
+          continue;
+
+        Function *Target = getSingleTarget(ClassVTables[Class], SlotOffset);
+        if (!Target)
+          continue;
+        DEBUG(dbgs() << "Devirtualized call in " << F->getName() << " to "
+                     << Target->getName() << "\n");
+        CS.setCalledFunction(
+            ConstantExpr::getBitCast(Target, Callee->getType()));
+        ++NumDevirtualized;
+        Changed = true;
+      }
+  return Changed;
+}
@@ -89,6 +89,13 @@ public:
       Add(cast<Instruction>(*UI));
   }
 
+  /// AddOperandsToWorkList - When an instruction is changed, add its operands
+  /// to the worklist, since they may have lost a use or be sinkable now.
+  void AddOperandsToWorkList(Instruction &I) {
+    for (User::op_iterator OI = I.op_begin(), OE = I.op_end(); OI != OE; ++OI)
+      AddValue(*OI);
+  }
+
 
   /// Zap - check that the worklist is empty and nuke the backing store for
   /// the map if it is large.
@@ -65,12 +65,20 @@ STATISTIC(NumSunkInst , "Number of instructions sunk");
 STATISTIC(NumExpand,    "Number of expansions");
 STATISTIC(NumFactor   , "Number of factorizations");
 STATISTIC(NumReassoc  , "Number of reassociations");
+STATISTIC(NumSeeded   , "Number of insts added to the initial worklist");
+STATISTIC(NumVisited  , "Number of insts visited");
+STATISTIC(NumIterations, "Number of iterations over a function");
 
 static cl::opt<bool> UnsafeFPShrink("enable-double-float-shrink", cl::Hidden,
                                    cl::init(false),
                                    cl::desc("Enable unsafe double to float "
                                             "shrinking for math lib calls"));
 
+static cl::opt<bool>
+SingleIteration("instcombine-single-iteration", cl::Hidden, cl::init(false),
+                cl::desc("Make one pass over each function, requeuing the "
+                         "operands as well as the users of changed insts"));
+
 // Initialization Routines
 void llvm::initializeInstCombine(PassRegistry &Registry) {
   initializeInstCombinerPass(Registry);
@@ -2309,12 +2317,14 @@ static bool AddReachableCodeToWorklist(BasicBlock *BB,
   // some N^2 behavior in pathological cases.
   IC.Worklist.AddInitialGroup(&InstrsForInstCombineWorklist[0],
                               InstrsForInstCombineWorklist.size());
+  NumSeeded += InstrsForInstCombineWorklist.size();
 
   return MadeIRChange;
 }
 
 bool InstCombiner::DoOneIteration(Function &F, unsigned Iteration) {
   MadeIRChange = false;
+  ++NumIterations;
 
   DEBUG(dbgs() << "\n\nINSTCOMBINE ITERATION #" << Iteration << " on "
                << F.getName() << "\n");
@@ -2358,6 +2368,7 @@ bool InstCombiner::DoOneIteration(Function &F, unsigned Iteration) {
   while (!Worklist.isEmpty()) {
     Instruction *I = Worklist.RemoveOne();
     if (I == 0) continue;  // skip null values.
+    ++NumVisited;
 
     // Check to see if we can DCE the instruction.
     if (isInstructionTriviallyDead(I, TLI)) {
@@ -2405,9 +2416,15 @@ bool InstCombiner::DoOneIteration(Function &F, unsigned Iteration) {
         // If the user is one of our immediate successors, and if that successor
         // only has us as a predecessors (we'd have to split the critical edge
         // otherwise), we can keep going.
-        if (UserIsSuccessor && UserParent->getSinglePredecessor())
+        if (UserIsSuccessor && UserParent->getSinglePredecessor()) {
           // Okay, the CFG is simple enough, try to sink this instruction.
-          MadeIRChange |= TryToSinkInstruction(I, UserParent);
+          if (TryToSinkInstruction(I, UserParent)) {
+            MadeIRChange = true;
+            // Its operands may now be sinkable after it.
+            if (SingleIteration)
+              Worklist.AddOperandsToWorkList(*I);
+          }
+        }
       }
     }
 
@@ -2465,6 +2482,8 @@ bool InstCombiner::DoOneIteration(Function &F, unsigned Iteration) {
         } else {
           Worklist.Add(I);
           Worklist.AddUsersToWorkList(*I);
+          if (SingleIteration)
+            Worklist.AddOperandsToWorkList(*I);
         }
       }
       MadeIRChange = true;
@@ -2517,10 +2536,14 @@ bool InstCombiner::runOnFunction(Function &F) {
   // by instcombiner.
   EverMadeChange = LowerDbgDeclare(F);
 
-  // Iterate while there is work to do.
+  // Iterate while there is work to do.  In single iteration mode, rely on
+  // the worklist to revisit everything a change may affect instead.
   unsigned Iteration = 0;
-  while (DoOneIteration(F, Iteration++))
+  while (DoOneIteration(F, Iteration++)) {
     EverMadeChange = true;
+    if (SingleIteration)
+      break;
+  }
 
   Builder = 0;
   return EverMadeChange;
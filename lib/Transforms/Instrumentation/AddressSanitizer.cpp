@@ -26,6 +26,11 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "llvm/DIBuilder.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
@@ -180,6 +185,13 @@ static cl::opt<bool> ClOptSameTemp("asan-opt-same-temp",
        cl::init(true));
 static cl::opt<bool> ClOptGlobals("asan-opt-globals",
        cl::desc("Don't instrument scalar globals"), cl::Hidden, cl::init(true));
+static cl::opt<bool> ClOptDominating("asan-opt-dominating",
+       cl::desc("Don't instrument accesses covered by a dominating check"),
+       cl::Hidden, cl::init(true));
+static cl::opt<bool> ClOptLoopRanges("asan-opt-loop-ranges",
+       cl::desc("Check the first and the last access of a simple loop in "
+                "its preheader instead of checking every iteration"),
+       cl::Hidden, cl::init(false));
 
 static cl::opt<bool> ClCheckLifetime("asan-check-lifetime",
        cl::desc("Use llvm.lifetime intrinsics to insert extra checks"),
@@ -203,6 +215,10 @@ STATISTIC(NumOptimizedAccessesToGlobalArray,
           "Number of optimized accesses to global arrays");
 STATISTIC(NumOptimizedAccessesToGlobalVar,
           "Number of optimized accesses to global vars");
+STATISTIC(NumOptimizedDominatedAccesses,
+          "Number of optimized accesses covered by a dominating check");
+STATISTIC(NumHoistedLoopAccesses,
+          "Number of loop accesses checked in the loop preheader");
 
 namespace {
 /// A set of dynamically initialized globals extracted from metadata.
@@ -283,6 +299,20 @@ static size_t RedzoneSizeForScale(int MappingScale) {
   return std::max(32U, 1U << MappingScale);
 }
 
+/// A memory access in a simple loop which is checked once in the loop
+/// preheader, at the addresses it accesses in the first and the last
+/// iteration, instead of on every iteration.
+struct HoistedLoopCheck {
+  Instruction *I;
+  Instruction *InsertBefore;
+  const SCEV *First;
+  const SCEV *Last;
+  Value *FirstAddr;
+  Value *LastAddr;
+  uint32_t TypeSize;
+  bool IsWrite;
+};
+
 /// AddressSanitizer: instrument the code in module to find memory bugs.
 struct AddressSanitizer : public FunctionPass {
   AddressSanitizer(bool CheckInitOrder = true,
@@ -318,11 +348,20 @@ struct AddressSanitizer : public FunctionPass {
   bool maybeInsertAsanInitAtFunctionEntry(Function &F);
   void emitShadowMapping(Module &M, IRBuilder<> &IRB) const;
   virtual bool doInitialization(Module &M);
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<DominatorTree>();
+    AU.addRequired<LoopInfo>();
+    AU.addRequired<ScalarEvolution>();
+  }
   static char ID;  // Pass identification, replacement for typeid
 
  private:
   void initializeCallbacks(Module &M);
 
+  uint32_t getAccessSizeInBits(Value *Addr) const;
+  bool loopMayFreeMemory(Loop *L);
+  bool getLoopAccessRange(Instruction *I, Value *Addr, HoistedLoopCheck &LC);
+
   bool ShouldInstrumentGlobal(GlobalVariable *G);
   bool LooksLikeCodeInBug11395(Instruction *I);
   void FindDynamicInitializers(Module &M);
@@ -337,6 +376,11 @@ struct AddressSanitizer : public FunctionPass {
 
   LLVMContext *C;
   DataLayout *TD;
+  DominatorTree *DT;
+  LoopInfo *LI;
+  ScalarEvolution *SE;
+  // Whether a loop contains calls, cached for the current function.
+  DenseMap<Loop*, bool> LoopCallsCache;
   int LongSize;
   Type *IntptrTy;
   ShadowMapping Mapping;
@@ -549,7 +593,13 @@ struct FunctionStackPoisoner : public InstVisitor<FunctionStackPoisoner> {
 }  // namespace
 
 char AddressSanitizer::ID = 0;
-INITIALIZE_PASS(AddressSanitizer, "asan",
+INITIALIZE_PASS_BEGIN(AddressSanitizer, "asan",
+    "AddressSanitizer: detects use-after-free and out-of-bounds bugs.",
+    false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTree)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_END(AddressSanitizer, "asan",
     "AddressSanitizer: detects use-after-free and out-of-bounds bugs.",
     false, false)
 FunctionPass *llvm::createAddressSanitizerFunctionPass(
@@ -677,6 +727,13 @@ bool AddressSanitizer::GlobalIsLinkerInitialized(GlobalVariable *G) {
   return G->hasInitializer() && !DynamicallyInitializedGlobals.Contains(G);
 }
 
+// Returns true if an access of TypeSize bits is instrumented with a single
+// check of the shadow of its first byte.
+static bool isSingleCheckAccessSize(uint64_t TypeSize) {
+  return TypeSize == 8  || TypeSize == 16 ||
+         TypeSize == 32 || TypeSize == 64 || TypeSize == 128;
+}
+
 void AddressSanitizer::instrumentMop(Instruction *I) {
   bool IsWrite = false;
   Value *Addr = isInterestingMemoryAccess(I, &IsWrite);
@@ -715,8 +772,7 @@ void AddressSanitizer::instrumentMop(Instruction *I) {
     NumInstrumentedReads++;
 
   // Instrument a 1-, 2-, 4-, 8-, or 16- byte access with one check.
-  if (TypeSize == 8  || TypeSize == 16 ||
-      TypeSize == 32 || TypeSize == 64 || TypeSize == 128)
+  if (isSingleCheckAccessSize(TypeSize))
     return instrumentAddress(I, I, Addr, TypeSize, IsWrite, 0);
   // Instrument unusual size (but still multiple of 8).
   // We can not do it with a single check, so we do 1-byte check for the first
@@ -732,6 +788,69 @@ void AddressSanitizer::instrumentMop(Instruction *I) {
   instrumentAddress(I, I, LastByte, 8, IsWrite, Size);
 }
 
+uint32_t AddressSanitizer::getAccessSizeInBits(Value *Addr) const {
+  Type *OrigTy = cast<PointerType>(Addr->getType())->getElementType();
+  return TD->getTypeStoreSizeInBits(OrigTy);
+}
+
+// Returns true if L contains a call, which may free or poison memory
+// checked earlier in the loop.
+bool AddressSanitizer::loopMayFreeMemory(Loop *L) {
+  DenseMap<Loop*, bool>::iterator It = LoopCallsCache.find(L);
+  if (It != LoopCallsCache.end())
+    return It->second;
+  bool HasCalls = false;
+  for (Loop::block_iterator BI = L->block_begin(), BE = L->block_end();
+       BI != BE && !HasCalls; ++BI) {
+    for (BasicBlock::iterator I = (*BI)->begin(), E = (*BI)->end();
+         I != E; ++I) {
+      if (CallSite(I) && !isa<DbgInfoIntrinsic>(I)) {
+        HasCalls = true;
+        break;
+      }
+    }
+  }
+  LoopCallsCache[L] = HasCalls;
+  return HasCalls;
+}
+
+// Checks whether the access I to Addr can be checked once in the preheader of
+// its loop.  This is the case if the loop has a single exit at its latch, I
+// is executed on every iteration, there are no calls in the loop and the
+// address is an affine recurrence with a computable trip count.  Only the
+// first and the last accessed addresses are checked, so an overflow from one
+// object into another that skips the redzone between them goes unnoticed.
+bool AddressSanitizer::getLoopAccessRange(Instruction *I, Value *Addr,
+                                          HoistedLoopCheck &LC) {
+  Loop *L = LI->getLoopFor(I->getParent());
+  if (!L)
+    return false;
+  BasicBlock *Preheader = L->getLoopPreheader();
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Preheader || !Latch || L->getExitingBlock() != Latch)
+    return false;
+  if (!DT->dominates(I->getParent(), Latch) || loopMayFreeMemory(L))
+    return false;
+
+  const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Addr));
+  if (!AR || AR->getLoop() != L || !AR->isAffine())
+    return false;
+  const SCEV *BackedgeTakenCount = SE->getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BackedgeTakenCount))
+    return false;
+  const SCEV *First = AR->getStart();
+  const SCEV *Last = AR->evaluateAtIteration(BackedgeTakenCount, *SE);
+  if (!isSafeToExpand(First, *SE) || !isSafeToExpand(Last, *SE))
+    return false;
+
+  LC.I = I;
+  LC.InsertBefore = Preheader->getTerminator();
+  LC.First = First;
+  LC.Last = Last;
+  LC.FirstAddr = LC.LastAddr = 0;
+  return true;
+}
+
 // Validate the result of Module::getOrInsertFunction called for an interface
 // function of AddressSanitizer. If the instrumented module defines a function
 // with the same name, their prototypes must match, otherwise
@@ -1221,9 +1340,23 @@ bool AddressSanitizer::runOnFunction(Function &F) {
   if (!ClDebugFunc.empty() && ClDebugFunc != F.getName())
     return false;
 
+  DT = &getAnalysis<DominatorTree>();
+  LI = &getAnalysis<LoopInfo>();
+  SE = &getAnalysis<ScalarEvolution>();
+  LoopCallsCache.clear();
+
   // We want to instrument every address only once per basic block (unless there
   // are calls between uses).
   SmallSet<Value*, 16> TempsToInstrument;
+  // The widest single-check access done so far at each address, keyed by the
+  // SCEV of the address.  A block with a single predecessor is dominated by it
+  // and inherits the checks done at its end, so this extends the per-block
+  // dedup above to extended basic blocks.  Calls clear it as they may free
+  // memory.
+  typedef DenseMap<const SCEV*, uint32_t> CheckedAddrMap;
+  DenseMap<BasicBlock*, CheckedAddrMap> CheckedAtEnd;
+  CheckedAddrMap Checked;
+  SmallVector<HoistedLoopCheck, 8> LoopChecks;
   SmallVector<Instruction*, 16> ToInstrument;
   SmallVector<Instruction*, 8> NoReturnCalls;
   int NumAllocas = 0;
@@ -1233,6 +1366,15 @@ bool AddressSanitizer::runOnFunction(Function &F) {
   for (Function::iterator FI = F.begin(), FE = F.end();
        FI != FE; ++FI) {
     TempsToInstrument.clear();
+    Checked.clear();
+    if (ClOpt && ClOptDominating) {
+      if (BasicBlock *Pred = FI->getSinglePredecessor()) {
+        DenseMap<BasicBlock*, CheckedAddrMap>::iterator It =
+            CheckedAtEnd.find(Pred);
+        if (It != CheckedAtEnd.end())
+          Checked = It->second;
+      }
+    }
     int NumInsnsPerBB = 0;
     for (BasicBlock::iterator BI = FI->begin(), BE = FI->end();
          BI != BE; ++BI) {
@@ -1242,6 +1384,30 @@ bool AddressSanitizer::runOnFunction(Function &F) {
           if (!TempsToInstrument.insert(Addr))
             continue;  // We've seen this temp in the current BB.
         }
+        uint32_t TypeSize = getAccessSizeInBits(Addr);
+        bool SingleCheck = isSingleCheckAccessSize(TypeSize);
+        const SCEV *AddrSCEV = 0;
+        if (ClOpt && ClOptDominating && SingleCheck) {
+          // A check of the same address with the same or a wider size
+          // covers this one: both look at the same shadow.
+          AddrSCEV = SE->getSCEV(Addr);
+          CheckedAddrMap::iterator It = Checked.find(AddrSCEV);
+          if (It != Checked.end() && It->second >= TypeSize) {
+            NumOptimizedDominatedAccesses++;
+            continue;
+          }
+        }
+        if (ClOpt && ClOptLoopRanges && SingleCheck) {
+          HoistedLoopCheck LC;
+          if (getLoopAccessRange(BI, Addr, LC)) {
+            LC.TypeSize = TypeSize;
+            LC.IsWrite = IsWrite;
+            LoopChecks.push_back(LC);
+            continue;
+          }
+        }
+        if (AddrSCEV)
+          Checked[AddrSCEV] = TypeSize;
       } else if (isa<MemIntrinsic>(BI) && ClMemIntrin) {
         // ok, take it.
       } else {
@@ -1251,6 +1417,7 @@ bool AddressSanitizer::runOnFunction(Function &F) {
         if (CS) {
           // A call inside BB.
           TempsToInstrument.clear();
+          Checked.clear();
           if (CS.doesNotReturn())
             NoReturnCalls.push_back(CS.getInstruction());
         }
@@ -1258,14 +1425,20 @@ bool AddressSanitizer::runOnFunction(Function &F) {
       }
       ToInstrument.push_back(BI);
       NumInsnsPerBB++;
-      if (NumInsnsPerBB >= ClMaxInsnsToInstrumentPerBB)
+      if (NumInsnsPerBB >= ClMaxInsnsToInstrumentPerBB) {
+        // The rest of the block is not looked at.
+        Checked.clear();
         break;
+      }
     }
+    if (!Checked.empty())
+      CheckedAtEnd[FI] = Checked;
   }
 
   Function *UninstrumentedDuplicate = 0;
   bool LikelyToInstrument =
-      !NoReturnCalls.empty() || !ToInstrument.empty() || (NumAllocas > 0);
+      !NoReturnCalls.empty() || !ToInstrument.empty() || !LoopChecks.empty() ||
+      (NumAllocas > 0);
   if (ClKeepUninstrumented && LikelyToInstrument) {
     ValueToValueMapTy VMap;
     UninstrumentedDuplicate = CloneFunction(&F, VMap, false);
@@ -1274,6 +1447,18 @@ bool AddressSanitizer::runOnFunction(Function &F) {
     F.getParent()->getFunctionList().push_back(UninstrumentedDuplicate);
   }
 
+  // Expand the addresses of the checks hoisted into loop preheaders while
+  // ScalarEvolution still describes the CFG, i.e. before instrumenting.
+  if (!LoopChecks.empty()) {
+    SCEVExpander Expander(*SE, "asan");
+    for (size_t i = 0, n = LoopChecks.size(); i != n; i++) {
+      HoistedLoopCheck &LC = LoopChecks[i];
+      Type *AddrTy = isInterestingMemoryAccess(LC.I, &IsWrite)->getType();
+      LC.FirstAddr = Expander.expandCodeFor(LC.First, AddrTy, LC.InsertBefore);
+      LC.LastAddr = Expander.expandCodeFor(LC.Last, AddrTy, LC.InsertBefore);
+    }
+  }
+
   // Instrument.
   int NumInstrumented = 0;
   for (size_t i = 0, n = ToInstrument.size(); i != n; i++) {
@@ -1287,6 +1472,14 @@ bool AddressSanitizer::runOnFunction(Function &F) {
     }
     NumInstrumented++;
   }
+  for (size_t i = 0, n = LoopChecks.size(); i != n; i++) {
+    HoistedLoopCheck &LC = LoopChecks[i];
+    instrumentAddress(LC.I, LC.InsertBefore, LC.FirstAddr, LC.TypeSize,
+                      LC.IsWrite, 0);
+    instrumentAddress(LC.I, LC.InsertBefore, LC.LastAddr, LC.TypeSize,
+                      LC.IsWrite, 0);
+    NumHoistedLoopAccesses++;
+  }
 
   FunctionStackPoisoner FSP(F, *this);
   bool ChangedStack = FSP.runOnFunction();
@@ -1299,7 +1492,8 @@ bool AddressSanitizer::runOnFunction(Function &F) {
     IRB.CreateCall(AsanHandleNoReturnFunc);
   }
 
-  bool res = NumInstrumented > 0 || ChangedStack || !NoReturnCalls.empty();
+  bool res = NumInstrumented > 0 || !LoopChecks.empty() || ChangedStack ||
+             !NoReturnCalls.empty();
 
   if (InjectCoverage(F))
     res = true;
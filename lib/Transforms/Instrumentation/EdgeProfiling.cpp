@@ -0,0 +1,1073 @@
+//===- EdgeProfiling.cpp - Edge profiles for any front end ----------------===//
+//
+//                      The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements edge profiling at the IR level, so that it works the
+// same for every front end, without a runtime library.
+//
+// -insert-edge-profiling counts the CFG edges of each function that are not in
+// a maximum spanning tree of its CFG, weighted by the static estimates of
+// BlockFrequencyInfo, so that the hottest edges are the ones left uncounted.
+// The instrumented program appends its counters to a file when it exits, with
+// nothing but the C library.
+//
+// It also records the most frequent targets of each indirect call.  Every
+// instrumented module registers the names of the functions whose address it
+// takes, so that the targets are written by name whichever module defines
+// them; calls to functions that no instrumented module knows are only counted.
+//
+// -edge-profile-loader reads the file back while compiling the same,
+// uninstrumented IR, derives the counts of the spanning tree edges from flow
+// conservation, and records the counts of each conditional branch and switch
+// as branch weight metadata, and the number of times each function was entered
+// as its entry count.  The targets of the indirect calls are recorded as
+// indirect call target metadata, for indirect call promotion.
+//
+// The file is text, with one record per instrumented function per run:
+//
+//   function name
+//   CFG checksum
+//   number of counters N
+//   counter 1
+//   ...
+//   counter N
+//   number of indirect call sites M
+//   call count 1 [target count, target name]...
+//   ...
+//   call count M [target count, target name]...
+//
+// The loader sums the records of each function, and ignores functions whose
+// checksum shows that their CFG is not the one that was instrumented.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "edge-profiling"
+
+#include "llvm/Transforms/Instrumentation.h"
+#include "MaximumSpanningTree.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/system_error.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <set>
+using namespace llvm;
+
+STATISTIC(NumInstrumented, "Number of functions instrumented");
+STATISTIC(NumCounters, "Number of edge counters inserted");
+STATISTIC(NumUnprofilable, "Number of functions whose edges cannot be "
+                           "profiled");
+STATISTIC(NumMismatched, "Number of functions whose CFG does not match "
+                         "their profile");
+STATISTIC(NumAnnotated, "Number of branches given profiled weights");
+STATISTIC(NumCallSites, "Number of indirect calls profiled");
+STATISTIC(NumCallsAnnotated, "Number of indirect calls given profiled "
+                             "targets");
+
+static cl::opt<std::string>
+EdgeProfileFilename("edge-profile-file", cl::init("llvmprof.edges"),
+                    cl::value_desc("filename"),
+                    cl::desc("Edge profile written by -insert-edge-profiling "
+                             "and read by -edge-profile-loader"));
+
+static cl::opt<bool>
+ProfileIndirectCalls("edge-profile-indirect-calls", cl::init(true),
+                     cl::desc("Record the targets of indirect calls in edge "
+                              "profiles"));
+
+/// The number of distinct targets recorded for each indirect call; calls to
+/// any others are only counted.
+static const unsigned NumTargetSlots = 3;
+
+/// The number of counters of an indirect call: the number of calls, then the
+/// address of each target and the number of calls to it.
+static const unsigned SiteSize = 1 + 2 * NumTargetSlots;
+
+namespace {
+/// ProfiledEdges - The edges of a function's CFG that a profile is in terms
+/// of.  A null block stands for the callers of the function, so there is an
+/// edge from it to the entry block and one to it from each block without
+/// successors.  All edges between the same two blocks count as one.
+struct ProfiledEdges {
+  typedef MaximumSpanningTree<BasicBlock>::Edge Edge;
+
+  /// The edges, in an order that only depends on the CFG.
+  std::vector<Edge> Edges;
+  /// The numbers of the nodes at the ends of each edge.  The callers are
+  /// node 0 and the blocks are numbered from 1 in layout order.
+  std::vector<std::pair<unsigned, unsigned> > EdgeNodes;
+  unsigned NumNodes;
+  /// The indices in Edges of the edges that get counters, in counter order.
+  std::vector<unsigned> Counted;
+  /// A hash of the CFG.
+  unsigned Checksum;
+
+  /// compute - Find the edges of F and which of them to count.  Return false
+  /// if F cannot be profiled.
+  bool compute(Function &F, Pass &P);
+
+  /// solve - Set Counts to the count of every edge, given the counters.
+  void solve(ArrayRef<uint64_t> Counters, std::vector<uint64_t> &Counts) const;
+};
+}
+
+bool ProfiledEdges::compute(Function &F, Pass &P) {
+  // The edges out of an indirectbr cannot be split to count them.
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    if (isa<IndirectBrInst>(BB->getTerminator()))
+      return false;
+
+  BranchProbabilityInfo &BPI = P.getAnalysis<BranchProbabilityInfo>(F);
+  BlockFrequencyInfo &BFI = P.getAnalysis<BlockFrequencyInfo>(F);
+
+  DenseMap<const BasicBlock *, unsigned> Number;
+  NumNodes = 1;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Number[BB] = NumNodes++;
+
+  MaximumSpanningTree<BasicBlock>::EdgeWeights Weights;
+  BasicBlock *Entry = &F.getEntryBlock();
+  Edges.push_back(Edge(0, Entry));
+  Weights.push_back(std::make_pair(
+      Edges.back(), double(BFI.getBlockFreq(Entry).getFrequency())));
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    double Freq = BFI.getBlockFreq(BB).getFrequency();
+    TerminatorInst *TI = BB->getTerminator();
+    if (TI->getNumSuccessors() == 0) {
+      Edges.push_back(Edge(BB, 0));
+      Weights.push_back(std::make_pair(Edges.back(), Freq));
+      continue;
+    }
+
+    SmallPtrSet<const BasicBlock *, 8> Seen;
+    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i) {
+      BasicBlock *Succ = TI->getSuccessor(i);
+      if (!Seen.insert(Succ))
+        continue;
+      Edges.push_back(Edge(BB, Succ));
+      // Critical edges into landing pads cannot be split, so keep unwind
+      // edges in the tree.
+      double Weight = std::numeric_limits<double>::max();
+      if (!Succ->isLandingPad()) {
+        BranchProbability Prob = BPI.getEdgeProbability(BB, Succ);
+        Weight = Freq * Prob.getNumerator() / Prob.getDenominator();
+      }
+      Weights.push_back(std::make_pair(Edges.back(), Weight));
+    }
+  }
+
+  Checksum = 0;
+  for (unsigned i = 0, e = Edges.size(); i != e; ++i) {
+    unsigned From = Edges[i].first ? Number[Edges[i].first] : 0;
+    unsigned To = Edges[i].second ? Number[Edges[i].second] : 0;
+    EdgeNodes.push_back(std::make_pair(From, To));
+    Checksum = (Checksum * 31 + From) * 31 + To;
+  }
+
+  MaximumSpanningTree<BasicBlock> MST(Weights);
+  std::set<Edge> Tree(MST.begin(), MST.end());
+  for (unsigned i = 0, e = Edges.size(); i != e; ++i) {
+    if (Tree.count(Edges[i]))
+      continue;
+    const BasicBlock *To = Edges[i].second;
+    if (To && To->isLandingPad() && !To->getUniquePredecessor())
+      return false;
+    Counted.push_back(i);
+  }
+  return true;
+}
+
+/// getIndirectCalls - Return the indirect calls of F that are profiled, in an
+/// order that only depends on F.
+static void getIndirectCalls(Function &F, SmallVectorImpl<CallSite> &Calls) {
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+      CallSite CS(I);
+      if (CS && !CS.getCalledFunction() &&
+          !isa<InlineAsm>(CS.getCalledValue()))
+        Calls.push_back(CS);
+    }
+}
+
+void ProfiledEdges::solve(ArrayRef<uint64_t> Counters,
+                          std::vector<uint64_t> &Counts) const {
+  Counts.assign(Edges.size(), 0);
+  std::vector<bool> Known(Edges.size(), false);
+  for (unsigned i = 0, e = Counted.size(); i != e; ++i) {
+    Counts[Counted[i]] = Counters[i];
+    Known[Counted[i]] = true;
+  }
+
+  std::vector<SmallVector<unsigned, 4> > Incident(NumNodes);
+  for (unsigned i = 0, e = EdgeNodes.size(); i != e; ++i) {
+    Incident[EdgeNodes[i].first].push_back(i);
+    if (EdgeNodes[i].second != EdgeNodes[i].first)
+      Incident[EdgeNodes[i].second].push_back(i);
+  }
+
+  // What flows into a node flows out of it, so once all but one of the edges
+  // of a node are known, so is the last one.  Peeling the leaves off the
+  // spanning tree this way eventually solves all of its edges.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (unsigned N = 0; N != NumNodes; ++N) {
+      unsigned NumUnknown = 0, Unknown = 0;
+      int64_t Balance = 0;
+      for (unsigned i = 0, e = Incident[N].size(); i != e; ++i) {
+        unsigned Idx = Incident[N][i];
+        if (!Known[Idx]) {
+          ++NumUnknown;
+          Unknown = Idx;
+          continue;
+        }
+        if (EdgeNodes[Idx].second == N)
+          Balance += Counts[Idx];
+        if (EdgeNodes[Idx].first == N)
+          Balance -= Counts[Idx];
+      }
+      if (NumUnknown != 1)
+        continue;
+
+      // A program that leaves a function by exiting or unwinding past it
+      // breaks conservation; clamp what it would make negative.
+      int64_t Count = EdgeNodes[Unknown].second == N ? -Balance : Balance;
+      Counts[Unknown] = std::max<int64_t>(Count, 0);
+      Known[Unknown] = true;
+      Changed = true;
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Instrumentation
+//===----------------------------------------------------------------------===//
+
+namespace {
+class EdgeProfiler : public ModulePass {
+public:
+  static char ID;
+  explicit EdgeProfiler(StringRef Filename = StringRef())
+    : ModulePass(ID), Filename(Filename) {
+    initializeEdgeProfilerPass(*PassRegistry::getPassRegistry());
+  }
+
+  virtual const char *getPassName() const { return "Edge Profiler"; }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<BlockFrequencyInfo>();
+    AU.addRequired<BranchProbabilityInfo>();
+  }
+
+  virtual bool runOnModule(Module &M);
+
+private:
+  /// InstrumentedFunction - What the dump function writes for a function.
+  struct InstrumentedFunction {
+    std::string Name;
+    unsigned Checksum;
+    GlobalVariable *Counters;
+    unsigned NumCounters;
+    /// The counters of the indirect calls, SiteSize per call.
+    GlobalVariable *Sites;
+    unsigned NumSites;
+  };
+
+  void insertCounters(const ProfiledEdges &PE, GlobalVariable *Counters);
+  GlobalVariable *insertCallSiteCounters(Function &F, unsigned &NumSites);
+  void defineRecordTarget(Module &M);
+  Function *insertSymbolTable(Module &M);
+  Function *insertWriteSites(Module &M);
+  void insertDump(Module &M, ArrayRef<InstrumentedFunction> Functions);
+
+  std::string Filename;
+  /// void record(i8 *Target, i64 *Site) counts a call to Target at Site.
+  Function *RecordTarget;
+};
+}
+
+char EdgeProfiler::ID = 0;
+INITIALIZE_PASS_BEGIN(EdgeProfiler, "insert-edge-profiling",
+                      "Insert instrumentation for edge profiling", false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
+INITIALIZE_PASS_DEPENDENCY(BranchProbabilityInfo)
+INITIALIZE_PASS_END(EdgeProfiler, "insert-edge-profiling",
+                    "Insert instrumentation for edge profiling", false, false)
+
+ModulePass *llvm::createEdgeProfilerPass(StringRef Filename) {
+  return new EdgeProfiler(Filename);
+}
+
+bool EdgeProfiler::runOnModule(Module &M) {
+  LLVMContext &Ctx = M.getContext();
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  RecordTarget = 0;
+  if (ProfileIndirectCalls) {
+    // Declare the function that records the targets now, so that it is not
+    // instrumented itself; it is defined if it ends up being called.
+    Type *RecordArgs[] = { Type::getInt8PtrTy(Ctx), Type::getInt64PtrTy(Ctx) };
+    RecordTarget = Function::Create(
+        FunctionType::get(Type::getVoidTy(Ctx), RecordArgs, false),
+        GlobalValue::InternalLinkage, "__llvm_edge_profile_record_target", &M);
+  }
+
+  SmallVector<InstrumentedFunction, 16> Functions;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    ProfiledEdges PE;
+    if (!PE.compute(*F, *this)) {
+      ++NumUnprofilable;
+      continue;
+    }
+
+    ArrayType *CountersTy = ArrayType::get(Int64Ty, PE.Counted.size());
+    GlobalVariable *Counters =
+      new GlobalVariable(M, CountersTy, false, GlobalValue::InternalLinkage,
+                         Constant::getNullValue(CountersTy),
+                         "__llvm_edge_ctr");
+    insertCounters(PE, Counters);
+
+    InstrumentedFunction IF;
+    IF.Name = F->getName();
+    IF.Checksum = PE.Checksum;
+    IF.Counters = Counters;
+    IF.NumCounters = PE.Counted.size();
+    IF.Sites = 0;
+    IF.NumSites = 0;
+    if (RecordTarget)
+      IF.Sites = insertCallSiteCounters(*F, IF.NumSites);
+    Functions.push_back(IF);
+    ++NumInstrumented;
+    NumCounters += PE.Counted.size();
+  }
+
+  if (RecordTarget && RecordTarget->use_empty()) {
+    RecordTarget->eraseFromParent();
+    RecordTarget = 0;
+  }
+  if (Functions.empty())
+    return RecordTarget != 0;
+  if (RecordTarget)
+    defineRecordTarget(M);
+  insertDump(M, Functions);
+  return true;
+}
+
+/// getCounterInsertPoint - Return the instruction to count the edge From->To
+/// before, splitting the edge if it is critical.
+static Instruction *getCounterInsertPoint(BasicBlock *From, BasicBlock *To) {
+  if (!From)
+    return To->getFirstInsertionPt();
+  TerminatorInst *TI = From->getTerminator();
+  if (!To)
+    return TI;
+
+  unsigned SuccNum = TI->getNumSuccessors();
+  bool OnlySucc = true;
+  for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i) {
+    if (TI->getSuccessor(i) != To)
+      OnlySucc = false;
+    else if (SuccNum == e)
+      SuccNum = i;
+  }
+  if (OnlySucc)
+    return TI;
+  if (To->getUniquePredecessor() == From)
+    return To->getFirstInsertionPt();
+
+  BasicBlock *Split = SplitCriticalEdge(TI, SuccNum, 0,
+                                        /*MergeIdenticalEdges=*/true);
+  assert(Split && "Edge to count is not critical?");
+  return Split->getTerminator();
+}
+
+void EdgeProfiler::insertCounters(const ProfiledEdges &PE,
+                                  GlobalVariable *Counters) {
+  for (unsigned i = 0, e = PE.Counted.size(); i != e; ++i) {
+    const ProfiledEdges::Edge &Edge = PE.Edges[PE.Counted[i]];
+    IRBuilder<> Builder(getCounterInsertPoint(
+        const_cast<BasicBlock *>(Edge.first),
+        const_cast<BasicBlock *>(Edge.second)));
+    // The counters are plain internal globals, so that LICM can promote the
+    // ones counted in a loop to registers.
+    Value *Addr = Builder.CreateConstInBoundsGEP2_64(Counters, 0, i);
+    Value *Count = Builder.CreateLoad(Addr);
+    Builder.CreateStore(Builder.CreateAdd(Count, Builder.getInt64(1)), Addr);
+  }
+}
+
+/// insertCallSiteCounters - Record the targets of the indirect calls of F, and
+/// return their counters, or null if F has none.
+GlobalVariable *EdgeProfiler::insertCallSiteCounters(Function &F,
+                                                     unsigned &NumSites) {
+  SmallVector<CallSite, 8> Calls;
+  getIndirectCalls(F, Calls);
+  NumSites = Calls.size();
+  if (Calls.empty())
+    return 0;
+
+  Module &M = *F.getParent();
+  ArrayType *SitesTy =
+    ArrayType::get(Type::getInt64Ty(M.getContext()), NumSites * SiteSize);
+  GlobalVariable *Sites =
+    new GlobalVariable(M, SitesTy, false, GlobalValue::InternalLinkage,
+                       Constant::getNullValue(SitesTy), "__llvm_edge_sites");
+  for (unsigned i = 0; i != NumSites; ++i) {
+    IRBuilder<> Builder(Calls[i].getInstruction());
+    Builder.CreateCall2(
+        RecordTarget,
+        Builder.CreatePointerCast(Calls[i].getCalledValue(),
+                                  Builder.getInt8PtrTy()),
+        Builder.CreateConstInBoundsGEP2_64(Sites, 0, i * SiteSize));
+  }
+  NumCallSites += NumSites;
+  return Sites;
+}
+
+/// defineRecordTarget - Define the function that counts a call at a site, as
+/// a call to one of the targets the site has seen, or to a new one if there
+/// is room for it.
+void EdgeProfiler::defineRecordTarget(Module &M) {
+  LLVMContext &Ctx = M.getContext();
+  Function::arg_iterator AI = RecordTarget->arg_begin();
+  Value *Target = AI++;
+  Value *Site = AI;
+  BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", RecordTarget);
+  BasicBlock *Loop = BasicBlock::Create(Ctx, "loop", RecordTarget);
+  BasicBlock *Found = BasicBlock::Create(Ctx, "found", RecordTarget);
+  BasicBlock *CheckFree = BasicBlock::Create(Ctx, "check.free", RecordTarget);
+  BasicBlock *Claim = BasicBlock::Create(Ctx, "claim", RecordTarget);
+  BasicBlock *Next = BasicBlock::Create(Ctx, "next", RecordTarget);
+  BasicBlock *Exit = BasicBlock::Create(Ctx, "exit", RecordTarget);
+
+  IRBuilder<> Builder(Entry);
+  Value *Total = Builder.CreateLoad(Site);
+  Builder.CreateStore(Builder.CreateAdd(Total, Builder.getInt64(1)), Site);
+  Value *Addr = Builder.CreatePtrToInt(Target, Builder.getInt64Ty());
+  Builder.CreateBr(Loop);
+
+  // Slots are taken in order, so the first free one ends the search.
+  Builder.SetInsertPoint(Loop);
+  PHINode *Slot = Builder.CreatePHI(Builder.getInt32Ty(), 2);
+  Slot->addIncoming(Builder.getInt32(0), Entry);
+  Value *Idx = Builder.CreateAdd(Builder.CreateShl(Slot, 1),
+                                 Builder.getInt32(1));
+  Value *SlotTarget = Builder.CreateGEP(Site, Idx);
+  Value *SlotCount = Builder.CreateGEP(SlotTarget, Builder.getInt32(1));
+  Value *Seen = Builder.CreateLoad(SlotTarget);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(Seen, Addr), Found, CheckFree);
+
+  Builder.SetInsertPoint(Found);
+  Value *Count = Builder.CreateLoad(SlotCount);
+  Builder.CreateStore(Builder.CreateAdd(Count, Builder.getInt64(1)),
+                      SlotCount);
+  Builder.CreateBr(Exit);
+
+  Builder.SetInsertPoint(CheckFree);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(Seen, Builder.getInt64(0)), Claim,
+                       Next);
+
+  Builder.SetInsertPoint(Claim);
+  Builder.CreateStore(Addr, SlotTarget);
+  Builder.CreateStore(Builder.getInt64(1), SlotCount);
+  Builder.CreateBr(Exit);
+
+  Builder.SetInsertPoint(Next);
+  Value *NextSlot = Builder.CreateAdd(Slot, Builder.getInt32(1));
+  Slot->addIncoming(NextSlot, Next);
+  Builder.CreateCondBr(
+      Builder.CreateICmpEQ(NextSlot, Builder.getInt32(NumTargetSlots)), Exit,
+      Loop);
+
+  Builder.SetInsertPoint(Exit);
+  Builder.CreateRetVoid();
+}
+
+/// getSymbolTables - Return the head of the list of symbol tables, which is
+/// common to the instrumented modules of the program.
+static GlobalVariable *getSymbolTables(Module &M) {
+  if (GlobalVariable *Head = M.getGlobalVariable("__llvm_edge_profile_symtabs"))
+    return Head;
+  Type *Int8PtrTy = Type::getInt8PtrTy(M.getContext());
+  return new GlobalVariable(M, Int8PtrTy, false, GlobalValue::CommonLinkage,
+                            Constant::getNullValue(Int8PtrTy),
+                            "__llvm_edge_profile_symtabs");
+}
+
+/// insertSymbolTable - Add a table of the functions whose address the module
+/// takes, and their names, to the list that the instrumented modules of the
+/// program share.  Return the function that registers the table.
+Function *EdgeProfiler::insertSymbolTable(Module &M) {
+  LLVMContext &Ctx = M.getContext();
+  Type *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  IRBuilder<> Builder(Ctx);
+
+  // The table holds pairs of a function and its name.  A function defined in
+  // another module may be listed by several; they agree on its name.
+  SmallVector<Constant *, 32> Entries;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isIntrinsic() || !F->hasName() || !F->hasAddressTaken())
+      continue;
+    Entries.push_back(ConstantExpr::getBitCast(F, Int8PtrTy));
+    Constant *Name = ConstantDataArray::getString(Ctx, F->getName());
+    GlobalVariable *NameVar =
+      new GlobalVariable(M, Name->getType(), true,
+                         GlobalValue::PrivateLinkage, Name,
+                         "__llvm_edge_profile_name");
+    NameVar->setUnnamedAddr(true);
+    Entries.push_back(ConstantExpr::getBitCast(NameVar, Int8PtrTy));
+  }
+  ArrayType *TableTy = ArrayType::get(Int8PtrTy, Entries.size());
+  GlobalVariable *Table =
+    new GlobalVariable(M, TableTy, true, GlobalValue::InternalLinkage,
+                       ConstantArray::get(TableTy, Entries),
+                       "__llvm_edge_profile_symtab");
+
+  // Each module links a node for its table into the common list:
+  // { i8 *Next, i64 NumFunctions, i8 **Table }.
+  Type *NodeFields[] = { Int8PtrTy, Int64Ty,
+                         PointerType::getUnqual(Int8PtrTy) };
+  StructType *NodeTy = StructType::get(Ctx, NodeFields);
+  Constant *Zeros[] = { ConstantInt::get(Int64Ty, 0),
+                        ConstantInt::get(Int64Ty, 0) };
+  Constant *NodeInit[] = {
+    Constant::getNullValue(Int8PtrTy),
+    ConstantInt::get(Int64Ty, Entries.size() / 2),
+    ConstantExpr::getInBoundsGetElementPtr(Table, Zeros)
+  };
+  GlobalVariable *Node =
+    new GlobalVariable(M, NodeTy, false, GlobalValue::InternalLinkage,
+                       ConstantStruct::get(NodeTy, NodeInit),
+                       "__llvm_edge_profile_symtab_node");
+  GlobalVariable *Head = getSymbolTables(M);
+
+  Function *Register =
+    Function::Create(FunctionType::get(Type::getVoidTy(Ctx), false),
+                     GlobalValue::InternalLinkage,
+                     "__llvm_edge_profile_register", &M);
+  Builder.SetInsertPoint(BasicBlock::Create(Ctx, "entry", Register));
+  Builder.CreateStore(Builder.CreateLoad(Head),
+                      Builder.CreateStructGEP(Node, 0));
+  Builder.CreateStore(Builder.CreateBitCast(Node, Int8PtrTy), Head);
+  Builder.CreateRetVoid();
+  return Register;
+}
+
+/// insertWriteSites - Define the function that writes the counts of the
+/// indirect calls of a function, a line per call, and the names of their
+/// targets.
+Function *EdgeProfiler::insertWriteSites(Module &M) {
+  LLVMContext &Ctx = M.getContext();
+  Type *VoidTy = Type::getVoidTy(Ctx);
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  Type *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+  Type *Int8PtrPtrTy = PointerType::getUnqual(Int8PtrTy);
+  Type *Int64PtrTy = Type::getInt64PtrTy(Ctx);
+  Type *FPrintfArgs[] = { Int8PtrTy, Int8PtrTy };
+  Constant *FPrintf = M.getOrInsertFunction(
+      "fprintf", FunctionType::get(Int32Ty, FPrintfArgs, true));
+  Type *NodeFields[] = { Int8PtrTy, Int64Ty, Int8PtrPtrTy };
+  Type *NodePtrTy = PointerType::getUnqual(StructType::get(Ctx, NodeFields));
+  GlobalVariable *Head = getSymbolTables(M);
+
+  // i8 *lookup(i64 Addr) returns the name of the function at Addr, or null if
+  // no table has it.
+  Function *Lookup =
+    Function::Create(FunctionType::get(Int8PtrTy, Int64Ty, false),
+                     GlobalValue::InternalLinkage,
+                     "__llvm_edge_profile_lookup", &M);
+  Value *Addr = Lookup->arg_begin();
+  BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", Lookup);
+  BasicBlock *NodeLoop = BasicBlock::Create(Ctx, "node", Lookup);
+  BasicBlock *NodeBody = BasicBlock::Create(Ctx, "node.body", Lookup);
+  BasicBlock *EntryLoop = BasicBlock::Create(Ctx, "entry.loop", Lookup);
+  BasicBlock *Found = BasicBlock::Create(Ctx, "found", Lookup);
+  BasicBlock *EntryNext = BasicBlock::Create(Ctx, "entry.next", Lookup);
+  BasicBlock *NodeNext = BasicBlock::Create(Ctx, "node.next", Lookup);
+  BasicBlock *NotFound = BasicBlock::Create(Ctx, "not.found", Lookup);
+  IRBuilder<> Builder(Entry);
+  Value *First = Builder.CreateLoad(Head);
+  Builder.CreateBr(NodeLoop);
+
+  Builder.SetInsertPoint(NodeLoop);
+  PHINode *Node = Builder.CreatePHI(Int8PtrTy, 2);
+  Node->addIncoming(First, Entry);
+  Builder.CreateCondBr(Builder.CreateIsNull(Node), NotFound, NodeBody);
+
+  Builder.SetInsertPoint(NodeBody);
+  Value *NodePtr = Builder.CreateBitCast(Node, NodePtrTy);
+  Value *Next = Builder.CreateLoad(Builder.CreateStructGEP(NodePtr, 0));
+  Value *NumEntries = Builder.CreateLoad(Builder.CreateStructGEP(NodePtr, 1));
+  Value *Table = Builder.CreateLoad(Builder.CreateStructGEP(NodePtr, 2));
+  Builder.CreateCondBr(Builder.CreateICmpEQ(NumEntries, Builder.getInt64(0)),
+                       NodeNext, EntryLoop);
+
+  Builder.SetInsertPoint(EntryLoop);
+  PHINode *Idx = Builder.CreatePHI(Int64Ty, 2);
+  Idx->addIncoming(Builder.getInt64(0), NodeBody);
+  Value *Fn = Builder.CreateLoad(
+      Builder.CreateGEP(Table, Builder.CreateShl(Idx, 1)));
+  Builder.CreateCondBr(
+      Builder.CreateICmpEQ(Builder.CreatePtrToInt(Fn, Int64Ty), Addr), Found,
+      EntryNext);
+
+  Builder.SetInsertPoint(Found);
+  Value *NameIdx = Builder.CreateAdd(Builder.CreateShl(Idx, 1),
+                                     Builder.getInt64(1));
+  Builder.CreateRet(Builder.CreateLoad(Builder.CreateGEP(Table, NameIdx)));
+
+  Builder.SetInsertPoint(EntryNext);
+  Value *NextIdx = Builder.CreateAdd(Idx, Builder.getInt64(1));
+  Idx->addIncoming(NextIdx, EntryNext);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(NextIdx, NumEntries), NodeNext,
+                       EntryLoop);
+
+  Builder.SetInsertPoint(NodeNext);
+  Node->addIncoming(Next, NodeNext);
+  Builder.CreateBr(NodeLoop);
+
+  Builder.SetInsertPoint(NotFound);
+  Builder.CreateRet(Constant::getNullValue(Int8PtrTy));
+
+  // void write(i8 *File, i64 *Sites, i32 NumSites) prints the number of calls
+  // at each site, followed by the count and name of each known target.
+  Type *WriteArgs[] = { Int8PtrTy, Int64PtrTy, Int32Ty };
+  Function *Write =
+    Function::Create(FunctionType::get(VoidTy, WriteArgs, false),
+                     GlobalValue::InternalLinkage,
+                     "__llvm_edge_profile_write_sites", &M);
+  Function::arg_iterator AI = Write->arg_begin();
+  Value *File = AI++;
+  Value *Sites = AI++;
+  Value *NumSites = AI;
+  Entry = BasicBlock::Create(Ctx, "entry", Write);
+  BasicBlock *SiteLoop = BasicBlock::Create(Ctx, "site", Write);
+  BasicBlock *SlotLoop = BasicBlock::Create(Ctx, "slot", Write);
+  BasicBlock *Print = BasicBlock::Create(Ctx, "print", Write);
+  BasicBlock *SlotNext = BasicBlock::Create(Ctx, "slot.next", Write);
+  BasicBlock *SiteNext = BasicBlock::Create(Ctx, "site.next", Write);
+  BasicBlock *Exit = BasicBlock::Create(Ctx, "exit", Write);
+  Builder.SetInsertPoint(Entry);
+  Value *TotalFormat = Builder.CreateGlobalStringPtr("%llu");
+  Value *TargetFormat = Builder.CreateGlobalStringPtr(" %llu %s");
+  Value *EndFormat = Builder.CreateGlobalStringPtr("\n");
+  Builder.CreateCondBr(Builder.CreateICmpEQ(NumSites, Builder.getInt32(0)),
+                       Exit, SiteLoop);
+
+  Builder.SetInsertPoint(SiteLoop);
+  PHINode *SiteIdx = Builder.CreatePHI(Int32Ty, 2);
+  SiteIdx->addIncoming(Builder.getInt32(0), Entry);
+  Value *Site = Builder.CreateGEP(
+      Sites, Builder.CreateMul(SiteIdx, Builder.getInt32(SiteSize)));
+  Builder.CreateCall3(FPrintf, File, TotalFormat, Builder.CreateLoad(Site));
+  Builder.CreateBr(SlotLoop);
+
+  Builder.SetInsertPoint(SlotLoop);
+  PHINode *Slot = Builder.CreatePHI(Int32Ty, 2);
+  Slot->addIncoming(Builder.getInt32(0), SiteLoop);
+  Value *SlotTarget = Builder.CreateGEP(
+      Site,
+      Builder.CreateAdd(Builder.CreateShl(Slot, 1), Builder.getInt32(1)));
+  Value *Name = Builder.CreateCall(Lookup, Builder.CreateLoad(SlotTarget));
+  Builder.CreateCondBr(Builder.CreateIsNull(Name), SlotNext, Print);
+
+  Builder.SetInsertPoint(Print);
+  Value *Count = Builder.CreateLoad(
+      Builder.CreateGEP(SlotTarget, Builder.getInt32(1)));
+  Value *Args[] = { File, TargetFormat, Count, Name };
+  Builder.CreateCall(FPrintf, Args);
+  Builder.CreateBr(SlotNext);
+
+  Builder.SetInsertPoint(SlotNext);
+  Value *NextSlot = Builder.CreateAdd(Slot, Builder.getInt32(1));
+  Slot->addIncoming(NextSlot, SlotNext);
+  Builder.CreateCondBr(
+      Builder.CreateICmpEQ(NextSlot, Builder.getInt32(NumTargetSlots)),
+      SiteNext, SlotLoop);
+
+  Builder.SetInsertPoint(SiteNext);
+  Builder.CreateCall2(FPrintf, File, EndFormat);
+  Value *NextSite = Builder.CreateAdd(SiteIdx, Builder.getInt32(1));
+  SiteIdx->addIncoming(NextSite, SiteNext);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(NextSite, NumSites), Exit,
+                       SiteLoop);
+
+  Builder.SetInsertPoint(Exit);
+  Builder.CreateRetVoid();
+  return Write;
+}
+
+void EdgeProfiler::insertDump(Module &M,
+                              ArrayRef<InstrumentedFunction> Functions) {
+  LLVMContext &Ctx = M.getContext();
+  Type *VoidTy = Type::getVoidTy(Ctx);
+  Type *Int32Ty = Type::getInt32Ty(Ctx);
+  Type *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+  Type *Int64PtrTy = Type::getInt64PtrTy(Ctx);
+  FunctionType *VoidFnTy = FunctionType::get(VoidTy, false);
+
+  // The FILE pointers are only passed around, so i8* will do for them.
+  Constant *GetEnv = M.getOrInsertFunction("getenv", Int8PtrTy, Int8PtrTy,
+                                           NULL);
+  Constant *FOpen = M.getOrInsertFunction("fopen", Int8PtrTy, Int8PtrTy,
+                                          Int8PtrTy, NULL);
+  Constant *FClose = M.getOrInsertFunction("fclose", Int32Ty, Int8PtrTy,
+                                           NULL);
+  Type *FPrintfArgs[] = { Int8PtrTy, Int8PtrTy };
+  Constant *FPrintf = M.getOrInsertFunction(
+      "fprintf", FunctionType::get(Int32Ty, FPrintfArgs, true));
+  Constant *AtExit = M.getOrInsertFunction(
+      "atexit", Int32Ty, PointerType::getUnqual(VoidFnTy), NULL);
+
+  // void write(i8 *File, i64 *Counters, i32 NumCounters) prints the counters
+  // one per line.
+  Type *WriteArgs[] = { Int8PtrTy, Int64PtrTy, Int32Ty };
+  Function *Write =
+    Function::Create(FunctionType::get(VoidTy, WriteArgs, false),
+                     GlobalValue::InternalLinkage, "__llvm_edge_profile_write",
+                     &M);
+  Function::arg_iterator AI = Write->arg_begin();
+  Value *File = AI++;
+  Value *Counters = AI++;
+  Value *NumCounters = AI;
+  BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", Write);
+  BasicBlock *Loop = BasicBlock::Create(Ctx, "loop", Write);
+  BasicBlock *Exit = BasicBlock::Create(Ctx, "exit", Write);
+  IRBuilder<> Builder(Entry);
+  Value *CountFormat = Builder.CreateGlobalStringPtr("%llu\n");
+  Builder.CreateCondBr(Builder.CreateICmpEQ(NumCounters, Builder.getInt32(0)),
+                       Exit, Loop);
+  Builder.SetInsertPoint(Loop);
+  PHINode *Idx = Builder.CreatePHI(Int32Ty, 2);
+  Idx->addIncoming(Builder.getInt32(0), Entry);
+  Value *Count = Builder.CreateLoad(Builder.CreateGEP(Counters, Idx));
+  Builder.CreateCall3(FPrintf, File, CountFormat, Count);
+  Value *Next = Builder.CreateAdd(Idx, Builder.getInt32(1));
+  Idx->addIncoming(Next, Loop);
+  Builder.CreateCondBr(Builder.CreateICmpEQ(Next, NumCounters), Exit, Loop);
+  Builder.SetInsertPoint(Exit);
+  Builder.CreateRetVoid();
+
+  // void dump() appends a record for each function to the profile, which
+  // $LLVM_EDGE_PROFILE_FILE can override the name of.
+  Function *Dump = Function::Create(VoidFnTy, GlobalValue::InternalLinkage,
+                                    "__llvm_edge_profile_dump", &M);
+  Entry = BasicBlock::Create(Ctx, "entry", Dump);
+  BasicBlock *Body = BasicBlock::Create(Ctx, "write", Dump);
+  Exit = BasicBlock::Create(Ctx, "exit", Dump);
+  Builder.SetInsertPoint(Entry);
+  Value *Env = Builder.CreateCall(
+      GetEnv, Builder.CreateGlobalStringPtr("LLVM_EDGE_PROFILE_FILE"));
+  Value *Path = Builder.CreateSelect(
+      Builder.CreateIsNull(Env),
+      Builder.CreateGlobalStringPtr(Filename.empty() ? EdgeProfileFilename
+                                                     : Filename),
+      Env);
+  File = Builder.CreateCall2(FOpen, Path, Builder.CreateGlobalStringPtr("a"));
+  Builder.CreateCondBr(Builder.CreateIsNull(File), Exit, Body);
+  Builder.SetInsertPoint(Body);
+  Value *HeaderFormat = Builder.CreateGlobalStringPtr("%s\n%u\n%u\n");
+  Value *NumSitesFormat = Builder.CreateGlobalStringPtr("%u\n");
+  Function *WriteSites = RecordTarget ? insertWriteSites(M) : 0;
+  for (unsigned i = 0, e = Functions.size(); i != e; ++i) {
+    const InstrumentedFunction &IF = Functions[i];
+    Value *NumCounters = Builder.getInt32(IF.NumCounters);
+    Value *Args[] = { File, HeaderFormat,
+                      Builder.CreateGlobalStringPtr(IF.Name),
+                      Builder.getInt32(IF.Checksum), NumCounters };
+    Builder.CreateCall(FPrintf, Args);
+    Builder.CreateCall3(Write, File,
+                        Builder.CreateConstInBoundsGEP2_64(IF.Counters, 0, 0),
+                        NumCounters);
+    Value *NumSites = Builder.getInt32(IF.NumSites);
+    Builder.CreateCall3(FPrintf, File, NumSitesFormat, NumSites);
+    if (IF.Sites)
+      Builder.CreateCall3(WriteSites, File,
+                          Builder.CreateConstInBoundsGEP2_64(IF.Sites, 0, 0),
+                          NumSites);
+  }
+  Builder.CreateCall(FClose, File);
+  Builder.CreateBr(Exit);
+  Builder.SetInsertPoint(Exit);
+  Builder.CreateRetVoid();
+
+  // Have a constructor register dump() to run at exit, along with the names
+  // the targets of indirect calls are written with.
+  Function *Register = RecordTarget ? insertSymbolTable(M) : 0;
+  Function *Init = Function::Create(VoidFnTy, GlobalValue::InternalLinkage,
+                                    "__llvm_edge_profile_init", &M);
+  Builder.SetInsertPoint(BasicBlock::Create(Ctx, "entry", Init));
+  if (Register)
+    Builder.CreateCall(Register);
+  Builder.CreateCall(AtExit, Dump);
+  Builder.CreateRetVoid();
+  appendToGlobalCtors(M, Init, 0);
+}
+
+//===----------------------------------------------------------------------===//
+// Profile loading
+//===----------------------------------------------------------------------===//
+
+namespace {
+class EdgeProfileLoader : public ModulePass {
+public:
+  static char ID;
+  explicit EdgeProfileLoader(StringRef Filename = StringRef())
+    : ModulePass(ID), Filename(Filename) {
+    initializeEdgeProfileLoaderPass(*PassRegistry::getPassRegistry());
+  }
+
+  virtual const char *getPassName() const { return "Edge Profile Loader"; }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<BlockFrequencyInfo>();
+    AU.addRequired<BranchProbabilityInfo>();
+  }
+
+  virtual bool runOnModule(Module &M);
+
+private:
+  /// SiteProfile - The calls made by an indirect call, summed over all runs.
+  struct SiteProfile {
+    SiteProfile() : Total(0) {}
+    uint64_t Total;
+    std::map<std::string, uint64_t> Targets;
+  };
+
+  /// FunctionProfile - The counters of a function, summed over all runs.
+  struct FunctionProfile {
+    FunctionProfile() : Checksum(0), Consistent(true) {}
+    unsigned Checksum;
+    std::vector<uint64_t> Counters;
+    std::vector<SiteProfile> Sites;
+    /// False if the runs disagree on the CFG of the function.
+    bool Consistent;
+  };
+
+  void readProfile(const MemoryBuffer &Buffer);
+  bool annotate(Function &F, const FunctionProfile &FP);
+  void annotateCalls(Function &F, const FunctionProfile &FP);
+
+  std::string Filename;
+  StringMap<FunctionProfile> Profiles;
+};
+}
+
+char EdgeProfileLoader::ID = 0;
+INITIALIZE_PASS_BEGIN(EdgeProfileLoader, "edge-profile-loader",
+                      "Load edge profiles as branch weights", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
+INITIALIZE_PASS_DEPENDENCY(BranchProbabilityInfo)
+INITIALIZE_PASS_END(EdgeProfileLoader, "edge-profile-loader",
+                    "Load edge profiles as branch weights", false, false)
+
+ModulePass *llvm::createEdgeProfileLoaderPass(StringRef Filename) {
+  return new EdgeProfileLoader(Filename);
+}
+
+/// readNumber - Parse the next line of Rest as a decimal number.
+static bool readNumber(StringRef &Rest, uint64_t &N) {
+  std::pair<StringRef, StringRef> Split = Rest.split('\n');
+  Rest = Split.second;
+  return !Split.first.empty() &&
+         Split.first.find_first_not_of("0123456789") == StringRef::npos &&
+         !Split.first.getAsInteger(10, N);
+}
+
+void EdgeProfileLoader::readProfile(const MemoryBuffer &Buffer) {
+  StringRef Rest = Buffer.getBuffer();
+  while (!Rest.empty()) {
+    std::pair<StringRef, StringRef> Split = Rest.split('\n');
+    StringRef Name = Split.first;
+    Rest = Split.second;
+    uint64_t Checksum, NumCounters;
+    if (Name.empty() || !readNumber(Rest, Checksum) ||
+        !readNumber(Rest, NumCounters))
+      report_fatal_error(Filename + ": malformed record for '" + Name + "'");
+
+    FunctionProfile &FP = Profiles[Name];
+    bool First = FP.Counters.empty();
+    if (First) {
+      FP.Checksum = Checksum;
+      FP.Counters.resize(NumCounters);
+    } else if (FP.Checksum != Checksum || FP.Counters.size() != NumCounters) {
+      FP.Consistent = false;
+    }
+    for (uint64_t i = 0; i != NumCounters; ++i) {
+      uint64_t Count;
+      if (!readNumber(Rest, Count))
+        report_fatal_error(Filename + ": malformed counter for '" + Name +
+                           "'");
+      if (FP.Consistent)
+        FP.Counters[i] += Count;
+    }
+
+    uint64_t NumSites;
+    if (!readNumber(Rest, NumSites))
+      report_fatal_error(Filename + ": malformed record for '" + Name + "'");
+    if (First)
+      FP.Sites.resize(NumSites);
+    else if (FP.Sites.size() != NumSites)
+      FP.Consistent = false;
+    for (uint64_t i = 0; i != NumSites; ++i) {
+      // Each site is a line with its number of calls, followed by the count
+      // and name of each of its known targets.
+      std::pair<StringRef, StringRef> Split = Rest.split('\n');
+      Rest = Split.second;
+      SmallVector<StringRef, 8> Fields;
+      Split.first.split(Fields, " ");
+      uint64_t Total;
+      if (Fields.size() % 2 != 1 || Fields[0].getAsInteger(10, Total))
+        report_fatal_error(Filename + ": malformed call site for '" + Name +
+                           "'");
+      if (!FP.Consistent)
+        continue;
+      SiteProfile &SP = FP.Sites[i];
+      SP.Total += Total;
+      for (unsigned j = 1, je = Fields.size(); j != je; j += 2) {
+        uint64_t Count;
+        if (Fields[j].getAsInteger(10, Count) || Fields[j + 1].empty())
+          report_fatal_error(Filename + ": malformed call site for '" + Name +
+                             "'");
+        SP.Targets[Fields[j + 1]] += Count;
+      }
+    }
+  }
+}
+
+bool EdgeProfileLoader::runOnModule(Module &M) {
+  if (Filename.empty())
+    Filename = EdgeProfileFilename;
+  OwningPtr<MemoryBuffer> Buffer;
+  if (error_code EC = MemoryBuffer::getFile(Filename, Buffer))
+    report_fatal_error("Could not open edge profile " + Filename + ": " +
+                       EC.message());
+  readProfile(*Buffer);
+
+  bool Changed = false;
+  for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+    if (F->isDeclaration())
+      continue;
+    StringMap<FunctionProfile>::const_iterator I = Profiles.find(F->getName());
+    if (I != Profiles.end())
+      Changed |= annotate(*F, I->getValue());
+  }
+  return Changed;
+}
+
+bool EdgeProfileLoader::annotate(Function &F, const FunctionProfile &FP) {
+  ProfiledEdges PE;
+  if (!FP.Consistent || !PE.compute(F, *this) || PE.Checksum != FP.Checksum ||
+      PE.Counted.size() != FP.Counters.size()) {
+    DEBUG(dbgs() << "Edge profile of " << F.getName() << " does not match\n");
+    ++NumMismatched;
+    return false;
+  }
+
+  std::vector<uint64_t> Counts;
+  PE.solve(FP.Counters, Counts);
+  DenseMap<ProfiledEdges::Edge, uint64_t> EdgeCounts;
+  for (unsigned i = 0, e = PE.Edges.size(); i != e; ++i)
+    EdgeCounts[PE.Edges[i]] = Counts[i];
+
+  // The first edge is the one from the callers into the entry block.
+  F.setEntryCount(Counts[0]);
+
+  MDBuilder MDB(F.getContext());
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    TerminatorInst *TI = BB->getTerminator();
+    if ((!isa<BranchInst>(TI) && !isa<SwitchInst>(TI)) ||
+        TI->getNumSuccessors() < 2)
+      continue;
+
+    // All the edges to a successor were counted together, so give their
+    // count to the first of them.
+    SmallVector<uint64_t, 4> Weights;
+    SmallPtrSet<const BasicBlock *, 4> Seen;
+    uint64_t Max = 0;
+    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i) {
+      BasicBlock *Succ = TI->getSuccessor(i);
+      uint64_t Weight = 0;
+      if (Seen.insert(Succ))
+        Weight = EdgeCounts.lookup(ProfiledEdges::Edge(BB, Succ));
+      Weights.push_back(Weight);
+      Max = std::max(Max, Weight);
+    }
+    // Leave the branches that never ran to the static heuristics.
+    if (Max == 0)
+      continue;
+
+    // Branch weights are 32 bits wide.
+    uint64_t Scale = Max / UINT32_MAX + 1;
+    SmallVector<uint32_t, 4> Weights32;
+    for (unsigned i = 0, e = Weights.size(); i != e; ++i)
+      Weights32.push_back(Weights[i] / Scale);
+    TI->setMetadata(LLVMContext::MD_prof, MDB.createBranchWeights(Weights32));
+    ++NumAnnotated;
+  }
+
+  annotateCalls(F, FP);
+  return true;
+}
+
+/// compareTargets - Order call targets by decreasing number of calls.
+static bool compareTargets(const std::pair<StringRef, uint64_t> &LHS,
+                           const std::pair<StringRef, uint64_t> &RHS) {
+  if (LHS.second != RHS.second)
+    return LHS.second > RHS.second;
+  return LHS.first < RHS.first;
+}
+
+/// annotateCalls - Record the profiled targets of the indirect calls of F.
+void EdgeProfileLoader::annotateCalls(Function &F, const FunctionProfile &FP) {
+  SmallVector<CallSite, 8> Calls;
+  getIndirectCalls(F, Calls);
+  if (Calls.size() != FP.Sites.size())
+    return;
+
+  MDBuilder MDB(F.getContext());
+  for (unsigned i = 0, e = Calls.size(); i != e; ++i) {
+    const SiteProfile &SP = FP.Sites[i];
+    if (SP.Targets.empty())
+      continue;
+    SmallVector<std::pair<StringRef, uint64_t>, 4> Targets;
+    for (std::map<std::string, uint64_t>::const_iterator
+             I = SP.Targets.begin(), E = SP.Targets.end();
+         I != E; ++I)
+      Targets.push_back(std::make_pair(StringRef(I->first), I->second));
+    std::sort(Targets.begin(), Targets.end(), compareTargets);
+    Calls[i].getInstruction()->setMetadata(
+        LLVMContext::MD_prof, MDB.createIndirectCallTargets(SP.Total, Targets));
+    ++NumCallsAnnotated;
+  }
+}
@@ -99,8 +99,10 @@
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/ADT/ValueMap.h"
+#include "llvm/Analysis/Dominators.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
@@ -164,6 +166,13 @@ static cl::opt<bool> ClStoreCleanOrigin("msan-store-clean-origin",
        cl::desc("store origin for clean (fully initialized) values"),
        cl::Hidden, cl::init(false));
 
+// Unless we keep going after a UMR, a value that has been checked is fully
+// initialized wherever the check dominates, and its shadow does not need to
+// be propagated (or its origin stored) any further.
+static cl::opt<bool> ClCleanAfterCheck("msan-clean-after-check",
+       cl::desc("treat values as initialized after a dominating check"),
+       cl::Hidden, cl::init(true));
+
 // This flag controls whether we check the shadow of the address
 // operand of load or store. Such bugs are very rare, since load from
 // a garbage address typically results in SEGV, but still happen
@@ -194,6 +203,12 @@ static cl::opt<bool> ClWrapIndirectCallsFast("msan-wrap-indirect-calls-fast",
        cl::desc("Do not wrap indirect calls with target in the same module"),
        cl::Hidden, cl::init(true));
 
+STATISTIC(NumShadowsCleanAfterCheck,
+          "Number of shadow uses known to be clean after a check");
+STATISTIC(NumOriginalInstructions,
+          "Number of instructions in instrumented functions");
+STATISTIC(NumAddedInstructions, "Number of instructions added");
+
 namespace {
 
 /// \brief An instrumentation pass implementing detection of uninitialized
@@ -509,8 +524,16 @@ struct MemorySanitizerVisitor : public InstVisitor<MemorySanitizerVisitor> {
   SmallVector<Instruction*, 16> StoreList;
   SmallVector<CallSite, 16> IndirectCallList;
 
+  /// \brief Values that are checked, mapped to the place of the check.
+  DenseMap<Value*, Instruction*> CheckedValues;
+  DominatorTree DT;
+  /// \brief The instruction being instrumented, or null if the shadow is
+  /// requested outside of the visit of a particular instruction.
+  Instruction *ShadowUser;
+
   MemorySanitizerVisitor(Function &F, MemorySanitizer &MS)
-      : F(F), MS(MS), VAHelper(CreateVarArgHelper(F, MS, *this)) {
+      : F(F), MS(MS), VAHelper(CreateVarArgHelper(F, MS, *this)),
+        ShadowUser(0) {
     bool SanitizeFunction = !MS.BL->isIn(F) && F.getAttributes().hasAttribute(
                                                    AttributeSet::FunctionIndex,
                                                    Attribute::SanitizeMemory);
@@ -530,6 +553,7 @@ struct MemorySanitizerVisitor : public InstVisitor<MemorySanitizerVisitor> {
   void materializeStores() {
     for (size_t i = 0, n = StoreList.size(); i < n; i++) {
       StoreInst& I = *dyn_cast<StoreInst>(StoreList[i]);
+      ShadowUser = &I;
 
       IRBuilder<> IRB(&I);
       Value *Val = I.getValueOperand();
@@ -573,6 +597,7 @@ struct MemorySanitizerVisitor : public InstVisitor<MemorySanitizerVisitor> {
         }
       }
     }
+    ShadowUser = 0;
   }
 
   void materializeChecks() {
@@ -660,14 +685,23 @@ struct MemorySanitizerVisitor : public InstVisitor<MemorySanitizerVisitor> {
     // It's easier to remove unreachable blocks than deal with missing shadow.
     removeUnreachableBlocks(F);
 
+    if (InsertChecks && ClCleanAfterCheck && !ClKeepGoing)
+      DT.runOnFunction(F);
+
     // Iterate all BBs in depth-first order and create shadow instructions
     // for all instructions (where applicable).
     // For PHI nodes we create dummy shadow PHIs which will be finalized later.
     for (df_iterator<BasicBlock*> DI = df_begin(&F.getEntryBlock()),
          DE = df_end(&F.getEntryBlock()); DI != DE; ++DI) {
       BasicBlock *BB = *DI;
-      visit(*BB);
+      // Like InstVisitor::visit(BasicBlock&), but remember the instruction
+      // being visited.  Instrumentation inserted after it is not visited.
+      for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E;) {
+        ShadowUser = I++;
+        visit(*ShadowUser);
+      }
     }
+    ShadowUser = 0;
 
     // Finalize PHI nodes.
     for (size_t i = 0, n = ShadowPHINodes.size(); i < n; i++) {
@@ -860,6 +894,16 @@ struct MemorySanitizerVisitor : public InstVisitor<MemorySanitizerVisitor> {
   /// This function either returns the value set earlier with setShadow,
   /// or extracts if from ParamTLS (for function arguments).
   Value *getShadow(Value *V) {
+    if (ShadowUser && !CheckedValues.empty()) {
+      // A failed check does not return, so V is initialized here if it is
+      // checked on every path leading to ShadowUser.
+      DenseMap<Value*, Instruction*>::iterator It = CheckedValues.find(V);
+      if (It != CheckedValues.end() && It->second != ShadowUser &&
+          DT.dominates(It->second, ShadowUser)) {
+        ++NumShadowsCleanAfterCheck;
+        return getCleanShadow(V);
+      }
+    }
     if (Instruction *I = dyn_cast<Instruction>(V)) {
       // For instructions the shadow is already stored in the map.
       Value *Shadow = ShadowMap[V];
@@ -980,6 +1024,8 @@ struct MemorySanitizerVisitor : public InstVisitor<MemorySanitizerVisitor> {
     if (!Shadow) return;
     Instruction *Origin = dyn_cast_or_null<Instruction>(getOrigin(Val));
     insertShadowCheck(Shadow, Origin, OrigIns);
+    if (InsertChecks && ClCleanAfterCheck && !ClKeepGoing)
+      CheckedValues.insert(std::make_pair(Val, OrigIns));
   }
 
   AtomicOrdering addReleaseOrdering(AtomicOrdering a) {
@@ -2342,6 +2388,13 @@ VarArgHelper *CreateVarArgHelper(Function &Func, MemorySanitizer &Msan,
 
 }  // namespace
 
+static unsigned countInstructions(Function &F) {
+  unsigned Count = 0;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+    Count += BB->size();
+  return Count;
+}
+
 bool MemorySanitizer::runOnFunction(Function &F) {
   MemorySanitizerVisitor Visitor(F, *this);
 
@@ -2353,5 +2406,15 @@ bool MemorySanitizer::runOnFunction(Function &F) {
                      AttributeSet::get(F.getContext(),
                                        AttributeSet::FunctionIndex, B));
 
-  return Visitor.runOnFunction();
+  unsigned OriginalSize = countInstructions(F);
+  bool Changed = Visitor.runOnFunction();
+  unsigned InstrumentedSize = countInstructions(F);
+  NumOriginalInstructions += OriginalSize;
+  // Unreachable blocks are removed before instrumenting, so the function can
+  // also shrink.
+  if (InstrumentedSize > OriginalSize)
+    NumAddedInstructions += InstrumentedSize - OriginalSize;
+  DEBUG(dbgs() << "MemorySanitizer: " << F.getName() << ": " << OriginalSize
+               << " instructions before, " << InstrumentedSize << " after\n");
+  return Changed;
 }
@@ -22,11 +22,14 @@
 #define DEBUG_TYPE "tsan"
 
 #include "llvm/Transforms/Instrumentation.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/Analysis/CaptureTracking.h"
+#include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
@@ -71,6 +74,10 @@ STATISTIC(NumInstrumentedVtableReads, "Number of vtable ptr reads");
 STATISTIC(NumOmittedReadsFromConstantGlobals,
           "Number of reads from constant globals");
 STATISTIC(NumOmittedReadsFromVtable, "Number of vtable reads");
+STATISTIC(NumOmittedRepeatedAccesses,
+          "Number of accesses ignored due to preceding accesses");
+STATISTIC(NumOmittedNonCaptured,
+          "Number of accesses ignored due to non-captured allocas");
 
 namespace {
 
@@ -94,9 +101,14 @@ struct ThreadSanitizer : public FunctionPass {
   void chooseInstructionsToInstrument(SmallVectorImpl<Instruction*> &Local,
                                       SmallVectorImpl<Instruction*> &All);
   bool addrPointsToConstantData(Value *Addr);
+  bool addrPointsToThreadLocalObject(Value *Addr);
   int getMemoryAccessFuncIndex(Value *Addr);
 
   DataLayout *TD;
+  // Non-captured allocas of the current function, and the ones that may be
+  // captured.
+  SmallPtrSet<Value*, 8> NonCapturedAllocas;
+  SmallPtrSet<Value*, 8> CapturedAllocas;
   Type *IntptrTy;
   SmallString<64> BlacklistFile;
   OwningPtr<SpecialCaseList> BL;
@@ -266,9 +278,32 @@ bool ThreadSanitizer::addrPointsToConstantData(Value *Addr) {
   return false;
 }
 
+// An alloca whose address is never captured can only be accessed by the
+// thread running this function, so accesses to it can not race.
+bool ThreadSanitizer::addrPointsToThreadLocalObject(Value *Addr) {
+  Value *Obj = GetUnderlyingObject(Addr, TD);
+  if (!isa<AllocaInst>(Obj))
+    return false;
+  if (NonCapturedAllocas.count(Obj))
+    return true;
+  if (CapturedAllocas.count(Obj))
+    return false;
+  if (PointerMayBeCaptured(Obj, /*ReturnCaptures=*/true,
+                           /*StoreCaptures=*/true)) {
+    CapturedAllocas.insert(Obj);
+    return false;
+  }
+  NonCapturedAllocas.insert(Obj);
+  return true;
+}
+
 // Instrumenting some of the accesses may be proven redundant.
 // Currently handled:
 //  - read-before-write (within same BB, no calls between)
+//  - read-after-access and write-after-write (within same BB, no calls
+//    between): an access racing with the later one would also race with
+//    the earlier one.
+//  - accesses to allocas that are not captured
 //
 // We do not handle some of the patterns that should not survive
 // after the classic compiler optimizations.
@@ -280,13 +315,50 @@ bool ThreadSanitizer::addrPointsToConstantData(Value *Addr) {
 void ThreadSanitizer::chooseInstructionsToInstrument(
     SmallVectorImpl<Instruction*> &Local,
     SmallVectorImpl<Instruction*> &All) {
+  // Iterate from the start, dropping reads of temps that were accessed
+  // before and writes to temps that were written before.  Vtable accesses
+  // are instrumented differently and are always kept.
+  SmallSet<Value*, 8> AccessedTargets;
   SmallSet<Value*, 8> WriteTargets;
+  SmallVector<Instruction*, 8> Remaining;
+  for (size_t i = 0, n = Local.size(); i != n; ++i) {
+    Instruction *I = Local[i];
+    if (isVtableAccess(I)) {
+      Remaining.push_back(I);
+      continue;
+    }
+    if (StoreInst *Store = dyn_cast<StoreInst>(I)) {
+      Value *Addr = Store->getPointerOperand();
+      if (WriteTargets.count(Addr)) {
+        NumOmittedRepeatedAccesses++;
+        continue;
+      }
+      WriteTargets.insert(Addr);
+      AccessedTargets.insert(Addr);
+    } else {
+      Value *Addr = cast<LoadInst>(I)->getPointerOperand();
+      if (AccessedTargets.count(Addr)) {
+        NumOmittedRepeatedAccesses++;
+        continue;
+      }
+      AccessedTargets.insert(Addr);
+    }
+    Remaining.push_back(I);
+  }
+
+  WriteTargets.clear();
   // Iterate from the end.
-  for (SmallVectorImpl<Instruction*>::reverse_iterator It = Local.rbegin(),
-       E = Local.rend(); It != E; ++It) {
+  for (SmallVectorImpl<Instruction*>::reverse_iterator It = Remaining.rbegin(),
+       E = Remaining.rend(); It != E; ++It) {
     Instruction *I = *It;
     if (StoreInst *Store = dyn_cast<StoreInst>(I)) {
-      WriteTargets.insert(Store->getPointerOperand());
+      Value *Addr = Store->getPointerOperand();
+      if (addrPointsToThreadLocalObject(Addr)) {
+        // The stored-to object is not visible to other threads.
+        NumOmittedNonCaptured++;
+        continue;
+      }
+      WriteTargets.insert(Addr);
     } else {
       LoadInst *Load = cast<LoadInst>(I);
       Value *Addr = Load->getPointerOperand();
@@ -299,6 +371,10 @@ void ThreadSanitizer::chooseInstructionsToInstrument(
         // Addr points to some constant data -- it can not race with any writes.
         continue;
       }
+      if (addrPointsToThreadLocalObject(Addr)) {
+        NumOmittedNonCaptured++;
+        continue;
+      }
     }
     All.push_back(I);
   }
@@ -330,6 +406,8 @@ bool ThreadSanitizer::runOnFunction(Function &F) {
   SmallVector<Instruction*, 8> MemIntrinCalls;
   bool Res = false;
   bool HasCalls = false;
+  NonCapturedAllocas.clear();
+  CapturedAllocas.clear();
 
   // Traverse all instructions, collect loads/stores/returns, check for calls.
   for (Function::iterator FI = F.begin(), FE = F.end();
@@ -337,9 +415,12 @@ bool ThreadSanitizer::runOnFunction(Function &F) {
     BasicBlock &BB = *FI;
     for (BasicBlock::iterator BI = BB.begin(), BE = BB.end();
          BI != BE; ++BI) {
-      if (isAtomic(BI))
+      if (isAtomic(BI)) {
         AtomicAccesses.push_back(BI);
-      else if (isa<LoadInst>(BI) || isa<StoreInst>(BI))
+        // Atomics may synchronize with other threads, so accesses before
+        // and after them are not redundant with each other.
+        chooseInstructionsToInstrument(LocalLoadsAndStores, AllLoadsAndStores);
+      } else if (isa<LoadInst>(BI) || isa<StoreInst>(BI))
         LocalLoadsAndStores.push_back(BI);
       else if (isa<ReturnInst>(BI))
         RetVec.push_back(BI);
@@ -354,8 +435,6 @@ bool ThreadSanitizer::runOnFunction(Function &F) {
   }
 
   // We have collected all loads and stores.
-  // FIXME: many of these accesses do not need to be checked for races
-  // (e.g. variables that do not escape, etc).
 
   // Instrument memory accesses.
   if (ClInstrumentMemoryAccesses && F.hasFnAttribute(Attribute::SanitizeThread))
@@ -131,6 +131,25 @@ namespace {
       Map.erase(It);
     }
 
+    /// Remove the elements whose keys have been blotted from the vector,
+    /// so that iteration no longer has to skip them.
+    void compact() {
+      size_t Out = 0;
+      for (size_t In = 0, E = Vector.size(); In != E; ++In) {
+        if (Vector[In].first == KeyT())
+          continue;
+        if (In != Out) {
+          Vector[Out] = Vector[In];
+          Map[Vector[Out].first] = Out;
+        }
+        ++Out;
+      }
+      Vector.erase(Vector.begin() + Out, Vector.end());
+    }
+
+    /// Return the number of elements that haven't been blotted.
+    size_t size() const { return Map.size(); }
+
     void clear() {
       Map.clear();
       Vector.clear();
@@ -381,6 +400,12 @@ namespace {
 
     void clear();
 
+    /// Return true if this holds no information, as after clear().
+    bool empty() const {
+      return !KnownSafe && !IsTailCallRelease && !ReleaseMetadata &&
+             Calls.empty() && ReverseInsertPts.empty() && !CFGHazardAfflicted;
+    }
+
     /// Conservatively merge the two RRInfo. Returns true if a partial merge has
     /// occured, false otherwise.
     bool Merge(const RRInfo &Other);
@@ -441,6 +466,12 @@ namespace {
     PtrState() : KnownPositiveRefCount(false), Partial(false),
                  Seq(S_None) {}
 
+    /// Return true if this is the state a pointer starts out in.  Merging
+    /// with it or visiting an instruction with it behaves the same as if the
+    /// pointer had no state at all.
+    bool IsInitial() const {
+      return Seq == S_None && !KnownPositiveRefCount && !Partial && RRI.empty();
+    }
 
     bool IsKnownSafe() const {
       return RRI.KnownSafe;
@@ -641,6 +672,12 @@ namespace {
     ptr_iterator findPtrBottomUpState(const Value *Arg) {
       return PerPtrBottomUp.find(Arg);
     }
+    ptr_const_iterator findPtrBottomUpState(const Value *Arg) const {
+      return PerPtrBottomUp.find(Arg);
+    }
+
+    size_t top_down_ptr_size() const { return PerPtrTopDown.size(); }
+    size_t bottom_up_ptr_size() const { return PerPtrBottomUp.size(); }
 
     void clearBottomUpPointers() {
       PerPtrBottomUp.clear();
@@ -650,6 +687,16 @@ namespace {
       PerPtrTopDown.clear();
     }
 
+    /// Drop the pointers in their initial state, other than those in Keep, so
+    /// that the states propagated from block to block only hold the pointers
+    /// with something going on.
+    void pruneTopDownPointers(const DenseSet<const Value *> &Keep) {
+      prune(PerPtrTopDown, Keep);
+    }
+    void pruneBottomUpPointers(const DenseSet<const Value *> &Keep) {
+      prune(PerPtrBottomUp, Keep);
+    }
+
     void InitFromPred(const BBState &Other);
     void InitFromSucc(const BBState &Other);
     void MergePred(const BBState &Other);
@@ -684,11 +731,25 @@ namespace {
     void addPred(BasicBlock *Pred) { Preds.push_back(Pred); }
 
     bool isExit() const { return Succs.empty(); }
+
+  private:
+    static void prune(MapTy &Map, const DenseSet<const Value *> &Keep);
   };
 
   const unsigned BBState::OverflowOccurredValue = 0xffffffff;
 }
 
+void BBState::prune(MapTy &Map, const DenseSet<const Value *> &Keep) {
+  bool Blotted = false;
+  for (ptr_iterator MI = Map.begin(), ME = Map.end(); MI != ME; ++MI)
+    if (MI->first && MI->second.IsInitial() && !Keep.count(MI->first)) {
+      Map.blot(MI->first);
+      Blotted = true;
+    }
+  if (Blotted)
+    Map.compact();
+}
+
 void BBState::InitFromPred(const BBState &Other) {
   PerPtrTopDown = Other.PerPtrTopDown;
   TopDownPathCount = Other.TopDownPathCount;
@@ -816,6 +877,13 @@ ARCAnnotationTargetIdentifier("objc-arc-annotation-target-identifier",
                                        "but those that apply to the given "
                                        "target llvm identifier."));
 
+/// The most pointers whose states are tracked at once before retain+release
+/// pairing gives up on a function.
+static cl::opt<unsigned>
+MaxPtrStates("arc-opt-max-ptr-states", cl::Hidden, cl::init(4095),
+             cl::desc("Maximum number of ptr states the optimizer keeps "
+                      "track of"));
+
 /// This function appends a unique ARCAnnotationProvenanceSourceMDKind id to an
 /// instruction so that we can track backwards when post processing via the llvm
 /// arc annotation processor tool. If the function is an
@@ -1078,6 +1146,15 @@ namespace {
     // This is used to track if a pointer is stored into an alloca.
     DenseSet<const Value *> MultiOwnersSet;
 
+    /// The pointers stored into allocas anywhere in the function.  Their
+    /// states are never pruned, because whether the bottom-up traversal has
+    /// any state for them at such a store decides MultiOwnersSet.
+    DenseSet<const Value *> StoredToAllocaSet;
+
+    /// Set when a block has more than MaxPtrStates pointers to track, which
+    /// makes OptimizeSequences give up on the function.
+    bool DisableRetainReleasePairing;
+
     /// A flag indicating whether this optimization pass should run.
     bool Run;
 
@@ -1170,7 +1247,7 @@ namespace {
 
   public:
     static char ID;
-    ObjCARCOpt() : FunctionPass(ID) {
+    ObjCARCOpt() : FunctionPass(ID), DisableRetainReleasePairing(false) {
       initializeObjCARCOptPass(*PassRegistry::getPassRegistry());
     }
   };
@@ -1627,6 +1704,16 @@ void
 ObjCARCOpt::CheckForCFGHazards(const BasicBlock *BB,
                                DenseMap<const BasicBlock *, BBState> &BBStates,
                                BBState &MyStates) const {
+  // Look up the states of the successors once, rather than for each pointer.
+  const TerminatorInst *TI = cast<TerminatorInst>(&BB->back());
+  SmallVector<const BBState *, 2> SuccStates;
+  for (succ_const_iterator SI(TI), SE(TI, false); SI != SE; ++SI) {
+    DenseMap<const BasicBlock *, BBState>::const_iterator BBI =
+      BBStates.find(*SI);
+    assert(BBI != BBStates.end());
+    SuccStates.push_back(&BBI->second);
+  }
+
   // If any top-down local-use or possible-dec has a succ which is earlier in
   // the sequence, forget it.
   for (BBState::ptr_iterator I = MyStates.top_down_ptr_begin(),
@@ -1644,20 +1731,20 @@ ObjCARCOpt::CheckForCFGHazards(const BasicBlock *BB,
            "Unknown top down sequence state.");
 
     const Value *Arg = I->first;
-    const TerminatorInst *TI = cast<TerminatorInst>(&BB->back());
     bool SomeSuccHasSame = false;
     bool AllSuccsHaveSame = true;
     bool NotAllSeqEqualButKnownSafe = false;
 
-    succ_const_iterator SI(TI), SE(TI, false);
-
-    for (; SI != SE; ++SI) {
+    for (unsigned i = 0, e = SuccStates.size(); i != e; ++i) {
       // If VisitBottomUp has pointer information for this successor, take
-      // what we know about it.
-      const DenseMap<const BasicBlock *, BBState>::iterator BBI =
-        BBStates.find(*SI);
-      assert(BBI != BBStates.end());
-      const PtrState &SuccS = BBI->second.getPtrBottomUpState(Arg);
+      // what we know about it.  A pointer it has no state for is in S_None.
+      BBState::ptr_const_iterator SuccI =
+        SuccStates[i]->findPtrBottomUpState(Arg);
+      if (SuccI == SuccStates[i]->bottom_up_ptr_end()) {
+        S.ClearSequenceProgress();
+        continue;
+      }
+      const PtrState &SuccS = SuccI->second;
       const Sequence SuccSSeq = SuccS.GetSeq();
 
       // If bottom up, the pointer is in an S_None state, clear the sequence
@@ -1939,6 +2026,12 @@ ObjCARCOpt::VisitBottomUp(BasicBlock *BB,
     }
   }
 
+  // Give up on functions with too many pointers to track.
+  if (MyStates.bottom_up_ptr_size() > MaxPtrStates) {
+    DisableRetainReleasePairing = true;
+    return false;
+  }
+
   // If ARC Annotations are enabled, output the current state of pointers at the
   // bottom of the basic block.
   ANNOTATE_BOTTOMUP_BBEND(MyStates, BB);
@@ -1970,6 +2063,13 @@ ObjCARCOpt::VisitBottomUp(BasicBlock *BB,
   // top of the basic block.
   ANNOTATE_BOTTOMUP_BBSTART(MyStates, BB);
 
+  // Only pass on the pointers with something going on.  The annotations show
+  // every pointer, so don't prune when they are wanted.
+#ifdef ARC_ANNOTATIONS
+  if (!EnableARCAnnotations)
+#endif
+  MyStates.pruneBottomUpPointers(StoredToAllocaSet);
+
   return NestingDetected;
 }
 
@@ -2149,6 +2249,12 @@ ObjCARCOpt::VisitTopDown(BasicBlock *BB,
     }
   }
 
+  // Give up on functions with too many pointers to track.
+  if (MyStates.top_down_ptr_size() > MaxPtrStates) {
+    DisableRetainReleasePairing = true;
+    return false;
+  }
+
   // If ARC Annotations are enabled, output the current state of pointers at the
   // top of the basic block.
   ANNOTATE_TOPDOWN_BBSTART(MyStates, BB);
@@ -2170,6 +2276,11 @@ ObjCARCOpt::VisitTopDown(BasicBlock *BB,
   if (!(EnableARCAnnotations && DisableCheckForCFGHazards))
 #endif
   CheckForCFGHazards(BB, BBStates, MyStates);
+
+#ifdef ARC_ANNOTATIONS
+  if (!EnableARCAnnotations)
+#endif
+  MyStates.pruneTopDownPointers(StoredToAllocaSet);
   return NestingDetected;
 }
 
@@ -2272,19 +2383,32 @@ ObjCARCOpt::Visit(Function &F,
                     NoObjCARCExceptionsMDKind,
                     BBStates);
 
+  // Find the pointers whose states must not be pruned.
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
+    if (StoreInst *SI = dyn_cast<StoreInst>(&*I))
+      if (AreAnyUnderlyingObjectsAnAlloca(SI->getPointerOperand()))
+        StoredToAllocaSet.insert(
+          StripPointerCastsAndObjCCalls(SI->getValueOperand()));
+
   // Use reverse-postorder on the reverse CFG for bottom-up.
   bool BottomUpNestingDetected = false;
   for (SmallVectorImpl<BasicBlock *>::const_reverse_iterator I =
        ReverseCFGPostOrder.rbegin(), E = ReverseCFGPostOrder.rend();
-       I != E; ++I)
+       I != E; ++I) {
     BottomUpNestingDetected |= VisitBottomUp(*I, BBStates, Retains);
+    if (DisableRetainReleasePairing)
+      return false;
+  }
 
   // Use reverse-postorder for top-down.
   bool TopDownNestingDetected = false;
   for (SmallVectorImpl<BasicBlock *>::const_reverse_iterator I =
        PostOrder.rbegin(), E = PostOrder.rend();
-       I != E; ++I)
+       I != E; ++I) {
     TopDownNestingDetected |= VisitTopDown(*I, BBStates, Releases);
+    if (DisableRetainReleasePairing)
+      return false;
+  }
 
   return TopDownNestingDetected && BottomUpNestingDetected;
 }
@@ -2838,15 +2962,19 @@ bool ObjCARCOpt::OptimizeSequences(Function &F) {
   DenseMap<const BasicBlock *, BBState> BBStates;
 
   // Analyze the CFG of the function, and all instructions.
+  DisableRetainReleasePairing = false;
   bool NestingDetected = Visit(F, BBStates, Retains, Releases);
 
-  // Transform.
-  bool AnyPairsCompletelyEliminated = PerformCodePlacement(BBStates, Retains,
-                                                           Releases,
-                                                           F.getParent());
+  // Transform, unless the analysis gave up.
+  bool AnyPairsCompletelyEliminated = false;
+  if (!DisableRetainReleasePairing)
+    AnyPairsCompletelyEliminated = PerformCodePlacement(BBStates, Retains,
+                                                        Releases,
+                                                        F.getParent());
 
   // Cleanup.
   MultiOwnersSet.clear();
+  StoredToAllocaSet.clear();
 
   return AnyPairsCompletelyEliminated && NestingDetected;
 }
@@ -16,6 +16,8 @@
 #define DEBUG_TYPE "codegenprepare"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/ValueMap.h"
@@ -31,6 +33,7 @@
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Support/CommandLine.h"
@@ -90,6 +93,20 @@ namespace {
     /// multiple load/stores of the same address.
     ValueMap<Value*, Value*> SunkAddrs;
 
+    /// LocalAddrModes - Addresses, with the type accessed through them, that
+    /// OptimizeMemoryInst found nothing to sink for in the current block.
+    /// Matching them again gives the same answer until something changes, so
+    /// this is cleared on every change.
+    DenseSet<std::pair<Value*, Type*> > LocalAddrModes;
+
+    /// BlocksToRevisit - Blocks changed since OptimizeBlock last ran over
+    /// them, which the next round of OptimizeBlock runs over again.  Only
+    /// these are revisited, instead of the whole function.
+    SmallPtrSet<BasicBlock*, 16> BlocksToRevisit;
+
+    /// RevisitAllBlocks - Set when a change may have affected any block.
+    bool RevisitAllBlocks;
+
     /// ModifiedDT - If CFG is modified in anyway, dominator tree may need to
     /// be updated.
     bool ModifiedDT;
@@ -127,6 +144,7 @@ namespace {
     bool OptimizeSelectInst(SelectInst *SI);
     bool DupRetToEnableTailCallOpts(BasicBlock *BB);
     bool PlaceDbgValues(Function &F);
+    void revisitUsers(Value *V);
   };
 }
 
@@ -169,20 +187,26 @@ bool CodeGenPrepare::runOnFunction(Function &F) {
   // find a node corresponding to the value.
   EverMadeChange |= PlaceDbgValues(F);
 
-  bool MadeChange = true;
-  while (MadeChange) {
-    MadeChange = false;
+  // Optimize every block, then keep optimizing the blocks that the changes
+  // made touched until there are none.
+  RevisitAllBlocks = true;
+  while (RevisitAllBlocks || !BlocksToRevisit.empty()) {
+    bool All = RevisitAllBlocks;
+    SmallPtrSet<BasicBlock*, 16> Blocks;
+    Blocks.swap(BlocksToRevisit);
+    RevisitAllBlocks = false;
     for (Function::iterator I = F.begin(); I != F.end(); ) {
       BasicBlock *BB = I++;
-      MadeChange |= OptimizeBlock(*BB);
+      if (All || Blocks.count(BB))
+        EverMadeChange |= OptimizeBlock(*BB);
     }
-    EverMadeChange |= MadeChange;
   }
 
   SunkAddrs.clear();
+  LocalAddrModes.clear();
 
   if (!DisableBranchOpts) {
-    MadeChange = false;
+    bool MadeChange = false;
     SmallPtrSet<BasicBlock*, 8> WorkList;
     for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
       SmallVector<BasicBlock*, 2> Successors(succ_begin(BB), succ_end(BB));
@@ -447,11 +471,13 @@ void CodeGenPrepare::EliminateMostlyEmptyBlock(BasicBlock *BB) {
 /// OptimizeNoopCopyExpression - If the specified cast instruction is a noop
 /// copy (e.g. it's casting from one pointer type to another, i32->i8 on PPC),
 /// sink it into user blocks to reduce the number of virtual
-/// registers that must be created and coalesced.
+/// registers that must be created and coalesced.  The blocks it is sunk into
+/// are added to SunkInto.
 ///
 /// Return true if any changes are made.
 ///
-static bool OptimizeNoopCopyExpression(CastInst *CI, const TargetLowering &TLI){
+static bool OptimizeNoopCopyExpression(CastInst *CI, const TargetLowering &TLI,
+                                       SmallVectorImpl<BasicBlock*> &SunkInto){
   // If this is a noop copy,
   EVT SrcVT = TLI.getValueType(CI->getOperand(0)->getType());
   EVT DstVT = TLI.getValueType(CI->getType());
@@ -510,6 +536,7 @@ static bool OptimizeNoopCopyExpression(CastInst *CI, const TargetLowering &TLI){
       InsertedCast =
         CastInst::Create(CI->getOpcode(), CI->getOperand(0), CI->getType(), "",
                          InsertPt);
+      SunkInto.push_back(UserBB);
       MadeChange = true;
     }
 
@@ -531,9 +558,11 @@ static bool OptimizeNoopCopyExpression(CastInst *CI, const TargetLowering &TLI){
 /// the number of virtual registers that must be created and coalesced.  This is
 /// a clear win except on targets with multiple condition code registers
 ///  (PowerPC), where it might lose; some adjustment may be wanted there.
+/// The blocks it is sunk into are added to SunkInto.
 ///
 /// Return true if any changes are made.
-static bool OptimizeCmpExpression(CmpInst *CI) {
+static bool OptimizeCmpExpression(CmpInst *CI,
+                                  SmallVectorImpl<BasicBlock*> &SunkInto) {
   BasicBlock *DefBB = CI->getParent();
 
   /// InsertedCmp - Only insert a cmp in each block once.
@@ -567,6 +596,7 @@ static bool OptimizeCmpExpression(CmpInst *CI) {
         CmpInst::Create(CI->getOpcode(),
                         CI->getPredicate(),  CI->getOperand(0),
                         CI->getOperand(1), "", InsertPt);
+      SunkInto.push_back(UserBB);
       MadeChange = true;
     }
 
@@ -633,6 +663,9 @@ bool CodeGenPrepare::OptimizeCallInst(CallInst *CI) {
     replaceAndRecursivelySimplify(CI, RetVal, TLI ? TLI->getDataLayout() : 0,
                                   TLInfo, ModifiedDT ? 0 : DT);
 
+    // The simplifications can reach anywhere in the function.
+    RevisitAllBlocks = true;
+
     // If the iterator instruction was recursively deleted, start over at the
     // start of the block.
     if (IterHandle != CurInstIterator) {
@@ -663,7 +696,14 @@ bool CodeGenPrepare::OptimizeCallInst(CallInst *CI) {
   // that have the default "don't know" as the objectsize.  Anything else
   // should be left alone.
   CodeGenPrepareFortifiedLibCalls Simplifier;
-  return Simplifier.fold(CI, TD, TLInfo);
+  SmallVector<BasicBlock*, 4> UserBlocks;
+  for (Value::use_iterator UI = CI->use_begin(), E = CI->use_end(); UI != E;
+       ++UI)
+    UserBlocks.push_back(cast<Instruction>(*UI)->getParent());
+  if (!Simplifier.fold(CI, TD, TLInfo))
+    return false;
+  BlocksToRevisit.insert(UserBlocks.begin(), UserBlocks.end());
+  return true;
 }
 
 /// DupRetToEnableTailCallOpts - Look for opportunities to duplicate return
@@ -799,13 +839,16 @@ bool CodeGenPrepare::DupRetToEnableTailCallOpts(BasicBlock *BB) {
 
     // Duplicate the return into CallBB.
     (void)FoldReturnIntoUncondBranch(RI, BB, CallBB);
+    BlocksToRevisit.insert(CallBB);
     ModifiedDT = Changed = true;
     ++NumRetsDup;
   }
 
   // If we eliminated all predecessors of the block, delete the block now.
-  if (Changed && !BB->hasAddressTaken() && pred_begin(BB) == pred_end(BB))
+  if (Changed && !BB->hasAddressTaken() && pred_begin(BB) == pred_end(BB)) {
+    BlocksToRevisit.erase(BB);
     BB->eraseFromParent();
+  }
 
   return Changed;
 }
@@ -1456,6 +1499,12 @@ static bool IsNonLocalValue(Value *V, BasicBlock *BB) {
 /// operands.
 bool CodeGenPrepare::OptimizeMemoryInst(Instruction *MemoryInst, Value *Addr,
                                         Type *AccessTy) {
+  // Don't match the same address again if nothing changed since it was last
+  // found to need nothing sunk.
+  std::pair<Value*, Type*> Key(Addr, AccessTy);
+  if (LocalAddrModes.count(Key))
+    return false;
+
   Value *Repl = Addr;
 
   // Try to collapse single-value PHI nodes.  This is necessary to undo
@@ -1530,7 +1579,10 @@ bool CodeGenPrepare::OptimizeMemoryInst(Instruction *MemoryInst, Value *Addr,
 
   // If the addressing mode couldn't be determined, or if multiple different
   // ones were determined, bail out now.
-  if (!Consensus) return false;
+  if (!Consensus) {
+    LocalAddrModes.insert(Key);
+    return false;
+  }
 
   // Check to see if any of the instructions supersumed by this addr mode are
   // non-local to I's BB.
@@ -1545,6 +1597,7 @@ bool CodeGenPrepare::OptimizeMemoryInst(Instruction *MemoryInst, Value *Addr,
   // If all the instructions matched are already in this BB, don't do anything.
   if (!AnyNonLocal) {
     DEBUG(dbgs() << "CGP: Found      local addrmode: " << AddrMode << "\n");
+    LocalAddrModes.insert(Key);
     return false;
   }
 
@@ -1631,6 +1684,13 @@ bool CodeGenPrepare::OptimizeMemoryInst(Instruction *MemoryInst, Value *Addr,
 
   MemoryInst->replaceUsesOfWith(Repl, SunkAddr);
 
+  // The blocks the address was computed in may now have dead code to clean
+  // up.
+  if (Instruction *ReplInst = dyn_cast<Instruction>(Repl))
+    BlocksToRevisit.insert(ReplInst->getParent());
+  for (unsigned i = 0, e = AddrModeInsts.size(); i != e; ++i)
+    BlocksToRevisit.insert(AddrModeInsts[i]->getParent());
+
   // If we have no uses, recursively delete the value and all dead instructions
   // using it.
   if (Repl->use_empty()) {
@@ -1714,6 +1774,7 @@ bool CodeGenPrepare::MoveExtToFormExtLoad(Instruction *I) {
   // can fold it.
   I->removeFromParent();
   I->insertAfter(LI);
+  BlocksToRevisit.insert(LI->getParent());
   ++NumExtsMoved;
   return true;
 }
@@ -1781,6 +1842,7 @@ bool CodeGenPrepare::OptimizeExtUses(Instruction *I) {
     if (!InsertedTrunc) {
       BasicBlock::iterator InsertPt = UserBB->getFirstInsertionPt();
       InsertedTrunc = new TruncInst(I, Src->getType(), "", InsertPt);
+      BlocksToRevisit.insert(UserBB);
     }
 
     // Replace a use of the {s|z}ext source with a use of the result.
@@ -1794,11 +1856,22 @@ bool CodeGenPrepare::OptimizeExtUses(Instruction *I) {
 
 /// isFormingBranchFromSelectProfitable - Returns true if a SelectInst should be
 /// turned into an explicit branch.
-static bool isFormingBranchFromSelectProfitable(SelectInst *SI) {
-  // FIXME: This should use the same heuristics as IfConversion to determine
-  // whether a select is better represented as a branch.  This requires that
-  // branch probability metadata is preserved for the select, which is not the
-  // case currently.
+static bool isFormingBranchFromSelectProfitable(const TargetLowering *TLI,
+                                                SelectInst *SI) {
+  // Selects that SimplifyCFG formed from a branch keep its weights.  Trust
+  // them when they are there: a branch on a predictable condition costs
+  // nothing, while the select waits for both values and the condition.
+  MDNode *Weights = SI->getMetadata(LLVMContext::MD_prof);
+  if (Weights && Weights->getNumOperands() == 3) {
+    ConstantInt *TrueWeight = dyn_cast<ConstantInt>(Weights->getOperand(1));
+    ConstantInt *FalseWeight = dyn_cast<ConstantInt>(Weights->getOperand(2));
+    if (TrueWeight && FalseWeight) {
+      uint64_t T = TrueWeight->getZExtValue(), F = FalseWeight->getZExtValue();
+      BranchProbability Threshold = TLI->getPredictableBranchThreshold();
+      return std::max(T, F) * Threshold.getDenominator() >
+             (T + F) * Threshold.getNumerator();
+    }
+  }
 
   CmpInst *Cmp = dyn_cast<CmpInst>(SI->getCondition());
 
@@ -1843,7 +1916,7 @@ bool CodeGenPrepare::OptimizeSelectInst(SelectInst *SI) {
     // We have efficient codegen support for the select instruction.
     // Check if it is profitable to keep this 'select'.
     if (!TLI->isPredictableSelectExpensive() ||
-        !isFormingBranchFromSelectProfitable(SI))
+        !isFormingBranchFromSelectProfitable(TLI, SI))
       return false;
   }
 
@@ -1864,7 +1937,10 @@ bool CodeGenPrepare::OptimizeSelectInst(SelectInst *SI) {
   BranchInst::Create(NextBlock, SmallBlock);
 
   // Insert the real conditional branch based on the original condition.
-  BranchInst::Create(NextBlock, SmallBlock, SI->getCondition(), SI);
+  BranchInst *BI =
+      BranchInst::Create(NextBlock, SmallBlock, SI->getCondition(), SI);
+  if (MDNode *Weights = SI->getMetadata(LLVMContext::MD_prof))
+    BI->setMetadata(LLVMContext::MD_prof, Weights);
 
   // The select itself is replaced with a PHI Node.
   PHINode *PN = PHINode::Create(SI->getType(), 2, "", NextBlock->begin());
@@ -1873,6 +1949,12 @@ bool CodeGenPrepare::OptimizeSelectInst(SelectInst *SI) {
   PN->addIncoming(SI->getFalseValue(), SmallBlock);
   SI->replaceAllUsesWith(PN);
   SI->eraseFromParent();
+  revisitUsers(PN);
+
+  // The rest of the block moved to NextBlock, which this round of
+  // OptimizeBlock skips.
+  BlocksToRevisit.insert(SmallBlock);
+  BlocksToRevisit.insert(NextBlock);
 
   // Instruct OptimizeBlock to skip to the next block.
   CurInstIterator = StartBlock->end();
@@ -1887,6 +1969,7 @@ bool CodeGenPrepare::OptimizeInst(Instruction *I) {
     // trivial PHI, go ahead and zap it here.
     if (Value *V = SimplifyInstruction(P, TLI ? TLI->getDataLayout() : 0,
                                        TLInfo, DT)) {
+      revisitUsers(P);
       P->replaceAllUsesWith(V);
       P->eraseFromParent();
       ++NumPHIsElim;
@@ -1905,8 +1988,11 @@ bool CodeGenPrepare::OptimizeInst(Instruction *I) {
     if (isa<Constant>(CI->getOperand(0)))
       return false;
 
-    if (TLI && OptimizeNoopCopyExpression(CI, *TLI))
+    SmallVector<BasicBlock*, 4> SunkInto;
+    if (TLI && OptimizeNoopCopyExpression(CI, *TLI, SunkInto)) {
+      BlocksToRevisit.insert(SunkInto.begin(), SunkInto.end());
       return true;
+    }
 
     if (isa<ZExtInst>(I) || isa<SExtInst>(I)) {
       bool MadeChange = MoveExtToFormExtLoad(I);
@@ -1915,8 +2001,13 @@ bool CodeGenPrepare::OptimizeInst(Instruction *I) {
     return false;
   }
 
-  if (CmpInst *CI = dyn_cast<CmpInst>(I))
-    return OptimizeCmpExpression(CI);
+  if (CmpInst *CI = dyn_cast<CmpInst>(I)) {
+    SmallVector<BasicBlock*, 4> SunkInto;
+    if (!OptimizeCmpExpression(CI, SunkInto))
+      return false;
+    BlocksToRevisit.insert(SunkInto.begin(), SunkInto.end());
+    return true;
+  }
 
   if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
     if (TLI)
@@ -1938,6 +2029,7 @@ bool CodeGenPrepare::OptimizeInst(Instruction *I) {
                                         GEPI->getName(), GEPI);
       GEPI->replaceAllUsesWith(NC);
       GEPI->eraseFromParent();
+      revisitUsers(NC);
       ++NumGEPsElim;
       OptimizeInst(NC);
       return true;
@@ -1959,17 +2051,34 @@ bool CodeGenPrepare::OptimizeInst(Instruction *I) {
 // selection.
 bool CodeGenPrepare::OptimizeBlock(BasicBlock &BB) {
   SunkAddrs.clear();
+  LocalAddrModes.clear();
   bool MadeChange = false;
 
   CurInstIterator = BB.begin();
   while (CurInstIterator != BB.end())
-    MadeChange |= OptimizeInst(CurInstIterator++);
+    if (OptimizeInst(CurInstIterator++)) {
+      LocalAddrModes.clear();
+      MadeChange = true;
+    }
+
+  // A change may have exposed more to do in this block.
+  if (MadeChange)
+    BlocksToRevisit.insert(&BB);
 
   MadeChange |= DupRetToEnableTailCallOpts(&BB);
 
   return MadeChange;
 }
 
+/// revisitUsers - Revisit the blocks of the users of V, which may have more
+/// to do after a change to V.
+void CodeGenPrepare::revisitUsers(Value *V) {
+  for (Value::use_iterator UI = V->use_begin(), E = V->use_end(); UI != E;
+       ++UI)
+    if (Instruction *User = dyn_cast<Instruction>(*UI))
+      BlocksToRevisit.insert(User->getParent());
+}
+
 // llvm.dbg.value is far away from the value then iSel may not be able
 // handle it properly. iSel will drop llvm.dbg.value if it can not
 // find a node corresponding to the value.
@@ -863,16 +863,11 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
 }
 
 namespace {
-  struct CouldAlias {
+  struct IsInSet {
     typedef Value *argument_type;
-    const AliasAnalysis::Location &LoadedLoc;
-    AliasAnalysis *AA;
+    const SmallPtrSet<Value*, 16> &Set;
 
-    bool operator()(Value *I) {
-      // See if the loaded location could alias the stack location.
-      AliasAnalysis::Location StackLoc(I, getPointerSize(I, *AA));
-      return !AA->isNoAlias(StackLoc, LoadedLoc);
-    }
+    bool operator()(Value *I) { return Set.count(I); }
   };
 }
 
@@ -894,7 +889,20 @@ void DSE::RemoveAccessedObjects(const AliasAnalysis::Location &LoadedLoc,
     return;
   }
 
-  // Remove objects that could alias LoadedLoc.
-  CouldAlias Pred = { LoadedLoc, AA };
+  // Remove objects that could alias LoadedLoc.  Ask about all of them in one
+  // batch, so that what is learned about LoadedLoc is reused.
+  SmallVector<AliasAnalysis::Location, 16> StackLocs;
+  for (unsigned i = 0, e = DeadStackObjects.size(); i != e; ++i) {
+    Value *I = DeadStackObjects[i];
+    StackLocs.push_back(AliasAnalysis::Location(I, getPointerSize(I, *AA)));
+  }
+  SmallVector<AliasAnalysis::AliasResult, 16> Results;
+  AA->batchAlias(LoadedLoc, StackLocs, Results);
+
+  SmallPtrSet<Value*, 16> Aliased;
+  for (unsigned i = 0, e = Results.size(); i != e; ++i)
+    if (Results[i] != AliasAnalysis::NoAlias)
+      Aliased.insert(DeadStackObjects[i]);
+  IsInSet Pred = { Aliased };
   DeadStackObjects.remove_if(Pred);
 }
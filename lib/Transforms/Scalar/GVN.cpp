@@ -27,6 +27,7 @@
 #include "llvm/Analysis/CFG.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/InstSimplifyCache.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/Loads.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
@@ -58,6 +59,9 @@ STATISTIC(NumGVNBlocks, "Number of blocks merged");
 STATISTIC(NumGVNSimpl,  "Number of instructions simplified");
 STATISTIC(NumGVNEqProp, "Number of equalities propagated");
 STATISTIC(NumPRELoad,   "Number of loads PRE'd");
+STATISTIC(NumGVNRevisited, "Number of instructions revisited after the walk");
+STATISTIC(NumLoadsNotQueried,
+          "Number of non-local loads skipped because of the query cap");
 
 static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
@@ -68,6 +72,22 @@ static cl::opt<uint32_t>
 MaxRecurseDepth("max-recurse-depth", cl::Hidden, cl::init(1000), cl::ZeroOrMore,
                 cl::desc("Max recurse depth (default = 1000)"));
 
+// Walk the function once, then revisit only what that walk changed, rather
+// than walking the whole function again until nothing changes.
+static cl::opt<bool>
+SingleIteration("gvn-single-iteration", cl::Hidden, cl::init(false),
+                cl::desc("Run GVN as a single walk over the function plus a "
+                         "worklist of changed values"));
+
+// The non-local dependences of a load are expensive to compute on big
+// functions; past this many queries in a function, the remaining non-local
+// loads are left alone.
+static cl::opt<unsigned>
+MaxNonLocalLoadQueries("gvn-max-nonlocal-load-queries", cl::Hidden,
+                       cl::init(5000),
+                       cl::desc("Max number of non-local load dependence "
+                                "queries per function (default = 5000)"));
+
 //===----------------------------------------------------------------------===//
 //                         ValueTable Class
 //===----------------------------------------------------------------------===//
@@ -132,6 +152,7 @@ namespace {
     void setDomTree(DominatorTree* D) { DT = D; }
     uint32_t getNextUnusedValueNumber() { return nextValueNumber; }
     void verifyRemoved(const Value *) const;
+    bool exists(Value *V) const { return valueNumbering.count(V); }
   };
 }
 
@@ -589,15 +610,19 @@ namespace {
     DominatorTree *DT;
     const DataLayout *TD;
     const TargetLibraryInfo *TLI;
+    InstSimplifyCache *SimplifyCache;
     SetVector<BasicBlock *> DeadBlocks;
 
     ValueTable VN;
 
     /// LeaderTable - A mapping from value numbers to lists of Value*'s that
-    /// have that value number.  Use findLeader to query it.
+    /// have that value number.  Use findLeader to query it.  Each entry keeps
+    /// the dominator tree node of its block, so that findLeader tests
+    /// dominance by comparing DFS intervals, without looking blocks up.
     struct LeaderTableEntry {
       Value *Val;
       const BasicBlock *BB;
+      const DomTreeNode *Node;
       LeaderTableEntry *Next;
     };
     DenseMap<uint32_t, LeaderTableEntry> LeaderTable;
@@ -605,6 +630,10 @@ namespace {
 
     SmallVector<Instruction*, 8> InstrsToErase;
 
+    /// NumNonLocalLoadQueries - The number of non-local load dependence
+    /// queries made in the current function.
+    unsigned NumNonLocalLoadQueries;
+
     typedef SmallVector<NonLocalDepResult, 64> LoadDepVect;
     typedef SmallVector<AvailableValueInBlock, 64> AvailValInBlkVect;
     typedef SmallVector<BasicBlock*, 64> UnavailBlkVect;
@@ -637,12 +666,14 @@ namespace {
       if (!Curr.Val) {
         Curr.Val = V;
         Curr.BB = BB;
+        Curr.Node = DT->getNode(const_cast<BasicBlock *>(BB));
         return;
       }
 
       LeaderTableEntry *Node = TableAllocator.Allocate<LeaderTableEntry>();
       Node->Val = V;
       Node->BB = BB;
+      Node->Node = DT->getNode(const_cast<BasicBlock *>(BB));
       Node->Next = Curr.Next;
       Curr.Next = Node;
     }
@@ -653,10 +684,12 @@ namespace {
       LeaderTableEntry* Prev = 0;
       LeaderTableEntry* Curr = &LeaderTable[N];
 
-      while (Curr->Val != I || Curr->BB != BB) {
+      while (Curr && (Curr->Val != I || Curr->BB != BB)) {
         Prev = Curr;
         Curr = Curr->Next;
       }
+      if (!Curr)
+        return;
 
       if (Prev) {
         Prev->Next = Curr->Next;
@@ -664,10 +697,12 @@ namespace {
         if (!Curr->Next) {
           Curr->Val = 0;
           Curr->BB = 0;
+          Curr->Node = 0;
         } else {
           LeaderTableEntry* Next = Curr->Next;
           Curr->Val = Next->Val;
           Curr->BB = Next->BB;
+          Curr->Node = Next->Node;
           Curr->Next = Next->Next;
         }
       }
@@ -703,6 +738,7 @@ namespace {
     bool processBlock(BasicBlock *BB);
     void dump(DenseMap<uint32_t, Value*> &d);
     bool iterateOnFunction(Function &F);
+    bool revisitChangedValues(Function &F);
     bool performPRE(Function &F);
     Value *findLeader(const BasicBlock *BB, uint32_t num);
     void cleanupGlobalSets();
@@ -1697,6 +1733,11 @@ bool GVN::processNonLocalLoad(LoadInst *LI) {
   // Step 1: Find the non-local dependencies of the load.
   LoadDepVect Deps;
   AliasAnalysis::Location Loc = VN.getAliasAnalysis()->getLocation(LI);
+  if (NumNonLocalLoadQueries >= MaxNonLocalLoadQueries) {
+    ++NumLoadsNotQueried;
+    return false;
+  }
+  ++NumNonLocalLoadQueries;
   MD->getNonLocalPointerDependency(Loc, true, LI->getParent(), Deps);
 
   // If we had to process more than one hundred blocks to find the
@@ -1789,7 +1830,9 @@ static void patchReplacementInstruction(Instruction *I, Value *Repl) {
         ReplInst->setMetadata(Kind, MDNode::getMostGenericRange(IMD, ReplMD));
         break;
       case LLVMContext::MD_prof:
-        llvm_unreachable("MD_prof in a non terminator instruction");
+        // The profiled targets of one of two calls say little about the
+        // targets of both.
+        ReplInst->setMetadata(Kind, NULL);
         break;
       case LLVMContext::MD_fpmath:
         ReplInst->setMetadata(Kind, MDNode::getMostGenericFPMath(IMD, ReplMD));
@@ -2000,18 +2043,21 @@ bool GVN::processLoad(LoadInst *L) {
 // question.  This is fast because dominator tree queries consist of only
 // a few comparisons of DFS numbers.
 Value *GVN::findLeader(const BasicBlock *BB, uint32_t num) {
-  LeaderTableEntry Vals = LeaderTable[num];
-  if (!Vals.Val) return 0;
+  DenseMap<uint32_t, LeaderTableEntry>::const_iterator I =
+    LeaderTable.find(num);
+  if (I == LeaderTable.end() || !I->second.Val) return 0;
+  const LeaderTableEntry &Vals = I->second;
+  const DomTreeNode *BBNode = DT->getNode(const_cast<BasicBlock *>(BB));
 
   Value *Val = 0;
-  if (DT->dominates(Vals.BB, BB)) {
+  if (DT->dominates(Vals.Node, BBNode)) {
     Val = Vals.Val;
     if (isa<Constant>(Val)) return Val;
   }
 
   LeaderTableEntry* Next = Vals.Next;
   while (Next) {
-    if (DT->dominates(Next->BB, BB)) {
+    if (DT->dominates(Next->Node, BBNode)) {
       if (isa<Constant>(Next->Val)) return Next->Val;
       if (!Val) Val = Next->Val;
     }
@@ -2202,7 +2248,8 @@ bool GVN::processInstruction(Instruction *I) {
   // to value numbering it.  Value numbering often exposes redundancies, for
   // example if it determines that %y is equal to %x then the instruction
   // "%z = and i32 %x, %y" becomes "%z = and i32 %x, %x" which we now simplify.
-  if (Value *V = SimplifyInstruction(I, TD, TLI, DT)) {
+  if (Value *V = SimplifyCache ? SimplifyCache->simplify(I, TD, TLI, DT)
+                               : SimplifyInstruction(I, TD, TLI, DT)) {
     I->replaceAllUsesWith(V);
     if (MD && V->getType()->getScalarType()->isPointerTy())
       MD->invalidateCachedPointerInfo(V);
@@ -2319,12 +2366,14 @@ bool GVN::runOnFunction(Function& F) {
   DT = &getAnalysis<DominatorTree>();
   TD = getAnalysisIfAvailable<DataLayout>();
   TLI = &getAnalysis<TargetLibraryInfo>();
+  SimplifyCache = getAnalysisIfAvailable<InstSimplifyCache>();
   VN.setAliasAnalysis(&getAnalysis<AliasAnalysis>());
   VN.setMemDep(MD);
   VN.setDomTree(DT);
 
   bool Changed = false;
   bool ShouldContinue = true;
+  NumNonLocalLoadQueries = 0;
 
   // Merge unconditional branches, allowing PRE to catch more
   // optimization opportunities.
@@ -2343,6 +2392,11 @@ bool GVN::runOnFunction(Function& F) {
     ShouldContinue = iterateOnFunction(F);
     Changed |= ShouldContinue;
     ++Iteration;
+    if (SingleIteration) {
+      if (ShouldContinue)
+        Changed |= revisitChangedValues(F);
+      break;
+    }
   }
 
   if (EnablePRE) {
@@ -2647,6 +2701,88 @@ bool GVN::iterateOnFunction(Function &F) {
   return Changed;
 }
 
+/// revisitChangedValues - Stand in for the iterations after the first one.
+/// Those only find more to do where the walk numbered an instruction before
+/// one of its operands was replaced, which a walk in dominator order does
+/// to PHI nodes.  Simplify the PHI nodes again, and renumber whatever uses a
+/// value that changed, transitively, replacing it if it turns out to be
+/// redundant.  Loads are not reconsidered.
+bool GVN::revisitChangedValues(Function &F) {
+  SmallSetVector<Instruction *, 32> Worklist;
+  for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+    if (!DT->isReachableFromEntry(BB) || DeadBlocks.count(BB))
+      continue;
+    for (BasicBlock::iterator I = BB->begin(); isa<PHINode>(I); ++I)
+      Worklist.insert(I);
+  }
+
+  bool Changed = false;
+  SmallPtrSet<Instruction *, 16> Deleted;
+  while (!Worklist.empty()) {
+    Instruction *I = Worklist.pop_back_val();
+    if (Deleted.count(I) || !VN.exists(I))
+      continue;
+    ++NumGVNRevisited;
+
+    Value *Repl = SimplifyCache ? SimplifyCache->simplify(I, TD, TLI, DT)
+                                : SimplifyInstruction(I, TD, TLI, DT);
+    if (Repl) {
+      removeFromLeaderTable(VN.lookup(I), I, I->getParent());
+      ++NumGVNSimpl;
+    } else {
+      if (isa<PHINode>(I) || isa<LoadInst>(I) || isa<AllocaInst>(I) ||
+          isa<TerminatorInst>(I) || I->getType()->isVoidTy())
+        continue;
+
+      uint32_t OldNum = VN.lookup(I);
+      VN.erase(I);
+      uint32_t NextNum = VN.getNextUnusedValueNumber();
+      uint32_t Num = VN.lookup_or_add(I);
+      if (Num == OldNum)
+        continue;
+
+      // A leader in the same block may come after I, which the walk never
+      // has to worry about.
+      removeFromLeaderTable(OldNum, I, I->getParent());
+      if (Num < NextNum) {
+        Repl = findLeader(I->getParent(), Num);
+        if (Instruction *ReplI = dyn_cast_or_null<Instruction>(Repl))
+          if (!DT->dominates(ReplI, I))
+            Repl = 0;
+      }
+      if (!Repl)
+        addToLeaderTable(Num, I, I->getParent());
+    }
+
+    // The users of I are numbered after what I was.
+    for (Value::use_iterator UI = I->use_begin(), UE = I->use_end();
+         UI != UE; ++UI)
+      if (Instruction *User = dyn_cast<Instruction>(*UI))
+        Worklist.insert(User);
+
+    if (!Repl)
+      continue;
+    DEBUG(dbgs() << "GVN revisited: " << *I << '\n');
+    patchAndReplaceAllUsesWith(I, Repl);
+    if (MD && Repl->getType()->getScalarType()->isPointerTy())
+      MD->invalidateCachedPointerInfo(Repl);
+    markInstructionForDeletion(I);
+    Deleted.insert(I);
+    Changed = true;
+  }
+
+  NumGVNInstr += InstrsToErase.size();
+  for (SmallVectorImpl<Instruction *>::iterator I = InstrsToErase.begin(),
+       E = InstrsToErase.end(); I != E; ++I) {
+    DEBUG(dbgs() << "GVN removed: " << **I << '\n');
+    if (MD) MD->removeInstruction(*I);
+    DEBUG(verifyRemoved(*I));
+    (*I)->eraseFromParent();
+  }
+  InstrsToErase.clear();
+  return Changed;
+}
+
 void GVN::cleanupGlobalSets() {
   VN.clear();
   LeaderTable.clear();
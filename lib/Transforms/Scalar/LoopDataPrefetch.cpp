@@ -0,0 +1,222 @@
+//===-- LoopDataPrefetch.cpp - Loop Data Prefetching Pass -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a Loop Data Prefetching Pass. It looks for loads and
+// stores in innermost loops whose addresses advance by a constant stride of at
+// least a cache line per iteration, a pattern the hardware prefetchers
+// usually fail to follow, and inserts an llvm.prefetch of the address the
+// access will use a few iterations later. The number of iterations to look
+// ahead is the cache miss latency divided by the size of the loop body.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "loop-data-prefetch"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/CodeMetrics.h"
+#include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+using namespace llvm;
+
+STATISTIC(NumPrefetches, "Number of prefetches inserted");
+
+static cl::opt<unsigned>
+PrefetchCacheLineSize("prefetch-cache-line-size", cl::init(0), cl::Hidden,
+                      cl::desc("Override the target's cache line size, in "
+                               "bytes, for loop data prefetching"));
+
+static cl::opt<unsigned>
+PrefetchMissLatency("prefetch-miss-latency", cl::init(0), cl::Hidden,
+                    cl::desc("Override the target's cache miss latency, in "
+                             "cycles, for loop data prefetching"));
+
+static cl::opt<unsigned>
+MinPrefetchStride("min-prefetch-stride", cl::init(0), cl::Hidden,
+                  cl::desc("Only prefetch accesses whose stride is at least "
+                           "this many bytes (zero means one cache line)"));
+
+static cl::opt<unsigned>
+MaxPrefetchIterationsAhead("max-prefetch-iterations-ahead", cl::init(64),
+                           cl::Hidden,
+                           cl::desc("Never prefetch further ahead than this "
+                                    "many loop iterations"));
+
+namespace {
+  class LoopDataPrefetch : public LoopPass {
+  public:
+    static char ID; // Pass ID, replacement for typeid
+    LoopDataPrefetch() : LoopPass(ID) {
+      initializeLoopDataPrefetchPass(*PassRegistry::getPassRegistry());
+    }
+
+    bool runOnLoop(Loop *L, LPPassManager &LPM);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.addRequired<LoopInfo>();
+      AU.addRequired<ScalarEvolution>();
+      AU.addRequired<TargetTransformInfo>();
+      AU.addRequiredID(LoopSimplifyID);
+
+      AU.addPreserved<LoopInfo>();
+      AU.addPreserved<ScalarEvolution>();
+      AU.addPreservedID(LoopSimplifyID);
+      AU.addPreservedID(LCSSAID);
+    }
+
+  private:
+    bool isAlreadyCovered(const SCEVAddRecExpr *AR,
+                          ArrayRef<const SCEVAddRecExpr *> Prefetched,
+                          unsigned CacheLineSize);
+
+    ScalarEvolution *SE;
+  };
+}
+
+char LoopDataPrefetch::ID = 0;
+INITIALIZE_PASS_BEGIN(LoopDataPrefetch, "loop-data-prefetch",
+                "Loop Data Prefetch", false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_AG_DEPENDENCY(TargetTransformInfo)
+INITIALIZE_PASS_END(LoopDataPrefetch, "loop-data-prefetch",
+                "Loop Data Prefetch", false, false)
+
+Pass *llvm::createLoopDataPrefetchPass() { return new LoopDataPrefetch(); }
+
+/// isAlreadyCovered - Return true if AR is a constant distance of less than a
+/// cache line away from an address stream we already prefetch.
+bool LoopDataPrefetch::isAlreadyCovered(
+    const SCEVAddRecExpr *AR, ArrayRef<const SCEVAddRecExpr *> Prefetched,
+    unsigned CacheLineSize) {
+  for (unsigned i = 0, e = Prefetched.size(); i != e; ++i) {
+    if (Prefetched[i]->getType() != AR->getType())
+      continue;
+    const SCEVConstant *Diff =
+      dyn_cast<SCEVConstant>(SE->getMinusSCEV(AR, Prefetched[i]));
+    if (Diff && Diff->getValue()->getValue().abs().ult(CacheLineSize))
+      return true;
+  }
+  return false;
+}
+
+bool LoopDataPrefetch::runOnLoop(Loop *L, LPPassManager &LPM) {
+  // Only the innermost loops run long enough for the prefetch to pay off.
+  if (!L->empty())
+    return false;
+
+  const TargetTransformInfo &TTI = getAnalysis<TargetTransformInfo>();
+  SE = &getAnalysis<ScalarEvolution>();
+
+  unsigned CacheLineSize = PrefetchCacheLineSize.getNumOccurrences() ?
+    PrefetchCacheLineSize : TTI.getCacheLineSize();
+  unsigned MissLatency = PrefetchMissLatency.getNumOccurrences() ?
+    PrefetchMissLatency : TTI.getCacheMissLatency();
+  if (!CacheLineSize || !MissLatency)
+    return false;
+  unsigned MinStride = MinPrefetchStride ? MinPrefetchStride : CacheLineSize;
+
+  // Estimate how many iterations run while one miss is outstanding, assuming
+  // one instruction per cycle.
+  CodeMetrics Metrics;
+  for (Loop::block_iterator I = L->block_begin(), E = L->block_end();
+       I != E; ++I)
+    Metrics.analyzeBasicBlock(*I, TTI);
+  unsigned LoopSize = std::max(Metrics.NumInsts, 1U);
+  unsigned ItersAhead = (MissLatency + LoopSize - 1) / LoopSize;
+  ItersAhead = std::min(ItersAhead, (unsigned)MaxPrefetchIterationsAhead);
+  if (!ItersAhead)
+    return false;
+
+  DEBUG(dbgs() << "LDP: Loop of " << LoopSize << " instructions, prefetching "
+        << ItersAhead << " iterations ahead\n");
+
+  Module *M = L->getHeader()->getParent()->getParent();
+  SmallVector<const SCEVAddRecExpr *, 16> Prefetched;
+  bool Changed = false;
+  for (Loop::block_iterator I = L->block_begin(), E = L->block_end();
+       I != E; ++I) {
+    for (BasicBlock::iterator J = (*I)->begin(), JE = (*I)->end();
+         J != JE; ++J) {
+      Instruction *MemI = J;
+      Value *PtrValue;
+      bool IsWrite;
+      if (LoadInst *LI = dyn_cast<LoadInst>(MemI)) {
+        if (LI->isVolatile())
+          continue;
+        PtrValue = LI->getPointerOperand();
+        IsWrite = false;
+      } else if (StoreInst *SI = dyn_cast<StoreInst>(MemI)) {
+        if (SI->isVolatile())
+          continue;
+        PtrValue = SI->getPointerOperand();
+        IsWrite = true;
+      } else
+        continue;
+
+      // Only affine address streams of this loop can be prefetched.
+      const SCEVAddRecExpr *AR =
+        dyn_cast<SCEVAddRecExpr>(SE->getSCEV(PtrValue));
+      if (!AR || AR->getLoop() != L || !AR->isAffine())
+        continue;
+
+      const SCEVConstant *Step =
+        dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+      if (!Step || Step->getValue()->getValue().abs().ult(MinStride))
+        continue;
+
+      if (isAlreadyCovered(AR, Prefetched, CacheLineSize))
+        continue;
+
+      // The address this access uses ItersAhead iterations from now.
+      const SCEV *NextAddr = SE->getAddExpr(AR, SE->getMulExpr(
+        SE->getConstant(Step->getType(), ItersAhead), Step));
+      if (!isSafeToExpand(NextAddr, *SE))
+        continue;
+
+      Prefetched.push_back(AR);
+
+      unsigned AS = PtrValue->getType()->getPointerAddressSpace();
+      Type *I8Ptr = Type::getInt8PtrTy(MemI->getContext(), AS);
+      SCEVExpander Expander(*SE, "prefaddr");
+      Value *PrefPtr = Expander.expandCodeFor(NextAddr, I8Ptr, MemI);
+
+      IRBuilder<> Builder(MemI);
+      Type *I32 = Type::getInt32Ty(MemI->getContext());
+      Value *PrefetchFunc = Intrinsic::getDeclaration(M, Intrinsic::prefetch);
+      Value *Args[] = {
+        PrefPtr,
+        ConstantInt::get(I32, IsWrite), // read or write
+        ConstantInt::get(I32, 3),       // temporal locality
+        ConstantInt::get(I32, 1)        // data cache
+      };
+      Builder.CreateCall(PrefetchFunc, Args);
+
+      DEBUG(dbgs() << "LDP: Prefetching " << *NextAddr << " for " << *MemI
+            << '\n');
+      ++NumPrefetches;
+      Changed = true;
+    }
+  }
+
+  return Changed;
+}
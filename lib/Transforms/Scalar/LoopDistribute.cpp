@@ -0,0 +1,556 @@
+//===- LoopDistribute.cpp - Loop Distribution Pass ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Loop Distribution Pass. It splits an innermost
+// loop into a sequence of loops, each executing a subset of the original
+// body, so that a recurrence that stops the loop vectorizer no longer stops
+// the rest of the body from being vectorized:
+//
+//   for (i = 0; i < n; ++i) {        for (i = 0; i < n; ++i)
+//     A[i + 1] = A[i] * B[i];   =>     A[i + 1] = A[i] * B[i];
+//     C[i] = D[i] + E[i];            for (i = 0; i < n; ++i)
+//   }                                  C[i] = D[i] + E[i];
+//
+// The body is partitioned by the strongly connected components of a graph
+// whose edges are the SSA def-use chains and the memory dependences reported
+// by DependenceAnalysis. A component is unsafe to vectorize if it contains a
+// cycle other than an induction or a simple reduction. Partitions only communicate through
+// memory, so components joined by a def-use chain are kept together, and
+// adjacent components of the same kind are merged. The loop is only
+// distributed when this separates unsafe components from safe ones that
+// access memory. The instructions computing the exit condition are replicated
+// in every new loop.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "loop-distribute"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <algorithm>
+using namespace llvm;
+
+STATISTIC(NumLoopsDistributed, "Number of loops distributed");
+STATISTIC(NumLoopsCreated, "Number of loops created by distribution");
+
+/// We don't query the dependences of loops with more memory accesses than
+/// this, as the number of queries is quadratic.
+static const unsigned MaxMemoryAccesses = 32;
+
+namespace {
+  /// A set of instructions of the loop body that will form one new loop.
+  struct Partition {
+    Partition() : Unsafe(false), HasMemoryAccess(false) {}
+
+    SmallVector<Instruction *, 8> Insts;
+    /// Contains a cycle other than a simple reduction.
+    bool Unsafe;
+    bool HasMemoryAccess;
+  };
+
+  typedef SmallVector<SmallVector<unsigned, 4>, 32> SuccessorLists;
+  typedef SmallVector<SmallVector<unsigned, 8>, 16> ComponentList;
+
+  /// The dependence graph of the loop body.
+  class DependenceGraph {
+  public:
+    unsigned addNode(Instruction *I) {
+      Index[I] = Nodes.size();
+      Nodes.push_back(I);
+      Succs.resize(Nodes.size());
+      return Nodes.size() - 1;
+    }
+
+    bool hasNode(Value *V) const { return Index.count(V); }
+    unsigned getNode(Value *V) const { return Index.lookup(V); }
+    Instruction *getInst(unsigned N) const { return Nodes[N]; }
+    unsigned size() const { return Nodes.size(); }
+
+    void addEdge(unsigned From, unsigned To) { Succs[From].push_back(To); }
+    const SuccessorLists &getSuccessors() const { return Succs; }
+
+  private:
+    SmallVector<Instruction *, 32> Nodes;
+    DenseMap<Value *, unsigned> Index;
+    SuccessorLists Succs;
+  };
+
+  /// Tarjan's algorithm for the strongly connected components of a graph
+  /// given by its successor lists.
+  class SCCFinder {
+  public:
+    explicit SCCFinder(const SuccessorLists &Succs) : Succs(Succs) {}
+
+    /// Computes the components in topological order.
+    void run(ComponentList &SCCs);
+
+  private:
+    void visit(unsigned N, ComponentList &SCCs);
+
+    const SuccessorLists &Succs;
+    SmallVector<unsigned, 32> DFSNum, LowLink, Stack;
+    SmallVector<bool, 32> OnStack;
+    unsigned NextDFSNum;
+  };
+
+  class LoopDistribute : public LoopPass {
+  public:
+    static char ID; // Pass ID, replacement for typeid
+    LoopDistribute() : LoopPass(ID) {
+      initializeLoopDistributePass(*PassRegistry::getPassRegistry());
+    }
+
+    bool runOnLoop(Loop *L, LPPassManager &LPM);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.addRequired<DominatorTree>();
+      AU.addRequired<LoopInfo>();
+      AU.addRequired<ScalarEvolution>();
+      AU.addRequired<DependenceAnalysis>();
+      AU.addRequiredID(LoopSimplifyID);
+      AU.addRequiredID(LCSSAID);
+
+      AU.addPreserved<DependenceAnalysis>();
+      AU.addPreserved<DominatorTree>();
+      AU.addPreserved<LoopInfo>();
+      AU.addPreserved<ScalarEvolution>();
+      AU.addPreservedID(LoopSimplifyID);
+      AU.addPreservedID(LCSSAID);
+    }
+
+  private:
+    bool buildGraph(Loop *L, DependenceGraph &G);
+    void distribute(Loop *L, ArrayRef<Partition> Parts, LPPassManager &LPM);
+
+    /// The instructions computing the exit condition. They are replicated in
+    /// every new loop.
+    SmallPtrSet<Instruction *, 8> Control;
+
+    DominatorTree *DT;
+    LoopInfo *LI;
+    ScalarEvolution *SE;
+    DependenceAnalysis *DA;
+  };
+}
+
+void SCCFinder::run(ComponentList &SCCs) {
+  DFSNum.assign(Succs.size(), 0);
+  LowLink.assign(Succs.size(), 0);
+  OnStack.assign(Succs.size(), false);
+  Stack.clear();
+  NextDFSNum = 1;
+  for (unsigned N = 0, E = Succs.size(); N != E; ++N)
+    if (!DFSNum[N])
+      visit(N, SCCs);
+
+  // Tarjan's algorithm finds the components in reverse topological order.
+  std::reverse(SCCs.begin(), SCCs.end());
+}
+
+void SCCFinder::visit(unsigned N, ComponentList &SCCs) {
+  DFSNum[N] = LowLink[N] = NextDFSNum++;
+  Stack.push_back(N);
+  OnStack[N] = true;
+
+  for (unsigned i = 0, e = Succs[N].size(); i != e; ++i) {
+    unsigned S = Succs[N][i];
+    if (!DFSNum[S]) {
+      visit(S, SCCs);
+      LowLink[N] = std::min(LowLink[N], LowLink[S]);
+    } else if (OnStack[S])
+      LowLink[N] = std::min(LowLink[N], DFSNum[S]);
+  }
+
+  if (LowLink[N] != DFSNum[N])
+    return;
+
+  SCCs.push_back(SmallVector<unsigned, 8>());
+  unsigned M;
+  do {
+    M = Stack.pop_back_val();
+    OnStack[M] = false;
+    SCCs.back().push_back(M);
+  } while (M != N);
+}
+
+char LoopDistribute::ID = 0;
+INITIALIZE_PASS_BEGIN(LoopDistribute, "loop-distribute",
+                "Distribute loops", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTree)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LCSSA)
+INITIALIZE_PASS_END(LoopDistribute, "loop-distribute",
+                "Distribute loops", false, false)
+
+Pass *llvm::createLoopDistributePass() { return new LoopDistribute(); }
+
+/// isSimpleReduction - Return true if the component SCC is a PHI updated by
+/// a chain of one associative and commutative operation, which the loop
+/// vectorizer handles as a reduction.
+static bool isSimpleReduction(const DependenceGraph &G,
+                              ArrayRef<unsigned> SCC) {
+  unsigned NumPHIs = 0;
+  unsigned Opcode = 0;
+  for (unsigned i = 0, e = SCC.size(); i != e; ++i) {
+    Instruction *I = G.getInst(SCC[i]);
+    if (isa<PHINode>(I)) {
+      ++NumPHIs;
+      continue;
+    }
+    if (!isa<BinaryOperator>(I) || !I->isAssociative() ||
+        !I->isCommutative())
+      return false;
+    if (Opcode && I->getOpcode() != Opcode)
+      return false;
+    Opcode = I->getOpcode();
+  }
+  return NumPHIs == 1 && Opcode;
+}
+
+/// isInduction - Return true if the component SCC is a PHI that steps by a
+/// constant every iteration of L, together with its update.
+static bool isInduction(const DependenceGraph &G, ArrayRef<unsigned> SCC,
+                        Loop *L, ScalarEvolution *SE) {
+  PHINode *PN = 0;
+  for (unsigned i = 0, e = SCC.size(); i != e; ++i) {
+    Instruction *I = G.getInst(SCC[i]);
+    if (!isa<PHINode>(I))
+      continue;
+    if (PN)
+      return false;
+    PN = cast<PHINode>(I);
+  }
+  if (!PN || !SE->isSCEVable(PN->getType()))
+    return false;
+  const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(PN));
+  return AR && AR->getLoop() == L && AR->isAffine() &&
+         isa<SCEVConstant>(AR->getStepRecurrence(*SE));
+}
+
+/// findLeader - Return the representative of X in the union-find forest
+/// Leader, compressing the path to it.
+static unsigned findLeader(SmallVectorImpl<unsigned> &Leader, unsigned X) {
+  while (Leader[X] != X)
+    X = Leader[X] = Leader[Leader[X]];
+  return X;
+}
+
+/// buildGraph - Add the instructions of the body of L to G, with the edges
+/// they depend on. Returns false if the body contains something we cannot
+/// distribute.
+bool LoopDistribute::buildGraph(Loop *L, DependenceGraph &G) {
+  BasicBlock *Header = L->getHeader();
+  BranchInst *BI = cast<BranchInst>(Header->getTerminator());
+
+  // Find the backward slice of the exit condition.
+  Control.clear();
+  SmallVector<Instruction *, 8> Worklist;
+  if (Instruction *Cond = dyn_cast<Instruction>(BI->getCondition()))
+    Worklist.push_back(Cond);
+  while (!Worklist.empty()) {
+    Instruction *I = Worklist.pop_back_val();
+    if (I->getParent() != Header || !Control.insert(I))
+      continue;
+    if (I->mayReadOrWriteMemory() || I->mayHaveSideEffects())
+      return false;
+    for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+         ++OI)
+      if (Instruction *Op = dyn_cast<Instruction>(*OI))
+        Worklist.push_back(Op);
+  }
+
+  SmallVector<unsigned, 16> MemAccesses;
+  for (BasicBlock::iterator I = Header->begin(), E = Header->end();
+       I != E; ++I) {
+    if (&*I == BI || Control.count(I) || isa<DbgInfoIntrinsic>(I))
+      continue;
+
+    if (LoadInst *Ld = dyn_cast<LoadInst>(I)) {
+      if (!Ld->isSimple())
+        return false;
+      MemAccesses.push_back(G.addNode(I));
+    } else if (StoreInst *St = dyn_cast<StoreInst>(I)) {
+      if (!St->isSimple())
+        return false;
+      MemAccesses.push_back(G.addNode(I));
+    } else if (I->mayReadOrWriteMemory() || I->mayHaveSideEffects()) {
+      return false;
+    } else
+      G.addNode(I);
+  }
+
+  if (MemAccesses.size() > MaxMemoryAccesses)
+    return false;
+
+  // Def-use edges.
+  for (unsigned N = 0, E = G.size(); N != E; ++N) {
+    Instruction *I = G.getInst(N);
+    for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+         ++OI)
+      if (G.hasNode(*OI))
+        G.addEdge(G.getNode(*OI), N);
+  }
+
+  // Memory dependence edges. A dependence whose direction at this loop's
+  // level may be '>' runs from a later iteration of the earlier access back
+  // to the later access, so it ties both into one component.
+  unsigned Level = L->getLoopDepth();
+  for (unsigned i = 0, e = MemAccesses.size(); i != e; ++i) {
+    Instruction *Src = G.getInst(MemAccesses[i]);
+    for (unsigned j = i + 1; j != e; ++j) {
+      Instruction *Dst = G.getInst(MemAccesses[j]);
+      if (isa<LoadInst>(Src) && isa<LoadInst>(Dst))
+        continue;
+      OwningPtr<Dependence> D(DA->depends(Src, Dst, true));
+      if (!D)
+        continue;
+      G.addEdge(MemAccesses[i], MemAccesses[j]);
+      if (D->isConfused() || D->getLevels() < Level ||
+          (D->getDirection(Level) & Dependence::DVEntry::GT))
+        G.addEdge(MemAccesses[j], MemAccesses[i]);
+    }
+  }
+  return true;
+}
+
+bool LoopDistribute::runOnLoop(Loop *L, LPPassManager &LPM) {
+  // Only innermost loops made of a single block are handled.
+  if (!L->empty() || L->getNumBlocks() != 1)
+    return false;
+  BasicBlock *Header = L->getHeader();
+  if (!L->getLoopPreheader() || !L->getExitBlock())
+    return false;
+  BranchInst *BI = dyn_cast<BranchInst>(Header->getTerminator());
+  if (!BI || !BI->isConditional())
+    return false;
+
+  DT = &getAnalysis<DominatorTree>();
+  LI = &getAnalysis<LoopInfo>();
+  SE = &getAnalysis<ScalarEvolution>();
+  DA = &getAnalysis<DependenceAnalysis>();
+
+  DependenceGraph G;
+  if (!buildGraph(L, G))
+    return false;
+
+  // Find the recurrences of the body.
+  ComponentList SCCs;
+  SCCFinder(G.getSuccessors()).run(SCCs);
+  SmallVector<unsigned, 32> SCCOf(G.size());
+  SmallVector<bool, 16> SCCUnsafe;
+  for (unsigned i = 0, e = SCCs.size(); i != e; ++i) {
+    ArrayRef<unsigned> SCC = SCCs[i];
+    bool Cyclic = SCC.size() > 1;
+    ArrayRef<unsigned> Succs = G.getSuccessors()[SCC[0]];
+    Cyclic |= std::find(Succs.begin(), Succs.end(), SCC[0]) != Succs.end();
+    SCCUnsafe.push_back(Cyclic && !isSimpleReduction(G, SCC) &&
+                        !isInduction(G, SCC, L, SE));
+    for (unsigned j = 0, je = SCC.size(); j != je; ++j)
+      SCCOf[SCC[j]] = i;
+  }
+
+  // Values only pass from one loop to the next through memory, so components
+  // joined by a def-use chain have to stay together.
+  SmallVector<unsigned, 16> Leader(SCCs.size());
+  for (unsigned i = 0, e = SCCs.size(); i != e; ++i)
+    Leader[i] = i;
+  for (unsigned N = 0, E = G.size(); N != E; ++N) {
+    Instruction *I = G.getInst(N);
+    for (User::op_iterator OI = I->op_begin(), OE = I->op_end(); OI != OE;
+         ++OI)
+      if (G.hasNode(*OI))
+        Leader[findLeader(Leader, SCCOf[G.getNode(*OI)])] =
+          findLeader(Leader, SCCOf[N]);
+  }
+
+  SmallVector<unsigned, 16> GroupOf(SCCs.size(), ~0U);
+  SmallVector<bool, 16> GroupUnsafe;
+  for (unsigned i = 0, e = SCCs.size(); i != e; ++i) {
+    unsigned Root = findLeader(Leader, i);
+    if (GroupOf[Root] == ~0U) {
+      GroupOf[Root] = GroupUnsafe.size();
+      GroupUnsafe.push_back(false);
+    }
+    GroupOf[i] = GroupOf[Root];
+    GroupUnsafe[GroupOf[i]] = GroupUnsafe[GroupOf[i]] || SCCUnsafe[i];
+  }
+
+  // Joining components may have closed new cycles between the groups, so
+  // order the groups by their own components.
+  SuccessorLists GroupSuccs(GroupUnsafe.size());
+  for (unsigned N = 0, E = G.size(); N != E; ++N) {
+    ArrayRef<unsigned> Succs = G.getSuccessors()[N];
+    for (unsigned i = 0, e = Succs.size(); i != e; ++i)
+      if (GroupOf[SCCOf[N]] != GroupOf[SCCOf[Succs[i]]])
+        GroupSuccs[GroupOf[SCCOf[N]]].push_back(GroupOf[SCCOf[Succs[i]]]);
+  }
+  ComponentList Clusters;
+  SCCFinder(GroupSuccs).run(Clusters);
+
+  // Form the partitions, merging adjacent clusters of the same kind.
+  SmallVector<Partition, 4> Parts;
+  SmallVector<unsigned, 16> PartOfGroup(GroupUnsafe.size());
+  for (unsigned i = 0, e = Clusters.size(); i != e; ++i) {
+    bool Unsafe = false;
+    for (unsigned j = 0, je = Clusters[i].size(); j != je; ++j)
+      Unsafe |= GroupUnsafe[Clusters[i][j]];
+    if (Parts.empty() || Parts.back().Unsafe != Unsafe) {
+      Parts.push_back(Partition());
+      Parts.back().Unsafe = Unsafe;
+    }
+    for (unsigned j = 0, je = Clusters[i].size(); j != je; ++j)
+      PartOfGroup[Clusters[i][j]] = Parts.size() - 1;
+  }
+
+  SmallVector<unsigned, 32> PartOf(G.size());
+  for (unsigned N = 0, E = G.size(); N != E; ++N) {
+    Instruction *I = G.getInst(N);
+    PartOf[N] = PartOfGroup[GroupOf[SCCOf[N]]];
+    Parts[PartOf[N]].Insts.push_back(I);
+    Parts[PartOf[N]].HasMemoryAccess |= isa<LoadInst>(I) || isa<StoreInst>(I);
+  }
+
+  // Distribution pays off when it isolates a recurrence from memory accesses
+  // that can then be vectorized.
+  bool HasUnsafe = false, HasSafeMemoryAccess = false;
+  for (unsigned i = 0, e = Parts.size(); i != e; ++i) {
+    HasUnsafe |= Parts[i].Unsafe;
+    HasSafeMemoryAccess |= !Parts[i].Unsafe && Parts[i].HasMemoryAccess;
+  }
+  if (!HasUnsafe || !HasSafeMemoryAccess)
+    return false;
+
+  // Only the last loop may define values used after it.
+  for (unsigned N = 0, E = G.size(); N != E; ++N) {
+    if (PartOf[N] + 1 == Parts.size())
+      continue;
+    Instruction *I = G.getInst(N);
+    for (Value::use_iterator UI = I->use_begin(), UE = I->use_end();
+         UI != UE; ++UI)
+      if (cast<Instruction>(*UI)->getParent() != Header)
+        return false;
+  }
+
+  DEBUG(dbgs() << "LDist: Distributing loop in "
+        << Header->getParent()->getName() << " into " << Parts.size()
+        << " loops\n");
+  distribute(L, Parts, LPM);
+  ++NumLoopsDistributed;
+  NumLoopsCreated += Parts.size() - 1;
+  return true;
+}
+
+/// eraseInstructions - Erase the instructions of Header that are not in
+/// Keep, the control instructions or the terminator.
+static void eraseInstructions(BasicBlock *Header,
+                              const SmallPtrSet<Instruction *, 32> &Keep) {
+  SmallVector<Instruction *, 32> Dead;
+  for (BasicBlock::iterator I = Header->begin(), E = Header->end();
+       I != E; ++I)
+    if (!Keep.count(I) && !isa<TerminatorInst>(I))
+      Dead.push_back(I);
+
+  for (unsigned i = 0, e = Dead.size(); i != e; ++i)
+    Dead[i]->replaceAllUsesWith(UndefValue::get(Dead[i]->getType()));
+  for (unsigned i = 0, e = Dead.size(); i != e; ++i)
+    Dead[i]->eraseFromParent();
+}
+
+/// distribute - Place a copy of L, keeping only the instructions of the
+/// partition and the control instructions, in front of L for every partition
+/// but the last one, which L keeps.
+void LoopDistribute::distribute(Loop *L, ArrayRef<Partition> Parts,
+                                LPPassManager &LPM) {
+  SE->forgetLoop(L);
+
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Preheader = L->getLoopPreheader();
+  BasicBlock *ExitBlock = L->getExitBlock();
+  Function *F = Header->getParent();
+  Loop *ParentLoop = L->getParentLoop();
+
+  BasicBlock *Pred = Preheader;
+  for (unsigned P = 0, PE = Parts.size() - 1; P != PE; ++P) {
+    ValueToValueMapTy VMap;
+    BasicBlock *NewHeader = CloneBasicBlock(Header, VMap, ".ldist", F);
+    NewHeader->moveBefore(Header);
+    VMap[Header] = NewHeader;
+    for (BasicBlock::iterator I = NewHeader->begin(), E = NewHeader->end();
+         I != E; ++I)
+      RemapInstruction(I, VMap,
+                       RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
+
+    SmallPtrSet<Instruction *, 32> Keep;
+    for (SmallPtrSet<Instruction *, 8>::iterator I = Control.begin(),
+           E = Control.end(); I != E; ++I)
+      Keep.insert(cast<Instruction>(VMap[*I]));
+    for (unsigned i = 0, e = Parts[P].Insts.size(); i != e; ++i)
+      Keep.insert(cast<Instruction>(VMap[Parts[P].Insts[i]]));
+    eraseInstructions(NewHeader, Keep);
+
+    // Enter the new loop from Pred and leave it for a new preheader of the
+    // next one.
+    for (BasicBlock::iterator I = NewHeader->begin(); isa<PHINode>(I); ++I) {
+      PHINode *PN = cast<PHINode>(I);
+      PN->setIncomingBlock(PN->getBasicBlockIndex(Preheader), Pred);
+    }
+    Pred->getTerminator()->replaceUsesOfWith(Header, NewHeader);
+
+    BasicBlock *NewPreheader =
+      BasicBlock::Create(F->getContext(), "ldist.ph", F, Header);
+    BranchInst::Create(Header, NewPreheader);
+    NewHeader->getTerminator()->replaceUsesOfWith(ExitBlock, NewPreheader);
+
+    Loop *NewLoop = new Loop();
+    LPM.insertLoop(NewLoop, ParentLoop);
+    NewLoop->addBasicBlockToLoop(NewHeader, LI->getBase());
+    if (ParentLoop)
+      ParentLoop->addBasicBlockToLoop(NewPreheader, LI->getBase());
+
+    DT->addNewBlock(NewHeader, Pred);
+    DT->addNewBlock(NewPreheader, NewHeader);
+    Pred = NewPreheader;
+  }
+
+  // The original loop runs the last partition.
+  for (BasicBlock::iterator I = Header->begin(); isa<PHINode>(I); ++I) {
+    PHINode *PN = cast<PHINode>(I);
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Preheader), Pred);
+  }
+  DT->changeImmediateDominator(Header, Pred);
+
+  SmallPtrSet<Instruction *, 32> Keep;
+  for (SmallPtrSet<Instruction *, 8>::iterator I = Control.begin(),
+         E = Control.end(); I != E; ++I)
+    Keep.insert(*I);
+  for (unsigned i = 0, e = Parts.back().Insts.size(); i != e; ++i)
+    Keep.insert(Parts.back().Insts[i]);
+  for (BasicBlock::iterator I = Header->begin(), E = Header->end();
+       I != E; ++I)
+    if (isa<DbgInfoIntrinsic>(I))
+      Keep.insert(I);
+  eraseInstructions(Header, Keep);
+}
@@ -0,0 +1,282 @@
+//===- LoopFusion.cpp - Loop Fusion Pass ----------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Loop Fusion Pass. It merges an innermost loop with
+// the loop that immediately follows it when both run the same number of
+// iterations, so that data produced by the first loop is consumed while it is
+// still in cache:
+//
+//   for (i = 0; i < n; ++i)          for (i = 0; i < n; ++i) {
+//     B[i] = A[i] * 2;          =>     B[i] = A[i] * 2;
+//   for (i = 0; i < n; ++i)            C[i] = B[i] + 1;
+//     C[i] = B[i] + 1;               }
+//
+// Both loops must be single blocks, the exit block of the first one must be
+// the empty preheader of the second one, and the first loop may not define
+// values used after it. Fusion is legal when no iteration of the second loop
+// accesses memory that a later iteration of the first loop writes, or writes
+// memory that a later iteration of the first loop accesses. Pairs of accesses
+// that DependenceAnalysis proves independent are skipped; for the others the
+// addresses have to be affine recurrences with the same constant step that
+// are a constant distance apart.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "loop-fusion"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/Local.h"
+using namespace llvm;
+
+STATISTIC(NumLoopsFused, "Number of loops fused");
+
+namespace {
+  class LoopFusion : public LoopPass {
+  public:
+    static char ID; // Pass ID, replacement for typeid
+    LoopFusion() : LoopPass(ID) {
+      initializeLoopFusionPass(*PassRegistry::getPassRegistry());
+    }
+
+    bool runOnLoop(Loop *L, LPPassManager &LPM);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.addRequired<DominatorTree>();
+      AU.addRequired<LoopInfo>();
+      AU.addRequired<ScalarEvolution>();
+      AU.addRequired<DependenceAnalysis>();
+      AU.addRequiredID(LoopSimplifyID);
+      AU.addRequiredID(LCSSAID);
+
+      AU.addPreserved<DependenceAnalysis>();
+      AU.addPreserved<DominatorTree>();
+      AU.addPreserved<LoopInfo>();
+      AU.addPreserved<ScalarEvolution>();
+      AU.addPreservedID(LoopSimplifyID);
+      AU.addPreservedID(LCSSAID);
+    }
+
+  private:
+    Loop *getFusionCandidate(Loop *L);
+    bool collectMemoryAccesses(Loop *L, SmallVectorImpl<Instruction *> &Accs);
+    bool canFuseAccesses(Instruction *First, Instruction *Second);
+    void fuse(Loop *L1, Loop *L2, LPPassManager &LPM);
+
+    DominatorTree *DT;
+    LoopInfo *LI;
+    ScalarEvolution *SE;
+    DependenceAnalysis *DA;
+    DataLayout *DL;
+  };
+}
+
+char LoopFusion::ID = 0;
+INITIALIZE_PASS_BEGIN(LoopFusion, "loop-fusion", "Fuse adjacent loops",
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTree)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LCSSA)
+INITIALIZE_PASS_END(LoopFusion, "loop-fusion", "Fuse adjacent loops",
+                    false, false)
+
+Pass *llvm::createLoopFusionPass() { return new LoopFusion(); }
+
+/// isSimpleLoop - Return true if L is an innermost loop made of one block
+/// with a preheader and a single exit block.
+static bool isSimpleLoop(Loop *L) {
+  if (!L->empty() || L->getNumBlocks() != 1)
+    return false;
+  if (!L->getLoopPreheader() || !L->getExitBlock())
+    return false;
+  BranchInst *BI = dyn_cast<BranchInst>(L->getHeader()->getTerminator());
+  return BI && BI->isConditional();
+}
+
+/// getFusionCandidate - Return the loop that L can be fused with, i.e. the
+/// loop that runs right after it the same number of times, or null.
+Loop *LoopFusion::getFusionCandidate(Loop *L) {
+  if (!isSimpleLoop(L))
+    return 0;
+
+  // The exit block of L must do nothing but enter the next loop.
+  BasicBlock *ExitBlock = L->getExitBlock();
+  if (ExitBlock->size() != 1 || !ExitBlock->getSinglePredecessor())
+    return 0;
+  BranchInst *BI = dyn_cast<BranchInst>(ExitBlock->getTerminator());
+  if (!BI || BI->isConditional())
+    return 0;
+  Loop *Next = LI->getLoopFor(BI->getSuccessor(0));
+  if (!Next || Next == L || Next->getLoopPreheader() != ExitBlock ||
+      !isSimpleLoop(Next))
+    return 0;
+
+  const SCEV *TripCount = SE->getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(TripCount) ||
+      TripCount != SE->getBackedgeTakenCount(Next))
+    return 0;
+  return Next;
+}
+
+/// collectMemoryAccesses - Add the loads and stores of L to Accs. Returns
+/// false if L has other instructions touching memory.
+bool LoopFusion::collectMemoryAccesses(Loop *L,
+                                       SmallVectorImpl<Instruction *> &Accs) {
+  BasicBlock *Header = L->getHeader();
+  for (BasicBlock::iterator I = Header->begin(), E = Header->end();
+       I != E; ++I) {
+    if (LoadInst *Ld = dyn_cast<LoadInst>(I)) {
+      if (!Ld->isSimple())
+        return false;
+      Accs.push_back(I);
+    } else if (StoreInst *St = dyn_cast<StoreInst>(I)) {
+      if (!St->isSimple())
+        return false;
+      Accs.push_back(I);
+    } else if (I->mayReadOrWriteMemory() || I->mayHaveSideEffects())
+      return false;
+  }
+  return true;
+}
+
+static Value *getPointerOperand(Instruction *I) {
+  if (LoadInst *Ld = dyn_cast<LoadInst>(I))
+    return Ld->getPointerOperand();
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+/// canFuseAccesses - Return true if the access Second of the second loop
+/// never touches memory that First touches in a later iteration of the
+/// first loop. One of them is a store.
+bool LoopFusion::canFuseAccesses(Instruction *First, Instruction *Second) {
+  OwningPtr<Dependence> D(DA->depends(First, Second, true));
+  if (!D)
+    return true;
+
+  Value *Ptr1 = getPointerOperand(First), *Ptr2 = getPointerOperand(Second);
+  const SCEVAddRecExpr *AR1 = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Ptr1));
+  const SCEVAddRecExpr *AR2 = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Ptr2));
+  if (!AR1 || !AR2 || !AR1->isAffine() || !AR2->isAffine() ||
+      AR1->getType() != AR2->getType())
+    return false;
+
+  const SCEVConstant *Step =
+    dyn_cast<SCEVConstant>(AR1->getStepRecurrence(*SE));
+  if (!Step || Step != AR2->getStepRecurrence(*SE))
+    return false;
+  const SCEVConstant *Dist = dyn_cast<SCEVConstant>(
+    SE->getMinusSCEV(AR2->getStart(), AR1->getStart()));
+  if (!Dist)
+    return false;
+
+  int64_t S = Step->getValue()->getSExtValue();
+  int64_t D2 = Dist->getValue()->getSExtValue();
+  int64_t Size1 = DL->getTypeStoreSize(
+    cast<PointerType>(Ptr1->getType())->getElementType());
+  int64_t Size2 = DL->getTypeStoreSize(
+    cast<PointerType>(Ptr2->getType())->getElementType());
+
+  // In iteration i, Second accesses [Start1 + D2 + i*S, +Size2). It must end
+  // before the access of First in iteration i + 1 if the addresses grow, and
+  // start after it if they shrink.
+  if (S > 0)
+    return D2 + Size2 <= S;
+  if (S < 0)
+    return D2 >= S + Size1;
+  return false;
+}
+
+bool LoopFusion::runOnLoop(Loop *L, LPPassManager &LPM) {
+  DT = &getAnalysis<DominatorTree>();
+  LI = &getAnalysis<LoopInfo>();
+  SE = &getAnalysis<ScalarEvolution>();
+  DA = &getAnalysis<DependenceAnalysis>();
+  DL = getAnalysisIfAvailable<DataLayout>();
+  if (!DL)
+    return false;
+
+  bool Changed = false;
+  while (Loop *Next = getFusionCandidate(L)) {
+    SmallVector<Instruction *, 16> Accs1, Accs2;
+    if (!collectMemoryAccesses(L, Accs1) || !collectMemoryAccesses(Next, Accs2))
+      break;
+
+    bool Legal = true;
+    for (unsigned i = 0, e = Accs1.size(); i != e && Legal; ++i)
+      for (unsigned j = 0, je = Accs2.size(); j != je && Legal; ++j)
+        if (isa<StoreInst>(Accs1[i]) || isa<StoreInst>(Accs2[j]))
+          Legal = canFuseAccesses(Accs1[i], Accs2[j]);
+    if (!Legal)
+      break;
+
+    DEBUG(dbgs() << "LFuse: Fusing loops " << L->getHeader()->getName()
+          << " and " << Next->getHeader()->getName() << '\n');
+    fuse(L, Next, LPM);
+    ++NumLoopsFused;
+    Changed = true;
+  }
+  return Changed;
+}
+
+/// fuse - Move the body of L2 into L1, which then exits where L2 did.
+void LoopFusion::fuse(Loop *L1, Loop *L2, LPPassManager &LPM) {
+  SE->forgetLoop(L1);
+  SE->forgetLoop(L2);
+
+  BasicBlock *Header1 = L1->getHeader();
+  BasicBlock *Preheader1 = L1->getLoopPreheader();
+  BasicBlock *Exit1 = L1->getExitBlock();
+  BasicBlock *Header2 = L2->getHeader();
+  BasicBlock *Exit2 = L2->getExitBlock();
+  BranchInst *BI2 = cast<BranchInst>(Header2->getTerminator());
+  Value *Cond2 = BI2->getCondition();
+
+  // Move the PHIs and the body of L2 into L1.
+  while (PHINode *PN = dyn_cast<PHINode>(Header2->begin())) {
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Exit1), Preheader1);
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Header2), Header1);
+    PN->moveBefore(Header1->getFirstNonPHI());
+  }
+  Header1->getInstList().splice(Header1->getTerminator(),
+                                Header2->getInstList(),
+                                Header2->begin(), BI2);
+
+  // Leave the fused loop where L2 left.
+  for (BasicBlock::iterator I = Exit2->begin(); isa<PHINode>(I); ++I) {
+    PHINode *PN = cast<PHINode>(I);
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Header2), Header1);
+  }
+  Header1->getTerminator()->replaceUsesOfWith(Exit1, Exit2);
+
+  // Header2 and Exit1 are now unreachable.
+  LPM.deleteLoopFromQueue(L2);
+  LI->removeBlock(Header2);
+  LI->removeBlock(Exit1);
+  DT->changeImmediateDominator(Exit2, Header1);
+  DT->eraseNode(Header2);
+  DT->eraseNode(Exit1);
+  Exit1->eraseFromParent();
+  Header2->dropAllReferences();
+  Header2->eraseFromParent();
+
+  // The exit test of L2 is redundant with the one of L1.
+  RecursivelyDeleteTriviallyDeadInstructions(Cond2);
+}
@@ -0,0 +1,246 @@
+//===-- LoopInvariantDivision.cpp - Divide by loop invariants -------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements a pass that rewrites unsigned divisions and remainders
+// by a loop-invariant but unknown divisor into a multiply by a "magic"
+// reciprocal and a couple of shifts. The code generator already does this for
+// constant divisors; here the magic number is computed at run time, once, in
+// the loop preheader, so that each iteration only pays for a multiply instead
+// of a hardware divide.
+//
+// For an N bit divisor d, with l = ceil(log2(d)), the preheader computes
+//
+//   m = floor(2^N * (2^l - d) / d) + 1
+//
+// and the quotient of an N bit x is then
+//
+//   t = mulhu(x, m)
+//   q = (t + ((x - t) >> min(l, 1))) >> max(l - 1, 0)
+//
+// as described in "Division by Invariant Integers using Multiplication" by
+// Granlund and Montgomery. A zero divisor is replaced by one when computing m,
+// so that hoisting the division does not introduce a trap on paths that never
+// divide.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "loop-invariant-div"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+using namespace llvm;
+
+STATISTIC(NumDivsExpanded, "Number of divisions by an invariant expanded");
+STATISTIC(NumRemsExpanded, "Number of remainders by an invariant expanded");
+
+static cl::opt<bool>
+ForceInvariantDivExpansion("force-loop-invariant-div", cl::init(false),
+                           cl::Hidden,
+                           cl::desc("Expand divisions by loop invariants even "
+                                    "if the target prefers a divide"));
+
+namespace {
+  /// DivisionMagic - The values computed in the preheader for one divisor.
+  struct DivisionMagic {
+    Value *Multiplier;
+    Value *PreShift;
+    Value *PostShift;
+  };
+
+  class LoopInvariantDivision : public LoopPass {
+  public:
+    static char ID; // Pass ID, replacement for typeid
+    LoopInvariantDivision() : LoopPass(ID) {
+      initializeLoopInvariantDivisionPass(*PassRegistry::getPassRegistry());
+    }
+
+    bool runOnLoop(Loop *L, LPPassManager &LPM);
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+      AU.addRequired<LoopInfo>();
+      AU.addRequired<TargetTransformInfo>();
+      AU.addRequiredID(LoopSimplifyID);
+
+      AU.addPreserved<LoopInfo>();
+      AU.addPreservedID(LoopSimplifyID);
+      AU.addPreservedID(LCSSAID);
+    }
+
+  private:
+    bool isCandidate(const BinaryOperator *BO, const Loop *L) const;
+    const DivisionMagic &getMagic(Value *Divisor, BasicBlock *Preheader);
+    Value *expandQuotient(BinaryOperator *BO, const DivisionMagic &Magic);
+
+    const TargetTransformInfo *TTI;
+    DenseMap<Value *, DivisionMagic> Magics;
+  };
+}
+
+char LoopInvariantDivision::ID = 0;
+INITIALIZE_PASS_BEGIN(LoopInvariantDivision, "loop-invariant-div",
+                "Loop Invariant Division", false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopInfo)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_AG_DEPENDENCY(TargetTransformInfo)
+INITIALIZE_PASS_END(LoopInvariantDivision, "loop-invariant-div",
+                "Loop Invariant Division", false, false)
+
+Pass *llvm::createLoopInvariantDivisionPass() {
+  return new LoopInvariantDivision();
+}
+
+/// isCandidate - Return true if BO is an unsigned division or remainder by a
+/// non-constant value that is invariant in L, of a value that is not.
+/// Divisions of invariants are left alone: LICM hoists those, and expanding
+/// them would only make the enclosing loop see a wider division.
+bool LoopInvariantDivision::isCandidate(const BinaryOperator *BO,
+                                        const Loop *L) const {
+  if (BO->getOpcode() != Instruction::UDiv &&
+      BO->getOpcode() != Instruction::URem)
+    return false;
+
+  IntegerType *Ty = dyn_cast<IntegerType>(BO->getType());
+  if (!Ty || Ty->getBitWidth() > 64)
+    return false;
+
+  Value *Divisor = BO->getOperand(1);
+  if (isa<Constant>(Divisor) || !L->isLoopInvariant(Divisor) ||
+      L->isLoopInvariant(BO->getOperand(0)))
+    return false;
+
+  return ForceInvariantDivExpansion ||
+         TTI->shouldExpandDivisionByInvariant(Ty);
+}
+
+/// getMagic - Return the magic values for dividing by Divisor, emitting the
+/// code that computes them at the end of Preheader the first time.
+const DivisionMagic &
+LoopInvariantDivision::getMagic(Value *Divisor, BasicBlock *Preheader) {
+  DenseMap<Value *, DivisionMagic>::iterator I = Magics.find(Divisor);
+  if (I != Magics.end())
+    return I->second;
+
+  IntegerType *Ty = cast<IntegerType>(Divisor->getType());
+  unsigned BitWidth = Ty->getBitWidth();
+  IntegerType *WideTy = IntegerType::get(Ty->getContext(), 2 * BitWidth);
+  IRBuilder<> Builder(Preheader->getTerminator());
+
+  // Divide by one instead of zero; the loop traps on its own if it divides.
+  Value *IsZero = Builder.CreateICmpEQ(Divisor, ConstantInt::get(Ty, 0));
+  Value *D = Builder.CreateSelect(IsZero, ConstantInt::get(Ty, 1), Divisor,
+                                  "div.nonzero");
+
+  // l = ceil(log2(d)) = N - ctlz(d - 1).
+  Module *M = Preheader->getParent()->getParent();
+  Function *Ctlz = Intrinsic::getDeclaration(M, Intrinsic::ctlz, Ty);
+  Value *DMinus1 = Builder.CreateSub(D, ConstantInt::get(Ty, 1));
+  Value *LeadingZeros =
+    Builder.CreateCall2(Ctlz, DMinus1, Builder.getFalse());
+  Value *Log2 = Builder.CreateSub(ConstantInt::get(Ty, BitWidth), LeadingZeros,
+                                  "div.log2");
+
+  // m = floor(2^N * (2^l - d) / d) + 1, computed in 2N bits.
+  Value *WideD = Builder.CreateZExt(D, WideTy);
+  Value *Pow2 = Builder.CreateShl(ConstantInt::get(WideTy, 1),
+                                  Builder.CreateZExt(Log2, WideTy));
+  Value *Num = Builder.CreateShl(Builder.CreateSub(Pow2, WideD), BitWidth);
+  Value *Quot = Builder.CreateTrunc(Builder.CreateUDiv(Num, WideD), Ty);
+  Value *Multiplier = Builder.CreateAdd(Quot, ConstantInt::get(Ty, 1),
+                                        "div.magic");
+
+  // The shifts are min(l, 1) and max(l - 1, 0).
+  Value *LogIsZero = Builder.CreateICmpEQ(Log2, ConstantInt::get(Ty, 0));
+  DivisionMagic Magic;
+  Magic.Multiplier = Multiplier;
+  Magic.PreShift = Builder.CreateSelect(LogIsZero, ConstantInt::get(Ty, 0),
+                                        ConstantInt::get(Ty, 1),
+                                        "div.preshift");
+  Magic.PostShift =
+    Builder.CreateSelect(LogIsZero, ConstantInt::get(Ty, 0),
+                         Builder.CreateSub(Log2, ConstantInt::get(Ty, 1)),
+                         "div.postshift");
+  return Magics[Divisor] = Magic;
+}
+
+/// expandQuotient - Emit the quotient of BO's operands before BO using the
+/// magic values of its divisor.
+Value *LoopInvariantDivision::expandQuotient(BinaryOperator *BO,
+                                             const DivisionMagic &Magic) {
+  IntegerType *Ty = cast<IntegerType>(BO->getType());
+  unsigned BitWidth = Ty->getBitWidth();
+  IntegerType *WideTy = IntegerType::get(Ty->getContext(), 2 * BitWidth);
+  IRBuilder<> Builder(BO);
+
+  Value *X = BO->getOperand(0);
+  Value *Prod = Builder.CreateMul(Builder.CreateZExt(X, WideTy),
+                                  Builder.CreateZExt(Magic.Multiplier, WideTy));
+  Value *T = Builder.CreateTrunc(Builder.CreateLShr(Prod, BitWidth), Ty);
+  Value *Diff = Builder.CreateLShr(Builder.CreateSub(X, T), Magic.PreShift);
+  return Builder.CreateLShr(Builder.CreateAdd(T, Diff), Magic.PostShift,
+                            "div.quot");
+}
+
+bool LoopInvariantDivision::runOnLoop(Loop *L, LPPassManager &LPM) {
+  BasicBlock *Preheader = L->getLoopPreheader();
+  if (!Preheader)
+    return false;
+
+  TTI = &getAnalysis<TargetTransformInfo>();
+  LoopInfo &LI = getAnalysis<LoopInfo>();
+
+  // Divisions in subloops were already looked at with the subloop, and any
+  // divisor invariant here was invariant there too.
+  SmallVector<BinaryOperator *, 8> Worklist;
+  for (Loop::block_iterator BI = L->block_begin(), BE = L->block_end();
+       BI != BE; ++BI) {
+    if (LI.getLoopFor(*BI) != L)
+      continue;
+    for (BasicBlock::iterator I = (*BI)->begin(), E = (*BI)->end(); I != E;
+         ++I)
+      if (BinaryOperator *BO = dyn_cast<BinaryOperator>(I))
+        if (isCandidate(BO, L))
+          Worklist.push_back(BO);
+  }
+  if (Worklist.empty())
+    return false;
+
+  Magics.clear();
+  for (unsigned i = 0, e = Worklist.size(); i != e; ++i) {
+    BinaryOperator *BO = Worklist[i];
+    DEBUG(dbgs() << "LID: expanding " << *BO << "\n");
+    const DivisionMagic &Magic = getMagic(BO->getOperand(1), Preheader);
+    Value *Result = expandQuotient(BO, Magic);
+    if (BO->getOpcode() == Instruction::URem) {
+      IRBuilder<> Builder(BO);
+      Result = Builder.CreateSub(BO->getOperand(0),
+                                 Builder.CreateMul(Result, BO->getOperand(1)),
+                                 "div.rem");
+      ++NumRemsExpanded;
+    } else {
+      ++NumDivsExpanded;
+    }
+    Result->takeName(BO);
+    BO->replaceAllUsesWith(Result);
+    BO->eraseFromParent();
+  }
+  Magics.clear();
+  return true;
+}
@@ -59,6 +59,7 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallBitVector.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/IVUsers.h"
 #include "llvm/Analysis/LoopPass.h"
@@ -71,6 +72,8 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/ValueHandle.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
@@ -84,6 +87,19 @@ using namespace llvm;
 /// worst cases before LSR burns too much compile time and stack space.
 static const unsigned MaxIVUsers = 200;
 
+STATISTIC(NumLoopsSolved, "Number of loops the LSR solver was run on");
+STATISTIC(NumFormulaeRated, "Number of formulae rated by the LSR solver");
+STATISTIC(NumGreedySolutions,
+          "Number of loops solved greedily once the solver ran out of budget");
+
+/// The number of formulae the recursive solver may rate for one loop.  Once
+/// it has rated that many, the search stops and LSR settles for the better
+/// of the best solution found so far and a greedy one.
+static cl::opt<unsigned> SolverBudget(
+  "lsr-solver-budget", cl::Hidden, cl::init(100000),
+  cl::desc("Number of formulae the LSR solver rates before it falls back "
+           "to a greedy solution"));
+
 // Temporary flag to cleanup congruent phis after LSR phi expansion.
 // It's currently disabled until we can determine whether it's truly useful or
 // not. The flag should be removed after the v3.0 release.
@@ -1704,7 +1720,10 @@ class LSRInstance {
                     SmallVectorImpl<const Formula *> &Workspace,
                     const Cost &CurCost,
                     const SmallPtrSet<const SCEV *, 16> &CurRegs,
-                    DenseSet<const SCEV *> &VisitedRegs) const;
+                    DenseSet<const SCEV *> &VisitedRegs,
+                    unsigned &Budget) const;
+  void SolveGreedily(SmallVectorImpl<const Formula *> &Solution,
+                     Cost &SolutionCost) const;
   void Solve(SmallVectorImpl<const Formula *> &Solution) const;
 
   BasicBlock::iterator
@@ -4123,13 +4142,15 @@ void LSRInstance::NarrowSearchSpaceUsingHeuristics() {
   NarrowSearchSpaceByPickingWinnerRegs();
 }
 
-/// SolveRecurse - This is the recursive solver.
+/// SolveRecurse - This is the recursive solver.  Each formula rated uses up
+/// one unit of Budget; once it is zero, the search stops.
 void LSRInstance::SolveRecurse(SmallVectorImpl<const Formula *> &Solution,
                                Cost &SolutionCost,
                                SmallVectorImpl<const Formula *> &Workspace,
                                const Cost &CurCost,
                                const SmallPtrSet<const SCEV *, 16> &CurRegs,
-                               DenseSet<const SCEV *> &VisitedRegs) const {
+                               DenseSet<const SCEV *> &VisitedRegs,
+                               unsigned &Budget) const {
   // Some ideas:
   //  - prune more:
   //    - use more aggressive filtering
@@ -4176,6 +4197,11 @@ void LSRInstance::SolveRecurse(SmallVectorImpl<const Formula *> &Solution,
       continue;
     }
 
+    if (Budget == 0)
+      return;
+    --Budget;
+    ++NumFormulaeRated;
+
     // Evaluate the cost of the current formula. If it's already worse than
     // the current best, prune the search at that point.
     NewCost = CurCost;
@@ -4186,7 +4212,7 @@ void LSRInstance::SolveRecurse(SmallVectorImpl<const Formula *> &Solution,
       Workspace.push_back(&F);
       if (Workspace.size() != Uses.size()) {
         SolveRecurse(Solution, SolutionCost, Workspace, NewCost,
-                     NewRegs, VisitedRegs);
+                     NewRegs, VisitedRegs, Budget);
         if (F.getNumRegs() == 1 && Workspace.size() == 1)
           VisitedRegs.insert(F.ScaledReg ? F.ScaledReg : F.BaseRegs[0]);
       } else {
@@ -4205,6 +4231,47 @@ void LSRInstance::SolveRecurse(SmallVectorImpl<const Formula *> &Solution,
   }
 }
 
+/// SolveGreedily - Choose the formula of each use in turn, taking the one
+/// that adds the least to the cost of the formulae already chosen.  This
+/// rates each formula once, so it is linear in the number of formulae.  If
+/// some use has no formula that doesn't lose, Solution is left empty.
+void LSRInstance::SolveGreedily(SmallVectorImpl<const Formula *> &Solution,
+                                Cost &SolutionCost) const {
+  Solution.clear();
+  Cost CurCost;
+  SmallPtrSet<const SCEV *, 16> CurRegs;
+  DenseSet<const SCEV *> VisitedRegs;
+
+  for (SmallVectorImpl<LSRUse>::const_iterator UI = Uses.begin(),
+       UE = Uses.end(); UI != UE; ++UI) {
+    const LSRUse &LU = *UI;
+    const Formula *Best = 0;
+    Cost BestCost;
+    BestCost.Loose();
+    SmallPtrSet<const SCEV *, 16> BestRegs;
+    for (SmallVectorImpl<Formula>::const_iterator I = LU.Formulae.begin(),
+         E = LU.Formulae.end(); I != E; ++I) {
+      Cost NewCost = CurCost;
+      SmallPtrSet<const SCEV *, 16> NewRegs = CurRegs;
+      NewCost.RateFormula(TTI, *I, NewRegs, VisitedRegs, L, LU.Offsets, SE,
+                          DT, LU);
+      if (NewCost < BestCost) {
+        Best = &*I;
+        BestCost = NewCost;
+        BestRegs = NewRegs;
+      }
+    }
+    if (!Best) {
+      Solution.clear();
+      return;
+    }
+    Solution.push_back(Best);
+    CurCost = BestCost;
+    CurRegs = BestRegs;
+  }
+  SolutionCost = CurCost;
+}
+
 /// Solve - Choose one formula from each use. Return the results in the given
 /// Solution vector.
 void LSRInstance::Solve(SmallVectorImpl<const Formula *> &Solution) const {
@@ -4215,10 +4282,36 @@ void LSRInstance::Solve(SmallVectorImpl<const Formula *> &Solution) const {
   SmallPtrSet<const SCEV *, 16> CurRegs;
   DenseSet<const SCEV *> VisitedRegs;
   Workspace.reserve(Uses.size());
+  ++NumLoopsSolved;
+  DEBUG(dbgs() << "\nSolving a search space of about "
+               << EstimateSearchSpaceComplexity() << " solutions.\n");
+  double StartTime = TimeRecord::getCurrentTime(true).getWallTime();
 
-  // SolveRecurse does all the work.
+  // SolveRecurse does all the work, unless it runs out of budget.
+  unsigned Budget = SolverBudget;
   SolveRecurse(Solution, SolutionCost, Workspace, CurCost,
-               CurRegs, VisitedRegs);
+               CurRegs, VisitedRegs, Budget);
+  if (Budget == 0) {
+    // The search may have stopped before it found any solution, or before
+    // it found a good one.  Take a greedy solution if it is cheaper.
+    ++NumGreedySolutions;
+    DEBUG(dbgs() << "The solver ran out of budget; solving greedily.\n");
+    SmallVector<const Formula *, 8> GreedySolution;
+    Cost GreedyCost;
+    SolveGreedily(GreedySolution, GreedyCost);
+    if (!GreedySolution.empty() &&
+        (Solution.empty() || GreedyCost < SolutionCost)) {
+      Solution = GreedySolution;
+      SolutionCost = GreedyCost;
+    }
+  }
+  DEBUG(dbgs() << "Rated " << (SolverBudget - Budget) << " formulae in "
+               << format("%.6f",
+                         TimeRecord::getCurrentTime(false).getWallTime() -
+                           StartTime)
+               << "s.\n");
+  (void)StartTime;
+
   if (Solution.empty()) {
     DEBUG(dbgs() << "\nNo Satisfactory Solution\n");
     return;
@@ -10,16 +10,27 @@
 // This pass implements a simple loop unroller.  It works best when loops have
 // been canonicalized by the -indvars pass, allowing it to determine the trip
 // counts of loops easily.
+//
+// In functions with a profiled entry count, the profile decides how hard to
+// try: loops the profile says are cold are only unrolled as far as they would
+// be when optimizing for size, while hot loops get a larger threshold and are
+// unrolled partially and at run time, by no more than the average trip count
+// the profile saw.  Each such function has a budget of instructions that
+// unrolling may add to it.
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "loop-unroll"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
 #include "llvm/Analysis/CodeMetrics.h"
 #include "llvm/Analysis/LoopPass.h"
 #include "llvm/Analysis/ScalarEvolution.h"
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
@@ -45,11 +56,31 @@ static cl::opt<bool>
 UnrollRuntime("unroll-runtime", cl::ZeroOrMore, cl::init(false), cl::Hidden,
   cl::desc("Unroll loops with run-time trip counts"));
 
+static cl::opt<bool>
+UnrollProfile("unroll-profile", cl::init(true), cl::Hidden,
+  cl::desc("Unroll loops in functions with a profile by how hot they are"));
+
+static cl::opt<unsigned>
+UnrollHotFraction("unroll-hot-fraction", cl::init(1000), cl::Hidden,
+  cl::desc("A loop is hot if its header runs at least as often as the most "
+           "entered function of the module, divided by this"));
+
+static cl::opt<unsigned>
+UnrollHotThreshold("unroll-hot-threshold", cl::init(400), cl::Hidden,
+  cl::desc("The cut-off point for unrolling loops the profile says are hot"));
+
+static cl::opt<unsigned>
+UnrollFunctionGrowth("unroll-function-growth", cl::init(1000), cl::Hidden,
+  cl::desc("The most instructions unrolling may add to a function with a "
+           "profile"));
+
 namespace {
   class LoopUnroll : public LoopPass {
   public:
     static char ID; // Pass ID, replacement for typeid
-    LoopUnroll(int T = -1, int C = -1, int P = -1, int R = -1) : LoopPass(ID) {
+    LoopUnroll(int T = -1, int C = -1, int P = -1, int R = -1)
+      : LoopPass(ID), CountedModule(0), MaxEntryCount(0),
+        GrowthLeft(UnrollFunctionGrowth) {
       CurrentThreshold = (T == -1) ? UnrollThreshold : unsigned(T);
       CurrentCount = (C == -1) ? UnrollCount : unsigned(C);
       CurrentAllowPartial = (P == -1) ? UnrollAllowPartial : (bool)P;
@@ -86,8 +117,29 @@ namespace {
     bool     UserAllowPartial;     // CurrentAllowPartial is user-specified.
     bool     UserRuntime;          // CurrentRuntime is user-specified.
 
+    /// The module MaxEntryCount was computed for, and the highest entry count
+    /// of its functions.
+    const Module *CountedModule;
+    uint64_t MaxEntryCount;
+
+    /// How many more instructions unrolling may add to the current function,
+    /// if it has a profile.
+    uint64_t GrowthLeft;
+
+    /// How hot the profile says a loop is.
+    enum Hotness { NoProfile, Cold, Warm, Hot };
+
     bool runOnLoop(Loop *L, LPPassManager &LPM);
 
+    /// Called once the loops of a function are done with.
+    virtual bool doFinalization() {
+      GrowthLeft = UnrollFunctionGrowth;
+      return false;
+    }
+
+  private:
+    Hotness getHotness(const Loop *L);
+
     /// This transformation requires natural loop information & requires that
     /// loop preheaders be inserted into the CFG...
     ///
@@ -101,6 +153,7 @@ namespace {
       AU.addRequired<ScalarEvolution>();
       AU.addPreserved<ScalarEvolution>();
       AU.addRequired<TargetTransformInfo>();
+      AU.addRequired<BlockFrequencyInfo>();
       // FIXME: Loop unroll requires LCSSA. And LCSSA requires dom info.
       // If loop unroll does not preserve dom info then LCSSA pass on next
       // loop will receive invalid dom info.
@@ -113,6 +166,7 @@ namespace {
 char LoopUnroll::ID = 0;
 INITIALIZE_PASS_BEGIN(LoopUnroll, "loop-unroll", "Unroll loops", false, false)
 INITIALIZE_AG_DEPENDENCY(TargetTransformInfo)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfo)
 INITIALIZE_PASS_DEPENDENCY(LoopInfo)
 INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
 INITIALIZE_PASS_DEPENDENCY(LCSSA)
@@ -145,6 +199,76 @@ static unsigned ApproximateLoopSize(const Loop *L, unsigned &NumCalls,
   return LoopSize;
 }
 
+/// getProfileTripCount - Return the average number of iterations the branch
+/// weights on the latch of L say the loop runs each time it is entered, or 0
+/// if there are none.
+static unsigned getProfileTripCount(const Loop *L) {
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch)
+    return 0;
+  BranchInst *BI = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (!BI || !BI->isConditional())
+    return 0;
+  MDNode *Weights = BI->getMetadata(LLVMContext::MD_prof);
+  if (!Weights || Weights->getNumOperands() != 3)
+    return 0;
+  MDString *Name = dyn_cast<MDString>(Weights->getOperand(0));
+  ConstantInt *Taken = dyn_cast<ConstantInt>(Weights->getOperand(1));
+  ConstantInt *NotTaken = dyn_cast<ConstantInt>(Weights->getOperand(2));
+  if (!Name || Name->getString() != "branch_weights" || !Taken || !NotTaken)
+    return 0;
+
+  uint64_t Back = Taken->getZExtValue(), Exit = NotTaken->getZExtValue();
+  if (!L->contains(BI->getSuccessor(0)))
+    std::swap(Back, Exit);
+  if (Exit == 0)
+    return 0;
+  uint64_t TripCount = (Back + Exit) / Exit;
+  return TripCount > UINT_MAX ? UINT_MAX : unsigned(TripCount);
+}
+
+/// getHotness - Classify L by the profiled entry count of its function, scaled
+/// by the block frequency of its header.  A loop is hot if its header runs at
+/// least 1/UnrollHotFraction as often as the most entered function of the
+/// module is entered, and cold if it never ran.
+LoopUnroll::Hotness LoopUnroll::getHotness(const Loop *L) {
+  const Function *F = L->getHeader()->getParent();
+  if (F->hasFnAttribute(Attribute::Cold))
+    return Cold;
+  uint64_t EntryCount;
+  if (!UnrollProfile || !F->getEntryCount(EntryCount))
+    return NoProfile;
+  if (EntryCount == 0)
+    return Cold;
+
+  const Module *M = F->getParent();
+  if (M != CountedModule) {
+    CountedModule = M;
+    MaxEntryCount = 0;
+    for (Module::const_iterator I = M->begin(), E = M->end(); I != E; ++I) {
+      uint64_t Count;
+      if (I->getEntryCount(Count))
+        MaxEntryCount = std::max(MaxEntryCount, Count);
+    }
+  }
+
+  // The frequencies are from before this function's loops were unrolled, but
+  // the header of a loop that is still to be visited is not touched by
+  // unrolling the loops inside it.  The blocks unrolling creates have no
+  // frequency, so they count as cold.
+  BlockFrequencyInfo &BFI = getAnalysis<BlockFrequencyInfo>();
+  double EntryFreq = BFI.getBlockFreq(&F->getEntryBlock()).getFrequency();
+  if (EntryFreq == 0)
+    return NoProfile;
+  uint64_t HeaderCount = EntryCount *
+    (BFI.getBlockFreq(L->getHeader()).getFrequency() / EntryFreq);
+  if (HeaderCount == 0)
+    return Cold;
+  if (HeaderCount >= MaxEntryCount / std::max(1U, unsigned(UnrollHotFraction)))
+    return Hot;
+  return Warm;
+}
+
 bool LoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
   LoopInfo *LI = &getAnalysis<LoopInfo>();
   ScalarEvolution *SE = &getAnalysis<ScalarEvolution>();
@@ -174,6 +298,35 @@ bool LoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
                      Attribute::OptimizeForSize))
     Threshold = UP.OptSizeThreshold;
 
+  bool AllowPartial = UserAllowPartial ? CurrentAllowPartial : UP.Partial;
+  bool Runtime = UserRuntime ? CurrentRuntime : UP.Runtime;
+
+  // Let the profile, if there is one, adjust what the user didn't specify.
+  // Cold loops are only unrolled as far as they would be for size, and hot
+  // ones as far as the hot threshold allows.
+  Hotness H = getHotness(L);
+  unsigned ProfileTripCount = 0;
+  if (H == Cold) {
+    DEBUG(dbgs() << "  Loop is cold\n");
+    if (!UserThreshold)
+      Threshold = std::min(Threshold, UP.OptSizeThreshold);
+    if (!UserAllowPartial)
+      AllowPartial = false;
+    if (!UserRuntime)
+      Runtime = false;
+  } else if (H == Hot) {
+    ProfileTripCount = getProfileTripCount(L);
+    DEBUG(dbgs() << "  Loop is hot, profiled trip count: " << ProfileTripCount
+          << "\n");
+    if (!UserThreshold)
+      Threshold = std::max(Threshold, unsigned(UnrollHotThreshold));
+    if (!UserAllowPartial)
+      AllowPartial = true;
+    // Unrolling a loop that runs only once or twice each time gains nothing.
+    if (!UserRuntime)
+      Runtime = ProfileTripCount == 0 || ProfileTripCount > 2;
+  }
+
   // Find trip count and trip multiple if count is not available
   unsigned TripCount = 0;
   unsigned TripMultiple = 1;
@@ -186,14 +339,16 @@ bool LoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
     TripMultiple = SE->getSmallConstantTripMultiple(L, LatchBlock);
   }
 
-  bool Runtime = UserRuntime ? CurrentRuntime : UP.Runtime;
-
   // Use a default unroll-count if the user doesn't specify a value
   // and the trip count is a run-time value.  The default is different
   // for run-time or compile-time trip count loops.
   unsigned Count = UserCount ? CurrentCount : UP.Count;
-  if (Runtime && Count == 0 && TripCount == 0)
+  if (Runtime && Count == 0 && TripCount == 0) {
     Count = UnrollRuntimeCount;
+    // Don't unroll further than the loop usually runs.
+    while (ProfileTripCount && Count > ProfileTripCount && Count > 2)
+      Count >>= 1;
+  }
 
   if (Count == 0) {
     // Conservative heuristic: if we know the trip count, see if we can
@@ -206,6 +361,7 @@ bool LoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
   }
 
   // Enforce the threshold.
+  uint64_t Growth = 0;
   if (Threshold != NoThreshold) {
     unsigned NumInlineCandidates;
     bool notDuplicatable;
@@ -225,7 +381,6 @@ bool LoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
     if (TripCount != 1 && Size > Threshold) {
       DEBUG(dbgs() << "  Too large to fully unroll with count: " << Count
             << " because size: " << Size << ">" << Threshold << "\n");
-      bool AllowPartial = UserAllowPartial ? CurrentAllowPartial : UP.Partial;
       if (!AllowPartial && !(Runtime && TripCount == 0)) {
         DEBUG(dbgs() << "  will not try to unroll partially because "
               << "-unroll-allow-partial not given\n");
@@ -250,11 +405,25 @@ bool LoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
       }
       DEBUG(dbgs() << "  partially unrolling with count: " << Count << "\n");
     }
+
+    // Keep within the budget of a function with a profile, counting the
+    // remainder loop of a run-time unrolled loop as one more copy.
+    if (H != NoProfile) {
+      Growth = (uint64_t)LoopSize*(Count - 1);
+      if (Runtime && TripCount == 0)
+        Growth += LoopSize;
+      if (Growth > GrowthLeft) {
+        DEBUG(dbgs() << "  Not unrolling: growth " << Growth
+              << " is over the function's budget of " << GrowthLeft << "\n");
+        return false;
+      }
+    }
   }
 
   // Unroll the loop.
   if (!UnrollLoop(L, Count, TripCount, Runtime, TripMultiple, LI, &LPM))
     return false;
 
+  GrowthLeft -= Growth;
   return true;
 }
@@ -1501,6 +1501,8 @@ namespace {
   struct SCCP : public FunctionPass {
     virtual void getAnalysisUsage(AnalysisUsage &AU) const {
       AU.addRequired<TargetLibraryInfo>();
+      // Dead blocks are emptied rather than removed, so the CFG is unchanged.
+      AU.setPreservesCFG();
     }
     static char ID; // Pass identification, replacement for typeid
     SCCP() : FunctionPass(ID) {
@@ -27,6 +27,7 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/Dominators.h"
@@ -67,6 +68,9 @@ STATISTIC(NumPromoted, "Number of allocas promoted to SSA values");
 STATISTIC(NumLoadsSpeculated, "Number of loads speculated to allow promotion");
 STATISTIC(NumDeleted, "Number of instructions deleted");
 STATISTIC(NumVectorized, "Number of vectorized aggregates");
+STATISTIC(NumEscapedEarly,
+          "Number of allocas found to escape before building slices");
+STATISTIC(NumPresorted, "Number of allocas whose slices needed no sorting");
 
 /// Hidden option to force the pass to not use DomTree and mem2reg, instead
 /// forming SSA values through the SSAUpdater infrastructure.
@@ -653,6 +657,29 @@ private:
   }
 };
 
+/// \brief Sort the slices, in linear time if they are already in increasing
+/// or decreasing order.
+///
+/// The fields of an aggregate that are accessed one at a time tend to come
+/// out of the use lists in order or in reverse order.  Slices that compare
+/// equal are interchangeable when forming and rewriting partitions, and are
+/// left in no particular order by sorting either.
+static void sortSlices(SmallVectorImpl<Slice> &Slices) {
+  bool Increasing = true, Decreasing = true;
+  for (unsigned i = 1, e = Slices.size(); i != e && (Increasing || Decreasing);
+       ++i) {
+    Increasing = Increasing && !(Slices[i] < Slices[i - 1]);
+    Decreasing = Decreasing && !(Slices[i - 1] < Slices[i]);
+  }
+  if (Increasing || Decreasing) {
+    if (!Increasing)
+      std::reverse(Slices.begin(), Slices.end());
+    ++NumPresorted;
+    return;
+  }
+  std::sort(Slices.begin(), Slices.end());
+}
+
 AllocaSlices::AllocaSlices(const DataLayout &DL, AllocaInst &AI)
     :
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_DUMP)
@@ -676,7 +703,7 @@ AllocaSlices::AllocaSlices(const DataLayout &DL, AllocaInst &AI)
 
   // Sort the uses. This arranges for the offsets to be in ascending order,
   // and the sizes to be in descending order.
-  std::sort(Slices.begin(), Slices.end());
+  sortSlices(Slices);
 }
 
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_DUMP)
@@ -3326,6 +3353,41 @@ bool SROA::splitAlloca(AllocaInst &AI, AllocaSlices &S) {
   return Changed;
 }
 
+/// \brief Find an instruction through which the alloca escapes, looking only
+/// through bitcasts and GEPs.
+///
+/// Building the slices of a large buffer only to find that it is passed to a
+/// call is expensive, and common.  Any instruction found here is one that
+/// building the slices would give up on as well.
+static Instruction *findEscapingUser(AllocaInst &AI) {
+  SmallVector<Instruction *, 16> Worklist(1, &AI);
+  SmallPtrSet<Instruction *, 16> Visited;
+  Visited.insert(&AI);
+  while (!Worklist.empty()) {
+    Instruction *I = Worklist.pop_back_val();
+    for (Value::use_iterator UI = I->use_begin(), UE = I->use_end();
+         UI != UE; ++UI) {
+      Instruction *User = cast<Instruction>(*UI);
+      if (isa<BitCastInst>(User) || isa<GetElementPtrInst>(User)) {
+        if (Visited.insert(User))
+          Worklist.push_back(User);
+        continue;
+      }
+      if (isa<PtrToIntInst>(User))
+        return User;
+      if (StoreInst *SI = dyn_cast<StoreInst>(User)) {
+        if (SI->getValueOperand() == I)
+          return SI;
+        continue;
+      }
+      if ((isa<CallInst>(User) || isa<InvokeInst>(User)) &&
+          !isa<IntrinsicInst>(User))
+        return User;
+    }
+  }
+  return 0;
+}
+
 /// \brief Analyze an alloca for SROA.
 ///
 /// This analyzes the alloca to ensure we can reason about it, builds
@@ -3353,6 +3415,12 @@ bool SROA::runOnAlloca(AllocaInst &AI) {
   AggLoadStoreRewriter AggRewriter(*DL);
   Changed |= AggRewriter.rewrite(AI);
 
+  if (Instruction *EscapingI = findEscapingUser(AI)) {
+    DEBUG(dbgs() << "  escapes through: " << *EscapingI << "\n");
+    ++NumEscapedEarly;
+    return Changed;
+  }
+
   // Build the slices using a recursive instruction-visiting builder.
   AllocaSlices S(*DL, AI);
   DEBUG(S.print(dbgs()));
@@ -20,30 +20,37 @@
 //      that edge. The weight of a block B is computed as the maximum
 //      number of samples found in B.
 //
+//      It is also added to indirect calls, to record the functions they
+//      called according to the profile, for indirect call promotion.
+//
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "sample-profile"
 
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/DebugInfo/DIContext.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CallSite.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/InstIterator.h"
 #include "llvm/Support/MemoryBuffer.h"
-#include "llvm/Support/Regex.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/SampleProfileFormat.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -82,8 +89,9 @@ public:
   SampleProfile(StringRef F) : Profiles(0), Filename(F) {}
 
   void dump();
-  void loadText();
-  void loadNative() { llvm_unreachable("not implemented"); }
+  void load(Module &M);
+  void loadText(const MemoryBuffer &Buffer);
+  void loadBinary(const MemoryBuffer &Buffer, Module &M);
   bool emitAnnotations(Function &F);
   void printFunctionProfile(raw_ostream &OS, StringRef FName);
   void dumpFunctionProfile(StringRef FName);
@@ -97,32 +105,12 @@ protected:
   /// This data structure contains the runtime profile for a given
   /// function. It contains the total number of samples collected
   /// in the function and a map of samples collected in every statement.
-  struct FunctionProfile {
-    /// \brief Total number of samples collected inside this function.
-    ///
-    /// Samples are cumulative, they include all the samples collected
-    /// inside this function and all its inlined callees.
-    unsigned TotalSamples;
-
-    // \brief Total number of samples collected at the head of the function.
-    unsigned TotalHeadSamples;
-
-    /// \brief Map line offsets to collected samples.
-    ///
-    /// Each entry in this map contains the number of samples
-    /// collected at the corresponding line offset. All line locations
-    /// are an offset from the start of the function.
-    BodySampleMap BodySamples;
-
-    /// \brief Map basic blocks to their computed weights.
-    ///
-    /// The weight of a basic block is defined to be the maximum
-    /// of all the instruction weights in that block.
-    BlockWeightMap BlockWeights;
-  };
+  typedef sampleprof::FunctionSamples FunctionProfile;
 
   uint32_t getInstWeight(Instruction &I, unsigned FirstLineno,
                          BodySampleMap &BodySamples);
+  bool emitCallTargets(Function &F, unsigned FirstLineno,
+                       FunctionProfile &FProfile);
   uint32_t computeBlockWeight(BasicBlock *B, unsigned FirstLineno,
                               BodySampleMap &BodySamples);
 
@@ -131,7 +119,14 @@ protected:
   /// The profile of every function executed at runtime is collected
   /// in the structure FunctionProfile. This maps function objects
   /// to their corresponding profiles.
-  StringMap<FunctionProfile> Profiles;
+  sampleprof::ProfileMap Profiles;
+
+  /// \brief Map basic blocks to their computed weights.
+  ///
+  /// The weight of a basic block is defined to be the maximum
+  /// of all the instruction weights in that block.  This is only kept
+  /// for the function being annotated.
+  BlockWeightMap BlockWeights;
 
   /// \brief Path name to the file holding the profile data.
   ///
@@ -142,63 +137,6 @@ protected:
   StringRef Filename;
 };
 
-/// \brief Loader class for text-based profiles.
-///
-/// This class defines a simple interface to read text files containing
-/// profiles. It keeps track of line number information and location of
-/// the file pointer. Users of this class are responsible for actually
-/// parsing the lines returned by the readLine function.
-///
-/// TODO - This does not really belong here. It is a generic text file
-/// reader. It should be moved to the Support library and made more general.
-class ExternalProfileTextLoader {
-public:
-  ExternalProfileTextLoader(StringRef F) : Filename(F) {
-    error_code EC;
-    EC = MemoryBuffer::getFile(Filename, Buffer);
-    if (EC)
-      report_fatal_error("Could not open profile file " + Filename + ": " +
-                         EC.message());
-    FP = Buffer->getBufferStart();
-    Lineno = 0;
-  }
-
-  /// \brief Read a line from the mapped file.
-  StringRef readLine() {
-    size_t Length = 0;
-    const char *start = FP;
-    while (FP != Buffer->getBufferEnd() && *FP != '\n') {
-      Length++;
-      FP++;
-    }
-    if (FP != Buffer->getBufferEnd())
-      FP++;
-    Lineno++;
-    return StringRef(start, Length);
-  }
-
-  /// \brief Return true, if we've reached EOF.
-  bool atEOF() const { return FP == Buffer->getBufferEnd(); }
-
-  /// \brief Report a parse error message and stop compilation.
-  void reportParseError(Twine Msg) const {
-    report_fatal_error(Filename + ":" + Twine(Lineno) + ": " + Msg + "\n");
-  }
-
-private:
-  /// \brief Memory buffer holding the text file.
-  OwningPtr<MemoryBuffer> Buffer;
-
-  /// \brief Current position into the memory buffer.
-  const char *FP;
-
-  /// \brief Current line number.
-  int64_t Lineno;
-
-  /// \brief Path name where to the profile file.
-  StringRef Filename;
-};
-
 /// \brief Sample profile pass.
 ///
 /// This pass reads profile data from the file specified by
@@ -267,90 +205,53 @@ void SampleProfile::dump() {
     dumpFunctionProfile(I->getKey());
 }
 
-/// \brief Load samples from a text file.
-///
-/// The file is divided in two segments:
-///
-/// Symbol table (represented with the string "symbol table")
-///    Number of symbols in the table
-///    symbol 1
-///    symbol 2
-///    ...
-///    symbol N
-///
-/// Function body profiles
-///    function1:total_samples:total_head_samples:number_of_locations
-///    location_offset_1: number_of_samples
-///    location_offset_2: number_of_samples
-///    ...
-///    location_offset_N: number_of_samples
+/// \brief Load the samples of the functions in \p M from the profile file.
 ///
-/// Function names must be mangled in order for the profile loader to
-/// match them in the current translation unit.
+/// The format of the file is recognized from its contents.
+void SampleProfile::load(Module &M) {
+  OwningPtr<MemoryBuffer> Buffer;
+  if (error_code EC = MemoryBuffer::getFile(Filename, Buffer))
+    report_fatal_error("Could not open profile file " + Filename + ": " +
+                       EC.message());
+  if (sampleprof::BinaryReader::isBinary(*Buffer))
+    loadBinary(*Buffer, M);
+  else
+    loadText(*Buffer);
+}
+
+/// \brief Load samples from a text file.
 ///
-/// Since this is a flat profile, a function that shows up more than
-/// once gets all its samples aggregated across all its instances.
+/// See SampleProfileFormat.h for the format.  Since this is a flat
+/// profile, a function that shows up more than once gets all its samples
+/// aggregated across all its instances.
 /// TODO - flat profiles are too imprecise to provide good optimization
 /// opportunities. Convert them to context-sensitive profile.
 ///
 /// This textual representation is useful to generate unit tests and
 /// for debugging purposes, but it should not be used to generate
 /// profiles for large programs, as the representation is extremely
-/// inefficient.
-void SampleProfile::loadText() {
-  ExternalProfileTextLoader Loader(Filename);
-
-  // Read the symbol table.
-  StringRef Line = Loader.readLine();
-  if (Line != "symbol table")
-    Loader.reportParseError("Expected 'symbol table', found " + Line);
-  int NumSymbols;
-  Line = Loader.readLine();
-  if (Line.getAsInteger(10, NumSymbols))
-    Loader.reportParseError("Expected a number, found " + Line);
-  for (int I = 0; I < NumSymbols; I++) {
-    StringRef FName = Loader.readLine();
-    FunctionProfile &FProfile = Profiles[FName];
-    FProfile.BodySamples.clear();
-    FProfile.TotalSamples = 0;
-    FProfile.TotalHeadSamples = 0;
-  }
-
-  // Read the profile of each function. Since each function may be
-  // mentioned more than once, and we are collecting flat profiles,
-  // accumulate samples as we parse them.
-  Regex HeadRE("^([^:]+):([0-9]+):([0-9]+):([0-9]+)$");
-  Regex LineSample("^([0-9]+): ([0-9]+)$");
-  while (!Loader.atEOF()) {
-    SmallVector<StringRef, 4> Matches;
-    Line = Loader.readLine();
-    if (!HeadRE.match(Line, &Matches))
-      Loader.reportParseError("Expected 'mangled_name:NUM:NUM:NUM', found " +
-                              Line);
-    assert(Matches.size() == 5);
-    StringRef FName = Matches[1];
-    unsigned NumSamples, NumHeadSamples, NumSampledLines;
-    Matches[2].getAsInteger(10, NumSamples);
-    Matches[3].getAsInteger(10, NumHeadSamples);
-    Matches[4].getAsInteger(10, NumSampledLines);
-    FunctionProfile &FProfile = Profiles[FName];
-    FProfile.TotalSamples += NumSamples;
-    FProfile.TotalHeadSamples += NumHeadSamples;
-    BodySampleMap &SampleMap = FProfile.BodySamples;
-    unsigned I;
-    for (I = 0; I < NumSampledLines && !Loader.atEOF(); I++) {
-      Line = Loader.readLine();
-      if (!LineSample.match(Line, &Matches))
-        Loader.reportParseError("Expected 'NUM: NUM', found " + Line);
-      assert(Matches.size() == 3);
-      unsigned LineOffset, NumSamples;
-      Matches[1].getAsInteger(10, LineOffset);
-      Matches[2].getAsInteger(10, NumSamples);
-      SampleMap[LineOffset] += NumSamples;
-    }
+/// inefficient.  Those should be converted to the binary format.
+void SampleProfile::loadText(const MemoryBuffer &Buffer) {
+  std::string ErrorMsg;
+  if (!sampleprof::readText(Buffer, Profiles, ErrorMsg))
+    report_fatal_error(Filename + ":" + ErrorMsg + "\n");
+}
 
-    if (I < NumSampledLines)
-      Loader.reportParseError("Unexpected end of file");
+/// \brief Load samples from a binary file.
+///
+/// Only the records of the functions defined in \p M are read.
+void SampleProfile::loadBinary(const MemoryBuffer &Buffer, Module &M) {
+  std::string ErrorMsg;
+  OwningPtr<sampleprof::BinaryReader> Reader(
+      sampleprof::BinaryReader::create(Buffer, ErrorMsg));
+  if (!Reader)
+    report_fatal_error(Filename + ": " + ErrorMsg);
+  for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
+    if (I->isDeclaration())
+      continue;
+    if (!Reader->read(I->getName(), Profiles[I->getName()]))
+      report_fatal_error(Filename + ": malformed profile of " +
+                         I->getName());
   }
 }
 
@@ -388,10 +289,8 @@ uint32_t SampleProfile::getInstWeight(Instruction &Inst, unsigned FirstLineno,
 uint32_t SampleProfile::computeBlockWeight(BasicBlock *B, unsigned FirstLineno,
                                            BodySampleMap &BodySamples) {
   // If we've computed B's weight before, return it.
-  Function *F = B->getParent();
-  FunctionProfile &FProfile = Profiles[F->getName()];
   std::pair<BlockWeightMap::iterator, bool> Entry =
-      FProfile.BlockWeights.insert(std::make_pair(B, 0));
+      BlockWeights.insert(std::make_pair(B, 0));
   if (!Entry.second)
     return Entry.first->second;
 
@@ -427,7 +326,13 @@ bool SampleProfile::emitAnnotations(Function &F) {
   MDBuilder MDB(F.getContext());
 
   // Clear the block weights cache.
-  FProfile.BlockWeights.clear();
+  BlockWeights.clear();
+
+  // The samples at the head of the function approximate its entry count.
+  if (FProfile.TotalHeadSamples) {
+    F.setEntryCount(FProfile.TotalHeadSamples);
+    Changed = true;
+  }
 
   // When we find a branch instruction: For each edge E out of the branch,
   // the weight of E is the weight of the target block.
@@ -453,6 +358,60 @@ bool SampleProfile::emitAnnotations(Function &F) {
     Changed = true;
   }
 
+  Changed |= emitCallTargets(F, FirstLineno, FProfile);
+  return Changed;
+}
+
+/// \brief Order call targets by decreasing number of calls.
+static bool compareCallTargets(const std::pair<StringRef, uint64_t> &LHS,
+                               const std::pair<StringRef, uint64_t> &RHS) {
+  if (LHS.second != RHS.second)
+    return LHS.second > RHS.second;
+  return LHS.first < RHS.first;
+}
+
+/// \brief Record the profiled targets of the indirect calls in \p F.
+///
+/// The profiler finds the targets of an indirect call in the branches it
+/// recorded, so every call at a line adds up to the total count of the call
+/// sites there.
+///
+/// \param F The function to annotate.
+/// \param FirstLineno The line number of the first instruction in \p F.
+/// \param FProfile The profile of \p F.
+///
+/// \returns True if any call was annotated.
+bool SampleProfile::emitCallTargets(Function &F, unsigned FirstLineno,
+                                    FunctionProfile &FProfile) {
+  if (FProfile.CallTargets.empty())
+    return false;
+
+  bool Changed = false;
+  MDBuilder MDB(F.getContext());
+  for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I) {
+    CallSite CS(&*I);
+    if (!CS || CS.getCalledFunction() ||
+        isa<InlineAsm>(CS.getCalledValue()))
+      continue;
+    unsigned LOffset = I->getDebugLoc().getLine() - FirstLineno + 1;
+    DenseMap<uint32_t, sampleprof::CallTargetMap>::const_iterator CT =
+        FProfile.CallTargets.find(LOffset);
+    if (CT == FProfile.CallTargets.end())
+      continue;
+
+    SmallVector<std::pair<StringRef, uint64_t>, 4> Targets;
+    uint64_t Total = 0;
+    for (sampleprof::CallTargetMap::const_iterator T = CT->second.begin(),
+                                                   TE = CT->second.end();
+         T != TE; ++T) {
+      Targets.push_back(std::make_pair(StringRef(T->first), T->second));
+      Total += T->second;
+    }
+    std::sort(Targets.begin(), Targets.end(), compareCallTargets);
+    I->setMetadata(LLVMContext::MD_prof,
+                   MDB.createIndirectCallTargets(Total, Targets));
+    Changed = true;
+  }
   return Changed;
 }
 
@@ -466,7 +425,7 @@ bool SampleProfileLoader::runOnFunction(Function &F) {
 
 bool SampleProfileLoader::doInitialization(Module &M) {
   Profiler.reset(new SampleProfile(Filename));
-  Profiler->loadText();
+  Profiler->load(M);
   return true;
 }
 
@@ -40,8 +40,12 @@ void llvm::initializeScalarOpts(PassRegistry &Registry) {
   initializeIndVarSimplifyPass(Registry);
   initializeJumpThreadingPass(Registry);
   initializeLICMPass(Registry);
+  initializeLoopDataPrefetchPass(Registry);
   initializeLoopDeletionPass(Registry);
+  initializeLoopDistributePass(Registry);
+  initializeLoopFusionPass(Registry);
   initializeLoopInstSimplifyPass(Registry);
+  initializeLoopInvariantDivisionPass(Registry);
   initializeLoopRotatePass(Registry);
   initializeLoopStrengthReducePass(Registry);
   initializeLoopRerollPass(Registry);
@@ -8,13 +8,14 @@
 //===----------------------------------------------------------------------===//
 //
 // This file implements the CloneModule interface which makes a copy of an
-// entire module.
+// entire module, and CloneModulePartition which copies part of one.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 using namespace llvm;
@@ -120,3 +121,131 @@ Module *llvm::CloneModule(const Module *M, ValueToValueMapTy &VMap) {
 
   return New;
 }
+
+namespace {
+/// PartitionDeclarer - Declare the global values that a partition refers to
+/// but does not define, the first time they are mapped.
+class PartitionDeclarer : public ValueMaterializer {
+  Module *New;
+
+public:
+  explicit PartitionDeclarer(Module *New) : New(New) {}
+  virtual Value *materializeValueFor(Value *V);
+};
+}
+
+Value *PartitionDeclarer::materializeValueFor(Value *V) {
+  const GlobalValue *GV = dyn_cast<GlobalValue>(V);
+  if (!GV)
+    return 0;
+
+  // Declarations keep their linkage (extern_weak, dllimport); definitions
+  // from other partitions become external, as deleteBody would make them.
+  GlobalValue::LinkageTypes Linkage =
+    GV->isDeclaration() ? GV->getLinkage() : GlobalValue::ExternalLinkage;
+  Type *Ty = GV->getType()->getElementType();
+  unsigned AddrSpace = GV->getType()->getAddressSpace();
+
+  if (const Function *F = dyn_cast<Function>(GV)) {
+    Function *NF =
+      Function::Create(cast<FunctionType>(Ty), Linkage, F->getName(), New);
+    NF->copyAttributesFrom(F);
+    NF->setPrefixData(0);
+    return NF;
+  }
+
+  if (const GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV)) {
+    GlobalVariable *NewGVar =
+      new GlobalVariable(*New, Ty, GVar->isConstant(), Linkage, 0,
+                         GVar->getName(), 0, GVar->getThreadLocalMode(),
+                         AddrSpace);
+    NewGVar->copyAttributesFrom(GVar);
+    return NewGVar;
+  }
+
+  // Aliases cannot be declarations, so declare something of the right kind.
+  GlobalValue *Decl;
+  if (FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+    Decl = Function::Create(FTy, Linkage, GV->getName(), New);
+  else
+    Decl = new GlobalVariable(*New, Ty, false, Linkage, 0, GV->getName(), 0,
+                              GlobalVariable::NotThreadLocal, AddrSpace);
+  Decl->setVisibility(GV->getVisibility());
+  return Decl;
+}
+
+Module *llvm::CloneModulePartition(const Module *M,
+                                   ArrayRef<const GlobalValue *> Definitions,
+                                   ValueToValueMapTy &VMap) {
+  Module *New = new Module(M->getModuleIdentifier(), M->getContext());
+  New->setDataLayout(M->getDataLayout());
+  New->setTargetTriple(M->getTargetTriple());
+
+  // Create all of the definitions before mapping anything, so that references
+  // between them are not taken for references out of the partition.
+  for (unsigned i = 0, e = Definitions.size(); i != e; ++i) {
+    const GlobalValue *GV = Definitions[i];
+    GlobalValue *NewGV;
+    if (const Function *F = dyn_cast<Function>(GV)) {
+      NewGV = Function::Create(cast<FunctionType>(GV->getType()
+                                                    ->getElementType()),
+                               F->getLinkage(), F->getName(), New);
+    } else if (const GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV)) {
+      NewGV = new GlobalVariable(*New, GVar->getType()->getElementType(),
+                                 GVar->isConstant(), GVar->getLinkage(),
+                                 (Constant*) 0, GVar->getName(),
+                                 (GlobalVariable*) 0,
+                                 GVar->getThreadLocalMode(),
+                                 GVar->getType()->getAddressSpace());
+    } else {
+      NewGV = new GlobalAlias(GV->getType(), GV->getLinkage(), GV->getName(),
+                              NULL, New);
+    }
+    NewGV->copyAttributesFrom(GV);
+    VMap[GV] = NewGV;
+  }
+
+  // Everything else is declared on demand while the initializers, bodies and
+  // aliasees are copied.
+  PartitionDeclarer Declarer(New);
+  for (unsigned i = 0, e = Definitions.size(); i != e; ++i) {
+    const GlobalValue *GV = Definitions[i];
+    if (const Function *I = dyn_cast<Function>(GV)) {
+      if (I->isDeclaration())
+        continue;
+      Function *F = cast<Function>(VMap[I]);
+      Function::arg_iterator DestI = F->arg_begin();
+      for (Function::const_arg_iterator J = I->arg_begin(); J != I->arg_end();
+           ++J) {
+        DestI->setName(J->getName());
+        VMap[J] = DestI++;
+      }
+
+      SmallVector<ReturnInst*, 8> Returns;  // Ignore returns cloned.
+      CloneFunctionInto(F, I, VMap, /*ModuleLevelChanges=*/true, Returns, "",
+                        0, 0, &Declarer);
+    } else if (const GlobalVariable *I = dyn_cast<GlobalVariable>(GV)) {
+      if (I->hasInitializer())
+        cast<GlobalVariable>(VMap[I])->setInitializer(
+          MapValue(I->getInitializer(), VMap, RF_None, 0, &Declarer));
+    } else {
+      const GlobalAlias *GA = cast<GlobalAlias>(GV);
+      if (const Constant *C = GA->getAliasee())
+        cast<GlobalAlias>(VMap[GA])->setAliasee(
+          MapValue(C, VMap, RF_None, 0, &Declarer));
+    }
+  }
+
+  // Named metadata, such as the debug info compile units, may refer to
+  // functions of every partition; those are declared like the rest.
+  for (Module::const_named_metadata_iterator I = M->named_metadata_begin(),
+         E = M->named_metadata_end(); I != E; ++I) {
+    const NamedMDNode &NMD = *I;
+    NamedMDNode *NewNMD = New->getOrInsertNamedMetadata(NMD.getName());
+    for (unsigned i = 0, e = NMD.getNumOperands(); i != e; ++i)
+      NewNMD->addOperand(MapValue(NMD.getOperand(i), VMap, RF_None, 0,
+                                  &Declarer));
+  }
+
+  return New;
+}
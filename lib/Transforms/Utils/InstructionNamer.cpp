@@ -31,6 +31,9 @@ namespace {
       Info.setPreservesAll();
     }
 
+    // Naming only touches the function's own symbol table.
+    bool isFunctionLocal() const { return true; }
+
     bool runOnFunction(Function &F) {
       for (Function::arg_iterator AI = F.arg_begin(), AE = F.arg_end();
            AI != AE; ++AI)
@@ -0,0 +1,393 @@
+//===- SampleProfileFormat.cpp - Sample profile file formats --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the text and binary sample profile formats.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SampleProfileFormat.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+using namespace sampleprof;
+
+static const char Magic[] = "LLVMSPRF";
+static const uint32_t Version = 2;
+static const size_t MagicSize = sizeof(Magic) - 1;
+static const size_t HeaderSize = MagicSize + 8;
+static const size_t IndexEntrySize = 16;
+
+//===----------------------------------------------------------------------===//
+// Text format
+//===----------------------------------------------------------------------===//
+
+/// parseNumber - Parse a nonempty string of decimal digits.
+static bool parseNumber(StringRef S, unsigned &N) {
+  if (S.empty() || S.find_first_not_of("0123456789") != StringRef::npos)
+    return false;
+  return !S.getAsInteger(10, N);
+}
+
+namespace {
+/// LineReader - Splits a buffer into lines as they are needed, counting
+/// them for error messages.
+class LineReader {
+  StringRef Rest;
+  unsigned Lineno;
+
+public:
+  explicit LineReader(StringRef Text) : Rest(Text), Lineno(0) {}
+
+  bool atEOF() const { return Rest.empty(); }
+
+  StringRef readLine() {
+    std::pair<StringRef, StringRef> Split = Rest.split('\n');
+    Rest = Split.second;
+    ++Lineno;
+    return Split.first;
+  }
+
+  bool error(const Twine &Msg, std::string &ErrorMsg) const {
+    ErrorMsg = (Twine(Lineno) + ": " + Msg).str();
+    return false;
+  }
+};
+}
+
+/// The text format is divided in two segments:
+///
+/// Symbol table (represented with the string "symbol table")
+///    Number of symbols in the table
+///    symbol 1
+///    ...
+///    symbol N
+///
+/// Function body profiles
+///    function1:total_samples:total_head_samples:number_of_locations
+///    location_offset_1: number_of_samples [target:number_of_samples ...]
+///    ...
+///    location_offset_N: number_of_samples [target:number_of_samples ...]
+///
+/// The optional targets of a location are the functions that the indirect
+/// calls at it called, by name.
+///
+/// A function that shows up more than once gets all its samples aggregated
+/// across all its instances.
+bool sampleprof::readText(const MemoryBuffer &Buffer, ProfileMap &Profiles,
+                          std::string &ErrorMsg) {
+  LineReader Reader(Buffer.getBuffer());
+
+  // Read the symbol table.
+  StringRef Line = Reader.readLine();
+  if (Line != "symbol table")
+    return Reader.error("Expected 'symbol table', found " + Line, ErrorMsg);
+  unsigned NumSymbols;
+  Line = Reader.readLine();
+  if (!parseNumber(Line, NumSymbols))
+    return Reader.error("Expected a number, found " + Line, ErrorMsg);
+  for (unsigned I = 0; I < NumSymbols; ++I)
+    Profiles.GetOrCreateValue(Reader.readLine());
+
+  // Read the profile of each function.  Since each function may be
+  // mentioned more than once, accumulate samples as we parse them.
+  while (!Reader.atEOF()) {
+    Line = Reader.readLine();
+    SmallVector<StringRef, 4> Fields;
+    Line.split(Fields, ":");
+    unsigned NumSamples, NumHeadSamples, NumSampledLines;
+    if (Fields.size() != 4 || Fields[0].empty() ||
+        !parseNumber(Fields[1], NumSamples) ||
+        !parseNumber(Fields[2], NumHeadSamples) ||
+        !parseNumber(Fields[3], NumSampledLines))
+      return Reader.error("Expected 'mangled_name:NUM:NUM:NUM', found " +
+                          Line, ErrorMsg);
+    FunctionSamples &FS = Profiles[Fields[0]];
+    FS.TotalSamples += NumSamples;
+    FS.TotalHeadSamples += NumHeadSamples;
+
+    for (unsigned I = 0; I < NumSampledLines; ++I) {
+      if (Reader.atEOF())
+        return Reader.error("Unexpected end of file", ErrorMsg);
+      Line = Reader.readLine();
+      std::pair<StringRef, StringRef> Sample = Line.split(": ");
+      SmallVector<StringRef, 4> Counts;
+      Sample.second.split(Counts, " ", -1, /*KeepEmpty=*/false);
+      unsigned LineOffset, NumSamples;
+      if (!parseNumber(Sample.first, LineOffset) || Counts.empty() ||
+          !parseNumber(Counts[0], NumSamples))
+        return Reader.error("Expected 'NUM: NUM', found " + Line, ErrorMsg);
+      FS.BodySamples[LineOffset] += NumSamples;
+
+      for (unsigned J = 1, JE = Counts.size(); J != JE; ++J) {
+        std::pair<StringRef, StringRef> Target = Counts[J].rsplit(':');
+        unsigned NumCalls;
+        if (Target.first.empty() || !parseNumber(Target.second, NumCalls))
+          return Reader.error("Expected 'mangled_name:NUM', found " +
+                              Counts[J], ErrorMsg);
+        FS.CallTargets[LineOffset][Target.first] += NumCalls;
+      }
+    }
+  }
+  return true;
+}
+
+/// getSortedNames - Return the names in Profiles in sorted order, so that
+/// the files written do not depend on the layout of the map.
+static std::vector<StringRef> getSortedNames(const ProfileMap &Profiles) {
+  std::vector<StringRef> Names;
+  for (ProfileMap::const_iterator I = Profiles.begin(), E = Profiles.end();
+       I != E; ++I)
+    Names.push_back(I->getKey());
+  std::sort(Names.begin(), Names.end());
+  return Names;
+}
+
+/// getSortedLines - Return the sampled lines of FS in order.
+static std::vector<std::pair<uint32_t, uint32_t> >
+getSortedLines(const FunctionSamples &FS) {
+  std::vector<std::pair<uint32_t, uint32_t> > Lines(FS.BodySamples.begin(),
+                                                    FS.BodySamples.end());
+  std::sort(Lines.begin(), Lines.end());
+  return Lines;
+}
+
+void sampleprof::writeText(const ProfileMap &Profiles, raw_ostream &OS) {
+  std::vector<StringRef> Names = getSortedNames(Profiles);
+  OS << "symbol table\n" << Names.size() << "\n";
+  for (unsigned i = 0, e = Names.size(); i != e; ++i)
+    OS << Names[i] << "\n";
+
+  for (unsigned i = 0, e = Names.size(); i != e; ++i) {
+    const FunctionSamples &FS = Profiles.find(Names[i])->getValue();
+    std::vector<std::pair<uint32_t, uint32_t> > Lines = getSortedLines(FS);
+    OS << Names[i] << ":" << FS.TotalSamples << ":" << FS.TotalHeadSamples
+       << ":" << Lines.size() << "\n";
+    for (unsigned j = 0, je = Lines.size(); j != je; ++j) {
+      OS << Lines[j].first << ": " << Lines[j].second;
+      DenseMap<uint32_t, CallTargetMap>::const_iterator CT =
+          FS.CallTargets.find(Lines[j].first);
+      if (CT != FS.CallTargets.end())
+        for (CallTargetMap::const_iterator I = CT->second.begin(),
+                                           IE = CT->second.end();
+             I != IE; ++I)
+          OS << " " << I->first << ":" << I->second;
+      OS << "\n";
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Binary format
+//===----------------------------------------------------------------------===//
+
+static uint64_t hashName(StringRef Name) { return HashString(Name); }
+
+static void write32(raw_ostream &OS, uint32_t V) {
+  char Buf[4];
+  support::endian::write<uint32_t, support::little, support::unaligned>(Buf, V);
+  OS.write(Buf, sizeof(Buf));
+}
+
+static void write64(raw_ostream &OS, uint64_t V) {
+  char Buf[8];
+  support::endian::write<uint64_t, support::little, support::unaligned>(Buf, V);
+  OS.write(Buf, sizeof(Buf));
+}
+
+static uint32_t read32(const char *P) {
+  return support::endian::read<uint32_t, support::little, support::unaligned>(
+      P);
+}
+
+static uint64_t read64(const char *P) {
+  return support::endian::read<uint64_t, support::little, support::unaligned>(
+      P);
+}
+
+/// getCallTargets - Return the call targets of line Line of FS, or null if
+/// there are none.
+static const CallTargetMap *getCallTargets(const FunctionSamples &FS,
+                                           uint32_t Line) {
+  DenseMap<uint32_t, CallTargetMap>::const_iterator I =
+      FS.CallTargets.find(Line);
+  return I == FS.CallTargets.end() ? 0 : &I->second;
+}
+
+/// getRecordSize - Return the size of the binary record of FS.
+static uint64_t getRecordSize(StringRef Name, const FunctionSamples &FS) {
+  uint64_t Size = 4 + Name.size() + 12;
+  for (DenseMap<uint32_t, uint32_t>::const_iterator
+           I = FS.BodySamples.begin(), E = FS.BodySamples.end();
+       I != E; ++I) {
+    Size += 12;
+    if (const CallTargetMap *Targets = getCallTargets(FS, I->first))
+      for (CallTargetMap::const_iterator T = Targets->begin(),
+                                         TE = Targets->end();
+           T != TE; ++T)
+        Size += 8 + T->first.size();
+  }
+  return Size;
+}
+
+void sampleprof::writeBinary(const ProfileMap &Profiles, raw_ostream &OS) {
+  std::vector<StringRef> Names = getSortedNames(Profiles);
+
+  // Lay out the records in name order, then sort the index by hash.
+  std::vector<std::pair<uint64_t, uint64_t> > Index;
+  uint64_t Offset = HeaderSize + IndexEntrySize * Names.size();
+  for (unsigned i = 0, e = Names.size(); i != e; ++i) {
+    Index.push_back(std::make_pair(hashName(Names[i]), Offset));
+    Offset += getRecordSize(Names[i], Profiles.find(Names[i])->getValue());
+  }
+  std::sort(Index.begin(), Index.end());
+
+  OS.write(Magic, MagicSize);
+  write32(OS, Version);
+  write32(OS, Names.size());
+  for (unsigned i = 0, e = Index.size(); i != e; ++i) {
+    write64(OS, Index[i].first);
+    write64(OS, Index[i].second);
+  }
+
+  for (unsigned i = 0, e = Names.size(); i != e; ++i) {
+    const FunctionSamples &FS = Profiles.find(Names[i])->getValue();
+    std::vector<std::pair<uint32_t, uint32_t> > Lines = getSortedLines(FS);
+    write32(OS, Names[i].size());
+    OS << Names[i];
+    write32(OS, FS.TotalSamples);
+    write32(OS, FS.TotalHeadSamples);
+    write32(OS, Lines.size());
+    for (unsigned j = 0, je = Lines.size(); j != je; ++j) {
+      write32(OS, Lines[j].first);
+      write32(OS, Lines[j].second);
+      const CallTargetMap *Targets = getCallTargets(FS, Lines[j].first);
+      write32(OS, Targets ? Targets->size() : 0);
+      if (!Targets)
+        continue;
+      for (CallTargetMap::const_iterator T = Targets->begin(),
+                                         TE = Targets->end();
+           T != TE; ++T) {
+        write32(OS, T->first.size());
+        OS << T->first;
+        write32(OS, T->second);
+      }
+    }
+  }
+}
+
+bool BinaryReader::isBinary(const MemoryBuffer &Buffer) {
+  return Buffer.getBuffer().startswith(StringRef(Magic, MagicSize));
+}
+
+BinaryReader *BinaryReader::create(const MemoryBuffer &Buffer,
+                                   std::string &ErrorMsg) {
+  if (Buffer.getBufferSize() < HeaderSize || !isBinary(Buffer)) {
+    ErrorMsg = "not a binary sample profile";
+    return 0;
+  }
+  const char *Start = Buffer.getBufferStart();
+  uint32_t FileVersion = read32(Start + MagicSize);
+  if (FileVersion != 1 && FileVersion != Version) {
+    ErrorMsg = "unsupported binary sample profile version";
+    return 0;
+  }
+  uint64_t NumFunctions = read32(Start + MagicSize + 4);
+  if (Buffer.getBufferSize() < HeaderSize + IndexEntrySize * NumFunctions) {
+    ErrorMsg = "truncated binary sample profile index";
+    return 0;
+  }
+  return new BinaryReader(Buffer, FileVersion, NumFunctions);
+}
+
+bool BinaryReader::readRecord(uint64_t Offset, StringRef &Name,
+                              FunctionSamples *Samples) const {
+  uint64_t Size = Buffer.getBufferSize();
+  const char *Start = Buffer.getBufferStart();
+  if (Offset > Size || Size - Offset < 4)
+    return false;
+  uint64_t NameSize = read32(Start + Offset);
+  Offset += 4;
+  if (Size - Offset < NameSize + 12)
+    return false;
+  Name = StringRef(Start + Offset, NameSize);
+  Offset += NameSize;
+  if (!Samples)
+    return true;
+
+  uint64_t NumLines = read32(Start + Offset + 8);
+  uint64_t LineSize = FileVersion == 1 ? 8 : 12;
+  if ((Size - Offset - 12) / LineSize < NumLines)
+    return false;
+  Samples->TotalSamples += read32(Start + Offset);
+  Samples->TotalHeadSamples += read32(Start + Offset + 4);
+  Offset += 12;
+  for (uint64_t i = 0; i != NumLines; ++i) {
+    if (Size - Offset < LineSize)
+      return false;
+    uint32_t Line = read32(Start + Offset);
+    Samples->BodySamples[Line] += read32(Start + Offset + 4);
+    uint64_t NumTargets = FileVersion == 1 ? 0 : read32(Start + Offset + 8);
+    Offset += LineSize;
+    for (uint64_t j = 0; j != NumTargets; ++j) {
+      if (Size - Offset < 4)
+        return false;
+      uint64_t TargetSize = read32(Start + Offset);
+      Offset += 4;
+      if (Size - Offset < TargetSize + 4)
+        return false;
+      std::string Target(Start + Offset, TargetSize);
+      Offset += TargetSize;
+      Samples->CallTargets[Line][Target] += read32(Start + Offset);
+      Offset += 4;
+    }
+  }
+  return true;
+}
+
+bool BinaryReader::read(StringRef Name, FunctionSamples &Samples) const {
+  // Binary search the index for the first entry with the hash of Name.
+  const char *Index = Buffer.getBufferStart() + HeaderSize;
+  uint64_t Hash = hashName(Name);
+  unsigned Lo = 0, Hi = NumFunctions;
+  while (Lo < Hi) {
+    unsigned Mid = Lo + (Hi - Lo) / 2;
+    if (read64(Index + IndexEntrySize * Mid) < Hash)
+      Lo = Mid + 1;
+    else
+      Hi = Mid;
+  }
+
+  for (; Lo != NumFunctions && read64(Index + IndexEntrySize * Lo) == Hash;
+       ++Lo) {
+    uint64_t Offset = read64(Index + IndexEntrySize * Lo + 8);
+    StringRef RecordName;
+    if (!readRecord(Offset, RecordName, 0))
+      return false;
+    if (RecordName == Name)
+      return readRecord(Offset, RecordName, &Samples);
+  }
+  return true;
+}
+
+bool BinaryReader::readAll(ProfileMap &Profiles) const {
+  const char *Index = Buffer.getBufferStart() + HeaderSize;
+  for (unsigned i = 0; i != NumFunctions; ++i) {
+    uint64_t Offset = read64(Index + IndexEntrySize * i + 8);
+    StringRef Name;
+    if (!readRecord(Offset, Name, 0) ||
+        !readRecord(Offset, Name, &Profiles[Name]))
+      return false;
+  }
+  return true;
+}
@@ -1804,6 +1804,10 @@ static bool FoldTwoEntryPHINode(PHINode *PN, const DataLayout *TD) {
   Instruction *InsertPt = DomBlock->getTerminator();
   IRBuilder<true, NoFolder> Builder(InsertPt);
 
+  // The selects keep the branch weights, so that CodeGenPrepare can turn
+  // them back into a branch if the condition is predictable.
+  MDNode *Weights = InsertPt->getMetadata(LLVMContext::MD_prof);
+
   // Move all 'aggressive' instructions, which are defined in the
   // conditional parts of the if's up to the dominating block.
   if (IfBlock1)
@@ -1822,6 +1826,8 @@ static bool FoldTwoEntryPHINode(PHINode *PN, const DataLayout *TD) {
 
     SelectInst *NV =
       cast<SelectInst>(Builder.CreateSelect(IfCond, TrueVal, FalseVal, ""));
+    if (Weights)
+      NV->setMetadata(LLVMContext::MD_prof, Weights);
     PN->replaceAllUsesWith(NV);
     NV->takeName(PN);
     PN->eraseFromParent();
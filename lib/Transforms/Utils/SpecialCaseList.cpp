@@ -28,24 +28,131 @@
 #include "llvm/Support/Regex.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
+#include <algorithm>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 
+namespace {
+/// A set of patterns whose only metacharacter is '*', matching any string.
+/// The patterns are kept in a trie keyed by the literal text before their
+/// first '*', so matching a query walks the trie along the query and only
+/// looks at the patterns whose prefix the query starts with.  The rest of
+/// such a pattern is checked by comparing its last literal piece with the
+/// end of the query and then finding the other pieces, in order, in between.
+class GlobSet {
+  struct Node {
+    /// Children of the node, sorted by character.
+    std::vector<std::pair<char, unsigned> > Children;
+    /// Indices in Globs of the patterns whose prefix ends at this node.
+    std::vector<unsigned> Globs;
+  };
+
+  /// The trie, rooted at Nodes[0].
+  std::vector<Node> Nodes;
+  /// For each pattern, the literal pieces following its first '*'.
+  std::vector<std::vector<std::string> > Globs;
+
+  /// Return the index of the child of node N for character C, or 0 if there
+  /// is none.
+  unsigned getChild(unsigned N, char C) const {
+    const std::vector<std::pair<char, unsigned> > &Children =
+        Nodes[N].Children;
+    std::vector<std::pair<char, unsigned> >::const_iterator I =
+        std::lower_bound(Children.begin(), Children.end(),
+                         std::make_pair(C, 0u));
+    return I != Children.end() && I->first == C ? I->second : 0;
+  }
+
+  /// Return whether Query matches '*' followed by Pieces joined with '*'.
+  static bool matchPieces(const std::vector<std::string> &Pieces,
+                          StringRef Query) {
+    StringRef Last = Pieces.back();
+    if (!Query.endswith(Last))
+      return false;
+    Query = Query.drop_back(Last.size());
+    for (size_t i = 0, e = Pieces.size() - 1; i != e; ++i) {
+      size_t Pos = Query.find(Pieces[i]);
+      if (Pos == StringRef::npos)
+        return false;
+      Query = Query.substr(Pos + Pieces[i].size());
+    }
+    return true;
+  }
+
+public:
+  GlobSet() : Nodes(1) {}
+
+  /// Return whether Pattern can be added to a GlobSet.
+  static bool isGlob(StringRef Pattern) {
+    if (Pattern.find('*') == StringRef::npos)
+      return false;
+    std::string Rest = Pattern;
+    Rest.erase(std::remove(Rest.begin(), Rest.end(), '*'), Rest.end());
+    return Regex::isLiteralERE(Rest);
+  }
+
+  void insert(StringRef Pattern) {
+    assert(isGlob(Pattern) && "Not a glob!");
+    SmallVector<StringRef, 4> Pieces;
+    Pattern.split(Pieces, "*");
+
+    unsigned N = 0;
+    StringRef Prefix = Pieces[0];
+    for (size_t i = 0, e = Prefix.size(); i != e; ++i) {
+      unsigned Child = getChild(N, Prefix[i]);
+      if (!Child) {
+        Child = Nodes.size();
+        Nodes.push_back(Node());
+        std::vector<std::pair<char, unsigned> > &Children = Nodes[N].Children;
+        Children.insert(std::lower_bound(Children.begin(), Children.end(),
+                                         std::make_pair(Prefix[i], 0u)),
+                        std::make_pair(Prefix[i], Child));
+      }
+      N = Child;
+    }
+
+    Nodes[N].Globs.push_back(Globs.size());
+    Globs.push_back(std::vector<std::string>(Pieces.begin() + 1, Pieces.end()));
+  }
+
+  bool empty() const { return Globs.empty(); }
+
+  bool match(StringRef Query) const {
+    unsigned N = 0;
+    for (size_t Depth = 0;; ++Depth) {
+      const std::vector<unsigned> &NodeGlobs = Nodes[N].Globs;
+      for (size_t i = 0, e = NodeGlobs.size(); i != e; ++i)
+        if (matchPieces(Globs[NodeGlobs[i]], Query.substr(Depth)))
+          return true;
+      if (Depth == Query.size())
+        return false;
+      N = getChild(N, Query[Depth]);
+      if (!N)
+        return false;
+    }
+  }
+};
+}
+
 /// Represents a set of regular expressions.  Regular expressions which are
-/// "literal" (i.e. no regex metacharacters) are stored in Strings, while all
-/// others are represented as a single pipe-separated regex in RegEx.  The
-/// reason for doing so is efficiency; StringSet is much faster at matching
-/// literal strings than Regex.
+/// "literal" (i.e. no regex metacharacters) are stored in Strings, the ones
+/// whose only metacharacter is the '*' wildcard in Globs, while all others are
+/// represented as a single pipe-separated regex in RegEx.  The reason for
+/// doing so is efficiency; StringSet and GlobSet are much faster at matching
+/// than Regex, which tries every alternative of a long regex in turn.
 struct SpecialCaseList::Entry {
   StringSet<> Strings;
+  GlobSet Globs;
   Regex *RegEx;
 
   Entry() : RegEx(0) {}
 
   bool match(StringRef Query) const {
-    return Strings.count(Query) || (RegEx && RegEx->match(Query));
+    return Strings.count(Query) || (!Globs.empty() && Globs.match(Query)) ||
+           (RegEx && RegEx->match(Query));
   }
 };
 
@@ -123,6 +230,12 @@ bool SpecialCaseList::parse(const MemoryBuffer *MB, std::string &Error) {
       continue;
     }
 
+    // ...or in Globs.
+    if (GlobSet::isGlob(Regexp)) {
+      Entries[Prefix][Category].Globs.insert(Regexp);
+      continue;
+    }
+
     // Replace * with .*
     for (size_t pos = 0; (pos = Regexp.find("*", pos)) != std::string::npos;
          pos += strlen(".*")) {
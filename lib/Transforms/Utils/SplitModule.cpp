@@ -0,0 +1,288 @@
+//===- SplitModule.cpp - Split a module into partitions -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the functions in llvm/Transforms/Utils/SplitModule.h.
+//
+// Partitioning works on equivalence classes of global values that have to be
+// emitted into the same object file.  The classes are then distributed over
+// the partitions greedily, largest first, to keep the amount of code per
+// partition roughly equal.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/IntEqClasses.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalAlias.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include <algorithm>
+
+using namespace llvm;
+
+namespace {
+/// GlobalNumbering - Number the global values of a module in the order
+/// documented for partitionModule.
+class GlobalNumbering {
+  DenseMap<const GlobalValue *, unsigned> Numbers;
+  std::vector<GlobalValue *> Globals;
+
+public:
+  explicit GlobalNumbering(Module &M) {
+    for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I)
+      add(I);
+    for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+         I != E; ++I)
+      add(I);
+    for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
+         I != E; ++I)
+      add(I);
+  }
+
+  void add(GlobalValue *GV) {
+    Numbers[GV] = Globals.size();
+    Globals.push_back(GV);
+  }
+
+  unsigned size() const { return Globals.size(); }
+  GlobalValue *operator[](unsigned N) const { return Globals[N]; }
+  unsigned getNumber(const GlobalValue *GV) const {
+    DenseMap<const GlobalValue *, unsigned>::const_iterator I =
+      Numbers.find(GV);
+    assert(I != Numbers.end() && "Global value is not numbered");
+    return I->second;
+  }
+};
+
+struct ClassWeight {
+  unsigned Class;
+  uint64_t Weight;
+  ClassWeight(unsigned Class, uint64_t Weight) : Class(Class), Weight(Weight) {}
+
+  /// Heavier classes first; ties are broken by class number so that the
+  /// assignment is deterministic.
+  bool operator<(const ClassWeight &RHS) const {
+    if (Weight != RHS.Weight)
+      return Weight > RHS.Weight;
+    return Class < RHS.Class;
+  }
+};
+} // end anonymous namespace
+
+/// findReferencingGlobals - Collect into Refs the global values whose
+/// definitions refer to V, looking through constants.
+static void findReferencingGlobals(const Value *V,
+                                   SmallPtrSet<const Constant *, 16> &Visited,
+                                   SmallVectorImpl<const GlobalValue *> &Refs) {
+  for (Value::const_use_iterator UI = V->use_begin(), UE = V->use_end();
+       UI != UE; ++UI) {
+    const User *U = *UI;
+    if (const Instruction *I = dyn_cast<Instruction>(U))
+      Refs.push_back(I->getParent()->getParent());
+    else if (const GlobalValue *GV = dyn_cast<GlobalValue>(U))
+      Refs.push_back(GV);
+    else if (const Constant *C = dyn_cast<Constant>(U))
+      if (Visited.insert(C))
+        findReferencingGlobals(C, Visited, Refs);
+  }
+}
+
+/// mustBeInFirstPartition - Return true if GV has to be emitted exactly once
+/// and therefore lives in partition 0.
+static bool mustBeInFirstPartition(const GlobalValue *GV) {
+  return GV->hasAppendingLinkage() || GV->getName().startswith("llvm.");
+}
+
+/// getWeight - Return an estimate of the code generation cost of GV.
+static uint64_t getWeight(const GlobalValue *GV) {
+  const Function *F = dyn_cast<Function>(GV);
+  if (!F)
+    return 1;
+  uint64_t Weight = 1;
+  for (Function::const_iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
+    Weight += BB->size();
+  return Weight;
+}
+
+void llvm::partitionModule(Module &M, unsigned N,
+                           std::vector<unsigned> &Partition) {
+  assert(N != 0 && "Cannot split a module into zero partitions");
+  GlobalNumbering Globals(M);
+  Partition.assign(Globals.size(), 0);
+  if (N == 1 || Globals.size() == 0)
+    return;
+
+  // Join the global values that have to end up in the same partition.
+  IntEqClasses Classes(Globals.size());
+  SmallVector<const GlobalValue *, 8> Refs;
+  SmallPtrSet<const Constant *, 16> Visited;
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I) {
+    GlobalValue *GV = Globals[I];
+    if (GlobalAlias *GA = dyn_cast<GlobalAlias>(GV)) {
+      if (const GlobalValue *Aliasee = GA->getAliasedGlobal())
+        Classes.join(I, Globals.getNumber(Aliasee));
+      continue;
+    }
+
+    // A blockaddress can only be emitted next to the function it refers to.
+    for (Value::use_iterator UI = GV->use_begin(), UE = GV->use_end();
+         UI != UE; ++UI) {
+      BlockAddress *BA = dyn_cast<BlockAddress>(*UI);
+      if (!BA)
+        continue;
+      Refs.clear();
+      Visited.clear();
+      findReferencingGlobals(BA, Visited, Refs);
+      for (unsigned R = 0, RE = Refs.size(); R != RE; ++R)
+        Classes.join(I, Globals.getNumber(Refs[R]));
+    }
+  }
+  Classes.compress();
+
+  // Weigh the classes and hand them out, largest first, to the partition with
+  // the least amount of code so far.  Everything that has to be unique goes to
+  // partition 0 up front.
+  std::vector<uint64_t> ClassWeights(Classes.getNumClasses(), 0);
+  std::vector<bool> IsFirstPartitionClass(Classes.getNumClasses(), false);
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I) {
+    const GlobalValue *GV = Globals[I];
+    if (GV->isDeclaration())
+      continue;
+    ClassWeights[Classes[I]] += getWeight(GV);
+    if (mustBeInFirstPartition(GV))
+      IsFirstPartitionClass[Classes[I]] = true;
+  }
+
+  std::vector<uint64_t> PartitionWeights(N, 0);
+  std::vector<unsigned> ClassPartition(Classes.getNumClasses(), 0);
+  std::vector<ClassWeight> Worklist;
+  for (unsigned C = 0, CE = Classes.getNumClasses(); C != CE; ++C) {
+    if (IsFirstPartitionClass[C])
+      PartitionWeights[0] += ClassWeights[C];
+    else if (ClassWeights[C] != 0)
+      Worklist.push_back(ClassWeight(C, ClassWeights[C]));
+  }
+  std::sort(Worklist.begin(), Worklist.end());
+  for (unsigned W = 0, WE = Worklist.size(); W != WE; ++W) {
+    unsigned Lightest = std::min_element(PartitionWeights.begin(),
+                                         PartitionWeights.end()) -
+                        PartitionWeights.begin();
+    ClassPartition[Worklist[W].Class] = Lightest;
+    PartitionWeights[Lightest] += Worklist[W].Weight;
+  }
+
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I)
+    Partition[I] = ClassPartition[Classes[I]];
+
+  // Local symbols that are referenced from another partition have to become
+  // visible to the linker.  Rename them so they cannot clash with symbols
+  // from outside the module.
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I) {
+    GlobalValue *GV = Globals[I];
+    if (!GV->hasLocalLinkage())
+      continue;
+    Refs.clear();
+    Visited.clear();
+    findReferencingGlobals(GV, Visited, Refs);
+    bool ReferencedElsewhere = false;
+    for (unsigned R = 0, RE = Refs.size(); R != RE && !ReferencedElsewhere;
+         ++R)
+      ReferencedElsewhere =
+        Partition[Globals.getNumber(Refs[R])] != Partition[I];
+    if (!ReferencedElsewhere)
+      continue;
+
+    GV->setName((GV->hasName() ? GV->getName() : "anon") + ".llvm.part");
+    GV->setLinkage(GlobalValue::ExternalLinkage);
+    GV->setVisibility(GlobalValue::HiddenVisibility);
+  }
+}
+
+void llvm::extractPartition(Module &M, ArrayRef<unsigned> Partition,
+                            unsigned P) {
+  GlobalNumbering Globals(M);
+  assert(Globals.size() == Partition.size() &&
+         "Module does not match the partitioning");
+
+  // Drop the definitions owned by other partitions.  Aliases cannot be
+  // declarations, so they are replaced by a declaration of the right kind
+  // once every body referring to them is gone.
+  SmallVector<GlobalAlias *, 8> DeadAliases;
+  SmallVector<GlobalVariable *, 8> DeadGlobals;
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I) {
+    if (Partition[I] == P)
+      continue;
+    GlobalValue *GV = Globals[I];
+    if (Function *F = dyn_cast<Function>(GV)) {
+      if (!F->isDeclaration())
+        F->deleteBody();
+    } else if (GlobalVariable *GVar = dyn_cast<GlobalVariable>(GV)) {
+      if (GVar->hasAppendingLinkage()) {
+        DeadGlobals.push_back(GVar);
+      } else if (!GVar->isDeclaration()) {
+        GVar->setInitializer(0);
+        GVar->setLinkage(GlobalValue::ExternalLinkage);
+      }
+    } else {
+      DeadAliases.push_back(cast<GlobalAlias>(GV));
+    }
+  }
+
+  for (unsigned I = 0, E = DeadGlobals.size(); I != E; ++I)
+    DeadGlobals[I]->eraseFromParent();
+
+  for (unsigned I = 0, E = DeadAliases.size(); I != E; ++I) {
+    GlobalAlias *GA = DeadAliases[I];
+    Type *Ty = GA->getType()->getElementType();
+    GlobalValue *Decl;
+    if (FunctionType *FTy = dyn_cast<FunctionType>(Ty))
+      Decl = Function::Create(FTy, GlobalValue::ExternalLinkage, "", &M);
+    else
+      Decl = new GlobalVariable(M, Ty, false, GlobalValue::ExternalLinkage, 0,
+                                "", 0, GlobalVariable::NotThreadLocal,
+                                GA->getType()->getAddressSpace());
+    Decl->takeName(GA);
+    Decl->setVisibility(GA->getVisibility());
+    GA->replaceAllUsesWith(Decl);
+    GA->eraseFromParent();
+  }
+
+  if (P != 0)
+    M.setModuleInlineAsm("");
+}
+
+bool llvm::materializePartition(Module &M, ArrayRef<unsigned> Partition,
+                                unsigned P, std::string *ErrMsg) {
+  GlobalNumbering Globals(M);
+  assert(Globals.size() == Partition.size() &&
+         "Module does not match the partitioning");
+
+  // Functions are numbered first.  A body that is not read leaves its
+  // function a declaration, which extractPartition would not touch, so give
+  // it the linkage deleteBody would have.
+  for (unsigned I = 0, E = Globals.size(); I != E; ++I) {
+    Function *F = dyn_cast<Function>(Globals[I]);
+    if (!F)
+      break;
+    if (!F->isMaterializable())
+      continue;
+    if (Partition[I] != P)
+      F->setLinkage(GlobalValue::ExternalLinkage);
+    else if (M.Materialize(F, ErrMsg))
+      return true;
+  }
+  M.dropMaterializer();
+  return false;
+}
@@ -187,9 +187,12 @@ void llvm::RemapInstruction(Instruction *I, ValueToValueMapTy &VMap,
   for (User::op_iterator op = I->op_begin(), E = I->op_end(); op != E; ++op) {
     Value *V = MapValue(*op, VMap, Flags, TypeMapper, Materializer);
     // If we aren't ignoring missing entries, assert that something happened.
-    if (V != 0)
-      *op = V;
-    else
+    // Operands that map to themselves are left alone, so that their use
+    // lists aren't touched.
+    if (V != 0) {
+      if (V != *op)
+        *op = V;
+    } else
       assert((Flags & RF_IgnoreMissingEntries) &&
              "Referenced value not in value map!");
   }
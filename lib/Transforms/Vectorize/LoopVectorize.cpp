@@ -106,6 +106,25 @@ static cl::opt<bool>
 EnableIfConversion("enable-if-conversion", cl::init(true), cl::Hidden,
                    cl::desc("Enable if-conversion during vectorization."));
 
+static cl::opt<bool>
+EnableInterleavedMemAccesses("enable-interleaved-mem-accesses",
+                             cl::init(false), cl::Hidden,
+                             cl::desc("Vectorize groups of strided loads or "
+                                      "stores, such as A[2*i] and A[2*i+1], "
+                                      "as wide accesses and shuffles."));
+
+static cl::opt<unsigned>
+MaxInterleaveGroupFactor("max-interleave-group-factor", cl::init(8),
+                         cl::Hidden,
+                         cl::desc("The largest stride, in elements, of an "
+                                  "interleaved access group."));
+
+static cl::opt<bool>
+EnableEpilogueVectorization("vectorize-epilogue", cl::init(false), cl::Hidden,
+                            cl::desc("Vectorize the scalar remainder of a "
+                                     "vectorized loop with half the vector "
+                                     "width."));
+
 /// We don't vectorize loops with a known constant trip count below this number.
 static cl::opt<unsigned>
 TinyTripCountVectorThreshold("vectorizer-min-trip-count", cl::init(16),
@@ -154,9 +173,10 @@ class InnerLoopVectorizer {
 public:
   InnerLoopVectorizer(Loop *OrigLoop, ScalarEvolution *SE, LoopInfo *LI,
                       DominatorTree *DT, DataLayout *DL,
-                      const TargetLibraryInfo *TLI, unsigned VecWidth,
+                      const TargetLibraryInfo *TLI,
+                      const TargetTransformInfo *TTI, unsigned VecWidth,
                       unsigned UnrollFactor)
-      : OrigLoop(OrigLoop), SE(SE), LI(LI), DT(DT), DL(DL), TLI(TLI),
+      : OrigLoop(OrigLoop), SE(SE), LI(LI), DT(DT), DL(DL), TLI(TLI), TTI(TTI),
         VF(VecWidth), UF(UnrollFactor), Builder(SE->getContext()), Induction(0),
         OldInduction(0), WidenMap(UnrollFactor) {}
 
@@ -232,6 +252,14 @@ protected:
   virtual void vectorizeMemoryInstruction(Instruction *Instr,
                                   LoopVectorizationLegality *Legal);
 
+  /// Vectorize the load LI of A[Index] as an llvm.gather of A.
+  void vectorizeGather(LoadInst *LI, Value *Index);
+
+  /// Vectorize the interleaved access group that Instr belongs to, when
+  /// Instr is where the group is to be emitted.
+  void vectorizeInterleaveGroup(Instruction *Instr,
+                                LoopVectorizationLegality *Legal);
+
   /// Create a broadcast instruction. This method generates a broadcast
   /// instruction (shuffle) for loop invariant values and for the induction
   /// value. If this is the induction variable then we extend it to N, N+1, ...
@@ -306,6 +334,8 @@ protected:
   DataLayout *DL;
   /// Target Library Info.
   const TargetLibraryInfo *TLI;
+  /// Target Transform Info.
+  const TargetTransformInfo *TTI;
 
   /// The vectorization SIMD factor to use. Each vector will have this many
   /// vector elements.
@@ -351,8 +381,9 @@ class InnerLoopUnroller : public InnerLoopVectorizer {
 public:
   InnerLoopUnroller(Loop *OrigLoop, ScalarEvolution *SE, LoopInfo *LI,
                     DominatorTree *DT, DataLayout *DL,
-                    const TargetLibraryInfo *TLI, unsigned UnrollFactor) :
-    InnerLoopVectorizer(OrigLoop, SE, LI, DT, DL, TLI, 1, UnrollFactor) { }
+                    const TargetLibraryInfo *TLI,
+                    const TargetTransformInfo *TTI, unsigned UnrollFactor) :
+    InnerLoopVectorizer(OrigLoop, SE, LI, DT, DL, TLI, TTI, 1, UnrollFactor) { }
 
 private:
   virtual void scalarizeInstruction(Instruction *Instr);
@@ -517,6 +548,26 @@ public:
     SmallVector<unsigned, 2> DependencySetId;
   };
 
+  /// An interleaved access group: loads, or stores, of the fields of an
+  /// array of records, such as A[2*i] and A[2*i+1], which all have the same
+  /// constant stride.  Each group is vectorized as one wide access and the
+  /// shuffles that split the records into their fields, or merge them.
+  struct InterleaveGroup {
+    InterleaveGroup(unsigned Factor)
+        : Factor(Factor), Align(0), InsertPos(0), Members(Factor) {}
+
+    /// The stride of the accesses, in elements.
+    unsigned Factor;
+    /// The alignment of the wide access.
+    unsigned Align;
+    /// The member where the wide access is emitted: the first load, or the
+    /// last store, in program order.
+    Instruction *InsertPos;
+    /// The members, by their field.  A load group may skip fields, but not
+    /// the first or the last.
+    SmallVector<Instruction *, 4> Members;
+  };
+
   /// A struct for saving information about induction variables.
   struct InductionInfo {
     InductionInfo(Value *Start, InductionKind K) : StartValue(Start), IK(K) {}
@@ -569,9 +620,22 @@ public:
   /// -1 - Address is consecutive, and decreasing.
   int isConsecutivePtr(Value *Ptr);
 
+  /// Returns the index of a load from a loop invariant base address when the
+  /// index varies in the loop, as in A[B[i]], or null otherwise. Such loads
+  /// can be vectorized as an llvm.gather.
+  Value *getGatherIndex(LoadInst *LI);
+
   /// Returns true if the value V is uniform within the loop.
   bool isUniform(Value *V);
 
+  /// Returns the interleaved access group of the load or store I, or null.
+  const InterleaveGroup *getInterleaveGroup(Instruction *I) const {
+    DenseMap<Instruction *, unsigned>::const_iterator It =
+      InterleaveGroupIndex.find(I);
+    return It == InterleaveGroupIndex.end() ? 0
+                                            : &InterleaveGroups[It->second];
+  }
+
   /// Returns true if this instruction will remain scalar after vectorization.
   bool isUniformAfterVectorization(Instruction* I) { return Uniforms.count(I); }
 
@@ -603,6 +667,19 @@ private:
   /// Collect the variables that need to stay uniform after vectorization.
   void collectLoopUniforms();
 
+  /// Find the groups of strided loads and stores that can be vectorized as
+  /// interleaved accesses.
+  void analyzeInterleaving();
+
+  /// Returns the stride, in elements, of the load or store I if it can be
+  /// part of an interleaved access group, or 0.
+  unsigned getInterleaveFactor(Instruction *I);
+
+  /// Form the interleaved access groups of Accesses, which are the strided
+  /// accesses of one block in program order, with their Factors.
+  void formInterleaveGroups(ArrayRef<Instruction *> Accesses,
+                            ArrayRef<unsigned> Factors);
+
   /// Return true if all of the instructions in the block can be speculatively
   /// executed. \p SafePtrs is a list of addresses that are known to be legal
   /// and we know that we can read from them without segfault.
@@ -662,6 +739,9 @@ private:
   RuntimePointerCheck PtrRtCheck;
   /// Can we assume the absence of NaNs.
   bool HasFunNoNaNAttr;
+  /// The interleaved access groups, and the group of each of their members.
+  std::vector<InterleaveGroup> InterleaveGroups;
+  DenseMap<Instruction *, unsigned> InterleaveGroupIndex;
 
   unsigned MaxSafeDepDistBytes;
 };
@@ -689,9 +769,10 @@ public:
   /// \return The most profitable vectorization factor and the cost of that VF.
   /// This method checks every power of two up to VF. If UserVF is not ZERO
   /// then this vectorization factor will be selected if vectorization is
-  /// possible.
+  /// possible. If MaxVF is not ZERO then no width above it is considered.
   VectorizationFactor selectVectorizationFactor(bool OptForSize,
-                                                unsigned UserVF);
+                                                unsigned UserVF,
+                                                unsigned MaxVF = 0);
 
   /// \return The size (in bits) of the widest type in the code that
   /// needs to be vectorized. We ignore values that remain scalar such as
@@ -901,6 +982,11 @@ struct LoopVectorize : public LoopPass {
   TargetLibraryInfo *TLI;
   bool DisableUnrolling;
 
+  /// Scalar remainder loops that are queued to be vectorized again as an
+  /// epilogue, mapped to the widest width they may use and whether that
+  /// width was forced by the user.
+  DenseMap<Loop *, std::pair<unsigned, bool> > Epilogues;
+
   virtual bool runOnLoop(Loop *L, LPPassManager &LPM) {
     // We only vectorize innermost loops.
     if (!L->empty())
@@ -928,7 +1014,20 @@ struct LoopVectorize : public LoopPass {
 
     LoopVectorizeHints Hints(L, DisableUnrolling);
 
-    if (Hints.Width == 1 && Hints.Unroll == 1) {
+    // A remainder loop that we queued for epilogue vectorization is already
+    // marked as vectorized; it only gets one more, narrower, attempt.
+    unsigned EpilogueMaxVF = 0;
+    bool EpilogueForced = false;
+    DenseMap<Loop *, std::pair<unsigned, bool> >::iterator EI =
+      Epilogues.find(L);
+    bool IsEpilogue = EI != Epilogues.end();
+    if (IsEpilogue) {
+      EpilogueMaxVF = EI->second.first;
+      EpilogueForced = EI->second.second;
+      Epilogues.erase(EI);
+      DEBUG(dbgs() << "LV: Vectorizing the epilogue with VF <= "
+            << EpilogueMaxVF << ".\n");
+    } else if (Hints.Width == 1 && Hints.Unroll == 1) {
       DEBUG(dbgs() << "LV: Not vectorizing.\n");
       return false;
     }
@@ -960,10 +1059,17 @@ struct LoopVectorize : public LoopPass {
 
     // Select the optimal vectorization factor.
     LoopVectorizationCostModel::VectorizationFactor VF;
-    VF = CM.selectVectorizationFactor(OptForSize, Hints.Width);
-    // Select the unroll factor.
-    unsigned UF = CM.selectUnrollFactor(OptForSize, Hints.Unroll, VF.Width,
-                                        VF.Cost);
+    if (IsEpilogue)
+      VF = CM.selectVectorizationFactor(OptForSize,
+                                        EpilogueForced ? EpilogueMaxVF : 0,
+                                        EpilogueMaxVF);
+    else
+      VF = CM.selectVectorizationFactor(OptForSize, Hints.Width);
+    // Select the unroll factor. The epilogue runs fewer iterations than the
+    // vector loop before it, so unrolling it never pays off.
+    unsigned UF = IsEpilogue ? 1 : CM.selectUnrollFactor(OptForSize,
+                                                         Hints.Unroll,
+                                                         VF.Width, VF.Cost);
 
     DEBUG(dbgs() << "LV: Found a vectorizable loop ("<< VF.Width << ") in "<<
           F->getParent()->getModuleIdentifier() << '\n');
@@ -974,16 +1080,26 @@ struct LoopVectorize : public LoopPass {
       if (UF == 1)
         return false;
       // We decided not to vectorize, but we may want to unroll.
-      InnerLoopUnroller Unroller(L, SE, LI, DT, DL, TLI, UF);
+      InnerLoopUnroller Unroller(L, SE, LI, DT, DL, TLI, TTI, UF);
       Unroller.vectorize(&LVL);
     } else {
       // If we decided that it is *legal* to vectorize the loop then do it.
-      InnerLoopVectorizer LB(L, SE, LI, DT, DL, TLI, VF.Width, UF);
+      InnerLoopVectorizer LB(L, SE, LI, DT, DL, TLI, TTI, VF.Width, UF);
       LB.vectorize(&LVL);
     }
 
     // Mark the loop as already vectorized to avoid vectorizing again.
-    Hints.setAlreadyVectorized(L);
+    bool UserVF = Hints.Width != 0;
+    if (!IsEpilogue)
+      Hints.setAlreadyVectorized(L);
+
+    // The scalar remainder may run up to VF - 1 iterations. Revisit it once
+    // to see whether a vector loop of half the width can take most of them.
+    if (EnableEpilogueVectorization && !IsEpilogue && !OptForSize &&
+        VF.Width >= 4) {
+      Epilogues[L] = std::make_pair(VF.Width / 2, UserVF);
+      LPM.redoLoop(L);
+    }
 
     DEBUG(verifyFunction(*L->getHeader()->getParent()));
     return true;
@@ -1092,6 +1208,33 @@ static unsigned getGEPInductionOperand(DataLayout *DL,
   return LastOperand;
 }
 
+Value *LoopVectorizationLegality::getGatherIndex(LoadInst *LI) {
+  if (!LI->isSimple() || LI->getPointerAddressSpace() != 0)
+    return 0;
+
+  GetElementPtrInst *Gep = dyn_cast<GetElementPtrInst>(LI->getPointerOperand());
+  if (!Gep)
+    return 0;
+
+  // The base address must be available before the loop.
+  Instruction *Base = dyn_cast<Instruction>(Gep->getPointerOperand());
+  if (Base && TheLoop->contains(Base))
+    return 0;
+
+  // Only the last index may be nonzero, as in a GEP into a global array.
+  unsigned NumOperands = Gep->getNumOperands();
+  for (unsigned i = 1; i != NumOperands - 1; ++i) {
+    ConstantInt *C = dyn_cast<ConstantInt>(Gep->getOperand(i));
+    if (!C || !C->isZero())
+      return 0;
+  }
+
+  Value *Index = Gep->getOperand(NumOperands - 1);
+  if (SE->isLoopInvariant(SE->getSCEV(Index), TheLoop))
+    return 0;
+  return Index;
+}
+
 int LoopVectorizationLegality::isConsecutivePtr(Value *Ptr) {
   assert(Ptr->getType()->isPointerTy() && "Unexpected non ptr");
   // Make sure that the pointer does not point to structs.
@@ -1193,6 +1336,28 @@ Value *InnerLoopVectorizer::reverseVector(Value *Vec) {
 }
 
 
+/// \brief Returns the indices to vectorize the load LI as an llvm.gather with
+/// VF elements, or null if the target has no gather instruction for it.
+static Value *getLegalGatherIndex(LoadInst *LI, unsigned VF,
+                                  LoopVectorizationLegality *Legal,
+                                  const TargetTransformInfo &TTI) {
+  Value *Index = Legal->getGatherIndex(LI);
+  if (!Index)
+    return 0;
+
+  // llvm.gather sign extends its indices like the GEP does, so prefer the
+  // narrower indices when the target can use them.
+  Type *DataTy = VectorType::get(LI->getType(), VF);
+  if (SExtInst *SExt = dyn_cast<SExtInst>(Index)) {
+    Value *Narrow = SExt->getOperand(0);
+    if (TTI.isLegalGather(DataTy, VectorType::get(Narrow->getType(), VF)))
+      return Narrow;
+  }
+  if (TTI.isLegalGather(DataTy, VectorType::get(Index->getType(), VF)))
+    return Index;
+  return 0;
+}
+
 void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr,
                                              LoopVectorizationLegality *Legal) {
   // Attempt to issue a wide load.
@@ -1201,6 +1366,15 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr,
 
   assert((LI || SI) && "Invalid Load/Store instruction");
 
+  // Interleaved accesses are vectorized as a group, where the wide access is
+  // emitted.
+  if (const LoopVectorizationLegality::InterleaveGroup *Group =
+        Legal->getInterleaveGroup(Instr)) {
+    if (Instr == Group->InsertPos)
+      vectorizeInterleaveGroup(Instr, Legal);
+    return;
+  }
+
   Type *ScalarDataTy = LI ? LI->getType() : SI->getValueOperand()->getType();
   Type *DataTy = VectorType::get(ScalarDataTy, VF);
   Value *Ptr = LI ? LI->getPointerOperand() : SI->getPointerOperand();
@@ -1217,10 +1391,13 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr,
     return scalarizeInstruction(Instr);
 
   // If the pointer is loop invariant or if it is non consecutive,
-  // scalarize the load.
+  // scalarize the load, unless the target can gather it.
   int ConsecutiveStride = Legal->isConsecutivePtr(Ptr);
   bool Reverse = ConsecutiveStride < 0;
   bool UniformLoad = LI && Legal->isUniform(Ptr);
+  if (!ConsecutiveStride && !UniformLoad && LI)
+    if (Value *Index = getLegalGatherIndex(LI, VF, Legal, *TTI))
+      return vectorizeGather(LI, Index);
   if (!ConsecutiveStride || UniformLoad)
     return scalarizeInstruction(Instr);
 
@@ -1331,6 +1508,128 @@ void InnerLoopVectorizer::vectorizeMemoryInstruction(Instruction *Instr,
   }
 }
 
+void InnerLoopVectorizer::vectorizeGather(LoadInst *LI, Value *Index) {
+  GetElementPtrInst *Gep = cast<GetElementPtrInst>(LI->getPointerOperand());
+  setDebugLocFromInst(Builder, LI);
+
+  Type *Tys[] = { VectorType::get(LI->getType(), VF),
+                  VectorType::get(Index->getType(), VF) };
+  Module *M = LI->getParent()->getParent()->getParent();
+  Function *Gather = Intrinsic::getDeclaration(M, Intrinsic::gather, Tys);
+  Value *Base = Builder.CreateBitCast(Gep->getPointerOperand(),
+                                      Builder.getInt8PtrTy());
+
+  VectorParts &Indices = getVectorValue(Index);
+  VectorParts &Entry = WidenMap.get(LI);
+  for (unsigned Part = 0; Part < UF; ++Part)
+    Entry[Part] = Builder.CreateCall2(Gather, Base, Indices[Part], "gather");
+}
+
+/// \brief Returns the mask <Start, Start + Stride, ..., Start + (VF-1) * Stride>
+/// that takes every Stride'th element of a vector.
+static Constant *getStridedMask(IRBuilder<> &Builder, unsigned Start,
+                                unsigned Stride, unsigned VF) {
+  SmallVector<Constant *, 16> Mask;
+  for (unsigned i = 0; i < VF; ++i)
+    Mask.push_back(Builder.getInt32(Start + i * Stride));
+  return ConstantVector::get(Mask);
+}
+
+/// \brief Returns the mask that interleaves NumVecs vectors of VF elements
+/// that are concatenated: <0, VF, 2*VF, ..., 1, VF+1, 2*VF+1, ...>.
+static Constant *getInterleaveMask(IRBuilder<> &Builder, unsigned VF,
+                                   unsigned NumVecs) {
+  SmallVector<Constant *, 16> Mask;
+  for (unsigned i = 0; i < VF; ++i)
+    for (unsigned j = 0; j < NumVecs; ++j)
+      Mask.push_back(Builder.getInt32(j * VF + i));
+  return ConstantVector::get(Mask);
+}
+
+/// \brief Concatenate the vectors Vecs, which all have the same type.
+static Value *concatenateVectors(IRBuilder<> &Builder,
+                                 ArrayRef<Value *> Vecs) {
+  unsigned VF = Vecs[0]->getType()->getVectorNumElements();
+  Value *Concat = Vecs[0];
+  for (unsigned i = 1, e = Vecs.size(); i != e; ++i) {
+    unsigned NumElts = Concat->getType()->getVectorNumElements();
+    // Both operands of a shuffle have the same type, so pad the next vector
+    // to the length of what is concatenated so far.
+    Value *Next = Vecs[i];
+    if (NumElts != VF) {
+      SmallVector<Constant *, 16> PadMask;
+      for (unsigned j = 0; j < NumElts; ++j)
+        PadMask.push_back(j < VF ? cast<Constant>(Builder.getInt32(j))
+                                 : UndefValue::get(Builder.getInt32Ty()));
+      Next = Builder.CreateShuffleVector(Next, UndefValue::get(Next->getType()),
+                                         ConstantVector::get(PadMask));
+    }
+    SmallVector<Constant *, 16> Mask;
+    for (unsigned j = 0; j < NumElts + VF; ++j)
+      Mask.push_back(Builder.getInt32(j));
+    Concat = Builder.CreateShuffleVector(Concat, Next,
+                                         ConstantVector::get(Mask));
+  }
+  return Concat;
+}
+
+void InnerLoopVectorizer::vectorizeInterleaveGroup(Instruction *Instr,
+                                             LoopVectorizationLegality *Legal) {
+  const LoopVectorizationLegality::InterleaveGroup *Group =
+    Legal->getInterleaveGroup(Instr);
+  LoadInst *LI = dyn_cast<LoadInst>(Instr);
+  StoreInst *SI = dyn_cast<StoreInst>(Instr);
+  Type *ScalarDataTy = LI ? LI->getType() : SI->getValueOperand()->getType();
+  Value *Ptr = LI ? LI->getPointerOperand() : SI->getPointerOperand();
+  unsigned AddressSpace = Ptr->getType()->getPointerAddressSpace();
+  unsigned Factor = Group->Factor;
+  Type *WideTy = VectorType::get(ScalarDataTy, Factor * VF);
+
+  // The field that Instr accesses.
+  unsigned Index = 0;
+  while (Group->Members[Index] != Instr)
+    ++Index;
+
+  setDebugLocFromInst(Builder, Instr);
+  Constant *Zero = Builder.getInt32(0);
+  VectorParts &PtrParts = getVectorValue(Ptr);
+  for (unsigned Part = 0; Part < UF; ++Part) {
+    // The address of the first record of this part.
+    Value *NewPtr = Builder.CreateExtractElement(PtrParts[Part], Zero);
+    NewPtr = Builder.CreateGEP(NewPtr, Builder.getInt32(-(int)Index));
+    NewPtr = Builder.CreateBitCast(NewPtr, WideTy->getPointerTo(AddressSpace));
+
+    if (LI) {
+      LoadInst *WideLoad = Builder.CreateLoad(NewPtr, "wide.vec");
+      WideLoad->setAlignment(Group->Align);
+      // Split the records into their fields.
+      for (unsigned i = 0; i < Factor; ++i) {
+        Instruction *Member = Group->Members[i];
+        if (!Member)
+          continue;
+        WidenMap.get(Member)[Part] =
+          Builder.CreateShuffleVector(WideLoad, UndefValue::get(WideTy),
+                                      getStridedMask(Builder, i, Factor, VF),
+                                      "strided.vec");
+      }
+      continue;
+    }
+
+    // Merge the fields into records.
+    SmallVector<Value *, 4> StoredVals;
+    for (unsigned i = 0; i < Factor; ++i) {
+      StoreInst *Member = cast<StoreInst>(Group->Members[i]);
+      StoredVals.push_back(getVectorValue(Member->getValueOperand())[Part]);
+    }
+    Value *Concat = concatenateVectors(Builder, StoredVals);
+    Value *Interleaved =
+      Builder.CreateShuffleVector(Concat, UndefValue::get(WideTy),
+                                  getInterleaveMask(Builder, VF, Factor),
+                                  "interleaved.vec");
+    Builder.CreateStore(Interleaved, NewPtr)->setAlignment(Group->Align);
+  }
+}
+
 void InnerLoopVectorizer::scalarizeInstruction(Instruction *Instr) {
   assert(!Instr->getType()->isAggregateType() && "Can't handle vectors");
   // Holds vector parameters or scalars, in case of uniform vals.
@@ -2875,6 +3174,9 @@ bool LoopVectorizationLegality::canVectorize() {
   // Collect all of the variables that remain uniform after vectorization.
   collectLoopUniforms();
 
+  if (EnableInterleavedMemAccesses)
+    analyzeInterleaving();
+
   DEBUG(dbgs() << "LV: We can vectorize this loop" <<
         (PtrRtCheck.Need ? " (with a runtime bound check)" : "")
         <<"!\n");
@@ -3113,6 +3415,160 @@ void LoopVectorizationLegality::collectLoopUniforms() {
   }
 }
 
+/// \brief Returns the pointer operand of the load or store I.
+static Value *getMemInstPointerOperand(Instruction *I) {
+  if (LoadInst *LI = dyn_cast<LoadInst>(I))
+    return LI->getPointerOperand();
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+/// \brief Returns the type of the value that the load or store I accesses.
+static Type *getMemInstValueType(Instruction *I) {
+  if (LoadInst *LI = dyn_cast<LoadInst>(I))
+    return LI->getType();
+  return cast<StoreInst>(I)->getValueOperand()->getType();
+}
+
+unsigned LoopVectorizationLegality::getInterleaveFactor(Instruction *I) {
+  LoadInst *LI = dyn_cast<LoadInst>(I);
+  StoreInst *SI = dyn_cast<StoreInst>(I);
+  if ((!LI && !SI) || (LI && !LI->isSimple()) || (SI && !SI->isSimple()))
+    return 0;
+
+  Value *Ptr = getMemInstPointerOperand(I);
+  Type *Ty = getMemInstValueType(I);
+  if (!VectorType::isValidElementType(Ty) || isConsecutivePtr(Ptr))
+    return 0;
+  uint64_t Size = DL->getTypeAllocSize(Ty);
+  if (Size != DL->getTypeStoreSize(Ty))
+    return 0;
+
+  const SCEVAddRecExpr *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Ptr));
+  if (!AR || AR->getLoop() != TheLoop || !AR->isAffine())
+    return 0;
+  const SCEVConstant *Step =
+    dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+  if (!Step)
+    return 0;
+  int64_t StepBytes = Step->getValue()->getSExtValue();
+  if (StepBytes <= 0 || StepBytes % Size)
+    return 0;
+  int64_t Stride = StepBytes / Size;
+  if (Stride < 2 || Stride > MaxInterleaveGroupFactor)
+    return 0;
+  return Stride;
+}
+
+void LoopVectorizationLegality::analyzeInterleaving() {
+  // The wide accesses are not masked, so only look at the blocks that run on
+  // every iteration.
+  for (Loop::block_iterator BI = TheLoop->block_begin(),
+         BE = TheLoop->block_end(); BI != BE; ++BI) {
+    if (blockNeedsPredication(*BI))
+      continue;
+    SmallVector<Instruction *, 16> Accesses;
+    SmallVector<unsigned, 16> Factors;
+    for (BasicBlock::iterator I = (*BI)->begin(), E = (*BI)->end(); I != E;
+         ++I)
+      if (unsigned Factor = getInterleaveFactor(I)) {
+        Accesses.push_back(I);
+        Factors.push_back(Factor);
+      }
+    formInterleaveGroups(Accesses, Factors);
+  }
+}
+
+void
+LoopVectorizationLegality::formInterleaveGroups(ArrayRef<Instruction *> Accesses,
+                                                ArrayRef<unsigned> Factors) {
+  SmallPtrSet<Instruction *, 16> Grouped;
+  for (unsigned a = 0, e = Accesses.size(); a != e; ++a) {
+    Instruction *A = Accesses[a];
+    if (Grouped.count(A))
+      continue;
+    unsigned Factor = Factors[a];
+    bool IsLoad = isa<LoadInst>(A);
+    Type *Ty = getMemInstValueType(A);
+    int64_t Size = DL->getTypeAllocSize(Ty);
+    const SCEV *PtrA = SE->getSCEV(getMemInstPointerOperand(A));
+
+    // Gather the accesses of the other fields of the records A accesses, by
+    // their offset in elements from A.
+    SmallVector<std::pair<int64_t, Instruction *>, 4> Members;
+    Members.push_back(std::make_pair(0, A));
+    int64_t MinOffset = 0, MaxOffset = 0;
+    unsigned Last = a;
+    for (unsigned b = a + 1; b != e; ++b) {
+      Instruction *B = Accesses[b];
+      if (Grouped.count(B) || Factors[b] != Factor ||
+          isa<LoadInst>(B) != IsLoad || getMemInstValueType(B) != Ty)
+        continue;
+      const SCEVConstant *Dist = dyn_cast<SCEVConstant>(
+          SE->getMinusSCEV(SE->getSCEV(getMemInstPointerOperand(B)), PtrA));
+      if (!Dist || Dist->getValue()->getSExtValue() % Size)
+        continue;
+      int64_t Offset = Dist->getValue()->getSExtValue() / Size;
+      if (std::max(MaxOffset, Offset) - std::min(MinOffset, Offset) >=
+          (int64_t)Factor)
+        continue;
+      bool Taken = false;
+      for (unsigned i = 0, ie = Members.size(); i != ie; ++i)
+        Taken |= Members[i].first == Offset;
+      if (Taken)
+        continue;
+      Members.push_back(std::make_pair(Offset, B));
+      MinOffset = std::min(MinOffset, Offset);
+      MaxOffset = std::max(MaxOffset, Offset);
+      Last = b;
+    }
+
+    // The wide access covers whole records, so it must not touch memory that
+    // the scalar loop does not: the first and last fields must be loaded, and
+    // every field stored.
+    if (Members.size() < 2 || MaxOffset - MinOffset != Factor - 1 ||
+        (!IsLoad && Members.size() != Factor))
+      continue;
+
+    // The loads all happen at the first of them, and the stores at the last,
+    // so nothing in between may write memory, or touch it at all for stores.
+    bool Conflict = false;
+    for (BasicBlock::iterator I = A, E = Accesses[Last]; I != E && !Conflict;
+         ++I) {
+      Instruction *Inst = I;
+      bool IsMember = false;
+      for (unsigned i = 0, ie = Members.size(); i != ie; ++i)
+        IsMember |= Members[i].second == Inst;
+      if (!IsMember)
+        Conflict = IsLoad ? Inst->mayWriteToMemory()
+                          : Inst->mayReadOrWriteMemory();
+    }
+    if (Conflict)
+      continue;
+
+    InterleaveGroup Group(Factor);
+    Group.InsertPos = IsLoad ? A : Accesses[Last];
+    for (unsigned i = 0, ie = Members.size(); i != ie; ++i) {
+      Instruction *Member = Members[i].second;
+      Group.Members[Members[i].first - MinOffset] = Member;
+      InterleaveGroupIndex[Member] = InterleaveGroups.size();
+      Grouped.insert(Member);
+    }
+
+    // The wide access starts at the first field.
+    Instruction *First = Group.Members[0];
+    Group.Align = isa<LoadInst>(First) ? cast<LoadInst>(First)->getAlignment()
+                                       : cast<StoreInst>(First)->getAlignment();
+    if (!Group.Align)
+      Group.Align = DL->getABITypeAlignment(Ty);
+
+    DEBUG(dbgs() << "LV: Found an interleaved " << (IsLoad ? "load" : "store")
+                 << " group of factor " << Factor << " with "
+                 << Members.size() << " members at " << *Group.InsertPos
+                 << "\n");
+    InterleaveGroups.push_back(Group);
+  }
+}
+
 namespace {
 /// \brief Analyses memory accesses in a loop.
 ///
@@ -4378,7 +4834,8 @@ bool LoopVectorizationLegality::blockCanBePredicated(BasicBlock *BB,
 
 LoopVectorizationCostModel::VectorizationFactor
 LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize,
-                                                      unsigned UserVF) {
+                                                      unsigned UserVF,
+                                                      unsigned MaxVF) {
   // Width 1 means no vectorize
   VectorizationFactor Factor = { 1U, 0U };
   if (OptForSize && Legal->getRuntimePointerCheck()->Need) {
@@ -4411,6 +4868,8 @@ LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize,
          " into one vector!");
 
   unsigned VF = MaxVectorSize;
+  if (MaxVF != 0 && MaxVF < VF)
+    VF = MaxVF;
 
   // If we optimize the program for size, avoid creating the tail loop.
   if (OptForSize) {
@@ -4894,11 +5353,36 @@ LoopVectorizationCostModel::getInstructionCost(Instruction *I, unsigned VF) {
       return TTI.getAddressComputationCost(VectorTy) +
         TTI.getMemoryOpCost(I->getOpcode(), VectorTy, Alignment, AS);
 
+    // An interleaved access group costs one wide access and its shuffles,
+    // which are counted where the wide access is emitted.
+    if (const LoopVectorizationLegality::InterleaveGroup *Group =
+          Legal->getInterleaveGroup(I)) {
+      if (I != Group->InsertPos)
+        return 0;
+      Type *WideTy = VectorType::get(ValTy, VF * Group->Factor);
+      SmallVector<unsigned, 4> Indices;
+      for (unsigned i = 0; i < Group->Factor; ++i)
+        if (Group->Members[i])
+          Indices.push_back(i);
+      return TTI.getAddressComputationCost(WideTy) +
+        TTI.getInterleavedMemoryOpCost(I->getOpcode(), WideTy, Group->Factor,
+                                       Indices, Group->Align, AS);
+    }
+
     // Scalarized loads/stores.
     int ConsecutiveStride = Legal->isConsecutivePtr(Ptr);
     bool Reverse = ConsecutiveStride < 0;
     unsigned ScalarAllocatedSize = DL->getTypeAllocSize(ValTy);
     unsigned VectorElementSize = DL->getTypeStoreSize(VectorTy)/VF;
+    Value *GatherIndex = 0;
+    if (LI && !ConsecutiveStride && ScalarAllocatedSize == VectorElementSize &&
+        !Legal->isUniform(Ptr))
+      GatherIndex = getLegalGatherIndex(LI, VF, Legal, TTI);
+    if (GatherIndex) {
+      Type *IndexTy = ToVectorTy(GatherIndex->getType(), VF);
+      return TTI.getAddressComputationCost(VectorTy) +
+        TTI.getGatherOpCost(VectorTy, IndexTy, Alignment);
+    }
     if (!ConsecutiveStride || ScalarAllocatedSize != VectorElementSize) {
       bool IsComplexComputation =
         isLikelyComplexAddressComputation(Ptr, Legal, SE, TheLoop);
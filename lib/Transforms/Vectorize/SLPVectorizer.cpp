@@ -1817,6 +1817,11 @@ private:
   /// \brief Try to vectorize a chain that may start at the operands of \V;
   bool tryToVectorize(BinaryOperator *V, BoUpSLP &R);
 
+  /// \brief Try to vectorize the horizontal reductions whose roots are
+  /// operands of \p I.
+  /// \returns true if a reduction was vectorized.
+  bool tryToVectorizeHorReductionOperands(Instruction *I, BoUpSLP &R);
+
   /// \brief Vectorize the stores that were collected in StoreRefs.
   bool vectorizeStoreChains(BoUpSLP &R);
 
@@ -2426,6 +2431,27 @@ static bool findBuildVector(InsertElementInst *IE,
   return false;
 }
 
+bool SLPVectorizer::tryToVectorizeHorReductionOperands(Instruction *I,
+                                                       BoUpSLP &R) {
+  for (unsigned i = 0, e = I->getNumOperands(); i != e; ++i) {
+    BinaryOperator *Root = dyn_cast<BinaryOperator>(I->getOperand(i));
+    if (!Root || Root->getParent() != I->getParent())
+      continue;
+
+    // An operation of the same kind is an inner node of a larger tree. We
+    // reach the whole tree through its root.
+    if (BinaryOperator *BI = dyn_cast<BinaryOperator>(I))
+      if (BI->getOpcode() == Root->getOpcode())
+        continue;
+
+    HorizontalReduction HorRdx;
+    if (HorRdx.matchAssociativeReduction(0, Root, DL) &&
+        HorRdx.tryToReduce(R, TTI))
+      return true;
+  }
+  return false;
+}
+
 static bool PhiTypeSorterFunc(Value *V, Value *V2) {
   return V->getType() < V2->getType();
 }
@@ -2534,6 +2560,17 @@ bool SLPVectorizer::vectorizeChainsInBlock(BasicBlock *BB, BoUpSLP &R) {
       continue;
     }
 
+    // Try to vectorize horizontal reductions that are neither carried by a
+    // PHI nor stored, such as an unrolled dot product that is returned or
+    // passed to a call.
+    if (ShouldVectorizeHor && !isa<StoreInst>(it) &&
+        tryToVectorizeHorReductionOperands(it, R)) {
+      Changed = true;
+      it = BB->begin();
+      e = BB->end();
+      continue;
+    }
+
     // Try to vectorize horizontal reductions feeding into a store.
     if (ShouldStartVectorizeHorAtStore)
       if (StoreInst *SI = dyn_cast<StoreInst>(it))
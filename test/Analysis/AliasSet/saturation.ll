@@ -0,0 +1,40 @@
+; RUN: opt -basicaa -print-alias-sets -disable-output < %s 2>&1 | FileCheck %s
+; RUN: opt -basicaa -print-alias-sets -alias-set-saturation-threshold=1 \
+; RUN:   -disable-output < %s 2>&1 | FileCheck %s -check-prefix=SATURATED
+; RUN: opt -no-aa -print-alias-sets -disable-output < %s 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=NOAA
+
+; CHECK-LABEL: Alias Set Tracker: 3 alias sets for 4 pointer values.
+; CHECK-DAG: must alias, Mod Pointers: (i32* %a, 4)
+; CHECK-DAG: must alias, Mod Pointers: (i32* %b, 4)
+; CHECK-DAG: may alias, Mod/Ref Pointers: (i32* %p, 4), (i32* %q, 4)
+
+; Once %p and %q share a may-alias set the tracker is over the threshold and
+; puts everything in one set.
+; SATURATED-LABEL: Alias Set Tracker:
+; SATURATED: may alias, Mod/Ref Pointers: (i32* %a, 4), (i32* %b, 4), (i32* %p, 4), (i32* %q, 4)
+define void @saturate(i32* %p, i32* %q) {
+  %a = alloca i32
+  %b = alloca i32
+  store i32 0, i32* %a
+  store i32 1, i32* %b
+  store i32 2, i32* %p
+  %v = load i32* %q
+  ret void
+}
+
+; Pointers into different allocas are told apart without asking alias
+; analysis.
+; NOAA-LABEL: Alias Set Tracker: 2 alias sets for 3 pointer values.
+; NOAA-DAG: may alias, Mod/Ref Pointers: (i32* %a0, 4), (i32* %a1, 4)
+; NOAA-DAG: must alias, Mod Pointers: (i32* %b, 4)
+define void @objects(i32 %i) {
+  %a = alloca [4 x i32]
+  %b = alloca i32
+  %a0 = getelementptr [4 x i32]* %a, i32 0, i32 0
+  %a1 = getelementptr [4 x i32]* %a, i32 0, i32 %i
+  store i32 0, i32* %a0
+  store i32 1, i32* %b
+  %v = load i32* %a1
+  ret void
+}
@@ -0,0 +1,22 @@
+; RUN: opt < %s -basicaa -aa-eval -print-all-alias-modref-info -stats \
+; RUN:   -disable-output 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; -aa-eval asks all of its queries in one batch, so each GEP is only
+; decomposed once.
+
+; CHECK: NoAlias: i32* %g1, i32* %g2
+; CHECK: NoAlias: i32* %g1, i32* %g3
+; CHECK: NoAlias: i32* %g2, i32* %g3
+; CHECK: {{[1-9][0-9]*}} basicaa - Number of GEP decompositions reused
+
+define void @f() {
+  %a = alloca [10 x i32]
+  %g1 = getelementptr [10 x i32]* %a, i32 0, i32 1
+  %g2 = getelementptr [10 x i32]* %a, i32 0, i32 2
+  %g3 = getelementptr [10 x i32]* %a, i32 0, i32 3
+  store i32 1, i32* %g1
+  store i32 2, i32* %g2
+  store i32 3, i32* %g3
+  ret void
+}
@@ -0,0 +1,13 @@
+; RUN: opt < %s -basicaa -count-aa -count-aa-per-pass -dse -disable-output \
+; RUN:   2>&1 | FileCheck %s
+
+; CHECK: Queries by pass (alias, mod/ref):
+; CHECK: {{[0-9]+ [0-9]+}} Dead Store Elimination
+
+define void @f(i32** %pp) {
+  %a = alloca i32
+  store i32 1, i32* %a
+  %q = load i32** %pp
+  %v = load i32* %q
+  ret void
+}
@@ -0,0 +1,37 @@
+; RUN: opt < %s -cost-model -analyze -mtriple=aarch64-none-linux-gnu -mattr=+neon | FileCheck %s
+
+target datalayout = "e-p:64:64-i64:64:64-i128:128:128-s0:32:32-f128:128:128-n32:64-S128"
+target triple = "aarch64-none-linux-gnu"
+
+define void @arith() {
+  ; CHECK: cost of 1 {{.*}} add <4 x i32>
+  %r0 = add <4 x i32> undef, undef
+  ; CHECK: cost of 1 {{.*}} mul <4 x i32>
+  %r1 = mul <4 x i32> undef, undef
+  ; 64-bit lanes are multiplied one at a time.
+  ; CHECK-NOT: cost of 1 {{.*}} mul <2 x i64>
+  %r2 = mul <2 x i64> undef, undef
+  ; CHECK: cost of 4 {{.*}} fdiv <4 x float>
+  %r3 = fdiv <4 x float> undef, undef
+  ; CHECK: cost of 2 {{.*}} fdiv <2 x float>
+  %r4 = fdiv <2 x float> undef, undef
+  ret void
+}
+
+define void @shuffles() {
+  ; CHECK: cost of 2 {{.*}} shufflevector <4 x i32>
+  %r0 = shufflevector <4 x i32> undef, <4 x i32> undef, <4 x i32> <i32 3, i32 2, i32 1, i32 0>
+  ; CHECK: cost of 1 {{.*}} shufflevector <2 x double>
+  %r1 = shufflevector <2 x double> undef, <2 x double> undef, <2 x i32> <i32 1, i32 0>
+  ret void
+}
+
+define void @elements() {
+  ; CHECK: cost of 0 {{.*}} extractelement <2 x double>
+  %r0 = extractelement <2 x double> undef, i32 0
+  ; CHECK: cost of 2 {{.*}} extractelement <2 x double>
+  %r1 = extractelement <2 x double> undef, i32 1
+  ; CHECK: cost of 2 {{.*}} extractelement <4 x i32>
+  %r2 = extractelement <4 x i32> undef, i32 0
+  ret void
+}
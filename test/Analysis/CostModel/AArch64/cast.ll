@@ -0,0 +1,26 @@
+; RUN: opt < %s -cost-model -analyze -mtriple=aarch64-none-linux-gnu -mattr=+neon | FileCheck %s
+
+target datalayout = "e-p:64:64-i64:64:64-i128:128:128-s0:32:32-f128:128:128-n32:64-S128"
+target triple = "aarch64-none-linux-gnu"
+
+define void @casts() {
+  ; CHECK: cost of 1 {{.*}} sext <4 x i16>
+  %r0 = sext <4 x i16> undef to <4 x i32>
+  ; CHECK: cost of 1 {{.*}} zext <2 x i32>
+  %r1 = zext <2 x i32> undef to <2 x i64>
+  ; CHECK: cost of 1 {{.*}} trunc <4 x i32>
+  %r2 = trunc <4 x i32> undef to <4 x i16>
+  ; CHECK: cost of 2 {{.*}} sext <8 x i16>
+  %r3 = sext <8 x i16> undef to <8 x i32>
+  ; CHECK: cost of 6 {{.*}} zext <16 x i8>
+  %r4 = zext <16 x i8> undef to <16 x i32>
+  ; CHECK: cost of 1 {{.*}} sitofp <4 x i32>
+  %r5 = sitofp <4 x i32> undef to <4 x float>
+  ; CHECK: cost of 1 {{.*}} fptosi <2 x double>
+  %r6 = fptosi <2 x double> undef to <2 x i64>
+  ; CHECK: cost of 1 {{.*}} fpext <2 x float>
+  %r7 = fpext <2 x float> undef to <2 x double>
+  ; CHECK: cost of 1 {{.*}} fptrunc <2 x double>
+  %r8 = fptrunc <2 x double> undef to <2 x float>
+  ret void
+}
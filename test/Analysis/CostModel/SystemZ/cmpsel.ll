@@ -0,0 +1,26 @@
+; RUN: opt < %s -cost-model -analyze -mtriple=s390x-linux-gnu -mcpu=z10 \
+; RUN:   | FileCheck %s -check-prefix=Z10
+; RUN: opt < %s -cost-model -analyze -mtriple=s390x-linux-gnu -mcpu=z196 \
+; RUN:   | FileCheck %s -check-prefix=Z196
+
+; Integer selects need a branch unless load/store-on-condition is available.
+define i64 @f1(i32 %a, i32 %b, i64 %c, i64 %d) {
+; Z10: cost of 2 {{.*}} select i1
+; Z196: cost of 1 {{.*}} select i1
+  %cond = icmp slt i32 %a, %b
+  %sel = select i1 %cond, i64 %c, i64 %d
+  ret i64 %sel
+}
+
+; Scalar loads and stores are single instructions; f128 values are split.
+define void @f2(i64 *%ptr1, double *%ptr2, fp128 *%ptr3) {
+; Z196: cost of 1 {{.*}} load i64
+; Z196: cost of 1 {{.*}} load double
+; Z196: cost of 2 {{.*}} load fp128
+; Z196: cost of 2 {{.*}} store fp128
+  %val1 = load i64 *%ptr1
+  %val2 = load double *%ptr2
+  %val3 = load fp128 *%ptr3
+  store fp128 %val3, fp128 *%ptr3
+  ret void
+}
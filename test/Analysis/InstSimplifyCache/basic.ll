@@ -0,0 +1,21 @@
+; RUN: opt < %s -instsimplify-cache -instsimplify -instsimplify -stats \
+; RUN:   -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -instsimplify-cache -instsimplify -instsimplify -S \
+; RUN:   | FileCheck %s -check-prefix=IR
+; REQUIRES: asserts
+
+; The second -instsimplify does not try again on the instructions the first
+; one could not simplify.
+
+; CHECK: 2 instsimplify-cache - Number of simplifications skipped
+; CHECK: 2 instsimplify-cache - Number of simplifications attempted
+
+; IR-LABEL: @f(
+; IR-NEXT: %a = add i32 %x, %y
+; IR-NEXT: %b = mul i32 %a, %y
+; IR-NEXT: ret i32 %b
+define i32 @f(i32 %x, i32 %y) {
+  %a = add i32 %x, %y
+  %b = mul i32 %a, %y
+  ret i32 %b
+}
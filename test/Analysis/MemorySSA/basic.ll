@@ -0,0 +1,60 @@
+; RUN: opt -basicaa -memoryssa -analyze < %s | FileCheck %s
+
+define i32 @diamond(i32* noalias %a, i32* noalias %b, i1 %c) {
+; CHECK-LABEL: 'diamond'
+entry:
+; CHECK: 1 = MemoryDef(liveOnEntry)
+; CHECK-NEXT: store i32 1, i32* %a
+  store i32 1, i32* %a
+  br i1 %c, label %then, label %else
+
+then:
+; CHECK: 2 = MemoryDef(1)
+; CHECK-NEXT: store i32 2, i32* %b
+  store i32 2, i32* %b
+  br label %merge
+
+else:
+; CHECK: 3 = MemoryDef(1)
+; CHECK-NEXT: store i32 3, i32* %b
+  store i32 3, i32* %b
+  br label %merge
+
+; Both paths into merge reach the store to %a.
+merge:
+; CHECK: 4 = MemoryPhi({%then,2},{%else,3})
+; CHECK: MemoryUse(4) clobbered by 1
+; CHECK-NEXT: load i32* %a
+  %v = load i32* %a
+; CHECK: MemoryUse(4)
+; CHECK-NOT: clobbered
+; CHECK-NEXT: load i32* %b
+  %w = load i32* %b
+  %r = add i32 %v, %w
+  ret i32 %r
+}
+
+define void @loop(i32* noalias %a, i32* noalias %b, i32 %n) {
+; CHECK-LABEL: 'loop'
+entry:
+; CHECK: 1 = MemoryDef(liveOnEntry)
+  store i32 0, i32* %a
+  br label %loop
+
+; The loop doesn't write %a, so the load's clobber is outside it.
+loop:
+; CHECK: 3 = MemoryPhi({%entry,1},{%loop,2})
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+; CHECK: 2 = MemoryDef(3)
+; CHECK-NEXT: store i32 %i, i32* %b
+  store i32 %i, i32* %b
+; CHECK: MemoryUse(2) clobbered by 1
+; CHECK-NEXT: load i32* %a
+  %v = load i32* %a
+  %i.next = add i32 %i, %v
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,42 @@
+; RUN: opt < %s -indvars -stats -S 2>&1 | FileCheck %s
+; RUN: opt < %s -indvars -scalar-evolution-cache-budget=1 -stats -S 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=BUDGET
+; REQUIRES: asserts
+
+; The results are the same whether or not the caches are dropped.
+; CHECK-LABEL: @nest(
+; CHECK: icmp ne i32 %{{.*}}, 100
+; CHECK: icmp ne i32 %{{.*}}, 200
+; CHECK: 1 scalar-evolution - Number of loop nests whose cached results were released
+; CHECK-NOT: dropped for being over budget
+
+; BUDGET-LABEL: @nest(
+; BUDGET: icmp ne i32 %{{.*}}, 100
+; BUDGET: icmp ne i32 %{{.*}}, 200
+; BUDGET: 2 scalar-evolution - Number of times the caches were dropped for being over budget
+
+define void @nest(i32* %p) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i32 [ 0, %outer ], [ %j.next, %inner ]
+  %idx = add i32 %i, %j
+  %gep = getelementptr i32* %p, i32 %idx
+  store i32 %j, i32* %gep
+  %j.next = add i32 %j, 1
+  %inner.cmp = icmp ult i32 %j.next, 100
+  br i1 %inner.cmp, label %inner, label %outer.latch
+
+outer.latch:
+  %i.next = add i32 %i, 1
+  %outer.cmp = icmp ult i32 %i.next, 200
+  br i1 %outer.cmp, label %outer, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,31 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s | opt -S | FileCheck %s
+
+; The module block starts its function bodies with an index of their offsets,
+; which the reader uses to find them.
+
+; BC: <FNINDEX abbrevid={{[0-9]+}}/> blob data = unprintable, 24 bytes.
+; BC-NEXT: <FUNCTION_BLOCK
+
+declare i32 @ext(i32)
+
+; CHECK: define i32 @first(i32 %x)
+; CHECK-NEXT: %y = call i32 @third(i32 %x)
+define i32 @first(i32 %x) {
+  %y = call i32 @third(i32 %x)
+  ret i32 %y
+}
+
+; CHECK: define i32 @second(i32 %x)
+; CHECK-NEXT: %y = add i32 %x, 2
+define i32 @second(i32 %x) {
+  %y = add i32 %x, 2
+  ret i32 %y
+}
+
+; CHECK: define i32 @third(i32 %x)
+; CHECK-NEXT: %y = call i32 @ext(i32 %x)
+define i32 @third(i32 %x) {
+  %y = call i32 @ext(i32 %x)
+  ret i32 %y
+}
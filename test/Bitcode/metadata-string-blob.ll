@@ -0,0 +1,13 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s | llvm-dis | FileCheck %s
+
+; Metadata strings are written as blobs so that the reader can use them in
+; place.
+
+; BC-DAG: <METADATA_STRING abbrevid={{[0-9]+}}/> blob data = 'hello world'
+; BC-DAG: <METADATA_STRING abbrevid={{[0-9]+}}/> blob data = ''
+
+; CHECK: !0 = metadata !{metadata !"hello world", metadata !""}
+
+!llvm.foo = !{!0}
+!0 = metadata !{metadata !"hello world", metadata !""}
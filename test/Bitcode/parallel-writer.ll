@@ -0,0 +1,54 @@
+; RUN: llvm-as < %s > %t.serial
+; RUN: llvm-as -bitcode-writer-threads=4 < %s > %t.parallel
+; RUN: cmp %t.serial %t.parallel
+; RUN: llvm-dis < %t.parallel | FileCheck %s
+
+; Function blocks encoded on several threads are spliced into the module
+; block in order, giving the same bytes as the serial writer.
+
+@g = global i32 7
+@table = constant [2 x i8*] [i8* blockaddress(@indirect, %one), i8* blockaddress(@indirect, %two)]
+
+; CHECK: define i32 @constants(i32 %x)
+; CHECK-NEXT: %a = add i32 %x, 42
+; CHECK-NEXT: %b = mul i32 %a, ptrtoint (i32* @g to i32)
+define i32 @constants(i32 %x) {
+  %a = add i32 %x, 42
+  %b = mul i32 %a, ptrtoint (i32* @g to i32)
+  ret i32 %b
+}
+
+; CHECK: define void @indirect(i8* %dest)
+; CHECK: indirectbr i8* %dest, [label %one, label %two]
+define void @indirect(i8* %dest) {
+entry:
+  indirectbr i8* %dest, [label %one, label %two]
+one:
+  store i32 1, i32* @g
+  ret void
+two:
+  store i32 2, i32* @g, !tbaa !3
+  ret void
+}
+
+; CHECK: define i32 @debug(i32 %x)
+; CHECK-NEXT: %y = sub i32 %x, 1, !dbg !{{[0-9]+}}
+; CHECK-NEXT: ret i32 %y, !dbg !{{[0-9]+}}
+define i32 @debug(i32 %x) {
+  %y = sub i32 %x, 1, !dbg !4
+  ret i32 %y, !dbg !5
+}
+
+; CHECK: define float @floats(float %x)
+; CHECK-NEXT: %y = fadd float %x, 1.500000e+00
+define float @floats(float %x) {
+  %y = fadd float %x, 1.5
+  ret float %y
+}
+
+!0 = metadata !{metadata !"root"}
+!1 = metadata !{metadata !"int", metadata !0}
+!2 = metadata !{metadata !"scope"}
+!3 = metadata !{metadata !1, metadata !1, i64 0}
+!4 = metadata !{i32 3, i32 5, metadata !2, null}
+!5 = metadata !{i32 4, i32 5, metadata !2, null}
@@ -0,0 +1,53 @@
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s -check-prefix=BC
+; RUN: llvm-as < %s > %t
+; RUN: llvm-nm %t | FileCheck %s -check-prefix=NM
+
+; The module block starts with a table of the global values of the module,
+; which llvm-nm reads instead of parsing the module.
+
+; BC: <VERSION op0=1/>
+; BC-NEXT: <SYMTAB_BLOCK
+; BC-NEXT: <ENTRY abbrevid=4 op0=0 op1=0 op2=0 op3=0/> blob data = 'func'
+; BC-NEXT: <ENTRY abbrevid=4 op0=0 op1=11 op2=0 op3=4/> blob data = 'odr'
+; BC-NEXT: <ENTRY abbrevid=4 op0=0 op1=0 op2=0 op3=1/> blob data = 'decl'
+; BC-NEXT: <ENTRY abbrevid=4 op0=1 op1=0 op2=0 op3=0/> blob data = 'var'
+; BC-NEXT: <ENTRY abbrevid=4 op0=1 op1=0 op2=0 op3=10/> blob data = 'tls'
+; BC-NEXT: <ENTRY abbrevid=4 op0=1 op1=0 op2=0 op3=1/> blob data = 'ext'
+; BC-NEXT: <ENTRY abbrevid=4 op0=1 op1=3 op2=0 op3=0/> blob data = 'internal_var'
+; BC-NEXT: <ENTRY abbrevid=4 op0=1 op1=9 op2=0 op3=0/> blob data = 'private_var'
+; BC-NEXT: <ENTRY abbrevid=4 op0=1 op1=0 op2=1 op3=0/> blob data = 'hidden'
+; BC-NEXT: <ENTRY abbrevid=4 op0=2 op1=0 op2=0 op3=16/> blob data = 'alias'
+; BC-NEXT: <ENTRY abbrevid=4 op0=2 op1=0 op2=0 op3=32/> blob data = 'valias'
+; BC-NEXT: </SYMTAB_BLOCK>
+
+; NM: T alias
+; NM-NEXT: U decl
+; NM-NEXT: U ext
+; NM-NEXT: T func
+; NM-NEXT: D hidden
+; NM-NEXT: d internal_var
+; NM-NEXT: C odr
+; NM-NEXT: D tls
+; NM-NEXT: D valias
+; NM-NEXT: D var
+; NM-NOT: private_var
+
+@var = global i32 1
+@tls = thread_local constant i32 2
+@ext = external global i32
+@internal_var = internal global i32 3
+@private_var = private global i32 4
+@hidden = hidden global i32 5
+
+@alias = alias void ()* @func
+@valias = alias i32* @var
+
+define void @func() {
+  ret void
+}
+
+define linkonce_odr void @odr() unnamed_addr {
+  ret void
+}
+
+declare void @decl()
@@ -0,0 +1,16 @@
+; RUN: llc -verify-machineinstrs < %s -mtriple=aarch64-none-linux-gnu -mcpu=cortex-a53 | FileCheck %s
+
+; On the in-order Cortex-A53 both loads should issue before the first use of
+; either, so that their latencies overlap.
+define i32 @load_use(i32* %a, i32* %b, i32 %x) {
+; CHECK-LABEL: load_use:
+; CHECK: ldr
+; CHECK: ldr
+; CHECK: add
+; CHECK: ret
+  %va = load i32* %a
+  %sa = add i32 %va, %x
+  %vb = load i32* %b
+  %sb = mul i32 %vb, %sa
+  ret i32 %sb
+}
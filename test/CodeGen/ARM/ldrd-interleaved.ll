@@ -0,0 +1,42 @@
+; RUN: llc < %s -mtriple=thumbv7-apple-ios -mcpu=cortex-a8 -relocation-model=static | FileCheck %s
+
+; A copy between two distinct objects, one field at a time. The stores to @dst
+; cannot clobber the loads from @src, so the loads and the stores can each be
+; grouped into a single paired access.
+
+@src = global [2 x i32] zeroinitializer, align 8
+@dst = global [2 x i32] zeroinitializer, align 8
+
+define void @copy() nounwind {
+entry:
+; CHECK-LABEL: copy:
+; CHECK: {{ldrd|ldm}}
+; CHECK-NOT: ldr
+; CHECK: {{strd|stm}}
+; CHECK-NOT: str
+; CHECK: bx lr
+  %0 = load i32* getelementptr inbounds ([2 x i32]* @src, i32 0, i32 0), align 8
+  store i32 %0, i32* getelementptr inbounds ([2 x i32]* @dst, i32 0, i32 0), align 8
+  %1 = load i32* getelementptr inbounds ([2 x i32]* @src, i32 0, i32 1), align 4
+  store i32 %1, i32* getelementptr inbounds ([2 x i32]* @dst, i32 0, i32 1), align 4
+  ret void
+}
+
+; The same copy split across a fall-through block boundary.
+define void @copy_blocks() nounwind {
+entry:
+; CHECK-LABEL: copy_blocks:
+; CHECK: {{ldrd|ldm}}
+; CHECK-NOT: ldr
+; CHECK: {{strd|stm}}
+; CHECK-NOT: str
+; CHECK: bx lr
+  %0 = load i32* getelementptr inbounds ([2 x i32]* @src, i32 0, i32 0), align 8
+  store i32 %0, i32* getelementptr inbounds ([2 x i32]* @dst, i32 0, i32 0), align 8
+  br label %next
+
+next:
+  %1 = load i32* getelementptr inbounds ([2 x i32]* @src, i32 0, i32 1), align 4
+  store i32 %1, i32* getelementptr inbounds ([2 x i32]* @dst, i32 0, i32 1), align 4
+  ret void
+}
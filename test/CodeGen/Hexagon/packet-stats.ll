@@ -0,0 +1,21 @@
+; RUN: llc -march=hexagon -mcpu=hexagonv4 -hexagon-packet-stats < %s \
+; RUN:   -o /dev/null 2>&1 | FileCheck %s
+; Check that the packetizer reports packet density for each function.
+
+; CHECK: Packet stats for foo: {{[0-9]+}} instructions in {{[0-9]+}} packets
+; CHECK: {{[0-9]+}} dependence stalls, {{[0-9]+}} resource stalls
+
+@a = external global i32
+@b = external global i32
+@c = external global i32
+
+define void @foo(i32 %x, i32 %y) nounwind {
+entry:
+  %add = add nsw i32 %x, %y
+  %sub = sub nsw i32 %x, %y
+  store i32 %add, i32* @a, align 4
+  store i32 %sub, i32* @b, align 4
+  %mul = mul nsw i32 %add, %sub
+  store i32 %mul, i32* @c, align 4
+  ret void
+}
@@ -11,10 +11,12 @@ target triple = "nvptx-nvidia-cuda"
 @myconst = internal constant i32 42, align 4
 
 
+; The conversions back to generic pointers are folded away again, so the
+; loads go straight to the global address space.
 define void @foo(i32* %a, i32* %b) {
-; CHECK: cvta.global.u32
+; CHECK: ld.global.u32
   %ld1 = load i32* @myglobal
-; CHECK: cvta.global.u32
+; CHECK: ld.global.u32
   %ld2 = load i32* @myconst
   store i32 %ld1, i32* %a
   store i32 %ld2, i32* %b
@@ -0,0 +1,52 @@
+; RUN: llc < %s -march=nvptx -mcpu=sm_20 | FileCheck %s
+
+; Loads and stores through generic pointers that can only point into one
+; address space are done in that address space.
+
+@shared = internal addrspace(3) global [16 x float] zeroinitializer, align 4
+
+declare float* @llvm.nvvm.ptr.global.to.gen.p0f32.p1f32(float addrspace(1)*)
+
+define float @load_shared(i32 %i) {
+; CHECK-LABEL: load_shared
+; CHECK: ld.shared.f32
+  %p = getelementptr [16 x float]* addrspacecast ([16 x float] addrspace(3)* @shared to [16 x float]*), i32 0, i32 %i
+  %v = load float* %p, align 4
+  ret float %v
+}
+
+; The address space is propagated around the loop.
+define void @sum(float addrspace(1)* %in, float* %out, i32 %n) {
+; CHECK-LABEL: sum
+; CHECK: ld.global.f32
+; CHECK: st.f32
+entry:
+  %gen = call float* @llvm.nvvm.ptr.global.to.gen.p0f32.p1f32(float addrspace(1)* %in)
+  br label %loop
+
+loop:
+  %p = phi float* [ %gen, %entry ], [ %p.next, %loop ]
+  %acc = phi float [ 0.0, %entry ], [ %acc.next, %loop ]
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v = load float* %p, align 4
+  %acc.next = fadd float %acc, %v
+  %p.next = getelementptr float* %p, i32 1
+  %i.next = add i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  store float %acc.next, float* %out, align 4
+  ret void
+}
+
+; A pointer that may point into either of two spaces stays generic.
+define float @select_spaces(float addrspace(1)* %g, i32 %i, i1 %c) {
+; CHECK-LABEL: select_spaces
+; CHECK: ld.f32
+  %gen = call float* @llvm.nvvm.ptr.global.to.gen.p0f32.p1f32(float addrspace(1)* %g)
+  %sh = getelementptr [16 x float]* addrspacecast ([16 x float] addrspace(3)* @shared to [16 x float]*), i32 0, i32 %i
+  %p = select i1 %c, float* %gen, float* %sh
+  %v = load float* %p, align 4
+  ret float %v
+}
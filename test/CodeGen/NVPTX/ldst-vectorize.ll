@@ -0,0 +1,54 @@
+; RUN: llc < %s -march=nvptx -mcpu=sm_20 | FileCheck %s
+
+; Scalar accesses to consecutive, suitably aligned addresses are merged into
+; vector loads and stores.
+
+define void @copy4(float addrspace(1)* %in, float addrspace(1)* %out) {
+; CHECK-LABEL: copy4
+; CHECK: ld.global.v4.f32
+; CHECK: st.global.v4.f32
+  %in1 = getelementptr float addrspace(1)* %in, i32 1
+  %in2 = getelementptr float addrspace(1)* %in, i32 2
+  %in3 = getelementptr float addrspace(1)* %in, i32 3
+  %v0 = load float addrspace(1)* %in, align 16
+  %v1 = load float addrspace(1)* %in1, align 4
+  %v2 = load float addrspace(1)* %in2, align 8
+  %v3 = load float addrspace(1)* %in3, align 4
+  %out1 = getelementptr float addrspace(1)* %out, i32 1
+  %out2 = getelementptr float addrspace(1)* %out, i32 2
+  %out3 = getelementptr float addrspace(1)* %out, i32 3
+  store float %v0, float addrspace(1)* %out, align 16
+  store float %v1, float addrspace(1)* %out1, align 4
+  store float %v2, float addrspace(1)* %out2, align 8
+  store float %v3, float addrspace(1)* %out3, align 4
+  ret void
+}
+
+; Interleaved loads and stores can be grouped when they do not alias.
+define void @copy2_interleaved(i64 addrspace(1)* noalias %in,
+                               i64 addrspace(1)* noalias %out) {
+; CHECK-LABEL: copy2_interleaved
+; CHECK: ld.global.v2.u64
+; CHECK: st.global.v2.u64
+  %v0 = load i64 addrspace(1)* %in, align 16
+  store i64 %v0, i64 addrspace(1)* %out, align 16
+  %in1 = getelementptr i64 addrspace(1)* %in, i32 1
+  %out1 = getelementptr i64 addrspace(1)* %out, i32 1
+  %v1 = load i64 addrspace(1)* %in1, align 8
+  store i64 %v1, i64 addrspace(1)* %out1, align 8
+  ret void
+}
+
+; Accesses that are not aligned to the vector size stay scalar.
+define void @underaligned(i32 addrspace(1)* %in, i32 addrspace(1)* %out) {
+; CHECK-LABEL: underaligned
+; CHECK-NOT: ld.global.v2
+; CHECK: ld.global.u32
+; CHECK: ld.global.u32
+  %in1 = getelementptr i32 addrspace(1)* %in, i32 1
+  %v0 = load i32 addrspace(1)* %in, align 4
+  %v1 = load i32 addrspace(1)* %in1, align 4
+  %s = add i32 %v0, %v1
+  store i32 %s, i32 addrspace(1)* %out, align 4
+  ret void
+}
@@ -0,0 +1,84 @@
+; RUN: llc < %s -mcpu=pwr8 | FileCheck %s
+target datalayout = "E-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v128:128:128-n32:64"
+target triple = "powerpc64-unknown-linux-gnu"
+
+; A call to a noreturn function on an error path does not return to the
+; loop, so it does not prevent a CTR loop.
+define void @noret(i32* nocapture %a) nounwind {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %inc, %for.inc ]
+  %arrayidx = getelementptr inbounds i32* %a, i64 %i
+  %0 = load i32* %arrayidx, align 4
+  %cmp = icmp slt i32 %0, 0
+  br i1 %cmp, label %fail, label %for.inc
+
+fail:
+  tail call void @abort() noreturn nounwind
+  unreachable
+
+for.inc:
+  %add = add nsw i32 %0, 1
+  store i32 %add, i32* %arrayidx, align 4
+  %inc = add nsw i64 %i, 1
+  %exitcond = icmp eq i64 %inc, 2048
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; CHECK-LABEL: @noret
+; CHECK: mtctr
+; CHECK: bdnz
+
+; A small memcpy becomes loads and stores, not a call to memcpy.
+define void @small_memcpy(i8* nocapture %dst, i8* nocapture %src) nounwind {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %inc, %for.body ]
+  %d = getelementptr inbounds i8* %dst, i64 %i
+  tail call void @llvm.memcpy.p0i8.p0i8.i64(i8* %d, i8* %src, i64 4, i32 1, i1 false)
+  %inc = add nsw i64 %i, 4
+  %exitcond = icmp eq i64 %inc, 2048
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; CHECK-LABEL: @small_memcpy
+; CHECK-NOT: bl memcpy
+; CHECK: mtctr
+; CHECK-NOT: bl memcpy
+; CHECK: bdnz
+
+; A large memcpy is a real call, which clobbers the counter register.
+define void @large_memcpy(i8* nocapture %dst, i8* nocapture %src) nounwind {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %inc, %for.body ]
+  %d = getelementptr inbounds i8* %dst, i64 %i
+  tail call void @llvm.memcpy.p0i8.p0i8.i64(i8* %d, i8* %src, i64 4096, i32 1, i1 false)
+  %inc = add nsw i64 %i, 4096
+  %exitcond = icmp eq i64 %inc, 65536
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; CHECK-LABEL: @large_memcpy
+; CHECK-NOT: mtctr
+; CHECK: bl memcpy
+; CHECK-NOT: bdnz
+; CHECK: blr
+
+declare void @abort() noreturn nounwind
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8* nocapture, i8* nocapture, i64, i32, i1) nounwind
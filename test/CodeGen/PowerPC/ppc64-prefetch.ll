@@ -13,3 +13,13 @@ declare void @llvm.prefetch(i8*, i32, i32, i32)
 ; CHECK: @test1
 ; CHECK: dcbt
 
+
+define void @test2(i8* %a, ...) nounwind {
+entry:
+  call void @llvm.prefetch(i8* %a, i32 1, i32 3, i32 1)
+  ret void
+}
+
+; CHECK: @test2
+; CHECK: dcbtst
+
@@ -0,0 +1,15 @@
+; RUN: llc < %s -march=r600 -mcpu=verde -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -march=r600 -mcpu=verde -si-target-waves=8 -verify-machineinstrs | FileCheck %s
+
+; A small kernel leaves room for the maximum number of waves.
+
+; CHECK-LABEL: @small:
+; CHECK: ; NumVgprs: {{[0-9]+}}
+; CHECK: ; NumSgprs: {{[0-9]+}}
+; CHECK: ; Occupancy: 10 waves per SIMD
+define void @small(i32 addrspace(1)* %out, i32 addrspace(1)* %in) {
+  %a = load i32 addrspace(1)* %in
+  %b = add i32 %a, 1
+  store i32 %b, i32 addrspace(1)* %out
+  ret void
+}
@@ -0,0 +1,25 @@
+; Check that the z196 and zEC12 machine models are accepted by the
+; machine scheduler.
+;
+; RUN: llc < %s -mtriple=s390x-linux-gnu -mcpu=z196 -enable-misched \
+; RUN:   -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -mtriple=s390x-linux-gnu -mcpu=zEC12 -enable-misched \
+; RUN:   -verify-machineinstrs | FileCheck %s
+
+define i64 @f1(i64 %a, i64 %b, double %c, double %d, i64 *%ptr) {
+; CHECK-LABEL: f1:
+; CHECK-DAG: dsgr
+; CHECK-DAG: msgr
+; CHECK-DAG: ddbr
+; CHECK-DAG: lg {{%r[0-9]+}}, 0(%r4)
+; CHECK: br %r14
+  %div = sdiv i64 %a, %b
+  %mul = mul i64 %a, %b
+  %fdiv = fdiv double %c, %d
+  %conv = fptosi double %fdiv to i64
+  %val = load i64 *%ptr
+  %add1 = add i64 %div, %mul
+  %add2 = add i64 %add1, %conv
+  %add3 = add i64 %add2, %val
+  ret i64 %add3
+}
@@ -0,0 +1,76 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -disable-fp-elim | FileCheck %s
+
+; A GC pointer live across a call is stored to a slot before it and reloaded
+; after it, and the slot is recorded as a Direct location, once as the base
+; and once as the pointer, in the stack map of the call.
+
+declare void @collect()
+declare void @use(i8 addrspace(1)*)
+
+define void @live(i8 addrspace(1)* %p) gc "statepoint" {
+entry:
+; CHECK-LABEL: live:
+; CHECK: movq %rdi, [[SLOT:-?[0-9]+]](%rbp)
+; CHECK-NEXT: callq collect
+; CHECK: movq [[SLOT]](%rbp), %rdi
+; CHECK-NEXT: callq use
+  call void @collect()
+  call void @use(i8 addrspace(1)* %p)
+  ret void
+}
+
+; The derived pointer is relocated along with its base.
+
+define void @derived(i64 addrspace(1)* %p) gc "statepoint" {
+entry:
+; CHECK-LABEL: derived:
+; CHECK: callq collect
+  %q = getelementptr i64 addrspace(1)* %p, i64 2
+  call void @collect()
+  store i64 0, i64 addrspace(1)* %q
+  ret void
+}
+
+; CHECK-LABEL:  .section  .llvm_stackmaps,"a",@progbits
+; CHECK-NEXT:  __LLVM_StackMaps:
+; CHECK-NEXT:   .long   0
+; Num LargeConstants
+; CHECK-NEXT:   .long   0
+; Num Callsites
+; CHECK-NEXT:   .long   2
+
+; @live: the base and the pointer are the same slot.
+; CHECK-NEXT:   .long   0
+; CHECK-NEXT:   .long   .L{{.*}}-live
+; CHECK-NEXT:   .short  0
+; CHECK-NEXT:   .short  2
+; CHECK-NEXT:   .byte   2
+; CHECK-NEXT:   .byte   8
+; CHECK-NEXT:   .short  6
+; CHECK-NEXT:   .long   [[SLOT]]
+; CHECK-NEXT:   .byte   2
+; CHECK-NEXT:   .byte   8
+; CHECK-NEXT:   .short  6
+; CHECK-NEXT:   .long   [[SLOT]]
+
+; @derived: the base, then the derived pointer, each in its own slot.
+; CHECK-NEXT:   .long   1
+; CHECK-NEXT:   .long   .L{{.*}}-derived
+; CHECK-NEXT:   .short  0
+; CHECK-NEXT:   .short  4
+; CHECK-NEXT:   .byte   2
+; CHECK-NEXT:   .byte   8
+; CHECK-NEXT:   .short  6
+; CHECK-NEXT:   .long   [[BASE:-?[0-9]+]]
+; CHECK-NEXT:   .byte   2
+; CHECK-NEXT:   .byte   8
+; CHECK-NEXT:   .short  6
+; CHECK-NEXT:   .long   [[BASE]]
+; CHECK-NEXT:   .byte   2
+; CHECK-NEXT:   .byte   8
+; CHECK-NEXT:   .short  6
+; CHECK-NEXT:   .long   [[BASE]]
+; CHECK-NEXT:   .byte   2
+; CHECK-NEXT:   .byte   8
+; CHECK-NEXT:   .short  6
+; CHECK-NEXT:   .long   {{-?[0-9]+}}
@@ -269,3 +269,21 @@ entry:
   %d = and <8 x i64> %p1, %c
   ret <8 x i64>%d
 }
+
+; CHECK-LABEL: fabs_v8f64
+; CHECK: vpandq
+; CHECK: ret
+declare <8 x double> @llvm.fabs.v8f64(<8 x double>)
+define <8 x double> @fabs_v8f64(<8 x double> %p) {
+  %t = call <8 x double> @llvm.fabs.v8f64(<8 x double> %p)
+  ret <8 x double> %t
+}
+
+; CHECK-LABEL: fabs_v16f32
+; CHECK: vpandq
+; CHECK: ret
+declare <16 x float> @llvm.fabs.v16f32(<16 x float>)
+define <16 x float> @fabs_v16f32(<16 x float> %p) {
+  %t = call <16 x float> @llvm.fabs.v16f32(<16 x float> %p)
+  ret <16 x float> %t
+}
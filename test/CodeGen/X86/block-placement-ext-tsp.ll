@@ -0,0 +1,102 @@
+; RUN: llc -mtriple=i686-linux -pre-RA-sched=source -block-placement-ext-tsp < %s | FileCheck %s
+
+declare void @error(i32 %i, i32 %a, i32 %b)
+
+define i32 @test_ifchains(i32 %i, i32* %a, i32 %b) {
+; The hot path falls through from the entry to the exit, and the unlikely
+; blocks are placed after it.
+; CHECK-LABEL: test_ifchains:
+; CHECK: %entry
+; CHECK-NOT: %then
+; CHECK: %else1
+; CHECK-NOT: %then
+; CHECK: %else2
+; CHECK-NOT: %then
+; CHECK: %exit
+; CHECK-DAG: %then1
+; CHECK-DAG: %then2
+; CHECK-DAG: %then3
+
+entry:
+  %gep1 = getelementptr i32* %a, i32 1
+  %val1 = load i32* %gep1
+  %cond1 = icmp ugt i32 %val1, 1
+  br i1 %cond1, label %then1, label %else1, !prof !0
+
+then1:
+  call void @error(i32 %i, i32 1, i32 %b)
+  br label %else1
+
+else1:
+  %gep2 = getelementptr i32* %a, i32 2
+  %val2 = load i32* %gep2
+  %cond2 = icmp ugt i32 %val2, 2
+  br i1 %cond2, label %then2, label %else2, !prof !0
+
+then2:
+  call void @error(i32 %i, i32 1, i32 %b)
+  br label %else2
+
+else2:
+  %gep3 = getelementptr i32* %a, i32 3
+  %val3 = load i32* %gep3
+  %cond3 = icmp ugt i32 %val3, 3
+  br i1 %cond3, label %then3, label %exit, !prof !0
+
+then3:
+  call void @error(i32 %i, i32 1, i32 %b)
+  br label %exit
+
+exit:
+  ret i32 %b
+}
+
+define i32 @test_loop_cold_blocks(i32 %i, i32* %a) {
+; Unlike the greedy layout, which rotates the loop to put the cold blocks in
+; front of it, the entry falls through into the loop and the cold blocks go
+; after the whole loop body.
+; CHECK-LABEL: test_loop_cold_blocks:
+; CHECK: %entry
+; CHECK-NOT: %unlikely
+; CHECK: %body1
+; CHECK-NOT: %unlikely
+; CHECK: %body2
+; CHECK-NOT: %unlikely
+; CHECK: %body3
+; CHECK-DAG: %unlikely1
+; CHECK-DAG: %unlikely2
+
+entry:
+  br label %body1
+
+body1:
+  %iv = phi i32 [ 0, %entry ], [ %next, %body3 ]
+  %base = phi i32 [ 0, %entry ], [ %sum, %body3 ]
+  %unlikelycond1 = icmp slt i32 %base, 42
+  br i1 %unlikelycond1, label %unlikely1, label %body2, !prof !0
+
+unlikely1:
+  call void @error(i32 %i, i32 1, i32 %base)
+  br label %body2
+
+body2:
+  %unlikelycond2 = icmp sgt i32 %base, 21
+  br i1 %unlikelycond2, label %unlikely2, label %body3, !prof !0
+
+unlikely2:
+  call void @error(i32 %i, i32 2, i32 %base)
+  br label %body3
+
+body3:
+  %arrayidx = getelementptr inbounds i32* %a, i32 %iv
+  %0 = load i32* %arrayidx
+  %sum = add nsw i32 %0, %base
+  %next = add i32 %iv, 1
+  %exitcond = icmp eq i32 %next, %i
+  br i1 %exitcond, label %exit, label %body1
+
+exit:
+  ret i32 %sum
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 4, i32 64}
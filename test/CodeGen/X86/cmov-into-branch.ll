@@ -61,3 +61,31 @@ define i32 @test5(i32 %a, i32* nocapture %b, i32 %x, i32 %y) {
 ; CHECK: cmov
 ; CHECK: cmov
 }
+
+; The weights show the condition is predictable, so a branch is better even
+; without a load.
+define i32 @test6(i32 %a, i32 %b, i32 %x, i32 %y) {
+  %cmp = icmp slt i32 %a, %b
+  %cond = select i1 %cmp, i32 %x, i32 %y, !prof !0
+  ret i32 %cond
+; CHECK-LABEL: test6:
+; CHECK: cmpl
+; CHECK-NOT: cmov
+; CHECK: j
+; CHECK-NOT: cmov
+}
+
+; The weights show the condition is unpredictable, so keep the cmov even
+; though the compare has a load.
+define i32 @test7(double %a, double* nocapture %b, i32 %x, i32 %y) {
+  %load = load double* %b, align 8
+  %cmp = fcmp olt double %load, %a
+  %cond = select i1 %cmp, i32 %x, i32 %y, !prof !1
+  ret i32 %cond
+; CHECK-LABEL: test7:
+; CHECK: ucomisd
+; CHECK: cmov
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 2000}
+!1 = metadata !{metadata !"branch_weights", i32 3, i32 2}
@@ -0,0 +1,24 @@
+; RUN: llc -mtriple=x86_64-linux < %s > %t.all
+; RUN: llc -mtriple=x86_64-linux -join-retry-changed-only < %s > %t.changed
+; RUN: diff %t.all %t.changed
+
+; Only retrying the copies whose registers have changed coalesces the same
+; copies as retrying all of them.
+
+define i32 @swap_loop(i32 %a, i32 %b, i32 %n) nounwind {
+entry:
+  br label %loop
+
+loop:
+  %x = phi i32 [ %a, %entry ], [ %y, %loop ]
+  %y = phi i32 [ %b, %entry ], [ %z, %loop ]
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %z = add i32 %x, %y
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = mul i32 %x, %z
+  ret i32 %r
+}
@@ -0,0 +1,19 @@
+; REQUIRES: asserts
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -stats 2>&1 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -combiner-node-visit-limit=1 \
+; RUN:   | FileCheck %s -check-prefix=LIMIT
+
+; The combiner counts the nodes it visits.
+; CHECK: dagcombine - Number of dag nodes visited
+
+; Limiting the visits to each node still produces correct code.
+; LIMIT-LABEL: f:
+; LIMIT: ret
+
+define i32 @f(i32 %a, i32 %b) nounwind {
+  %t1 = add i32 %a, 1
+  %t2 = add i32 %t1, 2
+  %t3 = shl i32 %t2, 1
+  %t4 = add i32 %t3, %b
+  ret i32 %t4
+}
@@ -0,0 +1,49 @@
+; RUN: llc < %s -mtriple=x86_64-apple-macosx10.8.0 -mcpu=corei7 -x86-early-ifcvt | FileCheck %s
+
+; A diamond on a condition with no known bias is if-converted.
+; CHECK-LABEL: unpredictable:
+; CHECK: cmov
+define i32 @unpredictable(i32 %a, i32 %b, i32 %c) nounwind readnone {
+entry:
+  %cmp = icmp slt i32 %a, %b
+  br i1 %cmp, label %if.then, label %if.else
+
+if.then:
+  %add = add nsw i32 %c, 3
+  br label %if.end
+
+if.else:
+  %sub = xor i32 %c, 7
+  br label %if.end
+
+if.end:
+  %r = phi i32 [ %add, %if.then ], [ %sub, %if.else ]
+  ret i32 %r
+}
+
+; The weights say the branch is almost never taken, so it is predicted right
+; and stays a branch.
+; CHECK-LABEL: predictable:
+; CHECK-NOT: cmov
+; CHECK: j
+; CHECK-NOT: cmov
+; CHECK: ret
+define i32 @predictable(i32 %a, i32 %b, i32 %c) nounwind readnone {
+entry:
+  %cmp = icmp slt i32 %a, %b
+  br i1 %cmp, label %if.then, label %if.else, !prof !0
+
+if.then:
+  %add = add nsw i32 %c, 3
+  br label %if.end
+
+if.else:
+  %sub = xor i32 %c, 7
+  br label %if.end
+
+if.end:
+  %r = phi i32 [ %add, %if.then ], [ %sub, %if.else ]
+  ret i32 %r
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 2000}
@@ -0,0 +1,65 @@
+; RUN: llc -O0 -mtriple=x86_64-linux -asm-verbose=false < %s | FileCheck %s
+; RUN: llc -O0 -mtriple=x86_64-linux -fast-isel-verbose -o /dev/null < %s 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=MISSES
+
+; Small switches are selected by fast-isel as a chain of compares.
+
+; CHECK-LABEL: small:
+; CHECK: cmpl $1, %edi
+; CHECK-NEXT: je
+; CHECK-NEXT: cmpl $7, %edi
+; CHECK-NEXT: je
+; CHECK-NEXT: cmpl $9, %edi
+; CHECK-NEXT: je
+; CHECK-NEXT: jmp
+define i32 @small(i32 %x) nounwind {
+entry:
+  switch i32 %x, label %def [
+    i32 1, label %one
+    i32 7, label %seven
+    i32 9, label %one
+  ]
+one:
+  ret i32 10
+seven:
+  ret i32 70
+def:
+  ret i32 0
+}
+
+; CHECK-LABEL: wide:
+; CHECK: movabsq $4294967296, [[REG:%r[a-z0-9]+]]
+; CHECK: cmpq [[REG]], %rdi
+; CHECK-NEXT: je
+define i64 @wide(i64 %x) nounwind {
+entry:
+  switch i64 %x, label %def [
+    i64 4294967296, label %big
+  ]
+big:
+  ret i64 1
+def:
+  ret i64 0
+}
+
+; Larger switches are left to SelectionDAG.
+
+; MISSES-NOT: FastISel missed
+; MISSES: FastISel missed terminator: switch i32 %x, label %def [
+; MISSES-NEXT: i32 1, label %a
+; MISSES-NOT: FastISel missed
+define i32 @large(i32 %x) nounwind {
+entry:
+  switch i32 %x, label %def [
+    i32 1, label %a
+    i32 2, label %b
+    i32 3, label %a
+    i32 4, label %b
+  ]
+a:
+  ret i32 1
+b:
+  ret i32 2
+def:
+  ret i32 0
+}
@@ -0,0 +1,46 @@
+; RUN: llc < %s -mtriple=x86_64-apple-darwin -mcpu=core-avx2 | FileCheck %s --check-prefix=AVX2
+; RUN: llc < %s -mtriple=x86_64-apple-darwin -mcpu=corei7-avx | FileCheck %s --check-prefix=AVX1
+; RUN: llc < %s -mtriple=x86_64-apple-darwin -mcpu=knl | FileCheck %s --check-prefix=KNL
+
+declare <4 x float> @llvm.gather.v4f32.v4i32(i8*, <4 x i32>)
+declare <4 x double> @llvm.gather.v4f64.v4i64(i8*, <4 x i64>)
+declare <4 x i32> @llvm.gather.v4i32.v4i64(i8*, <4 x i64>)
+declare <16 x float> @llvm.gather.v16f32.v16i32(i8*, <16 x i32>)
+
+; AVX2-LABEL: gather_d_ps:
+; AVX2: vgatherdps
+; AVX2: ret
+
+; Without AVX2 every element is loaded on its own.
+; AVX1-LABEL: gather_d_ps:
+; AVX1-NOT: vgather
+; AVX1: ret
+define <4 x float> @gather_d_ps(i8* %base, <4 x i32> %idx) {
+  %res = call <4 x float> @llvm.gather.v4f32.v4i32(i8* %base, <4 x i32> %idx)
+  ret <4 x float> %res
+}
+
+; AVX2-LABEL: gather_q_pd_256:
+; AVX2: vgatherqpd
+; AVX2: ret
+define <4 x double> @gather_q_pd_256(i8* %base, <4 x i64> %idx) {
+  %res = call <4 x double> @llvm.gather.v4f64.v4i64(i8* %base, <4 x i64> %idx)
+  ret <4 x double> %res
+}
+
+; AVX2-LABEL: gather_q_d_256:
+; AVX2: vpgatherqd
+; AVX2: ret
+define <4 x i32> @gather_q_d_256(i8* %base, <4 x i64> %idx) {
+  %res = call <4 x i32> @llvm.gather.v4i32.v4i64(i8* %base, <4 x i64> %idx)
+  ret <4 x i32> %res
+}
+
+; KNL-LABEL: gather_d_ps_512:
+; KNL: kxnorw
+; KNL: vgatherdps
+; KNL: ret
+define <16 x float> @gather_d_ps_512(i8* %base, <16 x i32> %idx) {
+  %res = call <16 x float> @llvm.gather.v16f32.v16i32(i8* %base, <16 x i32> %idx)
+  ret <16 x float> %res
+}
@@ -0,0 +1,49 @@
+; RUN: llc < %s | FileCheck %s
+; RUN: llc < %s -live-debug-variables-budget=1 | FileCheck %s -check-prefix=ONE
+; RUN: llc < %s -live-debug-variables-budget=0 | FileCheck %s -check-prefix=NONE
+
+; Variables first seen once a function is over the budget of tracked
+; DBG_VALUEs are dropped, and show as optimized out.
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-apple-macosx10.7.0"
+
+; CHECK-LABEL: foo:
+; CHECK-DAG: DEBUG_VALUE: foo:i
+; CHECK-DAG: DEBUG_VALUE: foo:j
+; CHECK: ret
+
+; ONE-LABEL: foo:
+; ONE: DEBUG_VALUE: foo:
+; ONE-NOT: DEBUG_VALUE
+; ONE: ret
+
+; NONE-LABEL: foo:
+; NONE-NOT: DEBUG_VALUE
+; NONE: ret
+
+define i32 @foo(i32 %i, i32 %j) nounwind uwtable readnone ssp {
+  tail call void @llvm.dbg.value(metadata !{i32 %i}, i64 0, metadata !6), !dbg !12
+  tail call void @llvm.dbg.value(metadata !{i32 %j}, i64 0, metadata !7), !dbg !12
+  %add = add nsw i32 %j, %i, !dbg !13
+  ret i32 %add, !dbg !13
+}
+
+declare void @llvm.dbg.value(metadata, i64, metadata) nounwind readnone
+
+!llvm.dbg.cu = !{!0}
+
+!0 = metadata !{i32 786449, metadata !20, i32 12, metadata !"clang version 3.5", i1 true, metadata !"", i32 0, metadata !21, metadata !21, metadata !18, null,  null, null} ; [ DW_TAG_compile_unit ]
+!1 = metadata !{i32 786478, metadata !20, metadata !2, metadata !"foo", metadata !"foo", metadata !"", i32 1, metadata !3, i1 false, i1 true, i32 0, i32 0, null, i32 256, i1 true, i32 (i32, i32)* @foo, null, null, metadata !19, i32 0} ; [ DW_TAG_subprogram ] [line 1] [def] [scope 0] [foo]
+!2 = metadata !{i32 786473, metadata !20} ; [ DW_TAG_file_type ]
+!3 = metadata !{i32 786453, metadata !20, metadata !2, metadata !"", i32 0, i64 0, i64 0, i32 0, i32 0, null, metadata !4, i32 0, null, null, null} ; [ DW_TAG_subroutine_type ] [line 0, size 0, align 0, offset 0] [from ]
+!4 = metadata !{metadata !5}
+!5 = metadata !{i32 786468, null, metadata !0, metadata !"int", i32 0, i64 32, i64 32, i64 0, i32 0, i32 5} ; [ DW_TAG_base_type ]
+!6 = metadata !{i32 786689, metadata !1, metadata !"i", metadata !2, i32 16777217, metadata !5, i32 0, null} ; [ DW_TAG_arg_variable ]
+!7 = metadata !{i32 786689, metadata !1, metadata !"j", metadata !2, i32 33554433, metadata !5, i32 0, null} ; [ DW_TAG_arg_variable ]
+!12 = metadata !{i32 1, i32 13, metadata !1, null}
+!13 = metadata !{i32 2, i32 3, metadata !1, null}
+!18 = metadata !{metadata !1}
+!19 = metadata !{metadata !6, metadata !7}
+!20 = metadata !{metadata !"a.c", metadata !"/tmp"}
+!21 = metadata !{i32 0}
@@ -0,0 +1,36 @@
+; RUN: llc -mtriple=x86_64-linux -threads=2 -o %t.s < %s
+; RUN: FileCheck --check-prefix=PART0 %s < %t.0.s
+; RUN: FileCheck --check-prefix=PART1 %s < %t.1.s
+; RUN: not llc -mtriple=x86_64-linux -threads=2 < %s 2>&1 \
+; RUN:   | FileCheck --check-prefix=STDOUT %s
+
+; STDOUT: -threads requires an output file name
+
+; The largest function goes into the first partition.
+; PART0-NOT: bar:
+; PART0: foo:
+; PART0: callq helper.llvm.part
+; PART0-NOT: bar:
+define i32 @foo(i32 %a) {
+  %b = add i32 %a, 1
+  %c = mul i32 %b, %a
+  %d = call i32 @helper(i32 %c)
+  %e = sub i32 %d, %b
+  ret i32 %e
+}
+
+; PART1-NOT: foo:
+; PART1: bar:
+; PART1: .hidden helper.llvm.part
+; PART1: helper.llvm.part:
+; PART1-NOT: foo:
+define i32 @bar(i32 %a) {
+  %b = call i32 @helper(i32 %a)
+  ret i32 %b
+}
+
+; Referenced from both partitions, so it has to be externalized.
+define internal i32 @helper(i32 %a) noinline {
+  %b = shl i32 %a, 2
+  ret i32 %b
+}
@@ -0,0 +1,34 @@
+; REQUIRES: asserts
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -max-dag-region-size=2 \
+; RUN:   -stats 2>&1 | FileCheck %s
+
+; Blocks larger than -max-dag-region-size are selected as several DAGs, with
+; values that cross a region boundary passed in virtual registers.
+
+; CHECK-LABEL: f:
+; CHECK: imull
+; CHECK: ret
+; CHECK-LABEL: g:
+; CHECK: callq h
+; CHECK: ret
+; CHECK: isel - Number of extra DAGs built for oversized blocks
+
+define i32 @f(i32 %a, i32 %b, i32* %p) nounwind {
+entry:
+  %x = add i32 %a, %b
+  %y = mul i32 %x, %a
+  store i32 %y, i32* %p
+  %z = xor i32 %y, %b
+  %w = sub i32 %z, %x
+  ret i32 %w
+}
+
+declare i32 @h(i32)
+
+define i32 @g(i32 %a) nounwind {
+entry:
+  %x = add i32 %a, 1
+  %y = shl i32 %x, 2
+  %c = tail call i32 @h(i32 %y)
+  ret i32 %c
+}
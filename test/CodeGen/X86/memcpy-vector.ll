@@ -0,0 +1,69 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7 | FileCheck %s -check-prefix=SSE
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mcpu=core-avx2 | FileCheck %s -check-prefix=AVX
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7 -x86-vector-memop-threshold=0 | FileCheck %s -check-prefix=OFF
+
+; Medium sized copies and sets of a known size are expanded into unaligned
+; vector moves, the last of which overlaps the one before it, instead of
+; calling the library.
+
+%struct.rec = type { [25 x i64] }
+
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8* nocapture, i8* nocapture, i64, i32, i1) nounwind
+declare void @llvm.memset.p0i8.i64(i8* nocapture, i8, i64, i32, i1) nounwind
+
+define void @copy200(%struct.rec* %d, %struct.rec* %s) nounwind {
+entry:
+  %0 = bitcast %struct.rec* %d to i8*
+  %1 = bitcast %struct.rec* %s to i8*
+  tail call void @llvm.memcpy.p0i8.p0i8.i64(i8* %0, i8* %1, i64 200, i32 8, i1 false)
+  ret void
+; SSE-LABEL: copy200:
+; SSE-NOT: memcpy
+; SSE-DAG: {{movups|movdqu}} 184(%rsi), [[TAIL:%xmm[0-9]+]]
+; SSE-DAG: {{movups|movdqu}} [[TAIL]], 184(%rdi)
+; SSE: ret
+
+; AVX-LABEL: copy200:
+; AVX-NOT: memcpy
+; AVX: vmovups
+; AVX: ret
+
+; OFF-LABEL: copy200:
+; OFF: memcpy
+}
+
+define void @copy400(i8* %d, i8* %s) nounwind {
+entry:
+  tail call void @llvm.memcpy.p0i8.p0i8.i64(i8* %d, i8* %s, i64 400, i32 1, i1 false)
+  ret void
+; Too large for SSE, but within the limit for AVX.
+; SSE-LABEL: copy400:
+; SSE: memcpy
+
+; AVX-LABEL: copy400:
+; AVX-NOT: memcpy
+; AVX-DAG: vmovups 368(%rsi), [[TAIL:%ymm[0-9]+]]
+; AVX-DAG: vmovups [[TAIL]], 368(%rdi)
+; AVX: ret
+}
+
+define void @set250(i8* %d) nounwind {
+entry:
+  tail call void @llvm.memset.p0i8.i64(i8* %d, i8 1, i64 250, i32 8, i1 false)
+  ret void
+; SSE-LABEL: set250:
+; SSE-NOT: memset
+; SSE: {{movups|movdqu|movaps|movdqa}} %xmm{{[0-9]+}}, 234(%rdi)
+; SSE: ret
+
+; OFF-LABEL: set250:
+; OFF: memset
+}
+
+define void @volatile200(i8* %d, i8* %s) nounwind {
+entry:
+  tail call void @llvm.memcpy.p0i8.p0i8.i64(i8* %d, i8* %s, i64 200, i32 8, i1 true)
+  ret void
+; SSE-LABEL: volatile200:
+; SSE: memcpy
+}
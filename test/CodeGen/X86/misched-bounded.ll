@@ -0,0 +1,28 @@
+; RUN: llc < %s -mtriple=x86_64-linux -enable-misched -verify-machineinstrs \
+; RUN:   -misched-max-region-instrs=4 -sched-simple-mem-chain-threshold=2 \
+; RUN:   -stats 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; Large scheduling regions are split, and ones with many memory operations
+; get simple memory chains, which still keep the stores in order.
+
+; CHECK-LABEL: stores:
+; CHECK: movl $1, (%rdi)
+; CHECK: movl $2, (%rsi)
+; CHECK: movl $3, (%rdi)
+; CHECK: ret
+
+; CHECK: misched - Number of scheduling regions given simple memory chains
+
+define i32 @stores(i32* %p, i32* %q) nounwind {
+entry:
+  %a = load i32* %q
+  store i32 1, i32* %p
+  %b = load i32* %q
+  store i32 2, i32* %q
+  %c = load i32* %p
+  store i32 3, i32* %p
+  %s = add i32 %a, %b
+  %t = add i32 %s, %c
+  ret i32 %t
+}
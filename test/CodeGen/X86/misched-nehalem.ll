@@ -0,0 +1,36 @@
+; REQUIRES: asserts
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mcpu=nehalem -debug-only=misched -o /dev/null 2>&1 | FileCheck %s --check-prefix=NHM
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mcpu=westmere -debug-only=misched -o /dev/null 2>&1 | FileCheck %s --check-prefix=NHM
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7 -debug-only=misched -o /dev/null 2>&1 | FileCheck %s --check-prefix=NHM
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7-avx -mattr=-avx -debug-only=misched -o /dev/null 2>&1 | FileCheck %s --check-prefix=SNB
+;
+; Nehalem and Westmere use their own machine model. Nehalem has a single
+; shuffle unit on port 5, so a shuffle-heavy kernel is limited by that port,
+; where Sandy Bridge can spread the shuffles over ports 1 and 5.
+
+; NHM: *** Critical resource NHMPort5
+; SNB-NOT: NHMPort
+; SNB: *** Critical resource SBPort15
+define void @shuffles(<4 x i32>* %p, <4 x i32>* %q) nounwind {
+entry:
+  %p1 = getelementptr <4 x i32>* %p, i64 1
+  %p2 = getelementptr <4 x i32>* %p, i64 2
+  %p3 = getelementptr <4 x i32>* %p, i64 3
+  %a0 = load <4 x i32>* %p, align 16
+  %a1 = load <4 x i32>* %p1, align 16
+  %a2 = load <4 x i32>* %p2, align 16
+  %a3 = load <4 x i32>* %p3, align 16
+  %s0 = shufflevector <4 x i32> %a0, <4 x i32> undef, <4 x i32> <i32 3, i32 2, i32 1, i32 0>
+  %s1 = shufflevector <4 x i32> %a1, <4 x i32> undef, <4 x i32> <i32 2, i32 3, i32 0, i32 1>
+  %s2 = shufflevector <4 x i32> %a2, <4 x i32> undef, <4 x i32> <i32 1, i32 0, i32 3, i32 2>
+  %s3 = shufflevector <4 x i32> %a3, <4 x i32> undef, <4 x i32> <i32 3, i32 0, i32 1, i32 2>
+  %t0 = shufflevector <4 x i32> %s0, <4 x i32> undef, <4 x i32> <i32 1, i32 2, i32 3, i32 0>
+  %t1 = shufflevector <4 x i32> %s1, <4 x i32> undef, <4 x i32> <i32 3, i32 2, i32 1, i32 0>
+  %t2 = shufflevector <4 x i32> %s2, <4 x i32> undef, <4 x i32> <i32 0, i32 3, i32 2, i32 1>
+  %t3 = shufflevector <4 x i32> %s3, <4 x i32> undef, <4 x i32> <i32 2, i32 1, i32 0, i32 3>
+  %u0 = shufflevector <4 x i32> %t0, <4 x i32> %t1, <4 x i32> <i32 0, i32 4, i32 1, i32 5>
+  %u1 = shufflevector <4 x i32> %t2, <4 x i32> %t3, <4 x i32> <i32 2, i32 6, i32 3, i32 7>
+  %r = add <4 x i32> %u0, %u1
+  store <4 x i32> %r, <4 x i32>* %q, align 16
+  ret void
+}
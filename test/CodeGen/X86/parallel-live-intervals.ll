@@ -0,0 +1,36 @@
+; RUN: llc -mtriple=x86_64-linux < %s > %t.serial
+; RUN: llc -mtriple=x86_64-linux -live-interval-threads=3 \
+; RUN:   -live-interval-parallel-threshold=0 -stats < %s > %t.parallel 2> %t.stats
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.stats
+; REQUIRES: asserts
+
+; Computing the live intervals of virtual registers on several threads gives
+; the same code.
+
+; CHECK: regalloc - Number of virtual register intervals computed in parallel
+
+define i32 @f(i32* %p, i32 %n) nounwind {
+entry:
+  %cmp0 = icmp sgt i32 %n, 0
+  br i1 %cmp0, label %loop, label %exit
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %prod = phi i32 [ 1, %entry ], [ %prod.next, %loop ]
+  %addr = getelementptr i32* %p, i32 %i
+  %v = load i32* %addr
+  %acc.next = add i32 %acc, %v
+  %m = mul i32 %prod, %v
+  %prod.next = xor i32 %m, %i
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %a = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %b = phi i32 [ 1, %entry ], [ %prod.next, %loop ]
+  %r = sub i32 %a, %b
+  ret i32 %r
+}
@@ -0,0 +1,22 @@
+; RUN: llc -mtriple=x86_64-linux -pass-timing-report=%t.yaml -o /dev/null < %s
+; RUN: FileCheck %s < %t.yaml
+
+; CHECK: ModulePasses:
+; CHECK: Functions:
+; CHECK: - Name: {{.*}}foo
+; CHECK-NEXT: WallTime:
+; CHECK-NEXT: UserTime:
+; CHECK-NEXT: SystemTime:
+; CHECK-NEXT: PeakMemory:
+; CHECK-NEXT: Passes:
+; CHECK: - Name: {{.*}}X86 DAG->DAG Instruction Selection
+; CHECK-NEXT: WallTime:
+; CHECK-NEXT: UserTime:
+; CHECK-NEXT: SystemTime:
+; CHECK-NEXT: MemoryDelta:
+; CHECK: - Name: {{.*}}X86 Assembly
+
+define i32 @foo(i32 %a) {
+  %b = mul i32 %a, %a
+  ret i32 %b
+}
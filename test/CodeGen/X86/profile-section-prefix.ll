@@ -0,0 +1,44 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -ffunction-sections \
+; RUN:   | FileCheck --check-prefix=SECTIONS %s
+
+; CHECK: .section .text.hot,"ax",@progbits
+; CHECK-NEXT: .globl hot
+; SECTIONS: .section .text.hot.hot,"ax",@progbits
+; SECTIONS-NEXT: .globl hot
+define void @hot() #0 {
+  ret void
+}
+
+; CHECK: .section .text.unlikely,"ax",@progbits
+; CHECK-NEXT: .globl unlikely
+; SECTIONS: .section .text.unlikely.unlikely,"ax",@progbits
+; SECTIONS-NEXT: .globl unlikely
+define void @unlikely() #1 {
+  ret void
+}
+
+; CHECK: .text
+; CHECK-NEXT: .globl plain
+; SECTIONS: .section .text.plain,"ax",@progbits
+; SECTIONS-NEXT: .globl plain
+define void @plain() {
+  ret void
+}
+
+; Weak functions keep their comdat group.
+; CHECK: .section .text.startup.weak,"axG",@progbits,weak,comdat
+; SECTIONS: .section .text.startup.weak,"axG",@progbits,weak,comdat
+define weak void @weak() #2 {
+  ret void
+}
+
+; An explicit section wins.
+; CHECK: .section foo,"ax",@progbits
+define void @explicit() #0 section "foo" {
+  ret void
+}
+
+attributes #0 = { "section-prefix"="hot" }
+attributes #1 = { "section-prefix"="unlikely" }
+attributes #2 = { "section-prefix"="startup" }
@@ -0,0 +1,91 @@
+; RUN: llc < %s -mtriple=x86_64-linux -regalloc=linearscan -verify-machineinstrs | FileCheck %s
+
+; Copy hints are followed, so the arguments are used in place.
+; CHECK-LABEL: add:
+; CHECK-NOT: mov
+; CHECK: leal (%rdi,%rsi), %eax
+; CHECK-NEXT: ret
+define i32 @add(i32 %a, i32 %b) nounwind {
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+; A value live across a call is evicted from the argument register it was
+; assigned first and ends up in a callee-saved register.
+; CHECK-LABEL: across_call:
+; CHECK: movl %edi, %ebx
+; CHECK: callq f
+; CHECK: addl %ebx, %eax
+declare i32 @f()
+define i32 @across_call(i32 %a) nounwind {
+  %c = call i32 @f()
+  %r = add i32 %c, %a
+  ret i32 %r
+}
+
+; More values are live in the loop than there are registers, so some of
+; them have to be spilled.
+; CHECK-LABEL: pressure:
+; CHECK: Spill
+; CHECK: ret
+define void @pressure(i32* %p, i32 %n) nounwind {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %g0 = getelementptr i32* %p, i32 0
+  %g1 = getelementptr i32* %p, i32 1
+  %g2 = getelementptr i32* %p, i32 2
+  %g3 = getelementptr i32* %p, i32 3
+  %g4 = getelementptr i32* %p, i32 4
+  %g5 = getelementptr i32* %p, i32 5
+  %g6 = getelementptr i32* %p, i32 6
+  %g7 = getelementptr i32* %p, i32 7
+  %g8 = getelementptr i32* %p, i32 8
+  %g9 = getelementptr i32* %p, i32 9
+  %g10 = getelementptr i32* %p, i32 10
+  %g11 = getelementptr i32* %p, i32 11
+  %g12 = getelementptr i32* %p, i32 12
+  %g13 = getelementptr i32* %p, i32 13
+  %g14 = getelementptr i32* %p, i32 14
+  %g15 = getelementptr i32* %p, i32 15
+  %v0 = load volatile i32* %g0
+  %v1 = load volatile i32* %g1
+  %v2 = load volatile i32* %g2
+  %v3 = load volatile i32* %g3
+  %v4 = load volatile i32* %g4
+  %v5 = load volatile i32* %g5
+  %v6 = load volatile i32* %g6
+  %v7 = load volatile i32* %g7
+  %v8 = load volatile i32* %g8
+  %v9 = load volatile i32* %g9
+  %v10 = load volatile i32* %g10
+  %v11 = load volatile i32* %g11
+  %v12 = load volatile i32* %g12
+  %v13 = load volatile i32* %g13
+  %v14 = load volatile i32* %g14
+  %v15 = load volatile i32* %g15
+  store volatile i32 %v0, i32* %g15
+  store volatile i32 %v1, i32* %g14
+  store volatile i32 %v2, i32* %g13
+  store volatile i32 %v3, i32* %g12
+  store volatile i32 %v4, i32* %g11
+  store volatile i32 %v5, i32* %g10
+  store volatile i32 %v6, i32* %g9
+  store volatile i32 %v7, i32* %g8
+  store volatile i32 %v8, i32* %g7
+  store volatile i32 %v9, i32* %g6
+  store volatile i32 %v10, i32* %g5
+  store volatile i32 %v11, i32* %g4
+  store volatile i32 %v12, i32* %g3
+  store volatile i32 %v13, i32* %g2
+  store volatile i32 %v14, i32* %g1
+  store volatile i32 %v15, i32* %g0
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
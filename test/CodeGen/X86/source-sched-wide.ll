@@ -0,0 +1,107 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -pre-RA-sched=source | FileCheck %s
+
+; A wide block where every node is ready at once.  The source order scheduler
+; keeps its ready queue in a heap, and must still emit the independent
+; computations in source order.
+
+; CHECK-LABEL: wide:
+; CHECK: movl {{%e[a-z0-9]+}}, (%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 4(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 8(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 12(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 16(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 20(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 24(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 28(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 32(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 36(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 40(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 44(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 48(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 52(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 56(%rsi)
+; CHECK: movl {{%e[a-z0-9]+}}, 60(%rsi)
+define void @wide(i32* %a, i32* %b) {
+entry:
+  %pa0 = getelementptr i32* %a, i64 0
+  %va0 = load i32* %pa0
+  %s0 = add i32 %va0, 1
+  %pb0 = getelementptr i32* %b, i64 0
+  store i32 %s0, i32* %pb0
+  %pa1 = getelementptr i32* %a, i64 1
+  %va1 = load i32* %pa1
+  %s1 = add i32 %va1, 2
+  %pb1 = getelementptr i32* %b, i64 1
+  store i32 %s1, i32* %pb1
+  %pa2 = getelementptr i32* %a, i64 2
+  %va2 = load i32* %pa2
+  %s2 = add i32 %va2, 3
+  %pb2 = getelementptr i32* %b, i64 2
+  store i32 %s2, i32* %pb2
+  %pa3 = getelementptr i32* %a, i64 3
+  %va3 = load i32* %pa3
+  %s3 = add i32 %va3, 4
+  %pb3 = getelementptr i32* %b, i64 3
+  store i32 %s3, i32* %pb3
+  %pa4 = getelementptr i32* %a, i64 4
+  %va4 = load i32* %pa4
+  %s4 = add i32 %va4, 5
+  %pb4 = getelementptr i32* %b, i64 4
+  store i32 %s4, i32* %pb4
+  %pa5 = getelementptr i32* %a, i64 5
+  %va5 = load i32* %pa5
+  %s5 = add i32 %va5, 6
+  %pb5 = getelementptr i32* %b, i64 5
+  store i32 %s5, i32* %pb5
+  %pa6 = getelementptr i32* %a, i64 6
+  %va6 = load i32* %pa6
+  %s6 = add i32 %va6, 7
+  %pb6 = getelementptr i32* %b, i64 6
+  store i32 %s6, i32* %pb6
+  %pa7 = getelementptr i32* %a, i64 7
+  %va7 = load i32* %pa7
+  %s7 = add i32 %va7, 8
+  %pb7 = getelementptr i32* %b, i64 7
+  store i32 %s7, i32* %pb7
+  %pa8 = getelementptr i32* %a, i64 8
+  %va8 = load i32* %pa8
+  %s8 = add i32 %va8, 9
+  %pb8 = getelementptr i32* %b, i64 8
+  store i32 %s8, i32* %pb8
+  %pa9 = getelementptr i32* %a, i64 9
+  %va9 = load i32* %pa9
+  %s9 = add i32 %va9, 10
+  %pb9 = getelementptr i32* %b, i64 9
+  store i32 %s9, i32* %pb9
+  %pa10 = getelementptr i32* %a, i64 10
+  %va10 = load i32* %pa10
+  %s10 = add i32 %va10, 11
+  %pb10 = getelementptr i32* %b, i64 10
+  store i32 %s10, i32* %pb10
+  %pa11 = getelementptr i32* %a, i64 11
+  %va11 = load i32* %pa11
+  %s11 = add i32 %va11, 12
+  %pb11 = getelementptr i32* %b, i64 11
+  store i32 %s11, i32* %pb11
+  %pa12 = getelementptr i32* %a, i64 12
+  %va12 = load i32* %pa12
+  %s12 = add i32 %va12, 13
+  %pb12 = getelementptr i32* %b, i64 12
+  store i32 %s12, i32* %pb12
+  %pa13 = getelementptr i32* %a, i64 13
+  %va13 = load i32* %pa13
+  %s13 = add i32 %va13, 14
+  %pb13 = getelementptr i32* %b, i64 13
+  store i32 %s13, i32* %pb13
+  %pa14 = getelementptr i32* %a, i64 14
+  %va14 = load i32* %pa14
+  %s14 = add i32 %va14, 15
+  %pb14 = getelementptr i32* %b, i64 14
+  store i32 %s14, i32* %pb14
+  %pa15 = getelementptr i32* %a, i64 15
+  %va15 = load i32* %pa15
+  %s15 = add i32 %va15, 16
+  %pb15 = getelementptr i32* %b, i64 15
+  store i32 %s15, i32* %pb15
+  ret void
+}
@@ -0,0 +1,28 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -disable-fp-elim | FileCheck %s
+
+; ELF targets put the stack maps in an allocated section, so that a JIT loads
+; them along with the code.
+
+; CHECK-LABEL:  .section  .llvm_stackmaps,"a",@progbits
+; CHECK-NEXT:  __LLVM_StackMaps:
+; CHECK-NEXT:   .long   0
+; Num LargeConstants
+; CHECK-NEXT:   .long   0
+; Num Callsites
+; CHECK-NEXT:   .long   1
+; CHECK-NEXT:   .long   7
+; CHECK-NEXT:   .long   .L{{.*}}-constant
+; CHECK-NEXT:   .short  0
+; CHECK-NEXT:   .short  1
+; CHECK-NEXT:   .byte   4
+; CHECK-NEXT:   .byte   8
+; CHECK-NEXT:   .short  0
+; CHECK-NEXT:   .long   42
+
+define void @constant() {
+entry:
+  tail call void (i32, i32, ...)* @llvm.experimental.stackmap(i32 7, i32 0, i64 42)
+  ret void
+}
+
+declare void @llvm.experimental.stackmap(i32, i32, ...)
@@ -0,0 +1,58 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -switch-peel-threshold=0 | FileCheck %s -check-prefix=NOPEEL
+
+; A case taking most of the executions of a switch is tested on its own
+; before the jump table for the other cases.
+
+declare void @f(i32)
+
+define void @dispatch(i32 %op) {
+entry:
+  switch i32 %op, label %exit [
+    i32 0, label %bb0
+    i32 1, label %bb1
+    i32 2, label %bb2
+    i32 3, label %bb3
+    i32 4, label %bb4
+    i32 5, label %bb5
+    i32 6, label %bb6
+    i32 7, label %bb7
+  ], !prof !0
+; CHECK-LABEL: dispatch:
+; CHECK: cmpl $3, %edi
+; CHECK: jmpq *.LJTI0_0
+; CHECK: .LJTI0_0:
+
+; NOPEEL-LABEL: dispatch:
+; NOPEEL-NOT: cmpl $3,
+; NOPEEL: jmpq *.LJTI0_0
+
+bb0:
+  call void @f(i32 0)
+  br label %exit
+bb1:
+  call void @f(i32 1)
+  br label %exit
+bb2:
+  call void @f(i32 2)
+  br label %exit
+bb3:
+  call void @f(i32 3)
+  br label %exit
+bb4:
+  call void @f(i32 4)
+  br label %exit
+bb5:
+  call void @f(i32 5)
+  br label %exit
+bb6:
+  call void @f(i32 6)
+  br label %exit
+bb7:
+  call void @f(i32 7)
+  br label %exit
+exit:
+  ret void
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 1, i32 1, i32 1, i32 1000, i32 1, i32 1, i32 1, i32 1}
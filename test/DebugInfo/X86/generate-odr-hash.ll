@@ -2,6 +2,8 @@
 
 ; RUN: llc %s -o %t -filetype=obj -O0 -generate-type-units -generate-odr-hash -mtriple=x86_64-unknown-linux-gnu
 ; RUN: llvm-dwarfdump -debug-dump=info %t | FileCheck %s
+; RUN: llc %s -o %t.parallel -filetype=obj -O0 -generate-type-units -generate-odr-hash -mtriple=x86_64-unknown-linux-gnu -dwarf-unit-threads=4
+; RUN: cmp %t %t.parallel
 ;
 ; Generated from:
 ; struct bar {};
@@ -5,6 +5,12 @@
 ; RUN: llc -filetype=obj %s -mtriple=x86_64-apple-darwin -o %t2
 ; RUN: llvm-dwarfdump %t2 | FileCheck %s -check-prefix=DARWIN-DWARF
 
+; Laying out the units on several threads gives the same output.
+; RUN: llc -filetype=asm -O0 -mtriple=x86_64-linux-gnu < %s > %t.serial.s
+; RUN: llc -filetype=asm -O0 -mtriple=x86_64-linux-gnu -dwarf-unit-threads=4 \
+; RUN:   < %s > %t.parallel.s
+; RUN: diff %t.serial.s %t.parallel.s
+
 ; Testing case generated from:
 ; clang++ tu1.cpp tu2.cpp -g -emit-llvm -c
 ; llvm-link tu1.bc tu2.bc -o tu12.ll -S
@@ -0,0 +1,132 @@
+; RUN: %lli -force-interpreter %s
+
+; Exercises the decoded forms of the interpreter's instructions together with
+; the visitor that runs the rest.  @main returns the number of checks that
+; failed.
+
+target datalayout = "e-p:64:64-s:64-f64:64:64-i64:64:64-f80:128:128-f128:128:128-n8:16:32:64-S128"
+
+%pair = type { i32, [4 x i16] }
+
+declare void @llvm.memset.p0i8.i64(i8* nocapture, i8, i64, i32, i1)
+
+define internal i32 @fib(i32 %n) {
+entry:
+  %small = icmp slt i32 %n, 2
+  br i1 %small, label %done, label %recurse
+
+recurse:
+  %n1 = sub i32 %n, 1
+  %n2 = sub i32 %n, 2
+  %f1 = call i32 @fib(i32 %n1)
+  %f2 = call i32 @fib(i32 %n2)
+  %sum = add i32 %f1, %f2
+  ret i32 %sum
+
+done:
+  ret i32 %n
+}
+
+; The PHI nodes of the loop header swap places, so they must all be read
+; before any of them is written.
+define internal i32 @fib_loop(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %a = phi i32 [ 0, %entry ], [ %b, %loop ]
+  %b = phi i32 [ 1, %entry ], [ %c, %loop ]
+  %c = add i32 %a, %b
+  %i.next = add i32 %i, 1
+  %more = icmp ult i32 %i.next, %n
+  br i1 %more, label %loop, label %exit
+
+exit:
+  ret i32 %b
+}
+
+define internal i32 @check(i1 %ok, i32 %failures) {
+  %inc = select i1 %ok, i32 0, i32 1
+  %r = add i32 %failures, %inc
+  ret i32 %r
+}
+
+define i32 @main() {
+entry:
+  %f = call i32 @fib(i32 10)
+  %f.ok = icmp eq i32 %f, 55
+  %c0 = call i32 @check(i1 %f.ok, i32 0)
+
+  %fl = call i32 @fib_loop(i32 10)
+  %fl.ok = icmp eq i32 %fl, 55
+  %c1 = call i32 @check(i1 %fl.ok, i32 %c0)
+
+  ; Arithmetic wraps at the width of the type.
+  %w = add i8 -56, 100
+  %w.ok = icmp eq i8 %w, 44
+  %c2 = call i32 @check(i1 %w.ok, i32 %c1)
+  %q = sdiv i32 -7, 2
+  %r = srem i32 -7, 2
+  %qr = mul i32 %q, %r
+  %qr.ok = icmp eq i32 %qr, 3
+  %c3 = call i32 @check(i1 %qr.ok, i32 %c2)
+  %sh = ashr i8 -128, 3
+  %sh.ok = icmp sle i8 %sh, -16
+  %c4 = call i32 @check(i1 %sh.ok, i32 %c3)
+  %u = udiv i16 -1, 16
+  %u.ext = zext i16 %u to i64
+  %u.ok = icmp eq i64 %u.ext, 4095
+  %c5 = call i32 @check(i1 %u.ok, i32 %c4)
+  %s.ext = sext i8 %sh to i32
+  %s.ok = icmp eq i32 %s.ext, -16
+  %c6 = call i32 @check(i1 %s.ok, i32 %c5)
+
+  ; Memory: a store through a variable GEP index, and a memset that the
+  ; interpreter lowers before running it.
+  %arr = alloca [10 x i32]
+  %p = alloca %pair
+  %p.raw = bitcast %pair* %p to i8*
+  call void @llvm.memset.p0i8.i64(i8* %p.raw, i8 1, i64 12, i32 4, i1 false)
+  br label %fill
+
+fill:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %fill ]
+  %slot = getelementptr [10 x i32]* %arr, i64 0, i64 %i
+  %i.trunc = trunc i64 %i to i32
+  %sq = mul i32 %i.trunc, %i.trunc
+  store i32 %sq, i32* %slot
+  %i.next = add i64 %i, 1
+  %fill.more = icmp ne i64 %i.next, 10
+  br i1 %fill.more, label %fill, label %sum
+
+sum:
+  %j = phi i64 [ 0, %fill ], [ %j.next, %sum ]
+  %acc = phi i32 [ 0, %fill ], [ %acc.next, %sum ]
+  %elt = getelementptr [10 x i32]* %arr, i64 0, i64 %j
+  %v = load i32* %elt
+  %acc.next = add i32 %acc, %v
+  %j.next = add i64 %j, 1
+  %sum.more = icmp ult i64 %j.next, 10
+  br i1 %sum.more, label %sum, label %after
+
+after:
+  %acc.ok = icmp eq i32 %acc.next, 285
+  %c7 = call i32 @check(i1 %acc.ok, i32 %c6)
+  %half = getelementptr %pair* %p, i64 0, i32 1, i64 3
+  %h = load i16* %half
+  %h.ok = icmp eq i16 %h, 257
+  %c8 = call i32 @check(i1 %h.ok, i32 %c7)
+
+  ; Floating point, and a pointer round trip.
+  %d = fmul double 1.5, 4.0
+  %d.sub = fsub double %d, 0.5
+  %d.ok = fcmp oeq double %d.sub, 5.5
+  %c9 = call i32 @check(i1 %d.ok, i32 %c8)
+  %addr = ptrtoint %pair* %p to i64
+  %back = inttoptr i64 %addr to %pair*
+  %same = icmp eq %pair* %back, %p
+  %c10 = call i32 @check(i1 %same, i32 %c9)
+
+  ret i32 %c10
+}
@@ -0,0 +1,74 @@
+; RUN: %lli -force-interpreter -interpreter-tier-up-threshold=3 %s
+; RUN: %lli -force-interpreter -interpreter-tier-up-threshold=3 \
+; RUN:   -interpreter-tier-up-wait -stats %s 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; Once they have been called often enough, @square and @sum run natively and
+; @sum sees the same @total as the interpreter.  @apply takes a function
+; pointer, which native code cannot call, so it stays interpreted.
+
+; CHECK: 1 interpreter - Number of hot functions that stay interpreted
+; CHECK: 2 interpreter - Number of functions compiled to native code
+
+target datalayout = "e-p:64:64-s:64-f64:64:64-i64:64:64-f80:128:128-f128:128:128-n8:16:32:64-S128"
+
+@total = global i64 0
+
+define internal i64 @square(i64 %x) {
+  %r = mul i64 %x, %x
+  ret i64 %r
+}
+
+; Adds the squares of 0 .. %n-1 to @total and returns them.
+define i64 @sum(i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i64 [ 0, %entry ], [ %acc.next, %loop ]
+  %sq = call i64 @square(i64 %i)
+  %acc.next = add i64 %acc, %sq
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %t = load i64* @total
+  %t.next = add i64 %t, %acc.next
+  store i64 %t.next, i64* @total
+  ret i64 %acc.next
+}
+
+define i64 @apply(i64 (i64)* %f, i64 %x) {
+  %r = call i64 %f(i64 %x)
+  ret i64 %r
+}
+
+define i32 @main() {
+entry:
+  br label %loop
+
+loop:
+  %k = phi i32 [ 0, %entry ], [ %k.next, %check ]
+  %s = call i64 @sum(i64 10)
+  %ok.sum = icmp eq i64 %s, 285
+  %a = call i64 @apply(i64 (i64)* @square, i64 3)
+  %ok.apply = icmp eq i64 %a, 9
+  %ok = and i1 %ok.sum, %ok.apply
+  br i1 %ok, label %check, label %fail
+
+check:
+  %k.next = add i32 %k, 1
+  %more = icmp ne i32 %k.next, 10
+  br i1 %more, label %loop, label %exit
+
+exit:
+  %t = load i64* @total
+  %ok.total = icmp eq i64 %t, 2850
+  %ret = select i1 %ok.total, i32 0, i32 1
+  ret i32 %ret
+
+fail:
+  ret i32 1
+}
@@ -0,0 +1,119 @@
+; Test that accesses covered by a dominating check are not instrumented again,
+; and that simple loops can be checked once in their preheader.
+; RUN: opt < %s -asan -S | FileCheck %s
+; RUN: opt < %s -asan -asan-opt-dominating=0 -S | FileCheck %s -check-prefix=NODOM
+; RUN: opt < %s -asan -asan-opt-loop-ranges -S | FileCheck %s -check-prefix=LOOP
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @foo()
+
+; The byte store in %then is covered by the 4-byte load in %entry, which
+; dominates it.
+define i32 @covered(i32* %a, i1 %c) sanitize_address {
+entry:
+  %x = load i32* %a, align 4
+  br i1 %c, label %then, label %exit
+
+then:
+  %p = bitcast i32* %a to i8*
+  store i8 0, i8* %p, align 1
+  br label %exit
+
+exit:
+  ret i32 %x
+}
+
+; CHECK: @covered
+; CHECK: __asan_report_load4
+; CHECK-NOT: __asan_report
+; CHECK: end_covered
+
+; NODOM: @covered
+; NODOM: __asan_report_load4
+; NODOM: __asan_report_store1
+; NODOM: end_covered
+
+define void @end_covered() {
+entry:
+  ret void
+}
+
+; A call may free the memory, so the store has to be checked again.
+define void @call_between(i32* %a) sanitize_address {
+entry:
+  %x = load i32* %a, align 4
+  call void @foo()
+  br label %next
+
+next:
+  store i32 %x, i32* %a, align 4
+  ret void
+}
+
+; CHECK: @call_between
+; CHECK: __asan_report_load4
+; CHECK: __asan_report_store4
+; CHECK: end_call_between
+
+define void @end_call_between() {
+entry:
+  ret void
+}
+
+; A narrower check does not cover a wider access.
+define i64 @wider(i64* %a) sanitize_address {
+entry:
+  %p = bitcast i64* %a to i32*
+  %x = load i32* %p, align 4
+  br label %next
+
+next:
+  %y = load i64* %a, align 8
+  ret i64 %y
+}
+
+; CHECK: @wider
+; CHECK: __asan_report_load4
+; CHECK: __asan_report_load8
+; CHECK: end_wider
+
+define void @end_wider() {
+entry:
+  ret void
+}
+
+; The store is checked for a[0] and a[n-1] before the loop.
+define void @loop(i32* %a, i64 %n) sanitize_address {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %p = getelementptr inbounds i32* %a, i64 %i
+  store i32 0, i32* %p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; LOOP: @loop
+; LOOP: __asan_report_store4
+; LOOP: __asan_report_store4
+; LOOP: {{^}}loop:
+; LOOP-NOT: __asan_report
+; LOOP: end_loop
+
+; CHECK: @loop
+; CHECK: {{^}}loop:
+; CHECK: __asan_report_store4
+; CHECK: end_loop
+
+define void @end_loop() {
+entry:
+  ret void
+}
@@ -0,0 +1,59 @@
+; RUN: opt < %s -insert-edge-profiling -S | FileCheck %s
+; RUN: opt < %s -insert-edge-profiling -edge-profile-indirect-calls=0 -S \
+; RUN:   | FileCheck %s -check-prefix=NOCALLS
+; RUN: opt < %s -edge-profile-loader \
+; RUN:   -edge-profile-file=%S/Inputs/indirect-call.edgeprof -S \
+; RUN:   | FileCheck %s -check-prefix=LOADER
+
+; Each indirect call records its target before it is made.
+
+; CHECK-DAG: @__llvm_edge_sites = internal global [7 x i64] zeroinitializer
+; CHECK-DAG: @__llvm_edge_profile_symtabs = common global i8* null
+; CHECK-DAG: @__llvm_edge_profile_symtab = internal constant [2 x i8*] [i8* bitcast (i32 (i32)* @callee_a to i8*), i8* getelementptr inbounds
+
+define i32 @callee_a(i32 %x) {
+entry:
+  ret i32 %x
+}
+
+define i32 @caller(i32 (i32)* %fp, i32 %x) {
+entry:
+; CHECK-LABEL: @caller(
+; CHECK: [[FP:%.*]] = bitcast i32 (i32)* %fp to i8*
+; CHECK-NEXT: call void @__llvm_edge_profile_record_target(i8* [[FP]], i64* getelementptr inbounds ([7 x i64]* @__llvm_edge_sites, i64 0, i64 0))
+; CHECK-NEXT: call i32 %fp(i32 %x)
+; NOCALLS-LABEL: @caller(
+; NOCALLS-NOT: record_target
+; NOCALLS: ret i32
+; LOADER-LABEL: @caller(
+; LOADER: call i32 %fp(i32 %x), !prof [[TARGETS:![0-9]+]]
+  %r = call i32 %fp(i32 %x)
+  ret i32 %r
+}
+
+define i32 (i32)* @get() {
+entry:
+  ret i32 (i32)* @callee_a
+}
+
+; The targets are written by name after the counters of the function, and
+; the table of names is registered before anything can be called.
+
+; CHECK-LABEL: define internal void @__llvm_edge_profile_record_target(i8*, i64*)
+; CHECK-LABEL: define internal i8* @__llvm_edge_profile_lookup(i64)
+; CHECK: load i8** @__llvm_edge_profile_symtabs
+; CHECK-LABEL: define internal void @__llvm_edge_profile_write_sites(i8*, i64*, i32)
+; CHECK: call i8* @__llvm_edge_profile_lookup(
+; CHECK-LABEL: define internal void @__llvm_edge_profile_dump()
+; CHECK: call void @__llvm_edge_profile_write_sites(i8* %{{.*}}, i64* getelementptr inbounds ([7 x i64]* @__llvm_edge_sites, i64 0, i64 0), i32 1)
+; CHECK-LABEL: define internal void @__llvm_edge_profile_register()
+; CHECK: store i8* bitcast ({{.*}}* @__llvm_edge_profile_symtab_node to i8*), i8** @__llvm_edge_profile_symtabs
+; CHECK-LABEL: define internal void @__llvm_edge_profile_init()
+; CHECK-NEXT: entry:
+; CHECK-NEXT: call void @__llvm_edge_profile_register()
+; CHECK-NEXT: call i32 @atexit(
+
+; NOCALLS-NOT: __llvm_edge_profile_register
+
+; The two runs add up to 15 calls: 8 to @callee_a and 5 to @callee_b.
+; LOADER: [[TARGETS]] = metadata !{metadata !"indirect_call_targets", i64 15, metadata !"callee_a", i64 8, metadata !"callee_b", i64 5}
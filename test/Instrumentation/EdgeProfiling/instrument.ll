@@ -0,0 +1,84 @@
+; RUN: opt < %s -insert-edge-profiling -edge-profile-file=diamond.edgeprof -S \
+; RUN:   | FileCheck %s
+
+; The two edges out of the spanning tree of the diamond are the ones into %m.
+
+; CHECK-DAG: @__llvm_edge_ctr = internal global [2 x i64] zeroinitializer
+; CHECK-DAG: @__llvm_edge_ctr1 = internal global [2 x i64] zeroinitializer
+; CHECK-DAG: c"diamond.edgeprof\00"
+; CHECK-DAG: @llvm.global_ctors = appending global {{.*}} @__llvm_edge_profile_init
+
+define i32 @diamond(i1 %c) {
+entry:
+  br i1 %c, label %a, label %b
+
+; CHECK-LABEL: a:
+; CHECK-NEXT: [[A:%.*]] = load i64* getelementptr inbounds ([2 x i64]* @__llvm_edge_ctr, i64 0, i64 0)
+; CHECK-NEXT: [[A1:%.*]] = add i64 [[A]], 1
+; CHECK-NEXT: store i64 [[A1]], i64* getelementptr inbounds ([2 x i64]* @__llvm_edge_ctr, i64 0, i64 0)
+; CHECK-NEXT: br label %m
+a:
+  br label %m
+
+; CHECK-LABEL: b:
+; CHECK-NEXT: [[B:%.*]] = load i64* getelementptr inbounds ([2 x i64]* @__llvm_edge_ctr, i64 0, i64 1)
+; CHECK-NEXT: [[B1:%.*]] = add i64 [[B]], 1
+; CHECK-NEXT: store i64 [[B1]], i64* getelementptr inbounds ([2 x i64]* @__llvm_edge_ctr, i64 0, i64 1)
+; CHECK-NEXT: br label %m
+b:
+  br label %m
+
+m:
+  %r = phi i32 [ 1, %a ], [ 2, %b ]
+  ret i32 %r
+}
+
+; The back edge is always counted, and it is critical, so it is split.
+
+define void @loop(i32 %n) {
+entry:
+  br label %loop
+
+; CHECK-LABEL: loop:
+; CHECK: br i1 %done, label %exit, label %loop.loop_crit_edge
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+
+; CHECK-LABEL: loop.loop_crit_edge:
+; CHECK-NEXT: load i64* getelementptr inbounds ([2 x i64]* @__llvm_edge_ctr1, i64 0, i64 {{[01]}})
+; CHECK-NEXT: add
+; CHECK-NEXT: store
+; CHECK-NEXT: br label %loop
+}
+
+; Functions with an indirectbr are not instrumented.
+
+; CHECK-LABEL: define void @indirect(
+; CHECK-NOT: __llvm_edge_ctr
+; CHECK: ret void
+define void @indirect(i8* %p) {
+entry:
+  indirectbr i8* %p, [label %exit]
+exit:
+  ret void
+}
+
+; The counters are written at exit, preceded by the name, the CFG checksum
+; and the number of counters of each function.
+
+; CHECK-LABEL: define internal void @__llvm_edge_profile_dump()
+; CHECK: call i8* @getenv(
+; CHECK: call i8* @fopen(
+; CHECK: call i32 (i8*, i8*, ...)* @fprintf(i8* %{{.*}}, i8* getelementptr {{.*}}, i8* getelementptr {{.*}}, i32 -1142006685, i32 2)
+; CHECK-NEXT: call void @__llvm_edge_profile_write(i8* %{{.*}}, i64* getelementptr inbounds ([2 x i64]* @__llvm_edge_ctr, i64 0, i64 0), i32 2)
+; CHECK: call void @__llvm_edge_profile_write(i8* %{{.*}}, i64* getelementptr inbounds ([2 x i64]* @__llvm_edge_ctr1, i64 0, i64 0), i32 2)
+; CHECK: call i32 @fclose(
+
+; CHECK-LABEL: define internal void @__llvm_edge_profile_init()
+; CHECK: call i32 @atexit(void ()* @__llvm_edge_profile_dump)
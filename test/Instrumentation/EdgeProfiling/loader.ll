@@ -0,0 +1,49 @@
+; RUN: opt < %s -edge-profile-loader \
+; RUN:   -edge-profile-file=%S/Inputs/diamond.edgeprof -S | FileCheck %s
+; RUN: not opt < %s -edge-profile-loader -edge-profile-file=%t.missing \
+; RUN:   -S 2>&1 | FileCheck --check-prefix=MISSING %s
+
+; The profile holds two runs of @diamond, which add up to 36 and 12 for the
+; edges into %m.  The edges out of %entry are derived from them.
+
+define i32 @diamond(i1 %c) {
+entry:
+; CHECK-LABEL: @diamond(
+; CHECK: br i1 %c, label %a, label %b, !prof [[DIAMOND:![0-9]+]]
+  br i1 %c, label %a, label %b
+
+a:
+  br label %m
+
+b:
+  br label %m
+
+m:
+  %r = phi i32 [ 1, %a ], [ 2, %b ]
+  ret i32 %r
+}
+
+; The CFG of @changed does not match the checksum in the profile.
+
+define i32 @changed(i1 %c) {
+entry:
+; CHECK-LABEL: @changed(
+; CHECK: br i1 %c, label %a, label %b{{$}}
+  br i1 %c, label %a, label %b
+
+a:
+  br label %m
+
+b:
+  br label %m
+
+m:
+  %r = phi i32 [ 1, %a ], [ 2, %b ]
+  ret i32 %r
+}
+
+; The two runs entered @diamond 48 times.
+; CHECK: attributes #{{[0-9]+}} = { "function-entry-count"="48" }
+; CHECK: [[DIAMOND]] = metadata !{metadata !"branch_weights", i32 36, i32 12}
+
+; MISSING: Could not open edge profile {{.*}}.missing
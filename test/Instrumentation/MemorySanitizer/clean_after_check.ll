@@ -0,0 +1,46 @@
+; RUN: opt < %s -msan -S | FileCheck %s
+; RUN: opt < %s -msan -msan-clean-after-check=0 -S | FileCheck -check-prefix=NOCLEAN %s
+; RUN: opt < %s -msan -msan-keep-going=1 -S | FileCheck -check-prefix=KEEPGOING %s
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The divisor is checked, so it is known to be initialized afterwards and
+; the return value has a clean shadow.
+
+define i32 @DivisorCleanAfterCheck(i32 %b) sanitize_memory {
+entry:
+  %div = udiv i32 1000, %b
+  %add = add i32 %div, %b
+  ret i32 %add
+}
+
+; CHECK: @DivisorCleanAfterCheck
+; CHECK: call void @__msan_warning_noreturn
+; CHECK: store i32 0, {{.*}}@__msan_retval_tls
+; CHECK: ret i32
+
+; NOCLEAN: @DivisorCleanAfterCheck
+; NOCLEAN: call void @__msan_warning_noreturn
+; NOCLEAN: store i32 %{{.*}}@__msan_retval_tls
+; NOCLEAN: ret i32
+
+; A value is only checked once.
+
+define i32 @CheckedOnce(i32 %b) sanitize_memory {
+entry:
+  %div1 = udiv i32 1000, %b
+  %div2 = udiv i32 2000, %b
+  %add = add i32 %div1, %div2
+  ret i32 %add
+}
+
+; CHECK: @CheckedOnce
+; CHECK: call void @__msan_warning_noreturn
+; CHECK-NOT: __msan_warning
+; CHECK: ret i32
+
+; KEEPGOING: @CheckedOnce
+; KEEPGOING: call void @__msan_warning
+; KEEPGOING: call void @__msan_warning
+; KEEPGOING: ret i32
@@ -28,5 +28,57 @@ entry:
 ; CHECK: __tsan_write
 ; CHECK: ret void
 
+define i32 @ReadAfterWrite(i32* nocapture %ptr) nounwind uwtable sanitize_thread {
+entry:
+  store i32 1, i32* %ptr, align 4
+  %0 = load i32* %ptr, align 4
+  ret i32 %0
+}
+
+; CHECK: define i32 @ReadAfterWrite
+; CHECK: __tsan_write
+; CHECK-NOT: __tsan_read
+; CHECK: ret i32
+
+define i32 @ReadAfterRead(i32* nocapture %ptr) nounwind uwtable sanitize_thread {
+entry:
+  %0 = load i32* %ptr, align 4
+  %1 = load volatile i32* %ptr, align 4
+  %add = add nsw i32 %0, %1
+  ret i32 %add
+}
+
+; CHECK: define i32 @ReadAfterRead
+; CHECK: __tsan_read
+; CHECK-NOT: __tsan_read
+; CHECK: ret i32
+
+define void @WriteAfterWrite(i32* nocapture %ptr) nounwind uwtable sanitize_thread {
+entry:
+  store volatile i32 1, i32* %ptr, align 4
+  store volatile i32 2, i32* %ptr, align 4
+  ret void
+}
+
+; CHECK: define void @WriteAfterWrite
+; CHECK: __tsan_write
+; CHECK-NOT: __tsan_write
+; CHECK: ret void
+
+define i32 @ReadAfterWriteWithAtomicInBetween(i32* nocapture %ptr, i32* %flag) nounwind uwtable sanitize_thread {
+entry:
+  store i32 1, i32* %ptr, align 4
+  %0 = load atomic i32* %flag acquire, align 4
+  %1 = load i32* %ptr, align 4
+  %add = add nsw i32 %0, %1
+  ret i32 %add
+}
+
+; CHECK: define i32 @ReadAfterWriteWithAtomicInBetween
+; CHECK: __tsan_write
+; CHECK: __tsan_atomic32_load
+; CHECK: __tsan_read
+; CHECK: ret i32
+
 declare void @foo()
 
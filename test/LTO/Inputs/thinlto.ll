@@ -0,0 +1,22 @@
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@counter = internal global i32 0
+
+define i32 @add_one(i32 %a) {
+  %b = call i32 @twice(i32 %a)
+  %c = add i32 %b, 1
+  ret i32 %c
+}
+
+define i32 @twice(i32 %a) {
+  %b = shl i32 %a, 1
+  ret i32 %b
+}
+
+define i32 @bump(i32 %a) {
+  %c = load i32* @counter
+  %d = add i32 %c, %a
+  store i32 %d, i32* @counter
+  ret i32 %d
+}
@@ -0,0 +1,32 @@
+; RUN: rm -rf %t.cache
+; RUN: llvm-as < %s > %t.bc
+; RUN: llvm-lto -j 2 -cache-dir=%t.cache -o %t1 -exported-symbol=foo \
+; RUN:     -exported-symbol=bar %t.bc
+; RUN: ls %t.cache | count 2
+
+; Linking again reuses both object files.
+; RUN: llvm-lto -j 2 -cache-dir=%t.cache -o %t2 -exported-symbol=foo \
+; RUN:     -exported-symbol=bar %t.bc
+; RUN: ls %t.cache | count 2
+; RUN: cmp %t1.0 %t2.0
+; RUN: cmp %t1.1 %t2.1
+
+; Different code generation options make for different object files.
+; RUN: llvm-lto -j 2 -cache-dir=%t.cache -o %t3 -exported-symbol=foo \
+; RUN:     -exported-symbol=bar -disable-fp-elim %t.bc
+; RUN: ls %t.cache | count 4
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @foo(i32 %a) {
+  %b = add i32 %a, 1
+  %c = mul i32 %b, %a
+  %d = call i32 @bar(i32 %c)
+  ret i32 %d
+}
+
+define i32 @bar(i32 %a) {
+  %b = shl i32 %a, 2
+  ret i32 %b
+}
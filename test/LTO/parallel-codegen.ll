@@ -0,0 +1,34 @@
+; RUN: llvm-as < %s >%t1
+; RUN: llvm-lto -j 2 -o %t2 -exported-symbol=foo -exported-symbol=bar %t1 \
+; RUN:     -disable-opt
+; RUN: llvm-nm %t2.0 | FileCheck --check-prefix=PART0 %s
+; RUN: llvm-nm %t2.1 | FileCheck --check-prefix=PART1 %s
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; The largest function goes into the first partition.
+; PART0: T foo
+; PART0-NOT: T bar
+; PART0: U helper.llvm.part
+define i32 @foo(i32 %a) {
+  %b = add i32 %a, 1
+  %c = mul i32 %b, %a
+  %d = call i32 @helper(i32 %c)
+  %e = sub i32 %d, %b
+  ret i32 %e
+}
+
+; PART1: T bar
+; PART1-NOT: T foo
+; PART1: T helper.llvm.part
+define i32 @bar(i32 %a) {
+  %b = call i32 @helper(i32 %a)
+  ret i32 %b
+}
+
+; Referenced from both partitions, so it has to be externalized.
+define internal i32 @helper(i32 %a) noinline {
+  %b = shl i32 %a, 2
+  ret i32 %b
+}
@@ -0,0 +1,48 @@
+; RUN: llvm-as < %s > %t1.bc
+; RUN: llvm-as < %p/Inputs/thinlto.ll > %t2.bc
+; RUN: llvm-lto -thinlto-summary %t1.bc %t2.bc
+; RUN: FileCheck %s -check-prefix=SUMMARY < %t2.bc.summary
+; RUN: llvm-lto -thinlto-link %t1.bc.summary %t2.bc.summary
+; RUN: FileCheck %s -check-prefix=IMPORTS < %t1.bc.imports
+; RUN: llvm-lto -thinlto-imports=%t1.bc.imports -o %t1.o %t1.bc
+; RUN: llvm-nm %t1.o | FileCheck %s -check-prefix=NM
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; SUMMARY: Module: {{.*}}2.bc
+; SUMMARY: - Name: add_one
+; SUMMARY-NEXT: Linkage: external
+; SUMMARY-NEXT: InstCount: 3
+; SUMMARY-NEXT: Importable: true
+; SUMMARY-NEXT: Calls: [ twice ]
+; SUMMARY: - Name: twice
+; SUMMARY-NEXT: Linkage: external
+; SUMMARY-NEXT: InstCount: 2
+; SUMMARY-NEXT: Importable: true
+; SUMMARY: - Name: bump
+; SUMMARY-NEXT: Linkage: external
+; SUMMARY-NEXT: InstCount: 4
+; SUMMARY-NEXT: Importable: false
+
+; @add_one is imported, and so is @twice, which it calls.  @bump refers to a
+; variable internal to its module, so it can't be.
+; IMPORTS: Module: {{.*}}1.bc
+; IMPORTS-NEXT: Imports:
+; IMPORTS-NEXT: - Module: {{.*}}2.bc
+; IMPORTS-NEXT: Functions: [ add_one, twice ]
+; IMPORTS-NOT: bump
+
+; The imported functions are inlined and not emitted.
+; NM-NOT: add_one
+; NM-NOT: twice
+; NM: U bump
+; NM: T main
+define i32 @main(i32 %a) {
+  %b = call i32 @add_one(i32 %a)
+  %c = call i32 @bump(i32 %b)
+  ret i32 %c
+}
+
+declare i32 @add_one(i32)
+declare i32 @bump(i32)
@@ -0,0 +1,24 @@
+define linkonce_odr i32 @unused(i32 %x) {
+  %r = call i32 @f0(i32 %x)
+  ret i32 %r
+}
+
+define linkonce_odr i32 @f0(i32 %x) {
+  ret i32 %x
+}
+
+define linkonce_odr i32 @f1(i32 %x) {
+  %r = call i32 @f0(i32 %x)
+  ret i32 %r
+}
+
+define linkonce_odr i32 @f2(i32 %x) {
+  %r = call i32 @f1(i32 %x)
+  %s = call i32 @f0(i32 %r)
+  ret i32 %s
+}
+
+define linkonce_odr i32 @f3(i32 %x) {
+  %r = call i32 @f2(i32 %x)
+  ret i32 %r
+}
@@ -0,0 +1,21 @@
+@counter = global i32 0
+
+define i32 @helper(i32 %x) {
+  %c = load i32* @counter
+  %r = add i32 %x, %c
+  ret i32 %r
+}
+
+define i32 @needed(i32 %x) {
+  %r = call i32 @helper(i32 %x)
+  ret i32 %r
+}
+
+define i32 @other(i32 %x) {
+  ret i32 %x
+}
+
+define i32 @unneeded(i32 %x) {
+  %r = call i32 @other(i32 %x)
+  ret i32 %r
+}
@@ -0,0 +1,7 @@
+%B = type { i32, %B* }
+%Pair = type { i64, i64 }
+%Other = type { i64, i32 }
+
+@b = global %B* null
+@pair2 = global %Pair* null
+@other = global %Other* null
@@ -0,0 +1,19 @@
+; RUN: llvm-as %s -o %t.a.bc
+; RUN: llvm-as %S/Inputs/lazy-link-chain.ll -o %t.b.bc
+; RUN: llvm-link %t.a.bc %t.b.bc -S | FileCheck %s
+
+; Linkonce functions are only linked in once something refers to them, and
+; linking one in can make more of them needed.
+
+; CHECK-DAG: define linkonce_odr i32 @f3(
+; CHECK-DAG: define linkonce_odr i32 @f2(
+; CHECK-DAG: define linkonce_odr i32 @f1(
+; CHECK-DAG: define linkonce_odr i32 @f0(
+; CHECK-NOT: @unused
+
+declare i32 @f3(i32)
+
+define i32 @main() {
+  %r = call i32 @f3(i32 0)
+  ret i32 %r
+}
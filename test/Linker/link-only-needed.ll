@@ -0,0 +1,20 @@
+; RUN: llvm-as %s -o %t.a.bc
+; RUN: llvm-as %S/Inputs/link-only-needed.ll -o %t.b.bc
+; RUN: llvm-link -only-needed %t.a.bc %t.b.bc -S | FileCheck %s
+; RUN: llvm-link %t.a.bc %t.b.bc -S | FileCheck %s -check-prefix=ALL
+
+; CHECK-DAG: @counter = global i32 0
+; CHECK-DAG: define i32 @needed(
+; CHECK-DAG: define i32 @helper(
+; CHECK-NOT: @unneeded
+; CHECK-NOT: @other
+
+; ALL-DAG: define i32 @unneeded(
+; ALL-DAG: define i32 @other(
+
+declare i32 @needed(i32)
+
+define i32 @main() {
+  %r = call i32 @needed(i32 0)
+  ret i32 %r
+}
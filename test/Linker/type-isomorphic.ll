@@ -0,0 +1,24 @@
+; RUN: llvm-link %s %p/Inputs/type-isomorphic.ll -S | FileCheck %s
+; RUN: llvm-link %s %p/Inputs/type-isomorphic.ll -S | FileCheck %s \
+; RUN:     -check-prefix=NODUP
+
+; A struct type of the module linked in that is isomorphic to one of the
+; destination maps onto it, whatever its name, rather than being
+; duplicated.  Types that differ anywhere are kept apart.
+
+; CHECK-DAG: %A = type { i32, %A* }
+; CHECK-DAG: %Pair = type { i64, i64 }
+; CHECK-DAG: %Other = type { i64, i32 }
+; CHECK-DAG: @a = global %A* null
+; CHECK-DAG: @b = global %A* null
+; CHECK-DAG: @pair = global %Pair* null
+; CHECK-DAG: @other = global %Other* null
+
+; NODUP-NOT: %B = type
+; NODUP-NOT: %Pair.{{[0-9]+}} = type
+
+%A = type { i32, %A* }
+%Pair = type { i64, i64 }
+
+@a = global %A* null
+@pair = global %Pair* null
@@ -0,0 +1,31 @@
+// RUN: llvm-mc -filetype=obj -compress-debug-sections -triple x86_64-pc-linux-gnu %s -o %t
+// RUN: llvm-readobj -s %t | FileCheck %s
+// RUN: llvm-objdump -s %t | FileCheck --check-prefix=DATA %s
+// REQUIRES: zlib
+
+// Test that debug sections are written compressed under a .zdebug_* name,
+// that their relocation sections are renamed with them, and that sections
+// which would not get smaller are left alone.
+
+// CHECK: Name: .zdebug_str
+// CHECK: Name: .zdebug_info
+// CHECK: Name: .rela.zdebug_info
+// CHECK: Name: .debug_line
+
+// The "ZLIB" magic is followed by the uncompressed size in big-endian.
+// DATA: Contents of section .zdebug_info:
+// DATA-NEXT: 0000 5a4c4942 00000000 00000100
+
+	.section	.debug_str,"MS",@progbits,1
+.Lstring:
+	.rept	64
+	.asciz	"a string that is repeated many times"
+	.endr
+
+	.section	.debug_info,"",@progbits
+	.rept	64
+	.long	.Lstring
+	.endr
+
+	.section	.debug_line,"",@progbits
+	.byte	1
@@ -0,0 +1,15 @@
+# RUN: llvm-mc -filetype=obj -triple x86_64-unknown-unknown %s -stats \
+# RUN:   -o /dev/null 2>&1 | FileCheck %s
+# REQUIRES: asserts
+
+# The data fragment grows to 128 bytes of storage for its 72 bytes of
+# contents, and gives back the slack once the jump starts a new fragment.
+
+# CHECK-DAG: {{[0-9]+}} assembler - Number of bytes held by fragments before layout
+# CHECK-DAG: 56 assembler - Number of bytes released by compacting fragments
+
+        .quad 0, 1, 2, 3, 4, 5, 6, 7, 8
+        jmp far
+        nop
+far:
+        ret
@@ -0,0 +1,21 @@
+# RUN: llvm-mc -filetype=obj -triple x86_64-unknown-unknown %s -stats \
+# RUN:   -o %t 2>&1 | FileCheck %s
+# RUN: llvm-objdump -d %t | FileCheck %s --check-prefix=DISASM
+# REQUIRES: asserts
+
+# Once the first jump has been relaxed, the second one, which only spans the
+# nop, doesn't need to be checked again.
+
+# CHECK-DAG: 4 assembler - Number of relaxable fragments checked
+# CHECK-DAG: 2 assembler - Number of relaxation checks avoided
+
+# DISASM: e9 c8 00 00 00 {{.*}}jmp
+# DISASM: eb 01 {{.*}}jmp
+
+        jmp far
+        .fill 200, 1, 0x90
+far:
+        jmp near
+        nop
+near:
+        ret
@@ -0,0 +1,46 @@
+; Disassembling the symbols of a section on several threads prints the same
+; as disassembling them one after another.
+
+; RUN: llc -mtriple=x86_64-pc-linux -filetype=obj %s -o %t.o
+; RUN: llvm-objdump -d %t.o > %t.serial
+; RUN: llvm-objdump -d -threads=3 %t.o > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+
+; CHECK: Disassembly of section .text:
+; CHECK: f1:
+; CHECK: ret
+; CHECK: f2:
+; CHECK: ret
+; CHECK: f3:
+; CHECK: ret
+; CHECK: f4:
+; CHECK: ret
+; CHECK: f5:
+; CHECK: ret
+
+define i32 @f1(i32 %a) {
+  %b = add i32 %a, 1
+  ret i32 %b
+}
+
+define i32 @f2(i32 %a) {
+  %b = mul i32 %a, 3
+  ret i32 %b
+}
+
+define i32 @f3(i32 %a, i32 %b) {
+  %c = sub i32 %a, %b
+  ret i32 %c
+}
+
+define i32 @f4(i32 %a) {
+  %b = call i32 @f1(i32 %a)
+  %c = call i32 @f2(i32 %b)
+  ret i32 %c
+}
+
+define i32 @f5(i32 %a) {
+  %b = shl i32 %a, 4
+  ret i32 %b
+}
@@ -0,0 +1,44 @@
+; RUN: opt < %s -disable-verify -function-pass-threads=4 -instnamer -domtree \
+; RUN:   -loops -S | FileCheck %s
+
+; A pipeline made up only of function-local passes runs each function on a
+; worker thread with its own pass instances; the result must be the same as
+; running it serially.
+; RUN: opt < %s -disable-verify -instnamer -domtree -loops -S > %t.serial
+; RUN: opt < %s -disable-verify -function-pass-threads=4 -instnamer -domtree \
+; RUN:   -loops -S > %t.parallel
+; RUN: diff %t.serial %t.parallel
+
+; CHECK-LABEL: define i32 @f0(i32 %arg)
+; CHECK: bb:
+; CHECK: %tmp = add i32 %arg, 1
+define i32 @f0(i32) {
+  %2 = add i32 %0, 1
+  ret i32 %2
+}
+
+; CHECK-LABEL: define i32 @f1(i32 %arg)
+; CHECK: bb1:
+; CHECK: %tmp = phi i32
+define i32 @f1(i32) {
+  br label %2
+  %3 = phi i32 [ 0, %1 ], [ %4, %2 ]
+  %4 = add i32 %3, 1
+  %5 = icmp slt i32 %4, %0
+  br i1 %5, label %2, label %6
+  ret i32 %4
+}
+
+; CHECK-LABEL: define i32 @f2(i32 %arg)
+define i32 @f2(i32) {
+  %2 = mul i32 %0, %0
+  ret i32 %2
+}
+
+; CHECK-LABEL: define i32 @f3(i32 %arg)
+define i32 @f3(i32) {
+  %2 = sub i32 %0, 3
+  ret i32 %2
+}
+
+declare void @ext()
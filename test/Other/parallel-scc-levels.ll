@@ -0,0 +1,44 @@
+; RUN: opt < %s -disable-verify -inline -instnamer -S > %t.serial
+; RUN: opt < %s -disable-verify -function-pass-threads=2 -inline -instnamer \
+; RUN:   -S > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: opt < %s -disable-verify -function-pass-threads=2 -inline -instnamer \
+; RUN:   -stats -disable-output 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; When a call graph pass manager ends with function passes that can run on
+; several threads, the SCCs are visited a level at a time.  @leaf1 and @leaf2
+; make up the first level and @mid1 and @mid2 the second, so their function
+; passes run in parallel; @top is alone on its level.
+
+; CHECK: 2 cgscc-passmgr - Number of SCC levels whose function passes ran in parallel
+
+define i32 @leaf1(i32) {
+  %2 = add i32 %0, 1
+  ret i32 %2
+}
+
+define i32 @leaf2(i32) {
+  %2 = mul i32 %0, 3
+  ret i32 %2
+}
+
+define i32 @mid1(i32) {
+  %2 = call i32 @leaf1(i32 %0)
+  %3 = call i32 @ext(i32 %2)
+  ret i32 %3
+}
+
+define i32 @mid2(i32) {
+  %2 = call i32 @leaf2(i32 %0)
+  %3 = call i32 @ext(i32 %2)
+  ret i32 %3
+}
+
+define i32 @top(i32) {
+  %2 = call i32 @mid1(i32 %0)
+  %3 = call i32 @mid2(i32 %2)
+  ret i32 %3
+}
+
+declare i32 @ext(i32)
@@ -0,0 +1,48 @@
+; RUN: opt < %s -correlated-propagation -stats -disable-output 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=FAST
+; RUN: opt < %s -correlated-propagation -lvi-max-cache-entries=1 -S \
+; RUN:   | FileCheck %s -check-prefix=EVICT
+; RUN: opt < %s -correlated-propagation -lvi-max-cache-entries=1 -stats \
+; RUN:     -disable-output 2>&1 | FileCheck %s -check-prefix=STATS
+; REQUIRES: asserts
+
+; The condition of the select and the incoming values of the phi are loads
+; that nothing compares, so their queries are answered without solving.
+; FAST: 3 lazy-value-info - Number of queries answered overdefined without solving
+define i32 @fast(i1* %pc, i32* %p, i1 %c) {
+entry:
+  %l = load i32* %p
+  %lc = load i1* %pc
+  %s = select i1 %lc, i32 %l, i32 1
+  br i1 %c, label %a, label %b
+a:
+  %m = load i32* %p
+  br label %b
+b:
+  %phi = phi i32 [ %l, %entry ], [ %m, %a ]
+  %r = add i32 %phi, %s
+  ret i32 %r
+}
+
+; Evicting values from the cache does not change the results.
+; EVICT-LABEL: @evict(
+; EVICT: %p = phi i32 [ %x, %entry ], [ 7, %a ]
+; EVICT: %q = phi i32 [ %x, %entry ], [ 8, %a ]
+; EVICT: %r = phi i32 [ %x, %entry ], [ 9, %a ]
+; STATS: {{[0-9]+}} lazy-value-info - Number of values evicted from the cache
+define i32 @evict(i32 %x) {
+entry:
+  %c = icmp eq i32 %x, 7
+  br i1 %c, label %a, label %b
+a:
+  %y = add i32 %x, 1
+  %z = add i32 %y, 1
+  br label %b
+b:
+  %p = phi i32 [ %x, %entry ], [ %x, %a ]
+  %q = phi i32 [ %x, %entry ], [ %y, %a ]
+  %r = phi i32 [ %x, %entry ], [ %z, %a ]
+  %s1 = add i32 %p, %q
+  %s2 = add i32 %s1, %r
+  ret i32 %s2
+}
@@ -0,0 +1,83 @@
+; RUN: opt < %s -summary-functionattrs -S | FileCheck %s
+
+@g = global i32 0
+@p = global i32* null
+
+; CHECK: define i32 @leaf() [[RO:#[0-9]+]]
+define i32 @leaf() {
+  %v = load i32* @g
+  ret i32 %v
+}
+
+; Local stores do not count, and the effect of @leaf is inherited.
+; CHECK: define i32 @caller() [[RO]]
+define i32 @caller() {
+  %a = alloca i32
+  store i32 1, i32* %a
+  %v = call i32 @leaf()
+  ret i32 %v
+}
+
+; CHECK: define void @writer() {
+define void @writer() {
+  store i32 1, i32* @g
+  ret void
+}
+
+; CHECK: define void @calls_writer() {
+define void @calls_writer() {
+  call void @writer()
+  ret void
+}
+
+; Arguments passed around a cycle are not captured.
+; CHECK: define i32 @m1(i32* nocapture %q, i1 %c) [[RO]]
+define i32 @m1(i32* %q, i1 %c) {
+  br i1 %c, label %rec, label %done
+rec:
+  %r = call i32 @m2(i32* %q, i1 %c)
+  ret i32 %r
+done:
+  %v = load i32* %q
+  ret i32 %v
+}
+
+; CHECK: define i32 @m2(i32* nocapture %q, i1 %c) [[RO]]
+define i32 @m2(i32* %q, i1 %c) {
+  %r = call i32 @m1(i32* %q, i1 %c)
+  ret i32 %r
+}
+
+; CHECK: define i32 @pure(i32 %x) [[RN:#[0-9]+]]
+define i32 @pure(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+; An argument that reaches a capturing argument is captured.
+; CHECK: define void @store_it(i32* %q) {
+define void @store_it(i32* %q) {
+  store i32* %q, i32** @p
+  ret void
+}
+
+; CHECK: define void @esc(i32* %q) {
+define void @esc(i32* %q) {
+  call void @store_it(i32* %q)
+  ret void
+}
+
+; Definitions that may be replaced are left alone.
+; CHECK: define weak i32 @weak_leaf(i32* %q) {
+define weak i32 @weak_leaf(i32* %q) {
+  ret i32 0
+}
+
+; CHECK: define void @calls_weak(i32* %q) {
+define void @calls_weak(i32* %q) {
+  call i32 @weak_leaf(i32* %q)
+  ret void
+}
+
+; CHECK-DAG: attributes [[RO]] = { readonly }
+; CHECK-DAG: attributes [[RN]] = { readnone }
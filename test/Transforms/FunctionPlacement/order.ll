@@ -0,0 +1,47 @@
+; RUN: opt < %s -order-functions -S | FileCheck %s
+
+; @caller calls @callee on every iteration of its loop, so they form the
+; densest cluster and come first.  @rare ran once, and @unprofiled keeps its
+; place after the functions that ran.
+
+; CHECK: declare void @ext()
+; CHECK: define void @caller(
+; CHECK: define internal void @callee()
+; CHECK: define void @rare()
+; CHECK: define void @unprofiled()
+
+declare void @ext()
+
+define void @unprofiled() {
+  call void @ext()
+  ret void
+}
+
+define void @rare() #0 {
+  ret void
+}
+
+define void @caller(i32 %n) #1 {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  call void @callee()
+  %next = add i32 %i, 1
+  %done = icmp eq i32 %next, %n
+  br i1 %done, label %exit, label %loop, !prof !0
+
+exit:
+  ret void
+}
+
+define internal void @callee() #2 {
+  ret void
+}
+
+attributes #0 = { "function-entry-count"="1" }
+attributes #1 = { "function-entry-count"="10" }
+attributes #2 = { "function-entry-count"="1000" }
+
+!0 = metadata !{metadata !"branch_weights", i32 10, i32 1000}
@@ -0,0 +1,68 @@
+; RUN: opt < %s -function-section-prefix -S | FileCheck %s
+
+@llvm.global_ctors = appending global [1 x { i32, void ()* }] [{ i32, void ()* } { i32 65535, void ()* @init }]
+
+declare void @ext()
+
+; @hot alone makes up 90% of the entries.
+; CHECK: define void @hot() #[[HOT:[0-9]+]]
+define void @hot() #0 {
+  ret void
+}
+
+; CHECK: define void @warm() #[[WARM:[0-9]+]]
+define void @warm() #1 {
+  ret void
+}
+
+; CHECK: define void @never() #[[NEVER:[0-9]+]]
+define void @never() #2 {
+  ret void
+}
+
+; CHECK: define void @cold() #[[COLD:[0-9]+]]
+define void @cold() #3 {
+  ret void
+}
+
+; CHECK: define internal void @init() #[[STARTUP:[0-9]+]]
+define internal void @init() {
+  call void @init_helper()
+  ret void
+}
+
+; Only the constructor calls @init_helper, so it is startup code too.
+; CHECK: define internal void @init_helper() #[[STARTUP]]
+define internal void @init_helper() {
+  call void @ext()
+  ret void
+}
+
+; @shared is also called from @plain, so it is left alone.
+; CHECK: define internal void @shared() {
+define internal void @shared() {
+  ret void
+}
+
+; CHECK: define void @plain() {
+define void @plain() {
+  call void @shared()
+  ret void
+}
+
+; CHECK: define void @explicit() #[[EXPLICIT:[0-9]+]] section "foo"
+define void @explicit() #0 section "foo" {
+  ret void
+}
+
+; CHECK-DAG: attributes #[[HOT]] = { "function-entry-count"="1000" "section-prefix"="hot" }
+; CHECK-DAG: attributes #[[WARM]] = { "function-entry-count"="100" }
+; CHECK-DAG: attributes #[[NEVER]] = { "function-entry-count"="0" "section-prefix"="unlikely" }
+; CHECK-DAG: attributes #[[COLD]] = { cold "section-prefix"="unlikely" }
+; CHECK-DAG: attributes #[[STARTUP]] = { "section-prefix"="startup" }
+; CHECK-DAG: attributes #[[EXPLICIT]] = { "function-entry-count"="1000" }
+
+attributes #0 = { "function-entry-count"="1000" }
+attributes #1 = { "function-entry-count"="100" }
+attributes #2 = { "function-entry-count"="0" }
+attributes #3 = { cold }
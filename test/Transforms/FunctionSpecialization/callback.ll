@@ -0,0 +1,62 @@
+; RUN: opt < %s -function-specialization -funcspec-max-growth=100 -S | FileCheck %s
+; RUN: opt < %s -function-specialization -funcspec-max-growth=0 -S | FileCheck %s -check-prefix=NOGROWTH
+
+; @apply is specialized for each callback, so the calls through %f become
+; direct calls.
+
+define internal i32 @apply(i32 (i32)* %f, i32 %x) {
+entry:
+  %r = call i32 %f(i32 %x)
+  ret i32 %r
+}
+
+define internal i32 @inc(i32 %x) {
+entry:
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define internal i32 @dec(i32 %x) {
+entry:
+  %r = sub i32 %x, 1
+  ret i32 %r
+}
+
+define i32 @caller(i32 %x) {
+entry:
+  %a = call i32 @apply(i32 (i32)* @inc, i32 %x)
+  %b = call i32 @apply(i32 (i32)* @dec, i32 %a)
+  ret i32 %b
+}
+
+; CHECK-LABEL: define i32 @caller
+; CHECK: call i32 @apply.spec(i32 (i32)* @inc, i32 %x)
+; CHECK: call i32 @apply.spec1(i32 (i32)* @dec, i32 %a)
+
+; NOGROWTH-LABEL: define i32 @caller
+; NOGROWTH: call i32 @apply(i32 (i32)* @inc, i32 %x)
+; NOGROWTH: call i32 @apply(i32 (i32)* @dec, i32 %a)
+
+; Functions visible outside the module are left alone.
+
+define i32 @apply_external(i32 (i32)* %f, i32 %x) {
+entry:
+  %r = call i32 %f(i32 %x)
+  ret i32 %r
+}
+
+define i32 @caller_external(i32 %x) {
+entry:
+  %a = call i32 @apply_external(i32 (i32)* @inc, i32 %x)
+  %b = call i32 @apply_external(i32 (i32)* @dec, i32 %a)
+  ret i32 %b
+}
+
+; CHECK-LABEL: define i32 @caller_external
+; CHECK: call i32 @apply_external(i32 (i32)* @inc, i32 %x)
+; CHECK: call i32 @apply_external(i32 (i32)* @dec, i32 %a)
+
+; CHECK-LABEL: define internal i32 @apply.spec(
+; CHECK: call i32 @inc(i32 %x)
+; CHECK-LABEL: define internal i32 @apply.spec1(
+; CHECK: call i32 @dec(i32 %x)
@@ -0,0 +1,36 @@
+; REQUIRES: asserts
+; RUN: opt < %s -basicaa -gvn -stats -S 2>&1 | FileCheck %s
+
+; When GVN finds that %p2 is %p1, memdep only throws away the cached results
+; for %p1 in the blocks that now access memory through it.
+
+; CHECK: define i32 @f
+; CHECK: merge:
+; CHECK-NOT: load i32**
+; CHECK: ret i32
+; CHECK: memdep - Number of cached non-local ptr responses invalidated
+
+target datalayout = "e-p:64:64:64"
+
+define i32 @f(i32** %pp, i1 %c) {
+entry:
+  %p1 = load i32** %pp
+  br i1 %c, label %then, label %else
+
+then:
+  %a = load i32* %p1
+  call void @use(i32 %a)
+  br label %merge
+
+else:
+  br label %merge
+
+merge:
+  %x = load i32* %p1
+  %p2 = load i32** %pp
+  %y = load i32* %p2
+  %r = add i32 %x, %y
+  ret i32 %r
+}
+
+declare void @use(i32) readnone
@@ -0,0 +1,28 @@
+; RUN: opt < %s -basicaa -gvn -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -gvn-max-nonlocal-load-queries=0 -S | FileCheck %s -check-prefix=CAP
+
+; Past the cap on non-local load queries, a load whose value is available in
+; every predecessor is left alone.
+
+define i32 @test(i32* %p, i1 %c) {
+entry:
+  %v = load i32* %p
+  br i1 %c, label %t, label %f
+
+t:
+  br label %m
+
+f:
+  br label %m
+
+; CHECK-LABEL: @test(
+; CHECK: m:
+; CHECK-NEXT: %s = add i32 %v, %v
+; CAP-LABEL: @test(
+; CAP: m:
+; CAP-NEXT: %w = load i32* %p
+m:
+  %w = load i32* %p
+  %s = add i32 %v, %w
+  ret i32 %s
+}
@@ -0,0 +1,26 @@
+; RUN: opt < %s -basicaa -gvn -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -gvn-single-iteration -S | FileCheck %s
+
+; %y is only found to be redundant after %p was numbered, which leaves %p
+; with the same value on both edges.  A second walk over the function, or
+; the worklist of changed values, simplifies %p and renumbers %q.
+
+define i32 @test(i32 %a, i32 %b, i1 %c) {
+entry:
+  %x = add i32 %a, %b
+  br label %loop
+
+; CHECK-LABEL: @test(
+; CHECK: loop:
+; CHECK-NOT: phi
+; CHECK-NOT: %y
+; CHECK: %q = add i32 %x, 1
+loop:
+  %p = phi i32 [ %x, %entry ], [ %y, %loop ]
+  %y = add i32 %a, %b
+  %q = add i32 %p, 1
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %q
+}
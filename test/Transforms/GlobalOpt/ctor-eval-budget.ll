@@ -0,0 +1,29 @@
+; RUN: opt -globalopt -globalopt-ctor-eval-budget=4 -S < %s | FileCheck %s
+
+%0 = type { i32, void ()* }
+
+@A = global i32 0
+@B = global i32 0
+@C = global i32 0
+@llvm.global_ctors = appending global [2 x %0] [%0 { i32 65535, void ()* @small }, %0 { i32 65535, void ()* @big }]
+
+; CHECK: @A = global i32 1
+; CHECK: @B = global i32 0
+; CHECK: @C = global i32 0
+; CHECK: @llvm.global_ctors = appending global [1 x {{.*}}] [{{.*}} { i32 65535, void ()* @big }]
+
+define internal void @small() {
+  store i32 1, i32* @A
+  ret void
+}
+
+; Five instructions are over the budget.
+; CHECK-LABEL: define internal void @big(
+; CHECK: store i32 2, i32* @B
+define internal void @big() {
+  store i32 2, i32* @B
+  store i32 3, i32* @C
+  store i32 4, i32* @B
+  store i32 5, i32* @C
+  ret void
+}
@@ -0,0 +1,82 @@
+; RUN: opt < %s -hotcoldsplit -S | FileCheck %s
+; RUN: opt < %s -hotcoldsplit -mtriple=x86_64-apple-macosx -S \
+; RUN:   | FileCheck --check-prefix=DARWIN %s
+
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @report(i32) cold
+declare void @work(i32)
+declare void @abort() noreturn
+
+; The error path ends in unreachable, so it is cold.
+
+; CHECK-LABEL: define i32 @fails(
+; CHECK: call void @fails_error(i32 %x)
+; CHECK-NOT: @report
+; CHECK: ret i32 0
+define i32 @fails(i32 %x) {
+entry:
+  %bad = icmp slt i32 %x, 0
+  br i1 %bad, label %error, label %ok
+
+error:
+  %neg = sub i32 0, %x
+  call void @report(i32 %neg)
+  %twice = mul i32 %neg, 2
+  call void @report(i32 %twice)
+  call void @abort()
+  unreachable
+
+ok:
+  call void @work(i32 %x)
+  ret i32 0
+}
+
+; The path that calls a cold function is cold, and it rejoins the hot path.
+
+; CHECK-LABEL: define i32 @rejoins(
+; CHECK: call void @rejoins_slow(i32 %x)
+; CHECK-NEXT: br label %done
+define i32 @rejoins(i32 %x) {
+entry:
+  %bad = icmp eq i32 %x, 42
+  br i1 %bad, label %slow, label %done
+
+slow:
+  %a = add i32 %x, 1
+  call void @report(i32 %a)
+  %b = add i32 %x, 2
+  call void @report(i32 %b)
+  br label %done
+
+done:
+  %r = phi i32 [ 0, %entry ], [ 1, %slow ]
+  call void @work(i32 %x)
+  ret i32 %r
+}
+
+; A cold region this small is cheaper left in place than called.
+
+; CHECK-LABEL: define void @small(
+; CHECK: call void @report(i32 %x)
+; CHECK: ret void
+define void @small(i32 %x) {
+entry:
+  %bad = icmp eq i32 %x, 42
+  br i1 %bad, label %slow, label %done
+
+slow:
+  call void @report(i32 %x)
+  br label %done
+
+done:
+  call void @work(i32 %x)
+  ret void
+}
+
+; CHECK: define internal void @fails_error(i32 %x) #[[COLD:[0-9]+]] section ".text.unlikely"
+; CHECK: call void @abort()
+; CHECK: define internal void @rejoins_slow(i32 %x) #[[COLD]] section ".text.unlikely"
+; CHECK: attributes #[[COLD]] = { {{.*}}cold
+
+; DARWIN: define internal void @fails_error(i32 %x) #{{[0-9]+}} {
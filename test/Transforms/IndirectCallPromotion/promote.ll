@@ -0,0 +1,79 @@
+; RUN: opt < %s -indirect-call-promotion -S | FileCheck %s
+
+%struct.S = type { i32 }
+
+declare i32 @hot(i32)
+declare void @warm(i32)
+declare void @sink(i32)
+declare i32 @takes_struct(%struct.S*)
+declare i32 @two_args(i32, i32)
+
+; @hot is called directly behind a check; @cold is called too rarely.
+define i32 @one_target(i32 (i32)* %fp, i32 %x) {
+entry:
+  %r = call i32 %fp(i32 %x), !prof !0
+  ret i32 %r
+}
+
+; CHECK-LABEL: @one_target(
+; CHECK: [[CMP:%.*]] = icmp eq i32 (i32)* %fp, @hot
+; CHECK-NEXT: br i1 [[CMP]], label %icp.direct, label %icp.indirect, !prof [[HOT_WEIGHTS:![0-9]+]]
+; CHECK: icp.direct:
+; CHECK-NEXT: %r.direct = call i32 @hot(i32 %x)
+; CHECK-NEXT: br label %icp.merge
+; CHECK: icp.indirect:
+; CHECK-NEXT: %r.indirect = call i32 %fp(i32 %x), !prof [[COLD_LEFT:![0-9]+]]
+; CHECK-NEXT: br label %icp.merge
+; CHECK: icp.merge:
+; CHECK-NEXT: %r = phi i32 [ %r.direct, %icp.direct ], [ %r.indirect, %icp.indirect ]
+; CHECK-NEXT: ret i32 %r
+
+; Both targets are promoted, the second one for what the first leaves.
+define void @two_targets(void (i32)* %fp, i32 %x) {
+entry:
+  call void %fp(i32 %x), !prof !1
+  ret void
+}
+
+; CHECK-LABEL: @two_targets(
+; CHECK: icmp eq void (i32)* %fp, @warm
+; CHECK: call void @warm(i32 %x)
+; CHECK: icmp eq void (i32)* %fp, @sink
+; CHECK: call void @sink(i32 %x)
+; CHECK: call void %fp(i32 %x), !prof [[NOTHING_LEFT:![0-9]+]]
+; CHECK-NOT: phi
+; CHECK: ret void
+
+; The pointer types of the arguments may differ.
+define i32 @cast_args(i32 (i8*)* %fp, i8* %p) {
+entry:
+  %r = call i32 %fp(i8* %p), !prof !2
+  ret i32 %r
+}
+
+; CHECK-LABEL: @cast_args(
+; CHECK: icmp eq i32 (i8*)* %fp, bitcast (i32 (%struct.S*)* @takes_struct to i32 (i8*)*)
+; CHECK: call i32 bitcast (i32 (%struct.S*)* @takes_struct to i32 (i8*)*)(i8* %p)
+
+; Targets that are not declared, or cannot be called with the arguments, are
+; left alone.
+define i32 @not_promoted(i32 (i32)* %fp, i32 %x) {
+entry:
+  %r = call i32 %fp(i32 %x), !prof !3
+  ret i32 %r
+}
+
+; CHECK-LABEL: @not_promoted(
+; CHECK-NOT: icmp
+; CHECK: call i32 %fp(i32 %x), !prof [[SAME:![0-9]+]]
+; CHECK-NEXT: ret i32
+
+; CHECK-DAG: [[HOT_WEIGHTS]] = metadata !{metadata !"branch_weights", i32 900, i32 100}
+; CHECK-DAG: [[COLD_LEFT]] = metadata !{metadata !"indirect_call_targets", i64 100, metadata !"cold", i64 50}
+; CHECK-DAG: [[NOTHING_LEFT]] = metadata !{metadata !"indirect_call_targets", i64 100}
+; CHECK-DAG: [[SAME]] = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"missing", i64 600, metadata !"two_args", i64 400}
+
+!0 = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"hot", i64 900, metadata !"cold", i64 50}
+!1 = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"warm", i64 500, metadata !"sink", i64 400}
+!2 = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"takes_struct", i64 1000}
+!3 = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"missing", i64 600, metadata !"two_args", i64 400}
@@ -0,0 +1,126 @@
+; RUN: opt < %s -inline -S | FileCheck %s
+; RUN: opt < %s -inline -inline-cache-callee-walks=false -S | FileCheck %s
+; RUN: opt < %s -inline -stats -disable-output 2>&1 | FileCheck %s -check-prefix=STATS
+; REQUIRES: asserts
+
+; Each callee is walked once and the walk is replayed at every call site,
+; with the same decisions as walking it each time.
+
+; STATS: 2 inline-cost - Number of callee walks recorded
+; STATS: 6 inline-cost - Number of callee walks replayed
+
+define i32 @small(i32 %x, i32* %p) {
+  %l = load i32* %p
+  %r = add i32 %x, %l
+  ret i32 %r
+}
+
+define i32 @big(i32 %x, i32* %p) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %v0 = add i32 %i, 3
+  %v1 = mul i32 %v0, 4
+  %v2 = xor i32 %v1, 5
+  %v3 = add i32 %v2, 6
+  %v4 = mul i32 %v3, 7
+  %v5 = xor i32 %v4, 8
+  %v6 = add i32 %v5, 9
+  %v7 = mul i32 %v6, 10
+  %v8 = xor i32 %v7, 11
+  %v9 = add i32 %v8, 12
+  %v10 = mul i32 %v9, 13
+  %v11 = xor i32 %v10, 14
+  %v12 = add i32 %v11, 15
+  %v13 = mul i32 %v12, 16
+  %v14 = xor i32 %v13, 17
+  %v15 = add i32 %v14, 18
+  %v16 = mul i32 %v15, 19
+  %v17 = xor i32 %v16, 20
+  %v18 = add i32 %v17, 21
+  %v19 = mul i32 %v18, 22
+  %v20 = xor i32 %v19, 23
+  %v21 = add i32 %v20, 24
+  %v22 = mul i32 %v21, 25
+  %v23 = xor i32 %v22, 26
+  %v24 = add i32 %v23, 27
+  %v25 = mul i32 %v24, 28
+  %v26 = xor i32 %v25, 29
+  %v27 = add i32 %v26, 30
+  %v28 = mul i32 %v27, 31
+  %v29 = xor i32 %v28, 32
+  %v30 = add i32 %v29, 33
+  %v31 = mul i32 %v30, 34
+  %v32 = xor i32 %v31, 35
+  %v33 = add i32 %v32, 36
+  %v34 = mul i32 %v33, 37
+  %v35 = xor i32 %v34, 38
+  %v36 = add i32 %v35, 39
+  %v37 = mul i32 %v36, 40
+  %v38 = xor i32 %v37, 41
+  %v39 = add i32 %v38, 42
+  %v40 = mul i32 %v39, 43
+  %v41 = xor i32 %v40, 44
+  %v42 = add i32 %v41, 45
+  %v43 = mul i32 %v42, 46
+  %v44 = xor i32 %v43, 47
+  %v45 = add i32 %v44, 48
+  %v46 = mul i32 %v45, 49
+  %v47 = xor i32 %v46, 50
+  %v48 = add i32 %v47, 51
+  %v49 = mul i32 %v48, 52
+  %v50 = xor i32 %v49, 53
+  %v51 = add i32 %v50, 54
+  %v52 = mul i32 %v51, 55
+  %v53 = xor i32 %v52, 56
+  %v54 = add i32 %v53, 57
+  %v55 = mul i32 %v54, 58
+  %v56 = xor i32 %v55, 59
+  %v57 = add i32 %v56, 60
+  %v58 = mul i32 %v57, 61
+  %v59 = xor i32 %v58, 62
+  store i32 %v59, i32* %p
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %x
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %v59
+}
+
+define i32 @a(i32 %x, i32* %p) {
+; CHECK-LABEL: @a(
+; CHECK-NOT: call i32 @small
+; CHECK: call i32 @big
+  %s = call i32 @small(i32 %x, i32* %p)
+  %b = call i32 @big(i32 %s, i32* %p)
+  ret i32 %b
+}
+
+define i32 @b(i32 %x, i32* %p) {
+; CHECK-LABEL: @b(
+; CHECK-NOT: call i32 @small
+; CHECK: call i32 @big
+  %s = call i32 @small(i32 %x, i32* %p)
+  %b = call i32 @big(i32 %s, i32* %p)
+  ret i32 %b
+}
+
+define i32 @c(i32 %x, i32* %p) {
+; CHECK-LABEL: @c(
+; CHECK-NOT: call i32 @small
+; CHECK: call i32 @big
+  %s = call i32 @small(i32 %x, i32* %p)
+  %b = call i32 @big(i32 %s, i32* %p)
+  ret i32 %b
+}
+
+; A constant argument may simplify the callee, so it is walked again.
+define i32 @d(i32* %p) {
+; CHECK-LABEL: @d(
+; CHECK-NOT: call i32 @small
+  %s = call i32 @small(i32 1, i32* %p)
+  ret i32 %s
+}
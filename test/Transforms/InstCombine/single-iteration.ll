@@ -0,0 +1,22 @@
+; RUN: opt < %s -instcombine -S | FileCheck %s
+; RUN: opt < %s -instcombine -instcombine-single-iteration -S | FileCheck %s
+; RUN: opt < %s -instcombine -stats -disable-output 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=FIXPOINT
+; RUN: opt < %s -instcombine -instcombine-single-iteration -stats \
+; RUN:   -disable-output 2>&1 | FileCheck %s -check-prefix=SINGLE
+; REQUIRES: asserts
+
+; Without -instcombine-single-iteration, instcombine makes a second pass over
+; the function to find that there is nothing left to do.
+
+; FIXPOINT: 2 instcombine - Number of iterations over a function
+; SINGLE: 1 instcombine - Number of iterations over a function
+
+; CHECK-LABEL: @f(
+; CHECK-NEXT: ret i32 %x
+define i32 @f(i32 %x) {
+  %a = add i32 %x, 1
+  %b = sub i32 %a, 1
+  %c = mul i32 %b, 1
+  ret i32 %c
+}
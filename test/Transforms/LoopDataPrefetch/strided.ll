@@ -0,0 +1,49 @@
+; RUN: opt < %s -loop-data-prefetch -prefetch-cache-line-size=64 \
+; RUN:   -prefetch-miss-latency=1 -S | FileCheck %s
+; RUN: opt < %s -loop-data-prefetch -S | FileCheck --check-prefix=NOTARGET %s
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+; The column loads and stores advance by 128 bytes per iteration and are
+; prefetched one iteration ahead. The row load only moves 8 bytes and is left
+; to the hardware prefetcher. The second column load is in the same cache line
+; as the first and shares its prefetch.
+
+; CHECK-LABEL: @scan(
+; CHECK: for.body:
+; CHECK: call void @llvm.prefetch(i8* %{{.*}}, i32 0, i32 3, i32 1)
+; CHECK-NEXT: load i64*
+; CHECK-NOT: call void @llvm.prefetch(i8* %{{.*}}, i32 0
+; CHECK: call void @llvm.prefetch(i8* %{{.*}}, i32 1, i32 3, i32 1)
+; CHECK-NEXT: store i64
+; CHECK-NOT: call void @llvm.prefetch
+; CHECK: for.end:
+
+; NOTARGET-NOT: @llvm.prefetch
+define i64 @scan(i64* noalias %col, i64* noalias %row, i64* noalias %out, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %sum = phi i64 [ 0, %entry ], [ %sum.next, %for.body ]
+  %idx = mul nsw i64 %i, 16
+  %p0 = getelementptr inbounds i64* %col, i64 %idx
+  %v0 = load i64* %p0, align 8
+  %idx1 = add nsw i64 %idx, 1
+  %p1 = getelementptr inbounds i64* %col, i64 %idx1
+  %v1 = load i64* %p1, align 8
+  %pr = getelementptr inbounds i64* %row, i64 %i
+  %vr = load i64* %pr, align 8
+  %a = add i64 %v0, %v1
+  %b = add i64 %a, %vr
+  %po = getelementptr inbounds i64* %out, i64 %idx
+  store i64 %b, i64* %po, align 8
+  %sum.next = add i64 %sum, %b
+  %i.next = add nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret i64 %sum.next
+}
@@ -0,0 +1,89 @@
+; RUN: opt < %s -basicaa -loop-distribute -S | FileCheck %s
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+;   for (i = 0; i < n; ++i) {
+;     A[i + 1] = A[i] * B[i];
+;     C[i] = D[i] + E[i];
+;   }
+;
+; The recurrence through A is moved to a loop of its own, so that the second
+; statement can be vectorized.
+
+; CHECK-LABEL: @recurrence(
+; CHECK: for.body.ldist:
+; CHECK: %iv.ldist = phi i64 [ 0, %entry ], [ %iv.next.ldist, %for.body.ldist ]
+; CHECK: load i32* %arrayidxA.ldist
+; CHECK: load i32* %arrayidxB.ldist
+; CHECK: mul i32
+; CHECK: store i32 %mulA.ldist, i32* %arrayidxA_plus_1.ldist
+; CHECK-NOT: load
+; CHECK: br i1 %exitcond.ldist, label %ldist.ph, label %for.body.ldist
+; CHECK: ldist.ph:
+; CHECK-NEXT: br label %for.body
+; CHECK: for.body:
+; CHECK: %iv = phi i64 [ 0, %ldist.ph ], [ %iv.next, %for.body ]
+; CHECK-NOT: %arrayidxA
+; CHECK: load i32* %arrayidxD
+; CHECK: load i32* %arrayidxE
+; CHECK: add i32
+; CHECK: store i32 %addC, i32* %arrayidxC
+; CHECK: br i1 %exitcond, label %for.end, label %for.body
+define void @recurrence(i32* noalias %a, i32* noalias %b, i32* noalias %c,
+                        i32* noalias %d, i32* noalias %e, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+
+  %arrayidxA = getelementptr inbounds i32* %a, i64 %iv
+  %loadA = load i32* %arrayidxA, align 4
+  %arrayidxB = getelementptr inbounds i32* %b, i64 %iv
+  %loadB = load i32* %arrayidxB, align 4
+  %mulA = mul i32 %loadB, %loadA
+  %iv.next = add nuw nsw i64 %iv, 1
+  %arrayidxA_plus_1 = getelementptr inbounds i32* %a, i64 %iv.next
+  store i32 %mulA, i32* %arrayidxA_plus_1, align 4
+
+  %arrayidxD = getelementptr inbounds i32* %d, i64 %iv
+  %loadD = load i32* %arrayidxD, align 4
+  %arrayidxE = getelementptr inbounds i32* %e, i64 %iv
+  %loadE = load i32* %arrayidxE, align 4
+  %addC = add i32 %loadE, %loadD
+  %arrayidxC = getelementptr inbounds i32* %c, i64 %iv
+  store i32 %addC, i32* %arrayidxC, align 4
+
+  %exitcond = icmp eq i64 %iv.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Without a recurrence the loop is left alone.
+
+; CHECK-LABEL: @no_recurrence(
+; CHECK-NOT: ldist
+; CHECK: ret void
+define void @no_recurrence(i32* noalias %c, i32* noalias %d,
+                           i32* noalias %e, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %arrayidxD = getelementptr inbounds i32* %d, i64 %iv
+  %loadD = load i32* %arrayidxD, align 4
+  %arrayidxE = getelementptr inbounds i32* %e, i64 %iv
+  %loadE = load i32* %arrayidxE, align 4
+  %addC = add i32 %loadE, %loadD
+  %arrayidxC = getelementptr inbounds i32* %c, i64 %iv
+  store i32 %addC, i32* %arrayidxC, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
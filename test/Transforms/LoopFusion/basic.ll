@@ -0,0 +1,92 @@
+; RUN: opt < %s -basicaa -loop-fusion -S | FileCheck %s
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+;   for (i = 0; i < n; ++i)
+;     B[i] = A[i] * 2;
+;   for (i = 0; i < n; ++i)
+;     C[i] = B[i] + 1;
+
+; CHECK-LABEL: @fuse(
+; CHECK: for.body:
+; CHECK: %iv = phi i64
+; CHECK: %iv2 = phi i64 [ 0, %entry ], [ %iv2.next, %for.body ]
+; CHECK: store i32 %mul, i32* %arrayidxB
+; CHECK: load i32* %arrayidxB2
+; CHECK: store i32 %add, i32* %arrayidxC
+; CHECK: br i1 %exitcond, label %for.end2, label %for.body
+; CHECK-NOT: for.body2:
+; CHECK: for.end2:
+; CHECK-NEXT: ret void
+define void @fuse(i32* noalias %a, i32* noalias %b, i32* noalias %c, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %arrayidxA = getelementptr inbounds i32* %a, i64 %iv
+  %loadA = load i32* %arrayidxA, align 4
+  %mul = shl i32 %loadA, 1
+  %arrayidxB = getelementptr inbounds i32* %b, i64 %iv
+  store i32 %mul, i32* %arrayidxB, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  br label %for.body2
+
+for.body2:
+  %iv2 = phi i64 [ 0, %for.end ], [ %iv2.next, %for.body2 ]
+  %arrayidxB2 = getelementptr inbounds i32* %b, i64 %iv2
+  %loadB = load i32* %arrayidxB2, align 4
+  %add = add i32 %loadB, 1
+  %arrayidxC = getelementptr inbounds i32* %c, i64 %iv2
+  store i32 %add, i32* %arrayidxC, align 4
+  %iv2.next = add nuw nsw i64 %iv2, 1
+  %exitcond2 = icmp eq i64 %iv2.next, %n
+  br i1 %exitcond2, label %for.end2, label %for.body2
+
+for.end2:
+  ret void
+}
+
+; The second loop reads B[i + 1], which the first loop only writes in its
+; next iteration, so the loops cannot be fused.
+
+; CHECK-LABEL: @no_fuse(
+; CHECK: for.body:
+; CHECK: br i1 %exitcond, label %for.end, label %for.body
+; CHECK: for.body2:
+define void @no_fuse(i32* noalias %a, i32* noalias %b, i32* noalias %c, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %arrayidxA = getelementptr inbounds i32* %a, i64 %iv
+  %loadA = load i32* %arrayidxA, align 4
+  %mul = shl i32 %loadA, 1
+  %arrayidxB = getelementptr inbounds i32* %b, i64 %iv
+  store i32 %mul, i32* %arrayidxB, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %exitcond = icmp eq i64 %iv.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  br label %for.body2
+
+for.body2:
+  %iv2 = phi i64 [ 0, %for.end ], [ %iv2.next, %for.body2 ]
+  %iv2.next = add nuw nsw i64 %iv2, 1
+  %arrayidxB2 = getelementptr inbounds i32* %b, i64 %iv2.next
+  %loadB = load i32* %arrayidxB2, align 4
+  %add = add i32 %loadB, 1
+  %arrayidxC = getelementptr inbounds i32* %c, i64 %iv2
+  store i32 %add, i32* %arrayidxC, align 4
+  %exitcond2 = icmp eq i64 %iv2.next, %n
+  br i1 %exitcond2, label %for.end2, label %for.body2
+
+for.end2:
+  ret void
+}
@@ -0,0 +1,74 @@
+; RUN: opt < %s -loop-invariant-div -force-loop-invariant-div -S | FileCheck %s
+; RUN: opt < %s -loop-invariant-div -S | FileCheck --check-prefix=NOTARGET %s
+
+; Divisions by a loop-invariant divisor become a multiply by a reciprocal that
+; the preheader computes once.  Without target information nothing changes.
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+; CHECK-LABEL: @div_rem(
+; CHECK: entry:
+; CHECK: %div.nonzero = select i1 %{{.*}}, i32 1, i32 %d
+; CHECK: call i32 @llvm.ctlz.i32(
+; CHECK: udiv i64
+; CHECK: %div.magic = add i32
+; CHECK: loop:
+; CHECK-NOT: udiv
+; CHECK-NOT: urem
+; CHECK: mul i64
+; CHECK: %q = lshr i32 {{.*}}, %div.postshift
+; CHECK: mul i32 %{{.*}}, %d
+; CHECK: %r = sub i32 %i
+; CHECK: exit:
+
+; NOTARGET-LABEL: @div_rem(
+; NOTARGET: %q = udiv i32 %i, %d
+; NOTARGET: %r = urem i32 %i, %d
+define i32 @div_rem(i32 %n, i32 %d) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %q = udiv i32 %i, %d
+  %r = urem i32 %i, %d
+  %s = add i32 %q, %r
+  %acc.next = add i32 %acc, %s
+  %i.next = add i32 %i, 1
+  %more = icmp ult i32 %i.next, %n
+  br i1 %more, label %loop, label %exit
+
+exit:
+  ret i32 %acc.next
+}
+
+; Signed divisions, constant divisors and invariant dividends are left alone.
+; CHECK-LABEL: @untouched(
+; CHECK-NOT: div.magic
+; CHECK: sdiv i64 %i, %d
+; CHECK: udiv i64 %i, 7
+; CHECK: udiv i64 %n, %d
+; CHECK: ret
+define i64 @untouched(i64 %n, i64 %d) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %acc = phi i64 [ 0, %entry ], [ %acc.next, %loop ]
+  %a = sdiv i64 %i, %d
+  %b = udiv i64 %i, 7
+  %c = udiv i64 %n, %d
+  %ab = add i64 %a, %b
+  %abc = add i64 %ab, %c
+  %acc.next = add i64 %acc, %abc
+  %i.next = add i64 %i, 1
+  %more = icmp ult i64 %i.next, %n
+  br i1 %more, label %loop, label %exit
+
+exit:
+  ret i64 %acc.next
+}
+
+; CHECK: declare i32 @llvm.ctlz.i32(i32, i1)
@@ -0,0 +1,31 @@
+; RUN: opt < %s -loop-reduce -lsr-solver-budget=1 -S | FileCheck %s
+; RUN: opt < %s -loop-reduce -lsr-solver-budget=1 -stats -disable-output 2>&1 | FileCheck %s -check-prefix=STATS
+; REQUIRES: asserts
+
+; Once the solver has rated as many formulae as its budget allows, LSR still
+; rewrites the loop, with a greedy solution.
+
+declare i1 @cond(i32)
+
+define void @test(i32 %B) {
+entry:
+  br label %Loop
+
+; CHECK-LABEL: @test(
+; CHECK: Loop:
+; CHECK: %lsr.iv
+Loop:
+  %IV = phi i32 [ 0, %entry ], [ %IVn, %Loop ]
+  %C = mul i32 %IV, 18
+  %D = mul i32 %IV, 18
+  %E = add i32 %D, %B
+  %cnd = call i1 @cond(i32 %E)
+  call i1 @cond(i32 %C)
+  %IVn = add i32 %IV, 1
+  br i1 %cnd, label %Loop, label %Out
+
+Out:
+  ret void
+}
+
+; STATS: 1 loop-reduce - Number of loops solved greedily once the solver ran out of budget
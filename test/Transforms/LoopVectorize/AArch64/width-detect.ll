@@ -0,0 +1,58 @@
+; RUN: opt < %s -loop-vectorize -mtriple=aarch64-none-linux-gnu -mattr=+neon -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -mtriple=aarch64-none-linux-gnu -mattr=-neon -S | FileCheck %s --check-prefix=NONEON
+
+target datalayout = "e-p:64:64-i64:64:64-i128:128:128-s0:32:32-f128:128:128-n32:64-S128"
+target triple = "aarch64-none-linux-gnu"
+
+; The NEON registers are 128 bits wide, and the loop is unrolled twice.
+; CHECK-LABEL: @foo_F32(
+; CHECK: fadd <4 x float>
+; CHECK: fadd <4 x float>
+; CHECK: ret
+; NONEON-LABEL: @foo_F32(
+; NONEON-NOT: <4 x float>
+; NONEON: ret
+define float @foo_F32(float* nocapture %A, i32 %n) nounwind uwtable readonly {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %indvars.iv = phi i64 [ %indvars.iv.next, %for.body ], [ 0, %entry ]
+  %sum = phi float [ %add, %for.body ], [ 0.000000e+00, %entry ]
+  %arrayidx = getelementptr inbounds float* %A, i64 %indvars.iv
+  %0 = load float* %arrayidx, align 4
+  %add = fadd fast float %sum, %0
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %sum.lcssa = phi float [ 0.000000e+00, %entry ], [ %add, %for.body ]
+  ret float %sum.lcssa
+}
+
+; CHECK-LABEL: @foo_I8(
+; CHECK: xor <16 x i8>
+; CHECK: ret
+define signext i8 @foo_I8(i8* nocapture %A, i32 %n) nounwind uwtable readonly {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %indvars.iv = phi i64 [ %indvars.iv.next, %for.body ], [ 0, %entry ]
+  %red = phi i8 [ %xor, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i8* %A, i64 %indvars.iv
+  %0 = load i8* %arrayidx, align 1
+  %xor = xor i8 %0, %red
+  %indvars.iv.next = add i64 %indvars.iv, 1
+  %lftr.wideiv = trunc i64 %indvars.iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %red.lcssa = phi i8 [ 0, %entry ], [ %xor, %for.body ]
+  ret i8 %red.lcssa
+}
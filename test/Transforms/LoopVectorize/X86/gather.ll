@@ -0,0 +1,66 @@
+; RUN: opt < %s -loop-vectorize -mtriple=x86_64-apple-macosx10.8.0 -mcpu=core-avx2 -force-vector-width=4 -force-vector-unroll=1 -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -mtriple=x86_64-apple-macosx10.8.0 -mcpu=corei7-avx -force-vector-width=4 -force-vector-unroll=1 -S | FileCheck %s --check-prefix=AVX1
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.8.0"
+
+@table = common global [1024 x float] zeroinitializer, align 16
+
+; out[i] = table[idx[i]] loads table with a gather using the 32-bit indices,
+; before they are sign extended.
+; CHECK-LABEL: @lookup(
+; CHECK: [[IDX:%.*]] = load <4 x i32>*
+; CHECK: call <4 x float> @llvm.gather.v4f32.v4i32(i8* bitcast ([1024 x float]* @table to i8*), <4 x i32> [[IDX]])
+; CHECK: store <4 x float>
+; CHECK: ret void
+
+; Without AVX2 there is no gather instruction, so the load stays scalar.
+; AVX1-LABEL: @lookup(
+; AVX1-NOT: @llvm.gather
+; AVX1: ret void
+define void @lookup(float* noalias nocapture %out, i32* noalias nocapture readonly %idx, i64 %n) {
+entry:
+  %cmp6 = icmp sgt i64 %n, 0
+  br i1 %cmp6, label %for.body, label %for.end
+
+for.body:
+  %i.07 = phi i64 [ %inc, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i32* %idx, i64 %i.07
+  %0 = load i32* %arrayidx, align 4
+  %idxprom = sext i32 %0 to i64
+  %arrayidx1 = getelementptr inbounds [1024 x float]* @table, i64 0, i64 %idxprom
+  %1 = load float* %arrayidx1, align 4
+  %arrayidx2 = getelementptr inbounds float* %out, i64 %i.07
+  store float %1, float* %arrayidx2, align 4
+  %inc = add nsw i64 %i.07, 1
+  %exitcond = icmp eq i64 %inc, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; 64-bit indices that are not sign extended are used as they are.
+; CHECK-LABEL: @lookup64(
+; CHECK: call <4 x double> @llvm.gather.v4f64.v4i64(i8* %{{.*}}, <4 x i64> %{{.*}})
+; CHECK: ret void
+define void @lookup64(double* noalias nocapture %out, double* noalias nocapture readonly %t, i64* noalias nocapture readonly %idx, i64 %n) {
+entry:
+  %cmp6 = icmp sgt i64 %n, 0
+  br i1 %cmp6, label %for.body, label %for.end
+
+for.body:
+  %i.07 = phi i64 [ %inc, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i64* %idx, i64 %i.07
+  %0 = load i64* %arrayidx, align 8
+  %arrayidx1 = getelementptr inbounds double* %t, i64 %0
+  %1 = load double* %arrayidx1, align 8
+  %arrayidx2 = getelementptr inbounds double* %out, i64 %i.07
+  store double %1, double* %arrayidx2, align 8
+  %inc = add nsw i64 %i.07, 1
+  %exitcond = icmp eq i64 %inc, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
@@ -0,0 +1,39 @@
+; RUN: opt < %s -loop-vectorize -enable-interleaved-mem-accesses \
+; RUN:   -mtriple=x86_64-apple-macosx10.8.0 -mcpu=corei7 -S | FileCheck %s
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.8.0"
+
+; Splitting pairs of floats takes a shufps per half, which makes the loop
+; worth vectorizing.
+; for (i = 0; i < 1024; ++i)
+;   Mag[i] = Z[2*i] * Z[2*i] + Z[2*i+1] * Z[2*i+1];
+
+; CHECK-LABEL: @magnitude(
+; CHECK: load <8 x float>
+; CHECK: fmul <4 x float>
+; CHECK: store <4 x float>
+define void @magnitude(float* noalias nocapture %Z, float* noalias nocapture %Mag) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %even = shl nsw i64 %i, 1
+  %p.re = getelementptr inbounds float* %Z, i64 %even
+  %re = load float* %p.re, align 4
+  %odd = or i64 %even, 1
+  %p.im = getelementptr inbounds float* %Z, i64 %odd
+  %im = load float* %p.im, align 4
+  %re2 = fmul float %re, %re
+  %im2 = fmul float %im, %im
+  %mag = fadd float %re2, %im2
+  %p.mag = getelementptr inbounds float* %Mag, i64 %i
+  store float %mag, float* %p.mag, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
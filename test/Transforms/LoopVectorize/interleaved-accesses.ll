@@ -0,0 +1,138 @@
+; RUN: opt < %s -loop-vectorize -enable-interleaved-mem-accesses \
+; RUN:   -force-vector-width=4 -force-vector-unroll=1 -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -force-vector-width=4 -force-vector-unroll=1 \
+; RUN:   -S | FileCheck --check-prefix=DISABLED %s
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+; for (i = 0; i < 1024; ++i)
+;   Sum[i] = A[2*i] + A[2*i+1];
+
+; CHECK-LABEL: @load_pairs(
+; CHECK: vector.body:
+; CHECK: %wide.vec = load <8 x i32>* %{{.*}}, align 4
+; CHECK: shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 0, i32 2, i32 4, i32 6>
+; CHECK: shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 1, i32 3, i32 5, i32 7>
+; CHECK: add nsw <4 x i32>
+; CHECK: store <4 x i32>
+
+; DISABLED-LABEL: @load_pairs(
+; DISABLED-NOT: load <8 x i32>
+; DISABLED: ret void
+define void @load_pairs(i32* noalias nocapture %A, i32* noalias nocapture %Sum) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %even = shl nsw i64 %i, 1
+  %p.even = getelementptr inbounds i32* %A, i64 %even
+  %a = load i32* %p.even, align 4
+  %odd = or i64 %even, 1
+  %p.odd = getelementptr inbounds i32* %A, i64 %odd
+  %b = load i32* %p.odd, align 4
+  %sum = add nsw i32 %a, %b
+  %p.sum = getelementptr inbounds i32* %Sum, i64 %i
+  store i32 %sum, i32* %p.sum, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; A group of loads may skip fields in the middle.
+; for (i = 0; i < 1024; ++i)
+;   Sum[i] = A[3*i] + A[3*i+2];
+
+; CHECK-LABEL: @load_gap(
+; CHECK: vector.body:
+; CHECK: %wide.vec = load <12 x float>* %{{.*}}, align 4
+; CHECK: shufflevector <12 x float> %wide.vec, <12 x float> undef, <4 x i32> <i32 0, i32 3, i32 6, i32 9>
+; CHECK: shufflevector <12 x float> %wide.vec, <12 x float> undef, <4 x i32> <i32 2, i32 5, i32 8, i32 11>
+; CHECK: fadd <4 x float>
+define void @load_gap(float* noalias nocapture %A, float* noalias nocapture %Sum) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %first = mul nsw i64 %i, 3
+  %p.first = getelementptr inbounds float* %A, i64 %first
+  %a = load float* %p.first, align 4
+  %third = add nsw i64 %first, 2
+  %p.third = getelementptr inbounds float* %A, i64 %third
+  %b = load float* %p.third, align 4
+  %sum = fadd float %a, %b
+  %p.sum = getelementptr inbounds float* %Sum, i64 %i
+  store float %sum, float* %p.sum, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; for (i = 0; i < 1024; ++i) {
+;   C[2*i] = Re[i];
+;   C[2*i+1] = Im[i];
+; }
+
+; CHECK-LABEL: @store_pairs(
+; CHECK: vector.body:
+; CHECK: %[[RE:.*]] = load <4 x i32>
+; CHECK: %[[IM:.*]] = load <4 x i32>
+; CHECK: %[[CONCAT:.*]] = shufflevector <4 x i32> %[[RE]], <4 x i32> %[[IM]], <8 x i32> <i32 0, i32 1, i32 2, i32 3, i32 4, i32 5, i32 6, i32 7>
+; CHECK: %interleaved.vec = shufflevector <8 x i32> %[[CONCAT]], <8 x i32> undef, <8 x i32> <i32 0, i32 4, i32 1, i32 5, i32 2, i32 6, i32 3, i32 7>
+; CHECK: store <8 x i32> %interleaved.vec, <8 x i32>* %{{.*}}, align 4
+define void @store_pairs(i32* noalias nocapture %C, i32* noalias nocapture %Re,
+                         i32* noalias nocapture %Im) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %p.re = getelementptr inbounds i32* %Re, i64 %i
+  %re = load i32* %p.re, align 4
+  %p.im = getelementptr inbounds i32* %Im, i64 %i
+  %im = load i32* %p.im, align 4
+  %even = shl nsw i64 %i, 1
+  %p.even = getelementptr inbounds i32* %C, i64 %even
+  store i32 %re, i32* %p.even, align 4
+  %odd = or i64 %even, 1
+  %p.odd = getelementptr inbounds i32* %C, i64 %odd
+  store i32 %im, i32* %p.odd, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+
+; Only one of the two fields is stored, so the wide store would write the
+; other one; the stores stay scalar.
+
+; CHECK-LABEL: @store_gap(
+; CHECK-NOT: store <8 x i32>
+; CHECK: ret void
+define void @store_gap(i32* noalias nocapture %C, i32* noalias nocapture %Re) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %p.re = getelementptr inbounds i32* %Re, i64 %i
+  %re = load i32* %p.re, align 4
+  %even = shl nsw i64 %i, 1
+  %p.even = getelementptr inbounds i32* %C, i64 %even
+  store i32 %re, i32* %p.even, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, 1024
+  br i1 %done, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
@@ -0,0 +1,46 @@
+; RUN: opt < %s -loop-vectorize -vectorize-epilogue -force-vector-width=8 \
+; RUN:   -force-vector-unroll=2 -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -force-vector-width=8 -force-vector-unroll=2 \
+; RUN:   -S | FileCheck --check-prefix=DISABLED %s
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.8.0"
+
+; The remainder of the 8-wide loop is vectorized once more, four elements at
+; a time and without unrolling, before the scalar loop finishes the rest.
+
+; CHECK-LABEL: @add_one(
+; CHECK: vector.body:
+; CHECK: load <8 x i32>
+; CHECK: load <8 x i32>
+; CHECK: add nsw <8 x i32>
+; CHECK: vector.body{{[0-9]+}}:
+; CHECK: load <4 x i32>
+; CHECK-NOT: load <4 x i32>
+; CHECK: add nsw <4 x i32>
+; CHECK-NOT: <2 x i32>
+; CHECK: ret void
+
+; DISABLED-LABEL: @add_one(
+; DISABLED: load <8 x i32>
+; DISABLED-NOT: <4 x i32>
+; DISABLED: ret void
+define void @add_one(i32* noalias nocapture %a, i32 %n) {
+entry:
+  %cmp = icmp sgt i32 %n, 0
+  br i1 %cmp, label %for.body, label %for.end
+
+for.body:
+  %iv = phi i64 [ %iv.next, %for.body ], [ 0, %entry ]
+  %arrayidx = getelementptr inbounds i32* %a, i64 %iv
+  %0 = load i32* %arrayidx, align 4
+  %add = add nsw i32 %0, 1
+  store i32 %add, i32* %arrayidx, align 4
+  %iv.next = add i64 %iv, 1
+  %lftr.wideiv = trunc i64 %iv.next to i32
+  %exitcond = icmp eq i32 %lftr.wideiv, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
@@ -0,0 +1,49 @@
+; RUN: opt -S -mergefunc -stats < %s 2>&1 | FileCheck %s
+; REQUIRES: asserts
+
+; Functions of the same type and shape but with different instructions hash
+; differently, so only the two identical ones are compared in full.
+
+; CHECK-LABEL: define i32 @add(
+; CHECK: add i32
+; CHECK-LABEL: define i32 @sub(
+; CHECK: sub i32
+; CHECK-LABEL: define i32 @mul(
+; CHECK: mul i32
+; CHECK-LABEL: define i32 @xor(
+; CHECK: xor i32
+; CHECK-LABEL: define i32 @add2(
+; CHECK: tail call i32 @add(
+
+; CHECK: 1 mergefunc - Number of function pairs compared in full
+; CHECK: 1 mergefunc - Number of functions merged
+
+define i32 @add(i32 %a, i32 %b) {
+  %x = add i32 %a, %b
+  %y = add i32 %x, %b
+  ret i32 %y
+}
+
+define i32 @sub(i32 %a, i32 %b) {
+  %x = sub i32 %a, %b
+  %y = sub i32 %x, %b
+  ret i32 %y
+}
+
+define i32 @mul(i32 %a, i32 %b) {
+  %x = mul i32 %a, %b
+  %y = mul i32 %x, %b
+  ret i32 %y
+}
+
+define i32 @xor(i32 %a, i32 %b) {
+  %x = xor i32 %a, %b
+  %y = xor i32 %x, %b
+  ret i32 %y
+}
+
+define i32 @add2(i32 %a, i32 %b) {
+  %x = add i32 %a, %b
+  %y = add i32 %x, %b
+  ret i32 %y
+}
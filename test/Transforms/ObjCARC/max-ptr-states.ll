@@ -0,0 +1,39 @@
+; RUN: opt -basicaa -objc-arc -S < %s | FileCheck %s
+; RUN: opt -basicaa -objc-arc -arc-opt-max-ptr-states=0 -S < %s | FileCheck %s -check-prefix=LIMIT
+
+; Retain+release pairing gives up on a function once it tracks more pointers
+; than -arc-opt-max-ptr-states.
+
+target datalayout = "e-p:64:64:64"
+
+declare i8* @objc_retain(i8*)
+declare void @objc_release(i8*)
+
+; CHECK-LABEL: define void @test0(
+; CHECK-NOT: @objc_
+; CHECK: }
+; LIMIT-LABEL: define void @test0(
+; LIMIT: @objc_retain
+; LIMIT: @objc_release
+; LIMIT: }
+define void @test0(i32* %x, i1 %p) nounwind {
+entry:
+  %a = bitcast i32* %x to i8*
+  %0 = call i8* @objc_retain(i8* %a) nounwind
+  br i1 %p, label %t, label %f
+
+t:
+  store i8 3, i8* %a
+  br label %return
+
+f:
+  store i32 7, i32* %x
+  br label %return
+
+return:
+  %c = bitcast i32* %x to i8*
+  call void @objc_release(i8* %c) nounwind, !clang.imprecise_release !0
+  ret void
+}
+
+!0 = metadata !{}
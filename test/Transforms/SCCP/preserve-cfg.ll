@@ -0,0 +1,19 @@
+; RUN: opt < %s -domtree -sccp -memcpyopt -debug-pass=Structure \
+; RUN:   -disable-output 2>&1 | FileCheck %s
+
+; SCCP does not change the CFG, so the dominator tree built before it is
+; still available to MemCpyOpt.
+
+; CHECK: Dominator Tree Construction
+; CHECK: Sparse Conditional Constant Propagation
+; CHECK-NOT: Dominator Tree Construction
+; CHECK: MemCpy Optimization
+
+define i32 @f(i1 %c) {
+entry:
+  br i1 true, label %a, label %b
+a:
+  ret i32 1
+b:
+  ret i32 2
+}
@@ -415,3 +415,63 @@ for.body:
 for.end:
   ret void
 }
+
+; float dot8(float * restrict A, float * restrict B) {
+;   return A[0]*B[0] + A[1]*B[1] + A[2]*B[2] + A[3]*B[3] +
+;          A[4]*B[4] + A[5]*B[5] + A[6]*B[6] + A[7]*B[7];
+; }
+
+; NOSTORE-LABEL: dot8
+; NOSTORE: fmul <4 x float>
+; NOSTORE: shufflevector <4 x float>
+; NOSTORE: extractelement <4 x float>
+; NOSTORE: ret float
+define float @dot8(float* noalias %A, float* noalias %B) {
+entry:
+  %a0 = load float* %A, align 4
+  %b0 = load float* %B, align 4
+  %m0 = fmul fast float %a0, %b0
+  %pa1 = getelementptr inbounds float* %A, i64 1
+  %a1 = load float* %pa1, align 4
+  %pb1 = getelementptr inbounds float* %B, i64 1
+  %b1 = load float* %pb1, align 4
+  %m1 = fmul fast float %a1, %b1
+  %s1 = fadd fast float %m0, %m1
+  %pa2 = getelementptr inbounds float* %A, i64 2
+  %a2 = load float* %pa2, align 4
+  %pb2 = getelementptr inbounds float* %B, i64 2
+  %b2 = load float* %pb2, align 4
+  %m2 = fmul fast float %a2, %b2
+  %s2 = fadd fast float %s1, %m2
+  %pa3 = getelementptr inbounds float* %A, i64 3
+  %a3 = load float* %pa3, align 4
+  %pb3 = getelementptr inbounds float* %B, i64 3
+  %b3 = load float* %pb3, align 4
+  %m3 = fmul fast float %a3, %b3
+  %s3 = fadd fast float %s2, %m3
+  %pa4 = getelementptr inbounds float* %A, i64 4
+  %a4 = load float* %pa4, align 4
+  %pb4 = getelementptr inbounds float* %B, i64 4
+  %b4 = load float* %pb4, align 4
+  %m4 = fmul fast float %a4, %b4
+  %s4 = fadd fast float %s3, %m4
+  %pa5 = getelementptr inbounds float* %A, i64 5
+  %a5 = load float* %pa5, align 4
+  %pb5 = getelementptr inbounds float* %B, i64 5
+  %b5 = load float* %pb5, align 4
+  %m5 = fmul fast float %a5, %b5
+  %s5 = fadd fast float %s4, %m5
+  %pa6 = getelementptr inbounds float* %A, i64 6
+  %a6 = load float* %pa6, align 4
+  %pb6 = getelementptr inbounds float* %B, i64 6
+  %b6 = load float* %pb6, align 4
+  %m6 = fmul fast float %a6, %b6
+  %s6 = fadd fast float %s5, %m6
+  %pa7 = getelementptr inbounds float* %A, i64 7
+  %a7 = load float* %pa7, align 4
+  %pb7 = getelementptr inbounds float* %B, i64 7
+  %b7 = load float* %pb7, align 4
+  %m7 = fmul fast float %a7, %b7
+  %s7 = fadd fast float %s6, %m7
+  ret float %s7
+}
@@ -0,0 +1,44 @@
+; RUN: opt < %s -sroa -S | FileCheck %s
+; RUN: opt < %s -sroa -stats -disable-output 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=STATS
+; REQUIRES: asserts
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-n8:16:32:64"
+
+; STATS: 1 sroa - Number of allocas found to escape before building slices
+; STATS: {{[0-9]+}} sroa - Number of allocas whose slices needed no sorting
+
+declare void @use(i8*)
+
+; A buffer that is passed to a call is left alone.
+define i8 @escapes() {
+; CHECK-LABEL: @escapes(
+; CHECK: alloca [4096 x i8]
+entry:
+  %buf = alloca [4096 x i8]
+  %p = getelementptr [4096 x i8]* %buf, i64 0, i64 16
+  store i8 1, i8* %p
+  %b = bitcast [4096 x i8]* %buf to i8*
+  call void @use(i8* %b)
+  %v = load i8* %p
+  ret i8 %v
+}
+
+; Fields accessed one at a time are still split apart.
+%pair = type { i32, i32 }
+
+define i32 @fields(i32 %a, i32 %b) {
+; CHECK-LABEL: @fields(
+; CHECK-NOT: alloca
+; CHECK: add i32 %a, %b
+entry:
+  %s = alloca %pair
+  %f0 = getelementptr %pair* %s, i64 0, i32 0
+  %f1 = getelementptr %pair* %s, i64 0, i32 1
+  store i32 %a, i32* %f0
+  store i32 %b, i32* %f1
+  %x = load i32* %f0
+  %y = load i32* %f1
+  %r = add i32 %x, %y
+  ret i32 %r
+}
@@ -0,0 +1,25 @@
+; RUN: llvm-sampleprof %S/Inputs/branch.prof -o %t.bin
+; RUN: llvm-sampleprof -text %t.bin | FileCheck %s
+; RUN: llvm-sampleprof -text %S/Inputs/branch.prof %t.bin \
+; RUN:   | FileCheck %s -check-prefix=MERGED
+; RUN: not llvm-sampleprof %S/convert.ll -o %t.bad 2>&1 \
+; RUN:   | FileCheck %s -check-prefix=ERROR
+
+; Converting to the binary format and back keeps every sample.
+; CHECK: symbol table
+; CHECK-NEXT: 1
+; CHECK-NEXT: main
+; CHECK-NEXT: main:15680:0:7
+; CHECK-NEXT: 0: 0
+; CHECK-NEXT: 4: 0
+; CHECK-NEXT: 7: 0
+; CHECK-NEXT: 9: 10226
+; CHECK-NEXT: 10: 2243
+; CHECK-NEXT: 16: 0
+; CHECK-NEXT: 18: 0
+
+; Several inputs are merged.
+; MERGED: main:31360:0:7
+; MERGED: 9: 20452
+
+; ERROR: convert.ll:1: Expected 'symbol table', found ; RUN:
@@ -0,0 +1,38 @@
+; RUN: opt < %s -sample-profile \
+; RUN:   -sample-profile-file=%S/Inputs/indirect-call.prof -S | FileCheck %s
+; RUN: llvm-sampleprof %S/Inputs/indirect-call.prof -o %t.prof
+; RUN: opt < %s -sample-profile -sample-profile-file=%t.prof -S \
+; RUN:   | FileCheck %s
+; RUN: llvm-sampleprof -text %t.prof | FileCheck %s -check-prefix=TEXT
+
+; The profile records the targets of the indirect call on the first line of
+; @caller, as the profiler found them in the branches it sampled.
+
+define i32 @caller(i32 (i32)* %fp, i32 %x) {
+entry:
+; CHECK-LABEL: @caller(
+; CHECK: call i32 %fp(i32 %x), !dbg !{{[0-9]+}}, !prof [[TARGETS:![0-9]+]]
+  %r = call i32 %fp(i32 %x), !dbg !7
+  ret i32 %r, !dbg !8
+}
+
+; CHECK: [[TARGETS]] = metadata !{metadata !"indirect_call_targets", i64 1000, metadata !"callee_a", i64 700, metadata !"callee_b", i64 300}
+
+; The targets survive the binary format.
+; TEXT: caller:2000:0:2
+; TEXT-NEXT: 1: 1000 callee_a:700 callee_b:300
+; TEXT-NEXT: 2: 1000
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!9}
+
+!0 = metadata !{i32 786449, metadata !1, i32 12, metadata !"clang version 3.5", i1 true, metadata !"", i32 0, metadata !2, metadata !2, metadata !3, metadata !2, metadata !2, metadata !""} ; [ DW_TAG_compile_unit ] [./indirect-call.c] [DW_LANG_C99]
+!1 = metadata !{metadata !"indirect-call.c", metadata !"."}
+!2 = metadata !{i32 0}
+!3 = metadata !{metadata !4}
+!4 = metadata !{i32 786478, metadata !1, metadata !5, metadata !"caller", metadata !"caller", metadata !"", i32 2, metadata !6, i1 false, i1 true, i32 0, i32 0, null, i32 256, i1 true, i32 (i32 (i32)*, i32)* @caller, null, null, metadata !2, i32 2} ; [ DW_TAG_subprogram ] [line 2] [def] [caller]
+!5 = metadata !{i32 786473, metadata !1}          ; [ DW_TAG_file_type ] [./indirect-call.c]
+!6 = metadata !{i32 786453, i32 0, null, metadata !"", i32 0, i64 0, i64 0, i64 0, i32 0, null, metadata !2, i32 0, null, null, null} ; [ DW_TAG_subroutine_type ] [line 0, size 0, align 0, offset 0] [from ]
+!7 = metadata !{i32 3, i32 0, metadata !4, null}
+!8 = metadata !{i32 4, i32 0, metadata !4, null}
+!9 = metadata !{i32 2, metadata !"Dwarf Version", i32 4}
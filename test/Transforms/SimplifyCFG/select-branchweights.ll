@@ -0,0 +1,25 @@
+; RUN: opt -simplifycfg -S < %s | FileCheck %s
+
+; The select that replaces the diamond keeps the weights of its branch.
+; CHECK-LABEL: @fold(
+; CHECK: select i1 %cmp, i32 %add, i32 %sub, !prof !0
+; CHECK: !0 = metadata !{metadata !"branch_weights", i32 1, i32 2000}
+define i32 @fold(i32 %a, i32 %b, i32 %c) {
+entry:
+  %cmp = icmp slt i32 %a, %b
+  br i1 %cmp, label %if.then, label %if.else, !prof !0
+
+if.then:
+  %add = add nsw i32 %c, 3
+  br label %if.end
+
+if.else:
+  %sub = xor i32 %c, 7
+  br label %if.end
+
+if.end:
+  %r = phi i32 [ %add, %if.then ], [ %sub, %if.else ]
+  ret i32 %r
+}
+
+!0 = metadata !{metadata !"branch_weights", i32 1, i32 2000}
@@ -0,0 +1,85 @@
+; RUN: opt < %s -wholeprogramdevirt -S | FileCheck %s
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+%struct.A = type { i32 (...)** }
+
+; B derives from A, inheriting f and overriding g.
+@_ZTV1A = constant [4 x i8*] [i8* null, i8* null, i8* bitcast (i32 (%struct.A*)* @_ZN1A1fEv to i8*), i8* bitcast (i32 (%struct.A*)* @_ZN1A1gEv to i8*)]
+@_ZTV1B = constant [4 x i8*] [i8* null, i8* null, i8* bitcast (i32 (%struct.A*)* @_ZN1A1fEv to i8*), i8* bitcast (i32 (%struct.A*)* @_ZN1B1gEv to i8*)]
+
+; C is abstract, D implements h.
+@_ZTV1C = constant [3 x i8*] [i8* null, i8* null, i8* bitcast (void ()* @__cxa_pure_virtual to i8*)]
+@_ZTV1D = constant [3 x i8*] [i8* null, i8* null, i8* bitcast (i32 (%struct.A*)* @_ZN1D1hEv to i8*)]
+
+define i32 @_ZN1A1fEv(%struct.A* %this) {
+  ret i32 1
+}
+
+define i32 @_ZN1A1gEv(%struct.A* %this) {
+  ret i32 2
+}
+
+define i32 @_ZN1B1gEv(%struct.A* %this) {
+  ret i32 3
+}
+
+define i32 @_ZN1D1hEv(%struct.A* %this) {
+  ret i32 4
+}
+
+declare void @__cxa_pure_virtual()
+
+; A::f is the only f.
+; CHECK-LABEL: define i32 @call_f
+; CHECK: call i32 @_ZN1A1fEv(%struct.A* %a)
+define i32 @call_f(%struct.A* %a) {
+  %1 = bitcast %struct.A* %a to i32 (%struct.A*)***
+  %vtable = load i32 (%struct.A*)*** %1
+  %fp = load i32 (%struct.A*)** %vtable
+  %r = call i32 %fp(%struct.A* %a), !vcall !5
+  ret i32 %r
+}
+
+; g is overridden in B.
+; CHECK-LABEL: define i32 @call_g
+; CHECK: call i32 %fp(%struct.A* %a)
+define i32 @call_g(%struct.A* %a) {
+  %1 = bitcast %struct.A* %a to i32 (%struct.A*)***
+  %vtable = load i32 (%struct.A*)*** %1
+  %vfn = getelementptr inbounds i32 (%struct.A*)** %vtable, i64 1
+  %fp = load i32 (%struct.A*)** %vfn
+  %r = call i32 %fp(%struct.A* %a), !vcall !5
+  ret i32 %r
+}
+
+; The pure virtual slot of C is never called.
+; CHECK-LABEL: define i32 @call_h
+; CHECK: call i32 @_ZN1D1hEv(%struct.A* %a)
+define i32 @call_h(%struct.A* %a) {
+  %1 = bitcast %struct.A* %a to i32 (%struct.A*)***
+  %vtable = load i32 (%struct.A*)*** %1
+  %fp = load i32 (%struct.A*)** %vtable
+  %r = call i32 %fp(%struct.A* %a), !vcall !6
+  ret i32 %r
+}
+
+; Without !vcall nothing is known about the callee.
+; CHECK-LABEL: define i32 @call_unknown
+; CHECK: call i32 %fp(%struct.A* %a)
+define i32 @call_unknown(%struct.A* %a) {
+  %1 = bitcast %struct.A* %a to i32 (%struct.A*)***
+  %vtable = load i32 (%struct.A*)*** %1
+  %fp = load i32 (%struct.A*)** %vtable
+  %r = call i32 %fp(%struct.A* %a)
+  ret i32 %r
+}
+
+!llvm.vtables = !{!0, !1, !2, !3, !4}
+!0 = metadata !{metadata !"_ZTS1A", [4 x i8*]* @_ZTV1A, i64 16}
+!1 = metadata !{metadata !"_ZTS1A", [4 x i8*]* @_ZTV1B, i64 16}
+!2 = metadata !{metadata !"_ZTS1B", [4 x i8*]* @_ZTV1B, i64 16}
+!3 = metadata !{metadata !"_ZTS1C", [3 x i8*]* @_ZTV1C, i64 16}
+!4 = metadata !{metadata !"_ZTS1C", [3 x i8*]* @_ZTV1D, i64 16}
+!5 = metadata !{metadata !"_ZTS1A"}
+!6 = metadata !{metadata !"_ZTS1C"}
@@ -0,0 +1,16 @@
+; RUN: not llvm-as < %s -o /dev/null 2>&1 | FileCheck %s
+
+declare <4 x float> @llvm.gather.v4f32.v4f32(i8*, <4 x float>)
+declare <4 x float> @llvm.gather.v4f32.v8i32(i8*, <8 x i32>)
+
+define void @f(i8* %p, <4 x float> %fidx, <8 x i32> %idx) {
+entry:
+; CHECK: llvm.gather indices must be integers
+; CHECK-NEXT: @llvm.gather.v4f32.v4f32
+  call <4 x float> @llvm.gather.v4f32.v4f32(i8* %p, <4 x float> %fidx)
+
+; CHECK: llvm.gather needs one index per element
+; CHECK-NEXT: @llvm.gather.v4f32.v8i32
+  call <4 x float> @llvm.gather.v4f32.v8i32(i8* %p, <8 x i32> %idx)
+  ret void
+}
@@ -17,6 +17,7 @@
 #define BUGDRIVER_H
 
 #include "llvm/ADT/ValueMap.h"
+#include "llvm/Support/Program.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 #include <string>
 #include <vector>
@@ -43,6 +44,16 @@ extern bool DisableSimplifyCFG;
 ///
 extern bool BugpointIsInterrupted;
 
+/// PassesJob - A run of the optimizer started by BugDriver::startPasses and
+/// not yet waited for.
+///
+struct PassesJob {
+  sys::ProcessInfo PI;
+  std::string InputFilename;
+  std::string OutputFilename;
+  std::string ErrMsg;
+};
+
 class BugDriver {
   LLVMContext& Context;
   const char *ToolName;            // argv[0] of bugpoint
@@ -260,6 +271,24 @@ public:
                  std::string &OutputFilename, bool DeleteOutput = false,
                  bool Quiet = false, unsigned NumExtraArgs = 0,
                  const char * const *ExtraArgs = NULL) const;
+
+  /// startPasses - Start running the specified passes on Program in a child
+  /// process, as runPasses does, but return without waiting for the child.
+  /// Return true if the child could not be started, otherwise it must be
+  /// waited for with finishPasses.  Several children may run at once.
+  ///
+  bool startPasses(Module *Program,
+                   const std::vector<std::string> &PassesToRun,
+                   PassesJob &Job, unsigned NumExtraArgs = 0,
+                   const char * const *ExtraArgs = NULL) const;
+
+  /// finishPasses - Wait for the child started by startPasses and return true
+  /// if the passes failed, printing the same message as runPasses unless
+  /// Quiet is set.  If DeleteOutput is set to true, the bitcode is deleted on
+  /// success.
+  ///
+  bool finishPasses(PassesJob &Job, bool DeleteOutput = false,
+                    bool Quiet = false) const;
                  
   /// runManyPasses - Take the specified pass list and create different 
   /// combinations of passes to compile the program with. Compile the program with
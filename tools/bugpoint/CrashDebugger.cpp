@@ -14,6 +14,7 @@
 #include "BugDriver.h"
 #include "ListReducer.h"
 #include "ToolRunner.h"
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Analysis/Verifier.h"
 #include "llvm/IR/Constants.h"
@@ -42,6 +43,41 @@ namespace {
          cl::init(false));
 }
 
+namespace {
+  cl::opt<unsigned>
+  ParallelTests("parallel-tests",
+                cl::desc("Number of reductions of an optimizer crash to test "
+                         "at once"),
+                cl::init(1));
+}
+
+/// findFirstCrash - Run Passes[i] on Modules[i] for each i, all at once, and
+/// return the first i for which the passes crash, or Modules.size() if none
+/// do.  A null module is taken not to crash.
+static unsigned findFirstCrash(const BugDriver &BD, ArrayRef<Module*> Modules,
+                               ArrayRef<std::vector<std::string> > Passes) {
+  std::vector<PassesJob> Jobs(Modules.size());
+  std::vector<bool> Started(Modules.size());
+  unsigned First = Modules.size();
+  for (unsigned i = 0, e = Modules.size(); i != e; ++i) {
+    if (!Modules[i])
+      continue;
+    // Passes that can't even be started count as crashing, as in runPasses.
+    Started[i] = !BD.startPasses(Modules[i], Passes[i], Jobs[i]);
+    if (!Started[i] && First == e)
+      First = i;
+  }
+
+  for (unsigned i = 0, e = Modules.size(); i != e; ++i) {
+    if (!Started[i])
+      continue;
+    outs() << "[" << i + 1 << "] ";
+    if (BD.finishPasses(Jobs[i], true/*delete*/) && i < First)
+      First = i;
+  }
+  return First;
+}
+
 namespace llvm {
   class ReducePassList : public ListReducer<std::string> {
     BugDriver &BD;
@@ -55,6 +91,14 @@ namespace llvm {
     virtual TestResult doTest(std::vector<std::string> &Removed,
                               std::vector<std::string> &Kept,
                               std::string &Error);
+
+    virtual unsigned getNumParallelTests() const { return ParallelTests; }
+
+    // doTests - Run each list of passes on the program in its own child
+    // process, all at once.
+    //
+    virtual unsigned doTests(std::vector<std::vector<std::string> > &Candidates,
+                             std::string &Error);
   };
 }
 
@@ -97,36 +141,131 @@ ReducePassList::doTest(std::vector<std::string> &Prefix,
   return NoFailure;
 }
 
+unsigned
+ReducePassList::doTests(std::vector<std::vector<std::string> > &Candidates,
+                        std::string &Error) {
+  if (Candidates.size() == 1)
+    return ListReducer<std::string>::doTests(Candidates, Error);
+
+  std::vector<Module*> Modules(Candidates.size(), BD.getProgram());
+  for (unsigned i = 0, e = Candidates.size(); i != e; ++i)
+    outs() << "[" << i + 1 << "] Checking to see if these passes crash: "
+           << getPassesString(Candidates[i]) << "\n";
+  return findFirstCrash(BD, Modules, Candidates);
+}
+
+static bool TestForOptimizerCrash(const BugDriver &BD, Module *M);
+
 namespace {
-  /// ReduceCrashingGlobalVariables - This works by removing the global
-  /// variable's initializer and seeing if the program still crashes. If it
-  /// does, then we keep that program and try again.
+  /// ReduceCrashingList - The part the reducers below have in common.  Each of
+  /// them trims a clone of the program down to a list of its contents and
+  /// sees if the program still crashes.  If it does, the clone becomes the
+  /// program.
   ///
-  class ReduceCrashingGlobalVariables : public ListReducer<GlobalVariable*> {
+  template<typename ElTy>
+  class ReduceCrashingList : public ListReducer<ElTy> {
+  protected:
     BugDriver &BD;
     bool (*TestFn)(const BugDriver &, Module *);
-  public:
-    ReduceCrashingGlobalVariables(BugDriver &bd,
-                                  bool (*testFn)(const BugDriver &, Module *))
+
+    ReduceCrashingList(BugDriver &bd,
+                       bool (*testFn)(const BugDriver &, Module *))
       : BD(bd), TestFn(testFn) {}
 
-    virtual TestResult doTest(std::vector<GlobalVariable*> &Prefix,
-                              std::vector<GlobalVariable*> &Kept,
+    /// buildTestModule - Return a clone of the program trimmed down to List,
+    /// after printing what is being checked, and set NewList to the elements
+    /// of List in the clone.  Return null if List need not be tested.
+    virtual Module *buildTestModule(const std::vector<ElTy> &List,
+                                    std::vector<ElTy> &NewList) = 0;
+
+  public:
+    typedef typename ListReducer<ElTy>::TestResult TestResult;
+
+    virtual TestResult doTest(std::vector<ElTy> &Prefix,
+                              std::vector<ElTy> &Kept,
                               std::string &Error) {
-      if (!Kept.empty() && TestGlobalVariables(Kept))
-        return KeepSuffix;
-      if (!Prefix.empty() && TestGlobalVariables(Prefix))
-        return KeepPrefix;
-      return NoFailure;
+      if (!Kept.empty() && TestList(Kept))
+        return ListReducer<ElTy>::KeepSuffix;
+      if (!Prefix.empty() && TestList(Prefix))
+        return ListReducer<ElTy>::KeepPrefix;
+      return ListReducer<ElTy>::NoFailure;
+    }
+
+    /// TestList - See if the program still crashes when trimmed down to List.
+    /// If it does, keep the trimmed version, and update List to refer to it.
+    bool TestList(std::vector<ElTy> &List) {
+      std::vector<ElTy> NewList;
+      Module *M = buildTestModule(List, NewList);
+      if (!M)
+        return false;
+
+      // Try running the hacked up program...
+      if (TestFn(BD, M)) {
+        BD.setNewProgram(M);      // It crashed, keep the trimmed version...
+        List.swap(NewList);
+        return true;
+      }
+      delete M;  // It didn't crash, try something else.
+      return false;
+    }
+
+    // Only the optimizer runs in a child process that can be started several
+    // times at once.
+    virtual unsigned getNumParallelTests() const {
+      return TestFn == TestForOptimizerCrash ? unsigned(ParallelTests) : 1;
     }
 
-    bool TestGlobalVariables(std::vector<GlobalVariable*> &GVs);
+    virtual unsigned doTests(std::vector<std::vector<ElTy> > &Candidates,
+                             std::string &Error) {
+      if (Candidates.size() == 1)
+        return ListReducer<ElTy>::doTests(Candidates, Error);
+
+      unsigned NumCandidates = Candidates.size();
+      std::vector<Module*> Modules(NumCandidates);
+      std::vector<std::vector<ElTy> > NewLists(NumCandidates);
+      for (unsigned i = 0; i != NumCandidates; ++i) {
+        outs() << "[" << i + 1 << "] ";
+        Modules[i] = buildTestModule(Candidates[i], NewLists[i]);
+        outs() << "\n";
+      }
+
+      std::vector<std::vector<std::string> >
+        Passes(NumCandidates, BD.getPassesToRun());
+      unsigned Crashed = findFirstCrash(BD, Modules, Passes);
+      for (unsigned i = 0; i != NumCandidates; ++i)
+        if (i != Crashed)
+          delete Modules[i];
+      if (Crashed != NumCandidates) {
+        BD.setNewProgram(Modules[Crashed]);
+        Candidates[Crashed].swap(NewLists[Crashed]);
+      }
+      return Crashed;
+    }
   };
 }
 
-bool
-ReduceCrashingGlobalVariables::TestGlobalVariables(
-                              std::vector<GlobalVariable*> &GVs) {
+namespace {
+  /// ReduceCrashingGlobalVariables - This works by removing the global
+  /// variable's initializer and seeing if the program still crashes. If it
+  /// does, then we keep that program and try again.
+  ///
+  class ReduceCrashingGlobalVariables
+    : public ReduceCrashingList<GlobalVariable*> {
+  public:
+    ReduceCrashingGlobalVariables(BugDriver &bd,
+                                  bool (*testFn)(const BugDriver &, Module *))
+      : ReduceCrashingList<GlobalVariable*>(bd, testFn) {}
+
+  protected:
+    virtual Module *buildTestModule(const std::vector<GlobalVariable*> &GVs,
+                                    std::vector<GlobalVariable*> &NewGVs);
+  };
+}
+
+Module *
+ReduceCrashingGlobalVariables::buildTestModule(
+                              const std::vector<GlobalVariable*> &GVs,
+                              std::vector<GlobalVariable*> &NewGVs) {
   // Clone the program to try hacking it apart...
   ValueToValueMapTy VMap;
   Module *M = CloneModule(BD.getProgram(), VMap);
@@ -153,18 +292,9 @@ ReduceCrashingGlobalVariables::TestGlobalVariables(
       I->setLinkage(GlobalValue::ExternalLinkage);
     }
 
-  // Try running the hacked up program...
-  if (TestFn(BD, M)) {
-    BD.setNewProgram(M);        // It crashed, keep the trimmed version...
-
-    // Make sure to use global variable pointers that point into the now-current
-    // module.
-    GVs.assign(GVSet.begin(), GVSet.end());
-    return true;
-  }
-
-  delete M;
-  return false;
+  // Make sure to use global variable pointers that point into the new module.
+  NewGVs.assign(GVSet.begin(), GVSet.end());
+  return M;
 }
 
 namespace {
@@ -172,34 +302,26 @@ namespace {
   /// seeing if the program still crashes. If it does, then keep the newer,
   /// smaller program.
   ///
-  class ReduceCrashingFunctions : public ListReducer<Function*> {
-    BugDriver &BD;
-    bool (*TestFn)(const BugDriver &, Module *);
+  class ReduceCrashingFunctions : public ReduceCrashingList<Function*> {
   public:
     ReduceCrashingFunctions(BugDriver &bd,
                             bool (*testFn)(const BugDriver &, Module *))
-      : BD(bd), TestFn(testFn) {}
+      : ReduceCrashingList<Function*>(bd, testFn) {}
 
-    virtual TestResult doTest(std::vector<Function*> &Prefix,
-                              std::vector<Function*> &Kept,
-                              std::string &Error) {
-      if (!Kept.empty() && TestFuncs(Kept))
-        return KeepSuffix;
-      if (!Prefix.empty() && TestFuncs(Prefix))
-        return KeepPrefix;
-      return NoFailure;
-    }
-
-    bool TestFuncs(std::vector<Function*> &Prefix);
+  protected:
+    virtual Module *buildTestModule(const std::vector<Function*> &Funcs,
+                                    std::vector<Function*> &NewFuncs);
   };
 }
 
-bool ReduceCrashingFunctions::TestFuncs(std::vector<Function*> &Funcs) {
+Module *
+ReduceCrashingFunctions::buildTestModule(const std::vector<Function*> &Funcs,
+                                         std::vector<Function*> &NewFuncs) {
   // If main isn't present, claim there is no problem.
   if (KeepMain && std::find(Funcs.begin(), Funcs.end(),
                             BD.getProgram()->getFunction("main")) ==
                       Funcs.end())
-    return false;
+    return 0;
 
   // Clone the program to try hacking it apart...
   ValueToValueMapTy VMap;
@@ -225,17 +347,9 @@ bool ReduceCrashingFunctions::TestFuncs(std::vector<Function*> &Funcs) {
     if (!I->isDeclaration() && !Functions.count(I))
       DeleteFunctionBody(I);
 
-  // Try running the hacked up program...
-  if (TestFn(BD, M)) {
-    BD.setNewProgram(M);        // It crashed, keep the trimmed version...
-
-    // Make sure to use function pointers that point into the now-current
-    // module.
-    Funcs.assign(Functions.begin(), Functions.end());
-    return true;
-  }
-  delete M;
-  return false;
+  // Make sure to use function pointers that point into the new module.
+  NewFuncs.assign(Functions.begin(), Functions.end());
+  return M;
 }
 
 
@@ -245,29 +359,21 @@ namespace {
   /// then running the simplify-cfg pass.  This has the effect of chopping up
   /// the CFG really fast which can reduce large functions quickly.
   ///
-  class ReduceCrashingBlocks : public ListReducer<const BasicBlock*> {
-    BugDriver &BD;
-    bool (*TestFn)(const BugDriver &, Module *);
+  class ReduceCrashingBlocks : public ReduceCrashingList<const BasicBlock*> {
   public:
     ReduceCrashingBlocks(BugDriver &bd,
                          bool (*testFn)(const BugDriver &, Module *))
-      : BD(bd), TestFn(testFn) {}
+      : ReduceCrashingList<const BasicBlock*>(bd, testFn) {}
 
-    virtual TestResult doTest(std::vector<const BasicBlock*> &Prefix,
-                              std::vector<const BasicBlock*> &Kept,
-                              std::string &Error) {
-      if (!Kept.empty() && TestBlocks(Kept))
-        return KeepSuffix;
-      if (!Prefix.empty() && TestBlocks(Prefix))
-        return KeepPrefix;
-      return NoFailure;
-    }
-
-    bool TestBlocks(std::vector<const BasicBlock*> &Prefix);
+  protected:
+    virtual Module *buildTestModule(const std::vector<const BasicBlock*> &BBs,
+                                    std::vector<const BasicBlock*> &NewBBs);
   };
 }
 
-bool ReduceCrashingBlocks::TestBlocks(std::vector<const BasicBlock*> &BBs) {
+Module *
+ReduceCrashingBlocks::buildTestModule(const std::vector<const BasicBlock*> &BBs,
+                                      std::vector<const BasicBlock*> &NewBBs) {
   // Clone the program to try hacking it apart...
   ValueToValueMapTy VMap;
   Module *M = CloneModule(BD.getProgram(), VMap);
@@ -329,55 +435,41 @@ bool ReduceCrashingBlocks::TestBlocks(std::vector<const BasicBlock*> &BBs) {
   }
   M = New;
 
-  // Try running on the hacked up program...
-  if (TestFn(BD, M)) {
-    BD.setNewProgram(M);      // It crashed, keep the trimmed version...
-
-    // Make sure to use basic block pointers that point into the now-current
-    // module, and that they don't include any deleted blocks.
-    BBs.clear();
-    const ValueSymbolTable &GST = M->getValueSymbolTable();
-    for (unsigned i = 0, e = BlockInfo.size(); i != e; ++i) {
-      Function *F = cast<Function>(GST.lookup(BlockInfo[i].first));
-      ValueSymbolTable &ST = F->getValueSymbolTable();
-      Value* V = ST.lookup(BlockInfo[i].second);
-      if (V && V->getType() == Type::getLabelTy(V->getContext()))
-        BBs.push_back(cast<BasicBlock>(V));
-    }
-    return true;
+  // Make sure to use basic block pointers that point into the new module, and
+  // that they don't include any deleted blocks.
+  const ValueSymbolTable &GST = M->getValueSymbolTable();
+  for (unsigned i = 0, e = BlockInfo.size(); i != e; ++i) {
+    Function *F = cast<Function>(GST.lookup(BlockInfo[i].first));
+    ValueSymbolTable &ST = F->getValueSymbolTable();
+    Value* V = ST.lookup(BlockInfo[i].second);
+    if (V && V->getType() == Type::getLabelTy(V->getContext()))
+      NewBBs.push_back(cast<BasicBlock>(V));
   }
-  delete M;  // It didn't crash, try something else.
-  return false;
+  return M;
 }
 
 namespace {
   /// ReduceCrashingInstructions reducer - This works by removing the specified
   /// non-terminator instructions and replacing them with undef.
   ///
-  class ReduceCrashingInstructions : public ListReducer<const Instruction*> {
-    BugDriver &BD;
-    bool (*TestFn)(const BugDriver &, Module *);
+  class ReduceCrashingInstructions
+    : public ReduceCrashingList<const Instruction*> {
   public:
     ReduceCrashingInstructions(BugDriver &bd,
                                bool (*testFn)(const BugDriver &, Module *))
-      : BD(bd), TestFn(testFn) {}
+      : ReduceCrashingList<const Instruction*>(bd, testFn) {}
 
-    virtual TestResult doTest(std::vector<const Instruction*> &Prefix,
-                              std::vector<const Instruction*> &Kept,
-                              std::string &Error) {
-      if (!Kept.empty() && TestInsts(Kept))
-        return KeepSuffix;
-      if (!Prefix.empty() && TestInsts(Prefix))
-        return KeepPrefix;
-      return NoFailure;
-    }
-
-    bool TestInsts(std::vector<const Instruction*> &Prefix);
+  protected:
+    virtual Module *
+    buildTestModule(const std::vector<const Instruction*> &Insts,
+                    std::vector<const Instruction*> &NewInsts);
   };
 }
 
-bool ReduceCrashingInstructions::TestInsts(std::vector<const Instruction*>
-                                           &Insts) {
+Module *
+ReduceCrashingInstructions::buildTestModule(
+                                   const std::vector<const Instruction*> &Insts,
+                                   std::vector<const Instruction*> &NewInsts) {
   // Clone the program to try hacking it apart...
   ValueToValueMapTy VMap;
   Module *M = CloneModule(BD.getProgram(), VMap);
@@ -412,20 +504,11 @@ bool ReduceCrashingInstructions::TestInsts(std::vector<const Instruction*>
   Passes.add(createVerifierPass());
   Passes.run(*M);
 
-  // Try running on the hacked up program...
-  if (TestFn(BD, M)) {
-    BD.setNewProgram(M);      // It crashed, keep the trimmed version...
-
-    // Make sure to use instruction pointers that point into the now-current
-    // module, and that they don't include any deleted blocks.
-    Insts.clear();
-    for (SmallPtrSet<Instruction*, 64>::const_iterator I = Instructions.begin(),
-             E = Instructions.end(); I != E; ++I)
-      Insts.push_back(*I);
-    return true;
-  }
-  delete M;  // It didn't crash, try something else.
-  return false;
+  // Make sure to use instruction pointers that point into the new module.
+  for (SmallPtrSet<Instruction*, 64>::const_iterator I = Instructions.begin(),
+           E = Instructions.end(); I != E; ++I)
+    NewInsts.push_back(*I);
+  return M;
 }
 
 /// DebugACrash - Given a predicate that determines whether a component crashes
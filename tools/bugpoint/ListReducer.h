@@ -45,6 +45,29 @@ struct ListReducer {
                             std::vector<ElTy> &Kept,
                             std::string &Error) = 0;
 
+  // getNumParallelTests - Return the number of lists doTests may be given at
+  // once.
+  //
+  virtual unsigned getNumParallelTests() const { return 1; }
+
+  // doTests - Test each of the Candidates on its own, as doTest would with an
+  // empty prefix, and return the index of the first one that still satisfies
+  // the property, or Candidates.size() if none does.  Only that one may be
+  // updated by the test.  Subclasses whose test runs in a child process can
+  // override this to run the tests concurrently.
+  //
+  virtual unsigned doTests(std::vector<std::vector<ElTy> > &Candidates,
+                           std::string &Error) {
+    std::vector<ElTy> EmptyList;
+    for (unsigned i = 0, e = Candidates.size(); i != e; ++i) {
+      if (doTest(EmptyList, Candidates[i], Error) == KeepSuffix)
+        return i;
+      if (!Error.empty())
+        break;
+    }
+    return Candidates.size();
+  }
+
   // reduceList - This function attempts to reduce the length of the specified
   // list while still maintaining the "test" property.  This is the core of the
   // "work" that bugpoint does.
@@ -156,7 +179,6 @@ Backjump:
     //
     if (TheList.size() > 2) {
       bool Changed = true;
-      std::vector<ElTy> EmptyList;
       while (Changed) {  // Trimming loop.
         Changed = false;
         
@@ -168,23 +190,35 @@ Backjump:
         if (std::rand() % 100 < BackjumpProbability)
           goto Backjump;
         
-        for (unsigned i = 1; i < TheList.size()-1; ++i) { // Check interior elts
+        for (unsigned i = 1; i < TheList.size()-1; ) { // Check interior elts
           if (BugpointIsInterrupted) {
             errs() << "\n\n*** Reduction Interrupted, cleaning up...\n\n";
             return true;
           }
-          
-          std::vector<ElTy> TestList(TheList);
-          TestList.erase(TestList.begin()+i);
-
-          if (doTest(EmptyList, TestList, Error) == KeepSuffix) {
-            // We can trim down the list!
-            TheList.swap(TestList);
-            --i;  // Don't skip an element of the list
-            Changed = true;
-          }
+
+          // Try deleting each of the next few elements on its own, and keep
+          // the first deletion that still satisfies the property.  This
+          // gives the same list as trying them one after the other.
+          unsigned NumTests = std::min(getNumParallelTests(),
+                                       unsigned(TheList.size()-1-i));
+          NumTests = std::max(NumTests, 1U);
+          std::vector<std::vector<ElTy> > TestLists(NumTests, TheList);
+          for (unsigned j = 0; j != NumTests; ++j)
+            TestLists[j].erase(TestLists[j].begin()+i+j);
+
+          unsigned Kept = doTests(TestLists, Error);
           if (!Error.empty())
             return true;
+          if (Kept == NumTests) {
+            i += NumTests;
+            continue;
+          }
+
+          // We can trim down the list!  Don't skip the element after the one
+          // that was deleted.
+          TheList.swap(TestLists[Kept]);
+          i += Kept;
+          Changed = true;
         }
         // This can take a long time if left uncontrolled.  For now, don't
         // iterate.
@@ -124,6 +124,21 @@ bool BugDriver::runPasses(Module *Program,
                           std::string &OutputFilename, bool DeleteOutput,
                           bool Quiet, unsigned NumExtraArgs,
                           const char * const *ExtraArgs) const {
+  PassesJob Job;
+  if (startPasses(Program, Passes, Job, NumExtraArgs, ExtraArgs))
+    return true;
+  OutputFilename = Job.OutputFilename;
+  return finishPasses(Job, DeleteOutput, Quiet);
+}
+
+/// startPasses - Write Program to a temporary file and start opt on it with
+/// the specified passes, without waiting for it to finish.  Return true if
+/// opt could not be started.
+///
+bool BugDriver::startPasses(Module *Program,
+                            const std::vector<std::string> &Passes,
+                            PassesJob &Job, unsigned NumExtraArgs,
+                            const char * const *ExtraArgs) const {
   // setup the output file name
   outs().flush();
   SmallString<128> UniqueFilename;
@@ -134,7 +149,7 @@ bool BugDriver::runPasses(Module *Program,
            << EC.message() << "\n";
     return 1;
   }
-  OutputFilename = UniqueFilename.str();
+  Job.OutputFilename = UniqueFilename.str();
 
   // set up the input file name
   SmallString<128> InputFilename;
@@ -165,6 +180,7 @@ bool BugDriver::runPasses(Module *Program,
 
   // Ok, everything that could go wrong before running opt is done.
   InFile.keep();
+  Job.InputFilename = InputFilename.str();
 
   // setup the child process' arguments
   SmallVector<const char*, 8> Args;
@@ -177,7 +193,7 @@ bool BugDriver::runPasses(Module *Program,
     Args.push_back(tool.c_str());
 
   Args.push_back("-o");
-  Args.push_back(OutputFilename.c_str());
+  Args.push_back(Job.OutputFilename.c_str());
   for (unsigned i = 0, e = OptArgs.size(); i != e; ++i)
     Args.push_back(OptArgs[i].c_str());
   std::vector<std::string> pass_args;
@@ -191,7 +207,7 @@ bool BugDriver::runPasses(Module *Program,
   for (std::vector<std::string>::const_iterator I = pass_args.begin(),
        E = pass_args.end(); I != E; ++I )
     Args.push_back(I->c_str());
-  Args.push_back(InputFilename.c_str());
+  Args.push_back(Job.InputFilename.c_str());
   for (unsigned i = 0; i < NumExtraArgs; ++i)
     Args.push_back(*ExtraArgs);
   Args.push_back(0);
@@ -212,18 +228,29 @@ bool BugDriver::runPasses(Module *Program,
   StringRef Nowhere;
   const StringRef *Redirects[3] = {0, &Nowhere, &Nowhere};
 
-  std::string ErrMsg;
-  int result = sys::ExecuteAndWait(Prog, Args.data(), 0,
-                                   (SilencePasses ? Redirects : 0), Timeout,
-                                   MemoryLimit, &ErrMsg);
+  // A child that can't be started is reported by finishPasses.
+  Job.PI = sys::ExecuteNoWait(Prog, Args.data(), 0,
+                              (SilencePasses ? Redirects : 0), MemoryLimit,
+                              &Job.ErrMsg);
+  return false;
+}
+
+/// finishPasses - Wait for the opt started by startPasses, then clean up its
+/// input file, and its output file too if it failed or DeleteOutput is set.
+///
+bool BugDriver::finishPasses(PassesJob &Job, bool DeleteOutput,
+                             bool Quiet) const {
+  int result = -1;
+  if (Job.PI.Pid != 0)
+    result = sys::Wait(Job.PI, Timeout, true, &Job.ErrMsg).ReturnCode;
 
   // If we are supposed to delete the bitcode file or if the passes crashed,
   // remove it now.  This may fail if the file was never created, but that's ok.
   if (DeleteOutput || result != 0)
-    sys::fs::remove(OutputFilename);
+    sys::fs::remove(Job.OutputFilename);
 
   // Remove the temporary input file as well
-  sys::fs::remove(InputFilename.c_str());
+  sys::fs::remove(Job.InputFilename);
 
   if (!Quiet) {
     if (result == 0)
@@ -232,9 +259,9 @@ bool BugDriver::runPasses(Module *Program,
       outs() << "Exited with error code '" << result << "'\n";
     else if (result < 0) {
       if (result == -1)
-        outs() << "Execute failed: " << ErrMsg << "\n";
+        outs() << "Execute failed: " << Job.ErrMsg << "\n";
       else
-        outs() << "Crashed: " << ErrMsg << "\n";
+        outs() << "Crashed: " << Job.ErrMsg << "\n";
     }
     if (result & 0x01000000)
       outs() << "Dumped core\n";
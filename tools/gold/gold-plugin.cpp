@@ -80,6 +80,11 @@ namespace options {
   static std::string extra_library_path;
   static std::string triple;
   static std::string mcpu;
+  // Number of partitions, compiled in parallel, the merged module is split
+  // into for code generation.
+  static unsigned jobs = 1;
+  // Directory to cache the object files of partitions in, if any.
+  static std::string cache_dir;
   // Additional options to pass into the code generator.
   // Note: This array will contain all plugin options which are not claimed
   // as plugin exclusive to pass to the code generator.
@@ -99,6 +104,13 @@ namespace options {
       mcpu = opt.substr(strlen("mcpu="));
     } else if (opt.startswith("extra-library-path=")) {
       extra_library_path = opt.substr(strlen("extra_library_path="));
+    } else if (opt.startswith("jobs=")) {
+      if (opt.substr(strlen("jobs=")).getAsInteger(10, jobs) || jobs == 0) {
+        (*message)(LDPL_WARNING, "Invalid number of jobs: %s", opt_);
+        jobs = 1;
+      }
+    } else if (opt.startswith("cache-dir=")) {
+      cache_dir = opt.substr(strlen("cache-dir="));
     } else if (opt.startswith("mtriple=")) {
       triple = opt.substr(strlen("mtriple="));
     } else if (opt.startswith("obj-path=")) {
@@ -442,13 +454,17 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  std::string ObjPath;
+  std::vector<std::string> ObjPaths;
   {
-    const char *Temp;
-    if (lto_codegen_compile_to_file(code_gen, &Temp)) {
+    const char **Temp;
+    unsigned NumFiles = 0;
+    lto_codegen_set_parallelism(code_gen, options::jobs);
+    if (!options::cache_dir.empty())
+      lto_codegen_set_cache_dir(code_gen, options::cache_dir.c_str());
+    if (lto_codegen_compile_to_files(code_gen, &Temp, &NumFiles)) {
       (*message)(LDPL_ERROR, "Could not produce a combined object file\n");
     }
-    ObjPath = Temp;
+    ObjPaths.assign(Temp, Temp + NumFiles);
   }
 
   lto_codegen_dispose(code_gen);
@@ -460,10 +476,12 @@ static ld_plugin_status all_symbols_read_hook(void) {
     }
   }
 
-  if ((*add_input_file)(ObjPath.c_str()) != LDPS_OK) {
-    (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
-    (*message)(LDPL_ERROR, "File left behind in: %s", ObjPath.c_str());
-    return LDPS_ERR;
+  for (unsigned i = 0, e = ObjPaths.size(); i != e; ++i) {
+    if ((*add_input_file)(ObjPaths[i].c_str()) != LDPS_OK) {
+      (*message)(LDPL_ERROR, "Unable to add .o file to the link.");
+      (*message)(LDPL_ERROR, "File left behind in: %s", ObjPaths[i].c_str());
+      return LDPS_ERR;
+    }
   }
 
   if (!options::extra_library_path.empty() &&
@@ -473,7 +491,7 @@ static ld_plugin_status all_symbols_read_hook(void) {
   }
 
   if (options::obj_path.empty())
-    Cleanup.push_back(ObjPath);
+    Cleanup.insert(Cleanup.end(), ObjPaths.begin(), ObjPaths.end());
 
   return LDPS_OK;
 }
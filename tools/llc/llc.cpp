@@ -15,13 +15,16 @@
 
 
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Assembly/PrintModulePass.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/CodeGen/LinkAllAsmWriterComponents.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassTimingReport.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/MC/SubtargetFeature.h"
 #include "llvm/Pass.h"
@@ -31,15 +34,19 @@
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PluginLoader.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Target/TargetLibraryInfo.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/SplitModule.h"
 #include <memory>
 using namespace llvm;
 
@@ -78,7 +85,21 @@ DisableSimplifyLibCalls("disable-simplify-libcalls",
                         cl::desc("Disable simplify-libcalls"),
                         cl::init(false));
 
+static cl::opt<unsigned>
+Threads("threads", cl::init(1), cl::value_desc("N"),
+        cl::desc("Split the module into N partitions and compile them on N "
+                 "threads into separate output files"));
+
+static cl::opt<std::string>
+PassTimingReportFile("pass-timing-report", cl::value_desc("filename"),
+                     cl::desc("Write the time and memory of each pass on each "
+                              "function to a YAML file"));
+
 static int compileModule(char**, LLVMContext&);
+static void configureTargetMachine(TargetMachine &, const Triple &,
+                                   const char *);
+static int emitModule(Module &, TargetMachine &, raw_ostream &, const char *);
+static int compileModuleInParallel(Module &, TargetMachine &, const char *);
 
 // GetFileNameRoot - Helper function to get the basename of a filename.
 static inline std::string
@@ -191,12 +212,31 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm system compiler\n");
 
+  OwningPtr<PassTimingReport> Report;
+  if (!PassTimingReportFile.empty()) {
+    Report.reset(new PassTimingReport());
+    addPassInstrumentation(Report.get());
+  }
+
   // Compile the module TimeCompilations times to give better compile time
   // metrics.
-  for (unsigned I = TimeCompilations; I; --I)
-    if (int RetVal = compileModule(argv, Context))
-      return RetVal;
-  return 0;
+  int RetVal = 0;
+  for (unsigned I = TimeCompilations; I && !RetVal; --I)
+    RetVal = compileModule(argv, Context);
+
+  if (Report) {
+    removePassInstrumentation(Report.get());
+    std::string ErrorInfo;
+    tool_output_file ReportOut(PassTimingReportFile.c_str(), ErrorInfo,
+                               sys::fs::F_None);
+    if (!ErrorInfo.empty()) {
+      errs() << argv[0] << ": " << ErrorInfo << '\n';
+      return 1;
+    }
+    Report->writeYAML(ReportOut.os());
+    ReportOut.keep();
+  }
+  return RetVal;
 }
 
 static int compileModule(char **argv, LLVMContext &Context) {
@@ -279,6 +319,7 @@ static int compileModule(char **argv, LLVMContext &Context) {
   Options.PositionIndependentExecutable = EnablePIE;
   Options.EnableSegmentedStacks = SegmentedStacks;
   Options.UseInitArray = UseInitArray;
+  Options.CompressDebugSections = CompressDebugSections;
 
   OwningPtr<TargetMachine>
     target(TheTarget->createTargetMachine(TheTriple.getTriple(),
@@ -287,7 +328,33 @@ static int compileModule(char **argv, LLVMContext &Context) {
   assert(target.get() && "Could not allocate target machine!");
   assert(mod && "Should have exited after outputting help!");
   TargetMachine &Target = *target.get();
+  configureTargetMachine(Target, TheTriple, argv[0]);
+
+  if (Threads > 1)
+    return compileModuleInParallel(*mod, Target, argv[0]);
+
+  // Figure out where we are going to send the output.
+  OwningPtr<tool_output_file> Out
+    (GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]));
+  if (!Out) return 1;
+
+  // Before executing passes, print the final values of the LLVM options.
+  cl::PrintOptionValues();
+
+  if (int RetVal = emitModule(*mod, Target, Out->os(), argv[0]))
+    return RetVal;
+
+  // Declare success.
+  Out->keep();
+
+  return 0;
+}
 
+/// configureTargetMachine - Apply the code generation options that aren't
+/// part of the TargetOptions to Target.
+static void configureTargetMachine(TargetMachine &Target,
+                                   const Triple &TheTriple,
+                                   const char *ProgName) {
   if (DisableDotLoc)
     Target.setMCUseLoc(false);
 
@@ -305,16 +372,27 @@ static int compileModule(char **argv, LLVMContext &Context) {
       TheTriple.isMacOSXVersionLT(10, 6))
     Target.setMCUseLoc(false);
 
-  // Figure out where we are going to send the output.
-  OwningPtr<tool_output_file> Out
-    (GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]));
-  if (!Out) return 1;
+  // Override default to generate verbose assembly.
+  Target.setAsmVerbosityDefault(true);
 
+  if (RelaxAll) {
+    if (FileType != TargetMachine::CGFT_ObjectFile)
+      errs() << ProgName
+             << ": warning: ignoring -mc-relax-all because filetype != obj";
+    else
+      Target.setMCRelaxAll(true);
+  }
+}
+
+/// emitModule - Run the code generator for Target on M, writing the output
+/// to Out.
+static int emitModule(Module &M, TargetMachine &Target, raw_ostream &Out,
+                      const char *ProgName) {
   // Build up all of the passes that we want to do to the module.
   PassManager PM;
 
   // Add an appropriate TargetLibraryInfo pass for the module's triple.
-  TargetLibraryInfo *TLI = new TargetLibraryInfo(TheTriple);
+  TargetLibraryInfo *TLI = new TargetLibraryInfo(Triple(M.getTargetTriple()));
   if (DisableSimplifyLibCalls)
     TLI->disableAllFunctions();
   PM.add(TLI);
@@ -326,58 +404,155 @@ static int compileModule(char **argv, LLVMContext &Context) {
   if (const DataLayout *TD = Target.getDataLayout())
     PM.add(new DataLayout(*TD));
   else
-    PM.add(new DataLayout(mod));
+    PM.add(new DataLayout(&M));
 
-  // Override default to generate verbose assembly.
-  Target.setAsmVerbosityDefault(true);
+  formatted_raw_ostream FOS(Out);
 
-  if (RelaxAll) {
-    if (FileType != TargetMachine::CGFT_ObjectFile)
-      errs() << argv[0]
-             << ": warning: ignoring -mc-relax-all because filetype != obj";
-    else
-      Target.setMCRelaxAll(true);
-  }
-
-  {
-    formatted_raw_ostream FOS(Out->os());
-
-    AnalysisID StartAfterID = 0;
-    AnalysisID StopAfterID = 0;
-    const PassRegistry *PR = PassRegistry::getPassRegistry();
-    if (!StartAfter.empty()) {
-      const PassInfo *PI = PR->getPassInfo(StartAfter);
-      if (!PI) {
-        errs() << argv[0] << ": start-after pass is not registered.\n";
-        return 1;
-      }
-      StartAfterID = PI->getTypeInfo();
-    }
-    if (!StopAfter.empty()) {
-      const PassInfo *PI = PR->getPassInfo(StopAfter);
-      if (!PI) {
-        errs() << argv[0] << ": stop-after pass is not registered.\n";
-        return 1;
-      }
-      StopAfterID = PI->getTypeInfo();
+  AnalysisID StartAfterID = 0;
+  AnalysisID StopAfterID = 0;
+  const PassRegistry *PR = PassRegistry::getPassRegistry();
+  if (!StartAfter.empty()) {
+    const PassInfo *PI = PR->getPassInfo(StartAfter);
+    if (!PI) {
+      errs() << ProgName << ": start-after pass is not registered.\n";
+      return 1;
     }
-
-    // Ask the target to add backend passes as necessary.
-    if (Target.addPassesToEmitFile(PM, FOS, FileType, NoVerify,
-                                   StartAfterID, StopAfterID)) {
-      errs() << argv[0] << ": target does not support generation of this"
-             << " file type!\n";
+    StartAfterID = PI->getTypeInfo();
+  }
+  if (!StopAfter.empty()) {
+    const PassInfo *PI = PR->getPassInfo(StopAfter);
+    if (!PI) {
+      errs() << ProgName << ": stop-after pass is not registered.\n";
       return 1;
     }
+    StopAfterID = PI->getTypeInfo();
+  }
+
+  // Ask the target to add backend passes as necessary.
+  if (Target.addPassesToEmitFile(PM, FOS, FileType, NoVerify,
+                                 StartAfterID, StopAfterID)) {
+    errs() << ProgName << ": target does not support generation of this"
+           << " file type!\n";
+    return 1;
+  }
 
-    // Before executing passes, print the final values of the LLVM options.
-    cl::PrintOptionValues();
+  PM.run(M);
+  return 0;
+}
+
+namespace {
+/// CodeGenPartition - The work handed to the thread that compiles one
+/// partition of the module.
+struct CodeGenPartition {
+  StringRef Bitcode;
+  ArrayRef<unsigned> Assignment;
+  unsigned Number;
+  const TargetMachine *Parent;
+  const char *ProgName;
+  std::string Filename;
+  int Result;
+};
+}
 
-    PM.run(*mod);
+/// compilePartition - Load a private copy of one partition of the module
+/// into a fresh context, reading only the function bodies of that partition,
+/// and compile it.
+static void compilePartition(void *Arg) {
+  CodeGenPartition &P = *static_cast<CodeGenPartition *>(Arg);
+  P.Result = 1;
+
+  LLVMContext Context;
+  std::string ErrMsg;
+  MemoryBuffer *Buffer = MemoryBuffer::getMemBuffer(P.Bitcode, "", false);
+  OwningPtr<Module> M(getLazyBitcodeModule(Buffer, Context, &ErrMsg));
+  if (!M) {
+    delete Buffer;
+    errs() << P.ProgName << ": " << ErrMsg << '\n';
+    return;
   }
+  if (materializePartition(*M, P.Assignment, P.Number, &ErrMsg)) {
+    errs() << P.ProgName << ": " << ErrMsg << '\n';
+    return;
+  }
+  extractPartition(*M, P.Assignment, P.Number);
+
+  const TargetMachine &Parent = *P.Parent;
+  OwningPtr<TargetMachine> TM(
+    Parent.getTarget().createTargetMachine(Parent.getTargetTriple(),
+                                           Parent.getTargetCPU(),
+                                           Parent.getTargetFeatureString(),
+                                           Parent.Options,
+                                           Parent.getRelocationModel(),
+                                           Parent.getCodeModel(),
+                                           Parent.getOptLevel()));
+  configureTargetMachine(*TM, Triple(Parent.getTargetTriple()), P.ProgName);
 
-  // Declare success.
-  Out->keep();
+  sys::fs::OpenFlags OpenFlags = sys::fs::F_None;
+  if (FileType != TargetMachine::CGFT_AssemblyFile)
+    OpenFlags |= sys::fs::F_Binary;
+  tool_output_file Out(P.Filename.c_str(), ErrMsg, OpenFlags);
+  if (!ErrMsg.empty()) {
+    errs() << ErrMsg << '\n';
+    return;
+  }
+
+  if (emitModule(*M, *TM, Out.os(), P.ProgName))
+    return;
+  Out.keep();
+  P.Result = 0;
+}
+
+/// compileModuleInParallel - Split M into one partition per thread and
+/// compile each partition into its own output file on its own thread, with
+/// a private LLVMContext and TargetMachine.  Partition N of the output file
+/// foo.o is written to foo.N.o.
+static int compileModuleInParallel(Module &M, TargetMachine &Target,
+                                   const char *ProgName) {
+  if (OutputFilename.empty() || OutputFilename == "-") {
+    errs() << ProgName << ": -threads requires an output file name\n";
+    return 1;
+  }
+
+  // Number the partitions in M itself, so that local symbols referenced
+  // across partitions are renamed consistently, and hand a bitcode
+  // snapshot to each thread.
+  std::vector<unsigned> Assignment;
+  partitionModule(M, Threads, Assignment);
+
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
 
+  std::vector<CodeGenPartition> Partitions(Threads);
+  std::vector<void *> Work;
+  StringRef Extension = sys::path::extension(OutputFilename);
+  for (unsigned i = 0; i != Threads; ++i) {
+    CodeGenPartition &P = Partitions[i];
+    SmallString<128> Filename(OutputFilename);
+    sys::path::replace_extension(Filename, Twine(i) + Extension);
+    P.Filename = Filename.str();
+    P.Bitcode = StringRef(Bitcode.data(), Bitcode.size());
+    P.Assignment = Assignment;
+    P.Number = i;
+    P.Parent = &Target;
+    P.ProgName = ProgName;
+    P.Result = 1;
+    Work.push_back(&P);
+  }
+
+  // Before executing passes, print the final values of the LLVM options.
+  cl::PrintOptionValues();
+
+  // The threads share global state such as the pass registry, which is only
+  // guarded once LLVM is in multithreaded mode.
+  if (!llvm_is_multithreaded())
+    llvm_start_multithreaded();
+  llvm_execute_on_threads(compilePartition, &Work[0], Work.size());
+
+  for (unsigned i = 0; i != Threads; ++i)
+    if (int RetVal = Partitions[i].Result)
+      return RetVal;
   return 0;
 }
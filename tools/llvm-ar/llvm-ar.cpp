@@ -12,18 +12,21 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileOutputBuffer.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
-#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdlib>
@@ -41,13 +44,10 @@ using namespace llvm;
 static StringRef ToolName;
 
 static const char *TemporaryOutput;
-static int TmpArchiveFD = -1;
 
 // fail - Show the error message and exit.
 LLVM_ATTRIBUTE_NORETURN static void fail(Twine Error) {
   outs() << ToolName << ": " << Error << ".\n";
-  if (TmpArchiveFD != -1)
-    close(TmpArchiveFD);
   if (TemporaryOutput)
     sys::fs::remove(TemporaryOutput);
   exit(1);
@@ -70,6 +70,11 @@ RestOfArgs(cl::Positional, cl::OneOrMore,
 
 std::string Options;
 
+static cl::opt<unsigned>
+NumThreads("j", cl::init(1),
+           cl::desc("Number of threads to read the symbols of members with"),
+           cl::value_desc("N"));
+
 // MoreHelp - Provide additional help output explaining the operations and
 // modifiers of llvm-ar. This object instructs the CommandLine library
 // to print the text of the constructor when the --help option is given.
@@ -588,14 +593,14 @@ static void printWithSpacePadding(raw_ostream &OS, T Data, unsigned Size) {
     OS << ' ';
 }
 
-static void print32BE(raw_fd_ostream &Out, unsigned Val) {
+static void print32BE(raw_ostream &Out, unsigned Val) {
   for (int I = 3; I >= 0; --I) {
     char V = (Val >> (8 * I)) & 0xff;
     Out << V;
   }
 }
 
-static void printRestOfMemberHeader(raw_fd_ostream &Out,
+static void printRestOfMemberHeader(raw_ostream &Out,
                                     const sys::TimeValue &ModTime, unsigned UID,
                                     unsigned GID, unsigned Perms,
                                     unsigned Size) {
@@ -607,14 +612,14 @@ static void printRestOfMemberHeader(raw_fd_ostream &Out,
   Out << "`\n";
 }
 
-static void printMemberHeader(raw_fd_ostream &Out, StringRef Name,
+static void printMemberHeader(raw_ostream &Out, StringRef Name,
                               const sys::TimeValue &ModTime, unsigned UID,
                               unsigned GID, unsigned Perms, unsigned Size) {
   printWithSpacePadding(Out, Twine(Name) + "/", 16);
   printRestOfMemberHeader(Out, ModTime, UID, GID, Perms, Size);
 }
 
-static void printMemberHeader(raw_fd_ostream &Out, unsigned NameOffset,
+static void printMemberHeader(raw_ostream &Out, unsigned NameOffset,
                               const sys::TimeValue &ModTime, unsigned UID,
                               unsigned GID, unsigned Perms, unsigned Size) {
   Out << '/';
@@ -622,212 +627,301 @@ static void printMemberHeader(raw_fd_ostream &Out, unsigned NameOffset,
   printRestOfMemberHeader(Out, ModTime, UID, GID, Perms, Size);
 }
 
-static void writeStringTable(raw_fd_ostream &Out,
-                             ArrayRef<NewArchiveIterator> Members,
-                             std::vector<unsigned> &StringMapIndexes) {
-  unsigned StartOffset = 0;
-  for (ArrayRef<NewArchiveIterator>::iterator I = Members.begin(),
-                                              E = Members.end();
-       I != E; ++I) {
-    StringRef Name = I->getName();
-    if (Name.size() < 16)
-      continue;
-    if (StartOffset == 0) {
-      printWithSpacePadding(Out, "//", 58);
-      Out << "`\n";
-      StartOffset = Out.tell();
-    }
-    StringMapIndexes.push_back(Out.tell() - StartOffset);
-    Out << Name << "/\n";
-  }
-  if (StartOffset == 0)
+namespace {
+/// MemberInfo - What goes into the new archive for one of its members.
+struct MemberInfo {
+  MemberInfo()
+      : UID(0), GID(0), Perms(0), File(0), IsObject(false), Obj(0) {}
+
+  sys::TimeValue ModTime;
+  unsigned UID, GID, Perms;
+  /// The contents of the member.
+  StringRef Data;
+  /// The file a new member was read from.
+  MemoryBuffer *File;
+
+  /// Whether the member is an object file.  The archive only gets a symbol
+  /// table if one of its members is.
+  bool IsObject;
+  /// The global symbols the member defines.
+  std::vector<StringRef> Symbols;
+  /// The object file the symbol names point into, if it had to be read.
+  object::ObjectFile *Obj;
+  error_code SymbolsEC;
+};
+
+/// SymbolJob - The members whose symbols are read by readMemberSymbols, which
+/// the threads take one at a time.
+struct SymbolJob {
+  const NewArchiveIterator *Members;
+  MemberInfo *Infos;
+  std::vector<unsigned> ToRead;
+  volatile sys::cas_flag Next;
+};
+}
+
+static void readMember(const NewArchiveIterator &Member, MemberInfo &Info) {
+  if (!Member.isNewMember()) {
+    object::Archive::child_iterator OldMember = Member.getOld();
+    Info.ModTime = OldMember->getLastModified();
+    Info.UID = OldMember->getUID();
+    Info.GID = OldMember->getGID();
+    Info.Perms = OldMember->getAccessMode();
+    Info.Data = OldMember->getBuffer();
     return;
-  if (Out.tell() % 2)
-    Out << '\n';
-  int Pos = Out.tell();
-  Out.seek(StartOffset - 12);
-  printWithSpacePadding(Out, Pos - StartOffset, 10);
-  Out.seek(Pos);
-}
-
-static void writeSymbolTable(
-    raw_fd_ostream &Out, ArrayRef<NewArchiveIterator> Members,
-    std::vector<std::pair<unsigned, unsigned> > &MemberOffsetRefs) {
-  unsigned StartOffset = 0;
-  unsigned MemberNum = 0;
-  std::vector<StringRef> SymNames;
-  std::vector<object::ObjectFile *> DeleteIt;
-  for (ArrayRef<NewArchiveIterator>::iterator I = Members.begin(),
-                                              E = Members.end();
-       I != E; ++I, ++MemberNum) {
-    object::ObjectFile *Obj;
-    if (I->isNewMember()) {
-      const char *Filename = I->getNew();
-      Obj = object::ObjectFile::createObjectFile(Filename);
+  }
+
+  const char *FileName = Member.getNew();
+  int FD;
+  failIfError(sys::fs::openFileForRead(FileName, FD), FileName);
+
+  sys::fs::file_status Status;
+  failIfError(sys::fs::status(FD, Status), FileName);
+
+  // Opening a directory doesn't make sense. Let it failed.
+  // Linux cannot open directories with open(2), although
+  // cygwin and *bsd can.
+  if (Status.type() == sys::fs::file_type::directory_file)
+    failIfError(error_code(errc::is_a_directory, posix_category()), FileName);
+
+  OwningPtr<MemoryBuffer> File;
+  failIfError(MemoryBuffer::getOpenFile(FD, FileName, File, Status.getSize(),
+                                        false),
+              FileName);
+  close(FD);
+
+  Info.ModTime = Status.getLastModificationTime();
+  Info.UID = Status.getUser();
+  Info.GID = Status.getGroup();
+  Info.Perms = Status.permissions();
+  Info.File = File.take();
+  Info.Data = Info.File->getBuffer();
+}
+
+// readMemberSymbols - Find the global symbols an object file member defines.
+// This may run on any thread, so errors are left in Info for the caller.
+static void readMemberSymbols(const NewArchiveIterator &Member,
+                              MemberInfo &Info) {
+  object::ObjectFile *Obj;
+  if (Member.isNewMember()) {
+    Obj = object::ObjectFile::createObjectFile(
+        MemoryBuffer::getMemBuffer(Info.Data, Member.getNew(), false));
+  } else {
+    object::Archive::child_iterator OldMember = Member.getOld();
+    OwningPtr<object::Binary> Binary;
+    error_code EC = OldMember->getAsBinary(Binary);
+    if (EC) { // FIXME: check only for "not an object file" errors.
+      Obj = NULL;
     } else {
-      object::Archive::child_iterator OldMember = I->getOld();
-      OwningPtr<object::Binary> Binary;
-      error_code EC = OldMember->getAsBinary(Binary);
-      if (EC) { // FIXME: check only for "not an object file" errors.
-        Obj = NULL;
-      } else {
-        Obj = dyn_cast<object::ObjectFile>(Binary.get());
-        if (Obj)
-          Binary.take();
-      }
+      Obj = dyn_cast<object::ObjectFile>(Binary.get());
+      if (Obj)
+        Binary.take();
     }
-    if (!Obj)
+  }
+  if (!Obj)
+    return;
+  Info.Obj = Obj;
+  Info.IsObject = true;
+
+  error_code &Err = Info.SymbolsEC;
+  for (object::symbol_iterator I = Obj->begin_symbols(),
+                               E = Obj->end_symbols();
+       I != E; I.increment(Err)) {
+    if (Err)
+      return;
+    uint32_t Symflags;
+    if ((Err = I->getFlags(Symflags)))
+      return;
+    if (Symflags & object::SymbolRef::SF_FormatSpecific)
       continue;
-    DeleteIt.push_back(Obj);
-    if (!StartOffset) {
-      printMemberHeader(Out, "", sys::TimeValue::now(), 0, 0, 0, 0);
-      StartOffset = Out.tell();
-      print32BE(Out, 0);
-    }
+    if (!(Symflags & object::SymbolRef::SF_Global))
+      continue;
+    if (Symflags & object::SymbolRef::SF_Undefined)
+      continue;
+    StringRef Name;
+    if ((Err = I->getName(Name)))
+      return;
+    Info.Symbols.push_back(Name);
+  }
+}
 
-    error_code Err;
-    for (object::symbol_iterator I = Obj->begin_symbols(),
-                                 E = Obj->end_symbols();
-         I != E; I.increment(Err), failIfError(Err)) {
-      uint32_t Symflags;
-      failIfError(I->getFlags(Symflags));
-      if (Symflags & object::SymbolRef::SF_FormatSpecific)
-        continue;
-      if (!(Symflags & object::SymbolRef::SF_Global))
-        continue;
-      if (Symflags & object::SymbolRef::SF_Undefined)
-        continue;
+static void runSymbolJob(void *Arg) {
+  SymbolJob *Job = static_cast<SymbolJob *>(Arg);
+  for (;;) {
+    unsigned Item = sys::AtomicIncrement(&Job->Next) - 1;
+    if (Item >= Job->ToRead.size())
+      return;
+    unsigned MemberNum = Job->ToRead[Item];
+    readMemberSymbols(Job->Members[MemberNum], Job->Infos[MemberNum]);
+  }
+}
+
+// readSymbols - Find the symbols of every member for the symbol table.  The
+// members kept from an archive that has a symbol table get the symbols it
+// lists for them, and the other members are read on up to NumThreads threads.
+static void readSymbols(object::Archive *OldArchive,
+                        ArrayRef<NewArchiveIterator> Members,
+                        std::vector<MemberInfo> &Infos) {
+  bool ReuseOldSymbols = OldArchive && OldArchive->hasSymbolTable() &&
+                         OldArchive->kind() != object::Archive::K_BSD;
+  if (ReuseOldSymbols) {
+    DenseMap<const char *, unsigned> OldMembers;
+    for (unsigned I = 0, E = Members.size(); I != E; ++I)
+      if (!Members[I].isNewMember())
+        OldMembers[Members[I].getOld()->getBuffer().data()] = I;
+    for (object::Archive::symbol_iterator I = OldArchive->begin_symbols(),
+                                          E = OldArchive->end_symbols();
+         I != E; ++I) {
       StringRef Name;
+      object::Archive::child_iterator Member;
       failIfError(I->getName(Name));
-      SymNames.push_back(Name);
-      MemberOffsetRefs.push_back(std::make_pair(Out.tell(), MemberNum));
-      print32BE(Out, 0);
+      failIfError(I->getMember(Member));
+      DenseMap<const char *, unsigned>::iterator Pos =
+          OldMembers.find(Member->getBuffer().data());
+      if (Pos == OldMembers.end())
+        continue;
+      Infos[Pos->second].IsObject = true;
+      Infos[Pos->second].Symbols.push_back(Name);
     }
   }
-  for (std::vector<StringRef>::iterator I = SymNames.begin(),
-                                        E = SymNames.end();
-       I != E; ++I) {
-    Out << *I;
-    Out << '\0';
-  }
-
-  for (std::vector<object::ObjectFile *>::iterator I = DeleteIt.begin(),
-                                                   E = DeleteIt.end();
-       I != E; ++I) {
-    object::ObjectFile *O = *I;
-    delete O;
-  }
-
-  if (StartOffset == 0)
-    return;
 
-  if (Out.tell() % 2)
-    Out << '\0';
-
-  unsigned Pos = Out.tell();
-  Out.seek(StartOffset - 12);
-  printWithSpacePadding(Out, Pos - StartOffset, 10);
-  Out.seek(StartOffset);
-  print32BE(Out, SymNames.size());
-  Out.seek(Pos);
+  SymbolJob Job;
+  Job.Members = Members.data();
+  Job.Infos = Infos.data();
+  Job.Next = 0;
+  for (unsigned I = 0, E = Members.size(); I != E; ++I)
+    if (Members[I].isNewMember() || !ReuseOldSymbols)
+      Job.ToRead.push_back(I);
+  unsigned Threads = std::max<unsigned>(NumThreads, 1);
+  std::vector<void *> Work(std::min<size_t>(Threads, Job.ToRead.size()), &Job);
+  if (!Work.empty())
+    llvm_execute_on_threads(runSymbolJob, &Work[0], Work.size());
+
+  for (unsigned I = 0, E = Members.size(); I != E; ++I)
+    failIfError(Infos[I].SymbolsEC);
 }
 
 static void performWriteOperation(ArchiveOperation Operation,
                                   object::Archive *OldArchive) {
-  SmallString<128> TmpArchive;
-  failIfError(sys::fs::createUniqueFile(ArchiveName + ".temp-archive-%%%%%%%.a",
-                                        TmpArchiveFD, TmpArchive));
-
-  TemporaryOutput = TmpArchive.c_str();
-  tool_output_file Output(TemporaryOutput, TmpArchiveFD);
-  raw_fd_ostream &Out = Output.os();
-  Out << "!<arch>\n";
-
   std::vector<NewArchiveIterator> NewMembers =
       computeNewArchiveMembers(Operation, OldArchive);
-
-  std::vector<std::pair<unsigned, unsigned> > MemberOffsetRefs;
-
-  if (Symtab) {
-    writeSymbolTable(Out, NewMembers, MemberOffsetRefs);
+  std::vector<MemberInfo> Infos(NewMembers.size());
+  for (unsigned I = 0, E = NewMembers.size(); I != E; ++I)
+    readMember(NewMembers[I], Infos[I]);
+  if (Symtab)
+    readSymbols(OldArchive, NewMembers, Infos);
+
+  // Lay out the whole archive, so that it can be written in one pass.
+  bool HasSymbolTable = false;
+  uint64_t NumSymbols = 0;
+  uint64_t SymbolTableSize = 4;
+  uint64_t StringTableSize = 0;
+  for (unsigned I = 0, E = NewMembers.size(); I != E; ++I) {
+    HasSymbolTable |= Infos[I].IsObject;
+    NumSymbols += Infos[I].Symbols.size();
+    for (unsigned J = 0, JE = Infos[I].Symbols.size(); J != JE; ++J)
+      SymbolTableSize += 4 + Infos[I].Symbols[J].size() + 1;
+    StringRef Name = NewMembers[I].getName();
+    if (Name.size() >= 16)
+      StringTableSize += Name.size() + 2;
   }
+  SymbolTableSize += SymbolTableSize % 2;
+  StringTableSize += StringTableSize % 2;
+
+  const uint64_t HeaderSize = sizeof(object::ArchiveMemberHeader);
+  uint64_t Pos = 8;
+  if (HasSymbolTable)
+    Pos += HeaderSize + SymbolTableSize;
+  if (StringTableSize)
+    Pos += HeaderSize + StringTableSize;
+  std::vector<uint64_t> MemberOffsets;
+  for (unsigned I = 0, E = NewMembers.size(); I != E; ++I) {
+    MemberOffsets.push_back(Pos);
+    Pos += HeaderSize + Infos[I].Data.size();
+    Pos += Pos % 2;
+  }
+  uint64_t ArchiveSize = Pos;
 
+  // Everything up to the first member.
+  std::string Head;
   std::vector<unsigned> StringMapIndexes;
-  writeStringTable(Out, NewMembers, StringMapIndexes);
-
-  std::vector<std::pair<unsigned, unsigned> >::iterator MemberRefsI =
-      MemberOffsetRefs.begin();
-
-  unsigned MemberNum = 0;
-  unsigned LongNameMemberNum = 0;
-  for (std::vector<NewArchiveIterator>::iterator I = NewMembers.begin(),
-                                                 E = NewMembers.end();
-       I != E; ++I, ++MemberNum) {
-
-    unsigned Pos = Out.tell();
-    while (MemberRefsI != MemberOffsetRefs.end() &&
-           MemberRefsI->second == MemberNum) {
-      Out.seek(MemberRefsI->first);
-      print32BE(Out, Pos);
-      ++MemberRefsI;
+  {
+    raw_string_ostream Out(Head);
+    Out << "!<arch>\n";
+    if (HasSymbolTable) {
+      printMemberHeader(Out, "", sys::TimeValue::now(), 0, 0, 0,
+                        SymbolTableSize);
+      print32BE(Out, NumSymbols);
+      for (unsigned I = 0, E = NewMembers.size(); I != E; ++I)
+        for (unsigned J = 0, JE = Infos[I].Symbols.size(); J != JE; ++J)
+          print32BE(Out, MemberOffsets[I]);
+      for (unsigned I = 0, E = NewMembers.size(); I != E; ++I)
+        for (unsigned J = 0, JE = Infos[I].Symbols.size(); J != JE; ++J)
+          Out << Infos[I].Symbols[J] << '\0';
+      if (Out.tell() % 2)
+        Out << '\0';
     }
-    Out.seek(Pos);
-
-    if (I->isNewMember()) {
-      const char *FileName = I->getNew();
-
-      int FD;
-      failIfError(sys::fs::openFileForRead(FileName, FD), FileName);
-
-      sys::fs::file_status Status;
-      failIfError(sys::fs::status(FD, Status), FileName);
-
-      // Opening a directory doesn't make sense. Let it failed.
-      // Linux cannot open directories with open(2), although
-      // cygwin and *bsd can.
-      if (Status.type() == sys::fs::file_type::directory_file)
-        failIfError(error_code(errc::is_a_directory, posix_category()),
-                    FileName);
-
-      OwningPtr<MemoryBuffer> File;
-      failIfError(MemoryBuffer::getOpenFile(FD, FileName, File,
-                                            Status.getSize(), false),
-                  FileName);
-
-      StringRef Name = sys::path::filename(FileName);
-      if (Name.size() < 16)
-        printMemberHeader(Out, Name, Status.getLastModificationTime(),
-                          Status.getUser(), Status.getGroup(),
-                          Status.permissions(), Status.getSize());
-      else
-        printMemberHeader(Out, StringMapIndexes[LongNameMemberNum++],
-                          Status.getLastModificationTime(), Status.getUser(),
-                          Status.getGroup(), Status.permissions(),
-                          Status.getSize());
-      Out << File->getBuffer();
-    } else {
-      object::Archive::child_iterator OldMember = I->getOld();
-      StringRef Name = I->getName();
-
-      if (Name.size() < 16)
-        printMemberHeader(Out, Name, OldMember->getLastModified(),
-                          OldMember->getUID(), OldMember->getGID(),
-                          OldMember->getAccessMode(), OldMember->getSize());
-      else
-        printMemberHeader(Out, StringMapIndexes[LongNameMemberNum++],
-                          OldMember->getLastModified(), OldMember->getUID(),
-                          OldMember->getGID(), OldMember->getAccessMode(),
-                          OldMember->getSize());
-      Out << OldMember->getBuffer();
+    if (StringTableSize) {
+      printWithSpacePadding(Out, "//", 48);
+      printWithSpacePadding(Out, StringTableSize, 10);
+      Out << "`\n";
+      uint64_t StartOffset = Out.tell();
+      for (unsigned I = 0, E = NewMembers.size(); I != E; ++I) {
+        StringRef Name = NewMembers[I].getName();
+        if (Name.size() < 16)
+          continue;
+        StringMapIndexes.push_back(Out.tell() - StartOffset);
+        Out << Name << "/\n";
+      }
+      if (Out.tell() % 2)
+        Out << '\n';
     }
+  }
 
-    if (Out.tell() % 2)
-      Out << '\n';
+  SmallString<128> TmpArchive;
+  failIfError(sys::fs::createUniqueFile(ArchiveName + ".temp-archive-%%%%%%%.a",
+                                        TmpArchive));
+  TemporaryOutput = TmpArchive.c_str();
+  OwningPtr<FileOutputBuffer> Output;
+  failIfError(FileOutputBuffer::create(TmpArchive, ArchiveSize, Output));
+
+  // Nothing below can fail before the buffer is committed, which would leave
+  // its temporary file behind.
+  char *Buf = reinterpret_cast<char *>(Output->getBufferStart());
+  assert(Head.size() == (NewMembers.empty() ? ArchiveSize : MemberOffsets[0]));
+  memcpy(Buf, Head.data(), Head.size());
+  unsigned LongNameMemberNum = 0;
+  for (unsigned I = 0, E = NewMembers.size(); I != E; ++I) {
+    const MemberInfo &Info = Infos[I];
+    StringRef Name = NewMembers[I].isNewMember()
+                         ? sys::path::filename(NewMembers[I].getNew())
+                         : NewMembers[I].getName();
+    SmallString<60> Header;
+    raw_svector_ostream Out(Header);
+    if (Name.size() < 16)
+      printMemberHeader(Out, Name, Info.ModTime, Info.UID, Info.GID,
+                        Info.Perms, Info.Data.size());
+    else
+      printMemberHeader(Out, StringMapIndexes[LongNameMemberNum++],
+                        Info.ModTime, Info.UID, Info.GID, Info.Perms,
+                        Info.Data.size());
+    Out.flush();
+    char *P = Buf + MemberOffsets[I];
+    memcpy(P, Header.data(), Header.size());
+    P += Header.size();
+    memcpy(P, Info.Data.data(), Info.Data.size());
+    P += Info.Data.size();
+    if ((P - Buf) % 2)
+      *P = '\n';
   }
-  Output.keep();
-  Out.close();
+  failIfError(Output->commit());
   sys::fs::rename(TemporaryOutput, ArchiveName);
   TemporaryOutput = NULL;
+
+  for (unsigned I = 0, E = Infos.size(); I != E; ++I) {
+    delete Infos[I].Obj;
+    delete Infos[I].File;
+  }
 }
 
 static void createSymbolTable(object::Archive *OldArchive) {
@@ -0,0 +1,789 @@
+//===-- llvm-compile-bench.cpp - Compile-time benchmark harness -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program measures how long the optimizer and the code generator take
+// on a corpus of modules.  Each module is compiled in-process several times,
+// and the time of the fastest run is written out as JSON, along with the time
+// of each pass, instruction counts, object size and peak memory.  Two such
+// results, for example from two builds of LLVM, can then be compared with
+// -compare.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/Verifier.h"
+#include "llvm/CodeGen/LinkAllCodegenComponents.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/LinkAllPasses.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Pass.h"
+#include "llvm/PassManager.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/YAMLTraits.h"
+#include "llvm/Target/TargetLibraryInfo.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+using namespace llvm;
+
+static cl::list<std::string>
+InputPaths(cl::Positional, cl::ZeroOrMore,
+           cl::desc("<input bitcode or assembly files and directories>"));
+
+static cl::opt<std::string>
+OutputFilename("o", cl::desc("Output filename"), cl::value_desc("filename"),
+               cl::init("-"));
+
+static cl::opt<unsigned>
+Repeat("repeat", cl::desc("Number of times to compile each module"),
+       cl::init(3));
+
+static cl::opt<unsigned>
+OptLevel("opt-level", cl::desc("Optimization level of the standard pipeline "
+                               "(0-3)"),
+         cl::init(2));
+
+static cl::opt<std::string>
+PassList("passes", cl::desc("Comma-separated list of passes to run instead "
+                            "of the standard pipeline"),
+         cl::value_desc("pass,pass,..."));
+
+static cl::opt<bool>
+DisableCodeGen("disable-codegen", cl::desc("Only run the optimizer"));
+
+static cl::opt<bool>
+DisablePassTimes("disable-pass-times",
+                 cl::desc("Do not time each pass on its own"));
+
+static cl::opt<std::string>
+TargetTriple("mtriple", cl::desc("Override the target triple of the modules"));
+
+static cl::opt<std::string>
+MCPU("mcpu", cl::desc("Target a specific cpu type"),
+     cl::value_desc("cpu-name"));
+
+static cl::list<std::string>
+MAttrs("mattr", cl::CommaSeparated, cl::desc("Target specific attributes"),
+       cl::value_desc("a1,+a2,-a3,..."));
+
+static cl::list<unsigned>
+StressSizes("stress-sizes", cl::CommaSeparated,
+            cl::desc("Also compile modules generated by llvm-stress with "
+                     "these sizes"),
+            cl::value_desc("size,size,..."));
+
+static cl::opt<unsigned>
+StressSeed("stress-seed", cl::desc("Seed of the llvm-stress modules"),
+           cl::init(1));
+
+static cl::opt<std::string>
+StressTool("llvm-stress", cl::desc("Path of llvm-stress (default: next to "
+                                   "this program)"),
+           cl::value_desc("path"));
+
+static cl::opt<bool>
+Compare("compare", cl::desc("Compare two results files, the base and then "
+                            "the new one, instead of compiling"));
+
+static cl::opt<double>
+Threshold("threshold", cl::desc("Change in percent beyond which -compare "
+                                "reports a regression"),
+          cl::init(5.0));
+
+static cl::opt<unsigned>
+ComparePasses("compare-passes", cl::desc("Number of passes -compare lists"),
+              cl::init(10));
+
+static const char *ProgName;
+
+//===----------------------------------------------------------------------===//
+// Results
+
+namespace {
+/// PassResult - The time a pass took on a module, over all of its runs.
+struct PassResult {
+  std::string Name;
+  double WallTime, UserTime;
+  PassResult() : WallTime(0), UserTime(0) {}
+};
+
+/// ModuleResult - The measurements of a module.
+struct ModuleResult {
+  std::string Name;
+  /// The number of instructions before and after the optimizer ran.
+  uint64_t InstCount, OptInstCount;
+  uint64_t ObjectSize;
+  /// The peak resident set size of this program once the module is done.
+  /// This includes the modules before it.
+  uint64_t PeakMemory;
+  /// The time of the fastest run.
+  double WallTime, UserTime;
+  /// The wall time of each run.
+  std::vector<double> WallTimes;
+  /// The passes in the order they first ran, from a separate run.
+  std::vector<PassResult> PassTimes;
+  ModuleResult()
+    : InstCount(0), OptInstCount(0), ObjectSize(0), PeakMemory(0),
+      WallTime(0), UserTime(0) {}
+};
+
+/// BenchResults - The contents of a results file.
+struct BenchResults {
+  std::string Passes;
+  unsigned OptLevel;
+  bool CodeGen;
+  unsigned Repeat;
+  std::vector<ModuleResult> Modules;
+  double WallTime, UserTime;
+  uint64_t PeakMemory;
+  BenchResults()
+    : OptLevel(0), CodeGen(false), Repeat(0), WallTime(0), UserTime(0),
+      PeakMemory(0) {}
+};
+
+/// PassTimer - Adds up the time of each pass, by name.
+class PassTimer : public PassInstrumentation {
+  sys::SmartMutex<true> Lock;
+  StringMap<unsigned> Index;
+  std::vector<PassResult> Passes;
+
+public:
+  virtual void passExecuted(const PassRunInfo &Info) {
+    sys::SmartScopedLock<true> Guard(Lock);
+    StringMapEntry<unsigned> &I =
+      Index.GetOrCreateValue(Info.P->getPassName(), Passes.size());
+    if (I.getValue() == Passes.size()) {
+      Passes.push_back(PassResult());
+      Passes.back().Name = I.getKey();
+    }
+    Passes[I.getValue()].WallTime += Info.Time.getWallTime();
+    Passes[I.getValue()].UserTime += Info.Time.getUserTime();
+  }
+
+  void take(std::vector<PassResult> &Result) {
+    sys::SmartScopedLock<true> Guard(Lock);
+    Result.swap(Passes);
+    Passes.clear();
+    Index.clear();
+  }
+};
+}
+
+//===----------------------------------------------------------------------===//
+// Compiling
+
+static uint64_t countInstructions(const Module &M) {
+  uint64_t Count = 0;
+  for (Module::const_iterator F = M.begin(), FE = M.end(); F != FE; ++F)
+    for (Function::const_iterator BB = F->begin(), BE = F->end(); BB != BE;
+         ++BB)
+      Count += BB->size();
+  return Count;
+}
+
+/// addOptimizationPasses - Add the passes given with -passes, or the standard
+/// pipeline for -opt-level, as opt would.
+static void addOptimizationPasses(PassManagerBase &MPM,
+                                  FunctionPassManager &FPM) {
+  if (!PassList.empty()) {
+    SmallVector<StringRef, 16> Names;
+    StringRef(PassList).split(Names, ",", -1, false);
+    const PassRegistry *PR = PassRegistry::getPassRegistry();
+    for (unsigned i = 0, e = Names.size(); i != e; ++i)
+      MPM.add(PR->getPassInfo(Names[i].trim())->createPass());
+    return;
+  }
+
+  PassManagerBuilder Builder;
+  Builder.OptLevel = OptLevel;
+  if (OptLevel > 1)
+    Builder.Inliner = createFunctionInliningPass(OptLevel > 2 ? 275 : 225);
+  else
+    Builder.Inliner = createAlwaysInlinerPass();
+  Builder.DisableUnrollLoops = OptLevel == 0;
+  Builder.LoopVectorize = OptLevel > 1;
+  Builder.SLPVectorize = true;
+  Builder.populateFunctionPassManager(FPM);
+  Builder.populateModulePassManager(MPM);
+}
+
+static TargetMachine *createTargetMachine(Module &M, std::string &Error) {
+  if (!TargetTriple.empty())
+    M.setTargetTriple(Triple::normalize(TargetTriple));
+  Triple TheTriple(M.getTargetTriple());
+  if (TheTriple.getTriple().empty())
+    TheTriple.setTriple(sys::getDefaultTargetTriple());
+
+  const Target *TheTarget = TargetRegistry::lookupTarget("", TheTriple, Error);
+  if (!TheTarget)
+    return 0;
+
+  SubtargetFeatures Features;
+  for (unsigned i = 0; i != MAttrs.size(); ++i)
+    Features.AddFeature(MAttrs[i]);
+
+  CodeGenOpt::Level OLvl = CodeGenOpt::Default;
+  switch (OptLevel) {
+  case 0: OLvl = CodeGenOpt::None; break;
+  case 1: OLvl = CodeGenOpt::Less; break;
+  case 2: OLvl = CodeGenOpt::Default; break;
+  default: OLvl = CodeGenOpt::Aggressive; break;
+  }
+
+  return TheTarget->createTargetMachine(TheTriple.getTriple(), MCPU,
+                                        Features.getString(), TargetOptions(),
+                                        Reloc::Default, CodeModel::Default,
+                                        OLvl);
+}
+
+/// compileOnce - Load the module at Path, then optimize it and generate code
+/// for it.  Only the optimizer and the code generator are timed, into Time.
+/// Return false and set Error if the module cannot be compiled.
+static bool compileOnce(StringRef Path, ModuleResult &Result, TimeRecord &Time,
+                        std::string &Error) {
+  LLVMContext Context;
+  SMDiagnostic Err;
+  OwningPtr<Module> M(ParseIRFile(Path, Err, Context));
+  if (!M) {
+    raw_string_ostream OS(Error);
+    Err.print(ProgName, OS);
+    return false;
+  }
+  Result.InstCount = countInstructions(*M);
+
+  OwningPtr<TargetMachine> TM;
+  if (!DisableCodeGen) {
+    TM.reset(createTargetMachine(*M, Error));
+    if (!TM)
+      return false;
+  }
+
+  PassManager OptPM;
+  FunctionPassManager FPM(M.get());
+  OptPM.add(new TargetLibraryInfo(Triple(M->getTargetTriple())));
+  FPM.add(new TargetLibraryInfo(Triple(M->getTargetTriple())));
+  if (TM && TM->getDataLayout()) {
+    OptPM.add(new DataLayout(*TM->getDataLayout()));
+    FPM.add(new DataLayout(*TM->getDataLayout()));
+  } else if (!M->getDataLayout().empty()) {
+    OptPM.add(new DataLayout(M.get()));
+    FPM.add(new DataLayout(M.get()));
+  }
+  if (TM) {
+    TM->addAnalysisPasses(OptPM);
+    TM->addAnalysisPasses(FPM);
+  }
+  addOptimizationPasses(OptPM, FPM);
+
+  SmallVector<char, 0> Object;
+  raw_svector_ostream OS(Object);
+  formatted_raw_ostream FOS(OS);
+  PassManager CodeGenPM;
+  if (TM) {
+    CodeGenPM.add(new TargetLibraryInfo(Triple(M->getTargetTriple())));
+    TM->addAnalysisPasses(CodeGenPM);
+    CodeGenPM.add(new DataLayout(*TM->getDataLayout()));
+    if (TM->addPassesToEmitFile(CodeGenPM, FOS,
+                                TargetMachine::CGFT_ObjectFile)) {
+      Error = "target does not support generation of object files";
+      return false;
+    }
+  }
+
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  FPM.doInitialization();
+  for (Module::iterator F = M->begin(), E = M->end(); F != E; ++F)
+    FPM.run(*F);
+  FPM.doFinalization();
+  OptPM.run(*M);
+  if (TM) {
+    CodeGenPM.run(*M);
+    FOS.flush();
+  }
+  Time = TimeRecord::getCurrentTime(false);
+  Time -= Start;
+
+  Result.OptInstCount = countInstructions(*M);
+  Result.ObjectSize = OS.str().size();
+  return true;
+}
+
+/// benchmarkModule - Compile the module at Path -repeat times, then once
+/// more with each pass timed.
+static bool benchmarkModule(StringRef Path, ModuleResult &Result,
+                            PassTimer &Timer) {
+  std::string Error;
+  for (unsigned i = 0; i != Repeat; ++i) {
+    TimeRecord Time;
+    if (!compileOnce(Path, Result, Time, Error)) {
+      errs() << ProgName << ": " << Path << ": " << Error << '\n';
+      return false;
+    }
+    Result.WallTimes.push_back(Time.getWallTime());
+    if (i == 0 || Time.getWallTime() < Result.WallTime) {
+      Result.WallTime = Time.getWallTime();
+      Result.UserTime = Time.getUserTime();
+    }
+  }
+
+  // Instrumenting the passes makes each of them count instructions, so the
+  // timed runs above are made without it.
+  if (!DisablePassTimes) {
+    TimeRecord Time;
+    addPassInstrumentation(&Timer);
+    bool Success = compileOnce(Path, Result, Time, Error);
+    removePassInstrumentation(&Timer);
+    Timer.take(Result.PassTimes);
+    if (!Success) {
+      errs() << ProgName << ": " << Path << ": " << Error << '\n';
+      return false;
+    }
+  }
+
+  Result.PeakMemory = sys::Process::GetPeakMemoryUsage();
+  return true;
+}
+
+/// collectInputs - Expand the input directories into the bitcode and
+/// assembly files they contain, in a stable order.
+static bool collectInputs(std::vector<std::string> &Files) {
+  for (unsigned i = 0, e = InputPaths.size(); i != e; ++i) {
+    const std::string &Path = InputPaths[i];
+    if (!sys::fs::is_directory(Path)) {
+      Files.push_back(Path);
+      continue;
+    }
+
+    std::vector<std::string> Found;
+    error_code EC;
+    for (sys::fs::recursive_directory_iterator I(Path, EC), E; I != E;
+         I.increment(EC)) {
+      if (EC)
+        break;
+      StringRef Ext = sys::path::extension(I->path());
+      if (Ext == ".bc" || Ext == ".ll")
+        Found.push_back(I->path());
+    }
+    if (EC) {
+      errs() << ProgName << ": " << Path << ": " << EC.message() << '\n';
+      return false;
+    }
+    std::sort(Found.begin(), Found.end());
+    Files.insert(Files.end(), Found.begin(), Found.end());
+  }
+  return true;
+}
+
+/// findStressTool - Find llvm-stress, next to this program first, so that
+/// the one of the build being measured is used.
+static std::string findStressTool(const char *Argv0) {
+  void *P = (void *)(intptr_t)findStressTool;
+  SmallString<128> Path(sys::fs::getMainExecutable(Argv0, P));
+  sys::path::remove_filename(Path);
+  sys::path::append(Path, "llvm-stress");
+  if (sys::fs::can_execute(Path.str()))
+    return Path.str();
+  return sys::FindProgramByName("llvm-stress");
+}
+
+/// generateStressModule - Run llvm-stress to write a module of the given size
+/// to a temporary file.
+static bool generateStressModule(StringRef Stress, unsigned Size,
+                                 SmallVectorImpl<char> &Path) {
+  if (error_code EC = sys::fs::createTemporaryFile("llvm-compile-bench", "ll",
+                                                   Path)) {
+    errs() << ProgName << ": " << EC.message() << '\n';
+    return false;
+  }
+
+  std::string SizeArg = "-size=" + utostr(Size);
+  std::string SeedArg = "-seed=" + utostr(StressSeed);
+  std::string OutputArg = "-o=" + std::string(Path.begin(), Path.end());
+  const char *Args[] = {
+    "llvm-stress", SizeArg.c_str(), SeedArg.c_str(), OutputArg.c_str(), 0
+  };
+  std::string ErrMsg;
+  if (sys::ExecuteAndWait(Stress, Args, 0, 0, 0, 0, &ErrMsg) != 0) {
+    errs() << ProgName << ": llvm-stress failed";
+    if (!ErrMsg.empty())
+      errs() << ": " << ErrMsg;
+    errs() << '\n';
+    return false;
+  }
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// JSON output
+
+static void writeString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned i = 0, e = S.size(); i != e; ++i) {
+    unsigned char C = S[i];
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+static void writeTime(raw_ostream &OS, double Time) {
+  OS << format("%.6f", Time);
+}
+
+static void writeResults(raw_ostream &OS, const BenchResults &R) {
+  OS << "{\n";
+  OS << "  \"passes\": ";
+  writeString(OS, R.Passes);
+  OS << ",\n";
+  OS << "  \"opt_level\": " << R.OptLevel << ",\n";
+  OS << "  \"codegen\": " << (R.CodeGen ? "true" : "false") << ",\n";
+  OS << "  \"repeat\": " << R.Repeat << ",\n";
+  OS << "  \"wall_time\": ";
+  writeTime(OS, R.WallTime);
+  OS << ",\n  \"user_time\": ";
+  writeTime(OS, R.UserTime);
+  OS << ",\n  \"peak_memory\": " << R.PeakMemory << ",\n";
+  OS << "  \"modules\": [";
+  for (unsigned i = 0, e = R.Modules.size(); i != e; ++i) {
+    const ModuleResult &M = R.Modules[i];
+    OS << (i ? ",\n" : "\n") << "    {\n";
+    OS << "      \"name\": ";
+    writeString(OS, M.Name);
+    OS << ",\n";
+    OS << "      \"inst_count\": " << M.InstCount << ",\n";
+    OS << "      \"opt_inst_count\": " << M.OptInstCount << ",\n";
+    OS << "      \"object_size\": " << M.ObjectSize << ",\n";
+    OS << "      \"peak_memory\": " << M.PeakMemory << ",\n";
+    OS << "      \"wall_time\": ";
+    writeTime(OS, M.WallTime);
+    OS << ",\n      \"user_time\": ";
+    writeTime(OS, M.UserTime);
+    OS << ",\n      \"wall_times\": [";
+    for (unsigned j = 0, je = M.WallTimes.size(); j != je; ++j) {
+      OS << (j ? ", " : "");
+      writeTime(OS, M.WallTimes[j]);
+    }
+    OS << "],\n      \"pass_times\": [";
+    for (unsigned j = 0, je = M.PassTimes.size(); j != je; ++j) {
+      const PassResult &P = M.PassTimes[j];
+      OS << (j ? ",\n" : "\n") << "        { \"name\": ";
+      writeString(OS, P.Name);
+      OS << ", \"wall_time\": ";
+      writeTime(OS, P.WallTime);
+      OS << ", \"user_time\": ";
+      writeTime(OS, P.UserTime);
+      OS << " }";
+    }
+    OS << (M.PassTimes.empty() ? "]\n" : "\n      ]\n") << "    }";
+  }
+  OS << (R.Modules.empty() ? "]\n" : "\n  ]\n");
+  OS << "}\n";
+}
+
+//===----------------------------------------------------------------------===//
+// Reading results back for -compare.  JSON is a subset of YAML, so the YAML
+// parser reads the files.  It does not take a plain scalar just before the
+// end of a multi-line mapping, so writeResults puts the modules last.
+
+LLVM_YAML_IS_FLOW_SEQUENCE_VECTOR(double)
+LLVM_YAML_IS_SEQUENCE_VECTOR(PassResult)
+LLVM_YAML_IS_SEQUENCE_VECTOR(ModuleResult)
+
+namespace llvm {
+namespace yaml {
+template <> struct MappingTraits<PassResult> {
+  static void mapping(IO &IO, PassResult &P) {
+    IO.mapRequired("name", P.Name);
+    IO.mapRequired("wall_time", P.WallTime);
+    IO.mapOptional("user_time", P.UserTime);
+  }
+};
+
+template <> struct MappingTraits<ModuleResult> {
+  static void mapping(IO &IO, ModuleResult &M) {
+    IO.mapRequired("name", M.Name);
+    IO.mapOptional("inst_count", M.InstCount);
+    IO.mapOptional("opt_inst_count", M.OptInstCount);
+    IO.mapOptional("object_size", M.ObjectSize);
+    IO.mapOptional("peak_memory", M.PeakMemory);
+    IO.mapRequired("wall_time", M.WallTime);
+    IO.mapOptional("user_time", M.UserTime);
+    IO.mapOptional("wall_times", M.WallTimes);
+    IO.mapOptional("pass_times", M.PassTimes);
+  }
+};
+
+template <> struct MappingTraits<BenchResults> {
+  static void mapping(IO &IO, BenchResults &R) {
+    IO.mapOptional("passes", R.Passes);
+    IO.mapOptional("opt_level", R.OptLevel);
+    IO.mapOptional("codegen", R.CodeGen);
+    IO.mapOptional("repeat", R.Repeat);
+    IO.mapRequired("wall_time", R.WallTime);
+    IO.mapOptional("user_time", R.UserTime);
+    IO.mapOptional("peak_memory", R.PeakMemory);
+    IO.mapRequired("modules", R.Modules);
+  }
+};
+}
+}
+
+static bool readResults(StringRef Path, BenchResults &R) {
+  OwningPtr<MemoryBuffer> Buffer;
+  if (error_code EC = MemoryBuffer::getFileOrSTDIN(Path, Buffer)) {
+    errs() << ProgName << ": " << Path << ": " << EC.message() << '\n';
+    return false;
+  }
+  yaml::Input YIn(Buffer->getBuffer());
+  YIn >> R;
+  if (YIn.error()) {
+    errs() << ProgName << ": " << Path << ": malformed results\n";
+    return false;
+  }
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// Comparing
+
+static void printHeader(raw_ostream &OS, const char *What) {
+  OS << format("%-40s", What) << "   Base (s)    New (s)    Change\n";
+}
+
+/// printChange - Print the base and new times and the change between them,
+/// and return true if it is a regression beyond the threshold.
+static bool printChange(raw_ostream &OS, StringRef Name, double Base,
+                        double New) {
+  double Change = Base > 0 ? (New - Base) / Base * 100 : 0;
+  bool Regressed = Change > Threshold;
+  OS << format("%-40s %10.4f %10.4f %+8.1f%%", Name.str().c_str(), Base, New,
+               Change);
+  if (Regressed)
+    OS << "  regressed";
+  OS << '\n';
+  return Regressed;
+}
+
+namespace {
+struct PassChange {
+  std::string Name;
+  double Base, New;
+  PassChange() : Base(0), New(0) {}
+};
+
+struct ChangesMore {
+  bool operator()(const PassChange &LHS, const PassChange &RHS) const {
+    return std::fabs(LHS.New - LHS.Base) > std::fabs(RHS.New - RHS.Base);
+  }
+};
+}
+
+/// compareResults - Compare the wall times of two results files.  Return true
+/// if the total regressed beyond the threshold.
+static bool compareResults(raw_ostream &OS, const BenchResults &Base,
+                           const BenchResults &New) {
+  StringMap<const ModuleResult *> BaseModules;
+  for (unsigned i = 0, e = Base.Modules.size(); i != e; ++i)
+    BaseModules[Base.Modules[i].Name] = &Base.Modules[i];
+
+  printHeader(OS, "Module");
+  double BaseTotal = 0, NewTotal = 0;
+  StringMap<unsigned> PassIndex;
+  std::vector<PassChange> Passes;
+  for (unsigned i = 0, e = New.Modules.size(); i != e; ++i) {
+    const ModuleResult &NM = New.Modules[i];
+    StringMap<const ModuleResult *>::iterator I = BaseModules.find(NM.Name);
+    if (I == BaseModules.end()) {
+      OS << NM.Name << ": only in the new results\n";
+      continue;
+    }
+    const ModuleResult &BM = *I->second;
+    BaseModules.erase(I);
+    printChange(OS, NM.Name, BM.WallTime, NM.WallTime);
+    BaseTotal += BM.WallTime;
+    NewTotal += NM.WallTime;
+
+    for (unsigned Side = 0; Side != 2; ++Side) {
+      const std::vector<PassResult> &PTs = Side ? NM.PassTimes : BM.PassTimes;
+      for (unsigned j = 0, je = PTs.size(); j != je; ++j) {
+        StringMapEntry<unsigned> &PI =
+          PassIndex.GetOrCreateValue(PTs[j].Name, Passes.size());
+        if (PI.getValue() == Passes.size()) {
+          Passes.push_back(PassChange());
+          Passes.back().Name = PTs[j].Name;
+        }
+        (Side ? Passes[PI.getValue()].New : Passes[PI.getValue()].Base) +=
+          PTs[j].WallTime;
+      }
+    }
+  }
+  for (unsigned i = 0, e = Base.Modules.size(); i != e; ++i)
+    if (BaseModules.count(Base.Modules[i].Name))
+      OS << Base.Modules[i].Name << ": only in the base results\n";
+
+  OS << '\n';
+  bool Regressed = printChange(OS, "Total", BaseTotal, NewTotal);
+
+  if (!Passes.empty() && ComparePasses) {
+    std::stable_sort(Passes.begin(), Passes.end(), ChangesMore());
+    OS << '\n';
+    printHeader(OS, "Pass");
+    for (unsigned i = 0, e = std::min<size_t>(ComparePasses, Passes.size());
+         i != e; ++i)
+      printChange(OS, Passes[i].Name, Passes[i].Base, Passes[i].New);
+  }
+  return Regressed;
+}
+
+//===----------------------------------------------------------------------===//
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  ProgName = argv[0];
+
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  InitializeAllAsmPrinters();
+
+  PassRegistry &Registry = *PassRegistry::getPassRegistry();
+  initializeCore(Registry);
+  initializeScalarOpts(Registry);
+  initializeObjCARCOpts(Registry);
+  initializeVectorization(Registry);
+  initializeIPO(Registry);
+  initializeAnalysis(Registry);
+  initializeIPA(Registry);
+  initializeTransformUtils(Registry);
+  initializeInstCombine(Registry);
+  initializeInstrumentation(Registry);
+  initializeTarget(Registry);
+  initializeCodeGen(Registry);
+
+  cl::ParseCommandLineOptions(argc, argv, "llvm compile-time benchmark\n");
+
+  std::string ErrorInfo;
+  tool_output_file Out(OutputFilename.c_str(), ErrorInfo, sys::fs::F_None);
+  if (!ErrorInfo.empty()) {
+    errs() << ProgName << ": " << ErrorInfo << '\n';
+    return 1;
+  }
+
+  if (Compare) {
+    if (InputPaths.size() != 2) {
+      errs() << ProgName << ": -compare takes two results files\n";
+      return 1;
+    }
+    BenchResults Base, New;
+    if (!readResults(InputPaths[0], Base) || !readResults(InputPaths[1], New))
+      return 1;
+    bool Regressed = compareResults(Out.os(), Base, New);
+    Out.keep();
+    return Regressed ? 1 : 0;
+  }
+
+  if (Repeat == 0) {
+    errs() << ProgName << ": -repeat must be at least 1\n";
+    return 1;
+  }
+  if (!PassList.empty()) {
+    SmallVector<StringRef, 16> Names;
+    StringRef(PassList).split(Names, ",", -1, false);
+    for (unsigned i = 0, e = Names.size(); i != e; ++i)
+      if (!Registry.getPassInfo(Names[i].trim())) {
+        errs() << ProgName << ": unknown pass '" << Names[i].trim() << "'\n";
+        return 1;
+      }
+  }
+
+  std::vector<std::string> Files;
+  if (!collectInputs(Files))
+    return 1;
+
+  std::string Stress = StressTool;
+  if (!StressSizes.empty() && Stress.empty()) {
+    Stress = findStressTool(argv[0]);
+    if (Stress.empty()) {
+      errs() << ProgName << ": cannot find llvm-stress\n";
+      return 1;
+    }
+  }
+
+  BenchResults Results;
+  Results.Passes = PassList;
+  Results.OptLevel = OptLevel;
+  Results.CodeGen = !DisableCodeGen;
+  Results.Repeat = Repeat;
+
+  PassTimer Timer;
+  for (unsigned i = 0, e = Files.size(); i != e; ++i) {
+    ModuleResult Result;
+    Result.Name = Files[i];
+    if (!benchmarkModule(Files[i], Result, Timer))
+      return 1;
+    Results.Modules.push_back(Result);
+  }
+
+  for (unsigned i = 0, e = StressSizes.size(); i != e; ++i) {
+    SmallString<128> Path;
+    if (!generateStressModule(Stress, StressSizes[i], Path))
+      return 1;
+    ModuleResult Result;
+    Result.Name = "llvm-stress -size=" + utostr(StressSizes[i]) +
+                  " -seed=" + utostr(StressSeed);
+    bool Success = benchmarkModule(Path, Result, Timer);
+    sys::fs::remove(Path.str());
+    if (!Success)
+      return 1;
+    Results.Modules.push_back(Result);
+  }
+
+  for (unsigned i = 0, e = Results.Modules.size(); i != e; ++i) {
+    Results.WallTime += Results.Modules[i].WallTime;
+    Results.UserTime += Results.Modules[i].UserTime;
+  }
+  Results.PeakMemory = sys::Process::GetPeakMemoryUsage();
+
+  writeResults(Out.os(), Results);
+  Out.keep();
+  return 0;
+}
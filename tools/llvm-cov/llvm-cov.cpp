@@ -12,14 +12,21 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/GCOV.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryObject.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/system_error.h"
+#include <algorithm>
+#include <vector>
 using namespace llvm;
 
 static cl::opt<bool>
@@ -34,6 +41,126 @@ InputGCDA("gcda", cl::desc("<input gcda file>"), cl::init(""));
 static cl::opt<std::string>
 OutputFile("o", cl::desc("<output llvm-cov file>"), cl::init("-"));
 
+static cl::list<std::string>
+InputGCNOs(cl::Positional, cl::ZeroOrMore,
+           cl::desc("<gcno files to merge into one report>"));
+
+static cl::opt<std::string>
+SummaryFile("summary", cl::desc("Write an lcov tracefile of the line counts"),
+            cl::value_desc("filename"), cl::init(""));
+
+static cl::opt<unsigned>
+NumThreads("threads", cl::init(1),
+           cl::desc("Number of threads to read coverage files on"),
+           cl::value_desc("N"));
+
+/// writeSummary - Write the lcov tracefile asked for with -summary, if any.
+static bool writeSummary(const FileInfo &FI) {
+  if (SummaryFile.empty())
+    return true;
+  std::string ErrorInfo;
+  raw_fd_ostream SummaryOS(SummaryFile.c_str(), ErrorInfo);
+  if (!ErrorInfo.empty()) {
+    errs() << ErrorInfo << "\n";
+    return false;
+  }
+  FI.printSummary(SummaryOS);
+  return true;
+}
+
+/// readCoverageFile - Read the .gcno or .gcda file Filename into GF.
+static bool readCoverageFile(StringRef Filename, GCOVFile &GF,
+                             raw_ostream &ErrOS) {
+  OwningPtr<MemoryBuffer> Buff;
+  if (error_code ec = MemoryBuffer::getFileOrSTDIN(Filename, Buff)) {
+    ErrOS << Filename << ": " << ec.message() << "\n";
+    return false;
+  }
+  GCOVBuffer GB(Buff.get());
+  if (!GF.read(GB)) {
+    ErrOS << Filename << ": invalid coverage file\n";
+    return false;
+  }
+  return true;
+}
+
+/// readTranslationUnit - Add the line counts of the translation unit with
+/// the graph file GCNO to FI.  The data file is the .gcda file next to it;
+/// if there is none the unit never ran and all of its counts are zero.
+static bool readTranslationUnit(StringRef GCNO, FileInfo &FI,
+                                raw_ostream &ErrOS) {
+  GCOVFile GF;
+  if (!readCoverageFile(GCNO, GF, ErrOS))
+    return false;
+  SmallString<128> GCDA(GCNO);
+  sys::path::replace_extension(GCDA, "gcda");
+  if (sys::fs::exists(GCDA.str()) && !readCoverageFile(GCDA, GF, ErrOS))
+    return false;
+
+  // The run and program counts of FI are replaced, not added to, so collect
+  // into a fresh FileInfo and merge that in.
+  FileInfo Unit;
+  GF.collectLineCounts(Unit);
+  FI.merge(Unit);
+  return true;
+}
+
+namespace {
+  /// MergeJob - The translation units read by runMergeJob.  Each thread
+  /// merges the units it reads into its own FileInfo.
+  struct MergeJob {
+    std::vector<std::string> Files;
+    std::vector<std::string> Errors;
+    std::vector<FileInfo> Results;
+    volatile sys::cas_flag Next;
+    volatile sys::cas_flag NextResult;
+  };
+}
+
+static void runMergeJob(void *Arg) {
+  MergeJob *Job = static_cast<MergeJob *>(Arg);
+  FileInfo &FI = Job->Results[sys::AtomicIncrement(&Job->NextResult) - 1];
+  for (;;) {
+    unsigned Item = sys::AtomicIncrement(&Job->Next) - 1;
+    if (Item >= Job->Files.size())
+      return;
+    raw_string_ostream ErrOS(Job->Errors[Item]);
+    readTranslationUnit(Job->Files[Item], FI, ErrOS);
+  }
+}
+
+/// mergeTranslationUnits - Read the translation units of InputGCNOs, on
+/// several threads if asked to, and print one report of their merged line
+/// counts.  Each source file is read once, however many units include it.
+static int mergeTranslationUnits(raw_fd_ostream &OS) {
+  MergeJob Job;
+  Job.Files.assign(InputGCNOs.begin(), InputGCNOs.end());
+  Job.Errors.resize(Job.Files.size());
+  Job.Results.resize(std::max(1U, std::min<unsigned>(NumThreads,
+                                                     Job.Files.size())));
+  Job.Next = 0;
+  Job.NextResult = 0;
+  std::vector<void *> Work(Job.Results.size(), &Job);
+  if (Work.size() == 1)
+    runMergeJob(&Job);
+  else
+    llvm_execute_on_threads(runMergeJob, &Work[0], Work.size());
+
+  bool HadError = false;
+  for (unsigned I = 0, E = Job.Errors.size(); I != E; ++I) {
+    errs() << Job.Errors[I];
+    HadError |= !Job.Errors[I].empty();
+  }
+
+  FileInfo &FI = Job.Results[0];
+  for (unsigned I = 1, E = Job.Results.size(); I != E; ++I)
+    FI.merge(Job.Results[I]);
+  FI.print(OS, "-", "-");
+
+  if (!writeSummary(FI))
+    return 1;
+  return HadError;
+}
 
 //===----------------------------------------------------------------------===//
 int main(int argc, char **argv) {
@@ -49,6 +176,15 @@ int main(int argc, char **argv) {
   if (!ErrorInfo.empty())
     errs() << ErrorInfo << "\n";
 
+  if (!InputGCNOs.empty()) {
+    if (!InputGCNO.empty() || !InputGCDA.empty() || DumpGCOV) {
+      errs() << argv[0] << ": -gcno, -gcda and -dump cannot be used with "
+             << "positional .gcno files\n";
+      return 1;
+    }
+    return mergeTranslationUnits(OS);
+  }
+
   GCOVFile GF;
   if (InputGCNO.empty())
     errs() << " " << argv[0] << ": No gcov input file!\n";
@@ -84,5 +220,7 @@ int main(int argc, char **argv) {
   FileInfo FI;
   GF.collectLineCounts(FI);
   FI.print(OS, InputGCNO, InputGCDA);
+  if (!writeSummary(FI))
+    return 1;
   return 0;
 }
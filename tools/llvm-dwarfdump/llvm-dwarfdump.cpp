@@ -52,6 +52,18 @@ static cl::opt<bool>
 PrintInlining("inlining", cl::init(false),
               cl::desc("Print all inlined frames for a given address"));
 
+static cl::list<std::string>
+FindNames("find",
+          cl::desc("Print the debug information entries with the given name, "
+                   "using the name indexes of the input if it has any"),
+          cl::value_desc("name"));
+
+static cl::opt<unsigned>
+NumThreads("j", cl::init(1),
+           cl::desc("Number of threads to parse compile units and line "
+                    "tables with"),
+           cl::value_desc("N"));
+
 static cl::opt<DIDumpType>
 DumpType("debug-dump", cl::init(DIDT_All),
   cl::desc("Dump of debug sections:"),
@@ -98,9 +110,21 @@ static void DumpInput(const StringRef &Filename) {
     return;
   }
 
-  OwningPtr<DIContext> DICtx(DIContext::getDWARFContext(Obj.get()));
+  OwningPtr<DIContext> DICtx(DIContext::getDWARFContext(Obj.get(),
+                                                        NumThreads));
 
-  if (Address == -1ULL) {
+  if (!FindNames.empty()) {
+    outs() << Filename
+           << ":\tfile format " << Obj->getFileFormatName() << "\n";
+    for (unsigned i = 0, e = FindNames.size(); i != e; ++i) {
+      SmallVector<uint32_t, 4> Offsets;
+      DICtx->findDIEOffsetsByName(FindNames[i], Offsets);
+      if (Offsets.empty())
+        outs() << "\n" << FindNames[i] << ": not found\n";
+      for (unsigned j = 0, je = Offsets.size(); j != je; ++j)
+        DICtx->dumpDIE(outs(), Offsets[j]);
+    }
+  } else if (Address == -1ULL) {
     outs() << Filename
            << ":\tfile format " << Obj->getFileFormatName() << "\n\n";
     // Dump the complete DWARF structure.
@@ -12,16 +12,21 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
 #include "llvm/LTO/LTOModule.h"
+#include "llvm/LTO/LTOSummary.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/system_error.h"
 
 using namespace llvm;
 
@@ -37,6 +42,37 @@ static cl::opt<bool>
 DisableGVNLoadPRE("disable-gvn-loadpre", cl::init(false),
   cl::desc("Do not run the GVN load PRE pass"));
 
+static cl::opt<unsigned>
+Parallelism("j", cl::init(1),
+  cl::desc("Number of partitions to generate code for in parallel"),
+  cl::value_desc("N"));
+
+static cl::opt<bool>
+ThinLTOSummary("thinlto-summary", cl::init(false),
+  cl::desc("Write the function summary of each input bitcode file to "
+           "<file>.summary"));
+
+static cl::opt<bool>
+ThinLTOLink("thinlto-link", cl::init(false),
+  cl::desc("Read the input function summaries and write the import list of "
+           "each module to <module>.imports"));
+
+static cl::opt<unsigned>
+ThinLTOImportLimit("thinlto-import-limit", cl::init(100),
+  cl::desc("Only import functions of at most N instructions"),
+  cl::value_desc("N"));
+
+static cl::opt<std::string>
+ThinLTOImports("thinlto-imports", cl::init(""),
+  cl::desc("Compile the single input module on its own, importing the "
+           "functions of the given import list"),
+  cl::value_desc("filename"));
+
+static cl::opt<std::string>
+CacheDir("cache-dir", cl::init(""),
+  cl::desc("Cache the object files of partitions in the given directory"),
+  cl::value_desc("directory"));
+
 static cl::list<std::string>
 InputFilenames(cl::Positional, cl::OneOrMore,
   cl::desc("<input bitcode files>"));
@@ -62,6 +98,69 @@ struct ModuleInfo {
 };
 }
 
+/// writeSummaries - Write the function summary of each input bitcode file
+/// next to it.
+static int writeSummaries(const char *ProgName, const TargetOptions &Options) {
+  for (unsigned i = 0; i < InputFilenames.size(); ++i) {
+    std::string Error;
+    OwningPtr<LTOModule> Module(
+      LTOModule::makeLTOModule(InputFilenames[i].c_str(), Options, Error));
+    if (!Error.empty()) {
+      errs() << ProgName << ": error loading file '" << InputFilenames[i]
+             << "': " << Error << "\n";
+      return 1;
+    }
+
+    LTOModuleSummary Summary;
+    Summary.build(*Module->getLLVVMModule(), InputFilenames[i]);
+
+    std::string SummaryFilename = InputFilenames[i] + ".summary";
+    raw_fd_ostream OS(SummaryFilename.c_str(), Error, sys::fs::F_None);
+    if (!Error.empty()) {
+      errs() << ProgName << ": error opening the file '" << SummaryFilename
+             << "': " << Error << "\n";
+      return 1;
+    }
+    Summary.write(OS);
+  }
+  return 0;
+}
+
+/// thinLink - Read the input function summaries and write the import list
+/// of each module next to its bitcode file.
+static int thinLink(const char *ProgName) {
+  std::vector<LTOModuleSummary> Summaries(InputFilenames.size());
+  for (unsigned i = 0; i < InputFilenames.size(); ++i) {
+    OwningPtr<MemoryBuffer> Buffer;
+    std::string Error;
+    if (error_code EC = MemoryBuffer::getFile(InputFilenames[i], Buffer))
+      Error = EC.message();
+    else
+      Summaries[i].read(Buffer->getBuffer(), Error);
+    if (!Error.empty()) {
+      errs() << ProgName << ": error loading file '" << InputFilenames[i]
+             << "': " << Error << "\n";
+      return 1;
+    }
+  }
+
+  std::vector<LTOImportList> Imports;
+  computeLTOImports(Summaries, ThinLTOImportLimit, Imports);
+
+  for (unsigned i = 0; i < Imports.size(); ++i) {
+    std::string Error;
+    std::string ImportsFilename = Imports[i].ModulePath + ".imports";
+    raw_fd_ostream OS(ImportsFilename.c_str(), Error, sys::fs::F_None);
+    if (!Error.empty()) {
+      errs() << ProgName << ": error opening the file '" << ImportsFilename
+             << "': " << Error << "\n";
+      return 1;
+    }
+    Imports[i].write(OS);
+  }
+  return 0;
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -98,6 +197,15 @@ int main(int argc, char **argv) {
   Options.EnableSegmentedStacks = SegmentedStacks;
   Options.UseInitArray = UseInitArray;
 
+  if (ThinLTOSummary)
+    return writeSummaries(argv[0], Options);
+  if (ThinLTOLink)
+    return thinLink(argv[0]);
+  if (!ThinLTOImports.empty() && InputFilenames.size() != 1) {
+    errs() << argv[0] << ": -thinlto-imports takes a single input file\n";
+    return 1;
+  }
+
   unsigned BaseArg = 0;
 
   LTOCodeGenerator CodeGen;
@@ -139,6 +247,33 @@ int main(int argc, char **argv) {
       if (Scope != LTO_SYMBOL_SCOPE_DEFAULT_CAN_BE_HIDDEN)
         KeptDSOSyms.push_back(Name);
     }
+
+    // A module compiled on its own keeps every symbol it defines, since the
+    // other modules may refer to any of them.
+    if (!ThinLTOImports.empty()) {
+      for (unsigned I = 0; I < NumSyms; ++I) {
+        lto_symbol_attributes Attrs = Module->getSymbolAttributes(I);
+        if ((Attrs & LTO_SYMBOL_SCOPE_MASK) != LTO_SYMBOL_SCOPE_INTERNAL &&
+            (Attrs & LTO_SYMBOL_DEFINITION_MASK) !=
+              LTO_SYMBOL_DEFINITION_UNDEFINED)
+          CodeGen.addMustPreserveSymbol(Module->getSymbolName(I));
+      }
+    }
+  }
+
+  if (!ThinLTOImports.empty()) {
+    OwningPtr<MemoryBuffer> Buffer;
+    std::string Error;
+    LTOImportList Imports;
+    if (error_code EC = MemoryBuffer::getFile(ThinLTOImports, Buffer))
+      Error = EC.message();
+    else if (Imports.read(Buffer->getBuffer(), Error))
+      CodeGen.importFunctions(Imports, Error);
+    if (!Error.empty()) {
+      errs() << argv[0] << ": error importing from '" << ThinLTOImports
+             << "': " << Error << "\n";
+      return 1;
+    }
   }
 
   // Add all the exported symbols to the table of symbols to preserve.
@@ -149,7 +284,34 @@ int main(int argc, char **argv) {
   for (unsigned i = 0; i < KeptDSOSyms.size(); ++i)
     CodeGen.addMustPreserveSymbol(KeptDSOSyms[i].c_str());
 
-  if (!OutputFilename.empty()) {
+  if (Parallelism > 1 || !CacheDir.empty()) {
+    std::string ErrorInfo;
+    const char **OutputNames = NULL;
+    unsigned NumOutputs = 0;
+    CodeGen.setParallelism(Parallelism);
+    CodeGen.setCacheDir(CacheDir.c_str());
+    if (!CodeGen.compile_to_files(&OutputNames, &NumOutputs, DisableOpt,
+                                  DisableInline, DisableGVNLoadPRE,
+                                  ErrorInfo)) {
+      errs() << argv[0]
+             << ": error compiling the code: " << ErrorInfo
+             << "\n";
+      return 1;
+    }
+
+    for (unsigned i = 0; i != NumOutputs; ++i) {
+      std::string Name = OutputNames[i];
+      if (!OutputFilename.empty()) {
+        Name = OutputFilename + "." + utostr(i);
+        if (error_code EC = sys::fs::rename(OutputNames[i], Name)) {
+          errs() << argv[0] << ": error writing the file '" << Name
+                 << "': " << EC.message() << "\n";
+          return 1;
+        }
+      }
+      outs() << "Wrote native object file '" << Name << "'\n";
+    }
+  } else if (!OutputFilename.empty()) {
     size_t len = 0;
     std::string ErrorInfo;
     const void *Code = CodeGen.compile(&len, DisableOpt, DisableInline,
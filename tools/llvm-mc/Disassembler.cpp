@@ -19,16 +19,25 @@
 #include "llvm/MC/MCInst.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSubtargetInfo.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/MemoryObject.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
 
 typedef std::vector<std::pair<unsigned char, const char*> > ByteArrayTy;
 
+static cl::opt<unsigned>
+BenchmarkIterations("disassemble-benchmark", cl::Hidden,
+                    cl::desc("Decode the input this many more times and "
+                             "report the decoding throughput"),
+                    cl::init(0));
+
 namespace {
 class VectorMemoryObject : public MemoryObject {
 private:
@@ -94,6 +103,42 @@ static bool PrintInsts(const MCDisassembler &DisAsm,
   return false;
 }
 
+/// BenchmarkInsts - Decode every byte array Iterations times without
+/// printing anything, and report the throughput on errs().
+static void BenchmarkInsts(const MCDisassembler &DisAsm,
+                           const std::vector<ByteArrayTy> &ByteArrays,
+                           unsigned Iterations) {
+  uint64_t NumInsts = 0, NumBytes = 0;
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  for (unsigned i = 0; i != Iterations; ++i) {
+    for (unsigned j = 0, e = ByteArrays.size(); j != e; ++j) {
+      VectorMemoryObject memoryObject(ByteArrays[j]);
+      uint64_t Size;
+      for (uint64_t Index = 0; Index < ByteArrays[j].size(); Index += Size) {
+        MCInst Inst;
+        if (DisAsm.getInstruction(Inst, Size, memoryObject, Index, nulls(),
+                                  nulls()) == MCDisassembler::Fail &&
+            Size == 0)
+          Size = 1;
+        ++NumInsts;
+      }
+      NumBytes += ByteArrays[j].size();
+    }
+  }
+  TimeRecord Time = TimeRecord::getCurrentTime(false);
+  Time -= Start;
+
+  double Seconds = Time.getWallTime();
+  errs() << "decoded " << NumInsts << " instructions (" << NumBytes
+         << " bytes) in " << format("%.4f", Seconds) << "s";
+  if (Seconds > 0)
+    errs() << ": " << format("%.1f", NumInsts / Seconds / 1e6)
+           << " M insts/s, "
+           << format("%.1f", NumBytes / Seconds / (1024.0 * 1024.0))
+           << " MB/s";
+  errs() << "\n";
+}
+
 static bool SkipToToken(StringRef &Str) {
   while (!Str.empty() && Str.find_first_not_of(" \t\r\n#,") != 0) {
     // Strip horizontal whitespace and commas.
@@ -171,6 +216,7 @@ int Disassembler::disassemble(const Target &T,
 
   // Convert the input to a vector for disassembly.
   ByteArrayTy ByteArray;
+  std::vector<ByteArrayTy> BenchmarkArrays;
   StringRef Str = Buffer.getBuffer();
   bool InAtomicBlock = false;
 
@@ -200,9 +246,12 @@ int Disassembler::disassemble(const Target &T,
     // It's a real token, get the bytes and emit them
     ErrorOccurred |= ByteArrayFromString(ByteArray, Str, SM);
 
-    if (!ByteArray.empty())
+    if (!ByteArray.empty()) {
       ErrorOccurred |= PrintInsts(*DisAsm, ByteArray, SM, Out, Streamer,
                                   InAtomicBlock);
+      if (BenchmarkIterations)
+        BenchmarkArrays.push_back(ByteArray);
+    }
   }
 
   if (InAtomicBlock) {
@@ -211,5 +260,8 @@ int Disassembler::disassemble(const Target &T,
     ErrorOccurred = true;
   }
 
+  if (BenchmarkIterations)
+    BenchmarkInsts(*DisAsm, BenchmarkArrays, BenchmarkIterations);
+
   return ErrorOccurred;
 }
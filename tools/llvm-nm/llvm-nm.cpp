@@ -25,6 +25,7 @@
 #include "llvm/Object/MachO.h"
 #include "llvm/Object/MachOUniversal.h"
 #include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
@@ -33,6 +34,7 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
 #include <algorithm>
@@ -120,6 +122,10 @@ namespace {
     cl::desc("Print the archive map"));
   cl::alias ArchiveMaps("s", cl::desc("Alias for --print-armap"),
                                  cl::aliasopt(ArchiveMap));
+
+  cl::opt<unsigned> NumThreads("threads", cl::init(1),
+    cl::desc("Number of threads to list archive members on"),
+    cl::value_desc("N"));
   bool PrintAddress = true;
 
   bool MultipleFiles = false;
@@ -130,8 +136,9 @@ namespace {
 }
 
 
-static void error(Twine message, Twine path = Twine()) {
-  errs() << ToolName << ": " << path << ": " << message << ".\n";
+static void error(Twine message, Twine path = Twine(),
+                  raw_ostream &OS = errs()) {
+  OS << ToolName << ": " << path << ": " << message << ".\n";
 }
 
 static bool error(error_code ec, Twine path = Twine()) {
@@ -185,12 +192,33 @@ namespace {
       return false;
   }
 
-  StringRef CurrentFilename;
   typedef std::vector<NMSymbol> SymbolListT;
-  SymbolListT SymbolList;
+
+  /// NMOutput - The streams a file or archive member is listed to.  With
+  /// -threads, archive members are listed into buffers of their own and
+  /// printed in archive order once they are all done.
+  struct NMOutput {
+    raw_ostream &OS;
+    raw_ostream &ErrOS;
+    bool HadError;
+
+    NMOutput(raw_ostream &OS, raw_ostream &ErrOS)
+      : OS(OS), ErrOS(ErrOS), HadError(false) {}
+  };
+}
+
+static bool error(error_code ec, NMOutput &Out) {
+  if (ec) {
+    error(ec.message(), Twine(), Out.ErrOS);
+    Out.HadError = true;
+    return true;
+  }
+  return false;
 }
 
-static void SortAndPrintSymbolList() {
+static void SortAndPrintSymbolList(SymbolListT &SymbolList,
+                                   StringRef CurrentFilename,
+                                   raw_ostream &OS) {
   if (!NoSort) {
     if (NumericSort)
       std::sort(SymbolList.begin(), SymbolList.end(), CompareSymbolAddress);
@@ -201,11 +229,11 @@ static void SortAndPrintSymbolList() {
   }
 
   if (OutputFormat == posix && MultipleFiles) {
-    outs() << '\n' << CurrentFilename << ":\n";
+    OS << '\n' << CurrentFilename << ":\n";
   } else if (OutputFormat == bsd && MultipleFiles) {
-    outs() << "\n" << CurrentFilename << ":\n";
+    OS << "\n" << CurrentFilename << ":\n";
   } else if (OutputFormat == sysv) {
-    outs() << "\n\nSymbols from " << CurrentFilename << ":\n\n"
+    OS << "\n\nSymbols from " << CurrentFilename << ":\n\n"
            << "Name                  Value   Class        Type"
            << "         Size   Line  Section\n";
   }
@@ -234,28 +262,26 @@ static void SortAndPrintSymbolList() {
       format("%08" PRIx64, i->Size).print(SymbolSizeStr, sizeof(SymbolSizeStr));
 
     if (OutputFormat == posix) {
-      outs() << i->Name << " " << i->TypeChar << " "
+      OS << i->Name << " " << i->TypeChar << " "
              << SymbolAddrStr << SymbolSizeStr << "\n";
     } else if (OutputFormat == bsd) {
       if (PrintAddress)
-        outs() << SymbolAddrStr << ' ';
+        OS << SymbolAddrStr << ' ';
       if (PrintSize) {
-        outs() << SymbolSizeStr;
+        OS << SymbolSizeStr;
         if (i->Size != object::UnknownAddressOrSize)
-          outs() << ' ';
+          OS << ' ';
       }
-      outs() << i->TypeChar << " " << i->Name  << "\n";
+      OS << i->TypeChar << " " << i->Name  << "\n";
     } else if (OutputFormat == sysv) {
       std::string PaddedName (i->Name);
       while (PaddedName.length () < 20)
         PaddedName += " ";
-      outs() << PaddedName << "|" << SymbolAddrStr << "|   "
+      OS << PaddedName << "|" << SymbolAddrStr << "|   "
              << i->TypeChar
              << "  |                  |" << SymbolSizeStr << "|     |\n";
     }
   }
-
-  SymbolList.clear();
 }
 
 static char TypeCharForSymbol(GlobalValue &GV) {
@@ -275,7 +301,8 @@ static char TypeCharForSymbol(GlobalValue &GV) {
                                                            return '?';
 }
 
-static void DumpSymbolNameForGlobalValue(GlobalValue &GV) {
+static void DumpSymbolNameForGlobalValue(GlobalValue &GV,
+                                         SymbolListT &SymbolList) {
   // Private linkage and available_externally linkage don't exist in symtab.
   if (GV.hasPrivateLinkage() ||
       GV.hasLinkerPrivateLinkage() ||
@@ -294,16 +321,72 @@ static void DumpSymbolNameForGlobalValue(GlobalValue &GV) {
   SymbolList.push_back(s);
 }
 
-static void DumpSymbolNamesFromModule(Module *M) {
-  CurrentFilename = M->getModuleIdentifier();
-  std::for_each (M->begin(), M->end(), DumpSymbolNameForGlobalValue);
-  std::for_each (M->global_begin(), M->global_end(),
-                 DumpSymbolNameForGlobalValue);
+static char TypeCharForBitcodeSymbol(const BitcodeSymbol &Sym) {
+  bool Internal = GlobalValue::isInternalLinkage(Sym.Linkage);
+  bool IsFunction = Sym.Kind == BitcodeSymbol::Function;
+  bool IsVariable = Sym.Kind == BitcodeSymbol::Variable;
+  if (Sym.IsDeclaration)                                  return 'U';
+  if (GlobalValue::isLinkOnceLinkage(Sym.Linkage))        return 'C';
+  if (GlobalValue::isCommonLinkage(Sym.Linkage))          return 'C';
+  if (GlobalValue::isWeakLinkage(Sym.Linkage))            return 'W';
+  if (IsFunction && Internal)                             return 't';
+  if (IsFunction)                                         return 'T';
+  if (IsVariable && Internal)                             return 'd';
+  if (IsVariable)                                         return 'D';
+  if (Sym.IsAliasOfFunction)                              return 'T';
+  if (Sym.IsAliasOfVariable)                              return 'D';
+                                                          return '?';
+}
+
+/// DumpSymbolNamesFromBitcode - List the symbols of a bitcode file from its
+/// symbol table block, without parsing the module.  Returns false if the
+/// file has no symbol table.
+static bool DumpSymbolNamesFromBitcode(MemoryBuffer *Buffer,
+                                       LLVMContext &Context,
+                                       raw_ostream &OS) {
+  std::vector<BitcodeSymbol> Symbols;
+  if (!getBitcodeSymbols(Buffer, Context, Symbols))
+    return false;
+
+  SymbolListT SymbolList;
+  for (unsigned i = 0, e = Symbols.size(); i != e; ++i) {
+    const BitcodeSymbol &Sym = Symbols[i];
+    if (Sym.Kind == BitcodeSymbol::Alias && WithoutAliases)
+      continue;
+    // Private linkage and available_externally linkage don't exist in symtab.
+    if (GlobalValue::isPrivateLinkage(Sym.Linkage) ||
+        GlobalValue::isLinkerPrivateLinkage(Sym.Linkage) ||
+        GlobalValue::isLinkerPrivateWeakLinkage(Sym.Linkage) ||
+        GlobalValue::isAvailableExternallyLinkage(Sym.Linkage))
+      continue;
+    if (GlobalValue::isLocalLinkage(Sym.Linkage) && ExternalOnly)
+      continue;
+
+    NMSymbol s;
+    s.Address = object::UnknownAddressOrSize;
+    s.Size = object::UnknownAddressOrSize;
+    s.TypeChar = TypeCharForBitcodeSymbol(Sym);
+    s.Name     = Sym.Name;
+    SymbolList.push_back(s);
+  }
+
+  SortAndPrintSymbolList(SymbolList, Buffer->getBufferIdentifier(), OS);
+  return true;
+}
+
+static void DumpSymbolNamesFromModule(Module *M, raw_ostream &OS) {
+  SymbolListT SymbolList;
+  for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I)
+    DumpSymbolNameForGlobalValue(*I, SymbolList);
+  for (Module::global_iterator I = M->global_begin(), E = M->global_end();
+       I != E; ++I)
+    DumpSymbolNameForGlobalValue(*I, SymbolList);
   if (!WithoutAliases)
-    std::for_each (M->alias_begin(), M->alias_end(),
-		   DumpSymbolNameForGlobalValue);
+    for (Module::alias_iterator I = M->alias_begin(), E = M->alias_end();
+         I != E; ++I)
+      DumpSymbolNameForGlobalValue(*I, SymbolList);
 
-  SortAndPrintSymbolList();
+  SortAndPrintSymbolList(SymbolList, M->getModuleIdentifier(), OS);
 }
 
 template <class ELFT>
@@ -498,35 +581,37 @@ static error_code getSymbolNMTypeChar(MachOObjectFile &Obj, symbol_iterator I,
   return object_error::success;
 }
 
-static char getNMTypeChar(ObjectFile *Obj, symbol_iterator I) {
+static char getNMTypeChar(ObjectFile *Obj, symbol_iterator I,
+                          NMOutput &Out) {
   char Res = '?';
   if (COFFObjectFile *COFF = dyn_cast<COFFObjectFile>(Obj)) {
-    error(getSymbolNMTypeChar(*COFF, I, Res));
+    error(getSymbolNMTypeChar(*COFF, I, Res), Out);
     return Res;
   }
   if (MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(Obj)) {
-    error(getSymbolNMTypeChar(*MachO, I, Res));
+    error(getSymbolNMTypeChar(*MachO, I, Res), Out);
     return Res;
   }
 
   if (ELF32LEObjectFile *ELF = dyn_cast<ELF32LEObjectFile>(Obj)) {
-    error(getSymbolNMTypeChar(*ELF, I, Res));
+    error(getSymbolNMTypeChar(*ELF, I, Res), Out);
     return Res;
   }
   if (ELF64LEObjectFile *ELF = dyn_cast<ELF64LEObjectFile>(Obj)) {
-    error(getSymbolNMTypeChar(*ELF, I, Res));
+    error(getSymbolNMTypeChar(*ELF, I, Res), Out);
     return Res;
   }
   if (ELF32BEObjectFile *ELF = dyn_cast<ELF32BEObjectFile>(Obj)) {
-    error(getSymbolNMTypeChar(*ELF, I, Res));
+    error(getSymbolNMTypeChar(*ELF, I, Res), Out);
     return Res;
   }
   ELF64BEObjectFile *ELF = cast<ELF64BEObjectFile>(Obj);
-  error(getSymbolNMTypeChar(*ELF, I, Res));
+  error(getSymbolNMTypeChar(*ELF, I, Res), Out);
   return Res;
 }
 
-static void DumpSymbolNamesFromObject(ObjectFile *obj) {
+static void DumpSymbolNamesFromObject(ObjectFile *obj, NMOutput &Out) {
+  SymbolListT SymbolList;
   error_code ec;
   symbol_iterator ibegin = obj->begin_symbols();
   symbol_iterator iend = obj->end_symbols();
@@ -535,26 +620,125 @@ static void DumpSymbolNamesFromObject(ObjectFile *obj) {
     iend = obj->end_dynamic_symbols();
   }
   for (symbol_iterator i = ibegin; i != iend; i.increment(ec)) {
-    if (error(ec)) break;
+    if (error(ec, Out)) break;
     uint32_t symflags;
-    if (error(i->getFlags(symflags))) break;
+    if (error(i->getFlags(symflags), Out)) break;
     if (!DebugSyms && (symflags & SymbolRef::SF_FormatSpecific))
       continue;
     NMSymbol s;
     s.Size = object::UnknownAddressOrSize;
     s.Address = object::UnknownAddressOrSize;
     if (PrintSize || SizeSort) {
-      if (error(i->getSize(s.Size))) break;
+      if (error(i->getSize(s.Size), Out)) break;
     }
     if (PrintAddress)
-      if (error(i->getAddress(s.Address))) break;
-    s.TypeChar = getNMTypeChar(obj, i);
-    if (error(i->getName(s.Name))) break;
+      if (error(i->getAddress(s.Address), Out)) break;
+    s.TypeChar = getNMTypeChar(obj, i, Out);
+    if (error(i->getName(s.Name), Out)) break;
     SymbolList.push_back(s);
   }
 
-  CurrentFilename = obj->getFileName();
-  SortAndPrintSymbolList();
+  SortAndPrintSymbolList(SymbolList, obj->getFileName(), Out.OS);
+}
+
+/// DumpSymbolNamesFromArchiveMember - List the symbols of one archive member.
+/// Returns false if the rest of the archive should not be listed.
+static bool DumpSymbolNamesFromArchiveMember(const object::Archive::Child &C,
+                                             LLVMContext &Context,
+                                             NMOutput &Out) {
+  OwningPtr<Binary> child;
+  if (C.getAsBinary(child)) {
+    // Try opening it as a bitcode file.
+    OwningPtr<MemoryBuffer> buff;
+    if (error(C.getMemoryBuffer(buff), Out))
+      return false;
+    if (buff && DumpSymbolNamesFromBitcode(buff.get(), Context, Out.OS))
+      return true;
+    Module *Result = 0;
+    std::string ErrorMessage;
+    if (buff)
+      Result = ParseBitcodeFile(buff.get(), Context, &ErrorMessage);
+
+    if (Result) {
+      DumpSymbolNamesFromModule(Result, Out.OS);
+      delete Result;
+    }
+    return true;
+  }
+  if (object::ObjectFile *o = dyn_cast<ObjectFile>(child.get())) {
+    Out.OS << o->getFileName() << ":\n";
+    DumpSymbolNamesFromObject(o, Out);
+  }
+  return true;
+}
+
+namespace {
+  /// MemberJob - The archive members listed by runMemberJob, and the text
+  /// listed for each.
+  struct MemberJob {
+    std::vector<object::Archive::Child> Members;
+    std::vector<std::string> Outputs;
+    std::vector<std::string> Errors;
+    std::vector<char> Failed;   ///< HadError for each member
+    std::vector<char> Stop;     ///< The member asked for listing to stop
+    volatile sys::cas_flag Next;
+  };
+}
+
+static void runMemberJob(void *Arg) {
+  MemberJob *Job = static_cast<MemberJob *>(Arg);
+  // Bitcode members need a context, and the global one cannot be shared
+  // between threads.
+  LLVMContext Context;
+  for (;;) {
+    unsigned Item = sys::AtomicIncrement(&Job->Next) - 1;
+    if (Item >= Job->Members.size())
+      return;
+    raw_string_ostream OS(Job->Outputs[Item]);
+    raw_string_ostream ErrOS(Job->Errors[Item]);
+    NMOutput Out(OS, ErrOS);
+    Job->Stop[Item] =
+        !DumpSymbolNamesFromArchiveMember(Job->Members[Item], Context, Out);
+    Job->Failed[Item] = Out.HadError;
+  }
+}
+
+/// DumpSymbolNamesFromArchive - List the symbols of every member of A.  With
+/// more than one thread the members are listed concurrently; the output is
+/// the same as listing them one after another.
+static void DumpSymbolNamesFromArchive(object::Archive *A,
+                                       LLVMContext &Context) {
+  if (NumThreads <= 1) {
+    NMOutput Out(outs(), errs());
+    for (object::Archive::child_iterator i = A->begin_children(),
+                                         e = A->end_children(); i != e; ++i)
+      if (!DumpSymbolNamesFromArchiveMember(*i, Context, Out))
+        break;
+    HadError |= Out.HadError;
+    return;
+  }
+
+  MemberJob Job;
+  for (object::Archive::child_iterator i = A->begin_children(),
+                                       e = A->end_children(); i != e; ++i)
+    Job.Members.push_back(*i);
+  unsigned NumMembers = Job.Members.size();
+  Job.Outputs.resize(NumMembers);
+  Job.Errors.resize(NumMembers);
+  Job.Failed.resize(NumMembers);
+  Job.Stop.resize(NumMembers);
+  Job.Next = 0;
+  std::vector<void *> Work(std::min<size_t>(NumThreads, NumMembers), &Job);
+  if (!Work.empty())
+    llvm_execute_on_threads(runMemberJob, &Work[0], Work.size());
+
+  for (unsigned I = 0; I != NumMembers; ++I) {
+    outs() << Job.Outputs[I];
+    errs() << Job.Errors[I];
+    HadError |= Job.Failed[I];
+    if (Job.Stop[I])
+      break;
+  }
 }
 
 static void DumpSymbolNamesFromFile(std::string &Filename) {
@@ -571,11 +755,14 @@ static void DumpSymbolNamesFromFile(std::string &Filename) {
 
   LLVMContext &Context = getGlobalContext();
   std::string ErrorMessage;
+  NMOutput Out(outs(), errs());
   if (magic == sys::fs::file_magic::bitcode) {
+    if (DumpSymbolNamesFromBitcode(Buffer.get(), Context, outs()))
+      return;
     Module *Result = 0;
     Result = ParseBitcodeFile(Buffer.get(), Context, &ErrorMessage);
     if (Result) {
-      DumpSymbolNamesFromModule(Result);
+      DumpSymbolNamesFromModule(Result, outs());
       delete Result;
     } else {
       error(ErrorMessage, Filename);
@@ -608,29 +795,7 @@ static void DumpSymbolNamesFromFile(std::string &Filename) {
         }
       }
 
-      for (object::Archive::child_iterator i = a->begin_children(),
-                                           e = a->end_children(); i != e; ++i) {
-        OwningPtr<Binary> child;
-        if (i->getAsBinary(child)) {
-          // Try opening it as a bitcode file.
-          OwningPtr<MemoryBuffer> buff;
-          if (error(i->getMemoryBuffer(buff)))
-            return;
-          Module *Result = 0;
-          if (buff)
-            Result = ParseBitcodeFile(buff.get(), Context, &ErrorMessage);
-
-          if (Result) {
-            DumpSymbolNamesFromModule(Result);
-            delete Result;
-          }
-          continue;
-        }
-        if (object::ObjectFile *o = dyn_cast<ObjectFile>(child.get())) {
-          outs() << o->getFileName() << ":\n";
-          DumpSymbolNamesFromObject(o);
-        }
-      }
+      DumpSymbolNamesFromArchive(a, Context);
     }
   } else if (magic == sys::fs::file_magic::macho_universal_binary) {
     OwningPtr<Binary> Bin;
@@ -646,7 +811,7 @@ static void DumpSymbolNamesFromFile(std::string &Filename) {
       OwningPtr<ObjectFile> Obj;
       if (!I->getAsObjectFile(Obj)) {
         outs() << Obj->getFileName() << ":\n";
-        DumpSymbolNamesFromObject(Obj.get());
+        DumpSymbolNamesFromObject(Obj.get(), Out);
       }
     }
   } else if (magic.is_object()) {
@@ -654,13 +819,14 @@ static void DumpSymbolNamesFromFile(std::string &Filename) {
     if (error(object::createBinary(Buffer.take(), obj), Filename))
       return;
     if (object::ObjectFile *o = dyn_cast<ObjectFile>(obj.get()))
-      DumpSymbolNamesFromObject(o);
+      DumpSymbolNamesFromObject(o, Out);
   } else {
     errs() << ToolName << ": " << Filename << ": "
            << "unrecognizable file type\n";
     HadError = true;
     return;
   }
+  HadError |= Out.HadError;
 }
 
 int main(int argc, char **argv) {
@@ -42,6 +42,7 @@
 #include "llvm/Object/COFF.h"
 #include "llvm/Object/MachO.h"
 #include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
@@ -57,6 +58,7 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/system_error.h"
 #include <algorithm>
@@ -147,12 +149,25 @@ YAMLCFG("yaml-cfg",
         cl::desc("Create a CFG and write it as a YAML MCModule."),
         cl::value_desc("yaml output file"));
 
+static cl::opt<unsigned>
+NumThreads("threads", cl::init(1),
+           cl::desc("Number of threads to disassemble with, and to dump "
+                    "archive members on when only symbol tables and section "
+                    "headers are printed"),
+           cl::value_desc("N"));
+
 static StringRef ToolName;
 
-bool llvm::error(error_code ec) {
+static bool error(error_code ec, raw_ostream &OS) {
   if (!ec) return false;
 
-  outs() << ToolName << ": error reading file: " << ec.message() << ".\n";
+  OS << ToolName << ": error reading file: " << ec.message() << ".\n";
+  return true;
+}
+
+bool llvm::error(error_code ec) {
+  if (!::error(ec, outs())) return false;
+
   outs().flush();
   return true;
 }
@@ -233,6 +248,10 @@ static void emitDOTFile(const char *FileName, const MCFunction &f,
 }
 
 void llvm::DumpBytes(StringRef bytes) {
+  DumpBytes(bytes, outs());
+}
+
+void llvm::DumpBytes(StringRef bytes, raw_ostream &OS) {
   static const char hex_rep[] = "0123456789abcdef";
   // FIXME: The real way to do this is to figure out the longest instruction
   //        and align to that size before printing. I'll fix this when I get
@@ -255,7 +274,7 @@ void llvm::DumpBytes(StringRef bytes) {
   }
 
   output[sizeof(output) - 1] = 0;
-  outs() << output;
+  OS << output;
 }
 
 bool llvm::RelocAddressLess(RelocationRef a, RelocationRef b) {
@@ -265,6 +284,193 @@ bool llvm::RelocAddressLess(RelocationRef a, RelocationRef b) {
   return a_addr < b_addr;
 }
 
+namespace {
+/// @brief The MC objects that decode and print instructions.  Every thread
+/// that disassembles has its own; the target descriptions they are made from
+/// are shared.
+struct DisassemblerTools {
+  OwningPtr<MCDisassembler> DisAsm;
+  OwningPtr<const MCObjectFileInfo> MOFI;
+  OwningPtr<MCContext> Ctx;
+  OwningPtr<MCInstPrinter> IP;
+};
+}
+
+static bool createDisassemblerTools(const Target *TheTarget,
+                                    const ObjectFile *Obj,
+                                    const MCAsmInfo &AsmInfo,
+                                    const MCRegisterInfo &MRI,
+                                    const MCSubtargetInfo &STI,
+                                    const MCInstrInfo &MII,
+                                    DisassemblerTools &Tools) {
+  Tools.DisAsm.reset(TheTarget->createMCDisassembler(STI));
+  if (!Tools.DisAsm) {
+    errs() << "error: no disassembler for target " << TripleName << "\n";
+    return false;
+  }
+
+  if (Symbolize) {
+    Tools.MOFI.reset(new MCObjectFileInfo);
+    Tools.Ctx.reset(new MCContext(&AsmInfo, &MRI, Tools.MOFI.get()));
+    OwningPtr<MCRelocationInfo> RelInfo(
+      TheTarget->createMCRelocationInfo(TripleName, *Tools.Ctx.get()));
+    if (RelInfo) {
+      OwningPtr<MCSymbolizer> Symzer(
+        MCObjectSymbolizer::createObjectSymbolizer(*Tools.Ctx.get(), RelInfo,
+                                                   Obj));
+      if (Symzer)
+        Tools.DisAsm->setSymbolizer(Symzer);
+    }
+  }
+
+  int AsmPrinterVariant = AsmInfo.getAssemblerDialect();
+  Tools.IP.reset(TheTarget->createMCInstPrinter(
+      AsmPrinterVariant, AsmInfo, MII, MRI, STI));
+  if (!Tools.IP) {
+    errs() << "error: no instruction printer for target " << TripleName
+      << '\n';
+    return false;
+  }
+  return true;
+}
+
+/// @brief Disassemble [Start, End) of a section's Bytes.  The relocations in
+/// Rels from RelCur on are printed after the instructions they apply to, and
+/// the index of the first one not printed is returned.
+static unsigned DisassembleRange(DisassemblerTools &Tools, StringRef Bytes,
+                                 uint64_t SectionAddr, uint64_t Start,
+                                 uint64_t End,
+                                 const std::vector<RelocationRef> &Rels,
+                                 unsigned RelCur, raw_ostream &OS,
+                                 raw_ostream &ErrOS) {
+  SmallString<40> Comments;
+  raw_svector_ostream CommentStream(Comments);
+  StringRefMemoryObject memoryObject(Bytes, SectionAddr);
+
+#ifndef NDEBUG
+  raw_ostream &DebugOut = DebugFlag ? dbgs() : nulls();
+#else
+  raw_ostream &DebugOut = nulls();
+#endif
+
+  uint64_t Size;
+  for (uint64_t Index = Start; Index < End; Index += Size) {
+    MCInst Inst;
+
+    if (Tools.DisAsm->getInstruction(Inst, Size, memoryObject,
+                                     SectionAddr + Index,
+                                     DebugOut, CommentStream)) {
+      OS << format("%8" PRIx64 ":", SectionAddr + Index);
+      if (!NoShowRawInsn) {
+        OS << "\t";
+        DumpBytes(StringRef(Bytes.data() + Index, Size), OS);
+      }
+      Tools.IP->printInst(&Inst, OS, "");
+      OS << CommentStream.str();
+      Comments.clear();
+      OS << "\n";
+    } else {
+      ErrOS << ToolName << ": warning: invalid instruction encoding\n";
+      if (Size == 0)
+        Size = 1; // skip illegible bytes
+    }
+
+    // Print relocation for instruction.
+    for (unsigned RelEnd = Rels.size(); RelCur != RelEnd; ++RelCur) {
+      bool hidden = false;
+      uint64_t addr;
+      SmallString<16> name;
+      SmallString<32> val;
+
+      // If this relocation is hidden, skip it.
+      if (error(Rels[RelCur].getHidden(hidden), OS)) continue;
+      if (hidden) continue;
+
+      if (error(Rels[RelCur].getOffset(addr), OS)) continue;
+      // Stop when the relocation's address is past the current instruction.
+      if (addr >= Index + Size) break;
+      if (error(Rels[RelCur].getTypeName(name), OS)) continue;
+      if (error(Rels[RelCur].getValueString(val), OS)) continue;
+
+      OS << format("\t\t\t%8" PRIx64 ": ", SectionAddr + addr) << name
+         << "\t" << val << "\n";
+    }
+  }
+  return RelCur;
+}
+
+namespace {
+/// @brief One symbol's worth of a text section, and what disassembling it
+/// printed.
+struct DisassemblyChunk {
+  StringRef Name;
+  uint64_t Start;
+  uint64_t End;
+  std::string Output;
+  std::string Errors;
+};
+
+/// @brief The chunks of a section disassembled by runDisassemblyJob, and
+/// what each thread needs to build its own DisassemblerTools.
+struct DisassemblyJob {
+  const Target *TheTarget;
+  const ObjectFile *Obj;
+  const MCAsmInfo *AsmInfo;
+  const MCRegisterInfo *MRI;
+  const MCSubtargetInfo *STI;
+  const MCInstrInfo *MII;
+  StringRef Bytes;
+  uint64_t SectionAddr;
+  std::vector<DisassemblyChunk> Chunks;
+  volatile sys::cas_flag Next;
+};
+}
+
+static void runDisassemblyJob(void *Arg) {
+  DisassemblyJob *Job = static_cast<DisassemblyJob *>(Arg);
+  DisassemblerTools Tools;
+  if (!createDisassemblerTools(Job->TheTarget, Job->Obj, *Job->AsmInfo,
+                               *Job->MRI, *Job->STI, *Job->MII, Tools))
+    return;
+  std::vector<RelocationRef> NoRels;
+  for (;;) {
+    unsigned Item = sys::AtomicIncrement(&Job->Next) - 1;
+    if (Item >= Job->Chunks.size())
+      return;
+    DisassemblyChunk &Chunk = Job->Chunks[Item];
+    raw_string_ostream OS(Chunk.Output);
+    raw_string_ostream ErrOS(Chunk.Errors);
+    OS << '\n' << Chunk.Name << ":\n";
+    DisassembleRange(Tools, Job->Bytes, Job->SectionAddr, Chunk.Start,
+                     Chunk.End, NoRels, 0, OS, ErrOS);
+  }
+}
+
+/// @brief Disassemble the chunks of a section on NumThreads threads.  They
+/// are handed out in batches of about a megabyte of code per thread, and
+/// each batch is printed in order before the next is started, which keeps
+/// the buffered output bounded.
+static void DisassembleChunks(DisassemblyJob &Job,
+                              ArrayRef<DisassemblyChunk> Chunks) {
+  const uint64_t BatchBytes = uint64_t(NumThreads) << 20;
+  for (unsigned I = 0, E = Chunks.size(); I != E;) {
+    Job.Chunks.clear();
+    uint64_t Bytes = 0;
+    for (; I != E && Bytes < BatchBytes; ++I) {
+      Job.Chunks.push_back(Chunks[I]);
+      Bytes += Chunks[I].End - Chunks[I].Start;
+    }
+    Job.Next = 0;
+    std::vector<void *> Work(std::min<size_t>(NumThreads, Job.Chunks.size()),
+                             &Job);
+    llvm_execute_on_threads(runDisassemblyJob, &Work[0], Work.size());
+    for (unsigned C = 0, CE = Job.Chunks.size(); C != CE; ++C) {
+      outs() << Job.Chunks[C].Output;
+      errs() << Job.Chunks[C].Errors;
+    }
+  }
+}
+
 static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
   const Target *TheTarget = getTarget(Obj);
   // getTarget() will have already issued a diagnostic if necessary, so
@@ -308,40 +514,16 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
     return;
   }
 
-  OwningPtr<MCDisassembler> DisAsm(TheTarget->createMCDisassembler(*STI));
-  if (!DisAsm) {
-    errs() << "error: no disassembler for target " << TripleName << "\n";
+  DisassemblerTools Tools;
+  if (!createDisassemblerTools(TheTarget, Obj, *AsmInfo, *MRI, *STI, *MII,
+                               Tools))
     return;
-  }
-
-  OwningPtr<const MCObjectFileInfo> MOFI;
-  OwningPtr<MCContext> Ctx;
-
-  if (Symbolize) {
-    MOFI.reset(new MCObjectFileInfo);
-    Ctx.reset(new MCContext(AsmInfo.get(), MRI.get(), MOFI.get()));
-    OwningPtr<MCRelocationInfo> RelInfo(
-      TheTarget->createMCRelocationInfo(TripleName, *Ctx.get()));
-    if (RelInfo) {
-      OwningPtr<MCSymbolizer> Symzer(
-        MCObjectSymbolizer::createObjectSymbolizer(*Ctx.get(), RelInfo, Obj));
-      if (Symzer)
-        DisAsm->setSymbolizer(Symzer);
-    }
-  }
+  MCDisassembler *DisAsm = Tools.DisAsm.get();
+  MCInstPrinter *IP = Tools.IP.get();
 
   OwningPtr<const MCInstrAnalysis>
     MIA(TheTarget->createMCInstrAnalysis(MII.get()));
 
-  int AsmPrinterVariant = AsmInfo->getAssemblerDialect();
-  OwningPtr<MCInstPrinter> IP(TheTarget->createMCInstPrinter(
-      AsmPrinterVariant, *AsmInfo, *MII, *MRI, *STI));
-  if (!IP) {
-    errs() << "error: no instruction printer for target " << TripleName
-      << '\n';
-    return;
-  }
-
   if (CFG || !YAMLCFG.empty()) {
     OwningPtr<MCObjectDisassembler> OD(
       new MCObjectDisassembler(*Obj, *DisAsm, *MIA));
@@ -366,7 +548,7 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
         static int filenum = 0;
         emitDOTFile((Twine((*FI)->getName()) + "_" +
                      utostr(filenum) + ".dot").str().c_str(),
-                      **FI, IP.get());
+                      **FI, IP);
         ++filenum;
       }
     }
@@ -448,87 +630,53 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
       Symbols.push_back(std::make_pair(0, name));
 
 
-    SmallString<40> Comments;
-    raw_svector_ostream CommentStream(Comments);
-
     StringRef Bytes;
     if (error(i->getContents(Bytes))) break;
-    StringRefMemoryObject memoryObject(Bytes, SectionAddr);
-    uint64_t Size;
-    uint64_t Index;
     uint64_t SectSize;
     if (error(i->getSize(SectSize))) break;
 
-    std::vector<RelocationRef>::const_iterator rel_cur = Rels.begin();
-    std::vector<RelocationRef>::const_iterator rel_end = Rels.end();
-    // Disassemble symbol by symbol.
+    // Each symbol is disassembled from its start to the start of the next.
+    std::vector<DisassemblyChunk> Chunks;
     for (unsigned si = 0, se = Symbols.size(); si != se; ++si) {
-      uint64_t Start = Symbols[si].first;
-      uint64_t End;
+      DisassemblyChunk Chunk;
+      Chunk.Name = Symbols[si].second;
+      Chunk.Start = Symbols[si].first;
       // The end is either the size of the section or the beginning of the next
       // symbol.
       if (si == se - 1)
-        End = SectSize;
+        Chunk.End = SectSize;
       // Make sure this symbol takes up space.
-      else if (Symbols[si + 1].first != Start)
-        End = Symbols[si + 1].first - 1;
+      else if (Symbols[si + 1].first != Chunk.Start)
+        Chunk.End = Symbols[si + 1].first - 1;
       else
         // This symbol has the same address as the next symbol. Skip it.
         continue;
+      Chunks.push_back(Chunk);
+    }
 
-      outs() << '\n' << Symbols[si].second << ":\n";
-
-#ifndef NDEBUG
-        raw_ostream &DebugOut = DebugFlag ? dbgs() : nulls();
-#else
-        raw_ostream &DebugOut = nulls();
-#endif
-
-      for (Index = Start; Index < End; Index += Size) {
-        MCInst Inst;
-
-        if (DisAsm->getInstruction(Inst, Size, memoryObject,
-                                   SectionAddr + Index,
-                                   DebugOut, CommentStream)) {
-          outs() << format("%8" PRIx64 ":", SectionAddr + Index);
-          if (!NoShowRawInsn) {
-            outs() << "\t";
-            DumpBytes(StringRef(Bytes.data() + Index, Size));
-          }
-          IP->printInst(&Inst, outs(), "");
-          outs() << CommentStream.str();
-          Comments.clear();
-          outs() << "\n";
-        } else {
-          errs() << ToolName << ": warning: invalid instruction encoding\n";
-          if (Size == 0)
-            Size = 1; // skip illegible bytes
-        }
-
-        // Print relocation for instruction.
-        while (rel_cur != rel_end) {
-          bool hidden = false;
-          uint64_t addr;
-          SmallString<16> name;
-          SmallString<32> val;
-
-          // If this relocation is hidden, skip it.
-          if (error(rel_cur->getHidden(hidden))) goto skip_print_rel;
-          if (hidden) goto skip_print_rel;
-
-          if (error(rel_cur->getOffset(addr))) goto skip_print_rel;
-          // Stop when rel_cur's address is past the current instruction.
-          if (addr >= Index + Size) break;
-          if (error(rel_cur->getTypeName(name))) goto skip_print_rel;
-          if (error(rel_cur->getValueString(val))) goto skip_print_rel;
-
-          outs() << format("\t\t\t%8" PRIx64 ": ", SectionAddr + addr) << name
-                 << "\t" << val << "\n";
+    // Symbols can be disassembled independently, unless relocations are
+    // printed inline: those that come after the last instruction of one
+    // symbol are printed with the first instruction of the next.
+    if (NumThreads > 1 && !InlineRelocs && Chunks.size() > 1) {
+      DisassemblyJob Job;
+      Job.TheTarget = TheTarget;
+      Job.Obj = Obj;
+      Job.AsmInfo = AsmInfo.get();
+      Job.MRI = MRI.get();
+      Job.STI = STI.get();
+      Job.MII = MII.get();
+      Job.Bytes = Bytes;
+      Job.SectionAddr = SectionAddr;
+      DisassembleChunks(Job, Chunks);
+      continue;
+    }
 
-        skip_print_rel:
-          ++rel_cur;
-        }
-      }
+    // Disassemble symbol by symbol.
+    unsigned RelCur = 0;
+    for (unsigned ci = 0, ce = Chunks.size(); ci != ce; ++ci) {
+      outs() << '\n' << Chunks[ci].Name << ":\n";
+      RelCur = DisassembleRange(Tools, Bytes, SectionAddr, Chunks[ci].Start,
+                                Chunks[ci].End, Rels, RelCur, outs(), errs());
     }
   }
 }
@@ -563,28 +711,28 @@ static void PrintRelocations(const ObjectFile *o) {
   }
 }
 
-static void PrintSectionHeaders(const ObjectFile *o) {
-  outs() << "Sections:\n"
-            "Idx Name          Size      Address          Type\n";
+static void PrintSectionHeaders(const ObjectFile *o, raw_ostream &OS) {
+  OS << "Sections:\n"
+        "Idx Name          Size      Address          Type\n";
   error_code ec;
   unsigned i = 0;
   for (section_iterator si = o->begin_sections(), se = o->end_sections();
                                                   si != se; si.increment(ec)) {
-    if (error(ec)) return;
+    if (error(ec, OS)) return;
     StringRef Name;
-    if (error(si->getName(Name))) return;
+    if (error(si->getName(Name), OS)) return;
     uint64_t Address;
-    if (error(si->getAddress(Address))) return;
+    if (error(si->getAddress(Address), OS)) return;
     uint64_t Size;
-    if (error(si->getSize(Size))) return;
+    if (error(si->getSize(Size), OS)) return;
     bool Text, Data, BSS;
-    if (error(si->isText(Text))) return;
-    if (error(si->isData(Data))) return;
-    if (error(si->isBSS(BSS))) return;
+    if (error(si->isText(Text), OS)) return;
+    if (error(si->isData(Data), OS)) return;
+    if (error(si->isBSS(BSS), OS)) return;
     std::string Type = (std::string(Text ? "TEXT " : "") +
                         (Data ? "DATA " : "") + (BSS ? "BSS" : ""));
-    outs() << format("%3d %-13s %08" PRIx64 " %016" PRIx64 " %s\n",
-                     i, Name.str().c_str(), Size, Address, Type.c_str());
+    OS << format("%3d %-13s %08" PRIx64 " %016" PRIx64 " %s\n",
+                 i, Name.str().c_str(), Size, Address, Type.c_str());
     ++i;
   }
 }
@@ -638,9 +786,10 @@ static void PrintSectionContents(const ObjectFile *o) {
   }
 }
 
-static void PrintCOFFSymbolTable(const COFFObjectFile *coff) {
+static void PrintCOFFSymbolTable(const COFFObjectFile *coff,
+                                 raw_ostream &OS) {
   const coff_file_header *header;
-  if (error(coff->getHeader(header))) return;
+  if (error(coff->getHeader(header), OS)) return;
   int aux_count = 0;
   const coff_symbol *symbol = 0;
   for (int i = 0, e = header->NumberOfSymbols; i != e; ++i) {
@@ -649,58 +798,59 @@ static void PrintCOFFSymbolTable(const COFFObjectFile *coff) {
       if (symbol->StorageClass == COFF::IMAGE_SYM_CLASS_STATIC
           && symbol->Value == 0) { // Section definition.
         const coff_aux_section_definition *asd;
-        if (error(coff->getAuxSymbol<coff_aux_section_definition>(i, asd)))
+        if (error(coff->getAuxSymbol<coff_aux_section_definition>(i, asd),
+                  OS))
           return;
-        outs() << "AUX "
-               << format("scnlen 0x%x nreloc %d nlnno %d checksum 0x%x "
-                         , unsigned(asd->Length)
-                         , unsigned(asd->NumberOfRelocations)
-                         , unsigned(asd->NumberOfLinenumbers)
-                         , unsigned(asd->CheckSum))
-               << format("assoc %d comdat %d\n"
-                         , unsigned(asd->Number)
-                         , unsigned(asd->Selection));
+        OS << "AUX "
+           << format("scnlen 0x%x nreloc %d nlnno %d checksum 0x%x "
+                     , unsigned(asd->Length)
+                     , unsigned(asd->NumberOfRelocations)
+                     , unsigned(asd->NumberOfLinenumbers)
+                     , unsigned(asd->CheckSum))
+           << format("assoc %d comdat %d\n"
+                     , unsigned(asd->Number)
+                     , unsigned(asd->Selection));
       } else
-        outs() << "AUX Unknown\n";
+        OS << "AUX Unknown\n";
     } else {
       StringRef name;
-      if (error(coff->getSymbol(i, symbol))) return;
-      if (error(coff->getSymbolName(symbol, name))) return;
-      outs() << "[" << format("%2d", i) << "]"
-             << "(sec " << format("%2d", int(symbol->SectionNumber)) << ")"
-             << "(fl 0x00)" // Flag bits, which COFF doesn't have.
-             << "(ty " << format("%3x", unsigned(symbol->Type)) << ")"
-             << "(scl " << format("%3x", unsigned(symbol->StorageClass)) << ") "
-             << "(nx " << unsigned(symbol->NumberOfAuxSymbols) << ") "
-             << "0x" << format("%08x", unsigned(symbol->Value)) << " "
-             << name << "\n";
+      if (error(coff->getSymbol(i, symbol), OS)) return;
+      if (error(coff->getSymbolName(symbol, name), OS)) return;
+      OS << "[" << format("%2d", i) << "]"
+         << "(sec " << format("%2d", int(symbol->SectionNumber)) << ")"
+         << "(fl 0x00)" // Flag bits, which COFF doesn't have.
+         << "(ty " << format("%3x", unsigned(symbol->Type)) << ")"
+         << "(scl " << format("%3x", unsigned(symbol->StorageClass)) << ") "
+         << "(nx " << unsigned(symbol->NumberOfAuxSymbols) << ") "
+         << "0x" << format("%08x", unsigned(symbol->Value)) << " "
+         << name << "\n";
       aux_count = symbol->NumberOfAuxSymbols;
     }
   }
 }
 
-static void PrintSymbolTable(const ObjectFile *o) {
-  outs() << "SYMBOL TABLE:\n";
+static void PrintSymbolTable(const ObjectFile *o, raw_ostream &OS) {
+  OS << "SYMBOL TABLE:\n";
 
   if (const COFFObjectFile *coff = dyn_cast<const COFFObjectFile>(o))
-    PrintCOFFSymbolTable(coff);
+    PrintCOFFSymbolTable(coff, OS);
   else {
     error_code ec;
     for (symbol_iterator si = o->begin_symbols(),
                          se = o->end_symbols(); si != se; si.increment(ec)) {
-      if (error(ec)) return;
+      if (error(ec, OS)) return;
       StringRef Name;
       uint64_t Address;
       SymbolRef::Type Type;
       uint64_t Size;
       uint32_t Flags;
       section_iterator Section = o->end_sections();
-      if (error(si->getName(Name))) continue;
-      if (error(si->getAddress(Address))) continue;
-      if (error(si->getFlags(Flags))) continue;
-      if (error(si->getType(Type))) continue;
-      if (error(si->getSize(Size))) continue;
-      if (error(si->getSection(Section))) continue;
+      if (error(si->getName(Name), OS)) continue;
+      if (error(si->getAddress(Address), OS)) continue;
+      if (error(si->getFlags(Flags), OS)) continue;
+      if (error(si->getType(Type), OS)) continue;
+      if (error(si->getSize(Size), OS)) continue;
+      if (error(si->getSection(Section), OS)) continue;
 
       bool Global = Flags & SymbolRef::SF_Global;
       bool Weak = Flags & SymbolRef::SF_Weak;
@@ -724,35 +874,35 @@ static void PrintSymbolTable(const ObjectFile *o) {
       const char *Fmt = o->getBytesInAddress() > 4 ? "%016" PRIx64 :
                                                      "%08" PRIx64;
 
-      outs() << format(Fmt, Address) << " "
-             << GlobLoc // Local -> 'l', Global -> 'g', Neither -> ' '
-             << (Weak ? 'w' : ' ') // Weak?
-             << ' ' // Constructor. Not supported yet.
-             << ' ' // Warning. Not supported yet.
-             << ' ' // Indirect reference to another symbol.
-             << Debug // Debugging (d) or dynamic (D) symbol.
-             << FileFunc // Name of function (F), file (f) or object (O).
-             << ' ';
+      OS << format(Fmt, Address) << " "
+         << GlobLoc // Local -> 'l', Global -> 'g', Neither -> ' '
+         << (Weak ? 'w' : ' ') // Weak?
+         << ' ' // Constructor. Not supported yet.
+         << ' ' // Warning. Not supported yet.
+         << ' ' // Indirect reference to another symbol.
+         << Debug // Debugging (d) or dynamic (D) symbol.
+         << FileFunc // Name of function (F), file (f) or object (O).
+         << ' ';
       if (Absolute)
-        outs() << "*ABS*";
+        OS << "*ABS*";
       else if (Section == o->end_sections())
-        outs() << "*UND*";
+        OS << "*UND*";
       else {
         if (const MachOObjectFile *MachO =
             dyn_cast<const MachOObjectFile>(o)) {
           DataRefImpl DR = Section->getRawDataRefImpl();
           StringRef SegmentName = MachO->getSectionFinalSegmentName(DR);
-          outs() << SegmentName << ",";
+          OS << SegmentName << ",";
         }
         StringRef SectionName;
-        if (error(Section->getName(SectionName)))
+        if (error(Section->getName(SectionName), OS))
           SectionName = "";
-        outs() << SectionName;
+        OS << SectionName;
       }
-      outs() << '\t'
-             << format("%08" PRIx64 " ", Size)
-             << Name
-             << '\n';
+      OS << '\t'
+         << format("%08" PRIx64 " ", Size)
+         << Name
+         << '\n';
     }
   }
 }
@@ -778,44 +928,103 @@ static void printPrivateFileHeader(const ObjectFile *o) {
   }
 }
 
-static void DumpObject(const ObjectFile *o) {
-  outs() << '\n';
-  outs() << o->getFileName()
-         << ":\tfile format " << o->getFileFormatName() << "\n\n";
+/// @brief Dump \a o.  Only the file header, section headers and symbol table
+/// go to \a OS; see canDumpToBuffers.
+static void DumpObject(const ObjectFile *o, raw_ostream &OS = outs()) {
+  OS << '\n';
+  OS << o->getFileName()
+     << ":\tfile format " << o->getFileFormatName() << "\n\n";
 
   if (Disassemble)
     DisassembleObject(o, Relocations);
   if (Relocations && !Disassemble)
     PrintRelocations(o);
   if (SectionHeaders)
-    PrintSectionHeaders(o);
+    PrintSectionHeaders(o, OS);
   if (SectionContents)
     PrintSectionContents(o);
   if (SymbolTable)
-    PrintSymbolTable(o);
+    PrintSymbolTable(o, OS);
   if (UnwindInfo)
     PrintUnwindInfo(o);
   if (PrivateHeaders)
     printPrivateFileHeader(o);
 }
 
-/// @brief Dump each object file in \a a;
+/// @brief Whether everything requested can be dumped to a buffer, which lets
+/// archive members be dumped concurrently.
+static bool canDumpToBuffers() {
+  return !Disassemble && !Relocations && !SectionContents && !UnwindInfo &&
+         !PrivateHeaders;
+}
+
+/// @brief Dump one member of \a a.
+static void DumpArchiveMember(const Archive *a, const Archive::Child &c,
+                              raw_ostream &OS, raw_ostream &ErrOS) {
+  OwningPtr<Binary> child;
+  if (error_code ec = c.getAsBinary(child)) {
+    // Ignore non-object files.
+    if (ec != object_error::invalid_file_type)
+      ErrOS << ToolName << ": '" << a->getFileName() << "': " << ec.message()
+            << ".\n";
+    return;
+  }
+  if (ObjectFile *o = dyn_cast<ObjectFile>(child.get()))
+    DumpObject(o, OS);
+  else
+    ErrOS << ToolName << ": '" << a->getFileName() << "': "
+          << "Unrecognized file type.\n";
+}
+
+namespace {
+/// @brief The archive members dumped by runMemberJob, and their output.
+struct MemberJob {
+  const Archive *Parent;
+  std::vector<Archive::Child> Members;
+  std::vector<std::string> Outputs;
+  std::vector<std::string> Errors;
+  volatile sys::cas_flag Next;
+};
+}
+
+static void runMemberJob(void *Arg) {
+  MemberJob *Job = static_cast<MemberJob *>(Arg);
+  for (;;) {
+    unsigned Item = sys::AtomicIncrement(&Job->Next) - 1;
+    if (Item >= Job->Members.size())
+      return;
+    raw_string_ostream OS(Job->Outputs[Item]);
+    raw_string_ostream ErrOS(Job->Errors[Item]);
+    DumpArchiveMember(Job->Parent, Job->Members[Item], OS, ErrOS);
+  }
+}
+
+/// @brief Dump each object file in \a a.  With -threads, the members are
+/// dumped concurrently into buffers that are then printed in archive order.
 static void DumpArchive(const Archive *a) {
+  if (NumThreads <= 1 || !canDumpToBuffers()) {
+    for (Archive::child_iterator i = a->begin_children(),
+                                 e = a->end_children(); i != e; ++i)
+      DumpArchiveMember(a, *i, outs(), errs());
+    return;
+  }
+
+  MemberJob Job;
+  Job.Parent = a;
   for (Archive::child_iterator i = a->begin_children(),
-                               e = a->end_children(); i != e; ++i) {
-    OwningPtr<Binary> child;
-    if (error_code ec = i->getAsBinary(child)) {
-      // Ignore non-object files.
-      if (ec != object_error::invalid_file_type)
-        errs() << ToolName << ": '" << a->getFileName() << "': " << ec.message()
-               << ".\n";
-      continue;
-    }
-    if (ObjectFile *o = dyn_cast<ObjectFile>(child.get()))
-      DumpObject(o);
-    else
-      errs() << ToolName << ": '" << a->getFileName() << "': "
-              << "Unrecognized file type.\n";
+                               e = a->end_children(); i != e; ++i)
+    Job.Members.push_back(*i);
+  Job.Outputs.resize(Job.Members.size());
+  Job.Errors.resize(Job.Members.size());
+  Job.Next = 0;
+  std::vector<void *> Work(std::min<size_t>(NumThreads, Job.Members.size()),
+                           &Job);
+  if (!Work.empty())
+    llvm_execute_on_threads(runMemberJob, &Work[0], Work.size());
+
+  for (unsigned i = 0, e = Job.Members.size(); i != e; ++i) {
+    outs() << Job.Outputs[i];
+    errs() << Job.Errors[i];
   }
 }
 
@@ -0,0 +1,96 @@
+//===-- llvm-sampleprof.cpp - Convert sample profiles ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program converts the sample profiles read by -sample-profile between
+// the text and binary formats.  Writing several inputs to one output merges
+// their samples.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include "llvm/Transforms/Utils/SampleProfileFormat.h"
+using namespace llvm;
+
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::OneOrMore, cl::desc("<input profiles>"));
+
+static cl::opt<std::string>
+OutputFilename("o", cl::desc("Output filename"), cl::value_desc("filename"),
+               cl::init("-"));
+
+static cl::opt<bool>
+OutputText("text", cl::desc("Write the text format instead of the binary "
+                            "format"));
+
+static bool readProfile(StringRef Filename, sampleprof::ProfileMap &Profiles) {
+  OwningPtr<MemoryBuffer> Buffer;
+  if (error_code EC = MemoryBuffer::getFileOrSTDIN(Filename, Buffer)) {
+    errs() << Filename << ": " << EC.message() << "\n";
+    return false;
+  }
+
+  std::string ErrorMsg;
+  if (!sampleprof::BinaryReader::isBinary(*Buffer)) {
+    if (sampleprof::readText(*Buffer, Profiles, ErrorMsg))
+      return true;
+    errs() << Filename << ":" << ErrorMsg << "\n";
+    return false;
+  }
+
+  OwningPtr<sampleprof::BinaryReader> Reader(
+      sampleprof::BinaryReader::create(*Buffer, ErrorMsg));
+  if (!Reader) {
+    errs() << Filename << ": " << ErrorMsg << "\n";
+    return false;
+  }
+  if (!Reader->readAll(Profiles)) {
+    errs() << Filename << ": malformed profile record\n";
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  // Print a stack trace if we signal out.
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+  cl::ParseCommandLineOptions(argc, argv, "sample profile converter\n");
+
+  sampleprof::ProfileMap Profiles;
+  for (unsigned i = 0, e = InputFilenames.size(); i != e; ++i)
+    if (!readProfile(InputFilenames[i], Profiles))
+      return 1;
+
+  std::string ErrorInfo;
+  tool_output_file Out(OutputFilename.c_str(), ErrorInfo,
+                       OutputText ? sys::fs::F_None : sys::fs::F_Binary);
+  if (!ErrorInfo.empty()) {
+    errs() << ErrorInfo << '\n';
+    return 1;
+  }
+
+  if (OutputText)
+    sampleprof::writeText(Profiles, Out.os());
+  else
+    sampleprof::writeBinary(Profiles, Out.os());
+
+  Out.keep();
+  return 0;
+}
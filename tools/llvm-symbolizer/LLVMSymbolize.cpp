@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "LLVMSymbolize.h"
+#include "SymbolizeIndex.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Config/config.h"
 #include "llvm/Object/MachO.h"
@@ -19,9 +20,14 @@
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/DataExtractor.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Atomic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 #include <sstream>
 #include <stdlib.h>
 
@@ -51,8 +57,8 @@ static void patchFunctionNameInDILineInfo(const std::string &NewFunctionName,
                         LineInfo.getLine(), LineInfo.getColumn());
 }
 
-ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
-    : Module(Obj), DebugInfoContext(DICtx) {
+ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx, AddressIndex *Index)
+    : Module(Obj), DebugInfoContext(DICtx), Index(Index) {
   error_code ec;
   for (symbol_iterator si = Module->begin_symbols(), se = Module->end_symbols();
        si != se; si.increment(ec)) {
@@ -90,6 +96,8 @@ ModuleInfo::ModuleInfo(ObjectFile *Obj, DIContext *DICtx)
   }
 }
 
+ModuleInfo::~ModuleInfo() {}
+
 bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
                                         std::string &Name, uint64_t &Addr,
                                         uint64_t &Size) const {
@@ -112,7 +120,12 @@ bool ModuleInfo::getNameFromSymbolTable(SymbolRef::Type Type, uint64_t Address,
 DILineInfo ModuleInfo::symbolizeCode(
     uint64_t ModuleOffset, const LLVMSymbolizer::Options &Opts) const {
   DILineInfo LineInfo;
-  if (DebugInfoContext) {
+  DIInliningInfo IndexedContext;
+  if (Index) {
+    if (Index->lookup(ModuleOffset, IndexedContext))
+      LineInfo = IndexedContext.getFrame(0);
+  } else if (DebugInfoContext) {
+    MutexGuard Guard(Lock);
     LineInfo = DebugInfoContext->getLineInfoForAddress(
         ModuleOffset, getDILineInfoSpecifierFlags(Opts));
   }
@@ -131,7 +144,10 @@ DILineInfo ModuleInfo::symbolizeCode(
 DIInliningInfo ModuleInfo::symbolizeInlinedCode(
     uint64_t ModuleOffset, const LLVMSymbolizer::Options &Opts) const {
   DIInliningInfo InlinedContext;
-  if (DebugInfoContext) {
+  if (Index) {
+    Index->lookup(ModuleOffset, InlinedContext);
+  } else if (DebugInfoContext) {
+    MutexGuard Guard(Lock);
     InlinedContext = DebugInfoContext->getInliningInfoForAddress(
         ModuleOffset, getDILineInfoSpecifierFlags(Opts));
   }
@@ -204,6 +220,85 @@ std::string LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
   return ss.str();
 }
 
+namespace {
+/// BatchJob - The requests of a symbolizeBatch call, grouped by module, which
+/// the threads take one module at a time.
+struct BatchJob {
+  LLVMSymbolizer *Symbolizer;
+  const std::vector<LLVMSymbolizer::Request> *Requests;
+  std::vector<std::string> *Results;
+  std::vector<std::vector<unsigned> > Modules;
+  volatile sys::cas_flag NextModule;
+};
+
+/// RequestOrder - Orders the indices of requests for the same module by kind
+/// and address.
+struct RequestOrder {
+  const std::vector<LLVMSymbolizer::Request> *Requests;
+  bool operator()(unsigned LHS, unsigned RHS) const {
+    const LLVMSymbolizer::Request &L = (*Requests)[LHS];
+    const LLVMSymbolizer::Request &R = (*Requests)[RHS];
+    if (L.IsData != R.IsData)
+      return R.IsData;
+    return L.ModuleOffset < R.ModuleOffset;
+  }
+};
+}
+
+static void runBatchJob(void *Arg) {
+  BatchJob *Job = static_cast<BatchJob *>(Arg);
+  const std::vector<LLVMSymbolizer::Request> &Requests = *Job->Requests;
+  std::vector<std::string> &Results = *Job->Results;
+  for (;;) {
+    unsigned Item = sys::AtomicIncrement(&Job->NextModule) - 1;
+    if (Item >= Job->Modules.size())
+      return;
+    const std::vector<unsigned> &Indices = Job->Modules[Item];
+    for (unsigned i = 0, e = Indices.size(); i != e; ++i) {
+      const LLVMSymbolizer::Request &R = Requests[Indices[i]];
+      if (i != 0) {
+        const LLVMSymbolizer::Request &Prev = Requests[Indices[i - 1]];
+        if (Prev.IsData == R.IsData && Prev.ModuleOffset == R.ModuleOffset) {
+          Results[Indices[i]] = Results[Indices[i - 1]];
+          continue;
+        }
+      }
+      LLVMSymbolizer *Symbolizer = Job->Symbolizer;
+      Results[Indices[i]] =
+          R.IsData ? Symbolizer->symbolizeData(R.ModuleName, R.ModuleOffset)
+                   : Symbolizer->symbolizeCode(R.ModuleName, R.ModuleOffset);
+    }
+  }
+}
+
+void LLVMSymbolizer::symbolizeBatch(const std::vector<Request> &Requests,
+                                    std::vector<std::string> &Results,
+                                    unsigned NumThreads) {
+  Results.assign(Requests.size(), std::string());
+  BatchJob Job;
+  Job.Symbolizer = this;
+  Job.Requests = &Requests;
+  Job.Results = &Results;
+  Job.NextModule = 0;
+  std::map<std::string, unsigned> ModuleNumbers;
+  for (unsigned i = 0, e = Requests.size(); i != e; ++i) {
+    std::pair<std::map<std::string, unsigned>::iterator, bool> Ins =
+        ModuleNumbers.insert(
+            std::make_pair(Requests[i].ModuleName, Job.Modules.size()));
+    if (Ins.second)
+      Job.Modules.push_back(std::vector<unsigned>());
+    Job.Modules[Ins.first->second].push_back(i);
+  }
+  RequestOrder Order = { &Requests };
+  for (unsigned i = 0, e = Job.Modules.size(); i != e; ++i)
+    std::stable_sort(Job.Modules[i].begin(), Job.Modules[i].end(), Order);
+
+  std::vector<void *> Work(
+      std::min<size_t>(std::max(NumThreads, 1U), Job.Modules.size()), &Job);
+  if (!Work.empty())
+    llvm_execute_on_threads(runBatchJob, &Work[0], Work.size());
+}
+
 void LLVMSymbolizer::flush() {
   DeleteContainerSeconds(Modules);
   DeleteContainerPointers(ParsedBinariesAndObjects);
@@ -365,6 +460,7 @@ LLVMSymbolizer::getObjectFileFromBinary(Binary *Bin, const std::string &ArchName
 
 ModuleInfo *
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
+  MutexGuard Guard(CacheLock);
   ModuleMapTy::iterator I = Modules.find(ModuleName);
   if (I != Modules.end())
     return I->second;
@@ -388,13 +484,64 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
     Modules.insert(make_pair(ModuleName, (ModuleInfo *)0));
     return 0;
   }
-  DIContext *Context = DIContext::getDWARFContext(DbgObj);
-  assert(Context);
-  ModuleInfo *Info = new ModuleInfo(Obj, Context);
+  ModuleInfo *Info;
+  AddressIndex *Index = 0;
+  if (!Opts.IndexCacheDir.empty() && DbgObj)
+    Index = getOrCreateAddressIndex(DbgObj);
+  if (Index) {
+    Info = new ModuleInfo(Obj, 0, Index);
+  } else {
+    DIContext *Context = DIContext::getDWARFContext(DbgObj, Opts.NumThreads,
+                                                    Opts.DIEMemoryBudget);
+    assert(Context);
+    Info = new ModuleInfo(Obj, Context);
+  }
   Modules.insert(make_pair(ModuleName, Info));
   return Info;
 }
 
+AddressIndex *LLVMSymbolizer::getOrCreateAddressIndex(ObjectFile *DbgObj) {
+  std::string BuildID;
+  if (!getBuildID(DbgObj, BuildID))
+    return 0;
+  SmallString<128> Path(Opts.IndexCacheDir);
+  sys::path::append(Path, BuildID + ".symidx");
+
+  OwningPtr<MemoryBuffer> Buffer;
+  if (!MemoryBuffer::getFile(Path.str(), Buffer, -1, false)) {
+    if (AddressIndex *Index = AddressIndex::create(Buffer.take()))
+      return Index;
+  }
+
+  OwningPtr<DIContext> Context(
+      DIContext::getDWARFContext(DbgObj, Opts.NumThreads));
+  std::string Data;
+  {
+    raw_string_ostream OS(Data);
+    AddressIndex::build(Context.get(), OS);
+  }
+
+  // Failing to save the index only costs later runs the time to rebuild it.
+  // Write it to a temporary file and move that into place, so that other
+  // processes never see a partial index.
+  SmallString<128> TempPath;
+  int FD;
+  if (!sys::fs::create_directories(Opts.IndexCacheDir) &&
+      !sys::fs::createUniqueFile(Path.str() + ".%%%%%%.tmp", FD, TempPath)) {
+    bool Written;
+    {
+      raw_fd_ostream OS(FD, /*shouldClose=*/true);
+      OS << Data;
+      OS.close();
+      Written = !OS.has_error();
+      OS.clear_error();
+    }
+    if (!Written || sys::fs::rename(TempPath.str(), Path.str()))
+      sys::fs::remove(TempPath.str());
+  }
+  return AddressIndex::create(MemoryBuffer::getMemBufferCopy(Data));
+}
+
 std::string LLVMSymbolizer::printDILineInfo(DILineInfo LineInfo) const {
   // By default, DILineInfo contains "<invalid>" for function/filename it
   // cannot fetch. We replace it to "??" to make our output closer to addr2line.
@@ -19,8 +19,10 @@
 #include "llvm/Object/MachOUniversal.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Mutex.h"
 #include <map>
 #include <string>
+#include <vector>
 
 namespace llvm {
 
@@ -28,8 +30,11 @@ using namespace object;
 
 namespace symbolize {
 
+class AddressIndex;
 class ModuleInfo;
 
+/// LLVMSymbolizer - Symbolizes addresses in modules, caching each module it
+/// opens.  Everything but flush may be called from several threads at once.
 class LLVMSymbolizer {
 public:
   struct Options {
@@ -38,12 +43,23 @@ public:
     bool PrintInlining : 1;
     bool Demangle : 1;
     std::string DefaultArch;
+    /// NumThreads - How many threads to parse the debug info of a module with.
+    unsigned NumThreads;
+    /// IndexCacheDir - If not empty, the directory to keep an address index
+    /// of each module with a build ID in, so that later runs don't need to
+    /// parse its debug info.
+    std::string IndexCacheDir;
+    /// DIEMemoryBudget - How many bytes of parsed debug info entries to keep
+    /// for each module, or 0 for no limit.
+    size_t DIEMemoryBudget;
     Options(bool UseSymbolTable = true, bool PrintFunctions = true,
             bool PrintInlining = true, bool Demangle = true,
-            std::string DefaultArch = "")
+            std::string DefaultArch = "", unsigned NumThreads = 1,
+            std::string IndexCacheDir = "", size_t DIEMemoryBudget = 0)
         : UseSymbolTable(UseSymbolTable), PrintFunctions(PrintFunctions),
           PrintInlining(PrintInlining), Demangle(Demangle),
-          DefaultArch(DefaultArch) {
+          DefaultArch(DefaultArch), NumThreads(NumThreads),
+          IndexCacheDir(IndexCacheDir), DIEMemoryBudget(DIEMemoryBudget) {
     }
   };
 
@@ -58,6 +74,20 @@ public:
   symbolizeCode(const std::string &ModuleName, uint64_t ModuleOffset);
   std::string
   symbolizeData(const std::string &ModuleName, uint64_t ModuleOffset);
+
+  /// Request - One address to symbolize as part of a batch.
+  struct Request {
+    std::string ModuleName;
+    uint64_t ModuleOffset;
+    bool IsData;
+  };
+
+  /// symbolizeBatch - Set Results[i] to what symbolizeCode or symbolizeData
+  /// returns for Requests[i].  Up to NumThreads modules are symbolized at
+  /// once.  The addresses in each module are deduplicated and looked up in
+  /// increasing order by a single thread.
+  void symbolizeBatch(const std::vector<Request> &Requests,
+                      std::vector<std::string> &Results, unsigned NumThreads);
   void flush();
   static std::string DemangleName(const std::string &Name);
 private:
@@ -69,10 +99,15 @@ private:
   /// \brief Returns a parsed object file for a given architecture in a
   /// universal binary (or the binary itself if it is an object file).
   ObjectFile *getObjectFileFromBinary(Binary *Bin, const std::string &ArchName);
+  /// \brief Returns the cached address index for a debug object file,
+  /// building and caching it first if necessary, or null if it has no build ID.
+  AddressIndex *getOrCreateAddressIndex(ObjectFile *DbgObj);
 
   std::string printDILineInfo(DILineInfo LineInfo) const;
   static std::string DemangleGlobalName(const std::string &Name);
 
+  // Guards the caches below, which getOrCreateModuleInfo fills.
+  sys::Mutex CacheLock;
   // Owns all the parsed binaries and object files.
   SmallVector<Binary*, 4> ParsedBinariesAndObjects;
   // Owns module info objects.
@@ -90,7 +125,10 @@ private:
 
 class ModuleInfo {
 public:
-  ModuleInfo(ObjectFile *Obj, DIContext *DICtx);
+  /// ModuleInfo - Take ownership of DICtx and Index, either of which may be
+  /// null.  Addresses are looked up in Index if there is one.
+  ModuleInfo(ObjectFile *Obj, DIContext *DICtx, AddressIndex *Index = 0);
+  ~ModuleInfo();
 
   DILineInfo symbolizeCode(uint64_t ModuleOffset,
                            const LLVMSymbolizer::Options &Opts) const;
@@ -104,7 +142,10 @@ private:
                               std::string &Name, uint64_t &Addr,
                               uint64_t &Size) const;
   ObjectFile *Module;
+  // Serializes the queries of DebugInfoContext, which isn't thread-safe.
+  mutable sys::Mutex Lock;
   OwningPtr<DIContext> DebugInfoContext;
+  OwningPtr<AddressIndex> Index;
 
   struct SymbolDesc {
     uint64_t Addr;
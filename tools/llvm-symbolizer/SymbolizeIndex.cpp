@@ -0,0 +1,261 @@
+//===-- SymbolizeIndex.cpp ------------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the address index used by the LLVM symbolization library.
+//
+// An index is a header followed by three tables, all little-endian:
+//
+//   Range  { u64 Start, u64 End, u32 FirstFrame, u32 NumFrames }
+//   Frame  { u32 FunctionName, u32 FileName, u32 Line, u32 Column }
+//   Strings, NUL-terminated, which the frames refer to by offset.
+//
+// Ranges are sorted by Start and don't overlap.  Adjacent rows of a line table
+// with the same inlining chain are merged into a single range.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SymbolizeIndex.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace llvm {
+namespace symbolize {
+
+using support::ulittle32_t;
+using support::ulittle64_t;
+
+static const char IndexMagic[8] = { 'L', 'L', 'V', 'M', 'S', 'Y', 'M', 'X' };
+static const uint32_t IndexVersion = 1;
+
+struct AddressIndex::Header {
+  char Magic[8];
+  ulittle32_t Version;
+  ulittle32_t NumRanges;
+  ulittle32_t NumFrames;
+  ulittle32_t StringsSize;
+};
+
+struct AddressIndex::Range {
+  ulittle64_t Start;
+  ulittle64_t End;
+  ulittle32_t FirstFrame;
+  ulittle32_t NumFrames;
+};
+
+struct AddressIndex::Frame {
+  ulittle32_t FunctionName;
+  ulittle32_t FileName;
+  ulittle32_t Line;
+  ulittle32_t Column;
+};
+
+namespace {
+/// StringTable - The strings of an index being built, each stored once.
+class StringTable {
+  StringMap<uint32_t> Offsets;
+  std::string Data;
+
+public:
+  uint32_t add(StringRef S) {
+    StringMap<uint32_t>::iterator I = Offsets.find(S);
+    if (I != Offsets.end())
+      return I->second;
+    uint32_t Offset = Data.size();
+    Data.append(S.begin(), S.end());
+    Data.push_back('\0');
+    Offsets[S] = Offset;
+    return Offset;
+  }
+  const std::string &getData() const { return Data; }
+};
+}
+
+static bool sameFrames(const DIInliningInfo &LHS, const DIInliningInfo &RHS) {
+  if (LHS.getNumberOfFrames() != RHS.getNumberOfFrames())
+    return false;
+  for (uint32_t i = 0, n = LHS.getNumberOfFrames(); i != n; ++i)
+    if (LHS.getFrame(i) != RHS.getFrame(i))
+      return false;
+  return true;
+}
+
+void AddressIndex::build(DIContext *DICtx, raw_ostream &OS) {
+  std::vector<std::pair<uint64_t, uint64_t> > RowRanges;
+  DICtx->getLineTableRanges(RowRanges);
+  std::sort(RowRanges.begin(), RowRanges.end());
+
+  const uint32_t Flags = DILineInfoSpecifier::FileLineInfo |
+                         DILineInfoSpecifier::AbsoluteFilePath |
+                         DILineInfoSpecifier::FunctionName;
+  std::vector<Range> Ranges;
+  std::vector<Frame> Frames;
+  StringTable Strings;
+  DIInliningInfo PrevInfo;
+  uint64_t PrevEnd = 0;
+  for (unsigned i = 0, e = RowRanges.size(); i != e; ++i) {
+    uint64_t Start = RowRanges[i].first;
+    uint64_t End = RowRanges[i].second;
+    // Where line tables overlap, the first row to cover an address wins.
+    if (!Ranges.empty() && Start < PrevEnd) {
+      if (End <= PrevEnd)
+        continue;
+      Start = PrevEnd;
+    }
+
+    DIInliningInfo Info = DICtx->getInliningInfoForAddress(Start, Flags);
+    if (Info.getNumberOfFrames() == 0)
+      Info.addFrame(DICtx->getLineInfoForAddress(Start, Flags));
+    if (!Ranges.empty() && Start == PrevEnd && sameFrames(Info, PrevInfo)) {
+      Ranges.back().End = End;
+      PrevEnd = End;
+      continue;
+    }
+
+    Range R;
+    R.Start = Start;
+    R.End = End;
+    R.FirstFrame = Frames.size();
+    R.NumFrames = Info.getNumberOfFrames();
+    Ranges.push_back(R);
+    for (uint32_t j = 0, n = Info.getNumberOfFrames(); j != n; ++j) {
+      DILineInfo LineInfo = Info.getFrame(j);
+      Frame F;
+      F.FunctionName = Strings.add(LineInfo.getFunctionName());
+      F.FileName = Strings.add(LineInfo.getFileName());
+      F.Line = LineInfo.getLine();
+      F.Column = LineInfo.getColumn();
+      Frames.push_back(F);
+    }
+    PrevInfo = Info;
+    PrevEnd = End;
+  }
+
+  Header H;
+  memcpy(H.Magic, IndexMagic, sizeof(IndexMagic));
+  H.Version = IndexVersion;
+  H.NumRanges = Ranges.size();
+  H.NumFrames = Frames.size();
+  H.StringsSize = Strings.getData().size();
+  OS.write(reinterpret_cast<const char *>(&H), sizeof(H));
+  if (!Ranges.empty())
+    OS.write(reinterpret_cast<const char *>(&Ranges[0]),
+             Ranges.size() * sizeof(Range));
+  if (!Frames.empty())
+    OS.write(reinterpret_cast<const char *>(&Frames[0]),
+             Frames.size() * sizeof(Frame));
+  OS << Strings.getData();
+}
+
+AddressIndex *AddressIndex::create(MemoryBuffer *Buffer) {
+  OwningPtr<AddressIndex> Index(new AddressIndex(Buffer));
+  StringRef Data = Buffer->getBuffer();
+  if (Data.size() < sizeof(Header))
+    return 0;
+  const Header *H = reinterpret_cast<const Header *>(Data.data());
+  if (memcmp(H->Magic, IndexMagic, sizeof(IndexMagic)) != 0 ||
+      H->Version != IndexVersion)
+    return 0;
+
+  uint64_t RangesOffset = sizeof(Header);
+  uint64_t FramesOffset =
+      RangesOffset + uint64_t(H->NumRanges) * sizeof(Range);
+  uint64_t StringsOffset =
+      FramesOffset + uint64_t(H->NumFrames) * sizeof(Frame);
+  if (StringsOffset + H->StringsSize != Data.size())
+    return 0;
+  // Every lookup relies on the last string being terminated.
+  if (H->StringsSize != 0 && Data.back() != '\0')
+    return 0;
+
+  Index->Ranges = reinterpret_cast<const Range *>(Data.data() + RangesOffset);
+  Index->NumRanges = H->NumRanges;
+  Index->Frames = reinterpret_cast<const Frame *>(Data.data() + FramesOffset);
+  Index->NumFrames = H->NumFrames;
+  Index->Strings = Data.substr(StringsOffset);
+  return Index.take();
+}
+
+static bool startsAfter(uint64_t Address, const AddressIndex::Range &R) {
+  return Address < R.Start;
+}
+
+bool AddressIndex::lookup(uint64_t Address, DIInliningInfo &Info) const {
+  const Range *R =
+      std::upper_bound(Ranges, Ranges + NumRanges, Address, startsAfter);
+  if (R == Ranges)
+    return false;
+  --R;
+  if (Address >= R->End)
+    return false;
+
+  // The index is only checked as far as each lookup needs, so that opening
+  // it doesn't read the whole file.
+  uint32_t FirstFrame = R->FirstFrame, NumFramesInRange = R->NumFrames;
+  if (FirstFrame > NumFrames || NumFramesInRange > NumFrames - FirstFrame)
+    return false;
+  DIInliningInfo Result;
+  for (uint32_t i = 0; i != NumFramesInRange; ++i) {
+    const Frame &F = Frames[FirstFrame + i];
+    uint32_t FunctionName = F.FunctionName, FileName = F.FileName;
+    if (FunctionName >= Strings.size() || FileName >= Strings.size())
+      return false;
+    Result.addFrame(DILineInfo(StringRef(Strings.data() + FileName),
+                               StringRef(Strings.data() + FunctionName),
+                               F.Line, F.Column));
+  }
+  Info = Result;
+  return true;
+}
+
+bool getBuildID(const object::ObjectFile *Obj, std::string &BuildID) {
+  static const char HexDigits[] = "0123456789abcdef";
+  const uint32_t NT_GNU_BUILD_ID = 3;
+  error_code EC;
+  for (object::section_iterator I = Obj->begin_sections(),
+                                E = Obj->end_sections();
+       I != E; I.increment(EC)) {
+    if (EC)
+      return false;
+    StringRef Name;
+    if (I->getName(Name) || Name != ".note.gnu.build-id")
+      continue;
+    StringRef Data;
+    if (I->getContents(Data))
+      return false;
+    DataExtractor DE(Data, Obj->isLittleEndian(), 0);
+    uint32_t Offset = 0;
+    if (!DE.isValidOffsetForDataOfSize(Offset, 12))
+      return false;
+    uint32_t NameSize = DE.getU32(&Offset);
+    uint32_t DescSize = DE.getU32(&Offset);
+    uint32_t Type = DE.getU32(&Offset);
+    if (Type != NT_GNU_BUILD_ID || NameSize != 4 || DescSize == 0 ||
+        !DE.isValidOffsetForDataOfSize(Offset, NameSize + DescSize) ||
+        Data.substr(Offset, NameSize) != StringRef("GNU", 4))
+      return false;
+    Offset += NameSize;
+    BuildID.clear();
+    for (uint32_t i = 0; i != DescSize; ++i) {
+      uint8_t Byte = Data[Offset + i];
+      BuildID += HexDigits[Byte >> 4];
+      BuildID += HexDigits[Byte & 0xf];
+    }
+    return true;
+  }
+  return false;
+}
+
+} // namespace symbolize
+} // namespace llvm
@@ -0,0 +1,76 @@
+//===-- SymbolizeIndex.h ---------------------------------------- C++ -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Header for the address index used by the LLVM symbolization library.
+//
+// Before the first address in a binary can be symbolized its DWARF has to be
+// parsed, which for a large binary takes much longer than the lookups. An
+// AddressIndex holds everything the binary's line tables can answer: a sorted
+// table of address ranges, each with the inlining chain of frames at it, and
+// a table of the strings the frames name. It can be written to a file once
+// and used directly from a memory mapping of that file by later runs.
+//
+//===----------------------------------------------------------------------===//
+#ifndef LLVM_SYMBOLIZE_INDEX_H
+#define LLVM_SYMBOLIZE_INDEX_H
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/DebugInfo/DIContext.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <string>
+
+namespace llvm {
+
+class raw_ostream;
+
+namespace object {
+class ObjectFile;
+}
+
+namespace symbolize {
+
+class AddressIndex {
+public:
+  /// build - Write to OS an index of the inlining chain at every address in
+  /// the line tables of DICtx.  Function names and absolute file names are
+  /// always recorded.
+  static void build(DIContext *DICtx, raw_ostream &OS);
+
+  /// create - Return an index reading from Buffer, which it takes ownership
+  /// of, or null if Buffer doesn't hold a valid index.
+  static AddressIndex *create(MemoryBuffer *Buffer);
+
+  /// lookup - Set Info to the inlining chain at Address, innermost frame
+  /// first. Return false if no range of the index contains Address.
+  bool lookup(uint64_t Address, DIInliningInfo &Info) const;
+
+  struct Header;
+  struct Range;
+  struct Frame;
+
+private:
+  explicit AddressIndex(MemoryBuffer *Buffer) : Buffer(Buffer) {}
+
+  OwningPtr<MemoryBuffer> Buffer;
+  const Range *Ranges;
+  uint32_t NumRanges;
+  const Frame *Frames;
+  uint32_t NumFrames;
+  StringRef Strings;
+};
+
+/// getBuildID - Set BuildID to the GNU build ID of Obj as a hex string.
+/// Return false if Obj doesn't have one.
+bool getBuildID(const object::ObjectFile *Obj, std::string &BuildID);
+
+} // namespace symbolize
+} // namespace llvm
+
+#endif // LLVM_SYMBOLIZE_INDEX_H
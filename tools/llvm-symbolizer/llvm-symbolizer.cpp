@@ -26,6 +26,7 @@
 #include <cstdio>
 #include <cstring>
 #include <string>
+#include <vector>
 
 using namespace llvm;
 using namespace symbolize;
@@ -51,6 +52,28 @@ static cl::opt<std::string> ClDefaultArch("default-arch", cl::init(""),
                                           cl::desc("Default architecture "
                                                    "(for multi-arch objects)"));
 
+static cl::opt<unsigned>
+ClNumThreads("j", cl::init(1),
+             cl::desc("Number of threads to parse the debug info of each "
+                      "module with"),
+             cl::value_desc("N"));
+
+static cl::opt<std::string>
+ClIndexCacheDir("index-cache-dir", cl::init(""),
+                cl::desc("Directory to cache an address index of each module "
+                         "with a build ID in"));
+
+static cl::opt<unsigned long long>
+ClDIEMemoryBudget("die-memory-budget", cl::init(0),
+                  cl::desc("Bytes of parsed debug info entries to keep for "
+                           "each module (0 for no limit)"),
+                  cl::value_desc("bytes"));
+
+static cl::opt<bool>
+ClBatch("batch", cl::init(false),
+        cl::desc("Read all of the input before answering, and symbolize up "
+                 "to -j modules at once"));
+
 static bool parseCommand(bool &IsData, std::string &ModuleName,
                          uint64_t &ModuleOffset) {
   const char *kDataCmd = "DATA ";
@@ -106,9 +129,23 @@ int main(int argc, char **argv) {
 
   cl::ParseCommandLineOptions(argc, argv, "llvm symbolizer for compiler-rt\n");
   LLVMSymbolizer::Options Opts(ClUseSymbolTable, ClPrintFunctions,
-                               ClPrintInlining, ClDemangle, ClDefaultArch);
+                               ClPrintInlining, ClDemangle, ClDefaultArch,
+                               ClNumThreads, ClIndexCacheDir,
+                               ClDIEMemoryBudget);
   LLVMSymbolizer Symbolizer(Opts);
 
+  if (ClBatch) {
+    std::vector<LLVMSymbolizer::Request> Requests;
+    LLVMSymbolizer::Request R;
+    while (parseCommand(R.IsData, R.ModuleName, R.ModuleOffset))
+      Requests.push_back(R);
+    std::vector<std::string> Results;
+    Symbolizer.symbolizeBatch(Requests, Results, ClNumThreads);
+    for (unsigned i = 0, e = Results.size(); i != e; ++i)
+      outs() << Results[i] << "\n";
+    return 0;
+  }
+
   bool IsData = false;
   std::string ModuleName;
   uint64_t ModuleOffset;
@@ -298,6 +298,31 @@ bool lto_codegen_compile_to_file(lto_code_gen_t cg, const char **name) {
                               sLastErrorString);
 }
 
+/// lto_codegen_set_parallelism - Sets the number of partitions, each compiled
+/// on its own thread, that lto_codegen_compile_to_files() generates.
+void lto_codegen_set_parallelism(lto_code_gen_t cg, unsigned parallelism) {
+  cg->setParallelism(parallelism);
+}
+
+/// lto_codegen_set_cache_dir - Sets the directory to cache the object files
+/// of lto_codegen_compile_to_files() partitions in.
+void lto_codegen_set_cache_dir(lto_code_gen_t cg, const char *path) {
+  cg->setCacheDir(path);
+}
+
+/// lto_codegen_compile_to_files - Generates code for all added modules into
+/// one native object file per partition. The names of the files are written
+/// to names. Returns true on error.
+bool lto_codegen_compile_to_files(lto_code_gen_t cg, const char ***names,
+                                  unsigned *num_files) {
+  if (!parsedOptions) {
+    cg->parseCodeGenDebugOptions();
+    parsedOptions = true;
+  }
+  return !cg->compile_to_files(names, num_files, DisableOpt, DisableInline,
+                               DisableGVNLoadPRE, sLastErrorString);
+}
+
 /// lto_codegen_debug_options - Used to pass extra options to the code
 /// generator.
 void lto_codegen_debug_options(lto_code_gen_t cg, const char *opt) {
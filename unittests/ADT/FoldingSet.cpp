@@ -14,6 +14,7 @@
 #include "gtest/gtest.h"
 #include "llvm/ADT/FoldingSet.h"
 #include <string>
+#include <vector>
 
 using namespace llvm;
 
@@ -35,5 +36,70 @@ TEST(FoldingSetTest, UnalignedStringTest) {
   EXPECT_EQ(a.ComputeHash(), b.ComputeHash());
 }
 
+// A node that counts how often it is profiled.
+class CountingNode : public FoldingSetNodeWithHash {
+  unsigned Value;
+public:
+  static unsigned NumProfiles;
+
+  explicit CountingNode(unsigned Value) : Value(Value) {}
+  void Profile(FoldingSetNodeID &ID) const {
+    ++NumProfiles;
+    ID.AddInteger(Value);
+  }
+};
+
+unsigned CountingNode::NumProfiles = 0;
+
+TEST(FoldingSetTest, FoldingSetWithHash) {
+  FoldingSetWithHash<CountingNode> Set;
+  std::vector<CountingNode *> Nodes;
+  for (unsigned i = 0; i != 1000; ++i)
+    Nodes.push_back(new CountingNode(i));
+
+  // Insert enough nodes to grow the table several times.  Only the inserted
+  // nodes themselves are profiled.
+  CountingNode::NumProfiles = 0;
+  for (unsigned i = 0; i != 1000; ++i) {
+    FoldingSetNodeID ID;
+    ID.AddInteger(i);
+    void *InsertPos;
+    EXPECT_EQ(0, Set.FindNodeOrInsertPos(ID, InsertPos));
+    if (i % 2)
+      Set.InsertNode(Nodes[i], InsertPos, ID);
+    else
+      Set.InsertNode(Nodes[i], InsertPos);
+  }
+  EXPECT_EQ(1000u, Set.size());
+  EXPECT_EQ(500u, CountingNode::NumProfiles);
+
+  // Each successful lookup profiles the node it finds, and only that one.
+  CountingNode::NumProfiles = 0;
+  for (unsigned i = 0; i != 1000; ++i) {
+    FoldingSetNodeID ID;
+    ID.AddInteger(i);
+    void *InsertPos;
+    EXPECT_EQ(Nodes[i], Set.FindNodeOrInsertPos(ID, InsertPos));
+  }
+  EXPECT_EQ(1000u, CountingNode::NumProfiles);
+
+  CountingNode Duplicate(42);
+  EXPECT_EQ(Nodes[42], Set.GetOrInsertNode(&Duplicate));
+  EXPECT_TRUE(Set.RemoveNode(Nodes[42]));
+  EXPECT_EQ(&Duplicate, Set.GetOrInsertNode(&Duplicate));
+  EXPECT_TRUE(Set.RemoveNode(&Duplicate));
+
+  unsigned NumIterated = 0;
+  for (FoldingSetWithHash<CountingNode>::iterator I = Set.begin(),
+       E = Set.end(); I != E; ++I)
+    ++NumIterated;
+  EXPECT_EQ(999u, NumIterated);
+
+  Set.clear();
+  EXPECT_TRUE(Set.empty());
+  for (unsigned i = 0; i != 1000; ++i)
+    delete Nodes[i];
+}
+
 }
 
@@ -0,0 +1,488 @@
+//===- llvm/unittest/ADT/GroupDenseMapTest.cpp - GroupDenseMap unit tests -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "gtest/gtest.h"
+#include "llvm/ADT/GroupDenseMap.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+uint32_t getTestKey(int i, uint32_t *) { return i; }
+uint32_t getTestValue(int i, uint32_t *) { return 42 + i; }
+
+uint32_t *getTestKey(int i, uint32_t **) {
+  static uint32_t dummy_arr1[8192];
+  assert(i < 8192 && "Only support 8192 dummy keys.");
+  return &dummy_arr1[i];
+}
+uint32_t *getTestValue(int i, uint32_t **) {
+  static uint32_t dummy_arr1[8192];
+  assert(i < 8192 && "Only support 8192 dummy keys.");
+  return &dummy_arr1[i];
+}
+
+/// \brief A test class that tries to check that construction and destruction
+/// occur correctly.
+class CtorTester {
+  static std::set<CtorTester *> Constructed;
+  int Value;
+
+public:
+  explicit CtorTester(int Value = 0) : Value(Value) {
+    EXPECT_TRUE(Constructed.insert(this).second);
+  }
+  CtorTester(uint32_t Value) : Value(Value) {
+    EXPECT_TRUE(Constructed.insert(this).second);
+  }
+  CtorTester(const CtorTester &Arg) : Value(Arg.Value) {
+    EXPECT_TRUE(Constructed.insert(this).second);
+  }
+  ~CtorTester() {
+    EXPECT_EQ(1u, Constructed.erase(this));
+  }
+  operator uint32_t() const { return Value; }
+
+  int getValue() const { return Value; }
+  bool operator==(const CtorTester &RHS) const { return Value == RHS.Value; }
+
+  static unsigned getNumConstructed() { return Constructed.size(); }
+};
+
+std::set<CtorTester *> CtorTester::Constructed;
+
+// No empty or tombstone keys are needed.
+struct CtorTesterMapInfo {
+  static unsigned getHashValue(const CtorTester &Val) {
+    return Val.getValue() * 37u;
+  }
+  static bool isEqual(const CtorTester &LHS, const CtorTester &RHS) {
+    return LHS == RHS;
+  }
+};
+
+CtorTester getTestKey(int i, CtorTester *) { return CtorTester(i); }
+CtorTester getTestValue(int i, CtorTester *) { return CtorTester(42 + i); }
+
+template <typename T>
+class GroupDenseMapTest : public ::testing::Test {
+protected:
+  T Map;
+
+  static typename T::key_type *const dummy_key_ptr;
+  static typename T::mapped_type *const dummy_value_ptr;
+
+  typename T::key_type getKey(int i = 0) {
+    return getTestKey(i, dummy_key_ptr);
+  }
+  typename T::mapped_type getValue(int i = 0) {
+    return getTestValue(i, dummy_value_ptr);
+  }
+};
+
+template <typename T>
+typename T::key_type *const GroupDenseMapTest<T>::dummy_key_ptr = 0;
+template <typename T>
+typename T::mapped_type *const GroupDenseMapTest<T>::dummy_value_ptr = 0;
+
+// Register these types for testing.
+typedef ::testing::Types<GroupDenseMap<uint32_t, uint32_t>,
+                         GroupDenseMap<uint32_t *, uint32_t *>,
+                         GroupDenseMap<CtorTester, CtorTester,
+                                       CtorTesterMapInfo>
+                         > GroupDenseMapTestTypes;
+TYPED_TEST_CASE(GroupDenseMapTest, GroupDenseMapTestTypes);
+
+// Empty map tests
+TYPED_TEST(GroupDenseMapTest, EmptyMapTest) {
+  EXPECT_EQ(0u, this->Map.size());
+  EXPECT_TRUE(this->Map.empty());
+  EXPECT_TRUE(this->Map.begin() == this->Map.end());
+  EXPECT_FALSE(this->Map.count(this->getKey()));
+  EXPECT_TRUE(this->Map.find(this->getKey()) == this->Map.end());
+  EXPECT_FALSE(this->Map.erase(this->getKey()));
+  EXPECT_EQ(0u, this->Map.getMemorySize());
+}
+
+// A map with a single entry
+TYPED_TEST(GroupDenseMapTest, SingleEntryMapTest) {
+  this->Map[this->getKey()] = this->getValue();
+
+  EXPECT_EQ(1u, this->Map.size());
+  EXPECT_FALSE(this->Map.empty());
+
+  typename TypeParam::iterator it = this->Map.begin();
+  EXPECT_EQ(this->getKey(), it->first);
+  EXPECT_EQ(this->getValue(), it->second);
+  ++it;
+  EXPECT_TRUE(it == this->Map.end());
+
+  EXPECT_TRUE(this->Map.count(this->getKey()));
+  EXPECT_FALSE(this->Map.count(this->getKey(1)));
+  EXPECT_TRUE(this->Map.find(this->getKey()) == this->Map.begin());
+  EXPECT_EQ(this->getValue(), this->Map.lookup(this->getKey()));
+  EXPECT_EQ(this->getValue(), this->Map[this->getKey()]);
+}
+
+// Test clear() method
+TYPED_TEST(GroupDenseMapTest, ClearTest) {
+  for (int i = 0; i < 1000; ++i)
+    this->Map[this->getKey(i)] = this->getValue(i);
+  this->Map.clear();
+
+  EXPECT_EQ(0u, this->Map.size());
+  EXPECT_TRUE(this->Map.empty());
+  EXPECT_TRUE(this->Map.begin() == this->Map.end());
+  EXPECT_FALSE(this->Map.count(this->getKey()));
+}
+
+// Test erase(iterator) and erase(value) methods
+TYPED_TEST(GroupDenseMapTest, EraseTest) {
+  this->Map[this->getKey()] = this->getValue();
+  this->Map[this->getKey(1)] = this->getValue(1);
+  this->Map.erase(this->Map.find(this->getKey()));
+  EXPECT_EQ(1u, this->Map.size());
+  EXPECT_FALSE(this->Map.count(this->getKey()));
+
+  EXPECT_TRUE(this->Map.erase(this->getKey(1)));
+  EXPECT_FALSE(this->Map.erase(this->getKey(1)));
+  EXPECT_EQ(0u, this->Map.size());
+  EXPECT_TRUE(this->Map.empty());
+  EXPECT_TRUE(this->Map.begin() == this->Map.end());
+}
+
+// Test insert() method
+TYPED_TEST(GroupDenseMapTest, InsertTest) {
+  EXPECT_TRUE(this->Map.insert(std::make_pair(this->getKey(),
+                                              this->getValue())).second);
+  EXPECT_FALSE(this->Map.insert(std::make_pair(this->getKey(),
+                                               this->getValue(1))).second);
+  EXPECT_EQ(1u, this->Map.size());
+  EXPECT_EQ(this->getValue(), this->Map[this->getKey()]);
+}
+
+// Test copy constructor and assignment
+TYPED_TEST(GroupDenseMapTest, CopyTest) {
+  for (int i = 0; i < 100; ++i)
+    this->Map[this->getKey(i)] = this->getValue(i);
+  for (int i = 0; i < 100; i += 2)
+    this->Map.erase(this->getKey(i));
+
+  TypeParam copyMap(this->Map);
+  EXPECT_EQ(50u, copyMap.size());
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(i % 2 == 1, copyMap.count(this->getKey(i)) == 1);
+
+  TypeParam assignedMap;
+  assignedMap[this->getKey(100)] = this->getValue(100);
+  assignedMap = copyMap;
+  EXPECT_EQ(50u, assignedMap.size());
+  EXPECT_FALSE(assignedMap.count(this->getKey(100)));
+  EXPECT_EQ(this->getValue(1), assignedMap[this->getKey(1)]);
+}
+
+// Test swap method
+TYPED_TEST(GroupDenseMapTest, SwapTest) {
+  for (int i = 0; i < 100; ++i)
+    this->Map[this->getKey(i)] = this->getValue(i);
+  TypeParam otherMap;
+
+  this->Map.swap(otherMap);
+  EXPECT_EQ(0u, this->Map.size());
+  EXPECT_TRUE(this->Map.empty());
+  EXPECT_EQ(100u, otherMap.size());
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(this->getValue(i), otherMap[this->getKey(i)]);
+}
+
+// A more complex iteration test
+TYPED_TEST(GroupDenseMapTest, IterationTest) {
+  bool visited[1000];
+  std::map<typename TypeParam::key_type, unsigned> visitedIndex;
+
+  for (int i = 0; i < 1000; ++i) {
+    visited[i] = false;
+    visitedIndex[this->getKey(i)] = i;
+
+    this->Map[this->getKey(i)] = this->getValue(i);
+  }
+
+  unsigned NumVisited = 0;
+  for (typename TypeParam::iterator it = this->Map.begin();
+       it != this->Map.end(); ++it, ++NumVisited)
+    visited[visitedIndex[it->first]] = true;
+
+  EXPECT_EQ(1000u, NumVisited);
+  for (int i = 0; i < 1000; ++i)
+    ASSERT_TRUE(visited[i]) << "Entry #" << i << " was never visited";
+}
+
+// const_iterator test
+TYPED_TEST(GroupDenseMapTest, ConstIteratorTest) {
+  // Check conversion from iterator to const_iterator.
+  typename TypeParam::iterator it = this->Map.begin();
+  typename TypeParam::const_iterator cit(it);
+  EXPECT_TRUE(it == cit);
+
+  // Check copying of const_iterators.
+  typename TypeParam::const_iterator cit2(cit);
+  EXPECT_TRUE(cit == cit2);
+}
+
+TEST(GroupDenseMapCustomTest, DestructionTest) {
+  unsigned Before = CtorTester::getNumConstructed();
+  {
+    GroupDenseMap<CtorTester, CtorTester, CtorTesterMapInfo> Map;
+    for (int i = 0; i < 1000; ++i)
+      Map[CtorTester(i)] = CtorTester(i + 1);
+    for (int i = 0; i < 1000; i += 3)
+      Map.erase(CtorTester(i));
+    EXPECT_EQ(Before + 2 * Map.size(), CtorTester::getNumConstructed());
+    Map.clear();
+    EXPECT_EQ(Before, CtorTester::getNumConstructed());
+    for (int i = 0; i < 10; ++i)
+      Map[CtorTester(i)] = CtorTester(i + 1);
+  }
+  EXPECT_EQ(Before, CtorTester::getNumConstructed());
+}
+
+// Key traits that allows lookup with either an unsigned or char* key;
+// In the latter case, "a" == 0, "b" == 1 and so on.
+struct TestMapInfo {
+  static unsigned getHashValue(const unsigned& Val) { return Val * 37U; }
+  static unsigned getHashValue(const char* Val) {
+    return (unsigned)(Val[0] - 'a') * 37U;
+  }
+  static bool isEqual(const unsigned& LHS, const unsigned& RHS) {
+    return LHS == RHS;
+  }
+  static bool isEqual(const char* LHS, const unsigned& RHS) {
+    return (unsigned)(LHS[0] - 'a') == RHS;
+  }
+};
+
+// find_as() tests
+TEST(GroupDenseMapCustomTest, FindAsTest) {
+  GroupDenseMap<unsigned, unsigned, TestMapInfo> map;
+  map[0] = 1;
+  map[1] = 2;
+  map[2] = 3;
+
+  EXPECT_EQ(3u, map.size());
+
+  EXPECT_EQ(1u, map.count(1));
+  EXPECT_EQ(1u, map.find(0)->second);
+  EXPECT_EQ(2u, map.find(1)->second);
+  EXPECT_EQ(3u, map.find(2)->second);
+  EXPECT_TRUE(map.find(3) == map.end());
+
+  EXPECT_EQ(1u, map.find_as("a")->second);
+  EXPECT_EQ(2u, map.find_as("b")->second);
+  EXPECT_EQ(3u, map.find_as("c")->second);
+  EXPECT_TRUE(map.find_as("d") == map.end());
+}
+
+// Keys that DenseMap reserves are ordinary keys here.
+TEST(GroupDenseMapCustomTest, ReservedKeysTest) {
+  GroupDenseMap<unsigned, unsigned> map;
+  map[DenseMapInfo<unsigned>::getEmptyKey()] = 1;
+  map[DenseMapInfo<unsigned>::getTombstoneKey()] = 2;
+  EXPECT_EQ(2u, map.size());
+  EXPECT_EQ(1u, map.lookup(DenseMapInfo<unsigned>::getEmptyKey()));
+  EXPECT_EQ(2u, map.lookup(DenseMapInfo<unsigned>::getTombstoneKey()));
+}
+
+// Every key lands in the same group and has the same control byte.
+struct CollidingMapInfo {
+  static unsigned getHashValue(const unsigned &) { return 0; }
+  static bool isEqual(const unsigned &LHS, const unsigned &RHS) {
+    return LHS == RHS;
+  }
+};
+
+TEST(GroupDenseMapCustomTest, CollisionTest) {
+  GroupDenseMap<unsigned, unsigned, CollidingMapInfo> map;
+  for (unsigned i = 0; i < 200; ++i)
+    map[i] = i + 1;
+  for (unsigned i = 0; i < 200; i += 2)
+    EXPECT_TRUE(map.erase(i));
+  for (unsigned i = 0; i < 200; ++i)
+    EXPECT_EQ(i % 2 ? i + 1 : 0, map.lookup(i));
+  for (unsigned i = 0; i < 200; i += 2)
+    map[i] = i + 1;
+  EXPECT_EQ(200u, map.size());
+  for (unsigned i = 0; i < 200; ++i)
+    EXPECT_EQ(i + 1, map.lookup(i));
+}
+
+// Mix inserts and erases and check the map against std::map; the erases
+// leave tombstones that later inserts reuse or that rehashing removes.
+TEST(GroupDenseMapCustomTest, ChurnTest) {
+  GroupDenseMap<unsigned, unsigned> map;
+  std::map<unsigned, unsigned> Expected;
+  uint32_t Seed = 1;
+  for (unsigned i = 0; i < 100000; ++i) {
+    Seed = Seed * 1103515245 + 12345;
+    unsigned Key = (Seed >> 8) % 2048;
+    if (Seed & 0x80) {
+      map[Key] = i;
+      Expected[Key] = i;
+    } else {
+      EXPECT_EQ(Expected.erase(Key) != 0, map.erase(Key));
+    }
+  }
+
+  ASSERT_EQ(Expected.size(), map.size());
+  for (std::map<unsigned, unsigned>::iterator I = Expected.begin(),
+       E = Expected.end(); I != E; ++I)
+    EXPECT_EQ(I->second, map.lookup(I->first));
+  // Only 2048 different keys were used, so the map stayed small.
+  EXPECT_GE(8192u * (sizeof(std::pair<unsigned, unsigned>) + 1),
+            map.getMemorySize());
+}
+
+TEST(GroupDenseMapCustomTest, ResizeTest) {
+  GroupDenseMap<unsigned, unsigned> map;
+  map.resize(1000);
+  size_t Size = map.getMemorySize();
+  const void *Buckets = map.getPointerIntoBucketsArray();
+  for (unsigned i = 0; i < 800; ++i)
+    map[i] = i;
+  EXPECT_EQ(Size, map.getMemorySize());
+  EXPECT_EQ(Buckets, map.getPointerIntoBucketsArray());
+}
+
+//===----------------------------------------------------------------------===//
+// Benchmarks comparing GroupDenseMap with DenseMap on the kind of keys the
+// hottest DenseMaps of the code generator use.
+//===----------------------------------------------------------------------===//
+
+uint32_t nextRandom(uint32_t &Seed) {
+  Seed ^= Seed << 13;
+  Seed ^= Seed >> 17;
+  Seed ^= Seed << 5;
+  return Seed;
+}
+
+uint64_t getElapsedNSec(const sys::TimeValue &Start) {
+  sys::TimeValue Elapsed = sys::TimeValue::now() - Start;
+  return Elapsed.seconds() * 1000000000ULL + Elapsed.nanoseconds();
+}
+
+/// Return 2 * N distinct keys in random order: addresses of objects of
+/// Stride bytes, or virtual register numbers if Stride is one.
+template <typename KeyT>
+std::vector<KeyT> getBenchmarkKeys(unsigned N, std::vector<char> &Storage,
+                                   unsigned Stride, uint32_t Seed) {
+  uintptr_t Base = 0x80000000u;
+  if (Stride > 1) {
+    Storage.resize(2 * N * Stride);
+    Base = (uintptr_t)&Storage[0];
+  }
+  std::vector<KeyT> Keys;
+  for (unsigned i = 0; i != 2 * N; ++i)
+    Keys.push_back((KeyT)(Base + i * Stride));
+  for (unsigned i = Keys.size(); i > 1; --i)
+    std::swap(Keys[i - 1], Keys[nextRandom(Seed) % i]);
+  return Keys;
+}
+
+/// Time insertion, hits, misses, erase churn and iteration on MapT, in
+/// nanoseconds per operation.  The first half of Keys is inserted, the second
+/// half is not.
+template <typename MapT>
+void runBenchmark(const char *Name, const std::vector<typename MapT::key_type>
+                  &Keys, unsigned Rounds) {
+  unsigned N = Keys.size() / 2;
+  uint64_t Insert = 0, Hit = 0, Miss = 0, Churn = 0, Iterate = 0;
+  unsigned Found = 0;
+  for (unsigned R = 0; R != Rounds; ++R) {
+    MapT Map;
+    sys::TimeValue Start = sys::TimeValue::now();
+    for (unsigned i = 0; i != N; ++i)
+      Map[Keys[i]] = i;
+    Insert += getElapsedNSec(Start);
+
+    Start = sys::TimeValue::now();
+    for (unsigned i = 0; i != N; ++i)
+      Found += Map.count(Keys[N - 1 - i]);
+    Hit += getElapsedNSec(Start);
+
+    Start = sys::TimeValue::now();
+    for (unsigned i = N; i != 2 * N; ++i)
+      Found += Map.count(Keys[i]);
+    Miss += getElapsedNSec(Start);
+
+    // Replace the oldest key with a new one, as worklists and live ranges
+    // do.
+    Start = sys::TimeValue::now();
+    for (unsigned i = 0; i != N; ++i) {
+      Map.erase(Keys[i]);
+      Map[Keys[N + i]] = i;
+    }
+    Churn += getElapsedNSec(Start);
+
+    Start = sys::TimeValue::now();
+    for (typename MapT::iterator I = Map.begin(), E = Map.end(); I != E; ++I)
+      Found += I->second & 1;
+    Iterate += getElapsedNSec(Start);
+  }
+
+  EXPECT_NE(0u, Found);
+  double Ops = double(N) * Rounds;
+  outs() << "  " << Name << ": insert " << format("%5.1f", Insert / Ops)
+         << ", hit " << format("%5.1f", Hit / Ops)
+         << ", miss " << format("%5.1f", Miss / Ops)
+         << ", churn " << format("%5.1f", Churn / Ops)
+         << ", iterate " << format("%5.1f", Iterate / Ops) << " ns/op\n";
+}
+
+template <typename KeyT>
+void compareMaps(const char *Desc, unsigned Stride) {
+  static const unsigned Sizes[] = { 32, 1024, 65536, 1048576 };
+  for (unsigned i = 0; i != array_lengthof(Sizes); ++i) {
+    std::vector<char> Storage;
+    std::vector<KeyT> Keys =
+      getBenchmarkKeys<KeyT>(Sizes[i], Storage, Stride, 42 + i);
+    unsigned Rounds = std::max(1u, 4194304u / Sizes[i]);
+    outs() << Desc << ", " << Sizes[i] << " keys, " << Rounds << " rounds\n";
+    runBenchmark<DenseMap<KeyT, unsigned> >("DenseMap     ", Keys, Rounds);
+    runBenchmark<GroupDenseMap<KeyT, unsigned> >("GroupDenseMap", Keys,
+                                                 Rounds);
+  }
+}
+
+struct Value;
+struct MachineInstr;
+
+// Value * keys, as in ValueMap and the value numbering tables.
+TEST(GroupDenseMapBenchmark, DISABLED_ValuePointers) {
+  compareMaps<Value *>("Value * keys", 48);
+}
+
+// MachineInstr * keys, as in the SlotIndexes and scheduler maps.
+TEST(GroupDenseMapBenchmark, DISABLED_MachineInstrPointers) {
+  compareMaps<MachineInstr *>("MachineInstr * keys", 72);
+}
+
+// Virtual register numbers, as in the LiveIntervals and register allocator
+// maps.
+TEST(GroupDenseMapBenchmark, DISABLED_RegisterNumbers) {
+  compareMaps<unsigned>("register keys", 1);
+}
+
+} // end anonymous namespace
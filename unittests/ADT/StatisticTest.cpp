@@ -0,0 +1,88 @@
+//===- StatisticTest.cpp - Statistic unit tests ---------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "unittest"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/ThreadPool.h"
+#include "gtest/gtest.h"
+#include <cstring>
+
+using namespace llvm;
+
+// Statistics only count in builds with assertions or LLVM_ENABLE_STATS.
+#if !defined(NDEBUG) || defined(LLVM_ENABLE_STATS)
+
+STATISTIC(Counter, "Counts statistic tests");
+STATISTIC(OtherCounter, "Counts other statistic tests");
+
+namespace {
+
+bool findStatistic(const char *Desc, unsigned &Value) {
+  std::vector<std::pair<const Statistic *, unsigned> > Stats =
+    GetStatistics();
+  for (size_t i = 0, e = Stats.size(); i != e; ++i)
+    if (std::strcmp(Stats[i].first->getDesc(), Desc) == 0) {
+      Value = Stats[i].second;
+      return true;
+    }
+  return false;
+}
+
+TEST(StatisticTest, Count) {
+  ResetStatistics();
+  ++Counter;
+  Counter += 5;
+  EXPECT_EQ(6u, Counter.getValue());
+  EXPECT_EQ(6u, Counter++);
+  --Counter;
+  Counter -= 2;
+  EXPECT_EQ(4u, (unsigned)Counter);
+
+  Counter = 3;
+  EXPECT_EQ(3u, Counter.getValue());
+  Counter *= 4;
+  EXPECT_EQ(12u, Counter.getValue());
+  Counter /= 6;
+  EXPECT_EQ(2u, Counter.getValue());
+}
+
+void bump(void *) {
+  for (unsigned i = 0; i != 1000; ++i)
+    ++Counter;
+}
+
+TEST(StatisticTest, Threads) {
+  ResetStatistics();
+  ThreadPool Pool(4);
+  for (unsigned i = 0; i != 8; ++i)
+    Pool.async(bump, 0);
+  Pool.wait();
+  EXPECT_EQ(8000u, Counter.getValue());
+}
+
+TEST(StatisticTest, SnapshotAndReset) {
+  ResetStatistics();
+  Counter += 2;
+  OtherCounter += 3;
+
+  unsigned Value = 0;
+  ASSERT_TRUE(findStatistic("Counts statistic tests", Value));
+  EXPECT_EQ(2u, Value);
+  ASSERT_TRUE(findStatistic("Counts other statistic tests", Value));
+  EXPECT_EQ(3u, Value);
+
+  ResetStatistics();
+  EXPECT_EQ(0u, Counter.getValue());
+  ASSERT_TRUE(findStatistic("Counts other statistic tests", Value));
+  EXPECT_EQ(0u, Value);
+}
+
+} // end anonymous namespace
+
+#endif
@@ -0,0 +1,143 @@
+//===- llvm/unittest/AsmParser/AsmParserTest.cpp - Tests for LLParser -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Assembly/Parser.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(AsmParserTest, ForwardReferences) {
+  LLVMContext Context;
+  SMDiagnostic Err;
+  OwningPtr<Module> M(ParseAssemblyString(
+      "define i32* @f() {\n"
+      "  br label %next\n"
+      "next:\n"
+      "  %x = load i32* @g, !tag !0\n"
+      "  %y = add i32 %x, 1\n"
+      "  store i32 %y, i32* @0\n"
+      "  ret i32* @g\n"
+      "}\n"
+      "@0 = global i32 0\n"
+      "@g = global i32 1\n"
+      "!0 = metadata !{metadata !\"tag\"}\n",
+      0, Err, Context));
+  ASSERT_TRUE(M.get() != 0) << Err.getMessage().str();
+
+  GlobalVariable *G = M->getGlobalVariable("g");
+  ASSERT_TRUE(G != 0);
+  Function *F = M->getFunction("f");
+  ReturnInst *Ret = cast<ReturnInst>(F->back().getTerminator());
+  EXPECT_EQ(G, Ret->getReturnValue());
+  EXPECT_EQ(2U, F->size());
+}
+
+TEST(AsmParserTest, EscapedNames) {
+  LLVMContext Context;
+  SMDiagnostic Err;
+  OwningPtr<Module> M(ParseAssemblyString(
+      "@\"a\\62c\" = global [4 x i8] c\"x\\5Cy\\00\"\n"
+      "define void @\"f\\20g\"() {\n"
+      "  %\"l\\6F\\63al\" = alloca i8\n"
+      "  ret void\n"
+      "}\n",
+      0, Err, Context));
+  ASSERT_TRUE(M.get() != 0) << Err.getMessage().str();
+
+  GlobalVariable *G = M->getGlobalVariable("abc");
+  ASSERT_TRUE(G != 0);
+  EXPECT_EQ("x\\y", cast<ConstantDataSequential>(G->getInitializer())
+                        ->getAsCString());
+  Function *F = M->getFunction("f g");
+  ASSERT_TRUE(F != 0);
+  EXPECT_EQ("local", F->front().front().getName());
+}
+
+// With several undefined values, the one used first is reported.
+TEST(AsmParserTest, UndefinedValueReportsFirstUse) {
+  LLVMContext Context;
+  SMDiagnostic Err;
+  OwningPtr<Module> M(ParseAssemblyString(
+      "define void @f() {\n"
+      "  store i32 0, i32* @zzz\n"
+      "  store i32 0, i32* @aaa\n"
+      "  ret void\n"
+      "}\n",
+      0, Err, Context));
+  EXPECT_TRUE(M.get() == 0);
+  EXPECT_EQ("use of undefined value '@zzz'", Err.getMessage());
+  EXPECT_EQ(2, Err.getLineNo());
+
+  M.reset(ParseAssemblyString(
+      "define void @f() {\n"
+      "  %a = add i32 %zzz, 1\n"
+      "  %b = add i32 %aaa, 1\n"
+      "  ret void\n"
+      "}\n",
+      0, Err, Context));
+  EXPECT_TRUE(M.get() == 0);
+  EXPECT_EQ("use of undefined value '%zzz'", Err.getMessage());
+  EXPECT_EQ(2, Err.getLineNo());
+}
+
+// Times parsing a large module that is mostly named values and forward
+// references.  Run it with --gtest_also_run_disabled_tests.
+TEST(AsmParserTest, DISABLED_ParseBenchmark) {
+  std::string Asm;
+  raw_string_ostream OS(Asm);
+  const unsigned NumFunctions = 2000, NumInsts = 200;
+  for (unsigned i = 0; i != NumFunctions; ++i) {
+    OS << "define i32 @function_with_a_long_name_" << i << "(i32 %arg) {\n"
+       << "entry:\n"
+       << "  br label %loop_body_block\n"
+       << "loop_body_block:\n"
+       << "  %value_0 = add i32 %arg, 1\n";
+    for (unsigned j = 1; j != NumInsts; ++j)
+      OS << "  %value_" << j << " = add i32 %value_" << j - 1 << ", " << j
+         << ", !dbg !" << j % 16 << "\n";
+    OS << "  %call = call i32 @function_with_a_long_name_"
+       << (i + 1) % NumFunctions << "(i32 %value_" << NumInsts - 1 << ")\n"
+       << "  ret i32 %call\n"
+       << "}\n";
+  }
+  OS << "!llvm.module.flags = !{!16}\n"
+     << "!16 = metadata !{i32 1, metadata !\"Debug Info Version\", i32 1}\n";
+  for (unsigned i = 0; i != 16; ++i)
+    OS << "!" << i << " = metadata !{i32 " << i << ", i32 0, metadata !17, "
+       << "null}\n";
+  OS << "!17 = metadata !{metadata !\"scope\"}\n";
+  OS.flush();
+
+  LLVMContext Context;
+  SMDiagnostic Err;
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  OwningPtr<Module> M(ParseAssemblyString(Asm.c_str(), 0, Err, Context));
+  TimeRecord Time = TimeRecord::getCurrentTime(false);
+  Time -= Start;
+  ASSERT_TRUE(M.get() != 0) << Err.getMessage().str();
+  EXPECT_EQ(NumFunctions, M->size());
+
+  double MB = Asm.size() / (1024.0 * 1024.0);
+  outs() << "parse: " << format("%.4f", Time.getWallTime()) << "s for "
+         << format("%.1f", MB) << " MB ("
+         << format("%.1f", MB / Time.getWallTime()) << " MB/s)\n";
+}
+
+} // end anonymous namespace
@@ -16,8 +16,11 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/PassManager.h"
+#include "llvm/Support/DataStream.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <cstring>
 
 namespace llvm {
 namespace {
@@ -61,5 +64,81 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddr) { // PR11677
   passes.run(*m);
 }
 
+/// BufferStreamer - Streams the bytes of a buffer, counting how many of them
+/// the reader has asked for so far.
+class BufferStreamer : public DataStreamer {
+  StringRef Data;
+  size_t &BytesRead;
+
+public:
+  BufferStreamer(StringRef Data, size_t &BytesRead)
+      : Data(Data), BytesRead(BytesRead) {}
+
+  virtual size_t GetBytes(unsigned char *Buf, size_t Len) {
+    size_t N = std::min(Len, Data.size() - BytesRead);
+    memcpy(Buf, Data.data() + BytesRead, N);
+    BytesRead += N;
+    return N;
+  }
+};
+
+static const unsigned NumStreamedFunctions = 64;
+
+/// makeLargeModule - A module whose bitcode spans several of the chunks that
+/// StreamingMemoryObject fetches at a time.
+static Module *makeLargeModule() {
+  Module *Mod = new Module("test-stream", getGlobalContext());
+  LLVMContext &Ctx = Mod->getContext();
+  Type *Int32 = Type::getInt32Ty(Ctx);
+  FunctionType *FuncTy = FunctionType::get(Int32, Int32, false);
+  for (unsigned i = 0; i != NumStreamedFunctions; ++i) {
+    Function *Func = Function::Create(FuncTy, GlobalValue::ExternalLinkage,
+                                      "f" + Twine(i), Mod);
+    BasicBlock *Entry = BasicBlock::Create(Ctx, "entry", Func);
+    Value *V = Func->arg_begin();
+    for (unsigned j = 0; j != 256; ++j)
+      V = BinaryOperator::CreateAdd(V, ConstantInt::get(Int32, i * 256 + j),
+                                    "", Entry);
+    ReturnInst::Create(Ctx, V, Entry);
+  }
+  return Mod;
+}
+
+TEST(BitReaderTest, MaterializeStreamedFunctionsInOrder) {
+  SmallString<1024> Mem;
+  {
+    OwningPtr<Module> Mod(makeLargeModule());
+    raw_svector_ostream OS(Mem);
+    WriteBitcodeToFile(Mod.get(), OS);
+  }
+
+  size_t BytesRead = 0;
+  std::string ErrMsg;
+  OwningPtr<Module> M(getStreamedBitcodeModule(
+      "test", new BufferStreamer(Mem.str(), BytesRead), getGlobalContext(),
+      &ErrMsg));
+  ASSERT_TRUE(M.get() != 0) << ErrMsg;
+
+  // The first body is available before the rest of the bitcode is read.
+  Function *F = materializeNextFunction(M.get(), &ErrMsg);
+  ASSERT_TRUE(F != 0) << ErrMsg;
+  EXPECT_EQ(M->getFunction("f0"), F);
+  EXPECT_FALSE(F->isDeclaration());
+  EXPECT_LT(BytesRead, Mem.size());
+
+  unsigned NumRead = 1;
+  while ((F = materializeNextFunction(M.get(), &ErrMsg))) {
+    EXPECT_EQ(M->getFunction(("f" + Twine(NumRead)).str()), F);
+    EXPECT_FALSE(F->isDeclaration());
+    ++NumRead;
+  }
+  EXPECT_TRUE(ErrMsg.empty()) << ErrMsg;
+  EXPECT_EQ(NumStreamedFunctions, NumRead);
+
+  EXPECT_FALSE(M->MaterializeAllPermanently(&ErrMsg)) << ErrMsg;
+  EXPECT_EQ(Mem.size(), BytesRead);
+  EXPECT_FALSE(verifyModule(*M, ReturnStatusAction));
+}
+
 }
 }
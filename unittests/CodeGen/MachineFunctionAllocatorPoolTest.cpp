@@ -0,0 +1,54 @@
+//===- MachineFunctionAllocatorPoolTest.cpp -------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/MachineFunction.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(MachineFunctionAllocatorPoolTest, ReusesSlabs) {
+  MachineFunctionAllocatorPool Pool;
+  void *First;
+  {
+    BumpPtrAllocator Allocator(4096, 4096, Pool);
+    First = Allocator.Allocate(16, 8);
+  }
+
+  // The slab released by the first allocator is handed to the next one.
+  BumpPtrAllocator Allocator(4096, 4096, Pool);
+  EXPECT_EQ(First, Allocator.Allocate(16, 8));
+}
+
+TEST(MachineFunctionAllocatorPoolTest, SkipsOversizedSlabs) {
+  MachineFunctionAllocatorPool Pool;
+  MemSlab *Big = Pool.Allocate(65536);
+  Pool.Deallocate(Big);
+
+  // Handing out the big slab for a small request would waste most of it.
+  MemSlab *Small = Pool.Allocate(4096);
+  EXPECT_NE(Big, Small);
+  EXPECT_EQ(Big, Pool.Allocate(40000));
+  Pool.Deallocate(Small);
+  Pool.Deallocate(Big);
+}
+
+TEST(MachineFunctionAllocatorPoolTest, BoundsFreeMemory) {
+  MachineFunctionAllocatorPool Pool(4096);
+  MemSlab *A = Pool.Allocate(4096);
+  MemSlab *B = Pool.Allocate(4096);
+  Pool.Deallocate(A);
+  // There is no room to keep B, so it goes back to malloc.
+  Pool.Deallocate(B);
+  EXPECT_EQ(A, Pool.Allocate(4096));
+  Pool.Deallocate(A);
+}
+
+} // end anonymous namespace
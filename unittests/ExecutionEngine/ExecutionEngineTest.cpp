@@ -106,6 +106,7 @@ TEST_F(ExecutionEngineTest, ClearModuleMappings) {
   Engine->clearGlobalMappingsFromModule(M);
 
   EXPECT_EQ(NULL, Engine->getGlobalValueAtAddress(&Mem1));
+  EXPECT_EQ(NULL, Engine->getPointerToGlobalIfAvailable(G1));
 
   GlobalVariable *G2 =
       NewExtGlobal(Type::getInt32Ty(getGlobalContext()), "Global2");
@@ -126,6 +127,11 @@ TEST_F(ExecutionEngineTest, DestructionRemovesGlobalMapping) {
   // mappings that refer to it.
   G1->eraseFromParent();
   EXPECT_EQ(NULL, Engine->getGlobalValueAtAddress(&Mem1));
+
+  // A global allocated where G1 was must not see its address.
+  GlobalVariable *G2 =
+    NewExtGlobal(Type::getInt32Ty(getGlobalContext()), "Global2");
+  EXPECT_EQ(NULL, Engine->getPointerToGlobalIfAvailable(G2));
 }
 
 }
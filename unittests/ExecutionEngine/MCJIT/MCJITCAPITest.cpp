@@ -59,6 +59,38 @@ static void roundTripDestroy(void *object) {
   delete static_cast<SectionMemoryManager*>(object);
 }
 
+namespace {
+struct TestObjectCache {
+  std::string Object;
+  unsigned NumCompiled;
+  unsigned NumHits;
+  bool Destroyed;
+  TestObjectCache() : NumCompiled(0), NumHits(0), Destroyed(false) {}
+};
+} // end anonymous namespace
+
+static void testCacheNotifyObjectCompiled(void *object, LLVMModuleRef module,
+                                          const char *objData,
+                                          size_t objSize) {
+  TestObjectCache *cache = static_cast<TestObjectCache*>(object);
+  cache->Object.assign(objData, objSize);
+  ++cache->NumCompiled;
+}
+
+static LLVMMemoryBufferRef testCacheGetObject(void *object,
+                                              LLVMModuleRef module) {
+  TestObjectCache *cache = static_cast<TestObjectCache*>(object);
+  if (cache->Object.empty())
+    return 0;
+  ++cache->NumHits;
+  return LLVMCreateMemoryBufferWithMemoryRangeCopy(
+    cache->Object.data(), cache->Object.size(), "cached object");
+}
+
+static void testCacheDestroy(void *object) {
+  static_cast<TestObjectCache*>(object)->Destroyed = true;
+}
+
 namespace {
 class MCJITCAPITest : public testing::Test, public MCJITTestAPICommon {
 protected:
@@ -194,3 +226,87 @@ TEST_F(MCJITCAPITest, custom_memory_manager) {
   EXPECT_EQ(42, functionPointer.usable());
   EXPECT_TRUE(didCallAllocateCodeSection);
 }
+
+TEST_F(MCJITCAPITest, object_cache) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  TestObjectCache cacheData;
+  LLVMMCJITObjectCacheRef cache = LLVMCreateSimpleMCJITObjectCache(
+    &cacheData, testCacheNotifyObjectCompiled, testCacheGetObject,
+    testCacheDestroy);
+  ASSERT_TRUE(cache != 0);
+
+  // The first engine compiles the module and hands the object to the cache.
+  buildSimpleFunction();
+  buildMCJITOptions();
+  buildMCJITEngine();
+  LLVMSetMCJITObjectCache(Engine, cache);
+
+  union {
+    uint64_t raw;
+    int (*usable)();
+  } functionPointer;
+  functionPointer.raw = LLVMGetFunctionAddress(Engine, "simple_function");
+  EXPECT_EQ(42, functionPointer.usable());
+  EXPECT_EQ(1u, cacheData.NumCompiled);
+  EXPECT_EQ(0u, cacheData.NumHits);
+
+  LLVMDisposeExecutionEngine(Engine);
+  Engine = 0;
+
+  // The second one loads it from the cache instead.
+  buildSimpleFunction();
+  buildMCJITEngine();
+  LLVMSetMCJITObjectCache(Engine, cache);
+
+  functionPointer.raw = LLVMGetFunctionAddress(Engine, "simple_function");
+  EXPECT_EQ(42, functionPointer.usable());
+  EXPECT_EQ(1u, cacheData.NumCompiled);
+  EXPECT_EQ(1u, cacheData.NumHits);
+
+  LLVMDisposeExecutionEngine(Engine);
+  Engine = 0;
+  Module = 0;
+  LLVMDisposeMCJITObjectCache(cache);
+  EXPECT_TRUE(cacheData.Destroyed);
+}
+
+TEST_F(MCJITCAPITest, background_compilation) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  buildSimpleFunction();
+  buildMCJITOptions();
+  buildMCJITEngine();
+
+  LLVMRequestFunctionAddress(Engine, "simple_function");
+
+  union {
+    uint64_t raw;
+    int (*usable)();
+  } functionPointer;
+  functionPointer.raw = LLVMGetFunctionAddress(Engine, "simple_function");
+  ASSERT_NE(0u, functionPointer.raw);
+  EXPECT_EQ(42, functionPointer.usable());
+  EXPECT_EQ(functionPointer.raw,
+            LLVMGetFunctionAddressIfReady(Engine, "simple_function"));
+}
+
+TEST_F(MCJITCAPITest, remove_module) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  buildSimpleFunction();
+  buildMCJITOptions();
+  buildMCJITEngine();
+  EXPECT_NE(0u, LLVMGetFunctionAddress(Engine, "simple_function"));
+
+  LLVMModuleRef removed = 0;
+  EXPECT_EQ(0, LLVMRemoveModule(Engine, Module, &removed, &Error));
+  EXPECT_EQ(Module, removed);
+
+  LLVMValueRef found;
+  EXPECT_NE(0, LLVMFindFunction(Engine, "simple_function", &found));
+  EXPECT_EQ(0u, LLVMGetFunctionAddress(Engine, "simple_function"));
+
+  LLVMDisposeModule(Module);
+  Module = 0;
+}
@@ -125,6 +125,61 @@ TEST_F(MCJITMultipleModuleTest, two_module_reverse_case) {
   checkAdd(ptr);
 }
 
+// Module A { Function FA },
+// Module B { Function FB },
+// execute FB, remove B, then execute FA
+TEST_F(MCJITMultipleModuleTest, two_module_remove_case) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  OwningPtr<Module> A, B;
+  Function *FA, *FB;
+  createTwoModuleCase(A, FA, B, FB);
+  std::string FBName = FB->getName().str();
+
+  createJIT(A.take());
+  Module *BPtr = B.get();
+  TheJIT->addModule(B.take());
+
+  uint64_t ptr = TheJIT->getFunctionAddress(FBName);
+  TheJIT->finalizeObject();
+  checkAdd(ptr);
+
+  EXPECT_TRUE(TheJIT->removeModule(BPtr));
+  delete BPtr;
+  EXPECT_EQ(0u, TheJIT->getFunctionAddress(FBName));
+
+  ptr = TheJIT->getFunctionAddress(FA->getName().str());
+  TheJIT->finalizeObject();
+  checkAdd(ptr);
+}
+
+// Module A { Function FA },
+// Module B { Extern FA, Function FB which calls FA },
+// discard the object data, execute FA then FB, then remove B
+TEST_F(MCJITMultipleModuleTest, two_module_discard_object_data_case) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  OwningPtr<Module> A, B;
+  Function *FA, *FB;
+  createTwoModuleExternCase(A, FA, B, FB);
+  std::string FBName = FB->getName().str();
+
+  createJIT(A.take());
+  TheJIT->DiscardObjectData();
+  Module *BPtr = B.get();
+  TheJIT->addModule(B.take());
+
+  // B is linked against A after A's object has been freed.
+  uint64_t ptr = TheJIT->getFunctionAddress(FA->getName().str());
+  checkAdd(ptr);
+  ptr = TheJIT->getFunctionAddress(FBName);
+  checkAdd(ptr);
+
+  EXPECT_TRUE(TheJIT->removeModule(BPtr));
+  delete BPtr;
+  EXPECT_EQ(0u, TheJIT->getFunctionAddress(FBName));
+}
+
 // Module A { Function FA },
 // Module B { Extern FA, Function FB which calls FA },
 // execute FB then FA
@@ -13,8 +13,11 @@
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ExecutionEngine/JIT.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Target/TargetMachine.h"
 #include "MCJITTestBase.h"
 #include "gtest/gtest.h"
 
@@ -238,5 +241,53 @@ TEST_F(MCJITObjectCacheTest, VerifyNonLoadFromCache) {
   EXPECT_FALSE(Cache->wereDuplicatesInserted());
 }
 
+TEST_F(MCJITObjectCacheTest, VerifyFileObjectCache) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("mcjit-cache", CacheDir));
+  OwningPtr<TargetMachine> TM(EngineBuilder(M.get())
+                                .setMCPU(sys::getHostCPUName())
+                                .selectTarget());
+  ASSERT_TRUE(TM.isValid());
+
+  // Compile this module with an MCJIT engine, which stores the object in the
+  // cache directory.
+  {
+    FileObjectCache Cache(CacheDir, *TM);
+    createJIT(M.take());
+    TheJIT->setObjectCache(&Cache);
+    compileAndRun();
+    TheJIT.reset();
+  }
+
+  // A second cache on the same directory, as another process would create it,
+  // finds the object for an identical module.
+  MM = new SectionMemoryManager;
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), OriginalRC);
+  {
+    FileObjectCache Cache(CacheDir, *TM);
+    OwningPtr<MemoryBuffer> Obj(Cache.getObject(M.get()));
+    EXPECT_TRUE(Obj.isValid());
+
+    createJIT(M.take());
+    TheJIT->setObjectCache(&Cache);
+    compileAndRun();
+    TheJIT.reset();
+  }
+
+  // A different module is not found.
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), ReplacementRC);
+  {
+    FileObjectCache Cache(CacheDir, *TM);
+    OwningPtr<MemoryBuffer> Obj(Cache.getObject(M.get()));
+    EXPECT_FALSE(Obj.isValid());
+  }
+
+  sys::fs::remove_all(CacheDir.str());
+}
+
 } // Namespace
 
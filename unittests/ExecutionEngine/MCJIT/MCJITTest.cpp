@@ -12,7 +12,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/SymbolAddressCache.h"
 #include "MCJITTestBase.h"
 #include "gtest/gtest.h"
 
@@ -78,6 +80,49 @@ TEST_F(MCJITTest, add_function) {
   EXPECT_EQ(-40, AddPtr(-10, -30));
 }
 
+TEST_F(MCJITTest, background_compile) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *F = insertAddFunction(M.get());
+  createJIT(M.take());
+  std::string Name = F->getName().str();
+  TheJIT->requestFunctionAddress(Name);
+
+  // Waiting for the address must pick up the result of the background
+  // compile, and from then on the address is ready.
+  uint64_t addPtr = TheJIT->getFunctionAddress(Name);
+  ASSERT_TRUE(addPtr != 0) << "Unable to get pointer to function .";
+  EXPECT_EQ(addPtr, TheJIT->getFunctionAddressIfReady(Name));
+
+  int (*AddPtr)(int, int) = (int(*)(int, int))addPtr;
+  EXPECT_EQ(3, AddPtr(1, 2));
+}
+
+TEST_F(MCJITTest, call_trampoline) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *F = insertAddFunction(M.get());
+  createJIT(M.take());
+
+  // runFunction has no special case for this signature.
+  std::vector<GenericValue> Args(2);
+  Args[0].IntVal = APInt(32, 10);
+  Args[1].IntVal = APInt(32, -30, true);
+  GenericValue Result = TheJIT->runFunction(F, Args);
+  EXPECT_EQ(-20, (int32_t)Result.IntVal.getSExtValue());
+
+  // The trampoline is made once per function type.
+  ExecutionEngine::CallTrampoline Trampoline =
+    TheJIT->getCallTrampoline(F->getFunctionType());
+  ASSERT_TRUE(Trampoline != 0);
+  EXPECT_EQ(Trampoline, TheJIT->getCallTrampoline(F->getFunctionType()));
+
+  int32_t Packed[2] = { 1, 2 };
+  int32_t Sum = 0;
+  Trampoline(TheJIT->getPointerToFunction(F), Packed, &Sum);
+  EXPECT_EQ(3, Sum);
+}
+
 TEST_F(MCJITTest, run_main) {
   SKIP_UNSUPPORTED_PLATFORM;
 
@@ -185,6 +230,58 @@ TEST_F(MCJITTest, multiple_functions) {
     << "Incorrect result returned from function";
 }
 
+TEST_F(MCJITTest, lazy_compilation) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  Function *Add = insertAddFunction(M.get());
+  Function *Caller =
+      insertSimpleCallFunction<int32_t(int32_t, int32_t)>(M.get(), Add);
+  std::string CallerBody = Caller->getName().str() + ".lazy_body";
+
+  createJIT(M.take());
+  TheJIT->DisableLazyCompilation(false);
+  uint64_t ptr = TheJIT->getFunctionAddress(Caller->getName().str());
+  EXPECT_TRUE(0 != ptr)
+    << "Unable to get pointer to caller() from JIT";
+
+  // Only the stubs have been compiled so far.
+  EXPECT_EQ(0u, TheJIT->getFunctionAddress(CallerBody));
+
+  int32_t (*FuncPtr)(int32_t, int32_t) = (int32_t(*)(int32_t, int32_t))ptr;
+  EXPECT_EQ(3, FuncPtr(1, 2));
+  EXPECT_NE(0u, TheJIT->getFunctionAddress(CallerBody));
+  EXPECT_EQ(7, FuncPtr(3, 4));
+}
+
+static int32_t multiplyHelper(int32_t A, int32_t B) {
+  return A * B;
+}
+
+TEST_F(MCJITTest, symbol_address_cache) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  // The helper is not visible to dlsym; only the cache knows where it is.
+  SymbolAddressCache Cache;
+  uint64_t HelperAddr = (uint64_t)(intptr_t)&multiplyHelper;
+  Cache.addSymbol("jit_test_multiply", HelperAddr);
+  Cache.addSymbol("_jit_test_multiply", HelperAddr);
+
+  Function *Helper = insertExternalReferenceToFunction(
+      M.get(), "jit_test_multiply",
+      TypeBuilder<int32_t(int32_t, int32_t), false>::get(Context));
+  Function *Caller =
+      insertSimpleCallFunction<int32_t(int32_t, int32_t)>(M.get(), Helper);
+
+  createJIT(M.take());
+  TheJIT->setSymbolAddressCache(&Cache);
+  uint64_t ptr = TheJIT->getFunctionAddress(Caller->getName().str());
+  EXPECT_TRUE(0 != ptr)
+    << "Unable to get pointer to caller() from JIT";
+
+  int32_t (*FuncPtr)(int32_t, int32_t) = (int32_t(*)(int32_t, int32_t))ptr;
+  EXPECT_EQ(6, FuncPtr(2, 3));
+}
+
 #endif /*!defined(__arm__)*/
 
 }
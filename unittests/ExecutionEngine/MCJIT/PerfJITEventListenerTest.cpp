@@ -0,0 +1,68 @@
+//===- PerfJITEventListenerTest.cpp - Tests for the perf map listener -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/system_error.h"
+#include "MCJITTestBase.h"
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+using namespace llvm;
+
+// The Makefile build compiles every test source in this directory.
+#if LLVM_USE_PERF
+
+namespace {
+
+class PerfJITEventListenerTest : public testing::Test, public MCJITTestBase {
+protected:
+  virtual void SetUp() { M.reset(createEmptyModule("<main>")); }
+};
+
+TEST_F(PerfJITEventListenerTest, WritesPerfMap) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  OwningPtr<JITEventListener> Listener(
+      JITEventListener::createPerfJITEventListener());
+  ASSERT_TRUE(Listener != 0);
+
+  Function *F = insertAddFunction(M.get(), "perf_map_test_add");
+  createJIT(M.take());
+  TheJIT->RegisterJITEventListener(Listener.get());
+  uint64_t Addr = TheJIT->getFunctionAddress(F->getName().str());
+  ASSERT_TRUE(Addr != 0);
+  TheJIT->UnregisterJITEventListener(Listener.get());
+
+  std::string Path;
+  raw_string_ostream(Path) << "/tmp/perf-" << ::getpid() << ".map";
+  OwningPtr<MemoryBuffer> Map;
+  ASSERT_FALSE(MemoryBuffer::getFile(Path, Map));
+
+  // Each line is "START SIZE name" with hex numbers and no 0x prefix.
+  std::string Prefix;
+  raw_string_ostream(Prefix).write_hex(Addr) << ' ';
+  bool Found = false;
+  StringRef Rest = Map->getBuffer();
+  while (!Rest.empty() && !Found) {
+    std::pair<StringRef, StringRef> Line = Rest.split('\n');
+    Rest = Line.second;
+    Found = Line.first.startswith(Prefix) &&
+            Line.first.endswith(" perf_map_test_add");
+  }
+  EXPECT_TRUE(Found) << "No perf map entry for the JITed function";
+}
+
+} // end anonymous namespace
+
+#endif // LLVM_USE_PERF
@@ -0,0 +1,200 @@
+//===- PooledSectionMemoryManagerTest.cpp - Tests for the pooled manager --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/PooledSectionMemoryManager.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+uintptr_t getPage(const uint8_t *Addr) {
+  return (uintptr_t)Addr & ~(sys::process::get_self()->page_size() - 1);
+}
+
+TEST(PooledSectionMemoryManagerTest, BasicAllocations) {
+  SectionMemoryPool Pool;
+  OwningPtr<PooledSectionMemoryManager> MemMgr(
+      new PooledSectionMemoryManager(Pool));
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 2, "", true);
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 3, "");
+  uint8_t *data2 = MemMgr->allocateDataSection(256, 0, 4, "", false);
+
+  EXPECT_NE((uint8_t*)0, code1);
+  EXPECT_NE((uint8_t*)0, code2);
+  EXPECT_NE((uint8_t*)0, data1);
+  EXPECT_NE((uint8_t*)0, data2);
+
+  for (unsigned i = 0; i < 256; ++i) {
+    code1[i] = 1;
+    code2[i] = 2;
+    data1[i] = 3;
+    data2[i] = 4;
+  }
+
+  for (unsigned i = 0; i < 256; ++i) {
+    EXPECT_EQ(1, code1[i]);
+    EXPECT_EQ(2, code2[i]);
+    EXPECT_EQ(3, data1[i]);
+    EXPECT_EQ(4, data2[i]);
+  }
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr->finalizeMemory(&Error));
+
+  // The contents survive finalization and stay readable.
+  for (unsigned i = 0; i < 256; ++i) {
+    EXPECT_EQ(1, code1[i]);
+    EXPECT_EQ(3, data1[i]);
+  }
+
+  // Writable data stays writable.
+  data2[0] = 5;
+  EXPECT_EQ(5, data2[0]);
+}
+
+TEST(PooledSectionMemoryManagerTest, Alignment) {
+  SectionMemoryPool Pool;
+  PooledSectionMemoryManager MemMgr(Pool);
+
+  for (unsigned i = 0; i < 100; ++i) {
+    unsigned Align = 1 << (i % 8);
+    uint8_t *Code = MemMgr.allocateCodeSection(i % 13, Align, i, "");
+    uint8_t *Data = MemMgr.allocateDataSection(i % 7, Align, i, "", i % 2);
+    EXPECT_EQ(0u, (uintptr_t)Code % Align);
+    EXPECT_EQ(0u, (uintptr_t)Data % Align);
+  }
+}
+
+TEST(PooledSectionMemoryManagerTest, SharesSlabs) {
+  SectionMemoryPool Pool;
+  std::vector<PooledSectionMemoryManager*> MemMgrs;
+  std::vector<uint8_t*> Data;
+
+  // The writable data of many managers is packed into the same pages.
+  for (unsigned i = 0; i < 64; ++i) {
+    MemMgrs.push_back(new PooledSectionMemoryManager(Pool));
+    Data.push_back(MemMgrs[i]->allocateDataSection(32, 0, 1, "", false));
+    MemMgrs[i]->allocateCodeSection(32, 0, 2, "");
+    EXPECT_FALSE(MemMgrs[i]->finalizeMemory());
+  }
+  EXPECT_EQ(getPage(Data[0]), getPage(Data[63]));
+
+  // All of it comes from one slab for the code and one for the data.
+  size_t MappedSize = Pool.getMappedSize();
+  EXPECT_GE(2u * 1024 * 1024, MappedSize);
+
+  for (unsigned i = 0; i < 64; ++i)
+    delete MemMgrs[i];
+  EXPECT_EQ(MappedSize, Pool.getMappedSize());
+}
+
+TEST(PooledSectionMemoryManagerTest, PacksCodeUntilFinalized) {
+  SectionMemoryPool Pool;
+  PooledSectionMemoryManager MemMgr(Pool);
+
+  uint8_t *First = MemMgr.allocateCodeSection(16, 0, 0, "");
+  for (unsigned i = 1; i < 64; ++i)
+    EXPECT_EQ(getPage(First),
+              getPage(MemMgr.allocateCodeSection(16, 0, i, "")));
+  EXPECT_FALSE(MemMgr.finalizeMemory());
+
+  // Nothing new may go into a page that is no longer writable.
+  EXPECT_NE(getPage(First), getPage(MemMgr.allocateCodeSection(16, 0, 64, "")));
+}
+
+TEST(PooledSectionMemoryManagerTest, KeepsManagersApart) {
+  SectionMemoryPool Pool;
+  PooledSectionMemoryManager MemMgr1(Pool);
+  PooledSectionMemoryManager MemMgr2(Pool);
+
+  // Finalizing one manager must not make the other one's code read-only
+  // before it is done writing it.
+  uint8_t *Code1 = MemMgr1.allocateCodeSection(16, 0, 1, "");
+  uint8_t *Code2 = MemMgr2.allocateCodeSection(16, 0, 1, "");
+  uint8_t *RO1 = MemMgr1.allocateDataSection(16, 0, 2, "", true);
+  uint8_t *RO2 = MemMgr2.allocateDataSection(16, 0, 2, "", true);
+  EXPECT_NE(getPage(Code1), getPage(Code2));
+  EXPECT_NE(getPage(RO1), getPage(RO2));
+
+  EXPECT_FALSE(MemMgr1.finalizeMemory());
+  Code2[0] = 1;
+  RO2[0] = 2;
+  EXPECT_FALSE(MemMgr2.finalizeMemory());
+}
+
+TEST(PooledSectionMemoryManagerTest, ReusesReleasedMemory) {
+  SectionMemoryPool Pool;
+
+  uint8_t *Code;
+  {
+    PooledSectionMemoryManager MemMgr(Pool);
+    Code = MemMgr.allocateCodeSection(100, 0, 1, "");
+    MemMgr.allocateDataSection(100, 0, 2, "", true);
+    EXPECT_FALSE(MemMgr.finalizeMemory());
+  }
+  size_t MappedSize = Pool.getMappedSize();
+
+  // The pages are writable again once everything on them is released.
+  for (unsigned i = 0; i < 100; ++i) {
+    PooledSectionMemoryManager MemMgr(Pool);
+    uint8_t *NewCode = MemMgr.allocateCodeSection(100, 0, 1, "");
+    uint8_t *NewData = MemMgr.allocateDataSection(100, 0, 2, "", true);
+    EXPECT_EQ(Code, NewCode);
+    NewCode[0] = 1;
+    NewData[0] = 2;
+    EXPECT_FALSE(MemMgr.finalizeMemory());
+  }
+  EXPECT_EQ(MappedSize, Pool.getMappedSize());
+}
+
+TEST(PooledSectionMemoryManagerTest, DeallocateSection) {
+  SectionMemoryPool Pool;
+  PooledSectionMemoryManager MemMgr(Pool);
+
+  uint8_t *Code = MemMgr.allocateCodeSection(100, 0, 1, "");
+  uint8_t *Data = MemMgr.allocateDataSection(100, 0, 2, "", false);
+  EXPECT_FALSE(MemMgr.finalizeMemory());
+
+  // Sections released one at a time are reused by the same manager.
+  MemMgr.deallocateSection(Data, 2);
+  EXPECT_EQ(Data, MemMgr.allocateDataSection(100, 0, 3, "", false));
+
+  MemMgr.deallocateSection(Code, 1);
+  uint8_t *NewCode = MemMgr.allocateCodeSection(100, 0, 4, "");
+  EXPECT_EQ(Code, NewCode);
+  NewCode[0] = 1;
+  EXPECT_FALSE(MemMgr.finalizeMemory());
+}
+
+TEST(PooledSectionMemoryManagerTest, LargeAllocations) {
+  SectionMemoryPool Pool(64 * 1024);
+  PooledSectionMemoryManager MemMgr(Pool);
+
+  uint8_t *Code = MemMgr.allocateCodeSection(0x100000, 0, 1, "");
+  uint8_t *Data = MemMgr.allocateDataSection(0x100000, 0, 2, "", false);
+  EXPECT_NE((uint8_t*)0, Code);
+  EXPECT_NE((uint8_t*)0, Data);
+
+  for (unsigned i = 0; i < 0x100000; ++i) {
+    Code[i] = 1;
+    Data[i] = 2;
+  }
+  for (unsigned i = 0; i < 0x100000; ++i) {
+    EXPECT_EQ(1, Code[i]);
+    EXPECT_EQ(2, Data[i]);
+  }
+  EXPECT_FALSE(MemMgr.finalizeMemory());
+}
+
+} // Namespace
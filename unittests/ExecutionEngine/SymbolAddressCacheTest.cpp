@@ -0,0 +1,55 @@
+//===- SymbolAddressCacheTest.cpp - Unit tests for SymbolAddressCache -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/SymbolAddressCache.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(SymbolAddressCacheTest, AddAndLookup) {
+  SymbolAddressCache Cache;
+  EXPECT_EQ(0u, Cache.lookup("foo"));
+
+  Cache.addSymbol("foo", 0x1000);
+  Cache.addSymbol("bar", 0x2000);
+  EXPECT_EQ(2u, Cache.size());
+  EXPECT_EQ(0x1000u, Cache.lookup("foo"));
+  EXPECT_EQ(0x2000u, Cache.lookup("bar"));
+
+  // A new address replaces the old one.
+  Cache.addSymbol("foo", 0x3000);
+  EXPECT_EQ(0x3000u, Cache.lookup("foo"));
+
+  Cache.removeSymbol("foo");
+  EXPECT_EQ(0u, Cache.lookup("foo"));
+  EXPECT_EQ(1u, Cache.size());
+
+  Cache.clear();
+  EXPECT_EQ(0u, Cache.lookup("bar"));
+  EXPECT_EQ(0u, Cache.size());
+}
+
+TEST(SymbolAddressCacheTest, BatchedLookup) {
+  SymbolAddressCache Cache;
+  Cache.addSymbol("a", 1);
+  Cache.addSymbol("c", 3);
+
+  StringRef Names[] = { "a", "b", "c" };
+  SmallVector<uint64_t, 3> Addrs;
+  Addrs.push_back(42);
+  Cache.lookup(Names, Addrs);
+  ASSERT_EQ(3u, Addrs.size());
+  EXPECT_EQ(1u, Addrs[0]);
+  EXPECT_EQ(0u, Addrs[1]);
+  EXPECT_EQ(3u, Addrs[2]);
+}
+
+} // end anonymous namespace
@@ -44,4 +44,33 @@ TEST(Attributes, Ordering) {
   EXPECT_NE(SetA, SetB);
 }
 
+TEST(Attributes, Lookup) {
+  LLVMContext C;
+
+  AttributeSet ASs[] = {
+    AttributeSet::get(C, AttributeSet::ReturnIndex, Attribute::ZExt),
+    AttributeSet::get(C, 3, Attribute::NoCapture),
+    AttributeSet::get(C, AttributeSet::FunctionIndex, Attribute::NoUnwind)
+  };
+  AttributeSet Set = AttributeSet::get(C, ASs);
+
+  EXPECT_TRUE(Set.hasAttribute(AttributeSet::ReturnIndex, Attribute::ZExt));
+  EXPECT_FALSE(Set.hasAttribute(AttributeSet::ReturnIndex, Attribute::SExt));
+  EXPECT_FALSE(Set.hasAttributes(1));
+  EXPECT_FALSE(Set.hasAttributes(2));
+  EXPECT_TRUE(Set.hasAttribute(3, Attribute::NoCapture));
+  EXPECT_FALSE(Set.hasAttributes(4));
+  EXPECT_TRUE(Set.hasAttribute(AttributeSet::FunctionIndex,
+                               Attribute::NoUnwind));
+  EXPECT_FALSE(Set.hasAttribute(AttributeSet::FunctionIndex,
+                                Attribute::NoCapture));
+
+  EXPECT_TRUE(Set.hasAttrSomewhere(Attribute::NoCapture));
+  EXPECT_FALSE(Set.hasAttrSomewhere(Attribute::SExt));
+
+  EXPECT_EQ(Attribute::get(C, Attribute::NoCapture),
+            Set.getAttribute(3, Attribute::NoCapture));
+  EXPECT_EQ(Attribute(), Set.getAttribute(3, Attribute::ZExt));
+}
+
 } // end anonymous namespace
@@ -8,11 +8,17 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/Constants.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 namespace llvm {
@@ -121,6 +127,87 @@ TEST(ConstantsTest, FP128Test) {
   EXPECT_TRUE(isa<ConstantFP>(X));
 }
 
+// Fold Opcode on A and B with APFloat, the way the folder does when it cannot
+// use host arithmetic.
+static APInt foldWithAPFloat(unsigned Opcode, APFloat A, const APFloat &B) {
+  switch (Opcode) {
+  case Instruction::FAdd:
+    A.add(B, APFloat::rmNearestTiesToEven);
+    break;
+  case Instruction::FSub:
+    A.subtract(B, APFloat::rmNearestTiesToEven);
+    break;
+  case Instruction::FMul:
+    A.multiply(B, APFloat::rmNearestTiesToEven);
+    break;
+  default:
+    A.divide(B, APFloat::rmNearestTiesToEven);
+    break;
+  }
+  return A.bitcastToAPInt();
+}
+
+TEST(ConstantsTest, FoldFloatArithmetic) {
+  LLVMContext Context;
+  const unsigned Opcodes[] = { Instruction::FAdd, Instruction::FSub,
+                               Instruction::FMul, Instruction::FDiv };
+  const uint64_t Doubles[] = {
+    0, 0x8000000000000000ULL,                     // +-0
+    0x3ff0000000000000ULL, 0xbff0000000000000ULL, // +-1
+    0x0010000000000000ULL, 0x0018000000000000ULL, // smallest normals
+    0x000fffffffffffffULL, 0x0000000000000001ULL, // subnormals
+    0x7fefffffffffffffULL, 0xffefffffffffffffULL, // +-largest
+    0x7ff0000000000000ULL, 0xfff0000000000000ULL, // +-inf
+    0x7ff8000000000000ULL, 0x7ff0000000000001ULL, // NaNs
+    0x3ff0000000000001ULL, 0x3ca0000000000000ULL  // rounding ties
+  };
+  const uint32_t Floats[] = {
+    0, 0x80000000, 0x3f800000, 0xbf800000, 0x00800000, 0x00c00000,
+    0x007fffff, 0x00000001, 0x7f7fffff, 0xff7fffff, 0x7f800000, 0xff800000,
+    0x7fc00000, 0x7f800001, 0x3f800001, 0x33800000
+  };
+
+  // Pair the special values with each other, then with pseudo-random bit
+  // patterns, and check the folded result against APFloat bit for bit.
+  uint64_t Seed = 0x9e3779b97f4a7c15ULL;
+  for (unsigned i = 0; i != 2000; ++i) {
+    uint64_t D1, D2;
+    uint32_t F1, F2;
+    if (i < 256) {
+      D1 = Doubles[i / 16];
+      D2 = Doubles[i % 16];
+      F1 = Floats[i / 16];
+      F2 = Floats[i % 16];
+    } else {
+      Seed = Seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      D1 = Seed;
+      // Keep the exponents close half of the time so that results round.
+      D2 = (Seed >> 17) ^ (i & 1 ? Seed & 0x7ff0000000000000ULL : 0);
+      F1 = uint32_t(D1 >> 32);
+      F2 = uint32_t(D2) ^ (i & 1 ? F1 & 0x7f800000 : 0);
+    }
+
+    APFloat AD1(APFloat::IEEEdouble, APInt(64, D1));
+    APFloat AD2(APFloat::IEEEdouble, APInt(64, D2));
+    APFloat AF1(APFloat::IEEEsingle, APInt(32, F1));
+    APFloat AF2(APFloat::IEEEsingle, APInt(32, F2));
+    for (unsigned j = 0; j != array_lengthof(Opcodes); ++j) {
+      Constant *C = ConstantExpr::get(Opcodes[j],
+                                      ConstantFP::get(Context, AD1),
+                                      ConstantFP::get(Context, AD2));
+      EXPECT_EQ(foldWithAPFloat(Opcodes[j], AD1, AD2),
+                cast<ConstantFP>(C)->getValueAPF().bitcastToAPInt())
+        << "double opcode " << Opcodes[j] << " " << D1 << " " << D2;
+
+      C = ConstantExpr::get(Opcodes[j], ConstantFP::get(Context, AF1),
+                            ConstantFP::get(Context, AF2));
+      EXPECT_EQ(foldWithAPFloat(Opcodes[j], AF1, AF2),
+                cast<ConstantFP>(C)->getValueAPF().bitcastToAPInt())
+        << "float opcode " << Opcodes[j] << " " << F1 << " " << F2;
+    }
+  }
+}
+
 TEST(ConstantsTest, PointerCast) {
   LLVMContext &C(getGlobalContext());
   Type *Int8PtrTy = Type::getInt8PtrTy(C);
@@ -256,5 +343,85 @@ TEST(ConstantsTest, AsInstructionsTest) {
 
 #undef CHECK
 
+TEST(ConstantsTest, UniqueExprsAndInlineAsms) {
+  LLVMContext Context;
+  Module M("m", Context);
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  Type *Int64Ty = Type::getInt64Ty(Context);
+  Constant *G = new GlobalVariable(M, Int32Ty, false,
+                                   GlobalValue::ExternalLinkage, 0, "g");
+  Constant *H = new GlobalVariable(M, Int32Ty, false,
+                                   GlobalValue::ExternalLinkage, 0, "h");
+
+  // The same parts give the same constant, any different part another one.
+  Constant *GInt = ConstantExpr::getPtrToInt(G, Int64Ty);
+  EXPECT_EQ(GInt, ConstantExpr::getPtrToInt(G, Int64Ty));
+  EXPECT_NE(GInt, ConstantExpr::getPtrToInt(G, Int32Ty));
+  EXPECT_NE(GInt, ConstantExpr::getPtrToInt(H, Int64Ty));
+  Constant *HInt = ConstantExpr::getPtrToInt(H, Int64Ty);
+  Constant *Eq = ConstantExpr::getICmp(CmpInst::ICMP_EQ, GInt, HInt);
+  EXPECT_EQ(Eq, ConstantExpr::getICmp(CmpInst::ICMP_EQ, GInt, HInt));
+  EXPECT_NE(Eq, ConstantExpr::getICmp(CmpInst::ICMP_NE, GInt, HInt));
+  Constant *Add = ConstantExpr::getAdd(GInt, HInt);
+  EXPECT_EQ(Add, ConstantExpr::getAdd(GInt, HInt));
+  EXPECT_NE(Add, ConstantExpr::getAdd(GInt, HInt, /*HasNUW=*/true));
+
+  // A constant that is destroyed is gone from the map.
+  Constant *One = ConstantInt::get(Int64Ty, 1);
+  Constant *Sub = ConstantExpr::getSub(GInt, One);
+  Sub->destroyConstant();
+  Sub = ConstantExpr::getSub(GInt, One);
+  EXPECT_EQ(Sub, ConstantExpr::getSub(GInt, One));
+
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(Context), false);
+  InlineAsm *Asm = InlineAsm::get(FTy, "nop", "", true);
+  EXPECT_EQ(Asm, InlineAsm::get(FTy, "nop", "", true));
+  EXPECT_NE(Asm, InlineAsm::get(FTy, "nop", "", false));
+  EXPECT_NE(Asm, InlineAsm::get(FTy, "nop", "~{memory}", true));
+}
+
+static uint64_t getElapsedNSec(const sys::TimeValue &Start) {
+  sys::TimeValue Elapsed = sys::TimeValue::now() - Start;
+  return Elapsed.seconds() * 1000000000ULL + Elapsed.nanoseconds();
+}
+
+// Time the creation of new constant expressions and the lookup of existing
+// ones, in the shapes that frontends create most: getelementptrs into
+// globals and casts of them.
+TEST(ConstantsBenchmark, DISABLED_ConstantExprCreation) {
+  static const unsigned Sizes[] = { 1024, 65536, 1048576 };
+  for (unsigned s = 0; s != array_lengthof(Sizes); ++s) {
+    unsigned N = Sizes[s];
+    LLVMContext Context;
+    Module M("m", Context);
+    Type *Int32Ty = Type::getInt32Ty(Context);
+    ArrayType *ArrTy = ArrayType::get(Int32Ty, 16);
+    std::vector<Constant*> Globals;
+    for (unsigned i = 0; i != N / 16; ++i)
+      Globals.push_back(new GlobalVariable(M, ArrTy, false,
+                                           GlobalValue::ExternalLinkage, 0));
+    Constant *Zero = ConstantInt::get(Int32Ty, 0);
+    Type *Int8PtrTy = Type::getInt8PtrTy(Context);
+
+    uint64_t Create = 0, Lookup = 0;
+    for (unsigned Round = 0; Round != 2; ++Round) {
+      sys::TimeValue Start = sys::TimeValue::now();
+      for (unsigned i = 0; i != N; ++i) {
+        Constant *Idx[] = { Zero, ConstantInt::get(Int32Ty, i % 16) };
+        Constant *GEP =
+          ConstantExpr::getInBoundsGetElementPtr(Globals[i / 16], Idx);
+        ConstantExpr::getBitCast(GEP, Int8PtrTy);
+      }
+      (Round == 0 ? Create : Lookup) += getElapsedNSec(Start);
+    }
+
+    // Each iteration made two constants.
+    double Ops = 2.0 * N;
+    outs() << N << " getelementptrs and bitcasts: create "
+           << format("%6.1f", Create / Ops) << ", lookup "
+           << format("%6.1f", Lookup / Ops) << " ns/op\n";
+  }
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
@@ -196,6 +196,79 @@ namespace llvm {
       Passes.add(P);
       Passes.run(*M);
     }
+
+    void expectUpToDate(DominatorTreeBase<BasicBlock> &DT, Function &F) {
+      DominatorTreeBase<BasicBlock> Fresh(false);
+      Fresh.recalculate(F);
+      EXPECT_FALSE(DT.compare(Fresh));
+    }
+
+    void replaceTerminator(BasicBlock *BB, Instruction *NewTerm) {
+      BB->getTerminator()->eraseFromParent();
+      BB->getInstList().push_back(NewTerm);
+    }
+
+    TEST(DominatorTree, IncrementalUpdates) {
+      const char *ModuleString =
+        "define void @f(i1 %c) {\n"
+        "entry:\n"
+        "  br i1 %c, label %a, label %b\n"
+        "a:\n"
+        "  br label %c\n"
+        "b:\n"
+        "  br label %d\n"
+        "c:\n"
+        "  br label %d\n"
+        "d:\n"
+        "  ret void\n"
+        "x:\n"
+        "  br label %c\n"
+        "}\n";
+      SMDiagnostic Err;
+      OwningPtr<Module> M(ParseAssemblyString(ModuleString, NULL, Err,
+                                              getGlobalContext()));
+      Function *F = M->getFunction("f");
+      Function::iterator FI = F->begin();
+      BasicBlock *Entry = FI++;
+      BasicBlock *A = FI++;
+      BasicBlock *B = FI++;
+      BasicBlock *C = FI++;
+      BasicBlock *D = FI++;
+      BasicBlock *X = FI++;
+      Value *Cond = F->arg_begin();
+
+      DominatorTreeBase<BasicBlock> DT(false);
+      DT.recalculate(*F);
+      EXPECT_EQ(Entry, DT.getNode(D)->getIDom()->getBlock());
+
+      // Removing entry->b leaves b unreachable and c the idom of d.
+      replaceTerminator(Entry, BranchInst::Create(A));
+      DT.deleteEdge(Entry, B);
+      expectUpToDate(DT, *F);
+      EXPECT_EQ(0, DT.getNode(B));
+      EXPECT_EQ(C, DT.getNode(D)->getIDom()->getBlock());
+
+      // Adding a->d makes a the idom of d.
+      replaceTerminator(A, BranchInst::Create(C, D, Cond));
+      DT.insertEdge(A, D);
+      expectUpToDate(DT, *F);
+      EXPECT_EQ(A, DT.getNode(D)->getIDom()->getBlock());
+
+      // Adding an edge into an unreachable block makes it reachable.
+      replaceTerminator(D, BranchInst::Create(X));
+      DT.insertEdge(D, X);
+      expectUpToDate(DT, *F);
+      EXPECT_EQ(D, DT.getNode(X)->getIDom()->getBlock());
+      EXPECT_EQ(A, DT.getNode(C)->getIDom()->getBlock());
+
+      // A back edge does not change any dominators.
+      replaceTerminator(X, BranchInst::Create(C, A, Cond));
+      DT.insertEdge(X, A);
+      expectUpToDate(DT, *F);
+      replaceTerminator(X, BranchInst::Create(C));
+      DT.deleteEdge(X, A);
+      expectUpToDate(DT, *F);
+    }
   }
 }
 
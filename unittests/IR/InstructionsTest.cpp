@@ -14,6 +14,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/IRArena.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/MDBuilder.h"
@@ -412,6 +413,55 @@ TEST(InstructionsTest, isEliminableCastPair) {
 
 }
 
+TEST(InstructionsTest, IRArena) {
+  LLVMContext C;
+  Type *Int32 = Type::getInt32Ty(C);
+  Value *One = ConstantInt::get(Int32, 1);
+  IRArena Arena;
+  EXPECT_EQ(0U, Arena.getTotalMemory());
+
+  BinaryOperator *Add;
+  PHINode *PN;
+  {
+    IRArena::Scope S(Arena);
+    EXPECT_EQ(&Arena, IRArena::getCurrent());
+    Add = BinaryOperator::CreateAdd(One, One);
+    PN = PHINode::Create(Int32, 2);
+  }
+  EXPECT_EQ(0, IRArena::getCurrent());
+  EXPECT_TRUE(Arena.contains(Add));
+  EXPECT_TRUE(Arena.contains(PN));
+  EXPECT_EQ(One, Add->getOperand(1));
+  size_t Memory = Arena.getTotalMemory();
+  EXPECT_NE(0U, Memory);
+
+  // Constants and instructions created outside a scope use the heap.
+  BinaryOperator *HeapAdd = BinaryOperator::CreateAdd(One, One);
+  EXPECT_FALSE(Arena.contains(HeapAdd));
+  EXPECT_FALSE(Arena.contains(ConstantInt::get(Int32, 2)));
+
+  {
+    IRArena::Scope S(Arena);
+    // Deleting an instruction in its arena's scope recycles its memory for
+    // the next instruction of the same size.
+    BinaryOperator *Old = Add;
+    delete Add;
+    Add = BinaryOperator::CreateAdd(One, One);
+    EXPECT_EQ(Old, Add);
+    // Growing a PHI node's hung-off operands doesn't involve the arena.
+    PN->addIncoming(One, 0);
+    PN->addIncoming(One, 0);
+    PN->addIncoming(One, 0);
+    EXPECT_FALSE(Arena.contains(PN->op_begin()));
+    delete HeapAdd;
+  }
+  EXPECT_EQ(Memory, Arena.getTotalMemory());
+
+  // Outside a scope, deleting leaves the memory to the arena.
+  delete Add;
+  delete PN;
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
 
@@ -32,6 +32,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/PassInstrumentation.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
@@ -407,6 +408,57 @@ namespace llvm {
       delete M;
     }
 
+    struct InsertInstPass : public FunctionPass {
+      static char ID;
+      InsertInstPass() : FunctionPass(ID) {}
+      virtual bool runOnFunction(Function &F) {
+        Type *Int32Ty = Type::getInt32Ty(F.getContext());
+        Constant *Zero = ConstantInt::get(Int32Ty, 0);
+        BinaryOperator::CreateAdd(Zero, Zero, "",
+                                  F.getEntryBlock().getTerminator());
+        return true;
+      }
+    };
+    char InsertInstPass::ID = 0;
+
+    struct RecordingInstrumentation : public PassInstrumentation {
+      std::vector<PassRunInfo> Runs;
+      Function *SkippedFunction;
+      RecordingInstrumentation() : SkippedFunction(0) {}
+      virtual bool shouldRunPass(Pass *P, Module &M, Function *F) {
+        return F != SkippedFunction;
+      }
+      virtual void passExecuted(const PassRunInfo &Info) {
+        Runs.push_back(Info);
+      }
+    };
+
+    TEST(PassManager, Instrumentation) {
+      OwningPtr<Module> M(makeLLVMModule());
+      RecordingInstrumentation PI;
+      PI.SkippedFunction = M->getFunction("test2");
+      unsigned SkippedSize = PI.SkippedFunction->getEntryBlock().size();
+
+      addPassInstrumentation(&PI);
+      PassManager Passes;
+      Passes.add(new InsertInstPass());
+      Passes.run(*M);
+      removePassInstrumentation(&PI);
+
+      // The function pass manager is not reported, and test2 is skipped.
+      ASSERT_EQ(3u, PI.Runs.size());
+      for (unsigned i = 0, e = PI.Runs.size(); i != e; ++i) {
+        const PassRunInfo &Info = PI.Runs[i];
+        EXPECT_EQ(M.get(), Info.M);
+        ASSERT_TRUE(Info.F != 0);
+        EXPECT_NE(PI.SkippedFunction, Info.F);
+        EXPECT_TRUE(Info.Changed);
+        EXPECT_EQ(Info.InstCountBefore + 1, Info.InstCountAfter);
+        EXPECT_LE(0.0, Info.Time.getWallTime());
+      }
+      EXPECT_EQ(SkippedSize, PI.SkippedFunction->getEntryBlock().size());
+    }
+
     Module* makeLLVMModule() {
       // Module Construction
       Module* mod = new Module("test-mem", getGlobalContext());
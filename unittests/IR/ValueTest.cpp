@@ -7,8 +7,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/BlockNumbering.h"
 #include "llvm/Assembly/Parser.h"
 #include "llvm/IR/Function.h"
+#include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Value.h"
@@ -43,6 +45,76 @@ TEST(ValueTest, UsedInBasicBlock) {
   EXPECT_TRUE(F->arg_begin()->isUsedInBasicBlock(F->begin()));
 }
 
+TEST(ValueTest, DiscardValueNames) {
+  LLVMContext C;
+  C.setDiscardValueNames(true);
+
+  const char *ModuleString = "@g = global i32 0\n"
+                             "define i32 @f(i32 %x) {\n"
+                             "entry:\n"
+                             "  %y = add i32 %x, 1\n"
+                             "  br label %next\n"
+                             "next:\n"
+                             "  %z = load i32* @g\n"
+                             "  %w = add i32 %y, %z\n"
+                             "  ret i32 %w\n"
+                             "}\n";
+  SMDiagnostic Err;
+  OwningPtr<Module> M(ParseAssemblyString(ModuleString, NULL, Err, C));
+  ASSERT_TRUE(M.get() != 0);
+  EXPECT_TRUE(C.shouldDiscardValueNames());
+
+  // Globals keep their names; locals are resolved, then lose theirs.
+  Function *F = M->getFunction("f");
+  ASSERT_TRUE(F != 0);
+  EXPECT_TRUE(M->getGlobalVariable("g") != 0);
+  EXPECT_FALSE(F->arg_begin()->hasName());
+  for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB) {
+    EXPECT_FALSE(BB->hasName());
+    for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I)
+      EXPECT_FALSE(I->hasName());
+  }
+
+  Instruction *Add = BinaryOperator::CreateAdd(F->arg_begin(), F->arg_begin(),
+                                               "sum", F->begin()->begin());
+  EXPECT_FALSE(Add->hasName());
+  Add->setName("sum");
+  EXPECT_FALSE(Add->hasName());
+  Add->eraseFromParent();
+}
+
+TEST(ValueTest, BasicBlockNumbers) {
+  LLVMContext C;
+  Module M("test", C);
+  Function *F = Function::Create(FunctionType::get(Type::getVoidTy(C), false),
+                                 GlobalValue::ExternalLinkage, "f", &M);
+  BasicBlock *BB0 = BasicBlock::Create(C, "", F);
+  BasicBlock *BB1 = BasicBlock::Create(C, "", F);
+  BasicBlock *BB2 = BasicBlock::Create(C, "", F);
+  EXPECT_EQ(0, BB0->getNumber());
+  EXPECT_EQ(1, BB1->getNumber());
+  EXPECT_EQ(2, BB2->getNumber());
+
+  // Numbers are not reused, so the cache must not mistake BB1 for BB2.
+  BlockNumberCache<BasicBlock, BasicBlock *> Cache;
+  Cache.insert(BB1, BB0);
+  EXPECT_EQ(BB0, Cache.lookup(BB1));
+  EXPECT_EQ(0, Cache.lookup(BB2));
+
+  BB1->removeFromParent();
+  EXPECT_EQ(-1, BB1->getNumber());
+  EXPECT_EQ(0, Cache.lookup(BB1));
+  F->getBasicBlockList().push_back(BB1);
+  EXPECT_EQ(3, BB1->getNumber());
+  EXPECT_EQ(4u, F->getMaxBlockNumber());
+  EXPECT_EQ(0, Cache.lookup(BB1));
+
+  Cache.insert(BB1, BB2);
+  EXPECT_EQ(BB2, Cache.lookup(BB1));
+  Cache.erase(BB1);
+  EXPECT_EQ(0, Cache.lookup(BB1));
+}
+
 TEST(GlobalTest, CreateAddressSpace) {
   LLVMContext &Ctx = getGlobalContext();
   OwningPtr<Module> M(new Module("TestModule", Ctx));
@@ -18,6 +18,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "gtest/gtest.h"
+#include <algorithm>
 
 namespace llvm {
 namespace {
@@ -77,5 +78,81 @@ TEST(VerifierTest, InvalidRetAttribute) {
               startswith("Attribute 'uwtable' only applies to functions!"));
 }
 
+TEST(VerifierTest, OnlyModifiedFunctions) {
+  LLVMContext &C = getGlobalContext();
+  Module M("M", C);
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(C), /*isVarArg=*/false);
+  Function *F = cast<Function>(M.getOrInsertFunction("foo", FTy));
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  ReturnInst *Ret = ReturnInst::Create(C, Entry);
+  Constant *Zero = ConstantInt::get(Type::getInt32Ty(C), 0);
+  Instruction *X = BinaryOperator::CreateAdd(Zero, Zero, "x", Ret);
+  Instruction *Y = BinaryOperator::CreateAdd(X, X, "y", Ret);
+
+  EXPECT_TRUE(F->isModifiedSinceVerified());
+  EXPECT_FALSE(verifyModule(M, ReturnStatusAction));
+  EXPECT_FALSE(F->isModifiedSinceVerified());
+
+  // Moving an instruction counts as a change, and this one breaks dominance.
+  Y->moveBefore(X);
+  EXPECT_TRUE(F->isModifiedSinceVerified());
+  EXPECT_FALSE(verifyModifiedFunctions(M, ReturnStatusAction, VerifyStructure));
+  EXPECT_TRUE(F->isModifiedSinceVerified());
+
+  std::string Error;
+  EXPECT_TRUE(verifyModifiedFunctions(M, ReturnStatusAction, VerifyAll,
+                                      &Error));
+  EXPECT_TRUE(StringRef(Error).
+              startswith("Instruction does not dominate all uses!"));
+
+  // Once fixed and verified, the function is skipped until it changes again.
+  X->moveBefore(Y);
+  EXPECT_FALSE(verifyModifiedFunctions(M, ReturnStatusAction));
+  EXPECT_FALSE(F->isModifiedSinceVerified());
+  Y->setOperand(0, Zero);
+  EXPECT_FALSE(F->isModifiedSinceVerified());
+  X->replaceAllUsesWith(Zero);
+  EXPECT_TRUE(F->isModifiedSinceVerified());
+}
+
+TEST(VerifierTest, MaintainedPredecessors) {
+  LLVMContext &C = getGlobalContext();
+  Module M("M", C);
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(C), /*isVarArg=*/false);
+  Function *F = cast<Function>(M.getOrInsertFunction("foo", FTy));
+  BasicBlock *Entry = BasicBlock::Create(C, "entry", F);
+  BasicBlock *Left = BasicBlock::Create(C, "left", F);
+  BasicBlock *Exit = BasicBlock::Create(C, "exit", F);
+  Constant *False = ConstantInt::getFalse(C);
+  BranchInst *EntryBr = BranchInst::Create(Left, Exit, False, Entry);
+  BranchInst::Create(Exit, Left);
+  ReturnInst::Create(C, Exit);
+
+  Exit->setMaintainsPredecessors(true);
+  EXPECT_EQ(2U, Exit->getMaintainedPredecessors().size());
+  EXPECT_EQ(0, Exit->getUniquePredecessor());
+
+  // Redirecting an edge updates the list.
+  EntryBr->setSuccessor(0, Exit);
+  EXPECT_EQ(3U, Exit->getMaintainedPredecessors().size());
+  EXPECT_FALSE(verifyFunction(*F, ReturnStatusAction));
+
+  // So does moving a terminator to another block.
+  BasicBlock *Split = Entry->splitBasicBlock(EntryBr, "split");
+  EXPECT_FALSE(verifyFunction(*F, ReturnStatusAction));
+  ArrayRef<BasicBlock*> Preds = Exit->getMaintainedPredecessors();
+  EXPECT_EQ(2, std::count(Preds.begin(), Preds.end(), Split));
+
+  // And erasing a terminator and dropping a block's references.
+  EntryBr->eraseFromParent();
+  BranchInst::Create(Left, Split);
+  EXPECT_EQ(Left, Exit->getSinglePredecessor());
+  Left->dropAllReferences();
+  EXPECT_EQ(0U, Exit->getMaintainedPredecessors().size());
+
+  Exit->setMaintainsPredecessors(false);
+  EXPECT_FALSE(Exit->maintainsPredecessors());
+}
+
 }
 }
@@ -13,6 +13,9 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 #include <algorithm>
 
@@ -45,7 +48,7 @@ TEST(WaymarkTest, NativeArray) {
 TEST(WaymarkTest, TwoBit) {
   Use* many = (Use*)calloc(sizeof(Use), 8212 + 1);
   ASSERT_TRUE(many);
-  Use::initTags(many, many + 8212);
+  Use::initTags(many, many + 8212, reinterpret_cast<User *>(many + 8212));
   for (Use *U = many, *Ue = many + 8212 - 1; U != Ue; ++U)
   {
     EXPECT_EQ(reinterpret_cast<User *>(Ue + 1), U->getUser());
@@ -53,5 +56,35 @@ TEST(WaymarkTest, TwoBit) {
   free(many);
 }
 
+// Times getUser() on calls with many operands, to compare waymarking with
+// LLVM_ENABLE_USE_BACK_POINTERS.  Run it with --gtest_also_run_disabled_tests.
+TEST(WaymarkTest, DISABLED_GetUserBenchmark) {
+  LLVMContext Context;
+  std::vector<Value *> Args(1000, ConstantInt::get(Type::getInt8Ty(Context),
+                                                   1));
+  FunctionType *FT = FunctionType::get(Type::getVoidTy(Context), true);
+  Function *F = Function::Create(FT, GlobalValue::ExternalLinkage);
+  std::vector<CallInst *> Calls;
+  for (unsigned i = 0; i != 100; ++i)
+    Calls.push_back(CallInst::Create(F, Args));
+
+  TimeRecord Start = TimeRecord::getCurrentTime(true);
+  unsigned Found = 0;
+  for (unsigned Iter = 0; Iter != 100; ++Iter)
+    for (unsigned i = 0, e = Calls.size(); i != e; ++i)
+      for (User::op_iterator OI = Calls[i]->op_begin(),
+                             OE = Calls[i]->op_end(); OI != OE; ++OI)
+        Found += OI->getUser() == Calls[i];
+  TimeRecord Time = TimeRecord::getCurrentTime(false);
+  Time -= Start;
+  EXPECT_EQ(100U * 100U * 1001U, Found);
+  outs() << "getUser: " << format("%.4f", Time.getWallTime()) << "s for "
+         << Found << " uses\n";
+
+  for (unsigned i = 0, e = Calls.size(); i != e; ++i)
+    delete Calls[i];
+  delete F;
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
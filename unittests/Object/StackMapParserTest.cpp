@@ -0,0 +1,113 @@
+//===- llvm/unittest/Object/StackMapParserTest.cpp - StackMapParser tests -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Object/StackMapParser.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+typedef StackMapParser<support::little> LittleParser;
+
+class StackMapBuilder {
+  std::vector<uint8_t> Bytes;
+
+  void emit(uint64_t V, unsigned Size) {
+    for (unsigned i = 0; i != Size; ++i)
+      Bytes.push_back(uint8_t(V >> (8 * i)));
+  }
+
+public:
+  void emit8(uint8_t V) { emit(V, 1); }
+  void emit16(uint16_t V) { emit(V, 2); }
+  void emit32(uint32_t V) { emit(V, 4); }
+  void emit64(uint64_t V) { emit(V, 8); }
+
+  void emitLocation(uint8_t Kind, uint16_t Reg, int32_t Offset) {
+    emit8(Kind);
+    emit8(8);
+    emit16(Reg);
+    emit32(uint32_t(Offset));
+  }
+
+  ArrayRef<uint8_t> get() const { return Bytes; }
+  ArrayRef<uint8_t> get(size_t Size) const {
+    return ArrayRef<uint8_t>(&Bytes[0], Size);
+  }
+};
+
+// Two constants, then a record with three locations and one with none.
+void buildSection(StackMapBuilder &B) {
+  B.emit32(0);
+  B.emit32(2);
+  B.emit64(0x100000000ULL);
+  B.emit64(uint64_t(-2));
+  B.emit32(2);
+
+  B.emit32(1);
+  B.emit32(0x40);
+  B.emit16(0);
+  B.emit16(3);
+  B.emitLocation(LittleParser::RegisterLocation, 6, 0);
+  B.emitLocation(LittleParser::IndirectLocation, 7, -16);
+  B.emitLocation(LittleParser::ConstantIndexLocation, 0, 1);
+
+  B.emit32(~0U);
+  B.emit32(0x80);
+  B.emit16(0);
+  B.emit16(0);
+}
+
+TEST(StackMapParserTest, Records) {
+  StackMapBuilder B;
+  buildSection(B);
+  LittleParser P(B.get());
+
+  EXPECT_TRUE(P.isValid());
+  ASSERT_EQ(2U, P.getNumConstants());
+  EXPECT_EQ(0x100000000ULL, P.getConstant(0).getValue());
+  ASSERT_EQ(2U, P.getNumRecords());
+
+  LittleParser::RecordAccessor R = P.getRecord(0);
+  EXPECT_EQ(1U, R.getID());
+  EXPECT_EQ(0x40U, R.getInstructionOffset());
+  ASSERT_EQ(3U, R.getNumLocations());
+  EXPECT_EQ(LittleParser::RegisterLocation, R.getLocation(0).getKind());
+  EXPECT_EQ(6U, R.getLocation(0).getDwarfRegNum());
+  EXPECT_EQ(LittleParser::IndirectLocation, R.getLocation(1).getKind());
+  EXPECT_EQ(7U, R.getLocation(1).getDwarfRegNum());
+  EXPECT_EQ(-16, R.getLocation(1).getOffset());
+  EXPECT_EQ(8U, R.getLocation(1).getSizeInBytes());
+  EXPECT_EQ(1U, R.getLocation(2).getConstantIndex());
+  EXPECT_EQ(-2, P.getConstantValue(R.getLocation(2)));
+
+  LittleParser::RecordAccessor Invalid = P.getRecord(1);
+  EXPECT_EQ(~0U, Invalid.getID());
+  EXPECT_EQ(0x80U, Invalid.getInstructionOffset());
+  EXPECT_EQ(0U, Invalid.getNumLocations());
+}
+
+TEST(StackMapParserTest, Truncated) {
+  StackMapBuilder B;
+  buildSection(B);
+
+  // Cut the second record short; the first is still available.
+  LittleParser P(B.get(B.get().size() - 2));
+  EXPECT_FALSE(P.isValid());
+  EXPECT_EQ(1U, P.getNumRecords());
+  EXPECT_EQ(1U, P.getRecord(0).getID());
+
+  LittleParser Empty(B.get(4));
+  EXPECT_FALSE(Empty.isValid());
+  EXPECT_EQ(0U, Empty.getNumRecords());
+}
+
+} // end anonymous namespace
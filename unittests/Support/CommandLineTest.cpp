@@ -81,6 +81,26 @@ TEST(CommandLineTest, ModifyExisitingOption) {
   ASSERT_EQ(cl::Hidden, TestOption.getOptionHiddenFlag()) <<
     "Failed to modify option's hidden flag.";
 }
+
+cl::opt<std::string> RenamedOption("renamed-option", cl::ZeroOrMore);
+TEST(CommandLineTest, ParseRenamedOption) {
+  const char *const Args1[] = { "prog", "-renamed-option=old" };
+  cl::ParseCommandLineOptions(2, Args1);
+  EXPECT_EQ("old", RenamedOption);
+
+  // The parser keeps its table of options between calls; renaming an option
+  // must still be seen by the next one.
+  RenamedOption.setArgStr("renamed-option-new");
+  const char *const Args2[] = { "prog", "-renamed-option-new=new" };
+  cl::ParseCommandLineOptions(2, Args2);
+  EXPECT_EQ("new", RenamedOption);
+
+  StringMap<cl::Option*> Map;
+  cl::getRegisteredOptions(Map);
+  EXPECT_EQ(0u, Map.count("renamed-option"));
+  EXPECT_EQ(&RenamedOption, Map.lookup("renamed-option-new"));
+}
+
 #ifndef SKIP_ENVIRONMENT_TESTS
 
 const char test_env_var[] = "LLVM_TEST_COMMAND_LINE_FLAGS";
@@ -168,4 +168,44 @@ TEST_F(MemoryBufferTest, getOpenFileReopened) {
   testGetOpenFileSlice(true);
 }
 
+TEST_F(MemoryBufferTest, getFileWithOptions) {
+  // Test that the access hints do not change the contents of the buffer,
+  // whether the file is mapped or read.
+  int TestFD;
+  SmallString<64> TestPath;
+  sys::fs::createTemporaryFile("MemoryBufferTest_Options", "temp", TestFD,
+                               TestPath);
+  raw_fd_ostream OF(TestFD, true, /*unbuffered=*/true);
+  for (int i = 0; i < 60000; ++i)
+    OF << "0123456789";
+  OF.close();
+
+  for (unsigned MinMapSize = 0; MinMapSize != 2; ++MinMapSize) {
+    MemoryBuffer::OpenOptions Options;
+    Options.Access = MemoryBuffer::AP_Sequential;
+    Options.Prefetch = true;
+    Options.Populate = true;
+    Options.HugePages = true;
+    // Never map the file in the second round.
+    Options.MinMapSize = MinMapSize ? 1000000 : 0;
+
+    OwningBuffer Buf;
+    error_code EC =
+      MemoryBuffer::getFile(TestPath.c_str(), Buf, -1, false, Options);
+    ASSERT_FALSE(EC);
+    EXPECT_EQ(MinMapSize ? MemoryBuffer::MemoryBuffer_Malloc
+                         : MemoryBuffer::MemoryBuffer_MMap,
+              Buf->getBufferKind());
+
+    StringRef BufData = Buf->getBuffer();
+    ASSERT_EQ(600000U, BufData.size());
+    Buf->adviseAccess(MemoryBuffer::AP_Random);
+    Buf->adviseAccess(MemoryBuffer::AP_WillNeed, BufData.slice(5000, 9000));
+    // A range outside of the buffer is ignored.
+    Buf->adviseAccess(MemoryBuffer::AP_WillNeed, data);
+    EXPECT_EQ('0', BufData[0]);
+    EXPECT_EQ('9', BufData[599999]);
+  }
+}
+
 }
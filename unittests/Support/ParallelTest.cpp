@@ -0,0 +1,172 @@
+//===- llvm/unittest/Support/ParallelTest.cpp - Parallel algorithm tests --===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+// A linear congruential generator, so that the inputs are the same on every
+// host.
+std::vector<unsigned> getRandomVector(size_t N) {
+  std::vector<unsigned> V(N);
+  unsigned Seed = 12345;
+  for (size_t i = 0; i != N; ++i) {
+    Seed = Seed * 1103515245 + 12345;
+    V[i] = Seed >> 8;
+  }
+  return V;
+}
+
+struct Square {
+  std::vector<unsigned> *Out;
+  void operator()(size_t I) const { (*Out)[I] = I * I; }
+};
+
+TEST(ParallelTest, For) {
+  std::vector<unsigned> V(10000);
+  Square Fn = { &V };
+  parallel_for(size_t(0), V.size(), Fn);
+  for (size_t i = 0, e = V.size(); i != e; ++i)
+    EXPECT_EQ(i * i, V[i]);
+
+  // Empty and single element ranges.
+  parallel_for(size_t(0), size_t(0), Fn);
+  parallel_for(size_t(3), size_t(4), Fn);
+  EXPECT_EQ(9u, V[3]);
+}
+
+struct Double {
+  void operator()(unsigned &X) const { X *= 2; }
+};
+
+TEST(ParallelTest, ForEach) {
+  std::vector<unsigned> V = getRandomVector(10000);
+  std::vector<unsigned> Expected = V;
+  std::for_each(Expected.begin(), Expected.end(), Double());
+  parallel_for_each(V.begin(), V.end(), Double());
+  EXPECT_EQ(Expected, V);
+}
+
+TEST(ParallelTest, Sort) {
+  std::vector<unsigned> V = getRandomVector(100000);
+  std::vector<unsigned> Expected = V;
+  std::sort(Expected.begin(), Expected.end());
+  parallel_sort(V.begin(), V.end());
+  EXPECT_EQ(Expected, V);
+
+  V = getRandomVector(100000);
+  std::sort(Expected.begin(), Expected.end(), std::greater<unsigned>());
+  parallel_sort(V.begin(), V.end(), std::greater<unsigned>());
+  EXPECT_EQ(Expected, V);
+
+  // Sizes that do not split evenly and that are too small to split.
+  for (size_t N = 0; N != 5000; N += 777) {
+    V = getRandomVector(N);
+    Expected = V;
+    std::sort(Expected.begin(), Expected.end());
+    parallel_sort(V.begin(), V.end());
+    EXPECT_EQ(Expected, V);
+  }
+}
+
+struct Identity {
+  uint64_t operator()(unsigned X) const { return X; }
+};
+
+struct Concat {
+  std::vector<unsigned> operator()(std::vector<unsigned> A,
+                                   const std::vector<unsigned> &B) const {
+    A.insert(A.end(), B.begin(), B.end());
+    return A;
+  }
+};
+
+struct Wrap {
+  std::vector<unsigned> operator()(unsigned X) const {
+    return std::vector<unsigned>(1, X);
+  }
+};
+
+TEST(ParallelTest, TransformReduce) {
+  std::vector<unsigned> V = getRandomVector(100000);
+  uint64_t Expected = 42;
+  for (size_t i = 0, e = V.size(); i != e; ++i)
+    Expected += V[i];
+  EXPECT_EQ(Expected, parallel_transform_reduce(V.begin(), V.end(),
+                                                uint64_t(42),
+                                                std::plus<uint64_t>(),
+                                                Identity()));
+  EXPECT_EQ(42u, parallel_transform_reduce(V.begin(), V.begin(), uint64_t(42),
+                                           std::plus<uint64_t>(), Identity()));
+
+  // The values are combined in order.
+  std::vector<unsigned> Init(1, 7);
+  std::vector<unsigned> Result =
+    parallel_transform_reduce(V.begin(), V.begin() + 5000, Init, Concat(),
+                              Wrap());
+  ASSERT_EQ(5001u, Result.size());
+  EXPECT_EQ(7u, Result[0]);
+  EXPECT_TRUE(std::equal(V.begin(), V.begin() + 5000, Result.begin() + 1));
+}
+
+// Microbenchmarks, comparing the parallel algorithms with their serial
+// counterparts.  Run them with --gtest_also_run_disabled_tests.
+
+double getElapsedMSec(const sys::TimeValue &Start) {
+  return (sys::TimeValue::now() - Start).msec();
+}
+
+TEST(ParallelTest, DISABLED_SortBenchmark) {
+  std::vector<unsigned> V = getRandomVector(10000000);
+  std::vector<unsigned> W = V;
+
+  sys::TimeValue Start = sys::TimeValue::now();
+  std::sort(V.begin(), V.end());
+  double Serial = getElapsedMSec(Start);
+
+  Start = sys::TimeValue::now();
+  parallel_sort(W.begin(), W.end());
+  double Parallel = getElapsedMSec(Start);
+
+  EXPECT_EQ(V, W);
+  outs() << "sort of " << V.size() << " elements: std::sort " << Serial
+         << " ms, parallel_sort " << Parallel << " ms on "
+         << ThreadPool::getDefault().getThreadCount() << " threads\n";
+}
+
+TEST(ParallelTest, DISABLED_TransformReduceBenchmark) {
+  std::vector<unsigned> V = getRandomVector(50000000);
+
+  sys::TimeValue Start = sys::TimeValue::now();
+  uint64_t SerialSum = 0;
+  for (size_t i = 0, e = V.size(); i != e; ++i)
+    SerialSum += V[i];
+  double Serial = getElapsedMSec(Start);
+
+  Start = sys::TimeValue::now();
+  uint64_t ParallelSum =
+    parallel_transform_reduce(V.begin(), V.end(), uint64_t(0),
+                              std::plus<uint64_t>(), Identity());
+  double Parallel = getElapsedMSec(Start);
+
+  EXPECT_EQ(SerialSum, ParallelSum);
+  outs() << "sum of " << V.size() << " elements: loop " << Serial
+         << " ms, parallel_transform_reduce " << Parallel << " ms on "
+         << ThreadPool::getDefault().getThreadCount() << " threads\n";
+}
+
+} // end anonymous namespace
@@ -39,6 +39,16 @@ TEST(ProcessTest, SelfProcess) {
   EXPECT_GT(TimeValue::MaxTime, process::get_self()->get_wall_time());
 }
 
+TEST(ProcessTest, MonotonicTime) {
+  TimeValue Start = Process::GetMonotonicTime();
+  TimeValue Last = Start;
+  for (unsigned i = 0; i != 1000; ++i) {
+    TimeValue Now = Process::GetMonotonicTime();
+    EXPECT_LE(Last, Now);
+    Last = Now;
+  }
+}
+
 #ifdef _MSC_VER
 #define setenv(name, var, ignore) _putenv_s(name, var)
 #endif
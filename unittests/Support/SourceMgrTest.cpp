@@ -172,3 +172,19 @@ TEST_F(SourceMgrTest, FixitForTab) {
             Output);
 }
 
+
+TEST_F(SourceMgrTest, LineAndColumn) {
+  setMainBuffer("aaa\nbb\r\ncc\n\nddd", "file.in");
+
+  // Look the locations up out of order, so that no query can build on the
+  // one before it.
+  EXPECT_EQ(std::make_pair(5U, 3U), SM.getLineAndColumn(getLoc(14)));
+  EXPECT_EQ(std::make_pair(1U, 1U), SM.getLineAndColumn(getLoc(0)));
+  EXPECT_EQ(std::make_pair(1U, 4U), SM.getLineAndColumn(getLoc(3)));
+  EXPECT_EQ(std::make_pair(3U, 2U), SM.getLineAndColumn(getLoc(9)));
+  EXPECT_EQ(std::make_pair(2U, 1U), SM.getLineAndColumn(getLoc(4)));
+  EXPECT_EQ(std::make_pair(2U, 1U), SM.getLineAndColumn(getLoc(7)));
+  EXPECT_EQ(std::make_pair(4U, 1U), SM.getLineAndColumn(getLoc(11)));
+  EXPECT_EQ(5U, SM.FindLineNumber(getLoc(15)));
+  EXPECT_EQ(3U, SM.FindLineNumber(getLoc(8)));
+}
@@ -0,0 +1,99 @@
+//===- llvm/unittest/Support/ThreadPoolTest.cpp - ThreadPool tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Atomic.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+void increment(void *Arg) {
+  sys::AtomicIncrement(static_cast<volatile sys::cas_flag *>(Arg));
+}
+
+TEST(ThreadPoolTest, AsyncAndWait) {
+  ThreadPool Pool(4);
+  volatile sys::cas_flag Count = 0;
+  for (unsigned i = 0; i != 1000; ++i)
+    Pool.async(increment, const_cast<sys::cas_flag *>(&Count));
+  Pool.wait();
+  EXPECT_EQ(1000u, Count);
+}
+
+TEST(ThreadPoolTest, DestructorWaits) {
+  volatile sys::cas_flag Count = 0;
+  {
+    ThreadPool Pool(2);
+    for (unsigned i = 0; i != 100; ++i)
+      Pool.async(increment, const_cast<sys::cas_flag *>(&Count));
+  }
+  EXPECT_EQ(100u, Count);
+}
+
+TEST(ThreadPoolTest, TaskGroup) {
+  ThreadPool Pool(4);
+  volatile sys::cas_flag Count1 = 0, Count2 = 0;
+  TaskGroup Group1(Pool), Group2(Pool);
+  for (unsigned i = 0; i != 100; ++i) {
+    Group1.spawn(increment, const_cast<sys::cas_flag *>(&Count1));
+    Group2.spawn(increment, const_cast<sys::cas_flag *>(&Count2));
+  }
+  Group1.wait();
+  EXPECT_EQ(100u, Count1);
+  Group2.wait();
+  EXPECT_EQ(100u, Count2);
+}
+
+struct Node {
+  ThreadPool *Pool;
+  unsigned Depth;
+  volatile sys::cas_flag *Count;
+};
+
+// Spawn two children into a nested group and wait for them from the task.
+void visit(void *Arg) {
+  Node *N = static_cast<Node *>(Arg);
+  sys::AtomicIncrement(N->Count);
+  if (N->Depth == 0)
+    return;
+  Node Children[2] = {
+    { N->Pool, N->Depth - 1, N->Count },
+    { N->Pool, N->Depth - 1, N->Count }
+  };
+  TaskGroup Group(*N->Pool);
+  Group.spawn(visit, &Children[0]);
+  Group.spawn(visit, &Children[1]);
+  Group.wait();
+}
+
+TEST(ThreadPoolTest, NestedGroups) {
+  // Waiting from inside the tasks must not deadlock even when there are more
+  // waiting tasks than workers.
+  ThreadPool Pool(2);
+  volatile sys::cas_flag Count = 0;
+  Node Root = { &Pool, 10, &Count };
+  TaskGroup Group(Pool);
+  Group.spawn(visit, &Root);
+  Group.wait();
+  EXPECT_EQ((1u << 11) - 1, Count);
+}
+
+TEST(ThreadPoolTest, DefaultPool) {
+  ThreadPool &Pool = ThreadPool::getDefault();
+  EXPECT_LE(Pool.getThreadCount(), ThreadPool::getHardwareConcurrency());
+  volatile sys::cas_flag Count = 0;
+  TaskGroup Group(Pool);
+  Group.spawn(increment, const_cast<sys::cas_flag *>(&Count));
+  Group.wait();
+  EXPECT_EQ(1u, Count);
+}
+
+} // end anonymous namespace
@@ -0,0 +1,49 @@
+//===- unittests/Support/TimerTest.cpp - Timer tests ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(TimerTest, WallTimeOnly) {
+  TimerGroup TG("Wall time only", /*WallTimeOnly=*/true);
+  EXPECT_TRUE(TG.isWallTimeOnly());
+
+  Timer T1("first", TG), T2("second", TG);
+  for (unsigned i = 0; i != 100; ++i) {
+    TimeRegion R(T1);
+  }
+  {
+    TimeRegion R(T2);
+  }
+
+  std::string Report;
+  raw_string_ostream OS(Report);
+  TG.print(OS);
+  OS.flush();
+
+  EXPECT_NE(std::string::npos, Report.find("Wall time only"));
+  EXPECT_NE(std::string::npos, Report.find("seconds (wall clock)"));
+  EXPECT_NE(std::string::npos, Report.find("first"));
+  EXPECT_NE(std::string::npos, Report.find("second"));
+  EXPECT_EQ(std::string::npos, Report.find("User Time"));
+  EXPECT_EQ(std::string::npos, Report.find("System Time"));
+
+  // The timers were reset by printing.
+  Report.clear();
+  TG.print(OS);
+  OS.flush();
+  EXPECT_TRUE(Report.empty());
+}
+
+} // end anonymous namespace
@@ -30,4 +30,31 @@ TEST(formatted_raw_ostreamTest, Test_Tell) {
   }
 }
 
+TEST(formatted_raw_ostreamTest, Test_PositionTracking) {
+  SmallString<128> A;
+  raw_svector_ostream B(A);
+  formatted_raw_ostream C(B);
+
+  C << "ab\ncd";
+  C.flush();
+  EXPECT_EQ(1U, C.getLine());
+  EXPECT_EQ(2U, C.getColumn());
+
+  // Nothing written while tracking is off is counted.
+  C.setPositionTracking(false);
+  EXPECT_FALSE(C.isTrackingPosition());
+  C << "\n\nxyz";
+  C.flush();
+  EXPECT_EQ(1U, C.getLine());
+  EXPECT_EQ(2U, C.getColumn());
+
+  C.setPositionTracking(true);
+  C << "\nx";
+  C.PadToColumn(4);
+  C.flush();
+  EXPECT_EQ(2U, C.getLine());
+  EXPECT_EQ(4U, C.getColumn());
+  EXPECT_EQ("ab\ncd\n\nxyz\nx   ", A.str());
+}
+
 }
@@ -8,8 +8,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "gtest/gtest.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -143,4 +147,125 @@ TEST(raw_ostreamTest, WriteEscaped) {
   EXPECT_EQ("\\001\\010\\200", Str);
 }
 
+/// writeReserved - Write Prefix to OS, reserve Reserved bytes and then write
+/// Size more bytes, half of them one at a time.  Return what was written.
+static std::string writeReserved(raw_fd_ostream &OS, StringRef Prefix,
+                                 uint64_t Reserved, size_t Size) {
+  std::string Expected = Prefix;
+  OS << Prefix;
+  OS.reserveExtraSpace(Reserved);
+  for (size_t i = 0; i != Size / 2; ++i) {
+    char C = 'a' + i % 26;
+    OS << C;
+    Expected += C;
+  }
+  std::string Rest(Size - Size / 2, 'z');
+  OS << Rest;
+  Expected += Rest;
+  return Expected;
+}
+
+static std::string readFile(StringRef Path) {
+  OwningPtr<MemoryBuffer> Buffer;
+  if (MemoryBuffer::getFile(Path, Buffer))
+    return "";
+  return Buffer->getBuffer();
+}
+
+TEST(raw_ostreamTest, ReserveExtraSpace) {
+  const size_t Sizes[] = { 0, 100000, 200000, 300000 };
+  for (unsigned i = 0; i != array_lengthof(Sizes); ++i) {
+    // Streams that open the file themselves, buffered or not.
+    for (unsigned Unbuffered = 0; Unbuffered != 2; ++Unbuffered) {
+      SmallString<64> Path;
+      ASSERT_FALSE(sys::fs::createTemporaryFile("raw_ostream", "", Path));
+      std::string Expected;
+      {
+        std::string ErrorInfo;
+        raw_fd_ostream OS(Path.c_str(), ErrorInfo, sys::fs::F_Binary);
+        ASSERT_EQ("", ErrorInfo);
+        if (Unbuffered)
+          OS.SetUnbuffered();
+        Expected = writeReserved(OS, "header", 200000, Sizes[i]);
+      }
+      EXPECT_EQ(Expected, readFile(Path));
+      sys::fs::remove(Path.str());
+    }
+
+    // A stream given a file descriptor that can be read from.
+    int FD;
+    SmallString<64> Path;
+    ASSERT_FALSE(sys::fs::createTemporaryFile("raw_ostream", "", FD, Path));
+    std::string Expected;
+    {
+      raw_fd_ostream OS(FD, true);
+      Expected = writeReserved(OS, "header", 200000, Sizes[i]);
+    }
+    EXPECT_EQ(Expected, readFile(Path));
+    sys::fs::remove(Path.str());
+  }
+}
+
+TEST(raw_ostreamTest, AsyncWrites) {
+  SmallString<64> Path;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("raw_ostream", "", Path));
+  std::string Expected;
+  {
+    std::string ErrorInfo;
+    raw_fd_ostream OS(Path.c_str(), ErrorInfo, sys::fs::F_Binary);
+    ASSERT_EQ("", ErrorInfo);
+    OS.SetUseAsyncWrites(true);
+
+    // Enough small writes to fill the buffer several times, then writes
+    // larger than the buffer.
+    for (unsigned i = 0; i != 500000; ++i) {
+      OS << i << '\n';
+      Expected += utostr(i) + '\n';
+    }
+    std::string Large(3 * 1024 * 1024, 'x');
+    OS << Large;
+    Expected += Large;
+    EXPECT_EQ(Expected.size(), OS.tell());
+
+    // Seeking waits for the pending output before moving.
+    OS.seek(0);
+    OS << "start";
+    Expected.replace(0, 5, "start");
+    OS.seek(Expected.size());
+    OS << "end";
+    Expected += "end";
+
+    OS.SetUseAsyncWrites(false);
+    OS << "sync";
+    Expected += "sync";
+    OS.close();
+    EXPECT_FALSE(OS.has_error());
+  }
+  EXPECT_EQ(Expected, readFile(Path));
+
+  // Errors of the background writes are reported by close().
+  int FD;
+  ASSERT_FALSE(sys::fs::openFileForRead(Path.c_str(), FD));
+  {
+    raw_fd_ostream OS(FD, true);
+    OS.SetUseAsyncWrites(true);
+    OS << std::string(3 * 1024 * 1024, 'y');
+    OS.close();
+    EXPECT_TRUE(OS.has_error());
+    OS.clear_error();
+  }
+  sys::fs::remove(Path.str());
+}
+
+TEST(raw_ostreamTest, ReserveExtraSpaceVector) {
+  SmallString<16> Buffer;
+  raw_svector_ostream OS(Buffer);
+  OS << "abc";
+  OS.reserveExtraSpace(100000);
+  EXPECT_LE(100003U, Buffer.capacity());
+  OS << std::string(100000, 'x');
+  EXPECT_EQ(100003U, OS.str().size());
+  EXPECT_EQ("abcx", OS.str().substr(0, 4));
+}
+
 }
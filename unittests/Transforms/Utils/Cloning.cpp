@@ -7,6 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/OwningPtr.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/IR/Argument.h"
@@ -15,6 +16,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "gtest/gtest.h"
 
@@ -173,4 +175,41 @@ TEST_F(CloneInstruction, Attributes) {
   delete F2;
 }
 
+TEST(CloneModulePartition, DeclaresReferences) {
+  LLVMContext Context;
+  Module M("m", Context);
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  FunctionType *FTy = FunctionType::get(Int32Ty, false);
+
+  GlobalVariable *G =
+    new GlobalVariable(M, Int32Ty, false, GlobalValue::InternalLinkage,
+                       ConstantInt::get(Int32Ty, 1), "g");
+  Function *Callee = Function::Create(FTy, GlobalValue::LinkOnceODRLinkage,
+                                      "callee", &M);
+  IRBuilder<> Builder(BasicBlock::Create(Context, "", Callee));
+  Builder.CreateRet(Builder.CreateLoad(G));
+
+  Function *Caller =
+    Function::Create(FTy, GlobalValue::ExternalLinkage, "caller", &M);
+  Builder.SetInsertPoint(BasicBlock::Create(Context, "", Caller));
+  Builder.CreateRet(Builder.CreateCall(Callee));
+
+  const GlobalValue *Definitions[] = { Caller };
+  ValueToValueMapTy VMap;
+  OwningPtr<Module> New(CloneModulePartition(&M, Definitions, VMap));
+
+  Function *NewCaller = New->getFunction("caller");
+  ASSERT_TRUE(NewCaller != 0);
+  EXPECT_FALSE(NewCaller->isDeclaration());
+  EXPECT_EQ(NewCaller, VMap[Caller]);
+
+  // The callee is declared but its body, and the global only the body refers
+  // to, are not copied.
+  Function *NewCallee = New->getFunction("callee");
+  ASSERT_TRUE(NewCallee != 0);
+  EXPECT_TRUE(NewCallee->isDeclaration());
+  EXPECT_TRUE(NewCallee->hasExternalLinkage());
+  EXPECT_TRUE(New->getNamedGlobal("g") == 0);
+}
+
 }
@@ -7,12 +7,18 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/SpecialCaseList.h"
 #include "gtest/gtest.h"
+#include <cstdlib>
+#include <vector>
 
 using namespace llvm;
 
@@ -207,6 +213,43 @@ TEST_F(SpecialCaseListTest, Substring) {
   EXPECT_TRUE(SCL->isIn(*GA1));
 }
 
+TEST_F(SpecialCaseListTest, Wildcards) {
+  Module M("hello", Ctx);
+  Function *F1 = makeFunction("_ZN4llvm3fooEv", M);
+  Function *F2 = makeFunction("_ZN4llvm3barEv", M);
+  Function *F3 = makeFunction("_ZN5clang3fooEv", M);
+  Function *F4 = makeFunction("aaa", M);
+
+  OwningPtr<SpecialCaseList> SCL(makeSpecialCaseList("fun:_ZN4llvm*\n"));
+  EXPECT_TRUE(SCL->isIn(*F1));
+  EXPECT_TRUE(SCL->isIn(*F2));
+  EXPECT_FALSE(SCL->isIn(*F3));
+
+  SCL.reset(makeSpecialCaseList("fun:_ZN4llvm*\n"
+                                "fun:_ZN*3foo*\n"));
+  EXPECT_TRUE(SCL->isIn(*F1));
+  EXPECT_TRUE(SCL->isIn(*F2));
+  EXPECT_TRUE(SCL->isIn(*F3));
+  EXPECT_FALSE(SCL->isIn(*F4));
+
+  SCL.reset(makeSpecialCaseList("fun:*foo*Ev\n"
+                                "fun:a*a*a\n"));
+  EXPECT_TRUE(SCL->isIn(*F1));
+  EXPECT_FALSE(SCL->isIn(*F2));
+  EXPECT_TRUE(SCL->isIn(*F3));
+  EXPECT_TRUE(SCL->isIn(*F4));
+
+  SCL.reset(makeSpecialCaseList("fun:a*a*a*a\n"
+                                "fun:_ZN4llvm3ba.Ev\n"));
+  EXPECT_FALSE(SCL->isIn(*F1));
+  EXPECT_TRUE(SCL->isIn(*F2));
+  EXPECT_FALSE(SCL->isIn(*F4));
+
+  SCL.reset(makeSpecialCaseList("fun:*\n"));
+  EXPECT_TRUE(SCL->isIn(*F1));
+  EXPECT_TRUE(SCL->isIn(*F4));
+}
+
 TEST_F(SpecialCaseListTest, InvalidSpecialCaseList) {
   std::string Error;
   EXPECT_EQ(0, makeSpecialCaseList("badline", Error));
@@ -229,4 +272,48 @@ TEST_F(SpecialCaseListTest, EmptySpecialCaseList) {
   EXPECT_FALSE(SCL->isIn(M));
 }
 
+// Microbenchmark comparing a list of many wildcard patterns with the single
+// combined regex they used to be matched with.  Run it with
+// --gtest_also_run_disabled_tests.
+TEST_F(SpecialCaseListTest, DISABLED_WildcardBenchmark) {
+  const unsigned NumPatterns = 1000, NumFunctions = 200;
+  srand(0);
+
+  std::string List, CombinedRegex;
+  for (unsigned i = 0; i != NumPatterns; ++i) {
+    std::string Pattern = "_ZN" + utostr(rand() % 100000) + "*" +
+                          utostr(rand() % 10) + "Ev";
+    List += "fun:" + Pattern + "\n";
+    if (!CombinedRegex.empty())
+      CombinedRegex += "|";
+    CombinedRegex += "^" + Pattern.replace(Pattern.find('*'), 1, ".*") + "$";
+  }
+  OwningPtr<SpecialCaseList> SCL(makeSpecialCaseList(List));
+  Regex RE(CombinedRegex);
+
+  Module M("hello", Ctx);
+  std::vector<Function *> Functions;
+  for (unsigned i = 0; i != NumFunctions; ++i)
+    Functions.push_back(makeFunction(
+        "_ZN" + utostr(rand() % 100000) + "foo" + utostr(rand() % 10) + "Ev",
+        M));
+
+  sys::TimeValue Start = sys::TimeValue::now();
+  unsigned RegexMatches = 0;
+  for (unsigned i = 0; i != NumFunctions; ++i)
+    RegexMatches += RE.match(Functions[i]->getName());
+  double RegexTime = (sys::TimeValue::now() - Start).msec();
+
+  Start = sys::TimeValue::now();
+  unsigned ListMatches = 0;
+  for (unsigned i = 0; i != NumFunctions; ++i)
+    ListMatches += SCL->isIn(*Functions[i]);
+  double ListTime = (sys::TimeValue::now() - Start).msec();
+
+  EXPECT_EQ(RegexMatches, ListMatches);
+  outs() << NumFunctions << " functions against " << NumPatterns
+         << " patterns: Regex " << RegexTime << " ms, SpecialCaseList "
+         << ListTime << " ms\n";
+}
+
 }
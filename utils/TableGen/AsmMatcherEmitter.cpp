@@ -2418,6 +2418,50 @@ static void emitMnemonicAliasVariant(raw_ostream &OS,const AsmMatcherInfo &Info,
   StringMatcher("Mnemonic", Cases, OS).Emit(Indent);
 }
 
+/// emitMnemonicRangeLookups - Emit, for each asm variant, a function that maps
+/// a mnemonic to the range of its entries in the variant's match table.  The
+/// lookup switches on the length and characters of the mnemonic instead of
+/// binary searching the table with string comparisons.
+static void emitMnemonicRangeLookups(raw_ostream &OS,
+                                     const AsmMatcherInfo &Info,
+                                     CodeGenTarget &Target) {
+  unsigned VariantCount = Target.getAsmParserVariantCount();
+  for (unsigned VC = 0; VC != VariantCount; ++VC) {
+    Record *AsmVariant = Target.getAsmParserVariant(VC);
+    int AsmVariantNo = AsmVariant->getValueAsInt("Variant");
+
+    // The matchables are sorted by mnemonic, so the entries of one mnemonic
+    // are contiguous in the table.
+    std::vector<StringMatcher::StringPair> Cases;
+    unsigned Index = 0, First = 0;
+    for (std::vector<MatchableInfo*>::const_iterator it =
+         Info.Matchables.begin(), ie = Info.Matchables.end();
+         it != ie; ++it) {
+      MatchableInfo &II = **it;
+      if (II.AsmVariantID != AsmVariantNo)
+        continue;
+      if (!Cases.empty() && Cases.back().first == II.Mnemonic) {
+        ++Index;
+        continue;
+      }
+      if (!Cases.empty())
+        Cases.back().second = "return std::make_pair(" + utostr(First) +
+                              "U, " + utostr(Index) + "U);";
+      Cases.push_back(StringMatcher::StringPair(II.Mnemonic, ""));
+      First = Index++;
+    }
+    if (!Cases.empty())
+      Cases.back().second = "return std::make_pair(" + utostr(First) +
+                            "U, " + utostr(Index) + "U);";
+
+    OS << "static std::pair<unsigned, unsigned> lookupMnemonic" << VC
+       << "(StringRef Mnemonic) {\n";
+    StringMatcher("Mnemonic", Cases, OS).Emit();
+    OS << "  return std::make_pair(0U, 0U);\n";
+    OS << "}\n\n";
+  }
+}
+
 /// emitMnemonicAliases - If the target has any MnemonicAlias<> definitions,
 /// emit a function for them and return true, otherwise return false.
 static bool emitMnemonicAliases(raw_ostream &OS, const AsmMatcherInfo &Info,
@@ -2881,24 +2925,23 @@ void AsmMatcherEmitter::run(raw_ostream &OS) {
     OS << "};\n\n";
   }
 
+  emitMnemonicRangeLookups(OS, Info, Target);
+
   // A method to determine if a mnemonic is in the list.
   OS << "bool " << Target.getName() << ClassName << "::\n"
      << "mnemonicIsValid(StringRef Mnemonic, unsigned VariantID) {\n";
-  OS << "  // Find the appropriate table for this asm variant.\n";
-  OS << "  const MatchEntry *Start, *End;\n";
+  OS << "  // Look the mnemonic up in the table for this asm variant.\n";
+  OS << "  std::pair<unsigned, unsigned> Range;\n";
   OS << "  switch (VariantID) {\n";
   OS << "  default: // unreachable\n";
   for (unsigned VC = 0; VC != VariantCount; ++VC) {
     Record *AsmVariant = Target.getAsmParserVariant(VC);
     int AsmVariantNo = AsmVariant->getValueAsInt("Variant");
-    OS << "  case " << AsmVariantNo << ": Start = MatchTable" << VC
-       << "; End = array_endof(MatchTable" << VC << "); break;\n";
+    OS << "  case " << AsmVariantNo << ": Range = lookupMnemonic" << VC
+       << "(Mnemonic); break;\n";
   }
   OS << "  }\n";
-  OS << "  // Search the table.\n";
-  OS << "  std::pair<const MatchEntry*, const MatchEntry*> MnemonicRange =\n";
-  OS << "    std::equal_range(Start, End, Mnemonic, LessOpcode());\n";
-  OS << "  return MnemonicRange.first != MnemonicRange.second;\n";
+  OS << "  return Range.first != Range.second;\n";
   OS << "}\n\n";
 
   // Finally, build the match function.
@@ -2939,20 +2982,21 @@ void AsmMatcherEmitter::run(raw_ostream &OS) {
   OS << "  ErrorInfo = ~0U;\n";
 
   // Emit code to search the table.
-  OS << "  // Find the appropriate table for this asm variant.\n";
-  OS << "  const MatchEntry *Start, *End;\n";
+  OS << "  // Find the appropriate table for this asm variant and look the\n";
+  OS << "  // mnemonic up in it.\n";
+  OS << "  const MatchEntry *Start;\n";
+  OS << "  std::pair<unsigned, unsigned> Range;\n";
   OS << "  switch (VariantID) {\n";
   OS << "  default: // unreachable\n";
   for (unsigned VC = 0; VC != VariantCount; ++VC) {
     Record *AsmVariant = Target.getAsmParserVariant(VC);
     int AsmVariantNo = AsmVariant->getValueAsInt("Variant");
     OS << "  case " << AsmVariantNo << ": Start = MatchTable" << VC
-       << "; End = array_endof(MatchTable" << VC << "); break;\n";
+       << "; Range = lookupMnemonic" << VC << "(Mnemonic); break;\n";
   }
   OS << "  }\n";
-  OS << "  // Search the table.\n";
-  OS << "  std::pair<const MatchEntry*, const MatchEntry*> MnemonicRange =\n";
-  OS << "    std::equal_range(Start, End, Mnemonic, LessOpcode());\n\n";
+  OS << "  std::pair<const MatchEntry*, const MatchEntry*> MnemonicRange(\n";
+  OS << "    Start + Range.first, Start + Range.second);\n\n";
 
   OS << "  // Return a more specific error code if no mnemonics match.\n";
   OS << "  if (MnemonicRange.first == MnemonicRange.second)\n";
@@ -2962,7 +3006,7 @@ void AsmMatcherEmitter::run(raw_ostream &OS) {
      << "*ie = MnemonicRange.second;\n";
   OS << "       it != ie; ++it) {\n";
 
-  OS << "    // equal_range guarantees that instruction mnemonic matches.\n";
+  OS << "    // The lookup guarantees that instruction mnemonic matches.\n";
   OS << "    assert(Mnemonic == it->getMnemonic());\n";
 
   // Emit check that the subclasses match.
@@ -19,6 +19,7 @@
 #include "llvm/TableGen/Error.h"
 #include "llvm/TableGen/Main.h"
 #include "llvm/TableGen/Record.h"
+#include <algorithm>
 
 using namespace llvm;
 
@@ -45,8 +46,8 @@ enum ActionType {
 };
 
 namespace {
-  cl::opt<ActionType>
-  Action(cl::desc("Action to perform:"),
+  cl::list<ActionType>
+  Actions(cl::desc("Actions to perform, each with its own -o:"),
          cl::values(clEnumValN(PrintRecords, "print-records",
                                "Print all records to stdout (default)"),
                     clEnumValN(GenEmitter, "gen-emitter",
@@ -91,7 +92,8 @@ namespace {
   Class("class", cl::desc("Print Enum list for this class"),
           cl::value_desc("class name"));
 
-bool LLVMTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
+bool LLVMTableGenMain(raw_ostream &OS, RecordKeeper &Records, unsigned Index) {
+  ActionType Action = Actions.empty() ? PrintRecords : Actions[Index];
   switch (Action) {
   case PrintRecords:
     OS << Records;           // No argument, dump all contents
@@ -178,5 +180,6 @@ int main(int argc, char **argv) {
   PrettyStackTraceProgram X(argc, argv);
   cl::ParseCommandLineOptions(argc, argv);
 
-  return TableGenMain(argv[0], &LLVMTableGenMain);
+  return TableGenMain(argv[0], &LLVMTableGenMain,
+                      std::max<unsigned>(1, Actions.size()));
 }
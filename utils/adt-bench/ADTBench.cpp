@@ -0,0 +1,406 @@
+//===- ADTBench - Benchmark the ADT and Support containers ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program runs workloads typical of the compiler on the containers in
+// ADT and Support, such as pointer-keyed maps of various sizes, insert/erase
+// churn, iteration and string interning, and outputs the run time of each.
+// It is meant for judging changes to hash functions and growth policies.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/ImmutableMap.h"
+#include "llvm/ADT/IntervalMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SparseSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<unsigned>
+Scale("scale", cl::desc("Multiply the work done by every benchmark by this"),
+      cl::init(1));
+
+static cl::opt<std::string>
+Filter("filter", cl::desc("Only run the benchmarks whose name contains this"),
+       cl::value_desc("substring"));
+
+static cl::opt<bool>
+List("list", cl::desc("List the benchmarks instead of running them"));
+
+/// The number of operations each benchmark does, whatever the size of its
+/// containers, before -scale.
+static const unsigned OpsPerBenchmark = 1 << 22;
+
+/// Sink - The benchmarks add their results here, so that the work is not
+/// optimized away.
+static volatile uint64_t Sink;
+
+namespace {
+/// Random - A small deterministic generator, so that each run does exactly
+/// the same work.
+class Random {
+  uint32_t State;
+public:
+  explicit Random(uint32_t Seed) : State(Seed) {}
+  uint32_t next() {
+    State ^= State << 13;
+    State ^= State >> 17;
+    State ^= State << 5;
+    return State;
+  }
+  uint32_t operator()(uint32_t N) { return next() % N; }
+};
+}
+
+/// makePointers - Return N distinct pointer-like keys in a random order,
+/// spaced and aligned like small heap objects.
+static std::vector<void *> makePointers(unsigned N, uint32_t Seed) {
+  std::vector<void *> Keys(N);
+  for (unsigned i = 0; i != N; ++i)
+    Keys[i] = reinterpret_cast<void *>(uintptr_t(0x100000) + uintptr_t(i) * 48);
+  Random R(Seed);
+  std::random_shuffle(Keys.begin(), Keys.end(), R);
+  return Keys;
+}
+
+/// makeNames - Return N distinct names like those of values and symbols.
+static std::vector<std::string> makeNames(unsigned N, uint32_t Seed) {
+  static const char *const Stems[] = {
+    "tmp", "call", "arrayidx", "add", "cmp", "_ZN4llvm5Value7getNameEv",
+    "for.body", "if.then", "retval", "this.addr"
+  };
+  std::vector<std::string> Names(N);
+  Random R(Seed);
+  for (unsigned i = 0; i != N; ++i) {
+    raw_string_ostream OS(Names[i]);
+    OS << Stems[R(array_lengthof(Stems))] << '.' << i;
+  }
+  return Names;
+}
+
+//===----------------------------------------------------------------------===//
+// Benchmarks.  Each does Size * Rounds operations on containers holding up to
+// Size elements.
+
+static uint64_t denseMapInsertFind(unsigned Size, unsigned Rounds) {
+  std::vector<void *> Keys = makePointers(Size * 2, 1);
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r) {
+    DenseMap<void *, unsigned> Map;
+    for (unsigned i = 0; i != Size; ++i)
+      Map[Keys[i]] = i;
+    // Half of the lookups hit and half miss.
+    for (unsigned i = Size / 2, e = Size + Size / 2; i != e; ++i) {
+      DenseMap<void *, unsigned>::iterator I = Map.find(Keys[i]);
+      if (I != Map.end())
+        Sum += I->second;
+    }
+  }
+  return Sum;
+}
+
+static uint64_t denseMapChurn(unsigned Size, unsigned Rounds) {
+  std::vector<void *> Keys = makePointers(Size * 2, 2);
+  DenseMap<void *, unsigned> Map;
+  for (unsigned i = 0; i != Size; ++i)
+    Map[Keys[i]] = i;
+  // Keep the map at Size elements, leaving tombstones behind.
+  Random R(3);
+  unsigned Out = Size;
+  uint64_t Sum = 0;
+  for (unsigned i = 0, e = Size * Rounds; i != e; ++i) {
+    unsigned In = R(Size * 2);
+    if (!Map.count(Keys[In]))
+      continue;
+    Map.erase(Keys[In]);
+    Map[Keys[Out]] = i;
+    Out = In;
+    Sum += Map.size();
+  }
+  return Sum;
+}
+
+static uint64_t denseMapIterate(unsigned Size, unsigned Rounds) {
+  std::vector<void *> Keys = makePointers(Size, 4);
+  DenseMap<void *, unsigned> Map;
+  for (unsigned i = 0; i != Size; ++i)
+    Map[Keys[i]] = i;
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r)
+    for (DenseMap<void *, unsigned>::iterator I = Map.begin(), E = Map.end();
+         I != E; ++I)
+      Sum += I->second;
+  return Sum;
+}
+
+static uint64_t smallVectorPushBack(unsigned Size, unsigned Rounds) {
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r) {
+    SmallVector<unsigned, 8> V;
+    for (unsigned i = 0; i != Size; ++i)
+      V.push_back(i);
+    Sum += V.size() + V.back();
+  }
+  return Sum;
+}
+
+static uint64_t smallPtrSetInsertCount(unsigned Size, unsigned Rounds) {
+  std::vector<void *> Keys = makePointers(Size * 2, 5);
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r) {
+    SmallPtrSet<void *, 16> Set;
+    for (unsigned i = 0; i != Size; ++i)
+      Set.insert(Keys[i]);
+    for (unsigned i = Size / 2, e = Size + Size / 2; i != e; ++i)
+      Sum += Set.count(Keys[i]);
+  }
+  return Sum;
+}
+
+static uint64_t stringMapIntern(unsigned Size, unsigned Rounds) {
+  std::vector<std::string> Names = makeNames(Size, 6);
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r) {
+    StringMap<unsigned> Map;
+    // Each name is interned once and then looked up three more times.
+    for (unsigned k = 0; k != 4; ++k)
+      for (unsigned i = 0; i != Size; ++i)
+        Sum += Map.GetOrCreateValue(Names[i], i).getValue();
+  }
+  return Sum;
+}
+
+namespace {
+/// Node - A uniqued node, like a constant or an SDNode.
+struct Node : public FoldingSetNode {
+  unsigned Opcode;
+  void *Op0, *Op1;
+  Node(unsigned Opcode, void *Op0, void *Op1)
+    : Opcode(Opcode), Op0(Op0), Op1(Op1) {}
+  void Profile(FoldingSetNodeID &ID) const {
+    ID.AddInteger(Opcode);
+    ID.AddPointer(Op0);
+    ID.AddPointer(Op1);
+  }
+};
+}
+
+static uint64_t foldingSetUnique(unsigned Size, unsigned Rounds) {
+  std::vector<void *> Ops = makePointers(Size, 7);
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r) {
+    BumpPtrAllocator Alloc;
+    FoldingSet<Node> Set;
+    Random R(8);
+    // About half of the nodes requested already exist.
+    for (unsigned i = 0; i != Size; ++i) {
+      unsigned Opcode = R(4);
+      void *Op0 = Ops[R(Size)], *Op1 = Ops[i / 2];
+      FoldingSetNodeID ID;
+      ID.AddInteger(Opcode);
+      ID.AddPointer(Op0);
+      ID.AddPointer(Op1);
+      void *InsertPos;
+      if (Set.FindNodeOrInsertPos(ID, InsertPos)) {
+        ++Sum;
+        continue;
+      }
+      Set.InsertNode(new (Alloc.Allocate<Node>()) Node(Opcode, Op0, Op1),
+                     InsertPos);
+    }
+  }
+  return Sum;
+}
+
+static uint64_t intervalMapInsertLookup(unsigned Size, unsigned Rounds) {
+  typedef IntervalMap<unsigned, unsigned> MapT;
+  std::vector<unsigned> Order(Size);
+  for (unsigned i = 0; i != Size; ++i)
+    Order[i] = i;
+  Random R(9);
+  std::random_shuffle(Order.begin(), Order.end(), R);
+
+  uint64_t Sum = 0;
+  MapT::Allocator Alloc;
+  for (unsigned r = 0; r != Rounds; ++r) {
+    MapT Map(Alloc);
+    for (unsigned i = 0; i != Size; ++i)
+      Map.insert(Order[i] * 16, Order[i] * 16 + 7, i + 1);
+    for (unsigned i = 0; i != Size; ++i)
+      Sum += Map.lookup(i * 8);
+  }
+  return Sum;
+}
+
+static uint64_t sparseSetInsertErase(unsigned Size, unsigned Rounds) {
+  std::vector<unsigned> Keys(Size);
+  Random R(10);
+  for (unsigned i = 0; i != Size; ++i)
+    Keys[i] = R(Size * 2);
+
+  SparseSet<unsigned> Set;
+  Set.setUniverse(Size * 2);
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r) {
+    for (unsigned i = 0; i != Size; ++i)
+      Set.insert(Keys[i]);
+    for (unsigned i = 0; i < Size; i += 2)
+      Set.erase(Keys[i]);
+    Sum += Set.size();
+    Set.clear();
+  }
+  return Sum;
+}
+
+static uint64_t immutableMapAddRemove(unsigned Size, unsigned Rounds) {
+  typedef ImmutableMap<unsigned, unsigned> MapT;
+  std::vector<unsigned> Keys(Size);
+  for (unsigned i = 0; i != Size; ++i)
+    Keys[i] = i;
+  Random R(11);
+  std::random_shuffle(Keys.begin(), Keys.end(), R);
+
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r) {
+    MapT::Factory F;
+    MapT Map = F.getEmptyMap();
+    for (unsigned i = 0; i != Size; ++i)
+      Map = F.add(Map, Keys[i], i);
+    for (unsigned i = 0; i < Size; i += 2)
+      Map = F.remove(Map, Keys[i]);
+    for (unsigned i = 0; i != Size; ++i)
+      if (const unsigned *V = Map.lookup(i))
+        Sum += *V;
+  }
+  return Sum;
+}
+
+static uint64_t bumpPtrAllocate(unsigned Size, unsigned Rounds) {
+  std::vector<unsigned> Sizes(Size);
+  Random R(12);
+  for (unsigned i = 0; i != Size; ++i)
+    Sizes[i] = 8 + R(8) * 8;
+
+  BumpPtrAllocator Alloc;
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r) {
+    for (unsigned i = 0; i != Size; ++i)
+      Sum += reinterpret_cast<uintptr_t>(Alloc.Allocate(Sizes[i], 8)) & 0xff;
+    Sum += Alloc.getTotalMemory();
+    Alloc.Reset();
+  }
+  return Sum;
+}
+
+static uint64_t rawOstreamFormat(unsigned Size, unsigned Rounds) {
+  std::vector<std::string> Names = makeNames(Size, 13);
+  uint64_t Sum = 0;
+  SmallString<4096> Buffer;
+  for (unsigned r = 0; r != Rounds; ++r) {
+    Buffer.clear();
+    raw_svector_ostream OS(Buffer);
+    for (unsigned i = 0; i != Size; ++i)
+      OS << "  %" << Names[i] << " = add i32 %" << i << ", " << -int(i)
+         << '\n';
+    Sum += OS.str().size();
+  }
+  return Sum;
+}
+
+static uint64_t hashStrings(unsigned Size, unsigned Rounds) {
+  std::vector<std::string> Names = makeNames(Size, 14);
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r)
+    for (unsigned i = 0; i != Size; ++i)
+      Sum += hash_value(StringRef(Names[i]));
+  return Sum;
+}
+
+static uint64_t hashCombinePointers(unsigned Size, unsigned Rounds) {
+  std::vector<void *> Keys = makePointers(Size, 15);
+  uint64_t Sum = 0;
+  for (unsigned r = 0; r != Rounds; ++r)
+    for (unsigned i = 0; i != Size; ++i)
+      Sum += hash_combine(Keys[i], i, Keys[Size - 1 - i]);
+  return Sum;
+}
+
+namespace {
+struct BenchmarkInfo {
+  const char *Name;
+  uint64_t (*Run)(unsigned Size, unsigned Rounds);
+  unsigned Size;
+};
+}
+
+static const BenchmarkInfo Benchmarks[] = {
+  { "DenseMap<void*> insert+find, 16 keys", denseMapInsertFind, 16 },
+  { "DenseMap<void*> insert+find, 1024 keys", denseMapInsertFind, 1024 },
+  { "DenseMap<void*> insert+find, 1M keys", denseMapInsertFind, 1 << 20 },
+  { "DenseMap<void*> erase/insert churn, 1024 keys", denseMapChurn, 1024 },
+  { "DenseMap<void*> erase/insert churn, 64K keys", denseMapChurn, 1 << 16 },
+  { "DenseMap<void*> iteration, 1024 keys", denseMapIterate, 1024 },
+  { "SmallVector<unsigned, 8> push_back, 8 elements",
+    smallVectorPushBack, 8 },
+  { "SmallVector<unsigned, 8> push_back, 4096 elements",
+    smallVectorPushBack, 4096 },
+  { "SmallPtrSet<void*, 16> insert+count, 16 keys",
+    smallPtrSetInsertCount, 16 },
+  { "SmallPtrSet<void*, 16> insert+count, 4096 keys",
+    smallPtrSetInsertCount, 4096 },
+  { "StringMap interning, 1024 names", stringMapIntern, 1024 },
+  { "StringMap interning, 64K names", stringMapIntern, 1 << 16 },
+  { "FoldingSet uniquing, 4096 nodes", foldingSetUnique, 4096 },
+  { "IntervalMap insert+lookup, 1024 intervals",
+    intervalMapInsertLookup, 1024 },
+  { "SparseSet insert+erase, 4096 keys", sparseSetInsertErase, 4096 },
+  { "ImmutableMap add+remove, 1024 keys", immutableMapAddRemove, 1024 },
+  { "BumpPtrAllocator small allocations", bumpPtrAllocate, 4096 },
+  { "raw_svector_ostream formatting", rawOstreamFormat, 1024 },
+  { "hash_value(StringRef)", hashStrings, 1024 },
+  { "hash_combine(void*, unsigned, void*)", hashCombinePointers, 1024 }
+};
+
+int main(int argc, char **argv) {
+  cl::ParseCommandLineOptions(argc, argv, "ADT container benchmark\n");
+
+  TimerGroup Group("ADT container benchmark");
+  // The group is printed once all of its timers are gone.
+  std::vector<Timer> Timers(array_lengthof(Benchmarks));
+  for (unsigned i = 0, e = array_lengthof(Benchmarks); i != e; ++i) {
+    const BenchmarkInfo &B = Benchmarks[i];
+    if (StringRef(B.Name).find(Filter) == StringRef::npos)
+      continue;
+    if (List) {
+      outs() << B.Name << '\n';
+      continue;
+    }
+
+    unsigned Rounds = std::max(1u, OpsPerBenchmark / B.Size) * Scale;
+    Timers[i].init(B.Name, Group);
+    Timers[i].startTimer();
+    Sink += B.Run(B.Size, Rounds);
+    Timers[i].stopTimer();
+  }
+
+  return 0;
+}